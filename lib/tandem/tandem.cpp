@@ -138,12 +138,12 @@ get_init_buckets(const std::size_t n, const std::vector<std::vector<Repeat>>& en
 void rebase(std::vector<tandem::Repeat>& runs, const std::map<std::size_t, std::size_t>& shift_map)
 {
     if (shift_map.empty()) return;
-    auto shift_map_it = std::cbegin(shift_map);
     for (auto& run : runs) {
-        while (std::next(shift_map_it) != std::cend(shift_map) && std::next(shift_map_it)->first <= run.pos) {
-            ++shift_map_it;
+        // Runs before the first collapsed sub-sequence are not shifted
+        const auto shift_itr = shift_map.upper_bound(run.pos);
+        if (shift_itr != std::cbegin(shift_map)) {
+            run.pos += static_cast<decltype(run.pos)>(std::prev(shift_itr)->second);
         }
-        run.pos += static_cast<decltype(run.pos)>(shift_map_it->second);
     }
 }
 
@@ -514,8 +514,8 @@ extract_exact_tandem_repeats(const T& str,
 
 /**
  Replaces all contiguous sub-sequences of c with a single c, inplace, and returns a map of
- each c position in the new sequence, and how many c's have been removed up to the first non-c
- base past the position. This is just a helper that can speed up repetition finding if the sequence
+ the position just past each collapsed sub-sequence in the new sequence, and how many c's have been
+ removed before the position. This is just a helper that can speed up repetition finding if the sequence
  contains long runs of characters that are not of interest (e.g. unknwown base 'N' in DNA/RNA sequence).
  
  If this function is used, the output StringRun's will need to be rebased to get the correct positions
@@ -523,7 +523,7 @@ extract_exact_tandem_repeats(const T& str,
  
  Example:
  std::string str {"NNNACGTNNTGCNANNNN"};
- auto n_shift_map = colapse(str, 'N'); // str is now "NACGTNTGCNAN", n_shift_map contains (0, 2), (4, 3), (9, 6)
+ auto n_shift_map = colapse(str, 'N'); // str is now "NACGTNTGCNAN", n_shift_map contains (1, 2), (6, 3), (12, 6)
  */
 template <typename SequenceType>
 std::map<std::size_t, std::size_t> collapse(SequenceType& sequence, const char c)
@@ -538,13 +538,13 @@ std::map<std::size_t, std::size_t> collapse(SequenceType& sequence, const char c
                                             });
         if (it1 == last) break;
         const auto it2 = std::find_if_not(it1, last, [c] (const char b) { return b == c; });
-        position    += std::distance(first, it1);
+        position    += std::distance(first, it1) + 1;
         num_removed += std::distance(it1, it2) - 1;
         result.emplace(position, num_removed);
         first = it2;
     }
     if (!result.empty()) {
-        sequence.erase(std::unique(std::next(std::begin(sequence), std::cbegin(result)->first), last,
+        sequence.erase(std::unique(std::next(std::begin(sequence), std::cbegin(result)->first - 1), last,
                                    [c] (const char lhs, const char rhs) noexcept {
                                        return lhs == c && lhs == rhs;
                                    }),
@@ -369,6 +369,12 @@ def main(args):
         cmake_options.append("-DCMAKE_VERBOSE_MAKEFILE:BOOL=ON")
     if args["architecture"]:
             cmake_options.append("-DCOMPILER_ARCHITECTURE=" + args["architecture"])
+    if args["cuda"]:
+        cmake_options.append("-DCUDA_PAIR_HMM=ON")
+    if args["single_precision_likelihoods"]:
+        cmake_options.append("-DSINGLE_PRECISION_LIKELIHOODS=ON")
+    if args["arena_allocation"]:
+        cmake_options.append("-DARENA_ALLOCATION=ON")
     if dependencies_dir is not None:
         if args["c_compiler"]:
             cmake_options.append("-DCMAKE_C_COMPILER=" + str(args["c_compiler"]))
@@ -507,5 +513,17 @@ if __name__ == '__main__':
                         required=False,
                         type=str,
                         help='The architecture to compile for')
+    parser.add_argument('--cuda',
+                        default=False,
+                        help='Build the CUDA pair HMM backend (use with --pair-hmm-gpu)',
+                        action='store_true')
+    parser.add_argument('--single-precision-likelihoods',
+                        default=False,
+                        help='Store haplotype likelihoods in single precision (see test/regression/regression.py)',
+                        action='store_true')
+    parser.add_argument('--arena-allocation',
+                        default=False,
+                        help='Allocate per-window calling scratch data from a thread-local arena',
+                        action='store_true')
     args = vars(parser.parse_args())
     main(args)
@@ -10,6 +10,7 @@
 
 #include "utils/sequence_utils.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/simd_bytes.hpp"
 
 namespace octopus {
 
@@ -20,7 +21,7 @@ constexpr AlignedRead::Tag AlignedRead::barcode_tag_;
 
 const GenomicRegion::ContigName& AlignedRead::Segment::contig_name() const
 {
-    return contig_name_;
+    return ContigDictionary::instance().name(contig_id_);
 }
 
 GenomicRegion::Position AlignedRead::Segment::begin() const noexcept
@@ -269,9 +270,19 @@ bool AlignedRead::is_marked_last_template_segment() const noexcept
     return flags_[9];
 }
 
+AlignedRead::FlagMask AlignedRead::make_flag_mask(const Flags& flags) noexcept
+{
+    return static_cast<FlagMask>(compress(flags).to_ulong());
+}
+
+bool AlignedRead::is_marked_any(const FlagMask mask) const noexcept
+{
+    return (flags_.to_ulong() & mask) != 0;
+}
+
 // private methods
 
-AlignedRead::FlagBits AlignedRead::compress(const Flags& flags) const noexcept
+AlignedRead::FlagBits AlignedRead::compress(const Flags& flags) noexcept
 {
     FlagBits result {};
     result[0] = flags.all_segments_in_read_aligned;
@@ -289,7 +300,7 @@ AlignedRead::FlagBits AlignedRead::compress(const Flags& flags) const noexcept
 
 AlignedRead::Flags AlignedRead::decompress(const FlagBits& flags) const noexcept
 {
-    return {flags[0], flags[1], flags[2], flags[3], flags[4], flags[5], flags[6], flags[7], flags[8], flags[9]};
+    return {flags[1], flags[0], flags[2], flags[3], flags[4], flags[5], flags[6], flags[7], flags[8], flags[9]};
 }
 
 AlignedRead::Segment::FlagBits AlignedRead::Segment::compress(const Flags& flags)
@@ -349,7 +360,10 @@ GenomicRegion::Position three_prime_mapping_position(const AlignedRead& read) no
 
 void capitalise_bases(AlignedRead& read) noexcept
 {
-    utils::capitalise(read.sequence());
+    auto& sequence = read.sequence();
+    if (!sequence.empty()) {
+        utils::simd::capitalise(&sequence.front(), &sequence.front() + sequence.size());
+    }
 }
 
 unsigned sum_base_qualities(const AlignedRead& read) noexcept
@@ -360,8 +374,7 @@ unsigned sum_base_qualities(const AlignedRead& read) noexcept
 void cap_qualities(AlignedRead& read, const AlignedRead::BaseQuality max) noexcept
 {
     auto& qualities = read.base_qualities();
-    std::transform(std::cbegin(qualities), std::cend(qualities), std::begin(qualities),
-                   [max] (const auto q) { return std::min(q, max); });
+    utils::simd::cap(qualities.data(), qualities.data() + qualities.size(), max);
 }
 
 void set_front_qualities(AlignedRead& read, std::size_t num_bases, const AlignedRead::BaseQuality value) noexcept
@@ -619,11 +632,6 @@ std::vector<AlignedRead> split(const AlignedRead& read, const GenomicRegion::Siz
 
 namespace {
 
-auto calculate_dynamic_bytes(const AlignedRead::Segment& segment) noexcept
-{
-    return segment.contig_name().size() * sizeof(char);
-}
-
 auto calculate_dynamic_bytes(const AlignedRead::Annotation& annotation) noexcept
 {
     return sizeof(AlignedRead::Annotation) + annotation.size() * sizeof(char);
@@ -635,9 +643,8 @@ auto calculate_dynamic_bytes(const AlignedRead& read) noexcept
     return read.name().size() * sizeof(char)
            + sequence_size(read) * sizeof(char)
            + sequence_size(read) * sizeof(AlignedRead::BaseQuality)
-           + read.cigar().size() * sizeof(CigarOperation)
-           + contig_name(read).size() * sizeof(char)
-           + (read.has_other_segment() ? sizeof(AlignedRead::Segment) + calculate_dynamic_bytes(read.next_segment()) : 0)
+           + (is_inline(read.cigar()) ? 0 : read.cigar().capacity() * sizeof(CigarOperation))
+           + (read.has_other_segment() ? sizeof(AlignedRead::Segment) : 0)
            + std::accumulate(std::cbegin(tags), std::cend(tags), std::size_t {0}, [&] (auto curr, const auto& tag) { 
                     return curr + sizeof(AlignedRead::Tag) + calculate_dynamic_bytes(*read.annotation(tag)); });
 }
@@ -662,7 +669,7 @@ boost::optional<AlignedRead::Tag> check_read_tag(const std::string& tag)
 
 bool operator==(const AlignedRead::Segment& lhs, const AlignedRead::Segment& rhs) noexcept
 {
-    return lhs.contig_name() == rhs.contig_name()
+    return lhs.contig_id_ == rhs.contig_id_
            && lhs.begin() == rhs.begin()
            && lhs.flags_ == rhs.flags_
            && lhs.inferred_template_length() == rhs.inferred_template_length();
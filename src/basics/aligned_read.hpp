@@ -75,7 +75,7 @@ public:
     private:
         using FlagBits = std::bitset<2>;
         
-        GenomicRegion::ContigName contig_name_;
+        GenomicRegion::ContigId contig_id_;
         GenomicRegion::Position begin_;
         GenomicRegion::Size inferred_template_length_;
         FlagBits flags_;
@@ -89,6 +89,8 @@ public:
     using Tag        = std::array<char, 2>;
     using Annotation = std::string;
     
+    using FlagMask = std::uint16_t;
+    
     AlignedRead() = default;
     
     template <typename String1_, typename GenomicRegion_, typename Seq_, 
@@ -152,6 +154,10 @@ public:
     bool is_marked_first_template_segment() const noexcept;
     bool is_marked_last_template_segment() const noexcept;
     
+    // The mask has the set members of flags, so a read can be tested for several flags at once
+    static FlagMask make_flag_mask(const Flags& flags) noexcept;
+    bool is_marked_any(FlagMask mask) const noexcept;
+    
     friend bool operator==(const AlignedRead& lhs, const AlignedRead& rhs) noexcept;
     friend bool operator<(const AlignedRead& lhs, const AlignedRead& rhs) noexcept;
     
@@ -173,7 +179,7 @@ private:
     FlagBits flags_;
     MappingQuality mapping_quality_;
     
-    FlagBits compress(const Flags& flags) const noexcept;
+    static FlagBits compress(const Flags& flags) noexcept;
     Flags decompress(const FlagBits& flags) const noexcept;
 };
 
@@ -274,7 +280,7 @@ AlignedRead::AlignedRead(String1_&& name, GenomicRegion_&& reference_region, Seq
 template <typename String_>
 AlignedRead::Segment::Segment(String_&& contig_name, GenomicRegion::Position begin,
                               GenomicRegion::Size inferred_template_length, Flags data)
-: contig_name_ {std::forward<String_>(contig_name)}
+: contig_id_ {ContigDictionary::instance().intern(contig_name)}
 , begin_ {begin}
 , inferred_template_length_ {inferred_template_length}
 , flags_ {compress(data)}
@@ -5,7 +5,9 @@
 #define aligned_template_hpp
 
 #include <vector>
+#include <string>
 #include <unordered_map>
+#include <functional>
 #include <iterator>
 #include <initializer_list>
 
@@ -104,6 +106,23 @@ inline auto insert_size(const AlignedRead& pair1, const AlignedRead& pair2)
     return static_cast<GenomicRegion::Size>(std::abs(inner_distance(pair1, pair2)));
 }
 
+// Mates are found by name. The names are referenced rather than copied into the lookup table, as
+// the reads outlive the pairing and copying every name is the main cost of pairing.
+using ReadNameReference = std::reference_wrapper<const std::string>;
+
+struct ReadNameHash
+{
+    std::size_t operator()(const ReadNameReference& name) const noexcept { return std::hash<std::string> {}(name.get()); }
+};
+
+struct ReadNameEqual
+{
+    bool operator()(const ReadNameReference& lhs, const ReadNameReference& rhs) const noexcept { return lhs.get() == rhs.get(); }
+};
+
+template <typename T>
+using ReadNameMap = std::unordered_map<ReadNameReference, T, ReadNameHash, ReadNameEqual>;
+
 template <typename ForwardIterator, typename OutputIterator>
 OutputIterator
 make_paired_read_templates(ForwardIterator first_read_itr, ForwardIterator last_read_itr,
@@ -111,7 +130,7 @@ make_paired_read_templates(ForwardIterator first_read_itr, ForwardIterator last_
                            const bool pairs_only = false,
                            const boost::optional<GenomicRegion::Size> max_insert_size = boost::none)
 {
-    std::unordered_map<std::string, MappableReferenceWrapper<const AlignedRead>> buffer {};
+    ReadNameMap<MappableReferenceWrapper<const AlignedRead>> buffer {};
     buffer.reserve(std::distance(first_read_itr, last_read_itr) / 2);
     std::for_each(first_read_itr, last_read_itr, [&] (const AlignedRead& read) {
         if (read.has_other_segment()) {
@@ -119,9 +138,9 @@ make_paired_read_templates(ForwardIterator first_read_itr, ForwardIterator last_
             if (template_id.empty()) {
                 throw std::runtime_error {"Read does not have a valid name"};
             }
-            const auto template_itr = buffer.find(template_id);
+            const auto template_itr = buffer.find(std::cref(template_id));
             if (template_itr == std::cend(buffer)) {
-                buffer.emplace(template_id, read);
+                buffer.emplace(std::cref(template_id), read);
             } else {
                 const auto& mate = template_itr->second.get();
                 if (!max_insert_size || insert_size(read, mate) < *max_insert_size) {
@@ -190,14 +209,14 @@ make_paired_and_barcode_linked_read_templates(ForwardIterator first_read_itr, Fo
                                               const bool linked_only = false)
 {
     const auto num_reads = static_cast<std::size_t>(std::distance(first_read_itr, last_read_itr));
-    std::unordered_map<std::string, MappableReferenceWrapper<const AlignedRead>> pairs {};
+    ReadNameMap<MappableReferenceWrapper<const AlignedRead>> pairs {};
     pairs.reserve(num_reads / 2);
     std::unordered_map<AlignedRead::NucleotideSequence, std::vector<MappableReferenceWrapper<const AlignedRead>>> barcodes {};
     barcodes.reserve(num_reads / 2);
     std::for_each(first_read_itr, last_read_itr, [&] (const AlignedRead& read) {
-        const auto pair = pairs.find(read.name());
+        const auto pair = pairs.find(std::cref(read.name()));
         if (pair == std::cend(pairs)) {
-            pairs.emplace(read.name(), read);
+            pairs.emplace(std::cref(read.name()), read);
             barcodes[read.barcode()].emplace_back(read);
         } else {
             const AlignedRead& mate {pair->second.get()};
@@ -16,29 +16,77 @@
 
 namespace octopus {
 
+namespace {
+
+constexpr unsigned bamCodeBits {4};
+constexpr CigarOperation::BamEncoding bamCodeMask {(1u << bamCodeBits) - 1};
+
+// In BAM code order
+constexpr std::array<CigarOperation::Flag, 16> bamCodeFlags {{
+    CigarOperation::Flag::alignmentMatch, CigarOperation::Flag::insertion, CigarOperation::Flag::deletion,
+    CigarOperation::Flag::skipped, CigarOperation::Flag::softClipped, CigarOperation::Flag::hardClipped,
+    CigarOperation::Flag::padding, CigarOperation::Flag::sequenceMatch, CigarOperation::Flag::substitution,
+    // Codes 9-15 are unused by the SAM spec
+    static_cast<CigarOperation::Flag>('?'), static_cast<CigarOperation::Flag>('?'), static_cast<CigarOperation::Flag>('?'),
+    static_cast<CigarOperation::Flag>('?'), static_cast<CigarOperation::Flag>('?'), static_cast<CigarOperation::Flag>('?'),
+    static_cast<CigarOperation::Flag>('?')
+}};
+
+CigarOperation::BamEncoding to_bam_code(const CigarOperation::Flag flag) noexcept
+{
+    using Flag = CigarOperation::Flag;
+    switch (flag) {
+        case Flag::alignmentMatch: return 0;
+        case Flag::insertion:      return 1;
+        case Flag::deletion:       return 2;
+        case Flag::skipped:        return 3;
+        case Flag::softClipped:    return 4;
+        case Flag::hardClipped:    return 5;
+        case Flag::padding:        return 6;
+        case Flag::sequenceMatch:  return 7;
+        case Flag::substitution:   return 8;
+        default:                   return 9; // invalid
+    }
+}
+
+} // namespace
+
+constexpr CigarOperation::Size CigarOperation::maxSize;
+
 CigarOperation::CigarOperation(const Size size, const Flag flag) noexcept
-: size_ {size}
-, flag_ {flag}
+: op_ {static_cast<BamEncoding>(size << bamCodeBits) | to_bam_code(flag)}
 {}
 
+CigarOperation CigarOperation::from_bam(const BamEncoding op) noexcept
+{
+    CigarOperation result {};
+    result.op_ = op;
+    return result;
+}
+
 void CigarOperation::set_flag(Flag type) noexcept
 {
-    flag_ = type;
+    op_ = (op_ & ~bamCodeMask) | to_bam_code(type);
 }
 
 void CigarOperation::set_size(Size size) noexcept
 {
-    size_ = size;
+    op_ = static_cast<BamEncoding>(size << bamCodeBits) | (op_ & bamCodeMask);
 }
 
 CigarOperation::Flag CigarOperation::flag() const noexcept
 {
-    return flag_;
+    return bamCodeFlags[op_ & bamCodeMask];
 }
 
 CigarOperation::Size CigarOperation::size() const noexcept
 {
-    return size_;
+    return op_ >> bamCodeBits;
+}
+
+CigarOperation::BamEncoding CigarOperation::bam_encoding() const noexcept
+{
+    return op_;
 }
 
 // non-member methods
@@ -203,6 +251,11 @@ bool is_valid(const CigarString& cigar) noexcept
                                          [] (const auto& op) { return is_valid(op); });
 }
 
+bool is_inline(const CigarString& cigar) noexcept
+{
+    return cigar.capacity() <= cigarInlineCapacity;
+}
+
 bool is_minimal(const CigarString& cigar) noexcept
 {
     return std::adjacent_find(std::cbegin(cigar), std::cend(cigar),
@@ -441,11 +494,7 @@ std::string to_string(const CigarString& cigar)
 
 std::size_t CigarHash::operator()(const CigarOperation& op) const noexcept
 {
-    std::size_t result {};
-    using boost::hash_combine;
-    hash_combine(result, op.flag());
-    hash_combine(result, op.size());
-    return result;
+    return boost::hash_value(op.bam_encoding());
 }
 
 std::size_t CigarHash::operator()(const CigarString& cigar) const noexcept
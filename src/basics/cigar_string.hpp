@@ -14,11 +14,17 @@
 #include <limits>
 
 #include <boost/functional/hash.hpp>
+#include <boost/container/small_vector.hpp>
 
 #include "concepts/comparable.hpp"
 
 namespace octopus {
 
+/*
+    A CigarOperation is stored in the BAM encoding: the size in the upper 28 bits and the
+    operation code in the lower 4, so it is the same size as a uint32_t and converting to and
+    from htslib records is a copy.
+*/
 class CigarOperation : public Comparable<CigarOperation> // Comparable so can compare reads
 {
 public:
@@ -36,11 +42,16 @@ public:
     };
     
     using Size = std::uint_fast32_t;
+    using BamEncoding = std::uint32_t;
+    
+    static constexpr Size maxSize {(Size {1} << 28) - 1};
     
     CigarOperation() = default;
     
     explicit CigarOperation(Size size, Flag type) noexcept;
     
+    static CigarOperation from_bam(BamEncoding op) noexcept;
+    
     CigarOperation(const CigarOperation&)            = default;
     CigarOperation& operator=(const CigarOperation&) = default;
     CigarOperation(CigarOperation&&)                 = default;
@@ -54,9 +65,10 @@ public:
     Flag flag() const noexcept;
     Size size() const noexcept;
     
+    BamEncoding bam_encoding() const noexcept;
+    
 private:
-    Size size_;
-    Flag flag_;
+    BamEncoding op_;
 };
 
 void increment_size(CigarOperation& op, CigarOperation::Size n = 1) noexcept;
@@ -84,7 +96,12 @@ bool is_clipping(const CigarOperation& op) noexcept;
 
 // CigarString
 
-using CigarString = std::vector<CigarOperation>;
+// Most reads have only a few operations so these are stored inline without a heap allocation
+constexpr std::size_t cigarInlineCapacity {8};
+
+using CigarString = boost::container::small_vector<CigarOperation, cigarInlineCapacity>;
+
+bool is_inline(const CigarString& cigar) noexcept;
 
 CigarString parse_cigar(const std::string& cigar);
 
@@ -174,6 +191,71 @@ CigarString copy_reference(const CigarString& cigar, CigarOperation::Size offset
 CigarString copy_sequence(const CigarString& cigar, CigarOperation::Size offset,
                           CigarOperation::Size size = std::numeric_limits<CigarOperation::Size>::max());
 
+/*
+    CigarFlagIterator visits the flag of each position in the cigar (i.e. as if each operation
+    of size n was repeated n times) without expanding it. All operations must be non-empty.
+*/
+class CigarFlagIterator
+{
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = CigarOperation::Flag;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const value_type*;
+    using reference         = value_type;
+    
+    CigarFlagIterator() = default;
+    
+    CigarFlagIterator(CigarString::const_iterator op, CigarOperation::Size offset = 0) noexcept
+    : op_ {op}, offset_ {offset}
+    {}
+    
+    reference operator*() const noexcept { return op_->flag(); }
+    
+    CigarFlagIterator& operator++() noexcept
+    {
+        if (++offset_ == op_->size()) {
+            ++op_;
+            offset_ = 0;
+        }
+        return *this;
+    }
+    
+    CigarFlagIterator operator++(int) noexcept
+    {
+        auto result = *this;
+        ++(*this);
+        return result;
+    }
+    
+    const CigarOperation& operation() const noexcept { return *op_; }
+    CigarOperation::Size offset() const noexcept { return offset_; }
+    
+    friend bool operator==(const CigarFlagIterator& lhs, const CigarFlagIterator& rhs) noexcept
+    {
+        return lhs.op_ == rhs.op_ && lhs.offset_ == rhs.offset_;
+    }
+    
+    friend bool operator!=(const CigarFlagIterator& lhs, const CigarFlagIterator& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+    
+private:
+    CigarString::const_iterator op_;
+    CigarOperation::Size offset_;
+};
+
+inline CigarFlagIterator flags_begin(const CigarString& cigar) noexcept
+{
+    return CigarFlagIterator {std::cbegin(cigar)};
+}
+
+inline CigarFlagIterator flags_end(const CigarString& cigar) noexcept
+{
+    return CigarFlagIterator {std::cend(cigar)};
+}
+
 std::vector<CigarOperation::Flag> decompose(const CigarString& cigar);
 CigarString collapse_matches(const CigarString& cigar);
 
@@ -0,0 +1,76 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "contig_dictionary.hpp"
+
+#include <stdexcept>
+
+namespace octopus {
+
+constexpr ContigDictionary::ContigId ContigDictionary::emptyId;
+constexpr unsigned ContigDictionary::chunkBits;
+constexpr std::size_t ContigDictionary::chunkSize;
+constexpr std::size_t ContigDictionary::maxChunks;
+
+ContigDictionary& ContigDictionary::instance()
+{
+    // Never destroyed, so names stay valid during static destruction
+    static auto* result = new ContigDictionary {};
+    return *result;
+}
+
+ContigDictionary::ContigDictionary()
+: chunks_ {}
+, ids_ {}
+, size_ {0}
+, mutex_ {}
+{
+    do_intern("");
+}
+
+ContigDictionary::ContigId ContigDictionary::intern(const ContigName& name)
+{
+    thread_local const ContigName* last_name {nullptr};
+    thread_local ContigId last_id {emptyId};
+    if (last_name && (&name == last_name || name == *last_name)) return last_id;
+    std::lock_guard<std::mutex> lock {mutex_};
+    const auto itr = ids_.find(name);
+    last_id = itr != std::cend(ids_) ? itr->second : do_intern(name);
+    last_name = &this->name(last_id);
+    return last_id;
+}
+
+boost::optional<ContigDictionary::ContigId> ContigDictionary::find(const ContigName& name) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    const auto itr = ids_.find(name);
+    if (itr != std::cend(ids_)) return itr->second;
+    return boost::none;
+}
+
+std::size_t ContigDictionary::size() const noexcept
+{
+    return size_.load(std::memory_order_acquire);
+}
+
+// private methods
+
+ContigDictionary::ContigId ContigDictionary::do_intern(const ContigName& name)
+{
+    const auto id = size_.load(std::memory_order_relaxed);
+    const auto chunk_idx = id >> chunkBits;
+    if (chunk_idx >= maxChunks) {
+        throw std::length_error {"ContigDictionary: too many contigs"};
+    }
+    auto* chunk = const_cast<ContigName*>(chunks_[chunk_idx].load(std::memory_order_relaxed));
+    if (!chunk) {
+        chunk = new ContigName[chunkSize];
+        chunks_[chunk_idx].store(chunk, std::memory_order_release);
+    }
+    chunk[id & (chunkSize - 1)] = name;
+    ids_.emplace(name, id);
+    size_.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+} // namespace octopus
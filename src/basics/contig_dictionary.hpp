@@ -0,0 +1,75 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef contig_dictionary_hpp
+#define contig_dictionary_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#include <boost/optional.hpp>
+
+namespace octopus {
+
+/*
+    ContigDictionary interns contig names so that GenomicRegion and AlignedRead can store a
+    32-bit id rather than a string. Ids are never reused and names are never moved or freed, so
+    a name reference obtained from an id stays valid for the life of the program.
+
+    The reference genome interns its contigs in reference order when it is opened, so those
+    contigs have the smallest ids. Names not in the reference (e.g. from a region string that
+    names an unknown contig) are interned on demand. Id 0 is the empty name.
+
+    Looking up a name is lock-free; interning takes a lock unless the name is the same as the
+    last one interned by the calling thread, which is the common case.
+*/
+class ContigDictionary
+{
+public:
+    using ContigName = std::string;
+    using ContigId   = std::uint32_t;
+
+    static constexpr ContigId emptyId {0};
+
+    static ContigDictionary& instance();
+
+    ContigDictionary(const ContigDictionary&)            = delete;
+    ContigDictionary& operator=(const ContigDictionary&) = delete;
+    ContigDictionary(ContigDictionary&&)                 = delete;
+    ContigDictionary& operator=(ContigDictionary&&)      = delete;
+
+    ContigId intern(const ContigName& name);
+    boost::optional<ContigId> find(const ContigName& name) const;
+    const ContigName& name(ContigId id) const noexcept;
+    std::size_t size() const noexcept;
+
+private:
+    static constexpr unsigned chunkBits {10};
+    static constexpr std::size_t chunkSize {std::size_t {1} << chunkBits};
+    static constexpr std::size_t maxChunks {std::size_t {1} << 16};
+
+    // Names are stored in fixed size chunks that are never reallocated so lookups need no lock
+    std::array<std::atomic<const ContigName*>, maxChunks> chunks_;
+    std::unordered_map<ContigName, ContigId> ids_;
+    std::atomic<ContigId> size_;
+    mutable std::mutex mutex_;
+
+    ContigDictionary();
+    ~ContigDictionary() = default;
+
+    ContigId do_intern(const ContigName& name);
+};
+
+inline const ContigDictionary::ContigName& ContigDictionary::name(const ContigId id) const noexcept
+{
+    return chunks_[id >> chunkBits].load(std::memory_order_acquire)[id & (chunkSize - 1)];
+}
+
+} // namespace octopus
+
+#endif
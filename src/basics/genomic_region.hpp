@@ -6,6 +6,7 @@
 
 #include <string>
 #include <functional>
+#include <type_traits>
 #include <stdexcept>
 #include <ostream>
 #include <cassert>
@@ -15,6 +16,7 @@
 
 #include "concepts/comparable.hpp"
 #include "contig_region.hpp"
+#include "contig_dictionary.hpp"
 
 namespace octopus {
 
@@ -23,6 +25,9 @@ namespace octopus {
     name is the reference contig name (usually a chromosome), and the
     begin and end positions are zero-indexed half open - [begin,end) - indices.
  
+    The contig name is interned in the ContigDictionary and only its id is stored, so
+    regions are cheap to copy and contig comparisons are integer comparisons.
+ 
     All comparison operations (<, ==, is_before, etc) throw exceptions if the arguements
     are not from the same contig.
 */
@@ -30,18 +35,22 @@ class GenomicRegion : public Comparable<GenomicRegion>
 {
 public:
     using ContigName = std::string;
+    using ContigId   = ContigDictionary::ContigId;
     using Position   = ContigRegion::Position;
     using Size       = ContigRegion::Size;
     using Distance   = ContigRegion::Distance;
     
     GenomicRegion() = default;  // for use with containers
     
-    template <typename T>
+    template <typename T, typename = std::enable_if_t<!std::is_integral<std::decay_t<T>>::value>>
     explicit GenomicRegion(T&& contig_name, Position begin, Position end);
     
-    template <typename T, typename R>
+    template <typename T, typename R, typename = std::enable_if_t<!std::is_integral<std::decay_t<T>>::value>>
     explicit GenomicRegion(T&& contig_name, R&& contig_region);
     
+    explicit GenomicRegion(ContigId contig, Position begin, Position end);
+    explicit GenomicRegion(ContigId contig, ContigRegion contig_region) noexcept;
+    
     GenomicRegion(const GenomicRegion&)            = default;
     GenomicRegion& operator=(const GenomicRegion&) = default;
     GenomicRegion(GenomicRegion&&)                 = default;
@@ -50,13 +59,14 @@ public:
     ~GenomicRegion() = default;
     
     const ContigName& contig_name() const noexcept;
+    ContigId contig_id() const noexcept;
     const ContigRegion& contig_region() const noexcept;
     
     Position begin() const noexcept;
     Position end() const noexcept;
 
 private:
-    ContigName contig_name_;
+    ContigId contig_id_ = ContigDictionary::emptyId;
     ContigRegion contig_region_;
 };
 
@@ -87,21 +97,36 @@ private:
 
 // public member methods
 
-template <typename T>
+template <typename T, typename>
 GenomicRegion::GenomicRegion(T&& contig_name, const Position begin, const Position end)
-: contig_name_ {std::forward<T>(contig_name)}
+: contig_id_ {ContigDictionary::instance().intern(contig_name)}
 , contig_region_ {begin, end}
 {}
 
-template <typename T, typename R>
+template <typename T, typename R, typename>
 GenomicRegion::GenomicRegion(T&& contig_name, R&& contig_region)
-: contig_name_ {std::forward<T>(contig_name)}
+: contig_id_ {ContigDictionary::instance().intern(contig_name)}
 , contig_region_ {std::forward<R>(contig_region)}
 {}
 
+inline GenomicRegion::GenomicRegion(const ContigId contig, const Position begin, const Position end)
+: contig_id_ {contig}
+, contig_region_ {begin, end}
+{}
+
+inline GenomicRegion::GenomicRegion(const ContigId contig, ContigRegion contig_region) noexcept
+: contig_id_ {contig}
+, contig_region_ {std::move(contig_region)}
+{}
+
 inline const GenomicRegion::ContigName& GenomicRegion::contig_name() const noexcept
 {
-    return contig_name_;
+    return ContigDictionary::instance().name(contig_id_);
+}
+
+inline GenomicRegion::ContigId GenomicRegion::contig_id() const noexcept
+{
+    return contig_id_;
 }
 
 inline const ContigRegion& GenomicRegion::contig_region() const noexcept
@@ -159,7 +184,7 @@ inline bool is_position(const GenomicRegion& region) noexcept
 
 inline bool is_same_contig(const GenomicRegion& lhs, const GenomicRegion& rhs) noexcept
 {
-    return lhs.contig_name() == rhs.contig_name();
+    return lhs.contig_id() == rhs.contig_id();
 }
 
 inline bool begins_equal(const GenomicRegion& lhs, const GenomicRegion& rhs)
@@ -243,39 +268,39 @@ inline GenomicRegion::Distance outer_distance(const GenomicRegion& lhs, const Ge
 
 inline GenomicRegion shift(const GenomicRegion& region, GenomicRegion::Distance n)
 {
-    return GenomicRegion {region.contig_name(), shift(region.contig_region(), n)};
+    return GenomicRegion {region.contig_id(), shift(region.contig_region(), n)};
 }
 
 inline GenomicRegion next_position(const GenomicRegion& region)
 {
-    return GenomicRegion {region.contig_name(), next_position(region.contig_region())};
+    return GenomicRegion {region.contig_id(), next_position(region.contig_region())};
 }
 
 inline GenomicRegion expand_lhs(const GenomicRegion& region, const GenomicRegion::Distance n)
 {
-    return GenomicRegion {region.contig_name(), expand_lhs(region.contig_region(), n)};
+    return GenomicRegion {region.contig_id(), expand_lhs(region.contig_region(), n)};
 }
 
 inline GenomicRegion expand_rhs(const GenomicRegion& region, const GenomicRegion::Distance n)
 {
-    return GenomicRegion {region.contig_name(), expand_rhs(region.contig_region(), n)};
+    return GenomicRegion {region.contig_id(), expand_rhs(region.contig_region(), n)};
 }
 
 inline GenomicRegion expand(const GenomicRegion& region, const GenomicRegion::Distance n)
 {
-    return GenomicRegion {region.contig_name(), expand(region.contig_region(), n)};
+    return GenomicRegion {region.contig_id(), expand(region.contig_region(), n)};
 }
 
 inline GenomicRegion expand(const GenomicRegion& region, const GenomicRegion::Distance lhs,
                             const GenomicRegion::Distance rhs)
 {
-    return GenomicRegion {region.contig_name(), expand(region.contig_region(), lhs, rhs)};
+    return GenomicRegion {region.contig_id(), expand(region.contig_region(), lhs, rhs)};
 }
 
 inline GenomicRegion encompassing_region(const GenomicRegion& lhs, const GenomicRegion& rhs)
 {
     if (!is_same_contig(lhs, rhs)) throw BadRegionCompare {to_string(lhs), to_string(rhs)};
-    return GenomicRegion {lhs.contig_name(), encompassing_region(lhs.contig_region(), rhs.contig_region())};
+    return GenomicRegion {lhs.contig_id(), encompassing_region(lhs.contig_region(), rhs.contig_region())};
 }
 
 inline boost::optional<GenomicRegion> intervening_region(const GenomicRegion& lhs, const GenomicRegion& rhs)
@@ -283,7 +308,7 @@ inline boost::optional<GenomicRegion> intervening_region(const GenomicRegion& lh
     if (!is_same_contig(lhs, rhs)) return boost::none;
     const auto contig_region = intervening_region(lhs.contig_region(),  rhs.contig_region());
     if (contig_region) {
-        return GenomicRegion {lhs.contig_name(), *contig_region};
+        return GenomicRegion {lhs.contig_id(), *contig_region};
     }
     return boost::none;
 }
@@ -299,7 +324,7 @@ inline boost::optional<GenomicRegion> overlapped_region(const GenomicRegion& lhs
     if (!overlaps(lhs, rhs)) {
         return boost::none;
     }
-    return GenomicRegion {lhs.contig_name(), *overlapped_region(lhs.contig_region(), rhs.contig_region())};
+    return GenomicRegion {lhs.contig_id(), *overlapped_region(lhs.contig_region(), rhs.contig_region())};
 }
 
 inline GenomicRegion::Size left_overhang_size(const GenomicRegion& lhs, const GenomicRegion& rhs) noexcept
@@ -325,39 +350,39 @@ inline bool right_overhangs(const GenomicRegion& lhs, const GenomicRegion& rhs)
 inline GenomicRegion left_overhang_region(const GenomicRegion& lhs, const GenomicRegion& rhs)
 {
     if (!is_same_contig(lhs, rhs)) throw BadRegionCompare {to_string(lhs), to_string(rhs)};
-    return GenomicRegion {lhs.contig_name(), left_overhang_region(lhs.contig_region(), rhs.contig_region())};
+    return GenomicRegion {lhs.contig_id(), left_overhang_region(lhs.contig_region(), rhs.contig_region())};
 }
 
 inline GenomicRegion right_overhang_region(const GenomicRegion& lhs, const GenomicRegion& rhs)
 {
     if (!is_same_contig(lhs, rhs)) throw BadRegionCompare {to_string(lhs), to_string(rhs)};
-    return GenomicRegion {lhs.contig_name(), right_overhang_region(lhs.contig_region(), rhs.contig_region())};
+    return GenomicRegion {lhs.contig_id(), right_overhang_region(lhs.contig_region(), rhs.contig_region())};
 }
 
 inline GenomicRegion closed_region(const GenomicRegion& lhs, const GenomicRegion& rhs)
 {
     if (!is_same_contig(lhs, rhs)) throw BadRegionCompare {to_string(lhs), to_string(rhs)};
-    return GenomicRegion {lhs.contig_name(), closed_region(lhs.contig_region(), rhs.contig_region())};
+    return GenomicRegion {lhs.contig_id(), closed_region(lhs.contig_region(), rhs.contig_region())};
 }
 
 inline GenomicRegion head_region(const GenomicRegion& region, const GenomicRegion::Size n = 0)
 {
-    return GenomicRegion {region.contig_name(), head_region(region.contig_region(), n)};
+    return GenomicRegion {region.contig_id(), head_region(region.contig_region(), n)};
 }
 
 inline GenomicRegion head_position(const GenomicRegion& region)
 {
-    return GenomicRegion {region.contig_name(), head_position(region.contig_region())};
+    return GenomicRegion {region.contig_id(), head_position(region.contig_region())};
 }
 
 inline GenomicRegion tail_region(const GenomicRegion& region, const GenomicRegion::Size n = 0)
 {
-    return GenomicRegion {region.contig_name(), tail_region(region.contig_region(), n)};
+    return GenomicRegion {region.contig_id(), tail_region(region.contig_region(), n)};
 }
 
 inline GenomicRegion tail_position(const GenomicRegion& region)
 {
-    return GenomicRegion {region.contig_name(), tail_position(region.contig_region())};
+    return GenomicRegion {region.contig_id(), tail_position(region.contig_region())};
 }
 
 inline GenomicRegion::Distance begin_distance(const GenomicRegion& first, const GenomicRegion& second)
@@ -384,7 +409,7 @@ struct GenomicRegionHash
     {
         using boost::hash_combine;
         std::size_t result {};
-        hash_combine(result, std::hash<GenomicRegion::ContigName>()(region.contig_name()));
+        hash_combine(result, region.contig_id());
         hash_combine(result, std::hash<ContigRegion>()(region.contig_region()));
         return result;
     }
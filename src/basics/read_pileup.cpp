@@ -27,14 +27,7 @@ const ContigRegion& ReadPileup::mapped_region() const noexcept
 
 void ReadPileup::add(const AlignedRead& read)
 {
-    const GenomicRegion region {contig_name(read), region_};
-    auto sequence = copy_sequence(read, region);
-    auto itr = std::find_if(std::next(std::begin(summaries_)), std::end(summaries_), [&] (const auto& p) { return p.first == sequence; });
-    if (itr == std::cend(summaries_)) {
-        summaries_.emplace_back(std::move(sequence), ReadSummaries {});
-        itr = std::prev(std::end(summaries_));
-    }
-    itr->second.push_back({copy_base_qualities(read, region), read.mapping_quality()});
+    add_to_pileups(read, this, std::next(this));
 }
 
 void ReadPileup::summaries(std::function<void(const NucleotideSequence&, const ReadSummaries&)> func) const
@@ -44,26 +37,91 @@ void ReadPileup::summaries(std::function<void(const NucleotideSequence&, const R
     }
 }
 
-namespace {
-
-auto pileup_overlap_range(std::vector<ReadPileup>& pileups, const AlignedRead& read)
+void ReadPileup::add(const SequenceIterator first_base, const SequenceIterator last_base, const QualityIterator first_quality,
+                     const MappingQuality mapping_quality)
 {
-    return overlap_range(std::begin(pileups), std::end(pileups), contig_region(read), BidirectionallySortedTag {});
+    const auto num_bases = static_cast<std::size_t>(std::distance(first_base, last_base));
+    auto itr = std::find_if(std::next(std::begin(summaries_)), std::end(summaries_), [&] (const auto& p) {
+        return p.first.size() == num_bases && std::equal(first_base, last_base, std::cbegin(p.first));
+    });
+    if (itr == std::cend(summaries_)) {
+        summaries_.emplace_back(NucleotideSequence {first_base, last_base}, ReadSummaries {});
+        itr = std::prev(std::end(summaries_));
+    }
+    itr->second.push_back({BaseQualities {first_quality, std::next(first_quality, num_bases)}, mapping_quality});
 }
 
-} // namespace
+// Walks the read's CIGAR operations once, adding each overlapped position's bases to its pileup. A position
+// has the bases aligned to it, and the first position after an insertion also has the inserted bases, as
+// copy_sequence gives for a single position.
+template <typename PileupIterator>
+void add_to_pileups(const AlignedRead& read, PileupIterator first_pileup, PileupIterator last_pileup)
+{
+    if (first_pileup == last_pileup) return;
+    const auto pileups_begin = mapped_begin(*first_pileup);
+    const auto pileups_end = pileups_begin + static_cast<ContigRegion::Size>(std::distance(first_pileup, last_pileup));
+    const auto first_base = std::cbegin(read.sequence());
+    const auto first_quality = std::cbegin(read.base_qualities());
+    auto reference_pos = mapped_begin(read);
+    std::size_t sequence_pos {0}, insertion_begin {0};
+    bool has_insertion {false};
+    for (const auto& op : read.cigar()) {
+        if (reference_pos >= pileups_end) break;
+        const auto op_size = static_cast<std::size_t>(op.size());
+        if (advances_reference(op)) {
+            const auto op_end = reference_pos + static_cast<ContigRegion::Size>(op_size);
+            const auto overlap_begin = std::max(reference_pos, pileups_begin);
+            const auto overlap_end = std::min(op_end, pileups_end);
+            const bool has_bases {advances_sequence(op)};
+            for (auto pos = overlap_begin; pos < overlap_end; ++pos) {
+                const auto op_offset = static_cast<std::size_t>(pos - reference_pos);
+                auto copy_begin = sequence_pos + (has_bases ? op_offset : 0);
+                const auto copy_end = copy_begin + (has_bases ? 1 : 0);
+                if (op_offset == 0 && has_insertion) copy_begin = insertion_begin;
+                std::next(first_pileup, pos - pileups_begin)->add(std::next(first_base, copy_begin), std::next(first_base, copy_end),
+                                                                  std::next(first_quality, copy_begin), read.mapping_quality());
+            }
+            reference_pos = op_end;
+            if (has_bases) sequence_pos += op_size;
+            has_insertion = false;
+        } else if (advances_sequence(op)) {
+            if (!has_insertion) {
+                insertion_begin = sequence_pos;
+                has_insertion = true;
+            }
+            sequence_pos += op_size;
+        }
+    }
+}
 
-ReadPileups make_pileups(const ReadContainer& reads, const GenomicRegion& region)
+ReadPileups make_pileups(const GenomicRegion& region)
 {
     ReadPileups result {};
     result.reserve(size(region));
     for (auto position = region.begin(); position < region.end(); ++position) {
         result.emplace_back(position);
     }
+    return result;
+}
+
+void add_to_pileups(const AlignedRead& read, ReadPileups& pileups)
+{
+    if (pileups.empty()) return;
+    const auto pileups_begin = mapped_begin(pileups.front());
+    const auto pileups_end = pileups_begin + static_cast<ContigRegion::Size>(pileups.size());
+    const auto overlap_begin = std::max(mapped_begin(read), pileups_begin);
+    const auto overlap_end = std::min(mapped_end(read), pileups_end);
+    if (overlap_begin < overlap_end) {
+        add_to_pileups(read, std::next(std::begin(pileups), overlap_begin - pileups_begin),
+                       std::next(std::begin(pileups), overlap_end - pileups_begin));
+    }
+}
+
+ReadPileups make_pileups(const ReadContainer& reads, const GenomicRegion& region)
+{
+    auto result = make_pileups(region);
     for (const AlignedRead& read : overlap_range(reads, region)) {
-        for (ReadPileup& pileup : pileup_overlap_range(result, read)) {
-            pileup.add(read);
-        }
+        add_to_pileups(read, result);
     }
     return result;
 }
@@ -8,6 +8,8 @@
 #include <utility>
 #include <functional>
 
+#include <boost/container/small_vector.hpp>
+
 #include "config/common.hpp"
 #include "concepts/mappable.hpp"
 #include "contig_region.hpp"
@@ -23,9 +25,12 @@ public:
     using BaseQuality        = AlignedRead::BaseQuality;
     using MappingQuality     = AlignedRead::MappingQuality;
     
+    // Most observations are a single base so their qualities are stored inline
+    using BaseQualities = boost::container::small_vector<BaseQuality, 1>;
+    
     struct ReadSummary
     {
-        std::vector<BaseQuality> base_qualities;
+        BaseQualities base_qualities;
         MappingQuality mapping_quality;
     };
     using ReadSummaries = std::vector<ReadSummary>;
@@ -48,12 +53,27 @@ public:
     void summaries(std::function<void(const NucleotideSequence&, const ReadSummaries&)> func) const;
 
 private:
+    using SequenceIterator = NucleotideSequence::const_iterator;
+    using QualityIterator  = AlignedRead::BaseQualityVector::const_iterator;
+    
     std::vector<std::pair<NucleotideSequence, ReadSummaries>> summaries_;
     ContigRegion region_;
+    
+    void add(SequenceIterator first_base, SequenceIterator last_base, QualityIterator first_quality,
+             MappingQuality mapping_quality);
+    
+    template <typename PileupIterator>
+    friend void add_to_pileups(const AlignedRead& read, PileupIterator first_pileup, PileupIterator last_pileup);
 };
 
 using ReadPileups = std::vector<ReadPileup>;
 
+// Empty pileups for each position in the region
+ReadPileups make_pileups(const GenomicRegion& region);
+
+// Adds the read to each of the pileups it overlaps, which must be for consecutive positions
+void add_to_pileups(const AlignedRead& read, ReadPileups& pileups);
+
 ReadPileups make_pileups(const ReadContainer& reads, const GenomicRegion& region);
 
 } // namespace octopus
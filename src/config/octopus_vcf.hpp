@@ -18,6 +18,7 @@ namespace info {
 VCF_SPEC_CONSTANT modelPosterior {"MP"};
 VCF_SPEC_CONSTANT denovo {"DENOVO"};
 VCF_SPEC_CONSTANT reversion {"REVERSION"};
+VCF_SPEC_CONSTANT degraded {"DEGRADED"};
 
 } // namespace info
 
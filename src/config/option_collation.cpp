@@ -33,12 +33,17 @@
 #include "basics/trio.hpp"
 #include "basics/pedigree.hpp"
 #include "readpipe/read_pipe_fwd.hpp"
+#include "readpipe/filtering/read_filter_chain.hpp"
 #include "core/tools/coretools.hpp"
+#include "core/tools/vargen/candidate_cache.hpp"
 #include "core/models/haplotype_likelihood_model.hpp"
 #include "core/models/error/error_model_factory.hpp"
+#include "core/models/pairhmm/gpu_pair_hmm.hpp"
 #include "core/callers/caller_builder.hpp"
 #include "logging/logging.hpp"
 #include "io/region/region_parser.hpp"
+#include "io/region/shard_manifest.hpp"
+#include "io/read/htslib_sam_facade.hpp"
 #include "io/pedigree/pedigree_reader.hpp"
 #include "io/variant/vcf_reader.hpp"
 #include "io/variant/vcf_writer.hpp"
@@ -246,6 +251,94 @@ boost::optional<unsigned> get_num_threads(const OptionMap& options)
     return boost::none;
 }
 
+bool is_numa_aware(const OptionMap& options)
+{
+    return options.at("numa").as<bool>();
+}
+
+unsigned get_task_prefetch_depth(const OptionMap& options)
+{
+    return as_unsigned("task-prefetch-depth", options);
+}
+
+boost::optional<fs::path> get_service_socket_path(const OptionMap& options)
+{
+    if (is_set("service-socket", options)) {
+        return resolve_path(options.at("service-socket").as<fs::path>(), options);
+    }
+    return boost::none;
+}
+
+unsigned get_max_service_jobs(const OptionMap& options)
+{
+    return std::max(as_unsigned("max-service-jobs", options), 1u);
+}
+
+class UnsupportedPairHMMInstructionSet : public UserError
+{
+    hmm::simd::InstructionSet instruction_set_;
+    
+    std::string do_where() const override
+    {
+        return "get_pair_hmm_instruction_set";
+    }
+    std::string do_why() const override
+    {
+        return std::string {"The pair-hmm-isa "} + hmm::simd::to_string(instruction_set_)
+               + " is not supported by this CPU or was not compiled into this build";
+    }
+    std::string do_help() const override
+    {
+        return "Use pair-hmm-isa AUTO to select the fastest supported instruction set";
+    }
+public:
+    UnsupportedPairHMMInstructionSet(hmm::simd::InstructionSet instruction_set) : instruction_set_ {instruction_set} {}
+};
+
+boost::optional<hmm::simd::InstructionSet> get_pair_hmm_instruction_set(const OptionMap& options)
+{
+    using hmm::simd::InstructionSet;
+    boost::optional<InstructionSet> result {};
+    switch (options.at("pair-hmm-isa").as<PairHMMInstructionSet>()) {
+        case PairHMMInstructionSet::automatic: break;
+        case PairHMMInstructionSet::sse2: result = InstructionSet::sse2; break;
+        case PairHMMInstructionSet::avx2: result = InstructionSet::avx2; break;
+        case PairHMMInstructionSet::avx512: result = InstructionSet::avx512; break;
+        case PairHMMInstructionSet::neon: result = InstructionSet::neon; break;
+        case PairHMMInstructionSet::sve: result = InstructionSet::sve; break;
+    }
+    if (result && !hmm::simd::is_supported(*result)) {
+        throw UnsupportedPairHMMInstructionSet {*result};
+    }
+    return result;
+}
+
+class UnavailablePairHMMGPU : public UserError
+{
+    std::string do_where() const override
+    {
+        return "get_pair_hmm_gpu_min_batch_size";
+    }
+    std::string do_why() const override
+    {
+        return "The pair-hmm-gpu option was given, but this build does not include the GPU pair HMM backend"
+               " or no usable GPU was found";
+    }
+    std::string do_help() const override
+    {
+        return "Rebuild with the CUDA_PAIR_HMM CMake option on a machine with a CUDA device, or remove pair-hmm-gpu";
+    }
+};
+
+boost::optional<std::size_t> get_pair_hmm_gpu_min_batch_size(const OptionMap& options)
+{
+    if (!options.at("pair-hmm-gpu").as<bool>()) return boost::none;
+    if (!hmm::gpu::is_available()) {
+        throw UnavailablePairHMMGPU {};
+    }
+    return as_unsigned("pair-hmm-gpu-min-batch-size", options);
+}
+
 ExecutionPolicy get_thread_execution_policy(const OptionMap& options)
 {
     if (is_set("threads", options)) {
@@ -259,9 +352,40 @@ ExecutionPolicy get_thread_execution_policy(const OptionMap& options)
     }
 }
 
+boost::optional<MemoryFootprint> get_max_memory(const OptionMap& options)
+{
+    if (is_set("max-memory", options)) {
+        return options.at("max-memory").as<MemoryFootprint>();
+    } else {
+        return boost::none;
+    }
+}
+
+// With --max-memory, the read buffer and reference cache may take at most these fractions of the budget
+static constexpr double maxReadBufferMemoryFraction {0.5}, maxReferenceCacheMemoryFraction {0.1};
+
+MemoryFootprint limit_to_memory_budget(MemoryFootprint footprint, const double budget_fraction, const OptionMap& options)
+{
+    const auto max_memory = get_max_memory(options);
+    if (max_memory) {
+        footprint = std::min(footprint, MemoryFootprint {static_cast<std::size_t>(budget_fraction * max_memory->bytes())});
+    }
+    return footprint;
+}
+
 MemoryFootprint get_target_read_buffer_size(const OptionMap& options)
 {
-    return options.at("target-read-buffer-memory").as<MemoryFootprint>();
+    return limit_to_memory_budget(options.at("target-read-buffer-memory").as<MemoryFootprint>(), maxReadBufferMemoryFraction, options);
+}
+
+bool compress_read_buffer(const OptionMap& options)
+{
+    return options.at("compress-read-buffer").as<bool>();
+}
+
+MemoryFootprint get_max_reference_cache_size(const OptionMap& options)
+{
+    return limit_to_memory_budget(options.at("max-reference-cache-memory").as<MemoryFootprint>(), maxReferenceCacheMemoryFraction, options);
 }
 
 boost::optional<fs::path> get_debug_log_file_name(const OptionMap& options)
@@ -292,11 +416,16 @@ bool is_very_fast_mode(const OptionMap& options)
     return options.at("very-fast").as<bool>();
 }
 
-ReferenceGenome make_reference(const OptionMap& options)
+fs::path get_reference_path(const OptionMap& options)
 {
     const fs::path input_path {options.at("reference").as<fs::path>()};
-    auto resolved_path = resolve_path(input_path, options);
-    auto ref_cache_size = options.at("max-reference-cache-memory").as<MemoryFootprint>();
+    return resolve_path(input_path, options);
+}
+
+ReferenceGenome make_reference(const OptionMap& options)
+{
+    auto resolved_path = get_reference_path(options);
+    auto ref_cache_size = get_max_reference_cache_size(options);
     static constexpr MemoryFootprint min_non_zero_reference_cache_size {1'000}; // 1Kb
     if (ref_cache_size.bytes() > 0 && ref_cache_size < min_non_zero_reference_cache_size) {
         static bool warned {false};
@@ -528,9 +657,55 @@ public:
     MissingRegionPathFile(fs::path p) : MissingFileError {std::move(p), "region path"} {};
 };
 
+io::ShardManifest read_shard_manifest(const OptionMap& options, const ReferenceGenome& reference)
+{
+    return io::read_shard_manifest(resolve_path(options.at("shard-manifest").as<fs::path>(), options), reference);
+}
+
+class InvalidShard : public UserError
+{
+    std::string do_where() const override
+    {
+        return "get_search_regions";
+    }
+    std::string do_why() const override
+    {
+        std::ostringstream ss {};
+        ss << "The shard " << shard_ << " is not in the shard manifest";
+        return ss.str();
+    }
+    std::string do_help() const override
+    {
+        if (num_shards_ == 0) return "Remake the shard manifest with --make-shards; the given manifest has no shards";
+        std::ostringstream ss {};
+        ss << "Use a shard between 0 and " << num_shards_ - 1 << " (the shard numbers in the manifest)";
+        return ss.str();
+    }
+    int shard_;
+    unsigned num_shards_;
+public:
+    InvalidShard(int shard, unsigned num_shards) : shard_ {shard}, num_shards_ {num_shards} {}
+};
+
+auto get_shard_regions(const OptionMap& options, const ReferenceGenome& reference)
+{
+    const auto manifest = read_shard_manifest(options, reference);
+    const auto shard = options.at("shard").as<int>();
+    std::vector<GenomicRegion> result {};
+    if (shard >= 0) result = io::get_padded_regions(manifest, static_cast<io::ShardRegion::ShardId>(shard));
+    if (result.empty()) throw InvalidShard {shard, io::count_shards(manifest)};
+    return result;
+}
+
 InputRegionMap get_search_regions(const OptionMap& options, const ReferenceGenome& reference)
 {
     using namespace utils;
+    if (is_set("shard", options)) {
+        return make_search_regions(get_shard_regions(options, reference));
+    }
+    if (is_set("merge-shards", options)) {
+        return make_search_regions(io::get_core_regions(read_shard_manifest(options, reference)));
+    }
     std::vector<GenomicRegion> skip_regions {};
     if (is_set("skip-regions", options)) {
         const auto& region_strings = options.at("skip-regions").as<std::vector<std::string>>();
@@ -589,6 +764,16 @@ InputRegionMap get_search_regions(const OptionMap& options, const ReferenceGenom
     return result;
 }
 
+InputRegionMap get_debug_regions(const OptionMap& options, const ReferenceGenome& reference)
+{
+    if (!is_set("debug-regions", options)) return {};
+    auto regions = parse_regions(options.at("debug-regions").as<std::vector<std::string>>(), reference);
+    if (options.at("one-based-indexing").as<bool>()) {
+        regions = transform_to_zero_based(std::move(regions));
+    }
+    return make_search_regions(regions);
+}
+
 ContigOutputOrder get_contig_output_order(const OptionMap& options)
 {
     return options.at("contig-output-order").as<ContigOutputOrder>();
@@ -743,7 +928,22 @@ ReadManager make_read_manager(const OptionMap& options)
 {
     auto read_paths = get_read_paths(options);
     const auto max_open_files = as_unsigned("max-open-read-files", options);
-    return ReadManager {std::move(read_paths), max_open_files};
+    const auto num_decompression_threads = as_unsigned("read-decompression-threads", options);
+    auto reference_path = resolve_path(options.at("reference").as<fs::path>(), options);
+    const auto read_ahead = options.at("read-ahead").as<bool>();
+    const auto remote_block_size = options.at("remote-read-block-size").as<MemoryFootprint>().bytes();
+    auto decoding_context = std::make_shared<io::HtslibDecodingContext>(num_decompression_threads, std::move(reference_path),
+                                                                        read_ahead, remote_block_size);
+    // Multi-sample fetches read each file on its own thread, which mostly waits on I/O, so this doesn't
+    // take from the calling threads. Likewise for opening the files at startup.
+    unsigned num_fetch_threads {0}, num_setup_threads {0};
+    const auto num_threads = get_num_threads(options);
+    if (read_paths.size() > 1 && (!num_threads || *num_threads > 1)) {
+        const auto max_io_threads = num_threads ? *num_threads : std::thread::hardware_concurrency();
+        num_setup_threads = std::min(static_cast<unsigned>(read_paths.size()), max_io_threads);
+        if (read_paths.size() <= max_open_files) num_fetch_threads = num_setup_threads;
+    }
+    return ReadManager {std::move(read_paths), max_open_files, std::move(decoding_context), num_fetch_threads, num_setup_threads};
 }
 
 bool denovo_candidate_variant_discovery_enabled(const OptionMap& options)
@@ -846,7 +1046,11 @@ auto make_read_transformers(const ReferenceGenome& reference, const OptionMap& o
             postfilter_transformer.add(MaskTemplateAdapters {});
         }
         if (overlap_masking_enabled(options)) {
-            postfilter_transformer.add(MaskStrandOfDuplicatedBases {});
+            if (get_read_linkage_type(options) != ReadLinkageType::none) {
+                postfilter_transformer.add(MergeOverlappedSegments {});
+            } else {
+                postfilter_transformer.add(MaskStrandOfDuplicatedBases {});
+            }
         }
         if (options.at("mask-inverted-soft-clipping").as<bool>()) {
             prefilter_transformer.add(MaskInvertedSoftClippedReadEnds {reference, 10, 500});
@@ -900,7 +1104,7 @@ public:
     BadSamTag(std::string name) : name_ {std::move(name)} {}
 };
 
-auto make_read_filterer(const OptionMap& options)
+ReadPipe::ReadFilterer make_read_filterer(const OptionMap& options)
 {
     using std::make_unique;
     using namespace octopus::readpipe;
@@ -908,24 +1112,35 @@ auto make_read_filterer(const OptionMap& options)
     
     ReadFilterer result {};
     
-    // these filters are mandatory
-    result.add(make_unique<HasValidBaseQualities>());
-    result.add(make_unique<HasWellFormedCigar>());
-    
     if (read_preprocessing_disabled(options)) {
+        // these filters are mandatory
+        result.add(make_unique<HasValidBaseQualities>());
+        result.add(make_unique<HasWellFormedCigar>());
         return result;
     }
-    if (!options.at("consider-unmapped-reads").as<bool>()) {
-        result.add(make_unique<IsMapped>());
-    }
     
     const auto min_mapping_quality = as_unsigned("min-mapping-quality", options);
     const auto min_base_quality    = as_unsigned("good-base-quality", options);
     const auto min_good_bases      = as_unsigned("min-good-bases", options);
     
-    if (min_mapping_quality > 0) {
-        result.add(make_unique<IsGoodMappingQuality>(min_mapping_quality));
+    // The flag and simple checks that nearly every run makes are done by one inlined chain
+    AlignedRead::Flags rejected_flags {};
+    rejected_flags.unmapped = !options.at("consider-unmapped-reads").as<bool>();
+    rejected_flags.duplicate = !options.at("allow-marked-duplicates").as<bool>();
+    rejected_flags.qc_fail = !options.at("allow-qc-fails").as<bool>();
+    rejected_flags.secondary_alignment = !options.at("allow-secondary-alignments").as<bool>();
+    rejected_flags.supplementary_alignment = !options.at("allow-supplementary-alignments").as<bool>();
+    predicates::HasGoodLength good_length {};
+    if (is_set("min-read-length", options)) {
+        good_length.min_length = as_unsigned("min-read-length", options);
+    }
+    if (is_set("max-read-length", options) && !split_long_reads(options)) {
+        good_length.max_length = as_unsigned("max-read-length", options);
     }
+    result.add(make_unique<CommonReadFilterChain>(rejected_flags, predicates::HasValidBaseQualities {},
+                                                  predicates::HasWellFormedCigar {},
+                                                  predicates::IsGoodMappingQuality {static_cast<AlignedRead::MappingQuality>(min_mapping_quality)},
+                                                  good_length));
     if (min_base_quality > 0 && min_good_bases > 0) {
         result.add(make_unique<HasSufficientGoodQualityBases>(min_base_quality, min_good_bases));
     }
@@ -933,20 +1148,21 @@ auto make_read_filterer(const OptionMap& options)
         auto min_good_base_fraction = options.at("min-good-base-fraction").as<double>();
         result.add(make_unique<HasSufficientGoodBaseFraction>(min_base_quality, min_good_base_fraction));
     }
-    if (is_set("min-read-length", options)) {
-        result.add(make_unique<IsLong>(as_unsigned("min-read-length", options)));
-    } else {
-        result.add(make_unique<IsLong>(0));
-    }
-    if (is_set("max-read-length", options) && !split_long_reads(options)) {
-        result.add(make_unique<IsShort>(as_unsigned("max-read-length", options)));
-    }
-    if (!options.at("allow-marked-duplicates").as<bool>()) {
-        result.add(make_unique<IsNotMarkedDuplicate>());
+    using RDDP = ReadDeduplicationDetectionPolicy;
+    const auto duplicate_detection_policy = options.at("duplicate-read-detection-policy").as<RDDP>();
+    if (options.at("collapse-duplicates").as<bool>()) {
+        switch (duplicate_detection_policy) {
+            case RDDP::relaxed: {
+                result.add(make_unique<IsNotCollapsedDuplicate<ReadFilterer::ReadIterator, FivePrimeAndCigarDuplicateDefinition>>());
+                break;
+            }
+            case RDDP::aggressive: {
+                result.add(make_unique<IsNotCollapsedDuplicate<ReadFilterer::ReadIterator, FivePrimeDuplicateDefinition>>());
+                break;
+            }
+        }
     }
     if (!options.at("allow-octopus-duplicates").as<bool>()) {
-        using RDDP = ReadDeduplicationDetectionPolicy;
-        const auto duplicate_detection_policy = options.at("duplicate-read-detection-policy").as<RDDP>();
         switch (duplicate_detection_policy) {
             case RDDP::relaxed: {
                 result.add(make_unique<IsNotDuplicate<ReadFilterer::ReadIterator, FivePrimeAndCigarDuplicateDefinition>>());
@@ -958,9 +1174,6 @@ auto make_read_filterer(const OptionMap& options)
             }
         }
     }
-    if (!options.at("allow-qc-fails").as<bool>()) {
-        result.add(make_unique<IsNotMarkedQcFail>());
-    }
     if (is_set("no-reads-with-tag", options)) {
         const auto filter_tags = options.at("no-reads-with-tag").as<std::vector<SamTag>>();
         for (const auto& filter_tag : filter_tags) {
@@ -971,12 +1184,6 @@ auto make_read_filterer(const OptionMap& options)
             result.add(make_unique<NotHasTag>(*tag, std::move(annotation)));
         }
     }
-    if (!options.at("allow-secondary-alignments").as<bool>()) {
-        result.add(make_unique<IsNotSecondaryAlignment>());
-    }
-    if (!options.at("allow-supplementary-alignments").as<bool>()) {
-        result.add(make_unique<IsNotSupplementaryAlignment>());
-    }
     if (options.at("no-reads-with-unmapped-segments").as<bool>()) {
         result.add(make_unique<IsNextSegmentMapped>());
         result.add(make_unique<IsProperTemplate>());
@@ -1025,7 +1232,7 @@ boost::optional<readpipe::Downsampler> make_downsampler(const OptionMap& options
     return boost::none;
 }
 
-ReadPipe make_read_pipe(ReadManager& read_manager, const ReferenceGenome& reference, std::vector<SampleName> samples, const OptionMap& options)
+auto make_read_pipe_without_streaming(ReadManager& read_manager, const ReferenceGenome& reference, std::vector<SampleName> samples, const OptionMap& options)
 {
     auto transformers = make_read_transformers(reference, options);
     if (transformers.second.num_transforms() > 0) {
@@ -1043,6 +1250,15 @@ ReadPipe make_read_pipe(ReadManager& read_manager, const ReferenceGenome& refere
     }
 }
 
+ReadPipe make_read_pipe(ReadManager& read_manager, const ReferenceGenome& reference, std::vector<SampleName> samples, const OptionMap& options)
+{
+    auto result = make_read_pipe_without_streaming(read_manager, reference, std::move(samples), options);
+    if (is_downsampling_enabled(options) && is_set("max-streamed-coverage", options)) {
+        result.set_max_streamed_coverage(as_unsigned("max-streamed-coverage", options));
+    }
+    return result;
+}
+
 auto get_default_germline_inclusion_predicate(const OptionMap& options)
 {
     return coretools::KnownCopyNumberInclusionPredicate {static_cast<unsigned>(options.at("organism-ploidy").as<int>())};
@@ -1295,6 +1511,7 @@ auto make_variant_generator_builder(const OptionMap& options, const boost::optio
             scanner_options.misalignment_parameters = boost::none;
         }
         scanner_options.ignore_strand_bias = options.at("allow-strand-biased-candidates").as<bool>();
+        scanner_options.collapse_identical_reads = options.at("collapse-identical-pileup-reads").as<bool>();
         result.set_cigar_scanner(std::move(scanner_options));
     }
     if (repeat_candidate_variant_generator_enabled(options)) {
@@ -1668,6 +1885,26 @@ bool use_int_hmm_scores(const OptionMap& options, const boost::optional<const Re
     return options.at("use-wide-hmm-scores").as<bool>();
 }
 
+boost::optional<std::size_t> get_min_active_clipped_read_length(const OptionMap& options)
+{
+    const auto result = as_unsigned("min-active-clipped-read-length", options);
+    if (result > 0) {
+        return static_cast<std::size_t>(result);
+    } else {
+        return boost::none;
+    }
+}
+
+boost::optional<std::size_t> get_min_difference_scored_haplotype_length(const OptionMap& options)
+{
+    const auto result = as_unsigned("min-difference-scored-haplotype-length", options);
+    if (result > 0) {
+        return static_cast<std::size_t>(result);
+    } else {
+        return boost::none;
+    }
+}
+
 HaplotypeLikelihoodModel
 make_calling_haplotype_likelihood_model(const OptionMap& options, const boost::optional<const ReadSetProfile&> read_profile)
 {
@@ -1681,6 +1918,8 @@ make_calling_haplotype_likelihood_model(const OptionMap& options, const boost::o
     }
     config.max_indel_error = as_unsigned("max-indel-errors", options);
     config.use_int_scores = use_int_hmm_scores(options, read_profile);
+    config.min_active_clipped_read_length = get_min_active_clipped_read_length(options);
+    config.min_difference_scored_haplotype_length = get_min_difference_scored_haplotype_length(options);
     return HaplotypeLikelihoodModel {std::move(error_model.snv), std::move(error_model.indel), config};
 }
 
@@ -1706,6 +1945,7 @@ make_realignment_haplotype_likelihood_model(const HaplotypeLikelihoodModel& call
     auto realignment_config = result.config();
     realignment_config.use_mapping_quality = false;
     realignment_config.use_flank_state = false;
+    realignment_config.min_difference_scored_haplotype_length = boost::none;
     realignment_config.use_int_scores = use_int_hmm_scores_for_realignment(options, read_profile);
     realignment_config.max_indel_error = get_realignment_hmm_max_indel_errors(options, read_profile);
     result.set(std::move(realignment_config));
@@ -1734,7 +1974,9 @@ auto make_haplotype_generator_builder(const OptionMap& options, const boost::opt
         .set_lagging_policy(lagging_policy)
         .set_max_holdout_depth(max_holdout_depth)
         .set_max_indicator_join_distance(get_max_indicator_join_distance())
-        .set_min_flank_pad(get_min_haplotype_flank_pad(options, input_reads_profile));
+        .set_min_flank_pad(get_min_haplotype_flank_pad(options, input_reads_profile))
+        .set_prune_unsupported_haplotypes(options.at("prune-unsupported-haplotypes").as<bool>())
+        .set_split_unlinked_blocks(options.at("split-unlinked-haplotype-blocks").as<bool>());
     if (input_reads_profile) {
         result.set_max_allele_distance(1000 * input_reads_profile->length_stats.max);
     }
@@ -2051,12 +2293,27 @@ auto get_normal_contamination_risk(const OptionMap& options)
     return result;
 }
 
+// Whatever of --max-memory is not given to the read buffer and reference cache is left for calling
+boost::optional<MemoryFootprint> get_max_working_memory(const OptionMap& options)
+{
+    const auto max_memory = get_max_memory(options);
+    if (!max_memory) return boost::none;
+    const auto fixed_memory = get_target_read_buffer_size(options) + get_max_reference_cache_size(options);
+    return MemoryFootprint {fixed_memory < *max_memory ? (*max_memory - fixed_memory).bytes() : 0};
+}
+
 auto get_target_working_memory(const OptionMap& options)
 {
     boost::optional<MemoryFootprint> result {};
-    if (is_set("target-working-memory", options)) {
+    const auto max_working_memory = get_max_working_memory(options);
+    if (is_set("target-working-memory", options) || max_working_memory) {
         static const MemoryFootprint min_target_memory {*parse_footprint("100M")};
-        result = options.at("target-working-memory").as<MemoryFootprint>();
+        if (is_set("target-working-memory", options)) {
+            result = options.at("target-working-memory").as<MemoryFootprint>();
+            if (max_working_memory) result = std::min(*result, *max_working_memory);
+        } else {
+            result = max_working_memory;
+        }
         auto num_threads = get_num_threads(options);
         if (!num_threads) {
             num_threads = std::thread::hardware_concurrency();
@@ -2157,16 +2414,56 @@ auto get_phase_detection_policy(const OptionMap& options)
     }
 }
 
-CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& read_pipe,
-                                  const InputRegionMap& regions, const OptionMap& options,
-                                  const boost::optional<const ReadSetProfile&> read_profile)
+// Only options that can change the generated candidates, so calling options can be tuned without invalidating the cache
+std::string make_candidate_cache_fingerprint(const OptionMap& options)
+{
+    static const std::vector<std::string> candidate_options {
+        "reference", "reads", "reads-file", "samples", "samples-file", "caller", "organism-ploidy", "normal-samples",
+        "snp-heterozygosity", "snp-heterozygosity-stdev", "indel-heterozygosity", "min-credible-somatic-frequency",
+        "min-expected-somatic-frequency", "min-clone-frequency", "fast", "very-fast",
+        "disable-read-preprocessing", "max-base-quality", "mask-low-quality-tails", "mask-tails", "mask-soft-clipped-bases",
+        "soft-clip-mask-threshold", "mask-soft-clipped-boundary-bases", "disable-adapter-masking", "disable-overlap-masking",
+        "mask-inverted-soft-clipping", "mask-3prime-shifted-soft-clipped-heads", "split-long-reads", "consider-unmapped-reads",
+        "min-mapping-quality", "good-base-quality", "min-good-base-fraction", "min-good-bases", "allow-qc-fails",
+        "min-read-length", "max-read-length", "allow-marked-duplicates", "allow-octopus-duplicates",
+        "duplicate-read-detection-policy", "collapse-duplicates", "allow-secondary-alignments", "allow-supplementary-alignments",
+        "no-reads-with-unmapped-segments", "no-reads-with-distant-segments", "no-adapter-contaminated-reads",
+        "max-decoy-supplementary-alignment-mapping-quality", "max-unplaced-supplementary-alignment-mapping-quality",
+        "max-unlocalized-supplementary-alignment-mapping-quality", "no-reads-with-tag", "disable-downsampling",
+        "downsample-above", "downsample-target", "max-streamed-coverage", "use-same-read-profile-for-all-samples",
+        "variant-discovery-mode", "disable-denovo-variant-discovery", "disable-pileup-candidate-generator",
+        "disable-repeat-candidate-generator", "disable-assembly-candidate-generator", "source-candidates",
+        "source-candidates-file", "min-source-candidate-quality", "use-filtered-source-candidates",
+        "min-pileup-base-quality", "min-supporting-reads", "force-pileup-candidates", "collapse-identical-pileup-reads",
+        "max-variant-size", "kmer-sizes", "max-fallback-kmers", "fallback-kmer-gap", "max-assembly-region-size",
+        "max-assembly-region-overlap", "assemble-all", "assembler-mask-base-quality", "allow-cycles", "min-kmer-prune",
+        "max-bubbles", "min-bubble-score", "allow-strand-biased-candidates", "min-candidate-credible-vaf-probability"
+    };
+    OptionMap candidate_option_map {};
+    for (const auto& option : candidate_options) {
+        if (options.count(option) == 1) candidate_option_map.emplace(option, options.at(option));
+    }
+    std::ostringstream ss {};
+    ss << to_string(candidate_option_map, true, false);
+    // Catch inputs that were modified in place
+    auto input_paths = get_read_paths(options, false);
+    input_paths.push_back(get_reference_path(options));
+    for (const auto& path : input_paths) {
+        boost::system::error_code ec {};
+        ss << ' ' << path.string() << ':' << fs::last_write_time(path, ec);
+    }
+    return std::to_string(std::hash<std::string> {}(ss.str()));
+}
+
+CallerBuilder make_caller_builder(const ReferenceGenome& reference, ReadPipe& read_pipe, const OptionMap& options,
+                                  const boost::optional<const ReadSetProfile&> read_profile,
+                                  const std::string& caller, const std::vector<SampleName>& samples,
+                                  const boost::optional<Pedigree>& pedigree)
 {
     CallerBuilder vc_builder {reference, read_pipe,
                               make_variant_generator_builder(options, read_profile),
                               make_haplotype_generator_builder(options, read_profile)};
-	const auto pedigree = read_ped_file(options);
-    const auto caller = get_caller_type(options, read_pipe.samples(), pedigree);
-    check_caller(caller, read_pipe.samples(), options);
+    check_caller(caller, samples, options);
     vc_builder.set_caller(caller);
     
     if (is_experimental_caller(caller)) {
@@ -2200,17 +2497,38 @@ CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& re
     } else {
         vc_builder.set_min_variant_posterior(min_variant_posterior);
     }
+    if (is_set("regenotype", options)) {
+        const auto regenotype_path = resolve_path(options.at("regenotype").as<fs::path>(), options);
+        vc_builder.set_regenotype_sites(std::make_shared<const VcfReader>(regenotype_path));
+        vc_builder.set_site_likelihoods(writes_site_likelihoods(options));
+    }
     vc_builder.set_read_linkage(get_read_linkage_type(options));
     vc_builder.set_ploidies(get_ploidy_map(options));
     vc_builder.set_max_haplotypes(get_max_haplotypes(options));
     vc_builder.set_max_genotypes(get_max_genotypes(options, caller));
     vc_builder.set_max_genotype_combinations(get_max_genotype_combinations(options, caller));
+    if (is_set("min-kept-genotype-posterior", options)) {
+        vc_builder.set_min_kept_genotype_posterior(options.at("min-kept-genotype-posterior").as<float>());
+    }
     vc_builder.set_haplotype_extension_threshold(options.at("min-protected-haplotype-posterior").as<double>());
     vc_builder.set_reference_haplotype_protection(protect_reference_haplotype(options));
     vc_builder.set_likelihood_model(make_calling_haplotype_likelihood_model(options, read_profile));
     auto min_phase_score = options.at("min-phase-score").as<Phred<double>>();
     vc_builder.set_min_phase_score(min_phase_score);
+    if (options.at("incremental-phasing").as<bool>()) {
+        vc_builder.set_phasing_algorithm(Phaser::Algorithm::incremental);
+    }
     vc_builder.set_early_phase_detection_policy(get_phase_detection_policy(options));
+    vc_builder.set_speculative_lookahead(options.at("speculative-lookahead").as<bool>());
+    vc_builder.set_region_prescreening(options.at("prescreen-regions").as<bool>());
+    const auto task_time_budget = get_task_time_budget(options);
+    if (task_time_budget) vc_builder.set_time_budget(*task_time_budget);
+    if (is_set("compact-retained-likelihoods", options)) {
+        vc_builder.set_compact_likelihood_bits(as_unsigned("compact-retained-likelihoods", options));
+    }
+    if (is_set("uninformative-read-spread", options)) {
+        vc_builder.set_uninformative_read_spread(options.at("uninformative-read-spread").as<float>());
+    }
     if (!options.at("use-uniform-genotype-priors").as<bool>()) {
         vc_builder.set_snp_heterozygosity(options.at("snp-heterozygosity").as<float>());
         vc_builder.set_indel_heterozygosity(options.at("indel-heterozygosity").as<float>());
@@ -2236,7 +2554,7 @@ CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& re
         vc_builder.set_normal_contamination_risk(get_normal_contamination_risk(options));
         vc_builder.set_tumour_germline_concentration(options.at("tumour-germline-concentration").as<float>());
     } else if (caller == "trio") {
-        vc_builder.set_trio(make_trio(read_pipe.samples(), options, pedigree));
+        vc_builder.set_trio(make_trio(samples, options, pedigree));
         vc_builder.set_snv_denovo_prior(options.at("denovo-snv-prior").as<float>());
         vc_builder.set_indel_denovo_prior(options.at("denovo-indel-prior").as<float>());
         vc_builder.set_min_denovo_posterior(options.at("min-denovo-posterior").as<Phred<double>>());
@@ -2275,6 +2593,41 @@ CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& re
     if (bad_region_detector) {
         vc_builder.set_bad_region_detector(std::move(*bad_region_detector));
     }
+    return vc_builder;
+}
+
+CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& read_pipe,
+                                  const InputRegionMap& regions, const OptionMap& options,
+                                  const boost::optional<const ReadSetProfile&> read_profile)
+{
+    const auto pedigree = read_ped_file(options);
+    const auto caller = get_caller_type(options, read_pipe.samples(), pedigree);
+    auto vc_builder = make_caller_builder(reference, read_pipe, options, read_profile, caller, read_pipe.samples(), pedigree);
+    if (is_set("candidate-cache", options)) {
+        const auto cache_directory = resolve_path(options.at("candidate-cache").as<fs::path>(), options);
+        vc_builder.set_candidate_cache(std::make_shared<coretools::CandidateCache>(cache_directory, make_candidate_cache_fingerprint(options)));
+    }
+    return CallerFactory {std::move(vc_builder)};
+}
+
+auto get_secondary_caller_samples(const std::string& caller, const std::vector<SampleName>& samples, const OptionMap& options)
+{
+    if ((caller == "individual" || caller == "polyclone") && samples.size() > 1) {
+        if (!is_set("normal-samples", options)) throw BadSampleCount {};
+        return std::vector<SampleName> {options.at("normal-samples").as<std::vector<std::string>>().front()};
+    }
+    return samples;
+}
+
+boost::optional<CallerFactory>
+make_secondary_caller_factory(const ReferenceGenome& reference, ReadPipe& read_pipe, const OptionMap& options,
+                              const boost::optional<const ReadSetProfile&> read_profile)
+{
+    if (!is_set("secondary-caller", options)) return boost::none;
+    const auto caller = options.at("secondary-caller").as<std::string>();
+    auto samples = get_secondary_caller_samples(caller, read_pipe.samples(), options);
+    auto vc_builder = make_caller_builder(reference, read_pipe, options, read_profile, caller, samples, read_ped_file(options));
+    vc_builder.set_samples(std::move(samples));
     return CallerFactory {std::move(vc_builder)};
 }
 
@@ -2415,6 +2768,9 @@ make_call_filter_factory(const ReferenceGenome& reference, ReadPipe& read_pipe,
                 output_options.annotations.insert(std::begin(annotations), std::end(annotations));
             }
             output_options.aggregate_allele_annotations = aggregate_annotations(options);
+            if (is_set("csr-training-output", options)) {
+                output_options.measure_table = resolve_path(options.at("csr-training-output").as<fs::path>(), options);
+            }
             result->set_output_options(std::move(output_options));
         }
     }
@@ -2475,6 +2831,19 @@ boost::optional<fs::path> get_output_path(const OptionMap& options)
     return boost::none;
 }
 
+boost::optional<fs::path> get_secondary_output_path(const OptionMap& options)
+{
+    if (is_set("secondary-output", options)) {
+        return resolve_path(options.at("secondary-output").as<fs::path>(), options);
+    }
+    return boost::none;
+}
+
+unsigned get_num_output_compression_threads(const OptionMap& options)
+{
+    return as_unsigned("output-compression-threads", options);
+}
+
 class UnwritableTempDirectory : public SystemError
 {
     std::string do_where() const override { return "create_temp_file_directory"; }
@@ -2570,6 +2939,14 @@ fs::path create_temp_file_directory(const OptionMap& options)
     unsigned temp_dir_counter {2};
     logging::WarningLogger log {};
     boost::system::error_code error_code {};
+    if (is_resume_requested(options)) {
+        if (fs::is_directory(result, error_code)) {
+            logging::InfoLogger info_log {};
+            stream(info_log) << "Resuming from temporary directory " << result;
+            return result;
+        }
+        stream(log) << "There is no temporary directory " << result << " to resume from so calling will start from the beginning";
+    }
     while (!fs::create_directory(result, error_code) && temp_dir_counter <= temp_dir_name_count_limit) {
         if (error_code != boost::system::errc::success) {
             // if create_directory returns false and error code is not set then directory already exists
@@ -2597,6 +2974,16 @@ bool keep_temporary_files(const OptionMap& options)
     return options.at("keep-temporary-files").as<bool>();
 }
 
+MemoryFootprint get_max_in_memory_calls_size(const OptionMap& options)
+{
+    return options.at("max-in-memory-calls").as<MemoryFootprint>();
+}
+
+bool is_resume_requested(const OptionMap& options)
+{
+    return options.at("resume").as<bool>();
+}
+
 boost::optional<fs::path> filter_request(const OptionMap& options)
 {
     if (is_call_filtering_requested(options) && is_set("filter-vcf", options)) {
@@ -2647,5 +3034,137 @@ boost::optional<fs::path> data_profile_request(const OptionMap& options)
     return boost::none;
 }
 
+boost::optional<fs::path> columnar_output_request(const OptionMap& options)
+{
+    if (is_set("columnar-output", options)) {
+        return resolve_path(options.at("columnar-output").as<fs::path>(), options);
+    }
+    return boost::none;
+}
+
+boost::optional<unsigned> get_data_profile_sample_size(const OptionMap& options)
+{
+    if (is_set("data-profile-sample-size", options)) {
+        return options.at("data-profile-sample-size").as<unsigned>();
+    }
+    return boost::none;
+}
+
+boost::optional<fs::path> task_report_request(const OptionMap& options)
+{
+    if (is_set("task-report", options)) {
+        return resolve_path(options.at("task-report").as<fs::path>(), options);
+    }
+    return boost::none;
+}
+
+boost::optional<fs::path> performance_report_request(const OptionMap& options)
+{
+    if (is_set("performance-report", options)) {
+        return resolve_path(options.at("performance-report").as<fs::path>(), options);
+    }
+    return boost::none;
+}
+
+boost::optional<fs::path> progress_report_request(const OptionMap& options)
+{
+    if (is_set("progress-report", options)) {
+        return resolve_path(options.at("progress-report").as<fs::path>(), options);
+    }
+    return boost::none;
+}
+
+std::chrono::seconds get_progress_report_interval(const OptionMap& options)
+{
+    return std::chrono::seconds {options.at("progress-report-interval").as<int>()};
+}
+
+boost::optional<std::chrono::seconds> get_task_time_budget(const OptionMap& options)
+{
+    if (is_set("task-time-budget", options)) {
+        return std::chrono::seconds {options.at("task-time-budget").as<int>()};
+    } else {
+        return boost::none;
+    }
+}
+
+bool writes_site_likelihoods(const OptionMap& options)
+{
+    return is_set("regenotype", options) && options.at("regenotype-likelihoods").as<bool>();
+}
+
+std::vector<fs::path> get_cohort_likelihood_paths(const OptionMap& options)
+{
+    std::vector<fs::path> result {};
+    if (is_set("cohort-likelihoods", options)) {
+        result = resolve_paths(options.at("cohort-likelihoods").as<std::vector<fs::path>>(), options);
+    }
+    return result;
+}
+
+boost::optional<fs::path> get_unevaluated_sites_output_path(const OptionMap& options)
+{
+    if (is_set("unevaluated-sites-output", options)) {
+        return resolve_path(options.at("unevaluated-sites-output").as<fs::path>(), options);
+    } else {
+        return boost::none;
+    }
+}
+
+boost::optional<ShardManifestRequest> shard_manifest_request(const OptionMap& options)
+{
+    if (is_set("make-shards", options)) {
+        ShardManifestRequest result {};
+        result.manifest = resolve_path(options.at("shard-manifest").as<fs::path>(), options);
+        result.num_shards = options.at("make-shards").as<int>();
+        result.padding = options.at("shard-padding").as<int>();
+        return result;
+    }
+    return boost::none;
+}
+
+class BadShardMerge : public UserError
+{
+    std::string do_where() const override
+    {
+        return "shard_merge_request";
+    }
+    std::string do_why() const override
+    {
+        std::ostringstream ss {};
+        ss << "The shard manifest has " << num_shards_ << " shards but " << num_calls_
+           << " shard call files were given";
+        return ss.str();
+    }
+    std::string do_help() const override
+    {
+        return "Provide one call file per shard to --merge-shards, in shard order";
+    }
+    
+    unsigned num_shards_;
+    std::size_t num_calls_;
+public:
+    BadShardMerge(unsigned num_shards, std::size_t num_calls) : num_shards_ {num_shards}, num_calls_ {num_calls} {}
+};
+
+bool is_shard_merge_requested(const OptionMap& options) noexcept
+{
+    return is_set("merge-shards", options);
+}
+
+boost::optional<ShardMergeRequest> shard_merge_request(const OptionMap& options, const ReferenceGenome& reference)
+{
+    if (is_shard_merge_requested(options)) {
+        ShardMergeRequest result {};
+        result.manifest = read_shard_manifest(options, reference);
+        result.shard_calls = resolve_paths(options.at("merge-shards").as<std::vector<fs::path>>(), options);
+        if (result.shard_calls.size() != io::count_shards(result.manifest)) {
+            throw BadShardMerge {io::count_shards(result.manifest), result.shard_calls.size()};
+        }
+        return result;
+    }
+    return boost::none;
+}
+
 } // namespace options
 } // namespace octopus
@@ -6,6 +6,7 @@
 
 #include <vector>
 #include <cstddef>
+#include <chrono>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
@@ -15,13 +16,16 @@
 #include "option_parser.hpp"
 #include "basics/ploidy_map.hpp"
 #include "core/callers/caller_factory.hpp"
+#include "core/tools/bad_region_detector.hpp"
 #include "core/csr/filters/variant_call_filter_factory.hpp"
 #include "io/reference/reference_genome.hpp"
 #include "io/read/read_manager.hpp"
 #include "io/variant/vcf_writer.hpp"
+#include "io/region/shard_manifest.hpp"
 #include "readpipe/read_pipe.hpp"
 #include "utils/input_reads_profiler.hpp"
 #include "utils/memory_footprint.hpp"
+#include "core/models/pairhmm/simd_pair_hmm_kernels.hpp"
 
 namespace fs = boost::filesystem;
 
@@ -37,12 +41,37 @@ boost::optional<fs::path> get_trace_log_file_name(const OptionMap& options);
 
 boost::optional<unsigned> get_num_threads(const OptionMap& options);
 
+bool is_numa_aware(const OptionMap& options);
+
+unsigned get_task_prefetch_depth(const OptionMap& options);
+
+boost::optional<fs::path> get_service_socket_path(const OptionMap& options);
+
+unsigned get_max_service_jobs(const OptionMap& options);
+
+// Returns none if the fastest instruction set the CPU supports should be used
+boost::optional<hmm::simd::InstructionSet> get_pair_hmm_instruction_set(const OptionMap& options);
+
+// Returns none if the GPU pair HMM backend shouldn't be used, otherwise the smallest batch to send to the GPU
+boost::optional<std::size_t> get_pair_hmm_gpu_min_batch_size(const OptionMap& options);
+
+boost::optional<MemoryFootprint> get_max_memory(const OptionMap& options);
+
 MemoryFootprint get_target_read_buffer_size(const OptionMap& options);
 
+bool compress_read_buffer(const OptionMap& options);
+
+MemoryFootprint get_max_reference_cache_size(const OptionMap& options);
+
+fs::path get_reference_path(const OptionMap& options);
+
 ReferenceGenome make_reference(const OptionMap& options);
 
 InputRegionMap get_search_regions(const OptionMap& options, const ReferenceGenome& reference);
 
+// Empty unless the debug and trace logs are restricted to some regions
+InputRegionMap get_debug_regions(const OptionMap& options, const ReferenceGenome& reference);
+
 ContigOutputOrder get_contig_output_order(const OptionMap& options);
 
 bool ignore_unmapped_contigs(const OptionMap& options);
@@ -55,6 +84,9 @@ boost::optional<AlignedRead::NucleotideSequence::size_type> max_read_length(cons
 
 bool use_same_read_profile_for_all_samples(const OptionMap& options);
 
+// The filters of the read pipe made by make_read_pipe
+ReadPipe::ReadFilterer make_read_filterer(const OptionMap& options);
+
 ReadPipe make_read_pipe(ReadManager& read_manager, const ReferenceGenome& reference, std::vector<SampleName> samples, const OptionMap& options);
 
 bool call_sites_only(const OptionMap& options);
@@ -74,6 +106,11 @@ CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& re
                                   const InputRegionMap& regions, const OptionMap& options,
                                   boost::optional<const ReadSetProfile&> input_reads_profile = boost::none);
 
+// The factory for the '--secondary-caller', which calls the reads and candidates of the main caller
+boost::optional<CallerFactory>
+make_secondary_caller_factory(const ReferenceGenome& reference, ReadPipe& read_pipe, const OptionMap& options,
+                              boost::optional<const ReadSetProfile&> input_reads_profile = boost::none);
+
 bool is_call_filtering_requested(const OptionMap& options) noexcept;
 
 std::unique_ptr<VariantCallFilterFactory>
@@ -87,9 +124,14 @@ bool keep_unfiltered_calls(const OptionMap& options) noexcept;
 ReadPipe make_call_filter_read_pipe(ReadManager& read_manager, const ReferenceGenome& reference, std::vector<SampleName> samples, const OptionMap& options);
 
 boost::optional<fs::path> get_output_path(const OptionMap& options);
+boost::optional<fs::path> get_secondary_output_path(const OptionMap& options);
+unsigned get_num_output_compression_threads(const OptionMap& options);
 
 fs::path create_temp_file_directory(const OptionMap& options);
 bool keep_temporary_files(const OptionMap& options);
+MemoryFootprint get_max_in_memory_calls_size(const OptionMap& options);
+
+bool is_resume_requested(const OptionMap& options);
 
 bool is_filter_training_mode(const OptionMap& options);
 
@@ -101,7 +143,42 @@ bool full_bamouts_requested(const OptionMap& options);
 
 unsigned estimate_max_open_files(const OptionMap& options);
 
+boost::optional<coretools::BadRegionDetector>
+make_bad_region_detector(const OptionMap& options, const boost::optional<const ReadSetProfile&>& input_reads_profile);
+
 boost::optional<fs::path> data_profile_request(const OptionMap& options);
+boost::optional<unsigned> get_data_profile_sample_size(const OptionMap& options);
+boost::optional<fs::path> columnar_output_request(const OptionMap& options);
+
+boost::optional<fs::path> task_report_request(const OptionMap& options);
+
+boost::optional<fs::path> performance_report_request(const OptionMap& options);
+
+boost::optional<fs::path> progress_report_request(const OptionMap& options);
+std::chrono::seconds get_progress_report_interval(const OptionMap& options);
+boost::optional<std::chrono::seconds> get_task_time_budget(const OptionMap& options);
+
+bool writes_site_likelihoods(const OptionMap& options);
+std::vector<fs::path> get_cohort_likelihood_paths(const OptionMap& options);
+boost::optional<fs::path> get_unevaluated_sites_output_path(const OptionMap& options);
+
+struct ShardManifestRequest
+{
+    fs::path manifest;
+    unsigned num_shards;
+    GenomicRegion::Size padding;
+};
+
+boost::optional<ShardManifestRequest> shard_manifest_request(const OptionMap& options);
+
+struct ShardMergeRequest
+{
+    io::ShardManifest manifest;
+    std::vector<fs::path> shard_calls;
+};
+
+bool is_shard_merge_requested(const OptionMap& options) noexcept;
+boost::optional<ShardMergeRequest> shard_merge_request(const OptionMap& options, const ReferenceGenome& reference);
 
 ReadLinkageType get_read_linkage_type(const OptionMap& options);
 
@@ -39,12 +39,13 @@ void check_positive(const std::string& option, const OptionMap& vm);
 void check_reads_present(const OptionMap& vm);
 void check_region_files_consistent(const OptionMap& vm);
 void check_trio_consistent(const OptionMap& vm);
-void validate_caller(const OptionMap& vm);
-void validate(const OptionMap& vm);
+void check_compact_likelihood_bits(const OptionMap& vm);
+void validate_caller(const OptionMap& vm, const std::string& option = "caller");
+void validate(const OptionMap& vm, bool require_reads);
 
 po::parsed_options run(po::command_line_parser& parser);
 
-OptionMap parse_options(const int argc, const char** argv)
+OptionMap parse_options(const int argc, const char** argv, const bool require_reads)
 {
     po::options_description general("General");
     general.add_options()
@@ -66,6 +67,10 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<fs::path>()->implicit_value("octopus_trace.log"),
      "Create very verbose log file for debugging")
     
+    ("debug-regions",
+     po::value<std::vector<std::string>>()->multitoken(),
+     "Space-separated list of regions (chrom:begin-end); only tasks overlapping one of these write to the debug and trace logs")
+    
     ("working-directory,w",
      po::value<fs::path>(),
      "Sets the working directory")
@@ -78,6 +83,28 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<int>()->implicit_value(0),
      "Maximum number of threads to be used. If no argument is provided unlimited threads are assumed")
     
+    ("numa",
+     po::bool_switch()->default_value(false),
+     "Bind calling threads to NUMA nodes and run each contig's tasks on a single node where possible")
+    
+    ("service-socket",
+     po::value<fs::path>(),
+     "Unix domain socket that the serve command accepts calling jobs on")
+    
+    ("max-service-jobs",
+     po::value<int>()->default_value(1),
+     "Maximum number of jobs the serve command runs at once")
+    
+    ("speculative-lookahead",
+     po::bool_switch()->default_value(false),
+     "Generate the next active region, and compute its haplotype likelihoods, on idle threads while the"
+     " current active region is evaluated. The work is discarded if the next active region changes")
+    
+    ("task-prefetch-depth",
+     po::value<int>()->default_value(1),
+     "Number of tasks whose reads and candidates are fetched, on a dedicated thread, while all task threads are busy"
+     " so they can go straight to inference when a thread becomes free. Zero disables prefetching")
+    
     ("max-reference-cache-memory,X",
      po::value<MemoryFootprint>()->default_value(*parse_footprint("500MB"), "500MB"),
      "Maximum memory for cached reference sequence")
@@ -86,13 +113,57 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<MemoryFootprint>()->default_value(*parse_footprint("6GB"), "6GB"),
      "None-binding request to limit the memory of buffered read data")
     
+    ("compress-read-buffer",
+     po::bool_switch()->default_value(false),
+     "Keep reads buffered for filtering in a compressed format, so more reads fit in the target read buffer memory")
+    
     ("target-working-memory",
      po::value<MemoryFootprint>(),
      "Target working memory per thread for computation, not including read or reference data")
+    
+    ("compact-retained-likelihoods",
+     po::value<int>(),
+     "Once the latents of an active region are inferred, replace its haplotype likelihoods with a copy quantised"
+     " to this many bits (8 or 16) per read and haplotype, relative to each read's most likely haplotype. The copy"
+     " is used for assigning reads to called haplotypes. Has no effect with --model-posterior SPECIAL")
+    
+    ("uninformative-read-spread",
+     po::value<float>(),
+     "Reads whose log likelihoods differ by no more than this across all haplotypes are left out of"
+     " genotype inference and model posterior calculation")
+    
+    ("max-memory",
+     po::value<MemoryFootprint>(),
+     "Limit on the total memory of read buffers, reference caching, and calling. The read buffer and reference"
+     " cache are shrunk to fit, and new calling tasks are held back while the estimated memory in use exceeds the limit")
      
     ("max-open-read-files",
      po::value<int>()->default_value(250),
      "Limits the number of read files that are open simultaneously")
+    
+    ("read-decompression-threads",
+     po::value<int>()->default_value(0),
+     "Number of threads shared by all read files for BAM/CRAM decompression. If zero, reads are decompressed by the thread requesting them")
+    
+    ("read-ahead",
+     po::bool_switch()->default_value(false),
+     "Tell the OS which parts of local BAM files will be read next, so they can be read into the page cache before they are needed")
+    
+    ("remote-read-block-size",
+     po::value<MemoryFootprint>()->default_value(*parse_footprint("8MB"), "8MB"),
+     "Size of the range requests made when reading remote (e.g. s3:// or gs://) read files. Zero uses the htslib default")
+    
+    ("pair-hmm-isa",
+     po::value<PairHMMInstructionSet>()->default_value(PairHMMInstructionSet::automatic),
+     "SIMD instruction set used by the pair HMM [AUTO, SSE2, AVX2, AVX512, NEON, SVE]. AUTO uses the fastest the CPU supports")
+    
+    ("pair-hmm-gpu",
+     po::bool_switch()->default_value(false),
+     "Compute large batches of pair HMM alignments on the GPU. Requires a build with the CUDA_PAIR_HMM option")
+    
+    ("pair-hmm-gpu-min-batch-size",
+     po::value<int>()->default_value(1024),
+     "Smallest batch of alignments sent to the GPU with pair-hmm-gpu; smaller batches use the SIMD kernels")
 
     ("temp-directory-prefix",
      po::value<fs::path>()->default_value("octopus-temp"),
@@ -102,6 +173,16 @@ OptionMap parse_options(const int argc, const char** argv)
      po::bool_switch()->default_value(false),
      "Do not remove temporary files, even after an error")
     
+    ("max-in-memory-calls",
+     po::value<MemoryFootprint>()->default_value(*parse_footprint("64MB"), "64MB"),
+     "Multithreaded runs keep calls in memory, and write them straight to the output at the end, until they exceed"
+     " this size, after which they are written to temporary files. Zero always uses temporary files")
+    
+    ("resume",
+     po::bool_switch()->default_value(false),
+     "Resume an interrupted multithreaded run from the progress journal in its temporary directory"
+     " (the directory given by temp-directory-prefix)")
+    
     ("reference,R",
      po::value<fs::path>()->required(),
      "Indexed FASTA format reference genome file to be analysed")
@@ -154,18 +235,44 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<fs::path>(),
      "File to where output is written (calls are written to stdout if unspecified)")
     
+    ("secondary-output",
+     po::value<fs::path>(),
+     "File to where calls made by the '--secondary-caller' are written")
+    
+    ("columnar-output",
+     po::value<fs::path>(),
+     "Directory to where the final calls are also written as columnar binary shards, one per contig, for fast"
+     " cohort queries. Requires calls to be written to a file")
+    
     ("contig-output-order",
      po::value<ContigOutputOrder>()->default_value(ContigOutputOrder::referenceIndex),
      "The order that contigs should be written to the output [LEXICOGRAPHICAL_ASCENDING, LEXICOGRAPHICAL_DESCENDING, CONTIG_SIZE_ASCENDING, CONTIG_SIZE_DESCENDING, REFERENCE_INDEX, REFERENCE_INDEX_REVERSED]")
     
+    ("output-compression-threads",
+     po::value<int>()->default_value(0),
+     "Number of threads shared by all compressed (.vcf.gz & .bcf) outputs, including temporary files, for BGZF compression. If zero, output is compressed by the thread writing it")
+    
     ("sites-only",
      po::bool_switch()->default_value(false),
      "Only reports call sites (i.e. drop sample genotype information)")
     
-    // ("regenotype",
-    //  po::value<fs::path>(),
-    //  "VCF file specifying calls to regenotype, only sites in this files will appear in the"
-    //  " final output")
+    ("regenotype",
+     po::value<fs::path>(),
+     "VCF file specifying sites to regenotype. Candidate discovery is skipped and each site in this file"
+     " appears once in the final output, genotyped from the reads overlapping it")
+    
+    ("regenotype-likelihoods",
+     po::bool_switch()->default_value(false),
+     "Also write each sample's log10 genotype likelihoods (GL) for the regenotyped sites, so the output can be"
+     " merged into a cohort with the 'merge-cohort' command")
+    
+    ("cohort-likelihoods",
+     po::value<std::vector<fs::path>>()->multitoken(),
+     "VCF files with sample genotype likelihoods (GL) that the 'merge-cohort' command merges into cohort genotypes")
+    
+    ("unevaluated-sites-output",
+     po::value<fs::path>(),
+     "File to where the 'merge-cohort' command writes the sites that some samples have no genotype likelihoods for")
     
     ("bamout",
      po::value<fs::path>(),
@@ -179,6 +286,26 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<fs::path>(),
      "Output a profile of variation and errors found in the data")
     
+    ("data-profile-sample-size",
+     po::value<unsigned>(),
+     "Stop profiling reads in a repeat context once it has this many reads, and stop the profile once all contexts found have")
+    
+    ("task-report",
+     po::value<fs::path>(),
+     "Output a JSONL report of the time and resources used by each calling task, ending with a summary of the slowest tasks")
+    
+    ("performance-report",
+     po::value<fs::path>(),
+     "Output counters and phase time histograms for the run, in Prometheus text format if the file extension is '.prom' and JSON otherwise")
+    
+    ("progress-report",
+     po::value<fs::path>(),
+     "Append a JSON line describing the progress, throughput and memory use of the run to this file every --progress-report-interval seconds")
+    
+    ("progress-report-interval",
+     po::value<int>()->default_value(10),
+     "Seconds between lines written to --progress-report")
+    
     ("fast",
      po::bool_switch()->default_value(false),
      "Turns off some features to improve runtime, at the cost of worse calling accuracy and phasing")
@@ -186,6 +313,31 @@ OptionMap parse_options(const int argc, const char** argv)
     ("very-fast",
      po::bool_switch()->default_value(false),
      "Like --fast but even faster")
+    
+    ("task-time-budget",
+     po::value<int>(),
+     "Seconds each calling task should take. Tasks that use over half of this consider fewer haplotypes for the rest of"
+     " their region, and the calls made with reduced effort are flagged DEGRADED")
+    
+    ("shard-manifest",
+     po::value<fs::path>(),
+     "Shard manifest file for distributed calling")
+    
+    ("make-shards",
+     po::value<int>(),
+     "Write a manifest partitioning the search regions into this many shards of roughly equal calling cost to --shard-manifest, then exit")
+    
+    ("shard-padding",
+     po::value<int>()->default_value(1000),
+     "Number of flanking reference positions called either side of each shard")
+    
+    ("shard",
+     po::value<int>(),
+     "Only call the regions of this shard in --shard-manifest (zero-based)")
+    
+    ("merge-shards",
+     po::value<std::vector<fs::path>>()->multitoken(),
+     "Merge the calls of each shard in --shard-manifest, given in shard order, into the final output")
     ;
     
     po::options_description read_preprocessing("Read preprocessing");
@@ -282,6 +434,10 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<ReadDeduplicationDetectionPolicy>()->default_value(ReadDeduplicationDetectionPolicy::relaxed),
      "Policy to use for duplicate read detection [RELAXED, AGGRESSIVE]")
     
+    ("collapse-duplicates",
+     po::bool_switch()->default_value(false),
+     "Merge each family of duplicate read pairs, split by MI or RX tags when present, into a single consensus read pair")
+    
     ("allow-secondary-alignments",
      po::bool_switch()->default_value(false),
      "Allows reads marked as secondary alignments")
@@ -330,6 +486,10 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<int>()->default_value(500),
      "Target coverage for the downsampler")
     
+    ("max-streamed-coverage",
+     po::value<int>(),
+     "Drop reads before they are decoded once this many reads overlap their start, to bound the work in extreme depth regions. Should be well above downsample-above")
+    
     ("use-same-read-profile-for-all-samples",
      po::bool_switch()->default_value(false),
      "Use the same read profile for all samples, rather than generating one per sample")
@@ -357,6 +517,11 @@ OptionMap parse_options(const int argc, const char** argv)
      po::bool_switch()->default_value(false),
      "Enable candidate generation using local re-assembly")
     
+    ("prescreen-regions",
+     po::bool_switch()->default_value(false),
+     "Skip candidate generation in regions where no read shows evidence of variation (indels, long soft"
+     " clips, or recurrent good quality mismatches)")
+    
     ("source-candidates,c",
      po::value<std::vector<fs::path>>()->multitoken(),
      "Variant file paths containing known variants. These variants will automatically become candidates")
@@ -386,6 +551,10 @@ OptionMap parse_options(const int argc, const char** argv)
      po::bool_switch()->default_value(false),
      "Include pileup candidate variants discovered from reads that are considered likely to be misaligned")
     
+    ("collapse-identical-pileup-reads",
+     po::bool_switch()->default_value(false),
+     "Scan identical reads (same position, strand, CIGAR and sequence) for pileup candidates once, for ultra-deep amplicon data")
+    
     ("max-variant-size",
      po::value<int>()->default_value(2000),
      "Maximum candidate variant size to consider (in region space)")
@@ -443,6 +612,11 @@ OptionMap parse_options(const int argc, const char** argv)
     ("min-candidate-credible-vaf-probability",
      po::value<float>()->default_value(0.75),
      "Minimum probability that pileup candidate variant has frequency above '--min-credible-somatic-frequency'")
+    
+    ("candidate-cache",
+     po::value<fs::path>(),
+     "Directory used to store candidate variants between runs. Candidates cached by a previous run with the same"
+     " inputs and discovery options are reused instead of being regenerated")
     ;
     
     po::options_description haplotype_generation("Haplotype generation");
@@ -485,6 +659,15 @@ OptionMap parse_options(const int argc, const char** argv)
     ("dont-protect-reference-haplotype",
      po::bool_switch()->default_value(false),
      "Do not protect the reference haplotype from filtering")
+    
+    ("prune-unsupported-haplotypes",
+     po::bool_switch()->default_value(false),
+     "Remove generated haplotypes with variant alleles that no read shares a kmer with before they are"
+     " evaluated by the calling model")
+    
+    ("split-unlinked-haplotype-blocks",
+     po::bool_switch()->default_value(false),
+     "Do not extend or backtrack the haplotype tree with alleles or haplotype blocks that no read links to it")
     ;
     
     po::options_description general_variant_calling("Variant calling (general)");
@@ -493,6 +676,11 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<std::string>()->default_value("population"),
      "Which of the octopus calling models to use")
     
+    ("secondary-caller",
+     po::value<std::string>(),
+     "An additional calling model to run on the same reads and candidate variants as '--caller', with calls"
+     " written to '--secondary-output'. The individual model calls the normal sample if multiple samples are given")
+    
     ("organism-ploidy,P",
      po::value<int>()->default_value(2),
      "All contigs with unspecified ploidies are assumed the organism ploidy")
@@ -552,6 +740,11 @@ OptionMap parse_options(const int argc, const char** argv)
      "Maximum number of genotype combinations that can be considered when computing joint"
      " genotype posterior probabilities")
     
+    ("min-kept-genotype-posterior",
+     po::value<float>(),
+     "Genotypes with posterior probability less than this in every sample are not kept after joint"
+     " genotyping, with the lost probability counted against calls")
+    
     ("use-independent-genotype-priors",
      po::bool_switch()->default_value(false),
      "Use independent genotype priors for joint calling")
@@ -583,6 +776,14 @@ OptionMap parse_options(const int argc, const char** argv)
     ("use-wide-hmm-scores",
      po::bool_switch()->default_value(false),
      "Use 32-bits rather than 16-bits for HMM scores")
+    
+    ("min-active-clipped-read-length",
+     po::value<int>()->default_value(1000),
+     "Reads at least this long are only aligned to haplotypes around the active region, rather than along their whole length (0 to disable)")
+    
+    ("min-difference-scored-haplotype-length",
+     po::value<int>()->default_value(2000),
+     "Haplotypes at least this long are scored by realigning reads only around where the haplotype differs from the reference (0 to disable)")
 
     ("read-linkage",
      po::value<ReadLinkage>()->default_value(ReadLinkage::paired),
@@ -595,6 +796,11 @@ OptionMap parse_options(const int argc, const char** argv)
     ("phasing-policy",
      po::value<PhasingPolicy>()->default_value(PhasingPolicy::automatic),
      "Policy for applying phasing algorithm [AUTO, CONSERVATIVE, AGGRESSIVE]")
+    
+    ("incremental-phasing",
+     po::bool_switch()->default_value(false),
+     "Build contiguous phase sets by linking each site to the nearest heterozygous sites, rather than"
+     " evaluating every pair of sites")
 
     ("bad-region-tolerance",
      po::value<BadRegionTolerance>()->default_value(BadRegionTolerance::normal),
@@ -759,6 +965,10 @@ OptionMap parse_options(const int argc, const char** argv)
      po::bool_switch()->default_value(false),
      "Aggregate all multi-value annotations into a single value")
     
+    ("csr-training-output",
+     po::value<fs::path>(),
+     "Write the measures of each call to a columnar binary table for training call filters")
+    
     ("filter-vcf",
      po::value<fs::path>(),
      "Filter the given Octopus VCF without calling")
@@ -860,7 +1070,7 @@ OptionMap parse_options(const int argc, const char** argv)
     
     vm_init.clear();
     po::store(run(po::command_line_parser(argc, argv).options(all)), vm);
-    validate(vm);
+    validate(vm, require_reads);
     po::notify(vm);
     
     return vm;
@@ -1126,15 +1336,26 @@ void check_trio_consistent(const OptionMap& vm)
     }
 }
 
-void validate_caller(const OptionMap& vm)
+void check_compact_likelihood_bits(const OptionMap& vm)
+{
+    const std::string option {"compact-retained-likelihoods"};
+    if (vm.count(option) == 1) {
+        const auto value = vm.at(option).as<int>();
+        if (value != 8 && value != 16) {
+            throw InvalidCommandLineOptionValue {option, value, "must be 8 or 16"};
+        }
+    }
+}
+
+void validate_caller(const OptionMap& vm, const std::string& option)
 {
-    if (vm.count("caller") == 1) {
-        const auto caller = vm.at("caller").as<std::string>();
+    if (vm.count(option) == 1) {
+        const auto caller = vm.at(option).as<std::string>();
         static const std::array<std::string, 6> validCallers {
             "individual", "population", "cancer", "trio", "polyclone", "cell"
         };
         if (std::find(std::cbegin(validCallers), std::cend(validCallers), caller) == std::cend(validCallers)) {
-            throw po::validation_error {po::validation_error::kind_t::invalid_option_value, caller, "caller"};
+            throw po::validation_error {po::validation_error::kind_t::invalid_option_value, caller, option};
         }
     }
 }
@@ -1162,32 +1383,65 @@ po::parsed_options run(po::command_line_parser& parser)
     }
 }
 
-void validate(const OptionMap& vm)
+void validate(const OptionMap& vm, const bool require_reads)
 {
     const std::vector<std::string> positive_int_options {
-        "threads", "mask-low-quality-tails", "mask-tails", "soft-clip-mask-threshold", "mask-soft-clipped-boundary-bases",
+        "threads", "max-service-jobs", "mask-low-quality-tails", "mask-tails", "soft-clip-mask-threshold", "mask-soft-clipped-boundary-bases",
         "min-mapping-quality", "good-base-quality", "min-good-bases", "min-read-length",
         "max-read-length", "min-base-quality", "max-variant-size",
         "max-fallback-kmers", "max-assembly-region-overlap", "assembler-mask-base-quality",
-        "min-kmer-prune", "max-bubbles", "max-holdout-depth", "max-copy-loss", "max-copy-gain"
+        "min-kmer-prune", "max-bubbles", "max-holdout-depth", "max-copy-loss", "max-copy-gain",
+        "shard-padding", "shard", "read-decompression-threads", "task-prefetch-depth",
+        "output-compression-threads", "min-active-clipped-read-length",
+        "min-difference-scored-haplotype-length"
     };
     const std::vector<std::string> strictly_positive_int_options {
-        "max-open-read-files", "downsample-above", "downsample-target", "min-supporting-reads",
+        "max-open-read-files", "downsample-above", "downsample-target", "max-streamed-coverage", "min-supporting-reads",
         "max-assembly-region-size", "fallback-kmer-gap", "organism-ploidy",
         "max-haplotypes", "haplotype-holdout-threshold", "haplotype-overflow",
         "max-genotypes", "max-genotype-combinations", "max-somatic-haplotypes", "max-clones",
-        "max-vb-seeds", "max-indel-errors", "max-base-quality", "max-phylogeny-size"
+        "max-vb-seeds", "max-indel-errors", "max-base-quality", "max-phylogeny-size", "make-shards",
+        "pair-hmm-gpu-min-batch-size", "progress-report-interval", "data-profile-sample-size",
+        "task-time-budget"
     };
     const std::vector<std::string> probability_options {
         "snp-heterozygosity", "snp-heterozygosity-stdev", "indel-heterozygosity",
         "somatic-snv-prior", "somatic-indel-prior", "min-expected-somatic-frequency", "min-credible-somatic-frequency", "somatic-credible-mass",
         "denovo-snv-prior", "denovo-indel-prior", "min-candidate-credible-vaf-probability",
-        "somatic-cnv-prior", "clone-prior"
+        "somatic-cnv-prior", "clone-prior", "min-kept-genotype-posterior"
     };
     conflicting_options(vm, "maternal-sample", "normal-sample");
     conflicting_options(vm, "paternal-sample", "normal-sample");
     conflicting_options(vm, "sites-only", "bamout");
     conflicting_options(vm, "sites-only", "data-profile");
+    conflicting_options(vm, "make-shards", "shard");
+    conflicting_options(vm, "make-shards", "merge-shards");
+    conflicting_options(vm, "shard", "merge-shards");
+    conflicting_options(vm, "shard", "regions");
+    conflicting_options(vm, "shard", "regions-file");
+    option_dependency(vm, "make-shards", "shard-manifest");
+    option_dependency(vm, "shard", "shard-manifest");
+    option_dependency(vm, "merge-shards", "shard-manifest");
+    option_dependency(vm, "numa", "threads");
+    option_dependency(vm, "resume", "threads");
+    option_dependency(vm, "task-report", "threads");
+    option_dependency(vm, "speculative-lookahead", "threads");
+    option_dependency(vm, "regenotype-likelihoods", "regenotype");
+    option_dependency(vm, "unevaluated-sites-output", "cohort-likelihoods");
+    option_dependency(vm, "task-prefetch-depth", "threads");
+    option_dependency(vm, "pair-hmm-gpu-min-batch-size", "pair-hmm-gpu");
+    option_dependency(vm, "data-profile-sample-size", "data-profile");
+    conflicting_options(vm, "resume", "make-shards");
+    conflicting_options(vm, "prescreen-regions", "source-candidates");
+    conflicting_options(vm, "prescreen-regions", "source-candidates-file");
+    conflicting_options(vm, "resume", "merge-shards");
+    option_dependency(vm, "secondary-caller", "secondary-output");
+    option_dependency(vm, "secondary-output", "secondary-caller");
+    conflicting_options(vm, "secondary-caller", "regenotype");
+    conflicting_options(vm, "secondary-caller", "resume");
+    conflicting_options(vm, "secondary-caller", "make-shards");
+    conflicting_options(vm, "secondary-caller", "shard");
+    conflicting_options(vm, "secondary-caller", "merge-shards");
     for (const auto& option : positive_int_options) {
         check_positive(option, vm);
     }
@@ -1197,10 +1451,12 @@ void validate(const OptionMap& vm)
     for (const auto& option : probability_options) {
         check_probability(option, vm);
     }
-    check_reads_present(vm);
+    if (require_reads) check_reads_present(vm);
     check_region_files_consistent(vm);
     check_trio_consistent(vm);
+    check_compact_likelihood_bits(vm);
     validate_caller(vm);
+    validate_caller(vm, "secondary-caller");
 }
 
 std::istream& operator>>(std::istream& in, ContigPloidy& plodies)
@@ -1655,6 +1911,51 @@ std::ostream& operator<<(std::ostream& out, const SamTag& tag)
     return out;
 }
 
+std::istream& operator>>(std::istream& in, PairHMMInstructionSet& result)
+{
+    std::string token;
+    in >> token;
+    if (token == "AUTO")
+        result = PairHMMInstructionSet::automatic;
+    else if (token == "SSE2")
+        result = PairHMMInstructionSet::sse2;
+    else if (token == "AVX2")
+        result = PairHMMInstructionSet::avx2;
+    else if (token == "AVX512")
+        result = PairHMMInstructionSet::avx512;
+    else if (token == "NEON")
+        result = PairHMMInstructionSet::neon;
+    else if (token == "SVE")
+        result = PairHMMInstructionSet::sve;
+    else throw po::validation_error {po::validation_error::kind_t::invalid_option_value, token, "pair-hmm-isa"};
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, const PairHMMInstructionSet& instruction_set)
+{
+    switch (instruction_set) {
+        case PairHMMInstructionSet::automatic:
+            out << "AUTO";
+            break;
+        case PairHMMInstructionSet::sse2:
+            out << "SSE2";
+            break;
+        case PairHMMInstructionSet::avx2:
+            out << "AVX2";
+            break;
+        case PairHMMInstructionSet::avx512:
+            out << "AVX512";
+            break;
+        case PairHMMInstructionSet::neon:
+            out << "NEON";
+            break;
+        case PairHMMInstructionSet::sve:
+            out << "SVE";
+            break;
+    }
+    return out;
+}
+
 namespace {
 
 template <typename T>
@@ -1785,6 +2086,8 @@ std::ostream& operator<<(std::ostream& os, const OptionMap& options)
             os << options[label].as<SamTag>();
         } else if (is_vector_type<SamTag>(value)) {
             write_vector<SamTag>(options, label, os, bullet);
+        } else if (is_type<PairHMMInstructionSet>(value)) {
+            os << options[label].as<PairHMMInstructionSet>();
         } else {
             os << "UnknownType(" << ((boost::any)value.value()).type().name() << ")";
         }
@@ -14,7 +14,8 @@ namespace octopus { namespace options {
 
 using OptionMap = boost::program_options::variables_map;
 
-OptionMap parse_options(int argc, const char** argv);
+// If require_reads is false then input reads need not be given (e.g. for commands that only use the reference)
+OptionMap parse_options(int argc, const char** argv, bool require_reads = true);
 
 enum class ContigOutputOrder
 {
@@ -42,6 +43,7 @@ enum class RealignedBAMType { full, mini };
 enum class ReadDeduplicationDetectionPolicy { relaxed, aggressive };
 enum class ModelPosteriorPolicy { all, off, special };
 enum class PhasingPolicy { conservative, aggressive, automatic };
+enum class PairHMMInstructionSet { automatic, sse2, avx2, avx512, neon, sve };
 
 struct SampleDropoutConcentrationPair
 {
@@ -85,6 +87,8 @@ std::istream& operator>>(std::istream& in, PhasingPolicy& policy);
 std::ostream& operator<<(std::ostream& os, const PhasingPolicy& policy);
 std::istream& operator>>(std::istream& in, SamTag& policy);
 std::ostream& operator<<(std::ostream& os, const SamTag& policy);
+std::istream& operator>>(std::istream& in, PairHMMInstructionSet& instruction_set);
+std::ostream& operator<<(std::ostream& os, const PairHMMInstructionSet& instruction_set);
 
 std::ostream& operator<<(std::ostream& os, const OptionMap& options);
 std::string to_string(const OptionMap& options, bool one_line = false, bool mark_modified = true);
@@ -25,12 +25,17 @@ namespace octopus {
 /*
  MappableFlatSet is a container designed to allow fast retrieval of MappableType elements with minimal
  memory overhead.
+ 
+ The elements are stored in a std::deque by default. Sets that are built once and then only read should
+ use MappableFlatVectorSet, whose contiguous storage is faster to scan.
  */
-template <typename MappableType, typename Allocator = std::allocator<MappableType>>
-class MappableFlatSet : public Comparable<MappableFlatSet<MappableType, Allocator>>
+template <typename MappableType,
+          typename Allocator = std::allocator<MappableType>,
+          typename Container = std::deque<MappableType, Allocator>>
+class MappableFlatSet : public Comparable<MappableFlatSet<MappableType, Allocator, Container>>
 {
 protected:
-    using base_t = std::deque<MappableType, Allocator>;
+    using base_t = Container;
     
 public:
     using allocator_type  = typename base_t::allocator_type;
@@ -155,12 +160,12 @@ public:
     template <typename MappableType_>
     void erase_contained(const MappableType_& mappable);
     
-    template <typename M, typename A>
-    friend bool operator==(const MappableFlatSet<M, A>& lhs, const MappableFlatSet<M, A>& rhs);
-    template <typename M, typename A>
-    friend bool operator<(const MappableFlatSet<M, A>& lhs, const MappableFlatSet<M, A>& rhs);
-    template <typename M, typename A>
-    friend void swap(MappableFlatSet<M, A>& lhs, MappableFlatSet<M, A>& rhs) noexcept;
+    template <typename M, typename A, typename C>
+    friend bool operator==(const MappableFlatSet<M, A, C>& lhs, const MappableFlatSet<M, A, C>& rhs);
+    template <typename M, typename A, typename C>
+    friend bool operator<(const MappableFlatSet<M, A, C>& lhs, const MappableFlatSet<M, A, C>& rhs);
+    template <typename M, typename A, typename C>
+    friend void swap(MappableFlatSet<M, A, C>& lhs, MappableFlatSet<M, A, C>& rhs) noexcept;
     
 private:
     base_t elements_;
@@ -168,16 +173,16 @@ private:
     typename RegionType<MappableType>::Position max_element_size_;
 };
 
-template <typename MappableType, typename Allocator>
-MappableFlatSet<MappableType, Allocator>::MappableFlatSet()
+template <typename MappableType, typename Allocator, typename Container>
+MappableFlatSet<MappableType, Allocator, Container>::MappableFlatSet()
 : elements_ {}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {0}
 {}
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename InputIterator>
-MappableFlatSet<MappableType, Allocator>::MappableFlatSet(InputIterator first, InputIterator second)
+MappableFlatSet<MappableType, Allocator, Container>::MappableFlatSet(InputIterator first, InputIterator second)
 : elements_ {first, second}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {0}
@@ -189,9 +194,9 @@ MappableFlatSet<MappableType, Allocator>::MappableFlatSet(InputIterator first, I
     max_element_size_ = region_size(*largest_mappable(elements_));
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename InputIterator>
-MappableFlatSet<MappableType, Allocator>::MappableFlatSet(ForwardSortedTag, InputIterator first, InputIterator second)
+MappableFlatSet<MappableType, Allocator, Container>::MappableFlatSet(ForwardSortedTag, InputIterator first, InputIterator second)
 : elements_ {first, second}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {0}
@@ -202,9 +207,9 @@ MappableFlatSet<MappableType, Allocator>::MappableFlatSet(ForwardSortedTag, Inpu
     max_element_size_ = region_size(*largest_mappable(elements_));
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename InputIterator>
-MappableFlatSet<MappableType, Allocator>::MappableFlatSet(BidirectionallySortedTag, InputIterator first, InputIterator second)
+MappableFlatSet<MappableType, Allocator, Container>::MappableFlatSet(BidirectionallySortedTag, InputIterator first, InputIterator second)
 : elements_ {first, second}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {0}
@@ -214,8 +219,8 @@ MappableFlatSet<MappableType, Allocator>::MappableFlatSet(BidirectionallySortedT
     max_element_size_ = region_size(*largest_mappable(elements_));
 }
 
-template <typename MappableType, typename Allocator>
-MappableFlatSet<MappableType, Allocator>::MappableFlatSet(std::initializer_list<MappableType> mappables)
+template <typename MappableType, typename Allocator, typename Container>
+MappableFlatSet<MappableType, Allocator, Container>::MappableFlatSet(std::initializer_list<MappableType> mappables)
 :
 elements_ {mappables},
 is_bidirectionally_sorted_ {true},
@@ -228,93 +233,93 @@ max_element_size_ {0}
     max_element_size_ = region_size(*largest_mappable(elements_));
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::iterator
-MappableFlatSet<MappableType, Allocator>::begin() noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::iterator
+MappableFlatSet<MappableType, Allocator, Container>::begin() noexcept
 {
     return elements_.begin();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_iterator
-MappableFlatSet<MappableType, Allocator>::begin() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_iterator
+MappableFlatSet<MappableType, Allocator, Container>::begin() const noexcept
 {
     return elements_.begin();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_iterator
-MappableFlatSet<MappableType, Allocator>::cbegin() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_iterator
+MappableFlatSet<MappableType, Allocator, Container>::cbegin() const noexcept
 {
     return elements_.cbegin();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::iterator
-MappableFlatSet<MappableType, Allocator>::end() noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::iterator
+MappableFlatSet<MappableType, Allocator, Container>::end() noexcept
 {
     return elements_.end();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_iterator
-MappableFlatSet<MappableType, Allocator>::end() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_iterator
+MappableFlatSet<MappableType, Allocator, Container>::end() const noexcept
 {
     return elements_.end();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_iterator
-MappableFlatSet<MappableType, Allocator>::cend() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_iterator
+MappableFlatSet<MappableType, Allocator, Container>::cend() const noexcept
 {
     return elements_.cend();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::reverse_iterator
-MappableFlatSet<MappableType, Allocator>::rbegin() noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::reverse_iterator
+MappableFlatSet<MappableType, Allocator, Container>::rbegin() noexcept
 {
     return elements_.rbegin();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_reverse_iterator
-MappableFlatSet<MappableType, Allocator>::rbegin() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_reverse_iterator
+MappableFlatSet<MappableType, Allocator, Container>::rbegin() const noexcept
 {
     return elements_.rbegin();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_reverse_iterator
-MappableFlatSet<MappableType, Allocator>::crbegin() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_reverse_iterator
+MappableFlatSet<MappableType, Allocator, Container>::crbegin() const noexcept
 {
     return elements_.crbegin();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::reverse_iterator
-MappableFlatSet<MappableType, Allocator>::rend() noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::reverse_iterator
+MappableFlatSet<MappableType, Allocator, Container>::rend() noexcept
 {
     return elements_.rend();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_reverse_iterator
-MappableFlatSet<MappableType, Allocator>::rend() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_reverse_iterator
+MappableFlatSet<MappableType, Allocator, Container>::rend() const noexcept
 {
     return elements_.rend();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_reverse_iterator
-MappableFlatSet<MappableType, Allocator>::crend() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_reverse_iterator
+MappableFlatSet<MappableType, Allocator, Container>::crend() const noexcept
 {
     return elements_.crend();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::reference
-MappableFlatSet<MappableType, Allocator>::at(size_type pos)
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::reference
+MappableFlatSet<MappableType, Allocator, Container>::at(size_type pos)
 {
     if (pos < size()) {
         return *std::next(begin(), pos);
@@ -323,9 +328,9 @@ MappableFlatSet<MappableType, Allocator>::at(size_type pos)
     }
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_reference
-MappableFlatSet<MappableType, Allocator>::at(size_type pos) const
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_reference
+MappableFlatSet<MappableType, Allocator, Container>::at(size_type pos) const
 {
     if (pos < size()) {
         return *std::next(cbegin(), pos);
@@ -334,52 +339,52 @@ MappableFlatSet<MappableType, Allocator>::at(size_type pos) const
     }
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::reference
-MappableFlatSet<MappableType, Allocator>::operator[](size_type pos)
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::reference
+MappableFlatSet<MappableType, Allocator, Container>::operator[](size_type pos)
 {
     return *std::next(begin(), pos);
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_reference
-MappableFlatSet<MappableType, Allocator>::operator[](size_type pos) const
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_reference
+MappableFlatSet<MappableType, Allocator, Container>::operator[](size_type pos) const
 {
     return *std::next(cbegin(), pos);
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::reference
-MappableFlatSet<MappableType, Allocator>::front()
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::reference
+MappableFlatSet<MappableType, Allocator, Container>::front()
 {
     return *begin();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_reference
-MappableFlatSet<MappableType, Allocator>::front() const
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_reference
+MappableFlatSet<MappableType, Allocator, Container>::front() const
 {
     return *cbegin();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::reference
-MappableFlatSet<MappableType, Allocator>::back()
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::reference
+MappableFlatSet<MappableType, Allocator, Container>::back()
 {
     return *std::prev(end());
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_reference
-MappableFlatSet<MappableType, Allocator>::back() const
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_reference
+MappableFlatSet<MappableType, Allocator, Container>::back() const
 {
     return *std::prev(cend());
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename ...Args>
-std::pair<typename MappableFlatSet<MappableType, Allocator>::iterator, bool>
-MappableFlatSet<MappableType, Allocator>::emplace(Args... args)
+std::pair<typename MappableFlatSet<MappableType, Allocator, Container>::iterator, bool>
+MappableFlatSet<MappableType, Allocator, Container>::emplace(Args... args)
 {
     elements_.emplace_back(std::forward<Args>(args)...);
     const auto it = std::lower_bound(std::begin(elements_), std::prev(std::end(elements_)),
@@ -398,9 +403,9 @@ MappableFlatSet<MappableType, Allocator>::emplace(Args... args)
     return std::make_pair(it, true);
 }
 
-template <typename MappableType, typename Allocator>
-std::pair<typename MappableFlatSet<MappableType, Allocator>::iterator, bool>
-MappableFlatSet<MappableType, Allocator>::insert(const MappableType& m)
+template <typename MappableType, typename Allocator, typename Container>
+std::pair<typename MappableFlatSet<MappableType, Allocator, Container>::iterator, bool>
+MappableFlatSet<MappableType, Allocator, Container>::insert(const MappableType& m)
 {
     auto it = std::lower_bound(std::begin(elements_), std::end(elements_), m);
     if (it == std::end(elements_) || *it != m) {
@@ -416,9 +421,9 @@ MappableFlatSet<MappableType, Allocator>::insert(const MappableType& m)
     return std::make_pair(it, true);
 }
 
-template <typename MappableType, typename Allocator>
-std::pair<typename MappableFlatSet<MappableType, Allocator>::iterator, bool>
-MappableFlatSet<MappableType, Allocator>::insert(MappableType&& m)
+template <typename MappableType, typename Allocator, typename Container>
+std::pair<typename MappableFlatSet<MappableType, Allocator, Container>::iterator, bool>
+MappableFlatSet<MappableType, Allocator, Container>::insert(MappableType&& m)
 {
     auto it = std::lower_bound(std::begin(elements_), std::end(elements_), m);
     if (it == std::end(elements_) || *it != m) {
@@ -434,12 +439,12 @@ MappableFlatSet<MappableType, Allocator>::insert(MappableType&& m)
     return std::make_pair(it, true);
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::iterator
-MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, const MappableType& m)
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::iterator
+MappableFlatSet<MappableType, Allocator, Container>::insert(const_iterator hint, const MappableType& m)
 {
     // hint is a hint pointing to where the insert should start to search.
-    typename MappableFlatSet<MappableType, Allocator>::iterator result;
+    typename MappableFlatSet<MappableType, Allocator, Container>::iterator result;
     if (hint != std::cend(elements_)) {
         if (hint != std::cbegin(elements_)) {
             const auto& prev_hint_element = *std::prev(hint);
@@ -463,8 +468,7 @@ MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, const Mapp
                 return insert(m).first; // hint is bad
             }
         } else if (*hint > m) {
-            elements_.push_front(m);
-            result = std::begin(elements_);
+            result = elements_.insert(std::begin(elements_), m);
         } else if (*hint == m) {
             return remove_constness(elements_, hint);
         } else {
@@ -473,7 +477,7 @@ MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, const Mapp
     } else {
         if (empty() || elements_.back() < m) {
             elements_.push_back(m);
-            result = std::begin(elements_);
+            result = std::prev(std::end(elements_));
         } else {
             return insert(m).first; // bad hint
         }
@@ -487,11 +491,11 @@ MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, const Mapp
     return result;
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::iterator
-MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, MappableType&& m)
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::iterator
+MappableFlatSet<MappableType, Allocator, Container>::insert(const_iterator hint, MappableType&& m)
 {
-    typename MappableFlatSet<MappableType, Allocator>::iterator result;
+    typename MappableFlatSet<MappableType, Allocator, Container>::iterator result;
     if (hint != std::cend(elements_)) {
         if (hint != std::cbegin(elements_)) {
             const auto& prev_hint_element = *std::prev(hint);
@@ -515,8 +519,7 @@ MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, MappableTy
                 return insert(std::move(m)).first; // hint is bad
             }
         } else if (*hint > m) {
-            elements_.push_front(std::move(m));
-            result = std::begin(elements_);
+            result = elements_.insert(std::begin(elements_), std::move(m));
         } else if (*hint == m) {
             return remove_constness(elements_, hint);
         } else {
@@ -525,7 +528,7 @@ MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, MappableTy
     } else {
         if (empty() || elements_.back() < m) {
             elements_.push_back(std::move(m));
-            result = std::begin(elements_);
+            result = std::prev(std::end(elements_));
         } else {
             return insert(std::move(m)).first; // bad hint
         }
@@ -539,39 +542,38 @@ MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, MappableTy
     return result;
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename InputIterator>
-void MappableFlatSet<MappableType, Allocator>::insert(InputIterator first, InputIterator last)
+void MappableFlatSet<MappableType, Allocator, Container>::insert(InputIterator first, InputIterator last)
 {
     if (first == last) return;
-    max_element_size_ = std::max(max_element_size_, region_size(*largest_mappable(first, last)));
-    for (auto it1 = first; it1 != last; ) {
-        const auto it2 = std::is_sorted_until(it1, last);
-        auto ub = std::upper_bound(std::begin(elements_), std::end(elements_), *std::prev(it2));
-        const auto d = std::distance(it1, it2);
-        const auto it3 = elements_.insert(ub, it1, it2);
-        // ub is now invalidated
-        const auto lb = std::lower_bound(std::begin(elements_), it3, *it3);
-        ub = std::next(it3, d);
-        std::inplace_merge(lb, it3, ub);
-        elements_.erase(std::unique(lb, ub), ub);
-        it1 = it2;
+    // Append everything, then sort and merge once, rather than inserting each sorted run in turn
+    const auto num_old_elements = elements_.size();
+    elements_.insert(std::end(elements_), first, last);
+    const auto old_last = std::next(std::begin(elements_), num_old_elements);
+    max_element_size_ = std::max(max_element_size_, region_size(*largest_mappable(old_last, std::end(elements_))));
+    if (!std::is_sorted(old_last, std::end(elements_))) {
+        std::sort(old_last, std::end(elements_));
+    }
+    if (num_old_elements > 0 && *old_last < *std::prev(old_last)) {
+        std::inplace_merge(std::begin(elements_), old_last, std::end(elements_));
     }
+    elements_.erase(std::unique(std::begin(elements_), std::end(elements_)), std::end(elements_));
     if (is_bidirectionally_sorted_) {
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
     }
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::iterator
-MappableFlatSet<MappableType, Allocator>::insert(std::initializer_list<MappableType> il)
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::iterator
+MappableFlatSet<MappableType, Allocator, Container>::insert(std::initializer_list<MappableType> il)
 {
     return insert(std::begin(il), std::end(il));
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::iterator
-MappableFlatSet<MappableType, Allocator>::erase(const_iterator p)
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::iterator
+MappableFlatSet<MappableType, Allocator, Container>::erase(const_iterator p)
 {
     if (p == cend()) return elements_.erase(p);
     const auto erased_size = region_size(*p);
@@ -587,9 +589,9 @@ MappableFlatSet<MappableType, Allocator>::erase(const_iterator p)
     return result;
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::size_type
-MappableFlatSet<MappableType, Allocator>::erase(const MappableType& m)
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::size_type
+MappableFlatSet<MappableType, Allocator, Container>::erase(const MappableType& m)
 {
     const auto it = std::lower_bound(std::cbegin(elements_), std::cend(elements_), m);
     if (it != std::cend(elements_) && *it == m) {
@@ -608,9 +610,9 @@ MappableFlatSet<MappableType, Allocator>::erase(const MappableType& m)
     return 0;
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::iterator
-MappableFlatSet<MappableType, Allocator>::erase(const_iterator first, const_iterator last)
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::iterator
+MappableFlatSet<MappableType, Allocator, Container>::erase(const_iterator first, const_iterator last)
 {
     if (first == last) return elements_.erase(first, last);
     const auto max_erased_size = region_size(*largest_mappable(first, last));
@@ -637,10 +639,10 @@ BidirIt binary_find(BidirIt first, BidirIt last, const T& value)
 
 } // namespace detail
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename BidirIt>
-typename MappableFlatSet<MappableType, Allocator>::size_type
-MappableFlatSet<MappableType, Allocator>::erase_all(BidirIt first, const BidirIt last)
+typename MappableFlatSet<MappableType, Allocator, Container>::size_type
+MappableFlatSet<MappableType, Allocator, Container>::erase_all(BidirIt first, const BidirIt last)
 {
     using ItrValueType = typename std::iterator_traits<BidirIt>::value_type;
     static_assert(std::is_same<ItrValueType, MappableType>::value, "Cannot erase different type");
@@ -690,74 +692,74 @@ MappableFlatSet<MappableType, Allocator>::erase_all(BidirIt first, const BidirIt
     return num_erased;
 }
 
-template <typename MappableType, typename Allocator>
-void MappableFlatSet<MappableType, Allocator>::clear()
+template <typename MappableType, typename Allocator, typename Container>
+void MappableFlatSet<MappableType, Allocator, Container>::clear()
 {
     elements_.clear();
     is_bidirectionally_sorted_ = true;
     max_element_size_ = 0;
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::size_type
-MappableFlatSet<MappableType, Allocator>::size() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::size_type
+MappableFlatSet<MappableType, Allocator, Container>::size() const noexcept
 {
     return elements_.size();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::size_type
-MappableFlatSet<MappableType, Allocator>::max_size() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::size_type
+MappableFlatSet<MappableType, Allocator, Container>::max_size() const noexcept
 {
     return elements_.max_size();
 }
 
-template <typename MappableType, typename Allocator>
-bool MappableFlatSet<MappableType, Allocator>::empty() const noexcept
+template <typename MappableType, typename Allocator, typename Container>
+bool MappableFlatSet<MappableType, Allocator, Container>::empty() const noexcept
 {
     return elements_.empty();
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 void
-MappableFlatSet<MappableType, Allocator>::shrink_to_fit()
+MappableFlatSet<MappableType, Allocator, Container>::shrink_to_fit()
 {
     elements_.shrink_to_fit();
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::iterator
-MappableFlatSet<MappableType, Allocator>::find(const MappableType& m)
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::iterator
+MappableFlatSet<MappableType, Allocator, Container>::find(const MappableType& m)
 {
     const auto it = std::lower_bound(std::begin(elements_), std::end(elements_), m);
     if (it == std::end(elements_) || !(*it == m)) return std::end(elements_);
     return it;
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::const_iterator
-MappableFlatSet<MappableType, Allocator>::find(const MappableType& m) const
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::const_iterator
+MappableFlatSet<MappableType, Allocator, Container>::find(const MappableType& m) const
 {
     const auto it = std::lower_bound(std::cbegin(elements_), std::cend(elements_), m);
     if (it == std::cend(elements_) || !(*it == m)) return std::cend(elements_);
     return it;
 }
 
-template <typename MappableType, typename Allocator>
-typename MappableFlatSet<MappableType, Allocator>::size_type
-MappableFlatSet<MappableType, Allocator>::count(const MappableType& m) const
+template <typename MappableType, typename Allocator, typename Container>
+typename MappableFlatSet<MappableType, Allocator, Container>::size_type
+MappableFlatSet<MappableType, Allocator, Container>::count(const MappableType& m) const
 {
     return std::binary_search(std::cbegin(elements_), std::cend(elements_), m);
 }
 
-template <typename MappableType, typename Allocator>
-const MappableType& MappableFlatSet<MappableType, Allocator>::leftmost() const
+template <typename MappableType, typename Allocator, typename Container>
+const MappableType& MappableFlatSet<MappableType, Allocator, Container>::leftmost() const
 {
     return front();
 }
 
-template <typename MappableType, typename Allocator>
-const MappableType& MappableFlatSet<MappableType, Allocator>::rightmost() const
+template <typename MappableType, typename Allocator, typename Container>
+const MappableType& MappableFlatSet<MappableType, Allocator, Container>::rightmost() const
 {
     const auto& last = *std::prev(std::cend(elements_));
     if (is_bidirectionally_sorted_) {
@@ -770,10 +772,10 @@ const MappableType& MappableFlatSet<MappableType, Allocator>::rightmost() const
     }
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
 bool
-MappableFlatSet<MappableType, Allocator>::has_overlapped(const MappableType_& mappable) const
+MappableFlatSet<MappableType, Allocator, Container>::has_overlapped(const MappableType_& mappable) const
 {
     using octopus::has_overlapped;
     if (is_bidirectionally_sorted_) {
@@ -782,10 +784,10 @@ MappableFlatSet<MappableType, Allocator>::has_overlapped(const MappableType_& ma
     return has_overlapped(std::cbegin(elements_), std::cend(elements_), mappable);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
 bool
-MappableFlatSet<MappableType, Allocator>::has_overlapped(const_iterator first, const_iterator last,
+MappableFlatSet<MappableType, Allocator, Container>::has_overlapped(const_iterator first, const_iterator last,
                                                          const MappableType_& mappable) const
 {
     using octopus::has_overlapped;
@@ -795,18 +797,18 @@ MappableFlatSet<MappableType, Allocator>::has_overlapped(const_iterator first, c
     return has_overlapped(first, last, mappable, max_element_size_);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
-typename MappableFlatSet<MappableType, Allocator>::size_type
-MappableFlatSet<MappableType, Allocator>::count_overlapped(const MappableType_& mappable) const
+typename MappableFlatSet<MappableType, Allocator, Container>::size_type
+MappableFlatSet<MappableType, Allocator, Container>::count_overlapped(const MappableType_& mappable) const
 {
     return count_overlapped(std::cbegin(elements_), std::cend(elements_), mappable);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
-typename MappableFlatSet<MappableType, Allocator>::size_type
-MappableFlatSet<MappableType, Allocator>::count_overlapped(const_iterator first, const_iterator last,
+typename MappableFlatSet<MappableType, Allocator, Container>::size_type
+MappableFlatSet<MappableType, Allocator, Container>::count_overlapped(const_iterator first, const_iterator last,
                                                            const MappableType_& mappable) const
 {
     using octopus::count_overlapped;
@@ -816,18 +818,18 @@ MappableFlatSet<MappableType, Allocator>::count_overlapped(const_iterator first,
     return count_overlapped(first, last, mappable, max_element_size_);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
-OverlapRange<typename MappableFlatSet<MappableType, Allocator>::const_iterator>
-MappableFlatSet<MappableType, Allocator>::overlap_range(const MappableType_& mappable) const
+OverlapRange<typename MappableFlatSet<MappableType, Allocator, Container>::const_iterator>
+MappableFlatSet<MappableType, Allocator, Container>::overlap_range(const MappableType_& mappable) const
 {
     return overlap_range(std::cbegin(elements_), std::cend(elements_), mappable);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
-OverlapRange<typename MappableFlatSet<MappableType, Allocator>::const_iterator>
-MappableFlatSet<MappableType, Allocator>::overlap_range(const_iterator first, const_iterator last,
+OverlapRange<typename MappableFlatSet<MappableType, Allocator, Container>::const_iterator>
+MappableFlatSet<MappableType, Allocator, Container>::overlap_range(const_iterator first, const_iterator last,
                                                         const MappableType_& mappable) const
 {
     using octopus::overlap_range;
@@ -837,9 +839,9 @@ MappableFlatSet<MappableType, Allocator>::overlap_range(const_iterator first, co
     return overlap_range(first, last, mappable, max_element_size_);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
-void MappableFlatSet<MappableType, Allocator>::erase_overlapped(const MappableType_& mappable)
+void MappableFlatSet<MappableType, Allocator, Container>::erase_overlapped(const MappableType_& mappable)
 {
     const auto overlapped = overlap_range(mappable);
     using octopus::size;
@@ -853,36 +855,36 @@ void MappableFlatSet<MappableType, Allocator>::erase_overlapped(const MappableTy
     }
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
 bool
-MappableFlatSet<MappableType, Allocator>::has_contained(const MappableType_& mappable) const
+MappableFlatSet<MappableType, Allocator, Container>::has_contained(const MappableType_& mappable) const
 {
     return has_contained(std::cbegin(elements_), std::cend(elements_), mappable);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
 bool
-MappableFlatSet<MappableType, Allocator>::has_contained(const_iterator first, const_iterator last,
+MappableFlatSet<MappableType, Allocator, Container>::has_contained(const_iterator first, const_iterator last,
                                                         const MappableType_& mappable) const
 {
     using octopus::has_contained;
     return has_contained(first, last, mappable);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
-typename MappableFlatSet<MappableType, Allocator>::size_type
-MappableFlatSet<MappableType, Allocator>::count_contained(const MappableType_& mappable) const
+typename MappableFlatSet<MappableType, Allocator, Container>::size_type
+MappableFlatSet<MappableType, Allocator, Container>::count_contained(const MappableType_& mappable) const
 {
     return count_contained(std::cbegin(elements_), std::cend(elements_), mappable);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
-typename MappableFlatSet<MappableType, Allocator>::size_type
-MappableFlatSet<MappableType, Allocator>::count_contained(const_iterator first, const_iterator last,
+typename MappableFlatSet<MappableType, Allocator, Container>::size_type
+MappableFlatSet<MappableType, Allocator, Container>::count_contained(const_iterator first, const_iterator last,
                                                           const MappableType_& mappable) const
 {
     using octopus::count_contained;
@@ -892,27 +894,27 @@ MappableFlatSet<MappableType, Allocator>::count_contained(const_iterator first,
     return count_contained(first, last, mappable);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
-ContainedRange<typename MappableFlatSet<MappableType, Allocator>::const_iterator>
-MappableFlatSet<MappableType, Allocator>::contained_range(const MappableType_& mappable) const
+ContainedRange<typename MappableFlatSet<MappableType, Allocator, Container>::const_iterator>
+MappableFlatSet<MappableType, Allocator, Container>::contained_range(const MappableType_& mappable) const
 {
     return contained_range(std::cbegin(elements_), std::cend(elements_), mappable);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
-ContainedRange<typename MappableFlatSet<MappableType, Allocator>::const_iterator>
-MappableFlatSet<MappableType, Allocator>::contained_range(const_iterator first, const_iterator last,
+ContainedRange<typename MappableFlatSet<MappableType, Allocator, Container>::const_iterator>
+MappableFlatSet<MappableType, Allocator, Container>::contained_range(const_iterator first, const_iterator last,
                                                           const MappableType_& mappable) const
 {
     using octopus::contained_range;
     return contained_range(first, last, mappable);
 }
 
-template <typename MappableType, typename Allocator>
+template <typename MappableType, typename Allocator, typename Container>
 template <typename MappableType_>
-void MappableFlatSet<MappableType, Allocator>::erase_contained(const MappableType_& mappable)
+void MappableFlatSet<MappableType, Allocator, Container>::erase_contained(const MappableType_& mappable)
 {
     const auto contained = contained_range(mappable);
     using octopus::size;
@@ -928,23 +930,23 @@ void MappableFlatSet<MappableType, Allocator>::erase_contained(const MappableTyp
 
 // non-member methods
 
-template <typename MappableType, typename Allocator>
-bool operator==(const MappableFlatSet<MappableType, Allocator>& lhs,
-                const MappableFlatSet<MappableType, Allocator>& rhs)
+template <typename MappableType, typename Allocator, typename Container>
+bool operator==(const MappableFlatSet<MappableType, Allocator, Container>& lhs,
+                const MappableFlatSet<MappableType, Allocator, Container>& rhs)
 {
     return lhs.elements_ == rhs.elements_;
 }
 
-template <typename MappableType, typename Allocator>
-bool operator<(const MappableFlatSet<MappableType, Allocator>& lhs,
-               const MappableFlatSet<MappableType, Allocator>& rhs)
+template <typename MappableType, typename Allocator, typename Container>
+bool operator<(const MappableFlatSet<MappableType, Allocator, Container>& lhs,
+               const MappableFlatSet<MappableType, Allocator, Container>& rhs)
 {
     return lhs.elements_ < rhs.elements_;
 }
 
-template <typename MappableType, typename Allocator>
-void swap(MappableFlatSet<MappableType, Allocator>& lhs,
-          MappableFlatSet<MappableType, Allocator>& rhs) noexcept
+template <typename MappableType, typename Allocator, typename Container>
+void swap(MappableFlatSet<MappableType, Allocator, Container>& lhs,
+          MappableFlatSet<MappableType, Allocator, Container>& rhs) noexcept
 {
     using std::swap;
     swap(lhs.elements_, rhs.elements_);
@@ -952,6 +954,9 @@ void swap(MappableFlatSet<MappableType, Allocator>& lhs,
     swap(lhs.max_element_size_, rhs.max_element_size_);
 }
 
+template <typename MappableType, typename Allocator = std::allocator<MappableType>>
+using MappableFlatVectorSet = MappableFlatSet<MappableType, Allocator, std::vector<MappableType, Allocator>>;
+
 } // namespace octopus
 
 #endif
@@ -0,0 +1,419 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef mappable_interval_tree_hpp
+#define mappable_interval_tree_hpp
+
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include <cassert>
+
+#include "concepts/mappable.hpp"
+#include "concepts/mappable_range.hpp"
+#include "utils/mappable_algorithms.hpp"
+
+namespace octopus {
+
+/*
+ MappableIntervalIndex is an implicit augmented interval tree (as in cgranges) over a ForwardSorted
+ random access range of mappables on a single contig. Node i of the tree is element i of the range; its
+ level is the number of trailing one bits of i, and it stores the maximum end position of its subtree.
+
+ Unlike the max-element-size bound used by MappableFlatSet, the cost of a query does not depend on the
+ largest element in the range, so a few long reads or deletions do not slow down queries elsewhere.
+
+ The index does not own the elements and must be rebuilt if the range is modified.
+ */
+template <typename MappableType>
+class MappableIntervalIndex
+{
+public:
+    using Position  = typename RegionType<MappableType>::Position;
+    using size_type = std::size_t;
+
+    MappableIntervalIndex() = default;
+
+    template <typename RandomIt>
+    MappableIntervalIndex(RandomIt first, RandomIt last);
+
+    MappableIntervalIndex(const MappableIntervalIndex&)            = default;
+    MappableIntervalIndex& operator=(const MappableIntervalIndex&) = default;
+    MappableIntervalIndex(MappableIntervalIndex&&)                 = default;
+    MappableIntervalIndex& operator=(MappableIntervalIndex&&)      = default;
+
+    ~MappableIntervalIndex() = default;
+
+    template <typename RandomIt>
+    void rebuild(RandomIt first, RandomIt last);
+    void clear() noexcept;
+
+    size_type size() const noexcept;
+    bool empty() const noexcept;
+
+    // All query functions take the range the index was built from
+
+    template <typename RandomIt, typename MappableTp>
+    RandomIt find_first_overlapped(RandomIt first, RandomIt last, const MappableTp& mappable) const;
+
+    template <typename RandomIt, typename MappableTp>
+    bool has_overlapped(RandomIt first, RandomIt last, const MappableTp& mappable) const;
+
+    template <typename RandomIt, typename MappableTp>
+    size_type count_overlapped(RandomIt first, RandomIt last, const MappableTp& mappable) const;
+
+    template <typename RandomIt, typename MappableTp>
+    OverlapRange<RandomIt> overlap_range(RandomIt first, RandomIt last, const MappableTp& mappable) const;
+
+    // Calls f on each overlapped element in order, stopping early if f returns true
+    template <typename RandomIt, typename MappableTp, typename Visitor>
+    void visit_overlapped(RandomIt first, RandomIt last, const MappableTp& mappable, Visitor f) const;
+
+private:
+    struct Node
+    {
+        Position begin, end, max_end;
+    };
+    
+    template <typename RandomIt, typename MappableTp, typename IndexVisitor>
+    void visit_overlapped_indices(RandomIt first, const MappableTp& mappable, IndexVisitor f) const;
+
+    std::vector<Node> nodes_;
+    int max_level_ = -1;
+
+    // Subtrees at or below this level are scanned linearly
+    static constexpr int linear_scan_level_ = 3;
+};
+
+template <typename MappableType>
+template <typename RandomIt>
+MappableIntervalIndex<MappableType>::MappableIntervalIndex(RandomIt first, RandomIt last)
+{
+    rebuild(first, last);
+}
+
+template <typename MappableType>
+template <typename RandomIt>
+void MappableIntervalIndex<MappableType>::rebuild(RandomIt first, RandomIt last)
+{
+    assert(std::is_sorted(first, last));
+    nodes_.clear();
+    nodes_.reserve(std::distance(first, last));
+    std::transform(first, last, std::back_inserter(nodes_), [] (const auto& mappable) {
+        return Node {mapped_begin(mappable), mapped_end(mappable), mapped_end(mappable)};
+    });
+    const auto n = nodes_.size();
+    max_level_ = -1;
+    if (n == 0) return;
+    size_type last_i {0};
+    for (size_type i {0}; i < n; i += 2) last_i = i;
+    Position last_max {nodes_[last_i].max_end};
+    int k {1};
+    for (; (size_type {1} << k) <= n; ++k) {
+        const size_type x {size_type {1} << (k - 1)}, i0 {(x << 1) - 1}, step {x << 2};
+        for (auto i = i0; i < n; i += step) {
+            const auto left_max = nodes_[i - x].max_end;
+            const auto right_max = i + x < n ? nodes_[i + x].max_end : last_max;
+            nodes_[i].max_end = std::max({nodes_[i].end, left_max, right_max});
+        }
+        last_i = (last_i >> k & 1) ? last_i - x : last_i + x;
+        if (last_i < n) last_max = std::max(last_max, nodes_[last_i].max_end);
+    }
+    max_level_ = k - 1;
+}
+
+template <typename MappableType>
+void MappableIntervalIndex<MappableType>::clear() noexcept
+{
+    nodes_.clear();
+    max_level_ = -1;
+}
+
+template <typename MappableType>
+typename MappableIntervalIndex<MappableType>::size_type
+MappableIntervalIndex<MappableType>::size() const noexcept
+{
+    return nodes_.size();
+}
+
+template <typename MappableType>
+bool MappableIntervalIndex<MappableType>::empty() const noexcept
+{
+    return nodes_.empty();
+}
+
+template <typename MappableType>
+template <typename RandomIt, typename MappableTp, typename IndexVisitor>
+void
+MappableIntervalIndex<MappableType>::visit_overlapped_indices(RandomIt first, const MappableTp& mappable,
+                                                              IndexVisitor f) const
+{
+    if (nodes_.empty()) return;
+    // The tree only prunes on positions, which must be inclusive as empty regions overlap their boundaries;
+    // overlaps decides each candidate
+    const auto query_begin = mapped_begin(mappable), query_end = mapped_end(mappable);
+    const auto n = nodes_.size();
+    const auto may_overlap = [&] (size_type i) { return query_begin <= nodes_[i].end; };
+    const auto visit = [&] (size_type i) { return overlaps(first[i], mappable) && f(i); };
+    struct StackNode
+    {
+        size_type x;
+        int k;
+        bool left_done;
+    };
+    StackNode stack[64];
+    int t {0};
+    stack[t++] = {(size_type {1} << max_level_) - 1, max_level_, false};
+    while (t > 0) {
+        const auto z = stack[--t];
+        if (z.k <= linear_scan_level_) {
+            const auto i0 = z.x >> z.k << z.k;
+            const auto i1 = std::min(i0 + (size_type {1} << (z.k + 1)) - 1, n);
+            for (auto i = i0; i < i1 && nodes_[i].begin <= query_end; ++i) {
+                if (may_overlap(i) && visit(i)) return;
+            }
+        } else if (!z.left_done) {
+            const auto y = z.x - (size_type {1} << (z.k - 1));
+            stack[t++] = {z.x, z.k, true};
+            if (y >= n || nodes_[y].max_end >= query_begin) {
+                stack[t++] = {y, z.k - 1, false};
+            }
+        } else if (z.x < n && nodes_[z.x].begin <= query_end) {
+            if (may_overlap(z.x) && visit(z.x)) return;
+            stack[t++] = {z.x + (size_type {1} << (z.k - 1)), z.k - 1, false};
+        }
+    }
+}
+
+template <typename MappableType>
+template <typename RandomIt, typename MappableTp, typename Visitor>
+void
+MappableIntervalIndex<MappableType>::visit_overlapped(RandomIt first, RandomIt last, const MappableTp& mappable,
+                                                      Visitor f) const
+{
+    assert(static_cast<size_type>(std::distance(first, last)) == nodes_.size());
+    visit_overlapped_indices(first, mappable, [&] (size_type i) { return f(first[i]); });
+}
+
+template <typename MappableType>
+template <typename RandomIt, typename MappableTp>
+RandomIt
+MappableIntervalIndex<MappableType>::find_first_overlapped(RandomIt first, RandomIt last,
+                                                           const MappableTp& mappable) const
+{
+    assert(static_cast<size_type>(std::distance(first, last)) == nodes_.size());
+    auto result = last;
+    visit_overlapped_indices(first, mappable, [&] (size_type i) {
+        result = std::next(first, i);
+        return true;
+    });
+    return result;
+}
+
+template <typename MappableType>
+template <typename RandomIt, typename MappableTp>
+bool
+MappableIntervalIndex<MappableType>::has_overlapped(RandomIt first, RandomIt last, const MappableTp& mappable) const
+{
+    bool result {false};
+    visit_overlapped(first, last, mappable, [&] (const auto&) { return result = true; });
+    return result;
+}
+
+template <typename MappableType>
+template <typename RandomIt, typename MappableTp>
+typename MappableIntervalIndex<MappableType>::size_type
+MappableIntervalIndex<MappableType>::count_overlapped(RandomIt first, RandomIt last,
+                                                      const MappableTp& mappable) const
+{
+    size_type result {0};
+    visit_overlapped(first, last, mappable, [&] (const auto&) { ++result; return false; });
+    return result;
+}
+
+template <typename MappableType>
+template <typename RandomIt, typename MappableTp>
+OverlapRange<RandomIt>
+MappableIntervalIndex<MappableType>::overlap_range(RandomIt first, RandomIt last, const MappableTp& mappable) const
+{
+    // OverlapRange is contiguous, so it spans the first overlapped element up to the first element after
+    // mappable; the filter skips any non-overlapped elements in between
+    const auto first_overlapped = find_first_overlapped(first, last, mappable);
+    return make_overlap_range(first_overlapped, find_first_after(first_overlapped, last, mappable), mappable);
+}
+
+/*
+ MappableIntervalTree is a flat, ForwardSorted container of MappableType elements on a single contig that
+ is indexed with a MappableIntervalIndex. It is intended for containers that are built once and then
+ queried many times, as any modification rebuilds the index.
+ */
+template <typename MappableType, typename Allocator = std::allocator<MappableType>>
+class MappableIntervalTree
+{
+protected:
+    using base_t = std::vector<MappableType, Allocator>;
+
+public:
+    using allocator_type  = typename base_t::allocator_type;
+    using value_type      = typename base_t::value_type;
+    using reference       = typename base_t::reference;
+    using const_reference = typename base_t::const_reference;
+    using difference_type = typename base_t::difference_type;
+    using size_type       = typename base_t::size_type;
+
+    using iterator               = typename base_t::const_iterator;
+    using const_iterator         = typename base_t::const_iterator;
+    using reverse_iterator       = typename base_t::const_reverse_iterator;
+    using const_reverse_iterator = typename base_t::const_reverse_iterator;
+
+    MappableIntervalTree() = default;
+
+    template <typename InputIterator>
+    MappableIntervalTree(InputIterator first, InputIterator last);
+    template <typename InputIterator>
+    MappableIntervalTree(ForwardSortedTag, InputIterator first, InputIterator last);
+
+    MappableIntervalTree(base_t elements);
+
+    MappableIntervalTree(const MappableIntervalTree&)            = default;
+    MappableIntervalTree& operator=(const MappableIntervalTree&) = default;
+    MappableIntervalTree(MappableIntervalTree&&)                 = default;
+    MappableIntervalTree& operator=(MappableIntervalTree&&)      = default;
+
+    ~MappableIntervalTree() = default;
+
+    const_iterator begin() const noexcept { return elements_.cbegin(); }
+    const_iterator cbegin() const noexcept { return elements_.cbegin(); }
+    const_iterator end() const noexcept { return elements_.cend(); }
+    const_iterator cend() const noexcept { return elements_.cend(); }
+    const_reverse_iterator rbegin() const noexcept { return elements_.crbegin(); }
+    const_reverse_iterator crbegin() const noexcept { return elements_.crbegin(); }
+    const_reverse_iterator rend() const noexcept { return elements_.crend(); }
+    const_reverse_iterator crend() const noexcept { return elements_.crend(); }
+
+    const_reference at(size_type pos) const { return elements_.at(pos); }
+    const_reference operator[](size_type pos) const { return elements_[pos]; }
+    const_reference front() const { return elements_.front(); }
+    const_reference back() const { return elements_.back(); }
+
+    template <typename InputIterator>
+    void insert(InputIterator first, InputIterator last);
+
+    void clear() noexcept;
+
+    size_type size() const noexcept { return elements_.size(); }
+    bool empty() const noexcept { return elements_.empty(); }
+
+    const MappableType& leftmost() const;
+    const MappableType& rightmost() const;
+
+    template <typename MappableType_>
+    bool has_overlapped(const MappableType_& mappable) const;
+    template <typename MappableType_>
+    size_type count_overlapped(const MappableType_& mappable) const;
+    template <typename MappableType_>
+    OverlapRange<const_iterator> overlap_range(const MappableType_& mappable) const;
+
+    friend bool operator==(const MappableIntervalTree& lhs, const MappableIntervalTree& rhs)
+    {
+        return lhs.elements_ == rhs.elements_;
+    }
+    friend bool operator!=(const MappableIntervalTree& lhs, const MappableIntervalTree& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    base_t elements_;
+    MappableIntervalIndex<MappableType> index_;
+};
+
+template <typename MappableType, typename Allocator>
+template <typename InputIterator>
+MappableIntervalTree<MappableType, Allocator>::MappableIntervalTree(InputIterator first, InputIterator last)
+: elements_ {first, last}
+, index_ {}
+{
+    std::sort(std::begin(elements_), std::end(elements_));
+    index_.rebuild(std::cbegin(elements_), std::cend(elements_));
+}
+
+template <typename MappableType, typename Allocator>
+template <typename InputIterator>
+MappableIntervalTree<MappableType, Allocator>::MappableIntervalTree(ForwardSortedTag, InputIterator first,
+                                                                    InputIterator last)
+: elements_ {first, last}
+, index_ {std::cbegin(elements_), std::cend(elements_)}
+{}
+
+template <typename MappableType, typename Allocator>
+MappableIntervalTree<MappableType, Allocator>::MappableIntervalTree(base_t elements)
+: elements_ {std::move(elements)}
+, index_ {}
+{
+    if (!std::is_sorted(std::cbegin(elements_), std::cend(elements_))) {
+        std::sort(std::begin(elements_), std::end(elements_));
+    }
+    index_.rebuild(std::cbegin(elements_), std::cend(elements_));
+}
+
+template <typename MappableType, typename Allocator>
+template <typename InputIterator>
+void MappableIntervalTree<MappableType, Allocator>::insert(InputIterator first, InputIterator last)
+{
+    if (first == last) return;
+    const auto num_old_elements = elements_.size();
+    elements_.insert(std::end(elements_), first, last);
+    const auto old_last = std::next(std::begin(elements_), num_old_elements);
+    std::sort(old_last, std::end(elements_));
+    std::inplace_merge(std::begin(elements_), old_last, std::end(elements_));
+    index_.rebuild(std::cbegin(elements_), std::cend(elements_));
+}
+
+template <typename MappableType, typename Allocator>
+void MappableIntervalTree<MappableType, Allocator>::clear() noexcept
+{
+    elements_.clear();
+    index_.clear();
+}
+
+template <typename MappableType, typename Allocator>
+const MappableType& MappableIntervalTree<MappableType, Allocator>::leftmost() const
+{
+    return front();
+}
+
+template <typename MappableType, typename Allocator>
+const MappableType& MappableIntervalTree<MappableType, Allocator>::rightmost() const
+{
+    return *rightmost_mappable(std::cbegin(elements_), std::cend(elements_));
+}
+
+template <typename MappableType, typename Allocator>
+template <typename MappableType_>
+bool MappableIntervalTree<MappableType, Allocator>::has_overlapped(const MappableType_& mappable) const
+{
+    return index_.has_overlapped(std::cbegin(elements_), std::cend(elements_), mappable);
+}
+
+template <typename MappableType, typename Allocator>
+template <typename MappableType_>
+typename MappableIntervalTree<MappableType, Allocator>::size_type
+MappableIntervalTree<MappableType, Allocator>::count_overlapped(const MappableType_& mappable) const
+{
+    return index_.count_overlapped(std::cbegin(elements_), std::cend(elements_), mappable);
+}
+
+template <typename MappableType, typename Allocator>
+template <typename MappableType_>
+OverlapRange<typename MappableIntervalTree<MappableType, Allocator>::const_iterator>
+MappableIntervalTree<MappableType, Allocator>::overlap_range(const MappableType_& mappable) const
+{
+    return index_.overlap_range(std::cbegin(elements_), std::cend(elements_), mappable);
+}
+
+} // namespace octopus
+
+#endif
@@ -13,7 +13,15 @@
 #include <type_traits>
 #include <algorithm>
 #include <memory>
+#include <stdexcept>
 
+#include <boost/align/aligned_allocator.hpp>
+
+/*
+ MatrixMap is a Key1 x Key2 table stored densely in row-major order, one row per Key1. Keys are mapped to
+ row and column indices once on insertion, so callers that look up the same keys repeatedly can use the
+ index accessors instead of hashing each time. The value storage is 64-byte aligned.
+ */
 template <typename Key1,
           typename Key2,
           typename T,
@@ -23,8 +31,9 @@ template <typename Key1,
           typename KeyEqual2 = std::equal_to<Key2>
 > class MatrixMap
 {
+    using Key1ContainerType = std::vector<Key1>;
     using Key2ContainerType = std::vector<Key2>;
-    using ValueContainerType = std::vector<T>;
+    using ValueContainerType = std::vector<T, boost::alignment::aligned_allocator<T, 64>>;
     
     struct Key2RefHash
     {
@@ -42,10 +51,11 @@ template <typename Key1,
         }
     };
     
-    using ValueMap = std::unordered_map<Key1, ValueContainerType, Hash1, KeyEqual1>;
-    using IndexSizeType = typename ValueMap::mapped_type::size_type;
+    using IndexSizeType = typename ValueContainerType::size_type;
+    using Key1IndiceMap = std::unordered_map<Key1, IndexSizeType, Hash1, KeyEqual1>;
     using IndiceMap = std::unordered_map<std::reference_wrapper<const Key2>, IndexSizeType, Key2RefHash, Key2RefEqual>;
     
+    using Key1Iterator  = typename Key1ContainerType::const_iterator;
     using Key2Iterator  = typename Key2ContainerType::const_iterator;
     using ValueIterator = typename ValueContainerType::const_iterator;
     
@@ -64,8 +74,10 @@ public:
     }
     
     MatrixMap(const MatrixMap& other)
-    : key2s_ {other.key2s_}
+    : key1s_ {other.key1s_}
+    , key2s_ {other.key2s_}
     , values_ {other.values_}
+    , key1_indices_ {other.key1_indices_}
     {
         this->generate_indice_map();
     }
@@ -76,8 +88,10 @@ public:
             return *this;
         }
         
+        key1s_  = other.key1s_;
         key2s_  = other.key2s_;
         values_ = other.values_;
+        key1_indices_ = other.key1_indices_;
         
         this->regenerate_indice_map();
         
@@ -85,8 +99,10 @@ public:
     }
     
     MatrixMap(MatrixMap&& other)
-    : key2s_ {std::move(other.key2s_)}
+    : key1s_ {std::move(other.key1s_)}
+    , key2s_ {std::move(other.key2s_)}
     , values_ {std::move(other.values_)}
+    , key1_indices_ {std::move(other.key1_indices_)}
     {
         this->generate_indice_map();
     }
@@ -97,8 +113,10 @@ public:
             return *this;
         }
         
+        key1s_  = std::move(other.key1s_);
         key2s_  = std::move(other.key2s_);
         values_ = std::move(other.values_);
+        key1_indices_ = std::move(other.key1_indices_);
         
         this->regenerate_indice_map();
         
@@ -109,18 +127,17 @@ public:
     
     T& operator()(const Key1& key1, const Key2& key2)
     {
-        return values_.at(key1)[key2_indices_.at(key2)];
+        return at_index(index1(key1), index2(key2));
     }
     
     const T& operator()(const Key1& key1, const Key2& key2) const
     {
-        return values_.at(key1)[key2_indices_.at(key2)];
+        return at_index(index1(key1), index2(key2));
     }
     
     InnerSlice operator()(const Key1& key) const
     {
-        const auto& key_values = values_.at(key);
-        return InnerSlice {std::cbegin(key_values), std::cend(key_values)};
+        return row(index1(key));
     }
     
     InnerMap operator[](const Key1& key) const
@@ -128,9 +145,52 @@ public:
         return InnerMap {this->begin(key), this->end(key), key2_indices_};
     }
     
+    // Index based access. Indices are stable until keys are inserted or erased.
+    
+    size_type index1(const Key1& key) const
+    {
+        return key1_indices_.at(key);
+    }
+    
+    size_type index2(const Key2& key) const
+    {
+        return key2_indices_.at(key);
+    }
+    
+    const Key1& key1(size_type i) const
+    {
+        return key1s_[i];
+    }
+    
+    const Key2& key2(size_type j) const
+    {
+        return key2s_[j];
+    }
+    
+    T& at_index(size_type i, size_type j)
+    {
+        return values_[i * size2() + j];
+    }
+    
+    const T& at_index(size_type i, size_type j) const
+    {
+        return values_[i * size2() + j];
+    }
+    
+    InnerSlice row(size_type i) const
+    {
+        const auto row_begin = std::next(std::cbegin(values_), i * size2());
+        return InnerSlice {row_begin, std::next(row_begin, size2())};
+    }
+    
+    const T* data() const noexcept
+    {
+        return values_.data();
+    }
+    
     bool empty1() const noexcept
     {
-        return values_.empty();
+        return key1s_.empty();
     }
     
     bool empty2() const noexcept
@@ -140,7 +200,7 @@ public:
     
     size_type size1() const noexcept
     {
-        return values_.size();
+        return key1s_.size();
     }
     
     size_type size2() const noexcept
@@ -150,7 +210,9 @@ public:
     
     void reserve1(size_type n)
     {
-        values_.reserve(n);
+        key1s_.reserve(n);
+        key1_indices_.reserve(n);
+        values_.reserve(n * size2());
     }
     
     void reserve2(size_type n)
@@ -161,15 +223,15 @@ public:
     
     void reserve(size_type n1, size_type n2)
     {
-        reserve1(n1);
         reserve2(n2);
+        reserve1(n1);
     }
     
     void clear() noexcept
     {
         key2s_.clear();
-        values_.clear();
         key2_indices_.clear();
+        clear_rows();
     }
     
     template <typename InputIt>
@@ -177,33 +239,21 @@ public:
     {
         key2s_.assign(first, last);
         this->regenerate_indice_map();
-        if (!values_.empty()) {
-            values_.clear();
-            return true;
-        }
-        return false;;
+        return clear_rows();
     }
     
     template <typename K>
     bool push_back(K&& key)
     {
         this->push_back_reallocate(std::forward<K>(key));
-        if (!values_.empty()) {
-            values_.clear();
-            return true;
-        }
-        return false;
+        return clear_rows();
     }
     
     template <typename... Args>
     bool emplace_back(Args&&... args)
     {
         this->emplace_back_reallocate(std::forward<Args>(args)...);
-        if (!values_.empty()) {
-            values_.clear();
-            return true;
-        }
-        return false;
+        return clear_rows();
     }
     
     template <typename K, typename InputIt>
@@ -214,24 +264,30 @@ public:
                 " length to Key2 range in this MatrixMap"};
         }
         
-        return values_.emplace(std::piecewise_construct,
-                               std::forward_as_tuple<K>(std::forward<K>(key)),
-                               std::make_tuple(first, last)).second;
+        if (key1_indices_.count(key) == 1) return false;
+        
+        key1s_.push_back(std::forward<K>(key));
+        key1_indices_.emplace(key1s_.back(), key1s_.size() - 1);
+        values_.insert(std::end(values_), first, last);
+        
+        return true;
     }
     
     template <typename K, typename InputIt>
     bool insert_or_assign_at(K&& key, InputIt first, InputIt last)
     {
-        if (values_.count(key) == 0) {
+        const auto itr = key1_indices_.find(key);
+        
+        if (itr == std::cend(key1_indices_)) {
             return insert_at(std::forward<K>(key), first, last);
         }
         
-        if (std::distance(first, last) != this->size2()) {
+        if (static_cast<std::size_t>(std::distance(first, last)) != this->size2()) {
             throw std::out_of_range {"MatrixMap::insert_at called with value range of different"
                 " length to Key2 range in this MatrixMap"};
         }
         
-        values_[std::forward<K>(key)].assign(first, last);
+        std::copy(first, last, std::next(std::begin(values_), itr->second * size2()));
         
         return false;
     }
@@ -244,15 +300,8 @@ public:
                 " length to Key1 range in this MatrixMap"};
         }
         
-        // TODO: not working for all forwards
-        //        if (key2_indices_.count(key) != 0) {
-        //            return false;
-        //        }
-        
-        for (auto& p : values_) {
-            p.second.push_back(*first++);
-        }
-        
+        // Values are given in Key1 insertion order
+        this->insert_column(size2(), first);
         this->push_back_reallocate(std::forward<K>(key));
         
         return true;
@@ -261,22 +310,17 @@ public:
     template <typename K, typename InputIt>
     bool insert_or_assign_each(K&& key, InputIt first, InputIt last)
     {
-        if (std::distance(first, last) != this->size1()) {
+        if (static_cast<std::size_t>(std::distance(first, last)) != this->size1()) {
             throw std::out_of_range {"MatrixMap::insert_each called with value range of different"
                 " length to Key1 range in this MatrixMap"};
         }
         if (key2_indices_.count(key) == 0) {
-            for (auto& p : values_) {
-                p.second.push_back(*first++);
-            }
-            this->push_back_reallocate(std::forward<K>(key));
-            return true;
+            return insert_each(std::forward<K>(key), first, last);
         }
-        const auto index = key2_indices_[key];
-        for (auto& p : values_) {
-            p.second[index] = *first++;
+        const auto index = key2_indices_.at(key);
+        for (size_type i {0}; i < size1(); ++i) {
+            at_index(i, index) = *first++;
         }
-        this->push_back_reallocate(std::forward<K>(key));
         return false;
     }
     
@@ -285,16 +329,24 @@ public:
         if (key2s_.empty()) {
             return;
         }
+        this->erase_column(size2() - 1);
         key2_indices_.erase(key2s_.back());
         key2s_.pop_back();
-        for (auto& p : values_) {
-            p.second.pop_back();
-        }
     }
     
     bool erase1(const Key1& key)
     {
-        return values_.erase(key) == 1;
+        const auto itr = key1_indices_.find(key);
+        if (itr == std::cend(key1_indices_)) {
+            return false;
+        }
+        const auto key_index = itr->second;
+        const auto row_begin = std::next(std::begin(values_), key_index * size2());
+        values_.erase(row_begin, std::next(row_begin, size2()));
+        key1_indices_.erase(itr);
+        const auto it = key1s_.erase(std::next(std::begin(key1s_), key_index));
+        std::for_each(it, std::end(key1s_), [this] (const auto& key) { --key1_indices_[key]; });
+        return true;
     }
     
     bool erase2(const Key2& key)
@@ -303,12 +355,10 @@ public:
             return false;
         }
         const auto key_index = key2_indices_[key];
-        for (auto& p : values_) {
-            p.second.erase(std::next(std::begin(p.second), key_index));
-        }
-        const auto it = key2s_.erase(std::next(std::begin(key2s_), key_index));
-        key2_indices_.erase(key);
-        std::for_each(it, std::end(key2s_), [this] (const auto& key) { --key2_indices_[key]; });
+        this->erase_column(key_index);
+        // The index map refers to the keys, which move when one is erased
+        key2s_.erase(std::next(std::begin(key2s_), key_index));
+        this->regenerate_indice_map();
         return true;
     }
     
@@ -338,8 +388,10 @@ public:
     }
     
 private:
+    Key1ContainerType key1s_;
     Key2ContainerType key2s_;
-    ValueMap values_;
+    ValueContainerType values_;
+    Key1IndiceMap key1_indices_;
     IndiceMap key2_indices_;
     
     void generate_indice_map()
@@ -357,6 +409,44 @@ private:
         generate_indice_map();
     }
     
+    bool clear_rows() noexcept
+    {
+        const bool had_rows {!key1s_.empty()};
+        key1s_.clear();
+        values_.clear();
+        key1_indices_.clear();
+        return had_rows;
+    }
+    
+    // The Key2 keys must be updated after these as the row size is size2()
+    
+    template <typename InputIt>
+    void insert_column(const size_type index, InputIt first)
+    {
+        const auto old_size2 = size2();
+        ValueContainerType values(size1() * (old_size2 + 1));
+        auto value_itr = std::begin(values);
+        for (size_type i {0}; i < size1(); ++i) {
+            const auto row_begin = std::next(std::begin(values_), i * old_size2);
+            value_itr = std::move(row_begin, std::next(row_begin, index), value_itr);
+            *value_itr++ = *first++;
+            value_itr = std::move(std::next(row_begin, index), std::next(row_begin, old_size2), value_itr);
+        }
+        values_ = std::move(values);
+    }
+    
+    void erase_column(const size_type index)
+    {
+        const auto old_size2 = size2();
+        auto value_itr = std::begin(values_);
+        for (size_type i {0}; i < size1(); ++i) {
+            const auto row_begin = std::next(std::begin(values_), i * old_size2);
+            value_itr = std::move(row_begin, std::next(row_begin, index), value_itr);
+            value_itr = std::move(std::next(row_begin, index + 1), std::next(row_begin, old_size2), value_itr);
+        }
+        values_.erase(value_itr, std::end(values_));
+    }
+    
     template <typename K>
     void push_back_reallocate(K&& key)
     {
@@ -452,12 +542,14 @@ public:
     
     ZipIterator begin(const Key1& key) const
     {
-        return ZipIterator {std::begin(key2s_), std::begin(values_.at(key))};
+        const auto slice = (*this)(key);
+        return ZipIterator {std::begin(key2s_), std::begin(slice)};
     }
     
     ZipIterator end(const Key1& key) const
     {
-        return ZipIterator {std::end(key2s_), std::end(values_.at(key))};
+        const auto slice = (*this)(key);
+        return ZipIterator {std::end(key2s_), std::end(slice)};
     }
     
     ZipIterator cbegin(const Key1& key) const
@@ -470,9 +562,6 @@ public:
         return end(key);
     }
     
-private:
-    using ValueMapIterator = typename ValueMap::const_iterator;
-    
 public:
     class InnerMap
     {
@@ -528,9 +617,10 @@ public:
         
         Iterator() = delete;
         
-        explicit Iterator(ValueMapIterator map_itr, Key2Iterator key2_begin_itr,
+        explicit Iterator(Key1Iterator key1_itr, ValueIterator row_itr, Key2Iterator key2_begin_itr,
                           const IndiceMap& key2_indices)
-        : map_itr_ {map_itr}
+        : key1_itr_ {key1_itr}
+        , row_itr_ {row_itr}
         , key2_begin_itr_ {key2_begin_itr}
         , key2_indices_ {key2_indices}
         {}
@@ -539,27 +629,24 @@ public:
         
         Iterator& operator++()
         {
-            map_itr_++;
+            ++key1_itr_;
+            row_itr_ = std::next(row_itr_, key2_indices_.get().size());
             return *this;
         }
         
         value_type operator*() const
         {
-            ZipIterator zip1 {key2_begin_itr_, std::begin(map_itr_->second)};
-            ZipIterator zip2 {std::next(key2_begin_itr_, key2_indices_.get().size()), std::end(map_itr_->second)};
-            return std::make_pair(std::ref(map_itr_->first), InnerMap {std::move(zip1), std::move(zip2), key2_indices_});
+            return std::make_pair(std::ref(*key1_itr_), make_inner_map());
         }
         
         auto operator->() const
         {
-            ZipIterator zip1 {key2_begin_itr_, std::begin(map_itr_->second)};
-            ZipIterator zip2 {std::next(key2_begin_itr_, key2_indices_.get().size()), std::end(map_itr_->second)};
-            return std::make_unique<value_type>(map_itr_->first, InnerMap {std::move(zip1), std::move(zip2), key2_indices_});
+            return std::make_unique<value_type>(*key1_itr_, make_inner_map());
         }
         
         friend bool operator==(const Iterator& lhs, const Iterator& rhs)
         {
-            return lhs.map_itr_ == rhs.map_itr_;
+            return lhs.key1_itr_ == rhs.key1_itr_;
         }
         
         friend bool operator!=(const Iterator& lhs, const Iterator& rhs)
@@ -568,13 +655,22 @@ public:
         }
         
     private:
-        ValueMapIterator map_itr_;
+        Key1Iterator key1_itr_;
+        ValueIterator row_itr_;
         Key2Iterator key2_begin_itr_;
         std::reference_wrapper<const IndiceMap> key2_indices_;
+        
+        InnerMap make_inner_map() const
+        {
+            const auto size2 = key2_indices_.get().size();
+            ZipIterator zip1 {key2_begin_itr_, row_itr_};
+            ZipIterator zip2 {std::next(key2_begin_itr_, size2), std::next(row_itr_, size2)};
+            return InnerMap {std::move(zip1), std::move(zip2), key2_indices_};
+        }
     };
     
-    Iterator begin() const { return Iterator {std::cbegin(values_), std::begin(key2s_), key2_indices_}; }
-    Iterator end() const { return Iterator {std::cend(values_), std::begin(key2s_), key2_indices_}; }
+    Iterator begin() const { return Iterator {std::cbegin(key1s_), std::cbegin(values_), std::begin(key2s_), key2_indices_}; }
+    Iterator end() const { return Iterator {std::cend(key1s_), std::cend(values_), std::begin(key2s_), key2_indices_}; }
     Iterator cbegin() const { return begin(); }
     Iterator cend() const { return end(); }
 };
@@ -8,6 +8,7 @@
 #include <utility>
 #include <vector>
 #include <functional>
+#include <algorithm>
 
 #include "config/common.hpp"
 #include "matrix_map.hpp"
@@ -101,6 +102,55 @@ void insert_samples(const Map& probabilities, ProbabilityMatrix<T, Probability,
     }
 }
 
+// Removes the keys with probability below min_probability in every sample, keeping the most probable
+// key of each sample regardless. Returns the probability mass removed from each sample, in sample index order.
+template <typename T,
+          typename Probability,
+          typename HashT,
+          typename EqualT>
+std::vector<Probability>
+remove_improbable_keys(ProbabilityMatrix<T, Probability, HashT, EqualT>& matrix, const Probability min_probability)
+{
+    const auto num_samples = matrix.size1(), num_keys = matrix.size2();
+    std::vector<Probability> result(num_samples, 0);
+    if (num_samples == 0 || num_keys == 0) return result;
+    std::vector<char> keep(num_keys, false);
+    for (std::size_t i {0}; i < num_samples; ++i) {
+        const auto probabilities = matrix.row(i);
+        const auto max_itr = std::max_element(std::cbegin(probabilities), std::cend(probabilities));
+        keep[std::distance(std::cbegin(probabilities), max_itr)] = true;
+        std::size_t j {0};
+        for (const auto probability : probabilities) {
+            if (probability >= min_probability) keep[j] = true;
+            ++j;
+        }
+    }
+    const auto num_kept_keys = static_cast<std::size_t>(std::count(std::cbegin(keep), std::cend(keep), true));
+    if (num_kept_keys == num_keys) return result;
+    std::vector<T> kept_keys {};
+    kept_keys.reserve(num_kept_keys);
+    for (std::size_t j {0}; j < num_keys; ++j) {
+        if (keep[j]) kept_keys.push_back(matrix.key2(j));
+    }
+    ProbabilityMatrix<T, Probability, HashT, EqualT> sparse_matrix {std::cbegin(kept_keys), std::cend(kept_keys)};
+    sparse_matrix.reserve1(num_samples);
+    std::vector<Probability> kept_probabilities(num_kept_keys);
+    for (std::size_t i {0}; i < num_samples; ++i) {
+        auto kept_itr = std::begin(kept_probabilities);
+        std::size_t j {0};
+        for (const auto probability : matrix.row(i)) {
+            if (keep[j++]) {
+                *kept_itr++ = probability;
+            } else {
+                result[i] += probability;
+            }
+        }
+        insert_sample(matrix.key1(i), kept_probabilities, sparse_matrix);
+    }
+    matrix = std::move(sparse_matrix);
+    return result;
+}
+
 } // namespace octopus
 
 #endif
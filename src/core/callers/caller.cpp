@@ -12,6 +12,9 @@
 #include <iostream>
 #include <limits>
 #include <queue>
+#include <future>
+#include <map>
+#include <cmath>
 
 #include "concepts/mappable.hpp"
 #include "basics/aligned_template.hpp"
@@ -23,6 +26,8 @@
 #include "core/tools/haplotype_filter.hpp"
 #include "core/tools/read_assigner.hpp"
 #include "core/tools/read_realigner.hpp"
+#include "core/tools/vargen/candidate_cache.hpp"
+#include "core/tools/variation_prescreen.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/read_stats.hpp"
 #include "utils/maths.hpp"
@@ -30,6 +35,18 @@
 #include "utils/erase_if.hpp"
 #include "utils/map_utils.hpp"
 #include "utils/thread_pool.hpp"
+#include "utils/arena.hpp"
+#include "utils/memory_budget.hpp"
+#include "utils/genotype_reader.hpp"
+#include "utils/sequence_utils.hpp"
+#include "utils/string_utils.hpp"
+#include "io/variant/vcf_reader.hpp"
+#include "io/variant/vcf_spec.hpp"
+#include "io/variant/vcf_utils.hpp"
+#include "config/octopus_vcf.hpp"
+#include "logging/performance_counters.hpp"
+#include "logging/profiler_zones.hpp"
+#include "logging/allocation_counts.hpp"
 
 namespace octopus {
 
@@ -37,7 +54,7 @@ namespace octopus {
 
 Caller::Caller(Components&& components, Parameters parameters)
 : reference_ {components.reference}
-, samples_ {components.read_pipe.get().samples()}
+, samples_ {components.samples ? *components.samples : components.read_pipe.get().samples()}
 , debug_log_ {}
 , trace_log_ {}
 , read_pipe_ {components.read_pipe}
@@ -46,11 +63,19 @@ Caller::Caller(Components&& components, Parameters parameters)
 , likelihood_model_ {std::move(components.likelihood_model)}
 , phaser_ {std::move(components.phaser)}
 , bad_region_detector_ {std::move(components.bad_region_detector)}
+, regenotype_sites_ {std::move(components.regenotype_sites)}
+, regenotype_samples_ {}
+, candidate_cache_ {std::move(components.candidate_cache)}
 , parameters_ {std::move(parameters)}
 {
     if (parameters_.max_haplotypes == 0) {
         throw std::logic_error {"Caller: max haplotypes must be > 0"};
     }
+    if (regenotype_sites_) {
+        const auto site_samples = regenotype_sites_->fetch_header().samples();
+        std::copy_if(std::cbegin(samples_), std::cend(samples_), std::back_inserter(regenotype_samples_),
+                     [&] (const auto& sample) { return std::find(std::cbegin(site_samples), std::cend(site_samples), sample) != std::cend(site_samples); });
+    }
     if (DEBUG_MODE) {
         debug_log_ = logging::DebugLogger {};
     }
@@ -64,6 +89,11 @@ std::string Caller::name() const
     return do_name();
 }
 
+const std::vector<SampleName>& Caller::samples() const noexcept
+{
+    return samples_;
+}
+
 Caller::CallTypeSet Caller::call_types() const
 {
     return do_call_types();
@@ -136,52 +166,215 @@ auto to_vector(std::deque<T>&& values)
     return std::vector<T> {make_move_iterator(std::begin(values)), make_move_iterator(std::end(values))};
 }
 
-auto convert_to_vcf(std::deque<CallWrapper>&& calls, const VcfRecordFactory& factory, const GenomicRegion& call_region)
+auto convert_to_vcf(std::deque<CallWrapper>&& calls, const VcfRecordFactory& factory, const GenomicRegion& call_region,
+                    Caller::OptionalThreadPool workers)
 {
-    auto records = factory.make(to_vector(std::move(calls)));
+    const allocation::ScopedZone allocation_zone {allocation::Zone::record_factory};
+    auto records = factory.make(to_vector(std::move(calls)), workers);
     erase_calls_outside_region(records, call_region);
     std::deque<VcfRecord> result {};
     utils::append(std::move(records), result);
     return result;
 }
 
+void flag_degraded_calls(std::deque<VcfRecord>& calls, const GenomicRegion& degraded_region)
+{
+    for (auto& call : calls) {
+        if (overlaps(call, degraded_region)) {
+            call = VcfRecord::Builder {call}.set_info_flag(vcf::spec::info::degraded).build_once();
+        }
+    }
+}
+
+// Points a member at a call's telemetry for the duration of the call
+class ScopedTelemetry
+{
+public:
+    ScopedTelemetry() = delete;
+    
+    ScopedTelemetry(TaskTelemetry*& member, TaskTelemetry* telemetry) noexcept : member_ {member} { member_ = telemetry; }
+    
+    ScopedTelemetry(const ScopedTelemetry&)            = delete;
+    ScopedTelemetry& operator=(const ScopedTelemetry&) = delete;
+    
+    ~ScopedTelemetry() noexcept { member_ = nullptr; }
+    
+private:
+    TaskTelemetry*& member_;
+};
+
 } // namespace
 
 std::deque<VcfRecord> 
 Caller::call(const GenomicRegion& call_region, 
              ProgressMeter& progress_meter,
              OptionalThreadPool workers) const
+{
+    boost::optional<GenomicRegion> unfinished_region {};
+    return call(call_region, progress_meter, workers, {}, unfinished_region);
+}
+
+std::deque<VcfRecord>
+Caller::call(const GenomicRegion& call_region,
+             ProgressMeter& progress_meter,
+             OptionalThreadPool workers,
+             const YieldPredicate& should_yield,
+             boost::optional<GenomicRegion>& unfinished_region,
+             boost::optional<TaskTelemetry&> telemetry) const
+{
+    return call_helper(call_region, progress_meter, workers, should_yield, unfinished_region, telemetry, nullptr, nullptr);
+}
+
+std::deque<VcfRecord>
+Caller::call(const GenomicRegion& call_region,
+             ProgressMeter& progress_meter,
+             OptionalThreadPool workers,
+             const YieldPredicate& should_yield,
+             boost::optional<GenomicRegion>& unfinished_region,
+             boost::optional<TaskTelemetry&> telemetry,
+             const Caller& secondary,
+             std::deque<VcfRecord>& secondary_calls) const
+{
+    secondary_calls.clear();
+    return call_helper(call_region, progress_meter, workers, should_yield, unfinished_region, telemetry, &secondary, &secondary_calls);
+}
+
+void Caller::prefetch(const GenomicRegion& call_region) const
+{
+    if (regenotype_sites_) return;
+    prefetched_inputs_ = fetch_call_inputs(call_region, boost::none);
+}
+
+void realign_assigned_reads(HaplotypeSupportMap& support)
+{
+    for (auto& p : support) {
+        realign_to_reference(p.second, p.first);
+        std::sort(std::begin(p.second), std::end(p.second));
+    }
+}
+
+auto assign_and_realign(const std::vector<AlignedRead>& reads, const Genotype<Haplotype>& genotype)
+{
+    auto result = compute_haplotype_support(genotype, reads, {AssignmentConfig::AmbiguousAction::first});
+    realign_assigned_reads(result);
+    return result;
+}
+
+auto assign_and_realign(const std::vector<AlignedRead>& reads, const Genotype<Haplotype>& genotype,
+                        const ReadLikelihoodMatrix& likelihoods)
+{
+    auto result = compute_haplotype_support(genotype, reads, likelihoods, boost::none, {AssignmentConfig::AmbiguousAction::first});
+    realign_assigned_reads(result);
+    return result;
+}
+
+// private methods
+
+std::deque<VcfRecord>
+Caller::call_helper(const GenomicRegion& call_region,
+                    ProgressMeter& progress_meter,
+                    OptionalThreadPool workers,
+                    const YieldPredicate& should_yield,
+                    boost::optional<GenomicRegion>& unfinished_region,
+                    boost::optional<TaskTelemetry&> telemetry,
+                    const Caller* secondary,
+                    std::deque<VcfRecord>* secondary_calls) const
+{
+    OCTOPUS_ZONE_REGION(call_region);
+    OCTOPUS_ZONE("Caller::call");
+    unfinished_region = boost::none;
+    if (regenotype_sites_) return regenotype(call_region, progress_meter, workers);
+    const ScopedTelemetry scoped_telemetry {telemetry_, telemetry.get_ptr()};
+    time_budget_state_ = boost::none;
+    if (parameters_.time_budget) time_budget_state_ = TimeBudgetState {std::chrono::steady_clock::now(), 0, boost::none};
+    boost::optional<CallInputs> inputs {};
+    if (prefetched_inputs_ && prefetched_inputs_->call_region == call_region) {
+        if (debug_log_) stream(*debug_log_) << "Using prefetched reads and candidates for " << call_region;
+        inputs = std::move(*prefetched_inputs_);
+    } else {
+        inputs = fetch_call_inputs(call_region, workers);
+    }
+    prefetched_inputs_ = boost::none;
+    if (!inputs) return {};
+    if (telemetry_) {
+        telemetry_->num_reads += inputs->num_reads;
+        telemetry_->num_candidates += inputs->num_candidates;
+    }
+    if (!refcalls_requested() && inputs->candidates.empty()) {
+        progress_meter.log_completed(call_region);
+        return {};
+    }
+    const ReadMap& reads {*inputs->reads}; // may be shared with other tasks
+    const auto& read_templates = inputs->read_templates;
+    auto& candidates = inputs->candidates;
+    const auto& likely_difficult_regions = inputs->likely_difficult_regions;
+    auto haplotype_generator = make_haplotype_generator(candidates, reads, read_templates);
+    for (auto& region : likely_difficult_regions) haplotype_generator.add_lagging_exclusion_zone(region);
+    auto calls = call_variants(call_region, candidates, reads, read_templates, haplotype_generator, progress_meter, workers,
+                               should_yield, unfinished_region);
+    const auto called_region = unfinished_region ? left_overhang_region(call_region, *unfinished_region) : call_region;
+    if (secondary) {
+        // The templates only depend on the reads and the linkage, so can be shared too
+        const bool share_templates {read_templates && secondary->parameters_.read_linkage == parameters_.read_linkage};
+        *secondary_calls = secondary->call_shared(called_region, candidates, reads,
+                                                  share_templates ? read_templates : boost::none,
+                                                  progress_meter, workers);
+    }
+    candidates.clear();
+    candidates.shrink_to_fit();
+    progress_meter.log_completed(called_region);
+    const auto record_factory = make_record_factory(reads);
+    if (debug_log_) stream(*debug_log_) << "Converting " << calls.size() << " calls made in " << called_region << " to VCF";
+    auto result = convert_to_vcf(std::move(calls), record_factory, called_region, workers);
+    if (time_budget_state_ && time_budget_state_->degraded_region) {
+        flag_degraded_calls(result, *time_budget_state_->degraded_region);
+    }
+    return result;
+}
+
+boost::optional<Caller::CallInputs>
+Caller::fetch_call_inputs(const GenomicRegion& call_region, OptionalThreadPool workers) const
 {
     ReadPipe::Report reads_report {};
-    ReadMap reads;
-    boost::optional<TemplateMap> read_templates {};
+    CallInputs result {call_region, std::make_shared<const ReadMap>(), boost::none, {}, {}, 0, 0};
     if (candidate_generator_.requires_reads()) {
-        reads = read_pipe_.get().fetch_reads(expand(call_region, 100), reads_report);
-        read_templates = make_read_templates(reads);
-        if (read_templates) {
-            add_reads(*read_templates, candidate_generator_);
-        } else {
-            add_reads(reads, candidate_generator_);
-        }
-        if (!refcalls_requested() && all_empty(reads)) {
+        result.reads = read_pipe_.get().fetch_shared_reads(expand(call_region, 100), reads_report, workers);
+        if (!refcalls_requested() && all_empty(*result.reads)) {
             if (debug_log_) stream(*debug_log_) << "Stopping early as no reads found in call region " << call_region;
-            return {};
+            return boost::none;
         }
-        if (debug_log_) stream(*debug_log_) << "Using " << count_reads(reads) << " reads in call region " << call_region;
+        if (debug_log_) stream(*debug_log_) << "Using " << count_reads(*result.reads) << " reads in call region " << call_region;
+        result.num_reads = count_reads(*result.reads);
+        if (parameters_.prescreen_regions && !coretools::has_variation_evidence(*result.reads, reference_)) {
+            // Reference calls, if requested, are still made from the reads, just without candidates
+            if (debug_log_) stream(*debug_log_) << "Skipping candidate generation as no reads show variation in " << call_region;
+            if (refcalls_requested()) result.read_templates = make_read_templates(*result.reads);
+            return result;
+        }
+        result.read_templates = make_read_templates(*result.reads);
     }
-    const auto candidate_region = calculate_candidate_region(call_region, reads, reference_, candidate_generator_);
-    auto candidates = generate_candidate_variants(candidate_region, workers);
-    if (debug_log_) debug::print_final_candidates(stream(*debug_log_), candidates, candidate_region);
-    if (!refcalls_requested() && candidates.empty()) {
-        progress_meter.log_completed(call_region);
-        return {};
+    const auto candidate_region = calculate_candidate_region(call_region, *result.reads, reference_, candidate_generator_);
+    auto cached_candidates = fetch_cached_candidates(candidate_region);
+    if (!cached_candidates && candidate_generator_.requires_reads()) {
+        if (result.read_templates) {
+            add_reads(*result.read_templates, candidate_generator_);
+        } else {
+            add_reads(*result.reads, candidate_generator_);
+        }
     }
+    auto& candidates = result.candidates;
+    candidates = cached_candidates ? std::move(*cached_candidates) : generate_candidate_variants(candidate_region, workers);
+    result.num_candidates = candidates.size();
+    performance::add(performance::Counter::candidates, candidates.size());
+    if (debug_log_) debug::print_final_candidates(stream(*debug_log_), candidates, candidate_region);
+    if (!refcalls_requested() && candidates.empty()) return result;
     if (!candidate_generator_.requires_reads()) {
         // as we didn't fetch them earlier
-        reads = read_pipe_.get().fetch_reads(call_region, reads_report);
-        read_templates = make_read_templates(reads);
+        result.reads = read_pipe_.get().fetch_shared_reads(call_region, reads_report, workers);
+        result.read_templates = make_read_templates(*result.reads);
+        result.num_reads += count_reads(*result.reads);
     }
-    std::vector<GenomicRegion> likely_difficult_regions {};
+    const ReadMap& reads {*result.reads};
     if (bad_region_detector_ && has_coverage(reads)) {
         const auto bad_regions = bad_region_detector_->detect(candidates, reads, reads_report);
         for (const auto& bad_region : bad_regions) {
@@ -192,39 +385,49 @@ Caller::call(const GenomicRegion& call_region,
                 }
                 candidates.erase_contained(bad_region.region);
             } else{
-                likely_difficult_regions.push_back(bad_region.region);
+                result.likely_difficult_regions.push_back(bad_region.region);
             }
         }
-        likely_difficult_regions.shrink_to_fit();
+        result.likely_difficult_regions.shrink_to_fit();
     }
-    auto haplotype_generator = make_haplotype_generator(candidates, reads, read_templates);
-    for (auto& region : likely_difficult_regions) haplotype_generator.add_lagging_exclusion_zone(region);
-    auto calls = call_variants(call_region, candidates, reads, read_templates, haplotype_generator, progress_meter, workers);
-    candidates.clear();
-    candidates.shrink_to_fit();
-    progress_meter.log_completed(call_region);
-    const auto record_factory = make_record_factory(reads);
-    if (debug_log_) stream(*debug_log_) << "Converting " << calls.size() << " calls made in " << call_region << " to VCF";
-    return convert_to_vcf(std::move(calls), record_factory, call_region);
-}
-
-std::vector<VcfRecord> Caller::regenotype(const std::vector<Variant>& variants, ProgressMeter& progress_meter) const
-{
-    return {}; // TODO
+    return result;
 }
 
-auto assign_and_realign(const std::vector<AlignedRead>& reads, const Genotype<Haplotype>& genotype)
-{
-    auto result = compute_haplotype_support(genotype, reads, {AssignmentConfig::AmbiguousAction::first});
-    for (auto& p : result) {
-        realign_to_reference(p.second, p.first);
-        std::sort(std::begin(p.second), std::end(p.second));
-    }
+std::deque<VcfRecord>
+Caller::call_shared(const GenomicRegion& call_region,
+                    const MappableFlatSet<Variant>& candidates,
+                    const ReadMap& reads,
+                    const boost::optional<TemplateMap>& shared_templates,
+                    ProgressMeter& progress_meter,
+                    OptionalThreadPool workers) const
+{
+    if (!refcalls_requested() && candidates.empty()) return {};
+    ReadMap sample_reads {};
+    if (reads.size() != samples_.size()) {
+        for (const auto& sample : samples_) sample_reads.emplace(sample, reads.at(sample));
+    }
+    const ReadMap& caller_reads {sample_reads.empty() ? reads : sample_reads};
+    if (debug_log_) stream(*debug_log_) << "Calling " << call_region << " with " << name() << " caller using shared reads and candidates";
+    boost::optional<TemplateMap> sample_templates {};
+    if (!shared_templates) {
+        sample_templates = make_read_templates(caller_reads);
+    } else if (shared_templates->size() != samples_.size()) {
+        sample_templates = TemplateMap {};
+        for (const auto& sample : samples_) sample_templates->emplace(sample, shared_templates->at(sample));
+    }
+    const auto& read_templates = shared_templates && shared_templates->size() == samples_.size() ? shared_templates : sample_templates;
+    auto haplotype_generator = make_haplotype_generator(candidates, caller_reads, read_templates);
+    boost::optional<GenomicRegion> unfinished_region {};
+    auto calls = call_variants(call_region, candidates, caller_reads, read_templates, haplotype_generator, progress_meter, workers,
+                               {}, unfinished_region);
+    const auto record_factory = make_record_factory(caller_reads);
+    auto result = convert_to_vcf(std::move(calls), record_factory, call_region, workers);
+    // Records that begin before call_region belong to the preceding call, which reports them too
+    result.erase(std::begin(result), std::find_if(std::begin(result), std::end(result),
+                 [&] (const VcfRecord& record) { return mapped_begin(record) >= mapped_begin(call_region); }));
     return result;
 }
 
-// private methods
-
 namespace debug {
 
 template <typename S>
@@ -384,6 +587,11 @@ std::size_t count_reads(const boost::variant<ReadMap, TemplateMap>& reads)
     return boost::apply_visitor([] (const auto& reads) { return octopus::count_reads(reads); }, reads);
 }
 
+bool can_yield(const GenomicRegion& completed_region, const GenomicRegion& call_region)
+{
+    return mapped_end(completed_region) > mapped_begin(call_region) && ends_before(completed_region, call_region);
+}
+
 bool have_callable_region(const GenomicRegion& active_region,
                           const boost::optional<GenomicRegion>& next_active_region,
                           const boost::optional<GenomicRegion>& backtrack_region,
@@ -394,6 +602,28 @@ bool have_callable_region(const GenomicRegion& active_region,
            && overlaps(active_region, call_region);
 }
 
+// A rough estimate of the memory of the genotypes and their posteriors, which dominate the latents
+template <typename GenotypeProbabilityMap>
+MemoryFootprint estimate_footprint(const std::shared_ptr<GenotypeProbabilityMap>& genotype_posteriors)
+{
+    if (!genotype_posteriors) return 0;
+    return genotype_posteriors->size2() * (sizeof(Genotype<IndexedHaplotype<>>) + genotype_posteriors->size1() * sizeof(double));
+}
+
+// Waits for a pool task that refers to the calling frame, so the task never outlives the frame if it is unwound
+template <typename T>
+class TaskGuard
+{
+public:
+    TaskGuard(Caller::OptionalThreadPool workers, const std::future<T>& task) noexcept : workers_ {workers}, task_ {task} {}
+    TaskGuard(const TaskGuard&) = delete;
+    TaskGuard& operator=(const TaskGuard&) = delete;
+    ~TaskGuard() { if (workers_ && task_.valid()) workers_->wait(task_); }
+private:
+    Caller::OptionalThreadPool workers_;
+    const std::future<T>& task_;
+};
+
 } // namespace
 
 boost::optional<TemplateMap> Caller::make_read_templates(const ReadMap& reads) const
@@ -415,8 +645,11 @@ Caller::call_variants(const GenomicRegion& call_region,
                       const boost::optional<TemplateMap>& read_templates,
                       HaplotypeGenerator& haplotype_generator,
                       ProgressMeter& progress_meter,
-                      OptionalThreadPool workers) const
+                      OptionalThreadPool workers,
+                      const YieldPredicate& should_yield,
+                      boost::optional<GenomicRegion>& unfinished_region) const
 {
+    OCTOPUS_ZONE("Caller::call_variants");
     auto haplotype_likelihoods = make_haplotype_likelihood_cache();
     std::deque<CallWrapper> result {};
     if (candidates.empty()) {
@@ -442,7 +675,19 @@ Caller::call_variants(const GenomicRegion& call_region,
     auto completed_region = head_region(call_region);
     std::deque<Haplotype> protected_haplotypes {};
     boost::variant<ReadMap, TemplateMap> active_reads;
+    // The next active region can be speculatively generated, and its likelihoods computed, while the latents
+    // of the current active region are inferred. This is only kept if the real next active region is the same.
+    HaplotypeLikelihoodArray speculative_haplotype_likelihoods {};
+    HaplotypeGenerator::HaplotypePacket speculative_packet {};
+    std::future<bool> speculation {};
+    const TaskGuard<bool> speculation_guard {workers, speculation};
+    bool has_speculative_likelihoods {false};
+    if (parameters_.speculative_lookahead) speculative_haplotype_likelihoods = make_haplotype_likelihood_cache();
     while (true) {
+        const CallingWindowArena window_arena {}; // scratch made calling this active region is released together
+        if (time_budget_state_) reduce_effort_if_out_of_time(call_region, completed_region, haplotype_generator);
+        const bool use_speculative_likelihoods {has_speculative_likelihoods && next_active_region};
+        has_speculative_likelihoods = false;
         status = generate_active_haplotypes(call_region, haplotype_generator, active_region, next_active_region,
                                             haplotypes, next_haplotypes, backtrack_region);
         if (status == GeneratorStatus::done) {
@@ -472,7 +717,15 @@ Caller::call_variants(const GenomicRegion& call_region,
             continue;
         }
         if (debug_log_) stream(*debug_log_) << "There are " << count_reads(active_reads) << " active reads in " << active_region;
-        if (!compute_haplotype_likelihoods(haplotype_likelihoods, active_region, haplotypes, candidates, active_reads, workers)) {
+        if (use_speculative_likelihoods) {
+            if (debug_log_) stream(*debug_log_) << "Using speculative likelihoods for " << haplotypes.size() << " haplotypes";
+            if (telemetry_) {
+                telemetry_->num_haplotypes += haplotypes.size();
+                telemetry_->max_haplotypes = std::max(telemetry_->max_haplotypes, haplotypes.size());
+            }
+            performance::add(performance::Counter::haplotypes, haplotypes.size());
+            std::swap(haplotype_likelihoods, speculative_haplotype_likelihoods);
+        } else if (!compute_haplotype_likelihoods(haplotype_likelihoods, active_region, haplotypes, candidates, active_reads, workers)) {
             haplotype_generator.clear_progress();
             haplotype_likelihoods.clear();
             continue;
@@ -489,9 +742,36 @@ Caller::call_variants(const GenomicRegion& call_region,
                 insert_sorted(*reference_haplotype_itr, protected_haplotypes);
             }
         }
-        auto has_removal_impact = filter_haplotypes(haplotypes, haplotype_generator, haplotype_likelihoods, protected_haplotypes);
+        auto has_removal_impact = filter_haplotypes(haplotypes, haplotype_generator, haplotype_likelihoods, protected_haplotypes, workers);
         if (haplotypes.empty()) continue;
-        const auto caller_latents = infer_latents(haplotypes, haplotype_likelihoods, workers);
+        if (can_speculate(workers)) {
+            speculation = workers->push([&, speculative_generator = haplotype_generator] () mutable {
+                return compute_speculative_haplotype_likelihoods(speculative_generator, call_region, candidates,
+                                                                 reads, read_templates, speculative_packet,
+                                                                 speculative_haplotype_likelihoods, workers);
+            });
+        }
+        // The latents and the model posteriors, which compare the evidence of other models to the latents,
+        // are computed from the same likelihoods, so the reads left out add the same term to both
+        auto informative_likelihoods = copy_informative_likelihoods(haplotype_likelihoods);
+        const auto& inference_likelihoods = informative_likelihoods ? *informative_likelihoods : haplotype_likelihoods;
+        const auto caller_latents = [&] () {
+            const TaskPhaseTimer timer {telemetry_, &TaskTelemetry::latents};
+            return infer_latents(haplotypes, inference_likelihoods, workers);
+        }();
+        // Some callers only make the genotype posteriors on demand, so only look at them if there is a budget to keep to
+        auto& memory_budget = process_memory_budget();
+        const MemoryBudget::Reservation latents_footprint {memory_budget, memory_budget.limit() ? estimate_footprint(caller_latents->genotype_posteriors()) : 0};
+        if (telemetry_ || performance::is_enabled()) {
+            const auto genotype_posteriors = caller_latents->genotype_posteriors();
+            if (genotype_posteriors) {
+                if (telemetry_) {
+                    telemetry_->num_genotypes += genotype_posteriors->size2();
+                    telemetry_->max_genotypes = std::max(telemetry_->max_genotypes, genotype_posteriors->size2());
+                }
+                performance::add(performance::Counter::genotypes, genotype_posteriors->size2());
+            }
+        }
         if (trace_log_) {
             debug::print_haplotype_posteriors(stream(*trace_log_), *caller_latents->haplotype_posteriors());
         } else if (debug_log_) {
@@ -504,6 +784,12 @@ Caller::call_variants(const GenomicRegion& call_region,
             if (debug_log_) *debug_log_ << "Haplotypes are saturated, clearing lagging";
             haplotype_generator.clear_progress();
         }
+        boost::optional<CompactLikelihoods> compact_likelihoods {};
+        if (compacts_likelihoods()) {
+            compact_likelihoods = compact(haplotypes, haplotype_likelihoods, inference_likelihoods, *caller_latents);
+            haplotype_likelihoods.release();
+            if (informative_likelihoods) informative_likelihoods->release();
+        }
         if (try_early_detect_phase_regions(haplotypes, candidates, active_region, *caller_latents, backtrack_region)) {
             auto phased_region = find_phased_head(haplotypes, candidates, active_region, *caller_latents);
             if (phased_region) {
@@ -512,6 +798,15 @@ Caller::call_variants(const GenomicRegion& call_region,
             }
         }
         status = generate_next_active_haplotypes(next_haplotypes, next_active_region, backtrack_region, haplotype_generator);
+        if (speculation.valid()) {
+            workers->wait(speculation);
+            has_speculative_likelihoods = speculation.get() && status == GeneratorStatus::good
+                                          && next_active_region == speculative_packet.active_region
+                                          && next_haplotypes == speculative_packet.haplotypes;
+            if (debug_log_) {
+                stream(*debug_log_) << "Speculative next active region " << (has_speculative_likelihoods ? "matched" : "did not match");
+            }
+        }
         if (backtrack_region) {
             // Only protect haplotypes in backtrack - or holdout - regions as these are more likely
             // to suffer from window artifacts.
@@ -522,12 +817,18 @@ Caller::call_variants(const GenomicRegion& call_region,
         if (status != GeneratorStatus::skipped) {
             if (have_callable_region(active_region, next_active_region, backtrack_region, call_region)) {
                 call_variants(active_region, call_region, next_active_region, backtrack_region,
-                              candidates, haplotypes, haplotype_likelihoods, reads, *caller_latents,
+                              candidates, haplotypes, haplotype_likelihoods, inference_likelihoods, compact_likelihoods,
+                              reads, *caller_latents,
                               result, prev_called_region, completed_region);
             }
         }
         haplotype_likelihoods.clear();
         progress_meter.log_completed(completed_region);
+        if (should_yield && !backtrack_region && can_yield(completed_region, call_region) && should_yield(completed_region)) {
+            unfinished_region = right_overhang_region(call_region, completed_region);
+            if (debug_log_) stream(*debug_log_) << "Yielding unfinished region " << *unfinished_region;
+            break;
+        }
     }
     return result;
 }
@@ -537,6 +838,30 @@ std::size_t Caller::do_remove_duplicates(HaplotypeBlock& haplotypes) const
     return octopus::remove_duplicates(haplotypes, Haplotype {mapped_region(haplotypes), reference_.get()});
 }
 
+// Effort is reduced in steps as the call uses a half, three quarters, and all of its time budget. The first
+// step stops lagging for the rest of the call region, and each step halves the haplotype limits.
+void Caller::reduce_effort_if_out_of_time(const GenomicRegion& call_region, const GenomicRegion& completed_region,
+                                          HaplotypeGenerator& haplotype_generator) const
+{
+    assert(time_budget_state_ && parameters_.time_budget);
+    using Seconds = std::chrono::duration<double>;
+    const Seconds elapsed {std::chrono::steady_clock::now() - time_budget_state_->start};
+    const auto budget_used = elapsed.count() / parameters_.time_budget->count();
+    const unsigned num_reductions {budget_used >= 1 ? 3u : budget_used >= 0.75 ? 2u : budget_used >= 0.5 ? 1u : 0u};
+    if (num_reductions <= time_budget_state_->num_reductions) return;
+    if (!time_budget_state_->degraded_region) {
+        auto remaining_region = right_overhang_region(call_region, completed_region);
+        haplotype_generator.add_lagging_exclusion_zone(remaining_region);
+        time_budget_state_->degraded_region = std::move(remaining_region);
+    }
+    haplotype_generator.reduce_haplotype_limits(1u << (num_reductions - time_budget_state_->num_reductions));
+    time_budget_state_->num_reductions = num_reductions;
+    if (debug_log_) {
+        stream(*debug_log_) << "Reducing calling effort in " << *time_budget_state_->degraded_region << " after using "
+                            << static_cast<int>(100 * budget_used) << "% of the time budget";
+    }
+}
+
 boost::optional<MemoryFootprint> Caller::target_max_memory() const noexcept
 {
     return parameters_.target_max_memory;
@@ -556,6 +881,7 @@ Caller::generate_active_haplotypes(const GenomicRegion& call_region,
                                    HaplotypeBlock& next_haplotypes,
                                    boost::optional<GenomicRegion> backtrack_region) const
 {
+    const TaskPhaseTimer timer {telemetry_, &TaskTelemetry::haplotype_generation};
     if (next_active_region) {
         haplotypes = std::move(next_haplotypes);
         active_region = std::move(*next_active_region);
@@ -613,10 +939,11 @@ void Caller::remove_duplicates(HaplotypeBlock& haplotypes) const
 bool Caller::filter_haplotypes(HaplotypeBlock& haplotypes,
                                HaplotypeGenerator& haplotype_generator,
                                HaplotypeLikelihoodArray& haplotype_likelihoods,
-                               const std::deque<Haplotype>& protected_haplotypes) const
+                               const std::deque<Haplotype>& protected_haplotypes,
+                               OptionalThreadPool workers) const
 {
     bool has_removal_impact {false};
-    auto removed_haplotypes = filter(haplotypes, haplotype_likelihoods, protected_haplotypes);
+    auto removed_haplotypes = filter(haplotypes, haplotype_likelihoods, protected_haplotypes, workers);
     std::sort(std::begin(haplotypes), std::end(haplotypes));
     if (haplotypes.empty()) {
         // This can only happen if all haplotypes have equal likelihood
@@ -645,6 +972,7 @@ Caller::generate_next_active_haplotypes(HaplotypeBlock& next_haplotypes,
                                         boost::optional<GenomicRegion>& backtrack_region,
                                         HaplotypeGenerator& haplotype_generator) const
 {
+    const TaskPhaseTimer timer {telemetry_, &TaskTelemetry::haplotype_generation};
     try {
         auto packet = haplotype_generator.generate();
         next_haplotypes = std::move(packet.haplotypes);
@@ -773,6 +1101,7 @@ Caller::find_phased_head(const MappableBlock<Haplotype>& haplotypes,
                          const GenomicRegion& active_region,
                          const Latents& latents) const
 {
+    const TaskPhaseTimer timer {telemetry_, &TaskTelemetry::phasing};
     if (debug_log_) stream(*debug_log_) << "Trying to find complete phase regions in " << active_region;
     const auto active_candidates = contained_range(candidates, active_region);
     const auto viable_phase_regions = extract_regions(active_candidates);
@@ -907,12 +1236,15 @@ void Caller::call_variants(const GenomicRegion& active_region,
                            const MappableFlatSet<Variant>& candidates,
                            const HaplotypeBlock& haplotypes,
                            const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                           const HaplotypeLikelihoodArray& inference_likelihoods,
+                           const boost::optional<CompactLikelihoods>& compact_likelihoods,
                            const ReadMap& reads,
                            const Latents& latents,
                            std::deque<CallWrapper>& result,
                            boost::optional<GenomicRegion>& prev_called_region,
                            GenomicRegion& completed_region) const
 {
+    OCTOPUS_ZONE("Caller::call_variants(active_region)");
     const auto passed_region = get_passed_region(active_region, next_active_region, backtrack_region);
     const auto uncalled_region = get_uncalled_region(active_region, passed_region, completed_region);
     auto active_candidates = extract_callable_variants(candidates, uncalled_region, prev_called_region,
@@ -920,20 +1252,33 @@ void Caller::call_variants(const GenomicRegion& active_region,
     std::vector<CallWrapper> calls {};
     if (!active_candidates.empty()) {
         if (debug_log_) stream(*debug_log_) << "Calling variants in region " << uncalled_region;
-        calls = wrap(call_variants(active_candidates, latents));
-        if (!calls.empty()) {
-            set_model_posteriors(calls, latents, haplotypes, haplotype_likelihoods);
-            set_phasing(calls, latents, haplotypes, call_region);
+        {
+            const TaskPhaseTimer timer {telemetry_, &TaskTelemetry::calling};
+            calls = wrap(call_variants(active_candidates, latents));
+            if (!calls.empty()) {
+                if (!compact_likelihoods) {
+                    set_model_posteriors(calls, latents, haplotypes, inference_likelihoods);
+                } else if (compact_likelihoods->model_posterior) {
+                    set_model_posteriors(calls, *compact_likelihoods->model_posterior);
+                }
+            }
         }
+        if (!calls.empty()) set_phasing(calls, latents, haplotypes, call_region);
     }
     if (refcalls_requested()) {
+        const TaskPhaseTimer timer {telemetry_, &TaskTelemetry::calling};
         const auto reportable_uncalled_region = overlapped_region(call_region, uncalled_region); // uncalled_region is padded
         if (reportable_uncalled_region) {
             const auto refcall_region = right_overhang_region(*reportable_uncalled_region, completed_region);
-            const auto pileups = make_pileups(reads, latents, refcall_region);
-            auto alleles = generate_reference_alleles(refcall_region, calls);
-            auto reference_calls = call_reference_helper(alleles, latents, pileups);
-            const auto itr = utils::append(std::move(reference_calls), calls);
+            const auto pileups = compact_likelihoods
+                ? make_pileups(reads, latents, refcall_region, active_region, compact_likelihoods->likelihoods)
+                : make_pileups(reads, latents, refcall_region, active_region, haplotype_likelihoods);
+            auto reference_calls = call_reference_blocks(refcall_region, calls, latents, pileups);
+            if (!reference_calls) {
+                auto alleles = generate_reference_alleles(refcall_region, calls);
+                reference_calls = call_reference_helper(alleles, latents, pileups);
+            }
+            const auto itr = utils::append(std::move(*reference_calls), calls);
             std::inplace_merge(std::begin(calls), itr, std::end(calls));
         }
     }
@@ -945,11 +1290,11 @@ void Caller::call_variants(const GenomicRegion& active_region,
 Genotype<IndexedHaplotype<>> Caller::call_genotype(const Latents& latents, const SampleName& sample) const
 {
     const auto genotype_posteriors_ptr = latents.genotype_posteriors();
-    const auto& genotype_posteriors = (*genotype_posteriors_ptr)[sample];
-    auto itr = std::max_element(std::cbegin(genotype_posteriors), std::cend(genotype_posteriors),
-                                [] (const auto& lhs, const auto& rhs) { return lhs.second < rhs.second; });
-    assert(itr != std::cend(genotype_posteriors));
-    return itr->first;
+    const auto& genotype_posteriors = *genotype_posteriors_ptr;
+    const auto sample_posteriors = genotype_posteriors.row(genotype_posteriors.index1(sample));
+    const auto itr = std::max_element(std::cbegin(sample_posteriors), std::cend(sample_posteriors));
+    assert(itr != std::cend(sample_posteriors));
+    return genotype_posteriors.key2(std::distance(std::cbegin(sample_posteriors), itr));
 }
 
 std::deque<Haplotype> Caller::get_called_haplotypes(const Latents& latents) const
@@ -979,17 +1324,20 @@ void Caller::set_model_posteriors(std::vector<CallWrapper>& calls, const Latents
     if (parameters_.model_posterior_policy == ModelPosteriorPolicy::all
         || (parameters_.model_posterior_policy == ModelPosteriorPolicy::special && requires_model_evaluation(calls))) {
         const auto mp = calculate_model_posterior(haplotypes, haplotype_likelihoods, latents);
-        if (mp) {
-            for (auto& call : calls) {
-                if (mp->joint) {
-                    call->set_model_posterior(probability_false_to_phred(1 - *mp->joint));
-                }
-                if (!mp->samples.empty()) {
-                    for (std::size_t sample_idx {0}; sample_idx < samples_.size(); ++sample_idx) {
-                        if (mp->samples[sample_idx]) {
-                            call->set_model_posterior(samples_[sample_idx], probability_false_to_phred(1 - *mp->samples[sample_idx]));
-                        }
-                    }
+        if (mp) set_model_posteriors(calls, *mp);
+    }
+}
+
+void Caller::set_model_posteriors(std::vector<CallWrapper>& calls, const ModelPosterior& model_posterior) const
+{
+    for (auto& call : calls) {
+        if (model_posterior.joint) {
+            call->set_model_posterior(probability_false_to_phred(1 - *model_posterior.joint));
+        }
+        if (!model_posterior.samples.empty()) {
+            for (std::size_t sample_idx {0}; sample_idx < samples_.size(); ++sample_idx) {
+                if (model_posterior.samples[sample_idx]) {
+                    call->set_model_posterior(samples_[sample_idx], probability_false_to_phred(1 - *model_posterior.samples[sample_idx]));
                 }
             }
         }
@@ -1060,6 +1408,7 @@ void Caller::set_phasing(std::vector<CallWrapper>& calls,
                          const HaplotypeBlock& haplotypes,
                          const GenomicRegion& call_region) const
 {
+    const TaskPhaseTimer timer {telemetry_, &TaskTelemetry::phasing};
     if (debug_log_) stream(*debug_log_) << "Phasing " << calls.size() << " calls in " << call_region;
     if (trace_log_) debug::print_genotype_posteriors(stream(*trace_log_), *latents.genotype_posteriors());
     const auto call_regions = extract_regions(calls);
@@ -1073,6 +1422,46 @@ bool Caller::refcalls_requested() const noexcept
     return parameters_.refcall_type != RefCallType::none;
 }
 
+bool Caller::compacts_likelihoods() const noexcept
+{
+    // With the SPECIAL policy it is not known if model posteriors are needed until the calls are made
+    return parameters_.compact_likelihood_bits && parameters_.model_posterior_policy != ModelPosteriorPolicy::special;
+}
+
+boost::optional<HaplotypeLikelihoodArray>
+Caller::copy_informative_likelihoods(const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    // Copying is only worthwhile if it substantially reduces the work of inference
+    static constexpr double minUninformativeFraction {0.1};
+    if (!parameters_.uninformative_read_spread) return boost::none;
+    OCTOPUS_ZONE("Caller::copy_informative_likelihoods");
+    const auto max_spread = static_cast<HaplotypeLikelihoodArray::LogProbability>(*parameters_.uninformative_read_spread);
+    auto result = haplotype_likelihoods.copy_informative(max_spread, minUninformativeFraction);
+    if (result && debug_log_) {
+        const auto samples = haplotype_likelihoods.samples();
+        std::size_t num_reads {0}, num_informative_reads {0};
+        for (const auto& sample : samples) {
+            num_reads += haplotype_likelihoods.num_likelihoods(sample);
+            num_informative_reads += result->num_likelihoods(sample);
+        }
+        stream(*debug_log_) << "Leaving " << (num_reads - num_informative_reads) << " of " << num_reads
+                            << " uninformative reads out of inference";
+    }
+    return result;
+}
+
+Caller::CompactLikelihoods
+Caller::compact(const HaplotypeBlock& haplotypes, const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                const HaplotypeLikelihoodArray& inference_likelihoods, const Latents& latents) const
+{
+    OCTOPUS_ZONE("Caller::compact");
+    CompactLikelihoods result {{haplotype_likelihoods, *parameters_.compact_likelihood_bits}, boost::none};
+    if (parameters_.model_posterior_policy == ModelPosteriorPolicy::all) {
+        result.model_posterior = calculate_model_posterior(haplotypes, inference_likelihoods, latents);
+    }
+    return result;
+}
+
 bool check_reference(const Variant& v, const ReferenceGenome& reference)
 {
     return ref_sequence(v) == reference.fetch_sequence(mapped_region(v));
@@ -1086,16 +1475,29 @@ bool check_reference(const std::vector<Variant>& variants, const ReferenceGenome
 MappableFlatSet<Variant> 
 Caller::generate_candidate_variants(const GenomicRegion& region, OptionalThreadPool workers) const
 {
+    const TaskPhaseTimer timer {telemetry_, &TaskTelemetry::candidate_generation};
     if (debug_log_) stream(*debug_log_) << "Generating candidate variants in region " << region;
     auto raw_candidates = candidate_generator_.generate(region, workers);
     if (debug_log_) debug::print_left_aligned_candidates(stream(*debug_log_), raw_candidates, reference_);
     auto final_candidates = unique_left_align(std::move(raw_candidates), reference_);
     assert(check_reference(final_candidates, reference_));
     candidate_generator_.clear();
+    if (candidate_cache_) candidate_cache_->write(region, final_candidates);
     return MappableFlatSet<Variant> {std::make_move_iterator(std::begin(final_candidates)),
                                      std::make_move_iterator(std::end(final_candidates))};
 }
 
+boost::optional<MappableFlatSet<Variant>>
+Caller::fetch_cached_candidates(const GenomicRegion& region) const
+{
+    if (!candidate_cache_) return boost::none;
+    auto cached_candidates = candidate_cache_->fetch(region);
+    if (!cached_candidates) return boost::none;
+    if (debug_log_) stream(*debug_log_) << "Using " << cached_candidates->size() << " cached candidate variants in region " << region;
+    return MappableFlatSet<Variant> {std::make_move_iterator(std::begin(*cached_candidates)),
+                                     std::make_move_iterator(std::end(*cached_candidates))};
+}
+
 HaplotypeGenerator 
 Caller::make_haplotype_generator(const MappableFlatSet<Variant>& candidates,
                                  const ReadMap& reads, 
@@ -1115,6 +1517,7 @@ HaplotypeLikelihoodArray Caller::make_haplotype_likelihood_cache() const
 
 VcfRecordFactory Caller::make_record_factory(const ReadMap& reads) const
 {
+    const allocation::ScopedZone allocation_zone {allocation::Zone::record_factory};
     return VcfRecordFactory {reference_, reads, samples_, parameters_.call_sites_only};
 }
 
@@ -1163,22 +1566,23 @@ bool Caller::compute_haplotype_likelihoods(HaplotypeLikelihoodArray& haplotype_l
                                            const boost::variant<ReadMap, TemplateMap>& active_reads,
                                            OptionalThreadPool workers) const
 {
+    const TaskPhaseTimer timer {telemetry_, &TaskTelemetry::likelihoods};
     assert(haplotype_likelihoods.is_empty());
-    boost::optional<HaplotypeLikelihoodArray::FlankState> flank_state {};
+    if (telemetry_) {
+        telemetry_->num_haplotypes += haplotypes.size();
+        telemetry_->max_haplotypes = std::max(telemetry_->max_haplotypes, haplotypes.size());
+    }
+    performance::add(performance::Counter::haplotypes, haplotypes.size());
     if (debug_log_) {
         stream(*debug_log_) << "Calculating likelihoods for " << haplotypes.size() << " haplotypes";
         debug::print_active_candidates(stream(*debug_log_), candidates, active_region);
-    }
-    if (likelihood_model_.can_use_flank_state()) {
-        flank_state = calculate_flank_state(haplotypes, active_region, candidates);
-        if (debug_log_) {
+        if (likelihood_model_.can_use_flank_state()) {
             debug::print_inactive_flanking_candidates(stream(*debug_log_), candidates, active_region,
                                                       mapped_region(haplotypes));
         }
     }
     try {
-        boost::apply_visitor([&] (const auto& reads) { 
-            haplotype_likelihoods.populate(reads, haplotypes, std::move(flank_state), workers); }, active_reads);
+        populate_haplotype_likelihoods(haplotype_likelihoods, active_region, haplotypes, candidates, active_reads, workers);
     } catch(const HaplotypeLikelihoodModel::ShortHaplotypeError& e) {
         if (debug_log_) {
             stream(*debug_log_) << "Skipping " << active_region << " as a haplotype was too short by "
@@ -1194,14 +1598,75 @@ bool Caller::compute_haplotype_likelihoods(HaplotypeLikelihoodArray& haplotype_l
     return true;
 }
 
+void Caller::populate_haplotype_likelihoods(HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                            const GenomicRegion& active_region,
+                                            const HaplotypeBlock& haplotypes,
+                                            const MappableFlatSet<Variant>& candidates,
+                                            const boost::variant<ReadMap, TemplateMap>& active_reads,
+                                            OptionalThreadPool workers) const
+{
+    boost::optional<HaplotypeLikelihoodArray::FlankState> flank_state {};
+    if (likelihood_model_.can_use_flank_state()) {
+        flank_state = calculate_flank_state(haplotypes, active_region, candidates);
+    }
+    boost::apply_visitor([&] (const auto& reads) {
+        haplotype_likelihoods.populate(reads, haplotypes, std::move(flank_state), workers); }, active_reads);
+}
+
+bool Caller::can_speculate(OptionalThreadPool workers) const noexcept
+{
+    // Speculation only pays if the work can run alongside latent inference, rather than before it
+    return parameters_.speculative_lookahead && workers && workers->n_idle() > 0;
+}
+
+// Called from a worker thread, so must not write to the caller's logs or telemetry.
+bool Caller::compute_speculative_haplotype_likelihoods(HaplotypeGenerator& haplotype_generator,
+                                                       const GenomicRegion& call_region,
+                                                       const MappableFlatSet<Variant>& candidates,
+                                                       const ReadMap& reads,
+                                                       const boost::optional<TemplateMap>& read_templates,
+                                                       HaplotypeGenerator::HaplotypePacket& packet,
+                                                       HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                                       OptionalThreadPool workers) const
+{
+    haplotype_likelihoods.clear();
+    try {
+        packet = haplotype_generator.generate();
+    } catch (const HaplotypeGenerator::HaplotypeOverflow&) {
+        return false;
+    }
+    if (!packet.active_region || packet.haplotypes.empty()) return false;
+    const auto& active_region = *packet.active_region;
+    if (is_after(active_region, call_region) && !packet.backtrack_region) return false;
+    // As generate_active_haplotypes does for the real next active region
+    auto haplotypes = packet.haplotypes;
+    std::sort(std::begin(haplotypes), std::end(haplotypes));
+    do_remove_duplicates(haplotypes);
+    boost::variant<ReadMap, TemplateMap> active_reads;
+    if (read_templates) {
+        active_reads = copy_overlapped(*read_templates, active_region);
+    } else {
+        active_reads = copy_overlapped(reads, active_region);
+    }
+    if (!has_coverage(active_reads)) return false;
+    try {
+        populate_haplotype_likelihoods(haplotype_likelihoods, active_region, haplotypes, candidates, active_reads, workers);
+    } catch (const HaplotypeLikelihoodModel::ShortHaplotypeError&) {
+        haplotype_likelihoods.clear();
+        return false;
+    }
+    return true;
+}
+
 std::vector<Haplotype>
 Caller::filter(HaplotypeBlock& haplotypes,
                const HaplotypeLikelihoodArray& haplotype_likelihoods,
-               const std::deque<Haplotype>& protected_haplotypes) const
+               const std::deque<Haplotype>& protected_haplotypes,
+               OptionalThreadPool workers) const
 {
     std::vector<Haplotype> removed_haplotypes {};
     if (protected_haplotypes.empty()) {
-        removed_haplotypes = filter_to_n(haplotypes, samples_, haplotype_likelihoods, parameters_.max_haplotypes);
+        removed_haplotypes = filter_to_n(haplotypes, samples_, haplotype_likelihoods, parameters_.max_haplotypes, workers);
     } else {
         if (debug_log_) {
             stream(*debug_log_) << "Protecting " << protected_haplotypes.size() << " haplotypes from filtering";
@@ -1217,7 +1682,7 @@ Caller::filter(HaplotypeBlock& haplotypes,
         std::set_intersection(std::cbegin(haplotypes), std::cend(haplotypes),
                               std::cbegin(protected_haplotypes), std::cend(protected_haplotypes),
                               std::back_inserter(protected_copies));
-        removed_haplotypes = filter_to_n(removable_haplotypes, samples_, haplotype_likelihoods, parameters_.max_haplotypes);
+        removed_haplotypes = filter_to_n(removable_haplotypes, samples_, haplotype_likelihoods, parameters_.max_haplotypes, workers);
         haplotypes = std::move(removable_haplotypes);
         std::sort(std::begin(haplotypes), std::end(haplotypes));
         merge_unique(std::move(protected_copies), haplotypes);
@@ -1323,10 +1788,231 @@ std::vector<CallWrapper> Caller::call_reference(const GenomicRegion& region, con
     haplotype_likelihoods.populate(active_reads, haplotypes);
     const auto latents = infer_latents(haplotypes, haplotype_likelihoods);
     const auto pileups = make_pileups(active_reads, *latents, region);
+    auto result = call_reference_blocks(region, {}, *latents, pileups);
+    if (result) return std::move(*result);
     const auto alleles = generate_reference_alleles(region);
     return call_reference_helper(alleles, *latents, pileups);
 }
 
+namespace {
+
+// Each site is genotyped in the call region containing its first position so is reported once
+auto fetch_regenotype_sites(const VcfReader& sites, const GenomicRegion& call_region)
+{
+    auto result = sites.fetch_records(call_region);
+    const auto not_started_in_region = [&] (const VcfRecord& site) { return site.mapped_region().begin() < call_region.begin(); };
+    result.erase(std::remove_if(std::begin(result), std::end(result), not_started_in_region), std::end(result));
+    return result;
+}
+
+// Overlapping sites must be genotyped together
+auto cluster_overlapping(std::vector<VcfRecord>&& sites)
+{
+    std::vector<std::vector<VcfRecord>> result {};
+    for (auto& site : sites) {
+        if (result.empty() || !overlaps(encompassing_region(result.back()), site.mapped_region())) {
+            result.emplace_back();
+        }
+        result.back().push_back(std::move(site));
+    }
+    return result;
+}
+
+auto get_site_alleles(const VcfRecord& site)
+{
+    std::vector<VcfRecord::NucleotideSequence> result {};
+    result.reserve(site.num_alt() + 1);
+    result.push_back(utils::capitalise_copy(site.ref()));
+    for (const auto& alt : site.alt()) {
+        result.push_back(utils::capitalise_copy(alt));
+    }
+    return result;
+}
+
+using SiteGenotype = std::vector<boost::optional<unsigned>>;
+
+SiteGenotype project(const Genotype<IndexedHaplotype<>>& genotype, const GenomicRegion& site_region,
+                     const std::vector<VcfRecord::NucleotideSequence>& site_alleles)
+{
+    SiteGenotype result(genotype.ploidy());
+    std::transform(std::cbegin(genotype), std::cend(genotype), std::begin(result), [&] (const auto& haplotype) {
+        const auto allele_itr = std::find(std::cbegin(site_alleles), std::cend(site_alleles), haplotype.haplotype().sequence(site_region));
+        return allele_itr != std::cend(site_alleles) ? boost::optional<unsigned> {std::distance(std::cbegin(site_alleles), allele_itr)} : boost::none;
+    });
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+bool is_homozygous_reference(const SiteGenotype& genotype) noexcept
+{
+    return std::all_of(std::cbegin(genotype), std::cend(genotype), [] (const auto& allele) { return allele && *allele == 0; });
+}
+
+auto get_site_format(const bool site_likelihoods)
+{
+    std::vector<VcfRecord::KeyType> result {vcfspec::format::genotype, vcfspec::format::conditionalQuality};
+    if (site_likelihoods) result.push_back(vcfspec::format::likelihoods);
+    return result;
+}
+
+auto make_missing_genotype_record(const VcfRecord& site, const std::vector<SampleName>& samples, const bool site_likelihoods)
+{
+    VcfRecord::Builder result {};
+    result.set_chrom(site.chrom()).set_pos(site.pos()).set_id(site.id()).set_ref(site.ref()).set_alt(site.alt());
+    result.set_format(get_site_format(site_likelihoods));
+    for (const auto& sample : samples) {
+        result.set_genotype(sample, SiteGenotype {boost::none}, VcfRecord::Builder::Phasing::unphased);
+        result.set_format_missing(sample, vcfspec::format::conditionalQuality);
+        if (site_likelihoods) result.set_format_missing(sample, vcfspec::format::likelihoods);
+    }
+    return result.build_once();
+}
+
+// log10 of the site genotype posteriors in VCF order, normalised so the largest is 0. With uniform genotype
+// priors these are the site genotype likelihoods, marginalised over the other sites in the cluster
+std::vector<std::string>
+make_site_genotype_likelihoods(const std::map<SiteGenotype, double>& site_genotype_posteriors,
+                               const unsigned num_alleles, const unsigned ploidy)
+{
+    const auto genotypes = get_genotype_allele_indices(num_alleles, ploidy);
+    std::vector<double> log10_posteriors(genotypes.size());
+    std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(log10_posteriors), [&] (const auto& genotype) {
+        const SiteGenotype site_genotype {std::cbegin(genotype), std::cend(genotype)};
+        const auto posterior_itr = site_genotype_posteriors.find(site_genotype);
+        const auto posterior = posterior_itr != std::cend(site_genotype_posteriors) ? posterior_itr->second : 0.0;
+        return std::log10(std::max(posterior, std::numeric_limits<double>::min()));
+    });
+    const auto max_log10_posterior = *std::max_element(std::cbegin(log10_posteriors), std::cend(log10_posteriors));
+    std::vector<std::string> result(log10_posteriors.size());
+    std::transform(std::cbegin(log10_posteriors), std::cend(log10_posteriors), std::begin(result), [=] (double log10_posterior) {
+        return utils::to_string(log10_posterior - max_log10_posterior, 2);
+    });
+    return result;
+}
+
+} // namespace
+
+std::deque<VcfRecord>
+Caller::regenotype(const GenomicRegion& call_region, ProgressMeter& progress_meter, OptionalThreadPool workers) const
+{
+    assert(regenotype_sites_);
+    OCTOPUS_ZONE("Caller::regenotype");
+    auto site_clusters = cluster_overlapping(fetch_regenotype_sites(*regenotype_sites_, call_region));
+    std::deque<VcfRecord> result {};
+    if (site_clusters.empty()) {
+        progress_meter.log_completed(call_region);
+        return result;
+    }
+    if (debug_log_) stream(*debug_log_) << "Regenotyping " << site_clusters.size() << " site clusters in " << call_region;
+    std::vector<GenomicRegion> site_regions {};
+    site_regions.reserve(site_clusters.size());
+    for (const auto& sites : site_clusters) site_regions.push_back(encompassing_region(sites));
+    const auto reads = read_pipe_.get().fetch_reads(site_regions, boost::none, workers);
+    for (const auto& sites : site_clusters) {
+        utils::append(genotype_sites(sites, reads, workers), result);
+    }
+    progress_meter.log_completed(call_region);
+    return result;
+}
+
+Caller::HaplotypeBlock
+Caller::make_site_haplotypes(const std::vector<VcfRecord>& sites, const GenomicRegion& region) const
+{
+    // The reference, each site allele on its own, and the input genotypes of every sample
+    HaplotypeBlock result {region};
+    result.emplace_back(region, reference_);
+    for (const auto& site : sites) {
+        const auto site_alleles = get_site_alleles(site);
+        std::for_each(std::next(std::cbegin(site_alleles)), std::cend(site_alleles), [&] (const auto& allele) {
+            if (utils::is_canonical_dna(allele)) {
+                Haplotype::Builder builder {region, reference_};
+                builder.push_back(Allele {site.mapped_region(), allele});
+                result.push_back(builder.build());
+            }
+        });
+    }
+    if (!regenotype_samples_.empty()) {
+        for (const auto& p : extract_genotypes(sites, regenotype_samples_, reference_, region)) {
+            for (const auto& genotype : p.second) {
+                for (const auto& haplotype : genotype) {
+                    if (contains(haplotype, region)) result.push_back(haplotype);
+                }
+            }
+        }
+    }
+    std::sort(std::begin(result), std::end(result));
+    do_remove_duplicates(result);
+    return result;
+}
+
+std::vector<VcfRecord>
+Caller::genotype_sites(const std::vector<VcfRecord>& sites, const ReadMap& reads, OptionalThreadPool workers) const
+{
+    const auto sites_region = encompassing_region(sites);
+    const auto active_reads = copy_overlapped(reads, sites_region);
+    const auto haplotype_region = get_safe_haplotype_region(sites_region, likelihood_model_, active_reads);
+    auto haplotypes = make_site_haplotypes(sites, haplotype_region);
+    std::vector<Variant> candidates {};
+    const Haplotype reference_haplotype {haplotype_region, reference_};
+    for (const auto& haplotype : haplotypes) utils::append(haplotype.difference(reference_haplotype), candidates);
+    MappableFlatSet<Variant> candidate_set {std::begin(candidates), std::end(candidates)};
+    auto haplotype_likelihoods = make_haplotype_likelihood_cache();
+    std::vector<VcfRecord> result {};
+    result.reserve(sites.size());
+    try {
+        populate_haplotype_likelihoods(haplotype_likelihoods, sites_region, haplotypes, candidate_set, active_reads, workers);
+    } catch (const HaplotypeLikelihoodModel::ShortHaplotypeError&) {
+        if (debug_log_) stream(*debug_log_) << "Could not evaluate haplotypes for sites in " << sites_region;
+        for (const auto& site : sites) result.push_back(make_missing_genotype_record(site, samples_, parameters_.site_likelihoods));
+        return result;
+    }
+    if (haplotypes.size() > parameters_.max_haplotypes) {
+        filter_to_n(haplotypes, samples_, haplotype_likelihoods, parameters_.max_haplotypes, workers);
+        std::sort(std::begin(haplotypes), std::end(haplotypes));
+        haplotype_likelihoods.reset(haplotypes);
+    }
+    const auto latents = infer_latents(haplotypes, haplotype_likelihoods, workers);
+    const auto genotype_posteriors_ptr = latents->genotype_posteriors();
+    const auto& genotype_posteriors = *genotype_posteriors_ptr;
+    for (const auto& site : sites) {
+        const auto site_alleles = get_site_alleles(site);
+        VcfRecord::Builder record {};
+        record.set_chrom(site.chrom()).set_pos(site.pos()).set_id(site.id()).set_ref(site.ref()).set_alt(site.alt());
+        record.set_format(get_site_format(parameters_.site_likelihoods));
+        double log_probability_all_reference {0};
+        for (const auto& sample : samples_) {
+            const auto sample_index = genotype_posteriors.index1(sample);
+            const auto sample_posteriors = genotype_posteriors.row(sample_index);
+            std::map<SiteGenotype, double> site_genotype_posteriors {};
+            std::size_t genotype_idx {0};
+            for (const auto posterior : sample_posteriors) {
+                const auto& genotype = genotype_posteriors.key2(genotype_idx++);
+                site_genotype_posteriors[project(genotype, site.mapped_region(), site_alleles)] += posterior;
+            }
+            const auto called = std::max_element(std::cbegin(site_genotype_posteriors), std::cend(site_genotype_posteriors),
+                                                 [] (const auto& lhs, const auto& rhs) { return lhs.second < rhs.second; });
+            assert(called != std::cend(site_genotype_posteriors));
+            record.set_genotype(sample, called->first, VcfRecord::Builder::Phasing::unphased);
+            const auto gq = probability_false_to_phred(std::max(1.0 - called->second, std::numeric_limits<double>::min()));
+            record.set_format(sample, vcfspec::format::conditionalQuality, static_cast<int>(std::round(gq.score())));
+            if (parameters_.site_likelihoods) {
+                const auto ploidy = static_cast<unsigned>(called->first.size());
+                record.set_format(sample, vcfspec::format::likelihoods,
+                                  make_site_genotype_likelihoods(site_genotype_posteriors, site_alleles.size(), ploidy));
+            }
+            // Lost genotypes could be reference, so count them against the site being variant
+            double reference_posterior {latents->lost_genotype_posterior_mass(sample_index)};
+            for (const auto& p : site_genotype_posteriors) {
+                if (is_homozygous_reference(p.first)) reference_posterior += p.second;
+            }
+            log_probability_all_reference += std::log(std::max(reference_posterior, std::numeric_limits<double>::min()));
+        }
+        record.set_qual(log_probability_false_to_phred(log_probability_all_reference).score());
+        result.push_back(record.build_once());
+    }
+    return result;
+}
+
 std::vector<CallWrapper>
 Caller::call_reference_helper(const std::vector<Allele>& alleles, const Latents& latents, const ReadPileupMap& pileups) const
 {
@@ -1403,33 +2089,67 @@ std::vector<Allele> Caller::generate_reference_alleles(const GenomicRegion& regi
     return generate_reference_alleles(region, {});
 }
 
-namespace {
-
-auto overlap_range(std::vector<ReadPileup>& pileups, const AlignedRead& read)
+// Positions are merged into a block while their qualities are in the same band, so no two positions in a
+// block differ by more than the merge threshold. Like squash_reference_calls, the block quality is the median
+// position quality, and each sample's genotype posterior is that of the first position.
+boost::optional<std::vector<CallWrapper>>
+Caller::call_reference_blocks(const GenomicRegion& region, const std::vector<CallWrapper>& calls,
+                              const Latents& latents, const ReadPileupMap& pileups) const
 {
-    return overlap_range(std::begin(pileups), std::end(pileups), contig_region(read), BidirectionallySortedTag {});
+    if (!is_merge_block_refcalling()) return boost::none;
+    const auto band_size = parameters_.refcall_block_merge_threshold->score();
+    std::vector<std::unique_ptr<ReferenceCall>> result {};
+    std::vector<double> block_qualities {};
+    for (const auto& reference : make_reference_alleles(extract_uncalled_reference_regions(region, calls), reference_)) {
+        const auto qualities = compute_reference_qualities(reference, latents, pileups);
+        if (!qualities) return boost::none;
+        assert(qualities->positions.size() == region_size(reference));
+        assert(qualities->ploidies.size() == samples_.size());
+        const auto capped_quality = [&] (const std::size_t idx) {
+            const auto quality = qualities->positions[idx].score();
+            return parameters_.max_refcall_posterior ? std::min(quality, parameters_.max_refcall_posterior->score()) : quality;
+        };
+        const auto& sequence = reference.sequence();
+        const auto num_positions = sequence.size();
+        std::size_t block_begin {0};
+        while (block_begin < num_positions) {
+            const auto band = std::floor(capped_quality(block_begin) / band_size);
+            block_qualities.clear();
+            auto block_end = block_begin;
+            do {
+                block_qualities.push_back(capped_quality(block_end++));
+            } while (block_end < num_positions && std::floor(capped_quality(block_end) / band_size) == band);
+            const auto block_position = mapped_begin(reference) + static_cast<GenomicRegion::Position>(block_begin);
+            GenomicRegion block_region {contig_name(reference), block_position, block_position + static_cast<GenomicRegion::Position>(block_end - block_begin)};
+            Allele block_reference {std::move(block_region), sequence.substr(block_begin, block_end - block_begin)};
+            std::map<SampleName, ReferenceCall::GenotypeCall> genotypes {};
+            for (std::size_t s {0}; s < samples_.size(); ++s) {
+                genotypes.emplace(samples_[s], ReferenceCall::GenotypeCall {qualities->ploidies[s], qualities->positions[block_begin]});
+            }
+            const Phred<> quality {maths::median(block_qualities)};
+            result.push_back(std::make_unique<ReferenceCall>(std::move(block_reference), quality, std::move(genotypes)));
+            block_begin = block_end;
+        }
+    }
+    return wrap(std::move(result));
 }
 
-} // namespace
-
-auto make_pileups(const std::vector<AlignedRead>& reads, const Genotype<Haplotype>& genotype, const GenomicRegion& region)
+auto make_pileups(const HaplotypeSupportMap& realignments, const GenomicRegion& region)
 {
-    const auto realignments = assign_and_realign(reads, genotype);
-    ReadPileups result {};
-    result.reserve(size(region));
-    for (auto position = region.begin(); position < region.end(); ++position) {
-        result.emplace_back(position);
-    }
+    auto result = make_pileups(region);
     for (const auto& p : realignments) {
         for (const auto& read : p.second) {
-            for (ReadPileup& pileup : overlap_range(result, read)) {
-                pileup.add(read);
-            }
+            add_to_pileups(read, result);
         }
     }
     return result;
 }
 
+auto make_pileups(const std::vector<AlignedRead>& reads, const Genotype<Haplotype>& genotype, const GenomicRegion& region)
+{
+    return make_pileups(assign_and_realign(reads, genotype), region);
+}
+
 ReadPileups make_pileups(const ReadContainer& reads, const Genotype<Haplotype>& genotype, const GenomicRegion& region)
 {
     const auto overlapped_reads = overlap_range(reads, region);
@@ -1459,6 +2179,66 @@ Caller::ReadPileupMap Caller::make_pileups(const ReadMap& reads, const Latents&
     return result;
 }
 
+// The caller's likelihoods are for every read overlapping the active region, in container order, so the
+// likelihoods of the reads overlapping a sub-region can be picked out without evaluating anything again.
+// boost::none if the likelihoods cannot be reused: the called haplotypes must be in the array, and must
+// span the reads without the remapping done for the other pileups. Compact likelihoods are enough, as reads
+// are only assigned to their most likely haplotype.
+template <typename LikelihoodArray>
+boost::optional<ReadPileups>
+make_pileups(const ReadContainer& reads, const Genotype<Haplotype>& genotype, const GenomicRegion& region,
+             const GenomicRegion& active_region, const LikelihoodArray& haplotype_likelihoods,
+             const SampleName& sample)
+{
+    if (!contains(active_region, region)) return boost::none;
+    if (!std::all_of(std::cbegin(genotype), std::cend(genotype),
+                     [&] (const auto& haplotype) { return haplotype_likelihoods.contains(haplotype); })) {
+        return boost::none;
+    }
+    if (reads.count_overlapped(active_region) != haplotype_likelihoods.num_likelihoods(sample)) {
+        return boost::none; // populated with templates
+    }
+    std::vector<AlignedRead> region_reads {};
+    std::vector<std::size_t> read_indices {};
+    std::size_t read_idx {0};
+    for (const auto& read : overlap_range(reads, active_region)) {
+        if (overlaps(read, region)) {
+            region_reads.push_back(read);
+            read_indices.push_back(read_idx);
+        }
+        ++read_idx;
+    }
+    if (region_reads.empty()) return ReadPileups {};
+    const auto min_genotype_region = expand(encompassing_region(region_reads), max_read_length(region_reads));
+    if (!contains(genotype, min_genotype_region)) return boost::none;
+    ReadLikelihoodMatrix likelihoods(genotype.ploidy());
+    for (unsigned k {0}; k < genotype.ploidy(); ++k) {
+        const auto& haplotype_likelihoods_k = haplotype_likelihoods(sample, genotype[k]);
+        likelihoods[k].reserve(read_indices.size());
+        for (auto idx : read_indices) likelihoods[k].push_back(haplotype_likelihoods_k[idx]);
+    }
+    return make_pileups(assign_and_realign(region_reads, genotype, likelihoods), region);
+}
+
+template <typename LikelihoodArray>
+Caller::ReadPileupMap Caller::make_pileups(const ReadMap& reads, const Latents& latents, const GenomicRegion& region,
+                                           const GenomicRegion& active_region,
+                                           const LikelihoodArray& haplotype_likelihoods) const
+{
+    ReadPileupMap result {};
+    result.reserve(samples_.size());
+    for (const auto& sample : samples_) {
+        const auto called_genotype = genotype_cast<Haplotype>(call_genotype(latents, sample));
+        auto pileups = octopus::make_pileups(reads.at(sample), called_genotype, region, active_region, haplotype_likelihoods, sample);
+        if (pileups) {
+            result.emplace(sample, std::move(*pileups));
+        } else {
+            result.emplace(sample, octopus::make_pileups(reads.at(sample), called_genotype, region));
+        }
+    }
+    return result;
+}
+
 namespace {
 
 std::unique_ptr<ReferenceCall>
@@ -11,6 +11,7 @@
 #include <deque>
 #include <typeindex>
 #include <set>
+#include <chrono>
 
 #include <boost/optional.hpp>
 #include <boost/variant.hpp>
@@ -23,6 +24,7 @@
 #include "core/types/indexed_haplotype.hpp"
 #include "core/tools/coretools.hpp"
 #include "core/models/haplotype_likelihood_array.hpp"
+#include "core/models/compact_haplotype_likelihood_array.hpp"
 #include "core/tools/vcf_record_factory.hpp"
 #include "containers/mappable_flat_set.hpp"
 #include "containers/probability_matrix.hpp"
@@ -33,6 +35,7 @@
 #include "utils/memory_footprint.hpp"
 #include "logging/progress_meter.hpp"
 #include "logging/logging.hpp"
+#include "logging/task_report.hpp"
 
 namespace octopus {
 
@@ -41,6 +44,9 @@ struct CallWrapper;
 class VariantCall;
 class ReferenceCall;
 class ThreadPool;
+class VcfReader;
+
+namespace coretools { class CandidateCache; }
 
 class Caller
 {
@@ -59,6 +65,9 @@ public:
         HaplotypeLikelihoodModel likelihood_model;
         Phaser phaser;
         boost::optional<BadRegionDetector> bad_region_detector = boost::none;
+        std::shared_ptr<const VcfReader> regenotype_sites = nullptr;
+        std::shared_ptr<coretools::CandidateCache> candidate_cache = nullptr;
+        boost::optional<std::vector<SampleName>> samples = boost::none; // all samples in the read pipe if none
     };
     
     struct Parameters
@@ -74,12 +83,21 @@ public:
         ExecutionPolicy execution_policy;
         ReadLinkageType read_linkage;
         bool try_early_phase_detection;
+        bool speculative_lookahead;
+        bool site_likelihoods; // write genotype likelihoods (GL) when regenotyping sites
+        bool prescreen_regions; // skip candidate generation when no read shows evidence of variation
+        boost::optional<unsigned> compact_likelihood_bits; // likelihoods kept after inference are quantised to this
+        boost::optional<std::chrono::seconds> time_budget; // for each call, after which less effort is made
+        boost::optional<double> uninformative_read_spread; // reads with less likelihood spread are left out of inference
     };
     
     using ReadMap = octopus::ReadMap;
 
     using OptionalThreadPool = boost::optional<ThreadPool&>;
     
+    // Called with the region completed so far; returning true requests the caller stops early
+    using YieldPredicate = std::function<bool(const GenomicRegion& completed_region)>;
+    
     Caller() = delete;
     
     Caller(Components&& components, Parameters parameters);
@@ -93,6 +111,8 @@ public:
     
     std::string name() const;
     
+    const std::vector<SampleName>& samples() const noexcept;
+    
     CallTypeSet call_types() const;
     
     unsigned min_callable_ploidy() const;
@@ -103,9 +123,39 @@ public:
         ProgressMeter& progress_meter,
         OptionalThreadPool workers = boost::none) const;
     
-    std::vector<VcfRecord> 
-    regenotype(const std::vector<Variant>& variants, 
-               ProgressMeter& progress_meter) const;
+    // If should_yield requests a stop then the calls made up to the yield point are returned,
+    // and unfinished_region is set to the part of call_region that remains to be called.
+    // If telemetry is given the counts and phase times of the call are added to it.
+    std::deque<VcfRecord>
+    call(const GenomicRegion& call_region,
+         ProgressMeter& progress_meter,
+         OptionalThreadPool workers,
+         const YieldPredicate& should_yield,
+         boost::optional<GenomicRegion>& unfinished_region,
+         boost::optional<TaskTelemetry&> telemetry = boost::none) const;
+    
+    // As above, but secondary also calls the region that this caller called, reusing the reads and
+    // candidates fetched by this caller. secondary may call a subset of this caller's samples.
+    std::deque<VcfRecord>
+    call(const GenomicRegion& call_region,
+         ProgressMeter& progress_meter,
+         OptionalThreadPool workers,
+         const YieldPredicate& should_yield,
+         boost::optional<GenomicRegion>& unfinished_region,
+         boost::optional<TaskTelemetry&> telemetry,
+         const Caller& secondary,
+         std::deque<VcfRecord>& secondary_calls) const;
+    
+    // Fetches the reads and candidates of call_region, so they are ready for the next call of
+    // call_region, which then goes straight to inference. Not thread-safe with call.
+    void prefetch(const GenomicRegion& call_region) const;
+    
+    // Genotypes the regenotype sites starting in call_region without candidate discovery, making one
+    // record for each site. call uses this if the caller was given regenotype sites.
+    std::deque<VcfRecord>
+    regenotype(const GenomicRegion& call_region,
+               ProgressMeter& progress_meter,
+               OptionalThreadPool workers = boost::none) const;
     
 protected:
     using HaplotypeBlock = HaplotypeGenerator::HaplotypeBlock;
@@ -116,6 +166,16 @@ protected:
     
     mutable boost::optional<logging::DebugLogger> debug_log_;
     mutable boost::optional<logging::TraceLogger> trace_log_;
+    mutable TaskTelemetry* telemetry_ = nullptr; // only set during call
+    
+    struct TimeBudgetState
+    {
+        std::chrono::steady_clock::time_point start;
+        unsigned num_reductions;
+        boost::optional<GenomicRegion> degraded_region; // called with reduced effort
+    };
+    
+    mutable boost::optional<TimeBudgetState> time_budget_state_; // only valid during call
     
     struct Latents
     {
@@ -129,6 +189,9 @@ protected:
         // we avoid copying.
         virtual std::shared_ptr<HaplotypeProbabilityMap> haplotype_posteriors() const = 0;
         virtual std::shared_ptr<GenotypeProbabilityMap> genotype_posteriors() const = 0;
+        // The posterior mass of the genotypes left out of genotype_posteriors() for the sample with the
+        // given index, which is only non-zero if the latents keep the probable genotypes only.
+        virtual double lost_genotype_posterior_mass(std::size_t sample_index) const noexcept { return 0; }
     };
     
 private:
@@ -142,8 +205,24 @@ private:
     HaplotypeLikelihoodModel likelihood_model_;
     Phaser phaser_;
     boost::optional<BadRegionDetector> bad_region_detector_;
+    std::shared_ptr<const VcfReader> regenotype_sites_;
+    std::vector<SampleName> regenotype_samples_; // samples genotyped in the regenotype sites
+    std::shared_ptr<coretools::CandidateCache> candidate_cache_;
     Parameters parameters_;
     
+    // The reads and candidates of a call region: everything needed before inference starts
+    struct CallInputs
+    {
+        GenomicRegion call_region;
+        ReadPipe::SharedReadMap reads;
+        boost::optional<TemplateMap> read_templates;
+        MappableFlatSet<Variant> candidates;
+        std::vector<GenomicRegion> likely_difficult_regions;
+        std::size_t num_reads, num_candidates;
+    };
+    
+    mutable boost::optional<CallInputs> prefetched_inputs_;
+    
     // virtual methods
     
     virtual std::string do_name() const = 0;
@@ -163,6 +242,12 @@ protected:
 
     using ReadPileupMap = std::unordered_map<SampleName, ReadPileups>;
     
+    struct ReferenceQualities
+    {
+        std::vector<Phred<double>> positions; // each sample's genotype posterior is the position quality
+        std::vector<unsigned> ploidies; // in sample order
+    };
+    
     boost::optional<MemoryFootprint> target_max_memory() const noexcept;
     ExecutionPolicy exucution_policy() const noexcept;
 
@@ -188,8 +273,32 @@ private:
     call_reference(const std::vector<Allele>& alleles, const Latents& latents,
                    const ReadPileupMap& pileups) const = 0;
     
+    // The quality of each position of the reference allele, if this can be computed without making a
+    // ReferenceCall for each position. Blocked reference calls are then made straight from the qualities.
+    virtual boost::optional<ReferenceQualities>
+    compute_reference_qualities(const Allele& reference, const Latents& latents,
+                                const ReadPileupMap& pileups) const { return boost::none; }
+    
     // helper methods
     
+    std::deque<VcfRecord>
+    call_helper(const GenomicRegion& call_region,
+                ProgressMeter& progress_meter,
+                OptionalThreadPool workers,
+                const YieldPredicate& should_yield,
+                boost::optional<GenomicRegion>& unfinished_region,
+                boost::optional<TaskTelemetry&> telemetry,
+                const Caller* secondary,
+                std::deque<VcfRecord>* secondary_calls) const;
+    boost::optional<CallInputs>
+    fetch_call_inputs(const GenomicRegion& call_region, OptionalThreadPool workers) const;
+    std::deque<VcfRecord>
+    call_shared(const GenomicRegion& call_region,
+                const MappableFlatSet<Variant>& candidates,
+                const ReadMap& reads,
+                const boost::optional<TemplateMap>& shared_templates, // made from reads with this caller's linkage
+                ProgressMeter& progress_meter,
+                OptionalThreadPool workers) const;
     boost::optional<TemplateMap> make_read_templates(const ReadMap& reads) const;
     std::deque<CallWrapper>
     call_variants(const GenomicRegion& call_region,
@@ -198,10 +307,27 @@ private:
                   const boost::optional<TemplateMap>& read_templates,
                   HaplotypeGenerator& haplotype_generator,
                   ProgressMeter& progress_meter,
-                  OptionalThreadPool workers) const;
+                  OptionalThreadPool workers,
+                  const YieldPredicate& should_yield,
+                  boost::optional<GenomicRegion>& unfinished_region) const;
     bool refcalls_requested() const noexcept;
+    // The likelihoods latents are inferred from, if reads that don't tell the haplotypes apart are left out
+    boost::optional<HaplotypeLikelihoodArray>
+    copy_informative_likelihoods(const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    // The likelihoods kept for calling once latents are inferred, if the full likelihoods are released.
+    // Model posteriors need the likelihoods the latents were inferred from, so are computed before they are released.
+    struct CompactLikelihoods
+    {
+        CompactHaplotypeLikelihoodArray likelihoods;
+        boost::optional<ModelPosterior> model_posterior;
+    };
+    bool compacts_likelihoods() const noexcept;
+    CompactLikelihoods compact(const HaplotypeBlock& haplotypes, const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                               const HaplotypeLikelihoodArray& inference_likelihoods, const Latents& latents) const;
     MappableFlatSet<Variant> 
     generate_candidate_variants(const GenomicRegion& region, OptionalThreadPool workers) const;
+    boost::optional<MappableFlatSet<Variant>>
+    fetch_cached_candidates(const GenomicRegion& region) const;
     HaplotypeGenerator 
     make_haplotype_generator(const MappableFlatSet<Variant>& candidates,
                              const ReadMap& reads,
@@ -210,11 +336,22 @@ private:
     VcfRecordFactory make_record_factory(const ReadMap& reads) const;
     std::vector<Haplotype>
     filter(HaplotypeBlock& haplotypes, const HaplotypeLikelihoodArray& haplotype_likelihoods,
-           const std::deque<Haplotype>& protected_haplotypes) const;
+           const std::deque<Haplotype>& protected_haplotypes, OptionalThreadPool workers) const;
     bool compute_haplotype_likelihoods(HaplotypeLikelihoodArray& haplotype_likelihoods, const GenomicRegion& active_region,
                                        const HaplotypeBlock& haplotypes, const MappableFlatSet<Variant>& candidates,
                                        const boost::variant<ReadMap, TemplateMap>& active_reads,
                                        OptionalThreadPool workers) const;
+    void populate_haplotype_likelihoods(HaplotypeLikelihoodArray& haplotype_likelihoods, const GenomicRegion& active_region,
+                                        const HaplotypeBlock& haplotypes, const MappableFlatSet<Variant>& candidates,
+                                        const boost::variant<ReadMap, TemplateMap>& active_reads,
+                                        OptionalThreadPool workers) const;
+    bool can_speculate(OptionalThreadPool workers) const noexcept;
+    bool compute_speculative_haplotype_likelihoods(HaplotypeGenerator& haplotype_generator, const GenomicRegion& call_region,
+                                                   const MappableFlatSet<Variant>& candidates, const ReadMap& reads,
+                                                   const boost::optional<TemplateMap>& read_templates,
+                                                   HaplotypeGenerator::HaplotypePacket& packet,
+                                                   HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                                   OptionalThreadPool workers) const;
     std::vector<std::reference_wrapper<const Haplotype>>
     get_removable_haplotypes(const HaplotypeBlock& haplotypes, const HaplotypeLikelihoodArray& haplotype_likelihoods,
                              const Latents::HaplotypeProbabilityMap& haplotype_posteriors,
@@ -230,9 +367,12 @@ private:
                                     boost::optional<GenomicRegion>& backtrack_region,
                                     HaplotypeGenerator& haplotype_generator) const;
     void remove_duplicates(HaplotypeBlock& haplotypes) const;
+    void reduce_effort_if_out_of_time(const GenomicRegion& call_region, const GenomicRegion& completed_region,
+                                      HaplotypeGenerator& haplotype_generator) const;
     bool filter_haplotypes(HaplotypeBlock& haplotypes, HaplotypeGenerator& haplotype_generator,
                            HaplotypeLikelihoodArray& haplotype_likelihoods,
-                           const std::deque<Haplotype>& protected_haplotypes) const;
+                           const std::deque<Haplotype>& protected_haplotypes,
+                           OptionalThreadPool workers) const;
     bool is_saturated(const HaplotypeBlock& haplotypes, const Latents& latents) const;
     unsigned count_probable_haplotypes(const Caller::Latents::HaplotypeProbabilityMap& haplotype_posteriors) const;
     void filter_haplotypes(bool prefilter_had_removal_impact, const HaplotypeBlock& haplotypes,
@@ -250,7 +390,9 @@ private:
                        const boost::optional<GenomicRegion>& next_active_region,
                        const boost::optional<GenomicRegion>& backtrack_region,
                        const MappableFlatSet<Variant>& candidates, const HaplotypeBlock& haplotypes,
-                       const HaplotypeLikelihoodArray& haplotype_likelihoods, const ReadMap& reads,
+                       const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                       const HaplotypeLikelihoodArray& inference_likelihoods,
+                       const boost::optional<CompactLikelihoods>& compact_likelihoods, const ReadMap& reads,
                        const Latents& latents, std::deque<CallWrapper>& result,
                        boost::optional<GenomicRegion>& prev_called_region, GenomicRegion& completed_region) const;
     GenotypeCallMap get_genotype_calls(const Latents& latents) const;
@@ -258,18 +400,28 @@ private:
     void set_model_posteriors(std::vector<CallWrapper>& calls, const Latents& latents,
                               const HaplotypeBlock& haplotypes,
                               const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    void set_model_posteriors(std::vector<CallWrapper>& calls, const ModelPosterior& model_posterior) const;
     void set_phasing(std::vector<CallWrapper>& calls, const Latents& latents,
                      const HaplotypeBlock& haplotypes, const GenomicRegion& call_region) const;
     bool done_calling(const GenomicRegion& region) const noexcept;
     bool is_merge_block_refcalling() const noexcept;
     std::vector<CallWrapper> call_reference(const GenomicRegion& region, const ReadMap& reads) const;
+    HaplotypeBlock make_site_haplotypes(const std::vector<VcfRecord>& sites, const GenomicRegion& region) const;
+    std::vector<VcfRecord> genotype_sites(const std::vector<VcfRecord>& sites, const ReadMap& reads,
+                                          OptionalThreadPool workers) const;
     std::vector<CallWrapper> call_reference_helper(const std::vector<Allele>& alleles, const Latents& latents,
                                                    const ReadPileupMap& pileups) const;
+    boost::optional<std::vector<CallWrapper>>
+    call_reference_blocks(const GenomicRegion& region, const std::vector<CallWrapper>& calls,
+                          const Latents& latents, const ReadPileupMap& pileups) const;
     std::vector<Allele>
     generate_reference_alleles(const GenomicRegion& region,
                                const std::vector<CallWrapper>& calls) const;
     std::vector<Allele> generate_reference_alleles(const GenomicRegion& region) const;
     ReadPileupMap make_pileups(const ReadMap& reads, const Latents& latents, const GenomicRegion& region) const;
+    template <typename LikelihoodArray>
+    ReadPileupMap make_pileups(const ReadMap& reads, const Latents& latents, const GenomicRegion& region,
+                               const GenomicRegion& active_region, const LikelihoodArray& haplotype_likelihoods) const;
     std::vector<std::unique_ptr<ReferenceCall>>
     squash_reference_calls(std::vector<std::unique_ptr<ReferenceCall>> refcalls) const;
 };
@@ -147,6 +147,31 @@ CallerBuilder& CallerBuilder::set_bad_region_detector(BadRegionDetector detector
     return *this;
 }
 
+CallerBuilder& CallerBuilder::set_regenotype_sites(std::shared_ptr<const VcfReader> sites) noexcept
+{
+    components_.regenotype_sites = std::move(sites);
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_site_likelihoods(bool write) noexcept
+{
+    params_.general.site_likelihoods = write;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_candidate_cache(std::shared_ptr<coretools::CandidateCache> cache) noexcept
+{
+    components_.candidate_cache = std::move(cache);
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_samples(std::vector<SampleName> samples)
+{
+    components_.samples = std::move(samples);
+    factory_ = generate_factory(); // the factories hold a reference to the samples
+    return *this;
+}
+
 CallerBuilder& CallerBuilder::set_min_variant_posterior(Phred<double> posterior) noexcept
 {
     params_.min_variant_posterior = posterior;
@@ -177,12 +202,48 @@ CallerBuilder& CallerBuilder::set_min_phase_score(Phred<double> score) noexcept
     return *this;
 }
 
+CallerBuilder& CallerBuilder::set_phasing_algorithm(Phaser::Algorithm algorithm) noexcept
+{
+    params_.phasing_algorithm = algorithm;
+    return *this;
+}
+
 CallerBuilder& CallerBuilder::set_early_phase_detection_policy(bool use) noexcept
 {
     params_.general.try_early_phase_detection = use;
     return *this;
 }
 
+CallerBuilder& CallerBuilder::set_speculative_lookahead(bool use) noexcept
+{
+    params_.general.speculative_lookahead = use;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_region_prescreening(bool use) noexcept
+{
+    params_.general.prescreen_regions = use;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_time_budget(std::chrono::seconds budget) noexcept
+{
+    params_.general.time_budget = budget;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_compact_likelihood_bits(unsigned bits) noexcept
+{
+    params_.general.compact_likelihood_bits = bits;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_uninformative_read_spread(double spread) noexcept
+{
+    params_.general.uninformative_read_spread = spread;
+    return *this;
+}
+
 CallerBuilder& CallerBuilder::set_snp_heterozygosity(double heterozygosity) noexcept
 {
     params_.snp_heterozygosity = heterozygosity;
@@ -207,6 +268,12 @@ CallerBuilder& CallerBuilder::set_max_genotype_combinations(boost::optional<std:
     return *this;
 }
 
+CallerBuilder& CallerBuilder::set_min_kept_genotype_posterior(boost::optional<double> min) noexcept
+{
+    params_.min_kept_genotype_posterior = min;
+    return *this;
+}
+
 CallerBuilder& CallerBuilder::set_likelihood_model(HaplotypeLikelihoodModel model) noexcept
 {
     components_.likelihood_model = std::move(model);
@@ -390,14 +457,19 @@ std::unique_ptr<Caller> CallerBuilder::build(const ContigName& contig) const
 
 Caller::Components CallerBuilder::make_components() const
 {
+    Phaser::Config phaser_config {Phaser::GenotypeMatchType::exact, params_.min_phase_score};
+    phaser_config.algorithm = params_.phasing_algorithm;
     return {
         components_.reference,
         components_.read_pipe,
         components_.variant_generator_builder.build(components_.reference),
         components_.haplotype_generator_builder,
         components_.likelihood_model,
-        Phaser {Phaser::Config {Phaser::GenotypeMatchType::exact, params_.min_phase_score}},
-        components_.bad_region_detector
+        Phaser {phaser_config},
+        components_.bad_region_detector,
+        components_.regenotype_sites,
+        components_.candidate_cache,
+        components_.samples
     };
 }
 
@@ -447,7 +519,7 @@ auto make_trio_prior_model(boost::optional<double> snp_heterozygosity,
 
 CallerBuilder::CallerFactoryMap CallerBuilder::generate_factory() const
 {
-    const auto& samples = components_.read_pipe.get().samples();
+    const auto& samples = components_.samples ? *components_.samples : components_.read_pipe.get().samples();
     return CallerFactoryMap {
         {"individual", [this, &samples] () {
             return std::make_unique<IndividualCaller>(make_components(),
@@ -469,7 +541,8 @@ CallerBuilder::CallerFactoryMap CallerBuilder::generate_factory() const
                                                           make_population_prior_model(params_.snp_heterozygosity, params_.indel_heterozygosity),
                                                           params_.max_genotype_combinations,
                                                           params_.use_independent_genotype_priors,
-                                                          params_.deduplicate_haplotypes_with_caller_model
+                                                          params_.deduplicate_haplotypes_with_caller_model,
+                                                          params_.min_kept_genotype_posterior
                                                       });
         }},
         {"cancer", [this, &samples] () {
@@ -509,7 +582,8 @@ CallerBuilder::CallerFactoryMap CallerBuilder::generate_factory() const
                                                     params_.min_variant_posterior,
                                                     params_.min_denovo_posterior,
                                                     params_.max_genotype_combinations,
-                                                    params_.deduplicate_haplotypes_with_caller_model
+                                                    params_.deduplicate_haplotypes_with_caller_model,
+                                                    params_.min_kept_genotype_posterior
                                                 });
         }},
         {"polyclone", [this] () {
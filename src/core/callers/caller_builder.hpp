@@ -57,17 +57,28 @@ public:
     CallerBuilder& set_execution_policy(ExecutionPolicy policy) noexcept;
     CallerBuilder& set_read_linkage(ReadLinkageType linkage) noexcept;
     CallerBuilder& set_bad_region_detector(BadRegionDetector detector) noexcept;
+    CallerBuilder& set_regenotype_sites(std::shared_ptr<const VcfReader> sites) noexcept;
+    CallerBuilder& set_site_likelihoods(bool write) noexcept;
+    CallerBuilder& set_candidate_cache(std::shared_ptr<coretools::CandidateCache> cache) noexcept;
+    CallerBuilder& set_samples(std::vector<SampleName> samples);
     
     CallerBuilder& set_min_variant_posterior(Phred<double> posterior) noexcept;
     CallerBuilder& set_max_haplotypes(unsigned n) noexcept;
     CallerBuilder& set_haplotype_extension_threshold(double p) noexcept;
     CallerBuilder& set_model_posterior_policy(Caller::ModelPosteriorPolicy policy) noexcept;
     CallerBuilder& set_min_phase_score(Phred<double> score) noexcept;
+    CallerBuilder& set_phasing_algorithm(Phaser::Algorithm algorithm) noexcept;
     CallerBuilder& set_early_phase_detection_policy(bool use) noexcept;
+    CallerBuilder& set_speculative_lookahead(bool use) noexcept;
+    CallerBuilder& set_region_prescreening(bool use) noexcept;
+    CallerBuilder& set_time_budget(std::chrono::seconds budget) noexcept;
+    CallerBuilder& set_compact_likelihood_bits(unsigned bits) noexcept;
+    CallerBuilder& set_uninformative_read_spread(double spread) noexcept;
     CallerBuilder& set_snp_heterozygosity(double heterozygosity) noexcept;
     CallerBuilder& set_indel_heterozygosity(double heterozygosity) noexcept;
     CallerBuilder& set_max_genotypes(boost::optional<std::size_t> max) noexcept;
     CallerBuilder& set_max_genotype_combinations(boost::optional<std::size_t> max) noexcept;
+    CallerBuilder& set_min_kept_genotype_posterior(boost::optional<double> min) noexcept;
     CallerBuilder& set_likelihood_model(HaplotypeLikelihoodModel model) noexcept;
     CallerBuilder& set_model_based_haplotype_dedup(bool use) noexcept;
     CallerBuilder& set_independent_genotype_prior_flag(bool use_independent) noexcept;
@@ -120,6 +131,9 @@ private:
         HaplotypeLikelihoodModel likelihood_model;
         Phaser phaser;
         boost::optional<BadRegionDetector> bad_region_detector = boost::none;
+        std::shared_ptr<const VcfReader> regenotype_sites = nullptr;
+        std::shared_ptr<coretools::CandidateCache> candidate_cache = nullptr;
+        boost::optional<std::vector<SampleName>> samples = boost::none;
     };
     
     struct Parameters
@@ -130,7 +144,9 @@ private:
         Phred<double> min_variant_posterior;
         boost::optional<double> snp_heterozygosity, indel_heterozygosity;
         Phred<double> min_phase_score;
+        Phaser::Algorithm phasing_algorithm;
         boost::optional<std::size_t> max_genotypes, max_genotype_combinations;
+        boost::optional<double> min_kept_genotype_posterior;
         bool deduplicate_haplotypes_with_caller_model;
         bool use_independent_genotype_priors;
         boost::optional<unsigned> max_vb_seeds;
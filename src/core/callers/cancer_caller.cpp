@@ -13,6 +13,8 @@
 #include <stdexcept>
 #include <iostream>
 #include <limits>
+#include <future>
+#include <exception>
 
 #include <boost/iterator/zip_iterator.hpp>
 #include <boost/tuple/tuple.hpp>
@@ -142,16 +144,17 @@ CancerCaller::infer_latents(const HaplotypeBlock& haplotypes,
 {
     // Store any intermediate results in Latents for reuse, so the order of model evaluation matters!
     auto result = std::make_unique<Latents>(haplotypes, samples_, parameters_);
+    result->genotype_likelihoods_ = std::make_unique<model::GenotypeLikelihoodCache>(haplotype_likelihoods);
     set_model_priors(*result);
     generate_germline_genotypes(*result, result->indexed_haplotypes_);
     if (debug_log_) stream(*debug_log_) << "There are " << result->germline_genotypes_.size() << " candidate germline genotypes";
-    evaluate_germline_model(*result, haplotype_likelihoods);
-    evaluate_cnv_model(*result, haplotype_likelihoods, workers);
+    evaluate_germline_and_cnv_models(*result, haplotype_likelihoods, workers);
     if (haplotypes.size() > 1) {
         fit_somatic_model(*result, haplotype_likelihoods, workers);
         evaluate_noise_model(*result, haplotype_likelihoods);
         set_model_posteriors(*result);
     }
+    result->genotype_likelihoods_.reset(); // haplotype_likelihoods may change after inference
     return result;
 }
 
@@ -342,31 +345,106 @@ auto copy_greatest_probability_genotypes(const MappableBlock<G>& genotypes,
     return copy_greatest_probability_values(genotypes, probabilities, n, min_include_probability, max_exclude_probability);
 }
 
-auto calculate_posteriors_with_germline_likelihood_model(const MappableBlock<CancerGenotype<IndexedHaplotype<>>>& genotypes,
-                                                         const CancerGenotypePriorModel& prior_model,
-                                                         const model::ConstantMixtureGenotypeLikelihoodModel likelihood_model,
-                                                         const std::vector<SampleName>& samples)
+struct CancerGenotypeSelection
 {
-    auto result = evaluate(genotypes, prior_model);
+    MappableBlock<CancerGenotype<IndexedHaplotype<>>> genotypes;
+    std::size_t num_candidates;
+    boost::optional<double> pruned_log_mass;
+};
+
+// An upper bound on the log likelihood of any genotype: each read is assigned its most likely haplotype
+double calculate_max_log_likelihood(const MappableBlock<IndexedHaplotype<>>& haplotypes,
+                                    const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                    const std::vector<SampleName>& samples)
+{
+    double result {0};
     for (const auto& sample : samples) {
-        likelihood_model.cache().prime(sample);
-        std::transform(std::cbegin(genotypes), std::cend(genotypes), std::cbegin(result), std::begin(result),
-                       [&] (const auto& genotype, auto curr) {
-                           return curr + likelihood_model.evaluate(demote(genotype));
-                       });
+        const auto num_reads = haplotype_likelihoods.num_likelihoods(sample);
+        std::vector<double> max_read_log_likelihoods(num_reads, std::numeric_limits<double>::lowest());
+        for (const auto& haplotype : haplotypes) {
+            const auto& likelihoods = haplotype_likelihoods(sample, haplotype);
+            std::transform(std::cbegin(likelihoods), std::cend(likelihoods), std::cbegin(max_read_log_likelihoods),
+                           std::begin(max_read_log_likelihoods), [] (auto lhs, auto rhs) { return std::max<double>(lhs, rhs); });
+        }
+        result += std::accumulate(std::cbegin(max_read_log_likelihoods), std::cend(max_read_log_likelihoods), 0.0);
     }
-    maths::normalise_exp(result);
     return result;
 }
 
-void filter_with_germline_model(MappableBlock<CancerGenotype<IndexedHaplotype<>>>& genotypes,
-                                const CancerGenotypePriorModel& prior_model,
-                                const model::ConstantMixtureGenotypeLikelihoodModel likelihood_model,
-                                const std::vector<SampleName>& samples,
-                                const std::size_t n)
-{
-    const auto germline_model_posteriors = calculate_posteriors_with_germline_likelihood_model(genotypes, prior_model, likelihood_model, samples);
-    genotypes = copy_greatest_probability_genotypes(genotypes, germline_model_posteriors, n);
+/*
+    Streams the cancer genotypes (germline x somatic) and keeps the k with greatest posterior under the germline
+    likelihood model, so at most k genotypes are held at once. A candidate is not scored if its prior plus an upper
+    bound on its likelihood cannot beat the worst kept genotype. The (bounded) log mass of the discarded candidates,
+    relative to all candidates, is reported.
+ */
+CancerGenotypeSelection
+select_top_cancer_genotypes(const MappableBlock<Genotype<IndexedHaplotype<>>>& germline_genotypes,
+                            const MappableBlock<IndexedHaplotype<>>& haplotypes,
+                            const unsigned somatic_ploidy,
+                            const CancerGenotypePriorModel& prior_model,
+                            const model::GenotypeLikelihoodCache& genotype_likelihoods,
+                            const std::vector<SampleName>& samples,
+                            const std::size_t k)
+{
+    assert(k > 0);
+    const auto somatic_genotypes = generate_all_max_zygosity_genotypes(haplotypes, somatic_ploidy);
+    const auto max_log_likelihood = calculate_max_log_likelihood(haplotypes, genotype_likelihoods.haplotype_likelihoods(), samples);
+    struct ScoredCandidate
+    {
+        double score;
+        std::size_t germline, somatic;
+    };
+    const auto greater = [] (const ScoredCandidate& lhs, const ScoredCandidate& rhs) noexcept { return lhs.score > rhs.score; };
+    std::vector<ScoredCandidate> top {}; // min-heap on score
+    top.reserve(std::min(k, germline_genotypes.size() * somatic_genotypes.size()));
+    constexpr auto no_mass = std::numeric_limits<double>::lowest();
+    double pruned_log_mass {no_mass}, candidate_log_mass {no_mass};
+    const auto accumulate_log_mass = [] (double& total, const double log_mass) {
+        total = total == no_mass ? log_mass : maths::log_sum_exp(total, log_mass);
+    };
+    std::size_t num_candidates {0};
+    for (std::size_t g {0}; g < germline_genotypes.size(); ++g) {
+        for (std::size_t s {0}; s < somatic_genotypes.size(); ++s) {
+            if (have_shared(germline_genotypes[g], somatic_genotypes[s])) continue;
+            ++num_candidates;
+            const CancerGenotype<IndexedHaplotype<>> candidate {germline_genotypes[g], somatic_genotypes[s]};
+            const auto log_prior = prior_model.evaluate(candidate);
+            if (top.size() == k && log_prior + max_log_likelihood <= top.front().score) {
+                accumulate_log_mass(pruned_log_mass, log_prior + max_log_likelihood);
+                accumulate_log_mass(candidate_log_mass, log_prior + max_log_likelihood);
+                continue;
+            }
+            auto score = log_prior;
+            const auto demoted_candidate = demote(candidate);
+            for (const auto& sample : samples) {
+                score += genotype_likelihoods.evaluate(sample, demoted_candidate);
+            }
+            accumulate_log_mass(candidate_log_mass, score);
+            if (top.size() < k) {
+                top.push_back({score, g, s});
+                std::push_heap(std::begin(top), std::end(top), greater);
+            } else if (score > top.front().score) {
+                accumulate_log_mass(pruned_log_mass, top.front().score);
+                std::pop_heap(std::begin(top), std::end(top), greater);
+                top.back() = {score, g, s};
+                std::push_heap(std::begin(top), std::end(top), greater);
+            } else {
+                accumulate_log_mass(pruned_log_mass, score);
+            }
+        }
+    }
+    // Keep generation order
+    std::sort(std::begin(top), std::end(top), [] (const auto& lhs, const auto& rhs) {
+        return lhs.germline == rhs.germline ? lhs.somatic < rhs.somatic : lhs.germline < rhs.germline; });
+    CancerGenotypeSelection result {MappableBlock<CancerGenotype<IndexedHaplotype<>>> {mapped_region(haplotypes)}, num_candidates, boost::none};
+    result.genotypes.reserve(top.size());
+    for (const auto& candidate : top) {
+        result.genotypes.emplace_back(germline_genotypes[candidate.germline], somatic_genotypes[candidate.somatic]);
+    }
+    if (pruned_log_mass != no_mass) {
+        result.pruned_log_mass = pruned_log_mass - candidate_log_mass;
+    }
+    return result;
 }
 
 } // namespace
@@ -432,22 +510,13 @@ void CancerCaller::generate_cancer_genotypes_with_clean_normal(Latents& latents,
         latents.cancer_genotypes_.push_back(extend_somatic(old_cancer_genotype_bases, latents.indexed_haplotypes_));
         erase_duplicates(latents.cancer_genotypes_.back());
     } else {
-        assert(latents.germline_model_);
-        haplotype_likelihoods.prime(normal_sample());
-        latents.normal_germline_inferences_ = latents.germline_model_->evaluate(germline_genotypes, haplotype_likelihoods);
+        evaluate_normal_germline_model(latents);
         const auto& germline_normal_posteriors = latents.normal_germline_inferences_->posteriors.genotype_probabilities;
-        const auto max_germline_genotype_bases = calculate_max_germline_genotype_bases(max_allowed_cancer_genotypes, num_haplotypes, 1);
+        // Consider twice as many candidates as can be kept
+        const auto max_germline_genotype_bases = calculate_max_germline_genotype_bases(2 * max_allowed_cancer_genotypes, num_haplotypes, 1);
         MappableBlock<Genotype<IndexedHaplotype<>>> germline_bases;
         germline_bases = copy_greatest_probability_genotypes(germline_genotypes, germline_normal_posteriors, max_germline_genotype_bases, 1e-100, 1e-2);
-        latents.cancer_genotypes_.push_back(generate_all_cancer_genotypes(germline_bases, latents.indexed_haplotypes_, 1));
-        if (latents.cancer_genotypes_.size() > 2 * max_allowed_cancer_genotypes) {
-            if (!latents.cancer_genotype_prior_model_->mutation_model().is_primed()) {
-                latents.cancer_genotype_prior_model_->mutation_model().prime(latents.haplotypes_.get());
-            }
-            const model::ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
-            filter_with_germline_model(latents.cancer_genotypes_.back(), *latents.cancer_genotype_prior_model_,
-                                       likelihood_model, samples_, max_allowed_cancer_genotypes);
-        }
+        generate_top_cancer_genotypes(latents, germline_bases, haplotype_likelihoods);
     }
 }
 
@@ -489,7 +558,8 @@ void CancerCaller::generate_cancer_genotypes_with_no_normal(Latents& latents, co
         const auto old_cancer_genotype_bases = copy_greatest_probability_values(latents.cancer_genotypes_.back(), cancer_genotype_posteriors, max_old_cancer_genotype_bases);
         latents.cancer_genotypes_.push_back(extend_somatic(old_cancer_genotype_bases, latents.indexed_haplotypes_));
     } else {
-        const auto max_germline_genotype_bases = calculate_max_germline_genotype_bases(max_allowed_cancer_genotypes, num_haplotypes, 1);
+        // Consider twice as many candidates as can be kept
+        const auto max_germline_genotype_bases = calculate_max_germline_genotype_bases(2 * max_allowed_cancer_genotypes, num_haplotypes, 1);
         const auto& germline_genotype_posteriors = latents.germline_model_inferences_.posteriors.genotype_probabilities;
         std::vector<double> germline_model_haplotype_posteriors(num_haplotypes);
         for (std::size_t g {0}; g < germline_genotypes.size(); ++g) {
@@ -500,17 +570,38 @@ void CancerCaller::generate_cancer_genotypes_with_no_normal(Latents& latents, co
         const auto max_germline_haplotype_bases = max_num_elements(max_germline_genotype_bases, parameters_.ploidy);
         const auto top_haplotypes = copy_greatest_probability_values(latents.indexed_haplotypes_, germline_model_haplotype_posteriors,
                                                                      max_germline_haplotype_bases);
-        auto germline_bases = generate_all_genotypes(top_haplotypes, parameters_.ploidy);
-        latents.cancer_genotypes_.push_back(generate_all_cancer_genotypes(germline_bases, latents.indexed_haplotypes_, 1));
-        if (latents.cancer_genotypes_.size() > 2 * max_allowed_cancer_genotypes) {
-            if (!latents.cancer_genotype_prior_model_->mutation_model().is_primed()) {
-                latents.cancer_genotype_prior_model_->mutation_model().prime(latents.haplotypes_);
-            }
-            const model::ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
-            filter_with_germline_model(latents.cancer_genotypes_.back(), *latents.cancer_genotype_prior_model_,
-                                       likelihood_model, samples_, max_allowed_cancer_genotypes);
-        }
+        const auto germline_bases = generate_all_genotypes(top_haplotypes, parameters_.ploidy);
+        generate_top_cancer_genotypes(latents, germline_bases, haplotype_likelihoods);
+    }
+}
+
+std::size_t CancerCaller::calculate_max_cancer_genotypes(const unsigned somatic_ploidy) const
+{
+    assert(parameters_.max_genotypes);
+    auto result = *parameters_.max_genotypes;
+    if (target_max_memory()) {
+        const auto genotype_bytes = sizeof(CancerGenotype<IndexedHaplotype<>>) + (parameters_.ploidy + somatic_ploidy) * sizeof(IndexedHaplotype<>);
+        result = std::min(result, std::max(target_max_memory()->bytes() / genotype_bytes, std::size_t {1}));
+    }
+    return result;
+}
+
+void CancerCaller::generate_top_cancer_genotypes(Latents& latents,
+                                                 const MappableBlock<Genotype<IndexedHaplotype<>>>& germline_genotypes,
+                                                 const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    if (!latents.cancer_genotype_prior_model_->mutation_model().is_primed()) {
+        latents.cancer_genotype_prior_model_->mutation_model().prime(latents.haplotypes_);
+    }
+    const auto max_cancer_genotypes = calculate_max_cancer_genotypes(1);
+    auto selection = select_top_cancer_genotypes(germline_genotypes, latents.indexed_haplotypes_, 1, *latents.cancer_genotype_prior_model_,
+                                                 *latents.genotype_likelihoods_, samples_, max_cancer_genotypes);
+    if (debug_log_ && selection.pruned_log_mass) {
+        stream(*debug_log_) << "Kept " << selection.genotypes.size() << " of " << selection.num_candidates
+                            << " candidate cancer genotypes (max " << max_cancer_genotypes << "), pruning an estimated "
+                            << *selection.pruned_log_mass << " log posterior mass";
     }
+    latents.cancer_genotypes_.push_back(std::move(selection.genotypes));
 }
 
 void CancerCaller::generate_cancer_genotypes(Latents& latents, const MappableBlock<Genotype<IndexedHaplotype<>>>& germline_genotypes) const
@@ -523,15 +614,54 @@ bool CancerCaller::has_high_normal_contamination_risk(const Latents& latents) co
     return parameters_.normal_contamination_risk == Parameters::NormalContaminationRisk::high;
 }
 
-void CancerCaller::evaluate_germline_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+/*
+    The germline and CNV models are independent given the germline prior model, so the germline
+    model is evaluated in a worker while the CNV model is evaluated in the calling thread. The
+    germline model only uses the pooled likelihoods and the precomputed genotype priors, so does
+    not touch anything the CNV model uses.
+ */
+void CancerCaller::evaluate_germline_and_cnv_models(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods, OptionalThreadPool workers) const
 {
     assert(!(latents.indexed_haplotypes_.empty() || latents.germline_genotypes_.empty()));
     latents.germline_prior_model_ = make_germline_prior_model(latents.haplotypes_);
     latents.germline_model_ = std::make_unique<GermlineModel>(*latents.germline_prior_model_);
-    const auto pooled_likelihoods = haplotype_likelihoods.merge_samples();
     latents.germline_prior_model_->prime(latents.haplotypes_);
     latents.germline_model_->prime(latents.haplotypes_);
-    latents.germline_model_inferences_ = latents.germline_model_->evaluate(latents.germline_genotypes_, pooled_likelihoods);
+    latents.germline_genotype_log_priors_ = octopus::evaluate(latents.germline_genotypes_, *latents.germline_prior_model_);
+    const auto pooled_likelihoods = haplotype_likelihoods.merge_samples();
+    if (!(workers && workers->n_idle() > 0)) {
+        evaluate_germline_model(latents, pooled_likelihoods);
+        evaluate_cnv_model(latents, haplotype_likelihoods, workers);
+        return;
+    }
+    auto germline_model = workers->try_push([&] () { evaluate_germline_model(latents, pooled_likelihoods); });
+    // The germline task must finish before returning, as it references this frame
+    std::exception_ptr error {};
+    try {
+        evaluate_cnv_model(latents, haplotype_likelihoods, workers);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    workers->wait(germline_model);
+    try {
+        germline_model.get();
+    } catch (...) {
+        if (!error) error = std::current_exception();
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void CancerCaller::evaluate_germline_model(Latents& latents, const HaplotypeLikelihoodArray& pooled_likelihoods) const
+{
+    assert(latents.germline_model_ && latents.germline_genotype_log_priors_.size() == latents.germline_genotypes_.size());
+    latents.germline_model_inferences_ = latents.germline_model_->evaluate(latents.germline_genotypes_, latents.germline_genotype_log_priors_, pooled_likelihoods);
+}
+
+void CancerCaller::evaluate_normal_germline_model(Latents& latents) const
+{
+    assert(latents.germline_model_ && latents.genotype_likelihoods_);
+    auto normal_likelihoods = latents.genotype_likelihoods_->evaluate(normal_sample(), latents.germline_genotypes_);
+    latents.normal_germline_inferences_ = latents.germline_model_->evaluate(latents.germline_genotype_log_priors_, std::move(normal_likelihoods));
 }
 
 void CancerCaller::evaluate_cnv_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods, OptionalThreadPool workers) const
@@ -543,6 +673,7 @@ void CancerCaller::evaluate_cnv_model(Latents& latents, const HaplotypeLikelihoo
     params.target_max_memory = this->target_max_memory();
     CNVModel cnv_model {samples_, cnv_model_priors, params};
     cnv_model.prime(latents.haplotypes_);
+    cnv_model.share_likelihoods(*latents.genotype_likelihoods_);
     latents.cnv_model_inferences_ = cnv_model.evaluate(latents.germline_genotypes_, haplotype_likelihoods, {}, workers);
 }
 
@@ -560,6 +691,7 @@ void CancerCaller::evaluate_somatic_model(Latents& latents, const HaplotypeLikel
         latents.cancer_genotype_prior_model_->mutation_model().prime(latents.haplotypes_);
     }
     model.prime(latents.haplotypes_);
+    model.share_likelihoods(*latents.genotype_likelihoods_);
     latents.somatic_model_inferences_.push_back(model.evaluate(latents.cancer_genotypes_.back(), haplotype_likelihoods, {}, workers));
 }
 
@@ -573,9 +705,7 @@ void CancerCaller::evaluate_noise_model(Latents& latents, const HaplotypeLikelih
 {
     if (has_normal_sample() && !has_high_normal_contamination_risk(latents)) {
         if (!latents.normal_germline_inferences_) {
-            assert(latents.germline_model_);
-            haplotype_likelihoods.prime(normal_sample());
-            latents.normal_germline_inferences_ = latents.germline_model_->evaluate(latents.germline_genotypes_, haplotype_likelihoods);
+            evaluate_normal_germline_model(latents);
         }
         assert(latents.cancer_genotype_prior_model_);
         auto noise_model_priors = get_noise_model_priors(*latents.cancer_genotype_prior_model_, latents.inferred_somatic_ploidy_);
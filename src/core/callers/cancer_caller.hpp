@@ -21,6 +21,7 @@
 #include "core/models/mutation/somatic_mutation_model.hpp"
 #include "core/models/genotype/individual_model.hpp"
 #include "core/models/genotype/subclone_model.hpp"
+#include "core/models/genotype/genotype_likelihood_cache.hpp"
 #include "basics/phred.hpp"
 #include "caller.hpp"
 
@@ -149,10 +150,15 @@ private:
     void generate_cancer_genotypes_with_clean_normal(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     void generate_cancer_genotypes_with_contaminated_normal(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     void generate_cancer_genotypes_with_no_normal(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    std::size_t calculate_max_cancer_genotypes(unsigned somatic_ploidy) const;
+    void generate_top_cancer_genotypes(Latents& latents, const GenotypeVector& germline_genotypes,
+                                       const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     void generate_cancer_genotypes(Latents& latents, const MappableBlock<Genotype<IndexedHaplotype<>>>& germline_genotypes) const;
     bool has_high_normal_contamination_risk(const Latents& latents) const;
     
-    void evaluate_germline_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    void evaluate_germline_and_cnv_models(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods, OptionalThreadPool workers) const;
+    void evaluate_germline_model(Latents& latents, const HaplotypeLikelihoodArray& pooled_likelihoods) const;
+    void evaluate_normal_germline_model(Latents& latents) const;
     void evaluate_cnv_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods, OptionalThreadPool workers) const;
     void evaluate_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods, OptionalThreadPool workers) const;
     void evaluate_noise_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
@@ -209,8 +215,11 @@ private:
     std::unique_ptr<GenotypePriorModel> germline_prior_model_ = nullptr;
     boost::optional<CancerGenotypePriorModel> cancer_genotype_prior_model_ = boost::none;
     std::unique_ptr<GermlineModel> germline_model_ = nullptr;
+    // genotype likelihoods shared by the models while they are inferred
+    std::unique_ptr<model::GenotypeLikelihoodCache> genotype_likelihoods_ = nullptr;
     // germline and CNV model
     MappableBlock<Genotype<IndexedHaplotype<>>> germline_genotypes_;
+    std::vector<double> germline_genotype_log_priors_;
     GermlineModel::InferredLatents germline_model_inferences_;
     CNVModel::InferredLatents cnv_model_inferences_;
     // somatic model
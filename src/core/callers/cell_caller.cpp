@@ -327,6 +327,74 @@ bool includes(const std::vector<SampleName>& samples, const SampleName& sample)
     return std::binary_search(std::cbegin(samples), std::cend(samples), sample);
 }
 
+// One ploidy per phylogeny group, indexed by group id
+using PloidyAssignment = std::vector<unsigned>;
+
+// Every assignment of copy changes to the non-founder groups is evaluated when there are at most this many,
+// otherwise a beam search is used so the number evaluated is polynomial in the number of clones
+constexpr std::size_t maxExhaustiveCopyChangeAssignments {64};
+constexpr std::size_t copyChangeBeamWidth {3};
+
+std::size_t num_copy_change_assignments(const unsigned clones, const std::size_t num_ploidies) noexcept
+{
+    std::size_t result {1};
+    for (unsigned id {1}; id < clones; ++id) {
+        if (result > maxExhaustiveCopyChangeAssignments) break;
+        result *= num_ploidies;
+    }
+    return result - 1;
+}
+
+// Evaluates ploidy assignments where the founder has the default ploidy and at least one other group does not.
+// evaluate returns the evidence of an assignment, or none if it was not evaluated.
+template <typename Evaluator>
+void search_copy_changes(const unsigned clones, const unsigned default_ploidy, const unsigned max_loss, const unsigned max_gain,
+                         const double default_log_evidence, Evaluator&& evaluate)
+{
+    const unsigned min_ploidy {default_ploidy - max_loss}, max_ploidy {default_ploidy + max_gain};
+    PloidyAssignment assignment(clones, default_ploidy);
+    if (num_copy_change_assignments(clones, max_ploidy - min_ploidy + 1) <= maxExhaustiveCopyChangeAssignments) {
+        // In lexicographic order
+        std::fill(std::next(std::begin(assignment)), std::end(assignment), min_ploidy);
+        while (true) {
+            if (std::any_of(std::next(std::cbegin(assignment)), std::cend(assignment), [=] (auto ploidy) { return ploidy != default_ploidy; })) {
+                evaluate(assignment);
+            }
+            auto id = clones - 1;
+            for (; id > 0 && assignment[id] == max_ploidy; --id) assignment[id] = min_ploidy;
+            if (id == 0) break;
+            ++assignment[id];
+        }
+    } else {
+        // Each step changes the ploidy of one more group in the best assignments of the previous step, and
+        // only assignments with more evidence than the best of the previous step are extended
+        std::vector<std::pair<double, PloidyAssignment>> beam {{default_log_evidence, assignment}};
+        for (unsigned step {1}; step < clones && !beam.empty(); ++step) {
+            const auto min_log_evidence = beam.front().first;
+            std::vector<std::pair<double, PloidyAssignment>> candidates {};
+            for (const auto& p : beam) {
+                for (std::size_t id {1}; id < clones; ++id) {
+                    if (p.second[id] != default_ploidy) continue;
+                    auto next = p.second;
+                    for (auto ploidy = min_ploidy; ploidy <= max_ploidy; ++ploidy) {
+                        if (ploidy == default_ploidy) continue;
+                        next[id] = ploidy;
+                        const auto log_evidence = evaluate(next);
+                        if (log_evidence && *log_evidence > min_log_evidence) {
+                            candidates.emplace_back(*log_evidence, next);
+                        }
+                    }
+                }
+            }
+            const auto num_kept = std::min(candidates.size(), copyChangeBeamWidth);
+            std::partial_sort(std::begin(candidates), std::next(std::begin(candidates), num_kept), std::end(candidates),
+                              [] (const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+            candidates.resize(num_kept);
+            beam = std::move(candidates);
+        }
+    }
+}
+
 } // namespace
 
 std::unique_ptr<CellCaller::Caller::Latents>
@@ -359,7 +427,7 @@ CellCaller::infer_latents(const HaplotypeBlock& haplotypes,
     const auto genotype_prior_model = make_prior_model(haplotypes);
     genotype_prior_model->prime(haplotypes);
     DeNovoModel mutation_model {parameters_.mutation_model_parameters};
-    mutation_model.prime(haplotypes);
+    mutation_model.prime(haplotypes, workers);
     model::SingleCellPriorModel::Parameters cell_prior_params {};
     cell_prior_params.copy_number_prior = parameters_.somatic_cnv_prior;
     model::SingleCellModel::Parameters model_parameters {};
@@ -375,10 +443,10 @@ CellCaller::infer_latents(const HaplotypeBlock& haplotypes,
     model_parameters.group_concentration = parameters_.clone_concentration;
     model::SingleCellModel::AlgorithmParameters config {};
     config.max_genotype_combinations = *parameters_.max_genotype_combinations;
-    config.execution_policy = this->exucution_policy();
     if (parameters_.max_vb_seeds) config.max_seeds = *parameters_.max_vb_seeds;
     CoalescentPopulationPriorModel population_prior_model {{Haplotype {mapped_region(haplotypes), reference_}, {}}};
     population_prior_model.prime(haplotypes);
+    model::SingleCellModel::CellCache cell_cache {};
     using SingleCellModelInferences = model::SingleCellModel::Inferences;
     std::vector<std::vector<SingleCellModelInferences>> inferences {};
     double max_log_evidence {};
@@ -409,50 +477,48 @@ CellCaller::infer_latents(const HaplotypeBlock& haplotypes,
                 }
                 model::SingleCellPriorModel phylogeny_prior_model {std::move(phylogeny), *genotype_prior_model, mutation_model, cell_prior_params};
                 const model::SingleCellModel phylogeny_model {samples_, std::move(phylogeny_prior_model), model_parameters, config, population_prior_model};
-                auto phylogeny_inferences = phylogeny_model.evaluate(genotypes, haplotype_likelihoods);
+                auto phylogeny_inferences = phylogeny_model.evaluate(genotypes, haplotype_likelihoods, workers, cell_cache);
                 log(phylogeny_inferences, samples_, genotypes, debug_log_);
                 
                 if (clones > 1 && copy_number_change_detection_enabled) {
-                    std::vector<unsigned> phylogeny_ploidy_assignments((1 + parameters_.max_copy_loss + parameters_.max_copy_gain) * (clones - 1));
-                    auto assignment_itr = std::begin(phylogeny_ploidy_assignments);
-                    for (auto ploidy = parameters_.ploidy - parameters_.max_copy_loss; ploidy <= parameters_.ploidy + parameters_.max_copy_gain; ++ploidy) {
-                        assignment_itr = std::fill_n(assignment_itr, clones - 1, ploidy);
-                    }
+                    using PloidyLabeledPhylogeny = Phylogeny<std::size_t, unsigned>;
+                    std::deque<PloidyLabeledPhylogeny> evaluated_phylogenies {};
                     std::unordered_map<std::size_t, unsigned> phylogeny_ploidies {};
                     phylogeny_ploidies.reserve(clones);
                     bool can_ignore_future_copy_changes {false};
-                    using PloidyLabeledPhylogeny = Phylogeny<std::size_t, unsigned>;
-                    std::deque<PloidyLabeledPhylogeny> evaluated_phylogenies {};
-                    do {
-                        if (phylogeny_ploidy_assignments[0] == parameters_.ploidy) {
-                            for (std::size_t id {0}; id < clones; ++id) {
-                                phylogeny_ploidies[id] = phylogeny_ploidy_assignments[id];
-                            }
-                            auto labeled_phylogeny = phylogeny_model.prior_model().phylogeny().transform([&] (const auto&) { return 0u; });
-                            for (const auto& p : phylogeny_ploidies) {
-                                labeled_phylogeny.group(p.first).value = p.second;
-                            }
-                            const auto is_isomorphic = [&] (const auto& other) { return labeled_phylogeny.is_isomorphism(other); };
-                            if (std::none_of(std::cbegin(evaluated_phylogenies), std::cend(evaluated_phylogenies), is_isomorphic)) {
-                                try {
-                                    auto phylogeny_copy_inferences = phylogeny_model.evaluate(phylogeny_ploidies, copy_change_genotypes, haplotype_likelihoods);
-                                    log(phylogeny_copy_inferences, samples_, copy_change_genotypes, debug_log_);
-                                    if (phylogeny_copy_inferences.log_evidence > phylogeny_inferences.log_evidence) {
-                                        phylogeny_inferences = std::move(phylogeny_copy_inferences);
-                                        copy_change_predicted = true;
-                                        can_ignore_future_copy_changes = false;
-                                    } else if (phylogeny_copy_inferences.log_evidence > max_log_evidence) {
-                                        can_ignore_future_copy_changes = false;
-                                    }
-                                    phylogeny_ploidies.clear();
-                                    evaluated_phylogenies.push_back(std::move(labeled_phylogeny));
-                                } catch (const model::SingleCellModel::NoViableGenotypeCombinationsError&) {
-                                    can_ignore_future_copy_changes = true;
-                                    break;
-                                }
-                            }
+                    // Returns the evidence of the assignment, or none if an isomorphic assignment was already evaluated
+                    const auto evaluate_ploidies = [&] (const PloidyAssignment& assignment) -> boost::optional<double> {
+                        auto labeled_phylogeny = phylogeny_model.prior_model().phylogeny().transform([&] (const auto&) { return 0u; });
+                        for (std::size_t id {0}; id < clones; ++id) {
+                            labeled_phylogeny.group(id).value = assignment[id];
+                        }
+                        const auto is_isomorphic = [&] (const auto& other) { return labeled_phylogeny.is_isomorphism(other); };
+                        if (std::any_of(std::cbegin(evaluated_phylogenies), std::cend(evaluated_phylogenies), is_isomorphic)) {
+                            return boost::none;
                         }
-                    } while (std::next_permutation(std::begin(phylogeny_ploidy_assignments), std::end(phylogeny_ploidy_assignments)));
+                        for (std::size_t id {0}; id < clones; ++id) {
+                            phylogeny_ploidies[id] = assignment[id];
+                        }
+                        auto phylogeny_copy_inferences = phylogeny_model.evaluate(phylogeny_ploidies, copy_change_genotypes, haplotype_likelihoods, workers, cell_cache);
+                        log(phylogeny_copy_inferences, samples_, copy_change_genotypes, debug_log_);
+                        const auto log_evidence = phylogeny_copy_inferences.log_evidence;
+                        if (log_evidence > phylogeny_inferences.log_evidence) {
+                            phylogeny_inferences = std::move(phylogeny_copy_inferences);
+                            copy_change_predicted = true;
+                            can_ignore_future_copy_changes = false;
+                        } else if (log_evidence > max_log_evidence) {
+                            can_ignore_future_copy_changes = false;
+                        }
+                        phylogeny_ploidies.clear();
+                        evaluated_phylogenies.push_back(std::move(labeled_phylogeny));
+                        return log_evidence;
+                    };
+                    try {
+                        search_copy_changes(clones, parameters_.ploidy, parameters_.max_copy_loss, parameters_.max_copy_gain,
+                                            phylogeny_inferences.log_evidence, evaluate_ploidies);
+                    } catch (const model::SingleCellModel::NoViableGenotypeCombinationsError&) {
+                        can_ignore_future_copy_changes = true;
+                    }
                     if (can_ignore_future_copy_changes) copy_number_change_detection_enabled = false;
                 }
                 clone_inferences.push_back(std::move(phylogeny_inferences));
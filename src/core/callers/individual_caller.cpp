@@ -146,9 +146,8 @@ IndividualCaller::infer_latents(const HaplotypeBlock& haplotypes,
     const auto indexed_haplotypes = index(haplotypes);
     auto genotypes = propose_genotypes(haplotypes, indexed_haplotypes, haplotype_likelihoods);
     if (debug_log_) stream(*debug_log_) << "There are " << genotypes.size() << " candidate genotypes";
-    auto prior_model = make_prior_model(haplotypes);
-    prior_model->prime(haplotypes);
-    model::IndividualModel model {*prior_model, debug_log_, trace_log_};
+    const auto& prior_model = prior_model_cache_.get(haplotypes, [this] (const auto& block) { return make_prior_model(block); });
+    model::IndividualModel model {prior_model, debug_log_, trace_log_};
     model.prime(haplotypes);
     haplotype_likelihoods.prime(sample());
     auto inferences = model.evaluate(genotypes, haplotype_likelihoods);
@@ -181,9 +180,8 @@ IndividualCaller::calculate_model_posterior(const HaplotypeBlock& haplotypes,
 {
     const auto indexed_haplotypes = index(haplotypes);
     const auto genotypes = propose_model_check_genotypes(haplotypes, indexed_haplotypes, latents);
-    const auto prior_model = make_prior_model(haplotypes);
-    prior_model->prime(haplotypes);
-    const model::IndividualModel model {*prior_model, debug_log_};
+    const auto& prior_model = prior_model_cache_.get(haplotypes, [this] (const auto& block) { return make_prior_model(block); });
+    const model::IndividualModel model {prior_model, debug_log_};
     haplotype_likelihoods.prime(sample());
     const auto inferences = model.evaluate(genotypes, haplotype_likelihoods);
     ModelPosterior result {};
@@ -513,6 +511,79 @@ auto marginalise_homozygous(const Allele& allele, const GenotypeProbabilityMap&
 
 using ReadPileupRange = ContainedRange<ReadPileups::const_iterator>;
 
+// Log likelihood terms of a read observation with each base quality, computed once so that reference
+// confidence can be computed column by column
+struct ObservationLogLikelihoods
+{
+    std::array<double, 256> error, not_error, heterozygous;
+    ObservationLogLikelihoods()
+    {
+        const auto phred_to_ln = [] (auto phred) { return phred * -maths::constants::ln10Div10<>; };
+        const auto phred_to_not_ln = [] (auto phred) { return std::log(1.0 - std::pow(10.0, -phred / 10.0)); };
+        for (unsigned q {0}; q < 256; ++q) {
+            error[q] = phred_to_ln(static_cast<AlignedRead::BaseQuality>(q));
+            not_error[q] = phred_to_not_ln(static_cast<AlignedRead::BaseQuality>(q));
+            heterozygous[q] = maths::log_sum_exp(not_error[q], error[q]) - std::log(2);
+        }
+    }
+};
+
+static const ObservationLogLikelihoods observation_log_likelihoods {};
+
+// The probability the pileups are not homozygous reference. Reference observations are summed as they are
+// seen, and non-reference observations after them.
+template <typename PileupIterator>
+Phred<double> compute_reference_quality(PileupIterator first_pileup, const PileupIterator last_pileup,
+                                        const Allele::NucleotideSequence& reference, std::size_t reference_idx,
+                                        std::vector<AlignedRead::BaseQuality>& non_reference_qualities)
+{
+    const auto& lls = observation_log_likelihoods;
+    non_reference_qualities.clear();
+    std::size_t depth {0};
+    double hom_ref_ln_likelihood {0}, het_alt_ln_likelihood {0};
+    const auto add_reference = [&] (AlignedRead::BaseQuality q) {
+        q = std::max(q, AlignedRead::BaseQuality {1});
+        hom_ref_ln_likelihood += lls.not_error[q];
+        het_alt_ln_likelihood += lls.heterozygous[q];
+        ++depth;
+    };
+    Allele::NucleotideSequence reference_sequence {};
+    for (; first_pileup != last_pileup; ++first_pileup) {
+        reference_sequence.assign(1, reference[reference_idx++]);
+        first_pileup->summaries([&] (const auto& sequence, const auto& summaries) {
+            if (sequence == reference_sequence) {
+                for (const auto& summary : summaries) {
+                    for (const auto base_quality : summary.base_qualities) {
+                        add_reference(std::min(base_quality, summary.mapping_quality));
+                    }
+                }
+            } else if (sequence.size() != reference_sequence.size()) {
+                // indel
+                constexpr ReadPileup::BaseQuality indel_base_quality {30};
+                for (const auto& summary : summaries) {
+                    non_reference_qualities.push_back(std::min(indel_base_quality, summary.mapping_quality));
+                }
+            } else {
+                // snv/mnv
+                for (const auto& summary : summaries) {
+                    for (const auto base_quality : summary.base_qualities) {
+                        non_reference_qualities.push_back(std::min(base_quality, summary.mapping_quality));
+                    }
+                }
+            }
+        });
+    }
+    depth += non_reference_qualities.size();
+    if (depth == 0) return Phred<double> {3.0};
+    for (auto q : non_reference_qualities) {
+        q = std::max(q, AlignedRead::BaseQuality {1});
+        hom_ref_ln_likelihood += lls.error[q];
+        het_alt_ln_likelihood += lls.heterozygous[q];
+    }
+    const auto het_ln_posterior = het_alt_ln_likelihood - maths::log_sum_exp(hom_ref_ln_likelihood, het_alt_ln_likelihood);
+    return log_probability_false_to_phred(het_ln_posterior);
+}
+
 auto compute_homozygous_posterior(const Allele& allele,
                                   const GenotypeProbabilityMap& genotype_posteriors,
                                   const GenotypeProbabilityMap& genotype_log_posteriors,
@@ -522,53 +593,8 @@ auto compute_homozygous_posterior(const Allele& allele,
     if (has_variation(allele, genotype_posteriors)) {
         return marginalise_homozygous(allele, genotype_log_posteriors);
     } else {
-        std::vector<AlignedRead::BaseQuality> reference_qualities {}, non_reference_qualities {};
-        Allele::NucleotideSequence reference_sequence {};
-        std::size_t reference_idx {0};
-        for (const ReadPileup& pileup : pileups) {
-            reference_sequence.assign(1, allele.sequence()[reference_idx++]);
-            pileup.summaries([&] (const auto& sequence, const auto& summaries) {
-                if (sequence == reference_sequence) {
-                    for (const auto& summary : summaries) {
-                        for (const auto base_quality : summary.base_qualities) {
-                            reference_qualities.push_back(std::min(base_quality, summary.mapping_quality));
-                        }
-                    }
-                } else if (sequence.size() != reference_sequence.size()) {
-                    // indel
-                    constexpr ReadPileup::BaseQuality indel_base_quality {30};
-                    for (const auto& summary : summaries) {
-                        non_reference_qualities.push_back(std::min(indel_base_quality, summary.mapping_quality));
-                    }
-                } else {
-                    // snv/mnv
-                    for (const auto& summary : summaries) {
-                        for (const auto base_quality : summary.base_qualities) {
-                            non_reference_qualities.push_back(std::min(base_quality, summary.mapping_quality));
-                        }
-                    }
-                }
-            });
-        }
-        const auto depth = reference_qualities.size() + non_reference_qualities.size();
-        if (depth == 0) return Phred<double> {3.0};
-        for (auto& q : reference_qualities) q = std::max(q, AlignedRead::BaseQuality {1});
-        for (auto& q : non_reference_qualities) q = std::max(q, AlignedRead::BaseQuality {1});
-        std::vector<double> reference_ln_likelihoods(depth), non_reference_ln_likelihoods(depth);
-        const auto phred_to_ln = [] (auto phred) { return phred * -maths::constants::ln10Div10<>; };
-        const auto phred_to_not_ln = [] (auto phred) { return std::log(1.0 - std::pow(10.0, -phred / 10.0)); };
-        auto itr = std::transform(std::cbegin(reference_qualities), std::cend(reference_qualities),
-                                  std::begin(reference_ln_likelihoods), phred_to_not_ln);
-        std::transform(std::cbegin(non_reference_qualities), std::cend(non_reference_qualities), itr, phred_to_ln);
-        itr = std::transform(std::cbegin(reference_qualities), std::cend(reference_qualities),
-                             std::begin(non_reference_ln_likelihoods), phred_to_ln);
-        std::transform(std::cbegin(non_reference_qualities), std::cend(non_reference_qualities), itr, phred_to_not_ln);
-        auto hom_ref_ln_likelihood = std::accumulate(std::cbegin(reference_ln_likelihoods), std::cend(reference_ln_likelihoods), 0.0);
-        auto het_alt_ln_likelihood = std::inner_product(std::cbegin(reference_ln_likelihoods), std::cend(reference_ln_likelihoods),
-                                                        std::cbegin(non_reference_ln_likelihoods), 0.0, std::plus<> {},
-                                                        [] (auto ref, auto alt) { return maths::log_sum_exp(ref, alt) - std::log(2); });
-        const auto het_ln_posterior = het_alt_ln_likelihood - maths::log_sum_exp(hom_ref_ln_likelihood, het_alt_ln_likelihood);
-        return log_probability_false_to_phred(het_ln_posterior);
+        std::vector<AlignedRead::BaseQuality> non_reference_qualities {};
+        return compute_reference_quality(std::cbegin(pileups), std::cend(pileups), allele.sequence(), 0, non_reference_qualities);
     }
 }
 
@@ -625,6 +651,39 @@ IndividualCaller::call_reference(const std::vector<Allele>& alleles,
     return transform_calls(std::move(calls), sample(), parameters_.ploidy);
 }
 
+boost::optional<Caller::ReferenceQualities>
+IndividualCaller::compute_reference_qualities(const Allele& reference,
+                                              const Caller::Latents& latents,
+                                              const ReadPileupMap& pileups) const
+{
+    const auto& individual_latents = dynamic_cast<const Latents&>(latents);
+    const auto& genotype_posteriors = (*individual_latents.genotype_posteriors())[sample()];
+    const auto& genotype_log_posteriors = (*individual_latents.genotype_log_posteriors())[sample()];
+    const auto& sample_pileups = pileups.at(sample());
+    ReferenceQualities result {{}, {parameters_.ploidy}};
+    const auto num_positions = region_size(reference);
+    result.positions.reserve(num_positions);
+    // Only positions in the genotype region can have variation
+    boost::optional<GenomicRegion> genotype_region {};
+    if (!genotype_posteriors.empty()) genotype_region = mapped_region(genotype_posteriors);
+    auto pileup_itr = std::lower_bound(std::cbegin(sample_pileups), std::cend(sample_pileups), mapped_begin(reference),
+                                       [] (const ReadPileup& pileup, const auto position) { return mapped_begin(pileup) < position; });
+    std::vector<AlignedRead::BaseQuality> non_reference_qualities {};
+    for (std::size_t idx {0}; idx < num_positions; ++idx, ++pileup_itr) {
+        const auto position = mapped_begin(reference) + static_cast<GenomicRegion::Position>(idx);
+        assert(pileup_itr != std::cend(sample_pileups) && mapped_begin(*pileup_itr) == position);
+        if (genotype_region && contains(genotype_region->contig_region(), ContigRegion {position, position + 1})) {
+            const Allele allele {GenomicRegion {contig_name(reference), position, position + 1}, reference.sequence().substr(idx, 1)};
+            if (has_variation(allele, genotype_posteriors)) {
+                result.positions.push_back(marginalise_homozygous(allele, genotype_log_posteriors));
+                continue;
+            }
+        }
+        result.positions.push_back(compute_reference_quality(pileup_itr, std::next(pileup_itr), reference.sequence(), idx, non_reference_qualities));
+    }
+    return result;
+}
+
 const SampleName& IndividualCaller::sample() const noexcept
 {
     return samples_.front();
@@ -719,9 +778,8 @@ IndividualCaller::propose_genotypes(const HaplotypeBlock& haplotypes,
         }
         if (debug_log_) stream(*debug_log_) << "Starting genotype reduction with ploidy " << ploidy;
         result = generate_all_genotypes(indexed_haplotypes, ploidy);
-        auto prior_model = make_prior_model(haplotypes);
-        prior_model->prime(haplotypes);
-        model::IndividualModel model {*prior_model};
+        const auto& prior_model = prior_model_cache_.get(haplotypes, [this] (const auto& block) { return make_prior_model(block); });
+        model::IndividualModel model {prior_model};
         model.prime(haplotypes);
         haplotype_likelihoods.prime(sample());
         for (; ploidy < parameters_.ploidy; ++ploidy) {
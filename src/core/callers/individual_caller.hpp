@@ -16,6 +16,7 @@
 #include "core/types/genotype.hpp"
 #include "core/models/mutation/coalescent_model.hpp"
 #include "core/models/genotype/genotype_prior_model.hpp"
+#include "core/models/genotype/prior_model_cache.hpp"
 #include "core/models/genotype/individual_model.hpp"
 #include "caller.hpp"
 
@@ -61,6 +62,8 @@ private:
     using GenotypeBlock = MappableBlock<Genotype<IndexedHaplotype<>>>;
     
     Parameters parameters_;
+    // The prior model primed on the current window's haplotypes, shared by all inference steps
+    mutable PriorModelCache<GenotypePriorModel> prior_model_cache_;
     
     std::string do_name() const override;
     CallTypeSet do_call_types() const override;
@@ -99,6 +102,10 @@ private:
     call_reference(const std::vector<Allele>& alleles, const Latents& latents,
                    const ReadPileupMap& pileups) const;
     
+    boost::optional<ReferenceQualities>
+    compute_reference_qualities(const Allele& reference, const Caller::Latents& latents,
+                                const ReadPileupMap& pileups) const override;
+    
     const SampleName& sample() const noexcept;
     
     std::unique_ptr<GenotypePriorModel> make_prior_model(const HaplotypeBlock& haplotypes) const;
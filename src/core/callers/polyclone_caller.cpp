@@ -20,8 +20,10 @@
 #include "core/types/variant.hpp"
 #include "core/types/calls/polyclone_variant_call.hpp"
 #include "core/types/calls/reference_call.hpp"
+#include "core/types/packed_genotype_block.hpp"
 #include "core/models/genotype/uniform_genotype_prior_model.hpp"
 #include "core/models/genotype/coalescent_genotype_prior_model.hpp"
+#include "core/models/genotype/constant_mixture_genotype_likelihood_model.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/read_stats.hpp"
 #include "utils/concat.hpp"
@@ -490,6 +492,30 @@ void reduce(GenotypeBlock& genotypes,
     reduce(genotypes, approx_posteriors, n);
 }
 
+// Equivalent to generating all max zygosity genotypes and reducing them, but only n genotypes are materialised
+MappableBlock<Genotype<IndexedHaplotype<>>>
+generate_top_max_zygosity_genotypes(const MappableBlock<IndexedHaplotype<>>& haplotypes,
+                                    const unsigned ploidy,
+                                    const GenotypePriorModel& genotype_prior_model,
+                                    const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                    const std::size_t n)
+{
+    const GenotypeIndexRange genotypes {static_cast<unsigned>(haplotypes.size()), ploidy, true};
+    const model::ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
+    const auto approx_log_posterior = [&] (const PackedGenotype& genotype) {
+        return likelihood_model.evaluate(genotype) + genotype_prior_model.evaluate(unpack(genotype, haplotypes));
+    };
+    const auto top_ranks = select_top_k_genotypes(genotypes, n, approx_log_posterior);
+    MappableBlock<Genotype<IndexedHaplotype<>>> result {mapped_region(haplotypes)};
+    result.reserve(top_ranks.size());
+    std::vector<PackedGenotype::HaplotypeIndex> indices(ploidy);
+    for (const auto rank : top_ranks) {
+        genotypes.unrank(rank, indices.data());
+        result.push_back(unpack(PackedGenotype {indices.data(), ploidy}, haplotypes));
+    }
+    return result;
+}
+
 auto make_hint(const std::size_t num_genotypes, const std::size_t idx, const double mass = 0.9999)
 {
     model::SubcloneModel::Latents::LogProbabilityVector result(num_genotypes, num_genotypes > 1 ? std::log((1 - mass) / (num_genotypes - 1)) : 0);
@@ -609,7 +635,13 @@ PolycloneCaller::fit_sublone_model(const HaplotypeBlock& haplotypes,
         const auto max_possible_genotypes = num_max_zygosity_genotypes_noexcept(haplotypes.size(), clonality);
         if (prev_genotypes.empty() || clonality <= 2 || !parameters_.max_genotypes ||
             (max_possible_genotypes && *max_possible_genotypes <= *parameters_.max_genotypes)) {
-            curr_genotypes = generate_all_max_zygosity_genotypes(indexed_haplotypes, clonality);
+            if (parameters_.max_genotypes && max_possible_genotypes && *max_possible_genotypes > *parameters_.max_genotypes
+                && haplotypes.size() <= std::numeric_limits<PackedGenotype::HaplotypeIndex>::max() + 1u) {
+                curr_genotypes = generate_top_max_zygosity_genotypes(indexed_haplotypes, clonality, genotype_prior_model,
+                                                                     haplotype_likelihoods, *parameters_.max_genotypes);
+            } else {
+                curr_genotypes = generate_all_max_zygosity_genotypes(indexed_haplotypes, clonality);
+            }
         } else {
             const static auto not_included = [] (const auto& genotype, const auto& haplotype) { return !contains(genotype, haplotype); };
             if (prev_genotypes.size() * (haplotypes.size() / 2) > *parameters_.max_genotypes) {
@@ -24,6 +24,7 @@
 #include "utils/read_stats.hpp"
 #include "utils/append.hpp"
 #include "utils/select_top_k.hpp"
+#include "utils/parallel_transform.hpp"
 #include "containers/probability_matrix.hpp"
 #include "core/models/genotype/individual_model.hpp"
 #include "core/models/genotype/uniform_population_prior_model.hpp"
@@ -154,7 +155,8 @@ auto calculate_haplotype_posteriors(const MappableBlock<IndexedHaplotype<>>& hap
 PopulationCaller::Latents::Latents(const std::vector<SampleName>& samples,
                                    const IndexedHaplotypeBlock& haplotypes,
                                    GenotypeBlock genotypes,
-                                   IndependenceModelInferences&& inferences)
+                                   IndependenceModelInferences&& inferences,
+                                   const boost::optional<double> min_kept_genotype_posterior)
 : genotypes_ {std::move(genotypes)}
 {
     auto& genotype_marginal_posteriors = inferences.posteriors.genotype_probabilities;
@@ -164,17 +166,14 @@ PopulationCaller::Latents::Latents(const std::vector<SampleName>& samples,
     for (const auto& haplotype : haplotypes) {
         haplotype_posteriors_->emplace(haplotype, haplotype_posteriors[index_of(haplotype)]);
     }
-    GenotypeProbabilityMap genotype_posteriors {std::begin(genotypes_), std::end(genotypes_)};
-    for (std::size_t s {0}; s < samples.size(); ++s) {
-        insert_sample(samples[s], std::move(genotype_marginal_posteriors[s]), genotype_posteriors);
-    }
-    genotype_posteriors_ = std::make_shared<GenotypeProbabilityMap>(std::move(genotype_posteriors));
+    set_genotype_posteriors(samples, genotype_marginal_posteriors, min_kept_genotype_posterior);
 }
 
 PopulationCaller::Latents::Latents(const std::vector<SampleName>& samples,
                                    const IndexedHaplotypeBlock& haplotypes,
                                    GenotypeBlock genotypes,
-                                   ModelInferences&& inferences)
+                                   ModelInferences&& inferences,
+                                   const boost::optional<double> min_kept_genotype_posterior)
 : genotypes_ {std::move(genotypes)}
 , model_latents_ {std::move(inferences)}
 {
@@ -184,10 +183,23 @@ PopulationCaller::Latents::Latents(const std::vector<SampleName>& samples,
     for (const auto& haplotype : haplotypes) {
         haplotype_posteriors_->emplace(haplotype, haplotype_posteriors[index_of(haplotype)]);
     }
+    set_genotype_posteriors(samples, genotype_marginal_posteriors, min_kept_genotype_posterior);
+}
+
+void PopulationCaller::Latents::set_genotype_posteriors(const std::vector<SampleName>& samples,
+                                                        const std::vector<std::vector<double>>& genotype_marginal_posteriors,
+                                                        const boost::optional<double> min_kept_genotype_posterior)
+{
     GenotypeProbabilityMap genotype_posteriors {std::begin(genotypes_), std::end(genotypes_)};
+    genotype_posteriors.reserve1(samples.size());
     for (std::size_t s {0}; s < samples.size(); ++s) {
         insert_sample(samples[s], genotype_marginal_posteriors[s], genotype_posteriors);
     }
+    if (min_kept_genotype_posterior) {
+        lost_genotype_posterior_masses_ = remove_improbable_keys(genotype_posteriors, *min_kept_genotype_posterior);
+    } else {
+        lost_genotype_posterior_masses_.assign(samples.size(), 0.0);
+    }
     genotype_posteriors_ = std::make_shared<GenotypeProbabilityMap>(std::move(genotype_posteriors));
 }
 
@@ -203,6 +215,11 @@ PopulationCaller::Latents::genotype_posteriors() const noexcept
     return genotype_posteriors_;
 }
 
+double PopulationCaller::Latents::lost_genotype_posterior_mass(const std::size_t sample_index) const noexcept
+{
+    return lost_genotype_posterior_masses_[sample_index];
+}
+
 using GenotypeBlock = MappableBlock<Genotype<IndexedHaplotype<>>>;
 using GenotypeBlockReference = std::reference_wrapper<const GenotypeBlock>;
 using GenotypesMap = std::map<unsigned, GenotypeBlock>;
@@ -213,9 +230,9 @@ PopulationCaller::infer_latents(const HaplotypeBlock& haplotypes,
                                 OptionalThreadPool workers) const
 {
     if (use_independence_model()) {
-        return infer_latents_with_independence_model(haplotypes, haplotype_likelihoods);
+        return infer_latents_with_independence_model(haplotypes, haplotype_likelihoods, workers);
     } else {
-        return infer_latents_with_joint_model(haplotypes, haplotype_likelihoods);
+        return infer_latents_with_joint_model(haplotypes, haplotype_likelihoods, workers);
     }
 }
 
@@ -244,9 +261,8 @@ PopulationCaller::calculate_model_posterior(const HaplotypeBlock& haplotypes,
                                             const Latents& latents) const
 {
     const auto indexed_haplotypes = index(haplotypes);
-    const auto prior_model = make_independent_prior_model(haplotypes);
-    prior_model->prime(haplotypes);
-    const model::IndividualModel model {*prior_model, debug_log_};
+    const auto& prior_model = independent_prior_model_cache_.get(haplotypes, [this] (const auto& block) { return make_independent_prior_model(block); });
+    const model::IndividualModel model {prior_model, debug_log_};
     ModelPosterior result {};
     result.samples.resize(samples_.size());
     for (std::size_t sample_idx {0}; sample_idx < samples_.size(); ++sample_idx) {
@@ -278,7 +294,7 @@ PopulationCaller::calculate_model_posterior(const HaplotypeBlock& haplotypes,
 std::vector<std::unique_ptr<octopus::VariantCall>>
 PopulationCaller::call_variants(const std::vector<Variant>& candidates, const Caller::Latents& latents, OptionalThreadPool workers) const
 {
-    return call_variants(candidates, dynamic_cast<const Latents&>(latents));
+    return call_variants(candidates, dynamic_cast<const Latents&>(latents), workers);
 }
 
 namespace {
@@ -325,11 +341,13 @@ using GenotypeCalls = std::vector<std::vector<GenotypeCall>>;
 using AlleleBools           = std::deque<bool>; // using std::deque because std::vector<bool> is evil
 using GenotypePropertyBools = std::vector<AlleleBools>;
 
+// Lost genotype posterior mass could belong to genotypes without the allele, so is counted against it
 auto marginalise(const GenotypeProbabilityMap& genotype_posteriors,
-                 const AlleleBools& contained_alleles)
+                 const AlleleBools& contained_alleles,
+                 const double lost_posterior_mass)
 {
     auto p = std::inner_product(std::cbegin(genotype_posteriors), std::cend(genotype_posteriors),
-                                std::cbegin(contained_alleles), 0.0, std::plus<> {},
+                                std::cbegin(contained_alleles), lost_posterior_mass, std::plus<> {},
                                 [] (const auto& p, const bool is_contained) {
                                     return is_contained ? 0.0 : p.second;
                                 });
@@ -337,12 +355,13 @@ auto marginalise(const GenotypeProbabilityMap& genotype_posteriors,
 }
 
 auto compute_sample_allele_posteriors(const GenotypeProbabilityMap& genotype_posteriors,
-                                      const GenotypePropertyBools& contained_alleles)
+                                      const GenotypePropertyBools& contained_alleles,
+                                      const double lost_posterior_mass)
 {
     std::vector<Phred<double>> result {};
     result.reserve(contained_alleles.size());
     for (const auto& allele : contained_alleles) {
-        result.emplace_back(marginalise(genotype_posteriors, allele));
+        result.emplace_back(marginalise(genotype_posteriors, allele, lost_posterior_mass));
     }
     return result;
 }
@@ -370,14 +389,17 @@ auto get_contained_alleles(const PopulationGenotypeProbabilityMap& genotype_post
 
 auto compute_posteriors(const std::vector<SampleName>& samples,
                         const std::vector<Allele>& alleles,
-                        const PopulationGenotypeProbabilityMap& genotype_posteriors)
+                        const PopulationGenotypeProbabilityMap& genotype_posteriors,
+                        const std::vector<double>& lost_posterior_masses,
+                        PopulationCaller::OptionalThreadPool workers)
 {
     const auto contained_alleles = get_contained_alleles(genotype_posteriors, alleles);
-    std::vector<std::vector<Phred<double>>> result {};
-    result.reserve(genotype_posteriors.size1());
-    for (const auto& sample : samples) {
-        result.emplace_back(compute_sample_allele_posteriors(genotype_posteriors[sample], contained_alleles));
-    }
+    std::vector<std::vector<Phred<double>>> result(samples.size());
+    parallel_transform(std::cbegin(samples), std::cend(samples), std::begin(result),
+                       [&] (const auto& sample) {
+                           const auto lost_posterior_mass = lost_posterior_masses[genotype_posteriors.index1(sample)];
+                           return compute_sample_allele_posteriors(genotype_posteriors[sample], contained_alleles, lost_posterior_mass);
+                       }, workers);
     return result;
 }
 
@@ -401,9 +423,12 @@ auto extract_alt_alleles(const std::vector<Variant>& variants)
 
 auto compute_posteriors(const std::vector<SampleName>& samples,
                         const std::vector<Variant>& variants,
-                        const PopulationGenotypeProbabilityMap& genotype_posteriors)
+                        const PopulationGenotypeProbabilityMap& genotype_posteriors,
+                        const std::vector<double>& lost_posterior_masses,
+                        PopulationCaller::OptionalThreadPool workers)
 {
-    const auto allele_posteriors = compute_posteriors(samples, extract_alt_alleles(variants), genotype_posteriors);
+    const auto allele_posteriors = compute_posteriors(samples, extract_alt_alleles(variants), genotype_posteriors,
+                                                      lost_posterior_masses, workers);
     VariantPosteriorVector result {};
     result.reserve(variants.size());
     for (std::size_t i {0}; i < variants.size(); ++i) {
@@ -439,13 +464,14 @@ auto call_genotype(const PopulationGenotypeProbabilityMap::InnerMap& genotype_po
                             [] (const auto& lhs, const auto& rhs) { return lhs.second < rhs.second; })->first;
 }
 
-auto call_genotypes(const std::vector<SampleName>& samples, const PopulationGenotypeProbabilityMap& genotype_posteriors)
+auto call_genotypes(const std::vector<SampleName>& samples,
+                    const PopulationGenotypeProbabilityMap& genotype_posteriors,
+                    PopulationCaller::OptionalThreadPool workers)
 {
-    std::vector<Genotype<IndexedHaplotype<>>> result {};
-    result.reserve(samples.size());
-    for (const auto& sample : samples) {
-        result.push_back(call_genotype(genotype_posteriors[sample]));
-    }
+    std::vector<Genotype<IndexedHaplotype<>>> result(samples.size());
+    parallel_transform(std::cbegin(samples), std::cend(samples), std::begin(result),
+                       [&] (const auto& sample) { return call_genotype(genotype_posteriors[sample]); },
+                       workers);
     return result;
 }
 
@@ -549,10 +575,12 @@ auto compute_polymorphism_posteriors(const std::vector<Variant>& variants,
 
 // allele genotype calling
 
-auto marginalise(const Genotype<Allele>& genotype, const GenotypeProbabilityMap& genotype_posteriors)
+auto marginalise(const Genotype<Allele>& genotype, const GenotypeProbabilityMap& genotype_posteriors,
+                 const double lost_posterior_mass)
 {
     double mass_not_contained {0};
     if (genotype.ploidy() > 0) {
+        mass_not_contained = lost_posterior_mass;
         for_each_contains(std::cbegin(genotype_posteriors), std::cend(genotype_posteriors), genotype,
                           [&] (const auto& p, bool contain) { if (!contain) mass_not_contained += p.second; },
                           [] (const auto& p) { return p.first; });
@@ -560,20 +588,43 @@ auto marginalise(const Genotype<Allele>& genotype, const GenotypeProbabilityMap&
     return probability_false_to_phred(mass_not_contained);
 }
 
+auto call_sample_genotypes(const Genotype<IndexedHaplotype<>>& genotype_call,
+                           const GenotypeProbabilityMap& genotype_posteriors,
+                           const double lost_posterior_mass,
+                           const std::vector<GenomicRegion>& variant_regions)
+{
+    std::vector<GenotypeCall> result {};
+    result.reserve(variant_regions.size());
+    for (const auto& region : variant_regions) {
+        auto genotype_chunk = copy<Allele>(genotype_call, region);
+        const auto posterior = marginalise(genotype_chunk, genotype_posteriors, lost_posterior_mass);
+        result.push_back({std::move(genotype_chunk), posterior});
+    }
+    return result;
+}
+
+// Samples are called independently (and concurrently if there are idle workers), and the calls
+// are then transposed so they are grouped by region, in sample order.
 auto call_genotypes(const std::vector<SampleName>& samples,
                     const std::vector<Genotype<IndexedHaplotype<>>>& genotype_calls,
                     const PopulationGenotypeProbabilityMap& genotype_posteriors,
-                    const std::vector<GenomicRegion>& variant_regions)
+                    const std::vector<double>& lost_posterior_masses,
+                    const std::vector<GenomicRegion>& variant_regions,
+                    PopulationCaller::OptionalThreadPool workers)
 {
+    std::vector<std::vector<GenotypeCall>> sample_calls(samples.size());
+    parallel_transform(std::cbegin(samples), std::cend(samples), std::cbegin(genotype_calls), std::begin(sample_calls),
+                       [&] (const auto& sample, const auto& genotype_call) {
+                           const auto lost_posterior_mass = lost_posterior_masses[genotype_posteriors.index1(sample)];
+                           return call_sample_genotypes(genotype_call, genotype_posteriors[sample], lost_posterior_mass, variant_regions);
+                       }, workers);
     GenotypeCalls result {};
     result.reserve(variant_regions.size());
-    for (const auto& region : variant_regions) {
+    for (std::size_t r {0}; r < variant_regions.size(); ++r) {
         std::vector<GenotypeCall> region_calls {};
         region_calls.reserve(samples.size());
-        for (std::size_t s {0}; s < samples.size(); ++s) { 
-            auto genotype_chunk = copy<Allele>(genotype_calls[s], region);
-            const auto posterior = marginalise(genotype_chunk, genotype_posteriors[samples[s]]);
-            region_calls.push_back({std::move(genotype_chunk), posterior});
+        for (auto& calls : sample_calls) {
+            region_calls.push_back(std::move(calls[r]));
         }
         result.push_back(std::move(region_calls));
     }
@@ -638,16 +689,17 @@ void log(const Genotype<IndexedHaplotype<>>& called_genotype,
 } // namespace debug
 
 std::vector<std::unique_ptr<octopus::VariantCall>>
-PopulationCaller::call_variants(const std::vector<Variant>& candidates, const Latents& latents) const
+PopulationCaller::call_variants(const std::vector<Variant>& candidates, const Latents& latents, OptionalThreadPool workers) const
 {
     const auto& genotype_posteriors = *latents.genotype_posteriors_;
     debug::log(genotype_posteriors, debug_log_, trace_log_);
-    const auto candidate_posteriors = compute_posteriors(samples_, candidates, genotype_posteriors);
+    const auto& lost_posterior_masses = latents.lost_genotype_posterior_masses_;
+    const auto candidate_posteriors = compute_posteriors(samples_, candidates, genotype_posteriors, lost_posterior_masses, workers);
     debug::log(candidate_posteriors, debug_log_, trace_log_);
-    const auto genotype_calls = call_genotypes(samples_, genotype_posteriors);
+    const auto genotype_calls = call_genotypes(samples_, genotype_posteriors, workers);
     auto variant_calls = call_candidates(candidate_posteriors, genotype_calls, parameters_.min_variant_posterior);
     const auto called_regions = extract_regions(variant_calls);
-    auto allele_genotype_calls = call_genotypes(samples_, genotype_calls, genotype_posteriors, called_regions);
+    auto allele_genotype_calls = call_genotypes(samples_, genotype_calls, genotype_posteriors, lost_posterior_masses, called_regions, workers);
     return transform_calls(samples_, std::move(variant_calls), std::move(allele_genotype_calls));
 }
 
@@ -753,17 +805,30 @@ auto append(MappableBlock<MappableType, Container1>&& src, MappableBlock<Mappabl
 
 std::unique_ptr<Caller::Latents>
 PopulationCaller::infer_latents_with_joint_model(const HaplotypeBlock& haplotypes,
-                                                 const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                                                 const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                                 OptionalThreadPool workers) const
 {
     const auto indexed_haplotypes = index(haplotypes);
-    const auto prior_model = make_joint_prior_model(haplotypes);
-    const model::PopulationModel model {*prior_model, {parameters_.max_genotype_combinations}, debug_log_};
-    prior_model->prime(haplotypes);
+    const auto& prior_model = joint_prior_model_cache_.get(haplotypes, [this] (const auto& block) { return make_joint_prior_model(block); });
+    const model::PopulationModel model {prior_model, {parameters_.max_genotype_combinations}, debug_log_};
+    model::PopulationModel::HaplotypeFrequencyVector initial_haplotype_frequencies {};
+    if (em_warm_start_) {
+        initial_haplotype_frequencies = model::map_haplotype_frequencies(em_warm_start_->haplotypes, em_warm_start_->haplotype_frequencies, haplotypes);
+    }
+    const auto update_em_warm_start = [&] (const model::PopulationModel::InferredLatents& inferences) {
+        if (inferences.haplotype_frequencies.empty()) {
+            em_warm_start_ = boost::none;
+        } else {
+            em_warm_start_ = EMWarmStart {haplotypes, inferences.haplotype_frequencies};
+        }
+    };
     if (unique_ploidies_.size() == 1) {
         auto genotypes = generate_all_genotypes(indexed_haplotypes, parameters_.ploidies.front());
         if (debug_log_) stream(*debug_log_) << "There are " << genotypes.size() << " candidate genotypes";
-        auto inferences = model.evaluate(samples_, haplotypes, genotypes, haplotype_likelihoods);
-        return std::make_unique<Latents>(samples_, indexed_haplotypes, std::move(genotypes), std::move(inferences));
+        auto inferences = model.evaluate(samples_, haplotypes, genotypes, haplotype_likelihoods, initial_haplotype_frequencies, workers);
+        update_em_warm_start(inferences);
+        return std::make_unique<Latents>(samples_, indexed_haplotypes, std::move(genotypes), std::move(inferences),
+                                         parameters_.min_kept_genotype_posterior);
     } else {
         model::PopulationModel::GenotypeVector genotypes {};
         for (const auto ploidy : unique_ploidies_) {
@@ -773,24 +838,27 @@ PopulationCaller::infer_latents_with_joint_model(const HaplotypeBlock& haplotype
                 genotypes.push_back(Genotype<IndexedHaplotype<>> {});
             }
         }
-        auto inferences = model.evaluate(samples_, parameters_.ploidies, haplotypes, genotypes, haplotype_likelihoods);
-        return std::make_unique<Latents>(samples_, indexed_haplotypes, std::move(genotypes), std::move(inferences));
+        auto inferences = model.evaluate(samples_, parameters_.ploidies, haplotypes, genotypes, haplotype_likelihoods, initial_haplotype_frequencies, workers);
+        update_em_warm_start(inferences);
+        return std::make_unique<Latents>(samples_, indexed_haplotypes, std::move(genotypes), std::move(inferences),
+                                         parameters_.min_kept_genotype_posterior);
     }
 }
 
 std::unique_ptr<Caller::Latents>
 PopulationCaller::infer_latents_with_independence_model(const HaplotypeBlock& haplotypes,
-                                                        const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                                                        const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                                        OptionalThreadPool workers) const
 {
     const auto indexed_haplotypes = index(haplotypes);
-    const auto prior_model = make_independent_prior_model(haplotypes);
-    prior_model->prime(haplotypes);
-    const model::IndependentPopulationModel model {*prior_model, debug_log_};
+    const auto& prior_model = independent_prior_model_cache_.get(haplotypes, [this] (const auto& block) { return make_independent_prior_model(block); });
+    const model::IndependentPopulationModel model {prior_model, debug_log_};
     if (parameters_.ploidies.size() == 1) {
         auto genotypes = generate_all_genotypes(indexed_haplotypes, parameters_.ploidies.front());
         if (debug_log_) stream(*debug_log_) << "There are " << genotypes.size() << " candidate genotypes";
-        auto inferences = model.evaluate(samples_, genotypes, haplotype_likelihoods);
-        return std::make_unique<Latents>(samples_, indexed_haplotypes, std::move(genotypes), std::move(inferences));
+        auto inferences = model.evaluate(samples_, genotypes, haplotype_likelihoods, workers);
+        return std::make_unique<Latents>(samples_, indexed_haplotypes, std::move(genotypes), std::move(inferences),
+                                         parameters_.min_kept_genotype_posterior);
     } else {
         model::PopulationModel::GenotypeVector genotypes {};
         for (const auto ploidy : unique_ploidies_) {
@@ -800,8 +868,9 @@ PopulationCaller::infer_latents_with_independence_model(const HaplotypeBlock& ha
                 genotypes.push_back(Genotype<IndexedHaplotype<>> {});
             }
         }
-        auto inferences = model.evaluate(samples_, parameters_.ploidies, genotypes, haplotype_likelihoods);
-        return std::make_unique<Latents>(samples_, indexed_haplotypes, std::move(genotypes), std::move(inferences));
+        auto inferences = model.evaluate(samples_, parameters_.ploidies, genotypes, haplotype_likelihoods, workers);
+        return std::make_unique<Latents>(samples_, indexed_haplotypes, std::move(genotypes), std::move(inferences),
+                                         parameters_.min_kept_genotype_posterior);
     }
 }
 
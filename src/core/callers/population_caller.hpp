@@ -16,6 +16,7 @@
 #include "core/models/mutation/coalescent_model.hpp"
 #include "core/models/genotype/genotype_prior_model.hpp"
 #include "core/models/genotype/population_prior_model.hpp"
+#include "core/models/genotype/prior_model_cache.hpp"
 #include "core/models/genotype/independent_population_model.hpp"
 #include "core/models/genotype/population_model.hpp"
 #include "caller.hpp"
@@ -41,6 +42,7 @@ public:
         boost::optional<std::size_t> max_genotype_combinations;
         bool use_independent_genotype_priors = false;
         bool deduplicate_haplotypes_with_germline_model = true;
+        boost::optional<double> min_kept_genotype_posterior = boost::none;
     };
     
     PopulationCaller() = delete;
@@ -62,8 +64,19 @@ private:
     using IndexedHaplotypeBlock = MappableBlock<IndexedHaplotype<>>;
     using GenotypeBlock = MappableBlock<Genotype<IndexedHaplotype<>>>;
     
+    struct EMWarmStart
+    {
+        HaplotypeBlock haplotypes;
+        model::PopulationModel::HaplotypeFrequencyVector haplotype_frequencies;
+    };
+    
     Parameters parameters_;
     std::vector<unsigned> unique_ploidies_;
+    // Haplotype frequencies estimated in the last window, which usually shares most haplotypes with the next
+    mutable boost::optional<EMWarmStart> em_warm_start_;
+    // Prior models primed on the current window's haplotypes, shared by all inference steps
+    mutable PriorModelCache<PopulationPriorModel> joint_prior_model_cache_;
+    mutable PriorModelCache<GenotypePriorModel> independent_prior_model_cache_;
     
     std::string do_name() const override;
     CallTypeSet do_call_types() const override;
@@ -91,7 +104,8 @@ private:
     call_variants(const std::vector<Variant>& candidates, const Caller::Latents& latents, OptionalThreadPool workers) const override;
     
     std::vector<std::unique_ptr<VariantCall>>
-    call_variants(const std::vector<Variant>& candidates, const Latents& latents) const;
+    call_variants(const std::vector<Variant>& candidates, const Latents& latents,
+                  OptionalThreadPool workers = boost::none) const;
     
     std::vector<std::unique_ptr<ReferenceCall>>
     call_reference(const std::vector<Allele>& alleles, const Caller::Latents& latents,
@@ -100,10 +114,12 @@ private:
     bool use_independence_model() const noexcept;
     std::unique_ptr<Caller::Latents>
     infer_latents_with_joint_model(const HaplotypeBlock& haplotypes,
-                                   const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+                                   const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                   OptionalThreadPool workers = boost::none) const;
     std::unique_ptr<Caller::Latents>
     infer_latents_with_independence_model(const HaplotypeBlock& haplotypes,
-                                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+                                          const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                          OptionalThreadPool workers = boost::none) const;
     std::unique_ptr<PopulationPriorModel> make_joint_prior_model(const HaplotypeBlock& haplotypes) const;
     std::unique_ptr<GenotypePriorModel> make_independent_prior_model(const HaplotypeBlock& haplotypes) const;
 
@@ -128,24 +144,34 @@ public:
     using IndexedHaplotypeBlock = MappableBlock<IndexedHaplotype<>>;
     using GenotypeBlock = MappableBlock<Genotype<IndexedHaplotype<>>>;
     
+    // If min_kept_genotype_posterior is given then genotypes below it in every sample are dropped from
+    // the genotype posteriors
     Latents(const std::vector<SampleName>& samples,
             const IndexedHaplotypeBlock&,
             GenotypeBlock genotypes,
-            IndependenceModelInferences&&);
+            IndependenceModelInferences&&,
+            boost::optional<double> min_kept_genotype_posterior = boost::none);
     Latents(const std::vector<SampleName>& samples,
             const IndexedHaplotypeBlock&,
             GenotypeBlock,
-            ModelInferences&&);
+            ModelInferences&&,
+            boost::optional<double> min_kept_genotype_posterior = boost::none);
     
     std::shared_ptr<HaplotypeProbabilityMap> haplotype_posteriors() const noexcept override;
     std::shared_ptr<GenotypeProbabilityMap> genotype_posteriors() const noexcept override;
+    double lost_genotype_posterior_mass(std::size_t sample_index) const noexcept override;
 
 private:
     GenotypeBlock genotypes_;
     ModelInferences model_latents_;
     std::shared_ptr<GenotypeProbabilityMap> genotype_posteriors_;
+    std::vector<double> lost_genotype_posterior_masses_; // by sample index
     std::shared_ptr<HaplotypeProbabilityMap> haplotype_posteriors_;
     boost::optional<ModelInferences> dummy_latents_;
+    
+    void set_genotype_posteriors(const std::vector<SampleName>& samples,
+                                 const std::vector<std::vector<double>>& genotype_marginal_posteriors,
+                                 boost::optional<double> min_kept_genotype_posterior);
 };
 
 } // namespace octopus
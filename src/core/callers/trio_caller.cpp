@@ -110,7 +110,8 @@ std::size_t TrioCaller::do_remove_duplicates(HaplotypeBlock& haplotypes) const
 TrioCaller::Latents::Latents(IndexedHaplotypeBlock haplotypes,
                              GenotypeBlock genotypes,
                              model::TrioModel::InferredLatents latents,
-                             const Trio& trio)
+                             const Trio& trio,
+                             const boost::optional<double> min_kept_genotype_posterior)
 : trio {trio}
 , haplotypes {std::move(haplotypes)}
 , maternal_genotypes {std::move(genotypes)}
@@ -123,6 +124,7 @@ TrioCaller::Latents::Latents(IndexedHaplotypeBlock haplotypes,
 {
     set_genotype_posteriors_shared_genotypes(trio);
     set_haplotype_posteriors_shared_genotypes();
+    remove_improbable_genotype_posteriors(min_kept_genotype_posterior);
 }
 
 TrioCaller::Latents::Latents(IndexedHaplotypeBlock haplotypes,
@@ -130,7 +132,8 @@ TrioCaller::Latents::Latents(IndexedHaplotypeBlock haplotypes,
                              GenotypeBlock paternal_genotypes,
                              const unsigned child_ploidy,
                              ModelInferences latents,
-                             const Trio& trio)
+                             const Trio& trio,
+                             const boost::optional<double> min_kept_genotype_posterior)
 : trio {trio}
 , haplotypes {std::move(haplotypes)}
 , maternal_genotypes {std::move(maternal_genotypes)}
@@ -144,6 +147,7 @@ TrioCaller::Latents::Latents(IndexedHaplotypeBlock haplotypes,
 {
     set_genotype_posteriors_unique_genotypes(trio);
     set_haplotype_posteriors_unique_genotypes();
+    remove_improbable_genotype_posteriors(min_kept_genotype_posterior);
     padded_marginal_maternal_posteriors_.clear();
     padded_marginal_maternal_posteriors_.shrink_to_fit();
     padded_marginal_paternal_posteriors_.clear();
@@ -164,6 +168,20 @@ TrioCaller::Latents::genotype_posteriors() const noexcept
     return marginal_genotype_posteriors;
 }
 
+double TrioCaller::Latents::lost_genotype_posterior_mass(const std::size_t sample_index) const noexcept
+{
+    return lost_genotype_posterior_masses[sample_index];
+}
+
+void TrioCaller::Latents::remove_improbable_genotype_posteriors(const boost::optional<double> min_kept_genotype_posterior)
+{
+    if (min_kept_genotype_posterior) {
+        lost_genotype_posterior_masses = remove_improbable_keys(*marginal_genotype_posteriors, *min_kept_genotype_posterior);
+    } else {
+        lost_genotype_posterior_masses.assign(marginal_genotype_posteriors->size1(), 0.0);
+    }
+}
+
 namespace {
 
 using model::TrioModel;
@@ -375,9 +393,8 @@ TrioCaller::infer_latents(const HaplotypeBlock& haplotypes,
     const auto indexed_haplotypes = index(haplotypes);
     if (parameters_.child_ploidy == 0) {
         assert(parameters_.maternal_ploidy == 0 || parameters_.paternal_ploidy == 0);
-        const auto prior_model = make_single_sample_prior_model(haplotypes);
-        prior_model->prime(haplotypes);
-        const model::IndividualModel sample_model {*prior_model};
+        const auto& prior_model = single_sample_prior_model_cache_.get(haplotypes, [this] (const auto& block) { return make_single_sample_prior_model(block); });
+        const model::IndividualModel sample_model {prior_model};
         GenotypeBlock parent_genotypes {mapped_region(haplotypes)}, empty_genotypes {mapped_region(haplotypes)};
         if (parameters_.maternal_ploidy > 0) {
             parent_genotypes = generate_all_genotypes(indexed_haplotypes, parameters_.maternal_ploidy);
@@ -399,14 +416,14 @@ TrioCaller::infer_latents(const HaplotypeBlock& haplotypes,
         }
         if (parameters_.maternal_ploidy == 0) std::swap(parent_genotypes, empty_genotypes);
         return std::make_unique<Latents>(std::move(indexed_haplotypes), std::move(parent_genotypes), std::move(empty_genotypes),
-                                         parameters_.child_ploidy, std::move(trio_latents), parameters_.trio);
+                                         parameters_.child_ploidy, std::move(trio_latents), parameters_.trio,
+                                         parameters_.min_kept_genotype_posterior);
     }
-    auto germline_prior_model = make_prior_model(haplotypes);
-    germline_prior_model->prime(haplotypes);
-    DeNovoModel denovo_model {parameters_.denovo_model_params, haplotypes.size(), DeNovoModel::CachingStrategy::none};
-    denovo_model.prime(haplotypes);
+    const auto& germline_prior_model = prior_model_cache_.get(haplotypes, [this] (const auto& block) { return make_prior_model(block); });
+    DeNovoModel denovo_model {parameters_.denovo_model_params};
+    denovo_model.prime(haplotypes, workers);
     const model::TrioModel model {
-        parameters_.trio, *germline_prior_model, denovo_model,
+        parameters_.trio, germline_prior_model, denovo_model,
         TrioModel::Options {parameters_.max_genotype_combinations},
         debug_log_
     };
@@ -414,19 +431,21 @@ TrioCaller::infer_latents(const HaplotypeBlock& haplotypes,
     if (parameters_.maternal_ploidy == parameters_.paternal_ploidy) {
         auto latents = model.evaluate(maternal_genotypes, haplotype_likelihoods);
         return std::make_unique<Latents>(std::move(indexed_haplotypes), std::move(maternal_genotypes),
-                                         std::move(latents), parameters_.trio);
+                                         std::move(latents), parameters_.trio, parameters_.min_kept_genotype_posterior);
     } else {
         auto paternal_genotypes = generate_all_genotypes(indexed_haplotypes, parameters_.paternal_ploidy);
         if (parameters_.maternal_ploidy == parameters_.child_ploidy) {
             auto latents = model.evaluate(maternal_genotypes, paternal_genotypes,
                                           maternal_genotypes, haplotype_likelihoods);
             return std::make_unique<Latents>(std::move(indexed_haplotypes), std::move(maternal_genotypes), std::move(paternal_genotypes),
-                                             parameters_.child_ploidy, std::move(latents), parameters_.trio);
+                                             parameters_.child_ploidy, std::move(latents), parameters_.trio,
+                                             parameters_.min_kept_genotype_posterior);
         } else {
             auto latents = model.evaluate(maternal_genotypes, paternal_genotypes,
                                           paternal_genotypes, haplotype_likelihoods);
             return std::make_unique<Latents>(std::move(indexed_haplotypes), std::move(maternal_genotypes), std::move(paternal_genotypes),
-                                             parameters_.child_ploidy, std::move(latents), parameters_.trio);
+                                             parameters_.child_ploidy, std::move(latents), parameters_.trio,
+                                             parameters_.min_kept_genotype_posterior);
         }
     }
 }
@@ -460,9 +479,8 @@ TrioCaller::calculate_model_posterior(const HaplotypeBlock& haplotypes,
                                       const Latents& latents) const
 {
     const auto indexed_haplotypes = index(haplotypes);
-    const auto prior_model = make_single_sample_prior_model(haplotypes);
-    prior_model->prime(haplotypes);
-    const model::IndividualModel model {*prior_model, debug_log_};
+    const auto& prior_model = single_sample_prior_model_cache_.get(haplotypes, [this] (const auto& block) { return make_single_sample_prior_model(block); });
+    const model::IndividualModel model {prior_model, debug_log_};
     ModelPosterior result {};
     result.samples.resize(3);
     const auto propose_model_check_genotypes_helper = [&] (const std::size_t sample_idx) {
@@ -932,9 +950,11 @@ void remove_ungenotyped_allele(std::vector<CalledGermlineVariant>& germline_call
 
 using GenotypeProbabilityMap = ProbabilityMatrix<Genotype<IndexedHaplotype<>>>;
 
-auto compute_posterior(const Genotype<Allele>& genotype, const GenotypeProbabilityMap::InnerMap& posteriors)
+// Lost genotype posterior mass could belong to genotypes without the called genotype, so is counted against it
+auto compute_posterior(const Genotype<Allele>& genotype, const GenotypeProbabilityMap::InnerMap& posteriors,
+                       const double lost_posterior_mass)
 {
-    auto p = std::accumulate(std::cbegin(posteriors), std::cend(posteriors), 0.0,
+    auto p = std::accumulate(std::cbegin(posteriors), std::cend(posteriors), lost_posterior_mass,
                              [&] (const double curr, const auto& p) {
                                  return curr + (contains(p.first, genotype) ? 0.0 : p.second);
                              });
@@ -954,17 +974,19 @@ struct GenotypedTrio
 
 auto call_genotypes(const Trio& trio, const TrioCall& called_trio,
                     const GenotypeProbabilityMap& trio_posteriors,
+                    const std::vector<double>& lost_posterior_masses,
                     const std::vector<GenomicRegion>& regions)
 {
     std::vector<GenotypedTrio> result {};
     result.reserve(regions.size());
+    const auto lost_mass = [&] (const SampleName& sample) { return lost_posterior_masses[trio_posteriors.index1(sample)]; };
     for (const auto& region : regions) {
         auto mother_genotype = copy<Allele>(called_trio.mother, region);
-        auto mother_posterior = compute_posterior(mother_genotype, trio_posteriors[trio.mother()]);
+        auto mother_posterior = compute_posterior(mother_genotype, trio_posteriors[trio.mother()], lost_mass(trio.mother()));
         auto father_genotype = copy<Allele>(called_trio.father, region);
-        auto father_posterior = compute_posterior(father_genotype, trio_posteriors[trio.father()]);
+        auto father_posterior = compute_posterior(father_genotype, trio_posteriors[trio.father()], lost_mass(trio.father()));
         auto child_genotype = copy<Allele>(called_trio.child, region);
-        auto child_posterior = compute_posterior(child_genotype, trio_posteriors[trio.child()]);
+        auto child_posterior = compute_posterior(child_genotype, trio_posteriors[trio.child()], lost_mass(trio.child()));
         result.push_back({{std::move(mother_genotype), mother_posterior},
                           {std::move(father_genotype), father_posterior},
                           {std::move(child_genotype), child_posterior}});
@@ -1099,8 +1121,10 @@ TrioCaller::call_variants(const std::vector<Variant>& candidates, const Latents&
     if (parameters_.maternal_ploidy == 0) called_trio.mother = Genotype<IndexedHaplotype<>> {};
     if (parameters_.paternal_ploidy == 0) called_trio.father = Genotype<IndexedHaplotype<>> {};
     if (parameters_.child_ploidy == 0) called_trio.child = Genotype<IndexedHaplotype<>> {};
-    auto denovo_genotypes = call_genotypes(parameters_.trio, called_trio, *latents.genotype_posteriors(), extract_regions(denovos));
-    auto germline_genotypes = call_genotypes(parameters_.trio, called_trio, *latents.genotype_posteriors(), extract_regions(germline_variants));
+    const auto& genotype_posteriors = *latents.genotype_posteriors();
+    const auto& lost_posterior_masses = latents.lost_genotype_posterior_masses;
+    auto denovo_genotypes = call_genotypes(parameters_.trio, called_trio, genotype_posteriors, lost_posterior_masses, extract_regions(denovos));
+    auto germline_genotypes = call_genotypes(parameters_.trio, called_trio, genotype_posteriors, lost_posterior_masses, extract_regions(germline_variants));
     boost::optional<Phred<double>> max_quality {};
     if (latents.model_latents.estimated_lost_log_posterior_mass) {
         max_quality = log_probability_false_to_phred(*latents.model_latents.estimated_lost_log_posterior_mass);
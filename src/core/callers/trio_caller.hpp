@@ -14,6 +14,7 @@
 #include "core/models/mutation/coalescent_model.hpp"
 #include "core/models/genotype/population_prior_model.hpp"
 #include "core/models/genotype/genotype_prior_model.hpp"
+#include "core/models/genotype/prior_model_cache.hpp"
 #include "core/models/mutation/denovo_model.hpp"
 #include "core/models/genotype/trio_model.hpp"
 
@@ -36,6 +37,7 @@ public:
         Phred<double> min_variant_posterior, min_denovo_posterior;
         boost::optional<std::size_t> max_genotype_combinations;
         bool deduplicate_haplotypes_with_germline_model = true;
+        boost::optional<double> min_kept_genotype_posterior = boost::none;
     };
     
     TrioCaller() = delete;
@@ -58,6 +60,9 @@ private:
     using GenotypeBlock = MappableBlock<Genotype<IndexedHaplotype<>>>;
     
     Parameters parameters_;
+    // Prior models primed on the current window's haplotypes, shared by all inference steps
+    mutable PriorModelCache<PopulationPriorModel> prior_model_cache_;
+    mutable PriorModelCache<GenotypePriorModel> single_sample_prior_model_cache_;
     
     std::string do_name() const override;
     CallTypeSet do_call_types() const override;
@@ -113,19 +118,24 @@ public:
     using ModelInferences = model::TrioModel::InferredLatents;
     friend TrioCaller;
     
+    // If min_kept_genotype_posterior is given then genotypes below it in every sample are dropped from
+    // the genotype posteriors
     Latents(IndexedHaplotypeBlock haplotypes,
             Genotypeblock genotypes,
             ModelInferences latents,
-            const Trio& trio);
+            const Trio& trio,
+            boost::optional<double> min_kept_genotype_posterior = boost::none);
     Latents(IndexedHaplotypeBlock haplotypes,
             Genotypeblock maternal_genotypes,
             Genotypeblock paternal_genotypes,
             unsigned child_ploidy,
             ModelInferences latents,
-            const Trio& trio);
+            const Trio& trio,
+            boost::optional<double> min_kept_genotype_posterior = boost::none);
     
     std::shared_ptr<HaplotypeProbabilityMap> haplotype_posteriors() const noexcept override;
     std::shared_ptr<GenotypeProbabilityMap> genotype_posteriors() const noexcept override;
+    double lost_genotype_posterior_mass(std::size_t sample_index) const noexcept override;
     
 private:
     Trio trio;
@@ -135,6 +145,7 @@ private:
     ModelInferences model_latents;
     std::vector<double> marginal_maternal_posteriors, marginal_paternal_posteriors, marginal_child_posteriors;
     mutable std::shared_ptr<GenotypeProbabilityMap> marginal_genotype_posteriors;
+    std::vector<double> lost_genotype_posterior_masses; // by sample index
     std::shared_ptr<HaplotypeProbabilityMap> marginal_haplotype_posteriors;
     Genotypeblock concatenated_genotypes_;
     std::vector<double> padded_marginal_maternal_posteriors_, padded_marginal_paternal_posteriors_, padded_marginal_child_posteriors_;
@@ -143,6 +154,7 @@ private:
     void set_genotype_posteriors(const Trio& trio);
     void set_genotype_posteriors_shared_genotypes(const Trio& trio);
     void set_genotype_posteriors_unique_genotypes(const Trio& trio);
+    void remove_improbable_genotype_posteriors(boost::optional<double> min_kept_genotype_posterior);
     void set_haplotype_posteriors();
     void set_haplotype_posteriors_shared_genotypes();
     void set_haplotype_posteriors_unique_genotypes();
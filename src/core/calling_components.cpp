@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <functional>
 #include <exception>
+#include <future>
 
 #include "config/config.hpp"
 #include "config/option_collation.hpp"
@@ -23,9 +24,9 @@ namespace {
 
 namespace fs = boost::filesystem;
 
-VcfWriter make_vcf_writer(boost::optional<fs::path> dst)
+VcfWriter make_vcf_writer(boost::optional<fs::path> dst, std::shared_ptr<HtslibEncodingContext> encoding_context)
 {
-    return dst ? VcfWriter {std::move(*dst)} : VcfWriter {};
+    return dst ? VcfWriter {std::move(*dst), std::move(encoding_context)} : VcfWriter {};
 }
 
 } // namespace
@@ -101,6 +102,11 @@ std::size_t GenomeCallingComponents::read_buffer_size() const noexcept
     return components_.read_buffer_size;
 }
 
+bool GenomeCallingComponents::compress_read_buffer() const noexcept
+{
+    return components_.compress_read_buffer;
+}
+
 const boost::optional<GenomeCallingComponents::Path>& GenomeCallingComponents::temp_directory() const noexcept
 {
     return components_.temp_directory;
@@ -111,11 +117,31 @@ bool GenomeCallingComponents::keep_temporary_files() const noexcept
     return components_.keep_temp_files;
 }
 
+bool GenomeCallingComponents::resume_requested() const noexcept
+{
+    return components_.resume;
+}
+
+MemoryFootprint GenomeCallingComponents::max_in_memory_calls_footprint() const noexcept
+{
+    return components_.max_in_memory_calls_footprint;
+}
+
 boost::optional<unsigned> GenomeCallingComponents::num_threads() const noexcept
 {
     return components_.num_threads;
 }
 
+bool GenomeCallingComponents::numa_aware() const noexcept
+{
+    return components_.numa_aware;
+}
+
+unsigned GenomeCallingComponents::task_prefetch_depth() const noexcept
+{
+    return components_.task_prefetch_depth;
+}
+
 const HaplotypeLikelihoodModel& GenomeCallingComponents::haplotype_likelihood_model() const noexcept
 {
     return components_.haplotype_likelihood_model;
@@ -131,6 +157,15 @@ const CallerFactory& GenomeCallingComponents::caller_factory() const noexcept
     return components_.caller_factory;
 }
 
+boost::optional<const CallerFactory&> GenomeCallingComponents::secondary_caller_factory() const noexcept
+{
+    if (components_.secondary_caller_factory) {
+        return *components_.secondary_caller_factory; // convert to reference
+    } else {
+        return boost::none;
+    }
+}
+
 boost::optional<VcfWriter&> GenomeCallingComponents::filtered_output() noexcept
 {
     if (components_.filtered_output) {
@@ -149,6 +184,24 @@ boost::optional<const VcfWriter&> GenomeCallingComponents::filtered_output() con
     }
 }
 
+boost::optional<VcfWriter&> GenomeCallingComponents::secondary_output() noexcept
+{
+    if (components_.secondary_output) {
+        return *components_.secondary_output; // convert to reference
+    } else {
+        return boost::none;
+    }
+}
+
+boost::optional<const VcfWriter&> GenomeCallingComponents::secondary_output() const noexcept
+{
+    if (components_.secondary_output) {
+        return *components_.secondary_output; // convert to reference
+    } else {
+        return boost::none;
+    }
+}
+
 const VariantCallFilterFactory& GenomeCallingComponents::call_filter_factory() const
 {
     return *components_.call_filter_factory;
@@ -193,16 +246,79 @@ boost::optional<const ReadSetProfile&> GenomeCallingComponents::reads_profile()
     }
 }
 
+const InputRegionMap& GenomeCallingComponents::bad_regions() const noexcept
+{
+    return components_.bad_regions;
+}
+
+const InputRegionMap& GenomeCallingComponents::debug_regions() const noexcept
+{
+    return components_.debug_regions;
+}
+
 boost::optional<GenomeCallingComponents::Path> GenomeCallingComponents::data_profile() const
 {
     return components_.data_profile;
 }
 
+boost::optional<GenomeCallingComponents::Path> GenomeCallingComponents::columnar_output() const
+{
+    return components_.columnar_output;
+}
+
+boost::optional<GenomeCallingComponents::Path> GenomeCallingComponents::task_report() const
+{
+    return components_.task_report;
+}
+
+boost::optional<GenomeCallingComponents::Path> GenomeCallingComponents::performance_report() const
+{
+    return components_.performance_report;
+}
+
+boost::optional<GenomeCallingComponents::Path> GenomeCallingComponents::progress_report() const
+{
+    return components_.progress_report;
+}
+
+std::chrono::seconds GenomeCallingComponents::progress_report_interval() const noexcept
+{
+    return components_.progress_report_interval;
+}
+
+boost::optional<std::chrono::seconds> GenomeCallingComponents::task_time_budget() const noexcept
+{
+    return components_.task_time_budget;
+}
+
+bool GenomeCallingComponents::site_likelihoods() const noexcept
+{
+    return components_.site_likelihoods;
+}
+
 IndelProfiler::ProfileConfig GenomeCallingComponents::profiler_config() const
 {
     return components_.profiler_config;
 }
 
+boost::optional<const options::ShardManifestRequest&> GenomeCallingComponents::shard_manifest_request() const noexcept
+{
+    if (components_.shard_manifest_request) {
+        return *components_.shard_manifest_request;
+    } else {
+        return boost::none;
+    }
+}
+
+boost::optional<const options::ShardMergeRequest&> GenomeCallingComponents::shard_merge_request() const noexcept
+{
+    if (components_.shard_merge_request) {
+        return *components_.shard_merge_request;
+    } else {
+        return boost::none;
+    }
+}
+
 bool GenomeCallingComponents::sites_only() const noexcept
 {
     return components_.sites_only;
@@ -398,7 +514,8 @@ bool require_temp_dir_for_filtering(const options::OptionMap& options)
 
 bool is_temp_directory_needed(const options::OptionMap& options)
 {
-    return is_multithreaded_run(options) || require_temp_dir_for_filtering(options);
+    return is_multithreaded_run(options) || require_temp_dir_for_filtering(options)
+           || options::is_shard_merge_requested(options);
 }
 
 boost::optional<fs::path> get_temp_directory(const options::OptionMap& options)
@@ -458,6 +575,38 @@ auto profile_reads_helper(const std::vector<SampleName>& samples,
     }
 }
 
+// Bad regions are found before calling so the task maker can give them their own tasks. Only read depths
+// are used, so this is quick if the read files have depth indices.
+InputRegionMap find_bad_regions_helper(const std::vector<SampleName>& samples,
+                                       const InputRegionMap& input_regions,
+                                       const ReadManager& source,
+                                       const boost::optional<ReadSetProfile>& reads_profile,
+                                       const options::OptionMap& options)
+{
+    InputRegionMap result {};
+    if (!reads_profile) return result;
+    const auto detector = options::make_bad_region_detector(options, *reads_profile);
+    if (!detector) return result;
+    static constexpr GenomicRegion::Size max_chunk_size {10'000'000};
+    const auto threads = options::get_num_threads(options);
+    ThreadPool pool {threads && *threads > 1 ? *threads : 0};
+    std::vector<std::future<std::vector<BadRegionDetector::BadRegion>>> chunk_bad_regions {};
+    for (const auto& p : input_regions) {
+        for (const auto& region : p.second) {
+            for (auto chunk_begin = region.begin(); chunk_begin < region.end(); chunk_begin += max_chunk_size) {
+                const GenomicRegion chunk {region.contig_name(), chunk_begin, std::min(chunk_begin + max_chunk_size, region.end())};
+                chunk_bad_regions.push_back(pool.push([&, chunk] () { return detector->detect(source, samples, chunk); }));
+            }
+        }
+    }
+    for (auto& bad_regions : chunk_bad_regions) {
+        for (auto& bad_region : bad_regions.get()) {
+            result[bad_region.region.contig_name()].insert(std::move(bad_region.region));
+        }
+    }
+    return result;
+}
+
 static const AlignedRead typical_illumina_read {
     "HISEQ1:9:H8962ADXX:2:1108:11915:94551",
     GenomicRegion {"1", 63492953, 63493103},
@@ -526,9 +675,32 @@ auto get_unfiltered_path(const fs::path& native)
     return add_identifier(native, "unfiltered");
 }
 
-auto generate_temp_output_path(const fs::path& temp_directory)
+bool can_use_bcf(const std::vector<GenomicRegion::ContigName>& contigs)
+{
+    // htslib cannot parse ':' in contig names.
+    // See https://github.com/samtools/htslib/pull/708
+    return std::none_of(std::cbegin(contigs), std::cend(contigs), [] (const auto& contig) {
+        return std::find(std::cbegin(contig), std::cend(contig), ':') != std::cend(contig); });
+}
+
+auto to_bcf_path(fs::path path)
+{
+    if (path.extension().string() == ".gz") path.replace_extension();
+    return path.replace_extension(".bcf");
+}
+
+// Temporary unfiltered calls are only read back by the call filter, so are kept as BCF when possible.
+// This avoids formatting and re-parsing VCF text (and the VCF.GZ compression round trip) between calling and filtering.
+auto generate_temp_unfiltered_path(const fs::path& temp_directory, const fs::path& file_name,
+                                   const std::vector<GenomicRegion::ContigName>& contigs)
 {
-    return temp_directory / "octopus_unfiltered.bcf";
+    auto result = temp_directory / file_name;
+    return can_use_bcf(contigs) ? to_bcf_path(std::move(result)) : result;
+}
+
+auto generate_temp_output_path(const fs::path& temp_directory, const std::vector<GenomicRegion::ContigName>& contigs)
+{
+    return generate_temp_unfiltered_path(temp_directory, "octopus_unfiltered.vcf", contigs);
 }
 
 bool all_samples_in_vcf(std::vector<SampleName> samples, const VcfReader& in)
@@ -590,16 +762,24 @@ GenomeCallingComponents::Components::Components(ReferenceGenome&& reference, Rea
 , contigs {get_contigs(this->regions, this->reference, options::get_contig_output_order(options))}
 , ploidies {options::get_ploidy_map(options)}
 , reads_profile {profile_reads_helper(this->samples, this->reference, this->regions, this->read_manager, this->ploidies, options)}
+, bad_regions {find_bad_regions_helper(this->samples, this->regions, this->read_manager, this->reads_profile, options)}
+, debug_regions {options::get_debug_regions(options, this->reference)}
 , read_pipe {options::make_read_pipe(this->read_manager, this->reference, this->samples, options)}
 , haplotype_likelihood_model {options::make_calling_haplotype_likelihood_model(options, optional_cref(this->reads_profile))}
 , realignment_haplotype_likelihood_model {options::make_realignment_haplotype_likelihood_model(haplotype_likelihood_model, optional_cref(this->reads_profile), options)}
 , caller_factory {options::make_caller_factory(this->reference, this->read_pipe, this->regions, options, optional_cref(this->reads_profile))}
+, secondary_caller_factory {options::make_secondary_caller_factory(this->reference, this->read_pipe, options, optional_cref(this->reads_profile))}
 , filter_read_pipe {}
 , output {std::move(output)}
 , filtered_output {}
+, secondary_output {}
 , num_threads {options::get_num_threads(options)}
+, numa_aware {options::is_numa_aware(options)}
+, task_prefetch_depth {options::get_task_prefetch_depth(options)}
 , read_buffer_footprint {options::get_target_read_buffer_size(options)}
 , read_buffer_size {}
+, compress_read_buffer {options::compress_read_buffer(options)}
+, buffer_memory {}
 , progress_meter {regions}
 , pedigree {options::get_pedigree(options, samples)}
 , sites_only {options::call_sites_only(options)}
@@ -607,11 +787,21 @@ GenomeCallingComponents::Components::Components(ReferenceGenome&& reference, Rea
 , bamout {options::bamout_request(options)}
 , bamout_config {}
 , data_profile {options::data_profile_request(options)}
+, columnar_output {options::columnar_output_request(options)}
+, task_report {options::task_report_request(options)}
+, performance_report {options::performance_report_request(options)}
+, progress_report {options::progress_report_request(options)}
+, progress_report_interval {options::get_progress_report_interval(options)}
+, task_time_budget {options::get_task_time_budget(options)}
+, site_likelihoods {options::writes_site_likelihoods(options)}
 , profiler_config {}
+, shard_manifest_request {options::shard_manifest_request(options)}
+, shard_merge_request {options::shard_merge_request(options, this->reference)}
 {
     drop_unused_samples(this->samples, this->read_manager);
     setup_progress_meter(options);
     set_read_buffer_size(options);
+    setup_memory_budget(options);
     setup_filter_read_pipe(options);
     filter_request = options::filter_request(options);
     if (filter_request && !all_samples_in_vcf(samples, *filter_request)) {
@@ -626,12 +816,15 @@ GenomeCallingComponents::Components::Components(ReferenceGenome&& reference, Rea
         throw;
     }
     keep_temp_files = options::keep_temporary_files(options);
+    resume = options::is_resume_requested(options);
+    max_in_memory_calls_footprint = options::get_max_in_memory_calls_size(options);
     bamout_config.alignment_model = realignment_haplotype_likelihood_model;
     bamout_config.copy_hom_ref_reads = options::full_bamouts_requested(options);
     bamout_config.max_buffer = read_buffer_footprint;
     bamout_config.max_threads = num_threads;
     bamout_config.read_linkage.linkage = options::get_read_linkage_type(options);
     profiler_config.alignment_model = bamout_config.alignment_model;
+    profiler_config.target_reads_per_context = options::get_data_profile_sample_size(options);
     if (reads_profile && reads_profile->length_stats.median > 1'000) {
         profiler_config.ignore_likely_misaligned_reads = false;
     }
@@ -653,11 +846,24 @@ void GenomeCallingComponents::Components::set_read_buffer_size(const options::Op
 {
     if (!samples.empty() && !regions.empty() && read_manager.good()) {
         read_buffer_size = calculate_max_num_reads(options::get_target_read_buffer_size(options), reads_profile);
+        // Concurrent tasks may request reads another task has already fetched (e.g. when a task is split)
+        if (!num_threads || *num_threads > 1) read_pipe.set_shared_cache(read_buffer_size);
     }
 }
 
+void GenomeCallingComponents::Components::setup_memory_budget(const options::OptionMap& options)
+{
+    auto& budget = process_memory_budget();
+    budget.set_limit(options::get_max_memory(options));
+    buffer_memory = MemoryBudget::Reservation {budget, read_buffer_footprint + options::get_max_reference_cache_size(options)};
+}
+
 void GenomeCallingComponents::Components::setup_writers(const options::OptionMap& options)
 {
+    const auto secondary_output_path = options::get_secondary_output_path(options);
+    if (secondary_output_path) {
+        secondary_output = make_vcf_writer(*secondary_output_path, output.encoding_context());
+    }
     if (call_filter_factory) {
         const auto final_output_path = output.path();
         filtered_output = std::move(output);
@@ -667,11 +873,11 @@ void GenomeCallingComponents::Components::setup_writers(const options::OptionMap
                 prefilter_path = get_unfiltered_path(*final_output_path);
             } else {
                 assert(temp_directory);
-                prefilter_path = *temp_directory / get_unfiltered_path(final_output_path->filename());
+                prefilter_path = generate_temp_unfiltered_path(*temp_directory, get_unfiltered_path(final_output_path->filename()), contigs);
             }
         } else {
             assert(temp_directory);
-            prefilter_path = generate_temp_output_path(*temp_directory);
+            prefilter_path = generate_temp_output_path(*temp_directory, contigs);
         }
         output.open(std::move(prefilter_path));
     }
@@ -692,6 +898,10 @@ void GenomeCallingComponents::update_dependents() noexcept
     }
     components_.caller_factory.set_reference(components_.reference);
     components_.caller_factory.set_read_pipe(components_.read_pipe);
+    if (components_.secondary_caller_factory) {
+        components_.secondary_caller_factory->set_reference(components_.reference);
+        components_.secondary_caller_factory->set_read_pipe(components_.read_pipe);
+    }
 }
 
 namespace {
@@ -742,14 +952,21 @@ private:
 
 VcfWriter make_output_vcf_writer(const options::OptionMap& options)
 {
-    return make_vcf_writer(options::get_output_path(options));
+    const auto num_compression_threads = options::get_num_output_compression_threads(options);
+    std::shared_ptr<HtslibEncodingContext> encoding_context {};
+    if (num_compression_threads > 0) encoding_context = std::make_shared<HtslibEncodingContext>(num_compression_threads);
+    return make_vcf_writer(options::get_output_path(options), std::move(encoding_context));
 }
 
 } // namespace
 
 GenomeCallingComponents collate_genome_calling_components(const options::OptionMap& options)
 {
-    auto reference    = options::make_reference(options);
+    return collate_genome_calling_components(options::make_reference(options), options);
+}
+
+GenomeCallingComponents collate_genome_calling_components(ReferenceGenome reference, const options::OptionMap& options)
+{
     auto read_manager = options::make_read_manager(options);
     // Check this here to avoid creating output file on error
     if (!options::ignore_unmapped_contigs(options) && !all_reference_contigs_mapped(read_manager, reference)) {
@@ -796,27 +1013,83 @@ void cleanup(GenomeCallingComponents& components) noexcept
     }
 }
 
+namespace {
+
+boost::optional<InputRegionMap::mapped_type>
+get_debug_regions(const GenomicRegion::ContigName& contig, const GenomeCallingComponents& genome_components)
+{
+    const auto& debug_regions = genome_components.debug_regions();
+    if (debug_regions.empty()) return boost::none;
+    if (debug_regions.count(contig) == 0) return InputRegionMap::mapped_type {};
+    return debug_regions.at(contig);
+}
+
+std::unique_ptr<const Caller>
+make_secondary_caller(const GenomicRegion::ContigName& contig, const GenomeCallingComponents& genome_components)
+{
+    if (genome_components.secondary_caller_factory()) {
+        return genome_components.secondary_caller_factory()->make(contig);
+    } else {
+        return nullptr;
+    }
+}
+
+} // namespace
+
 ContigCallingComponents::ContigCallingComponents(const GenomicRegion::ContigName& contig,
                                                  GenomeCallingComponents& genome_components)
 : reference {genome_components.reference()}
 , read_manager {genome_components.read_manager()}
 , regions {genome_components.search_regions().at(contig)}
+, bad_regions {}
+, debug_regions {get_debug_regions(contig, genome_components)}
 , samples {genome_components.samples()}
 , caller {genome_components.caller_factory().make(contig)}
+, secondary_caller {make_secondary_caller(contig, genome_components)}
 , read_buffer_size {genome_components.read_buffer_size()}
 , output {genome_components.output()}
+, secondary_output {genome_components.secondary_output()}
 , progress_meter {genome_components.progress_meter()}
-{}
+{
+    if (genome_components.bad_regions().count(contig) == 1) {
+        bad_regions = genome_components.bad_regions().at(contig);
+    }
+}
 
 ContigCallingComponents::ContigCallingComponents(const GenomicRegion::ContigName& contig, VcfWriter& output,
                                                  GenomeCallingComponents& genome_components)
 : reference {genome_components.reference()}
 , read_manager {genome_components.read_manager()}
 , regions {genome_components.search_regions().at(contig)}
+, bad_regions {}
+, debug_regions {get_debug_regions(contig, genome_components)}
 , samples {genome_components.samples()}
 , caller {genome_components.caller_factory().make(contig)}
+, secondary_caller {make_secondary_caller(contig, genome_components)}
 , read_buffer_size {genome_components.read_buffer_size()}
 , output {output}
+, secondary_output {genome_components.secondary_output()}
+, progress_meter {genome_components.progress_meter()}
+{
+    if (genome_components.bad_regions().count(contig) == 1) {
+        bad_regions = genome_components.bad_regions().at(contig);
+    }
+}
+
+ContigCallingComponents::ContigCallingComponents(const GenomicRegion::ContigName& contig,
+                                                 GenomeCallingComponents& genome_components,
+                                                 TaskScope)
+: reference {genome_components.reference()}
+, read_manager {genome_components.read_manager()}
+, regions {}
+, bad_regions {}
+, debug_regions {get_debug_regions(contig, genome_components)}
+, samples {genome_components.samples()}
+, caller {genome_components.caller_factory().make(contig)}
+, secondary_caller {make_secondary_caller(contig, genome_components)}
+, read_buffer_size {genome_components.read_buffer_size()}
+, output {genome_components.output()}
+, secondary_output {genome_components.secondary_output()}
 , progress_meter {genome_components.progress_meter()}
 {}
 
@@ -6,6 +6,7 @@
 
 #include <vector>
 #include <cstddef>
+#include <chrono>
 #include <functional>
 #include <memory>
 
@@ -14,6 +15,7 @@
 
 #include "config/common.hpp"
 #include "config/option_parser.hpp"
+#include "config/option_collation.hpp"
 #include "basics/genomic_region.hpp"
 #include "basics/ploidy_map.hpp"
 #include "basics/pedigree.hpp"
@@ -27,6 +29,7 @@
 #include "core/tools/bam_realigner.hpp"
 #include "core/tools/indel_profiler.hpp"
 #include "utils/memory_footprint.hpp"
+#include "utils/memory_budget.hpp"
 #include "utils/input_reads_profiler.hpp"
 #include "logging/progress_meter.hpp"
 
@@ -61,14 +64,22 @@ public:
     const VcfWriter& output() const noexcept;
     MemoryFootprint read_buffer_footprint() const noexcept;
     std::size_t read_buffer_size() const noexcept;
+    bool compress_read_buffer() const noexcept;
     const boost::optional<Path>& temp_directory() const noexcept;
     bool keep_temporary_files() const noexcept;
+    bool resume_requested() const noexcept;
+    MemoryFootprint max_in_memory_calls_footprint() const noexcept;
     boost::optional<unsigned> num_threads() const noexcept;
+    bool numa_aware() const noexcept;
+    unsigned task_prefetch_depth() const noexcept;
     const HaplotypeLikelihoodModel& haplotype_likelihood_model() const noexcept;
     HaplotypeLikelihoodModel realignment_haplotype_likelihood_model() const;
     const CallerFactory& caller_factory() const noexcept;
+    boost::optional<const CallerFactory&> secondary_caller_factory() const noexcept;
     boost::optional<VcfWriter&> filtered_output() noexcept;
     boost::optional<const VcfWriter&> filtered_output() const noexcept;
+    boost::optional<VcfWriter&> secondary_output() noexcept;
+    boost::optional<const VcfWriter&> secondary_output() const noexcept;
     const VariantCallFilterFactory& call_filter_factory() const;
     ReadPipe& filter_read_pipe() noexcept;
     const ReadPipe& filter_read_pipe() const noexcept;
@@ -80,8 +91,19 @@ public:
     boost::optional<Path> bamout() const;
     BAMRealigner::Config bamout_config() const noexcept;
     boost::optional<const ReadSetProfile&> reads_profile() const noexcept;
+    const InputRegionMap& bad_regions() const noexcept;
+    const InputRegionMap& debug_regions() const noexcept;
     boost::optional<Path> data_profile() const;
+    boost::optional<Path> columnar_output() const;
+    boost::optional<Path> task_report() const;
+    boost::optional<Path> performance_report() const;
+    boost::optional<Path> progress_report() const;
+    std::chrono::seconds progress_report_interval() const noexcept;
+    boost::optional<std::chrono::seconds> task_time_budget() const noexcept;
+    bool site_likelihoods() const noexcept;
     IndelProfiler::ProfileConfig profiler_config() const;
+    boost::optional<const options::ShardManifestRequest&> shard_manifest_request() const noexcept;
+    boost::optional<const options::ShardMergeRequest&> shard_merge_request() const noexcept;
     
 private:
     struct Components
@@ -105,16 +127,24 @@ private:
         std::vector<GenomicRegion::ContigName> contigs;
         PloidyMap ploidies;
         boost::optional<ReadSetProfile> reads_profile;
+        InputRegionMap bad_regions; // found from read depths alone
+        InputRegionMap debug_regions; // empty unless debug logging is restricted to some regions
         ReadPipe read_pipe;
         HaplotypeLikelihoodModel haplotype_likelihood_model;
         HaplotypeLikelihoodModel realignment_haplotype_likelihood_model;
         CallerFactory caller_factory;
+        boost::optional<CallerFactory> secondary_caller_factory;
         boost::optional<ReadPipe> filter_read_pipe;
         VcfWriter output;
         boost::optional<VcfWriter> filtered_output;
+        boost::optional<VcfWriter> secondary_output;
         boost::optional<unsigned> num_threads;
+        bool numa_aware;
+        unsigned task_prefetch_depth;
         MemoryFootprint read_buffer_footprint;
         std::size_t read_buffer_size;
+        bool compress_read_buffer;
+        MemoryBudget::Reservation buffer_memory; // the read buffer and reference cache
         ProgressMeter progress_meter;
         boost::optional<Pedigree> pedigree;
         bool sites_only;
@@ -122,16 +152,28 @@ private:
         boost::optional<Path> bamout;
         BAMRealigner::Config bamout_config;
         boost::optional<Path> data_profile;
+        boost::optional<Path> columnar_output;
+        boost::optional<Path> task_report;
+        boost::optional<Path> performance_report;
+        boost::optional<Path> progress_report;
+        std::chrono::seconds progress_report_interval;
+        boost::optional<std::chrono::seconds> task_time_budget;
+        bool site_likelihoods;
         IndelProfiler::ProfileConfig profiler_config;
+        boost::optional<options::ShardManifestRequest> shard_manifest_request;
+        boost::optional<options::ShardMergeRequest> shard_merge_request;
         
         // Components that require temporary directory during construction appear last to make
         // exception handling easier.
         boost::optional<Path> temp_directory;
         bool keep_temp_files;
+        bool resume;
+        MemoryFootprint max_in_memory_calls_footprint;
         std::unique_ptr<VariantCallFilterFactory> call_filter_factory;
         
         void setup_progress_meter(const options::OptionMap& options);
         void set_read_buffer_size(const options::OptionMap& options);
+        void setup_memory_budget(const options::OptionMap& options);
         void setup_writers(const options::OptionMap& options);
         void setup_filter_read_pipe(const options::OptionMap& options);
     };
@@ -142,6 +184,8 @@ private:
 };
 
 GenomeCallingComponents collate_genome_calling_components(const options::OptionMap& options);
+// Uses the given reference rather than loading the one in options
+GenomeCallingComponents collate_genome_calling_components(ReferenceGenome reference, const options::OptionMap& options);
 
 bool validate(const GenomeCallingComponents& components);
 
@@ -152,10 +196,14 @@ struct ContigCallingComponents
     std::reference_wrapper<const ReferenceGenome> reference;
     std::reference_wrapper<const ReadManager> read_manager;
     InputRegionMap::mapped_type regions;
+    InputRegionMap::mapped_type bad_regions;
+    boost::optional<InputRegionMap::mapped_type> debug_regions; // none if debug logging is not restricted
     std::reference_wrapper<const std::vector<SampleName>> samples;
     std::unique_ptr<const Caller> caller;
+    std::unique_ptr<const Caller> secondary_caller; // calls the reads and candidates of caller
     std::size_t read_buffer_size;
     std::reference_wrapper<VcfWriter> output;
+    boost::optional<VcfWriter&> secondary_output;
     std::reference_wrapper<ProgressMeter> progress_meter;
     
     ContigCallingComponents() = delete;
@@ -166,6 +214,13 @@ struct ContigCallingComponents
     ContigCallingComponents(const GenomicRegion::ContigName& contig, VcfWriter& output,
                             GenomeCallingComponents& genome_components);
     
+    // For calling a single task of the contig: regions and bad_regions are left empty as tasks
+    // already know their region, so only the per-task caller is built
+    struct TaskScope {};
+    ContigCallingComponents(const GenomicRegion::ContigName& contig,
+                            GenomeCallingComponents& genome_components,
+                            TaskScope);
+    
     ContigCallingComponents(const ContigCallingComponents&)            = delete;
     ContigCallingComponents& operator=(const ContigCallingComponents&) = delete;
     ContigCallingComponents(ContigCallingComponents&&)                 = default;
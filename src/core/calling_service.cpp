@@ -0,0 +1,310 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "calling_service.hpp"
+
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <future>
+#include <deque>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include "config/option_collation.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "core/calling_components.hpp"
+#include "core/octopus.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/timing.hpp"
+#include "exceptions/user_error.hpp"
+#include "exceptions/system_error.hpp"
+#include "logging/logging.hpp"
+#include "logging/error_handler.hpp"
+
+namespace octopus {
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+class ServiceSocketError : public SystemError
+{
+    std::string do_where() const override { return "run_calling_service"; }
+    std::string do_why() const override
+    {
+        return "could not " + action_ + " the service socket " + socket_.string() + ": " + reason_;
+    }
+    std::string do_help() const override
+    {
+        return "check the socket path is writable and is not in use by another service";
+    }
+    fs::path socket_;
+    std::string action_, reason_;
+public:
+    ServiceSocketError(fs::path socket, std::string action)
+    : socket_ {std::move(socket)}, action_ {std::move(action)}, reason_ {std::strerror(errno)} {}
+};
+
+class MissingServiceSocket : public UserError
+{
+    std::string do_where() const override { return "run_calling_service"; }
+    std::string do_why() const override { return "the serve command requires a socket to accept jobs on"; }
+    std::string do_help() const override { return "set the --service-socket option"; }
+};
+
+class MissingJobOutput : public UserError
+{
+    std::string do_where() const override { return "run_calling_service"; }
+    std::string do_why() const override { return "service jobs cannot write calls to stdout"; }
+    std::string do_help() const override { return "add --output to the job"; }
+};
+
+// The memory budget and performance counters are process wide, so are shared by every job of the service
+class UnsupportedServiceOption : public UserError
+{
+    std::string do_where() const override { return "run_calling_service"; }
+    std::string do_why() const override { return "the option --" + option_ + " cannot be used " + context_; }
+    std::string do_help() const override { return help_; }
+    std::string option_, context_, help_;
+public:
+    UnsupportedServiceOption(std::string option, std::string context, std::string help)
+    : option_ {std::move(option)}, context_ {std::move(context)}, help_ {std::move(help)} {}
+};
+
+void check_report_options(const options::OptionMap& options, const std::string& context)
+{
+    for (const std::string option : {"performance-report", "progress-report"}) {
+        if (options.count(option) == 1) {
+            throw UnsupportedServiceOption {option, context, "run the job with the octopus command to get this report"};
+        }
+    }
+}
+
+bool is_set_by(const std::vector<std::string>& arguments, const std::string& option)
+{
+    const auto flag = "--" + option;
+    return std::any_of(std::cbegin(arguments), std::cend(arguments), [&] (const std::string& argument) {
+        return argument == flag || argument.compare(0, flag.size() + 1, flag + '=') == 0;
+    });
+}
+
+// Owns a listening Unix domain socket, removing the socket file when closed
+class ServiceSocket
+{
+public:
+    ServiceSocket(fs::path path) : path_ {std::move(path)}
+    {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if (path_.string().size() >= sizeof(address.sun_path)) {
+            errno = ENAMETOOLONG;
+            throw ServiceSocketError {path_, "bind"};
+        }
+        std::strncpy(address.sun_path, path_.c_str(), sizeof(address.sun_path) - 1);
+        fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd_ < 0) throw ServiceSocketError {path_, "create"};
+        ::unlink(path_.c_str()); // a stale socket from a previous service
+        if (::bind(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(fd_);
+            throw ServiceSocketError {path_, "bind"};
+        }
+        if (::listen(fd_, SOMAXCONN) != 0) {
+            ::close(fd_);
+            ::unlink(path_.c_str());
+            throw ServiceSocketError {path_, "listen on"};
+        }
+    }
+
+    ServiceSocket(const ServiceSocket&)            = delete;
+    ServiceSocket& operator=(const ServiceSocket&) = delete;
+
+    ~ServiceSocket()
+    {
+        ::close(fd_);
+        ::unlink(path_.c_str());
+    }
+
+    // Returns a negative descriptor if accept fails
+    int accept() const noexcept
+    {
+        int result;
+        do { result = ::accept(fd_, nullptr, nullptr); } while (result < 0 && errno == EINTR);
+        return result;
+    }
+
+private:
+    fs::path path_;
+    int fd_;
+};
+
+// A connection to a single client, closed on destruction
+class Connection
+{
+public:
+    Connection(int fd) noexcept : fd_ {fd} {}
+    Connection(const Connection&)            = delete;
+    Connection& operator=(const Connection&) = delete;
+    Connection(Connection&& other) noexcept : fd_ {other.fd_} { other.fd_ = -1; }
+    ~Connection() { if (fd_ >= 0) ::close(fd_); }
+
+    std::string read_line() const
+    {
+        static constexpr std::size_t maxLineLength {1 << 16};
+        std::string result {};
+        char c;
+        while (result.size() < maxLineLength) {
+            const auto num_read = ::read(fd_, &c, 1);
+            if (num_read < 0 && errno == EINTR) continue;
+            if (num_read <= 0 || c == '\n') break;
+            result.push_back(c);
+        }
+        if (!result.empty() && result.back() == '\r') result.pop_back();
+        return result;
+    }
+
+    void write_line(std::string line) const noexcept
+    {
+        line.push_back('\n');
+        std::size_t num_written {0};
+        while (num_written < line.size()) {
+            const auto n = ::write(fd_, line.data() + num_written, line.size() - num_written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return; // client has gone; the job's output is still written
+            num_written += n;
+        }
+    }
+
+private:
+    int fd_;
+};
+
+std::vector<std::string> split_arguments(const std::string& line)
+{
+    auto result = utils::split(line, " \t");
+    result.erase(std::remove(std::begin(result), std::end(result), std::string {}), std::end(result));
+    return result;
+}
+
+options::OptionMap parse_job_options(const std::vector<std::string>& service_arguments,
+                                     const std::vector<std::string>& job_arguments)
+{
+    std::vector<const char*> argv {};
+    argv.reserve(service_arguments.size() + job_arguments.size());
+    for (const auto& argument : service_arguments) argv.push_back(argument.c_str());
+    for (const auto& argument : job_arguments) argv.push_back(argument.c_str());
+    auto result = options::parse_options(static_cast<int>(argv.size()), argv.data());
+    if (result.count("output") == 0) throw MissingJobOutput {};
+    check_report_options(result, "in service jobs");
+    if (is_set_by(job_arguments, "max-memory")) {
+        throw UnsupportedServiceOption {"max-memory", "in service jobs",
+                                        "set --max-memory when starting the service to limit the memory of all its jobs"};
+    }
+    return result;
+}
+
+std::string describe(const Error& error)
+{
+    return error.why() + " (" + error.help() + ")";
+}
+
+class CallingService
+{
+public:
+    CallingService(const options::OptionMap& options, std::vector<std::string> arguments)
+    : arguments_ {std::move(arguments)}
+    , reference_ {options::make_reference(options)}
+    , workers_ {options::get_max_service_jobs(options)}
+    , num_jobs_ {0}
+    {}
+
+    // Takes jobs until a client requests shutdown, then waits for running jobs to finish
+    void serve(const ServiceSocket& socket)
+    {
+        logging::InfoLogger info_log {};
+        std::deque<std::future<void>> jobs {};
+        for (;;) {
+            const auto fd = socket.accept();
+            if (fd < 0) {
+                logging::WarningLogger warn_log {};
+                stream(warn_log) << "Failed to accept service connection: " << std::strerror(errno);
+                continue;
+            }
+            Connection connection {fd};
+            auto line = connection.read_line();
+            if (line == "SHUTDOWN") {
+                info_log << "Received shutdown request. Waiting for running jobs to finish";
+                for (auto& job : jobs) job.get();
+                connection.write_line("OK");
+                return;
+            }
+            const auto job_id = ++num_jobs_;
+            stream(info_log) << "Received job " << job_id << ": " << line;
+            jobs.push_back(workers_.push([this, job_id, connection = std::move(connection), line = std::move(line)] () {
+                connection.write_line(run_job(job_id, split_arguments(line)));
+            }));
+            jobs.erase(std::remove_if(std::begin(jobs), std::end(jobs), [] (const auto& job) {
+                return job.wait_for(std::chrono::seconds {0}) == std::future_status::ready;
+            }), std::end(jobs));
+        }
+    }
+
+private:
+    std::vector<std::string> arguments_;
+    ReferenceGenome reference_;
+    ThreadPool workers_;
+    std::size_t num_jobs_;
+    // Collation creates the temporary directory and reads the shared reference, so is done one job at a time
+    std::mutex collation_mutex_;
+
+    std::string run_job(const std::size_t job_id, const std::vector<std::string>& job_arguments) noexcept
+    {
+        try {
+            const auto start = std::chrono::system_clock::now();
+            const auto options = parse_job_options(arguments_, job_arguments);
+            std::unique_lock<std::mutex> lock {collation_mutex_};
+            auto components = collate_genome_calling_components(reference_, options);
+            lock.unlock();
+            if (!validate(components)) return "ERROR invalid job";
+            run_octopus(components, {utils::join(job_arguments, ' '), options::to_string(options, true, false)});
+            logging::InfoLogger info_log {};
+            stream(info_log) << "Finished job " << job_id << " in "
+                             << utils::TimeInterval {start, std::chrono::system_clock::now()};
+            return "OK";
+        } catch (const Error& e) {
+            log_error(e);
+            return "ERROR " + describe(e);
+        } catch (const std::exception& e) {
+            log_error(e);
+            return std::string {"ERROR "} + e.what();
+        } catch (...) {
+            return "ERROR unknown";
+        }
+    }
+};
+
+} // namespace
+
+void run_calling_service(const options::OptionMap& options, std::vector<std::string> arguments)
+{
+    const auto socket_path = options::get_service_socket_path(options);
+    if (!socket_path) throw MissingServiceSocket {};
+    check_report_options(options, "with the serve command");
+    CallingService service {options, std::move(arguments)};
+    const ServiceSocket socket {*socket_path};
+    logging::InfoLogger info_log {};
+    stream(info_log) << "Accepting calling jobs on " << *socket_path;
+    service.serve(socket);
+}
+
+} // namespace octopus
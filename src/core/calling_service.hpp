@@ -0,0 +1,29 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef calling_service_hpp
+#define calling_service_hpp
+
+#include <string>
+#include <vector>
+
+#include "config/option_parser.hpp"
+
+namespace octopus {
+
+/*
+    Runs octopus as a long-lived service that accepts calling jobs on the Unix domain socket given by
+    --service-socket. The reference is loaded once, when the service starts, and copies are given to
+    each job; random forests are shared between jobs that use the same forest files.
+
+    Each connection sends one job: a single line of command line arguments that are appended to the
+    service's own arguments (e.g. '--reads a.bam --regions chr1:1000-2000 --output a.vcf.gz'). The
+    service replies with 'OK' once the job's output is written, or 'ERROR' followed by a description
+    if the job fails. Up to --max-service-jobs jobs run at once; later jobs wait for a free slot.
+    Sending the line 'SHUTDOWN' stops the service once running jobs have finished.
+ */
+void run_calling_service(const options::OptionMap& options, std::vector<std::string> arguments);
+
+} // namespace octopus
+
+#endif
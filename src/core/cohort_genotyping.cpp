@@ -0,0 +1,455 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "cohort_genotyping.hpp"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <numeric>
+#include <iterator>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include "config/common.hpp"
+#include "config/option_collation.hpp"
+#include "basics/genomic_region.hpp"
+#include "basics/phred.hpp"
+#include "core/types/haplotype.hpp"
+#include "core/types/indexed_haplotype.hpp"
+#include "core/types/genotype.hpp"
+#include "core/models/genotype/hardy_weinberg_model.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "io/variant/vcf.hpp"
+#include "io/variant/vcf_spec.hpp"
+#include "config/octopus_vcf.hpp"
+#include "utils/maths.hpp"
+#include "utils/string_utils.hpp"
+#include "exceptions/user_error.hpp"
+#include "logging/logging.hpp"
+
+namespace octopus {
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+class MissingCohortLikelihoods : public UserError
+{
+    std::string do_where() const override { return "run_cohort_genotyping"; }
+    std::string do_why() const override { return "the merge-cohort command requires files of sample genotype likelihoods"; }
+    std::string do_help() const override { return "set the --cohort-likelihoods option"; }
+};
+
+class UnsortedCohortLikelihoods : public UserError
+{
+    std::string do_where() const override { return "run_cohort_genotyping"; }
+    std::string do_why() const override
+    {
+        return "the records in " + file_.string() + " are not sorted in reference contig order";
+    }
+    std::string do_help() const override { return "sort the file so its contigs are in the same order as the reference"; }
+    fs::path file_;
+public:
+    UnsortedCohortLikelihoods(fs::path file) : file_ {std::move(file)} {}
+};
+
+// Reference contig index and position, which all sources must be sorted by
+using SiteKey = std::pair<std::size_t, GenomicRegion::Position>;
+
+class LikelihoodSource
+{
+public:
+    LikelihoodSource(const fs::path& file, const std::unordered_map<std::string, std::size_t>& contig_indices)
+    : reader_ {file}
+    , samples_ {reader_.fetch_header().samples()}
+    , records_ {reader_.iterate()}
+    , contig_indices_ {contig_indices}
+    , key_ {}
+    {
+        skip_unknown_contigs();
+    }
+
+    const std::vector<SampleName>& samples() const noexcept { return samples_; }
+    bool done() const { return records_.first == records_.second; }
+    const SiteKey& key() const noexcept { return key_; }
+    const VcfRecord& record() const { return *records_.first; }
+
+    void next()
+    {
+        const auto prev_key = key_;
+        ++records_.first;
+        skip_unknown_contigs();
+        if (!done() && key_ < prev_key) throw UnsortedCohortLikelihoods {reader_.path()};
+    }
+
+private:
+    VcfReader reader_;
+    std::vector<SampleName> samples_;
+    VcfReader::RecordIteratorPair records_;
+    const std::unordered_map<std::string, std::size_t>& contig_indices_;
+    SiteKey key_;
+
+    void skip_unknown_contigs()
+    {
+        for (; !done(); ++records_.first) {
+            const auto contig_itr = contig_indices_.find(records_.first->chrom());
+            if (contig_itr != std::cend(contig_indices_)) {
+                key_ = {contig_itr->second, records_.first->pos()};
+                return;
+            }
+        }
+    }
+};
+
+using GenotypeAlleleIndices = std::vector<std::vector<unsigned>>;
+using Log10GenotypeLikelihoods = std::vector<double>;
+
+// GL fields are 'G' cardinality, so the ploidy is the one with that many genotypes
+boost::optional<unsigned> infer_ploidy(const std::size_t num_genotypes, const unsigned num_alleles)
+{
+    constexpr unsigned maxPloidy {10};
+    std::size_t num_ploidy_genotypes {1};
+    for (unsigned ploidy {1}; ploidy <= maxPloidy; ++ploidy) {
+        // the number of multisets of size ploidy from num_alleles elements
+        num_ploidy_genotypes = num_ploidy_genotypes * (num_alleles + ploidy - 1) / ploidy;
+        if (num_ploidy_genotypes == num_genotypes) return ploidy;
+        if (num_ploidy_genotypes > num_genotypes) break;
+    }
+    return boost::none;
+}
+
+boost::optional<Log10GenotypeLikelihoods> get_likelihoods(const VcfRecord& record, const SampleName& sample)
+{
+    if (!record.has_format(vcfspec::format::likelihoods)) return boost::none;
+    const auto& values = record.get_sample_value(sample, vcfspec::format::likelihoods);
+    if (values.empty()) return boost::none;
+    Log10GenotypeLikelihoods result(values.size());
+    for (std::size_t i {0}; i < values.size(); ++i) {
+        if (values[i] == vcfspec::missingValue) return boost::none;
+        try {
+            result[i] = std::stod(values[i]);
+        } catch (const std::exception&) {
+            return boost::none;
+        }
+    }
+    return result;
+}
+
+struct SampleLikelihoods
+{
+    unsigned ploidy;
+    Log10GenotypeLikelihoods log10_likelihoods;
+};
+
+class SiteGenotyper
+{
+public:
+    struct GenotypeSet
+    {
+        GenotypeAlleleIndices alleles;
+        std::vector<Genotype<IndexedHaplotype<>>> genotypes;
+    };
+    
+    SiteGenotyper(const VcfRecord& site, const ReferenceGenome& reference)
+    : num_alleles_ {site.num_alt() + 1}
+    , haplotypes_ {}
+    , indexed_haplotypes_ {}
+    , genotypes_ {}
+    , hardy_weinberg_ {}
+    {
+        const auto begin = site.pos() - 1;
+        const GenomicRegion site_region {site.chrom(), begin, begin + static_cast<GenomicRegion::Size>(site.ref().size())};
+        haplotypes_.reserve(num_alleles_);
+        haplotypes_.emplace_back(site_region, site.ref(), reference);
+        for (const auto& alt : site.alt()) haplotypes_.emplace_back(site_region, alt, reference);
+        indexed_haplotypes_.reserve(num_alleles_);
+        for (unsigned i {0}; i < num_alleles_; ++i) indexed_haplotypes_.emplace_back(haplotypes_[i], i);
+    }
+    
+    SiteGenotyper(const SiteGenotyper&)            = delete;
+    SiteGenotyper& operator=(const SiteGenotyper&) = delete;
+    
+    unsigned num_alleles() const noexcept { return num_alleles_; }
+    
+    const GenotypeSet& genotypes(const unsigned ploidy)
+    {
+        auto itr = genotypes_.find(ploidy);
+        if (itr == std::cend(genotypes_)) {
+            GenotypeSet genotypes {get_genotype_allele_indices(num_alleles_, ploidy), {}};
+            genotypes.genotypes.reserve(genotypes.alleles.size());
+            for (const auto& alleles : genotypes.alleles) {
+                Genotype<IndexedHaplotype<>> genotype {ploidy};
+                for (const auto allele : alleles) genotype.emplace(indexed_haplotypes_[allele]);
+                genotypes.genotypes.push_back(std::move(genotype));
+            }
+            itr = genotypes_.emplace(ploidy, std::move(genotypes)).first;
+        }
+        return itr->second;
+    }
+    
+    // Finds the allele frequencies that maximise the likelihood of all samples under Hardy-Weinberg equilibrium
+    void estimate_frequencies(const std::vector<boost::optional<SampleLikelihoods>>& samples)
+    {
+        constexpr unsigned maxIterations {100};
+        constexpr double epsilon {1e-6}, minFrequency {1e-10};
+        hardy_weinberg_.set_frequencies(HardyWeinbergModel::HaplotypeFrequencyVector(num_alleles_, 1.0 / num_alleles_));
+        std::vector<double> expected_allele_counts(num_alleles_);
+        for (unsigned i {0}; i < maxIterations; ++i) {
+            std::fill(std::begin(expected_allele_counts), std::end(expected_allele_counts), 0.0);
+            for (const auto& sample : samples) {
+                if (!sample) continue;
+                const auto posteriors = genotype_posteriors(*sample);
+                const auto& alleles = genotypes(sample->ploidy).alleles;
+                for (std::size_t g {0}; g < alleles.size(); ++g) {
+                    for (const auto allele : alleles[g]) expected_allele_counts[allele] += posteriors[g];
+                }
+            }
+            if (maths::normalise(expected_allele_counts) <= 0) return;
+            // Keep every allele possible, otherwise its frequency can never recover
+            for (auto& frequency : expected_allele_counts) frequency = std::max(frequency, minFrequency);
+            maths::normalise(expected_allele_counts);
+            auto& frequencies = hardy_weinberg_.frequencies();
+            double max_change {0};
+            for (unsigned a {0}; a < num_alleles_; ++a) {
+                max_change = std::max(max_change, std::abs(frequencies[a] - expected_allele_counts[a]));
+                frequencies[a] = expected_allele_counts[a];
+            }
+            if (max_change < epsilon) break;
+        }
+    }
+    
+    const HardyWeinbergModel::HaplotypeFrequencyVector& frequencies() const noexcept
+    {
+        return hardy_weinberg_.frequencies();
+    }
+    
+    std::vector<double> genotype_posteriors(const SampleLikelihoods& sample)
+    {
+        static const double ln10 {std::log(10.0)};
+        const auto& genotypes = this->genotypes(sample.ploidy).genotypes;
+        std::vector<double> result(genotypes.size());
+        for (std::size_t g {0}; g < genotypes.size(); ++g) {
+            result[g] = ln10 * sample.log10_likelihoods[g] + hardy_weinberg_.evaluate(genotypes[g]);
+        }
+        maths::normalise_exp(result);
+        return result;
+    }
+    
+private:
+    unsigned num_alleles_;
+    std::vector<Haplotype> haplotypes_;
+    std::vector<IndexedHaplotype<>> indexed_haplotypes_; // refer to haplotypes_
+    std::map<unsigned, GenotypeSet> genotypes_;
+    HardyWeinbergModel hardy_weinberg_;
+};
+
+// A sample can be in several sources, e.g. when it is regenotyped at new sites
+struct CohortSample
+{
+    SampleName name;
+    std::vector<std::size_t> sources;
+};
+
+struct GenotypingCounts
+{
+    std::size_t num_sites, num_unevaluated_sites;
+};
+
+auto make_cohort_header(const std::vector<CohortSample>& samples, const ReferenceGenome& reference,
+                        const std::vector<GenomicRegion::ContigName>& contigs)
+{
+    std::vector<SampleName> sample_names(samples.size());
+    std::transform(std::cbegin(samples), std::cend(samples), std::begin(sample_names), [] (const auto& sample) { return sample.name; });
+    auto builder = vcf::make_header_template().set_samples(std::move(sample_names));
+    for (const auto& contig : contigs) {
+        builder.add_contig(contig, {{"length", std::to_string(reference.contig_size(contig))}});
+    }
+    builder.add_basic_field("reference", reference.name());
+    builder.add_info(vcfspec::info::alleleFrequency, "A", "Float", "Allele frequency estimated from the sample genotype likelihoods");
+    builder.add_format(vcfspec::format::likelihoods, "G", "Float", "log10-scaled genotype likelihoods");
+    return builder.build_once();
+}
+
+auto make_sites_header(const ReferenceGenome& reference, const std::vector<GenomicRegion::ContigName>& contigs)
+{
+    auto builder = vcf::make_header_template();
+    for (const auto& contig : contigs) {
+        builder.add_contig(contig, {{"length", std::to_string(reference.contig_size(contig))}});
+    }
+    builder.add_basic_field("reference", reference.name());
+    return builder.build_once();
+}
+
+void genotype_site(const std::vector<std::pair<std::size_t, const VcfRecord*>>& site_records,
+                   const std::vector<CohortSample>& samples,
+                   const ReferenceGenome& reference,
+                   VcfWriter& dst, boost::optional<VcfWriter>& unevaluated_dst,
+                   GenotypingCounts& counts)
+{
+    const VcfRecord& site {*site_records.front().second};
+    SiteGenotyper genotyper {site, reference};
+    std::vector<boost::optional<SampleLikelihoods>> likelihoods(samples.size());
+    for (std::size_t s {0}; s < samples.size(); ++s) {
+        boost::optional<Log10GenotypeLikelihoods> sample_likelihoods {};
+        for (const auto& p : site_records) {
+            const auto& sources = samples[s].sources;
+            if (std::find(std::cbegin(sources), std::cend(sources), p.first) != std::cend(sources)) {
+                sample_likelihoods = get_likelihoods(*p.second, samples[s].name);
+                if (sample_likelihoods) break;
+            }
+        }
+        if (!sample_likelihoods) continue;
+        const auto ploidy = infer_ploidy(sample_likelihoods->size(), genotyper.num_alleles());
+        if (!ploidy) continue;
+        likelihoods[s] = SampleLikelihoods {*ploidy, std::move(*sample_likelihoods)};
+    }
+    genotyper.estimate_frequencies(likelihoods);
+    VcfRecord::Builder record {};
+    record.set_chrom(site.chrom()).set_pos(site.pos()).set_id(site.id()).set_ref(site.ref()).set_alt(site.alt());
+    record.set_format({vcfspec::format::genotype, vcfspec::format::conditionalQuality, vcfspec::format::likelihoods});
+    std::vector<unsigned> allele_counts(genotyper.num_alleles());
+    unsigned num_samples_with_data {0};
+    double log_probability_all_reference {0};
+    for (std::size_t s {0}; s < samples.size(); ++s) {
+        const auto& sample = samples[s].name;
+        if (!likelihoods[s]) {
+            record.set_genotype(sample, std::vector<boost::optional<unsigned>> {boost::none}, VcfRecord::Builder::Phasing::unphased);
+            record.set_format_missing(sample, vcfspec::format::conditionalQuality);
+            record.set_format_missing(sample, vcfspec::format::likelihoods);
+            continue;
+        }
+        ++num_samples_with_data;
+        const auto posteriors = genotyper.genotype_posteriors(*likelihoods[s]);
+        const auto& genotypes = genotyper.genotypes(likelihoods[s]->ploidy).alleles;
+        const auto called_idx = std::distance(std::cbegin(posteriors), std::max_element(std::cbegin(posteriors), std::cend(posteriors)));
+        const auto& called = genotypes[called_idx];
+        record.set_genotype(sample, std::vector<boost::optional<unsigned>> {std::cbegin(called), std::cend(called)},
+                            VcfRecord::Builder::Phasing::unphased);
+        const auto gq = probability_false_to_phred(std::max(1.0 - posteriors[called_idx], std::numeric_limits<double>::min()));
+        record.set_format(sample, vcfspec::format::conditionalQuality, static_cast<int>(std::round(gq.score())));
+        record.set_format(sample, vcfspec::format::likelihoods, utils::to_strings(likelihoods[s]->log10_likelihoods, 2));
+        for (const auto allele : called) ++allele_counts[allele];
+        log_probability_all_reference += std::log(std::max(posteriors.front(), std::numeric_limits<double>::min()));
+    }
+    if (num_samples_with_data > 0) {
+        record.set_qual(log_probability_false_to_phred(log_probability_all_reference).score());
+    }
+    std::vector<std::string> alt_frequencies {}, alt_counts {};
+    for (unsigned a {1}; a < genotyper.num_alleles(); ++a) {
+        alt_frequencies.push_back(utils::to_string(genotyper.frequencies()[a], 4, utils::PrecisionRule::sf));
+        alt_counts.push_back(std::to_string(allele_counts[a]));
+    }
+    record.set_info(vcfspec::info::alleleFrequency, std::move(alt_frequencies));
+    record.set_info(vcfspec::info::alleleCount, std::move(alt_counts));
+    record.set_info(vcfspec::info::totalAlleleCount, std::accumulate(std::cbegin(allele_counts), std::cend(allele_counts), 0u));
+    record.set_info(vcfspec::info::numSamplesWithData, num_samples_with_data);
+    dst << record.build_once();
+    ++counts.num_sites;
+    if (num_samples_with_data < samples.size()) {
+        ++counts.num_unevaluated_sites;
+        if (unevaluated_dst) {
+            VcfRecord::Builder unevaluated_site {};
+            unevaluated_site.set_chrom(site.chrom()).set_pos(site.pos()).set_id(site.id()).set_ref(site.ref()).set_alt(site.alt());
+            *unevaluated_dst << unevaluated_site.build_once();
+        }
+    }
+}
+
+// Records at the same position are the same site if they have the same alleles
+auto group_sites(const std::vector<std::pair<std::size_t, const VcfRecord*>>& records)
+{
+    std::vector<std::vector<std::pair<std::size_t, const VcfRecord*>>> result {};
+    for (const auto& p : records) {
+        const auto same_site = [&] (const auto& group) {
+            const auto& site = *group.front().second;
+            return site.ref() == p.second->ref() && site.alt() == p.second->alt();
+        };
+        auto group_itr = std::find_if(std::begin(result), std::end(result), same_site);
+        if (group_itr == std::end(result)) {
+            result.emplace_back();
+            group_itr = std::prev(std::end(result));
+        }
+        group_itr->push_back(p);
+    }
+    return result;
+}
+
+} // namespace
+
+void run_cohort_genotyping(const options::OptionMap& options)
+{
+    const auto source_paths = options::get_cohort_likelihood_paths(options);
+    if (source_paths.empty()) throw MissingCohortLikelihoods {};
+    const auto reference = options::make_reference(options);
+    const auto reference_contigs = reference.contig_names();
+    std::unordered_map<std::string, std::size_t> contig_indices {};
+    for (std::size_t i {0}; i < reference_contigs.size(); ++i) contig_indices.emplace(reference_contigs[i], i);
+    std::vector<LikelihoodSource> sources {};
+    sources.reserve(source_paths.size());
+    std::vector<CohortSample> samples {};
+    std::vector<GenomicRegion::ContigName> contigs {};
+    for (const auto& path : source_paths) {
+        sources.emplace_back(path, contig_indices);
+        for (const auto& sample : sources.back().samples()) {
+            const auto is_sample = [&] (const CohortSample& other) { return other.name == sample; };
+            auto sample_itr = std::find_if(std::begin(samples), std::end(samples), is_sample);
+            if (sample_itr == std::end(samples)) {
+                samples.push_back({sample, {}});
+                sample_itr = std::prev(std::end(samples));
+            }
+            sample_itr->sources.push_back(sources.size() - 1);
+        }
+        for (auto& contig : get_contigs(VcfReader {path}.fetch_header())) {
+            if (contig_indices.count(contig) == 1 && std::find(std::cbegin(contigs), std::cend(contigs), contig) == std::cend(contigs)) {
+                contigs.push_back(std::move(contig));
+            }
+        }
+    }
+    std::sort(std::begin(contigs), std::end(contigs), [&] (const auto& lhs, const auto& rhs) { return contig_indices.at(lhs) < contig_indices.at(rhs); });
+    const auto output_path = options::get_output_path(options);
+    const auto header = make_cohort_header(samples, reference, contigs);
+    VcfWriter output {output_path ? VcfWriter {*output_path, header} : VcfWriter {header}};
+    boost::optional<VcfWriter> unevaluated_output {};
+    if (const auto unevaluated_path = options::get_unevaluated_sites_output_path(options)) {
+        unevaluated_output = VcfWriter {*unevaluated_path, make_sites_header(reference, contigs)};
+    }
+    logging::InfoLogger info_log {};
+    stream(info_log) << "Merging the genotype likelihoods of " << samples.size() << " samples from " << sources.size() << " files";
+    GenotypingCounts counts {0, 0};
+    std::vector<VcfRecord> position_records {};
+    std::vector<std::pair<std::size_t, const VcfRecord*>> position_sources {};
+    while (true) {
+        boost::optional<SiteKey> next_key {};
+        for (const auto& source : sources) {
+            if (!source.done() && (!next_key || source.key() < *next_key)) next_key = source.key();
+        }
+        if (!next_key) break;
+        position_records.clear();
+        std::vector<std::size_t> record_sources {};
+        for (std::size_t i {0}; i < sources.size(); ++i) {
+            for (auto& source = sources[i]; !source.done() && source.key() == *next_key; source.next()) {
+                position_records.push_back(source.record());
+                record_sources.push_back(i);
+            }
+        }
+        position_sources.clear();
+        for (std::size_t i {0}; i < position_records.size(); ++i) {
+            position_sources.emplace_back(record_sources[i], &position_records[i]);
+        }
+        for (const auto& site_records : group_sites(position_sources)) {
+            genotype_site(site_records, samples, reference, output, unevaluated_output, counts);
+        }
+    }
+    stream(info_log) << "Wrote " << counts.num_sites << " cohort sites, of which " << counts.num_unevaluated_sites
+                     << " are missing genotype likelihoods for some samples";
+}
+
+} // namespace octopus
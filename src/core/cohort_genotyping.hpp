@@ -0,0 +1,29 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef cohort_genotyping_hpp
+#define cohort_genotyping_hpp
+
+#include "config/option_parser.hpp"
+
+namespace octopus {
+
+/*
+    Merges the sample genotype likelihoods (GL) of the --cohort-likelihoods files into one cohort VCF,
+    without looking at any reads. These files are usually the output of --regenotype with
+    --regenotype-likelihoods, so a cohort can grow by genotyping just the new samples and merging
+    their likelihoods with the existing cohort's.
+
+    Records with the same position, REF, and ALTs are the same site. A sample may be in several files
+    (e.g. the cohort file and a file regenotyping the cohort at new sites), in which case the first
+    file with likelihoods for the site is used. The allele frequencies of each site are re-estimated
+    by EM under a Hardy-Weinberg model from the likelihoods of all samples, and each sample's genotype
+    (GT, GQ) is then called from its likelihoods and these frequencies. Samples without likelihoods for
+    a site get missing genotypes. Those sites are written to --unevaluated-sites-output if given, so
+    the missing samples can be regenotyped at just these sites.
+ */
+void run_cohort_genotyping(const options::OptionMap& options);
+
+} // namespace octopus
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "facet.hpp"
 
+#include <utility>
+
 namespace octopus { namespace csr {
 
 bool operator==(const Facet& lhs, const Facet& rhs) noexcept
@@ -15,5 +17,21 @@ bool operator==(const FacetWrapper& lhs, const FacetWrapper& rhs) noexcept
     return *lhs.base() == *rhs.base();
 }
 
+DeferredFacet::DeferredFacet(std::string name, FacetMaker maker)
+: name_ {std::move(name)}
+, maker_ {std::move(maker)}
+, made_ {}
+, facet_ {}
+{}
+
+Facet::ResultType DeferredFacet::do_get() const
+{
+    std::call_once(made_, [this] () {
+        facet_ = maker_();
+        maker_ = nullptr; // release any block data captured by the maker
+    });
+    return facet_.get();
+}
+
 } // namespace csr
 } // namespace octopus
@@ -9,6 +9,7 @@
 #include <memory>
 #include <unordered_map>
 #include <map>
+#include <mutex>
 
 #include <boost/variant.hpp>
 
@@ -54,9 +55,19 @@ public:
         std::vector<DuplicateReadSet> duplicates;
     };
     using ReadsSummaryMap = std::unordered_map<SampleName, ReadsSummary>;
+    
+    struct ReadStatistics
+    {
+        unsigned max_coverage = 0;
+        std::size_t num_reads = 0, num_forward = 0, num_mapq_zero = 0, num_significantly_clipped = 0;
+        double sum_squared_mapping_quality = 0;
+        AlignedRead::NucleotideSequence::size_type max_read_length = 0;
+    };
+    using ReadStatisticsMap = std::unordered_map<GenomicRegion, std::unordered_map<SampleName, ReadStatistics>>;
 
     using ResultType = boost::variant<std::reference_wrapper<const ReadMap>,
                                       std::reference_wrapper<const ReadsSummaryMap>,
+                                      std::reference_wrapper<const ReadStatisticsMap>,
                                       std::reference_wrapper<const SupportMaps>,
                                       std::reference_wrapper<const std::string>,
                                       std::reference_wrapper<const std::vector<std::string>>,
@@ -111,6 +122,34 @@ private:
 
 bool operator==(const FacetWrapper& lhs, const FacetWrapper& rhs) noexcept;
 
+// Makes the wrapped facet the first time it is requested, so expensive facets are
+// not computed for blocks where no evaluated measure asks for them
+class DeferredFacet : public Facet
+{
+public:
+    using FacetMaker = std::function<FacetWrapper()>;
+    
+    DeferredFacet() = delete;
+    
+    DeferredFacet(std::string name, FacetMaker maker);
+    
+    DeferredFacet(const DeferredFacet&)            = delete;
+    DeferredFacet& operator=(const DeferredFacet&) = delete;
+    DeferredFacet(DeferredFacet&&)                 = delete;
+    DeferredFacet& operator=(DeferredFacet&&)      = delete;
+    
+    virtual ~DeferredFacet() override = default;
+    
+private:
+    std::string name_;
+    mutable FacetMaker maker_;
+    mutable std::once_flag made_;
+    mutable FacetWrapper facet_;
+    
+    const std::string& do_name() const noexcept override { return name_; }
+    ResultType do_get() const override;
+};
+
 namespace detail {
 
 template <typename T>
@@ -23,6 +23,7 @@
 #include "ploidies.hpp"
 #include "pedigree.hpp"
 #include "reads_summary.hpp"
+#include "read_statistics.hpp"
 
 namespace octopus { namespace csr {
 
@@ -124,8 +125,8 @@ FacetFactory::FacetBlock FacetFactory::make(const std::vector<std::string>& name
 {
     if (names.empty()) return {};
     check_requirements(names);
-    const auto block_data = make_block_data(names, block);
-    return make(names, block_data);
+    auto block_data = std::make_shared<const BlockData>(make_block_data(names, block));
+    return make(names, std::move(block_data));
 }
 
 namespace {
@@ -149,7 +150,7 @@ bool requires_reference(const std::vector<std::string>& facets) noexcept
 
 bool requires_reads(const std::string& facet) noexcept
 {
-    const static std::array<std::string, 3> read_facets{name<OverlappingReads>(), name<ReadsSummary>(), name<ReadAssignments>()};
+    const static std::array<std::string, 4> read_facets{name<OverlappingReads>(), name<ReadsSummary>(), name<ReadStatistics>(), name<ReadAssignments>()};
     return std::find(std::cbegin(read_facets), std::cend(read_facets), facet) != std::cend(read_facets);
 }
 
@@ -191,6 +192,13 @@ bool requires_pedigree(const std::vector<std::string>& facets) noexcept
     return std::any_of(std::cbegin(facets), std::cend(facets), [](const auto& facet) { return requires_pedigree(facet); });
 }
 
+bool is_deferred(const std::string& facet) noexcept
+{
+    // These do real work per block (read realignment, duplicate detection), so are only made if used
+    const static std::array<std::string, 2> deferred_facets{name<ReadAssignments>(), name<ReadsSummary>()};
+    return std::find(std::cbegin(deferred_facets), std::cend(deferred_facets), facet) != std::cend(deferred_facets);
+}
+
 } // namespace
 
 class BadFacetFactoryRequest : public ProgramError
@@ -219,14 +227,14 @@ FacetFactory::make(const std::vector<std::string>& names,
     std::vector<FacetBlock> result {};
     result.reserve(blocks.size());
     if (blocks.size() > 1 && !workers.empty()) {
-        boost::optional<ReadMap> reads {};
+        BufferedReadPipe::SharedReadMap reads {};
         if (requires_reads(names)) {
             std::vector<GenomicRegion> block_regions {};
             block_regions.reserve(blocks.size());
             for (const auto& block : blocks) {
                 block_regions.push_back(encompassing_region(block));
             }
-            reads = read_pipe_->source().fetch_reads(block_regions);
+            reads = read_pipe_->fetch_shared_reads(block_regions);
         }
         const auto fetch_genotypes = requires_genotypes(names);
         result.resize(blocks.size());
@@ -242,12 +250,11 @@ FacetFactory::make(const std::vector<std::string>& names,
                       if (reads) {
                           data.reads = copy_overlapped(*reads, *data.region);
                       }
-                      return this->make(names, data, workers);
+                      return this->make(names, std::make_shared<const BlockData>(std::move(data)), workers);
                   }, workers);
     } else {
         for (const auto& block : blocks) {
-            const auto data = make_block_data(names, block);
-            result.push_back(make(names, data));
+            result.push_back(make(names, std::make_shared<const BlockData>(make_block_data(names, block))));
         }
     }
     return result;
@@ -267,6 +274,11 @@ void FacetFactory::setup_facet_makers()
         assert(block.reads);
         return {std::make_unique<ReadsSummary>(*block.reads)};
     };
+    facet_makers_[name<ReadStatistics>()] = [] (const BlockData& block, OptionalThreadPool workers) -> FacetWrapper
+    {
+        assert(block.reads);
+        return {std::make_unique<ReadStatistics>(*block.reads, *block.calls)};
+    };
     facet_makers_[name<ReadAssignments>()] = [this] (const BlockData& block, OptionalThreadPool workers) -> FacetWrapper
     {
         assert(block.reads && block.genotypes);
@@ -351,14 +363,19 @@ FacetWrapper FacetFactory::make(const std::string& name, const BlockData& block,
 }
 
 FacetFactory::FacetBlock
-FacetFactory::make(const std::vector<std::string>& names, const BlockData& block,
+FacetFactory::make(const std::vector<std::string>& names, std::shared_ptr<const BlockData> block,
                    OptionalThreadPool workers) const
 {
     FacetBlock result(names.size());
     using octopus::transform;
     transform(std::cbegin(names), std::cend(names), std::begin(result), 
-              [this, &block] (const auto& name) { return this-> make(name, block); }, 
-              workers);
+              [this, &block] (const auto& name) -> FacetWrapper {
+                  if (is_deferred(name)) {
+                      return {std::make_unique<DeferredFacet>(name, [this, name, block] () { return this->make(name, *block); })};
+                  } else {
+                      return this->make(name, *block);
+                  }
+              }, workers);
     return result;
 }
 
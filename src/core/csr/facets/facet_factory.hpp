@@ -8,6 +8,7 @@
 #include <vector>
 #include <functional>
 #include <unordered_map>
+#include <memory>
 
 #include <boost/optional.hpp>
 
@@ -82,7 +83,7 @@ private:
     void check_requirements(const std::string& name) const;
     void check_requirements(const std::vector<std::string>& names) const;
     FacetWrapper make(const std::string& name, const BlockData& block, OptionalThreadPool workers = boost::none) const;
-    FacetBlock make(const std::vector<std::string>& names, const BlockData& block, OptionalThreadPool workers = boost::none) const;
+    FacetBlock make(const std::vector<std::string>& names, std::shared_ptr<const BlockData> block, OptionalThreadPool workers = boost::none) const;
     BlockData make_block_data(const std::vector<std::string>& names, const CallBlock& block) const;
 };
 
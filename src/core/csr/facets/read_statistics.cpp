@@ -0,0 +1,87 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "read_statistics.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "utils/mappable_algorithms.hpp"
+
+namespace octopus { namespace csr {
+
+const std::string ReadStatistics::name_ {"ReadStatistics"};
+
+namespace {
+
+auto clip_fraction(const AlignedRead& read) noexcept
+{
+    assert(sequence_size(read) > 0);
+    return static_cast<double>(total_clip_size(read)) / sequence_size(read);
+}
+
+// Same as max_coverage(reads, region), which is zero for empty regions
+unsigned max_coverage(const std::vector<int>& coverage_changes) noexcept
+{
+    int result {0}, coverage {0};
+    for (const auto change : coverage_changes) {
+        coverage += change;
+        result = std::max(result, coverage);
+    }
+    return static_cast<unsigned>(result);
+}
+
+Facet::ReadStatistics compute_statistics(const ReadContainer& reads, const GenomicRegion& region,
+                                         std::vector<int>& coverage_changes)
+{
+    Facet::ReadStatistics result {};
+    const auto num_positions = region_size(region);
+    coverage_changes.assign(num_positions + 1, 0);
+    for (const auto& read : overlap_range(reads, region)) {
+        ++result.num_reads;
+        if (is_forward_strand(read)) ++result.num_forward;
+        if (read.mapping_quality() == 0) ++result.num_mapq_zero;
+        const auto mapping_quality = static_cast<double>(read.mapping_quality());
+        result.sum_squared_mapping_quality += mapping_quality * mapping_quality;
+        if (is_significantly_clipped(read)) ++result.num_significantly_clipped;
+        result.max_read_length = std::max(result.max_read_length, sequence_size(read));
+        const auto first = mapped_begin(read) <= mapped_begin(region) ? 0 : mapped_begin(read) - mapped_begin(region);
+        const auto last = std::min(mapped_end(read) - mapped_begin(region), num_positions);
+        if (first < last) {
+            ++coverage_changes[first];
+            --coverage_changes[last];
+        }
+    }
+    result.max_coverage = max_coverage(coverage_changes);
+    return result;
+}
+
+} // namespace
+
+ReadStatistics::ReadStatistics(const ReadMap& reads, const std::vector<VcfRecord>& calls)
+{
+    statistics_.reserve(calls.size());
+    std::vector<int> coverage_changes {};
+    for (const auto& call : calls) {
+        const auto& region = mapped_region(call);
+        if (statistics_.count(region) == 1) continue;
+        auto& call_statistics = statistics_[region];
+        call_statistics.reserve(reads.size());
+        for (const auto& p : reads) {
+            call_statistics.emplace(p.first, compute_statistics(p.second, region, coverage_changes));
+        }
+    }
+}
+
+Facet::ResultType ReadStatistics::do_get() const
+{
+    return std::cref(statistics_);
+}
+
+bool is_significantly_clipped(const AlignedRead& read) noexcept
+{
+    return is_soft_clipped(read) && clip_fraction(read) > 0.25;
+}
+
+} // namespace csr
+} // namespace octopus
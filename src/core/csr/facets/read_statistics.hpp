@@ -0,0 +1,53 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef read_statistics_hpp
+#define read_statistics_hpp
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "facet.hpp"
+#include "config/common.hpp"
+#include "io/variant/vcf_record.hpp"
+
+namespace octopus { namespace csr {
+
+// Read aggregates for each call and sample, computed in one pass over the reads overlapping each
+// call so that measures using them do not each visit the reads again
+class ReadStatistics : public Facet
+{
+public:
+    using ResultType = std::reference_wrapper<const ReadStatisticsMap>;
+    
+    ReadStatistics() = default;
+    
+    ReadStatistics(const ReadMap& reads, const std::vector<VcfRecord>& calls);
+
+private:
+    static const std::string name_;
+    
+    ReadStatisticsMap statistics_;
+    
+    const std::string& do_name() const noexcept override { return name_; }
+    Facet::ResultType do_get() const override;
+};
+
+inline const auto& get(const Facet::ReadStatisticsMap& statistics, const VcfRecord& call, const SampleName& sample)
+{
+    return statistics.at(mapped_region(call)).at(sample);
+}
+
+inline const auto& get(const Facet::ReadStatisticsMap& statistics, const VcfRecord& call)
+{
+    return statistics.at(mapped_region(call));
+}
+
+// Reads with more than a quarter of their bases soft clipped
+bool is_significantly_clipped(const AlignedRead& read) noexcept;
+
+} // namespace csr
+} // namespace octopus
+
+#endif
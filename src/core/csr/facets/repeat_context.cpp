@@ -12,7 +12,7 @@ namespace octopus { namespace csr {
 const std::string RepeatContext::name_ {"RepeatContext"};
 
 RepeatContext::RepeatContext(const ReferenceGenome& reference, GenomicRegion region)
-: result_ {find_exact_tandem_repeats(reference.fetch_sequence(region), region, 1, 20)}
+: result_ {find_exact_tandem_repeats(reference, region, 20)}
 {}
 
 Facet::ResultType RepeatContext::do_get() const
@@ -0,0 +1,246 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "compact_forest.hpp"
+
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <cmath>
+#include <cassert>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+#include "ranger/Forest.h"
+#include "ranger/utility.h"
+#include "ranger/globals.h"
+
+namespace octopus { namespace csr {
+
+constexpr CompactForest::NodeIndex CompactForest::leaf_;
+
+namespace {
+
+bool is_gzipped(const CompactForest::Path& file) noexcept
+{
+    return file.extension() == ".gz";
+}
+
+// Mirrors ForestProbability::loadFromFileInternal
+template <typename Stream>
+void check_tree_type(Stream& forest)
+{
+    ranger::TreeType tree_type;
+    forest.read((char*) &tree_type, sizeof(tree_type));
+    if (!forest || tree_type != ranger::TREE_PROBABILITY) {
+        throw std::runtime_error {"not a probability forest"};
+    }
+}
+
+auto get_class_order(const std::vector<double>& class_values)
+{
+    std::vector<std::size_t> result(class_values.size());
+    for (std::size_t class_idx {0}; class_idx < class_values.size(); ++class_idx) {
+        const auto class_value = class_values[class_idx];
+        if (class_value < 0 || class_value >= class_values.size() || std::floor(class_value) != class_value) {
+            throw std::runtime_error {"unexpected class value"};
+        }
+        result[class_idx] = static_cast<std::size_t>(class_value);
+    }
+    return result;
+}
+
+} // namespace
+
+CompactForest::CompactForest(const Path& ranger_forest)
+: feature_names_ {}
+, ordered_features_ {}
+, num_classes_ {0}
+, tree_roots_ {}
+, split_features_ {}
+, left_children_ {}
+, right_children_ {}
+, split_values_ {}
+, leaf_probabilities_ {}
+{
+    std::ifstream file {ranger_forest.string(), std::ios::binary};
+    if (!file) throw std::runtime_error {"could not open forest"};
+    boost::iostreams::filtering_istream forest {};
+    if (is_gzipped(ranger_forest)) {
+        forest.push(boost::iostreams::gzip_decompressor());
+    }
+    forest.push(file);
+    ranger::Forest::MetaInfo meta {};
+    ranger::read_meta(forest, meta);
+    feature_names_ = std::move(meta.independent_variable_names);
+    ordered_features_.assign(std::cbegin(meta.ordered_variable_indicators), std::cend(meta.ordered_variable_indicators));
+    // Variables without an indicator are treated as ordered, which is Ranger's default
+    ordered_features_.resize(std::max(ordered_features_.size(), feature_names_.size()), true);
+    check_tree_type(forest);
+    std::vector<double> class_values {};
+    ranger::readVector1D(class_values, forest);
+    num_classes_ = class_values.size();
+    if (num_classes_ == 0) throw std::runtime_error {"no classes"};
+    const auto class_order = get_class_order(class_values);
+    tree_roots_.reserve(meta.num_trees);
+    std::vector<std::vector<std::size_t>> child_node_ids {};
+    std::vector<std::size_t> split_var_ids {}, terminal_nodes {};
+    std::vector<double> split_values {};
+    std::vector<std::vector<double>> terminal_class_counts {};
+    for (std::size_t tree_idx {0}; tree_idx < meta.num_trees; ++tree_idx) {
+        ranger::readVector2D(child_node_ids, forest);
+        ranger::readVector1D(split_var_ids, forest);
+        ranger::readVector1D(split_values, forest);
+        ranger::readVector1D(terminal_nodes, forest);
+        ranger::readVector2D(terminal_class_counts, forest);
+        if (!forest || child_node_ids.size() != 2 || child_node_ids[0].size() != child_node_ids[1].size()
+            || split_var_ids.size() != child_node_ids[0].size() || split_values.size() != split_var_ids.size()
+            || terminal_nodes.size() != terminal_class_counts.size()) {
+            throw std::runtime_error {"malformed tree"};
+        }
+        const auto root = static_cast<NodeIndex>(split_features_.size());
+        const auto num_nodes = split_var_ids.size();
+        if (num_nodes == 0) throw std::runtime_error {"empty tree"};
+        tree_roots_.push_back(root);
+        for (std::size_t node {0}; node < num_nodes; ++node) {
+            const auto left = child_node_ids[0][node], right = child_node_ids[1][node];
+            if (left == 0 && right == 0) {
+                split_features_.push_back(leaf_);
+                left_children_.push_back(leaf_);
+                right_children_.push_back(leaf_);
+                split_values_.push_back(0);
+            } else {
+                if (left >= num_nodes || right >= num_nodes || split_var_ids[node] >= feature_names_.size()) {
+                    throw std::runtime_error {"malformed tree"};
+                }
+                split_features_.push_back(static_cast<NodeIndex>(split_var_ids[node]));
+                left_children_.push_back(root + static_cast<NodeIndex>(left));
+                right_children_.push_back(root + static_cast<NodeIndex>(right));
+                split_values_.push_back(split_values[node]);
+            }
+        }
+        for (std::size_t terminal_idx {0}; terminal_idx < terminal_nodes.size(); ++terminal_idx) {
+            const auto node = root + terminal_nodes[terminal_idx];
+            const auto& counts = terminal_class_counts[terminal_idx];
+            if (terminal_nodes[terminal_idx] >= num_nodes || split_features_[node] != leaf_ || counts.size() != num_classes_) {
+                throw std::runtime_error {"malformed tree"};
+            }
+            left_children_[node] = static_cast<NodeIndex>(leaf_probabilities_.size() / num_classes_);
+            const auto first_probability = leaf_probabilities_.size();
+            leaf_probabilities_.resize(first_probability + num_classes_);
+            for (std::size_t class_idx {0}; class_idx < num_classes_; ++class_idx) {
+                leaf_probabilities_[first_probability + class_order[class_idx]] = counts[class_idx];
+            }
+        }
+        if (std::find(std::next(std::cbegin(left_children_), root), std::cend(left_children_), leaf_) != std::cend(left_children_)) {
+            throw std::runtime_error {"missing terminal node counts"};
+        }
+    }
+}
+
+const std::vector<std::string>& CompactForest::feature_names() const noexcept
+{
+    return feature_names_;
+}
+
+std::size_t CompactForest::num_features() const noexcept
+{
+    return feature_names_.size();
+}
+
+std::size_t CompactForest::num_classes() const noexcept
+{
+    return num_classes_;
+}
+
+std::size_t CompactForest::num_trees() const noexcept
+{
+    return tree_roots_.size();
+}
+
+namespace {
+
+// Small enough that a batch of rows and one tree's nodes fit in cache together
+constexpr std::size_t batch_size {256};
+
+} // namespace
+
+void CompactForest::predict(const double* rows, const std::size_t num_rows, double* result) const
+{
+    const auto num_features = this->num_features();
+    std::fill_n(result, num_rows * num_classes_, 0.0);
+    for (std::size_t batch_begin {0}; batch_begin < num_rows; batch_begin += batch_size) {
+        const auto batch_end = std::min(batch_begin + batch_size, num_rows);
+        for (const auto root : tree_roots_) {
+            for (auto row_idx = batch_begin; row_idx < batch_end; ++row_idx) {
+                const auto probabilities = find_leaf(root, rows + row_idx * num_features);
+                std::transform(probabilities, probabilities + num_classes_, result + row_idx * num_classes_,
+                               result + row_idx * num_classes_, std::plus<> {});
+            }
+        }
+    }
+    if (!tree_roots_.empty()) {
+        const auto num_trees = static_cast<double>(tree_roots_.size());
+        std::transform(result, result + num_rows * num_classes_, result, [=] (double p) { return p / num_trees; });
+    }
+}
+
+std::vector<double> CompactForest::predict(const std::vector<double>& rows) const
+{
+    const auto num_features = this->num_features();
+    assert(num_features > 0 && rows.size() % num_features == 0);
+    const auto num_rows = rows.size() / num_features;
+    std::vector<double> result(num_rows * num_classes_);
+    predict(rows.data(), num_rows, result.data());
+    return result;
+}
+
+std::vector<double> CompactForest::predict(const std::vector<double>& rows, ThreadPool& workers) const
+{
+    const auto num_features = this->num_features();
+    assert(num_features > 0 && rows.size() % num_features == 0);
+    const auto num_rows = rows.size() / num_features;
+    if (workers.size() < 2 || num_rows <= batch_size) return predict(rows);
+    std::vector<double> result(num_rows * num_classes_);
+    const auto num_batches = (num_rows + batch_size - 1) / batch_size;
+    const auto batches_per_task = (num_batches + workers.size() - 1) / workers.size();
+    const auto rows_per_task = batches_per_task * batch_size;
+    std::vector<std::future<void>> tasks {};
+    tasks.reserve(workers.size());
+    for (std::size_t row_begin {0}; row_begin < num_rows; row_begin += rows_per_task) {
+        const auto task_rows = std::min(rows_per_task, num_rows - row_begin);
+        tasks.push_back(workers.push([this, &rows, &result, row_begin, task_rows, num_features] () {
+            predict(rows.data() + row_begin * num_features, task_rows, result.data() + row_begin * num_classes_);
+        }));
+    }
+    for (auto& task : tasks) task.get();
+    return result;
+}
+
+// private methods
+
+const double* CompactForest::find_leaf(NodeIndex node, const double* row) const noexcept
+{
+    // Same branching rules as ranger::Tree::predict
+    while (split_features_[node] != leaf_) {
+        const auto feature = split_features_[node];
+        const auto value = row[feature];
+        bool left;
+        if (ordered_features_[feature]) {
+            left = value <= split_values_[node];
+        } else {
+            const auto factor_id = static_cast<std::size_t>(std::floor(value) - 1);
+            const auto split_id = static_cast<std::size_t>(std::floor(split_values_[node]));
+            left = !(split_id & (1ULL << factor_id));
+        }
+        node = left ? left_children_[node] : right_children_[node];
+    }
+    return leaf_probabilities_.data() + left_children_[node] * num_classes_;
+}
+
+} // namespace csr
+} // namespace octopus
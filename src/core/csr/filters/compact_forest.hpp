@@ -0,0 +1,70 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef compact_forest_hpp
+#define compact_forest_hpp
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include <boost/filesystem/path.hpp>
+
+#include "utils/thread_pool.hpp"
+
+namespace octopus { namespace csr {
+
+// An inference-only copy of a Ranger probability forest. The trees are flattened into a single
+// structure-of-arrays node table when the forest file is loaded, and rows are predicted in
+// batches, one tree at a time, so a tree's nodes stay in cache while it is applied to each row.
+class CompactForest
+{
+public:
+    using Path = boost::filesystem::path;
+
+    CompactForest() = default;
+
+    // Throws std::runtime_error if the file is not a Ranger probability forest
+    CompactForest(const Path& ranger_forest);
+
+    CompactForest(const CompactForest&)            = default;
+    CompactForest& operator=(const CompactForest&) = default;
+    CompactForest(CompactForest&&)                 = default;
+    CompactForest& operator=(CompactForest&&)      = default;
+
+    ~CompactForest() = default;
+
+    const std::vector<std::string>& feature_names() const noexcept;
+    std::size_t num_features() const noexcept;
+    std::size_t num_classes() const noexcept;
+    std::size_t num_trees() const noexcept;
+
+    // rows holds num_rows * num_features() values, one row after another. The result holds
+    // num_classes() probabilities for each row, ordered by class value.
+    void predict(const double* rows, std::size_t num_rows, double* result) const;
+    std::vector<double> predict(const std::vector<double>& rows) const;
+    std::vector<double> predict(const std::vector<double>& rows, ThreadPool& workers) const;
+
+private:
+    using NodeIndex = std::uint32_t;
+
+    static constexpr NodeIndex leaf_ {std::numeric_limits<NodeIndex>::max()};
+
+    std::vector<std::string> feature_names_;
+    std::vector<char> ordered_features_;
+    std::size_t num_classes_;
+    std::vector<NodeIndex> tree_roots_;
+    // For leaves split_features_ is leaf_ and left_children_ is the leaf's index into leaf_probabilities_
+    std::vector<NodeIndex> split_features_, left_children_, right_children_;
+    std::vector<double> split_values_;
+    std::vector<double> leaf_probabilities_;
+
+    const double* find_leaf(NodeIndex root, const double* row) const noexcept;
+};
+
+} // namespace csr
+} // namespace octopus
+
+#endif
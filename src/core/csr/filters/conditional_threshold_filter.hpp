@@ -52,6 +52,13 @@ private:
     virtual bool passes_all_hard_filters(const MeasureVector& measures) const override;
     virtual bool passes_all_soft_filters(const MeasureVector& measures) const override;
     virtual std::vector<std::string> get_failing_vcf_filter_keys(const MeasureVector& measures) const override;
+    // The hard conditions in use depend on the chooser measures, which come last
+    virtual std::size_t num_early_filter_measures() const noexcept override { return 0; }
+    // Which conditions apply depends on each sample's chooser measures, so calls are classified one at a time
+    virtual std::vector<ClassificationList> classify_block(const MeasureBlock& measures, const SampleList& samples) const override
+    {
+        return SinglePassVariantCallFilter::classify_block(measures, samples);
+    }
     
     std::size_t choose_filter(const MeasureVector& measures) const;
     bool passes_all_hard_filters(const MeasureVector& measures, MeasureIndexRange range) const;
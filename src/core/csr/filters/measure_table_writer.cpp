@@ -0,0 +1,145 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "measure_table_writer.hpp"
+
+#include <limits>
+#include <iterator>
+#include <algorithm>
+#include <cassert>
+
+#include <boost/variant.hpp>
+
+#include "utils/string_utils.hpp"
+#include "exceptions/unwritable_file_error.hpp"
+
+namespace octopus { namespace csr {
+
+namespace {
+
+static const std::string magic {"OCTMEAS1"};
+
+class UnwritableMeasureTable : public UnwritableFileError
+{
+    std::string do_where() const override { return "MeasureTableWriter"; }
+public:
+    UnwritableMeasureTable(boost::filesystem::path file) : UnwritableFileError {std::move(file), "measure table"} {}
+};
+
+template <typename T>
+void append(const T value, std::vector<char>& buffer)
+{
+    const auto bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(std::cend(buffer), bytes, bytes + sizeof(T));
+}
+
+void append(const std::string& value, std::vector<char>& buffer)
+{
+    append(static_cast<std::uint32_t>(value.size()), buffer);
+    buffer.insert(std::cend(buffer), std::cbegin(value), std::cend(value));
+}
+
+struct FloatVisitor : boost::static_visitor<float>
+{
+    static constexpr float missing_value = std::numeric_limits<float>::quiet_NaN();
+    float operator()(const Measure::ValueType& value) const
+    {
+        return boost::apply_visitor([] (const auto& v) { return static_cast<float>(v); }, value);
+    }
+    float operator()(const Measure::Optional<Measure::ValueType>& value) const
+    {
+        return value ? (*this)(*value) : missing_value;
+    }
+    template <typename T> float operator()(const T&) const
+    {
+        return missing_value;
+    }
+};
+
+std::string join_alts(const VcfRecord& call)
+{
+    std::vector<std::string> alts {};
+    alts.reserve(call.alt().size());
+    for (const auto& alt : call.alt()) alts.push_back(alt);
+    return utils::join(alts, ',');
+}
+
+} // namespace
+
+MeasureTableWriter::MeasureTableWriter(Path file, const std::vector<MeasureWrapper>& measures, const std::vector<SampleName>& samples,
+                                       const std::size_t chunk_size)
+: path_ {std::move(file)}
+, file_ {path_.string(), std::ios::binary | std::ios::trunc}
+, num_measures_ {measures.size()}
+, num_samples_ {samples.size()}
+, chunk_size_ {std::max(chunk_size, std::size_t {1})}
+, keys_ {}
+, values_ {}
+, num_rows_ {0}
+{
+    if (!file_) throw UnwritableMeasureTable {path_};
+    std::vector<char> header {std::cbegin(magic), std::cend(magic)};
+    append(static_cast<std::uint32_t>(samples.size()), header);
+    for (const auto& sample : samples) append(sample, header);
+    append(static_cast<std::uint32_t>(measures.size()), header);
+    for (const auto& measure : measures) append(measure.name(), header);
+    file_.write(header.data(), header.size());
+    values_.resize(num_measures_ * num_samples_ * chunk_size_);
+}
+
+MeasureTableWriter::~MeasureTableWriter()
+{
+    try {
+        close();
+    } catch (...) {}
+}
+
+const MeasureTableWriter::Path& MeasureTableWriter::path() const noexcept
+{
+    return path_;
+}
+
+void MeasureTableWriter::write(const VcfRecord& call, const std::vector<MeasureVector>& sample_measures)
+{
+    assert(sample_measures.size() == num_samples_);
+    append(call.chrom(), keys_);
+    append(static_cast<std::uint64_t>(call.pos() - 1), keys_);
+    append(call.ref(), keys_);
+    append(join_alts(call), keys_);
+    const FloatVisitor to_float {};
+    for (std::size_t sample_idx {0}; sample_idx < num_samples_; ++sample_idx) {
+        assert(sample_measures[sample_idx].size() == num_measures_);
+        for (std::size_t measure_idx {0}; measure_idx < num_measures_; ++measure_idx) {
+            const auto column = measure_idx * num_samples_ + sample_idx;
+            values_[column * chunk_size_ + num_rows_] = boost::apply_visitor(to_float, sample_measures[sample_idx][measure_idx]);
+        }
+    }
+    if (++num_rows_ == chunk_size_) flush();
+}
+
+void MeasureTableWriter::close()
+{
+    if (file_.is_open()) {
+        flush();
+        file_.close();
+    }
+}
+
+// private methods
+
+void MeasureTableWriter::flush()
+{
+    if (num_rows_ == 0) return;
+    const auto num_rows = static_cast<std::uint32_t>(num_rows_);
+    file_.write(reinterpret_cast<const char*>(&num_rows), sizeof(num_rows));
+    file_.write(keys_.data(), keys_.size());
+    for (std::size_t column {0}; column < num_measures_ * num_samples_; ++column) {
+        file_.write(reinterpret_cast<const char*>(values_.data() + column * chunk_size_), num_rows_ * sizeof(float));
+    }
+    if (!file_) throw UnwritableMeasureTable {path_};
+    keys_.clear();
+    num_rows_ = 0;
+}
+
+} // namespace csr
+} // namespace octopus
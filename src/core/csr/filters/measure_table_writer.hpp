@@ -0,0 +1,72 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef measure_table_writer_hpp
+#define measure_table_writer_hpp
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/filesystem/path.hpp>
+
+#include "config/common.hpp"
+#include "io/variant/vcf_record.hpp"
+#include "../measures/measure.hpp"
+
+namespace octopus { namespace csr {
+
+/*
+    Writes per-sample call measures to a chunked, columnar binary table for training filter models.
+    All integers and floats are little-endian; strings are a uint32 length followed by the bytes.
+
+    header: "OCTMEAS1", uint32 num_samples, sample names, uint32 num_measures, measure names
+    chunk:  uint32 num_rows,
+            num_rows keys (contig string, uint64 0-based position, ref string, alt string with
+                           alleles separated by ','),
+            then for each measure, for each sample, num_rows float32 values
+
+    Missing or non-scalar values are written as NaN. Chunks follow each other until the end of file.
+ */
+class MeasureTableWriter
+{
+public:
+    using Path = boost::filesystem::path;
+    using MeasureVector = std::vector<Measure::ResultType>;
+
+    MeasureTableWriter() = delete;
+
+    MeasureTableWriter(Path file, const std::vector<MeasureWrapper>& measures, const std::vector<SampleName>& samples,
+                       std::size_t chunk_size = 4096);
+
+    MeasureTableWriter(const MeasureTableWriter&)            = delete;
+    MeasureTableWriter& operator=(const MeasureTableWriter&) = delete;
+    MeasureTableWriter(MeasureTableWriter&&)                 = delete;
+    MeasureTableWriter& operator=(MeasureTableWriter&&)      = delete;
+
+    ~MeasureTableWriter();
+
+    const Path& path() const noexcept;
+
+    // sample_measures holds the measures of each sample, in the order the samples were given
+    void write(const VcfRecord& call, const std::vector<MeasureVector>& sample_measures);
+
+    void close();
+
+private:
+    Path path_;
+    std::ofstream file_;
+    std::size_t num_measures_, num_samples_, chunk_size_;
+    std::vector<char> keys_;
+    std::vector<float> values_; // (measure, sample, row) for the current chunk
+    std::size_t num_rows_;
+
+    void flush();
+};
+
+} // namespace csr
+} // namespace octopus
+
+#endif
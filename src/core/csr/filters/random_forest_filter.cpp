@@ -7,23 +7,23 @@
 #include <iterator>
 #include <algorithm>
 #include <numeric>
-#include <iostream>
 #include <cassert>
 #include <cmath>
-#include <limits>
-#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <map>
+#include <mutex>
+#include <ctime>
 
 #include <boost/variant.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem/operations.hpp>
 
-#include "ranger/ForestProbability.h"
+#include "ranger/Forest.h"
 
 #include "utils/concat.hpp"
 #include "utils/append.hpp"
 #include "utils/maths.hpp"
-#include "utils/string_utils.hpp"
-#include "utils/reorder.hpp"
 #include "exceptions/missing_file_error.hpp"
 #include "exceptions/program_error.hpp"
 #include "exceptions/malformed_file_error.hpp"
@@ -103,6 +103,17 @@ progress
 }
 {}
 
+class MalformedForestFile : public MalformedFileError
+{
+    std::string do_where() const override { return "RandomForestFilter"; }
+    std::string do_help() const override
+    {
+        return "make sure the forest was trained with the same measures and in the same order as the prediction measures";
+    }
+public:
+    MalformedForestFile(boost::filesystem::path file) : MalformedFileError {std::move(file)} {}
+};
+
 namespace {
 
 auto concat(const std::vector<std::vector<MeasureWrapper>>& measures)
@@ -114,6 +125,40 @@ auto concat(const std::vector<std::vector<MeasureWrapper>>& measures)
     return result;
 }
 
+CompactForest read_forest(const RandomForestFilter::Path& ranger_forest, const std::size_t num_measures)
+{
+    CompactForest result {};
+    try {
+        result = CompactForest {ranger_forest};
+    } catch (const std::runtime_error& e) {
+        throw MalformedForestFile {ranger_forest};
+    }
+    if (result.num_features() == 0 || result.num_features() != num_measures) {
+        throw MalformedForestFile {ranger_forest};
+    }
+    return result;
+}
+
+// Loaded forests are kept while any filter uses them, so concurrent runs in one process (e.g. calling
+// service jobs) read each forest file once. Entries are keyed by path and modification time.
+std::shared_ptr<const CompactForest> load_forest(const RandomForestFilter::Path& ranger_forest, const std::size_t num_measures)
+{
+    static std::map<std::pair<std::string, std::time_t>, std::weak_ptr<const CompactForest>> cache {};
+    static std::mutex mutex {};
+    boost::system::error_code ec {};
+    const auto key = std::make_pair(boost::filesystem::absolute(ranger_forest).string(),
+                                    boost::filesystem::last_write_time(ranger_forest, ec));
+    std::lock_guard<std::mutex> lock {mutex};
+    auto result = cache[key].lock();
+    if (!result) {
+        result = std::make_shared<const CompactForest>(read_forest(ranger_forest, num_measures));
+        cache[key] = result;
+    } else if (result->num_features() != num_measures) {
+        throw MalformedForestFile {ranger_forest};
+    }
+    return result;
+}
+
 } // namespace
 
 RandomForestFilter::RandomForestFilter(FacetFactory facet_factory,
@@ -130,6 +175,7 @@ RandomForestFilter::RandomForestFilter(FacetFactory facet_factory,
                                concat(concat(forest_measures), chooser_measures),
                                std::move(output_config), threading, std::move(temp_directory), progress}
 , forest_paths_ {std::move(ranger_forests)}
+, forests_ {}
 , chooser_ {std::move(chooser)}
 , forest_measure_info_ {}
 , first_chooser_measure_index_ {0}
@@ -137,13 +183,19 @@ RandomForestFilter::RandomForestFilter(FacetFactory facet_factory,
 , options_ {std::move(options)}
 , threading_ {threading}
 , num_records_ {0}
-, data_buffer_ {}
+, num_samples_ {0}
+, row_buffer_ {}
+, predictions_ {}
 {
-    forest_measure_info_.reserve(ranger_forests.size());
+    forest_measure_info_.reserve(forest_paths_.size());
     for (const auto& measures : forest_measures) {
         forest_measure_info_.push_back({first_chooser_measure_index_, measures.size()});
         first_chooser_measure_index_ += measures.size();
     }
+    forests_.reserve(forest_paths_.size());
+    for (std::size_t forest_idx {0}; forest_idx < forest_paths_.size(); ++forest_idx) {
+        forests_.push_back(load_forest(forest_paths_[forest_idx], forest_measure_info_[forest_idx].number));
+    }
 }
 
 std::string RandomForestFilter::do_name() const
@@ -155,11 +207,6 @@ const std::string RandomForestFilter::allele_quality_name_ = "RFAQ";
 const std::string RandomForestFilter::genotype_quality_name_ = "RFGQ";
 const std::string RandomForestFilter::call_quality_name_ = "RFAQ_ALL";
 
-std::unique_ptr<ranger::Forest> RandomForestFilter::make_forest() const
-{
-    return std::make_unique<ranger::ForestProbability>();
-}
-
 boost::optional<std::string> RandomForestFilter::allele_quality_name() const
 {
     return allele_quality_name_;
@@ -201,37 +248,20 @@ std::int8_t RandomForestFilter::choose_forest(const MeasureVector& measures) con
     return chooser_(chooser_measures);
 }
 
-template <typename T>
-static void write_line(const std::vector<T>& data, std::ostream& out)
-{
-    std::copy(std::cbegin(data), std::prev(std::cend(data)), std::ostream_iterator<T> {out, " "});
-    out << data.back() << '\n';
-}
-
 void RandomForestFilter::prepare_for_registration(const SampleList& samples) const
 {
     const auto num_forests = forest_paths_.size();
     data_.resize(num_forests);
     for (std::size_t forest_idx {0}; forest_idx < num_forests; ++forest_idx) {
-        const auto& info = forest_measure_info_[forest_idx];
-        std::vector<std::string> data_header {};
-        const auto first_measure = std::next(std::cbegin(measures_), info.start_index);
-        data_header.reserve(info.number + 1);
-        std::transform(first_measure, std::next(first_measure, info.number),
-                       std::back_inserter(data_header), [] (const auto& measure) { return measure.name(); });
-        data_header.push_back("TP");
         data_[forest_idx].reserve(samples.size());
         for (const auto& sample : samples) {
             auto data_path = temp_directory();
-            Path fname {"octopus_ranger_temp_forest_data_" + std::to_string(forest_idx) + "_" + sample + ".dat"};
+            Path fname {"octopus_forest_temp_data_" + std::to_string(forest_idx) + "_" + sample + ".dat"};
             data_path /= fname;
-            data_[forest_idx].emplace_back(data_path.string(), data_path);
-            write_line(data_header, data_[forest_idx].back().handle);
+            data_[forest_idx].emplace_back(data_path);
         }
     }
-    data_buffer_.resize(num_forests);
-    for (auto& buffer : data_buffer_) buffer.resize(samples.size());
-    choices_.resize(samples.size());
+    num_samples_ = samples.size();
 }
 
 namespace {
@@ -294,35 +324,31 @@ void check_nan(const std::vector<double>& values)
     }
 }
 
-void skip_lines(std::istream& in, int n = 1)
-{
-    for (; n > 0; --n) in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-}
-
 } // namespace
 
 void RandomForestFilter::record(const std::size_t call_idx, std::size_t sample_idx, MeasureVector measures) const
 {
     assert(!measures.empty());
     const auto forest_idx = choose_forest(measures);
-    const auto num_forests = static_cast<std::remove_const_t<decltype(forest_idx)>>(data_buffer_.size());
+    const auto num_forests = static_cast<std::remove_const_t<decltype(forest_idx)>>(data_.size());
     if (forest_idx >= 0 && forest_idx < num_forests) {
-        auto& buffer = data_buffer_[forest_idx][sample_idx];
+        auto& buffer = row_buffer_;
         const auto& info = forest_measure_info_[forest_idx];
         const auto first_measure = std::next(std::cbegin(measures), info.start_index);
         buffer.reserve(info.number);
         std::transform(first_measure, std::next(first_measure, info.number),
                        std::next(std::cbegin(this->measures_), info.start_index),
                        std::back_inserter(buffer), cast_to_double);
-        buffer.push_back(0); // dummy TP value
         check_nan(buffer);
-        write_line(buffer, data_[forest_idx][sample_idx].handle);
+        // The record index leads the row, so rows can be matched to records without keeping the forest
+        // choices. Rows are written as raw doubles, so are read back exactly and with no parsing.
+        buffer.insert(std::cbegin(buffer), static_cast<double>(call_idx));
+        data_[forest_idx][sample_idx].handle.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(double));
         buffer.clear();
     } else {
         hard_filtered_record_indices_.push_back(call_idx);
     }
     if (call_idx >= num_records_) ++num_records_;
-    choices_[sample_idx].push_back(forest_idx);
 }
 
 void RandomForestFilter::close_data_files() const
@@ -336,85 +362,62 @@ void RandomForestFilter::close_data_files() const
 
 namespace {
 
-std::vector<std::string> read_header(std::ifstream& prediction_file)
-{
-    skip_lines(prediction_file);
-    std::string line;
-    std::getline(prediction_file, line);
-    skip_lines(prediction_file);
-    return utils::split(line, ' ');
-}
-    
-} // namespace
+// Number of rows read from a data file and predicted at once
+constexpr std::size_t prediction_batch_size {1u << 16};
 
-class MalformedForestFile : public MalformedFileError
-{
-    std::string do_where() const override { return "RandomForestFilter"; }
-    std::string do_help() const override
-    {
-        return "make sure the forest was trained with the same measures and in the same order as the prediction measures";
-    }
-public:
-    MalformedForestFile(boost::filesystem::path file) : MalformedFileError {std::move(file)} {}
-};
+} // namespace
 
 void RandomForestFilter::prepare_for_classification(boost::optional<Log>& log) const
 {
     if (log) *log << "Preparing random forests for classification";
     close_data_files();
+    row_buffer_.clear();
+    row_buffer_.shrink_to_fit();
     if (num_records_ == 0) return;
-    const Path ranger_prefix {temp_directory() / "octopus_ranger_temp"};
-    const Path ranger_prediction_fname {ranger_prefix.string() + ".prediction"};
-    const auto num_samples = choices_.size();
-    auto& predictions = data_buffer_;
-    data_buffer_.resize(num_records_, std::vector<std::vector<double>>(num_samples));
-    for (std::size_t forest_idx {0}; forest_idx < forest_paths_.size(); ++forest_idx) {
-        for (std::size_t sample_idx {0}; sample_idx < num_samples; ++sample_idx) {
-            auto forest_choice_itr = std::find(std::cbegin(choices_[sample_idx]), std::cend(choices_[sample_idx]), forest_idx);
-            if (forest_choice_itr != std::cend(choices_[sample_idx])) {
-                const auto& file = data_[forest_idx][sample_idx];
-                std::vector<std::string> tmp {}, cat_vars {};
-                const auto ranger_threads = threading_.max_threads ? *threading_.max_threads : 1u;
-                const auto forest = make_forest();
-                try {
-                    forest->initCpp("", ranger::MemoryMode::MEM_DOUBLE, file.path.string(), 0, ranger_prefix.string(),
-                                    1000, nullptr, 12, ranger_threads, forest_paths_[forest_idx].string(), ranger::ImportanceMode::IMP_GINI, 1, "",
-                                    tmp, "", true, cat_vars, false, ranger::SplitRule::LOGRANK, "", false, 1.0,
-                                    ranger::DEFAULT_ALPHA, ranger::DEFAULT_MINPROP, false,
-                                    ranger::PredictionType::RESPONSE, ranger::DEFAULT_NUM_RANDOM_SPLITS, ranger::DEFAULT_MAXDEPTH);
-                } catch (const std::runtime_error& e) {
-                    throw MalformedForestFile {forest_paths_[forest_idx]};
-                } catch (const std::out_of_range& e) {
-                    throw MalformedForestFile {forest_paths_[forest_idx]};
-                }
-                forest->run(false, false);
-                forest->writePredictionFile();
-                std::ifstream prediction_file {ranger_prediction_fname.string()};
-                const auto header = read_header(prediction_file);
-                std::vector<std::size_t> order(header.size());
-                for (std::size_t idx {0}; idx < header.size(); ++idx) {
-                    order[std::stoi(header[idx])] = idx;
+    const auto predictions_path = temp_directory() / "octopus_forest_temp_predictions.dat";
+    {
+        std::ofstream predictions {predictions_path.string(), std::ios::binary | std::ios::trunc};
+    }
+    boost::filesystem::resize_file(predictions_path, num_records_ * num_samples_ * sizeof(PredictionCell));
+    std::fstream predictions {predictions_path.string(), std::ios::binary | std::ios::in | std::ios::out};
+    std::vector<double> rows {}, features {};
+    for (std::size_t forest_idx {0}; forest_idx < forests_.size(); ++forest_idx) {
+        const auto& forest = *forests_[forest_idx];
+        const auto row_size = forest.num_features() + 1; // the record index then the features
+        for (std::size_t sample_idx {0}; sample_idx < num_samples_; ++sample_idx) {
+            const auto& file = data_[forest_idx][sample_idx];
+            std::ifstream data {file.path.string(), std::ios::binary};
+            for (;;) {
+                rows.resize(prediction_batch_size * row_size);
+                data.read(reinterpret_cast<char*>(rows.data()), rows.size() * sizeof(double));
+                const auto num_rows = static_cast<std::size_t>(data.gcount()) / (row_size * sizeof(double));
+                if (num_rows == 0) break;
+                features.clear();
+                for (std::size_t row_idx {0}; row_idx < num_rows; ++row_idx) {
+                    const auto first_feature = std::next(std::cbegin(rows), row_idx * row_size + 1);
+                    features.insert(std::cend(features), first_feature, std::next(first_feature, row_size - 1));
                 }
-                std::string line;
-                while (std::getline(prediction_file, line)) {
-                    if (!line.empty()) {
-                        const auto record_idx = std::distance(std::cbegin(choices_[sample_idx]), forest_choice_itr);
-                        std::istringstream ss {line};
-                        predictions[record_idx][sample_idx].assign(std::istream_iterator<double>{ss}, std::istream_iterator<double>{});
-                        reorder(std::cbegin(order), std::cend(order), std::begin(predictions[record_idx][sample_idx]));
-                        assert(forest_choice_itr != std::cend(choices_[sample_idx]));
-                        forest_choice_itr = std::find(std::next(forest_choice_itr), std::cend(choices_[sample_idx]), forest_idx);
-                    }
+                const auto probabilities = forest.predict(features, workers());
+                for (std::size_t row_idx {0}; row_idx < num_rows; ++row_idx) {
+                    const auto record_idx = static_cast<std::size_t>(rows[row_idx * row_size]);
+                    const auto first_probability = std::next(std::cbegin(probabilities), row_idx * forest.num_classes());
+                    PredictionCell cell {};
+                    cell[0] = static_cast<float>(first_probability[0]);
+                    cell[1] = forest.num_classes() == 3 ? static_cast<float>(first_probability[0] + first_probability[2]) : std::nanf("");
+                    predictions.seekp(static_cast<std::streamoff>((sample_idx * num_records_ + record_idx) * sizeof(PredictionCell)));
+                    predictions.write(reinterpret_cast<const char*>(cell.data()), sizeof(PredictionCell));
                 }
-                boost::filesystem::remove(file.path);
             }
+            data.close();
+            boost::filesystem::remove(file.path);
         }
     }
-    boost::filesystem::remove(ranger_prediction_fname);
+    predictions.close();
+    predictions_ = MappedFile {predictions_path};
+    rows.clear();
+    rows.shrink_to_fit();
     data_.clear();
     data_.shrink_to_fit();
-    choices_.clear();
-    choices_.shrink_to_fit();
     if (!hard_filtered_record_indices_.empty()) {
         hard_filtered_.resize(num_records_, false);
         for (auto idx : hard_filtered_record_indices_) {
@@ -425,22 +428,18 @@ void RandomForestFilter::prepare_for_classification(boost::optional<Log>& log) c
     }
 }
 
-std::size_t RandomForestFilter::get_forest_choice(std::size_t call_idx, std::size_t sample_idx) const
-{
-    return choices_.empty() ? 0 : choices_[sample_idx][call_idx];
-}
-
 VariantCallFilter::Classification RandomForestFilter::classify(const std::size_t call_idx, std::size_t sample_idx) const
 {
     Classification result {};
     if (hard_filtered_.empty() || !hard_filtered_[call_idx]) {
-        const auto& predictions = data_buffer_;
-        assert(call_idx < predictions.size() && sample_idx < predictions[call_idx].size());
-        const auto& probabilities = predictions[call_idx][sample_idx];
-        if (probabilities.size() == 3) {
-            const auto probability_allele_false = probabilities[0];
+        assert(call_idx < num_records_ && sample_idx < num_samples_ && predictions_.is_open());
+        PredictionCell probabilities;
+        std::copy_n(predictions_.data() + (sample_idx * num_records_ + call_idx) * sizeof(PredictionCell),
+                    sizeof(PredictionCell), reinterpret_cast<char*>(probabilities.data()));
+        if (!std::isnan(probabilities[1])) {
+            const double probability_allele_false {probabilities[0]};
             result.quality = probability_false_to_phred(std::max(probability_allele_false, 1e-10));
-            const auto probability_genotype_false = probabilities[0] + probabilities[2];
+            const double probability_genotype_false {probabilities[1]};
             result.genotype_quality = probability_false_to_phred(std::max(probability_genotype_false, 1e-10));
             if (*result.genotype_quality >= min_soft_genotype_quality()) {
                 result.category = Classification::Category::unfiltered;
@@ -449,8 +448,7 @@ VariantCallFilter::Classification RandomForestFilter::classify(const std::size_t
                 result.reasons.assign({"RF"});
             }
         } else {
-            assert(probabilities.size() == 2);
-            const auto probability_allele_false = probabilities[0];
+            const double probability_allele_false {probabilities[0]};
             result.quality = probability_false_to_phred(std::max(probability_allele_false, 1e-10));
             if (*result.quality >= min_soft_genotype_quality()) {
                 result.category = Classification::Category::unfiltered;
@@ -5,6 +5,8 @@
 #define random_forest_filter_hpp
 
 #include <vector>
+#include <array>
+#include <deque>
 #include <cstddef>
 #include <memory>
 #include <fstream>
@@ -14,10 +16,10 @@
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
 
-#include "ranger/Forest.h"
-
 #include "basics/phred.hpp"
 #include "double_pass_variant_call_filter.hpp"
+#include "compact_forest.hpp"
+#include "utils/system_utils.hpp"
 
 namespace octopus { namespace csr {
 
@@ -69,16 +71,17 @@ private:
     {
         std::ofstream handle;
         Path path;
-        template <typename F, typename P>
-        File(F&& handle, P&& path) : handle {std::forward<F>(handle)}, path {std::forward<P>(path)} {};
+        File(Path p) : handle {p.string(), std::ios::binary}, path {std::move(p)} {};
     };
     struct ForestMeasureInfo
     {
         std::size_t start_index, number;
     };
+    // The genotype probability is nan for forests that only classify alleles
+    using PredictionCell = std::array<float, 2>;
     
     std::vector<Path> forest_paths_;
-    std::vector<std::unique_ptr<ranger::Forest>> forests_;
+    std::vector<std::shared_ptr<const CompactForest>> forests_; // shared with other filters using the same files
     std::function<std::int8_t(std::vector<Measure::ResultType>)> chooser_;
     std::vector<ForestMeasureInfo> forest_measure_info_;
     std::size_t first_chooser_measure_index_, num_chooser_measures_;
@@ -86,9 +89,11 @@ private:
     ConcurrencyPolicy threading_;
     
     mutable std::vector<std::vector<File>> data_;
-    mutable std::size_t num_records_;
-    mutable std::vector<std::vector<std::vector<double>>> data_buffer_;
-    mutable std::vector<std::deque<std::int8_t>> choices_;
+    mutable std::size_t num_records_, num_samples_;
+    mutable std::vector<double> row_buffer_;
+    // Each sample's predictions, in record order, stored as a column of (probability allele false,
+    // probability genotype false) pairs, so the classification pass reads them from disk
+    mutable MappedFile predictions_;
     mutable std::deque<std::size_t> hard_filtered_record_indices_;
     mutable std::vector<bool> hard_filtered_;
     
@@ -112,7 +117,6 @@ private:
     virtual bool is_soft_filtered(const ClassificationList& sample_classifications, boost::optional<Phred<double>> joint_quality,
                                   const MeasureVector& measures, std::vector<std::string>& reasons) const override;
     
-    std::unique_ptr<ranger::Forest> make_forest() const;
     boost::optional<std::string> allele_quality_name() const override;
     boost::optional<std::string> genotype_quality_name() const override;
     std::int8_t choose_forest(const MeasureVector& measures) const;
@@ -120,7 +124,6 @@ private:
     void record(std::size_t call_idx, std::size_t sample_idx, MeasureVector measures) const override;
     void close_data_files() const;
     void prepare_for_classification(boost::optional<Log>& log) const override;
-    std::size_t get_forest_choice(std::size_t call_idx, std::size_t sample_idx) const;
     Classification classify(std::size_t call_idx, std::size_t sample_idx) const override;
 };
 
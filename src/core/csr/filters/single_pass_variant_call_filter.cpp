@@ -31,9 +31,10 @@ void SinglePassVariantCallFilter::filter(const VcfReader& source, VcfWriter& des
     if (progress_) progress_->start();
     const auto samples = source.fetch_header().samples();
     if (can_measure_multiple_blocks()) {
-        for (auto p = source.iterate(); p.first != p.second;) {
-            filter(read_next_blocks(p.first, p.second, samples), dest, dest_header, samples);
-        }
+        auto p = source.iterate();
+        measure_blocks(p.first, p.second, samples, [&] (const std::vector<CallBlock>& blocks, const std::vector<MeasureBlock>& measures) {
+            filter(blocks, measures, dest, dest_header, samples);
+        });
     } else if (can_measure_single_call()) {
         auto p = source.iterate();
         std::for_each(std::move(p.first), std::move(p.second), [&] (const VcfRecord& call) { filter(call, dest, dest_header, samples); });
@@ -55,9 +56,9 @@ void SinglePassVariantCallFilter::filter(const CallBlock& block, VcfWriter& dest
     filter(block, measure(block), dest, dest_header, samples);
 }
 
-void SinglePassVariantCallFilter::filter(const std::vector<CallBlock>& blocks, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const
+void SinglePassVariantCallFilter::filter(const std::vector<CallBlock>& blocks, const std::vector<MeasureBlock>& measures,
+                                         VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const
 {
-    const auto measures = measure(blocks);
     assert(measures.size() == blocks.size());
     for (auto tup : boost::combine(blocks, measures)) {
         filter(tup.get<0>(), tup.get<1>(), dest, dest_header, samples);
@@ -68,8 +69,9 @@ void SinglePassVariantCallFilter::filter(const CallBlock& block, const MeasureBl
                                          const VcfHeader& dest_header, const SampleList& samples) const
 {
     assert(measures.size() == block.size());
-    for (auto tup : boost::combine(block, measures)) {
-        filter(tup.get<0>(), tup.get<1>(), dest, dest_header, samples);
+    const auto classifications = classify_block(measures, samples);
+    for (std::size_t call_idx {0}; call_idx < block.size(); ++call_idx) {
+        filter(block[call_idx], measures[call_idx], classifications[call_idx], dest, dest_header, samples);
     }
     log_progress(closed_region(block.front(), block.back()));
 }
@@ -77,9 +79,16 @@ void SinglePassVariantCallFilter::filter(const CallBlock& block, const MeasureBl
 void SinglePassVariantCallFilter::filter(const VcfRecord& call, const MeasureVector& measures, VcfWriter& dest,
                                          const VcfHeader& dest_header, const SampleList& samples) const
 {
-    const auto sample_classifications = classify(measures, samples);
+    filter(call, measures, classify(measures, samples), dest, dest_header, samples);
+}
+
+void SinglePassVariantCallFilter::filter(const VcfRecord& call, const MeasureVector& measures,
+                                         const ClassificationList& sample_classifications,
+                                         VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const
+{
+    write_measure_table(call, measures, samples);
     const auto call_classification = merge(sample_classifications, measures);
-    if (measure_annotations_requested()) {
+    if (measure_annotations_requested() && call_classification.category != Classification::Category::hard_filtered) {
         VcfRecord::Builder annotation_builder {call};
         annotate(annotation_builder, measures, dest_header);
         write(std::move(annotation_builder), call_classification, samples, sample_classifications, dest);
@@ -101,6 +110,17 @@ SinglePassVariantCallFilter::classify(const MeasureVector& call_measures, const
     return result;
 }
 
+std::vector<VariantCallFilter::ClassificationList>
+SinglePassVariantCallFilter::classify_block(const MeasureBlock& measures, const SampleList& samples) const
+{
+    std::vector<ClassificationList> result {};
+    result.reserve(measures.size());
+    for (const auto& call_measures : measures) {
+        result.push_back(classify(call_measures, samples));
+    }
+    return result;
+}
+
 static auto expand_lhs_to_zero(const GenomicRegion& region)
 {
     return GenomicRegion {region.contig_name(), 0, region.end()};
@@ -35,18 +35,24 @@ public:
 protected:
     std::vector<std::string> measure_names_;
     
+    // Classifies each sample of each call in a block, indexed [call][sample]. By default calls are
+    // classified one at a time; filters that can classify a whole block at once override this.
+    virtual std::vector<ClassificationList> classify_block(const MeasureBlock& measures, const SampleList& samples) const;
+    
 private:
     boost::optional<ProgressMeter&> progress_;
     mutable boost::optional<GenomicRegion::ContigName> current_contig_;
     
     virtual Classification classify(const MeasureVector& call_measures) const = 0;
-    
     void filter(const VcfReader& source, VcfWriter& dest, const VcfHeader& dest_header) const override;
     void filter(const VcfRecord& call, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
     void filter(const CallBlock& block, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
-    void filter(const std::vector<CallBlock>& blocks, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
+    void filter(const std::vector<CallBlock>& blocks, const std::vector<MeasureBlock>& measures,
+                VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
     void filter(const CallBlock& block, const MeasureBlock & measures, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
     void filter(const VcfRecord& call, const MeasureVector& measures, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
+    void filter(const VcfRecord& call, const MeasureVector& measures, const ClassificationList& sample_classifications,
+                VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
     ClassificationList classify(const MeasureVector& call_measures, const SampleList& samples) const;
     void log_progress(const GenomicRegion& region) const;
 };
@@ -111,12 +111,130 @@ VariantCallFilter::Classification ThresholdVariantCallFilter::classify(const Mea
     }
 }
 
+namespace {
+
+// The present values of one measure over the cells (call, sample) of a block. A cell may have any
+// number of values (e.g. one per allele); missing values are left out, so they always pass.
+struct MeasureColumn
+{
+    std::vector<double> values;
+    std::vector<std::size_t> cell_ends;
+};
+
+struct ColumnAppender : public boost::static_visitor<>
+{
+    std::vector<double>& values;
+    explicit ColumnAppender(std::vector<double>& values) : values {values} {}
+    struct ToDouble : public boost::static_visitor<double>
+    {
+        template <typename T> double operator()(T value) const noexcept { return static_cast<double>(value); }
+    };
+    void operator()(const Measure::ValueType& value) const
+    {
+        values.push_back(boost::apply_visitor(ToDouble {}, value));
+    }
+    template <typename T> void operator()(const Measure::Optional<T>& value) const
+    {
+        if (value) (*this)(*value);
+    }
+    template <typename T> void operator()(const Measure::Array<T>& array) const
+    {
+        for (const auto& value : array) (*this)(value);
+    }
+};
+
+template <typename Cmp>
+void evaluate(const std::vector<double>& values, const double target, Cmp cmp, std::vector<char>& result)
+{
+    std::transform(std::cbegin(values), std::cend(values), std::begin(result),
+                   [=] (double value) -> char { return !cmp(value, target); });
+}
+
+void evaluate(const ThresholdVariantCallFilter::CompiledThreshold& threshold, const std::vector<double>& values,
+              std::vector<char>& result)
+{
+    using Comparator = ThresholdVariantCallFilter::CompiledThreshold::Comparator;
+    result.resize(values.size());
+    switch (threshold.comparator) {
+        case Comparator::equal: evaluate(values, threshold.target, std::equal_to<> {}, result); break;
+        case Comparator::not_equal: evaluate(values, threshold.target, std::not_equal_to<> {}, result); break;
+        case Comparator::less: evaluate(values, threshold.target, std::less<> {}, result); break;
+        case Comparator::less_equal: evaluate(values, threshold.target, std::less_equal<> {}, result); break;
+        case Comparator::greater: evaluate(values, threshold.target, std::greater<> {}, result); break;
+        case Comparator::greater_equal: evaluate(values, threshold.target, std::greater_equal<> {}, result); break;
+    }
+}
+
+} // namespace
+
+std::vector<VariantCallFilter::ClassificationList>
+ThresholdVariantCallFilter::classify_block(const MeasureBlock& measures, const SampleList& samples) const
+{
+    // Each condition is applied to the whole block at once, rather than each call and sample in turn
+    const auto num_samples = samples.size();
+    const auto num_cells = measures.size() * num_samples;
+    std::vector<char> passes_hard(num_cells, true);
+    for (std::size_t i {0}; i < hard_thresholds_.size(); ++i) {
+        apply_threshold(hard_thresholds_[i], i, measures, num_samples, passes_hard);
+    }
+    std::vector<std::vector<char>> passes_soft(soft_thresholds_.size(), std::vector<char>(num_cells, true));
+    for (std::size_t i {0}; i < soft_thresholds_.size(); ++i) {
+        apply_threshold(soft_thresholds_[i], hard_thresholds_.size() + i, measures, num_samples, passes_soft[i]);
+    }
+    std::vector<ClassificationList> result(measures.size(), ClassificationList(num_samples));
+    for (std::size_t call_idx {0}; call_idx < measures.size(); ++call_idx) {
+        for (std::size_t sample_idx {0}; sample_idx < num_samples; ++sample_idx) {
+            const auto cell = call_idx * num_samples + sample_idx;
+            auto& classification = result[call_idx][sample_idx];
+            if (!passes_hard[cell]) {
+                classification.category = Classification::Category::hard_filtered;
+                continue;
+            }
+            for (std::size_t i {0}; i < soft_thresholds_.size(); ++i) {
+                if (!passes_soft[i][cell]) classification.reasons.push_back(vcf_filter_keys_[i]);
+            }
+            if (classification.reasons.empty()) {
+                classification.category = Classification::Category::unfiltered;
+            } else {
+                classification.category = Classification::Category::soft_filtered;
+                if (!all_unique_filter_keys_) {
+                    auto& reasons = classification.reasons;
+                    std::sort(std::begin(reasons), std::end(reasons));
+                    reasons.erase(std::unique(std::begin(reasons), std::end(reasons)), std::end(reasons));
+                }
+            }
+        }
+    }
+    return result;
+}
+
 bool ThresholdVariantCallFilter::passes_all_hard_filters(const MeasureVector& measures) const
 {
     const auto last_hard = std::next(std::cbegin(measures), hard_thresholds_.size());
     return passes_all_filters(std::cbegin(measures), last_hard, std::cbegin(hard_thresholds_));
 }
 
+std::size_t ThresholdVariantCallFilter::num_early_filter_measures() const noexcept
+{
+    return hard_thresholds_.size();
+}
+
+bool ThresholdVariantCallFilter::is_early_hard_filtered(const VcfRecord& call, const MeasureVector& measures) const
+{
+    // A call is only removed if every sample fails a hard condition
+    if (call.num_samples() == 0) return false;
+    MeasureVector sample_measures(hard_thresholds_.size());
+    for (unsigned sample_idx {0}; sample_idx < call.num_samples(); ++sample_idx) {
+        for (std::size_t i {0}; i < hard_thresholds_.size(); ++i) {
+            sample_measures[i] = get_sample_value(measures[i], measures_[i], sample_idx);
+        }
+        if (passes_all_filters(std::cbegin(sample_measures), std::cend(sample_measures), std::cbegin(hard_thresholds_))) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool ThresholdVariantCallFilter::passes_all_soft_filters(const MeasureVector& measures) const
 {
     const auto first_soft = std::next(std::cbegin(measures), hard_thresholds_.size());
@@ -140,5 +258,43 @@ std::vector<std::string> ThresholdVariantCallFilter::get_failing_vcf_filter_keys
     return result;
 }
 
+void ThresholdVariantCallFilter::apply_threshold(const ThresholdWrapper& threshold, const std::size_t measure_idx,
+                                                 const MeasureBlock& measures, const std::size_t num_samples,
+                                                 std::vector<char>& passes) const
+{
+    const auto& measure = measures_[measure_idx];
+    const auto compiled = threshold.compile();
+    if (compiled) {
+        MeasureColumn column {};
+        column.cell_ends.reserve(passes.size());
+        const ColumnAppender append {column.values};
+        for (const auto& call_measures : measures) {
+            for (std::size_t sample_idx {0}; sample_idx < num_samples; ++sample_idx) {
+                boost::apply_visitor(append, get_sample_value(call_measures[measure_idx], measure, sample_idx));
+                column.cell_ends.push_back(column.values.size());
+            }
+        }
+        std::vector<char> value_passes {};
+        evaluate(*compiled, column.values, value_passes);
+        std::size_t cell_begin {0};
+        for (std::size_t cell {0}; cell < passes.size(); ++cell) {
+            const auto cell_end = column.cell_ends[cell];
+            if (passes[cell]) {
+                passes[cell] = std::all_of(std::next(std::cbegin(value_passes), cell_begin),
+                                           std::next(std::cbegin(value_passes), cell_end),
+                                           [] (char pass) { return pass; });
+            }
+            cell_begin = cell_end;
+        }
+    } else {
+        std::size_t cell {0};
+        for (const auto& call_measures : measures) {
+            for (std::size_t sample_idx {0}; sample_idx < num_samples; ++sample_idx, ++cell) {
+                if (passes[cell]) passes[cell] = threshold(get_sample_value(call_measures[measure_idx], measure, sample_idx));
+            }
+        }
+    }
+}
+
 } // namespace csr
 } // namespace octopus
@@ -7,6 +7,8 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <memory>
+#include <type_traits>
 
 #include <boost/optional.hpp>
 #include <boost/variant.hpp>
@@ -25,11 +27,21 @@ namespace csr {
 class ThresholdVariantCallFilter : public SinglePassVariantCallFilter
 {
 public:
+    // A threshold lowered to a single comparison against a double, which can be applied to a whole
+    // column of measure values at once. Like the threshold it came from, a value passes if it does not
+    // compare true against the target (e.g. a value fails a 'less' threshold if it is less than the target).
+    struct CompiledThreshold
+    {
+        enum class Comparator { equal, not_equal, less, less_equal, greater, greater_equal } comparator;
+        double target;
+    };
+    
     struct Threshold
     {
         virtual ~Threshold() = default;
         virtual std::unique_ptr<Threshold> clone() const = 0;
         virtual bool operator()(const Measure::ResultType& value) const noexcept = 0;
+        virtual boost::optional<CompiledThreshold> compile() const { return boost::none; }
     };
     
     struct ThresholdWrapper
@@ -42,6 +54,7 @@ public:
             return *this;
         }
         bool operator()(Measure::ResultType value) const noexcept { return (*threshold)(value); }
+        boost::optional<CompiledThreshold> compile() const { return threshold->compile(); }
         std::unique_ptr<Threshold> threshold;
     };
     
@@ -89,10 +102,16 @@ private:
     std::string do_name() const override;
     virtual void annotate(VcfHeader::Builder& header) const override;
     virtual Classification classify(const MeasureVector& measures) const override;
+    virtual std::vector<ClassificationList> classify_block(const MeasureBlock& measures, const SampleList& samples) const override;
     
     virtual bool passes_all_hard_filters(const MeasureVector& measures) const;
     virtual bool passes_all_soft_filters(const MeasureVector& measures) const;
     virtual std::vector<std::string> get_failing_vcf_filter_keys(const MeasureVector& measures) const;
+    virtual std::size_t num_early_filter_measures() const noexcept override;
+    virtual bool is_early_hard_filtered(const VcfRecord& call, const MeasureVector& measures) const override;
+    
+    void apply_threshold(const ThresholdWrapper& threshold, std::size_t measure_idx, const MeasureBlock& measures,
+                         std::size_t num_samples, std::vector<char>& passes) const;
 };
 
 template <typename M, typename... Args>
@@ -112,6 +131,16 @@ struct UnaryThreshold
     {
         return boost::apply_visitor(visitor_, value);
     }
+    boost::optional<ThresholdVariantCallFilter::CompiledThreshold>
+    compile(ThresholdVariantCallFilter::CompiledThreshold::Comparator comparator) const
+    {
+        // Integer targets are compared with the measure's own type (and signedness), so are not lowered to doubles
+        if (std::is_floating_point<T>::value || std::is_same<T, bool>::value) {
+            return ThresholdVariantCallFilter::CompiledThreshold {comparator, static_cast<double>(visitor_.target)};
+        } else {
+            return boost::none;
+        }
+    }
 private:
     struct UnaryVisitor : public boost::static_visitor<bool>
     {
@@ -155,6 +184,10 @@ struct EqualThreshold : public ThresholdVariantCallFilter::Threshold
     {
         return base_(value);
     }
+    boost::optional<ThresholdVariantCallFilter::CompiledThreshold> compile() const
+    {
+        return base_.compile(ThresholdVariantCallFilter::CompiledThreshold::Comparator::equal);
+    }
 private:
     detail::UnaryThreshold<std::equal_to<>, T> base_;
 };
@@ -171,6 +204,10 @@ struct NotEqualThreshold : public ThresholdVariantCallFilter::Threshold
     {
         return base_(value);
     }
+    boost::optional<ThresholdVariantCallFilter::CompiledThreshold> compile() const
+    {
+        return base_.compile(ThresholdVariantCallFilter::CompiledThreshold::Comparator::not_equal);
+    }
 private:
     detail::UnaryThreshold<std::not_equal_to<>, T> base_;
 };
@@ -187,6 +224,10 @@ struct LessThreshold : public ThresholdVariantCallFilter::Threshold
     {
         return base_(value);
     }
+    boost::optional<ThresholdVariantCallFilter::CompiledThreshold> compile() const
+    {
+        return base_.compile(ThresholdVariantCallFilter::CompiledThreshold::Comparator::less);
+    }
 private:
     detail::UnaryThreshold<std::less<>, T> base_;
 };
@@ -203,6 +244,10 @@ struct LessEqualThreshold : public ThresholdVariantCallFilter::Threshold
     {
         return base_(value);
     }
+    boost::optional<ThresholdVariantCallFilter::CompiledThreshold> compile() const
+    {
+        return base_.compile(ThresholdVariantCallFilter::CompiledThreshold::Comparator::less_equal);
+    }
 private:
     detail::UnaryThreshold<std::less_equal<>, T> base_;
 };
@@ -219,6 +264,10 @@ struct GreaterThreshold : public ThresholdVariantCallFilter::Threshold
     {
         return base_(value);
     }
+    boost::optional<ThresholdVariantCallFilter::CompiledThreshold> compile() const
+    {
+        return base_.compile(ThresholdVariantCallFilter::CompiledThreshold::Comparator::greater);
+    }
 private:
     detail::UnaryThreshold<std::greater<>, T> base_;
 };
@@ -235,6 +284,10 @@ struct GreaterEqualThreshold : public ThresholdVariantCallFilter::Threshold
     {
         return base_(value);
     }
+    boost::optional<ThresholdVariantCallFilter::CompiledThreshold> compile() const
+    {
+        return base_.compile(ThresholdVariantCallFilter::CompiledThreshold::Comparator::greater_equal);
+    }
 private:
     detail::UnaryThreshold<std::greater_equal<>, T> base_;
 };
@@ -12,6 +12,7 @@
 #include <limits>
 #include <cmath>
 #include <thread>
+#include <deque>
 
 #include <boost/range/combine.hpp>
 #include <boost/multiprecision/gmp.hpp>
@@ -70,6 +71,7 @@ VariantCallFilter::VariantCallFilter(FacetFactory facet_factory,
 , facet_names_ {}
 , output_config_ {output_config}
 , duplicate_measures_ {}
+, measure_table_ {}
 , workers_ {get_pool_size(threading)}
 {
     std::unordered_map<MeasureWrapper, int> measure_counts {};
@@ -121,6 +123,10 @@ void VariantCallFilter::filter(const VcfReader& source, VcfWriter& dest, boost::
         dest << header;
         filter(source, dest, header);
     }
+    if (measure_table_) {
+        measure_table_->close();
+        measure_table_.reset();
+    }
 }
 
 // protected methods
@@ -254,31 +260,37 @@ VariantCallFilter::read_next_blocks(VcfIterator& first, const VcfIterator& last,
     return result;
 }
 
-VariantCallFilter::MeasureVector VariantCallFilter::measure(const VcfRecord& call) const
+template <typename Evaluator>
+VariantCallFilter::MeasureVector VariantCallFilter::evaluate_measures(const VcfRecord& call, Evaluator evaluate) const
 {
     MeasureVector result(measures_.size());
-    if (duplicate_measures_.empty()) {
-        std::transform(std::cbegin(measures_), std::cend(measures_), std::begin(result),
-                       [&call] (const MeasureWrapper& m) { return m(call); });
-    } else {
-        std::unordered_map<MeasureWrapper, Measure::ResultType> result_buffer {};
-        result_buffer.reserve(duplicate_measures_.size());
-        for (const auto& m : duplicate_measures_) {
-            result_buffer.emplace(m, m(call));
+    std::unordered_map<MeasureWrapper, Measure::ResultType> result_buffer {};
+    const auto evaluate_once = [&] (const MeasureWrapper& m) -> Measure::ResultType {
+        if (duplicate_measures_.empty()) return evaluate(m);
+        auto itr = result_buffer.find(m);
+        if (itr == std::cend(result_buffer)) {
+            if (std::find(std::cbegin(duplicate_measures_), std::cend(duplicate_measures_), m) == std::cend(duplicate_measures_)) {
+                return evaluate(m);
+            }
+            itr = result_buffer.emplace(m, evaluate(m)).first;
         }
-        std::transform(std::cbegin(measures_), std::cend(measures_), std::begin(result),
-                       [&call, &result_buffer] (const MeasureWrapper& m) -> Measure::ResultType {
-                           auto itr = result_buffer.find(m);
-                           if (itr != std::cend(result_buffer)) {
-                               return itr->second;
-                           } else {
-                               return m(call);
-                           }
-                       });
-    }
+        return itr->second;
+    };
+    const auto num_early_measures = std::min(num_early_filter_measures(), measures_.size());
+    const auto last_early_measure = std::next(std::cbegin(measures_), num_early_measures);
+    const auto result_itr = std::transform(std::cbegin(measures_), last_early_measure, std::begin(result), evaluate_once);
+    if (num_early_measures > 0 && num_early_measures < measures_.size() && is_early_hard_filtered(call, result)) {
+        return result;
+    }
+    std::transform(last_early_measure, std::cend(measures_), result_itr, evaluate_once);
     return result;
 }
 
+VariantCallFilter::MeasureVector VariantCallFilter::measure(const VcfRecord& call) const
+{
+    return evaluate_measures(call, [&call] (const MeasureWrapper& m) { return m(call); });
+}
+
 VariantCallFilter::MeasureBlock VariantCallFilter::measure(const CallBlock& block) const
 {
     const auto facets = compute_facets(block);
@@ -307,6 +319,39 @@ std::vector<VariantCallFilter::MeasureBlock> VariantCallFilter::measure(const st
     return result;
 }
 
+void VariantCallFilter::measure_blocks(VcfIterator& first, const VcfIterator& last, const SampleList& samples,
+                                       const MeasuredBlocksConsumer& consume) const
+{
+    // Only one batch is measured at a time as facets fetch reads from a single (stateful) read pipe,
+    // but reading, classifying, and writing calls no longer hold up the workers.
+    struct Batch
+    {
+        std::vector<CallBlock> blocks;
+        std::future<std::vector<MeasureBlock>> measures;
+    };
+    std::deque<Batch> batches {}; // references to elements stay valid on push_back and pop_front
+    const auto start_measuring = [this] (Batch& batch) {
+        batch.measures = workers_.push([this, &batch] () { return this->measure(batch.blocks); });
+    };
+    if (first == last) return;
+    batches.push_back({read_next_blocks(first, last, samples), {}});
+    start_measuring(batches.back());
+    try {
+        while (!batches.empty()) {
+            if (first != last) batches.push_back({read_next_blocks(first, last, samples), {}});
+            const auto measures = batches.front().measures.get();
+            if (batches.size() > 1) start_measuring(batches[1]);
+            consume(batches.front().blocks, measures);
+            batches.pop_front();
+        }
+    } catch (...) {
+        for (auto& batch : batches) {
+            if (batch.measures.valid()) batch.measures.wait();
+        }
+        throw;
+    }
+}
+
 void VariantCallFilter::write(VcfRecord::Builder&& call, const Classification& classification, VcfWriter& dest) const
 {
     if (!is_hard_filtered(classification)) {
@@ -372,6 +417,20 @@ void VariantCallFilter::annotate(VcfRecord::Builder& call, const MeasureVector&
     }
 }
 
+void VariantCallFilter::write_measure_table(const VcfRecord& call, const MeasureVector& measures, const SampleList& samples) const
+{
+    if (!output_config_.measure_table) return;
+    if (!measure_table_) {
+        measure_table_ = std::make_unique<MeasureTableWriter>(*output_config_.measure_table, measures_, samples);
+    }
+    std::vector<MeasureVector> sample_measures {};
+    sample_measures.reserve(samples.size());
+    for (std::size_t sample_idx {0}; sample_idx < samples.size(); ++sample_idx) {
+        sample_measures.push_back(get_sample_values(measures, measures_, sample_idx, true));
+    }
+    measure_table_->write(call, sample_measures);
+}
+
 // private methods
 
 boost::optional<Phred<double>>
@@ -605,27 +664,7 @@ VariantCallFilter::MeasureBlock VariantCallFilter::measure(const CallBlock& bloc
 
 VariantCallFilter::MeasureVector VariantCallFilter::measure(const VcfRecord& call, const Measure::FacetMap& facets) const
 {
-    MeasureVector result(measures_.size());
-    if (duplicate_measures_.empty()) {
-        std::transform(std::cbegin(measures_), std::cend(measures_), std::begin(result),
-                       [&] (const MeasureWrapper& m) { return m(call, facets); });
-    } else {
-        std::unordered_map<MeasureWrapper, Measure::ResultType> result_buffer {};
-        result_buffer.reserve(duplicate_measures_.size());
-        for (const auto& m : duplicate_measures_) {
-            result_buffer.emplace(m, m(call, facets));
-        }
-        std::transform(std::cbegin(measures_), std::cend(measures_), std::begin(result),
-                       [&] (const MeasureWrapper& m) -> Measure::ResultType {
-                           auto itr = result_buffer.find(m);
-                           if (itr != std::cend(result_buffer)) {
-                               return itr->second;
-                           } else {
-                               return m(call, facets);
-                           }
-                       });
-    }
-    return result;
+    return evaluate_measures(call, [&] (const MeasureWrapper& m) { return m(call, facets); });
 }
 
 void VariantCallFilter::pass(const SampleName& sample, VcfRecord::Builder& call) const
@@ -652,6 +691,11 @@ void VariantCallFilter::fail(VcfRecord::Builder& call, std::vector<std::string>
     }
 }
 
+ThreadPool& VariantCallFilter::workers() const noexcept
+{
+    return workers_;
+}
+
 bool VariantCallFilter::is_multithreaded() const noexcept
 {
     return !workers_.empty();
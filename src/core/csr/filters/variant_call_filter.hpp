@@ -11,8 +11,10 @@
 #include <functional>
 #include <future>
 #include <unordered_set>
+#include <memory>
 
 #include <boost/optional.hpp>
+#include <boost/filesystem/path.hpp>
 
 #include "config/common.hpp"
 #include "basics/phred.hpp"
@@ -26,6 +28,7 @@
 #include "../facets/facet.hpp"
 #include "../facets/facet_factory.hpp"
 #include "../measures/measure.hpp"
+#include "measure_table_writer.hpp"
 
 namespace octopus {
 
@@ -45,6 +48,7 @@ public:
         bool annotate_all_active_measures = false;
         std::unordered_set<std::string> annotations = {};
         bool aggregate_allele_annotations = false;
+        boost::optional<boost::filesystem::path> measure_table = boost::none;
     };
     
     struct ConcurrencyPolicy
@@ -98,6 +102,11 @@ protected:
     MeasureVector measure(const VcfRecord& call) const;
     MeasureBlock measure(const CallBlock& block) const;
     std::vector<MeasureBlock> measure(const std::vector<CallBlock>& blocks) const;
+    using MeasuredBlocksConsumer = std::function<void(const std::vector<CallBlock>&, const std::vector<MeasureBlock>&)>;
+    // Measures batches of blocks read from [first, last) on the worker pool while the calling thread reads
+    // the next batch and consumes the last measured one. Batches are consumed in input order.
+    void measure_blocks(VcfIterator& first, const VcfIterator& last, const SampleList& samples,
+                        const MeasuredBlocksConsumer& consume) const;
     void write(VcfRecord::Builder&& call, const Classification& classification, VcfWriter& dest) const;
     void write(const VcfRecord& call, const Classification& classification, VcfWriter& dest) const;
     void write(VcfRecord::Builder&& call, const Classification& classification,
@@ -108,8 +117,10 @@ protected:
                VcfWriter& dest) const;
     bool measure_annotations_requested() const noexcept;
     void annotate(VcfRecord::Builder& call, const MeasureVector& measures, const VcfHeader& header) const;
+    void write_measure_table(const VcfRecord& call, const MeasureVector& measures, const SampleList& samples) const;
     Phred<double> compute_joint_quality(const std::vector<Phred<double>>& qualities) const;
     std::vector<std::string> compute_reason_union(const ClassificationList& sample_classifications) const;
+    ThreadPool& workers() const noexcept;
     
 private:
     using FacetNameSet = std::vector<std::string>;
@@ -118,6 +129,7 @@ private:
     FacetNameSet facet_names_;
     OutputOptions output_config_;
     std::vector<MeasureWrapper> duplicate_measures_;
+    mutable std::unique_ptr<MeasureTableWriter> measure_table_;
     
     mutable ThreadPool workers_;
     
@@ -130,6 +142,11 @@ private:
     virtual boost::optional<Phred<double>> compute_joint_quality(const ClassificationList& sample_classifications, const MeasureVector& measures) const;
     virtual bool is_soft_filtered(const ClassificationList& sample_classifications, boost::optional<Phred<double>> joint_quality,
                                   const MeasureVector& measures, std::vector<std::string>& reasons) const;
+    // Filters that can hard filter a call from its first few measures alone override these, so the
+    // remaining measures (and facets only they use) are not evaluated for calls that will be removed.
+    // Only the first num_early_filter_measures() measures are set when is_early_hard_filtered is called.
+    virtual std::size_t num_early_filter_measures() const noexcept { return 0; }
+    virtual bool is_early_hard_filtered(const VcfRecord& call, const MeasureVector& measures) const { return false; }
     
     VcfHeader make_header(const VcfHeader& source) const;
     VcfHeader make_header(const VcfReader& source) const;
@@ -137,6 +154,8 @@ private:
     std::vector<Measure::FacetMap> compute_facets(const std::vector<CallBlock>& blocks) const;
     MeasureBlock measure(const CallBlock& block, const Measure::FacetMap& facets) const;
     MeasureVector measure(const VcfRecord& call, const Measure::FacetMap& facets) const;
+    template <typename Evaluator>
+    MeasureVector evaluate_measures(const VcfRecord& call, Evaluator evaluate) const;
     VcfRecord::Builder construct_template(const VcfRecord& call) const;
     void configure(VcfRecord::Builder& call) const;
     bool is_requested_annotation(const MeasureWrapper& measure) const noexcept;
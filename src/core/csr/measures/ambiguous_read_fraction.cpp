@@ -14,7 +14,7 @@
 #include "io/variant/vcf_spec.hpp"
 #include "utils/genotype_reader.hpp"
 #include "../facets/samples.hpp"
-#include "../facets/overlapping_reads.hpp"
+#include "../facets/read_statistics.hpp"
 #include "../facets/read_assignments.hpp"
 
 namespace octopus { namespace csr {
@@ -34,12 +34,12 @@ Measure::ValueType AmbiguousReadFraction::get_value_type() const
 Measure::ResultType AmbiguousReadFraction::do_evaluate(const VcfRecord& call, const FacetMap& facets) const
 {
     const auto& samples = get_value<Samples>(facets.at("Samples"));
-    const auto& reads = get_value<OverlappingReads>(facets.at("OverlappingReads"));
+    const auto& statistics = get_value<ReadStatistics>(facets.at("ReadStatistics"));
     const auto& assignments = get_value<ReadAssignments>(facets.at("ReadAssignments")).haplotypes;
     Array<Optional<ValueType>> result(samples.size());
     for (std::size_t s {0}; s < samples.size(); ++s) {
         const auto& sample = samples[s];
-        const auto num_overlapping_reads = count_overlapped(reads.at(sample), call);
+        const auto num_overlapping_reads = get(statistics, call, sample).num_reads;
         if (num_overlapping_reads > 0) {
             double sample_result {};
             if (assignments.count(sample) == 1) {
@@ -69,7 +69,7 @@ std::string AmbiguousReadFraction::do_describe() const
 
 std::vector<std::string> AmbiguousReadFraction::do_requirements() const
 {
-    return {"Samples", "OverlappingReads", "ReadAssignments"};
+    return {"Samples", "ReadStatistics", "ReadAssignments"};
 }
 
 } // namespace csr
@@ -9,8 +9,7 @@
 
 #include "basics/aligned_read.hpp"
 #include "io/variant/vcf_record.hpp"
-#include "utils/read_stats.hpp"
-#include "../facets/overlapping_reads.hpp"
+#include "../facets/read_statistics.hpp"
 
 namespace octopus { namespace csr {
 
@@ -26,30 +25,13 @@ Measure::ValueType ClippedReadFraction::get_value_type() const
     return double {};
 }
 
-namespace {
-
-auto clip_fraction(const AlignedRead& read) noexcept
-{
-    assert(sequence_size(read) > 0);
-    return static_cast<double>(total_clip_size(read)) / sequence_size(read);
-}
-
-bool is_significantly_clipped(const AlignedRead& read) noexcept
-{
-    return is_soft_clipped(read) && clip_fraction(read) > 0.25;
-}
-
-} // namespace
-
 Measure::ResultType ClippedReadFraction::do_evaluate(const VcfRecord& call, const FacetMap& facets) const
 {
-    const auto& reads = get_value<OverlappingReads>(facets.at("OverlappingReads"));
-    unsigned num_reads {0}, num_soft_clipped_reads {0};
-    for (const auto& p : reads) {
-        for (const auto& read : overlap_range(p.second, call)) {
-            if (is_significantly_clipped(read)) ++num_soft_clipped_reads;
-            ++num_reads;
-        }
+    const auto& statistics = get_value<ReadStatistics>(facets.at("ReadStatistics"));
+    std::size_t num_reads {0}, num_soft_clipped_reads {0};
+    for (const auto& p : get(statistics, call)) {
+        num_soft_clipped_reads += p.second.num_significantly_clipped;
+        num_reads += p.second.num_reads;
     }
     Optional<ValueType> result {};
     if (num_reads > 0) {
@@ -75,7 +57,7 @@ std::string ClippedReadFraction::do_describe() const
 
 std::vector<std::string> ClippedReadFraction::do_requirements() const
 {
-    return {"OverlappingReads"};
+    return {"ReadStatistics"};
 }
 
 } // namespace csr
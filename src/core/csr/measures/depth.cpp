@@ -10,7 +10,7 @@
 #include "io/variant/vcf_spec.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "../facets/samples.hpp"
-#include "../facets/overlapping_reads.hpp"
+#include "../facets/read_statistics.hpp"
 
 namespace octopus { namespace csr {
 
@@ -38,14 +38,14 @@ Measure::ResultType Depth::do_evaluate(const VcfRecord& call, const FacetMap& fa
     if (aggregate_) {
         ValueType result {};
         if (recalculate_) {
-            const auto& reads = get_value<OverlappingReads>(facets.at("OverlappingReads"));
+            const auto& statistics = get_value<ReadStatistics>(facets.at("ReadStatistics"));
             std::size_t depth {0};
-            for (const auto& p : reads) {
-                depth += max_coverage(p.second, mapped_region(call));
+            for (const auto& p : get(statistics, call)) {
+                depth += p.second.max_coverage;
             }
             result = depth;
         } else {
-            result = boost::lexical_cast<std::size_t>(call.info_value(vcfspec::info::combinedReadDepth).front());
+            result = call.info_value_as<std::size_t>(vcfspec::info::combinedReadDepth);
         }
         return result;
     } else {
@@ -53,13 +53,13 @@ Measure::ResultType Depth::do_evaluate(const VcfRecord& call, const FacetMap& fa
         Array<ValueType> result {};
         result.reserve(samples.size());
         if (recalculate_) {
-            const auto& reads = get_value<OverlappingReads>(facets.at("OverlappingReads"));
+            const auto& statistics = get_value<ReadStatistics>(facets.at("ReadStatistics"));
             for (const auto& sample : samples) {
-                result.emplace_back(static_cast<std::size_t>(max_coverage(reads.at(sample), mapped_region(call))));
+                result.emplace_back(static_cast<std::size_t>(get(statistics, call, sample).max_coverage));
             }
         } else {
             for (const auto& sample : samples) {
-                result.emplace_back(boost::lexical_cast<std::size_t>(call.get_sample_value(sample, vcfspec::format::combinedReadDepth).front()));
+                result.emplace_back(call.get_sample_value_as<std::size_t>(sample, vcfspec::format::combinedReadDepth));
             }
         }
         return result;
@@ -89,7 +89,7 @@ std::vector<std::string> Depth::do_requirements() const
 {
     std::vector<std::string> result {};
     if (!aggregate_) result.push_back("Samples");
-    if (recalculate_) result.push_back("OverlappingReads");
+    if (recalculate_) result.push_back("ReadStatistics");
     return result;
 }
 
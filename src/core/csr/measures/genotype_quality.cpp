@@ -34,7 +34,7 @@ Measure::ResultType GenotypeQuality::do_evaluate(const VcfRecord& call, const Fa
     for (std::size_t s {0}; s < samples.size(); ++s) {
         static const std::string gq_field {vcfspec::format::conditionalQuality};
         if (call.has_format(gq_field)) {
-            result[s] = std::stod(call.get_sample_value(samples[s], gq_field).front());
+            result[s] = call.get_sample_value_as<double>(samples[s], gq_field);
         }
     }
     return result;
@@ -6,8 +6,7 @@
 #include <boost/variant.hpp>
 
 #include "io/variant/vcf_record.hpp"
-#include "utils/read_stats.hpp"
-#include "../facets/overlapping_reads.hpp"
+#include "../facets/read_statistics.hpp"
 
 namespace octopus { namespace csr {
 
@@ -29,10 +28,14 @@ Measure::ResultType MappingQualityZeroCount::do_evaluate(const VcfRecord& call,
 {
     ValueType result {};
     if (recalculate_) {
-        const auto& reads = get_value<OverlappingReads>(facets.at("OverlappingReads"));
-        result = count_mapq_zero(reads, mapped_region(call));
+        const auto& statistics = get_value<ReadStatistics>(facets.at("ReadStatistics"));
+        std::size_t num_mapq_zero {0};
+        for (const auto& p : get(statistics, call)) {
+            num_mapq_zero += p.second.num_mapq_zero;
+        }
+        result = num_mapq_zero;
     } else {
-        result = static_cast<std::size_t>(std::stoull(call.info_value("MQ0").front()));
+        result = call.info_value_as<std::size_t>("MQ0");
     }
     return result;
 }
@@ -55,7 +58,7 @@ std::string MappingQualityZeroCount::do_describe() const
 std::vector<std::string> MappingQualityZeroCount::do_requirements() const
 {
     if (recalculate_) {
-        return {"OverlappingReads"};
+        return {"ReadStatistics"};
     } else {
         return {};
     }
@@ -7,9 +7,8 @@
 
 #include "io/variant/vcf_record.hpp"
 #include "io/variant/vcf_spec.hpp"
-#include "utils/read_stats.hpp"
 #include "../facets/samples.hpp"
-#include "../facets/overlapping_reads.hpp"
+#include "../facets/read_statistics.hpp"
 
 namespace octopus { namespace csr {
 
@@ -28,11 +27,11 @@ Measure::ValueType MaxReadLength::get_value_type() const
 Measure::ResultType MaxReadLength::do_evaluate(const VcfRecord& call, const FacetMap& facets) const
 {
     const auto& samples = get_value<Samples>(facets.at("Samples"));
-    const auto& reads = get_value<OverlappingReads>(facets.at("OverlappingReads"));
+    const auto& statistics = get_value<ReadStatistics>(facets.at("ReadStatistics"));
     Array<ValueType> result {};
     result.reserve(samples.size());
     for (const auto& sample : samples) {
-        result.emplace_back(max_read_length(reads.at(sample), mapped_region(call)));
+        result.emplace_back(get(statistics, call, sample).max_read_length);
     }
     return result;
 }
@@ -54,7 +53,7 @@ std::string MaxReadLength::do_describe() const
 
 std::vector<std::string> MaxReadLength::do_requirements() const
 {
-    return {"Samples", "OverlappingReads"};
+    return {"Samples", "ReadStatistics"};
 }
 
 } // namespace csr
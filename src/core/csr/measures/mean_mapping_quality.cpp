@@ -4,13 +4,13 @@
 #include "mean_mapping_quality.hpp"
 
 #include <cassert>
+#include <cmath>
 
 #include <boost/variant.hpp>
 
 #include "io/variant/vcf_record.hpp"
-#include "utils/read_stats.hpp"
 #include "io/variant/vcf_spec.hpp"
-#include "../facets/overlapping_reads.hpp"
+#include "../facets/read_statistics.hpp"
 
 namespace octopus { namespace csr {
 
@@ -32,11 +32,17 @@ Measure::ResultType MeanMappingQuality::do_evaluate(const VcfRecord& call, const
 {
     ValueType result {};
     if (recalculate_) {
-        const auto& reads = get_value<OverlappingReads>(facets.at("OverlappingReads"));
-        assert(!reads.empty());
-        result = rmq_mapping_quality(reads, mapped_region(call));
+        const auto& statistics = get_value<ReadStatistics>(facets.at("ReadStatistics"));
+        std::size_t num_reads {0};
+        double sum_squared_mapping_quality {0};
+        for (const auto& p : get(statistics, call)) {
+            num_reads += p.second.num_reads;
+            sum_squared_mapping_quality += p.second.sum_squared_mapping_quality;
+        }
+        // Root mean square, as rmq_mapping_quality
+        result = num_reads > 0 ? std::sqrt(sum_squared_mapping_quality / num_reads) : 0.0;
     } else {
-        result = std::stod(call.info_value(vcfspec::info::rmsMappingQuality).front());
+        result = call.info_value_as<double>(vcfspec::info::rmsMappingQuality);
     }
     return result;
 }
@@ -59,7 +65,7 @@ std::string MeanMappingQuality::do_describe() const
 std::vector<std::string> MeanMappingQuality::do_requirements() const
 {
     if (recalculate_) {
-        return {"OverlappingReads"};
+        return {"ReadStatistics"};
     } else {
         return {};
     }
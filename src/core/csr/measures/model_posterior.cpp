@@ -3,8 +3,6 @@
 
 #include "model_posterior.hpp"
 
-#include <boost/lexical_cast.hpp>
-
 #include "io/variant/vcf_record.hpp"
 #include "io/variant/vcf_spec.hpp"
 #include "config/octopus_vcf.hpp"
@@ -31,14 +29,14 @@ Measure::ResultType ModelPosterior::do_evaluate(const VcfRecord& call, const Fac
     Array<Optional<ValueType>> result(samples.size());
     if (call.has_format(ovcf::format::modelPosterior)) {
         for (std::size_t s {0}; s < samples.size(); ++s) {
-            const auto mp = call.get_sample_value(samples[s], ovcf::format::modelPosterior);
+            const auto& mp = call.get_sample_value(samples[s], ovcf::format::modelPosterior);
             assert(mp.size() == 1);
             if (mp[0] != vcfspec::missingValue) {
-                result[s] = boost::lexical_cast<double>(mp[0]);
+                result[s] = parse_real_value(mp[0]);
             }
         }
     } else if (!is_info_missing(ovcf::info::modelPosterior, call)) {
-        auto mp = std::stod(call.info_value(ovcf::info::modelPosterior).front());
+        auto mp = call.info_value_as<double>(ovcf::info::modelPosterior);
         std::fill(std::begin(result), std::end(result), mp);
     }
     return result;
@@ -23,7 +23,7 @@ Measure::ResultType PhylogenyPosterior::do_evaluate(const VcfRecord& call, const
 {
     Optional<ValueType> result {};
     if (!is_info_missing(this->name(), call)) {
-        result = std::stod(call.info_value(this->name()).front());
+        result = call.info_value_as<double>(this->name());
     }
     return result;
 }
@@ -26,7 +26,7 @@ Measure::ResultType PosteriorProbability::do_evaluate(const VcfRecord& call, con
     if (call.has_info("PP")) {
         const auto& pp = call.info_value("PP");
         if (pp.size() == 1 && pp.front() != vcfspec::missingValue) {
-            result = std::stod(pp.front());
+            result = parse_real_value(pp.front());
         }
     }
     return result;
@@ -15,10 +15,10 @@
 #include "io/variant/vcf_record.hpp"
 #include "basics/aligned_read.hpp"
 #include "core/types/allele.hpp"
-#include "utils/maths.hpp"
 #include "../facets/samples.hpp"
 #include "../facets/alleles.hpp"
 #include "../facets/read_assignments.hpp"
+#include "tail_probabilities.hpp"
 
 namespace octopus { namespace csr {
 
@@ -111,7 +111,7 @@ auto compute_head_tail_counts(const Allele& allele, const ReadRefSupportSet& sup
 double calculate_tail_bias(const PositionCounts counts, const double tolerance = 0.5, const double prior = 1.0)
 {
     assert(tolerance > 0.0 && tolerance < 1.0);
-    return maths::beta_cdf(counts.middle + prior, counts.end + prior, tolerance);
+    return beta_cdf(counts.middle + prior, counts.end + prior, tolerance);
 }
 
 double calculate_tail_bias(const Allele& allele, const ReadRefSupportSet& support, const EndDefinition end_def = EndDefinition {})
@@ -15,10 +15,10 @@
 #include "io/variant/vcf_record.hpp"
 #include "basics/aligned_read.hpp"
 #include "core/types/allele.hpp"
-#include "utils/maths.hpp"
 #include "../facets/samples.hpp"
 #include "../facets/alleles.hpp"
 #include "../facets/read_assignments.hpp"
+#include "tail_probabilities.hpp"
 
 namespace octopus { namespace csr {
 
@@ -88,8 +88,8 @@ double calculate_position_bias(const PositionCounts forward_counts, const Positi
     assert(tolerance > 0.0 && tolerance < 1.0);
     const auto num_lhs = forward_counts.head + reverse_counts.tail;
     const auto num_rhs = forward_counts.tail + reverse_counts.head;
-    const auto prob_lhs_biased = maths::beta_sf(static_cast<double>(num_lhs + 1), static_cast<double>(num_rhs + 1), 0.5 + tolerance / 2);
-    const auto prob_rhs_biased = maths::beta_cdf(static_cast<double>(num_lhs + 1), static_cast<double>(num_rhs + 1), 0.5 - tolerance / 2);
+    const auto prob_lhs_biased = beta_sf(static_cast<double>(num_lhs + 1), static_cast<double>(num_rhs + 1), 0.5 + tolerance / 2);
+    const auto prob_rhs_biased = beta_cdf(static_cast<double>(num_lhs + 1), static_cast<double>(num_rhs + 1), 0.5 - tolerance / 2);
     return prob_lhs_biased + prob_rhs_biased;
 }
 
@@ -20,6 +20,7 @@
 #include "utils/maths.hpp"
 #include "utils/beta_distribution.hpp"
 #include "utils/string_utils.hpp"
+#include "tail_probabilities.hpp"
 #include "../facets/samples.hpp"
 #include "../facets/alleles.hpp"
 #include "../facets/read_assignments.hpp"
@@ -160,11 +161,10 @@ double estimate_prob_different(const std::vector<double>& lhs, const std::vector
     return static_cast<double>(n_diffs) / diffs.size();
 }
 
-double calculate_max_prob_different(const DirectionCountVector& direction_counts, const std::size_t num_samples,
-                                    const double min_diff)
+double estimate_max_prob_different(const DirectionCountVector& direction_counts, const std::size_t num_samples,
+                                   const double min_diff)
 {
     const auto num_counts = direction_counts.size();
-    if (num_counts < 2) return 0;
     const auto samples = generate_beta_samples(direction_counts, num_samples);
     double result {0};
     for (std::size_t i {0}; i < num_counts - 1; ++i) {
@@ -175,6 +175,46 @@ double calculate_max_prob_different(const DirectionCountVector& direction_counts
     return result;
 }
 
+boost::optional<double>
+calculate_exact_max_prob_different(const DirectionCountVector& direction_counts, const double min_diff)
+{
+    const auto num_counts = direction_counts.size();
+    double result {0};
+    for (std::size_t i {0}; i < num_counts - 1; ++i) {
+        for (auto j = i + 1; j < num_counts; ++j) {
+            const auto& lhs = direction_counts[i];
+            const auto& rhs = direction_counts[j];
+            const auto prob = beta_difference_probability(lhs.forward, lhs.reverse, rhs.forward, rhs.reverse, min_diff);
+            if (!prob) return boost::none;
+            result = std::max(result, *prob);
+        }
+    }
+    return result;
+}
+
+// The estimates are seeded by the counts, so are deterministic and can be memoised
+ProbabilityMemo& estimate_memo()
+{
+    static ProbabilityMemo result {};
+    return result;
+}
+
+double calculate_max_prob_different(const DirectionCountVector& direction_counts, const std::size_t num_samples,
+                                    const double min_diff)
+{
+    const auto num_counts = direction_counts.size();
+    if (num_counts < 2) return 0;
+    const auto exact_prob = calculate_exact_max_prob_different(direction_counts, min_diff);
+    if (exact_prob) return *exact_prob;
+    ProbabilityMemo::Key key {static_cast<double>(num_samples), min_diff};
+    key.reserve(2 + 2 * num_counts);
+    for (const auto& counts : direction_counts) {
+        key.push_back(counts.forward);
+        key.push_back(counts.reverse);
+    }
+    return estimate_memo().fetch(key, [&] () { return estimate_max_prob_different(direction_counts, num_samples, min_diff); });
+}
+
 } // namespace
 
 Measure::ResultType StrandBias::do_evaluate(const VcfRecord& call, const FacetMap& facets) const
@@ -8,10 +8,9 @@
 #include "io/variant/vcf_record.hpp"
 #include "io/variant/vcf_spec.hpp"
 #include "basics/aligned_read.hpp"
-#include "utils/read_stats.hpp"
-#include "utils/maths.hpp"
 #include "../facets/samples.hpp"
-#include "../facets/overlapping_reads.hpp"
+#include "../facets/read_statistics.hpp"
+#include "tail_probabilities.hpp"
 
 namespace octopus { namespace csr {
 
@@ -50,12 +49,13 @@ std::vector<std::string> StrandDisequilibrium::do_parameters() const
 Measure::ResultType StrandDisequilibrium::do_evaluate(const VcfRecord& call, const FacetMap& facets) const
 {
     const auto& samples = get_value<Samples>(facets.at("Samples"));
-    const auto& reads = get_value<OverlappingReads>(facets.at("OverlappingReads"));
+    const auto& statistics = get_value<ReadStatistics>(facets.at("ReadStatistics"));
     Array<ValueType> result {};
     result.reserve(samples.size());
     for (const auto& sample : samples) {
-        const auto direction_counts = count_directions(reads.at(sample), mapped_region(call));
-        const auto tail_probability = maths::beta_tail_probability(direction_counts.first + 0.5, direction_counts.second + 0.5, tail_mass_);
+        const auto& sample_statistics = get(statistics, call, sample);
+        const auto num_reverse = sample_statistics.num_reads - sample_statistics.num_forward;
+        const auto tail_probability = beta_tail_probability(sample_statistics.num_forward + 0.5, num_reverse + 0.5, tail_mass_);
         result.emplace_back(tail_probability);
     }
     return result;
@@ -78,7 +78,7 @@ std::string StrandDisequilibrium::do_describe() const
 
 std::vector<std::string> StrandDisequilibrium::do_requirements() const
 {
-    return {"Samples", "OverlappingReads"};
+    return {"Samples", "ReadStatistics"};
 }
 
 bool StrandDisequilibrium::is_equal(const Measure& other) const noexcept
@@ -0,0 +1,129 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "tail_probabilities.hpp"
+
+#include <cmath>
+#include <utility>
+#include <algorithm>
+
+#include <boost/math/distributions/beta.hpp>
+#include <boost/math/constants/constants.hpp>
+
+#include "utils/maths.hpp"
+
+namespace octopus { namespace csr {
+
+namespace {
+
+enum class Tail { lower, upper, both, difference };
+
+ProbabilityMemo& memo()
+{
+    static ProbabilityMemo result {};
+    return result;
+}
+
+double fetch_beta(const Tail tail, const double a, const double b, const double x)
+{
+    return memo().fetch({static_cast<double>(tail), a, b, x}, [=] () {
+        switch (tail) {
+            case Tail::lower: return maths::beta_cdf(a, b, x);
+            case Tail::upper: return maths::beta_sf(a, b, x);
+            default: return maths::beta_tail_probability(a, b, x);
+        }
+    });
+}
+
+// The integrand has degree a1 + b1 + a2 + b2 - 3, which needs (a1 + b1 + a2 + b2 - 2) / 2 nodes
+constexpr unsigned maxExactNodes {64};
+
+using Rule = std::vector<std::pair<double, double>>; // (node, weight) on [-1, 1]
+
+Rule make_gauss_legendre_rule(const unsigned n)
+{
+    Rule result(n);
+    const auto m = (n + 1) / 2;
+    for (unsigned i {0}; i < m; ++i) {
+        double z {std::cos(boost::math::constants::pi<double>() * (i + 0.75) / (n + 0.5))}, dp {0};
+        for (int iteration {0}; iteration < 100; ++iteration) {
+            double p1 {1}, p2 {0};
+            for (unsigned j {1}; j <= n; ++j) {
+                const auto p3 = p2;
+                p2 = p1;
+                p1 = ((2.0 * j - 1) * z * p2 - (j - 1.0) * p3) / j;
+            }
+            dp = n * (z * p1 - p2) / (z * z - 1);
+            const auto z_prev = z;
+            z = z_prev - p1 / dp;
+            if (std::abs(z - z_prev) < 1e-15) break;
+        }
+        const auto weight = 2 / ((1 - z * z) * dp * dp);
+        result[i] = {-z, weight};
+        result[n - 1 - i] = {z, weight};
+    }
+    return result;
+}
+
+const Rule& get_gauss_legendre_rule(const unsigned n)
+{
+    static const auto rules = [] () {
+        std::vector<Rule> result(maxExactNodes + 1);
+        for (unsigned n {1}; n <= maxExactNodes; ++n) result[n] = make_gauss_legendre_rule(n);
+        return result;
+    }();
+    return rules[n];
+}
+
+// P(p1 - p2 > d) = integral over y in [0, 1 - d] of f2(y) * P(p1 > y + d)
+double integrate_upper_difference(const unsigned a1, const unsigned b1, const unsigned a2, const unsigned b2,
+                                  const double min_difference, const Rule& rule)
+{
+    const boost::math::beta_distribution<> beta1 {static_cast<double>(a1), static_cast<double>(b1)};
+    const boost::math::beta_distribution<> beta2 {static_cast<double>(a2), static_cast<double>(b2)};
+    const auto half_length = (1 - min_difference) / 2;
+    double result {0};
+    for (const auto& node : rule) {
+        const auto y = half_length * (node.first + 1);
+        result += node.second * boost::math::pdf(beta2, y) * boost::math::cdf(boost::math::complement(beta1, y + min_difference));
+    }
+    return half_length * result;
+}
+
+} // namespace
+
+double beta_cdf(const double a, const double b, const double x)
+{
+    return fetch_beta(Tail::lower, a, b, x);
+}
+
+double beta_sf(const double a, const double b, const double x)
+{
+    return fetch_beta(Tail::upper, a, b, x);
+}
+
+double beta_tail_probability(const double a, const double b, const double x)
+{
+    return fetch_beta(Tail::both, a, b, x);
+}
+
+boost::optional<double>
+beta_difference_probability(const unsigned a1, const unsigned b1, const unsigned a2, const unsigned b2,
+                            const double min_difference)
+{
+    if (a1 == 0 || b1 == 0 || a2 == 0 || b2 == 0) return boost::none;
+    const auto num_nodes = std::max((a1 + b1 + a2 + b2 - 1) / 2, 1u);
+    if (num_nodes > maxExactNodes) return boost::none;
+    if (min_difference >= 1) return 0.0;
+    const ProbabilityMemo::Key key {static_cast<double>(Tail::difference), static_cast<double>(a1), static_cast<double>(b1),
+                                    static_cast<double>(a2), static_cast<double>(b2), min_difference};
+    return memo().fetch(key, [=] () {
+        const auto& rule = get_gauss_legendre_rule(num_nodes);
+        const auto result = integrate_upper_difference(a1, b1, a2, b2, min_difference, rule)
+                          + integrate_upper_difference(a2, b2, a1, b1, min_difference, rule);
+        return std::min(std::max(result, 0.0), 1.0);
+    });
+}
+
+} // namespace csr
+} // namespace octopus
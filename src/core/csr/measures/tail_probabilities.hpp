@@ -0,0 +1,74 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef tail_probabilities_hpp
+#define tail_probabilities_hpp
+
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstddef>
+
+#include <boost/optional.hpp>
+#include <boost/functional/hash.hpp>
+
+namespace octopus { namespace csr {
+
+/*
+    Tail probabilities for the bias measures. Measures are evaluated for every call and sample, but
+    the read counts they are evaluated on repeat heavily between calls, so results are memoised in
+    process-wide tables. All functions are thread-safe.
+ */
+
+// As maths::beta_cdf, maths::beta_sf, and maths::beta_tail_probability
+double beta_cdf(double a, double b, double x);
+double beta_sf(double a, double b, double x);
+double beta_tail_probability(double a, double b, double x);
+
+// The probability that |p1 - p2| > min_difference, where p1 ~ Beta(a1, b1) and p2 ~ Beta(a2, b2).
+// With integer parameters the integrand is a polynomial, so Gauss-Legendre quadrature with enough
+// nodes is exact. boost::none if the parameters are too large for this to be cheap.
+boost::optional<double>
+beta_difference_probability(unsigned a1, unsigned b1, unsigned a2, unsigned b2, double min_difference);
+
+// A memo of probabilities keyed by the arguments they are computed from. The table is cleared
+// when full. compute is called without holding the lock.
+class ProbabilityMemo
+{
+public:
+    using Key = std::vector<double>;
+
+    ProbabilityMemo(std::size_t max_size = 65'536) : table_ {}, max_size_ {max_size} {}
+
+    ProbabilityMemo(const ProbabilityMemo&)            = delete;
+    ProbabilityMemo& operator=(const ProbabilityMemo&) = delete;
+    ProbabilityMemo(ProbabilityMemo&&)                 = delete;
+    ProbabilityMemo& operator=(ProbabilityMemo&&)      = delete;
+
+    ~ProbabilityMemo() = default;
+
+    template <typename F>
+    double fetch(const Key& key, F compute)
+    {
+        {
+            std::lock_guard<std::mutex> lock {mutex_};
+            const auto itr = table_.find(key);
+            if (itr != std::cend(table_)) return itr->second;
+        }
+        const double result {compute()};
+        std::lock_guard<std::mutex> lock {mutex_};
+        if (table_.size() >= max_size_) table_.clear();
+        table_.emplace(key, result);
+        return result;
+    }
+
+private:
+    std::unordered_map<Key, double, boost::hash<Key>> table_;
+    std::size_t max_size_;
+    std::mutex mutex_;
+};
+
+} // namespace csr
+} // namespace octopus
+
+#endif
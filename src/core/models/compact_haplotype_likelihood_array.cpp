@@ -0,0 +1,150 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "compact_haplotype_likelihood_array.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace octopus {
+
+namespace {
+
+double get_quantisation_step(const unsigned bits)
+{
+    switch (bits) {
+        case 8: return 0.1;
+        case 16: return 0.001;
+        default: throw std::invalid_argument {"CompactHaplotypeLikelihoodArray: bits must be 8 or 16, not " + std::to_string(bits)};
+    }
+}
+
+} // namespace
+
+CompactHaplotypeLikelihoodArray::CompactHaplotypeLikelihoodArray(const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                                                 const unsigned bits)
+: bits_ {bits}
+, step_ {get_quantisation_step(bits)}
+, samples_ {haplotype_likelihoods.samples()}
+, haplotypes_ {haplotype_likelihoods.haplotypes()}
+{
+    if (haplotype_likelihoods.is_empty()) return;
+    const auto num_haplotypes = haplotypes_.size();
+    const auto code_bytes = bits_ / 8;
+    const auto max_code = static_cast<double>((1u << bits_) - 1);
+    haplotype_indices_.reserve(num_haplotypes);
+    for (std::size_t haplotype_idx {0}; haplotype_idx < num_haplotypes; ++haplotype_idx) {
+        haplotype_indices_.emplace(haplotypes_[haplotype_idx], haplotype_idx);
+    }
+    sample_indices_.reserve(samples_.size());
+    sample_layouts_.reserve(samples_.size());
+    std::size_t num_best {0}, num_codes {0};
+    for (std::size_t sample_idx {0}; sample_idx < samples_.size(); ++sample_idx) {
+        const auto num_likelihoods = haplotype_likelihoods.num_likelihoods(samples_[sample_idx]);
+        sample_indices_.emplace(samples_[sample_idx], sample_idx);
+        sample_layouts_.push_back({num_best, num_codes, num_likelihoods});
+        num_best += num_likelihoods;
+        num_codes += num_haplotypes * num_likelihoods;
+    }
+    best_likelihoods_.assign(num_best, std::numeric_limits<LogProbability>::lowest());
+    codes_.resize(num_codes * code_bytes);
+    for (std::size_t sample_idx {0}; sample_idx < samples_.size(); ++sample_idx) {
+        const auto& layout = sample_layouts_[sample_idx];
+        const auto matrix = haplotype_likelihoods.matrix(samples_[sample_idx]);
+        const auto best = best_likelihoods_.data() + layout.best_offset;
+        for (std::size_t haplotype_idx {0}; haplotype_idx < num_haplotypes; ++haplotype_idx) {
+            const auto row = matrix[haplotype_idx];
+            for (std::size_t read_idx {0}; read_idx < layout.num_likelihoods; ++read_idx) {
+                best[read_idx] = std::max(best[read_idx], row[read_idx]);
+            }
+        }
+        for (std::size_t haplotype_idx {0}; haplotype_idx < num_haplotypes; ++haplotype_idx) {
+            const auto row = matrix[haplotype_idx];
+            auto code_itr = codes_.data() + (layout.code_offset + haplotype_idx * layout.num_likelihoods) * code_bytes;
+            for (std::size_t read_idx {0}; read_idx < layout.num_likelihoods; ++read_idx, code_itr += code_bytes) {
+                const auto difference = static_cast<double>(best[read_idx]) - row[read_idx];
+                const auto code = static_cast<std::uint16_t>(std::min(std::round(difference / step_), max_code));
+                if (code_bytes == 1) {
+                    *code_itr = static_cast<std::uint8_t>(code);
+                } else {
+                    std::memcpy(code_itr, &code, sizeof(code));
+                }
+            }
+        }
+    }
+    footprint_.resize(footprint());
+}
+
+unsigned CompactHaplotypeLikelihoodArray::bits() const noexcept
+{
+    return bits_;
+}
+
+std::size_t CompactHaplotypeLikelihoodArray::num_likelihoods(const SampleName& sample) const
+{
+    return sample_layouts_[sample_indices_.at(sample)].num_likelihoods;
+}
+
+CompactHaplotypeLikelihoodArray::LikelihoodVector
+CompactHaplotypeLikelihoodArray::operator()(const SampleName& sample, const Haplotype& haplotype) const
+{
+    return make_vector(sample_indices_.at(sample), haplotype_indices_.at(haplotype));
+}
+
+CompactHaplotypeLikelihoodArray::LikelihoodVector
+CompactHaplotypeLikelihoodArray::operator()(const SampleName& sample, const IndexedHaplotype<>& haplotype) const
+{
+    return make_vector(sample_indices_.at(sample), index_of(haplotype));
+}
+
+const std::vector<SampleName>& CompactHaplotypeLikelihoodArray::samples() const noexcept
+{
+    return samples_;
+}
+
+const MappableBlock<Haplotype>& CompactHaplotypeLikelihoodArray::haplotypes() const noexcept
+{
+    return haplotypes_;
+}
+
+bool CompactHaplotypeLikelihoodArray::contains(const Haplotype& haplotype) const noexcept
+{
+    return haplotype_indices_.count(haplotype) == 1;
+}
+
+bool CompactHaplotypeLikelihoodArray::is_empty() const noexcept
+{
+    return haplotype_indices_.empty();
+}
+
+MemoryFootprint CompactHaplotypeLikelihoodArray::footprint() const noexcept
+{
+    return codes_.capacity() + best_likelihoods_.capacity() * sizeof(LogProbability);
+}
+
+// private methods
+
+std::uint16_t CompactHaplotypeLikelihoodArray::code(const std::size_t idx) const noexcept
+{
+    if (bits_ == 8) {
+        return codes_[idx];
+    } else {
+        std::uint16_t result;
+        std::memcpy(&result, codes_.data() + 2 * idx, sizeof(result));
+        return result;
+    }
+}
+
+CompactHaplotypeLikelihoodArray::LikelihoodVector
+CompactHaplotypeLikelihoodArray::make_vector(const std::size_t sample_idx, const std::size_t haplotype_idx) const noexcept
+{
+    const auto& layout = sample_layouts_[sample_idx];
+    return {this, best_likelihoods_.data() + layout.best_offset,
+            layout.code_offset + haplotype_idx * layout.num_likelihoods, layout.num_likelihoods};
+}
+
+} // namespace octopus
@@ -0,0 +1,115 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef compact_haplotype_likelihood_array_hpp
+#define compact_haplotype_likelihood_array_hpp
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include "config/common.hpp"
+#include "containers/mappable_block.hpp"
+#include "core/types/haplotype.hpp"
+#include "core/types/indexed_haplotype.hpp"
+#include "utils/memory_budget.hpp"
+#include "haplotype_likelihood_array.hpp"
+
+namespace octopus {
+
+/*
+    CompactHaplotypeLikelihoodArray is an approximate, read-only copy of a HaplotypeLikelihoodArray
+    for work that only ranks haplotypes by their support for each read, such as assigning reads to
+    called haplotypes, after the latents have been inferred from the full likelihoods.
+
+    For each read only the likelihood of its best haplotype is kept at full precision. The likelihood
+    of every other haplotype is kept as its log difference from the best, quantised to 8 or 16 bits.
+    Differences too large to represent are clamped, so these reads still rank the haplotype below
+    any that is represented. With 8 bits the quantisation step is 0.1 (about half a Phred unit) and
+    differences up to 25.5 are exact to within the step; with 16 bits the step is 0.001 and
+    differences up to 65.5 are exact to within the step. The pair HMM score granularity is ln 10 / 10,
+    so either is finer than the likelihood model can distinguish.
+
+    Reads are in the same order as in the array the likelihoods were taken from.
+ */
+class CompactHaplotypeLikelihoodArray
+{
+public:
+    using LogProbability = HaplotypeLikelihoodArray::LogProbability;
+
+    // A decoding view of the likelihoods of one haplotype for each read of a sample
+    class LikelihoodVector
+    {
+    public:
+        LikelihoodVector() = default;
+        LikelihoodVector(const CompactHaplotypeLikelihoodArray* array, const LogProbability* best,
+                         std::size_t code_offset, std::size_t size) noexcept
+        : array_ {array}, best_ {best}, code_offset_ {code_offset}, size_ {size} {}
+
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+
+        LogProbability operator[](std::size_t n) const noexcept
+        {
+            return best_[n] - static_cast<LogProbability>(array_->code(code_offset_ + n) * array_->step_);
+        }
+
+    private:
+        const CompactHaplotypeLikelihoodArray* array_ = nullptr;
+        const LogProbability* best_ = nullptr;
+        std::size_t code_offset_ = 0, size_ = 0;
+    };
+
+    CompactHaplotypeLikelihoodArray() = default;
+
+    // bits must be 8 or 16
+    CompactHaplotypeLikelihoodArray(const HaplotypeLikelihoodArray& haplotype_likelihoods, unsigned bits = 8);
+
+    CompactHaplotypeLikelihoodArray(const CompactHaplotypeLikelihoodArray&)            = delete;
+    CompactHaplotypeLikelihoodArray& operator=(const CompactHaplotypeLikelihoodArray&) = delete;
+    CompactHaplotypeLikelihoodArray(CompactHaplotypeLikelihoodArray&&)                 = default;
+    CompactHaplotypeLikelihoodArray& operator=(CompactHaplotypeLikelihoodArray&&)      = default;
+
+    ~CompactHaplotypeLikelihoodArray() = default;
+
+    unsigned bits() const noexcept;
+
+    std::size_t num_likelihoods(const SampleName& sample) const;
+
+    LikelihoodVector operator()(const SampleName& sample, const Haplotype& haplotype) const;
+    LikelihoodVector operator()(const SampleName& sample, const IndexedHaplotype<>& haplotype) const;
+
+    const std::vector<SampleName>& samples() const noexcept;
+    const MappableBlock<Haplotype>& haplotypes() const noexcept;
+
+    bool contains(const Haplotype& haplotype) const noexcept;
+
+    bool is_empty() const noexcept;
+
+    MemoryFootprint footprint() const noexcept;
+
+private:
+    struct SampleLayout
+    {
+        std::size_t best_offset, code_offset, num_likelihoods;
+    };
+
+    unsigned bits_ = 8;
+    double step_ = 0.1;
+    std::vector<LogProbability> best_likelihoods_; // [sample][read]
+    std::vector<std::uint8_t> codes_; // [sample][haplotype][read], bits_ / 8 bytes each
+    std::vector<SampleLayout> sample_layouts_;
+    std::unordered_map<SampleName, std::size_t> sample_indices_;
+    std::unordered_map<Haplotype, std::size_t, HaplotypeHash> haplotype_indices_;
+    std::vector<SampleName> samples_;
+    MappableBlock<Haplotype> haplotypes_;
+    MemoryBudget::Reservation footprint_ {process_memory_budget()};
+
+    std::uint16_t code(std::size_t idx) const noexcept;
+    LikelihoodVector make_vector(std::size_t sample_idx, std::size_t haplotype_idx) const noexcept;
+};
+
+} // namespace octopus
+
+#endif
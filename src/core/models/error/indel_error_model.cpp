@@ -22,4 +22,21 @@ void IndelErrorModel::set_penalties(const Haplotype& haplotype, PenaltyVector& g
     do_set_penalties(haplotype, gap_open_penalities, gap_extend_penalties);
 }
 
+void IndelErrorModel::set_penalties(const Haplotype& haplotype, const ReferenceWindow& window,
+                                    const PenaltyVector& reference_gap_open_penalties, const PenaltyVector& reference_gap_extend_penalties,
+                                    PenaltyVector& gap_open_penalities, PenaltyVector& gap_extend_penalties) const
+{
+    do_set_penalties(haplotype, window, reference_gap_open_penalties, reference_gap_extend_penalties,
+                     gap_open_penalities, gap_extend_penalties);
+}
+
+// private methods
+
+void IndelErrorModel::do_set_penalties(const Haplotype& haplotype, const ReferenceWindow& window,
+                                       const PenaltyVector& reference_gap_open_penalties, const PenaltyVector& reference_gap_extend_penalties,
+                                       PenaltyVector& gap_open_penalities, PenaltyVector& gap_extend_penalties) const
+{
+    do_set_penalties(haplotype, gap_open_penalities, gap_extend_penalties);
+}
+
 } // namespace octopus
@@ -12,6 +12,7 @@
 namespace octopus {
 
 class Haplotype;
+class ReferenceWindow;
 
 class IndelErrorModel
 {
@@ -24,11 +25,18 @@ public:
     std::unique_ptr<IndelErrorModel> clone() const;
     void set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalties, PenaltyType& gap_extend_penalty) const;
     void set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalties, PenaltyVector& gap_extend_penalties) const;
+    // The haplotype's penalties given those of the reference sequence of a window containing it
+    void set_penalties(const Haplotype& haplotype, const ReferenceWindow& window,
+                       const PenaltyVector& reference_gap_open_penalties, const PenaltyVector& reference_gap_extend_penalties,
+                       PenaltyVector& gap_open_penalties, PenaltyVector& gap_extend_penalties) const;
     
 private:
     virtual std::unique_ptr<IndelErrorModel> do_clone() const = 0;
     virtual void do_set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalties, PenaltyType& gap_extend_penalty) const = 0;
     virtual void do_set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalties, PenaltyVector& gap_extend_penalties) const = 0;
+    virtual void do_set_penalties(const Haplotype& haplotype, const ReferenceWindow& window,
+                                  const PenaltyVector& reference_gap_open_penalties, const PenaltyVector& reference_gap_extend_penalties,
+                                  PenaltyVector& gap_open_penalties, PenaltyVector& gap_extend_penalties) const;
 };
 
 } // namespace octopus
@@ -0,0 +1,161 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "reference_window.hpp"
+
+#include <iterator>
+#include <algorithm>
+
+namespace octopus {
+
+constexpr unsigned ReferenceWindow::maxPeriod;
+constexpr unsigned ReferenceWindow::flankSize;
+
+namespace {
+
+bool is_square(const ReferenceWindow::NucleotideSequence& sequence, const std::size_t pos, const unsigned period) noexcept
+{
+    if (pos + 2 * period > sequence.size()) return false;
+    const auto first = std::next(std::cbegin(sequence), pos);
+    return std::equal(first, std::next(first, period), std::next(first, period));
+}
+
+bool is_repeat_split_point(const ReferenceWindow::NucleotideSequence& sequence, const std::size_t pos) noexcept
+{
+    for (unsigned period {1}; period <= ReferenceWindow::maxPeriod; ++period) {
+        for (auto square_pos = pos + 1 - 2 * period; square_pos < pos; ++square_pos) {
+            if (is_square(sequence, square_pos, period)) return false;
+        }
+    }
+    return true;
+}
+
+bool is_smoothed_repeat_split_point(const ReferenceWindow::NucleotideSequence& sequence, const std::size_t pos) noexcept
+{
+    // SNV smoothing bridges gaps of up to period + 1 bases between repeats
+    for (unsigned period {1}; period <= 3; ++period) {
+        for (auto square_pos = pos - 3 * period - 1; square_pos <= pos + period + 1; ++square_pos) {
+            if (is_square(sequence, square_pos, period)) return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ReferenceWindow::ReferenceWindow(const Haplotype& reference)
+: region_ {mapped_region(reference)}
+, sequence_ {reference.sequence()}
+, is_repeat_split_point_(sequence_.size(), false)
+, is_smoothed_repeat_split_point_(sequence_.size(), false)
+{
+    if (sequence_.size() > 2 * flankSize) {
+        for (auto pos = flankSize; pos <= sequence_.size() - flankSize; ++pos) {
+            if (is_repeat_split_point(sequence_, pos)) {
+                is_repeat_split_point_[pos] = true;
+                is_smoothed_repeat_split_point_[pos] = is_smoothed_repeat_split_point(sequence_, pos);
+            }
+        }
+    }
+}
+
+const GenomicRegion& ReferenceWindow::region() const noexcept
+{
+    return region_;
+}
+
+const ReferenceWindow::NucleotideSequence& ReferenceWindow::sequence() const noexcept
+{
+    return sequence_;
+}
+
+boost::optional<std::vector<ReferenceWindow::Segment>> ReferenceWindow::split(const Haplotype& haplotype, const Context context) const
+{
+    if (!is_same_region(haplotype, region_)) return boost::none;
+    // Lay out the haplotype as pieces that are the same as the reference, and pieces that are not
+    std::vector<Segment> pieces {};
+    std::size_t haplotype_pos {0}, reference_pos {0};
+    const auto add_reference = [&] (const std::size_t length) {
+        if (length == 0) return;
+        if (!pieces.empty() && pieces.back().is_reference && pieces.back().end == haplotype_pos
+            && pieces.back().reference_begin + (haplotype_pos - pieces.back().begin) == reference_pos) {
+            pieces.back().end += length;
+        } else {
+            pieces.push_back({haplotype_pos, haplotype_pos + length, reference_pos, true});
+        }
+        haplotype_pos += length;
+        reference_pos += length;
+    };
+    const auto window_begin = region_.begin();
+    const auto alleles = haplotype.alleles();
+    for (auto itr = alleles.first; itr != alleles.second; ++itr) {
+        const auto& allele = *itr;
+        if (!contains(region_.contig_region(), allele.mapped_region())) return boost::none;
+        const std::size_t allele_reference_pos {static_cast<std::size_t>(mapped_begin(allele) - window_begin)};
+        if (allele_reference_pos < reference_pos) return boost::none;
+        add_reference(allele_reference_pos - reference_pos);
+        const auto& allele_sequence = allele.sequence();
+        const std::size_t reference_length {region_size(allele)};
+        if (allele_sequence.size() == reference_length
+            && std::equal(std::cbegin(allele_sequence), std::cend(allele_sequence), std::next(std::cbegin(sequence_), reference_pos))) {
+            add_reference(reference_length);
+        } else {
+            pieces.push_back({haplotype_pos, haplotype_pos + allele_sequence.size(), reference_pos, false});
+            haplotype_pos += allele_sequence.size();
+            reference_pos += reference_length;
+        }
+    }
+    if (reference_pos > sequence_.size()) return boost::none;
+    add_reference(sequence_.size() - reference_pos);
+    if (haplotype_pos != sequence_size(haplotype)) return boost::none;
+    // A haplotype position is a split point if the reference position it maps to is, and the bases that
+    // decide this are the same in the haplotype as in the reference
+    const auto& is_split_point = context == Context::repeats ? is_repeat_split_point_ : is_smoothed_repeat_split_point_;
+    const auto is_haplotype_split_point = [&] (const Segment& piece, const std::size_t pos) {
+        return pos >= piece.begin + flankSize && pos + flankSize <= piece.end
+               && is_split_point[piece.reference_begin + (pos - piece.begin)];
+    };
+    std::vector<Segment> result {};
+    result.reserve(pieces.size());
+    const auto add_reference_segment = [&] (const Segment& piece, const std::size_t begin, const std::size_t end) {
+        if (begin < end) {
+            result.push_back({begin, end, piece.reference_begin + (begin - piece.begin), true});
+        }
+    };
+    // Patches start at the last split point before a non-reference piece, and end at the first split point
+    // after it, so nearby alleles share a patch. Pieces between patches must be reference.
+    boost::optional<std::size_t> patch_begin {};
+    std::size_t patched_end {0};
+    const Segment* prev_piece {nullptr};
+    for (const auto& piece : pieces) {
+        if (piece.is_reference) {
+            if (patch_begin) {
+                auto pos = piece.begin + flankSize;
+                while (pos + flankSize <= piece.end && !is_haplotype_split_point(piece, pos)) ++pos;
+                if (pos + flankSize <= piece.end) {
+                    result.push_back({*patch_begin, pos, 0, false});
+                    patch_begin = boost::none;
+                    patched_end = pos;
+                }
+            }
+        } else if (!patch_begin) {
+            auto pos = patched_end;
+            if (prev_piece && prev_piece->is_reference) {
+                auto split_pos = prev_piece->end;
+                while (split_pos > patched_end && !is_haplotype_split_point(*prev_piece, split_pos)) --split_pos;
+                pos = split_pos;
+                add_reference_segment(*prev_piece, patched_end, pos);
+            }
+            patch_begin = pos;
+        }
+        prev_piece = &piece;
+    }
+    if (patch_begin) {
+        result.push_back({*patch_begin, haplotype_pos, 0, false});
+    } else if (prev_piece) {
+        add_reference_segment(*prev_piece, patched_end, haplotype_pos);
+    }
+    return result;
+}
+
+} // namespace octopus
@@ -0,0 +1,76 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef reference_window_hpp
+#define reference_window_hpp
+
+#include <vector>
+#include <cstddef>
+
+#include <boost/optional.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "core/types/haplotype.hpp"
+
+namespace octopus {
+
+/*
+    ReferenceWindow lets the repeat based error models compute the penalties of a haplotype by
+    copying the penalties of the reference sequence of the haplotype's window, and only recomputing
+    them near the haplotype's alleles.
+
+    The repeat based models find tandem repeats with period at most maxPeriod. A split point is a
+    reference position that no such repeat crosses, so the repeats either side of it can be found
+    independently on just that side's sequence. The SNV model also smooths its priors over nearby
+    repeats of period 3 or less, so its split points must also be far enough from any such repeat that
+    the smoothing has no memory across them. Either way, penalties computed on the sequence between
+    two split points are exactly those computed on the whole sequence. Whether a position is a split
+    point only depends on the flankSize bases each side of it.
+ */
+class ReferenceWindow
+{
+public:
+    using NucleotideSequence = Haplotype::NucleotideSequence;
+
+    // A part of a haplotype sequence that either has the same penalties as the reference sequence
+    // at reference_begin, or must be computed on its own
+    struct Segment
+    {
+        std::size_t begin, end;
+        std::size_t reference_begin;
+        bool is_reference;
+    };
+
+    // What the penalties of a position depend on
+    enum class Context { repeats, smoothed_repeats };
+
+    static constexpr unsigned maxPeriod {5};
+    static constexpr unsigned flankSize {10};
+
+    ReferenceWindow() = delete;
+
+    ReferenceWindow(const Haplotype& reference);
+
+    ReferenceWindow(const ReferenceWindow&)            = default;
+    ReferenceWindow& operator=(const ReferenceWindow&) = default;
+    ReferenceWindow(ReferenceWindow&&)                 = default;
+    ReferenceWindow& operator=(ReferenceWindow&&)      = default;
+
+    ~ReferenceWindow() = default;
+
+    const GenomicRegion& region() const noexcept;
+    const NucleotideSequence& sequence() const noexcept;
+
+    // Splits the haplotype sequence into segments, or returns none if the haplotype is not in this window.
+    // Every non-reference segment starts and ends at a split point or an end of the haplotype.
+    boost::optional<std::vector<Segment>> split(const Haplotype& haplotype, Context context = Context::repeats) const;
+
+private:
+    GenomicRegion region_;
+    NucleotideSequence sequence_;
+    std::vector<bool> is_repeat_split_point_, is_smoothed_repeat_split_point_;
+};
+
+} // namespace octopus
+
+#endif
@@ -5,26 +5,61 @@
 
 #include <algorithm>
 #include <iterator>
+#include <tuple>
 
 #include "tandem/tandem.hpp"
 
+#include "reference_window.hpp"
+
 namespace octopus {
 
 namespace {
 
-auto extract_repeats(const Haplotype& haplotype)
+bool has_smaller_period(const Haplotype::NucleotideSequence& sequence, const std::size_t pos, const std::size_t end, const unsigned period) noexcept
+{
+    for (unsigned divisor {1}; divisor < period; ++divisor) {
+        if (period % divisor == 0
+            && std::equal(std::next(std::cbegin(sequence), pos + divisor), std::next(std::cbegin(sequence), end),
+                          std::next(std::cbegin(sequence), pos))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Finds every maximal run with smallest period at most ReferenceWindow::maxPeriod. Unlike the suffix array
+// based finder, what is found only depends on the bases of each run and the bases either side of it.
+auto extract_repeats(const Haplotype::NucleotideSequence& sequence)
 {
-    return tandem::extract_exact_tandem_repeats(haplotype.sequence(), 1, 5);
+    std::vector<tandem::Repeat> result {};
+    const auto num_bases = sequence.size();
+    for (unsigned period {1}; period <= ReferenceWindow::maxPeriod; ++period) {
+        for (std::size_t pos {0}; pos + period < num_bases; ) {
+            if (sequence[pos] != sequence[pos + period]) {
+                ++pos;
+                continue;
+            }
+            auto end = pos + period + 1;
+            while (end < num_bases && sequence[end] == sequence[end - period]) ++end;
+            if (end - pos >= 2 * period && !has_smaller_period(sequence, pos, end, period)) {
+                result.emplace_back(pos, end - pos, period);
+            }
+            pos = end - period + 1;
+        }
+    }
+    return result;
 }
 
+// Ties are broken by position so the penalties do not depend on the order repeats are found in
 void sort_by_length(std::vector<tandem::Repeat>& repeats)
 {
-    std::sort(std::begin(repeats), std::end(repeats), [] (const auto& lhs, const auto& rhs) { return lhs.length < rhs.length; });
+    std::sort(std::begin(repeats), std::end(repeats), [] (const auto& lhs, const auto& rhs) {
+        return std::tie(lhs.length, lhs.pos, lhs.period) < std::tie(rhs.length, rhs.pos, rhs.period); });
 }
 
-void set_motif(const Haplotype& haplotype, const tandem::Repeat& repeat, Haplotype::NucleotideSequence& result)
+void set_motif(const Haplotype::NucleotideSequence& sequence, const tandem::Repeat& repeat, Haplotype::NucleotideSequence& result)
 {
-    const auto motif_itr = std::next(std::cbegin(haplotype.sequence()), repeat.pos);
+    const auto motif_itr = std::next(std::cbegin(sequence), repeat.pos);
     result.assign(motif_itr, std::next(motif_itr, repeat.period));
 }
 
@@ -45,19 +80,19 @@ auto fill_n_if_less(FordwardIt first, std::size_t n, const Tp& value)
 void RepeatBasedIndelErrorModel::do_set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalities, PenaltyType& gap_extend_penalty) const
 {
     gap_open_penalities.assign(sequence_size(haplotype), get_default_open_penalty());
-    const auto repeats = extract_repeats(haplotype);
+    const auto repeats = extract_repeats(haplotype.sequence());
     if (!repeats.empty()) {
         tandem::Repeat max_repeat {};
         Sequence motif(3, 'N');
         for (const auto& repeat : repeats) {
-            set_motif(haplotype, repeat, motif);
+            set_motif(haplotype.sequence(), repeat, motif);
             const auto open_penalty = get_open_penalty(motif, repeat.length);
             fill_n_if_less(std::next(std::begin(gap_open_penalities), repeat.pos), repeat.length, open_penalty);
             if (repeat.length > max_repeat.length) {
                 max_repeat = repeat;
             }
         }
-        set_motif(haplotype, max_repeat, motif);
+        set_motif(haplotype.sequence(), max_repeat, motif);
         gap_extend_penalty = get_extension_penalty(motif, max_repeat.length);
     } else {
         gap_extend_penalty = get_default_extension_penalty();
@@ -66,14 +101,50 @@ void RepeatBasedIndelErrorModel::do_set_penalties(const Haplotype& haplotype, Pe
 
 void RepeatBasedIndelErrorModel::do_set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalities, PenaltyVector& gap_extend_penalties) const
 {
-    gap_open_penalities.assign(sequence_size(haplotype), get_default_open_penalty());
-    gap_extend_penalties.assign(sequence_size(haplotype), get_default_extension_penalty());
-    auto repeats = extract_repeats(haplotype);
+    set_sequence_penalties(haplotype.sequence(), gap_open_penalities, gap_extend_penalties);
+}
+
+void RepeatBasedIndelErrorModel::do_set_penalties(const Haplotype& haplotype, const ReferenceWindow& window,
+                                                  const PenaltyVector& reference_gap_open_penalties, const PenaltyVector& reference_gap_extend_penalties,
+                                                  PenaltyVector& gap_open_penalities, PenaltyVector& gap_extend_penalties) const
+{
+    const auto segments = window.split(haplotype);
+    if (!segments) {
+        set_sequence_penalties(haplotype.sequence(), gap_open_penalities, gap_extend_penalties);
+        return;
+    }
+    gap_open_penalities.resize(sequence_size(haplotype));
+    gap_extend_penalties.resize(sequence_size(haplotype));
+    PenaltyVector segment_open_penalities {}, segment_extend_penalties {};
+    Sequence segment_sequence {};
+    for (const auto& segment : *segments) {
+        const auto length = segment.end - segment.begin;
+        if (segment.is_reference) {
+            std::copy_n(std::next(std::cbegin(reference_gap_open_penalties), segment.reference_begin), length,
+                        std::next(std::begin(gap_open_penalities), segment.begin));
+            std::copy_n(std::next(std::cbegin(reference_gap_extend_penalties), segment.reference_begin), length,
+                        std::next(std::begin(gap_extend_penalties), segment.begin));
+        } else {
+            segment_sequence.assign(haplotype.sequence(), segment.begin, length);
+            set_sequence_penalties(segment_sequence, segment_open_penalities, segment_extend_penalties);
+            std::copy(std::cbegin(segment_open_penalities), std::cend(segment_open_penalities),
+                      std::next(std::begin(gap_open_penalities), segment.begin));
+            std::copy(std::cbegin(segment_extend_penalties), std::cend(segment_extend_penalties),
+                      std::next(std::begin(gap_extend_penalties), segment.begin));
+        }
+    }
+}
+
+void RepeatBasedIndelErrorModel::set_sequence_penalties(const Sequence& sequence, PenaltyVector& gap_open_penalities, PenaltyVector& gap_extend_penalties) const
+{
+    gap_open_penalities.assign(sequence.size(), get_default_open_penalty());
+    gap_extend_penalties.assign(sequence.size(), get_default_extension_penalty());
+    auto repeats = extract_repeats(sequence);
     if (!repeats.empty()) {
         sort_by_length(repeats);
         Sequence motif(3, 'N');
         for (const auto& repeat : repeats) {
-            set_motif(haplotype, repeat, motif);
+            set_motif(sequence, repeat, motif);
             const auto open_penalty = get_open_penalty(motif, repeat.length);
             fill_n_if_less(std::next(std::begin(gap_open_penalities), repeat.pos), repeat.length, open_penalty);
             const auto extension_penalty = get_extension_penalty(motif, repeat.length);
@@ -31,12 +31,17 @@ protected:
 private:
     void do_set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalties, PenaltyType& gap_extend_penalty) const override;
     void do_set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalties, PenaltyVector& gap_extend_penalties) const override;
+    void do_set_penalties(const Haplotype& haplotype, const ReferenceWindow& window,
+                          const PenaltyVector& reference_gap_open_penalties, const PenaltyVector& reference_gap_extend_penalties,
+                          PenaltyVector& gap_open_penalties, PenaltyVector& gap_extend_penalties) const override;
     
     virtual std::unique_ptr<IndelErrorModel> do_clone() const override = 0;
     virtual PenaltyType get_default_open_penalty() const noexcept = 0;
     virtual PenaltyType get_open_penalty(const Sequence& motif, unsigned length) const noexcept = 0;
     virtual PenaltyType get_default_extension_penalty() const noexcept = 0;
     virtual PenaltyType get_extension_penalty(const Sequence& motif, unsigned length) const noexcept = 0;
+    
+    void set_sequence_penalties(const Sequence& sequence, PenaltyVector& gap_open_penalties, PenaltyVector& gap_extend_penalties) const;
 };
 
 } // namespace octopus
@@ -11,6 +11,8 @@
 
 #include <core/types/haplotype.hpp>
 
+#include "reference_window.hpp"
+
 namespace octopus {
 
 constexpr decltype(BasicRepeatBasedSNVErrorModel::max_period_) BasicRepeatBasedSNVErrorModel::max_period_;
@@ -40,9 +42,9 @@ std::unique_ptr<SnvErrorModel> BasicRepeatBasedSNVErrorModel::do_clone() const
 
 namespace {
 
-auto extract_repeats(const Haplotype& haplotype, const unsigned max_period)
+auto extract_repeats(const std::string& sequence, const unsigned max_period)
 {
-    return tandem::extract_exact_tandem_repeats(haplotype.sequence(), 1, max_period);
+    return tandem::extract_exact_tandem_repeats(sequence, 1, max_period);
 }
 
 template <typename ForwardIt, typename OutputIt>
@@ -102,9 +104,8 @@ constexpr auto base_hash(const char b) noexcept
     }
 }
 
-auto repeat_hash(const Haplotype& haplotype, const tandem::Repeat& repeat) noexcept
+auto repeat_hash(const std::string& sequence, const tandem::Repeat& repeat) noexcept
 {
-    const auto& sequence = haplotype.sequence();
     const auto first = std::next(std::begin(sequence), repeat.pos);
     const auto last = std::next(first, repeat.period);
     return std::accumulate(first, last, std::int8_t {0}, [] (const auto& curr, const auto b) { return curr + base_hash(b); });
@@ -139,20 +140,85 @@ auto make_substitution_mask(const Haplotype& haplotype)
     return result;
 }
 
+void apply_substitution_mask(const Haplotype& haplotype, std::vector<std::int8_t>& priors, const std::int8_t max_quality)
+{
+    const auto substitution_mask = make_substitution_mask(haplotype);
+    std::transform(std::cbegin(priors), std::cend(priors), std::cbegin(substitution_mask),
+                   std::begin(priors), [=] (auto q, auto b) { return !b ? q : max_quality; });
+}
+
+void set_masks(const Haplotype& haplotype, std::vector<char>& forward_snv_mask, std::vector<char>& reverse_snv_mask)
+{
+    using std::cbegin; using std::cend; using std::crbegin; using std::crend;
+    using std::begin; using std::rbegin; using std::next;
+    const auto& sequence = haplotype.sequence();
+    forward_snv_mask.resize(sequence.size());
+    std::rotate_copy(crbegin(sequence), next(crbegin(sequence)), crend(sequence), rbegin(forward_snv_mask));
+    reverse_snv_mask.resize(sequence.size());
+    std::rotate_copy(cbegin(sequence), next(cbegin(sequence)), cend(sequence), begin(reverse_snv_mask));
+}
+
 } // namespace
 
 void BasicRepeatBasedSNVErrorModel::do_evaluate(const Haplotype& haplotype,
                                      MutationVector& forward_snv_mask, PenaltyVector& forward_snv_priors,
                                      MutationVector& reverse_snv_mask, PenaltyVector& reverse_snv_priors) const
+{
+    set_repeat_priors(haplotype.sequence(), forward_snv_priors, reverse_snv_priors);
+    const auto max_quality = penalty_caps_.front().front();
+    apply_substitution_mask(haplotype, forward_snv_priors, max_quality);
+    apply_substitution_mask(haplotype, reverse_snv_priors, max_quality);
+    set_masks(haplotype, forward_snv_mask, reverse_snv_mask);
+}
+
+void BasicRepeatBasedSNVErrorModel::do_evaluate(const Haplotype& haplotype, const ReferenceWindow& window,
+                                                const PenaltyVector& reference_forward_snv_priors, const PenaltyVector& reference_reverse_snv_priors,
+                                                MutationVector& forward_snv_mask, PenaltyVector& forward_snv_priors,
+                                                MutationVector& reverse_snv_mask, PenaltyVector& reverse_snv_priors) const
+{
+    const auto segments = window.split(haplotype, ReferenceWindow::Context::smoothed_repeats);
+    if (!segments) {
+        do_evaluate(haplotype, forward_snv_mask, forward_snv_priors, reverse_snv_mask, reverse_snv_priors);
+        return;
+    }
+    // The reference has no substitutions so its priors are just the repeat priors
+    forward_snv_priors.resize(sequence_size(haplotype));
+    reverse_snv_priors.resize(sequence_size(haplotype));
+    PenaltyVector segment_forward_priors {}, segment_reverse_priors {};
+    std::string segment_sequence {};
+    for (const auto& segment : *segments) {
+        const auto length = segment.end - segment.begin;
+        if (segment.is_reference) {
+            std::copy_n(std::next(std::cbegin(reference_forward_snv_priors), segment.reference_begin), length,
+                        std::next(std::begin(forward_snv_priors), segment.begin));
+            std::copy_n(std::next(std::cbegin(reference_reverse_snv_priors), segment.reference_begin), length,
+                        std::next(std::begin(reverse_snv_priors), segment.begin));
+        } else {
+            segment_sequence.assign(haplotype.sequence(), segment.begin, length);
+            set_repeat_priors(segment_sequence, segment_forward_priors, segment_reverse_priors);
+            std::copy(std::cbegin(segment_forward_priors), std::cend(segment_forward_priors),
+                      std::next(std::begin(forward_snv_priors), segment.begin));
+            std::copy(std::cbegin(segment_reverse_priors), std::cend(segment_reverse_priors),
+                      std::next(std::begin(reverse_snv_priors), segment.begin));
+        }
+    }
+    const auto max_quality = penalty_caps_.front().front();
+    apply_substitution_mask(haplotype, forward_snv_priors, max_quality);
+    apply_substitution_mask(haplotype, reverse_snv_priors, max_quality);
+    set_masks(haplotype, forward_snv_mask, reverse_snv_mask);
+}
+
+void BasicRepeatBasedSNVErrorModel::set_repeat_priors(const std::string& sequence,
+                                                      PenaltyVector& forward_snv_priors, PenaltyVector& reverse_snv_priors) const
 {
     using std::cbegin; using std::cend; using std::crbegin; using std::crend;
     using std::begin; using std::rbegin; using std::next;
-    const auto repeats = extract_repeats(haplotype, max_period_);
-    const auto num_bases = sequence_size(haplotype);
+    const auto repeats = extract_repeats(sequence, max_period_);
+    const auto num_bases = sequence.size();
     std::array<std::vector<std::int8_t>, max_period_> repeat_masks {};
     repeat_masks.fill(std::vector<std::int8_t>(num_bases, 0));
     for (const auto& repeat : repeats) {
-        std::fill_n(next(begin(repeat_masks[repeat.period - 1]), repeat.pos), repeat.length, repeat_hash(haplotype, repeat));
+        std::fill_n(next(begin(repeat_masks[repeat.period - 1]), repeat.pos), repeat.length, repeat_hash(sequence, repeat));
     }
     const auto max_quality = penalty_caps_.front().front();
     forward_snv_priors.assign(num_bases, max_quality);
@@ -166,16 +232,6 @@ void BasicRepeatBasedSNVErrorModel::do_evaluate(const Haplotype& haplotype,
         count_runs(crbegin(repeat_mask), crend(repeat_mask), rbegin(runs), max_gap);
         set_priors(runs, reverse_snv_priors, penalty_caps_[i]);
     }
-    const auto substitution_mask = make_substitution_mask(haplotype);
-    std::transform(std::cbegin(forward_snv_priors), std::cend(forward_snv_priors), std::cbegin(substitution_mask),
-                   std::begin(forward_snv_priors), [=] (auto q, auto b) { return !b ? q : max_quality; });
-    std::transform(std::cbegin(reverse_snv_priors), std::cend(reverse_snv_priors), std::cbegin(substitution_mask),
-                   std::begin(reverse_snv_priors), [=] (auto q, auto b) { return !b ? q : max_quality; });
-    const auto& sequence = haplotype.sequence();
-    forward_snv_mask.resize(num_bases);
-    std::rotate_copy(crbegin(sequence), next(crbegin(sequence)), crend(sequence), rbegin(forward_snv_mask));
-    reverse_snv_mask.resize(num_bases);
-    std::rotate_copy(cbegin(sequence), next(cbegin(sequence)), cend(sequence), begin(reverse_snv_mask));
 }
 
 } // namespace octopus
@@ -7,6 +7,7 @@
 #include <vector>
 #include <array>
 #include <cstdint>
+#include <string>
 
 #include "snv_error_model.hpp"
 
@@ -47,6 +48,12 @@ private:
     virtual void do_evaluate(const Haplotype& haplotype,
                              MutationVector& forward_snv_mask, PenaltyVector& forward_snv_priors,
                              MutationVector& reverse_snv_mask, PenaltyVector& reverse_snv_priors) const override ;
+    virtual void do_evaluate(const Haplotype& haplotype, const ReferenceWindow& window,
+                             const PenaltyVector& reference_forward_snv_priors, const PenaltyVector& reference_reverse_snv_priors,
+                             MutationVector& forward_snv_mask, PenaltyVector& forward_snv_priors,
+                             MutationVector& reverse_snv_mask, PenaltyVector& reverse_snv_priors) const override;
+    
+    void set_repeat_priors(const std::string& sequence, PenaltyVector& forward_snv_priors, PenaltyVector& reverse_snv_priors) const;
 };
 
 } // namespace octopus
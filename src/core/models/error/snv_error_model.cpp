@@ -17,4 +17,23 @@ void SnvErrorModel::evaluate(const Haplotype& haplotype,
     do_evaluate(haplotype, forward_snv_mask, forward_snv_priors, reverse_snv_mask, reverse_snv_priors);
 }
 
+void SnvErrorModel::evaluate(const Haplotype& haplotype, const ReferenceWindow& window,
+                             const PenaltyVector& reference_forward_snv_priors, const PenaltyVector& reference_reverse_snv_priors,
+                             MutationVector& forward_snv_mask, PenaltyVector& forward_snv_priors,
+                             MutationVector& reverse_snv_mask, PenaltyVector& reverse_snv_priors) const
+{
+    do_evaluate(haplotype, window, reference_forward_snv_priors, reference_reverse_snv_priors,
+                forward_snv_mask, forward_snv_priors, reverse_snv_mask, reverse_snv_priors);
+}
+
+// private methods
+
+void SnvErrorModel::do_evaluate(const Haplotype& haplotype, const ReferenceWindow& window,
+                                const PenaltyVector& reference_forward_snv_priors, const PenaltyVector& reference_reverse_snv_priors,
+                                MutationVector& forward_snv_mask, PenaltyVector& forward_snv_priors,
+                                MutationVector& reverse_snv_mask, PenaltyVector& reverse_snv_priors) const
+{
+    do_evaluate(haplotype, forward_snv_mask, forward_snv_priors, reverse_snv_mask, reverse_snv_priors);
+}
+
 } // namespace octopus
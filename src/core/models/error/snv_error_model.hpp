@@ -11,6 +11,7 @@
 namespace octopus {
 
 class Haplotype;
+class ReferenceWindow;
 
 class SnvErrorModel
 {
@@ -25,12 +26,21 @@ public:
     void evaluate(const Haplotype& haplotype,
                   MutationVector& forward_snv_mask, PenaltyVector& forward_snv_priors,
                   MutationVector& reverse_snv_mask, PenaltyVector& reverse_snv_priors) const;
+    // The haplotype's priors given those of the reference sequence of a window containing it
+    void evaluate(const Haplotype& haplotype, const ReferenceWindow& window,
+                  const PenaltyVector& reference_forward_snv_priors, const PenaltyVector& reference_reverse_snv_priors,
+                  MutationVector& forward_snv_mask, PenaltyVector& forward_snv_priors,
+                  MutationVector& reverse_snv_mask, PenaltyVector& reverse_snv_priors) const;
 
 private:
     virtual std::unique_ptr<SnvErrorModel> do_clone() const = 0;
     virtual void do_evaluate(const Haplotype& haplotype,
                              MutationVector& forward_snv_mask, PenaltyVector& forward_snv_priors,
                              MutationVector& reverse_snv_mask, PenaltyVector& reverse_snv_priors) const = 0;
+    virtual void do_evaluate(const Haplotype& haplotype, const ReferenceWindow& window,
+                             const PenaltyVector& reference_forward_snv_priors, const PenaltyVector& reference_reverse_snv_priors,
+                             MutationVector& forward_snv_mask, PenaltyVector& forward_snv_priors,
+                             MutationVector& reverse_snv_mask, PenaltyVector& reverse_snv_priors) const;
 };
 
 } // namespace octopus
@@ -13,6 +13,10 @@
 
 #include "utils/maths.hpp"
 
+#if defined(__SSE2__)
+#include "fmath.hpp"
+#endif // defined(__SSE2__)
+
 namespace octopus { namespace model {
 
 ConstantMixtureGenotypeLikelihoodModel::ConstantMixtureGenotypeLikelihoodModel(const HaplotypeLikelihoodArray& likelihoods)
@@ -61,19 +65,148 @@ static constexpr auto ln(const unsigned n)
     return lnLookup[n];
 }
 
+/*
+    Kernels for the sum over reads of the mixture log likelihoods of genotypes with at most three distinct
+    haplotypes. Each haplotype has a log weight (ln of its copy number). On SSE2 four reads are processed
+    per step: the maximum term is kept in double, and only the bounded correction ln(sum exp(x - max))
+    is computed in float with the fmath approximations, so the error per read is below 1e-6 whatever
+    the magnitude of the likelihoods. All reads are accumulated into one double reduction.
+ */
+
+#if defined(__SSE2__)
+
+struct Quad
+{
+    __m128d lo, hi;
+};
+
+inline Quad load(const double* values) noexcept { return {_mm_loadu_pd(values), _mm_loadu_pd(values + 2)}; }
+inline Quad load(const float* values) noexcept
+{
+    const auto x = _mm_loadu_ps(values);
+    return {_mm_cvtps_pd(x), _mm_cvtps_pd(_mm_movehl_ps(x, x))};
+}
+inline Quad broadcast(const double x) noexcept { return {_mm_set1_pd(x), _mm_set1_pd(x)}; }
+inline Quad add(const Quad& a, const Quad& b) noexcept { return {_mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi)}; }
+inline Quad sub(const Quad& a, const Quad& b) noexcept { return {_mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi)}; }
+inline Quad max(const Quad& a, const Quad& b) noexcept { return {_mm_max_pd(a.lo, b.lo), _mm_max_pd(a.hi, b.hi)}; }
+inline Quad min(const Quad& a, const Quad& b) noexcept { return {_mm_min_pd(a.lo, b.lo), _mm_min_pd(a.hi, b.hi)}; }
+inline __m128 narrow(const Quad& x) noexcept { return _mm_movelh_ps(_mm_cvtpd_ps(x.lo), _mm_cvtpd_ps(x.hi)); }
+inline Quad widen(const __m128 x) noexcept { return {_mm_cvtps_pd(x), _mm_cvtps_pd(_mm_movehl_ps(x, x))}; }
+inline double horizontal_sum(const Quad& x) noexcept
+{
+    const auto pair = _mm_add_pd(x.lo, x.hi);
+    return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+#endif // defined(__SSE2__)
+
+template <typename T>
+double sum_log_likelihoods(const T* likelihoods, const std::size_t n) noexcept
+{
+    double result {0};
+    std::size_t read_idx {0};
+#if defined(__SSE2__)
+    auto sum = broadcast(0);
+    for (; read_idx + 4 <= n; read_idx += 4) {
+        sum = add(sum, load(likelihoods + read_idx));
+    }
+    result = horizontal_sum(sum);
+#endif // defined(__SSE2__)
+    for (; read_idx < n; ++read_idx) result += likelihoods[read_idx];
+    return result;
+}
+
+// sum {read} ln(exp(a[read] + a_weight) + exp(b[read] + b_weight))
+template <typename T>
+double sum_log_sum_exp(const T* a, const double a_weight, const T* b, const double b_weight, const std::size_t n) noexcept
+{
+    double result {0};
+    std::size_t read_idx {0};
+#if defined(__SSE2__)
+    const auto a_weights = broadcast(a_weight), b_weights = broadcast(b_weight);
+    const auto ones = _mm_set1_ps(1.0f);
+    auto sum = broadcast(0);
+    for (; read_idx + 4 <= n; read_idx += 4) {
+        const auto x = add(load(a + read_idx), a_weights), y = add(load(b + read_idx), b_weights);
+        const auto m = max(x, y);
+        const auto correction = fmath::log_ps(_mm_add_ps(ones, fmath::exp_ps(narrow(sub(min(x, y), m)))));
+        sum = add(sum, add(m, widen(correction)));
+    }
+    result = horizontal_sum(sum);
+#endif // defined(__SSE2__)
+    for (; read_idx < n; ++read_idx) {
+        result += maths::log_sum_exp(a[read_idx] + a_weight, b[read_idx] + b_weight);
+    }
+    return result;
+}
+
+// sum {read} ln(exp(a[read] + a_weight) + exp(b[read] + b_weight) + exp(c[read] + c_weight))
+template <typename T>
+double sum_log_sum_exp(const T* a, const double a_weight, const T* b, const double b_weight,
+                       const T* c, const double c_weight, const std::size_t n) noexcept
+{
+    double result {0};
+    std::size_t read_idx {0};
+#if defined(__SSE2__)
+    const auto a_weights = broadcast(a_weight), b_weights = broadcast(b_weight), c_weights = broadcast(c_weight);
+    auto sum = broadcast(0);
+    for (; read_idx + 4 <= n; read_idx += 4) {
+        const auto x = add(load(a + read_idx), a_weights);
+        const auto y = add(load(b + read_idx), b_weights);
+        const auto z = add(load(c + read_idx), c_weights);
+        const auto m = max(max(x, y), z);
+        const auto exps = _mm_add_ps(_mm_add_ps(fmath::exp_ps(narrow(sub(x, m))), fmath::exp_ps(narrow(sub(y, m)))),
+                                     fmath::exp_ps(narrow(sub(z, m))));
+        sum = add(sum, add(m, widen(fmath::log_ps(exps))));
+    }
+    result = horizontal_sum(sum);
+#endif // defined(__SSE2__)
+    for (; read_idx < n; ++read_idx) {
+        result += maths::log_sum_exp(a[read_idx] + a_weight, b[read_idx] + b_weight, c[read_idx] + c_weight);
+    }
+    return result;
+}
+
+template <typename LikelihoodVector>
+auto sum_log_likelihoods(const LikelihoodVector& likelihoods) noexcept
+{
+    return sum_log_likelihoods(likelihoods.data(), likelihoods.size());
+}
+
+// ln p(reads | genotype) for a genotype with copies of haplotype a and b copies of haplotype b
+template <typename LikelihoodVector>
+double sum_mixture_log_likelihoods(const LikelihoodVector& a, const unsigned a_copies,
+                                   const LikelihoodVector& b, const unsigned b_copies) noexcept
+{
+    assert(a.size() == b.size());
+    const auto n = a.size();
+    return sum_log_sum_exp(a.data(), ln(a_copies), b.data(), ln(b_copies), n) - n * ln(a_copies + b_copies);
+}
+
+template <typename LikelihoodVector>
+double sum_mixture_log_likelihoods(const LikelihoodVector& a, const unsigned a_copies,
+                                   const LikelihoodVector& b, const unsigned b_copies,
+                                   const LikelihoodVector& c, const unsigned c_copies) noexcept
+{
+    assert(a.size() == b.size() && a.size() == c.size());
+    const auto n = a.size();
+    return sum_log_sum_exp(a.data(), ln(a_copies), b.data(), ln(b_copies), c.data(), ln(c_copies), n)
+           - n * ln(a_copies + b_copies + c_copies);
+}
+
 } // namespace
 
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
 ConstantMixtureGenotypeLikelihoodModel::evaluate(const Genotype<IndexedHaplotype<>>& genotype) const
 {
-    switch (genotype.ploidy()) {
-        case 0: return 0.0;
-        case 1: return evaluate_haploid(genotype);
-        case 2: return evaluate_diploid(genotype);
-        case 3: return evaluate_triploid(genotype);
-        case 4: return evaluate_tetraploid(genotype);
-        default: return evaluate_polyploid(genotype);
-    }
+    return evaluate_indexed(genotype);
+}
+
+ConstantMixtureGenotypeLikelihoodModel::LogProbability
+ConstantMixtureGenotypeLikelihoodModel::evaluate(const PackedGenotype& genotype) const
+{
+    return evaluate_indexed(genotype);
 }
 
 // private methods
@@ -81,8 +214,7 @@ ConstantMixtureGenotypeLikelihoodModel::evaluate(const Genotype<IndexedHaplotype
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
 ConstantMixtureGenotypeLikelihoodModel::evaluate_haploid(const Genotype<Haplotype>& genotype) const
 {
-    const auto& log_likelihoods = likelihoods_[genotype[0]];
-    return std::accumulate(std::cbegin(log_likelihoods), std::cend(log_likelihoods), LogProbability {0});
+    return sum_log_likelihoods(likelihoods_[genotype[0]]);
 }
 
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
@@ -90,48 +222,25 @@ ConstantMixtureGenotypeLikelihoodModel::evaluate_diploid(const Genotype<Haplotyp
 {
     const auto& log_likelihoods1 = likelihoods_[genotype[0]];
     if (is_homozygous(genotype)) {
-        return std::accumulate(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1), LogProbability {0});
+        return sum_log_likelihoods(log_likelihoods1);
     }
-    const auto& log_likelihoods2 = likelihoods_[genotype[1]];
-    return std::inner_product(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1),
-                              std::cbegin(log_likelihoods2), LogProbability {0}, std::plus<> {},
-                              [] (const auto a, const auto b) -> LogProbability {
-                                  return maths::log_sum_exp(a, b) - ln<decltype(a)>(2);
-                              });
+    return sum_mixture_log_likelihoods(log_likelihoods1, 1, likelihoods_[genotype[1]], 1);
 }
 
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
 ConstantMixtureGenotypeLikelihoodModel::evaluate_triploid(const Genotype<Haplotype>& genotype) const
 {
-    using std::cbegin; using std::cend;
     const auto& log_likelihoods1 = likelihoods_[genotype[0]];
     if (is_homozygous(genotype)) {
-        return std::accumulate(cbegin(log_likelihoods1), cend(log_likelihoods1), LogProbability {0});
+        return sum_log_likelihoods(log_likelihoods1);
     }
     if (zygosity(genotype) == 3) {
-        const auto& log_likelihoods2 = likelihoods_[genotype[1]];
-        const auto& log_likelihoods3 = likelihoods_[genotype[2]];
-        return maths::inner_product(cbegin(log_likelihoods1), cend(log_likelihoods1),
-                                    cbegin(log_likelihoods2), cbegin(log_likelihoods3),
-                                    LogProbability {0}, std::plus<> {},
-                                    [] (const auto a, const auto b, const auto c) -> LogProbability {
-                                        return maths::log_sum_exp(a, b, c) - ln<decltype(a)>(3);
-                                    });
+        return sum_mixture_log_likelihoods(log_likelihoods1, 1, likelihoods_[genotype[1]], 1, likelihoods_[genotype[2]], 1);
     }
     if (genotype[0] != genotype[1]) {
-        const auto& log_likelihoods2 = likelihoods_[genotype[1]];
-        return std::inner_product(cbegin(log_likelihoods1), cend(log_likelihoods1),
-                                  cbegin(log_likelihoods2), LogProbability {0}, std::plus<> {},
-                                  [] (const auto a, const auto b) -> LogProbability {
-                                      return maths::log_sum_exp(a, ln<decltype(a)>(2) + b) - ln<decltype(a)>(3);
-                                  });
+        return sum_mixture_log_likelihoods(log_likelihoods1, 1, likelihoods_[genotype[1]], 2);
     }
-    const auto& log_likelihoods3 = likelihoods_[genotype[2]];
-    return std::inner_product(cbegin(log_likelihoods1), cend(log_likelihoods1),
-                              cbegin(log_likelihoods3), LogProbability {0}, std::plus<> {},
-                              [] (const auto a, const auto b) -> LogProbability {
-                                  return maths::log_sum_exp(ln<decltype(a)>(2) + a, b) - ln<decltype(a)>(3);
-                              });
+    return sum_mixture_log_likelihoods(log_likelihoods1, 2, likelihoods_[genotype[2]], 1);
 }
 
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
@@ -160,135 +269,91 @@ ConstantMixtureGenotypeLikelihoodModel::evaluate_polyploid(const Genotype<Haplot
     return result;
 }
 
+template <typename IndexedGenotype>
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
-ConstantMixtureGenotypeLikelihoodModel::evaluate_haploid(const Genotype<IndexedHaplotype<>>& genotype) const
+ConstantMixtureGenotypeLikelihoodModel::evaluate_indexed(const IndexedGenotype& genotype) const
 {
-    const auto& log_likelihoods = likelihoods_[genotype[0]];
-    return std::accumulate(std::cbegin(log_likelihoods), std::cend(log_likelihoods), LogProbability {0});
+    switch (genotype.ploidy()) {
+        case 0: return 0.0;
+        case 1: return evaluate_indexed_haploid(genotype);
+        case 2: return evaluate_indexed_diploid(genotype);
+        case 3: return evaluate_indexed_triploid(genotype);
+        case 4: return evaluate_indexed_tetraploid(genotype);
+        default: return evaluate_indexed_polyploid(genotype);
+    }
+}
+
+template <typename IndexedGenotype>
+ConstantMixtureGenotypeLikelihoodModel::LogProbability
+ConstantMixtureGenotypeLikelihoodModel::evaluate_indexed_haploid(const IndexedGenotype& genotype) const
+{
+    return sum_log_likelihoods(likelihoods_[genotype[0]]);
 }
 
+template <typename IndexedGenotype>
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
-ConstantMixtureGenotypeLikelihoodModel::evaluate_diploid(const Genotype<IndexedHaplotype<>>& genotype) const
+ConstantMixtureGenotypeLikelihoodModel::evaluate_indexed_diploid(const IndexedGenotype& genotype) const
 {
     const auto& log_likelihoods1 = likelihoods_[genotype[0]];
     if (is_homozygous(genotype)) {
-        return std::accumulate(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1), LogProbability {0});
+        return sum_log_likelihoods(log_likelihoods1);
     } else {
-        constexpr static auto ln2 = ln<HaplotypeLikelihoodArray::LogProbability>(2);
-        (void) ln2; // To silence bad GCC unused-but-set-variable warning
-        const auto& log_likelihoods2 = likelihoods_[genotype[1]];
-        return std::inner_product(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1),
-                                  std::cbegin(log_likelihoods2), LogProbability {0}, std::plus<> {},
-                                  [] (const auto a, const auto b) -> LogProbability {
-                                      return maths::log_sum_exp(a, b) - ln2;
-                                  });
+        return sum_mixture_log_likelihoods(log_likelihoods1, 1, likelihoods_[genotype[1]], 1);
     }
 }
 
+template <typename IndexedGenotype>
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
-ConstantMixtureGenotypeLikelihoodModel::evaluate_triploid(const Genotype<IndexedHaplotype<>>& genotype) const
+ConstantMixtureGenotypeLikelihoodModel::evaluate_indexed_triploid(const IndexedGenotype& genotype) const
 {
-    constexpr static auto ln2 = ln<HaplotypeLikelihoodArray::LogProbability>(2);
-    constexpr static auto ln3 = ln<HaplotypeLikelihoodArray::LogProbability>(3);
-    (void) ln2; (void) ln3; // To silence bad GCC unused-but-set-variable warning
     if (genotype[0] == genotype[1]) {
         if (genotype[1] == genotype[2]) {
             // homozygous
-            return std::accumulate(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]), LogProbability {0});
+            return sum_log_likelihoods(likelihoods_[genotype[0]]);
         } else {
-            return std::inner_product(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]),
-                                      std::cbegin(likelihoods_[genotype[2]]),
-                                      LogProbability {0}, std::plus<> {},
-                                      [] (const auto a, const auto b) -> LogProbability {
-                                          return maths::log_sum_exp(ln2 + a, b) - ln3;
-                                      });
+            return sum_mixture_log_likelihoods(likelihoods_[genotype[0]], 2, likelihoods_[genotype[2]], 1);
         }
     } else if (genotype[1] == genotype[2]) {
-        return std::inner_product(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]),
-                                  std::cbegin(likelihoods_[genotype[1]]),
-                                  LogProbability {0}, std::plus<> {},
-                                  [] (const auto a, const auto b) -> LogProbability {
-                                      return maths::log_sum_exp(a, ln2 + b) - ln3;
-                                  });
+        return sum_mixture_log_likelihoods(likelihoods_[genotype[0]], 1, likelihoods_[genotype[1]], 2);
     } else {
         // zygosity = 3
-        return maths::inner_product(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]),
-                                    std::cbegin(likelihoods_[genotype[1]]), 
-                                    std::cbegin(likelihoods_[genotype[2]]),
-                                    LogProbability {0}, std::plus<> {},
-                                    [] (const auto a, const auto b, const auto c) -> LogProbability {
-                                        return maths::log_sum_exp(a, b, c) - ln3;
-                                    });
+        return sum_mixture_log_likelihoods(likelihoods_[genotype[0]], 1, likelihoods_[genotype[1]], 1, likelihoods_[genotype[2]], 1);
     }
 }
 
+template <typename IndexedGenotype>
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
-ConstantMixtureGenotypeLikelihoodModel::evaluate_tetraploid(const Genotype<IndexedHaplotype<>>& genotype) const
+ConstantMixtureGenotypeLikelihoodModel::evaluate_indexed_tetraploid(const IndexedGenotype& genotype) const
 {
-    constexpr static auto ln2 = ln<HaplotypeLikelihoodArray::LogProbability>(2);
-    constexpr static auto ln3 = ln<HaplotypeLikelihoodArray::LogProbability>(3);
     constexpr static auto ln4 = ln<HaplotypeLikelihoodArray::LogProbability>(4);
-    (void) ln2; (void) ln3; (void) ln4; // To silence bad GCC unused-but-set-variable warning
+    (void) ln4; // To silence bad GCC unused-but-set-variable warning
     if (genotype[0] == genotype[1]) {
         if (genotype[1] == genotype[2]) {
             if (genotype[2] == genotype[3]) {
                 // homozygous
-                return std::accumulate(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]), LogProbability {0});
+                return sum_log_likelihoods(likelihoods_[genotype[0]]);
             } else {
                 // zygosity = 2
-                return std::inner_product(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]),
-                                          std::cbegin(likelihoods_[genotype[3]]),
-                                          LogProbability {0}, std::plus<> {},
-                                          [] (const auto a, const auto b) -> LogProbability {
-                                              return maths::log_sum_exp(ln3 + a, b) - ln4;
-                                          });
+                return sum_mixture_log_likelihoods(likelihoods_[genotype[0]], 3, likelihoods_[genotype[3]], 1);
             }
         } else if (genotype[2] == genotype[3]) {
             // zygosity = 2
-            return std::inner_product(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]),
-                                      std::cbegin(likelihoods_[genotype[2]]),
-                                      LogProbability {0}, std::plus<> {},
-                                      [] (const auto a, const auto b) -> LogProbability {
-                                          return maths::log_sum_exp(a, b) - ln2;
-                                      });
+            return sum_mixture_log_likelihoods(likelihoods_[genotype[0]], 2, likelihoods_[genotype[2]], 2);
         } else {
             // zygosity = 3
-            return maths::inner_product(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]),
-                                        std::cbegin(likelihoods_[genotype[2]]), 
-                                        std::cbegin(likelihoods_[genotype[3]]),
-                                        LogProbability {0}, std::plus<> {},
-                                        [] (const auto a, const auto b, const auto c) -> LogProbability {
-                                            return maths::log_sum_exp(ln2 + a, b, c) - ln4;
-                                        });
+            return sum_mixture_log_likelihoods(likelihoods_[genotype[0]], 2, likelihoods_[genotype[2]], 1, likelihoods_[genotype[3]], 1);
         }
     } else if (genotype[1] == genotype[2]) {
         if (genotype[2] == genotype[3]) {
             // zygosity = 2
-            return std::inner_product(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]),
-                                      std::cbegin(likelihoods_[genotype[1]]),
-                                      LogProbability {0}, std::plus<> {},
-                                      [] (const auto a, const auto b) -> LogProbability {
-                                          return maths::log_sum_exp(a, ln3 + b) - ln4;
-                                      });
+            return sum_mixture_log_likelihoods(likelihoods_[genotype[0]], 1, likelihoods_[genotype[1]], 3);
         } else {
             // zygosity = 3
-            return maths::inner_product(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]),
-                                        std::cbegin(likelihoods_[genotype[1]]), 
-                                        std::cbegin(likelihoods_[genotype[3]]),
-                                        LogProbability {0}, std::plus<> {},
-                                        [] (const auto a, const auto b, const auto c) -> LogProbability {
-                                            return maths::log_sum_exp(a, ln2 + b, c) - ln4;
-                                        });
+            return sum_mixture_log_likelihoods(likelihoods_[genotype[0]], 1, likelihoods_[genotype[1]], 2, likelihoods_[genotype[3]], 1);
         }
     } else if (genotype[2] == genotype[3]) {
         // zygosity = 3
-        return maths::inner_product(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]),
-                                    std::cbegin(likelihoods_[genotype[1]]), 
-                                    std::cbegin(likelihoods_[genotype[2]]),
-                                    LogProbability {0}, std::plus<> {},
-                                    [] (const auto a, const auto b, const auto c) -> LogProbability {
-                                        return maths::log_sum_exp(a, b, ln2 + c) - ln4;
-                                    });
+        return sum_mixture_log_likelihoods(likelihoods_[genotype[0]], 1, likelihoods_[genotype[1]], 1, likelihoods_[genotype[2]], 2);
     } else {
         // zygosity = 4
         return maths::inner_product(std::cbegin(likelihoods_[genotype[0]]), std::cend(likelihoods_[genotype[0]]),
@@ -302,8 +367,9 @@ ConstantMixtureGenotypeLikelihoodModel::evaluate_tetraploid(const Genotype<Index
     }
 }
 
-ConstantMixtureGenotypeLikelihoodModel::LogProbability 
-ConstantMixtureGenotypeLikelihoodModel::evaluate_polyploid(const Genotype<IndexedHaplotype<>>& genotype) const
+template <typename IndexedGenotype>
+ConstantMixtureGenotypeLikelihoodModel::LogProbability
+ConstantMixtureGenotypeLikelihoodModel::evaluate_indexed_polyploid(const IndexedGenotype& genotype) const
 {
     assert(likelihoods_.is_primed());
     const auto ln_ploidy = std::log(genotype.ploidy());
@@ -9,6 +9,7 @@
 #include "core/types/haplotype.hpp"
 #include "core/types/indexed_haplotype.hpp"
 #include "core/types/genotype.hpp"
+#include "core/types/packed_genotype_block.hpp"
 #include "core/models/haplotype_likelihood_array.hpp"
 
 namespace octopus { namespace model {
@@ -33,6 +34,7 @@ public:
     
     LogProbability evaluate(const Genotype<Haplotype>& genotype) const;
     LogProbability evaluate(const Genotype<IndexedHaplotype<>>& genotype) const;
+    LogProbability evaluate(const PackedGenotype& genotype) const;
     
 private:
     const HaplotypeLikelihoodArray& likelihoods_;
@@ -44,11 +46,13 @@ private:
     LogProbability evaluate_diploid(const Genotype<Haplotype>& genotype) const;
     LogProbability evaluate_triploid(const Genotype<Haplotype>& genotype) const;
     LogProbability evaluate_polyploid(const Genotype<Haplotype>& genotype) const;
-    LogProbability evaluate_haploid(const Genotype<IndexedHaplotype<>>& genotype) const;
-    LogProbability evaluate_diploid(const Genotype<IndexedHaplotype<>>& genotype) const;
-    LogProbability evaluate_triploid(const Genotype<IndexedHaplotype<>>& genotype) const;
-    LogProbability evaluate_tetraploid(const Genotype<IndexedHaplotype<>>& genotype) const;
-    LogProbability evaluate_polyploid(const Genotype<IndexedHaplotype<>>& genotype) const;
+    // For Genotype<IndexedHaplotype<>> and PackedGenotype
+    template <typename IndexedGenotype> LogProbability evaluate_indexed(const IndexedGenotype& genotype) const;
+    template <typename IndexedGenotype> LogProbability evaluate_indexed_haploid(const IndexedGenotype& genotype) const;
+    template <typename IndexedGenotype> LogProbability evaluate_indexed_diploid(const IndexedGenotype& genotype) const;
+    template <typename IndexedGenotype> LogProbability evaluate_indexed_triploid(const IndexedGenotype& genotype) const;
+    template <typename IndexedGenotype> LogProbability evaluate_indexed_tetraploid(const IndexedGenotype& genotype) const;
+    template <typename IndexedGenotype> LogProbability evaluate_indexed_polyploid(const IndexedGenotype& genotype) const;
 };
 
 template <typename Container1, typename Container2>
@@ -61,6 +65,17 @@ evaluate(const Container1& genotypes, const ConstantMixtureGenotypeLikelihoodMod
     return result;
 }
 
+template <typename Container>
+Container&
+evaluate(const PackedGenotypeBlock& genotypes, const ConstantMixtureGenotypeLikelihoodModel& model, Container& result)
+{
+    result.resize(genotypes.size());
+    for (std::size_t g {0}; g < genotypes.size(); ++g) {
+        result[g] = model.evaluate(genotypes[g]);
+    }
+    return result;
+}
+
 template <typename Container>
 auto evaluate(const Container& genotypes, const ConstantMixtureGenotypeLikelihoodModel& model)
 {
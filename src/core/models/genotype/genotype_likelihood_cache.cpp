@@ -0,0 +1,57 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "genotype_likelihood_cache.hpp"
+
+#include <numeric>
+#include <iterator>
+
+namespace octopus { namespace model {
+
+GenotypeLikelihoodCache::GenotypeLikelihoodCache(const HaplotypeLikelihoodArray& haplotype_likelihoods)
+: likelihood_model_ {haplotype_likelihoods}
+, cache_ {}
+{}
+
+const HaplotypeLikelihoodArray& GenotypeLikelihoodCache::haplotype_likelihoods() const noexcept
+{
+    return likelihood_model_.cache();
+}
+
+GenotypeLikelihoodCache::LogProbability
+GenotypeLikelihoodCache::evaluate(const SampleName& sample, const Genotype<IndexedHaplotype<>>& genotype) const
+{
+    return evaluate(genotype, prime(sample));
+}
+
+std::size_t GenotypeLikelihoodCache::size() const noexcept
+{
+    return std::accumulate(std::cbegin(cache_), std::cend(cache_), std::size_t {0},
+                           [] (auto curr, const auto& p) noexcept { return curr + p.second.size(); });
+}
+
+void GenotypeLikelihoodCache::clear() noexcept
+{
+    cache_.clear();
+}
+
+// private methods
+
+GenotypeLikelihoodCache::SampleCache& GenotypeLikelihoodCache::prime(const SampleName& sample) const
+{
+    likelihood_model_.cache().prime(sample);
+    return cache_[sample];
+}
+
+GenotypeLikelihoodCache::LogProbability
+GenotypeLikelihoodCache::evaluate(const Genotype<IndexedHaplotype<>>& genotype, SampleCache& sample_cache) const
+{
+    const auto itr = sample_cache.find(genotype);
+    if (itr != std::cend(sample_cache)) return itr->second;
+    const auto result = likelihood_model_.evaluate(genotype);
+    sample_cache.emplace(genotype, result);
+    return result;
+}
+
+} // namespace model
+} // namespace octopus
@@ -0,0 +1,77 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef genotype_likelihood_cache_hpp
+#define genotype_likelihood_cache_hpp
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+
+#include "config/common.hpp"
+#include "core/types/indexed_haplotype.hpp"
+#include "core/types/genotype.hpp"
+#include "core/models/haplotype_likelihood_array.hpp"
+#include "constant_mixture_genotype_likelihood_model.hpp"
+
+namespace octopus { namespace model {
+
+/*
+    Memoises the constant mixture genotype log likelihoods ln p(reads of sample | genotype)
+    of one window, so models evaluated over the same HaplotypeLikelihoodArray (and the
+    same haplotype indices) share the likelihoods of genotypes they have in common.
+ 
+    Evaluation primes the HaplotypeLikelihoodArray, so the cache is not thread-safe.
+ */
+class GenotypeLikelihoodCache
+{
+public:
+    using LogProbability = ConstantMixtureGenotypeLikelihoodModel::LogProbability;
+    using LogProbabilityVector = std::vector<LogProbability>;
+    
+    GenotypeLikelihoodCache() = delete;
+    
+    GenotypeLikelihoodCache(const HaplotypeLikelihoodArray& haplotype_likelihoods);
+    
+    GenotypeLikelihoodCache(const GenotypeLikelihoodCache&)            = delete;
+    GenotypeLikelihoodCache& operator=(const GenotypeLikelihoodCache&) = delete;
+    GenotypeLikelihoodCache(GenotypeLikelihoodCache&&)                 = default;
+    GenotypeLikelihoodCache& operator=(GenotypeLikelihoodCache&&)      = delete;
+    
+    ~GenotypeLikelihoodCache() = default;
+    
+    const HaplotypeLikelihoodArray& haplotype_likelihoods() const noexcept;
+    
+    LogProbability evaluate(const SampleName& sample, const Genotype<IndexedHaplotype<>>& genotype) const;
+    template <typename Container>
+    LogProbabilityVector evaluate(const SampleName& sample, const Container& genotypes) const;
+    
+    std::size_t size() const noexcept;
+    void clear() noexcept;
+    
+private:
+    using SampleCache = std::unordered_map<Genotype<IndexedHaplotype<>>, LogProbability>;
+    
+    ConstantMixtureGenotypeLikelihoodModel likelihood_model_;
+    mutable std::unordered_map<SampleName, SampleCache> cache_;
+    
+    SampleCache& prime(const SampleName& sample) const;
+    LogProbability evaluate(const Genotype<IndexedHaplotype<>>& genotype, SampleCache& sample_cache) const;
+};
+
+template <typename Container>
+GenotypeLikelihoodCache::LogProbabilityVector
+GenotypeLikelihoodCache::evaluate(const SampleName& sample, const Container& genotypes) const
+{
+    auto& sample_cache = prime(sample);
+    LogProbabilityVector result(genotypes.size());
+    std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(result),
+                   [&] (const auto& genotype) { return this->evaluate(genotype, sample_cache); });
+    return result;
+}
+
+} // namespace model
+} // namespace octopus
+
+#endif
@@ -3,6 +3,11 @@
 
 #include "independent_population_model.hpp"
 
+#include <algorithm>
+#include <iterator>
+#include <future>
+#include <utility>
+
 namespace octopus { namespace model {
 
 IndependentPopulationModel::IndependentPopulationModel(const GenotypePriorModel& genotype_prior_model,
@@ -11,13 +16,100 @@ IndependentPopulationModel::IndependentPopulationModel(const GenotypePriorModel&
 : individual_model_ {genotype_prior_model, debug_log, trace_log}
 {}
 
+namespace {
+
+bool use_workers(const IndependentPopulationModel::SampleVector& samples,
+                 const IndependentPopulationModel::OptionalThreadPool& workers) noexcept
+{
+    return workers && samples.size() > 1 && workers->n_idle() > 0;
+}
+
+// The genotype prior model is not thread-safe, but as priors are the same for all samples (of the
+// same ploidy) they are computed up front. Each sample job then evaluates a primed copy of its own
+// likelihoods. Results are in sample order.
+template <typename SampleEvaluator>
+auto evaluate_concurrently(const IndependentPopulationModel::SampleVector& samples,
+                           const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                           SampleEvaluator evaluate_sample,
+                           ThreadPool& workers)
+{
+    using SampleResult = decltype(evaluate_sample(std::size_t {}, haplotype_likelihoods));
+    std::vector<std::future<SampleResult>> futures {};
+    futures.reserve(samples.size() - 1);
+    for (std::size_t s {0}; s < samples.size() - 1; ++s) {
+        futures.push_back(workers.try_push([&, s] () {
+            const auto sample_likelihoods = haplotype_likelihoods.merge_samples({samples[s]}, samples[s]);
+            return evaluate_sample(s, sample_likelihoods);
+        }));
+    }
+    // run last sample in calling thread
+    haplotype_likelihoods.prime(samples.back());
+    auto last_result = evaluate_sample(samples.size() - 1, haplotype_likelihoods);
+    std::vector<SampleResult> result {};
+    result.reserve(samples.size());
+    for (auto& f : futures) {
+        workers.wait(f);
+        result.push_back(f.get());
+    }
+    result.push_back(std::move(last_result));
+    return result;
+}
+
+auto evaluate_concurrently(const IndividualModel& model,
+                           const IndependentPopulationModel::SampleVector& samples,
+                           const IndependentPopulationModel::GenotypeVector& genotypes,
+                           const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                           ThreadPool& workers)
+{
+    const auto genotype_log_priors = octopus::evaluate(genotypes, model.prior_model());
+    return evaluate_concurrently(samples, haplotype_likelihoods,
+                                 [&] (std::size_t, const HaplotypeLikelihoodArray& sample_likelihoods) {
+                                     return model.evaluate(genotypes, genotype_log_priors, sample_likelihoods);
+                                 }, workers);
+}
+
+IndependentPopulationModel::Latents::GenotypeProbabilityVector
+expand_posteriors(const IndividualModel::InferredLatents& sample_results,
+                  const IndependentPopulationModel::GenotypeVector& genotypes,
+                  const unsigned sample_ploidy)
+{
+    IndependentPopulationModel::Latents::GenotypeProbabilityVector result(genotypes.size());
+    for (std::size_t genotype_idx {0}, sample_genotype_idx {0}; genotype_idx < genotypes.size(); ++genotype_idx) {
+        if (genotypes[genotype_idx].ploidy() == sample_ploidy) {
+            result[genotype_idx] = sample_results.posteriors.genotype_probabilities[sample_genotype_idx++];
+        }
+    }
+    return result;
+}
+
+IndependentPopulationModel::Latents::GenotypeProbabilityVector
+make_ploidy_zero_posteriors(const IndependentPopulationModel::GenotypeVector& genotypes)
+{
+    IndependentPopulationModel::Latents::GenotypeProbabilityVector result(genotypes.size());
+    const static auto is_ploidy_zero = [] (const auto& g) { return g.ploidy() == 0; };
+    const auto genotype_itr = std::find_if(std::cbegin(genotypes), std::cend(genotypes), is_ploidy_zero);
+    const auto genotype_idx = static_cast<std::size_t>(std::distance(std::cbegin(genotypes), genotype_itr));
+    result[genotype_idx] = 1;
+    return result;
+}
+
+} // namespace
+
 IndependentPopulationModel::InferredLatents
 IndependentPopulationModel::evaluate(const SampleVector& samples,
                                      const GenotypeVector& genotypes,
-                                     const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                                     const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                     OptionalThreadPool workers) const
 {
     InferredLatents result {};
     result.posteriors.genotype_probabilities.reserve(samples.size());
+    if (use_workers(samples, workers)) {
+        for (auto& sample_results : evaluate_concurrently(individual_model_, samples, genotypes, haplotype_likelihoods, *workers)) {
+            result.posteriors.genotype_probabilities.push_back(std::move(sample_results.posteriors.genotype_probabilities));
+            result.log_evidence += sample_results.log_evidence;
+        }
+        return result;
+    }
     for (const auto& sample : samples) {
         haplotype_likelihoods.prime(sample);
         auto sample_results = individual_model_.evaluate(genotypes, haplotype_likelihoods);
@@ -31,7 +123,8 @@ IndependentPopulationModel::InferredLatents
 IndependentPopulationModel::evaluate(const SampleVector& samples,
                                      const std::vector<unsigned>& sample_ploidies,
                                      const GenotypeVector& genotypes,
-                                     const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                                     const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                     OptionalThreadPool workers) const
 {
     const auto max_ploidy = *std::max_element(std::cbegin(sample_ploidies), std::cend(sample_ploidies));
     std::vector<GenotypeVector> genotypes_by_ploidy(max_ploidy + 1);
@@ -40,26 +133,42 @@ IndependentPopulationModel::evaluate(const SampleVector& samples,
         if (genotype.ploidy() <= max_ploidy) genotypes_by_ploidy[genotype.ploidy()].push_back(genotype);
     }
     InferredLatents result {};
+    result.posteriors.genotype_probabilities.reserve(samples.size());
+    if (use_workers(samples, workers)) {
+        std::vector<IndividualModel::Latents::ProbabilityVector> genotype_log_priors_by_ploidy(max_ploidy + 1);
+        for (const auto ploidy : sample_ploidies) {
+            if (ploidy > 0 && genotype_log_priors_by_ploidy[ploidy].empty()) {
+                genotype_log_priors_by_ploidy[ploidy] = octopus::evaluate(genotypes_by_ploidy[ploidy], individual_model_.prior_model());
+            }
+        }
+        const auto evaluate_sample = [&] (const std::size_t s, const HaplotypeLikelihoodArray& sample_likelihoods) -> boost::optional<IndividualModel::InferredLatents> {
+            const auto sample_ploidy = sample_ploidies[s];
+            if (sample_ploidy == 0) return boost::none;
+            return individual_model_.evaluate(genotypes_by_ploidy[sample_ploidy], genotype_log_priors_by_ploidy[sample_ploidy], sample_likelihoods);
+        };
+        auto sample_results = evaluate_concurrently(samples, haplotype_likelihoods, evaluate_sample, *workers);
+        for (std::size_t s {0}; s < samples.size(); ++s) {
+            if (sample_results[s]) {
+                result.posteriors.genotype_probabilities.push_back(expand_posteriors(*sample_results[s], genotypes, sample_ploidies[s]));
+                result.log_evidence += sample_results[s]->log_evidence;
+            } else {
+                assert(genotypes_by_ploidy[0].size() == 1);
+                result.posteriors.genotype_probabilities.push_back(make_ploidy_zero_posteriors(genotypes));
+            }
+        }
+        return result;
+    }
     for (std::size_t s {0}; s < samples.size(); ++s) {
         haplotype_likelihoods.prime(samples[s]);
         const auto sample_ploidy = sample_ploidies[s];
-        Latents::GenotypeProbabilityVector genotype_posteriors(genotypes.size());
         if (sample_ploidy > 0) {
             auto sample_results = individual_model_.evaluate(genotypes_by_ploidy[sample_ploidy], haplotype_likelihoods);
-            for (std::size_t genotype_idx {0}, sample_genotype_idx {0}; genotype_idx < genotypes.size(); ++genotype_idx) {
-                if (genotypes[genotype_idx].ploidy() == sample_ploidy) {
-                    genotype_posteriors[genotype_idx] = sample_results.posteriors.genotype_probabilities[sample_genotype_idx++];
-                }
-            }
+            result.posteriors.genotype_probabilities.push_back(expand_posteriors(sample_results, genotypes, sample_ploidy));
             result.log_evidence += sample_results.log_evidence;
         } else {
             assert(genotypes_by_ploidy[0].size() == 1);
-            const static auto is_ploidy_zero = [] (const auto& g) { return g.ploidy() == 0; };
-            const auto genotype_itr = std::find_if(std::cbegin(genotypes), std::cend(genotypes), is_ploidy_zero);
-            const auto genotype_idx = static_cast<std::size_t>(std::distance(std::cbegin(genotypes), genotype_itr));
-            genotype_posteriors[genotype_idx] = 1;
+            result.posteriors.genotype_probabilities.push_back(make_ploidy_zero_posteriors(genotypes));
         }
-        result.posteriors.genotype_probabilities.push_back(std::move(genotype_posteriors));
     }
     return result;
 }
@@ -19,6 +19,7 @@
 #include "containers/probability_matrix.hpp"
 #include "containers/mappable_block.hpp"
 #include "logging/logging.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace octopus { namespace model {
 
@@ -28,6 +29,7 @@ public:
     using SampleVector            = std::vector<SampleName>;
     using GenotypeVector          = MappableBlock<Genotype<IndexedHaplotype<>>>;
     using GenotypeVectorReference = std::reference_wrapper<const GenotypeVector>;
+    using OptionalThreadPool      = boost::optional<ThreadPool&>;
     
     struct Latents
     {
@@ -54,18 +56,20 @@ public:
     
     ~IndependentPopulationModel() = default;
     
-    // All samples have same ploidy
+    // All samples have same ploidy. Samples are evaluated concurrently if there are idle workers.
     InferredLatents
     evaluate(const SampleVector& samples,
              const GenotypeVector& genotypes,
-             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+             const HaplotypeLikelihoodArray& haplotype_likelihoods,
+             OptionalThreadPool workers = boost::none) const;
     
-    // Samples have different ploidy
+    // Samples have different ploidy. Samples are evaluated concurrently if there are idle workers.
     InferredLatents
     evaluate(const SampleVector& samples,
              const std::vector<unsigned>& sample_ploidies,
              const GenotypeVector& genotypes,
-             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+             const HaplotypeLikelihoodArray& haplotype_likelihoods,
+             OptionalThreadPool workers = boost::none) const;
 
 private:
     IndividualModel individual_model_;
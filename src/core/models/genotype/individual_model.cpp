@@ -5,6 +5,7 @@
 
 #include <utility>
 #include <algorithm>
+#include <functional>
 #include <cmath>
 #include <cassert>
 #include <iostream>
@@ -76,9 +77,36 @@ IndividualModel::evaluate(const MappableBlock<Genotype<IndexedHaplotype<>>>& gen
     result.posteriors.genotype_log_probabilities = octopus::model::evaluate(genotypes, likelihood_model);
     debug::log_genotype_likelihoods(debug_log_, trace_log_, genotypes, result.posteriors.genotype_log_probabilities);
     octopus::evaluate(genotypes, genotype_prior_model_, result.posteriors.genotype_log_probabilities, false, true);
-    result.log_evidence = maths::normalise_logs(result.posteriors.genotype_log_probabilities);
+    result.log_evidence = maths::fast_normalise_logs(result.posteriors.genotype_log_probabilities);
     result.posteriors.genotype_probabilities = result.posteriors.genotype_log_probabilities;
-    maths::exp_each(result.posteriors.genotype_probabilities);
+    maths::fast_exp_each(result.posteriors.genotype_probabilities);
+    return result;
+}
+
+IndividualModel::InferredLatents
+IndividualModel::evaluate(const MappableBlock<Genotype<IndexedHaplotype<>>>& genotypes,
+                          const Latents::ProbabilityVector& genotype_log_priors,
+                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    assert(!genotypes.empty());
+    assert(genotype_log_priors.size() == genotypes.size());
+    ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
+    return evaluate(genotype_log_priors, octopus::model::evaluate(genotypes, likelihood_model));
+}
+
+IndividualModel::InferredLatents
+IndividualModel::evaluate(const Latents::ProbabilityVector& genotype_log_priors,
+                          Latents::ProbabilityVector genotype_log_likelihoods) const
+{
+    assert(genotype_log_priors.size() == genotype_log_likelihoods.size());
+    InferredLatents result {};
+    result.posteriors.genotype_log_probabilities = std::move(genotype_log_likelihoods);
+    std::transform(std::cbegin(genotype_log_priors), std::cend(genotype_log_priors),
+                   std::cbegin(result.posteriors.genotype_log_probabilities),
+                   std::begin(result.posteriors.genotype_log_probabilities), std::plus<> {});
+    result.log_evidence = maths::fast_normalise_logs(result.posteriors.genotype_log_probabilities);
+    result.posteriors.genotype_probabilities = result.posteriors.genotype_log_probabilities;
+    maths::fast_exp_each(result.posteriors.genotype_probabilities);
     return result;
 }
 
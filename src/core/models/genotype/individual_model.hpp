@@ -57,6 +57,18 @@ public:
     evaluate(const MappableBlock<Genotype<IndexedHaplotype<>>>& genotypes,
              const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     
+    // Uses precomputed genotype priors rather than the prior model, and does not log, so is
+    // safe to call concurrently with distinct haplotype_likelihoods.
+    InferredLatents
+    evaluate(const MappableBlock<Genotype<IndexedHaplotype<>>>& genotypes,
+             const Latents::ProbabilityVector& genotype_log_priors,
+             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    
+    // As above, but with precomputed genotype log likelihoods
+    InferredLatents
+    evaluate(const Latents::ProbabilityVector& genotype_log_priors,
+             Latents::ProbabilityVector genotype_log_likelihoods) const;
+    
 private:
     const GenotypePriorModel& genotype_prior_model_;
     const MappableBlock<Haplotype>* haplotypes_;
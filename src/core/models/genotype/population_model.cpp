@@ -10,6 +10,7 @@
 #include <limits>
 #include <cassert>
 #include <exception>
+#include <future>
 
 #include "utils/maths.hpp"
 #include "utils/select_top_k.hpp"
@@ -128,45 +129,105 @@ HardyWeinbergModel make_hardy_weinberg_model(const ModelConstants& constants)
     return HardyWeinbergModel {std::move(frequencies)};
 }
 
-GenotypeLogLikelihoodMatrix
-compute_genotype_log_likelihoods(const std::vector<SampleName>& samples,
-                                 const PopulationModel::GenotypeVector& genotypes,
-                                 const HaplotypeLikelihoodArray& haplotype_likelihoods)
+HardyWeinbergModel make_hardy_weinberg_model(const ModelConstants& constants,
+                                             const PopulationModel::HaplotypeFrequencyVector& initial_frequencies)
 {
-    assert(!genotypes.empty());
-    ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
-    GenotypeLogLikelihoodMatrix result {};
-    result.reserve(samples.size());
-    std::transform(std::cbegin(samples), std::cend(samples), std::back_inserter(result), [&] (const auto& sample) {
-        GenotypeLogLikelihoodVector likelihoods(genotypes.size());
-        haplotype_likelihoods.prime(sample);
-        std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(likelihoods),
-                       [&] (const auto& genotype) { return likelihood_model.evaluate(genotype); });
-        return likelihoods;
-    });
+    if (initial_frequencies.size() == constants.num_haplotypes) {
+        return HardyWeinbergModel {initial_frequencies};
+    } else {
+        return make_hardy_weinberg_model(constants);
+    }
+}
+
+bool use_workers(const std::size_t num_samples, const PopulationModel::OptionalThreadPool& workers) noexcept
+{
+    return workers && num_samples > 1 && workers->n_idle() > 0;
+}
+
+// Calls f(first_sample_idx, last_sample_idx) for contiguous chunks of samples, one chunk per worker
+// with the last chunk run in the calling thread
+template <typename BinaryFunction>
+void for_each_sample_chunk(const std::size_t num_samples, PopulationModel::OptionalThreadPool workers, BinaryFunction&& f)
+{
+    if (!use_workers(num_samples, workers)) {
+        f(std::size_t {0}, num_samples);
+        return;
+    }
+    const auto num_chunks = std::min(num_samples, workers->size() + 1);
+    const auto chunk_size = (num_samples + num_chunks - 1) / num_chunks;
+    std::vector<std::future<void>> futures {};
+    futures.reserve(num_chunks - 1);
+    std::size_t chunk_begin {0};
+    for (; chunk_begin + chunk_size < num_samples; chunk_begin += chunk_size) {
+        futures.push_back(workers->try_push([&f, chunk_begin, chunk_size] () { f(chunk_begin, chunk_begin + chunk_size); }));
+    }
+    // Every chunk must finish before returning, as the tasks reference this frame
+    std::exception_ptr error {};
+    try {
+        f(chunk_begin, num_samples);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    for (auto& future : futures) {
+        workers->wait(future);
+        try {
+            future.get();
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+GenotypeLogLikelihoodVector
+compute_sample_genotype_log_likelihoods(const PopulationModel::GenotypeVector& genotypes,
+                                        const boost::optional<PackedGenotypeBlock>& packed_genotypes,
+                                        const HaplotypeLikelihoodArray& primed_haplotype_likelihoods,
+                                        const std::vector<bool>* mask = nullptr)
+{
+    ConstantMixtureGenotypeLikelihoodModel likelihood_model {primed_haplotype_likelihoods};
+    GenotypeLogLikelihoodVector result(genotypes.size());
+    if (!mask && packed_genotypes) {
+        evaluate(*packed_genotypes, likelihood_model, result);
+        return result;
+    }
+    for (std::size_t g {0}; g < genotypes.size(); ++g) {
+        if (mask && !(*mask)[g]) {
+            result[g] = std::numeric_limits<LogProbability>::lowest();
+        } else if (packed_genotypes) {
+            result[g] = likelihood_model.evaluate((*packed_genotypes)[g]);
+        } else {
+            result[g] = likelihood_model.evaluate(genotypes[g]);
+        }
+    }
     return result;
 }
 
+// Each worker evaluates a primed copy of its samples' likelihoods, as priming is not thread-safe
 GenotypeLogLikelihoodMatrix
 compute_genotype_log_likelihoods(const std::vector<SampleName>& samples,
                                  const PopulationModel::GenotypeVector& genotypes,
                                  const HaplotypeLikelihoodArray& haplotype_likelihoods,
-                                 const std::vector<std::vector<bool>>& sample_genotype_masks)
+                                 const std::vector<std::vector<bool>>* sample_genotype_masks,
+                                 PopulationModel::OptionalThreadPool workers)
 {
     assert(!genotypes.empty());
-    ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
-    GenotypeLogLikelihoodMatrix result {};
-    result.reserve(samples.size());
-    std::transform(std::cbegin(samples), std::cend(samples), std::cbegin(sample_genotype_masks),
-                   std::back_inserter(result), [&] (const auto& sample, const auto& mask) {
-        GenotypeLogLikelihoodVector likelihoods(genotypes.size());
-        haplotype_likelihoods.prime(sample);
-        std::transform(std::cbegin(genotypes), std::cend(genotypes), std::cbegin(mask), std::begin(likelihoods),
-                       [&] (const auto& genotype, bool ok) {
-                           return ok ? likelihood_model.evaluate(genotype) : std::numeric_limits<LogProbability>::lowest();
-                       });
-        return likelihoods;
-    });
+    const auto packed_genotypes = pack(genotypes); // evaluated for every sample
+    GenotypeLogLikelihoodMatrix result(samples.size());
+    const auto get_mask = [&] (const std::size_t s) { return sample_genotype_masks ? &(*sample_genotype_masks)[s] : nullptr; };
+    if (use_workers(samples.size(), workers)) {
+        for_each_sample_chunk(samples.size(), workers, [&] (const std::size_t first, const std::size_t last) {
+            for (std::size_t s {first}; s < last; ++s) {
+                const auto sample_likelihoods = haplotype_likelihoods.merge_samples({samples[s]}, samples[s]);
+                result[s] = compute_sample_genotype_log_likelihoods(genotypes, packed_genotypes, sample_likelihoods, get_mask(s));
+            }
+        });
+    } else {
+        for (std::size_t s {0}; s < samples.size(); ++s) {
+            haplotype_likelihoods.prime(samples[s]);
+            result[s] = compute_sample_genotype_log_likelihoods(genotypes, packed_genotypes, haplotype_likelihoods, get_mask(s));
+        }
+    }
     return result;
 }
 
@@ -202,7 +263,7 @@ init_genotype_posteriors(const GenotypeLogMarginalVector& genotype_log_marginals
                        [] (const auto& genotype_log_marginal, const auto genotype_log_likilhood) {
                            return genotype_log_marginal.log_probability + genotype_log_likilhood;
                        });
-        maths::normalise_exp(posteriors);
+        maths::fast_normalise_exp(posteriors);
         result.emplace_back(std::move(posteriors));
     }
     return result;
@@ -210,17 +271,20 @@ init_genotype_posteriors(const GenotypeLogMarginalVector& genotype_log_marginals
 
 void update_genotype_posteriors(GenotypeMarginalPosteriorMatrix& current_genotype_posteriors,
                                 const GenotypeLogMarginalVector& genotype_log_marginals,
-                                const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods)
-{
-    auto likelihood_itr = std::cbegin(genotype_log_likilhoods);
-    for (auto& sample_genotype_posteriors : current_genotype_posteriors) {
-        std::transform(std::cbegin(genotype_log_marginals), std::cend(genotype_log_marginals),
-                       std::cbegin(*likelihood_itr++), std::begin(sample_genotype_posteriors),
-                       [] (const auto& log_marginal, const auto& log_likeilhood) {
-                           return log_marginal.log_probability + log_likeilhood;
-                       });
-        maths::normalise_exp(sample_genotype_posteriors);
-    }
+                                const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods,
+                                PopulationModel::OptionalThreadPool workers = boost::none)
+{
+    for_each_sample_chunk(current_genotype_posteriors.size(), workers, [&] (const std::size_t first, const std::size_t last) {
+        for (std::size_t s {first}; s < last; ++s) {
+            auto& sample_genotype_posteriors = current_genotype_posteriors[s];
+            std::transform(std::cbegin(genotype_log_marginals), std::cend(genotype_log_marginals),
+                           std::cbegin(genotype_log_likilhoods[s]), std::begin(sample_genotype_posteriors),
+                           [] (const auto& log_marginal, const auto& log_likeilhood) {
+                               return log_marginal.log_probability + log_likeilhood;
+                           });
+            maths::fast_normalise_exp(sample_genotype_posteriors);
+        }
+    });
 }
 
 auto collapse_genotype_posteriors(const GenotypeMarginalPosteriorMatrix& genotype_posteriors)
@@ -262,7 +326,8 @@ double update_haplotype_frequencies(HardyWeinbergModel& hw_model,
 double do_em_iteration(GenotypeMarginalPosteriorMatrix& genotype_posteriors,
                        HardyWeinbergModel& hw_model,
                        GenotypeLogMarginalVector& genotype_log_marginals,
-                       const ModelConstants& constants)
+                       const ModelConstants& constants,
+                       PopulationModel::OptionalThreadPool workers)
 {
     const auto max_change = update_haplotype_frequencies(hw_model,
                                                          genotype_posteriors,
@@ -270,52 +335,100 @@ double do_em_iteration(GenotypeMarginalPosteriorMatrix& genotype_posteriors,
                                                          constants.num_haplotypes,
                                                          constants.frequency_update_norm);
     update_genotype_log_marginals(genotype_log_marginals, hw_model);
-    update_genotype_posteriors(genotype_posteriors, genotype_log_marginals, constants.genotype_log_likilhoods);
+    update_genotype_posteriors(genotype_posteriors, genotype_log_marginals, constants.genotype_log_likilhoods, workers);
     return max_change;
 }
 
-void run_em(GenotypeMarginalPosteriorMatrix& genotype_posteriors,
-            HardyWeinbergModel& hw_model,
-            GenotypeLogMarginalVector& genotype_log_marginals,
-            const ModelConstants& constants,
-            const EMOptions options,
-            boost::optional<logging::TraceLogger> trace_log = boost::none)
+// Returns the number of iterations needed to converge, or none if EM did not converge
+boost::optional<unsigned> run_em(GenotypeMarginalPosteriorMatrix& genotype_posteriors,
+                HardyWeinbergModel& hw_model,
+                GenotypeLogMarginalVector& genotype_log_marginals,
+                const ModelConstants& constants,
+                const EMOptions options,
+                PopulationModel::OptionalThreadPool workers = boost::none)
 {
     for (unsigned n {1}; n <= options.max_iterations; ++n) {
-        const auto max_change = do_em_iteration(genotype_posteriors, hw_model, genotype_log_marginals, constants);
-        if (max_change <= options.epsilon) break;
+        const auto max_change = do_em_iteration(genotype_posteriors, hw_model, genotype_log_marginals, constants, workers);
+        if (max_change <= options.epsilon) return n;
     }
+    return boost::none;
 }
 
 auto compute_approx_genotype_marginal_posteriors(const PopulationModel::GenotypeVector& genotypes,
                                                  const GenotypeLogLikelihoodMatrix& genotype_likelihoods,
                                                  const ModelConstants& constants,
-                                                 const EMOptions options)
+                                                 const EMOptions options,
+                                                 PopulationModel::HaplotypeFrequencyVector& haplotype_frequencies,
+                                                 boost::optional<logging::DebugLogger>& debug_log,
+                                                 PopulationModel::OptionalThreadPool workers = boost::none)
 {
-    auto hw_model = make_hardy_weinberg_model(constants);
+    bool warm_start {haplotype_frequencies.size() == constants.num_haplotypes};
+    auto hw_model = make_hardy_weinberg_model(constants, haplotype_frequencies);
     auto genotype_log_marginals = init_genotype_log_marginals(genotypes, hw_model);
     auto result = init_genotype_posteriors(genotype_log_marginals, genotype_likelihoods);
-    run_em(result, hw_model, genotype_log_marginals, constants, options);
+    auto num_iterations = run_em(result, hw_model, genotype_log_marginals, constants, options, workers);
+    if (warm_start && !num_iterations) {
+        // The warm start was not close enough to a fixed point; start again from flat frequencies
+        warm_start = false;
+        hw_model = make_hardy_weinberg_model(constants);
+        update_genotype_log_marginals(genotype_log_marginals, hw_model);
+        result = init_genotype_posteriors(genotype_log_marginals, genotype_likelihoods);
+        num_iterations = run_em(result, hw_model, genotype_log_marginals, constants, options, workers);
+    }
+    if (debug_log) {
+        auto log = stream(*debug_log);
+        log << "EM " << (warm_start ? "from warm start " : "");
+        if (num_iterations) {
+            log << "converged after " << *num_iterations << " iterations";
+        } else {
+            log << "did not converge after " << options.max_iterations << " iterations";
+        }
+    }
+    haplotype_frequencies = std::move(hw_model.frequencies());
     return result;
 }
 
 auto compute_approx_genotype_marginal_posteriors(const MappableBlock<Haplotype>& haplotypes,
                                                  const PopulationModel::GenotypeVector& genotypes,
                                                  const GenotypeLogLikelihoodMatrix& genotype_likelihoods,
-                                                 const EMOptions options)
+                                                 const EMOptions options,
+                                                 PopulationModel::HaplotypeFrequencyVector& haplotype_frequencies,
+                                                 boost::optional<logging::DebugLogger>& debug_log,
+                                                 PopulationModel::OptionalThreadPool workers = boost::none)
 {
     const ModelConstants constants {haplotypes, genotypes, genotype_likelihoods};
-    return compute_approx_genotype_marginal_posteriors(genotypes, genotype_likelihoods, constants, options);
+    return compute_approx_genotype_marginal_posteriors(genotypes, genotype_likelihoods, constants, options, haplotype_frequencies, debug_log, workers);
 }
 
 auto compute_approx_genotype_marginal_posteriors(const MappableBlock<Haplotype>& haplotypes,
                                                  const PopulationModel::GenotypeVector& genotypes,
                                                  const GenotypeLogLikelihoodMatrix& genotype_likelihoods,
                                                  const std::vector<unsigned>& sample_plodies,
-                                                 const EMOptions options)
+                                                 const EMOptions options,
+                                                 PopulationModel::HaplotypeFrequencyVector& haplotype_frequencies,
+                                                 boost::optional<logging::DebugLogger>& debug_log,
+                                                 PopulationModel::OptionalThreadPool workers = boost::none)
 {
     const ModelConstants constants {haplotypes, genotypes, genotype_likelihoods, sample_plodies};
-    return compute_approx_genotype_marginal_posteriors(genotypes, genotype_likelihoods, constants, options);
+    return compute_approx_genotype_marginal_posteriors(genotypes, genotype_likelihoods, constants, options, haplotype_frequencies, debug_log, workers);
+}
+
+// ln p(reads) under the mean-field approximation: the samples are independent given the haplotype frequencies
+double calculate_mean_field_log_evidence(const PopulationModel::GenotypeVector& genotypes,
+                                         const GenotypeLogLikelihoodMatrix& genotype_log_likelihoods,
+                                         const PopulationModel::HaplotypeFrequencyVector& haplotype_frequencies)
+{
+    const HardyWeinbergModel hw_model {haplotype_frequencies};
+    const auto genotype_log_marginals = init_genotype_log_marginals(genotypes, hw_model);
+    double result {0};
+    GenotypeLogLikelihoodVector buffer(genotypes.size());
+    for (const auto& sample_genotype_log_likelihoods : genotype_log_likelihoods) {
+        std::transform(std::cbegin(genotype_log_marginals), std::cend(genotype_log_marginals),
+                       std::cbegin(sample_genotype_log_likelihoods), std::begin(buffer),
+                       [] (const auto& log_marginal, const auto log_likelihood) { return log_marginal.log_probability + log_likelihood; });
+        result += maths::fast_log_sum_exp(buffer);
+    }
+    return result;
 }
 
 using GenotypeCombinationVector = std::vector<std::size_t>;
@@ -559,7 +672,7 @@ auto calculate_posteriors(const PopulationModel::GenotypeVector& genotypes,
         fill(genotypes, combination, genotype_combination);
         result.push_back(prior_model.evaluate(genotype_combination) + sum(likelihoods_buffer));
     }
-    const auto norm = maths::normalise_exp(result);
+    const auto norm = maths::fast_normalise_exp(result);
     return std::make_pair(std::move(result), norm);
 }
 
@@ -593,25 +706,62 @@ void calculate_posterior_marginals(const Range& genotypes,
     result.log_evidence = norm;
 }
 
+bool can_enumerate_combinations(const boost::optional<std::size_t> num_possible_genotype_combinations,
+                                const PopulationModel::Options& options) noexcept
+{
+    return num_possible_genotype_combinations
+        && (!options.max_genotype_combinations || *num_possible_genotype_combinations <= *options.max_genotype_combinations);
+}
+
+bool use_mean_field(const std::size_t num_samples,
+                    const boost::optional<std::size_t> num_possible_genotype_combinations,
+                    const PopulationModel::Options& options) noexcept
+{
+    return num_samples >= options.min_mean_field_samples
+        && !can_enumerate_combinations(num_possible_genotype_combinations, options);
+}
+
+void set_mean_field_posteriors(GenotypeMarginalPosteriorMatrix&& em_genotype_marginals,
+                               const PopulationModel::GenotypeVector& genotypes,
+                               const GenotypeLogLikelihoodMatrix& genotype_log_likelihoods,
+                               PopulationModel::InferredLatents& result)
+{
+    result.posteriors.marginal_genotype_probabilities = std::move(em_genotype_marginals);
+    result.log_evidence = calculate_mean_field_log_evidence(genotypes, genotype_log_likelihoods, result.haplotype_frequencies);
+}
+
 } // namespace
 
 PopulationModel::InferredLatents
 PopulationModel::evaluate(const SampleVector& samples,
                           const MappableBlock<Haplotype>& haplotypes,
                           const GenotypeVector& genotypes,
-                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                          const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                          const HaplotypeFrequencyVector& initial_haplotype_frequencies,
+                          OptionalThreadPool workers) const
 {
     assert(!genotypes.empty());
-    const auto genotype_log_likelihoods = compute_genotype_log_likelihoods(samples, genotypes, haplotype_likelihoods);
+    const auto genotype_log_likelihoods = compute_genotype_log_likelihoods(samples, genotypes, haplotype_likelihoods, nullptr, workers);
     const auto num_possible_genotype_combinations = compute_num_combinations(genotypes.size(), samples.size());
     InferredLatents result;
+    if (use_mean_field(samples.size(), num_possible_genotype_combinations, options_)) {
+        if (debug_log_) stream(*debug_log_) << "Using mean-field inference for " << samples.size() << " samples";
+        const EMOptions em_options {options_.max_em_iterations, options_.em_epsilon};
+        result.haplotype_frequencies = initial_haplotype_frequencies;
+        auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_log_likelihoods, em_options,
+                                                                                 result.haplotype_frequencies, debug_log_, workers);
+        set_mean_field_posteriors(std::move(em_genotype_marginals), genotypes, genotype_log_likelihoods, result);
+        return result;
+    }
     GenotypeCombinationMatrix genotype_combinations {};
     if (!options_.max_genotype_combinations || (num_possible_genotype_combinations && *num_possible_genotype_combinations <= *options_.max_genotype_combinations)) {
         genotype_combinations = generate_all_genotype_combinations(genotypes.size(), samples.size());
     } else {
         const auto max_genotype_combinations = options_.max_genotype_combinations ? *options_.max_genotype_combinations : *num_possible_genotype_combinations;
         const EMOptions em_options {options_.max_em_iterations, options_.em_epsilon};
-        const auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_log_likelihoods, em_options);
+        result.haplotype_frequencies = initial_haplotype_frequencies;
+        const auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_log_likelihoods, em_options,
+                                                                                       result.haplotype_frequencies, debug_log_);
         genotype_combinations = propose_genotype_combinations(genotypes, em_genotype_marginals, max_genotype_combinations);
     }
     calculate_posterior_marginals(genotypes, genotype_combinations, genotype_log_likelihoods, prior_model_, result);
@@ -678,27 +828,84 @@ PopulationModel::evaluate(const SampleVector& samples,
                           const std::vector<unsigned>& sample_ploidies,
                           const MappableBlock<Haplotype>& haplotypes,
                           const GenotypeVector& genotypes,
-                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                          const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                          const HaplotypeFrequencyVector& initial_haplotype_frequencies,
+                          OptionalThreadPool workers) const
 {
     const auto genotype_masks = make_genotype_masks(sample_ploidies, genotypes);
-    const auto genotype_log_likelihoods = compute_genotype_log_likelihoods(samples, genotypes, haplotype_likelihoods, genotype_masks);
+    const auto genotype_log_likelihoods = compute_genotype_log_likelihoods(samples, genotypes, haplotype_likelihoods, &genotype_masks, workers);
     std::vector<std::size_t> sample_genotype_set_ids, genotype_set_sizes;
     std::tie(sample_genotype_set_ids, genotype_set_sizes) = get_genotype_sets(sample_ploidies, genotypes);
     const auto num_possible_genotype_combinations = compute_num_combinations(sample_genotype_set_ids, genotype_set_sizes);
     InferredLatents result {};
+    if (use_mean_field(samples.size(), num_possible_genotype_combinations, options_)) {
+        if (debug_log_) stream(*debug_log_) << "Using mean-field inference for " << samples.size() << " samples";
+        const EMOptions em_options {options_.max_em_iterations, options_.em_epsilon};
+        result.haplotype_frequencies = initial_haplotype_frequencies;
+        auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_log_likelihoods, sample_ploidies, em_options,
+                                                                                 result.haplotype_frequencies, debug_log_, workers);
+        set_mean_field_posteriors(std::move(em_genotype_marginals), genotypes, genotype_log_likelihoods, result);
+        return result;
+    }
     GenotypeCombinationMatrix genotype_combinations {};
     if (!options_.max_genotype_combinations || (num_possible_genotype_combinations && *num_possible_genotype_combinations <= *options_.max_genotype_combinations)) {
         genotype_combinations = generate_all_genotype_combinations(sample_genotype_set_ids, genotype_set_sizes);
     } else {
         const auto max_genotype_combinations = options_.max_genotype_combinations ? *options_.max_genotype_combinations : *num_possible_genotype_combinations;
         const EMOptions em_options {options_.max_em_iterations, options_.em_epsilon};
-        const auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_log_likelihoods, sample_ploidies, em_options);
+        result.haplotype_frequencies = initial_haplotype_frequencies;
+        const auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_log_likelihoods, sample_ploidies, em_options,
+                                                                                       result.haplotype_frequencies, debug_log_);
         genotype_combinations = propose_genotype_combinations(genotypes, em_genotype_marginals, max_genotype_combinations);
     }
     calculate_posterior_marginals(genotypes, genotype_combinations, genotype_log_likelihoods, prior_model_, result);
     return result;
 }
 
+PopulationModel::HaplotypeFrequencyVector
+map_haplotype_frequencies(const MappableBlock<Haplotype>& source_haplotypes,
+                          const PopulationModel::HaplotypeFrequencyVector& source_frequencies,
+                          const MappableBlock<Haplotype>& target_haplotypes,
+                          const double flat_frequency_weight)
+{
+    assert(source_haplotypes.size() == source_frequencies.size());
+    if (source_haplotypes.empty() || target_haplotypes.empty()) return {};
+    const auto overlap = overlapped_region(mapped_region(source_haplotypes), mapped_region(target_haplotypes));
+    if (!overlap || is_empty(*overlap)) return {};
+    std::unordered_map<Haplotype::NucleotideSequence, double> segment_frequencies {};
+    segment_frequencies.reserve(source_haplotypes.size());
+    for (std::size_t idx {0}; idx < source_haplotypes.size(); ++idx) {
+        if (contains(source_haplotypes[idx], *overlap)) {
+            segment_frequencies[source_haplotypes[idx].sequence(*overlap)] += source_frequencies[idx];
+        }
+    }
+    std::vector<boost::optional<Haplotype::NucleotideSequence>> target_segments(target_haplotypes.size());
+    std::unordered_map<Haplotype::NucleotideSequence, unsigned> segment_counts {};
+    for (std::size_t idx {0}; idx < target_haplotypes.size(); ++idx) {
+        if (contains(target_haplotypes[idx], *overlap)) {
+            target_segments[idx] = target_haplotypes[idx].sequence(*overlap);
+            ++segment_counts[*target_segments[idx]];
+        }
+    }
+    PopulationModel::HaplotypeFrequencyVector result(target_haplotypes.size(), 0.0);
+    double mapped_mass {0};
+    for (std::size_t idx {0}; idx < target_haplotypes.size(); ++idx) {
+        if (target_segments[idx]) {
+            const auto segment_itr = segment_frequencies.find(*target_segments[idx]);
+            if (segment_itr != std::cend(segment_frequencies)) {
+                result[idx] = segment_itr->second / segment_counts[*target_segments[idx]];
+                mapped_mass += result[idx];
+            }
+        }
+    }
+    if (mapped_mass <= 0) return {};
+    const auto flat_frequency = flat_frequency_weight / target_haplotypes.size();
+    for (auto& frequency : result) {
+        frequency = (1 - flat_frequency_weight) * frequency / mapped_mass + flat_frequency;
+    }
+    return result;
+}
+
 namespace debug {
     
 } // namespace debug
@@ -17,6 +17,7 @@
 #include "containers/probability_matrix.hpp"
 #include "containers/mappable_block.hpp"
 #include "logging/logging.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace octopus { namespace model {
 
@@ -28,20 +29,27 @@ public:
         boost::optional<std::size_t> max_genotype_combinations = boost::none;
         unsigned max_em_iterations = 100;
         double em_epsilon = 0.001;
+        // With at least this many samples, and too many genotype combinations to enumerate, the
+        // joint posterior is approximated by the mean-field EM posteriors under Hardy-Weinberg
+        // frequencies, rather than by proposing genotype combinations.
+        std::size_t min_mean_field_samples = 50;
     };
     struct Latents
     {
         using ProbabilityVector = std::vector<double>;
         std::vector<ProbabilityVector> marginal_genotype_probabilities;
     };
+    using HaplotypeFrequencyVector = std::vector<double>;
     struct InferredLatents
     {
         Latents posteriors;
         double log_evidence;
+        HaplotypeFrequencyVector haplotype_frequencies = {}; // EM estimates; empty if EM was not needed
     };
     
     using SampleVector   = std::vector<SampleName>;
     using GenotypeVector = MappableBlock<Genotype<IndexedHaplotype<>>>;
+    using OptionalThreadPool = boost::optional<ThreadPool&>;
     
     PopulationModel() = delete;
     
@@ -60,19 +68,27 @@ public:
     
     const PopulationPriorModel& prior_model() const noexcept;
     
+    // If given, initial_haplotype_frequencies (one per haplotype) warm start the EM used to
+    // propose genotype combinations, rather than flat frequencies. Workers are only used
+    // for mean-field inference, which is parallel over samples.
+    
     // All samples have same ploidy
     InferredLatents
     evaluate(const SampleVector& samples,
              const MappableBlock<Haplotype>& haplotypes,
              const GenotypeVector& genotypes,
-             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+             const HaplotypeLikelihoodArray& haplotype_likelihoods,
+             const HaplotypeFrequencyVector& initial_haplotype_frequencies = {},
+             OptionalThreadPool workers = boost::none) const;
     // Samples have different ploidy
     InferredLatents
     evaluate(const SampleVector& samples,
              const std::vector<unsigned>& sample_ploidies,
              const MappableBlock<Haplotype>& haplotypes,
              const GenotypeVector& genotypes,
-             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+             const HaplotypeLikelihoodArray& haplotype_likelihoods,
+             const HaplotypeFrequencyVector& initial_haplotype_frequencies = {},
+             OptionalThreadPool workers = boost::none) const;
     
 private:
     Options options_;
@@ -80,6 +96,19 @@ private:
     mutable boost::optional<logging::DebugLogger> debug_log_;
 };
 
+/*
+    Maps haplotype frequencies estimated for one set of haplotypes (e.g. the previous window) onto
+    another, through the haplotype sequences over the region where the two sets overlap. Frequency
+    mass of each overlap segment is shared evenly between the target haplotypes with that segment,
+    and mixed with flat frequencies so haplotypes new to the target are not ruled out.
+    Returns an empty vector if the haplotypes do not overlap or share no segments.
+ */
+PopulationModel::HaplotypeFrequencyVector
+map_haplotype_frequencies(const MappableBlock<Haplotype>& source_haplotypes,
+                          const PopulationModel::HaplotypeFrequencyVector& source_frequencies,
+                          const MappableBlock<Haplotype>& target_haplotypes,
+                          double flat_frequency_weight = 0.1);
+
 } // namesapce model
 } // namespace octopus
 
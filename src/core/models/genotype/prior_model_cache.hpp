@@ -0,0 +1,60 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef prior_model_cache_hpp
+#define prior_model_cache_hpp
+
+#include <memory>
+#include <utility>
+
+#include "core/types/haplotype.hpp"
+#include "containers/mappable_block.hpp"
+
+namespace octopus {
+
+// Holds the last primed prior model so callers can reuse it while the haplotypes stay the same,
+// e.g. between latent inference, model posterior calculation, and genotype reduction in one window.
+// Prior models only depend on the haplotypes (and their reference), so these are the key.
+template <typename PriorModel>
+class PriorModelCache
+{
+public:
+    using HaplotypeBlock = MappableBlock<Haplotype>;
+
+    PriorModelCache() = default;
+
+    // Copies get their own (empty) cache, as cached models are primed on the source's haplotypes
+    PriorModelCache(const PriorModelCache&) : PriorModelCache {} {}
+    PriorModelCache& operator=(const PriorModelCache&) { clear(); return *this; }
+    PriorModelCache(PriorModelCache&&)                 = default;
+    PriorModelCache& operator=(PriorModelCache&&)      = default;
+
+    ~PriorModelCache() = default;
+
+    // make(haplotypes) must return a std::unique_ptr<PriorModel>; it is only called on a cache miss
+    template <typename Factory>
+    const PriorModel& get(const HaplotypeBlock& haplotypes, Factory&& make)
+    {
+        if (!model_ || !(haplotypes_ == haplotypes)) {
+            model_ = nullptr;
+            haplotypes_ = haplotypes;
+            model_ = std::forward<Factory>(make)(haplotypes_);
+            model_->prime(haplotypes_);
+        }
+        return *model_;
+    }
+
+    void clear() noexcept
+    {
+        model_ = nullptr;
+        haplotypes_.clear();
+    }
+
+private:
+    HaplotypeBlock haplotypes_;
+    std::unique_ptr<PriorModel> model_;
+};
+
+} // namespace octopus
+
+#endif
@@ -24,17 +24,6 @@ namespace octopus { namespace model {
 
 const UniformPopulationPriorModel SingleCellModel::default_population_prior_model_{};
 
-namespace {
-
-auto get_vb_model_options(const SingleCellModel::AlgorithmParameters& config)
-{
-    VariationalBayesMixtureMixtureModel::Options result {};
-    result.parallel_execution = config.execution_policy == ExecutionPolicy::par;
-    return result;
-}
-
-} // namespace
-
 SingleCellModel::SingleCellModel(std::vector<SampleName> samples,
                                  SingleCellPriorModel prior_model,
                                  Parameters parameters,
@@ -42,7 +31,7 @@ SingleCellModel::SingleCellModel(std::vector<SampleName> samples,
                                  boost::optional<const PopulationPriorModel&> population_prior_model)
 : samples_{std::move(samples)}
 , prior_model_{std::move(prior_model)}
-, posterior_model_ {get_vb_model_options(config)}
+, posterior_model_ {}
 , parameters_{std::move(parameters)}
 , config_{std::move(config)}
 , population_prior_model_{std::addressof(population_prior_model ? *population_prior_model : default_population_prior_model_)}
@@ -79,7 +68,9 @@ copy(const std::vector<T>& values, const std::vector<std::size_t>& indices)
 
 SingleCellModel::Inferences
 SingleCellModel::evaluate(const GenotypeVector& genotypes,
-                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                          const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                          OptionalThreadPool workers,
+                          OptionalCellCache cache) const
 {
     assert(all_same_ploidy(genotypes));
     const auto num_clones = prior_model_.phylogeny().size();
@@ -87,10 +78,10 @@ SingleCellModel::evaluate(const GenotypeVector& genotypes,
     assert(num_clones <= samples_.size());
     Inferences result {};
     if (num_clones == 1) {
-        evaluate(result, genotypes, haplotype_likelihoods);
+        evaluate(result, genotypes, haplotype_likelihoods, workers);
     } else {
-        const auto genotype_combinations = propose_genotype_combinations(genotypes, haplotype_likelihoods);
-        evaluate(result, genotypes, genotype_combinations, haplotype_likelihoods);
+        const auto genotype_combinations = propose_genotype_combinations(genotypes, haplotype_likelihoods, workers, cache);
+        evaluate(result, genotypes, genotype_combinations, haplotype_likelihoods, workers);
     }
     return result;
 }
@@ -98,17 +89,19 @@ SingleCellModel::evaluate(const GenotypeVector& genotypes,
 SingleCellModel::Inferences
 SingleCellModel::evaluate(const PhylogenyNodePloidyMap& phylogeny_ploidies,
                           const GenotypeVector& genotypes,
-                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                          const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                          OptionalThreadPool workers,
+                          OptionalCellCache cache) const
 {
     assert(phylogeny_ploidies.size() == prior_model_.phylogeny().size());
     const auto num_clones = prior_model_.phylogeny().size();
     assert(num_clones <= genotypes.size());
     if (num_clones == 1) {
-        return evaluate(genotypes, haplotype_likelihoods);
+        return evaluate(genotypes, haplotype_likelihoods, workers, cache);
     } else {
         Inferences result {};
-        const auto genotype_combinations = propose_genotype_combinations(phylogeny_ploidies, genotypes, haplotype_likelihoods);
-        evaluate(result, genotypes, genotype_combinations, haplotype_likelihoods);
+        const auto genotype_combinations = propose_genotype_combinations(phylogeny_ploidies, genotypes, haplotype_likelihoods, workers, cache);
+        evaluate(result, genotypes, genotype_combinations, haplotype_likelihoods, workers);
         return result;
     }
 }
@@ -359,9 +352,35 @@ void erase_combinations_with_duplicate_indices(std::vector<std::vector<std::size
 
 } // namespace
 
+std::vector<SingleCellModel::CellCache::ProbabilityVector>
+SingleCellModel::compute_cell_genotype_posteriors(const GenotypeVector& genotypes,
+                                                  const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                                  const boost::optional<std::size_t> max_genotype_combinations,
+                                                  OptionalThreadPool workers,
+                                                  OptionalCellCache cache) const
+{
+    if (cache) {
+        for (const auto& entry : cache->entries) {
+            if (entry.genotypes == std::addressof(genotypes) && entry.max_genotype_combinations == max_genotype_combinations) {
+                return entry.genotype_posteriors;
+            }
+        }
+    }
+    PopulationModel::Options population_model_options {};
+    population_model_options.max_genotype_combinations = max_genotype_combinations;
+    PopulationModel population_model {*population_prior_model_, population_model_options};
+    const auto haplotypes = haplotype_likelihoods.haplotypes();
+    auto population_inferences = population_model.evaluate(samples_, haplotypes, genotypes, haplotype_likelihoods, {}, workers);
+    auto result = std::move(population_inferences.posteriors.marginal_genotype_probabilities);
+    if (cache) cache->entries.push_back({std::addressof(genotypes), max_genotype_combinations, result});
+    return result;
+}
+
 SingleCellModel::GenotypeCombinationVector
 SingleCellModel::propose_genotype_combinations(const GenotypeVector& genotypes,
-                                               const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                                               const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                               OptionalThreadPool workers,
+                                               OptionalCellCache cache) const
 {
     const auto num_groups = prior_model_.phylogeny().size();
     const auto max_possible_combinations = num_combinations(genotypes.size(), num_groups);
@@ -372,21 +391,16 @@ SingleCellModel::propose_genotype_combinations(const GenotypeVector& genotypes,
     // 3. Run individual model on merged reads
     // 4. Select top combinations using cluster marginal posteriors
     
-    PopulationModel::Options population_model_options {};
-    population_model_options.max_genotype_combinations = max_genotype_combinations;
-    PopulationModel population_model {*population_prior_model_, population_model_options};
     std::vector<PopulationModel::Latents::ProbabilityVector> population_genotype_posteriors;
     IndividualModel individual_model {prior_model_.germline_prior_model()};
     std::vector<ProbabilityVector> cluster_marginal_genotype_posteriors {};
     cluster_marginal_genotype_posteriors.reserve(samples_.size() / 2);
-    const auto haplotypes = haplotype_likelihoods.haplotypes();
     ClusterVector clusters {};
     std::vector<std::vector<SampleName>> samples_by_cluster {};
     
     while (clusters.empty() || clusters.size() > num_groups) {
         if (clusters.empty()) {
-            auto population_inferences = population_model.evaluate(samples_, haplotypes, genotypes, haplotype_likelihoods);
-            population_genotype_posteriors = std::move(population_inferences.posteriors.marginal_genotype_probabilities);
+            population_genotype_posteriors = compute_cell_genotype_posteriors(genotypes, haplotype_likelihoods, max_genotype_combinations, workers, cache);
             clusters = cluster_samples(population_genotype_posteriors, std::min(std::max(samples_.size() / 4, 2 * num_groups), samples_.size()));
         } else if (clusters.size() > 2 * num_groups) {
             clusters = cluster_samples(cluster_marginal_genotype_posteriors, std::min(std::max(clusters.size() / 2, 2 * num_groups), samples_.size()));
@@ -498,20 +512,6 @@ SingleCellModel::propose_all_genotype_combinations(const GenotypeVector& genotyp
 
 namespace {
 
-auto max_ploidy(const SingleCellModel::GenotypeVector& genotypes)
-{
-    const static auto ploidy_less = [] (const auto& lhs, const auto& rhs) { return lhs.ploidy() < rhs.ploidy(); };
-    return std::max_element(std::cbegin(genotypes), std::cend(genotypes), ploidy_less)->ploidy();
-}
-
-auto segment_by_ploidy(const SingleCellModel::GenotypeVector& genotypes)
-{
-    std::vector<SingleCellModel::GenotypeVector> result(max_ploidy(genotypes) + 1);
-    for (auto& g : result) g.reserve(genotypes.size());
-    for (const auto& genotype : genotypes) result[genotype.ploidy()].push_back(genotype);
-    return result;
-}
-
 bool valid_ploidies(const std::vector<std::size_t>& combination,
                     const SingleCellModel::GenotypeVector& genotypes,
                     const std::vector<unsigned>& required_ploidies) noexcept
@@ -593,44 +593,21 @@ private:
 SingleCellModel::GenotypeCombinationVector
 SingleCellModel::propose_genotype_combinations(const PhylogenyNodePloidyMap& phylogeny_ploidies,
                                                const GenotypeVector& genotypes,
-                                               const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                                               const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                               OptionalThreadPool workers,
+                                               OptionalCellCache cache) const
 {
-    // First assign each sample to a ploidy
-    const auto genotypes_by_ploidy = segment_by_ploidy(genotypes);
-    std::vector<unsigned> sample_ploidies {};
-    sample_ploidies.reserve(samples_.size());
     const ZygosityGenotypePriorModel zygosity_prior {prior_model_.germline_prior_model()};
     const IndividualModel zygosity_individual_model {zygosity_prior};
-    for (const auto& sample : samples_) {
-        haplotype_likelihoods.prime(sample);
-        unsigned best_ploidy {1};
-        double max_log_evidence {};
-        for (unsigned ploidy {1}; ploidy < genotypes_by_ploidy.size(); ++ploidy) {
-            if (!genotypes_by_ploidy[ploidy].empty()) {
-                const auto inferences = zygosity_individual_model.evaluate(genotypes_by_ploidy[ploidy], haplotype_likelihoods);
-                if (ploidy == 1 || max_log_evidence < inferences.log_evidence) {
-                    best_ploidy = ploidy;
-                    max_log_evidence = inferences.log_evidence;
-                }
-            }
-        }
-        sample_ploidies.push_back(best_ploidy);
-    }
-    
-    PopulationModel::Options population_model_options {};
-    population_model_options.max_genotype_combinations = config_.max_genotype_combinations;
-    PopulationModel population_model {*population_prior_model_, population_model_options};
     std::vector<PopulationModel::Latents::ProbabilityVector> population_genotype_posteriors;
     const auto num_groups = prior_model_.phylogeny().size();
     std::vector<ProbabilityVector> cluster_marginal_genotype_posteriors {};
-    const auto haplotypes = haplotype_likelihoods.haplotypes();
     ClusterVector clusters {};
     std::vector<std::vector<SampleName>> samples_by_cluster {};
     
     while (clusters.empty() || clusters.size() > num_groups) {
         if (clusters.empty()) {
-            auto population_inferences = population_model.evaluate(samples_, haplotypes, genotypes, haplotype_likelihoods);
-            population_genotype_posteriors = std::move(population_inferences.posteriors.marginal_genotype_probabilities);
+            population_genotype_posteriors = compute_cell_genotype_posteriors(genotypes, haplotype_likelihoods, config_.max_genotype_combinations, workers, cache);
             clusters = cluster_samples(population_genotype_posteriors, std::min(std::max(samples_.size() / 4, 2 * num_groups), samples_.size()));
         } else if (clusters.size() > 2 * num_groups) {
             clusters = cluster_samples(cluster_marginal_genotype_posteriors, std::min(std::max(clusters.size() / 2, 2 * num_groups), samples_.size()));
@@ -737,7 +714,8 @@ void make_point_seeds(const std::size_t num_genotypes, const std::vector<std::si
 void
 SingleCellModel::evaluate(Inferences& result,
                           const GenotypeVector& genotypes,
-                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                          const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                          OptionalThreadPool workers) const
 {
     SubcloneModel::Priors subclone_priors {prior_model_.germline_prior_model(), {}};
     const auto ploidy = genotypes.front().ploidy();
@@ -749,7 +727,7 @@ SingleCellModel::evaluate(Inferences& result,
     SubcloneModel helper_model {samples_, std::move(subclone_priors), algo_params};
     SubcloneModel::InferredLatents subclone_inferences;
     if (!config_.max_genotype_combinations || genotypes.size() <= *config_.max_genotype_combinations) {
-        subclone_inferences = helper_model.evaluate(genotypes, haplotype_likelihoods);
+        subclone_inferences = helper_model.evaluate(genotypes, haplotype_likelihoods, {}, workers);
     } else {
         const auto genotype_subset_indices = propose_genotypes(genotypes, haplotype_likelihoods);
         const auto genotype_subset = copy(genotypes, genotype_subset_indices);
@@ -758,7 +736,7 @@ SingleCellModel::evaluate(Inferences& result,
         std::iota(std::begin(hint_indices), std::end(hint_indices), 0u);
         std::vector<LogProbabilityVector> hints {};
         make_point_seeds(genotype_subset.size(), hint_indices, hints);
-        subclone_inferences = helper_model.evaluate(genotype_subset, haplotype_likelihoods, std::move(hints));
+        subclone_inferences = helper_model.evaluate(genotype_subset, haplotype_likelihoods, std::move(hints), workers);
         SubcloneModel::Latents::ProbabilityVector weighted_genotype_posteriors(genotypes.size());
         for (std::size_t g {0}; g < genotype_subset.size(); ++g) {
             weighted_genotype_posteriors[genotype_subset_indices[g]] = subclone_inferences.weighted_genotype_posteriors[g];
@@ -776,12 +754,13 @@ void
 SingleCellModel::evaluate(Inferences& result,
                           const GenotypeVector& genotypes,
                           const GenotypeCombinationVector& genotype_combinations,
-                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                          const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                          OptionalThreadPool workers) const
 {
     const auto genotype_combination_priors = calculate_genotype_priors(genotype_combinations, genotypes);
     const auto vb_haplotype_likelihoods = make_likelihood_matrix(genotype_combinations, genotypes, haplotype_likelihoods);
     auto seeds = propose_seeds(genotype_combinations, genotypes, genotype_combination_priors, haplotype_likelihoods);
-    auto vb_inferences = evaluate_model(genotype_combination_priors, vb_haplotype_likelihoods, std::move(seeds));
+    auto vb_inferences = evaluate_model(genotype_combination_priors, vb_haplotype_likelihoods, std::move(seeds), workers);
     for (std::size_t group_idx {0}; group_idx < prior_model_.phylogeny().size(); ++group_idx) {
         Inferences::GroupInferences group {};
         group.sample_attachment_posteriors.resize(samples_.size());
@@ -887,7 +866,8 @@ SingleCellModel::propose_seeds(const GenotypeCombinationVector& genotype_combina
 VariationalBayesMixtureMixtureModel::Inferences
 SingleCellModel::evaluate_model(const VariationalBayesMixtureMixtureModel::LogProbabilityVector& genotype_combination_priors,
                                 const VBLikelihoodMatrix& haplotype_likelihoods,
-                                VBSeedVector seeds) const
+                                VBSeedVector seeds,
+                                OptionalThreadPool workers) const
 {
     if (parameters_.group_priors) {
         if (parameters_.sample_dropout_concentrations.size() == samples_.size()) {
@@ -896,14 +876,16 @@ SingleCellModel::evaluate_model(const VariationalBayesMixtureMixtureModel::LogPr
                                              *parameters_.group_priors,
                                              parameters_.group_concentration,
                                              parameters_.sample_dropout_concentrations,
-                                             std::move(seeds));
+                                             std::move(seeds),
+                                             workers);
         } else {
             return posterior_model_.evaluate(genotype_combination_priors,
                                              haplotype_likelihoods,
                                              *parameters_.group_priors,
                                              parameters_.group_concentration,
                                              parameters_.dropout_concentration,
-                                             std::move(seeds));
+                                             std::move(seeds),
+                                             workers);
         }
     } else {
         if (parameters_.sample_dropout_concentrations.size() == samples_.size()) {
@@ -911,13 +893,15 @@ SingleCellModel::evaluate_model(const VariationalBayesMixtureMixtureModel::LogPr
                                              haplotype_likelihoods,
                                              parameters_.group_concentration,
                                              parameters_.sample_dropout_concentrations,
-                                             std::move(seeds));
+                                             std::move(seeds),
+                                             workers);
         } else {
             return posterior_model_.evaluate(genotype_combination_priors,
                                              haplotype_likelihoods,
                                              parameters_.group_concentration,
                                              parameters_.dropout_concentration,
-                                             std::move(seeds));
+                                             std::move(seeds),
+                                             workers);
         }
     }
 }
@@ -52,7 +52,6 @@ public:
     {
         boost::optional<std::size_t> max_genotype_combinations;
         unsigned max_seeds = 20;
-        ExecutionPolicy execution_policy = ExecutionPolicy::seq;
     };
     
     struct NoViableGenotypeCombinationsError : public ProgramError
@@ -62,8 +61,25 @@ public:
     };
     
     using GenotypeVector = std::vector<Genotype<IndexedHaplotype<>>>;
+    using OptionalThreadPool = boost::optional<ThreadPool&>;
     using PhylogenyNodePloidyMap = std::unordered_map<SingleCellPriorModel::CellPhylogeny::LabelType, unsigned>;
     
+    // The per-cell genotype posteriors used to propose genotype combinations do not depend on the
+    // phylogeny, so can be shared by the models of each phylogeny proposed for the same genotypes.
+    // Entries are keyed by the address of the genotypes, which must outlive the cache.
+    struct CellCache
+    {
+        using ProbabilityVector = std::vector<double>;
+        struct Entry
+        {
+            const GenotypeVector* genotypes;
+            boost::optional<std::size_t> max_genotype_combinations;
+            std::vector<ProbabilityVector> genotype_posteriors;
+        };
+        std::vector<Entry> entries;
+    };
+    using OptionalCellCache = boost::optional<CellCache&>;
+    
     SingleCellModel() = delete;
     
     SingleCellModel(std::vector<SampleName> samples,
@@ -83,12 +99,16 @@ public:
     
     Inferences
     evaluate(const GenotypeVector& genotypes,
-             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+             const HaplotypeLikelihoodArray& haplotype_likelihoods,
+             OptionalThreadPool workers = boost::none,
+             OptionalCellCache cache = boost::none) const;
     
     Inferences
     evaluate(const PhylogenyNodePloidyMap& phylogeny_ploidies,
              const GenotypeVector& genotypes,
-             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+             const HaplotypeLikelihoodArray& haplotype_likelihoods,
+             OptionalThreadPool workers = boost::none,
+             OptionalCellCache cache = boost::none) const;
 
 private:
     const static UniformPopulationPriorModel default_population_prior_model_;
@@ -108,24 +128,36 @@ private:
     std::vector<std::size_t>
     propose_genotypes(const GenotypeVector& genotypes,
                       const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    std::vector<CellCache::ProbabilityVector>
+    compute_cell_genotype_posteriors(const GenotypeVector& genotypes,
+                                     const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                     boost::optional<std::size_t> max_genotype_combinations,
+                                     OptionalThreadPool workers,
+                                     OptionalCellCache cache) const;
     GenotypeCombinationVector
     propose_genotype_combinations(const GenotypeVector& genotypes,
-                                  const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+                                  const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                  OptionalThreadPool workers,
+                                  OptionalCellCache cache) const;
     GenotypeCombinationVector
     propose_all_genotype_combinations(const GenotypeVector& genotypes) const;
     GenotypeCombinationVector
     propose_genotype_combinations(const PhylogenyNodePloidyMap& phylogeny_ploidies,
                                   const GenotypeVector& genotypes,
-                                  const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+                                  const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                  OptionalThreadPool workers,
+                                  OptionalCellCache cache) const;
     void
     evaluate(Inferences& result,
              const GenotypeVector& genotypes,
-             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+             const HaplotypeLikelihoodArray& haplotype_likelihoods,
+             OptionalThreadPool workers) const;
     void
     evaluate(Inferences& result,
              const GenotypeVector& genotypes,
              const GenotypeCombinationVector& genotype_combinations,
-             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+             const HaplotypeLikelihoodArray& haplotype_likelihoods,
+             OptionalThreadPool workers) const;
     VariationalBayesMixtureMixtureModel::LogProbabilityVector
     calculate_genotype_priors(const GenotypeCombinationVector& genotype_combinations,
                               const GenotypeVector& genotypes) const;
@@ -141,7 +173,8 @@ private:
     VariationalBayesMixtureMixtureModel::Inferences
     evaluate_model(const VariationalBayesMixtureMixtureModel::LogProbabilityVector& genotype_combination_priors,
                    const VBLikelihoodMatrix& haplotype_likelihoods,
-                   VBSeedVector seeds) const;
+                   VBSeedVector seeds,
+                   OptionalThreadPool workers) const;
 };
 
 } // namespace model
@@ -154,11 +154,22 @@ LogProbabilityVector evaluate(const std::vector<G>& genotypes, const ConstantMix
 std::vector<LogProbabilityVector>
 compute_genotype_likelihoods_with_germline_model(const std::vector<SampleName>& samples,
                                                  const std::vector<CancerGenotype<IndexedHaplotype<>>>& genotypes,
-                                                 const HaplotypeLikelihoodArray& haplotype_log_likelihoods)
+                                                 const HaplotypeLikelihoodArray& haplotype_log_likelihoods,
+                                                 const GenotypeLikelihoodCache* likelihood_cache)
 {
-    ConstantMixtureGenotypeLikelihoodModel model {haplotype_log_likelihoods};
     std::vector<LogProbabilityVector> result {};
     result.reserve(samples.size());
+    if (likelihood_cache) {
+        std::vector<Genotype<IndexedHaplotype<>>> demoted_genotypes {};
+        demoted_genotypes.reserve(genotypes.size());
+        std::transform(std::cbegin(genotypes), std::cend(genotypes), std::back_inserter(demoted_genotypes),
+                       [] (const auto& genotype) { return demote(genotype); });
+        for (const auto& sample : samples) {
+            result.push_back(likelihood_cache->evaluate(sample, demoted_genotypes));
+        }
+        return result;
+    }
+    ConstantMixtureGenotypeLikelihoodModel model {haplotype_log_likelihoods};
     for (const auto& sample : samples) {
         model.cache().prime(sample);
         result.push_back(evaluate(genotypes, model));
@@ -187,11 +198,21 @@ evaluate_germlines(const std::vector<CancerGenotype<IndexedHaplotype<>>>& genoty
 std::vector<LogProbabilityVector>
 compute_germline_genotype_likelihoods_with_germline_model(const std::vector<SampleName>& samples,
                                                           const std::vector<CancerGenotype<IndexedHaplotype<>>>& genotypes,
-                                                          const HaplotypeLikelihoodArray& haplotype_log_likelihoods)
+                                                          const HaplotypeLikelihoodArray& haplotype_log_likelihoods,
+                                                          const GenotypeLikelihoodCache* likelihood_cache)
 {
-    ConstantMixtureGenotypeLikelihoodModel model {haplotype_log_likelihoods};
     std::vector<LogProbabilityVector> result {};
     result.reserve(samples.size());
+    if (likelihood_cache) {
+        for (const auto& sample : samples) {
+            LogProbabilityVector sample_result(genotypes.size());
+            std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(sample_result),
+                           [&] (const auto& genotype) { return likelihood_cache->evaluate(sample, genotype.germline()); });
+            result.push_back(std::move(sample_result));
+        }
+        return result;
+    }
+    ConstantMixtureGenotypeLikelihoodModel model {haplotype_log_likelihoods};
     for (const auto& sample : samples) {
         model.cache().prime(sample);
         result.push_back(evaluate_germlines(genotypes, model));
@@ -238,7 +259,8 @@ generate_seeds(const std::vector<SampleName>& samples,
                const SubcloneModel::Priors& priors,
                std::size_t max_seeds,
                std::vector<LogProbabilityVector> hints,
-               const MappableBlock<Haplotype>* haplotypes)
+               const MappableBlock<Haplotype>* haplotypes,
+               const GenotypeLikelihoodCache* likelihood_cache)
 {
     if (genotypes.size() <= max_seeds) {
         return generate_exhaustive_seeds(genotypes.size());
@@ -251,8 +273,12 @@ generate_seeds(const std::vector<SampleName>& samples,
     std::vector<LogProbabilityVector> basic_sample_likelihoods {};
     basic_sample_likelihoods.reserve(samples.size());
     for (const auto& sample : samples) {
-        basic_likelihood_model.cache().prime(sample);
-        basic_sample_likelihoods.push_back(evaluate(genotypes, basic_likelihood_model));
+        if (likelihood_cache) {
+            basic_sample_likelihoods.push_back(likelihood_cache->evaluate(sample, genotypes));
+        } else {
+            basic_likelihood_model.cache().prime(sample);
+            basic_sample_likelihoods.push_back(evaluate(genotypes, basic_likelihood_model));
+        }
     }
     auto basic_likelihoods = add_all_and_normalise(basic_sample_likelihoods);
     auto basic_posteriors = add_and_normalise(genotype_log_priors, basic_likelihoods);
@@ -293,7 +319,8 @@ generate_seeds(const std::vector<SampleName>& samples,
                const SomaticSubcloneModel::Priors& priors,
                std::size_t max_seeds,
                std::vector<LogProbabilityVector> hints,
-               const MappableBlock<Haplotype>* haplotypes)
+               const MappableBlock<Haplotype>* haplotypes,
+               const GenotypeLikelihoodCache* likelihood_cache)
 {
     if (genotypes.size() <= max_seeds) {
         return generate_exhaustive_seeds(genotypes.size());
@@ -309,7 +336,7 @@ generate_seeds(const std::vector<SampleName>& samples,
     result.push_back(prior_mixture_posteriors); // 1
     --max_seeds;
     if (max_seeds == 0) return result;
-    auto sample_normal_likelihoods = compute_genotype_likelihoods_with_germline_model(samples, genotypes, haplotype_log_likelihoods);
+    auto sample_normal_likelihoods = compute_genotype_likelihoods_with_germline_model(samples, genotypes, haplotype_log_likelihoods, likelihood_cache);
     auto normal_likelihoods = add_all_and_normalise(sample_prior_mixture_likelihoods);
     auto normal_posteriors = add_and_normalise(genotype_log_priors, normal_likelihoods);
     result.push_back(normal_posteriors); // 2
@@ -325,7 +352,7 @@ generate_seeds(const std::vector<SampleName>& samples,
     if (max_seeds == 0) return result;
     result.push_back(combined_model_likelihoods); // 6
     if (max_seeds == 0) return result;
-    auto sample_germline_likelihoods = compute_germline_genotype_likelihoods_with_germline_model(samples, genotypes, haplotype_log_likelihoods);
+    auto sample_germline_likelihoods = compute_germline_genotype_likelihoods_with_germline_model(samples, genotypes, haplotype_log_likelihoods, likelihood_cache);
     result.push_back(add_all_and_normalise(sample_germline_likelihoods)); // 7
     --max_seeds;
     if (max_seeds == 0) return result;
@@ -22,6 +22,7 @@
 #include "variational_bayes_mixture_model.hpp"
 #include "genotype_prior_model.hpp"
 #include "cancer_genotype_prior_model.hpp"
+#include "genotype_likelihood_cache.hpp"
 
 namespace octopus { namespace model {
 
@@ -87,6 +88,9 @@ public:
     void unprime() noexcept;
     bool is_primed() const noexcept;
     
+    // The cache must be over the same HaplotypeLikelihoodArray given to evaluate
+    void share_likelihoods(const GenotypeLikelihoodCache& cache) noexcept;
+    
     InferredLatents
     evaluate(const std::vector<GenotypeType>& genotypes,
              const HaplotypeLikelihoodArray& haplotype_likelihoods,
@@ -98,6 +102,7 @@ private:
     Priors priors_;
     AlgorithmParameters parameters_;
     const MappableBlock<Haplotype>* haplotypes_;
+    const GenotypeLikelihoodCache* likelihood_cache_;
 };
 
 using SubcloneModel = SubcloneModelBase<Genotype<IndexedHaplotype<>>, GenotypePriorModel>;
@@ -116,6 +121,8 @@ SubcloneModelBase<G, GPM>::SubcloneModelBase(std::vector<SampleName> samples, Pr
 : samples_ {std::move(samples)}
 , priors_ {std::move(priors)}
 , parameters_ {parameters}
+, haplotypes_ {nullptr}
+, likelihood_cache_ {nullptr}
 {}
 
 template <typename G, typename GPM>
@@ -142,6 +149,12 @@ bool SubcloneModelBase<G, GPM>::is_primed() const noexcept
     return haplotypes_;
 }
 
+template <typename G, typename GPM>
+void SubcloneModelBase<G, GPM>::share_likelihoods(const GenotypeLikelihoodCache& cache) noexcept
+{
+    likelihood_cache_ = std::addressof(cache);
+}
+
 namespace detail {
 
 std::vector<LogProbabilityVector>
@@ -152,7 +165,8 @@ generate_seeds(const std::vector<SampleName>& samples,
                const SubcloneModel::Priors& priors,
                std::size_t max_seeds,
                std::vector<LogProbabilityVector> hints = {},
-               const MappableBlock<Haplotype>* haplotypes = nullptr);
+               const MappableBlock<Haplotype>* haplotypes = nullptr,
+               const GenotypeLikelihoodCache* likelihood_cache = nullptr);
 
 std::vector<LogProbabilityVector>
 generate_seeds(const std::vector<SampleName>& samples,
@@ -162,7 +176,8 @@ generate_seeds(const std::vector<SampleName>& samples,
                const SomaticSubcloneModel::Priors& priors,
                std::size_t max_seeds,
                std::vector<LogProbabilityVector> hints = {},
-               const MappableBlock<Haplotype>* haplotypes = nullptr);
+               const MappableBlock<Haplotype>* haplotypes = nullptr,
+               const GenotypeLikelihoodCache* likelihood_cache = nullptr);
 
 template <std::size_t K, typename G, typename GPM>
 VBAlpha<K> flatten(const typename SubcloneModelBase<G, GPM>::Priors::GenotypeMixturesDirichletAlphas& alpha)
@@ -347,11 +362,12 @@ run_variational_bayes(const std::vector<SampleName>& samples,
                       const typename SubcloneModelBase<G, GPM>::AlgorithmParameters& params,
                       std::vector<typename SubcloneModelBase<G, GPM>::Latents::LogProbabilityVector> hints,
                       const MappableBlock<Haplotype>* haplotypes,
+                      const GenotypeLikelihoodCache* likelihood_cache,
                       typename SubcloneModelBase<G, GPM>::OptionalThreadPool workers)
 {
     constexpr auto max_ploidy = SubcloneModelBase<G, GPM>::max_ploidy;
     auto genotype_log_priors = evaluate(genotypes, priors.genotype_prior_model);
-    auto seeds = generate_seeds(samples, genotypes, genotype_log_priors, haplotype_log_likelihoods, priors, params.max_seeds, std::move(hints), haplotypes);
+    auto seeds = generate_seeds(samples, genotypes, genotype_log_priors, haplotype_log_likelihoods, priors, params.max_seeds, std::move(hints), haplotypes, likelihood_cache);
     return run_variational_bayes_helper<G, GPM>(samples, genotypes, priors.alphas, std::move(genotype_log_priors),
                                                 haplotype_log_likelihoods, params, std::move(seeds), workers,
                                                 make_index_range<1, max_ploidy + 1> {});
@@ -367,7 +383,7 @@ SubcloneModelBase<G, GPM>::evaluate(const std::vector<G>& genotypes,
                                     OptionalThreadPool workers) const
 {
     assert(!genotypes.empty());
-    return detail::run_variational_bayes<G, GPM>(samples_, genotypes, priors_, haplotype_likelihoods, parameters_, std::move(hints), haplotypes_, workers);
+    return detail::run_variational_bayes<G, GPM>(samples_, genotypes, priors_, haplotype_likelihoods, parameters_, std::move(hints), haplotypes_, likelihood_cache_, workers);
 }
 
 } // namespace model
@@ -10,6 +10,9 @@
 #include <cassert>
 #include <string>
 #include <iostream>
+#include <queue>
+#include <unordered_map>
+#include <limits>
 
 #include <boost/iterator/transform_iterator.hpp>
 
@@ -129,8 +132,9 @@ auto compute_likelihoods(const TrioModel::GenotypeVector& genotypes,
                          const ConstantMixtureGenotypeLikelihoodModel& model)
 {
     std::vector<GenotypeIndexProbabilityPair> result(genotypes.size());
+    const auto packed_genotypes = pack(genotypes);
     for (GenotypeIndex idx {0}; idx < static_cast<GenotypeIndex>(genotypes.size()); ++idx) {
-        result[idx] = {model.evaluate(genotypes[idx]), idx};
+        result[idx] = {packed_genotypes ? model.evaluate((*packed_genotypes)[idx]) : model.evaluate(genotypes[idx]), idx};
     }
     return result;
 }
@@ -713,41 +717,210 @@ auto join(const ReducedVectorMap<ParentsProbabilityPair>& parents,
     return result;
 }
 
-auto join(const ReducedVectorMap<ParentsProbabilityPair>& parents,
-          const ReducedVectorMap<GenotypeIndexProbabilityPair>& child,
-          const TrioGenotypeData& genotypes,
-          const DeNovoModel& mutation_model)
+// Calls f with the child-given-parents probability function for the given ploidies
+template <typename F>
+auto visit_child_probability_function(const unsigned child_ploidy, const unsigned maternal_ploidy, const unsigned paternal_ploidy,
+                                      const DeNovoModel& mutation_model, F f)
 {
-    const auto maternal_ploidy = genotypes.maternal[parents.first->maternal].ploidy();
-    const auto paternal_ploidy = genotypes.paternal[parents.first->paternal].ploidy();
-    const auto child_ploidy    = genotypes.child[child.first->genotype].ploidy();
     if (child_ploidy == 1) {
         if (paternal_ploidy == 1) {
             if (maternal_ploidy == 0) {
-                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<1, 0, 1> {mutation_model});
+                return f(ProbabilityOfChildGivenParents<1, 0, 1> {mutation_model});
             }
             if (maternal_ploidy == 1) {
-                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<1, 1, 1> {mutation_model});
+                return f(ProbabilityOfChildGivenParents<1, 1, 1> {mutation_model});
             }
             if (maternal_ploidy == 2) {
-                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<1, 2, 1> {mutation_model});
+                return f(ProbabilityOfChildGivenParents<1, 2, 1> {mutation_model});
             }
         }
     } else if (child_ploidy == 2) {
         if (maternal_ploidy == 2) {
             if (paternal_ploidy == 1) {
-                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<2, 2, 1> {mutation_model});
+                return f(ProbabilityOfChildGivenParents<2, 2, 1> {mutation_model});
             }
             if (paternal_ploidy == 2) {
-                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<2, 2, 2> {mutation_model});
+                return f(ProbabilityOfChildGivenParents<2, 2, 2> {mutation_model});
             }
         }
     } else if (child_ploidy == 3 && maternal_ploidy == 3 && paternal_ploidy == 3) {
-        return join(parents, child, genotypes, ProbabilityOfChildGivenParents<3, 3, 3> {mutation_model});
+        return f(ProbabilityOfChildGivenParents<3, 3, 3> {mutation_model});
     }
     throw std::runtime_error {"TrioModel: unimplemented joint probability function"};
 }
 
+auto join(const ReducedVectorMap<ParentsProbabilityPair>& parents,
+          const ReducedVectorMap<GenotypeIndexProbabilityPair>& child,
+          const TrioGenotypeData& genotypes,
+          const DeNovoModel& mutation_model)
+{
+    const auto maternal_ploidy = genotypes.maternal[parents.first->maternal].ploidy();
+    const auto paternal_ploidy = genotypes.paternal[parents.first->paternal].ploidy();
+    const auto child_ploidy    = genotypes.child[child.first->genotype].ploidy();
+    return visit_child_probability_function(child_ploidy, maternal_ploidy, paternal_ploidy, mutation_model,
+                                            [&] (auto jpdf) { return join(parents, child, genotypes, jpdf); });
+}
+
+// Bounded best-first search of the trio joint space
+
+std::size_t count_joint_genotypes(const TrioGenotypeData& genotypes) noexcept
+{
+    return genotypes.maternal.size() * genotypes.paternal.size() * genotypes.child.size();
+}
+
+struct TrioSearchNode
+{
+    double bound;
+    std::size_t mother, father, child; // ranks in the sorted likelihood vectors
+};
+
+bool operator<(const TrioSearchNode& lhs, const TrioSearchNode& rhs) noexcept
+{
+    return lhs.bound < rhs.bound;
+}
+
+auto sum_probabilities(const std::vector<GenotypeIndexProbabilityPair>& likelihoods)
+{
+    using boost::make_transform_iterator;
+    return maths::log_sum_exp(make_transform_iterator(std::cbegin(likelihoods), ProbabilityGetter {}),
+                              make_transform_iterator(std::cend(likelihoods), ProbabilityGetter {}));
+}
+
+// An upper bound on the log mass of the trios not yet explored. The bound of a trio is the sum of the sample
+// likelihoods, as the parent prior and the probability of the child given the parents are both at most one.
+// The bounds of all trios sum to the product of the sample likelihood masses, so the unexplored bound mass
+// is the difference of that and the explored bound mass; when the difference is lost to rounding the next
+// best bound times the number of unexplored trios is used.
+double calculate_unexplored_log_mass_bound(const double total_bound_log_mass, const double explored_bound_log_mass,
+                                           const double next_bound, const double num_unexplored) noexcept
+{
+    static const double min_log_fraction {std::log(std::numeric_limits<double>::epsilon()) + 10};
+    auto result = total_bound_log_mass + min_log_fraction;
+    if (explored_bound_log_mass < total_bound_log_mass) {
+        result = std::max(total_bound_log_mass + std::log1p(-std::exp(explored_bound_log_mass - total_bound_log_mass)), result);
+    }
+    return std::min(std::log(num_unexplored) + next_bound, result);
+}
+
+template <typename F>
+auto search_joint(const std::vector<GenotypeIndexProbabilityPair>& maternal_likelihoods,
+                  const std::vector<GenotypeIndexProbabilityPair>& paternal_likelihoods,
+                  const std::vector<GenotypeIndexProbabilityPair>& child_likelihoods,
+                  const TrioGenotypeData& genotypes,
+                  const PopulationPriorModel& prior_model,
+                  F jpdf,
+                  const std::size_t max_joint,
+                  const double max_log_probability_loss,
+                  boost::optional<double>& lost_log_mass)
+{
+    // Likelihoods must be sorted in descending order so the bound of a trio is no greater than its predecessor's
+    const auto M = maternal_likelihoods.size(), P = paternal_likelihoods.size(), C = child_likelihoods.size();
+    const auto bound = [&] (std::size_t m, std::size_t p, std::size_t c) {
+        return maternal_likelihoods[m].probability + paternal_likelihoods[p].probability + child_likelihoods[c].probability;
+    };
+    const auto total_bound_log_mass = sum_probabilities(maternal_likelihoods) + sum_probabilities(paternal_likelihoods)
+                                    + sum_probabilities(child_likelihoods);
+    const auto num_trios = static_cast<double>(M) * P * C;
+    std::priority_queue<TrioSearchNode> frontier {};
+    frontier.push({bound(0, 0, 0), 0, 0, 0});
+    std::unordered_map<std::size_t, double> parent_log_priors {};
+    std::vector<JointProbability> result {};
+    result.reserve(std::min(max_joint, M * P * C));
+    auto explored_log_mass = std::numeric_limits<double>::lowest();
+    auto explored_bound_log_mass = explored_log_mass;
+    while (!frontier.empty()) {
+        const auto node = frontier.top();
+        frontier.pop();
+        const auto mother = maternal_likelihoods[node.mother].genotype;
+        const auto father = paternal_likelihoods[node.father].genotype;
+        const auto child  = child_likelihoods[node.child].genotype;
+        auto prior_itr = parent_log_priors.find(mother * P + father);
+        if (prior_itr == std::cend(parent_log_priors)) {
+            const auto prior = joint_probability(genotypes.maternal[mother], genotypes.paternal[father], prior_model);
+            prior_itr = parent_log_priors.emplace(mother * P + father, prior).first;
+        }
+        const auto log_probability = node.bound + prior_itr->second
+                                   + jpdf(genotypes.child[child], genotypes.maternal[mother], genotypes.paternal[father]);
+        result.push_back({log_probability, 0.0, mother, father, child});
+        explored_log_mass = maths::log_sum_exp(explored_log_mass, log_probability);
+        explored_bound_log_mass = maths::log_sum_exp(explored_bound_log_mass, node.bound);
+        // Each trio has exactly one predecessor so is pushed once
+        if (node.child + 1 < C) {
+            frontier.push({bound(node.mother, node.father, node.child + 1), node.mother, node.father, node.child + 1});
+        }
+        if (node.child == 0 && node.father + 1 < P) {
+            frontier.push({bound(node.mother, node.father + 1, 0), node.mother, node.father + 1, 0});
+        }
+        if (node.child == 0 && node.father == 0 && node.mother + 1 < M) {
+            frontier.push({bound(node.mother + 1, 0, 0), node.mother + 1, 0, 0});
+        }
+        if (frontier.empty()) break;
+        const auto unexplored_log_mass = calculate_unexplored_log_mass_bound(total_bound_log_mass, explored_bound_log_mass,
+                                                                             frontier.top().bound, num_trios - result.size());
+        const auto unexplored_log_fraction = unexplored_log_mass - maths::log_sum_exp(explored_log_mass, unexplored_log_mass);
+        if (unexplored_log_fraction < max_log_probability_loss || result.size() >= max_joint) {
+            lost_log_mass = unexplored_log_fraction;
+            break;
+        }
+    }
+    return result;
+}
+
+template <typename Container>
+auto find_homozygous_reference(const Container& genotypes)
+{
+    const auto itr = std::find_if(std::cbegin(genotypes), std::cend(genotypes),
+                                  [] (const auto& genotype) { return is_homozygous_reference(genotype); });
+    return static_cast<GenotypeIndex>(std::distance(std::cbegin(genotypes), itr));
+}
+
+void sort_by_probability(std::vector<GenotypeIndexProbabilityPair>& likelihoods)
+{
+    std::sort(std::begin(likelihoods), std::end(likelihoods), std::greater<> {});
+}
+
+auto search_joint(std::vector<GenotypeIndexProbabilityPair>& maternal_likelihoods,
+                  std::vector<GenotypeIndexProbabilityPair>& paternal_likelihoods,
+                  std::vector<GenotypeIndexProbabilityPair>& child_likelihoods,
+                  const TrioGenotypeData& genotypes,
+                  const PopulationPriorModel& prior_model,
+                  const DeNovoModel& mutation_model,
+                  const TrioModel::Options& options,
+                  boost::optional<double>& lost_log_mass)
+{
+    assert(options.max_genotype_combinations);
+    sort_by_probability(maternal_likelihoods);
+    sort_by_probability(paternal_likelihoods);
+    sort_by_probability(child_likelihoods);
+    const auto maternal_ploidy = genotypes.maternal.front().ploidy();
+    const auto paternal_ploidy = genotypes.paternal.front().ploidy();
+    const auto child_ploidy    = genotypes.child.front().ploidy();
+    return visit_child_probability_function(child_ploidy, maternal_ploidy, paternal_ploidy, mutation_model, [&] (auto jpdf) {
+        auto result = search_joint(maternal_likelihoods, paternal_likelihoods, child_likelihoods,
+                                   genotypes, prior_model, jpdf, *options.max_genotype_combinations,
+                                   options.max_joint_log_probability_loss, lost_log_mass);
+        // Make sure the hom-ref trio survives - if present - to get nice QUALs
+        const auto mother = find_homozygous_reference(genotypes.maternal);
+        const auto father = find_homozygous_reference(genotypes.paternal);
+        const auto child  = find_homozygous_reference(genotypes.child);
+        if (mother < genotypes.maternal.size() && father < genotypes.paternal.size() && child < genotypes.child.size()) {
+            const auto is_reference_trio = [&] (const auto& p) { return p.maternal == mother && p.paternal == father && p.child == child; };
+            if (std::none_of(std::cbegin(result), std::cend(result), is_reference_trio)) {
+                const auto find_likelihood = [] (const auto& likelihoods, const GenotypeIndex genotype) {
+                    return std::find_if(std::cbegin(likelihoods), std::cend(likelihoods),
+                                        [=] (const auto& p) { return p.genotype == genotype; })->probability;
+                };
+                const auto log_probability = find_likelihood(maternal_likelihoods, mother) + find_likelihood(paternal_likelihoods, father)
+                                           + find_likelihood(child_likelihoods, child)
+                                           + joint_probability(genotypes.maternal[mother], genotypes.paternal[father], prior_model)
+                                           + jpdf(genotypes.child[child], genotypes.maternal[mother], genotypes.paternal[father]);
+                result.push_back({log_probability, 0.0, mother, father, child});
+            }
+        }
+        return result;
+    });
+}
+
 auto extract_probabilities(const std::vector<JointProbability>& joint_likelihoods)
 {
     std::vector<double> result(joint_likelihoods.size());
@@ -818,6 +991,13 @@ TrioModel::evaluate(const GenotypeVector& maternal_genotypes,
         debug::print(stream(*debug_log_), "child", genotypes.child, child_likelihoods);
     }
     boost::optional<double> lost_log_mass {};
+    if (options_.max_genotype_combinations && count_joint_genotypes(genotypes) > *options_.max_genotype_combinations) {
+        auto joint_likelihoods = search_joint(maternal_likelihoods, paternal_likelihoods, child_likelihoods, genotypes,
+                                              prior_model_, mutation_model_, options_, lost_log_mass);
+        if (debug_log_) debug::print(stream(*debug_log_), genotypes, joint_likelihoods);
+        const auto evidence = normalise_exp(joint_likelihoods);
+        return {std::move(joint_likelihoods), evidence, lost_log_mass};
+    }
     auto reduced_maternal_likelihoods = maternal_likelihoods;
     const auto reduced_maternal_likelihoods_info = reduce(reduced_maternal_likelihoods, prior_model_, lost_log_mass, options_, genotypes.maternal);
     auto reduced_paternal_likelihoods = paternal_likelihoods;
@@ -27,18 +27,15 @@ VariationalBayesMixtureMixtureModel::evaluate(const LogProbabilityVector& genoty
                                               const GroupOptionalPriorArray& group_priors,
                                               const GroupConcentrationVector& group_concentrations,
                                               const MixtureConcentrationArray& mixture_concentrations,
-                                              std::vector<LogProbabilityVector> seeds) const
+                                              std::vector<LogProbabilityVector> seeds,
+                                              OptionalThreadPool workers) const
 {
     const auto group_log_priors = to_logs(group_priors);
-    const auto expanded_log_likelihoods = expand(log_likelihoods);
+    const auto expanded_log_likelihoods = expand(log_likelihoods, workers);
     const auto evaluate_seed = [&] (auto&& seed) {
         return this->evaluate(genotype_log_priors, log_likelihoods, expanded_log_likelihoods, group_log_priors, group_concentrations, mixture_concentrations, std::move(seed)); };
     std::vector<PointInferences> seed_inferences(seeds.size());
-    if (options_.parallel_execution) {
-        parallel_transform(std::make_move_iterator(std::begin(seeds)), std::make_move_iterator(std::end(seeds)), std::begin(seed_inferences), evaluate_seed);
-    } else {
-        std::transform(std::make_move_iterator(std::begin(seeds)), std::make_move_iterator(std::end(seeds)), std::begin(seed_inferences), evaluate_seed);
-    }
+    parallel_transform(std::make_move_iterator(std::begin(seeds)), std::make_move_iterator(std::end(seeds)), std::begin(seed_inferences), evaluate_seed, workers);
     Inferences result {};
     compute_evidence_weighted_latents(result.weighted_genotype_posteriors, result.weighted_group_responsibilities, seed_inferences);
     const static auto evidence_less = [] (const auto& lhs, const auto& rhs) { return lhs.approx_log_evidence < rhs.approx_log_evidence; };
@@ -51,11 +48,12 @@ VariationalBayesMixtureMixtureModel::evaluate(const LogProbabilityVector& genoty
                                               const HaplotypeLikelihoodMatrix& log_likelihoods,
                                               const GroupConcentrationVector& group_concentrations,
                                               const MixtureConcentrationArray& mixture_concentrations,
-                                              std::vector<LogProbabilityVector> seeds) const
+                                              std::vector<LogProbabilityVector> seeds,
+                                              OptionalThreadPool workers) const
 {
     const auto num_samples = log_likelihoods.size();
     const GroupOptionalPriorArray no_priors(num_samples);
-    return evaluate(genotype_log_priors, log_likelihoods, no_priors, group_concentrations, mixture_concentrations, std::move(seeds));
+    return evaluate(genotype_log_priors, log_likelihoods, no_priors, group_concentrations, mixture_concentrations, std::move(seeds), workers);
 }
 
 VariationalBayesMixtureMixtureModel::Inferences
@@ -64,7 +62,8 @@ VariationalBayesMixtureMixtureModel::evaluate(const LogProbabilityVector& genoty
                                               const GroupOptionalPriorArray& group_priors,
                                               const double group_concentration,
                                               const std::vector<double>& mixture_concentrations,
-                                              std::vector<LogProbabilityVector> seeds) const
+                                              std::vector<LogProbabilityVector> seeds,
+                                              OptionalThreadPool workers) const
 {
     const auto num_samples = log_likelihoods.size();
     assert(mixture_concentrations.size() == num_samples);
@@ -84,7 +83,7 @@ VariationalBayesMixtureMixtureModel::evaluate(const LogProbabilityVector& genoty
             sample_group_sample_concentrations.assign(group_mixture_sizes[t++], sample_concentration);
         }
     }
-    return evaluate(genotype_log_priors, log_likelihoods, group_priors, group_concentrations, group_mixture_concentrations, std::move(seeds));
+    return evaluate(genotype_log_priors, log_likelihoods, group_priors, group_concentrations, group_mixture_concentrations, std::move(seeds), workers);
 }
 
 VariationalBayesMixtureMixtureModel::Inferences
@@ -92,11 +91,12 @@ VariationalBayesMixtureMixtureModel::evaluate(const LogProbabilityVector& genoty
                                               const HaplotypeLikelihoodMatrix& log_likelihoods,
                                               const double group_concentration,
                                               const std::vector<double>& mixture_concentrations,
-                                              std::vector<LogProbabilityVector> seeds) const
+                                              std::vector<LogProbabilityVector> seeds,
+                                              OptionalThreadPool workers) const
 {
     const auto num_samples = log_likelihoods.size();
     const GroupOptionalPriorArray no_priors(num_samples);
-    return evaluate(genotype_log_priors, log_likelihoods, no_priors, group_concentration, mixture_concentrations, std::move(seeds));
+    return evaluate(genotype_log_priors, log_likelihoods, no_priors, group_concentration, mixture_concentrations, std::move(seeds), workers);
 }
 
 VariationalBayesMixtureMixtureModel::Inferences
@@ -105,7 +105,8 @@ VariationalBayesMixtureMixtureModel::evaluate(const LogProbabilityVector& genoty
                                               const GroupOptionalPriorArray& group_priors,
                                               const double group_concentration,
                                               const double mixture_concentration,
-                                              std::vector<LogProbabilityVector> seeds) const
+                                              std::vector<LogProbabilityVector> seeds,
+                                              OptionalThreadPool workers) const
 {
     const auto num_samples = log_likelihoods.size();
     const auto num_groups = log_likelihoods.front().front().size();
@@ -122,7 +123,7 @@ VariationalBayesMixtureMixtureModel::evaluate(const LogProbabilityVector& genoty
             sample_group_sample_concentrations.assign(group_mixture_sizes[t++], mixture_concentration);
         }
     }
-    return evaluate(genotype_log_priors, log_likelihoods, group_priors, group_concentrations, mixture_concentrations, std::move(seeds));
+    return evaluate(genotype_log_priors, log_likelihoods, group_priors, group_concentrations, mixture_concentrations, std::move(seeds), workers);
 }
 
 VariationalBayesMixtureMixtureModel::Inferences
@@ -130,11 +131,12 @@ VariationalBayesMixtureMixtureModel::evaluate(const LogProbabilityVector& genoty
                                               const HaplotypeLikelihoodMatrix& log_likelihoods,
                                               const double group_concentration,
                                               const double mixture_concentration,
-                                              std::vector<LogProbabilityVector> seeds) const
+                                              std::vector<LogProbabilityVector> seeds,
+                                              OptionalThreadPool workers) const
 {
     const auto num_samples = log_likelihoods.size();
     const GroupOptionalPriorArray no_priors(num_samples);
-    return evaluate(genotype_log_priors, log_likelihoods, no_priors, group_concentration, mixture_concentration, std::move(seeds));
+    return evaluate(genotype_log_priors, log_likelihoods, no_priors, group_concentration, mixture_concentration, std::move(seeds), workers);
 }
 
 // Private methods
@@ -165,26 +167,29 @@ VariationalBayesMixtureMixtureModel::to_logs(const GroupOptionalPriorArray& prio
 }
 
 VariationalBayesMixtureMixtureModel::ExpandedHaplotypeLikelihoodMatrix 
-VariationalBayesMixtureMixtureModel::expand(const HaplotypeLikelihoodMatrix& likelihoods) const
+VariationalBayesMixtureMixtureModel::expand(const HaplotypeLikelihoodMatrix& likelihoods, OptionalThreadPool workers) const
 {
     const auto S = likelihoods.size();
     const auto G = likelihoods[0].size();
     const auto T = likelihoods[0][0].size();
-    ExpandedHaplotypeLikelihoodMatrix result(S, ExpandedGroupLikelihoodVector(T));
-    for (std::size_t s {0}; s < S; ++s) {
-        const auto N = likelihoods[s][0][0][0].size();
+    const auto expand_sample = [&] (const GenotypeCombinationLikelihoodVector& sample_likelihoods) {
+        const auto N = sample_likelihoods[0][0][0].size();
+        ExpandedGroupLikelihoodVector result(T);
         for (std::size_t t {0}; t < T; ++t) {
             const auto K = likelihoods[0][0][t].size();
-            result[s][t].assign(K, ExpandedGenotype(N, ExpandedLikelihood(G)));
+            result[t].assign(K, ExpandedGenotype(N, ExpandedLikelihood(G)));
             for (std::size_t k {0}; k < K; ++k) {
                 for (std::size_t g {0}; g < G; ++g) {
                     for (std::size_t n {0}; n < N; ++n) {
-                        result[s][t][k][n][g] = likelihoods[s][g][t][k][n];
+                        result[t][k][n][g] = sample_likelihoods[g][t][k][n];
                     }
                 }
             }
         }
-    }
+        return result;
+    };
+    ExpandedHaplotypeLikelihoodMatrix result(S);
+    parallel_transform(std::cbegin(likelihoods), std::cend(likelihoods), std::begin(result), expand_sample, workers);
     return result;
 }
 
@@ -243,6 +248,12 @@ T log_sum_exp(const std::vector<T>& logs)
     return maths::log_sum_exp(logs);
 }
 
+// Cells with no reads in the window (i.e. dropouts) add nothing to any genotype dependent term
+bool has_reads(const VariationalBayesMixtureMixtureModel::GenotypeCombinationLikelihoodVector& sample_likelihoods) noexcept
+{
+    return sample_likelihoods[0][0][0].size() > 0;
+}
+
 bool all_equal_sizes(const VariationalBayesMixtureMixtureModel::MixtureConcentrationVector& concentrations) noexcept
 {
     const auto size_unequal = [] (const auto& lhs, const auto& rhs) { return lhs.size() != rhs.size(); };
@@ -352,6 +363,7 @@ VariationalBayesMixtureMixtureModel::init_responsibilities(const GroupOptionalLo
                     approx_taus[k][n] = approx_tau[k];
                 }
             }
+            if (!has_reads(log_likelihoods[s])) continue;
             for (std::size_t k {0}; k < K; ++k) {
                 for (std::size_t g {0}; g < G; ++g) {
                     result[s][t] += genotype_priors[g] * inner_product(approx_taus[k], log_likelihoods[s][g][t][k]);
@@ -384,6 +396,7 @@ VariationalBayesMixtureMixtureModel::update_responsibilities(GroupResponsibility
             const auto ln_ex_pi = dirichlet_expectation_log(mixture_concentrations[s][t]);
             const auto K = ln_ex_pi.size();
             result[s][t] += sum(ln_ex_pi);
+            if (!has_reads(log_likelihoods[s])) continue;
             for (std::size_t k {0}; k < max_K; ++k) {
                 for (std::size_t g {0}; g < G; ++g) {
                     if (k < K) {
@@ -508,6 +521,7 @@ VariationalBayesMixtureMixtureModel::marginalise(const GroupResponsibilityVector
     const auto S = component_responsibilities.size();
     LogProbability result {0};
     for (std::size_t s {0}; s < S; ++s) {
+        if (!has_reads(log_likelihoods[s])) continue;
         for (std::size_t t {0}; t < T; ++t) {
             result += group_responsibilities[s][t] * marginalise(component_responsibilities[s][t], log_likelihoods[s][g][t]);
         }
@@ -604,6 +618,7 @@ VariationalBayesMixtureMixtureModel::calculate_evidence(const GroupConcentration
     for (std::size_t g {0}; g < G; ++g) {
         auto w = genotype_log_priors[g] - genotype_log_posteriors[g];
         for (std::size_t s {0}; s < S; ++s) {
+            if (!has_reads(log_likelihoods[s])) continue;
             double ss {0};
             for (std::size_t t {0}; t < T; ++t) {
                 ss += group_responsibilities[s][t] * marginalise(component_responsibilities[s][t], log_likelihoods[s][g][t]);
@@ -23,7 +23,6 @@ public:
         double epsilon = 0.05;
         unsigned max_iterations = 1000;
         double save_memory = false;
-        bool parallel_execution = false;
     };
     
     using Probability = double;
@@ -48,6 +47,8 @@ public:
     using GroupOptionalPriorVector = boost::optional<ProbabilityVector>; // One element per group
     using GroupOptionalPriorArray = std::vector<GroupOptionalPriorVector>; // One element per sample
     
+    using OptionalThreadPool = boost::optional<ThreadPool&>;
+    
     using Tau = std::vector<double>; // One element per read
     using ComponentResponsibilityVector = std::vector<Tau>; // One element per haplotype in genotype (max)
     using ComponentResponsibilityVectorArray = std::vector<ComponentResponsibilityVector>; // One element per group
@@ -92,14 +93,16 @@ public:
              const GroupOptionalPriorArray& group_priors,
              const GroupConcentrationVector& group_concentrations,
              const MixtureConcentrationArray& mixture_concentrations,
-             std::vector<LogProbabilityVector> seeds) const;
+             std::vector<LogProbabilityVector> seeds,
+             OptionalThreadPool workers = boost::none) const;
     
     Inferences
     evaluate(const LogProbabilityVector& genotype_log_priors,
              const HaplotypeLikelihoodMatrix& log_likelihoods,
              const GroupConcentrationVector& group_concentrations,
              const MixtureConcentrationArray& mixture_concentrations,
-             std::vector<LogProbabilityVector> seeds) const;
+             std::vector<LogProbabilityVector> seeds,
+             OptionalThreadPool workers = boost::none) const;
     
     Inferences
     evaluate(const LogProbabilityVector& genotype_log_priors,
@@ -107,14 +110,16 @@ public:
              const GroupOptionalPriorArray& group_priors,
              double group_concentration,
              const std::vector<double>& mixture_concentrations,
-             std::vector<LogProbabilityVector> seeds) const;
+             std::vector<LogProbabilityVector> seeds,
+             OptionalThreadPool workers = boost::none) const;
     
     Inferences
     evaluate(const LogProbabilityVector& genotype_log_priors,
              const HaplotypeLikelihoodMatrix& log_likelihoods,
              double group_concentration,
              const std::vector<double>& mixture_concentrations,
-             std::vector<LogProbabilityVector> seeds) const;
+             std::vector<LogProbabilityVector> seeds,
+             OptionalThreadPool workers = boost::none) const;
     
     Inferences
     evaluate(const LogProbabilityVector& genotype_log_priors,
@@ -122,14 +127,16 @@ public:
              const GroupOptionalPriorArray& group_priors,
              double group_concentration,
              double mixture_concentration,
-             std::vector<LogProbabilityVector> seeds) const;
+             std::vector<LogProbabilityVector> seeds,
+             OptionalThreadPool workers = boost::none) const;
     
     Inferences
     evaluate(const LogProbabilityVector& genotype_log_priors,
              const HaplotypeLikelihoodMatrix& log_likelihoods,
              double group_concentration,
              double mixture_concentration,
-             std::vector<LogProbabilityVector> seeds) const;
+             std::vector<LogProbabilityVector> seeds,
+             OptionalThreadPool workers = boost::none) const;
     
 private:
     using GroupOptionalLogPriorVector = boost::optional<LogProbabilityVector>; // One element per group
@@ -145,7 +152,7 @@ private:
     
     GroupOptionalLogPriorVector to_logs(const GroupOptionalPriorVector& prior) const;
     GroupOptionalLogPriorArray to_logs(const GroupOptionalPriorArray& priors) const;
-    ExpandedHaplotypeLikelihoodMatrix expand(const HaplotypeLikelihoodMatrix& likelihoods) const;
+    ExpandedHaplotypeLikelihoodMatrix expand(const HaplotypeLikelihoodMatrix& likelihoods, OptionalThreadPool workers) const;
     PointInferences
     evaluate(const LogProbabilityVector& genotype_log_priors,
              const HaplotypeLikelihoodMatrix& log_likelihoods,
@@ -14,15 +14,20 @@
 #include <cassert>
 #include <limits>
 #include <type_traits>
+#include <atomic>
 
 #include <boost/optional.hpp>
-#include <boost/math/special_functions/digamma.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif // defined(__SSE2__)
 
 #include "core/models/haplotype_likelihood_array.hpp"
 #include "utils/maths.hpp"
 #include "utils/memory_footprint.hpp"
 #include "utils/parallel_transform.hpp"
 #include "utils/thread_pool.hpp"
+#include "utils/huge_page_allocator.hpp"
 
 
 /**
@@ -41,6 +46,8 @@ struct VariationalBayesParameters
     double epsilon = 0.05;
     unsigned max_iterations = 1000;
     bool save_memory = false;
+    // A seed is abandoned once its evidence lower bound is this far below the best converged seed
+    boost::optional<double> max_seed_log_evidence_deficit = 50.0;
 };
 
 using ProbabilityVector    = std::vector<double>;
@@ -85,7 +92,7 @@ using VBGenotypeVector = std::vector<VBGenotype<K>>; // Per element per genotype
 template <std::size_t K>
 using VBReadLikelihoodMatrix = std::vector<VBGenotypeVector<K>>; // One element per sample
 
-using VBTau = std::vector<VBReadLikelihoodArray::BaseType::value_type>; // One element per read
+using VBTau = HugePageVector<VBReadLikelihoodArray::BaseType::value_type>; // One element per read
 template <std::size_t K>
 using VBResponsibilityVector = std::array<VBTau, K>; // One element per haplotype in genotype (i.e. K)
 template <std::size_t K>
@@ -105,7 +112,40 @@ struct VBLatents
 namespace detail {
 
 using VBExpandedLikelihood = std::vector<float>; // One element per genotype
-using VBExpandedGenotype = std::vector<VBExpandedLikelihood>; // One element per read
+
+// The likelihoods of every read (rows) under every genotype (columns) for one haplotype in genotype,
+// stored contiguously so the likelihoods of a read can be marginalised over genotypes in one pass.
+class VBExpandedGenotype
+{
+public:
+    using value_type = VBExpandedLikelihood::value_type;
+    
+    VBExpandedGenotype() = default;
+    
+    VBExpandedGenotype(std::size_t num_reads, std::size_t num_genotypes)
+    : num_reads_ {num_reads}
+    , num_genotypes_ {num_genotypes}
+    , likelihoods_(num_reads * num_genotypes)
+    {}
+    
+    VBExpandedGenotype(const VBExpandedGenotype&)            = default;
+    VBExpandedGenotype& operator=(const VBExpandedGenotype&) = default;
+    VBExpandedGenotype(VBExpandedGenotype&&)                 = default;
+    VBExpandedGenotype& operator=(VBExpandedGenotype&&)      = default;
+    
+    ~VBExpandedGenotype() = default;
+    
+    std::size_t size() const noexcept { return num_reads_; } // num reads
+    std::size_t num_genotypes() const noexcept { return num_genotypes_; }
+    
+    const value_type* operator[](const std::size_t n) const noexcept { return likelihoods_.data() + n * num_genotypes_; }
+    value_type* operator[](const std::size_t n) noexcept { return likelihoods_.data() + n * num_genotypes_; }
+    
+private:
+    std::size_t num_reads_ = 0, num_genotypes_ = 0;
+    HugePageVector<value_type> likelihoods_;
+};
+
 template <std::size_t K>
 using VBExpandedGenotypeVector = std::array<VBExpandedGenotype, K>; // One element per haplotype in genotype
 template <std::size_t K>
@@ -120,10 +160,11 @@ auto invert(const VBGenotypeVector<K>& likelihoods)
     const auto num_reads = likelihoods.front().front().size();
     VBExpandedGenotypeVector<K> result {};
     for (std::size_t k {0}; k < K; ++k) {
-        result[k] = VBExpandedGenotype(num_reads, VBExpandedLikelihood(num_genotypes));
-        for (std::size_t n {0}; n < num_reads; ++n) {
-            for (std::size_t g {0}; g < num_genotypes; ++g) {
-                result[k][n][g] = likelihoods[g][k][n];
+        result[k] = VBExpandedGenotype {num_reads, num_genotypes};
+        for (std::size_t g {0}; g < num_genotypes; ++g) {
+            const auto& genotype_likelihoods = likelihoods[g][k];
+            for (std::size_t n {0}; n < num_reads; ++n) {
+                result[k][n][g] = genotype_likelihoods[n];
             }
         }
     }
@@ -140,10 +181,52 @@ auto invert(const VBReadLikelihoodMatrix<K>& matrix)
     return result;
 }
 
+#if defined(__SSE2__)
+
+inline __m128 load_quad(const float* values) noexcept
+{
+    return _mm_loadu_ps(values);
+}
+
+inline __m128 load_quad(const double* values) noexcept
+{
+    return _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(values)), _mm_cvtpd_ps(_mm_loadu_pd(values + 2)));
+}
+
+inline void store_quad(const __m128 values, float* result) noexcept
+{
+    _mm_storeu_ps(result, values);
+}
+
+inline void store_quad(const __m128 values, double* result) noexcept
+{
+    _mm_storeu_pd(result, _mm_cvtps_pd(values));
+    _mm_storeu_pd(result + 2, _mm_cvtps_pd(_mm_movehl_ps(values, values)));
+}
+
+#endif // defined(__SSE2__)
+
+inline float dot_product(const float* lhs, const float* rhs, const std::size_t n) noexcept
+{
+    std::size_t i {0};
+    float result {0};
+    #if defined(__SSE2__)
+    auto sums = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        sums = _mm_add_ps(sums, _mm_mul_ps(_mm_loadu_ps(lhs + i), _mm_loadu_ps(rhs + i)));
+    }
+    sums = _mm_add_ps(sums, _mm_movehl_ps(sums, sums));
+    sums = _mm_add_ss(sums, _mm_shuffle_ps(sums, sums, 1));
+    result = _mm_cvtss_f32(sums);
+    #endif // defined(__SSE2__)
+    for (; i < n; ++i) result += lhs[i] * rhs[i];
+    return result;
+}
+
 inline ProbabilityVector& exp(const LogProbabilityVector& log_probabilities, ProbabilityVector& result) noexcept
 {
-    std::transform(std::cbegin(log_probabilities), std::cend(log_probabilities), std::begin(result),
-                   [] (const auto lp) noexcept { return std::exp(lp); });
+    std::copy(std::cbegin(log_probabilities), std::cend(log_probabilities), std::begin(result));
+    maths::fast_exp_each(result);
     return result;
 }
 
@@ -174,10 +257,10 @@ template <typename T, std::size_t K>
 auto compute_digamma_diffs(const std::array<T, K>& alphas)
 {
     std::array<T, K> result;
-    using boost::math::digamma;
-    const auto digamma_a0 = digamma(sum(alphas));
+    using maths::fast_digamma;
+    const auto digamma_a0 = fast_digamma(sum(alphas));
     for (unsigned k {0}; k < K; ++k) {
-        result[k] = digamma(alphas[k]) - digamma_a0;
+        result[k] = fast_digamma(alphas[k]) - digamma_a0;
     }
     return result;
 }
@@ -214,71 +297,72 @@ auto inner_product(const T1& lhs, const T2& rhs) noexcept
     return std::inner_product(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs), T {0});
 }
 
-template <typename ProbabilityVector_, std::size_t K>
-auto marginalise(const ProbabilityVector_& distribution, const VBExpandedGenotypeVector<K>& likelihoods,
+template <std::size_t K>
+auto marginalise(const VBExpandedLikelihood& distribution, const VBExpandedGenotypeVector<K>& likelihoods,
                  const unsigned k, const std::size_t n) noexcept
 {
-    return inner_product(distribution, likelihoods[k][n]);
+    assert(distribution.size() == likelihoods[k].num_genotypes());
+    return dot_product(distribution.data(), likelihoods[k][n], distribution.size());
 }
 
-template <std::size_t K, typename T, typename ProbabilityVector_, typename VBLikelihoodGenotypeVector>
-void
-update_responsibilities_helper(VBResponsibilityVector<K>& result,
-                               const std::array<T, K>& al,
-                               const ProbabilityVector_& genotype_probabilities,
-                               const VBLikelihoodGenotypeVector& read_likelihoods,
-                               std::true_type)
+// Replaces the unnormalised log responsibilities of each read with the normalised responsibilities
+template <std::size_t K>
+void normalise_responsibilities(VBResponsibilityVector<K>& ln_rho) noexcept
 {
-    const auto N = count_reads(read_likelihoods);
-    std::array<T, K> ln_rho;
-    for (std::size_t n {0}; n < N; ++n) {
-        for (unsigned k {0}; k < K; ++k) {
-            ln_rho[k] = al[k] + marginalise(genotype_probabilities, read_likelihoods, k, n);
-        }
-        const auto ln_rho_norm = maths::fast_log_sum_exp(ln_rho);
+    const auto N = ln_rho[0].size();
+    std::size_t n {0};
+    #if defined(__SSE2__)
+    // Four reads at a time
+    for (; n + 4 <= N; n += 4) {
+        std::array<__m128, K> rho;
+        for (unsigned k {0}; k < K; ++k) rho[k] = load_quad(ln_rho[k].data() + n);
+        auto max_ln_rho = rho[0];
+        for (unsigned k {1}; k < K; ++k) max_ln_rho = _mm_max_ps(max_ln_rho, rho[k]);
+        auto norm = _mm_setzero_ps();
         for (unsigned k {0}; k < K; ++k) {
-            result[k][n] = maths::fast_exp(ln_rho[k] - ln_rho_norm);
+            rho[k] = fmath::exp_ps(_mm_sub_ps(rho[k], max_ln_rho));
+            norm = _mm_add_ps(norm, rho[k]);
         }
+        for (unsigned k {0}; k < K; ++k) store_quad(_mm_div_ps(rho[k], norm), ln_rho[k].data() + n);
+    }
+    #endif // defined(__SSE2__)
+    using T = VBTau::value_type;
+    std::array<T, K> rho;
+    for (; n < N; ++n) {
+        for (unsigned k {0}; k < K; ++k) rho[k] = ln_rho[k][n];
+        const auto ln_rho_norm = maths::fast_log_sum_exp(rho);
+        for (unsigned k {0}; k < K; ++k) ln_rho[k][n] = maths::fast_exp(rho[k] - ln_rho_norm);
     }
 }
 
-template <std::size_t K, typename T, typename ProbabilityVector_>
+template <std::size_t K, typename T, typename ProbabilityVector_, typename VBLikelihoodGenotypeVector>
 void
 update_responsibilities_helper(VBResponsibilityVector<K>& result,
                                const std::array<T, K>& al,
                                const ProbabilityVector_& genotype_probabilities,
-                               const VBExpandedGenotypeVector<K>& read_likelihoods,
-                               std::false_type)
+                               const VBLikelihoodGenotypeVector& read_likelihoods)
 {
-    using LikelihoodType = VBExpandedLikelihood::value_type;
-    const std::vector<LikelihoodType> demoted_genotype_probabilities {std::cbegin(genotype_probabilities), std::cend(genotype_probabilities)};
-    update_responsibilities_helper(result, al, demoted_genotype_probabilities, read_likelihoods, std::true_type {});
+    const auto N = count_reads(read_likelihoods);
+    for (unsigned k {0}; k < K; ++k) {
+        for (std::size_t n {0}; n < N; ++n) {
+            result[k][n] = al[k] + marginalise(genotype_probabilities, read_likelihoods, k, n);
+        }
+    }
+    normalise_responsibilities(result);
 }
 
-template <std::size_t K, typename T, typename ProbabilityVector_>
+template <std::size_t K, typename T>
 void
 update_responsibilities_helper(VBResponsibilityVector<K>& result,
                                const std::array<T, K>& al,
-                               const ProbabilityVector_& genotype_probabilities,
+                               const ProbabilityVector& genotype_probabilities,
                                const VBExpandedGenotypeVector<K>& read_likelihoods)
 {
     // For the expanded likelihood array, the inner product between likelihoods and genotype
-    // posteriors - a key bottleneck in the responsibility update calculate - can be vectorised.
-    // To ensure optimal execution the floating point types of the genotype probabilities and likelihoods should match.
-    using ProbabilityType = typename ProbabilityVector_::value_type;
-    using LikelihoodType = VBExpandedLikelihood::value_type;
-    update_responsibilities_helper(result, al, genotype_probabilities, read_likelihoods,
-                                   std::is_same<ProbabilityType, LikelihoodType> {});
-}
-
-template <std::size_t K, typename T, typename VBLikelihoodGenotypeVector, typename ProbabilityVector_>
-void
-update_responsibilities_helper(VBResponsibilityVector<K>& result,
-                               const std::array<T, K>& al,
-                               const ProbabilityVector_& genotype_probabilities,
-                               const VBLikelihoodGenotypeVector& read_likelihoods)
-{
-    update_responsibilities_helper(result, al, genotype_probabilities, read_likelihoods, std::true_type {});
+    // posteriors - a key bottleneck in the responsibility update calculate - is vectorised.
+    // This requires the floating point types of the genotype probabilities and likelihoods to match.
+    const VBExpandedLikelihood demoted_genotype_probabilities {std::cbegin(genotype_probabilities), std::cend(genotype_probabilities)};
+    update_responsibilities_helper<K, T, VBExpandedLikelihood>(result, al, demoted_genotype_probabilities, read_likelihoods);
 }
 
 template <std::size_t K, typename VBLikelihoodGenotypeVector>
@@ -331,8 +415,8 @@ init_responsibilities(const VBAlphaVector<K>& prior_alphas,
     return result;
 }
 
-template <typename T>
-inline auto sum(const std::vector<T>& values) noexcept
+template <typename T, typename A>
+inline auto sum(const std::vector<T, A>& values) noexcept
 {
     return std::accumulate(std::cbegin(values), std::cend(values), T {});
 }
@@ -398,14 +482,14 @@ void update_genotype_log_posteriors(LogProbabilityVector& result,
     for (std::size_t g {0}; g < G; ++g) {
         result[g] = genotype_log_priors[g] + marginalise(responsibilities, read_likelihoods, g);
     }
-    maths::normalise_logs(result);
+    maths::fast_normalise_logs(result);
 }
 
 inline auto entropy(const VBTau& tau) noexcept
 {
     using T = VBTau::value_type;
     return -std::accumulate(std::cbegin(tau), std::cend(tau), T {0},
-                            [] (const auto curr, const auto t) noexcept { return curr + (t * std::log(t)); });
+                            [] (const auto curr, const auto t) noexcept { return t > 0 ? curr + (t * std::log(t)) : curr; });
 }
 
 // E [ln q(Z_s)]
@@ -448,6 +532,38 @@ auto calculate_evidence_lower_bound(const VBAlphaVector<K>& prior_alphas,
 
 // Main algorithm - single seed
 
+// The greatest evidence lower bound of any converged seed, shared by seeds run concurrently
+class SeedLogEvidenceBound
+{
+public:
+    SeedLogEvidenceBound() = default;
+    
+    SeedLogEvidenceBound(const SeedLogEvidenceBound&)            = delete;
+    SeedLogEvidenceBound& operator=(const SeedLogEvidenceBound&) = delete;
+    SeedLogEvidenceBound(SeedLogEvidenceBound&&)                 = delete;
+    SeedLogEvidenceBound& operator=(SeedLogEvidenceBound&&)      = delete;
+    
+    ~SeedLogEvidenceBound() = default;
+    
+    double get() const noexcept { return max_log_evidence_.load(std::memory_order_relaxed); }
+    
+    void update(const double log_evidence) noexcept
+    {
+        auto curr = get();
+        while (log_evidence > curr && !max_log_evidence_.compare_exchange_weak(curr, log_evidence, std::memory_order_relaxed));
+    }
+    
+private:
+    std::atomic<double> max_log_evidence_ {std::numeric_limits<double>::lowest()};
+};
+
+inline bool is_dominated(const double log_evidence, const SeedLogEvidenceBound* bound,
+                         const VariationalBayesParameters& params) noexcept
+{
+    return bound && params.max_seed_log_evidence_deficit
+           && log_evidence < bound->get() - *params.max_seed_log_evidence_deficit;
+}
+
 // Starting iteration with given genotype_log_posteriors
 template <std::size_t K, typename VBLikelihoodMatrix1, typename VBLikelihoodMatrix2>
 VBLatents<K>
@@ -456,7 +572,8 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
                       const VBLikelihoodMatrix1& log_likelihoods1,
                       const VBLikelihoodMatrix2& log_likelihoods2,
                       LogProbabilityVector genotype_log_posteriors,
-                      const VariationalBayesParameters& params)
+                      const VariationalBayesParameters& params,
+                      SeedLogEvidenceBound* bound = nullptr)
 {
     assert(!prior_alphas.empty());
     assert(!genotype_log_priors.empty());
@@ -477,7 +594,11 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
         auto curr_evidence = calculate_evidence_lower_bound(prior_alphas, posterior_alphas, genotype_log_priors,
                                                             genotype_posteriors, genotype_log_posteriors, responsibilities,
                                                             log_likelihoods1, 1e-10);
-        if (curr_evidence <= prev_evidence || (curr_evidence - prev_evidence) < params.epsilon) break;
+        if (curr_evidence <= prev_evidence || (curr_evidence - prev_evidence) < params.epsilon) {
+            if (bound) bound->update(curr_evidence);
+            break;
+        }
+        if (is_dominated(curr_evidence, bound, params)) break;
         prev_evidence = curr_evidence;
         update_responsibilities(responsibilities, posterior_alphas, genotype_posteriors, log_likelihoods2);
     }
@@ -494,10 +615,11 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
                       const LogProbabilityVector& genotype_log_priors,
                       const VBReadLikelihoodMatrix<K>& log_likelihoods,
                       LogProbabilityVector genotype_log_posteriors,
-                      const VariationalBayesParameters& params)
+                      const VariationalBayesParameters& params,
+                      SeedLogEvidenceBound* bound = nullptr)
 {
-    return run_variational_bayes(prior_alphas, genotype_log_posteriors, log_likelihoods,
-                                 log_likelihoods, genotype_log_posteriors, params);
+    return run_variational_bayes(prior_alphas, genotype_log_priors, log_likelihoods,
+                                 log_likelihoods, std::move(genotype_log_posteriors), params, bound);
 }
 
 // Main algorithm - multiple seed
@@ -521,10 +643,13 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
 {
     std::vector<VBLatents<K>> result {};
     result.reserve(seeds.size());
+    // Seeds are independent, but a seed that is clearly dominated by one that has already converged is
+    // abandoned. Abandoned seeds still return their current latents, which receive negligible evidence weight.
+    SeedLogEvidenceBound bound {};
     if (run_vb_with_matrix_inversion(log_likelihoods, params, seeds)) {
         const auto inverted_log_likelihoods = invert(log_likelihoods);
         const auto func = [&] (auto&& seed) { return detail::run_variational_bayes(prior_alphas, genotype_log_priors, log_likelihoods,
-                                                                                   inverted_log_likelihoods, std::move(seed), params); };
+                                                                                   inverted_log_likelihoods, std::move(seed), params, &bound); };
         if (workers) {
             transform(std::make_move_iterator(std::begin(seeds)), std::make_move_iterator(std::end(seeds)),
                       std::back_inserter(result), func, *workers);
@@ -533,7 +658,7 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
         }
     } else {
         const auto func = [&] (auto&& seed) { return detail::run_variational_bayes(prior_alphas, genotype_log_priors, log_likelihoods,
-                                                                                   std::move(seed), params); };
+                                                                                   std::move(seed), params, &bound); };
         if (workers) {
             transform(std::make_move_iterator(std::begin(seeds)), std::make_move_iterator(std::end(seeds)),
                       std::back_inserter(result), func, *workers);
@@ -608,7 +733,7 @@ compute_evidence_weighted_genotype_posteriors(const std::vector<VBLatents<K>>& l
     const auto modes = find_map_modes(latents, log_evidences);
     std::vector<double> mode_weights(modes.size());
     std::transform(std::cbegin(modes), std::cend(modes), std::begin(mode_weights), [&] (auto mode) { return log_evidences[mode]; });
-    maths::normalise_exp(mode_weights);
+    maths::fast_normalise_exp(mode_weights);
     const auto num_genotypes = latents.front().genotype_posteriors.size();    
     ProbabilityVector result(num_genotypes);
     for (std::size_t i {0}; i < modes.size(); ++i) {
@@ -718,8 +843,7 @@ estimate_memory_requirement(const std::vector<SampleName>& samples,
         bytes += tau_bytes * K + sizeof(VBResponsibilityVector<K>);
         if (!params.save_memory) {
             bytes += sizeof(detail::VBExpandedLikelihoodMatrix<K>);
-            auto inverse_bytes = sizeof(detail::VBExpandedLikelihood::value_type) * num_genotypes + sizeof(detail::VBExpandedLikelihood);
-            inverse_bytes *= num_likelihoods;
+            auto inverse_bytes = sizeof(detail::VBExpandedGenotype::value_type) * num_genotypes * num_likelihoods;
             inverse_bytes += sizeof(detail::VBExpandedGenotype);
             bytes += K * inverse_bytes + sizeof(detail::VBExpandedGenotypeVector<K>);
         }
@@ -0,0 +1,63 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "haplotype_coordinate_transform.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace octopus {
+
+HaplotypeCoordinateTransform::HaplotypeCoordinateTransform(const Haplotype& haplotype, const Position pad)
+: region_ {contig_region(haplotype)}
+, pad_ {pad}
+, indels_ {}
+{
+    std::ptrdiff_t shift {0};
+    const auto alleles = haplotype.alleles();
+    std::for_each(alleles.first, alleles.second, [&] (const ContigAllele& allele) {
+        const auto size_change = static_cast<std::ptrdiff_t>(allele.sequence().size()) - static_cast<std::ptrdiff_t>(region_size(allele));
+        if (size_change != 0) {
+            shift += size_change;
+            indels_.push_back({mapped_begin(allele), mapped_end(allele), shift});
+        }
+    });
+}
+
+boost::optional<HaplotypeCoordinateTransform::MappingPosition>
+HaplotypeCoordinateTransform::map(const AlignedRead& read) const noexcept
+{
+    // The pair HMM aligns the whole read sequence, including soft clipped bases, so the mapping is for
+    // where the sequence would start if the soft clipped bases were aligned without gaps
+    const auto& read_region = contig_region(read);
+    const auto soft_clips = get_soft_clipped_sizes(read);
+    if (read_region.begin() < region_.begin() + soft_clips.first) return boost::none;
+    const auto sequence_begin = read_region.begin() - soft_clips.first;
+    const auto sequence_end = read_region.end() + soft_clips.second;
+    if (sequence_end > region_.end() || read_region.end() > region_.end()) return boost::none;
+    if (is_near_indel(sequence_begin, read_region.begin()) || is_near_indel(read_region.end(), sequence_end)) {
+        return boost::none;
+    }
+    const auto result = static_cast<std::ptrdiff_t>(sequence_begin - region_.begin()) + shift_before(sequence_begin);
+    if (result < 0) return boost::none;
+    return static_cast<MappingPosition>(result);
+}
+
+// private methods
+
+// True if an indel is within pad of [first, last]
+bool HaplotypeCoordinateTransform::is_near_indel(const Position first, const Position last) const noexcept
+{
+    const auto itr = std::lower_bound(std::cbegin(indels_), std::cend(indels_), first,
+                                      [this] (const Indel& indel, const Position position) noexcept { return indel.end + pad_ < position; });
+    return itr != std::cend(indels_) && itr->begin <= last + pad_;
+}
+
+std::ptrdiff_t HaplotypeCoordinateTransform::shift_before(const Position position) const noexcept
+{
+    const auto itr = std::upper_bound(std::cbegin(indels_), std::cend(indels_), position,
+                                      [] (const Position position, const Indel& indel) noexcept { return position < indel.end; });
+    return itr != std::cbegin(indels_) ? std::prev(itr)->shift : 0;
+}
+
+} // namespace octopus
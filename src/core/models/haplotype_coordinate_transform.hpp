@@ -0,0 +1,61 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef haplotype_coordinate_transform_hpp
+#define haplotype_coordinate_transform_hpp
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "basics/contig_region.hpp"
+#include "basics/aligned_read.hpp"
+#include "core/types/haplotype.hpp"
+#include "haplotype_likelihood_model.hpp"
+
+namespace octopus {
+
+/*
+    Maps reads into a haplotype directly from their reference alignment: a read's sequence starts in
+    the haplotype at its reference offset, less any front soft clipped bases, plus the size changes of
+    the haplotype's indels (explicit alleles that change the sequence size) before it. Reads with a
+    haplotype indel within pad of either end of their sequence, or under a soft clip, aren't mapped.
+ */
+class HaplotypeCoordinateTransform
+{
+public:
+    using Position = ContigRegion::Position;
+    using MappingPosition = HaplotypeLikelihoodModel::MappingPosition;
+
+    HaplotypeCoordinateTransform() = delete;
+
+    HaplotypeCoordinateTransform(const Haplotype& haplotype, Position pad);
+
+    HaplotypeCoordinateTransform(const HaplotypeCoordinateTransform&)            = default;
+    HaplotypeCoordinateTransform& operator=(const HaplotypeCoordinateTransform&) = default;
+    HaplotypeCoordinateTransform(HaplotypeCoordinateTransform&&)                 = default;
+    HaplotypeCoordinateTransform& operator=(HaplotypeCoordinateTransform&&)      = default;
+
+    ~HaplotypeCoordinateTransform() = default;
+
+    boost::optional<MappingPosition> map(const AlignedRead& read) const noexcept;
+
+private:
+    struct Indel
+    {
+        Position begin, end;
+        std::ptrdiff_t shift; // of this and all previous indels
+    };
+
+    ContigRegion region_;
+    Position pad_;
+    std::vector<Indel> indels_; // sorted and non-overlapping
+
+    bool is_near_indel(Position first, Position last) const noexcept;
+    std::ptrdiff_t shift_before(Position position) const noexcept;
+};
+
+} // namespace octopus
+
+#endif
@@ -5,13 +5,167 @@
 
 #include <utility>
 #include <cassert>
-#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <functional>
 
-#include "utils/erase_if.hpp"
 #include "utils/parallel_transform.hpp"
+#include "utils/arena.hpp"
+#include "logging/profiler_zones.hpp"
+#include "haplotype_coordinate_transform.hpp"
 
 namespace octopus {
 
+namespace {
+
+// Reads that have the same likelihood as each other under any haplotype
+bool have_same_likelihoods(const AlignedRead& lhs, const AlignedRead& rhs) noexcept
+{
+    return is_same_region(lhs, rhs) && lhs.mapping_quality() == rhs.mapping_quality()
+        && lhs.is_marked_reverse_mapped() == rhs.is_marked_reverse_mapped()
+        && lhs.sequence() == rhs.sequence() && lhs.base_qualities() == rhs.base_qualities()
+        && lhs.cigar() == rhs.cigar(); // reads are placed in the haplotype by their soft clips and indels
+}
+
+/*
+    Writes the first of each set of reads in [first, last) with the same likelihoods to unique_reads,
+    and, if there are any duplicates, the index in unique_reads of each read to read_indices.
+    Duplicates have the same mapped region, so only reads sharing a region are compared.
+ */
+template <typename ForwardIterator>
+void collapse_identical_reads(ForwardIterator first, const ForwardIterator last,
+                              std::vector<const AlignedRead*>& unique_reads,
+                              std::vector<std::size_t>& read_indices)
+{
+    const auto num_reads = static_cast<std::size_t>(std::distance(first, last));
+    unique_reads.clear();
+    unique_reads.reserve(num_reads);
+    read_indices.clear();
+    read_indices.reserve(num_reads);
+    std::unordered_multimap<std::size_t, std::size_t> region_unique_indices {};
+    while (first != last) {
+        const auto region_last = std::find_if_not(std::next(first), last, [&] (const AlignedRead& read) { return is_same_region(read, *first); });
+        if (std::next(first) == region_last) {
+            read_indices.push_back(unique_reads.size());
+            unique_reads.push_back(std::addressof(*first));
+            first = region_last;
+            continue;
+        }
+        region_unique_indices.clear();
+        for (; first != region_last; ++first) {
+            const AlignedRead& read {*first};
+            const auto hash = std::hash<AlignedRead::NucleotideSequence> {}(read.sequence());
+            const auto matches = region_unique_indices.equal_range(hash);
+            const auto match_itr = std::find_if(matches.first, matches.second,
+                                                [&] (const auto& p) { return have_same_likelihoods(*unique_reads[p.second], read); });
+            if (match_itr != matches.second) {
+                read_indices.push_back(match_itr->second);
+            } else {
+                region_unique_indices.emplace(hash, unique_reads.size());
+                read_indices.push_back(unique_reads.size());
+                unique_reads.push_back(std::addressof(read));
+            }
+        }
+    }
+    if (unique_reads.size() == num_reads) read_indices.clear();
+}
+
+// True if the read's own alignment has an indel within pad bases of either end of the read sequence
+bool has_indel_near_ends(const AlignedRead& read, const std::size_t pad) noexcept
+{
+    const auto read_size = sequence_size(read);
+    std::size_t position {0};
+    for (const auto& op : read.cigar()) {
+        if (is_indel(op)) {
+            const auto indel_end = position + (is_insertion(op) ? op.size() : 0);
+            if (position < pad || indel_end + pad > read_size) return true;
+        }
+        if (advances_sequence(op)) position += op.size();
+    }
+    return false;
+}
+
+// The kmer hashes are only computed for reads that can't be mapped directly into some haplotype
+struct ReadMappingInputs
+{
+    bool has_indel_near_ends;
+    KmerPerfectHashes hashes;
+};
+
+template <unsigned char K>
+ReadMappingInputs
+make_read_mapping_inputs(const AlignedRead& read, const std::vector<HaplotypeCoordinateTransform>& transforms,
+                         const std::size_t indel_pad)
+{
+    ReadMappingInputs result {has_indel_near_ends(read, indel_pad), {}};
+    if (result.has_indel_near_ends
+        || std::any_of(std::cbegin(transforms), std::cend(transforms), [&] (const auto& transform) { return !transform.map(read); })) {
+        result.hashes = compute_kmer_hashes<K>(read.sequence());
+    }
+    return result;
+}
+
+std::vector<HaplotypeCoordinateTransform>
+make_coordinate_transforms(const MappableBlock<Haplotype>& haplotypes, const unsigned indel_pad)
+{
+    std::vector<HaplotypeCoordinateTransform> result {};
+    result.reserve(haplotypes.size());
+    for (const auto& haplotype : haplotypes) result.emplace_back(haplotype, indel_pad);
+    return result;
+}
+
+/*
+    Maps reads into one haplotype by coordinate transform, falling back to kmer mapping. The haplotype's
+    kmer hash table is only populated if some read needs it, and is cleared on destruction.
+ */
+template <unsigned char K>
+class HaplotypeMapper
+{
+public:
+    HaplotypeMapper(const Haplotype& haplotype, const HaplotypeCoordinateTransform& transform, KmerHashTable& hashes)
+    : haplotype_ {haplotype}
+    , transform_ {transform}
+    , hashes_ {hashes}
+    , mapping_counts_ {}
+    , is_hashed_ {false}
+    {}
+
+    HaplotypeMapper(const HaplotypeMapper&)            = delete;
+    HaplotypeMapper& operator=(const HaplotypeMapper&) = delete;
+    HaplotypeMapper(HaplotypeMapper&&)                 = delete;
+    HaplotypeMapper& operator=(HaplotypeMapper&&)      = delete;
+
+    ~HaplotypeMapper() { if (is_hashed_) clear_kmer_hash_table(hashes_); }
+
+    template <typename OutputIt>
+    OutputIt map(const AlignedRead& read, const ReadMappingInputs& inputs, OutputIt result, const std::size_t max_mapping_positions)
+    {
+        if (!inputs.has_indel_near_ends) {
+            if (const auto position = transform_.map(read)) {
+                *result++ = *position;
+                return result;
+            }
+        }
+        if (!is_hashed_) {
+            populate_kmer_hash_table<K>(haplotype_.sequence(), hashes_);
+            mapping_counts_ = init_mapping_counts(hashes_);
+            is_hashed_ = true;
+        }
+        result = map_query_to_target(inputs.hashes, hashes_, mapping_counts_, result, max_mapping_positions);
+        reset_mapping_counts(mapping_counts_);
+        return result;
+    }
+
+private:
+    const Haplotype& haplotype_;
+    const HaplotypeCoordinateTransform& transform_;
+    KmerHashTable& hashes_;
+    MappedIndexCounts mapping_counts_;
+    bool is_hashed_;
+};
+
+} // namespace
+
 // public methods
 
 HaplotypeLikelihoodArray::HaplotypeLikelihoodArray(const unsigned num_haplotypes_hint,
@@ -36,6 +190,35 @@ HaplotypeLikelihoodArray::HaplotypeLikelihoodArray(HaplotypeLikelihoodModel like
     mapping_positions_.resize(maxMappingPositions);
 }
 
+HaplotypeLikelihoodArray::HaplotypeLikelihoodArray(const HaplotypeLikelihoodArray& other)
+: likelihood_model_ {other.likelihood_model_}
+, alignment_scores_ {other.alignment_scores_}
+, likelihoods_ {other.likelihoods_}
+, likelihoods_footprint_ {process_memory_budget(), likelihoods_.capacity() * sizeof(LogProbability)}
+, sample_layouts_ {other.sample_layouts_}
+, num_haplotypes_ {other.num_haplotypes_}
+, rows_ {}
+, haplotype_indices_ {other.haplotype_indices_}
+, sample_indices_ {other.sample_indices_}
+, samples_ {other.samples_}
+, haplotypes_ {other.haplotypes_}
+, primed_sample_ {other.primed_sample_}
+, read_iterators_ {other.read_iterators_}
+, template_iterators_ {other.template_iterators_}
+, mapping_positions_ {other.mapping_positions_}
+{
+    set_rows();
+}
+
+HaplotypeLikelihoodArray& HaplotypeLikelihoodArray::operator=(const HaplotypeLikelihoodArray& other)
+{
+    if (this != &other) {
+        HaplotypeLikelihoodArray copy {other};
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
 HaplotypeLikelihoodArray::ReadPacket::ReadPacket(Iterator first, Iterator last)
 : first {first}
 , last {last}
@@ -53,6 +236,7 @@ void HaplotypeLikelihoodArray::populate(const ReadMap& reads,
                                         boost::optional<FlankState> flank_state,
                                         OptionalThreadPool workers)
 {
+    OCTOPUS_ZONE("HaplotypeLikelihoodArray::populate");
     // This code is not very pretty because it is a bottleneck for the entire application.
     // We want to try a minimise memory allocations for the mapping.
     haplotype_indices_.clear();
@@ -62,39 +246,70 @@ void HaplotypeLikelihoodArray::populate(const ReadMap& reads,
     set_read_iterators_and_sample_indices(reads);
     assert(reads.size() == read_iterators_.size());
     const auto num_samples = reads.size();
-    // Precompute all read hashes so we don't have to recompute for each haplotype
-    std::vector<std::vector<KmerPerfectHashes>> read_hashes {};
-    read_hashes.reserve(num_samples);
+    // Reads with the same likelihood under every haplotype are only mapped and evaluated once.
+    // Reads are mapped into each haplotype from their alignment where possible, and otherwise by kmers,
+    // so the read hashes needed for that are computed once for all haplotypes.
+    const auto coordinate_transforms = make_coordinate_transforms(haplotypes, directMappingIndelPad);
+    ArenaVector<std::vector<ReadMappingInputs>> read_mapping_inputs {};
+    read_mapping_inputs.reserve(num_samples);
+    ArenaVector<std::vector<const AlignedRead*>> sample_reads {};
+    sample_reads.reserve(num_samples);
+    ArenaVector<std::vector<std::size_t>> sample_read_indices {};
+    sample_read_indices.reserve(num_samples);
+    std::size_t max_sample_reads {0};
     for (const auto& t : read_iterators_) {
-        std::vector<KmerPerfectHashes> sample_read_hashes {};
-        sample_read_hashes.reserve(t.num_reads);
-        std::transform(t.first, t.last, std::back_inserter(sample_read_hashes),
-                       [] (const AlignedRead& read) { return compute_kmer_hashes<mapperKmerSize>(read.sequence()); });
-        read_hashes.emplace_back(std::move(sample_read_hashes));
-    }
-    auto haplotype_hashes = init_kmer_hash_table<mapperKmerSize>();
-    const auto first_mapping_position = std::begin(mapping_positions_);
-    likelihoods_.resize(haplotypes.size(), std::vector<LikelihoodVector>(num_samples));
+        std::vector<const AlignedRead*> reads_ptrs {};
+        std::vector<std::size_t> read_indices {};
+        collapse_identical_reads(t.first, t.last, reads_ptrs, read_indices);
+        std::vector<ReadMappingInputs> sample_mapping_inputs {};
+        sample_mapping_inputs.reserve(reads_ptrs.size());
+        std::transform(std::cbegin(reads_ptrs), std::cend(reads_ptrs), std::back_inserter(sample_mapping_inputs),
+                       [&] (const AlignedRead* read) {
+                           return make_read_mapping_inputs<mapperKmerSize>(*read, coordinate_transforms, directMappingIndelPad);
+                       });
+        read_mapping_inputs.emplace_back(std::move(sample_mapping_inputs));
+        max_sample_reads = std::max(reads_ptrs.size(), max_sample_reads);
+        sample_reads.emplace_back(std::move(reads_ptrs));
+        sample_read_indices.emplace_back(std::move(read_indices));
+    }
+    // All of a sample's reads are mapped before any are evaluated so the model can batch the alignments
+    if (mapping_positions_.size() < max_sample_reads * maxMappingPositions) {
+        mapping_positions_.resize(max_sample_reads * maxMappingPositions);
+    }
+    std::vector<HaplotypeLikelihoodModel::MappingPositionRange> read_mapping_positions {};
+    read_mapping_positions.reserve(max_sample_reads);
+    ArenaVector<LogProbability> unique_read_likelihoods {};
+    auto& haplotype_hashes = thread_local_kmer_hash_table<mapperKmerSize>();
+    std::vector<std::size_t> num_sample_likelihoods(num_samples);
+    std::transform(std::cbegin(read_iterators_), std::cend(read_iterators_), std::begin(num_sample_likelihoods),
+                   [] (const ReadPacket& t) noexcept { return t.num_reads; });
+    allocate(haplotypes.size(), num_sample_likelihoods);
     for (std::size_t haplotype_idx {0}; haplotype_idx < haplotypes.size(); ++haplotype_idx) {
         const auto& haplotype = haplotypes[haplotype_idx];
-        populate_kmer_hash_table<mapperKmerSize>(haplotype.sequence(), haplotype_hashes);
-        auto haplotype_mapping_counts = init_mapping_counts(haplotype_hashes);
+        HaplotypeMapper<mapperKmerSize> mapper {haplotype, coordinate_transforms[haplotype_idx], haplotype_hashes};
         likelihood_model_.reset(haplotype, flank_state);
         for (std::size_t sample_idx {0}; sample_idx < num_samples; ++sample_idx) {
-            auto& likelihoods = likelihoods_[haplotype_idx][sample_idx];
-            const auto& t = read_iterators_[sample_idx];
-            likelihoods.resize(t.num_reads);
-            std::transform(t.first, t.last, std::cbegin(read_hashes[sample_idx]), std::begin(likelihoods),
-                           [&] (const AlignedRead& read, const auto& read_hashes) {
-                               const auto last_mapping_position = map_query_to_target(read_hashes, haplotype_hashes,
-                                                                                      haplotype_mapping_counts,
-                                                                                      first_mapping_position,
-                                                                                      maxMappingPositions);
-                               reset_mapping_counts(haplotype_mapping_counts);
-                               return likelihood_model_.evaluate(read, first_mapping_position, last_mapping_position);
-                           });
+            read_mapping_positions.clear();
+            auto first_mapping_position = std::begin(mapping_positions_);
+            for (std::size_t read_idx {0}; read_idx < sample_reads[sample_idx].size(); ++read_idx) {
+                const auto last_mapping_position = mapper.map(*sample_reads[sample_idx][read_idx],
+                                                              read_mapping_inputs[sample_idx][read_idx],
+                                                              first_mapping_position, maxMappingPositions);
+                read_mapping_positions.emplace_back(first_mapping_position, last_mapping_position);
+                first_mapping_position += maxMappingPositions;
+            }
+            const auto& read_indices = sample_read_indices[sample_idx];
+            if (read_indices.empty()) {
+                likelihood_model_.evaluate(sample_reads[sample_idx], read_mapping_positions, row_data(haplotype_idx, sample_idx),
+                                           alignment_scores_);
+            } else {
+                unique_read_likelihoods.resize(sample_reads[sample_idx].size());
+                likelihood_model_.evaluate(sample_reads[sample_idx], read_mapping_positions, unique_read_likelihoods.data(),
+                                           alignment_scores_);
+                std::transform(std::cbegin(read_indices), std::cend(read_indices), row_data(haplotype_idx, sample_idx),
+                               [&] (const auto unique_idx) noexcept { return unique_read_likelihoods[unique_idx]; });
+            }
         }
-        clear_kmer_hash_table(haplotype_hashes);
         haplotype_indices_.emplace(haplotype, haplotype_idx);
     }
     likelihood_model_.clear();
@@ -107,6 +322,7 @@ void HaplotypeLikelihoodArray::populate(const TemplateMap& reads,
                                         boost::optional<FlankState> flank_state,
                                         OptionalThreadPool workers)
 {
+    OCTOPUS_ZONE("HaplotypeLikelihoodArray::populate");
     haplotype_indices_.clear();
     if (haplotype_indices_.bucket_count() < haplotypes.size()) {
         haplotype_indices_.rehash(haplotypes.size());
@@ -114,65 +330,65 @@ void HaplotypeLikelihoodArray::populate(const TemplateMap& reads,
     set_template_iterators_and_sample_indices(reads);
     assert(reads.size() == template_iterators_.size());
     const auto num_samples = reads.size();
-    // Precompute all read hashes so we don't have to recompute for each haplotype
-    std::vector<std::vector<std::vector<KmerPerfectHashes>>> template_hashes {};
-    template_hashes.reserve(num_samples);
+    // Precompute the read mapping inputs so we don't have to recompute for each haplotype
+    const auto coordinate_transforms = make_coordinate_transforms(haplotypes, directMappingIndelPad);
+    ArenaVector<std::vector<std::vector<ReadMappingInputs>>> template_mapping_inputs {};
+    template_mapping_inputs.reserve(num_samples);
     for (const auto& t : template_iterators_) {
-        std::vector<std::vector<KmerPerfectHashes>> sample_read_hashes {};
-        sample_read_hashes.reserve(t.num_templates);
+        std::vector<std::vector<ReadMappingInputs>> sample_mapping_inputs {};
+        sample_mapping_inputs.reserve(t.num_templates);
         using octopus::transform;
-        transform(t.first, t.last, std::back_inserter(sample_read_hashes), [] (const AlignedTemplate& reads) {
-            std::vector<KmerPerfectHashes> result {};
+        transform(t.first, t.last, std::back_inserter(sample_mapping_inputs), [&] (const AlignedTemplate& reads) {
+            std::vector<ReadMappingInputs> result {};
             result.reserve(reads.size());
-            for (const auto& read : reads) result.push_back(compute_kmer_hashes<mapperKmerSize>(read.sequence()));
+            for (const auto& read : reads) {
+                result.push_back(make_read_mapping_inputs<mapperKmerSize>(read, coordinate_transforms, directMappingIndelPad));
+            }
             return result;
         }, workers);
-        template_hashes.emplace_back(std::move(sample_read_hashes));
+        template_mapping_inputs.emplace_back(std::move(sample_mapping_inputs));
     }
-    const auto populate_haplotype = [this, &template_hashes, &flank_state, num_samples] (
-           const Haplotype& haplotype, 
-           const auto& haplotype_hashes, 
-           std::vector<LikelihoodVector>& likelihoods,
+    const auto populate_haplotype = [this, &template_mapping_inputs, &coordinate_transforms, &flank_state, num_samples] (
+           const Haplotype& haplotype,
+           const std::size_t haplotype_idx,
            HaplotypeLikelihoodModel& likelihood_model) {
         thread_local std::vector<HaplotypeLikelihoodModel::MappingPositionVector> mapping_positions {};
-        auto haplotype_mapping_counts = init_mapping_counts(haplotype_hashes);
+        HaplotypeMapper<mapperKmerSize> mapper {haplotype, coordinate_transforms[haplotype_idx],
+                                                thread_local_kmer_hash_table<mapperKmerSize>()};
         likelihood_model.reset(haplotype, flank_state);
         for (std::size_t sample_idx {0}; sample_idx < num_samples; ++sample_idx) {
-            auto& sample_likelihoods = likelihoods[sample_idx];
             const auto& t = template_iterators_[sample_idx];
-            sample_likelihoods.resize(t.num_templates);
-            std::transform(t.first, t.last, std::cbegin(template_hashes[sample_idx]), std::begin(sample_likelihoods),
-                           [&] (const AlignedTemplate& read_template, const auto& template_hashes) {
+            std::transform(t.first, t.last, std::cbegin(template_mapping_inputs[sample_idx]), row_data(haplotype_idx, sample_idx),
+                           [&] (const AlignedTemplate& read_template, const auto& mapping_inputs) {
                                mapping_positions.resize(read_template.size());
-                               assert(read_template.size() == template_hashes.size());
-                               for (std::size_t i {0}; i < template_hashes.size(); ++i) {
+                               assert(read_template.size() == mapping_inputs.size());
+                               for (std::size_t i {0}; i < mapping_inputs.size(); ++i) {
                                    mapping_positions[i].resize(maxMappingPositions);
-                                   mapping_positions[i].erase(map_query_to_target(template_hashes[i], haplotype_hashes,
-                                                                                  haplotype_mapping_counts,
-                                                                                  std::begin(mapping_positions[i]),
-                                                                                  maxMappingPositions),
+                                   mapping_positions[i].erase(mapper.map(read_template[i], mapping_inputs[i],
+                                                                         std::begin(mapping_positions[i]),
+                                                                         maxMappingPositions),
                                                               std::end(mapping_positions[i]));
-                                   reset_mapping_counts(haplotype_mapping_counts);
                                }
                                return likelihood_model.evaluate(read_template, mapping_positions);
                            });
         }
     };
-    likelihoods_.resize(haplotypes.size(), std::vector<LikelihoodVector>(num_samples));
+    std::vector<std::size_t> num_sample_likelihoods(num_samples);
+    std::transform(std::cbegin(template_iterators_), std::cend(template_iterators_), std::begin(num_sample_likelihoods),
+                   [] (const TemplatePacket& t) noexcept { return t.num_templates; });
+    allocate(haplotypes.size(), num_sample_likelihoods);
     // We need to weigh up the cost of doing multithreading here - there is a small penalty for
-    // using the thread pool, but the bigger cost comes from the extra allocations for the kmer hash table
-    // and copying the likelihood model (one for each haplotype). If the thread pool doesn't have much
+    // using the thread pool, but the bigger cost comes from copying the likelihood model (one for each haplotype). If the thread pool doesn't have much
     // capacity, either because there are few threads or the workload is already high, then it
     // could be faster to run this section in a single thread (and also save some memory).
     if (haplotypes.size() > 1 && workers && workers->size() > 2 && workers->n_idle() > 1) {
         std::vector<std::future<void>> futures(haplotypes.size() - 1);
         for (std::size_t haplotype_idx {0}; haplotype_idx < haplotypes.size(); ++haplotype_idx) {
             auto task = [&haplotype = haplotypes[haplotype_idx], 
-                 &likelihoods = likelihoods_[haplotype_idx], 
+                 haplotype_idx,
                  likelihood_model = likelihood_model_, 
                  populate_haplotype] () mutable {
-                auto haplotype_hashes = make_kmer_hash_table<mapperKmerSize>(haplotype.sequence());
-                populate_haplotype(haplotype, haplotype_hashes, likelihoods, likelihood_model);
+                populate_haplotype(haplotype, haplotype_idx, likelihood_model);
             };
             if (haplotype_idx < (haplotypes.size() - 1)) {
                 futures[haplotype_idx] = workers->try_push(std::move(task));
@@ -181,13 +397,13 @@ void HaplotypeLikelihoodArray::populate(const TemplateMap& reads,
                 task();
             }
         }
-        for (auto& f : futures) f.get();
+        for (auto& f : futures) {
+            workers->wait(f);
+            f.get();
+        }
     } else {
-        auto haplotype_hashes = init_kmer_hash_table<mapperKmerSize>();
         for (std::size_t haplotype_idx {0}; haplotype_idx < haplotypes.size(); ++haplotype_idx) {
-            populate_kmer_hash_table<mapperKmerSize>(haplotypes[haplotype_idx].sequence(), haplotype_hashes);
-            populate_haplotype(haplotypes[haplotype_idx], haplotype_hashes, likelihoods_[haplotype_idx], likelihood_model_);
-            clear_kmer_hash_table(haplotype_hashes);
+            populate_haplotype(haplotypes[haplotype_idx], haplotype_idx, likelihood_model_);
         }
     }
     for (std::size_t haplotype_idx {0}; haplotype_idx < haplotypes.size(); ++haplotype_idx) {
@@ -200,39 +416,53 @@ void HaplotypeLikelihoodArray::populate(const TemplateMap& reads,
 
 std::size_t HaplotypeLikelihoodArray::num_likelihoods(const SampleName& sample) const
 {
-    return likelihoods_.front()[sample_indices_.at(sample)].size();
+    return sample_layouts_[sample_indices_.at(sample)].num_likelihoods;
 }
 
 std::size_t HaplotypeLikelihoodArray::num_likelihoods() const // if primed
 {
     assert(is_primed());
-    return likelihoods_.front()[*primed_sample_].size();
+    return sample_layouts_[*primed_sample_].num_likelihoods;
 }
 
 const HaplotypeLikelihoodArray::LikelihoodVector&
 HaplotypeLikelihoodArray::operator()(const SampleName& sample, const Haplotype& haplotype) const
 {
-    return likelihoods_[haplotype_indices_.at(haplotype)][sample_indices_.at(sample)];
+    return row(haplotype_indices_.at(haplotype), sample_indices_.at(sample));
 }
 
 const HaplotypeLikelihoodArray::LikelihoodVector&
 HaplotypeLikelihoodArray::operator()(const SampleName& sample, const IndexedHaplotype<>& haplotype) const
 {
-    return likelihoods_[index_of(haplotype)][sample_indices_.at(sample)];
+    return row(index_of(haplotype), sample_indices_.at(sample));
 }
 
 const HaplotypeLikelihoodArray::LikelihoodVector&
 HaplotypeLikelihoodArray::operator[](const Haplotype& haplotype) const
 {
     assert(is_primed());
-    return likelihoods_[haplotype_indices_.at(haplotype)][*primed_sample_];
+    return row(haplotype_indices_.at(haplotype), *primed_sample_);
 }
 
 const HaplotypeLikelihoodArray::LikelihoodVector&
 HaplotypeLikelihoodArray::operator[](const IndexedHaplotype<>& haplotype) const noexcept
 {
     assert(is_primed());
-    return likelihoods_[index_of(haplotype)][*primed_sample_];
+    return row(index_of(haplotype), *primed_sample_);
+}
+
+const HaplotypeLikelihoodArray::LikelihoodVector&
+HaplotypeLikelihoodArray::operator[](const std::size_t haplotype_index) const noexcept
+{
+    assert(is_primed());
+    return row(haplotype_index, *primed_sample_);
+}
+
+HaplotypeLikelihoodArray::SampleLikelihoodMatrix
+HaplotypeLikelihoodArray::matrix(const SampleName& sample) const
+{
+    const auto& layout = sample_layouts_[sample_indices_.at(sample)];
+    return {likelihoods_.data() + layout.offset, num_haplotypes_, layout.num_likelihoods, layout.stride};
 }
 
 std::vector<SampleName> HaplotypeLikelihoodArray::samples() const
@@ -251,7 +481,7 @@ HaplotypeLikelihoodArray::extract_sample(const SampleName& sample) const
     const auto sample_index = sample_indices_.at(sample);
     SampleLikelihoodMap result {haplotype_indices_.size()};
     for (const auto& p : haplotype_indices_) {
-        result.emplace(p.first, likelihoods_[p.second][sample_index]);
+        result.emplace(p.first, row(p.second, sample_index));
     }
     return result;
 }
@@ -263,18 +493,28 @@ bool HaplotypeLikelihoodArray::contains(const Haplotype& haplotype) const noexce
 
 bool HaplotypeLikelihoodArray::is_empty() const noexcept
 {
-    return likelihoods_.empty();
+    return num_haplotypes_ == 0;
 }
 
 void HaplotypeLikelihoodArray::clear() noexcept
 {
     likelihoods_.clear();
+    sample_layouts_.clear();
+    num_haplotypes_ = 0;
+    rows_.clear();
     haplotype_indices_.clear();
     sample_indices_.clear();
     haplotypes_.clear();
     unprime();
 }
 
+void HaplotypeLikelihoodArray::release() noexcept
+{
+    clear();
+    LikelihoodStorage {}.swap(likelihoods_);
+    likelihoods_footprint_.resize(0);
+}
+
 bool HaplotypeLikelihoodArray::is_primed() const noexcept
 {
     return static_cast<bool>(primed_sample_);
@@ -328,13 +568,56 @@ void HaplotypeLikelihoodArray::set_template_iterators_and_sample_indices(const T
     }
 }
 
+void HaplotypeLikelihoodArray::allocate(const std::size_t num_haplotypes, const std::vector<std::size_t>& num_likelihoods)
+{
+    // Rows are padded to whole 64 byte blocks, so every row starts on a block boundary
+    constexpr std::size_t rowBlockSize {64 / sizeof(LogProbability)};
+    sample_layouts_.clear();
+    sample_layouts_.reserve(num_likelihoods.size());
+    std::size_t offset {0};
+    for (const auto n : num_likelihoods) {
+        const auto stride = (n + rowBlockSize - 1) / rowBlockSize * rowBlockSize;
+        sample_layouts_.push_back({offset, n, stride});
+        offset += num_haplotypes * stride;
+    }
+    likelihoods_.resize(offset);
+    likelihoods_footprint_.resize(likelihoods_.capacity() * sizeof(LogProbability));
+    num_haplotypes_ = num_haplotypes;
+    set_rows();
+}
+
+void HaplotypeLikelihoodArray::set_rows()
+{
+    rows_.clear();
+    rows_.reserve(num_haplotypes_ * sample_layouts_.size());
+    for (std::size_t haplotype_idx {0}; haplotype_idx < num_haplotypes_; ++haplotype_idx) {
+        for (const auto& layout : sample_layouts_) {
+            rows_.emplace_back(likelihoods_.data() + layout.offset + haplotype_idx * layout.stride, layout.num_likelihoods);
+        }
+    }
+}
+
+HaplotypeLikelihoodArray::LogProbability*
+HaplotypeLikelihoodArray::row_data(const std::size_t haplotype_idx, const std::size_t sample_idx) noexcept
+{
+    const auto& layout = sample_layouts_[sample_idx];
+    return likelihoods_.data() + layout.offset + haplotype_idx * layout.stride;
+}
+
+const HaplotypeLikelihoodArray::LikelihoodVector&
+HaplotypeLikelihoodArray::row(const std::size_t haplotype_idx, const std::size_t sample_idx) const noexcept
+{
+    return rows_[haplotype_idx * sample_layouts_.size() + sample_idx];
+}
+
 void HaplotypeLikelihoodArray::reset(MappableBlock<Haplotype> haplotypes)
 {
     assert(haplotypes.size() <= haplotypes_.size());
     if (haplotypes.empty()) {
         clear();
     } else if (haplotypes.size() < haplotypes_.size()) {
-        std::deque<std::size_t> indices_to_keep {};
+        std::vector<std::size_t> indices_to_keep {};
+        indices_to_keep.reserve(haplotypes.size());
         for (std::size_t haplotype_idx {0}; haplotype_idx < haplotypes.size(); ++haplotype_idx) {
             auto& old_haplotype_idx = haplotype_indices_.at(haplotypes[haplotype_idx]);
             indices_to_keep.push_back(old_haplotype_idx);
@@ -342,14 +625,17 @@ void HaplotypeLikelihoodArray::reset(MappableBlock<Haplotype> haplotypes)
         }
         assert(!indices_to_keep.empty());
         assert(std::is_sorted(std::cbegin(indices_to_keep), std::cend(indices_to_keep)));
-        std::size_t idx {0};
-        const auto remover = [&] (const auto&) noexcept {
-            if (indices_to_keep.empty()) return true;
-            if (idx++ != indices_to_keep.front()) return true;
-            indices_to_keep.pop_front();
-            return false;
-        };
-        erase_if(likelihoods_, remover);
+        // Kept rows only move down within each sample's block, so can be moved in place
+        for (std::size_t haplotype_idx {0}; haplotype_idx < indices_to_keep.size(); ++haplotype_idx) {
+            const auto old_haplotype_idx = indices_to_keep[haplotype_idx];
+            if (old_haplotype_idx == haplotype_idx) continue;
+            for (std::size_t sample_idx {0}; sample_idx < sample_layouts_.size(); ++sample_idx) {
+                const auto first = row_data(old_haplotype_idx, sample_idx);
+                std::copy(first, first + sample_layouts_[sample_idx].num_likelihoods, row_data(haplotype_idx, sample_idx));
+            }
+        }
+        num_haplotypes_ = indices_to_keep.size();
+        set_rows();
         haplotypes_ = std::move(haplotypes);
     }
 }
@@ -367,11 +653,11 @@ HaplotypeLikelihoodArray::merge_samples(const std::vector<SampleName>& samples,
     for (const auto& sample : samples) {
         total_num_likelihoods += this->num_likelihoods(sample);
     }
-    result.likelihoods_.resize(haplotypes_.size(), std::vector<LikelihoodVector>(1, LikelihoodVector(total_num_likelihoods)));
-    for (std::size_t haplotype_idx {0}; haplotype_idx < haplotypes_.size(); ++haplotype_idx) {
-        auto dst_likelihood_itr = std::begin(result.likelihoods_[haplotype_idx][0]);
+    result.allocate(num_haplotypes_, {total_num_likelihoods});
+    for (std::size_t haplotype_idx {0}; haplotype_idx < num_haplotypes_; ++haplotype_idx) {
+        auto dst_likelihood_itr = result.row_data(haplotype_idx, 0);
         for (const auto& sample : samples) {
-            const auto& src_likelihoods = likelihoods_[haplotype_idx][sample_indices_.at(sample)];
+            const auto& src_likelihoods = row(haplotype_idx, sample_indices_.at(sample));
             dst_likelihood_itr = std::copy(std::cbegin(src_likelihoods), std::cend(src_likelihoods), dst_likelihood_itr);
         }
     }
@@ -391,14 +677,14 @@ HaplotypeLikelihoodArray::merge_samples(boost::optional<SampleName> new_sample)
     HaplotypeLikelihoodArray result {static_cast<unsigned>(haplotypes_.size()), {std::move(*new_sample)}};
     result.haplotypes_ = haplotypes_;
     std::size_t total_num_likelihoods {0};
-    for (const auto& s : likelihoods_.front()) {
-        total_num_likelihoods += s.size();
-    }
-    result.likelihoods_.resize(haplotypes_.size(), std::vector<LikelihoodVector>(1, LikelihoodVector(total_num_likelihoods)));
-    for (std::size_t haplotype_idx {0}; haplotype_idx < haplotypes_.size(); ++haplotype_idx) {
-        auto dst_likelihood_itr = std::begin(result.likelihoods_[haplotype_idx][0]);
-        for (std::size_t sample_idx {0}; sample_idx < samples_.size(); ++sample_idx) {
-            const auto& src_likelihoods = likelihoods_[haplotype_idx][sample_idx];
+    for (const auto& layout : sample_layouts_) {
+        total_num_likelihoods += layout.num_likelihoods;
+    }
+    result.allocate(num_haplotypes_, {total_num_likelihoods});
+    for (std::size_t haplotype_idx {0}; haplotype_idx < num_haplotypes_; ++haplotype_idx) {
+        auto dst_likelihood_itr = result.row_data(haplotype_idx, 0);
+        for (std::size_t sample_idx {0}; sample_idx < sample_layouts_.size(); ++sample_idx) {
+            const auto& src_likelihoods = row(haplotype_idx, sample_idx);
             dst_likelihood_itr = std::copy(std::cbegin(src_likelihoods), std::cend(src_likelihoods), dst_likelihood_itr);
         }
     }
@@ -408,6 +694,55 @@ HaplotypeLikelihoodArray::merge_samples(boost::optional<SampleName> new_sample)
     return result;
 }
 
+boost::optional<HaplotypeLikelihoodArray>
+HaplotypeLikelihoodArray::copy_informative(const LogProbability max_spread, const double min_fraction) const
+{
+    if (num_haplotypes_ == 0) return boost::none;
+    std::vector<std::vector<std::size_t>> informative_indices(sample_layouts_.size());
+    std::vector<LogProbability> min_likelihoods {}, max_likelihoods {};
+    std::size_t num_likelihoods {0}, num_informative_likelihoods {0};
+    for (std::size_t sample_idx {0}; sample_idx < sample_layouts_.size(); ++sample_idx) {
+        const auto& first_likelihoods = row(0, sample_idx);
+        min_likelihoods.assign(std::cbegin(first_likelihoods), std::cend(first_likelihoods));
+        max_likelihoods.assign(std::cbegin(first_likelihoods), std::cend(first_likelihoods));
+        for (std::size_t haplotype_idx {1}; haplotype_idx < num_haplotypes_; ++haplotype_idx) {
+            const auto& likelihoods = row(haplotype_idx, sample_idx);
+            for (std::size_t read_idx {0}; read_idx < likelihoods.size(); ++read_idx) {
+                min_likelihoods[read_idx] = std::min(min_likelihoods[read_idx], likelihoods[read_idx]);
+                max_likelihoods[read_idx] = std::max(max_likelihoods[read_idx], likelihoods[read_idx]);
+            }
+        }
+        auto& indices = informative_indices[sample_idx];
+        for (std::size_t read_idx {0}; read_idx < min_likelihoods.size(); ++read_idx) {
+            if (max_likelihoods[read_idx] - min_likelihoods[read_idx] > max_spread) indices.push_back(read_idx);
+        }
+        num_likelihoods += min_likelihoods.size();
+        num_informative_likelihoods += indices.size();
+    }
+    const auto num_uninformative_likelihoods = num_likelihoods - num_informative_likelihoods;
+    if (num_uninformative_likelihoods == 0 || num_uninformative_likelihoods < min_fraction * num_likelihoods) {
+        return boost::none;
+    }
+    HaplotypeLikelihoodArray result {static_cast<unsigned>(num_haplotypes_), samples_};
+    std::vector<std::size_t> num_sample_likelihoods(informative_indices.size());
+    std::transform(std::cbegin(informative_indices), std::cend(informative_indices), std::begin(num_sample_likelihoods),
+                   [] (const auto& indices) noexcept { return indices.size(); });
+    result.allocate(num_haplotypes_, num_sample_likelihoods);
+    for (std::size_t haplotype_idx {0}; haplotype_idx < num_haplotypes_; ++haplotype_idx) {
+        for (std::size_t sample_idx {0}; sample_idx < sample_layouts_.size(); ++sample_idx) {
+            const auto& src_likelihoods = row(haplotype_idx, sample_idx);
+            std::transform(std::cbegin(informative_indices[sample_idx]), std::cend(informative_indices[sample_idx]),
+                           result.row_data(haplotype_idx, sample_idx),
+                           [&] (const auto read_idx) noexcept { return src_likelihoods[read_idx]; });
+        }
+    }
+    result.haplotype_indices_ = haplotype_indices_;
+    result.sample_indices_ = sample_indices_;
+    result.haplotypes_ = haplotypes_;
+    result.primed_sample_ = primed_sample_;
+    return result;
+}
+
 // non-member methods
 
 namespace debug {
@@ -22,7 +22,9 @@
 #include "core/types/haplotype.hpp"
 #include "core/types/indexed_haplotype.hpp"
 #include "utils/kmer_mapper.hpp"
+#include "utils/huge_page_allocator.hpp"
 #include "utils/thread_pool.hpp"
+#include "utils/memory_budget.hpp"
 #include "haplotype_likelihood_model.hpp"
 
 namespace octopus {
@@ -33,14 +35,79 @@ namespace octopus {
  
     The matrix can be efficiently populated as the read mapping and alignment are
     done internally which allows minimal memory allocation.
+ 
+    The likelihoods are stored in one contiguous [sample][haplotype][read] matrix. Each
+    (sample, haplotype) row is 64-byte aligned and padded to a multiple of 64 bytes, so models
+    can stream through the reads of a haplotype, or step between haplotypes by a fixed stride.
+ 
+    With the SINGLE_PRECISION_LIKELIHOODS build option the likelihoods are stored as float,
+    which halves the size of the matrix. Likelihoods are still computed in double, so the only
+    error is the rounding on store, which is at most 2^-24 |ln p|: less than 1/1000th of the pair
+    HMM score granularity (ln 10 / 10) for any likelihood above about -3800.
  */
 class HaplotypeLikelihoodArray
 {
 public:
     using FlankState = HaplotypeLikelihoodModel::FlankState;
     
+#if defined(SINGLE_PRECISION_LIKELIHOODS)
+    using LogProbability       = float;
+#else
     using LogProbability       = HaplotypeLikelihoodModel::LogProbability;
-    using LikelihoodVector     = std::vector<LogProbability>;
+#endif
+    
+    // A view of the likelihoods of one haplotype for each read of a sample
+    class LikelihoodVector
+    {
+    public:
+        using value_type     = LogProbability;
+        using size_type      = std::size_t;
+        using const_iterator = const LogProbability*;
+        using iterator       = const_iterator;
+    
+        LikelihoodVector() = default;
+        LikelihoodVector(const LogProbability* data, std::size_t size) noexcept : data_ {data}, size_ {size} {}
+    
+        const LogProbability* data() const noexcept { return data_; }
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+    
+        const_iterator begin() const noexcept { return data_; }
+        const_iterator end() const noexcept { return data_ + size_; }
+        const_iterator cbegin() const noexcept { return begin(); }
+        const_iterator cend() const noexcept { return end(); }
+    
+        LogProbability operator[](std::size_t n) const noexcept { return data_[n]; }
+        LogProbability front() const noexcept { return data_[0]; }
+        LogProbability back() const noexcept { return data_[size_ - 1]; }
+    
+    private:
+        const LogProbability* data_ = nullptr;
+        std::size_t size_ = 0;
+    };
+    
+    // A view of the likelihoods of every haplotype for one sample: row i holds the likelihoods of the
+    // haplotype with index i, and rows start stride() elements apart (stride() >= num_likelihoods()).
+    class SampleLikelihoodMatrix
+    {
+    public:
+        SampleLikelihoodMatrix() = default;
+        SampleLikelihoodMatrix(const LogProbability* data, std::size_t num_haplotypes, std::size_t num_likelihoods, std::size_t stride) noexcept
+        : data_ {data}, num_haplotypes_ {num_haplotypes}, num_likelihoods_ {num_likelihoods}, stride_ {stride} {}
+    
+        const LogProbability* data() const noexcept { return data_; }
+        std::size_t num_haplotypes() const noexcept { return num_haplotypes_; }
+        std::size_t num_likelihoods() const noexcept { return num_likelihoods_; }
+        std::size_t stride() const noexcept { return stride_; }
+    
+        LikelihoodVector operator[](std::size_t haplotype_idx) const noexcept { return {data_ + haplotype_idx * stride_, num_likelihoods_}; }
+        LogProbability operator()(std::size_t haplotype_idx, std::size_t read_idx) const noexcept { return data_[haplotype_idx * stride_ + read_idx]; }
+    
+    private:
+        const LogProbability* data_ = nullptr;
+        std::size_t num_haplotypes_ = 0, num_likelihoods_ = 0, stride_ = 0;
+    };
+    
     using LikelihoodVectorRef  = std::reference_wrapper<const LikelihoodVector>;
     using HaplotypeRef         = std::reference_wrapper<const Haplotype>;
     using SampleLikelihoodMap  = std::unordered_map<HaplotypeRef, LikelihoodVectorRef>;
@@ -55,8 +122,8 @@ public:
                              unsigned num_haplotypes_hint,
                              const std::vector<SampleName>& samples);
     
-    HaplotypeLikelihoodArray(const HaplotypeLikelihoodArray&)            = default;
-    HaplotypeLikelihoodArray& operator=(const HaplotypeLikelihoodArray&) = default;
+    HaplotypeLikelihoodArray(const HaplotypeLikelihoodArray&);
+    HaplotypeLikelihoodArray& operator=(const HaplotypeLikelihoodArray&);
     HaplotypeLikelihoodArray(HaplotypeLikelihoodArray&&)                 = default;
     HaplotypeLikelihoodArray& operator=(HaplotypeLikelihoodArray&&)      = default;
     
@@ -78,6 +145,9 @@ public:
     const LikelihoodVector& operator()(const SampleName& sample, const IndexedHaplotype<>& haplotype) const;
     const LikelihoodVector& operator[](const Haplotype& haplotype) const; // when primed with a sample
     const LikelihoodVector& operator[](const IndexedHaplotype<>& haplotype) const noexcept; // when primed with a sample
+    const LikelihoodVector& operator[](std::size_t haplotype_index) const noexcept; // when primed with a sample
+    
+    SampleLikelihoodMatrix matrix(const SampleName& sample) const;
     
     std::vector<SampleName> samples() const;
     MappableBlock<Haplotype> haplotypes() const;
@@ -92,6 +162,9 @@ public:
     
     void clear() noexcept;
     
+    // Clears and gives back the memory of the likelihood matrix, which clear keeps for the next populate
+    void release() noexcept;
+    
     bool is_primed() const noexcept;
     void prime(const SampleName& sample) const;
     void unprime() const noexcept;
@@ -99,11 +172,23 @@ public:
     HaplotypeLikelihoodArray merge_samples(const std::vector<SampleName>& samples, boost::optional<SampleName> new_sample = boost::none) const;
     HaplotypeLikelihoodArray merge_samples(boost::optional<SampleName> new_sample = boost::none) const;
     
+    // A read whose likelihoods differ by at most max_spread across all haplotypes adds (almost) the same
+    // term to the log likelihood of every genotype, so doesn't change genotype posteriors. Returns a copy
+    // without the likelihoods of these reads, unless fewer than min_fraction of the reads can be removed.
+    // The reads of the copy are no longer aligned with the populated reads.
+    boost::optional<HaplotypeLikelihoodArray>
+    copy_informative(LogProbability max_spread, double min_fraction = 0) const;
+    
 private:
     static constexpr unsigned char mapperKmerSize {6};
     static constexpr std::size_t maxMappingPositions {10};
+    // Reads are kmer mapped if there is an indel, in the haplotype or in their own alignment, this close
+    // to either of their ends, as the indel may be aligned differently in the read
+    static constexpr unsigned directMappingIndelPad {2 * mapperKmerSize};
     
     HaplotypeLikelihoodModel likelihood_model_;
+    // Kept over populate calls, as consecutive active regions have many of the same alignments
+    HaplotypeLikelihoodModel::AlignmentScoreCache alignment_scores_;
     
     struct ReadPacket
     {
@@ -120,7 +205,18 @@ private:
         std::size_t num_templates;
     };
     
-    std::vector<std::vector<LikelihoodVector>> likelihoods_;
+    using LikelihoodStorage = HugePageVector<LogProbability>;
+    
+    struct SampleLayout
+    {
+        std::size_t offset, num_likelihoods, stride;
+    };
+    
+    LikelihoodStorage likelihoods_;
+    MemoryBudget::Reservation likelihoods_footprint_ {process_memory_budget()};
+    std::vector<SampleLayout> sample_layouts_;
+    std::size_t num_haplotypes_ = 0;
+    std::vector<LikelihoodVector> rows_; // [haplotype][sample] views into likelihoods_
     std::unordered_map<Haplotype, std::size_t, HaplotypeHash> haplotype_indices_;
     std::unordered_map<SampleName, std::size_t> sample_indices_;
     std::vector<SampleName> samples_;
@@ -135,6 +231,10 @@ private:
     
     void set_read_iterators_and_sample_indices(const ReadMap& reads);
     void set_template_iterators_and_sample_indices(const TemplateMap& reads);
+    void allocate(std::size_t num_haplotypes, const std::vector<std::size_t>& num_likelihoods);
+    void set_rows();
+    LogProbability* row_data(std::size_t haplotype_idx, std::size_t sample_idx) noexcept;
+    const LikelihoodVector& row(std::size_t haplotype_idx, std::size_t sample_idx) const noexcept;
 };
 
 // non-member methods
@@ -7,8 +7,12 @@
 #include <cmath>
 #include <limits>
 #include <cassert>
+#include <mutex>
+#include <deque>
+#include <algorithm>
 
 #include "core/models/error/error_model_factory.hpp"
+#include "core/models/error/reference_window.hpp"
 #include "concepts/mappable.hpp"
 #include "utils/maths.hpp"
 
@@ -32,6 +36,70 @@ HaplotypeLikelihoodModel::ShortHaplotypeError::required_extension() const noexce
     return required_extension_;
 }
 
+// HaplotypePenaltyCache
+
+// The penalties of the reference sequence of a window, which the penalties of haplotypes in the window patch
+struct HaplotypeLikelihoodModel::ReferencePenalties
+{
+    ReferenceWindow window;
+    HaplotypePenalties penalties;
+};
+
+class HaplotypeLikelihoodModel::HaplotypePenaltyCache
+{
+public:
+    using PenaltiesPtr = std::shared_ptr<const HaplotypePenalties>;
+    using ReferencePenaltiesPtr = std::shared_ptr<const ReferencePenalties>;
+    
+    HaplotypePenaltyCache(std::size_t max_size = 1024, std::size_t max_windows = 8)
+    : penalties_ {}, max_size_ {max_size}, windows_ {}, max_windows_ {max_windows} {}
+    
+    // The cache is shared between threads
+    template <typename F>
+    PenaltiesPtr fetch(const Haplotype& haplotype, F compute)
+    {
+        {
+            std::lock_guard<std::mutex> lock {mutex_};
+            const auto itr = penalties_.find(haplotype);
+            if (itr != std::cend(penalties_)) return itr->second;
+        }
+        auto result = std::make_shared<const HaplotypePenalties>(compute(haplotype));
+        std::lock_guard<std::mutex> lock {mutex_};
+        if (penalties_.size() >= max_size_) {
+            penalties_.clear();
+        }
+        return penalties_.emplace(haplotype, std::move(result)).first->second;
+    }
+    
+    // Haplotypes are mostly evaluated window by window, so only the most recent windows are kept
+    template <typename F>
+    ReferencePenaltiesPtr fetch_reference(const Haplotype& haplotype, F compute)
+    {
+        const auto is_haplotype_window = [&] (const auto& window) { return is_same_region(window->window.region(), haplotype); };
+        {
+            std::lock_guard<std::mutex> lock {mutex_};
+            const auto itr = std::find_if(std::cbegin(windows_), std::cend(windows_), is_haplotype_window);
+            if (itr != std::cend(windows_)) return *itr;
+        }
+        auto result = std::make_shared<const ReferencePenalties>(compute(haplotype));
+        std::lock_guard<std::mutex> lock {mutex_};
+        const auto itr = std::find_if(std::cbegin(windows_), std::cend(windows_), is_haplotype_window);
+        if (itr != std::cend(windows_)) return *itr;
+        if (windows_.size() >= max_windows_) {
+            windows_.pop_front();
+        }
+        windows_.push_back(result);
+        return result;
+    }
+    
+private:
+    std::unordered_map<Haplotype, PenaltiesPtr, HaplotypeHash> penalties_;
+    std::size_t max_size_;
+    std::deque<ReferencePenaltiesPtr> windows_;
+    std::size_t max_windows_;
+    std::mutex mutex_;
+};
+
 // public methods
 
 const HaplotypeLikelihoodModel::Config& HaplotypeLikelihoodModel::config() const noexcept
@@ -61,26 +129,28 @@ void HaplotypeLikelihoodModel::reset(const Haplotype& haplotype, boost::optional
 {
     haplotype_ = std::addressof(haplotype);
     haplotype_flank_state_ = std::move(flank_state);
-    if (snv_error_model_) {
-        snv_error_model_->evaluate(haplotype,
-                                   haplotype_snv_forward_mask_, haplotype_snv_forward_priors_,
-                                   haplotype_snv_reverse_mask_, haplotype_snv_reverse_priors_);
-    } else {
-        // TODO: refactor HaplotypeLikelihoodModel to use another HMM evaluate overload without SNV model
-        haplotype_snv_forward_priors_.assign(sequence_size(haplotype), 100);
-        haplotype_snv_forward_mask_.assign(std::cbegin(haplotype.sequence()), std::cend(haplotype.sequence()));
-        haplotype_snv_reverse_priors_.assign(sequence_size(haplotype), 100);
-        haplotype_snv_reverse_mask_.assign(std::cbegin(haplotype.sequence()), std::cend(haplotype.sequence()));
-    }
-    if (indel_error_model_) {
-        indel_error_model_->set_penalties(haplotype, haplotype_gap_open_penalities_, haplotype_gap_extend_penalities_);
+    auto reference = haplotype_penalty_cache_->fetch_reference(haplotype, [this] (const Haplotype& haplotype) {
+        const auto reference_haplotype = make_reference_haplotype(haplotype);
+        return ReferencePenalties {ReferenceWindow {reference_haplotype}, compute_penalties(reference_haplotype)};
+    });
+    haplotype_penalties_ = haplotype_penalty_cache_->fetch(haplotype, [&] (const Haplotype& haplotype) {
+        return compute_penalties(haplotype, *reference); });
+    if (reference != reference_penalties_) {
+        reference_scores_.clear();
+        reference_penalties_ = std::move(reference);
     }
+    set_haplotype_differences();
+    has_haplotype_hashes_ = false;
 }
 
 void HaplotypeLikelihoodModel::clear() noexcept
 {
     haplotype_ = nullptr;
     haplotype_flank_state_ = boost::none;
+    haplotype_penalties_ = nullptr;
+    reference_penalties_ = nullptr;
+    haplotype_differences_ = boost::none;
+    reference_scores_.clear();
 }
 
 HaplotypeLikelihoodModel::HaplotypeLikelihoodModel()
@@ -100,8 +170,11 @@ HaplotypeLikelihoodModel::HaplotypeLikelihoodModel(std::unique_ptr<SnvErrorModel
 , indel_error_model_ {std::move(indel_model)}
 , haplotype_ {nullptr}
 , haplotype_flank_state_ {}
-, haplotype_gap_open_penalities_ {}
-, haplotype_gap_extend_penalities_ {}
+, haplotype_penalties_ {}
+, haplotype_penalty_cache_ {std::make_shared<HaplotypePenaltyCache>()}
+, reference_penalties_ {}
+, haplotype_differences_ {}
+, reference_scores_ {}
 , config_ {config}
 {
     if (config.use_int_scores) {
@@ -114,39 +187,6 @@ HaplotypeLikelihoodModel::HaplotypeLikelihoodModel(std::unique_ptr<SnvErrorModel
     }
 }
 
-HaplotypeLikelihoodModel::HaplotypeLikelihoodModel(const HaplotypeLikelihoodModel& other)
-{
-    if (other.indel_error_model_) {
-        indel_error_model_ = other.indel_error_model_->clone();
-    } else {
-        indel_error_model_ = nullptr;
-    }
-    if (other.snv_error_model_) {
-        snv_error_model_ = other.snv_error_model_->clone();
-    } else {
-        snv_error_model_ = nullptr;
-    }
-    haplotype_ = other.haplotype_;
-    haplotype_flank_state_ = other.haplotype_flank_state_;
-    haplotype_snv_forward_mask_ = other.haplotype_snv_forward_mask_;
-    haplotype_snv_reverse_mask_ = other.haplotype_snv_reverse_mask_;
-    haplotype_snv_forward_priors_ = other.haplotype_snv_forward_priors_;
-    haplotype_snv_reverse_priors_ = other.haplotype_snv_reverse_priors_;
-    haplotype_gap_open_penalities_ = other.haplotype_gap_open_penalities_;
-    haplotype_gap_extend_penalities_ = other.haplotype_gap_extend_penalities_;
-    config_ = other.config_;
-    hmm_ = other.hmm_;
-}
-
-HaplotypeLikelihoodModel& HaplotypeLikelihoodModel::operator=(const HaplotypeLikelihoodModel& other)
-{
-    if (this != &other) {
-        HaplotypeLikelihoodModel tmp {other};
-        std::swap(*this, tmp);
-    }
-    return *this;
-}
-
 void swap(HaplotypeLikelihoodModel& lhs, HaplotypeLikelihoodModel& rhs) noexcept
 {
     using std::swap;
@@ -154,14 +194,16 @@ void swap(HaplotypeLikelihoodModel& lhs, HaplotypeLikelihoodModel& rhs) noexcept
     swap(lhs.snv_error_model_, rhs.snv_error_model_);
     swap(lhs.haplotype_, rhs.haplotype_);
     swap(lhs.haplotype_flank_state_, rhs.haplotype_flank_state_);
-    swap(lhs.haplotype_snv_forward_mask_, rhs.haplotype_snv_forward_mask_);
-    swap(lhs.haplotype_snv_reverse_mask_, rhs.haplotype_snv_reverse_mask_);
-    swap(lhs.haplotype_snv_forward_priors_, rhs.haplotype_snv_forward_priors_);
-    swap(lhs.haplotype_snv_reverse_priors_, rhs.haplotype_snv_reverse_priors_);
-    swap(lhs.haplotype_gap_open_penalities_, rhs.haplotype_gap_open_penalities_);
-    swap(lhs.haplotype_gap_extend_penalities_, rhs.haplotype_gap_extend_penalities_);
+    swap(lhs.haplotype_penalties_, rhs.haplotype_penalties_);
+    swap(lhs.haplotype_penalty_cache_, rhs.haplotype_penalty_cache_);
+    swap(lhs.reference_penalties_, rhs.reference_penalties_);
+    swap(lhs.haplotype_differences_, rhs.haplotype_differences_);
+    swap(lhs.reference_scores_, rhs.reference_scores_);
     swap(lhs.config_, rhs.config_);
     swap(lhs.hmm_, rhs.hmm_);
+    swap(lhs.haplotype_forward_hashes_, rhs.haplotype_forward_hashes_);
+    swap(lhs.haplotype_reverse_hashes_, rhs.haplotype_reverse_hashes_);
+    swap(lhs.has_haplotype_hashes_, rhs.has_haplotype_hashes_);
 }
 
 bool HaplotypeLikelihoodModel::can_use_flank_state() const noexcept
@@ -185,14 +227,14 @@ HaplotypeLikelihoodModel::evaluate(const AlignedRead& read, const MappingPositio
 namespace {
 
 template <typename pHMM>
-int num_out_of_range_bases(const std::size_t mapping_position, const AlignedRead& read, const Haplotype& haplotype,
+int num_out_of_range_bases(const std::size_t target_offset, const std::size_t target_size, const Haplotype& haplotype,
                            const pHMM& hmm) noexcept
 {
     const auto required_pad = min_flank_pad(hmm);
-    if (mapping_position < required_pad) {
-        return required_pad - mapping_position;
+    if (target_offset < required_pad) {
+        return required_pad - target_offset;
     }
-    const auto mapping_end = mapping_position + sequence_size(read) + required_pad;
+    const auto mapping_end = target_offset + target_size + required_pad;
     if (mapping_end > sequence_size(haplotype)) {
         return static_cast<int>(sequence_size(haplotype)) - static_cast<int>(mapping_end);
     } else {
@@ -200,64 +242,132 @@ int num_out_of_range_bases(const std::size_t mapping_position, const AlignedRead
     }
 }
 
+template <typename pHMM>
+int num_out_of_range_bases(const std::size_t mapping_position, const AlignedRead& read, const Haplotype& haplotype,
+                           const pHMM& hmm) noexcept
+{
+    return num_out_of_range_bases(mapping_position, sequence_size(read), haplotype, hmm);
+}
+
+template <typename pHMM>
+bool is_in_range(const std::size_t target_offset, const std::size_t target_size, const Haplotype& haplotype, const pHMM& hmm) noexcept
+{
+    return num_out_of_range_bases(target_offset, target_size, haplotype, hmm) == 0;
+}
+
 template <typename pHMM>
 bool is_in_range(const std::size_t mapping_position, const AlignedRead& read, const Haplotype& haplotype, const pHMM& hmm) noexcept
 {
     return num_out_of_range_bases(mapping_position, read, haplotype, hmm) == 0;
 }
 
+struct ClippedRead
+{
+    AlignedRead::NucleotideSequence sequence;
+    AlignedRead::BaseQualityVector base_qualities;
+};
+
+void clip_read(const AlignedRead& read, const std::size_t lhs, const std::size_t rhs, ClippedRead& result)
+{
+    assert(lhs + rhs < sequence_size(read));
+    const auto size = sequence_size(read) - lhs - rhs;
+    result.sequence.assign(read.sequence(), lhs, size);
+    const auto qualities_begin = std::next(std::cbegin(read.base_qualities()), lhs);
+    result.base_qualities.assign(qualities_begin, std::next(qualities_begin, size));
+}
+
+// The number of read sequence bases, including soft clipped bases, aligned before the reference position
+// reference_offset bases from the read's aligned start. Back soft clipped bases are counted as if aligned.
+std::size_t sequence_offset(const AlignedRead& read, const std::size_t reference_offset) noexcept
+{
+    std::size_t sequence_position {0}, reference_position {0};
+    for (const auto& op : read.cigar()) {
+        const auto size = static_cast<std::size_t>(op.size());
+        if (advances_reference(op) && advances_sequence(op)) {
+            if (reference_position + size > reference_offset) {
+                return sequence_position + (reference_offset - reference_position);
+            }
+            reference_position += size;
+            sequence_position += size;
+        } else if (advances_reference(op)) {
+            if (reference_position + size > reference_offset) return sequence_position;
+            reference_position += size;
+        } else if (advances_sequence(op)) {
+            if (is_clipping(op) && reference_position > 0) {
+                return sequence_position + std::min(reference_offset - reference_position, size);
+            }
+            sequence_position += size;
+        }
+    }
+    return sequence_position;
+}
+
 } // namespace
 
-template <typename InputIt, typename pHMM>
+// Evaluates target_size bases of the read, the first of which is target_shift bases into the haplotype from each
+// mapping position of the read, or original_target_offset bases into the haplotype by the read's own alignment,
+// with evaluate(target_offset) given the position of the first evaluated base in the haplotype
+template <typename InputIt, typename pHMM, typename Evaluator>
 HaplotypeLikelihoodModel::LogProbability
 max_score(const AlignedRead& read, const Haplotype& haplotype,
           InputIt first_mapping_position, InputIt last_mapping_position,
-          const pHMM& hmm)
+          const pHMM& hmm, Evaluator evaluate,
+          const std::size_t target_shift, const std::size_t original_target_offset, const std::size_t target_size)
 {
     assert(contains(haplotype, read));
+    assert(target_size <= sequence_size(read));
     using LogProbability = HaplotypeLikelihoodModel::LogProbability;
-    using PositionType = typename std::iterator_traits<InputIt>::value_type;
-    const auto original_mapping_position = static_cast<PositionType>(begin_distance(haplotype, read));
     auto max_log_probability = std::numeric_limits<LogProbability>::lowest();
     bool is_original_position_mapped {false}, has_in_range_mapping_position {false};
     std::for_each(first_mapping_position, last_mapping_position, [&] (const auto position) {
-        if (position == original_mapping_position) {
+        const auto target_offset = static_cast<std::size_t>(position) + target_shift;
+        if (target_offset == original_target_offset) {
             is_original_position_mapped = true;
         }
-        if (is_in_range(position, read, haplotype, hmm)) {
+        if (is_in_range(target_offset, target_size, haplotype, hmm)) {
             has_in_range_mapping_position = true;
-            auto p = hmm.evaluate(read.sequence(), haplotype.sequence(), read.base_qualities(), position);
+            auto p = evaluate(target_offset);
             max_log_probability = std::max(static_cast<LogProbability>(p), max_log_probability);
         }
     });
-    if (!is_original_position_mapped && is_in_range(original_mapping_position, read, haplotype, hmm)) {
+    if (!is_original_position_mapped && is_in_range(original_target_offset, target_size, haplotype, hmm)) {
         has_in_range_mapping_position = true;
-        auto p = hmm.evaluate(read.sequence(), haplotype.sequence(), read.base_qualities(), original_mapping_position);
+        auto p = evaluate(original_target_offset);
         max_log_probability = std::max(static_cast<LogProbability>(p), max_log_probability);
     }
     if (!has_in_range_mapping_position) {
-        const auto min_shift = num_out_of_range_bases(original_mapping_position, read, haplotype, hmm);
-        auto final_mapping_position = original_mapping_position;
+        const auto min_shift = num_out_of_range_bases(original_target_offset, target_size, haplotype, hmm);
+        auto final_target_offset = original_target_offset;
         if (min_shift > 0) {
-            final_mapping_position += min_shift;
-            if (!is_in_range(final_mapping_position, read, haplotype, hmm)) {
+            final_target_offset += min_shift;
+            if (!is_in_range(final_target_offset, target_size, haplotype, hmm)) {
                 throw HaplotypeLikelihoodModel::ShortHaplotypeError {haplotype, static_cast<unsigned>(min_shift)};
             }
         } else {
             const auto min_left_shift = static_cast<unsigned>(-min_shift);
-            if (original_mapping_position >= min_left_shift) {
-                final_mapping_position -= min_left_shift;
+            if (original_target_offset >= min_left_shift) {
+                final_target_offset -= min_left_shift;
             } else {
-                auto required_extension = min_left_shift - original_mapping_position;
+                auto required_extension = min_left_shift - original_target_offset;
                 throw HaplotypeLikelihoodModel::ShortHaplotypeError {haplotype, required_extension};
             }
         }
-        max_log_probability = hmm.evaluate(read.sequence(), haplotype.sequence(), read.base_qualities(), final_mapping_position);
+        max_log_probability = evaluate(final_target_offset);
     }
-    assert(max_log_probability > std::numeric_limits<LogProbability>::lowest() && max_log_probability <= 0);
     return max_log_probability;
 }
 
+template <typename InputIt, typename pHMM, typename Evaluator>
+HaplotypeLikelihoodModel::LogProbability
+max_score(const AlignedRead& read, const Haplotype& haplotype,
+          InputIt first_mapping_position, InputIt last_mapping_position,
+          const pHMM& hmm, Evaluator evaluate)
+{
+    const auto original_mapping_position = static_cast<std::size_t>(begin_distance(haplotype, read));
+    return max_score(read, haplotype, first_mapping_position, last_mapping_position, hmm, std::move(evaluate),
+                     0, original_mapping_position, sequence_size(read));
+}
+
 HaplotypeLikelihoodModel::LogProbability
 HaplotypeLikelihoodModel::evaluate(const AlignedRead& read,
                                    MappingPositionItr first_mapping_position,
@@ -266,22 +376,381 @@ HaplotypeLikelihoodModel::evaluate(const AlignedRead& read,
     if (haplotype_ == nullptr) {
         throw std::runtime_error {"HaplotypeLikelihoodModel: no buffered Haplotype"};
     }
+    const auto difference_score = evaluate_differences(read, first_mapping_position, last_mapping_position);
+    if (difference_score) {
+        return finalise(read, *difference_score);
+    }
+    const auto model = make_hmm_parameters(read);
+    hmm_.set(model);
+    const auto clip = compute_active_clip(read);
+    LogProbability ln_prob_given_mapped;
+    if (clip.lhs == 0 && clip.rhs == 0) {
+        ln_prob_given_mapped = max_score(read, *haplotype_, first_mapping_position, last_mapping_position, hmm_,
+                                         [&] (const auto position) {
+                                             return hmm_.evaluate(read.sequence(), haplotype_->sequence(), read.base_qualities(), position);
+                                         });
+    } else {
+        thread_local ClippedRead clipped_read {};
+        clip_read(read, clip.lhs, clip.rhs, clipped_read);
+        ln_prob_given_mapped = max_score(read, *haplotype_, first_mapping_position, last_mapping_position, hmm_,
+                                         [&] (const auto position) {
+                                             return hmm_.evaluate(clipped_read.sequence, haplotype_->sequence(), clipped_read.base_qualities, position);
+                                         }, clip.target_shift, begin_distance(*haplotype_, read) + clip.reference_shift,
+                                         clipped_read.sequence.size());
+    }
+    assert(ln_prob_given_mapped > std::numeric_limits<LogProbability>::lowest() && ln_prob_given_mapped <= 0);
+    return finalise(read, ln_prob_given_mapped);
+}
+
+void
+HaplotypeLikelihoodModel::evaluate(const std::vector<const AlignedRead*>& reads,
+                                   const std::vector<MappingPositionRange>& mapping_positions,
+                                   std::vector<LogProbability>& result,
+                                   boost::optional<AlignmentScoreCache&> cache) const
+{
+    result.resize(reads.size());
+    evaluate(reads, mapping_positions, result.data(), cache);
+}
+
+void
+HaplotypeLikelihoodModel::evaluate(const std::vector<const AlignedRead*>& reads,
+                                   const std::vector<MappingPositionRange>& mapping_positions,
+                                   LogProbability* result,
+                                   boost::optional<AlignmentScoreCache&> cache) const
+{
+    assert(reads.size() == mapping_positions.size());
+    if (haplotype_ == nullptr) {
+        throw std::runtime_error {"HaplotypeLikelihoodModel: no buffered Haplotype"};
+    }
+    // The batch refers to the read sequences and the haplotype model parameters, which don't change
+    // until every batched alignment has been evaluated
+    struct BatchedAlignment
+    {
+        std::size_t read_idx;
+        AlignmentScoreCache::Key key;
+        bool is_cacheable;
+    };
+    thread_local hmm::AlignmentBatch batch {};
+    thread_local std::vector<BatchedAlignment> batched_alignments {};
+    // A deque so the batch's pointers to clipped reads stay valid as more are added
+    thread_local std::deque<ClippedRead> clipped_reads {};
+    batch.clear();
+    batched_alignments.clear();
+    clipped_reads.clear();
+    if (cache && !has_haplotype_hashes_) {
+        set_haplotype_hashes();
+    }
+    for (std::size_t read_idx {0}; read_idx < reads.size(); ++read_idx) {
+        const auto& read = *reads[read_idx];
+        const auto difference_score = evaluate_differences(read, mapping_positions[read_idx].first, mapping_positions[read_idx].second);
+        if (difference_score) {
+            result[read_idx] = *difference_score;
+            continue;
+        }
+        const auto model = make_hmm_parameters(read);
+        hmm_.set(model);
+        const auto clip = compute_active_clip(read);
+        const auto* sequence = &read.sequence();
+        const auto* base_qualities = &read.base_qualities();
+        if (clip.lhs > 0 || clip.rhs > 0) {
+            clipped_reads.emplace_back();
+            clip_read(read, clip.lhs, clip.rhs, clipped_reads.back());
+            sequence = &clipped_reads.back().sequence;
+            base_qualities = &clipped_reads.back().base_qualities;
+        }
+        AlignmentScoreCache::Key read_key {};
+        if (cache) {
+            utils::hash_bytes(read_key, sequence->data(), sequence->size());
+            utils::hash_bytes(read_key, base_qualities->data(), base_qualities->size());
+        }
+        const auto& haplotype_hashes = read.is_marked_reverse_mapped() ? haplotype_reverse_hashes_ : haplotype_forward_hashes_;
+        const auto hash_window = [&] (utils::Hash128& hash, const std::size_t offset, const std::size_t size) noexcept {
+            haplotype_hashes.hash_range(hash, offset, size);
+        };
+        result[read_idx] = max_score(read, *haplotype_, mapping_positions[read_idx].first, mapping_positions[read_idx].second, hmm_,
+                                     [&] (const auto position) {
+                                         auto key = read_key;
+                                         const bool is_cacheable {cache && hmm_.hash_truth(haplotype_->sequence(), sequence->size(), position, key, hash_window)};
+                                         if (is_cacheable) {
+                                             const auto cached_score = cache->find(key);
+                                             if (cached_score) return *cached_score;
+                                         }
+                                         const auto p = hmm_.evaluate(*sequence, haplotype_->sequence(), *base_qualities,
+                                                                      position, batch, batched_alignments.size());
+                                         if (p) {
+                                             if (is_cacheable) cache->insert(key, *p);
+                                             return *p;
+                                         }
+                                         batched_alignments.push_back({read_idx, key, is_cacheable});
+                                         return std::numeric_limits<LogProbability>::lowest();
+                                     }, clip.target_shift, begin_distance(*haplotype_, read) + clip.reference_shift,
+                                     sequence->size());
+    }
+    hmm_.evaluate(batch, [&] (const std::size_t alignment_idx, const LogProbability p) {
+        const auto& alignment = batched_alignments[alignment_idx];
+        result[alignment.read_idx] = std::max(p, result[alignment.read_idx]);
+        if (alignment.is_cacheable) cache->insert(alignment.key, p);
+    });
+    for (std::size_t read_idx {0}; read_idx < reads.size(); ++read_idx) {
+        assert(result[read_idx] > std::numeric_limits<LogProbability>::lowest() && result[read_idx] <= 0);
+        result[read_idx] = finalise(*reads[read_idx], result[read_idx]);
+    }
+}
+
+void
+HaplotypeLikelihoodModel::evaluate(const std::vector<const AlignedRead*>& reads,
+                                   const std::vector<MappingPositionRange>& mapping_positions,
+                                   float* result,
+                                   boost::optional<AlignmentScoreCache&> cache) const
+{
+    thread_local std::vector<LogProbability> buffer {};
+    evaluate(reads, mapping_positions, buffer, cache);
+    std::copy(std::cbegin(buffer), std::cend(buffer), result);
+}
+
+void HaplotypeLikelihoodModel::set_haplotype_hashes() const
+{
+    // Each position's value packs everything the pair HMM reads from the haplotype model at that position
+    const auto& sequence = haplotype_->sequence();
+    const auto& penalties = *haplotype_penalties_;
+    assert(penalties.gap_open_penalities.size() >= sequence.size() && penalties.gap_extend_penalities.size() >= sequence.size());
+    const auto set_hashes = [&] (const std::vector<char>& snv_mask, const std::vector<Penalty>& snv_priors, utils::PrefixHashes& result) {
+        result.assign(sequence.size(), [&] (const std::size_t i) noexcept {
+            using Value = utils::PrefixHashes::Value;
+            return static_cast<Value>(static_cast<unsigned char>(sequence[i]))
+                   | static_cast<Value>(static_cast<std::uint8_t>(penalties.gap_open_penalities[i])) << 8
+                   | static_cast<Value>(static_cast<std::uint8_t>(penalties.gap_extend_penalities[i])) << 16
+                   | static_cast<Value>(static_cast<unsigned char>(snv_mask[i])) << 24
+                   | static_cast<Value>(static_cast<std::uint8_t>(snv_priors[i])) << 32;
+        });
+    };
+    set_hashes(penalties.snv_forward_mask, penalties.snv_forward_priors, haplotype_forward_hashes_);
+    set_hashes(penalties.snv_reverse_mask, penalties.snv_reverse_priors, haplotype_reverse_hashes_);
+    has_haplotype_hashes_ = true;
+}
+
+// Enough bases either side of an evaluated part of a read that alignments near its edges aren't forced
+std::size_t HaplotypeLikelihoodModel::clip_margin() const noexcept
+{
+    constexpr std::size_t min_margin {50};
+    return std::max(min_margin, static_cast<std::size_t>(4 * hmm_.band_size()));
+}
+
+// Reads longer than the active region are mostly aligned to the flanks, which are the same in every haplotype
+// of the window, and whose alignment scores are discounted anyway. So leaving the flank bases of long reads out
+// of the evaluation changes the likelihoods of the haplotypes by about the same constant, but saves aligning the
+// whole read to every haplotype. A margin of flank bases is kept either side so that alignments near the edges of
+// the active region, including indels, aren't forced. The clip is found in reference coordinates, so is the same
+// for every haplotype of the window, and mapped to read sequence coordinates through the read's alignment, so
+// the clipped read is evaluated on its own diagonal however many soft clipped bases and indels it has.
+HaplotypeLikelihoodModel::ReadClip
+HaplotypeLikelihoodModel::compute_active_clip(const AlignedRead& read) const noexcept
+{
+    const auto read_size = sequence_size(read);
+    if (!config_.min_active_clipped_read_length || read_size < *config_.min_active_clipped_read_length || !haplotype_flank_state_) {
+        return {0, 0, 0, 0};
+    }
+    const auto margin = clip_margin();
+    const auto read_begin = static_cast<std::size_t>(begin_distance(*haplotype_, read));
+    const auto read_end = read_begin + static_cast<std::size_t>(region_size(read));
+    const auto active_begin = static_cast<std::size_t>(haplotype_flank_state_->lhs_flank);
+    const auto active_end = static_cast<std::size_t>(region_size(*haplotype_) - haplotype_flank_state_->rhs_flank);
+    ReadClip result {0, 0, 0, 0};
+    if (active_begin > read_begin + margin) {
+        result.reference_shift = active_begin - margin - read_begin;
+        result.lhs = sequence_offset(read, result.reference_shift);
+        // Mapping positions are where the first sequence base, which may be soft clipped, maps
+        result.target_shift = get_soft_clipped_sizes(read).first + result.reference_shift;
+    }
+    if (read_end > active_end + margin) {
+        result.rhs = read_size - sequence_offset(read, active_end + margin - read_begin);
+    }
+    // Reads that barely overlap the active region are evaluated in full
+    if (result.lhs + result.rhs + margin >= read_size) {
+        return {0, 0, 0, 0};
+    }
+    return result;
+}
+
+void HaplotypeLikelihoodModel::set_haplotype_differences()
+{
+    haplotype_differences_ = boost::none;
+    if (!config_.min_difference_scored_haplotype_length || region_size(*haplotype_) < *config_.min_difference_scored_haplotype_length) {
+        return;
+    }
+    // The haplotype has the same sequence and penalties as the reference outside the non-reference segments
+    const auto segments = reference_penalties_->window.split(*haplotype_, ReferenceWindow::Context::smoothed_repeats);
+    if (!segments) return;
+    haplotype_differences_ = std::vector<DifferenceSpan> {};
+    auto& differences = *haplotype_differences_;
+    std::size_t reference_position {0};
+    bool is_in_difference {false};
+    for (const auto& segment : *segments) {
+        if (segment.is_reference) {
+            if (is_in_difference) {
+                differences.back().reference_end = segment.reference_begin;
+                is_in_difference = false;
+            }
+            reference_position = segment.reference_begin + (segment.end - segment.begin);
+        } else if (is_in_difference) {
+            differences.back().end = segment.end;
+        } else {
+            differences.push_back({segment.begin, segment.end, reference_position, reference_position});
+            is_in_difference = true;
+        }
+    }
+    if (is_in_difference) {
+        differences.back().reference_end = reference_penalties_->window.sequence().size();
+    }
+}
+
+boost::optional<HaplotypeLikelihoodModel::LogProbability>
+HaplotypeLikelihoodModel::evaluate_reference(const AlignedRead& read) const
+{
+    const auto itr = reference_scores_.find(std::addressof(read));
+    if (itr != std::cend(reference_scores_)) return itr->second;
+    const auto& reference = reference_penalties_->window.sequence();
+    const auto read_begin = static_cast<std::size_t>(begin_distance(*haplotype_, read));
+    const auto pad = static_cast<std::size_t>(min_flank_pad(hmm_));
+    if (read_begin < pad || read_begin + sequence_size(read) + pad > reference.size()) return boost::none;
+    const auto model = make_hmm_parameters(read, reference_penalties_->penalties);
+    hmm_.set(model);
+    const auto result = hmm_.evaluate(read.sequence(), reference, read.base_qualities(), read_begin);
+    reference_scores_.emplace(std::addressof(read), result);
+    return result;
+}
+
+/*
+    A read that extends well beyond the parts of the haplotype that differ from the reference aligns to the
+    haplotype the same way as to the reference, except around the differences. So the likelihood of the read is
+    approximately the likelihood of the read given the reference, which is computed once per window, adjusted by
+    the difference between aligning just the part of the read around the differences to the haplotype and to the
+    reference. Returns none if the read should be evaluated in full.
+    
+    The read is placed by its own alignment, so only reads whose sequence is aligned without soft clips or
+    indels, and that don't map anywhere else in the haplotype, are evaluated this way.
+ */
+boost::optional<HaplotypeLikelihoodModel::LogProbability>
+HaplotypeLikelihoodModel::evaluate_differences(const AlignedRead& read,
+                                               const MappingPositionItr first_mapping_position,
+                                               const MappingPositionItr last_mapping_position) const
+{
+    if (!haplotype_differences_) return boost::none;
+    if (is_soft_clipped(read.cigar()) || has_indel(read.cigar())) return boost::none;
+    const auto& differences = *haplotype_differences_;
+    const auto margin = clip_margin();
+    const auto read_size = sequence_size(read);
+    const auto read_begin = static_cast<std::size_t>(begin_distance(*haplotype_, read));
+    const auto read_end = read_begin + read_size;
+    const auto first_difference = std::find_if(std::cbegin(differences), std::cend(differences),
+                                               [&] (const DifferenceSpan& difference) { return difference.reference_end + margin > read_begin; });
+    const auto last_difference = std::find_if(first_difference, std::cend(differences),
+                                              [&] (const DifferenceSpan& difference) { return difference.reference_begin >= read_end + margin; });
+    // The haplotype and reference are the same between differences, so the read's haplotype position is
+    // shifted from its reference position by the size change of the differences before it
+    auto haplotype_read_begin = static_cast<std::ptrdiff_t>(read_begin);
+    if (first_difference != std::cbegin(differences)) {
+        const auto& prev_difference = *std::prev(first_difference);
+        haplotype_read_begin += static_cast<std::ptrdiff_t>(prev_difference.end) - static_cast<std::ptrdiff_t>(prev_difference.reference_end);
+    }
+    if (std::any_of(first_mapping_position, last_mapping_position,
+                    [&] (const auto position) { return static_cast<std::ptrdiff_t>(position) != haplotype_read_begin; })) {
+        return boost::none;
+    }
+    if (first_difference == last_difference) {
+        return evaluate_reference(read);
+    }
+    const auto& last_overlapped_difference = *std::prev(last_difference);
+    const auto reference_begin = first_difference->reference_begin, reference_end = last_overlapped_difference.reference_end;
+    if (reference_begin < read_begin + margin || reference_end + margin > read_end) return boost::none;
+    // The read is aligned without gaps, so sequence and reference offsets are the same
+    const ReadClip clip {reference_begin - margin - read_begin, read_end - reference_end - margin, 0, 0};
+    if (clip.lhs == 0 && clip.rhs == 0) return boost::none;
+    const auto target_size = read_size - clip.lhs - clip.rhs;
+    const auto haplotype_offset = first_difference->begin - margin;
+    const auto reference_offset = reference_begin - margin;
+    const auto pad = static_cast<std::size_t>(min_flank_pad(hmm_));
+    const auto& reference = reference_penalties_->window.sequence();
+    if (haplotype_offset < pad || haplotype_offset + target_size + pad > sequence_size(*haplotype_)
+        || reference_offset < pad || reference_offset + target_size + pad > reference.size()) {
+        return boost::none;
+    }
+    const auto reference_score = evaluate_reference(read);
+    if (!reference_score) return boost::none;
+    thread_local ClippedRead clipped_read {};
+    clip_read(read, clip.lhs, clip.rhs, clipped_read);
+    const auto haplotype_model = make_hmm_parameters(read);
+    hmm_.set(haplotype_model);
+    const auto haplotype_difference_score = hmm_.evaluate(clipped_read.sequence, haplotype_->sequence(), clipped_read.base_qualities, haplotype_offset);
+    const auto reference_model = make_hmm_parameters(read, reference_penalties_->penalties);
+    hmm_.set(reference_model);
+    const auto reference_difference_score = hmm_.evaluate(clipped_read.sequence, reference, clipped_read.base_qualities, reference_offset);
+    return std::min(*reference_score + haplotype_difference_score - reference_difference_score, LogProbability {0});
+}
+
+HaplotypeLikelihoodModel::HaplotypePenalties
+HaplotypeLikelihoodModel::compute_penalties(const Haplotype& haplotype, boost::optional<const ReferencePenalties&> reference) const
+{
+    HaplotypePenalties result {};
+    if (snv_error_model_) {
+        if (reference) {
+            snv_error_model_->evaluate(haplotype, reference->window,
+                                       reference->penalties.snv_forward_priors, reference->penalties.snv_reverse_priors,
+                                       result.snv_forward_mask, result.snv_forward_priors,
+                                       result.snv_reverse_mask, result.snv_reverse_priors);
+        } else {
+            snv_error_model_->evaluate(haplotype,
+                                       result.snv_forward_mask, result.snv_forward_priors,
+                                       result.snv_reverse_mask, result.snv_reverse_priors);
+        }
+    } else {
+        // TODO: refactor HaplotypeLikelihoodModel to use another HMM evaluate overload without SNV model
+        result.snv_forward_priors.assign(sequence_size(haplotype), 100);
+        result.snv_forward_mask.assign(std::cbegin(haplotype.sequence()), std::cend(haplotype.sequence()));
+        result.snv_reverse_priors.assign(sequence_size(haplotype), 100);
+        result.snv_reverse_mask.assign(std::cbegin(haplotype.sequence()), std::cend(haplotype.sequence()));
+    }
+    if (indel_error_model_) {
+        if (reference) {
+            indel_error_model_->set_penalties(haplotype, reference->window,
+                                              reference->penalties.gap_open_penalities, reference->penalties.gap_extend_penalities,
+                                              result.gap_open_penalities, result.gap_extend_penalities);
+        } else {
+            indel_error_model_->set_penalties(haplotype, result.gap_open_penalities, result.gap_extend_penalities);
+        }
+    }
+    return result;
+}
+
+HaplotypeLikelihoodModel::HMM::ParameterType
+HaplotypeLikelihoodModel::make_hmm_parameters(const AlignedRead& read) const noexcept
+{
+    return make_hmm_parameters(read, *haplotype_penalties_);
+}
+
+HaplotypeLikelihoodModel::HMM::ParameterType
+HaplotypeLikelihoodModel::make_hmm_parameters(const AlignedRead& read, const HaplotypePenalties& penalties) const noexcept
+{
     const auto is_forward = !read.is_marked_reverse_mapped();
-    HMM::ParameterType model {
-        haplotype_gap_open_penalities_,
-        haplotype_gap_extend_penalities_,
-        is_forward ? haplotype_snv_forward_mask_ : haplotype_snv_reverse_mask_,
-        is_forward ? haplotype_snv_forward_priors_ : haplotype_snv_reverse_priors_
+    HMM::ParameterType result {
+        penalties.gap_open_penalities,
+        penalties.gap_extend_penalities,
+        is_forward ? penalties.snv_forward_mask : penalties.snv_reverse_mask,
+        is_forward ? penalties.snv_forward_priors : penalties.snv_reverse_priors
     };
     if (haplotype_flank_state_) {
-        model.lhs_flank_size = haplotype_flank_state_->lhs_flank;
-        model.rhs_flank_size = haplotype_flank_state_->rhs_flank;
+        result.lhs_flank_size = haplotype_flank_state_->lhs_flank;
+        result.rhs_flank_size = haplotype_flank_state_->rhs_flank;
     } else {
-        model.lhs_flank_size = 0;
-        model.rhs_flank_size = 0;
+        result.lhs_flank_size = 0;
+        result.rhs_flank_size = 0;
     }
-    hmm_.set(model);
-    const auto ln_prob_given_mapped = max_score(read, *haplotype_, first_mapping_position, last_mapping_position, hmm_);
+    return result;
+}
+
+HaplotypeLikelihoodModel::LogProbability
+HaplotypeLikelihoodModel::finalise(const AlignedRead& read, const LogProbability ln_prob_given_mapped) const
+{
     if (config_.use_mapping_quality) {
         // This calculation is approximately
         // p(read | hap) = p(read missmapped) p(read | hap, missmapped)
@@ -336,7 +805,7 @@ template <typename InputIt, typename pHMM>
 HaplotypeLikelihoodModel::Alignment
 compute_optimal_alignment(const AlignedRead& read, const Haplotype& haplotype,
                           InputIt first_mapping_position, InputIt last_mapping_position,
-                          const pHMM& hmm)
+                          const pHMM& hmm, const bool is_score_exact)
 {
     assert(contains(haplotype, read));
     using LogProbability = HaplotypeLikelihoodModel::LogProbability;
@@ -344,25 +813,40 @@ compute_optimal_alignment(const AlignedRead& read, const Haplotype& haplotype,
     const auto original_mapping_position = static_cast<PositionType>(begin_distance(haplotype, read));
     HaplotypeLikelihoodModel::Alignment result {};
     result.likelihood = std::numeric_limits<LogProbability>::lowest();
-    bool is_original_position_mapped {false}, has_in_range_mapping_position {false};
+    thread_local std::vector<std::pair<std::size_t, LogProbability>> candidates {};
+    candidates.clear();
+    bool is_original_position_mapped {false};
     std::for_each(first_mapping_position, last_mapping_position, [&] (const auto position) {
         if (position == original_mapping_position) {
             is_original_position_mapped = true;
         }
         if (is_in_range(position, read, haplotype, hmm)) {
-            has_in_range_mapping_position = true;
-            auto alignment = hmm.align(read.sequence(), haplotype.sequence(), read.base_qualities(), position);
-            if (alignment.likelihood > result.likelihood) {
-                result.mapping_position = alignment.target_offset;
-                result.likelihood = alignment.likelihood;
-                result.cigar = std::move(alignment.cigar);
-            }
+            candidates.emplace_back(position, 0);
         }
     });
+    // The original position wins ties, unlike the mapped positions where the first wins
+    bool is_original_position_appended {false};
     if (!is_original_position_mapped && is_in_range(original_mapping_position, read, haplotype, hmm)) {
-        has_in_range_mapping_position = true;
-        auto alignment = hmm.align(read.sequence(), haplotype.sequence(), read.base_qualities(), original_mapping_position);
-        if (alignment.likelihood >= result.likelihood) {
+        candidates.emplace_back(original_mapping_position, 0);
+        is_original_position_appended = true;
+    }
+    const bool has_in_range_mapping_position {!candidates.empty()};
+    // A traceback costs much more than a score, so when the score is the likelihood of the traceback
+    // alignment (no flank discount), only the positions that can be optimal are traced back.
+    auto min_candidate_likelihood = std::numeric_limits<LogProbability>::lowest();
+    if (candidates.size() > 1 && is_score_exact) {
+        for (auto& candidate : candidates) {
+            candidate.second = hmm.evaluate(read.sequence(), haplotype.sequence(), read.base_qualities(), candidate.first);
+            min_candidate_likelihood = std::max(candidate.second, min_candidate_likelihood);
+        }
+        min_candidate_likelihood -= maths::constants::ln10Div10<>; // allow for rounding between the two
+    }
+    for (std::size_t i {0}; i < candidates.size(); ++i) {
+        if (min_candidate_likelihood > std::numeric_limits<LogProbability>::lowest()
+            && candidates[i].second < min_candidate_likelihood) continue;
+        auto alignment = hmm.align(read.sequence(), haplotype.sequence(), read.base_qualities(), candidates[i].first);
+        const bool is_original = is_original_position_appended && i + 1 == candidates.size();
+        if (alignment.likelihood > result.likelihood || (is_original && alignment.likelihood == result.likelihood)) {
             result.mapping_position = alignment.target_offset;
             result.likelihood = alignment.likelihood;
             result.cigar = std::move(alignment.cigar);
@@ -401,10 +885,11 @@ HaplotypeLikelihoodModel::align(const AlignedRead& read, MappingPositionItr firs
         throw std::runtime_error {"HaplotypeLikelihoodModel: no buffered Haplotype"};
     }
     const auto is_forward = !read.is_marked_reverse_mapped();
-    HMM::ParameterType model {haplotype_gap_open_penalities_,
-                              haplotype_gap_extend_penalities_,
-                              is_forward ? haplotype_snv_forward_mask_ : haplotype_snv_reverse_mask_,
-                              is_forward ? haplotype_snv_forward_priors_ : haplotype_snv_reverse_priors_};
+    const auto& penalties = *haplotype_penalties_;
+    HMM::ParameterType model {penalties.gap_open_penalities,
+                              penalties.gap_extend_penalities,
+                              is_forward ? penalties.snv_forward_mask : penalties.snv_reverse_mask,
+                              is_forward ? penalties.snv_forward_priors : penalties.snv_reverse_priors};
     if (haplotype_flank_state_) {
         model.lhs_flank_size = haplotype_flank_state_->lhs_flank;
         model.rhs_flank_size = haplotype_flank_state_->rhs_flank;
@@ -413,7 +898,8 @@ HaplotypeLikelihoodModel::align(const AlignedRead& read, MappingPositionItr firs
         model.rhs_flank_size = 0;
     }
     hmm_.set(model);
-    auto result = compute_optimal_alignment(read, *haplotype_, first_mapping_position, last_mapping_position, hmm_);
+    const bool is_score_exact {model.lhs_flank_size == 0 && model.rhs_flank_size == 0};
+    auto result = compute_optimal_alignment(read, *haplotype_, first_mapping_position, last_mapping_position, hmm_, is_score_exact);
     if (config_.use_mapping_quality) {
         auto mapping_quality = read.mapping_quality();
         if (config_.mapping_quality_cap_trigger && mapping_quality >= *config_.mapping_quality_cap_trigger) {
@@ -430,6 +916,119 @@ HaplotypeLikelihoodModel::align(const AlignedRead& read, MappingPositionItr firs
     return result;
 }
 
+namespace {
+
+using AlignmentScoreCacheIndex = std::uint32_t;
+
+constexpr AlignmentScoreCacheIndex nullScoreEntry {std::numeric_limits<AlignmentScoreCacheIndex>::max()};
+
+std::size_t alignment_score_cache_capacity(const std::size_t max_memory) noexcept
+{
+    // Each score has an entry, and an index node of its key, the entry index, and about two pointers
+    using Key = HaplotypeLikelihoodModel::AlignmentScoreCache::Key;
+    constexpr std::size_t bytes_per_score {sizeof(Key) + sizeof(HaplotypeLikelihoodModel::LogProbability)
+                                           + 2 * sizeof(AlignmentScoreCacheIndex)
+                                           + sizeof(std::pair<const Key, AlignmentScoreCacheIndex>) + 2 * sizeof(void*)};
+    return std::min<std::size_t>(std::max<std::size_t>(max_memory / bytes_per_score, 1), nullScoreEntry);
+}
+
+} // namespace
+
+HaplotypeLikelihoodModel::AlignmentScoreCache::AlignmentScoreCache(const std::size_t max_memory)
+: entries_ {}
+, indices_ {}
+, head_ {nullScoreEntry}
+, tail_ {nullScoreEntry}
+, capacity_ {alignment_score_cache_capacity(max_memory)}
+{}
+
+boost::optional<HaplotypeLikelihoodModel::LogProbability>
+HaplotypeLikelihoodModel::AlignmentScoreCache::find(const Key& key) noexcept
+{
+    const auto itr = indices_.find(key);
+    if (itr != std::cend(indices_)) {
+        if (itr->second != head_) {
+            unlink(itr->second);
+            push_front(itr->second);
+        }
+        return entries_[itr->second].score;
+    } else {
+        return boost::none;
+    }
+}
+
+void HaplotypeLikelihoodModel::AlignmentScoreCache::insert(const Key& key, const LogProbability score)
+{
+    const auto itr = indices_.find(key);
+    if (itr != std::cend(indices_)) {
+        entries_[itr->second].score = score;
+        if (itr->second != head_) {
+            unlink(itr->second);
+            push_front(itr->second);
+        }
+        return;
+    }
+    EntryIndex index;
+    if (entries_.size() < capacity_) {
+        index = static_cast<EntryIndex>(entries_.size());
+        entries_.push_back({key, score, nullScoreEntry, nullScoreEntry});
+    } else {
+        index = tail_;
+        unlink(index);
+        indices_.erase(entries_[index].key);
+        entries_[index].key = key;
+        entries_[index].score = score;
+    }
+    push_front(index);
+    indices_.emplace(key, index);
+}
+
+std::size_t HaplotypeLikelihoodModel::AlignmentScoreCache::size() const noexcept
+{
+    return indices_.size();
+}
+
+std::size_t HaplotypeLikelihoodModel::AlignmentScoreCache::capacity() const noexcept
+{
+    return capacity_;
+}
+
+void HaplotypeLikelihoodModel::AlignmentScoreCache::clear() noexcept
+{
+    entries_.clear();
+    indices_.clear();
+    head_ = tail_ = nullScoreEntry;
+}
+
+void HaplotypeLikelihoodModel::AlignmentScoreCache::unlink(const EntryIndex index) noexcept
+{
+    auto& entry = entries_[index];
+    if (entry.prev != nullScoreEntry) {
+        entries_[entry.prev].next = entry.next;
+    } else {
+        head_ = entry.next;
+    }
+    if (entry.next != nullScoreEntry) {
+        entries_[entry.next].prev = entry.prev;
+    } else {
+        tail_ = entry.prev;
+    }
+    entry.prev = entry.next = nullScoreEntry;
+}
+
+void HaplotypeLikelihoodModel::AlignmentScoreCache::push_front(const EntryIndex index) noexcept
+{
+    auto& entry = entries_[index];
+    entry.prev = nullScoreEntry;
+    entry.next = head_;
+    if (head_ != nullScoreEntry) {
+        entries_[head_].prev = index;
+    } else {
+        tail_ = index;
+    }
+    head_ = index;
+}
+
 HaplotypeLikelihoodModel make_haplotype_likelihood_model(const std::string label, bool use_mapping_quality)
 {
     HaplotypeLikelihoodModel::Config config {};
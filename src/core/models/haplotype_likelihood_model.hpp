@@ -12,6 +12,8 @@
 #include <functional>
 #include <memory>
 #include <stdexcept>
+#include <utility>
+#include <unordered_map>
 
 #include <boost/optional.hpp>
 
@@ -23,6 +25,7 @@
 #include "core/types/haplotype.hpp"
 #include "core/models/error/snv_error_model.hpp"
 #include "core/models/error/indel_error_model.hpp"
+#include "utils/hash_functions.hpp"
 #include "pairhmm/pair_hmm.hpp"
 
 namespace octopus {
@@ -41,6 +44,12 @@ public:
         bool use_flank_state = true;
         unsigned max_indel_error = 8;
         bool use_int_scores = false;
+        // Reads at least this long are only evaluated over the bases that can align to the active part of the
+        // haplotype (between the flanks), which needs a flank state
+        boost::optional<std::size_t> min_active_clipped_read_length = boost::none;
+        // Haplotypes at least this long are scored by how reads align to the parts of the haplotype that differ
+        // from the reference, relative to how the reads align to the reference
+        boost::optional<std::size_t> min_difference_scored_haplotype_length = boost::none;
     };
     
     struct FlankState
@@ -49,10 +58,12 @@ public:
     };
     
     class ShortHaplotypeError;
+    class AlignmentScoreCache;
     
     using MappingPosition       = std::size_t;
     using MappingPositionVector = std::vector<MappingPosition>;
     using MappingPositionItr    = MappingPositionVector::const_iterator;
+    using MappingPositionRange  = std::pair<MappingPositionItr, MappingPositionItr>;
     
     struct Alignment
     {
@@ -69,8 +80,8 @@ public:
                              std::unique_ptr<IndelErrorModel> indel_model,
                              Config config);
     
-    HaplotypeLikelihoodModel(const HaplotypeLikelihoodModel&);
-    HaplotypeLikelihoodModel& operator=(const HaplotypeLikelihoodModel&);
+    HaplotypeLikelihoodModel(const HaplotypeLikelihoodModel&)            = default;
+    HaplotypeLikelihoodModel& operator=(const HaplotypeLikelihoodModel&) = default;
     HaplotypeLikelihoodModel(HaplotypeLikelihoodModel&&)            = default;
     HaplotypeLikelihoodModel& operator=(HaplotypeLikelihoodModel&&) = default;
     
@@ -94,6 +105,23 @@ public:
     LogProbability evaluate(const AlignedRead& read, const MappingPositionVector& mapping_positions) const;
     LogProbability evaluate(const AlignedRead& read, MappingPositionItr first_mapping_position, MappingPositionItr last_mapping_position) const;
     
+    // As evaluate for each read, but full alignments of the reads are computed together in SIMD batches.
+    // Alignment scores found in cache are reused, and those computed are added to it.
+    void evaluate(const std::vector<const AlignedRead*>& reads,
+                  const std::vector<MappingPositionRange>& mapping_positions,
+                  std::vector<LogProbability>& result,
+                  boost::optional<AlignmentScoreCache&> cache = boost::none) const;
+    // As above, writing reads.size() results to result
+    void evaluate(const std::vector<const AlignedRead*>& reads,
+                  const std::vector<MappingPositionRange>& mapping_positions,
+                  LogProbability* result,
+                  boost::optional<AlignmentScoreCache&> cache = boost::none) const;
+    // As above, but rounds the results to single precision
+    void evaluate(const std::vector<const AlignedRead*>& reads,
+                  const std::vector<MappingPositionRange>& mapping_positions,
+                  float* result,
+                  boost::optional<AlignmentScoreCache&> cache = boost::none) const;
+    
     // ln p(read template | haplotype, model)
     LogProbability evaluate(const AlignedTemplate& reads) const;
     LogProbability evaluate(const AlignedTemplate& reads, const std::vector<MappingPositionVector>& mapping_positions) const;
@@ -105,19 +133,71 @@ public:
 private:
     using HMM = hmm::PairHMM<hmm::MutationModel>;
     
-    std::unique_ptr<SnvErrorModel> snv_error_model_;
-    std::unique_ptr<IndelErrorModel> indel_error_model_;
+    // The error model penalties of a haplotype, which only depend on the haplotype
+    struct HaplotypePenalties
+    {
+        std::vector<char> snv_forward_mask, snv_reverse_mask;
+        std::vector<Penalty> snv_forward_priors, snv_reverse_priors;
+        std::vector<Penalty> gap_open_penalities, gap_extend_penalities;
+    };
+    
+    struct ReferencePenalties;
+    class HaplotypePenaltyCache;
+    
+    // The number of bases left out of the evaluation at either end of a read. The first evaluated base is
+    // target_shift bases into the haplotype from where the read sequence maps into it, and reference_shift
+    // reference bases from the read's aligned start.
+    struct ReadClip
+    {
+        std::size_t lhs, rhs;
+        std::size_t target_shift, reference_shift;
+    };
+    
+    // A part of a haplotype that differs from the reference, in haplotype and reference coordinates
+    struct DifferenceSpan
+    {
+        std::size_t begin, end;
+        std::size_t reference_begin, reference_end;
+    };
+    
+    // Error models are immutable so are shared by all copies of the model
+    std::shared_ptr<const SnvErrorModel> snv_error_model_;
+    std::shared_ptr<const IndelErrorModel> indel_error_model_;
     
     const Haplotype* haplotype_;
     
     boost::optional<FlankState> haplotype_flank_state_;
     
-    std::vector<char> haplotype_snv_forward_mask_, haplotype_snv_reverse_mask_;
-    std::vector<Penalty> haplotype_snv_forward_priors_, haplotype_snv_reverse_priors_;
+    // Computed once per haplotype, by patching the penalties of the reference sequence of the haplotype's
+    // window, and shared by every copy of the model (copies have the same error models)
+    std::shared_ptr<const HaplotypePenalties> haplotype_penalties_;
+    std::shared_ptr<HaplotypePenaltyCache> haplotype_penalty_cache_;
+    std::shared_ptr<const ReferencePenalties> reference_penalties_;
+    
+    // Only set for haplotypes that are scored by their differences with the reference
+    boost::optional<std::vector<DifferenceSpan>> haplotype_differences_;
+    // ln p(read | reference, mapped) for reads of the current window, computed on demand
+    mutable std::unordered_map<const AlignedRead*, LogProbability> reference_scores_;
     
-    std::vector<Penalty> haplotype_gap_open_penalities_, haplotype_gap_extend_penalities_;
     Config config_;
     mutable HMM hmm_;
+    
+    // Hashes of the haplotype model for each read direction, so alignment windows are hashed in constant time
+    mutable utils::PrefixHashes haplotype_forward_hashes_, haplotype_reverse_hashes_;
+    mutable bool has_haplotype_hashes_ = false;
+    
+    HaplotypePenalties compute_penalties(const Haplotype& haplotype, boost::optional<const ReferencePenalties&> reference = boost::none) const;
+    HMM::ParameterType make_hmm_parameters(const AlignedRead& read) const noexcept;
+    HMM::ParameterType make_hmm_parameters(const AlignedRead& read, const HaplotypePenalties& penalties) const noexcept;
+    void set_haplotype_hashes() const;
+    std::size_t clip_margin() const noexcept;
+    ReadClip compute_active_clip(const AlignedRead& read) const noexcept;
+    void set_haplotype_differences();
+    boost::optional<LogProbability> evaluate_reference(const AlignedRead& read) const;
+    boost::optional<LogProbability> evaluate_differences(const AlignedRead& read,
+                                                         MappingPositionItr first_mapping_position,
+                                                         MappingPositionItr last_mapping_position) const;
+    LogProbability finalise(const AlignedRead& read, LogProbability ln_prob_given_mapped) const;
 };
 
 class HaplotypeLikelihoodModel::ShortHaplotypeError : public std::runtime_error
@@ -138,6 +218,55 @@ private:
     Length required_extension_;
 };
 
+/*
+    AlignmentScoreCache memoises the pair HMM scores of reads at mapping positions in haplotypes. Scores are
+    keyed on the read sequence and base qualities, and on the haplotype model in the read's alignment window.
+    So a read's score is reused for any haplotype that is the same around the read, including the haplotypes
+    of later active regions, such as those reintroduced after a holdout or revisited by backtracking.
+    The cache holds at most max_memory bytes of scores, and evicts the least recently used score when full.
+ */
+class HaplotypeLikelihoodModel::AlignmentScoreCache
+{
+public:
+    using Key = utils::Hash128;
+    
+    AlignmentScoreCache(std::size_t max_memory = 16 * 1024 * 1024);
+    
+    AlignmentScoreCache(const AlignmentScoreCache&)            = default;
+    AlignmentScoreCache& operator=(const AlignmentScoreCache&) = default;
+    AlignmentScoreCache(AlignmentScoreCache&&)                 = default;
+    AlignmentScoreCache& operator=(AlignmentScoreCache&&)      = default;
+    
+    ~AlignmentScoreCache() = default;
+    
+    // A found score becomes the most recently used
+    boost::optional<LogProbability> find(const Key& key) noexcept;
+    void insert(const Key& key, LogProbability score);
+    
+    std::size_t size() const noexcept;
+    std::size_t capacity() const noexcept;
+    void clear() noexcept;
+    
+private:
+    using EntryIndex = std::uint32_t;
+    
+    // Entries form a doubly linked recency list through their indices, so eviction reuses the entry storage
+    struct Entry
+    {
+        Key key;
+        LogProbability score;
+        EntryIndex prev, next;
+    };
+    
+    std::vector<Entry> entries_;
+    std::unordered_map<Key, EntryIndex, utils::Hash128Hash> indices_;
+    EntryIndex head_, tail_; // most and least recently used
+    std::size_t capacity_;
+    
+    void unlink(EntryIndex index) noexcept;
+    void push_front(EntryIndex index) noexcept;
+};
+
 HaplotypeLikelihoodModel make_haplotype_likelihood_model(const std::string label, bool use_mapping_quality = true);
 
 } // namespace octopus
@@ -8,6 +8,7 @@
 #include <complex>
 #include <numeric>
 #include <stdexcept>
+#include <limits>
 
 #include <boost/math/special_functions/binomial.hpp>
 
@@ -24,8 +25,8 @@ CoalescentModel::CoalescentModel(Haplotype reference, Parameters params,
 , params_ {params}
 , haplotypes_ {}
 , caching_ {caching}
-, index_cache_ {}
-, index_flag_buffer_ {}
+, num_signature_words_ {0}
+, haplotype_signatures_ {}
 , k_indel_zero_result_cache_ {2 * num_haplotyes_hint, std::vector<boost::optional<LogProbability>> {}}
 {
     if (params_.snp_heterozygosity <= 0 || params_.indel_heterozygosity <= 0) {
@@ -55,28 +56,33 @@ void CoalescentModel::set_reference(Haplotype reference)
                                         std::forward_as_tuple(reference_),
                                         std::forward_as_tuple());
     }
+    if (is_primed()) make_site_signatures();
 }
 
 void CoalescentModel::prime(MappableBlock<Haplotype> haplotypes)
 {
     haplotypes_ = std::move(haplotypes);
-    index_cache_.assign(haplotypes_.size(), boost::none);
-    index_flag_buffer_.assign(haplotypes_.size(), false);
+    make_site_signatures();
 }
 
 void CoalescentModel::unprime() noexcept
 {
     haplotypes_.clear();
     haplotypes_.shrink_to_fit();
-    index_cache_.clear();
-    index_cache_.shrink_to_fit();
-    index_flag_buffer_.clear();
-    index_flag_buffer_.shrink_to_fit();
+    num_signature_words_ = 0;
+    haplotype_signatures_.clear();
+    haplotype_signatures_.shrink_to_fit();
+    snp_site_mask_.clear();
+    repeat_indel_site_mask_.clear();
+    complex_indel_site_mask_.clear();
+    site_heterozygosities_.clear();
+    site_heterozygosities_.shrink_to_fit();
+    signature_result_cache_.clear();
 }
 
 bool CoalescentModel::is_primed() const noexcept
 {
-    return !index_cache_.empty();
+    return !haplotypes_.empty();
 }
 
 CoalescentModel::LogProbability CoalescentModel::evaluate(const Haplotype& haplotype) const
@@ -86,7 +92,7 @@ CoalescentModel::LogProbability CoalescentModel::evaluate(const Haplotype& haplo
 
 CoalescentModel::LogProbability CoalescentModel::evaluate(const std::vector<unsigned>& haplotype_indices) const
 {
-    return evaluate(count_segregating_sites(haplotype_indices));
+    return evaluate(haplotype_indices, std::true_type {});
 }
 
 namespace {
@@ -185,7 +191,16 @@ CoalescentModel::LogProbability CoalescentModel::evaluate(const SegregatingSiteC
     if (counts.repeat_indels + counts.complex_indels == 0) {
         return evaluate_no_indels(counts.snps, counts.haplotypes);
     } else {
-        const auto indel_heterozygosities = calculate_buffered_indel_heterozygosities();
+        return evaluate(counts, calculate_buffered_indel_heterozygosities());
+    }
+}
+
+CoalescentModel::LogProbability
+CoalescentModel::evaluate(const SegregatingSiteCounts& counts, const std::pair<double, double> indel_heterozygosities) const
+{
+    if (counts.repeat_indels + counts.complex_indels == 0) {
+        return evaluate_no_indels(counts.snps, counts.haplotypes);
+    } else {
         const auto repeat_indel_heterozygosity = maths::round_sf(indel_heterozygosities.second, 6);
         const auto complex_indel_heterozygosity = maths::round_sf(indel_heterozygosities.first, 6);
         SegregatingSiteCountsWithIndelHeterozygosities sites {counts, repeat_indel_heterozygosity, complex_indel_heterozygosity};
@@ -222,6 +237,80 @@ CoalescentModel::LogProbability CoalescentModel::evaluate_no_indels(const unsign
     return result;
 }
 
+namespace {
+
+unsigned count_set_bits(std::uint64_t word) noexcept
+{
+    #if defined(__GNUC__)
+    return __builtin_popcountll(word);
+    #else
+    unsigned result {0};
+    for (; word != 0; word &= word - 1) ++result;
+    return result;
+    #endif
+}
+
+} // namespace
+
+CoalescentModel::LogProbability CoalescentModel::evaluate_signature_buffer(const unsigned num_haplotypes) const
+{
+    SegregatingSiteCounts counts {num_haplotypes + 1, 0, 0, 0};
+    boost::optional<double> min_heterozygosity {}, max_heterozygosity {};
+    for (std::size_t w {0}; w < num_signature_words_; ++w) {
+        const auto sites = signature_buffer_[w];
+        counts.snps += count_set_bits(sites & snp_site_mask_[w]);
+        counts.repeat_indels += count_set_bits(sites & repeat_indel_site_mask_[w]);
+        counts.complex_indels += count_set_bits(sites & complex_indel_site_mask_[w]);
+        for (auto indels = sites & (repeat_indel_site_mask_[w] | complex_indel_site_mask_[w]); indels != 0; indels &= indels - 1) {
+            const auto site = 64 * w + count_set_bits((indels & -indels) - 1);
+            const auto site_heterozygosity = site_heterozygosities_[site];
+            min_heterozygosity = min_heterozygosity ? std::min(*min_heterozygosity, site_heterozygosity) : site_heterozygosity;
+            max_heterozygosity = max_heterozygosity ? std::max(*max_heterozygosity, site_heterozygosity) : site_heterozygosity;
+        }
+    }
+    if (!min_heterozygosity) return evaluate_no_indels(counts.snps, counts.haplotypes);
+    return evaluate(counts, std::make_pair(*min_heterozygosity, *max_heterozygosity));
+}
+
+void CoalescentModel::make_site_signatures()
+{
+    std::vector<std::vector<Variant>> differences {};
+    differences.reserve(haplotypes_.size());
+    std::vector<Variant> sites {};
+    for (const auto& haplotype : haplotypes_) {
+        differences.push_back(haplotype.difference(reference_));
+        sites.insert(std::cend(sites), std::cbegin(differences.back()), std::cend(differences.back()));
+    }
+    std::sort(std::begin(sites), std::end(sites));
+    sites.erase(std::unique(std::begin(sites), std::end(sites)), std::end(sites));
+    num_signature_words_ = (sites.size() + 63) / 64;
+    haplotype_signatures_.assign(haplotypes_.size() * num_signature_words_, 0);
+    for (std::size_t h {0}; h < differences.size(); ++h) {
+        for (const auto& variant : differences[h]) {
+            const auto site = static_cast<std::size_t>(std::distance(std::cbegin(sites), std::lower_bound(std::cbegin(sites), std::cend(sites), variant)));
+            haplotype_signatures_[h * num_signature_words_ + site / 64] |= std::uint64_t {1} << (site % 64);
+        }
+    }
+    snp_site_mask_.assign(num_signature_words_, 0);
+    repeat_indel_site_mask_.assign(num_signature_words_, 0);
+    complex_indel_site_mask_.assign(num_signature_words_, 0);
+    site_heterozygosities_.assign(sites.size(), 0);
+    for (std::size_t site {0}; site < sites.size(); ++site) {
+        const auto bit = std::uint64_t {1} << (site % 64);
+        if (is_indel(sites[site])) {
+            if (has_overlapped(reference_repeats_, sites[site])) {
+                repeat_indel_site_mask_[site / 64] |= bit;
+            } else {
+                complex_indel_site_mask_[site / 64] |= bit;
+            }
+            site_heterozygosities_[site] = calculate_heterozygosity(sites[site]);
+        } else {
+            snp_site_mask_[site / 64] |= bit;
+        }
+    }
+    signature_result_cache_.clear();
+}
+
 void CoalescentModel::fill_site_buffer(const Haplotype& haplotype) const
 {
     assert(site_buffer2_.empty());
@@ -372,6 +461,11 @@ std::size_t CoalescentModel::SegregatingSiteCountsWithIndelHeterozygositiesHash:
     return result;
 }
 
+std::size_t CoalescentModel::SiteSignatureHash::operator()(const SiteSignature& signature) const noexcept
+{
+    return boost::hash_range(std::cbegin(signature), std::cend(signature));
+}
+
 bool CoalescentModel::SegregatingSiteCountsWithIndelHeterozygositiesEqual::operator()(const SegregatingSiteCountsWithIndelHeterozygosities& lhs, const SegregatingSiteCountsWithIndelHeterozygosities& rhs) const noexcept
 {
     return lhs.counts == rhs.counts && lhs.repeat_heterozygosity == rhs.repeat_heterozygosity && lhs.complex_heterozygosity == rhs.complex_heterozygosity;
@@ -12,6 +12,7 @@
 #include <iterator>
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <tuple>
 #include <cassert>
 #include <type_traits>
@@ -93,6 +94,14 @@ private:
         bool operator()(const SegregatingSiteCountsWithIndelHeterozygosities& lhs,
                         const SegregatingSiteCountsWithIndelHeterozygosities& rhs) const noexcept;
     };
+    
+    // Bit i is set if segregating site i of the primed haplotypes is present. Signature keys have
+    // one more word holding the number of haplotypes.
+    using SiteSignature = std::vector<std::uint64_t>;
+    struct SiteSignatureHash
+    {
+        std::size_t operator()(const SiteSignature& signature) const noexcept;
+    };
 
     using SegregatingSiteCountsWithIndelHeterozygositiesCache =  std::unordered_map<
         SegregatingSiteCountsWithIndelHeterozygosities, LogProbability,
@@ -109,21 +118,31 @@ private:
     MappableBlock<Haplotype> haplotypes_;
     CachingStrategy caching_;
     
+    // Primed haplotypes are evaluated from their site signatures
+    std::size_t num_signature_words_;
+    std::vector<std::uint64_t> haplotype_signatures_; // num_signature_words_ per primed haplotype
+    SiteSignature snp_site_mask_, repeat_indel_site_mask_, complex_indel_site_mask_;
+    std::vector<double> site_heterozygosities_; // only defined for indel sites
+    
     mutable std::vector<VariantReference> site_buffer1_, site_buffer2_;
     mutable std::unordered_map<Haplotype, std::vector<Variant>> difference_value_cache_;
     mutable std::unordered_map<const Haplotype*, std::vector<Variant>> difference_address_cache_;
-    mutable std::vector<boost::optional<std::vector<Variant>>> index_cache_;
-    mutable std::vector<bool> index_flag_buffer_;
+    mutable SiteSignature signature_buffer_;
+    mutable std::unordered_map<SiteSignature, LogProbability, SiteSignatureHash> signature_result_cache_;
     mutable std::vector<std::vector<boost::optional<LogProbability>>> k_indel_zero_result_cache_;
     mutable SegregatingSiteCountsWithIndelHeterozygositiesCache k_indel_pos_result_cache_;
     
+    template <typename Container> LogProbability evaluate(const Container& haplotypes, std::true_type) const;
+    template <typename Container> LogProbability evaluate(const Container& haplotypes, std::false_type) const;
     LogProbability evaluate(const SegregatingSiteCounts& t) const;
+    LogProbability evaluate(const SegregatingSiteCounts& t, std::pair<double, double> indel_heterozygosities) const;
     LogProbability evaluate_no_indels(unsigned k_snp, unsigned n) const;
-
+    LogProbability evaluate_signature_buffer(unsigned num_haplotypes) const;
+    
+    void make_site_signatures();
+    
     void fill_site_buffer(const Haplotype& haplotype) const;
     template <typename Range> void fill_site_buffer(const Range& haplotypes) const;
-    template <typename Range> void fill_site_buffer(const Range& haplotypes, std::false_type) const;
-    template <typename Range> void fill_site_buffer(const Range& haplotypes, std::true_type) const;
     void fill_site_buffer_uncached(const Haplotype& haplotype) const;
     void fill_site_buffer_from_value_cache(const Haplotype& haplotype) const;
     void fill_site_buffer_from_address_cache(const Haplotype& haplotype) const;
@@ -135,30 +154,53 @@ private:
     double calculate_heterozygosity(const Variant& indel) const;
 };
 
+namespace detail {
+
+template <typename T, typename = void> struct is_indexed_or_index : std::false_type {};
+template <typename T>
+struct is_indexed_or_index<T, std::enable_if_t<is_indexed_v<T> || std::is_integral<T>::value>> : std::true_type {};
+
+} // namespace detail
+
 template <typename Container>
 CoalescentModel::LogProbability CoalescentModel::evaluate(const Container& haplotypes) const
 {
-    return evaluate(count_segregating_sites(haplotypes));
+    return evaluate(haplotypes, detail::is_indexed_or_index<typename Container::value_type> {});
 }
 
 // private methods
 
-namespace detail {
-
-template <typename T, typename = void> struct is_indexed_or_index : std::false_type {};
 template <typename T>
-struct is_indexed_or_index<T, std::enable_if_t<is_indexed_v<T> || std::is_integral<T>::value>> : std::true_type {};
+inline std::enable_if_t<std::is_integral<T>::value, T> index_of(T i) noexcept { return i; }
 
-} // namespace detail
+template <typename Container>
+CoalescentModel::LogProbability CoalescentModel::evaluate(const Container& haplotypes, std::true_type) const
+{
+    assert(is_primed());
+    signature_buffer_.assign(num_signature_words_ + 1, 0);
+    unsigned num_haplotypes {0};
+    for (auto indexed : haplotypes) {
+        const auto signature = std::next(std::cbegin(haplotype_signatures_), index_of(indexed) * num_signature_words_);
+        std::transform(signature, std::next(signature, num_signature_words_), std::cbegin(signature_buffer_),
+                       std::begin(signature_buffer_), std::bit_or<> {});
+        ++num_haplotypes;
+    }
+    signature_buffer_.back() = num_haplotypes;
+    const auto itr = signature_result_cache_.find(signature_buffer_);
+    if (itr != std::cend(signature_result_cache_)) return itr->second;
+    const auto result = evaluate_signature_buffer(num_haplotypes);
+    signature_result_cache_.emplace(signature_buffer_, result);
+    return result;
+}
 
-template <typename Range>
-void CoalescentModel::fill_site_buffer(const Range& haplotypes) const
+template <typename Container>
+CoalescentModel::LogProbability CoalescentModel::evaluate(const Container& haplotypes, std::false_type) const
 {
-    fill_site_buffer(haplotypes, detail::is_indexed_or_index<typename Range::value_type> {});
+    return evaluate(count_segregating_sites(haplotypes));
 }
 
 template <typename Range>
-void CoalescentModel::fill_site_buffer(const Range& haplotypes, std::false_type) const
+void CoalescentModel::fill_site_buffer(const Range& haplotypes) const
 {
     assert(site_buffer2_.empty());
     site_buffer1_.clear();
@@ -173,42 +215,6 @@ void CoalescentModel::fill_site_buffer(const Range& haplotypes, std::false_type)
     }
 }
 
-template <typename T>
-inline std::enable_if_t<std::is_integral<T>::value, T> index_of(T i) noexcept { return i; }
-
-template <typename Range>
-void CoalescentModel::fill_site_buffer(const Range& haplotypes, std::true_type) const
-{
-    site_buffer1_.clear();
-    std::fill(std::begin(index_flag_buffer_), std::end(index_flag_buffer_), false);
-    unsigned num_unique_nonempty_indices {0};
-    auto middle = std::begin(site_buffer1_);
-    for (auto indexed : haplotypes) {
-        const auto index = index_of(indexed);
-        if (!index_flag_buffer_[index]) {
-            auto& variants = index_cache_[index];
-            if (!variants) {
-                variants = haplotypes_[index].difference(reference_);
-            }
-            if (!variants->empty()) {
-                middle = site_buffer1_.insert(std::cend(site_buffer1_), std::cbegin(*variants), std::cend(*variants));
-                ++num_unique_nonempty_indices;
-            }
-            index_flag_buffer_[index] = true;
-        }
-    }
-    if (num_unique_nonempty_indices == 2) {
-        assert(site_buffer2_.empty());
-        std::merge(std::begin(site_buffer1_), middle, middle, std::end(site_buffer1_), std::back_inserter(site_buffer2_));
-        site_buffer2_.erase(std::unique(std::begin(site_buffer2_), std::end(site_buffer2_)), std::end(site_buffer2_));
-        site_buffer1_ = std::move(site_buffer2_);
-        site_buffer2_.clear();
-    } else if (num_unique_nonempty_indices > 2) {
-        std::sort(std::begin(site_buffer1_), std::end(site_buffer1_));
-        site_buffer1_.erase(std::unique(std::begin(site_buffer1_), std::end(site_buffer1_)), std::end(site_buffer1_));
-    }
-}
-
 namespace detail {
 
 template <typename Container>
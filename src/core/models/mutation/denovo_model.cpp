@@ -9,6 +9,9 @@
 #include <numeric>
 #include <cmath>
 #include <cstdint>
+#include <limits>
+#include <future>
+#include <exception>
 #include <stdexcept>
 #include <cassert>
 
@@ -28,32 +31,19 @@ std::int8_t probability_to_penalty(const double probability) noexcept
 
 } // namespace
 
-DeNovoModel::DeNovoModel(Parameters parameters, std::size_t num_haplotypes_hint, CachingStrategy caching)
+DeNovoModel::DeNovoModel(Parameters parameters)
 : params_ {parameters}
 , snv_log_prior_ {std::log(params_.snv_prior)}
 , pad_penalty_ {60}
 , snv_penalty_ {probability_to_penalty(params_.snv_prior)}
 , indel_model_ {{params_.indel_prior}}
 , min_ln_probability_ {}
-, num_haplotypes_hint_ {num_haplotypes_hint}
-, caching_ {caching}
-, alignment_ {}
-, tmp_indel_model_ {}
-, local_indel_model_ {}
+, num_haplotypes_ {0}
+, index_cache_ {}
 , gap_model_index_cache_ {}
-, value_cache_ {}
-, address_cache_ {}
-, guarded_index_cache_ {}
-, unguarded_index_cache_ {}
-, padded_given_ {}
-, use_unguarded_ {false}
+, workspace_ {make_workspace()}
 {
-    if (caching_ == CachingStrategy::address) {
-        address_cache_.reserve(num_haplotypes_hint_ * num_haplotypes_hint_);
-    } else if (caching == CachingStrategy::value) {
-        value_cache_.reserve(num_haplotypes_hint_);
-    }
-    padded_given_.reserve(1000);
+    workspace_.padded_given.reserve(1000);
 }
 
 DeNovoModel::Parameters DeNovoModel::parameters() const
@@ -61,69 +51,51 @@ DeNovoModel::Parameters DeNovoModel::parameters() const
     return params_;
 }
 
-void DeNovoModel::prime(const MappableBlock<Haplotype>& haplotypes)
+void DeNovoModel::prime(const MappableBlock<Haplotype>& haplotypes, OptionalThreadPool workers)
 {
     if (is_primed()) throw std::runtime_error {"DeNovoModel: already primed"};
-    constexpr std::size_t max_unguardered {50};
-    gap_model_index_cache_.resize(haplotypes.size());
-    if (haplotypes.size() <= max_unguardered) {
-        unguarded_index_cache_.assign(haplotypes.size(), std::vector<LogProbability>(haplotypes.size(), 0));
-        const auto indexed_haplotypes = index(haplotypes);
-        for (std::size_t given_idx {0}; given_idx < haplotypes.size(); ++given_idx) {
-            for (std::size_t target_idx {0}; target_idx < haplotypes.size(); ++target_idx) {
-                if (target_idx != given_idx) {
-                    unguarded_index_cache_[target_idx][given_idx] = evaluate_uncached(indexed_haplotypes[target_idx], indexed_haplotypes[given_idx]);
-                }
-            }
-            gap_model_index_cache_[given_idx] = boost::none; // clear the cache to reclaim memory
-        }
-        use_unguarded_ = true;
+    constexpr std::size_t max_eager_size {50}, max_parallel_eager_size {500};
+    num_haplotypes_ = haplotypes.size();
+    index_cache_.assign(num_haplotypes_ * num_haplotypes_, std::numeric_limits<LogProbability>::quiet_NaN());
+    for (std::size_t idx {0}; idx < num_haplotypes_; ++idx) {
+        index_cache_[idx * num_haplotypes_ + idx] = 0;
+    }
+    const bool use_workers {workers && workers->size() > 1 && workers->n_idle() > 0};
+    if (num_haplotypes_ <= max_eager_size || (use_workers && num_haplotypes_ <= max_parallel_eager_size)) {
+        evaluate_all(haplotypes, use_workers ? workers : boost::none);
     } else {
-        guarded_index_cache_.assign(haplotypes.size(), std::vector<boost::optional<LogProbability>>(haplotypes.size()));
+        gap_model_index_cache_.resize(num_haplotypes_);
     }
 }
 
 void DeNovoModel::unprime() noexcept
 {
+    num_haplotypes_ = 0;
+    index_cache_.clear();
+    index_cache_.shrink_to_fit();
     gap_model_index_cache_.clear();
     gap_model_index_cache_.shrink_to_fit();
-    guarded_index_cache_.clear();
-    guarded_index_cache_.shrink_to_fit();
-    unguarded_index_cache_.clear();
-    unguarded_index_cache_.shrink_to_fit();
-    use_unguarded_ = false;
 }
 
 bool DeNovoModel::is_primed() const noexcept
 {
-    return !guarded_index_cache_.empty() || !unguarded_index_cache_.empty();
+    return !index_cache_.empty();
 }
 
 DeNovoModel::LogProbability DeNovoModel::evaluate(const Haplotype& target, const Haplotype& given) const
 {
-    switch (caching_) {
-        case CachingStrategy::address: return evaluate_address_cache(target, given);
-        case CachingStrategy::value: return evaluate_basic_cache(target, given);
-        case CachingStrategy::none: return evaluate_uncached(target, given);
-        default: return evaluate_uncached(target, given); // to prevent compiler warning
-    }
+    auto indel_model = generate_local_indel_model(given, workspace_);
+    return evaluate_uncached(target, given, indel_model, workspace_);
 }
 
 DeNovoModel::LogProbability DeNovoModel::evaluate(const IndexedHaplotype<>& target, const IndexedHaplotype<>& given) const
 {
-    if (use_unguarded_) {
-        return unguarded_index_cache_[index_of(target)][index_of(given)];
-    } else {
-        auto& result = guarded_index_cache_[index_of(target)][index_of(given)];
-        if (!result) {
-            if (target != given) {
-                result = evaluate_uncached(target, given);
-            } else {
-                result = 0;
-            }
-        }
-        return *result;
+    assert(index_of(target) < num_haplotypes_ && index_of(given) < num_haplotypes_);
+    auto& result = index_cache_[index_of(target) * num_haplotypes_ + index_of(given)];
+    if (std::isnan(result)) {
+        result = evaluate_uncached(target.haplotype(), given.haplotype(), get_local_indel_model(given), workspace_);
     }
+    return result;
 }
 
 // private methods
@@ -219,46 +191,53 @@ auto recalculate_log_probability(const CigarString& alignment,
 
 } // namespace
 
-DeNovoModel::LocalIndelModel DeNovoModel::generate_local_indel_model(const Haplotype& given) const
+DeNovoModel::Workspace DeNovoModel::make_workspace()
+{
+    return {{}, {}, HMM {32, HMM::ScoreType::int32}};
+}
+
+DeNovoModel::LocalIndelModel DeNovoModel::generate_local_indel_model(const Haplotype& given, const Workspace& workspace) const
 {
     LocalIndelModel result {};
     result.indel = indel_model_.evaluate(given);
     const auto num_bases = sequence_size(given);
+    const auto pad = workspace.hmm.band_size();
     assert(result.indel.gap_open.size() == num_bases);
-    result.open.resize(num_bases + 2 * hmm_.band_size(), pad_penalty_);
-    result.extend.resize(num_bases + 2 * hmm_.band_size(), pad_penalty_);
-    set_penalties(result.indel, hmm_.band_size(), result.open, result.extend);
+    result.open.resize(num_bases + 2 * pad, pad_penalty_);
+    result.extend.resize(num_bases + 2 * pad, pad_penalty_);
+    set_penalties(result.indel, pad, result.open, result.extend);
     return result;
 }
 
-void DeNovoModel::set_local_indel_model(const IndexedHaplotype<>& given) const
+DeNovoModel::LocalIndelModel& DeNovoModel::get_local_indel_model(const IndexedHaplotype<>& given) const
 {
     assert(index_of(given) < gap_model_index_cache_.size());
-    auto& cached_result = gap_model_index_cache_[index_of(given)];
-    if (!cached_result) {
-        cached_result = generate_local_indel_model(given.haplotype());
+    auto& result = gap_model_index_cache_[index_of(given)];
+    if (!result) {
+        result = generate_local_indel_model(given.haplotype(), workspace_);
     }
-    local_indel_model_ = std::addressof(*cached_result);
+    return *result;
 }
 
-DeNovoModel::HMM::ParameterType DeNovoModel::make_hmm_parameters() const noexcept
+DeNovoModel::HMM::ParameterType DeNovoModel::make_hmm_parameters(const LocalIndelModel& indel_model) const noexcept
 {
-    return {local_indel_model_->open, local_indel_model_->extend, {}, {}, snv_penalty_};
+    return {indel_model.open, indel_model.extend, {}, {}, snv_penalty_};
 }
 
-bool DeNovoModel::can_try_align_with_hmm(const Haplotype& target, const Haplotype& given) const noexcept
+bool DeNovoModel::can_try_align_with_hmm(const Haplotype& target, const Haplotype& given, const Workspace& workspace) const noexcept
 {
-    return sequence_length_distance(target, given) < static_cast<unsigned>(hmm_.band_size());
+    return sequence_length_distance(target, given) < static_cast<unsigned>(workspace.hmm.band_size());
 }
 
-void DeNovoModel::align_with_hmm(const Haplotype& target, const Haplotype& given) const
+void DeNovoModel::align_with_hmm(const Haplotype& target, const Haplotype& given,
+                                 LocalIndelModel& indel_model, Workspace& workspace) const
 {
-    pad_given(target, given, hmm_.band_size(), padded_given_);
-    local_indel_model_->open.resize(padded_given_.size(), pad_penalty_);
-    local_indel_model_->extend.resize(padded_given_.size(), pad_penalty_);
-    const auto hmm_params = make_hmm_parameters();
-    hmm_.set(hmm_params);
-    hmm_.align(target.sequence(), padded_given_, alignment_);
+    pad_given(target, given, workspace.hmm.band_size(), workspace.padded_given);
+    indel_model.open.resize(workspace.padded_given.size(), pad_penalty_);
+    indel_model.extend.resize(workspace.padded_given.size(), pad_penalty_);
+    const auto hmm_params = make_hmm_parameters(indel_model);
+    workspace.hmm.set(hmm_params);
+    workspace.hmm.align(target.sequence(), workspace.padded_given, workspace.alignment);
 }
 
 bool is_valid_alignment(const hmm::Alignment& alignment, std::size_t flank_pad) noexcept
@@ -267,74 +246,80 @@ bool is_valid_alignment(const hmm::Alignment& alignment, std::size_t flank_pad)
 }
 
 DeNovoModel::LogProbability
-DeNovoModel::evaluate_uncached(const Haplotype& target, const Haplotype& given, const bool gap_penalties_cached) const
+DeNovoModel::evaluate_uncached(const Haplotype& target, const Haplotype& given,
+                               LocalIndelModel& indel_model, Workspace& workspace) const
 {
-    if (!gap_penalties_cached) {
-        tmp_indel_model_ = generate_local_indel_model(given);
-        local_indel_model_ = std::addressof(tmp_indel_model_);
-    }
     LogProbability result;
-    if (can_try_align_with_hmm(target, given)) {
+    if (can_try_align_with_hmm(target, given, workspace)) {
         try {
-            align_with_hmm(target, given);
-            if (is_valid_alignment(alignment_, hmm_.band_size())) {
-                result = recalculate_log_probability(alignment_.cigar, snv_log_prior_, local_indel_model_->indel);
+            align_with_hmm(target, given, indel_model, workspace);
+            if (is_valid_alignment(workspace.alignment, workspace.hmm.band_size())) {
+                result = recalculate_log_probability(workspace.alignment.cigar, snv_log_prior_, indel_model.indel);
             } else {
-                result = calculate_approx_log_probability(target, given, snv_log_prior_, local_indel_model_->indel);
+                result = calculate_approx_log_probability(target, given, snv_log_prior_, indel_model.indel);
             }
         } catch (const hmm::HMMOverflow&) {
-            result = calculate_approx_log_probability(target, given, snv_log_prior_, local_indel_model_->indel);
+            result = calculate_approx_log_probability(target, given, snv_log_prior_, indel_model.indel);
         }
     } else {
-        result = calculate_approx_log_probability(target, given, snv_log_prior_, local_indel_model_->indel);
+        result = calculate_approx_log_probability(target, given, snv_log_prior_, indel_model.indel);
     }
     return min_ln_probability_ ? std::max(result, *min_ln_probability_) : result;
 }
 
-DeNovoModel::LogProbability
-DeNovoModel::evaluate_uncached(const IndexedHaplotype<>& target, const IndexedHaplotype<>& given) const
+void DeNovoModel::evaluate_given(const MappableBlock<Haplotype>& haplotypes, const std::size_t given_idx, Workspace& workspace) const
 {
-    set_local_indel_model(given);
-    return evaluate_uncached(target.haplotype(), given.haplotype(), true);
+    const auto& given = haplotypes[given_idx];
+    auto indel_model = generate_local_indel_model(given, workspace);
+    for (std::size_t target_idx {0}; target_idx < num_haplotypes_; ++target_idx) {
+        if (target_idx != given_idx) {
+            index_cache_[target_idx * num_haplotypes_ + given_idx] = evaluate_uncached(haplotypes[target_idx], given, indel_model, workspace);
+        }
+    }
 }
 
-DeNovoModel::LogProbability
-DeNovoModel::evaluate_basic_cache(const Haplotype& target, const Haplotype& given) const
+void DeNovoModel::evaluate_all(const MappableBlock<Haplotype>& haplotypes, OptionalThreadPool workers) const
 {
-    const auto target_iter = value_cache_.find(target);
-    if (target_iter != std::cend(value_cache_)) {
-        const auto given_iter = target_iter->second.find(given);
-        if (given_iter != std::cend(target_iter->second)) {
-            return given_iter->second;
+    if (!workers) {
+        for (std::size_t given_idx {0}; given_idx < num_haplotypes_; ++given_idx) {
+            evaluate_given(haplotypes, given_idx, workspace_);
         }
+        return;
     }
-    const auto result = evaluate_uncached(target, given);
-    if (target_iter != std::cend(value_cache_)) {
-        target_iter->second.emplace(given, result);
-    } else {
-        auto p = value_cache_.emplace(std::piecewise_construct,
-                                      std::forward_as_tuple(target),
-                                      std::forward_as_tuple(num_haplotypes_hint_));
-        assert(p.second);
-        p.first->second.emplace(given, result);
+    // Blocks are split by given haplotype so each gap model is only generated once. Every
+    // block writes to its own matrix entries with its own workspace, so no locking is needed.
+    const auto num_blocks = std::min(num_haplotypes_, workers->size() + 1);
+    const auto block_size = (num_haplotypes_ + num_blocks - 1) / num_blocks;
+    const auto evaluate_block = [&] (const std::size_t first_idx, const std::size_t last_idx, Workspace& workspace) {
+        for (auto given_idx = first_idx; given_idx < last_idx; ++given_idx) {
+            evaluate_given(haplotypes, given_idx, workspace);
+        }
+    };
+    std::vector<std::future<void>> futures {};
+    futures.reserve(num_blocks - 1);
+    std::size_t block_begin {0};
+    for (; block_begin + block_size < num_haplotypes_; block_begin += block_size) {
+        futures.push_back(workers->try_push([&, block_begin] () {
+            auto workspace = make_workspace();
+            evaluate_block(block_begin, block_begin + block_size, workspace);
+        }));
     }
-    return result;
-}
-
-DeNovoModel::LogProbability
-DeNovoModel::evaluate_address_cache(const Haplotype& target, const Haplotype& given) const
-{
-    const auto p = std::make_pair(std::addressof(target), std::addressof(given));
-    const auto itr = address_cache_.find(p);
-    if (itr == std::cend(address_cache_)) {
-        const auto result = evaluate_uncached(target, given);
-        address_cache_.emplace(std::piecewise_construct,
-                               std::forward_as_tuple(p),
-                               std::forward_as_tuple(result));
-        return result;
-    } else {
-        return itr->second;
+    // Every block must finish before returning, as the tasks reference this frame
+    std::exception_ptr error {};
+    try {
+        evaluate_block(block_begin, num_haplotypes_, workspace_);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    for (auto& future : futures) {
+        workers->wait(future);
+        try {
+            future.get();
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
     }
+    if (error) std::rethrow_exception(error);
 }
 
 } // namespace octopus
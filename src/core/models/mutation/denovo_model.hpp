@@ -5,16 +5,16 @@
 #define denovo_model_hpp
 
 #include <cstddef>
-#include <unordered_map>
+#include <vector>
 #include <string>
 #include <utility>
 
 #include <boost/optional.hpp>
-#include <boost/functional/hash.hpp>
 
 #include "core/types/haplotype.hpp"
 #include "core/types/indexed_haplotype.hpp"
 #include "containers/mappable_block.hpp"
+#include "utils/thread_pool.hpp"
 #include "../pairhmm/pair_hmm.hpp"
 #include "indel_mutation_model.hpp"
 
@@ -24,19 +24,16 @@ class DeNovoModel
 {
 public:
     using LogProbability = double;
+    using OptionalThreadPool = boost::optional<ThreadPool&>;
     
     struct Parameters
     {
         double snv_prior, indel_prior;
     };
     
-    enum class CachingStrategy { none, value, address };
-    
     DeNovoModel() = delete;
     
-    DeNovoModel(Parameters parameters,
-                std::size_t num_haplotypes_hint = 1000,
-                CachingStrategy caching = CachingStrategy::value);
+    DeNovoModel(Parameters parameters);
     
     DeNovoModel(const DeNovoModel&)            = default;
     DeNovoModel& operator=(const DeNovoModel&) = default;
@@ -47,25 +44,17 @@ public:
     
     Parameters parameters() const;
     
-    void prime(const MappableBlock<Haplotype>& haplotypes);
+    // Small haplotype sets are evaluated eagerly (in parallel if workers are given),
+    // larger ones are evaluated lazily on demand
+    void prime(const MappableBlock<Haplotype>& haplotypes, OptionalThreadPool workers = boost::none);
     void unprime() noexcept;
     bool is_primed() const noexcept;
     
     // ln p(target | given)
-    LogProbability evaluate(const Haplotype& target, const Haplotype& given) const;
-    LogProbability evaluate(const IndexedHaplotype<>& target, const IndexedHaplotype<>& given) const;
+    LogProbability evaluate(const Haplotype& target, const Haplotype& given) const; // not cached
+    LogProbability evaluate(const IndexedHaplotype<>& target, const IndexedHaplotype<>& given) const; // must be primed
     
 private:
-    struct AddressPairHash
-    {
-        std::size_t operator()(const std::pair<const Haplotype*, const Haplotype*>& p) const noexcept
-        {
-            auto result = boost::hash_value(p.first);
-            boost::hash_combine(result, p.second);
-            return result;
-        }
-    };
-    
     using PenaltyVector = hmm::PenaltyVector;
     struct LocalIndelModel
     {
@@ -73,37 +62,38 @@ private:
         PenaltyVector open, extend;
     };
     
-    using HMM = hmm::PairHMM<hmm::VariableGapExtendMutationModel, 32, int>;
+    using HMM = hmm::PairHMM<hmm::VariableGapExtendMutationModel>;
+    
+    struct Workspace
+    {
+        hmm::Alignment alignment;
+        std::string padded_given;
+        HMM hmm;
+    };
     
     Parameters params_;
     LogProbability snv_log_prior_;
     std::int8_t pad_penalty_, snv_penalty_;
     IndelMutationModel indel_model_;
     boost::optional<LogProbability> min_ln_probability_;
-    std::size_t num_haplotypes_hint_;
-    CachingStrategy caching_;
     
-    mutable hmm::Alignment alignment_;
-    mutable LocalIndelModel tmp_indel_model_;
-    mutable LocalIndelModel* local_indel_model_;
+    std::size_t num_haplotypes_;
+    // Dense [target][given] matrix; NaN marks entries not yet evaluated
+    mutable std::vector<LogProbability> index_cache_;
     mutable std::vector<boost::optional<LocalIndelModel>> gap_model_index_cache_;
-    mutable std::unordered_map<Haplotype, std::unordered_map<Haplotype, LogProbability>> value_cache_;
-    mutable std::unordered_map<std::pair<const Haplotype*, const Haplotype*>, LogProbability, AddressPairHash> address_cache_;
-    mutable std::vector<std::vector<boost::optional<double>>> guarded_index_cache_;
-    mutable std::vector<std::vector<LogProbability>> unguarded_index_cache_;
-    mutable std::string padded_given_;
-    mutable bool use_unguarded_;
-    mutable HMM hmm_;
+    mutable Workspace workspace_;
     
-    LocalIndelModel generate_local_indel_model(const Haplotype& given) const;
-    void set_local_indel_model(const IndexedHaplotype<>& given) const;
-    HMM::ParameterType make_hmm_parameters() const noexcept;
-    bool can_try_align_with_hmm(const Haplotype& target, const Haplotype& given) const noexcept;
-    void align_with_hmm(const Haplotype& target, const Haplotype& given) const;
-    LogProbability evaluate_uncached(const Haplotype& target, const Haplotype& given, bool gap_penalties_cached = false) const;
-    LogProbability evaluate_uncached(const IndexedHaplotype<>& target, const IndexedHaplotype<>& given) const;
-    LogProbability evaluate_basic_cache(const Haplotype& target, const Haplotype& given) const;
-    LogProbability evaluate_address_cache(const Haplotype& target, const Haplotype& given) const;
+    static Workspace make_workspace();
+    LocalIndelModel generate_local_indel_model(const Haplotype& given, const Workspace& workspace) const;
+    LocalIndelModel& get_local_indel_model(const IndexedHaplotype<>& given) const;
+    HMM::ParameterType make_hmm_parameters(const LocalIndelModel& indel_model) const noexcept;
+    bool can_try_align_with_hmm(const Haplotype& target, const Haplotype& given, const Workspace& workspace) const noexcept;
+    void align_with_hmm(const Haplotype& target, const Haplotype& given,
+                        LocalIndelModel& indel_model, Workspace& workspace) const;
+    LogProbability evaluate_uncached(const Haplotype& target, const Haplotype& given,
+                                     LocalIndelModel& indel_model, Workspace& workspace) const;
+    void evaluate_given(const MappableBlock<Haplotype>& haplotypes, std::size_t given_idx, Workspace& workspace) const;
+    void evaluate_all(const MappableBlock<Haplotype>& haplotypes, OptionalThreadPool workers) const;
 };
 
 } // namespace octopus
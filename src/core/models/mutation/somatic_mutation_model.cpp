@@ -12,9 +12,8 @@
 
 namespace octopus {
 
-SomaticMutationModel::SomaticMutationModel(Parameters params, std::size_t num_haplotypes_hint,
-                                           CachingStrategy caching)
-: model_ {params, num_haplotypes_hint, caching}
+SomaticMutationModel::SomaticMutationModel(Parameters params)
+: model_ {params}
 {}
 
 void SomaticMutationModel::prime(MappableBlock<Haplotype> haplotypes)
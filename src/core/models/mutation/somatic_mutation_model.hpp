@@ -19,13 +19,10 @@ class SomaticMutationModel
 public:
     using LogProbability  = DeNovoModel::LogProbability;
     using Parameters      = DeNovoModel::Parameters;
-    using CachingStrategy = DeNovoModel::CachingStrategy;
     
     SomaticMutationModel() = delete;
     
-    SomaticMutationModel(Parameters params,
-                         std::size_t num_haplotypes_hint = 1000,
-                         CachingStrategy caching = CachingStrategy::value);
+    SomaticMutationModel(Parameters params);
     
     SomaticMutationModel(const SomaticMutationModel&)            = default;
     SomaticMutationModel& operator=(const SomaticMutationModel&) = default;
@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+// Compiled with the AVX2 flags whatever the target architecture is
+
+#include "simd_pair_hmm_kernels.hpp"
+
+#include "avx2_pair_hmm_impl.hpp"
+#include "simd_pair_hmm.hpp"
+#include "batched_pair_hmm.hpp"
+#include "rolling_initializer.hpp"
+#include "simd_pair_hmm_kernel_builder.hpp"
+
+namespace octopus { namespace hmm { namespace simd {
+
+#if defined(AVX2_PHMM)
+
+namespace {
+
+template <unsigned BandSize, typename ScoreType>
+using AVX2Kernel = PairHMM<AVX2PairHMMInstructionSet<BandSize, ScoreType>, InsertRollingInitializer>;
+
+template <unsigned BandSize> using ShortHMM = AVX2Kernel<BandSize, short>;
+template <unsigned BandSize> using IntHMM   = AVX2Kernel<BandSize, int>;
+
+template <unsigned BandSize, typename ScoreType>
+using IsViable = std::integral_constant<bool, BandSize % (32 / sizeof(ScoreType)) == 0>;
+
+template <unsigned BandSize> using IsViableShort = IsViable<BandSize, short>;
+template <unsigned BandSize> using IsViableInt   = IsViable<BandSize, int>;
+
+PairHMMKernelSet make_avx2_kernels(const PairHMMKernelSet& sse2) noexcept
+{
+    return {InstructionSet::avx2,
+            detail::make_kernels<ShortHMM, IsViableShort>(sse2.int16),
+            detail::make_kernels<IntHMM, IsViableInt>(sse2.int32),
+            detail::make_batched_kernel<BatchedPairHMM<AVX2PairHMMInstructionSet<32 / sizeof(short), short>>>(),
+            detail::make_batched_kernel<BatchedPairHMM<AVX2PairHMMInstructionSet<32 / sizeof(int), int>>>()};
+}
+
+} // namespace
+
+const PairHMMKernelSet* avx2_kernels() noexcept
+{
+    const auto sse2 = sse2_kernels();
+    if (!sse2) return nullptr;
+    static const PairHMMKernelSet result {make_avx2_kernels(*sse2)};
+    return &result;
+}
+
+#else
+
+const PairHMMKernelSet* avx2_kernels() noexcept
+{
+    return nullptr;
+}
+
+#endif
+
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
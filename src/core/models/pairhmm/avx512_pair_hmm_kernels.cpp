@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+// Compiled with the AVX-512 (F and BW) flags whatever the target architecture is
+
+#include "simd_pair_hmm_kernels.hpp"
+
+#include "avx512_pair_hmm_impl.hpp"
+#include "simd_pair_hmm.hpp"
+#include "batched_pair_hmm.hpp"
+#include "rolling_initializer.hpp"
+#include "simd_pair_hmm_kernel_builder.hpp"
+
+namespace octopus { namespace hmm { namespace simd {
+
+#if defined(AVX512_PHMM)
+
+namespace {
+
+template <unsigned BandSize, typename ScoreType>
+using AVX512Kernel = PairHMM<AVX512PairHMMInstructionSet<BandSize, ScoreType>, InsertRollingInitializer>;
+
+template <unsigned BandSize> using ShortHMM = AVX512Kernel<BandSize, short>;
+template <unsigned BandSize> using IntHMM   = AVX512Kernel<BandSize, int>;
+
+template <unsigned BandSize, typename ScoreType>
+using IsViable = std::integral_constant<bool, BandSize % (64 / sizeof(ScoreType)) == 0>;
+
+template <unsigned BandSize> using IsViableShort = IsViable<BandSize, short>;
+template <unsigned BandSize> using IsViableInt   = IsViable<BandSize, int>;
+
+PairHMMKernelSet make_avx512_kernels(const PairHMMKernelSet& avx2) noexcept
+{
+    return {InstructionSet::avx512,
+            detail::make_kernels<ShortHMM, IsViableShort>(avx2.int16),
+            detail::make_kernels<IntHMM, IsViableInt>(avx2.int32),
+            detail::make_batched_kernel<BatchedPairHMM<AVX512PairHMMInstructionSet<64 / sizeof(short), short>>>(),
+            detail::make_batched_kernel<BatchedPairHMM<AVX512PairHMMInstructionSet<64 / sizeof(int), int>>>()};
+}
+
+} // namespace
+
+const PairHMMKernelSet* avx512_kernels() noexcept
+{
+    const auto avx2 = avx2_kernels();
+    if (!avx2) return nullptr;
+    static const PairHMMKernelSet result {make_avx512_kernels(*avx2)};
+    return &result;
+}
+
+#else
+
+const PairHMMKernelSet* avx512_kernels() noexcept
+{
+    return nullptr;
+}
+
+#endif
+
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
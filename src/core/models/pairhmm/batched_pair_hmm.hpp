@@ -0,0 +1,297 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef batched_pair_hmm_hpp
+#define batched_pair_hmm_hpp
+
+#if __GNUC__ >= 6
+    #pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <limits>
+#include <vector>
+#include <type_traits>
+#include <cassert>
+
+#include <boost/align/aligned_allocator.hpp>
+
+#include "simd_pair_hmm_kernels.hpp"
+#include "sse2_pair_hmm_impl.hpp"
+#include "avx2_pair_hmm_impl.hpp"
+#include "avx512_pair_hmm_impl.hpp"
+#include "neon_pair_hmm_impl.hpp"
+
+namespace octopus { namespace hmm { namespace simd {
+
+/*
+ BatchedPairHMM computes the same banded alignment scores as PairHMM, but vectorises across alignments
+ rather than along the band: each SIMD lane holds a separate alignment (e.g. a different read, or a
+ different mapping position of the same read) against a truth window of the same size. This uses the
+ full vector width however small the band is, which PairHMM can't do for short bands on wide registers.
+
+ The recurrences are exactly those of PairHMM::align_helper (including the rolling initialisation and
+ the score increments), with the band held as an array of vectors, so scores are identical. All
+ alignments in a batch must have the same target length, and only scores (not tracebacks) are computed.
+ The per-position inputs of each lane are transposed into lane-interleaved vectors before the alignment.
+ */
+template <typename InstructionSet>
+class BatchedPairHMM : private InstructionSet
+{
+public:
+    using ScoreType = typename InstructionSet::ScoreType;
+
+    using Lane = BatchLane;
+
+    constexpr static const char* name() noexcept { return InstructionSet::name; }
+    constexpr static int batch_size() noexcept { return InstructionSet::band_size; }
+    
+    static_assert(batch_size() <= maxBatchSize, "");
+
+    // Computes the scores of num_lanes <= batch_size() alignments. All truths have length
+    // truth_len = target_len + 2 * band_size - 1, as for PairHMM.
+    void
+    align(const Lane* lanes,
+          const int num_lanes,
+          const int truth_len,
+          const int target_len,
+          const int band_size,
+          const short nuc_prior,
+          int* scores) const
+    {
+        assert(num_lanes > 0 && num_lanes <= batch_size());
+        assert(target_len > 0 && truth_len > band_size && (truth_len == target_len + 2 * band_size - 1));
+        thread_local Workspace workspace {};
+        workspace.reset(truth_len, target_len, band_size);
+        transpose(lanes, num_lanes, truth_len, target_len, band_size, workspace);
+        const auto minscores = align_helper(target_len, band_size, nuc_prior, workspace);
+        std::array<ScoreType, batch_size()> lane_minscores;
+        std::memcpy(lane_minscores.data(), &minscores, sizeof(minscores));
+        for (int lane {0}; lane < num_lanes; ++lane) {
+            const ScoreType minscore {lane_minscores[lane]};
+            scores[lane] = (minscore - null_score_) >> trace_bits_;
+        }
+    }
+
+private:
+    using VectorType  = typename InstructionSet::VectorType;
+    using SmallVector = std::vector<VectorType, boost::alignment::aligned_allocator<VectorType>>;
+
+    using InstructionSet::vectorise;
+    using InstructionSet::_add;
+    using InstructionSet::_and;
+    using InstructionSet::_andnot;
+    using InstructionSet::_or;
+    using InstructionSet::_cmpeq;
+    using InstructionSet::_min;
+
+    // These must match PairHMM
+    constexpr static ScoreType infinity_tolerance_ {0x7FF};
+    constexpr static ScoreType infinity_ {std::numeric_limits<ScoreType>::max() - infinity_tolerance_};
+    constexpr static int trace_bits_ {2};
+    constexpr static ScoreType n_score_ {2 << trace_bits_};
+    constexpr static ScoreType max_quality_score_ {64};
+    // PairHMM shifts infinity_ into a ScoreType for the SNV prior past the end of the truth, which wraps
+    constexpr static ScoreType shifted_infinity_ {static_cast<ScoreType>(static_cast<std::make_unsigned_t<ScoreType>>(infinity_) << trace_bits_)};
+    constexpr static ScoreType null_score_ {std::numeric_limits<ScoreType>::min()};
+
+    struct Workspace
+    {
+        // indexed by truth position, up to and including truth_len
+        SmallVector truth, truth_n_score, snv_mask, snv_prior, gap_open, gap_extend;
+        // indexed by target position + band_size, padded either side
+        SmallVector target, qualities;
+        // the band, one vector per diagonal offset
+        SmallVector m1, i1, d1, m2, i2, d2;
+
+        void reset(const int truth_len, const int target_len, const int band_size)
+        {
+            for (auto* v : {&truth, &truth_n_score, &snv_mask, &snv_prior, &gap_open, &gap_extend}) {
+                v->resize(truth_len + 1);
+            }
+            for (auto* v : {&target, &qualities}) {
+                v->resize(target_len + 2 * band_size);
+            }
+            for (auto* v : {&m1, &i1, &d1, &m2, &i2, &d2}) {
+                v->assign(band_size, vectorise(infinity_));
+            }
+        }
+    };
+
+    // Element lane of vector index in values, which are written one lane at a time
+    static ScoreType* lane_data(SmallVector& values, const int lane) noexcept
+    {
+        return reinterpret_cast<ScoreType*>(values.data()) + lane;
+    }
+
+    static void
+    transpose(const Lane* lanes,
+              const int num_lanes,
+              const int truth_len,
+              const int target_len,
+              const int band_size,
+              Workspace& workspace) noexcept
+    {
+        constexpr int stride {batch_size()};
+        // Positions are done in blocks so the interleaved writes for every lane stay in cache
+        constexpr int block_size {32};
+        for (int block_begin {0}; block_begin < truth_len; block_begin += block_size) {
+            const auto block_end = std::min(block_begin + block_size, truth_len);
+            for (int lane_idx {0}; lane_idx < batch_size(); ++lane_idx) {
+                const auto& lane = lanes[lane_idx < num_lanes ? lane_idx : 0]; // unused lanes repeat the first alignment
+                auto truth      = lane_data(workspace.truth, lane_idx);
+                auto snv_mask   = lane_data(workspace.snv_mask, lane_idx);
+                auto snv_prior  = lane_data(workspace.snv_prior, lane_idx);
+                auto gap_open   = lane_data(workspace.gap_open, lane_idx);
+                auto gap_extend = lane_data(workspace.gap_extend, lane_idx);
+                for (int pos {block_begin}; pos < block_end; ++pos) {
+                    truth[pos * stride]      = lane.truth[pos];
+                    snv_mask[pos * stride]   = lane.snv_mask[pos];
+                    snv_prior[pos * stride]  = lane.snv_prior[pos] << trace_bits_;
+                    gap_open[pos * stride]   = lane.gap_open[pos] << trace_bits_;
+                    gap_extend[pos * stride] = lane.gap_extend[pos] << trace_bits_;
+                }
+                if (block_end == truth_len) {
+                    // As PairHMM, positions past the end of the truth are N with the last gap penalties
+                    truth[truth_len * stride]      = 'N';
+                    snv_mask[truth_len * stride]   = 'N';
+                    snv_prior[truth_len * stride]  = shifted_infinity_;
+                    gap_open[truth_len * stride]   = lane.gap_open[truth_len - 1] << trace_bits_;
+                    gap_extend[truth_len * stride] = lane.gap_extend[truth_len - 1] << trace_bits_;
+                }
+            }
+        }
+        for (int block_begin {0}; block_begin < target_len; block_begin += block_size) {
+            const auto block_end = std::min(block_begin + block_size, target_len);
+            for (int lane_idx {0}; lane_idx < batch_size(); ++lane_idx) {
+                const auto& lane = lanes[lane_idx < num_lanes ? lane_idx : 0];
+                auto target    = lane_data(workspace.target, lane_idx) + band_size * stride;
+                auto qualities = lane_data(workspace.qualities, lane_idx) + band_size * stride;
+                for (int pos {block_begin}; pos < block_end; ++pos) {
+                    target[pos * stride]    = lane.target[pos];
+                    qualities[pos * stride] = lane.qualities[pos] << trace_bits_;
+                }
+            }
+        }
+        const auto n = vectorise('N'), inf = vectorise(infinity_);
+        const auto n_score_offset = vectorise(n_score_ - infinity_);
+        for (int pos {0}; pos <= truth_len; ++pos) {
+            workspace.truth_n_score[pos] = _add(_and(_cmpeq(workspace.truth[pos], n), n_score_offset), inf);
+        }
+        const auto max_quality = vectorise(max_quality_score_ << trace_bits_);
+        std::fill_n(std::begin(workspace.target), band_size, inf);
+        std::fill_n(std::begin(workspace.qualities), band_size, max_quality);
+        std::fill(std::next(std::begin(workspace.target), band_size + target_len), std::end(workspace.target), vectorise('0'));
+        std::fill(std::next(std::begin(workspace.qualities), band_size + target_len), std::end(workspace.qualities), max_quality);
+    }
+
+    VectorType
+    match_score(const VectorType& target,
+                const VectorType& truth,
+                const VectorType& qualities,
+                const VectorType& truth_n_score,
+                const VectorType& snv_mask,
+                const VectorType& snv_prior) const noexcept
+    {
+        const auto is_snv = _cmpeq(target, snv_mask);
+        return _min(_andnot(_cmpeq(target, truth), _min(qualities, _or(_and(is_snv, snv_prior), _andnot(is_snv, qualities)))), truth_n_score);
+    }
+
+    VectorType
+    align_helper(const int target_len,
+                 const int band_size,
+                 const short nuc_prior,
+                 Workspace& workspace) const noexcept
+    {
+        const auto inf = vectorise(infinity_);
+        const auto null = vectorise(null_score_);
+        const auto nuc_prior_score = vectorise(static_cast<std::int8_t>(nuc_prior) << trace_bits_);
+        auto& m1 = workspace.m1; auto& i1 = workspace.i1; auto& d1 = workspace.d1;
+        auto& m2 = workspace.m2; auto& i2 = workspace.i2; auto& d2 = workspace.d2;
+        const auto* truth         = workspace.truth.data();
+        const auto* truth_n_score = workspace.truth_n_score.data();
+        const auto* snv_mask      = workspace.snv_mask.data();
+        const auto* snv_prior     = workspace.snv_prior.data();
+        const auto* gap_open      = workspace.gap_open.data();
+        const auto* gap_extend    = workspace.gap_extend.data();
+        const auto* target        = workspace.target.data() + band_size;
+        const auto* qualities     = workspace.qualities.data() + band_size;
+        auto minscore = inf;
+        // Band offset k of diagonal pair j aligns target position j - k against truth position j + k
+        // (even diagonal) or j + k + 1 (odd diagonal) of the window.
+        for (int j = 0; j < target_len + band_size; ++j) {
+            // even diagonal
+            if (j < band_size) {
+                m1[j] = null;
+                m2[j] = null;
+            }
+            for (int k = 0; k < band_size; ++k) {
+                m1[k] = _min(m1[k], _min(i1[k], d1[k]));
+            }
+            if (j >= target_len) minscore = _min(minscore, m1[j - target_len]);
+            for (int k = 0; k < band_size; ++k) {
+                m1[k] = _add(m1[k], match_score(target[j - k], truth[j + k], qualities[j - k], truth_n_score[j + k],
+                                                snv_mask[j + k], snv_prior[j + k]));
+            }
+            for (int k = band_size - 1; k > 0; --k) {
+                d1[k] = _min(_add(d2[k - 1], gap_extend[j + k]), _add(_min(m2[k - 1], i2[k - 1]), gap_open[j + k]));
+            }
+            d1[0] = inf;
+            for (int k = 0; k < band_size; ++k) {
+                i1[k] = _add(_min(_add(i2[k], gap_extend[j + k]), _add(m2[k], gap_open[j + k])), nuc_prior_score);
+            }
+            // odd diagonal
+            for (int k = 0; k < band_size; ++k) {
+                m2[k] = _min(m2[k], _min(i2[k], d2[k]));
+            }
+            if (j >= target_len) minscore = _min(minscore, m2[j - target_len]);
+            for (int k = 0; k < band_size; ++k) {
+                const auto pos = j + k + 1;
+                m2[k] = _add(m2[k], match_score(target[j - k], truth[pos], qualities[j - k], truth_n_score[pos],
+                                                snv_mask[pos], snv_prior[pos]));
+                d2[k] = _min(_add(d1[k], gap_extend[pos]), _add(_min(m1[k], i1[k]), gap_open[pos]));
+            }
+            for (int k = 0; k < band_size - 1; ++k) {
+                const auto pos = j + k + 1;
+                i2[k] = _add(_min(_add(i1[k + 1], gap_extend[pos]), _add(m1[k + 1], gap_open[pos])), nuc_prior_score);
+            }
+            i2[band_size - 1] = inf;
+        }
+        return minscore;
+    }
+};
+
+// The widest available instruction set for ScoreType
+
+#if defined(AVX512_PHMM)
+
+template <typename ScoreType = short>
+using BatchedSimdPairHMM = BatchedPairHMM<AVX512PairHMMInstructionSet<64 / sizeof(ScoreType), ScoreType>>;
+
+#elif defined(AVX2_PHMM)
+
+template <typename ScoreType = short>
+using BatchedSimdPairHMM = BatchedPairHMM<AVX2PairHMMInstructionSet<32 / sizeof(ScoreType), ScoreType>>;
+
+#elif defined(SSE2_PHMM)
+
+template <typename ScoreType = short>
+using BatchedSimdPairHMM = BatchedPairHMM<SSE2PairHMMInstructionSet<16 / sizeof(ScoreType), ScoreType>>;
+
+#elif defined(NEON_PHMM)
+
+template <typename ScoreType = short>
+using BatchedSimdPairHMM = BatchedPairHMM<NEONPairHMMInstructionSet<16 / sizeof(ScoreType), ScoreType>>;
+
+#endif
+
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
+
+#endif
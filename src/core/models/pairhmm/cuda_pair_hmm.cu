@@ -0,0 +1,285 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+// Only compiled with the CUDA_PAIR_HMM build option
+
+#include "gpu_pair_hmm.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include <cuda_runtime.h>
+
+namespace octopus { namespace hmm { namespace gpu { namespace detail {
+
+/*
+ Each thread block computes one alignment, with a thread per band offset, using the recurrences of
+ BatchedPairHMM::align_helper (which are those of PairHMM), so scores are identical to the CPU kernels.
+ Thread k owns offset k of each band vector (in shared memory) and only reads its neighbours' offsets
+ after a barrier. The inputs of each alignment are packed contiguously: truth, SNV mask, SNV prior, gap
+ open and gap extend (truth_len each), then target and qualities (target_len each).
+ */
+
+namespace {
+
+template <typename ScoreType>
+struct Constants
+{
+    // These must match PairHMM
+    static constexpr ScoreType infinity_tolerance {0x7FF};
+    static constexpr ScoreType infinity {std::numeric_limits<ScoreType>::max() - infinity_tolerance};
+    static constexpr int trace_bits {2};
+    static constexpr ScoreType n_score {2 << trace_bits};
+    static constexpr ScoreType max_quality_score {64};
+    static constexpr ScoreType shifted_infinity {static_cast<ScoreType>(static_cast<std::make_unsigned_t<ScoreType>>(infinity) << trace_bits)};
+    static constexpr ScoreType null_score {std::numeric_limits<ScoreType>::min()};
+};
+
+// The SIMD kernels add with wraparound
+template <typename ScoreType>
+__device__ ScoreType add(const ScoreType lhs, const ScoreType rhs) noexcept
+{
+    using UnsignedScoreType = std::make_unsigned_t<ScoreType>;
+    return static_cast<ScoreType>(static_cast<UnsignedScoreType>(lhs) + static_cast<UnsignedScoreType>(rhs));
+}
+
+template <typename ScoreType>
+__device__ ScoreType min(const ScoreType lhs, const ScoreType rhs) noexcept
+{
+    return rhs < lhs ? rhs : lhs;
+}
+
+template <typename ScoreType>
+struct PackedAlignment
+{
+    using C = Constants<ScoreType>;
+
+    const char* truth;
+    const char* snv_mask;
+    const std::int8_t* snv_prior;
+    const std::int8_t* gap_open;
+    const std::int8_t* gap_extend;
+    const char* target;
+    const std::int8_t* qualities;
+    int truth_len, target_len;
+
+    // As BatchedPairHMM::transpose, positions past the end of the truth are N with the last gap penalties,
+    // and the target is padded with infinity before and '0' after
+    __device__ ScoreType truth_at(const int pos) const noexcept { return pos < truth_len ? truth[pos] : 'N'; }
+    __device__ ScoreType truth_n_score_at(const int pos) const noexcept { return truth_at(pos) == 'N' ? C::n_score : C::infinity; }
+    __device__ ScoreType snv_mask_at(const int pos) const noexcept { return pos < truth_len ? snv_mask[pos] : 'N'; }
+    __device__ ScoreType snv_prior_at(const int pos) const noexcept
+    {
+        return pos < truth_len ? static_cast<ScoreType>(snv_prior[pos] << C::trace_bits) : C::shifted_infinity;
+    }
+    __device__ ScoreType gap_open_at(const int pos) const noexcept
+    {
+        return static_cast<ScoreType>(gap_open[pos < truth_len ? pos : truth_len - 1] << C::trace_bits);
+    }
+    __device__ ScoreType gap_extend_at(const int pos) const noexcept
+    {
+        return static_cast<ScoreType>(gap_extend[pos < truth_len ? pos : truth_len - 1] << C::trace_bits);
+    }
+    __device__ ScoreType target_at(const int pos) const noexcept
+    {
+        return pos < 0 ? C::infinity : (pos < target_len ? static_cast<ScoreType>(target[pos]) : static_cast<ScoreType>('0'));
+    }
+    __device__ ScoreType quality_at(const int pos) const noexcept
+    {
+        return pos >= 0 && pos < target_len ? static_cast<ScoreType>(qualities[pos] << C::trace_bits)
+                                            : static_cast<ScoreType>(C::max_quality_score << C::trace_bits);
+    }
+
+    __device__ ScoreType match_score(const int target_pos, const int truth_pos) const noexcept
+    {
+        const auto target_base = target_at(target_pos);
+        if (target_base == truth_at(truth_pos)) return min<ScoreType>(0, truth_n_score_at(truth_pos));
+        const auto quality = quality_at(target_pos);
+        const auto mismatch = target_base == snv_mask_at(truth_pos) ? min(quality, snv_prior_at(truth_pos)) : quality;
+        return min(mismatch, truth_n_score_at(truth_pos));
+    }
+};
+
+template <typename ScoreType>
+__global__ void
+align_kernel(const std::int8_t* inputs, const int truth_len, const int target_len, const short nuc_prior, int* scores)
+{
+    using C = Constants<ScoreType>;
+    extern __shared__ int shared_memory[];
+    const int band_size = blockDim.x;
+    const int k = threadIdx.x;
+    auto m1 = reinterpret_cast<ScoreType*>(shared_memory);
+    auto i1 = m1 + band_size, d1 = i1 + band_size;
+    auto m2 = d1 + band_size, i2 = m2 + band_size, d2 = i2 + band_size;
+
+    const auto lane_size = static_cast<std::size_t>(5 * truth_len + 2 * target_len);
+    const auto lane = inputs + blockIdx.x * lane_size;
+    PackedAlignment<ScoreType> alignment {};
+    alignment.truth      = reinterpret_cast<const char*>(lane);
+    alignment.snv_mask   = reinterpret_cast<const char*>(lane + truth_len);
+    alignment.snv_prior  = lane + 2 * truth_len;
+    alignment.gap_open   = lane + 3 * truth_len;
+    alignment.gap_extend = lane + 4 * truth_len;
+    alignment.target     = reinterpret_cast<const char*>(lane + 5 * truth_len);
+    alignment.qualities  = lane + 5 * truth_len + target_len;
+    alignment.truth_len  = truth_len;
+    alignment.target_len = target_len;
+
+    const auto nuc_prior_score = static_cast<ScoreType>(static_cast<std::int8_t>(nuc_prior) << C::trace_bits);
+    m1[k] = i1[k] = d1[k] = m2[k] = i2[k] = d2[k] = C::infinity;
+    auto minscore = C::infinity;
+    __syncthreads();
+    for (int j = 0; j < target_len + band_size; ++j) {
+        // even diagonal
+        if (j < band_size) {
+            if (k == j) m1[k] = m2[k] = C::null_score;
+            __syncthreads();
+        }
+        m1[k] = min(m1[k], min(i1[k], d1[k]));
+        if (k == j - target_len) minscore = min(minscore, m1[k]);
+        m1[k] = add(m1[k], alignment.match_score(j - k, j + k));
+        d1[k] = k > 0 ? min(add(d2[k - 1], alignment.gap_extend_at(j + k)), add(min(m2[k - 1], i2[k - 1]), alignment.gap_open_at(j + k)))
+                      : C::infinity;
+        i1[k] = add(min(add(i2[k], alignment.gap_extend_at(j + k)), add(m2[k], alignment.gap_open_at(j + k))), nuc_prior_score);
+        __syncthreads();
+        // odd diagonal
+        const auto pos = j + k + 1;
+        m2[k] = min(m2[k], min(i2[k], d2[k]));
+        if (k == j - target_len) minscore = min(minscore, m2[k]);
+        m2[k] = add(m2[k], alignment.match_score(j - k, pos));
+        d2[k] = min(add(d1[k], alignment.gap_extend_at(pos)), add(min(m1[k], i1[k]), alignment.gap_open_at(pos)));
+        i2[k] = k < band_size - 1 ? add(min(add(i1[k + 1], alignment.gap_extend_at(pos)), add(m1[k + 1], alignment.gap_open_at(pos))), nuc_prior_score)
+                                  : C::infinity;
+        __syncthreads();
+    }
+    m1[k] = minscore;
+    __syncthreads();
+    if (k == 0) {
+        for (int offset {1}; offset < band_size; ++offset) {
+            minscore = min(minscore, m1[offset]);
+        }
+        scores[blockIdx.x] = static_cast<int>((static_cast<long long>(minscore) - C::null_score) >> C::trace_bits);
+    }
+}
+
+// Device and pinned host buffers for one calling thread, which are grown as needed
+class Workspace
+{
+public:
+    Workspace() = default;
+    Workspace(const Workspace&) = delete;
+    Workspace& operator=(const Workspace&) = delete;
+    ~Workspace()
+    {
+        if (host_inputs_) cudaFreeHost(host_inputs_);
+        if (device_inputs_) cudaFree(device_inputs_);
+        if (device_scores_) cudaFree(device_scores_);
+        if (stream_) cudaStreamDestroy(stream_);
+    }
+
+    bool reserve(const std::size_t input_bytes, const std::size_t num_scores) noexcept
+    {
+        if (!stream_ && cudaStreamCreateWithFlags(&stream_, cudaStreamNonBlocking) != cudaSuccess) {
+            stream_ = nullptr;
+            return false;
+        }
+        if (input_bytes > input_capacity_) {
+            if (host_inputs_) cudaFreeHost(host_inputs_);
+            if (device_inputs_) cudaFree(device_inputs_);
+            host_inputs_ = nullptr; device_inputs_ = nullptr; input_capacity_ = 0;
+            if (cudaMallocHost(reinterpret_cast<void**>(&host_inputs_), input_bytes) != cudaSuccess
+                || cudaMalloc(reinterpret_cast<void**>(&device_inputs_), input_bytes) != cudaSuccess) {
+                return false;
+            }
+            input_capacity_ = input_bytes;
+        }
+        if (num_scores > score_capacity_) {
+            if (device_scores_) cudaFree(device_scores_);
+            device_scores_ = nullptr; score_capacity_ = 0;
+            if (cudaMalloc(reinterpret_cast<void**>(&device_scores_), num_scores * sizeof(int)) != cudaSuccess) {
+                return false;
+            }
+            score_capacity_ = num_scores;
+        }
+        return true;
+    }
+
+    std::int8_t* host_inputs() noexcept { return host_inputs_; }
+    std::int8_t* device_inputs() noexcept { return device_inputs_; }
+    int* device_scores() noexcept { return device_scores_; }
+    cudaStream_t stream() noexcept { return stream_; }
+
+private:
+    cudaStream_t stream_ = nullptr;
+    std::int8_t* host_inputs_ = nullptr;
+    std::int8_t* device_inputs_ = nullptr;
+    int* device_scores_ = nullptr;
+    std::size_t input_capacity_ = 0, score_capacity_ = 0;
+};
+
+void pack(const simd::BatchLane& lane, const int truth_len, const int target_len, std::int8_t* result) noexcept
+{
+    std::memcpy(result, lane.truth, truth_len); result += truth_len;
+    std::memcpy(result, lane.snv_mask, truth_len); result += truth_len;
+    std::memcpy(result, lane.snv_prior, truth_len); result += truth_len;
+    std::memcpy(result, lane.gap_open, truth_len); result += truth_len;
+    std::memcpy(result, lane.gap_extend, truth_len); result += truth_len;
+    std::memcpy(result, lane.target, target_len); result += target_len;
+    std::memcpy(result, lane.qualities, target_len);
+}
+
+} // namespace
+
+bool cuda_has_device() noexcept
+{
+    int num_devices {0};
+    return cudaGetDeviceCount(&num_devices) == cudaSuccess && num_devices > 0;
+}
+
+std::string cuda_device_name()
+{
+    int device {0};
+    cudaDeviceProp properties {};
+    if (cudaGetDevice(&device) != cudaSuccess || cudaGetDeviceProperties(&properties, device) != cudaSuccess) {
+        return "unknown device";
+    }
+    return properties.name;
+}
+
+bool cuda_align(const simd::BatchLane* lanes, const std::size_t num_lanes, const int truth_len, const int target_len,
+                const int band_size, const short nuc_prior, const ScorePrecision score_precision, int* scores) noexcept
+{
+    if (num_lanes == 0) return true;
+    thread_local Workspace workspace {};
+    const auto lane_size = static_cast<std::size_t>(5 * truth_len + 2 * target_len);
+    if (!workspace.reserve(num_lanes * lane_size, num_lanes)) {
+        cudaGetLastError(); // clear the error so later calls can retry
+        return false;
+    }
+    for (std::size_t lane {0}; lane < num_lanes; ++lane) {
+        pack(lanes[lane], truth_len, target_len, workspace.host_inputs() + lane * lane_size);
+    }
+    const auto stream = workspace.stream();
+    cudaMemcpyAsync(workspace.device_inputs(), workspace.host_inputs(), num_lanes * lane_size, cudaMemcpyHostToDevice, stream);
+    const dim3 grid {static_cast<unsigned>(num_lanes)}, block {static_cast<unsigned>(band_size)};
+    if (score_precision == ScorePrecision::int16) {
+        align_kernel<short><<<grid, block, 6 * band_size * sizeof(short), stream>>>
+            (workspace.device_inputs(), truth_len, target_len, nuc_prior, workspace.device_scores());
+    } else {
+        align_kernel<int><<<grid, block, 6 * band_size * sizeof(int), stream>>>
+            (workspace.device_inputs(), truth_len, target_len, nuc_prior, workspace.device_scores());
+    }
+    cudaMemcpyAsync(scores, workspace.device_scores(), num_lanes * sizeof(int), cudaMemcpyDeviceToHost, stream);
+    if (cudaStreamSynchronize(stream) != cudaSuccess || cudaGetLastError() != cudaSuccess) {
+        cudaGetLastError();
+        return false;
+    }
+    return true;
+}
+
+} // namespace detail
+} // namespace gpu
+} // namespace hmm
+} // namespace octopus
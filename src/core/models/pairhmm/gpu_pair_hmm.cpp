@@ -0,0 +1,70 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "gpu_pair_hmm.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace octopus { namespace hmm { namespace gpu {
+
+UnavailableError::UnavailableError()
+: std::runtime_error {"the GPU pair HMM backend is not compiled in or there is no usable device"}
+{}
+
+namespace {
+
+// Zero if the backend is disabled
+std::atomic<std::size_t> enabled_min_batch_size {0};
+
+} // namespace
+
+bool is_available() noexcept
+{
+#if defined(CUDA_PHMM)
+    static const bool result {detail::cuda_has_device()};
+    return result;
+#else
+    return false;
+#endif
+}
+
+void enable(const std::size_t min_batch_size)
+{
+    if (!is_available()) {
+        throw UnavailableError {};
+    }
+    enabled_min_batch_size.store(std::max(min_batch_size, std::size_t {1}), std::memory_order_relaxed);
+}
+
+bool is_enabled() noexcept
+{
+    return enabled_min_batch_size.load(std::memory_order_relaxed) > 0;
+}
+
+std::size_t min_batch_size() noexcept
+{
+    return enabled_min_batch_size.load(std::memory_order_relaxed);
+}
+
+std::string device_name()
+{
+#if defined(CUDA_PHMM)
+    if (is_available()) return detail::cuda_device_name();
+#endif
+    return "";
+}
+
+bool align(const simd::BatchLane* lanes, const std::size_t num_lanes, const int truth_len, const int target_len,
+           const int band_size, const short nuc_prior, const ScorePrecision score_precision, int* scores) noexcept
+{
+#if defined(CUDA_PHMM)
+    return detail::cuda_align(lanes, num_lanes, truth_len, target_len, band_size, nuc_prior, score_precision, scores);
+#else
+    return false;
+#endif
+}
+
+} // namespace gpu
+} // namespace hmm
+} // namespace octopus
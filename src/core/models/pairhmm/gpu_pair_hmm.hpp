@@ -0,0 +1,67 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef gpu_pair_hmm_hpp
+#define gpu_pair_hmm_hpp
+
+#include <cstddef>
+#include <string>
+#include <stdexcept>
+
+#include "simd_pair_hmm_kernels.hpp"
+
+namespace octopus { namespace hmm { namespace gpu {
+
+/*
+ An optional GPU backend for batched alignments (see AlignmentBatch and batched_pair_hmm.hpp). When enabled,
+ each group of batched alignments with the same target length that has at least min_batch_size() alignments
+ (e.g. every read against a haplotype in a window) is sent to the GPU in one transfer, and smaller groups are
+ left to the SIMD kernels. Scores are identical to the CPU kernels. The backend is only compiled in with the
+ CUDA_PAIR_HMM build option, otherwise is_available() is false and enable throws.
+ */
+
+enum class ScorePrecision { int16, int32 };
+
+// True if the backend is compiled in and there is a usable device
+bool is_available() noexcept;
+
+class UnavailableError : public std::runtime_error
+{
+public:
+    UnavailableError();
+};
+
+// Throws UnavailableError if the backend isn't available. Should be called before any calling components are made.
+void enable(std::size_t min_batch_size);
+
+bool is_enabled() noexcept;
+
+// Only meaningful if is_enabled()
+std::size_t min_batch_size() noexcept;
+
+std::string device_name();
+
+// As BatchedPairHMM::align, but for any number of alignments. Returns false if the device failed, in which
+// case the scores are not set and must be computed with the CPU kernels.
+bool align(const simd::BatchLane* lanes, std::size_t num_lanes, int truth_len, int target_len, int band_size,
+           short nuc_prior, ScorePrecision score_precision, int* scores) noexcept;
+
+#if defined(CUDA_PHMM)
+
+namespace detail {
+
+// Defined in cuda_pair_hmm.cu
+bool cuda_has_device() noexcept;
+std::string cuda_device_name();
+bool cuda_align(const simd::BatchLane* lanes, std::size_t num_lanes, int truth_len, int target_len, int band_size,
+                short nuc_prior, ScorePrecision score_precision, int* scores) noexcept;
+
+} // namespace detail
+
+#endif
+
+} // namespace gpu
+} // namespace hmm
+} // namespace octopus
+
+#endif
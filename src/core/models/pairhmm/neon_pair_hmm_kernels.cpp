@@ -0,0 +1,54 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "simd_pair_hmm_kernels.hpp"
+
+#include "neon_pair_hmm_impl.hpp"
+#include "simd_pair_hmm.hpp"
+#include "batched_pair_hmm.hpp"
+#include "rolling_initializer.hpp"
+#include "simd_pair_hmm_kernel_builder.hpp"
+
+namespace octopus { namespace hmm { namespace simd {
+
+#if defined(NEON_PHMM)
+
+namespace {
+
+template <unsigned BandSize, typename ScoreType>
+using NEONKernel = PairHMM<NEONPairHMMInstructionSet<BandSize, ScoreType>, InsertRollingInitializer>;
+
+template <unsigned BandSize> using ShortHMM = NEONKernel<BandSize, short>;
+template <unsigned BandSize> using IntHMM   = NEONKernel<BandSize, int>;
+
+template <unsigned BandSize> using IsViable = std::true_type;
+
+PairHMMKernelSet make_neon_kernels() noexcept
+{
+    return {InstructionSet::neon,
+            detail::make_kernels<ShortHMM, IsViable>(),
+            detail::make_kernels<IntHMM, IsViable>(),
+            detail::make_batched_kernel<BatchedPairHMM<NEONPairHMMInstructionSet<16 / sizeof(short), short>>>(),
+            detail::make_batched_kernel<BatchedPairHMM<NEONPairHMMInstructionSet<16 / sizeof(int), int>>>()};
+}
+
+} // namespace
+
+const PairHMMKernelSet* neon_kernels() noexcept
+{
+    static const PairHMMKernelSet result {make_neon_kernels()};
+    return &result;
+}
+
+#else
+
+const PairHMMKernelSet* neon_kernels() noexcept
+{
+    return nullptr;
+}
+
+#endif
+
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
@@ -9,6 +9,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <utility>
+#include <tuple>
 #include <stdexcept>
 #include <algorithm>
 #include <numeric>
@@ -21,11 +22,16 @@
 #include <cassert>
 #include <iostream>
 
+#include <boost/optional.hpp>
+
 #include "basics/cigar_string.hpp"
 #include "exceptions/program_error.hpp"
 #include "utils/maths.hpp"
+#include "utils/hash_functions.hpp"
 #include "simd_pair_hmm_factory.hpp"
 #include "simd_pair_hmm_wrapper.hpp"
+#include "batched_pair_hmm.hpp"
+#include "gpu_pair_hmm.hpp"
 
 namespace octopus { namespace hmm {
 
@@ -44,6 +50,50 @@ struct Alignment
     double likelihood;
 };
 
+// Evaluations that need a full banded alignment can be deferred to an AlignmentBatch (with the batch
+// overload of evaluate), and then computed together, so that alignments with the same target length
+// can use the batched (inter-alignment) SIMD kernel. The batch only stores pointers to the sequences,
+// qualities and model parameters, which must remain valid until the batch is evaluated.
+class AlignmentBatch
+{
+public:
+    using Id = std::size_t;
+    
+    AlignmentBatch() = default;
+    
+    AlignmentBatch(const AlignmentBatch&)            = default;
+    AlignmentBatch& operator=(const AlignmentBatch&) = default;
+    AlignmentBatch(AlignmentBatch&&)                 = default;
+    AlignmentBatch& operator=(AlignmentBatch&&)      = default;
+    
+    ~AlignmentBatch() = default;
+    
+    bool empty() const noexcept { return alignments_.empty(); }
+    std::size_t size() const noexcept { return alignments_.size(); }
+    void clear() noexcept { alignments_.clear(); }
+    
+    void add(const simd::BatchLane& lane, const int target_len, const short nuc_prior, const Id id)
+    {
+        alignments_.push_back({lane, target_len, nuc_prior, id});
+    }
+    
+    struct BatchedAlignment
+    {
+        simd::BatchLane lane;
+        int target_len;
+        short nuc_prior;
+        Id id;
+    };
+    
+    using Iterator = std::vector<BatchedAlignment>::iterator;
+    
+    Iterator begin() noexcept { return std::begin(alignments_); }
+    Iterator end() noexcept { return std::end(alignments_); }
+
+private:
+    std::vector<BatchedAlignment> alignments_;
+};
+
 class HMMOverflow : public ProgramError
 {
 public:
@@ -822,6 +872,181 @@ simd_align(const Sequence1& truth,
     make_cigar(align1, align2, result.cigar);
 }
 
+template <typename PairHMMParameters>
+constexpr bool is_batchable_model() noexcept
+{
+    return !std::is_same<std::decay_t<decltype(std::declval<PairHMMParameters>().snv_mask)>, NullType>::value
+           && !std::is_same<std::decay_t<decltype(std::declval<PairHMMParameters>().lhs_flank_size)>, NullType>::value
+           && std::is_class<std::decay_t<decltype(std::declval<PairHMMParameters>().gap_open)>>::value
+           && std::is_class<std::decay_t<decltype(std::declval<PairHMMParameters>().gap_extend)>>::value;
+}
+
+inline int batch_size(const simd::PairHMMWrapper& hmm) noexcept
+{
+    return hmm.batch_size();
+}
+template <typename InstructionSet, template <class> class InitializerType>
+constexpr int batch_size(const simd::PairHMM<InstructionSet, InitializerType>&) noexcept
+{
+    return simd::BatchedSimdPairHMM<typename simd::PairHMM<InstructionSet, InitializerType>::ScoreType>::batch_size();
+}
+
+inline void
+align_batch(const simd::PairHMMWrapper& hmm, const simd::BatchLane* lanes, const int num_lanes,
+            const int truth_len, const int target_len, const short nuc_prior, int* scores) noexcept
+{
+    hmm.align(lanes, num_lanes, truth_len, target_len, nuc_prior, scores);
+}
+template <typename InstructionSet, template <class> class InitializerType>
+void
+align_batch(const simd::PairHMM<InstructionSet, InitializerType>& hmm, const simd::BatchLane* lanes, const int num_lanes,
+            const int truth_len, const int target_len, const short nuc_prior, int* scores) noexcept
+{
+    using BatchedPairHMM = simd::BatchedSimdPairHMM<typename simd::PairHMM<InstructionSet, InitializerType>::ScoreType>;
+    BatchedPairHMM {}.align(lanes, num_lanes, truth_len, target_len, hmm.band_size(), nuc_prior, scores);
+}
+
+inline gpu::ScorePrecision score_precision(const simd::PairHMMWrapper& hmm) noexcept
+{
+    return hmm.score_precision() == simd::PairHMMWrapper::ScorePrecision::int16 ? gpu::ScorePrecision::int16 : gpu::ScorePrecision::int32;
+}
+template <typename InstructionSet, template <class> class InitializerType>
+constexpr gpu::ScorePrecision score_precision(const simd::PairHMM<InstructionSet, InitializerType>&) noexcept
+{
+    using ScoreType = typename simd::PairHMM<InstructionSet, InitializerType>::ScoreType;
+    return sizeof(ScoreType) == sizeof(short) ? gpu::ScorePrecision::int16 : gpu::ScorePrecision::int32;
+}
+
+// Computes a group of batched alignments on the GPU, returning false if the device failed
+template <typename PairHMM,
+          typename BatchIterator,
+          typename F>
+bool gpu_evaluate_batch(BatchIterator first, BatchIterator last, const PairHMM& hmm,
+                        const int truth_len, const int target_len, const short nuc_prior, F& f)
+{
+    thread_local std::vector<simd::BatchLane> lanes {};
+    thread_local std::vector<int> scores {};
+    lanes.clear();
+    std::transform(first, last, std::back_inserter(lanes), [] (const AlignmentBatch::BatchedAlignment& alignment) noexcept { return alignment.lane; });
+    scores.resize(lanes.size());
+    if (!gpu::align(lanes.data(), lanes.size(), truth_len, target_len, hmm.band_size(), nuc_prior, score_precision(hmm), scores.data())) {
+        return false;
+    }
+    for (auto score_itr = std::cbegin(scores); first != last; ++first, ++score_itr) {
+        f(first->id, -ln10Div10<> * static_cast<double>(*score_itr));
+    }
+    return true;
+}
+
+// The batched kernel only helps if it has more lanes than the band, otherwise PairHMM fills the vector
+template <typename PairHMM>
+bool use_batched_kernel(const PairHMM& hmm) noexcept
+{
+    return batch_size(hmm) > hmm.band_size();
+}
+
+template <typename Sequence1,
+          typename Sequence2,
+          typename PairHMM,
+          typename PairHMMParameters>
+boost::optional<double>
+simd_evaluate_or_batch(const Sequence1& truth,
+                       const Sequence2& target,
+                       const std::vector<std::uint8_t>& target_base_qualities,
+                       const std::size_t target_offset,
+                       const PairHMM& hmm,
+                       const PairHMMParameters& hmm_params,
+                       AlignmentBatch& batch,
+                       const AlignmentBatch::Id id,
+                       std::false_type)
+{
+    return simd_evaluate(truth, target, target_base_qualities, target_offset, hmm, hmm_params);
+}
+template <typename Sequence1,
+          typename Sequence2,
+          typename PairHMM,
+          typename PairHMMParameters>
+boost::optional<double>
+simd_evaluate_or_batch(const Sequence1& truth,
+                       const Sequence2& target,
+                       const std::vector<std::uint8_t>& target_base_qualities,
+                       const std::size_t target_offset,
+                       const PairHMM& hmm,
+                       const PairHMMParameters& hmm_params,
+                       AlignmentBatch& batch,
+                       const AlignmentBatch::Id id,
+                       std::true_type)
+{
+    const auto pad = hmm.band_size();
+    const auto truth_size  = static_cast<int>(truth.size());
+    const auto target_size = static_cast<int>(target.size());
+    const auto truth_alignment_size = static_cast<int>(target_size + 2 * pad - 1);
+    const auto alignment_offset = std::max(0, static_cast<int>(target_offset) - pad);
+    if (alignment_offset + truth_alignment_size > truth_size) {
+        return std::numeric_limits<double>::lowest();
+    }
+    if (!use_batched_kernel(hmm) || use_adjusted_alignment_score(truth, target, target_offset, hmm, hmm_params)) {
+        return simd_evaluate(truth, target, target_base_qualities, target_offset, hmm, hmm_params);
+    }
+    const simd::BatchLane lane {
+        truth.data() + alignment_offset,
+        target.data(),
+        reinterpret_cast<const std::int8_t*>(target_base_qualities.data()),
+        data(hmm_params.snv_mask, alignment_offset),
+        data(hmm_params.snv_priors, alignment_offset),
+        data(hmm_params.gap_open, alignment_offset),
+        data(hmm_params.gap_extend, alignment_offset)
+    };
+    batch.add(lane, target_size, hmm_params.nuc_prior, id);
+    return boost::none;
+}
+
+template <typename PairHMM,
+          typename F>
+void evaluate_batch(AlignmentBatch& batch, const PairHMM& hmm, F&& f)
+{
+    using BatchedAlignment = AlignmentBatch::BatchedAlignment;
+    const int max_batch_size {batch_size(hmm)};
+    const int min_batch_size {max_batch_size / 2};
+    assert(max_batch_size <= simd::maxBatchSize);
+    const auto band_size = hmm.band_size();
+    std::sort(std::begin(batch), std::end(batch), [] (const BatchedAlignment& lhs, const BatchedAlignment& rhs) noexcept {
+        return std::tie(lhs.target_len, lhs.nuc_prior) < std::tie(rhs.target_len, rhs.nuc_prior);
+    });
+    std::array<simd::BatchLane, simd::maxBatchSize> lanes;
+    std::array<int, simd::maxBatchSize> scores;
+    for (auto group_begin = std::begin(batch); group_begin != std::end(batch);) {
+        const auto target_len = group_begin->target_len;
+        const auto nuc_prior = group_begin->nuc_prior;
+        const auto group_end = std::find_if(std::next(group_begin), std::end(batch), [=] (const BatchedAlignment& alignment) noexcept {
+            return alignment.target_len != target_len || alignment.nuc_prior != nuc_prior;
+        });
+        const auto truth_len = target_len + 2 * band_size - 1;
+        if (gpu::is_enabled() && static_cast<std::size_t>(std::distance(group_begin, group_end)) >= gpu::min_batch_size()
+            && gpu_evaluate_batch(group_begin, group_end, hmm, truth_len, target_len, nuc_prior, f)) {
+            group_begin = group_end;
+            continue;
+        }
+        // Alignments that would leave most lanes empty are done one at a time
+        while (std::distance(group_begin, group_end) >= min_batch_size) {
+            const auto num_lanes = static_cast<int>(std::min<std::ptrdiff_t>(std::distance(group_begin, group_end), max_batch_size));
+            std::transform(group_begin, std::next(group_begin, num_lanes), std::begin(lanes),
+                           [] (const BatchedAlignment& alignment) noexcept { return alignment.lane; });
+            align_batch(hmm, lanes.data(), num_lanes, truth_len, target_len, nuc_prior, scores.data());
+            for (int i {0}; i < num_lanes; ++i, ++group_begin) {
+                f(group_begin->id, -ln10Div10<> * static_cast<double>(scores[i]));
+            }
+        }
+        for (; group_begin != group_end; ++group_begin) {
+            const auto& lane = group_begin->lane;
+            const auto score = hmm.align(lane.truth, lane.target, lane.qualities, truth_len, target_len,
+                                         lane.snv_mask, lane.snv_prior, lane.gap_open, lane.gap_extend, nuc_prior);
+            f(group_begin->id, -ln10Div10<> * static_cast<double>(score));
+        }
+    }
+    batch.clear();
+}
+
 } // namespace detail
 
 template <typename Sequence1,
@@ -889,6 +1114,99 @@ align(const Sequence1& truth,
     align(truth, target, target_base_qualities, hmm.band_size(), hmm, model_params, result);
 }
 
+// As evaluate, but returns none if the alignment was added to batch rather than evaluated
+template <typename Sequence1,
+          typename Sequence2,
+          typename PairHMM,
+          typename PairHMMParameters>
+boost::optional<double>
+evaluate(const Sequence1& truth,
+         const Sequence2& target,
+         const std::vector<std::uint8_t>& target_base_qualities,
+         const std::size_t target_offset,
+         const PairHMM& hmm,
+         const PairHMMParameters& model_params,
+         AlignmentBatch& batch,
+         const AlignmentBatch::Id id)
+{
+    auto p = detail::try_naive_evaluate(truth, target, target_base_qualities, target_offset, model_params);
+    if (p.second) return p.first;
+    return detail::simd_evaluate_or_batch(truth, target, target_base_qualities, target_offset, hmm, model_params, batch, id,
+                                          std::integral_constant<bool, detail::is_batchable_model<PairHMMParameters>()> {});
+}
+
+// Combines into hash everything except the target and its base qualities that evaluate(truth, target,
+// target_base_qualities, target_offset, hmm, model_params) depends on, which is the model over the part of
+// the truth the target is aligned to. So evaluations with equal target hashes and equal truth hashes are
+// equal, whichever truths they are. Returns false, leaving hash unchanged, if the target doesn't fit the truth.
+// hash_window(hash, offset, size) must combine the truth, gap penalties, SNV mask and SNV priors over
+// [offset, offset + size) into hash, e.g. from precomputed hashes of the truth.
+template <typename Sequence,
+          typename PairHMM,
+          typename PairHMMParameters,
+          typename WindowHasher>
+bool
+hash_truth(const Sequence& truth,
+           const std::size_t target_size,
+           const std::size_t target_offset,
+           const PairHMM& hmm,
+           const PairHMMParameters& model_params,
+           utils::Hash128& hash,
+           WindowHasher&& hash_window) noexcept
+{
+    static_assert(detail::is_batchable_model<PairHMMParameters>(), "");
+    const auto pad = hmm.band_size();
+    const auto truth_size = static_cast<int>(truth.size());
+    const auto truth_alignment_size = static_cast<int>(target_size + 2 * pad - 1);
+    const auto alignment_offset = std::max(0, static_cast<int>(target_offset) - pad);
+    if (alignment_offset + truth_alignment_size > truth_size) return false;
+    // The flanks and target offset are relative to the truth window
+    const auto lhs_flank_size = static_cast<int>(model_params.lhs_flank_size);
+    const auto rhs_flank_begin = truth_size - static_cast<int>(model_params.rhs_flank_size);
+    const auto window_lhs_flank_size = std::min(std::max(lhs_flank_size - alignment_offset, 0), truth_alignment_size);
+    const auto window_rhs_flank_size = std::min(std::max(alignment_offset + truth_alignment_size - rhs_flank_begin, 0), truth_alignment_size);
+    const bool is_flank_adjusted {static_cast<int>(target_offset) < lhs_flank_size + pad
+                                  || static_cast<int>(target_offset + target_size) + pad > rhs_flank_begin};
+    utils::hash_combine(hash, static_cast<std::uint64_t>(pad));
+    utils::hash_combine(hash, static_cast<std::uint64_t>(model_params.nuc_prior));
+    utils::hash_combine(hash, static_cast<std::uint64_t>(target_offset) - alignment_offset);
+    utils::hash_combine(hash, static_cast<std::uint64_t>(window_lhs_flank_size));
+    utils::hash_combine(hash, static_cast<std::uint64_t>(window_rhs_flank_size));
+    utils::hash_combine(hash, static_cast<std::uint64_t>(is_flank_adjusted));
+    hash_window(hash, static_cast<std::size_t>(alignment_offset), static_cast<std::size_t>(truth_alignment_size));
+    return true;
+}
+
+template <typename Sequence,
+          typename PairHMM,
+          typename PairHMMParameters>
+bool
+hash_truth(const Sequence& truth,
+           const std::size_t target_size,
+           const std::size_t target_offset,
+           const PairHMM& hmm,
+           const PairHMMParameters& model_params,
+           utils::Hash128& hash) noexcept
+{
+    return hash_truth(truth, target_size, target_offset, hmm, model_params, hash,
+                      [&] (utils::Hash128& hash, const std::size_t offset, const std::size_t size) noexcept {
+                          utils::hash_bytes(hash, truth.data() + offset, size);
+                          utils::hash_bytes(hash, detail::data(model_params.gap_open, offset), size);
+                          utils::hash_bytes(hash, detail::data(model_params.gap_extend, offset), size);
+                          utils::hash_bytes(hash, detail::data(model_params.snv_mask, offset), size);
+                          utils::hash_bytes(hash, detail::data(model_params.snv_priors, offset), size);
+                      });
+}
+
+// Evaluates every alignment in batch, calling f(id, log_probability) for each, and clears the batch
+template <typename PairHMM, typename F>
+void evaluate(AlignmentBatch& batch, const PairHMM& hmm, F&& f)
+{
+    if (!batch.empty()) {
+        detail::evaluate_batch(batch, hmm, std::forward<F>(f));
+    }
+}
+
 template <typename Parameters,
           int BandSize = 0,
           typename Score = NullType>
@@ -953,6 +1271,42 @@ public:
         return octopus::hmm::evaluate(truth, target, hmm_, *params_);
     }
     
+    template <typename Sequence1,
+              typename Sequence2>
+    boost::optional<double>
+    evaluate(const Sequence1& target,
+             const Sequence2& truth,
+             const std::vector<std::uint8_t>& target_base_qualities,
+             const std::size_t target_offset,
+             AlignmentBatch& batch,
+             const AlignmentBatch::Id id) const
+    {
+        assert(params_);
+        return octopus::hmm::evaluate(truth, target, target_base_qualities, target_offset, hmm_, *params_, batch, id);
+    }
+    
+    template <typename F>
+    void evaluate(AlignmentBatch& batch, F&& f) const
+    {
+        octopus::hmm::evaluate(batch, hmm_, std::forward<F>(f));
+    }
+    
+    template <typename Sequence>
+    bool hash_truth(const Sequence& truth, const std::size_t target_size, const std::size_t target_offset,
+                    utils::Hash128& hash) const noexcept
+    {
+        assert(params_);
+        return octopus::hmm::hash_truth(truth, target_size, target_offset, hmm_, *params_, hash);
+    }
+    template <typename Sequence, typename WindowHasher>
+    bool hash_truth(const Sequence& truth, const std::size_t target_size, const std::size_t target_offset,
+                    utils::Hash128& hash, WindowHasher&& hash_window) const noexcept
+    {
+        assert(params_);
+        return octopus::hmm::hash_truth(truth, target_size, target_offset, hmm_, *params_, hash,
+                                        std::forward<WindowHasher>(hash_window));
+    }
+    
     template <typename Sequence1,
               typename Sequence2>
     void
@@ -141,7 +141,14 @@ private:
         current = _add(current, _min(_andnot(_cmpeq(_targetwin, _truthwin), _qualitieswin), _truthnqual));
     }
     
-    auto make_traceback_array(int target_len, int) const noexcept { return SmallVector(2 * (target_len + band_size_) + 1); }
+    // The traceback needs 2 bits per cell of each anti-diagonal band (one vector), so is linear in the target
+    // length. The storage is kept between calls on each thread, so only grows with the longest target seen.
+    SmallVector& make_traceback_array(int target_len, int) const
+    {
+        thread_local SmallVector result {};
+        result.resize(2 * (target_len + band_size_) + 1);
+        return result;
+    }
     auto make_traceback_array(int target_len, NullType) const noexcept { return NullType {}; }
     
     void
@@ -263,7 +270,7 @@ private:
         auto _snvmaskwin   = vectorise(snv_mask);
         auto _snv_priorwin = vectorise_left_shift_bits<trace_bits_>(snv_prior);
         auto _truthnqual   = _add(_and(_cmpeq(_truthwin, vectorise('N')), vectorise(n_score_ - infinity_)), _inf);
-        auto _backpointers = make_traceback_array(target_len, first_pos);
+        auto&& _backpointers = make_traceback_array(target_len, first_pos);
         auto _m1 = _inf, _i1 = _inf, _d1 = _inf, _m2 = _inf, _i2 = _inf, _d2 = _inf;
         Initializer rollinginit {null_score_};
         ScoreType minscore {infinity_}, cur_score;
@@ -334,8 +341,9 @@ private:
     {
         return (snv_mask[x] == target[y]) ? std::min(quals[y], caps[x]) : quals[y];
     }
+    template <typename CharArrayOrNull>
     auto
-    get_mismatch_quality(const char* target,
+    get_mismatch_quality(CharArrayOrNull target,
                          const std::int8_t* quals,
                          int x, int y,
                          NullType,
@@ -0,0 +1,125 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef simd_pair_hmm_kernel_builder_hpp
+#define simd_pair_hmm_kernel_builder_hpp
+
+#include <array>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+
+#include "simd_pair_hmm_kernels.hpp"
+
+namespace octopus { namespace hmm { namespace simd { namespace detail {
+
+/*
+ Helpers for the instruction set translation units to make their PairHMMKernelSet. Each unit must only
+ instantiate the kernels of its own instruction set, as the same template compiled with different
+ instruction set flags in two units would be one symbol to the linker. Band sizes that an instruction
+ set can't fill are taken from the next instruction set down, as PairHMMSelector does.
+ */
+
+template <typename HMM,
+          typename OpenPenaltyArrayOrConstant,
+          typename ExtendPenaltyArrayOrConstant>
+AlignmentKernels<OpenPenaltyArrayOrConstant, ExtendPenaltyArrayOrConstant> make_alignment_kernels() noexcept
+{
+    using Open = OpenPenaltyArrayOrConstant;
+    using Extend = ExtendPenaltyArrayOrConstant;
+    return {
+        [] (const char* truth, const char* target, const std::int8_t* qualities, int truth_len, int target_len,
+            Open gap_open, Extend gap_extend, short nuc_prior) {
+            return HMM {}.align(truth, target, qualities, truth_len, target_len, gap_open, gap_extend, nuc_prior);
+        },
+        [] (const char* truth, const char* target, const std::int8_t* qualities, int truth_len, int target_len,
+            const char* snv_mask, const std::int8_t* snv_prior, Open gap_open, Extend gap_extend, short nuc_prior) {
+            return HMM {}.align(truth, target, qualities, truth_len, target_len, snv_mask, snv_prior,
+                                gap_open, gap_extend, nuc_prior);
+        },
+        [] (const char* truth, const char* target, const std::int8_t* qualities, int truth_len, int target_len,
+            Open gap_open, Extend gap_extend, short nuc_prior, int& first_pos, char* align1, char* align2) {
+            return HMM {}.align(truth, target, qualities, truth_len, target_len, gap_open, gap_extend, nuc_prior,
+                                first_pos, align1, align2);
+        },
+        [] (const char* truth, const char* target, const std::int8_t* qualities, int truth_len, int target_len,
+            const char* snv_mask, const std::int8_t* snv_prior, Open gap_open, Extend gap_extend, short nuc_prior,
+            int& first_pos, char* align1, char* align2) {
+            return HMM {}.align(truth, target, qualities, truth_len, target_len, snv_mask, snv_prior,
+                                gap_open, gap_extend, nuc_prior, first_pos, align1, align2);
+        },
+        [] (int truth_len, int lhs_flank_len, int rhs_flank_len, const std::int8_t* quals,
+            Open gap_open, Extend gap_extend, short nuc_prior, int first_pos, const char* aln1, const char* aln2,
+            int& target_mask_size) {
+            return HMM {}.calculate_flank_score(truth_len, lhs_flank_len, rhs_flank_len, quals, gap_open, gap_extend,
+                                                nuc_prior, first_pos, aln1, aln2, target_mask_size);
+        },
+        [] (int truth_len, int lhs_flank_len, int rhs_flank_len, const char* target, const std::int8_t* quals,
+            const char* snv_mask, const std::int8_t* snv_prior, Open gap_open, Extend gap_extend, short nuc_prior,
+            int first_pos, const char* aln1, const char* aln2, int& target_mask_size) {
+            return HMM {}.calculate_flank_score(truth_len, lhs_flank_len, rhs_flank_len, target, quals, snv_mask, snv_prior,
+                                                gap_open, gap_extend, nuc_prior, first_pos, aln1, aln2, target_mask_size);
+        }
+    };
+}
+
+template <typename HMM>
+PairHMMKernel make_kernel() noexcept
+{
+    return {HMM::name(), HMM::band_size(),
+            std::make_tuple(make_alignment_kernels<HMM, PenaltyArray, PenaltyArray>(),
+                            make_alignment_kernels<HMM, PenaltyArray, PenaltyConstant>(),
+                            make_alignment_kernels<HMM, PenaltyConstant, PenaltyConstant>())};
+}
+
+template <typename BatchedHMM>
+BatchedPairHMMKernel make_batched_kernel() noexcept
+{
+    return {BatchedHMM::name(), BatchedHMM::batch_size(),
+            [] (const BatchLane* lanes, int num_lanes, int truth_len, int target_len, int band_size,
+                short nuc_prior, int* scores) {
+                BatchedHMM {}.align(lanes, num_lanes, truth_len, target_len, band_size, nuc_prior, scores);
+            }};
+}
+
+constexpr unsigned kernel_band_size(const std::size_t index) noexcept
+{
+    return 8u << index;
+}
+
+template <template <unsigned> class HMMTemplate, unsigned BandSize>
+PairHMMKernel make_kernel_or_fallback(const PairHMMKernel&, std::true_type) noexcept
+{
+    return make_kernel<HMMTemplate<BandSize>>();
+}
+template <template <unsigned> class HMMTemplate, unsigned BandSize>
+PairHMMKernel make_kernel_or_fallback(const PairHMMKernel& fallback, std::false_type) noexcept
+{
+    return fallback;
+}
+
+template <template <unsigned> class HMMTemplate,
+          template <unsigned> class IsViable,
+          std::size_t... BandIndices>
+auto make_kernels(const std::array<PairHMMKernel, numKernelBandSizes>& fallback, std::index_sequence<BandIndices...>) noexcept
+{
+    return std::array<PairHMMKernel, numKernelBandSizes> {{
+        make_kernel_or_fallback<HMMTemplate, kernel_band_size(BandIndices)>(
+            fallback[BandIndices], std::integral_constant<bool, IsViable<kernel_band_size(BandIndices)>::value> {})...
+    }};
+}
+
+// The kernel of each band size is HMMTemplate<band size> if IsViable<band size>, otherwise the fallback kernel
+template <template <unsigned> class HMMTemplate,
+          template <unsigned> class IsViable>
+auto make_kernels(const std::array<PairHMMKernel, numKernelBandSizes>& fallback = {}) noexcept
+{
+    return make_kernels<HMMTemplate, IsViable>(fallback, std::make_index_sequence<numKernelBandSizes> {});
+}
+
+} // namespace detail
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
+
+#endif
@@ -0,0 +1,123 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "simd_pair_hmm_kernels.hpp"
+
+#include <atomic>
+#include <string>
+
+#if defined(__aarch64__) && defined(__linux__)
+    #include <sys/auxv.h>
+    #include <asm/hwcap.h>
+#endif
+
+namespace octopus { namespace hmm { namespace simd {
+
+const char* to_string(const InstructionSet instruction_set) noexcept
+{
+    switch (instruction_set) {
+        case InstructionSet::sse2: return "SSE2";
+        case InstructionSet::avx2: return "AVX2";
+        case InstructionSet::avx512: return "AVX512";
+        case InstructionSet::neon: return "NEON";
+        case InstructionSet::sve: return "SVE";
+    }
+    return "";
+}
+
+UnsupportedInstructionSetError::UnsupportedInstructionSetError(InstructionSet instruction_set)
+: std::runtime_error {std::string {"pair HMM instruction set "} + to_string(instruction_set) + " is not supported"}
+, instruction_set_ {instruction_set}
+{}
+
+namespace {
+
+const PairHMMKernelSet* find_kernels(const InstructionSet instruction_set) noexcept
+{
+    switch (instruction_set) {
+        case InstructionSet::sse2: return sse2_kernels();
+        case InstructionSet::avx2: return avx2_kernels();
+        case InstructionSet::avx512: return avx512_kernels();
+        case InstructionSet::neon: return neon_kernels();
+        case InstructionSet::sve: return sve_kernels();
+    }
+    return nullptr;
+}
+
+bool cpu_supports(const InstructionSet instruction_set) noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // These also check that the OS saves the wide registers
+    switch (instruction_set) {
+        case InstructionSet::sse2: return __builtin_cpu_supports("sse4.1"); // the int kernels need SSE4.1
+        case InstructionSet::avx2: return __builtin_cpu_supports("avx2");
+        case InstructionSet::avx512: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+        case InstructionSet::neon: return false;
+        case InstructionSet::sve: return false;
+    }
+    return false;
+#elif defined(__aarch64__)
+    #if defined(__linux__)
+        switch (instruction_set) {
+            case InstructionSet::neon: return getauxval(AT_HWCAP) & HWCAP_ASIMD;
+            #if defined(HWCAP_SVE)
+            case InstructionSet::sve: return getauxval(AT_HWCAP) & HWCAP_SVE;
+            #endif
+            default: return false;
+        }
+    #else
+        return instruction_set == InstructionSet::neon; // Advanced SIMD is mandatory on AArch64
+    #endif
+#else
+    return false;
+#endif
+}
+
+std::atomic<const PairHMMKernelSet*> current_kernels {nullptr};
+
+} // namespace
+
+bool is_supported(const InstructionSet instruction_set) noexcept
+{
+    return find_kernels(instruction_set) != nullptr && cpu_supports(instruction_set);
+}
+
+InstructionSet fastest_supported_instruction_set()
+{
+    for (const auto instruction_set : {InstructionSet::avx512, InstructionSet::avx2, InstructionSet::sve, InstructionSet::neon}) {
+        if (is_supported(instruction_set)) return instruction_set;
+    }
+    if (!is_supported(InstructionSet::sse2)) {
+        throw UnsupportedInstructionSetError {InstructionSet::sse2};
+    }
+    return InstructionSet::sse2;
+}
+
+void set_instruction_set(const InstructionSet instruction_set)
+{
+    if (!is_supported(instruction_set)) {
+        throw UnsupportedInstructionSetError {instruction_set};
+    }
+    current_kernels.store(find_kernels(instruction_set), std::memory_order_release);
+}
+
+InstructionSet get_instruction_set()
+{
+    return get_kernels().instruction_set;
+}
+
+const PairHMMKernelSet& get_kernels()
+{
+    auto result = current_kernels.load(std::memory_order_acquire);
+    if (!result) {
+        const auto fastest = find_kernels(fastest_supported_instruction_set());
+        if (current_kernels.compare_exchange_strong(result, fastest, std::memory_order_acq_rel)) {
+            result = fastest;
+        }
+    }
+    return *result;
+}
+
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
@@ -0,0 +1,146 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef simd_pair_hmm_kernels_hpp
+#define simd_pair_hmm_kernels_hpp
+
+#include <array>
+#include <tuple>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+namespace octopus { namespace hmm { namespace simd {
+
+/*
+ The pair HMM kernels for each instruction set are compiled in their own translation units (with the
+ compiler flags for that instruction set), and exposed through tables of function pointers, so that one
+ binary contains every kernel the target architecture supports. The kernels are chosen at runtime from
+ the instruction sets that the CPU supports: the fastest by default, or as set by set_instruction_set.
+ */
+
+enum class InstructionSet { sse2, avx2, avx512, neon, sve };
+
+const char* to_string(InstructionSet instruction_set) noexcept;
+
+// The inputs of one alignment in a batch, as for PairHMM::align with SNV mask and gap penalty arrays
+struct BatchLane
+{
+    const char* truth;
+    const char* target;
+    const std::int8_t* qualities;
+    const char* snv_mask;
+    const std::int8_t* snv_prior;
+    const std::int8_t* gap_open;
+    const std::int8_t* gap_extend;
+};
+
+using PenaltyArray    = const std::int8_t*;
+using PenaltyConstant = std::int8_t;
+
+// The PairHMM align and calculate_flank_score overloads for one combination of gap penalty types
+template <typename OpenPenaltyArrayOrConstant,
+          typename ExtendPenaltyArrayOrConstant>
+struct AlignmentKernels
+{
+    int (*align)(const char* truth, const char* target, const std::int8_t* qualities,
+                 int truth_len, int target_len,
+                 OpenPenaltyArrayOrConstant gap_open, ExtendPenaltyArrayOrConstant gap_extend,
+                 short nuc_prior);
+    int (*align_with_snv_mask)(const char* truth, const char* target, const std::int8_t* qualities,
+                               int truth_len, int target_len,
+                               const char* snv_mask, const std::int8_t* snv_prior,
+                               OpenPenaltyArrayOrConstant gap_open, ExtendPenaltyArrayOrConstant gap_extend,
+                               short nuc_prior);
+    int (*align_with_traceback)(const char* truth, const char* target, const std::int8_t* qualities,
+                                int truth_len, int target_len,
+                                OpenPenaltyArrayOrConstant gap_open, ExtendPenaltyArrayOrConstant gap_extend,
+                                short nuc_prior, int& first_pos, char* align1, char* align2);
+    int (*align_with_snv_mask_and_traceback)(const char* truth, const char* target, const std::int8_t* qualities,
+                                             int truth_len, int target_len,
+                                             const char* snv_mask, const std::int8_t* snv_prior,
+                                             OpenPenaltyArrayOrConstant gap_open, ExtendPenaltyArrayOrConstant gap_extend,
+                                             short nuc_prior, int& first_pos, char* align1, char* align2);
+    int (*calculate_flank_score)(int truth_len, int lhs_flank_len, int rhs_flank_len,
+                                 const std::int8_t* quals,
+                                 OpenPenaltyArrayOrConstant gap_open, ExtendPenaltyArrayOrConstant gap_extend,
+                                 short nuc_prior, int first_pos, const char* aln1, const char* aln2,
+                                 int& target_mask_size);
+    int (*calculate_flank_score_with_snv_mask)(int truth_len, int lhs_flank_len, int rhs_flank_len,
+                                               const char* target, const std::int8_t* quals,
+                                               const char* snv_mask, const std::int8_t* snv_prior,
+                                               OpenPenaltyArrayOrConstant gap_open, ExtendPenaltyArrayOrConstant gap_extend,
+                                               short nuc_prior, int first_pos, const char* aln1, const char* aln2,
+                                               int& target_mask_size);
+};
+
+// A compiled PairHMM, i.e. a band size and score type for an instruction set
+struct PairHMMKernel
+{
+    const char* name;
+    int band_size;
+    std::tuple<AlignmentKernels<PenaltyArray, PenaltyArray>,
+               AlignmentKernels<PenaltyArray, PenaltyConstant>,
+               AlignmentKernels<PenaltyConstant, PenaltyConstant>> alignment;
+};
+
+// The most alignments any BatchedPairHMM computes at once (16 bit scores in 512 bit vectors)
+constexpr int maxBatchSize {32};
+
+// A compiled BatchedPairHMM for a score type
+struct BatchedPairHMMKernel
+{
+    const char* name;
+    int batch_size;
+    void (*align)(const BatchLane* lanes, int num_lanes, int truth_len, int target_len, int band_size,
+                  short nuc_prior, int* scores);
+};
+
+// Band sizes are the powers of two from 8 to 256
+constexpr std::size_t numKernelBandSizes {6};
+
+struct PairHMMKernelSet
+{
+    InstructionSet instruction_set;
+    std::array<PairHMMKernel, numKernelBandSizes> int16, int32; // in increasing band size
+    BatchedPairHMMKernel batched_int16, batched_int32;
+};
+
+// Returns nullptr if the kernels for the instruction set aren't available for the target architecture.
+// The SVE kernels are also unavailable if the CPU vector length isn't the one they were compiled for.
+const PairHMMKernelSet* sse2_kernels() noexcept;
+const PairHMMKernelSet* avx2_kernels() noexcept;
+const PairHMMKernelSet* avx512_kernels() noexcept;
+const PairHMMKernelSet* neon_kernels() noexcept;
+const PairHMMKernelSet* sve_kernels() noexcept;
+
+class UnsupportedInstructionSetError : public std::runtime_error
+{
+public:
+    UnsupportedInstructionSetError(InstructionSet instruction_set);
+
+    InstructionSet instruction_set() const noexcept { return instruction_set_; }
+
+private:
+    InstructionSet instruction_set_;
+};
+
+// True if the kernels for the instruction set are compiled in and the CPU supports it
+bool is_supported(InstructionSet instruction_set) noexcept;
+
+// Throws UnsupportedInstructionSetError if the CPU supports none of the instruction sets
+InstructionSet fastest_supported_instruction_set();
+
+// Sets the kernels used by every PairHMMWrapper reset afterwards, so should be called before any are made.
+// Throws UnsupportedInstructionSetError if the instruction set isn't supported.
+void set_instruction_set(InstructionSet instruction_set);
+
+InstructionSet get_instruction_set();
+
+const PairHMMKernelSet& get_kernels();
+
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
+
+#endif
@@ -5,38 +5,19 @@
 #define simd_pair_hmm_wrapper_hpp
 
 #include <tuple>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
 
-#include <boost/variant.hpp>
-
-#include "exceptions/user_error.hpp"
-#include "simd_pair_hmm_factory.hpp"
+#include "simd_pair_hmm_kernels.hpp"
 
 namespace octopus { namespace hmm { namespace simd {
 
-namespace detail {
-
-constexpr unsigned ipow(unsigned base, unsigned exponent) noexcept
-{
-    return exponent == 0 ? 1 : base * ipow(base, exponent - 1);
-}
-
-template <typename T, std::size_t... I>
-constexpr auto make_phmm_tuple(std::index_sequence<I...>) { return std::make_tuple(SimdPairHMM<ipow(2, I + 3), T>{}...); }
-
-template <typename Tuple>
-struct to_variant;
-
-template <typename... Ts>
-struct to_variant<std::tuple<Ts...>>
-{
-    using type = boost::variant<Ts...>;
-};
-
-template <typename Tuple>
-using to_variant_t = typename to_variant<Tuple>::type;
-
-} // namespace detail
-
+// Calls the PairHMM kernel for the band size and score precision, compiled for the instruction set
+// selected at runtime (see simd_pair_hmm_kernels.hpp)
 class PairHMMWrapper
 {
 public:
@@ -72,19 +53,27 @@ public:
     
     ~PairHMMWrapper() = default;
     
-    int band_size() const noexcept
-    {
-        return boost::apply_visitor([] (const auto& hmm) noexcept { return hmm.band_size(); }, hmm_);
-    }
+    int band_size() const noexcept { return kernel_->band_size; }
     
-    const char* name() const noexcept
-    {
-        return boost::apply_visitor([] (const auto& hmm) noexcept { return hmm.name(); }, hmm_);
-    }
+    const char* name() const noexcept { return kernel_->name; }
+    
+    ScorePrecision score_precision() const noexcept { return score_precision_; }
     
+    // The number of alignments the batched kernel computes at once
+    int batch_size() const noexcept { return batched_kernel_->batch_size; }
+
     void reset(int min_band_size, ScorePrecision score_precision = ScorePrecision::int16)
     {
-        hmm_ = make_simd_pair_hmm(min_band_size, score_precision);
+        const auto& kernels = get_kernels();
+        const auto& candidates = score_precision == ScorePrecision::int16 ? kernels.int16 : kernels.int32;
+        const auto kernel_itr = std::find_if(std::cbegin(candidates), std::cend(candidates),
+                                             [=] (const PairHMMKernel& kernel) noexcept { return kernel.band_size >= min_band_size; });
+        if (kernel_itr == std::cend(candidates)) {
+            throw TooLargeBandSizeError {min_band_size, candidates.back().band_size};
+        }
+        kernel_ = std::addressof(*kernel_itr);
+        batched_kernel_ = score_precision == ScorePrecision::int16 ? &kernels.batched_int16 : &kernels.batched_int32;
+        score_precision_ = score_precision;
     }
     
     template <typename OpenPenaltyArrayOrConstant,
@@ -99,9 +88,8 @@ public:
           const ExtendPenaltyArrayOrConstant gap_extend,
           short nuc_prior) const noexcept
     {
-        return boost::apply_visitor([&] (const auto& hmm) noexcept {
-            return hmm.align(truth, target, qualities, truth_len, target_len, gap_open, gap_extend, nuc_prior);
-        }, hmm_);
+        return kernels<OpenPenaltyArrayOrConstant, ExtendPenaltyArrayOrConstant>()
+            .align(truth, target, qualities, truth_len, target_len, gap_open, gap_extend, nuc_prior);
     }
     template <typename OpenPenaltyArrayOrConstant,
               typename ExtendPenaltyArrayOrConstant>
@@ -117,9 +105,8 @@ public:
           const ExtendPenaltyArrayOrConstant gap_extend,
           short nuc_prior) const noexcept
     {
-        return boost::apply_visitor([&] (const auto& hmm) noexcept {
-            return hmm.align(truth, target, qualities, truth_len, target_len, snv_mask, snv_prior, gap_open, gap_extend, nuc_prior);
-        }, hmm_);
+        return kernels<OpenPenaltyArrayOrConstant, ExtendPenaltyArrayOrConstant>()
+            .align_with_snv_mask(truth, target, qualities, truth_len, target_len, snv_mask, snv_prior, gap_open, gap_extend, nuc_prior);
     }
     template <typename OpenPenaltyArrayOrConstant,
               typename ExtendPenaltyArrayOrConstant>
@@ -136,9 +123,8 @@ public:
           char* align1,
           char* align2) const noexcept
     {
-        return boost::apply_visitor([&] (const auto& hmm) noexcept {
-            return hmm.align(truth, target, qualities, truth_len, target_len, gap_open, gap_extend, nuc_prior, first_pos, align1, align2);
-        }, hmm_);
+        return kernels<OpenPenaltyArrayOrConstant, ExtendPenaltyArrayOrConstant>()
+            .align_with_traceback(truth, target, qualities, truth_len, target_len, gap_open, gap_extend, nuc_prior, first_pos, align1, align2);
     }
     template <typename OpenPenaltyArrayOrConstant,
               typename ExtendPenaltyArrayOrConstant>
@@ -157,9 +143,8 @@ public:
           char* align1,
           char* align2) const noexcept
     {
-        return boost::apply_visitor([&] (const auto& hmm) noexcept {
-            return hmm.align(truth, target, qualities, truth_len, target_len, snv_mask, snv_prior, gap_open, gap_extend, nuc_prior, first_pos, align1, align2);
-        }, hmm_);
+        return kernels<OpenPenaltyArrayOrConstant, ExtendPenaltyArrayOrConstant>()
+            .align_with_snv_mask_and_traceback(truth, target, qualities, truth_len, target_len, snv_mask, snv_prior, gap_open, gap_extend, nuc_prior, first_pos, align1, align2);
     }
     template <typename OpenPenaltyArrayOrConstant,
               typename ExtendPenaltyArrayOrConstant>
@@ -176,9 +161,8 @@ public:
                           const char* aln2,
                           int& target_mask_size) const noexcept
     {
-        return boost::apply_visitor([&] (const auto& hmm) noexcept {
-            return hmm.calculate_flank_score(truth_len, lhs_flank_len, rhs_flank_len, quals, gap_open, gap_extend, nuc_prior, first_pos, aln1, aln2, target_mask_size);
-        }, hmm_);
+        return kernels<OpenPenaltyArrayOrConstant, ExtendPenaltyArrayOrConstant>()
+            .calculate_flank_score(truth_len, lhs_flank_len, rhs_flank_len, quals, gap_open, gap_extend, nuc_prior, first_pos, aln1, aln2, target_mask_size);
     }
     template <typename OpenPenaltyArrayOrConstant,
               typename ExtendPenaltyArrayOrConstant>
@@ -198,56 +182,42 @@ public:
                           const char* aln2,
                           int& target_mask_size) const noexcept
     {
-        return boost::apply_visitor([&] (const auto& hmm) noexcept {
-            return hmm.calculate_flank_score(truth_len, lhs_flank_len, rhs_flank_len, target, quals, snv_mask, snv_prior, gap_open, gap_extend, nuc_prior, first_pos, aln1, aln2, target_mask_size);
-        }, hmm_);
+        return kernels<OpenPenaltyArrayOrConstant, ExtendPenaltyArrayOrConstant>()
+            .calculate_flank_score_with_snv_mask(truth_len, lhs_flank_len, rhs_flank_len, target, quals, snv_mask, snv_prior, gap_open, gap_extend, nuc_prior, first_pos, aln1, aln2, target_mask_size);
     }
 
-private:
-    using ShortPairHMMs = decltype(detail::make_phmm_tuple<short>(std::make_index_sequence<6>()));
-    using IntPairHMMs   = decltype(detail::make_phmm_tuple<int>(std::make_index_sequence<6>()));
-    using PairHMMs      = decltype(std::tuple_cat(ShortPairHMMs {}, IntPairHMMs {}));
-    
-    using PairHmmVariant = detail::to_variant_t<PairHMMs>;
-    
-    PairHmmVariant hmm_;
-    
-    template <typename Hmms>
-    constexpr static int max_band_size() { return std::tuple_element_t<std::tuple_size<Hmms>::value - 1, Hmms>::band_size(); }
-    
-    template <typename Hmms, std::size_t... Is>
-    PairHmmVariant make_simd_pair_hmm_helper(const int min_band_size, std::index_sequence<Is...>) const
+    // As BatchedPairHMM::align, with the band size of this PairHMM
+    void
+    align(const BatchLane* lanes,
+          const int num_lanes,
+          const int truth_len,
+          const int target_len,
+          const short nuc_prior,
+          int* scores) const noexcept
     {
-        if (min_band_size <= max_band_size<Hmms>()) {
-            PairHmmVariant result {};
-            int unused[] = {((Is == 0 || std::tuple_element_t<(Is > 0 ? Is - 1 : 0), Hmms>::band_size() < min_band_size)
-                            && min_band_size <= std::tuple_element_t<Is, Hmms>::band_size()
-                            ? (result = std::tuple_element_t<Is, Hmms> {}, 0) : 0)...};
-            (void) unused;
-            return result;
-        } else {
-            throw TooLargeBandSizeError {min_band_size, max_band_size<Hmms>()};
-        }
+        batched_kernel_->align(lanes, num_lanes, truth_len, target_len, band_size(), nuc_prior, scores);
     }
-    PairHmmVariant make_simd_pair_hmm(const int min_band_size, const ScorePrecision score_precision) const
+    
+    static int max_band_size(ScorePrecision score_precision)
     {
-        if (score_precision == ScorePrecision::int16) {
-            using Hmms = ShortPairHMMs;
-            return make_simd_pair_hmm_helper<Hmms>(min_band_size, std::make_index_sequence<std::tuple_size<Hmms>::value>());
-        } else {
-            using Hmms = IntPairHMMs;
-            return make_simd_pair_hmm_helper<Hmms>(min_band_size, std::make_index_sequence<std::tuple_size<Hmms>::value>());
-        }
+        const auto& kernels = get_kernels();
+        return (score_precision == ScorePrecision::int16 ? kernels.int16 : kernels.int32).back().band_size;
     }
 
-public:
-    static int max_band_size(ScorePrecision score_precision) noexcept
+private:
+    const PairHMMKernel* kernel_;
+    const BatchedPairHMMKernel* batched_kernel_;
+    ScorePrecision score_precision_;
+    
+    template <typename PenaltyArrayOrConstant>
+    using KernelPenaltyType = std::conditional_t<std::is_pointer<PenaltyArrayOrConstant>::value, PenaltyArray, PenaltyConstant>;
+    
+    template <typename OpenPenaltyArrayOrConstant,
+              typename ExtendPenaltyArrayOrConstant>
+    const auto& kernels() const noexcept
     {
-        if (score_precision == ScorePrecision::int16) {
-            return max_band_size<ShortPairHMMs>();
-        } else {
-            return max_band_size<IntPairHMMs>();
-        }
+        using Kernels = AlignmentKernels<KernelPenaltyType<OpenPenaltyArrayOrConstant>, KernelPenaltyType<ExtendPenaltyArrayOrConstant>>;
+        return std::get<Kernels>(kernel_->alignment);
     }
 };
 
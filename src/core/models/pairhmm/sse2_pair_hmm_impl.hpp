@@ -16,6 +16,9 @@
 #if defined(__SSE2__)
 #include <emmintrin.h>
 #endif // defined(__SSE2__)
+#if defined(__SSE4_1__)
+#include <smmintrin.h> // for the int score type
+#endif // defined(__SSE4_1__)
 #include "utils/array_tricks.hpp"
 
 namespace octopus { namespace hmm { namespace simd {
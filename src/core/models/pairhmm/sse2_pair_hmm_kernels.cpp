@@ -0,0 +1,56 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+// Compiled with the SSE4.1 flags, which the int kernels need, whatever the target architecture is
+
+#include "simd_pair_hmm_kernels.hpp"
+
+#include "sse2_pair_hmm_impl.hpp"
+#include "simd_pair_hmm.hpp"
+#include "batched_pair_hmm.hpp"
+#include "rolling_initializer.hpp"
+#include "simd_pair_hmm_kernel_builder.hpp"
+
+namespace octopus { namespace hmm { namespace simd {
+
+#if defined(SSE2_PHMM) && defined(__SSE4_1__)
+
+namespace {
+
+template <unsigned BandSize, typename ScoreType>
+using SSE2Kernel = PairHMM<SSE2PairHMMInstructionSet<BandSize, ScoreType>, InsertRollingInitializer>;
+
+template <unsigned BandSize> using ShortHMM = SSE2Kernel<BandSize, short>;
+template <unsigned BandSize> using IntHMM   = SSE2Kernel<BandSize, int>;
+
+template <unsigned BandSize> using IsViable = std::true_type;
+
+PairHMMKernelSet make_sse2_kernels() noexcept
+{
+    return {InstructionSet::sse2,
+            detail::make_kernels<ShortHMM, IsViable>(),
+            detail::make_kernels<IntHMM, IsViable>(),
+            detail::make_batched_kernel<BatchedPairHMM<SSE2PairHMMInstructionSet<16 / sizeof(short), short>>>(),
+            detail::make_batched_kernel<BatchedPairHMM<SSE2PairHMMInstructionSet<16 / sizeof(int), int>>>()};
+}
+
+} // namespace
+
+const PairHMMKernelSet* sse2_kernels() noexcept
+{
+    static const PairHMMKernelSet result {make_sse2_kernels()};
+    return &result;
+}
+
+#else
+
+const PairHMMKernelSet* sse2_kernels() noexcept
+{
+    return nullptr;
+}
+
+#endif
+
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
@@ -0,0 +1,348 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef sve_pair_hmm_impl_hpp
+#define sve_pair_hmm_impl_hpp
+
+#if __GNUC__ >= 6
+    #pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+#if defined(__ARM_FEATURE_SVE) && defined(__ARM_FEATURE_SVE_BITS)
+#include <arm_sve.h>
+#endif
+#include "utils/array_tricks.hpp"
+
+namespace octopus { namespace hmm { namespace simd {
+
+/*
+ SVE vectors are sizeless unless the vector length is fixed at compile time (-msve-vector-bits), and
+ sizeless types can't be array elements or class members, so these kernels are compiled for one vector
+ length and must only be used on CPUs with exactly that length. Vectors wider than 512 bits would need
+ batches larger than maxBatchSize.
+ */
+
+#if defined(__ARM_FEATURE_SVE) && defined(__ARM_FEATURE_SVE_BITS) && __ARM_FEATURE_SVE_BITS >= 128 && __ARM_FEATURE_SVE_BITS <= 512
+
+#define SVE_PHMM
+
+typedef svint16_t SVEInt16Block __attribute__((arm_sve_vector_bits(__ARM_FEATURE_SVE_BITS)));
+typedef svint32_t SVEInt32Block __attribute__((arm_sve_vector_bits(__ARM_FEATURE_SVE_BITS)));
+
+constexpr int sveVectorBytes {__ARM_FEATURE_SVE_BITS / 8};
+
+template <unsigned BandSize = 16,
+          typename ScoreTp = short>
+class SVEPairHMMInstructionSet
+{
+    static_assert(std::is_same<ScoreTp, short>::value || std::is_same<ScoreTp, int>::value, "ScoreType not short or int");
+
+    using BlockType = std::conditional_t<std::is_same<ScoreTp, short>::value, SVEInt16Block, SVEInt32Block>;
+
+protected:
+    using ScoreType = ScoreTp;
+
+    constexpr static int word_size = sizeof(ScoreType);
+
+    constexpr static const char* name = "SVE";
+
+private:
+    constexpr static auto block_bytes_       = sizeof(BlockType);
+    constexpr static auto block_words_       = block_bytes_ / word_size;
+    constexpr static std::size_t num_blocks_ = BandSize / block_words_;
+
+    static_assert(BandSize > 0, "BandSize must be positive");
+    static_assert(BandSize % block_words_ == 0, "BandSize must be multiple of block words");
+
+protected:
+    using VectorType = std::array<BlockType, num_blocks_>;
+
+    constexpr static int band_size = num_blocks_ * block_words_;
+
+    static_assert(sizeof(VectorType) / word_size == band_size, "size error");
+
+private:
+    static svbool_t all(short) noexcept { return svptrue_b16(); }
+    static svbool_t all(int) noexcept { return svptrue_b32(); }
+    static svbool_t all() noexcept { return all(ScoreType {}); }
+
+    static BlockType do_vectorise_block(ScoreType x, short) noexcept
+    {
+        return svdup_n_s16(x);
+    }
+    static BlockType do_vectorise_block(ScoreType x, int) noexcept
+    {
+        return svdup_n_s32(x);
+    }
+    static BlockType vectorise_block(ScoreType x) noexcept
+    {
+        return do_vectorise_block(x, ScoreType {});
+    }
+    static BlockType do_load(const ScoreType* values, short) noexcept
+    {
+        return svld1_s16(all(), values);
+    }
+    static BlockType do_load(const ScoreType* values, int) noexcept
+    {
+        return svld1_s32(all(), values);
+    }
+protected:
+    static VectorType vectorise(ScoreType x) noexcept
+    {
+        return make_array<num_blocks_>(vectorise_block(x));
+    }
+    template <typename T>
+    static VectorType vectorise(const T* values) noexcept
+    {
+        // The values may be narrower than ScoreType, so are converted as for the other instruction sets
+        VectorType result;
+        for (std::size_t block {0}; block < num_blocks_; ++block) {
+            ScoreType words[block_words_];
+            std::copy_n(values + block * block_words_, block_words_, words);
+            result[block] = do_load(words, ScoreType {});
+        }
+        return result;
+    }
+private:
+    static BlockType do_insert_first(const BlockType& a, ScoreType x, short) noexcept
+    {
+        return svinsr_n_s16(a, x);
+    }
+    static BlockType do_insert_first(const BlockType& a, ScoreType x, int) noexcept
+    {
+        return svinsr_n_s32(a, x);
+    }
+protected:
+    static VectorType vectorise_zero_set_last(ScoreType x) noexcept
+    {
+        const auto zero = vectorise_block(0);
+        return make_array<num_blocks_>(do_insert_first(zero, x, ScoreType {}), zero);
+    }
+private:
+    static ScoreType do_extract(const BlockType& a, const int index, short) noexcept
+    {
+        return svlasta_s16(svwhilelt_b16_s32(0, index), a);
+    }
+    static ScoreType do_extract(const BlockType& a, const int index, int) noexcept
+    {
+        return svlasta_s32(svwhilelt_b32_s32(0, index), a);
+    }
+protected:
+    static ScoreType _extract(const VectorType& a, const int index) noexcept
+    {
+        assert(index >= 0 && index < band_size);
+        return do_extract(a[index / block_words_], index % block_words_, ScoreType {});
+    }
+    template <int index>
+    static ScoreType _extract(const VectorType& a) noexcept
+    {
+        static_assert(index >= 0 && index < band_size, "index out range");
+        return _extract(a, index);
+    }
+private:
+    static BlockType do_insert(const BlockType& a, ScoreType value, const int index, short) noexcept
+    {
+        return svdup_n_s16_m(a, svcmpeq_n_s16(all(), svindex_s16(0, 1), index), value);
+    }
+    static BlockType do_insert(const BlockType& a, ScoreType value, const int index, int) noexcept
+    {
+        return svdup_n_s32_m(a, svcmpeq_n_s32(all(), svindex_s32(0, 1), index), value);
+    }
+protected:
+    template <typename T>
+    static VectorType _insert(VectorType a, const T& value, const int index) noexcept
+    {
+        assert(index >= 0);
+        if (index < band_size) {
+            auto& block = a[index / block_words_];
+            block = do_insert(block, value, index % block_words_, ScoreType {});
+        }
+        return a;
+    }
+    template <int index, typename T>
+    static VectorType _insert(const VectorType& a, T value) noexcept
+    {
+        static_assert(index >= 0 && index < band_size, "index out range");
+        return _insert(a, value, index);
+    }
+    static VectorType _insert_bottom(const VectorType& a, const ScoreType value) noexcept
+    {
+        return _insert<0>(a, value);
+    }
+    static VectorType _insert_top(const VectorType& a, const ScoreType value) noexcept
+    {
+        return _insert<band_size - 1>(a, value);
+    }
+private:
+    static BlockType do_add(const BlockType& lhs, const BlockType& rhs, short) noexcept
+    {
+        return svadd_s16_x(all(), lhs, rhs);
+    }
+    static BlockType do_add(const BlockType& lhs, const BlockType& rhs, int) noexcept
+    {
+        return svadd_s32_x(all(), lhs, rhs);
+    }
+    static BlockType do_and(const BlockType& lhs, const BlockType& rhs, short) noexcept
+    {
+        return svand_s16_x(all(), lhs, rhs);
+    }
+    static BlockType do_and(const BlockType& lhs, const BlockType& rhs, int) noexcept
+    {
+        return svand_s32_x(all(), lhs, rhs);
+    }
+    // ~lhs & rhs, as _mm_andnot_si128
+    static BlockType do_andnot(const BlockType& lhs, const BlockType& rhs, short) noexcept
+    {
+        return svbic_s16_x(all(), rhs, lhs);
+    }
+    static BlockType do_andnot(const BlockType& lhs, const BlockType& rhs, int) noexcept
+    {
+        return svbic_s32_x(all(), rhs, lhs);
+    }
+    static BlockType do_or(const BlockType& lhs, const BlockType& rhs, short) noexcept
+    {
+        return svorr_s16_x(all(), lhs, rhs);
+    }
+    static BlockType do_or(const BlockType& lhs, const BlockType& rhs, int) noexcept
+    {
+        return svorr_s32_x(all(), lhs, rhs);
+    }
+protected:
+    static VectorType _add(const VectorType& lhs, const VectorType& rhs) noexcept
+    {
+        return transform([] (const auto& lhs, const auto& rhs) noexcept { return do_add(lhs, rhs, ScoreType {}); }, lhs, rhs);
+    }
+    static VectorType _and(const VectorType& lhs, const VectorType& rhs) noexcept
+    {
+        return transform([] (const auto& lhs, const auto& rhs) noexcept { return do_and(lhs, rhs, ScoreType {}); }, lhs, rhs);
+    }
+    static VectorType _andnot(const VectorType& lhs, const VectorType& rhs) noexcept
+    {
+        return transform([] (const auto& lhs, const auto& rhs) noexcept { return do_andnot(lhs, rhs, ScoreType {}); }, lhs, rhs);
+    }
+    static VectorType _or(const VectorType& lhs, const VectorType& rhs) noexcept
+    {
+        return transform([] (const auto& lhs, const auto& rhs) noexcept { return do_or(lhs, rhs, ScoreType {}); }, lhs, rhs);
+    }
+private:
+    // All bits set in equal words, as _mm_cmpeq_epi16
+    static BlockType do_cmpeq(const BlockType& lhs, const BlockType& rhs, short) noexcept
+    {
+        return svdup_n_s16_z(svcmpeq_s16(all(), lhs, rhs), -1);
+    }
+    static BlockType do_cmpeq(const BlockType& lhs, const BlockType& rhs, int) noexcept
+    {
+        return svdup_n_s32_z(svcmpeq_s32(all(), lhs, rhs), -1);
+    }
+protected:
+    static VectorType _cmpeq(const VectorType& lhs, const VectorType& rhs) noexcept
+    {
+        return transform([] (const auto& lhs, const auto& rhs) noexcept { return do_cmpeq(lhs, rhs, ScoreType {}); }, lhs, rhs);
+    }
+private:
+    // The last block_words_ - offset words of lhs followed by the first offset words of rhs
+    template <int offset>
+    static BlockType do_splice(const BlockType& lhs, const BlockType& rhs, short) noexcept
+    {
+        return svext_s16(lhs, rhs, offset);
+    }
+    template <int offset>
+    static BlockType do_splice(const BlockType& lhs, const BlockType& rhs, int) noexcept
+    {
+        return svext_s32(lhs, rhs, offset);
+    }
+protected:
+    static VectorType _left_shift_word(VectorType a) noexcept
+    {
+        adjacent_apply_reverse([] (const auto& lhs, const auto& rhs) noexcept {
+            return do_splice<block_words_ - 1>(lhs, rhs, ScoreType {});
+        }, a, a);
+        std::get<0>(a) = do_splice<block_words_ - 1>(vectorise_block(0), std::get<0>(a), ScoreType {});
+        return a;
+    }
+    static VectorType _right_shift_word(VectorType a) noexcept
+    {
+        adjacent_apply([] (const auto& lhs, const auto& rhs) noexcept {
+            return do_splice<1>(lhs, rhs, ScoreType {});
+        }, a, a);
+        std::get<num_blocks_ - 1>(a) = do_splice<1>(std::get<num_blocks_ - 1>(a), vectorise_block(0), ScoreType {});
+        return a;
+    }
+private:
+    template <int n>
+    static BlockType do_left_shift_bits(const BlockType& a, short) noexcept
+    {
+        return svlsl_n_s16_x(all(), a, n);
+    }
+    template <int n>
+    static BlockType do_left_shift_bits(const BlockType& a, int) noexcept
+    {
+        return svlsl_n_s32_x(all(), a, n);
+    }
+protected:
+    template <int n>
+    static VectorType _left_shift_bits(const VectorType& a) noexcept
+    {
+        return transform([] (const auto& x) noexcept { return do_left_shift_bits<n>(x, ScoreType {}); }, a);
+    }
+private:
+    // Logical shifts, as _mm_srli_epi16
+    template <int n>
+    static BlockType do_right_shift_bits(const BlockType& a, short) noexcept
+    {
+        return svreinterpret_s16_u16(svlsr_n_u16_x(all(), svreinterpret_u16_s16(a), n));
+    }
+    template <int n>
+    static BlockType do_right_shift_bits(const BlockType& a, int) noexcept
+    {
+        return svreinterpret_s32_u32(svlsr_n_u32_x(all(), svreinterpret_u32_s32(a), n));
+    }
+protected:
+    template <int n>
+    static VectorType _right_shift_bits(const VectorType& a) noexcept
+    {
+        return transform([] (const auto& x) noexcept { return do_right_shift_bits<n>(x, ScoreType {}); }, a);
+    }
+private:
+    static BlockType do_min(const BlockType& lhs, const BlockType& rhs, short) noexcept
+    {
+        return svmin_s16_x(all(), lhs, rhs);
+    }
+    static BlockType do_min(const BlockType& lhs, const BlockType& rhs, int) noexcept
+    {
+        return svmin_s32_x(all(), lhs, rhs);
+    }
+protected:
+    static VectorType _min(const VectorType& lhs, const VectorType& rhs) noexcept
+    {
+        return transform([] (const auto& lhs, const auto& rhs) noexcept { return do_min(lhs, rhs, ScoreType {}); }, lhs, rhs);
+    }
+private:
+    static BlockType do_max(const BlockType& lhs, const BlockType& rhs, short) noexcept
+    {
+        return svmax_s16_x(all(), lhs, rhs);
+    }
+    static BlockType do_max(const BlockType& lhs, const BlockType& rhs, int) noexcept
+    {
+        return svmax_s32_x(all(), lhs, rhs);
+    }
+protected:
+    static VectorType _max(const VectorType& lhs, const VectorType& rhs) noexcept
+    {
+        return transform([] (const auto& lhs, const auto& rhs) noexcept { return do_max(lhs, rhs, ScoreType {}); }, lhs, rhs);
+    }
+};
+
+#endif // defined(__ARM_FEATURE_SVE) && defined(__ARM_FEATURE_SVE_BITS)
+
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
+
+#endif
@@ -0,0 +1,74 @@
+// Copyright (c) 2015-2021 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+// Compiled with the SVE flags for one vector length (SVE_VECTOR_BITS) whatever the target architecture is
+
+#include "simd_pair_hmm_kernels.hpp"
+
+#include "sve_pair_hmm_impl.hpp"
+#include "simd_pair_hmm.hpp"
+#include "batched_pair_hmm.hpp"
+#include "rolling_initializer.hpp"
+#include "simd_pair_hmm_kernel_builder.hpp"
+
+#if defined(SVE_PHMM) && defined(__linux__)
+    #include <sys/prctl.h>
+#endif
+
+namespace octopus { namespace hmm { namespace simd {
+
+#if defined(SVE_PHMM) && defined(__linux__) && defined(PR_SVE_GET_VL)
+
+namespace {
+
+template <unsigned BandSize, typename ScoreType>
+using SVEKernel = PairHMM<SVEPairHMMInstructionSet<BandSize, ScoreType>, InsertRollingInitializer>;
+
+template <unsigned BandSize> using ShortHMM = SVEKernel<BandSize, short>;
+template <unsigned BandSize> using IntHMM   = SVEKernel<BandSize, int>;
+
+template <unsigned BandSize, typename ScoreType>
+using IsViable = std::integral_constant<bool, BandSize % (sveVectorBytes / sizeof(ScoreType)) == 0>;
+
+template <unsigned BandSize> using IsViableShort = IsViable<BandSize, short>;
+template <unsigned BandSize> using IsViableInt   = IsViable<BandSize, int>;
+
+// The kernels are only correct on CPUs with the vector length they were compiled for. This doesn't
+// execute any SVE instructions, so is safe on CPUs without SVE (prctl fails).
+bool has_compiled_vector_length() noexcept
+{
+    const auto vector_length = prctl(PR_SVE_GET_VL);
+    return vector_length >= 0 && (vector_length & PR_SVE_VL_LEN_MASK) == sveVectorBytes;
+}
+
+PairHMMKernelSet make_sve_kernels(const PairHMMKernelSet& neon) noexcept
+{
+    return {InstructionSet::sve,
+            detail::make_kernels<ShortHMM, IsViableShort>(neon.int16),
+            detail::make_kernels<IntHMM, IsViableInt>(neon.int32),
+            detail::make_batched_kernel<BatchedPairHMM<SVEPairHMMInstructionSet<sveVectorBytes / sizeof(short), short>>>(),
+            detail::make_batched_kernel<BatchedPairHMM<SVEPairHMMInstructionSet<sveVectorBytes / sizeof(int), int>>>()};
+}
+
+} // namespace
+
+const PairHMMKernelSet* sve_kernels() noexcept
+{
+    const auto neon = neon_kernels();
+    if (!neon || !has_compiled_vector_length()) return nullptr;
+    static const PairHMMKernelSet result {make_sve_kernels(*neon)};
+    return &result;
+}
+
+#else
+
+const PairHMMKernelSet* sve_kernels() noexcept
+{
+    return nullptr;
+}
+
+#endif
+
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
@@ -26,6 +26,8 @@
 #include <cassert>
 
 #include <boost/optional.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
 
 #include "date/tz.h"
 #include "date/ptz.h"
@@ -38,20 +40,28 @@
 #include "containers/mappable_map.hpp"
 #include "io/reference/reference_genome.hpp"
 #include "io/read/read_manager.hpp"
+#include "io/region/shard_manifest.hpp"
+#include "io/region/progress_journal.hpp"
 #include "readpipe/read_pipe_fwd.hpp"
 #include "readpipe/buffered_read_pipe.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/read_stats.hpp"
+#include "utils/repeat_finder.hpp"
 #include "utils/append.hpp"
 #include "config/octopus_vcf.hpp"
 #include "core/callers/caller_factory.hpp"
 #include "core/callers/caller.hpp"
 #include "utils/maths.hpp"
 #include "logging/progress_meter.hpp"
+#include "logging/task_report.hpp"
+#include "logging/performance_counters.hpp"
+#include "logging/allocation_counts.hpp"
+#include "logging/progress_status_writer.hpp"
 #include "logging/logging.hpp"
 #include "logging/error_handler.hpp"
 #include "core/tools/vcf_header_factory.hpp"
 #include "io/variant/vcf.hpp"
+#include "io/variant/columnar_call_writer.hpp"
 #include "utils/timing.hpp"
 #include "exceptions/program_error.hpp"
 #include "exceptions/system_error.hpp"
@@ -61,8 +71,8 @@
 #include "core/tools/bam_realigner.hpp"
 #include "core/tools/indel_profiler.hpp"
 #include "utils/thread_pool.hpp"
-
-#include "timers.hpp" // BENCHMARK
+#include "utils/system_utils.hpp"
+#include "utils/memory_budget.hpp"
 
 namespace octopus {
 
@@ -130,7 +140,9 @@ VcfHeader make_vcf_header(const std::vector<SampleName>& samples,
                           const std::vector<GenomicRegion::ContigName>& contigs,
                           const ReferenceGenome& reference,
                           const CallTypeSet& call_types,
-                          const UserCommandInfo& info)
+                          const UserCommandInfo& info,
+                          const bool may_degrade_calls = false,
+                          const bool site_likelihoods = false)
 {
     auto builder = vcf::make_header_template().set_samples(samples);
     for (const auto& contig : contigs) {
@@ -148,6 +160,12 @@ VcfHeader make_vcf_header(const std::vector<SampleName>& samples,
         factory.register_call_type(type);
     }
     factory.annotate(builder);
+    if (may_degrade_calls) {
+        builder.add_info(vcf::spec::info::degraded, "0", "Flag", "Called with reduced effort as the calling task ran short of time");
+    }
+    if (site_likelihoods) {
+        builder.add_format(vcfspec::format::likelihoods, "G", "Float", "log10-scaled genotype likelihoods");
+    }
     return builder.build_once();
 }
 
@@ -155,10 +173,12 @@ VcfHeader make_vcf_header(const std::vector<SampleName>& samples,
                           const GenomicRegion::ContigName& contig,
                           const ReferenceGenome& reference,
                           const CallTypeSet& call_types,
-                          const UserCommandInfo& info)
+                          const UserCommandInfo& info,
+                          const bool may_degrade_calls = false,
+                          const bool site_likelihoods = false)
 {
     return make_vcf_header(samples, std::vector<GenomicRegion::ContigName> {contig},
-                           reference, call_types, info);
+                           reference, call_types, info, may_degrade_calls, site_likelihoods);
 }
 
 VcfHeader read_vcf_header(const VcfReader::Path& vcf_filename)
@@ -185,28 +205,57 @@ bool has_reads(const GenomicRegion& region, ContigCallingComponents& components)
     return components.read_manager.get().has_reads(components.samples.get(), region);
 }
 
-auto get_call_types(const GenomeCallingComponents& components, const std::vector<ContigName>& contigs)
+auto get_call_types(const CallerFactory& caller_factory, const std::vector<ContigName>& contigs)
 {
     CallTypeSet result {};
     for (const auto& contig : contigs) {
-        const auto tmp_caller = components.caller_factory().make(contig);
+        const auto tmp_caller = caller_factory.make(contig);
         auto caller_call_types = tmp_caller->call_types();
         result.insert(std::begin(caller_call_types), std::end(caller_call_types));
     }
     return result;
 }
 
+auto get_call_types(const GenomeCallingComponents& components, const std::vector<ContigName>& contigs)
+{
+    return get_call_types(components.caller_factory(), contigs);
+}
+
+VcfHeader make_secondary_vcf_header(const GenomeCallingComponents& components,
+                                    const std::vector<ContigName>& contigs,
+                                    const UserCommandInfo& info)
+{
+    assert(components.secondary_caller_factory() && !contigs.empty());
+    const auto& caller_factory = *components.secondary_caller_factory();
+    const auto call_types = get_call_types(caller_factory, contigs);
+    if (components.sites_only() && !apply_csr(components)) {
+        return make_vcf_header({}, contigs, components.reference(), call_types, info);
+    } else {
+        const auto tmp_caller = caller_factory.make(contigs.front());
+        return make_vcf_header(tmp_caller->samples(), contigs, components.reference(), call_types, info);
+    }
+}
+
+bool may_degrade_calls(const GenomeCallingComponents& components) noexcept
+{
+    return static_cast<bool>(components.task_time_budget());
+}
+
 void write_caller_output_header(GenomeCallingComponents& components, const UserCommandInfo& info)
 {
     const auto call_types = get_call_types(components, components.contigs());
     if (components.sites_only() && !apply_csr(components)) {
         components.output() << make_vcf_header({}, components.contigs(), components.reference(),
-                                               call_types, info);
+                                               call_types, info, may_degrade_calls(components));
     } else if (components.filter_request()) {
         components.output() << make_vcf_header(*components.filter_request(), info);
     } else {
         components.output() << make_vcf_header(components.samples(), components.contigs(),
-                                               components.reference(), call_types, info);
+                                               components.reference(), call_types, info, may_degrade_calls(components),
+                                               components.site_likelihoods());
+    }
+    if (components.secondary_output()) {
+        *components.secondary_output() << make_secondary_vcf_header(components, components.contigs(), info);
     }
 }
 
@@ -322,6 +371,9 @@ void log_finish_info(const GenomeCallingComponents& components, const utils::Tim
                      << run_duration;
     const auto output_path = get_final_output_path(components);
     if (output_path) stream(info_log) << "Calls have been written to " << *output_path;
+    if (components.secondary_output() && components.secondary_output()->path()) {
+        stream(info_log) << "Secondary calls have been written to " << *components.secondary_output()->path();
+    }
 }
 
 void write_calls(std::deque<VcfRecord>&& calls, VcfWriter& out)
@@ -427,6 +479,12 @@ bool is_consistent(const std::deque<VcfRecord>& merged_calls)
     return true; // TODO
 }
 
+// Only tasks overlapping a debug region write to the debug and trace logs
+bool should_mute_debug_logs(const GenomicRegion& region, const ContigCallingComponents& components)
+{
+    return components.debug_regions && !components.debug_regions->has_overlapped(region);
+}
+
 void resolve_connecting_calls(std::vector<VcfRecord>& old_connecting_calls,
                               std::deque<VcfRecord>& calls,
                               const ContigCallingComponents& components)
@@ -453,6 +511,7 @@ void resolve_connecting_calls(std::vector<VcfRecord>& old_connecting_calls,
             const auto unresolved_region = encompassing_region(merged_calls);
             merged_calls.clear();
             merged_calls.shrink_to_fit();
+            const logging::ScopedDebugMute debug_mute {should_mute_debug_logs(unresolved_region, components)};
             auto new_calls = components.caller->call(unresolved_region, components.progress_meter);
             // TODO: we need to make sure the new calls don't contain any calls
             // outside the unresolved_region, and also possibly adjust phase regions
@@ -473,7 +532,7 @@ void run_octopus_on_contig(ContigCallingComponents&& components)
     
     const auto window_config = default_window_config;
     
-    std::deque<VcfRecord> calls;
+    std::deque<VcfRecord> calls, secondary_calls;
     std::vector<VcfRecord> connecting_calls {};
     auto input_region = components.regions.front();
     auto subregion    = propose_call_subregion(components, input_region, window_config);
@@ -484,7 +543,14 @@ void run_octopus_on_contig(ContigCallingComponents&& components)
         if (debug_log) stream(*debug_log) << "Processing subregion " << subregion;
         
         try {
-            calls = components.caller->call(subregion, components.progress_meter);
+            const logging::ScopedDebugMute debug_mute {should_mute_debug_logs(subregion, components)};
+            if (components.secondary_caller) {
+                boost::optional<GenomicRegion> unfinished_region {};
+                calls = components.caller->call(subregion, components.progress_meter, boost::none, {}, unfinished_region,
+                                                boost::none, *components.secondary_caller, secondary_calls);
+            } else {
+                calls = components.caller->call(subregion, components.progress_meter);
+            }
         } catch(...) {
             // TODO: which exceptions can we recover from?
             throw;
@@ -505,6 +571,7 @@ void run_octopus_on_contig(ContigCallingComponents&& components)
         buffer_connecting_calls(calls, next_subregion, connecting_calls);
         try {
             write_calls(std::move(calls), components.output);
+            if (components.secondary_output) write_calls(std::move(secondary_calls), *components.secondary_output);
         } catch(...) {
             // TODO: which exceptions can we recover from?
             throw;
@@ -515,17 +582,12 @@ void run_octopus_on_contig(ContigCallingComponents&& components)
 
 void run_octopus_single_threaded(GenomeCallingComponents& components)
 {
-    #ifdef BENCHMARK
-    init_timers();
-    #endif
     components.progress_meter().start();
+    components.progress_meter().set_task_counts(1, 0);
     for (const auto& contig : components.contigs()) {
         run_octopus_on_contig(ContigCallingComponents {contig, components});
     }
     components.progress_meter().stop();
-    #ifdef BENCHMARK
-        print_all_timers();
-    #endif
 }
 
 bool can_use_temp_bcf(const GenomicRegion& region)
@@ -536,12 +598,13 @@ bool can_use_temp_bcf(const GenomicRegion& region)
 }
 
 auto create_unique_temp_output_file_path(const GenomicRegion& region,
-                                         const GenomeCallingComponents& components)
+                                         const GenomeCallingComponents& components,
+                                         const std::string& tag = {})
 {
     auto result = *components.temp_directory();
     const auto begin   = std::to_string(region.begin());
     const auto end     = std::to_string(region.end());
-    boost::filesystem::path file_name {region.contig_name() + "_" + begin + "-" + end + "_temp"};
+    boost::filesystem::path file_name {region.contig_name() + "_" + begin + "-" + end + "_temp" + tag};
     
     // Hack for htslib ':' parsing issues
     if (can_use_temp_bcf(region)) {
@@ -554,25 +617,143 @@ auto create_unique_temp_output_file_path(const GenomicRegion& region,
     return result;
 }
 
+// The header lists all of contigs, but the call types are taken from the first, as all the contigs
+// of a temporary file have the same ploidies and so the same caller
+VcfHeader make_temp_vcf_header(const GenomeCallingComponents& components, const std::vector<ContigName>& contigs)
+{
+    const auto call_types = get_call_types(components, {contigs.front()});
+    return make_vcf_header(components.samples(), contigs, components.reference(), call_types, {"octopus-internal", ""},
+                           may_degrade_calls(components), components.site_likelihoods());
+}
+
 VcfHeader make_temp_vcf_header(const GenomeCallingComponents& components, const GenomicRegion& region)
 {
-    const auto call_types = get_call_types(components, {region.contig_name()});
-    return make_vcf_header(components.samples(), region.contig_name(), components.reference(), call_types, {"octopus-internal", ""});
+    return make_temp_vcf_header(components, std::vector<ContigName> {region.contig_name()});
+}
+
+VcfWriter create_unique_temp_output_file(const GenomicRegion& region, const GenomeCallingComponents& components,
+                                         const std::string& tag = {})
+{
+    // Temporary files share the compression threads of the output
+    return {create_unique_temp_output_file_path(region, components, tag), make_temp_vcf_header(components, region),
+            components.output().encoding_context()};
+}
+
+VcfWriter create_unique_temp_output_file(const GenomicRegion::ContigName& contig, const GenomeCallingComponents& components,
+                                         const std::string& tag = {})
+{
+    return create_unique_temp_output_file(components.reference().contig_region(contig), components, tag);
+}
+
+struct ContigBatchConfig
+{
+    GenomicRegion::Size max_contig_size = 100'000;
+    GenomicRegion::Size max_batch_search_size = 1'000'000;
+    std::size_t max_batch_contigs = 1'000;
+};
+
+static const ContigBatchConfig default_contig_batch_config {};
+
+// Assemblies often have thousands of tiny contigs (unplaced scaffolds, decoys, viral sequences), which
+// would otherwise each get their own task, caller, and temporary file. Runs of consecutive tiny contigs
+// are instead batched: each batch is called by a single task, and written to a single temporary file,
+// led by the first contig of the batch. As the contigs of a batch are consecutive, merging the temporary
+// files keeps the output in contig order. Every contig not in a batch leads a batch of its own.
+class ContigBatches
+{
+public:
+    ContigBatches() = delete;
+    
+    ContigBatches(const GenomeCallingComponents& components, const ContigBatchConfig& config = default_contig_batch_config);
+    
+    ContigBatches(const ContigBatches&)            = default;
+    ContigBatches& operator=(const ContigBatches&) = default;
+    ContigBatches(ContigBatches&&)                 = default;
+    ContigBatches& operator=(ContigBatches&&)      = default;
+    
+    ~ContigBatches() = default;
+    
+    const std::vector<ContigName>& leads() const noexcept;
+    const ContigName& lead(const ContigName& contig) const;
+    // The contigs of the batch led by lead, in contig order
+    const std::vector<ContigName>& batch(const ContigName& lead) const;
+    std::size_t num_batched_contigs() const noexcept;
+    
+private:
+    std::vector<ContigName> leads_;
+    std::unordered_map<ContigName, ContigName> contig_leads_;
+    std::unordered_map<ContigName, std::vector<ContigName>> batches_;
+};
+
+bool has_same_ploidies(const ContigName& lhs, const ContigName& rhs, const GenomeCallingComponents& components)
+{
+    return get_ploidies(components.samples(), lhs, components.ploidies())
+           == get_ploidies(components.samples(), rhs, components.ploidies());
+}
+
+GenomicRegion::Size search_size(const ContigName& contig, const GenomeCallingComponents& components)
+{
+    const auto itr = components.search_regions().find(contig);
+    return itr != std::cend(components.search_regions()) ? sum_region_sizes(itr->second) : 0;
+}
+
+ContigBatches::ContigBatches(const GenomeCallingComponents& components, const ContigBatchConfig& config)
+: leads_ {}
+, contig_leads_ {}
+, batches_ {}
+{
+    // Tasks overlapping debug regions are identified by their first region, so don't batch if these are restricted
+    const bool can_batch {components.debug_regions().empty()};
+    const auto is_batchable = [&] (const ContigName& contig) {
+        // Batched contigs are written to one BCF file, so must be parsable by htslib
+        return can_batch && components.reference().contig_size(contig) <= config.max_contig_size
+               && can_use_temp_bcf(components.reference().contig_region(contig))
+               && (components.bad_regions().count(contig) == 0 || components.bad_regions().at(contig).empty());
+    };
+    const auto& contigs = components.contigs();
+    for (auto itr = std::cbegin(contigs); itr != std::cend(contigs);) {
+        const auto& lead = *itr;
+        std::vector<ContigName> batch {lead};
+        ++itr;
+        if (is_batchable(lead)) {
+            auto batch_search_size = search_size(lead, components);
+            for (; itr != std::cend(contigs) && batch.size() < config.max_batch_contigs; ++itr) {
+                if (!is_batchable(*itr) || !has_same_ploidies(lead, *itr, components)) break;
+                const auto contig_search_size = search_size(*itr, components);
+                if (batch_search_size + contig_search_size > config.max_batch_search_size) break;
+                batch_search_size += contig_search_size;
+                batch.push_back(*itr);
+            }
+        }
+        for (const auto& contig : batch) contig_leads_.emplace(contig, lead);
+        batches_.emplace(lead, std::move(batch));
+        leads_.push_back(lead);
+    }
+}
+
+const std::vector<ContigName>& ContigBatches::leads() const noexcept
+{
+    return leads_;
 }
 
-VcfWriter create_unique_temp_output_file(const GenomicRegion& region, const GenomeCallingComponents& components)
+const ContigName& ContigBatches::lead(const ContigName& contig) const
 {
-    return {create_unique_temp_output_file_path(region, components), make_temp_vcf_header(components, region)};
+    return contig_leads_.at(contig);
 }
 
-VcfWriter create_unique_temp_output_file(const GenomicRegion::ContigName& contig, const GenomeCallingComponents& components)
+const std::vector<ContigName>& ContigBatches::batch(const ContigName& lead) const
 {
-    return create_unique_temp_output_file(components.reference().contig_region(contig), components);
+    return batches_.at(lead);
+}
+
+std::size_t ContigBatches::num_batched_contigs() const noexcept
+{
+    return contig_leads_.size() - leads_.size();
 }
 
 using TempVcfWriterMap = std::unordered_map<ContigName, VcfWriter>;
 
-TempVcfWriterMap make_temp_vcf_writers(const GenomeCallingComponents& components)
+TempVcfWriterMap make_temp_vcf_writers(const GenomeCallingComponents& components, const std::string& tag = {})
 {
     if (!components.temp_directory()) {
         throw std::runtime_error {"Could not make temp writers"};
@@ -580,28 +761,288 @@ TempVcfWriterMap make_temp_vcf_writers(const GenomeCallingComponents& components
     TempVcfWriterMap result {};
     result.reserve(components.contigs().size());
     for (const auto& contig : components.contigs()) {
-        auto contig_writer = create_unique_temp_output_file(contig, components);
+        auto contig_writer = create_unique_temp_output_file(contig, components, tag);
         contig_writer.close();
         result.emplace(contig, std::move(contig_writer));
     }
     return result;
 }
 
+// One writer for each batch, keyed by the batch lead
+TempVcfWriterMap make_temp_vcf_writers(const GenomeCallingComponents& components, const ContigBatches& batches,
+                                       const std::string& tag = {})
+{
+    if (!components.temp_directory()) {
+        throw std::runtime_error {"Could not make temp writers"};
+    }
+    TempVcfWriterMap result {};
+    result.reserve(batches.leads().size());
+    for (const auto& lead : batches.leads()) {
+        VcfWriter batch_writer {create_unique_temp_output_file_path(components.reference().contig_region(lead), components, tag),
+                                make_temp_vcf_header(components, batches.batch(lead)),
+                                components.output().encoding_context()};
+        batch_writer.close();
+        result.emplace(lead, std::move(batch_writer));
+    }
+    return result;
+}
+
+TempVcfWriterMap make_secondary_temp_vcf_writers(const GenomeCallingComponents& components, const ContigBatches& batches)
+{
+    if (!components.temp_directory()) {
+        throw std::runtime_error {"Could not make temp writers"};
+    }
+    TempVcfWriterMap result {};
+    result.reserve(batches.leads().size());
+    for (const auto& lead : batches.leads()) {
+        VcfWriter batch_writer {create_unique_temp_output_file_path(components.reference().contig_region(lead), components, "_secondary"),
+                                make_secondary_vcf_header(components, batches.batch(lead), {"octopus-internal", ""}),
+                                components.output().encoding_context()};
+        batch_writer.close();
+        result.emplace(lead, std::move(batch_writer));
+    }
+    return result;
+}
+
+boost::filesystem::path get_progress_journal_path(const GenomeCallingComponents& components)
+{
+    return *components.temp_directory() / "progress.journal";
+}
+
+// Each attempt of a resumed run writes new temporary files so the calls of earlier attempts are kept
+std::string make_temp_file_tag(const GenomeCallingComponents& components)
+{
+    if (!components.resume_requested()) return {};
+    const auto& contigs = components.contigs();
+    for (unsigned attempt {2};; ++attempt) {
+        auto result = "_" + std::to_string(attempt);
+        const auto is_used = [&] (const ContigName& contig) {
+            return boost::filesystem::exists(create_unique_temp_output_file_path(components.reference().contig_region(contig), components, result)); };
+        if (std::none_of(std::cbegin(contigs), std::cend(contigs), is_used)) return result;
+    }
+}
+
+class UnresumableCalls : public SystemError
+{
+    std::string do_where() const override { return "load_resumed_calls"; }
+    std::string do_why() const override
+    {
+        std::ostringstream ss {};
+        ss << "The temporary calls file " << file_ << " recorded in the progress journal is missing or truncated";
+        return ss.str();
+    }
+    std::string do_help() const override { return "Remove the temporary directory and restart the run without --resume"; }
+    boost::filesystem::path file_;
+public:
+    UnresumableCalls(boost::filesystem::path file) : file_ {std::move(file)} {}
+};
+
+using CompletedContigMap = std::unordered_map<ContigName, GenomicRegion::Position>;
+
+// The last task of a contig written by earlier attempts of a resumed run
+struct ResumedTask
+{
+    GenomicRegion region;
+    std::deque<VcfRecord> calls;
+};
+
+// The calls made by earlier attempts of a resumed run. Every search region before the completed
+// position of a contig has been called and written to one of the calls files, except for the calls
+// of the last task of each contig, which are kept apart so they can be resolved against the calls
+// of the next task.
+struct ResumedCalls
+{
+    CompletedContigMap completed = {};
+    std::vector<boost::filesystem::path> calls_files = {};
+    std::unordered_map<ContigName, ResumedTask> last_tasks = {};
+};
+
+struct ResumedRecords
+{
+    std::size_t first, last;
+    boost::optional<ContigName> resumed_task;
+};
+
+using ResumedRecordMap = std::map<boost::filesystem::path, std::vector<ResumedRecords>>;
+
+// Copies the calls file without the records of last tasks, which are moved to the resumed tasks. The
+// calls files of earlier attempts are left untouched so they can be resumed again.
+boost::filesystem::path remove_last_tasks(const boost::filesystem::path& calls_file,
+                                          const std::vector<ResumedRecords>& removed,
+                                          ResumedCalls& resumed)
+{
+    auto result = calls_file.parent_path() / ("resumed_" + calls_file.filename().string());
+    const VcfReader src {calls_file};
+    VcfWriter dst {result, src.fetch_header()};
+    std::size_t record_index {0};
+    for (auto records = src.iterate(); records.first != records.second; ++records.first, ++record_index) {
+        const auto range = std::find_if(std::cbegin(removed), std::cend(removed), [=] (const ResumedRecords& range) {
+            return range.first <= record_index && record_index < range.last; });
+        if (range == std::cend(removed)) {
+            dst << *records.first;
+        } else if (range->resumed_task) {
+            resumed.last_tasks.at(*range->resumed_task).calls.push_back(*records.first);
+        }
+    }
+    const auto is_missing = [=] (const ResumedRecords& range) { return range.last > record_index; };
+    if (std::any_of(std::cbegin(removed), std::cend(removed), is_missing)) {
+        throw UnresumableCalls {calls_file};
+    }
+    return result;
+}
+
+ResumedCalls load_resumed_calls(const GenomeCallingComponents& components)
+{
+    ResumedCalls result {};
+    const auto journal_path = get_progress_journal_path(components);
+    if (!components.resume_requested() || !boost::filesystem::exists(journal_path)) return result;
+    const auto entries = io::read_progress_journal(journal_path, components.reference());
+    // A calls file holding several contigs has an entry for each, and the largest size covers them all
+    std::map<boost::filesystem::path, std::uintmax_t> recorded_sizes {};
+    std::unordered_map<ContigName, const io::ProgressJournalEntry*> latest_entries {};
+    for (const auto& entry : entries) {
+        auto& recorded_size = recorded_sizes[entry.calls_file];
+        recorded_size = std::max(recorded_size, entry.calls_file_size);
+        auto& completed = result.completed[entry.completed.contig_name()];
+        completed = std::max(completed, entry.completed.end());
+        latest_entries[entry.completed.contig_name()] = std::addressof(entry);
+    }
+    // The last task of each contig in the latest entry is resumed. The last tasks of earlier entries were
+    // resumed by a later attempt, which wrote them again, so are dropped.
+    ResumedRecordMap removed_records {};
+    for (const auto& entry : entries) {
+        if (!entry.last_task || entry.last_task->num_records == 0) continue;
+        const auto& contig = entry.completed.contig_name();
+        ResumedRecords records {entry.last_task->first_record, entry.last_task->first_record + entry.last_task->num_records};
+        if (latest_entries.at(contig) == std::addressof(entry)) {
+            records.resumed_task = contig;
+            result.last_tasks.emplace(contig, ResumedTask {entry.last_task->region, {}});
+        }
+        removed_records[entry.calls_file].push_back(std::move(records));
+    }
+    for (const auto& p : recorded_sizes) {
+        boost::system::error_code ec {};
+        const auto calls_file_size = boost::filesystem::file_size(p.first, ec);
+        if (ec || calls_file_size < p.second) {
+            throw UnresumableCalls {p.first};
+        }
+        // Anything after the recorded size was written after the last sync and may be incomplete
+        if (calls_file_size > p.second) {
+            boost::filesystem::resize_file(p.first, p.second);
+        }
+        const auto removed = removed_records.find(p.first);
+        if (removed != std::cend(removed_records)) {
+            result.calls_files.push_back(remove_last_tasks(p.first, removed->second, result));
+        } else {
+            result.calls_files.push_back(p.first);
+        }
+    }
+    return result;
+}
+
+// Removes the parts of the regions called by earlier attempts of a resumed run
+void remove_completed(InputRegionMap::mapped_type& regions, const GenomicRegion::Position completed)
+{
+    std::vector<GenomicRegion> remaining {};
+    remaining.reserve(regions.size());
+    for (const auto& region : regions) {
+        if (region.end() <= completed) continue;
+        if (region.begin() < completed) {
+            remaining.emplace_back(region.contig_name(), completed, region.end());
+        } else {
+            remaining.push_back(region);
+        }
+    }
+    regions = InputRegionMap::mapped_type {std::make_move_iterator(std::begin(remaining)), std::make_move_iterator(std::end(remaining))};
+}
+
+void log_resumed_progress(const ResumedCalls& resumed, GenomeCallingComponents& components)
+{
+    if (resumed.completed.empty()) return;
+    GenomicRegion::Size completed_size {0};
+    for (const auto& p : resumed.completed) {
+        if (components.search_regions().count(p.first) == 0) continue;
+        for (const auto& region : components.search_regions().at(p.first)) {
+            if (region.begin() >= p.second) break;
+            const GenomicRegion completed_region {p.first, region.begin(), std::min(region.end(), p.second)};
+            completed_size += size(completed_region);
+            components.progress_meter().log_completed(completed_region);
+        }
+    }
+    logging::InfoLogger log {};
+    stream(log) << "Resuming with " << utils::format_with_commas(completed_size) << "bp already called in "
+                << resumed.calls_files.size() << " temporary files";
+}
+
 struct Task : public Mappable<Task>
 {
+    using Cost = double;
+    
     GenomicRegion region;
     ExecutionPolicy policy;
+    Cost cost;
+    std::vector<GenomicRegion> batch; // further regions called after region, for a task of a contig batch
     
     Task() = delete;
     
-    Task(GenomicRegion region, ExecutionPolicy policy = ExecutionPolicy::seq)
+    Task(GenomicRegion region, ExecutionPolicy policy = ExecutionPolicy::seq, Cost cost = 0)
     : region {std::move(region)}
     , policy {policy}
+    , cost {cost}
+    , batch {}
     {};
     
     const GenomicRegion& mapped_region() const noexcept { return region; }
 };
 
+struct TaskCostModelConfig
+{
+    unsigned max_samples = 8;
+    GenomicRegion::Size sample_size = 2'000;
+    double repeat_weight = 4.0;
+};
+
+static const TaskCostModelConfig default_task_cost_model_config {};
+
+// Estimates the relative cost of calling region from evenly spaced sample windows. Calling time
+// scales with the number of reads, and is inflated in repetitive sequence where there are more
+// candidates and haplotypes.
+Task::Cost estimate_cost(const GenomicRegion& region, const ContigCallingComponents& components,
+                         const TaskCostModelConfig& config = default_task_cost_model_config)
+{
+    if (is_empty(region)) return 0;
+    const auto num_samples = std::max(std::min(static_cast<GenomicRegion::Size>(config.max_samples),
+                                               size(region) / config.sample_size), GenomicRegion::Size {1});
+    const auto sample_size = std::min(size(region), config.sample_size);
+    const auto sample_stride = size(region) / num_samples;
+    std::size_t num_sampled_reads {0};
+    GenomicRegion::Size num_sampled_bases {0}, num_sampled_repeat_bases {0};
+    for (GenomicRegion::Size i {0}; i < num_samples; ++i) {
+        const auto sample_begin = region.begin() + i * sample_stride;
+        const GenomicRegion sample_region {region.contig_name(), sample_begin, sample_begin + sample_size};
+        num_sampled_reads += components.read_manager.get().estimate_read_count(components.samples, sample_region);
+        num_sampled_repeat_bases += sum_region_sizes(find_repeat_regions(components.reference, sample_region));
+        num_sampled_bases += sample_size;
+    }
+    const auto read_density = static_cast<double>(num_sampled_reads) / num_sampled_bases;
+    const auto repeat_density = static_cast<double>(num_sampled_repeat_bases) / num_sampled_bases;
+    return size(region) * (1 + read_density) * (1 + config.repeat_weight * repeat_density);
+}
+
+struct TaskCostLess
+{
+    bool operator()(const Task& lhs, const Task& rhs) const noexcept
+    {
+        if (lhs.cost != rhs.cost) return lhs.cost < rhs.cost;
+        // Prefer the earlier task on ties; regions on different contigs are not comparable
+        if (!is_same_contig(lhs, rhs)) return rhs.region.contig_name() < lhs.region.contig_name();
+        return rhs.region < lhs.region;
+    }
+};
+
+// Tasks ready for execution are dispatched longest-processing-time first
+using ReadyTaskQueue = std::priority_queue<Task, std::vector<Task>, TaskCostLess>;
+
 std::ostream& operator<<(std::ostream& os, const Task& task)
 {
     os << task.region;
@@ -629,7 +1070,7 @@ private:
     std::vector<ContigName> contigs_;
 };
 
-using TaskQueue = std::queue<Task>;
+using TaskQueue = std::deque<Task>;
 using TaskMap   = std::map<ContigName, TaskQueue, ContigOrder>;
 
 auto count_tasks(const TaskMap& tasks) noexcept
@@ -649,8 +1090,15 @@ struct TaskMakerSyncPacket
     std::atomic_uint num_tasks;
     std::unordered_map<ContigName, bool> finished;
     std::atomic_bool all_done;
+    std::function<void()> on_new_tasks = {}; // Called by task maker after new tasks are made available
 };
 
+void notify_new_tasks(TaskMakerSyncPacket& sync)
+{
+    sync.cv.notify_one();
+    if (sync.on_new_tasks) sync.on_new_tasks();
+}
+
 void make_region_tasks(const GenomicRegion& region,
                        const ContigCallingComponents& components,
                        const ExecutionPolicy policy,
@@ -663,24 +1111,25 @@ void make_region_tasks(const GenomicRegion& region,
     std::unique_lock<std::mutex> lock {sync.mutex, std::defer_lock};
     auto subregion = propose_call_subregion(components, region, window_config);
     if (ends_equal(subregion, region)) {
+        const auto cost = estimate_cost(subregion, components);
         lock.lock();
         sync.cv.wait(lock, [&] () { return sync.ready; });
-        result.emplace(std::move(subregion), policy);
+        result.emplace_back(std::move(subregion), policy, cost);
         ++sync.num_tasks;
         if (last_region_in_contig) {
             sync.finished.at(region.contig_name()) = true;
             if (last_contig) sync.all_done = true;
         }
         lock.unlock();
-        sync.cv.notify_one();
+        notify_new_tasks(sync);
     } else {
-        std::deque<GenomicRegion> batch {};
-        batch.push_back(subregion);
+        std::deque<Task> batch {};
+        batch.emplace_back(subregion, policy, estimate_cost(subregion, components));
         bool done {false};
         while (true) {
             while (batch.size() < std::max(sync.batch_size_hint.load(), 1u) || !sync.waiting) {
                 subregion = propose_call_subregion(components, subregion, region, window_config);
-                batch.push_back(subregion);
+                batch.emplace_back(subregion, policy, estimate_cost(subregion, components));
                 assert(!ends_before(region, subregion));
                 if (ends_equal(subregion, region)) {
                     done = true;
@@ -691,7 +1140,7 @@ void make_region_tasks(const GenomicRegion& region,
             assert(!lock.owns_lock());
             lock.lock();
             sync.cv.wait(lock, [&] () { return sync.ready; });
-            for (auto&& r : batch) result.emplace(std::move(r), policy);
+            utils::append(std::move(batch), result);
             sync.num_tasks += batch.size();
             if (done) {
                 if (last_region_in_contig) {
@@ -701,17 +1150,52 @@ void make_region_tasks(const GenomicRegion& region,
                     assert(!last_contig);
                 }
                 lock.unlock();
-                sync.cv.notify_one();
+                notify_new_tasks(sync);
                 break;
             } else {
                 batch.clear();
                 lock.unlock();
-                sync.cv.notify_one();
+                notify_new_tasks(sync);
             }
         }
     }
 }
 
+void mark_finished(const ContigName& contig, TaskMap& tasks, TaskMakerSyncPacket& sync, const bool last_contig)
+{
+    std::unique_lock<std::mutex> lock {sync.mutex};
+    sync.cv.wait(lock, [&] () { return sync.ready; });
+    tasks.erase(contig);
+    sync.finished.at(contig) = true;
+    if (last_contig) sync.all_done = true;
+    lock.unlock();
+    notify_new_tasks(sync);
+}
+
+// Bad regions are split from the regions around them so they get their own tasks, and don't hold up the
+// calling of good regions
+auto isolate_bad_regions(const InputRegionMap::mapped_type& regions, const InputRegionMap::mapped_type& bad_regions)
+{
+    if (bad_regions.empty()) return regions;
+    std::vector<GenomicRegion> result {};
+    result.reserve(regions.size() + 2 * bad_regions.size());
+    for (const auto& region : regions) {
+        auto good_begin = region.begin();
+        for (const auto& bad_region : overlap_range(bad_regions, region)) {
+            const auto isolated_region = *overlapped_region(region, bad_region);
+            if (good_begin < isolated_region.begin()) {
+                result.emplace_back(region.contig_name(), good_begin, isolated_region.begin());
+            }
+            if (!is_empty(isolated_region)) result.push_back(isolated_region);
+            good_begin = std::max(good_begin, isolated_region.end());
+        }
+        if (good_begin < region.end()) {
+            result.emplace_back(region.contig_name(), good_begin, region.end());
+        }
+    }
+    return InputRegionMap::mapped_type {std::make_move_iterator(std::begin(result)), std::make_move_iterator(std::end(result))};
+}
+
 void make_contig_tasks(const ContigCallingComponents& components,
                        const ExecutionPolicy policy,
                        TaskQueue& result,
@@ -720,10 +1204,11 @@ void make_contig_tasks(const ContigCallingComponents& components,
                        const WindowConfig& window_config)
 {
     if (components.regions.empty()) return;
-    std::for_each(std::cbegin(components.regions), std::prev(std::cend(components.regions)), [&] (const auto& region) {
+    const auto regions = isolate_bad_regions(components.regions, components.bad_regions);
+    std::for_each(std::cbegin(regions), std::prev(std::cend(regions)), [&] (const auto& region) {
         make_region_tasks(region, components, policy, result, sync, false, last_contig, window_config);
     });
-    make_region_tasks(components.regions.back(), components, policy, result, sync, true, last_contig, window_config);
+    make_region_tasks(regions.back(), components, policy, result, sync, true, last_contig, window_config);
 }
 
 ExecutionPolicy make_execution_policy(const GenomeCallingComponents& components)
@@ -741,22 +1226,80 @@ auto make_contig_components(const ContigName& contig, GenomeCallingComponents& c
     return result;
 }
 
+// All the remaining search regions of a contig batch are called by a single task, scheduled under the batch lead
+void make_batch_task(const std::vector<ContigName>& batch,
+                     GenomeCallingComponents& components,
+                     const unsigned num_threads,
+                     const ExecutionPolicy policy,
+                     const CompletedContigMap& completed,
+                     TaskMap& tasks,
+                     TaskMakerSyncPacket& sync,
+                     const bool last_batch)
+{
+    std::vector<GenomicRegion> regions {};
+    for (const auto& contig : batch) {
+        if (components.search_regions().count(contig) == 0) continue;
+        auto contig_regions = components.search_regions().at(contig);
+        if (completed.count(contig) == 1) {
+            remove_completed(contig_regions, completed.at(contig));
+        }
+        regions.insert(std::cend(regions), std::cbegin(contig_regions), std::cend(contig_regions));
+    }
+    if (regions.empty()) {
+        for (std::size_t i {0}; i < batch.size(); ++i) {
+            mark_finished(batch[i], tasks, sync, last_batch && i == batch.size() - 1);
+        }
+        return;
+    }
+    const auto lead_components = make_contig_components(batch.front(), components, num_threads);
+    Task task {regions.front(), policy};
+    task.batch.assign(std::next(std::cbegin(regions)), std::cend(regions));
+    for (const auto& region : regions) {
+        task.cost += estimate_cost(region, lead_components);
+    }
+    std::unique_lock<std::mutex> lock {sync.mutex};
+    sync.cv.wait(lock, [&] () { return sync.ready; });
+    tasks[batch.front()].push_back(std::move(task));
+    ++sync.num_tasks;
+    for (const auto& contig : batch) {
+        sync.finished.at(contig) = true;
+    }
+    if (last_batch) sync.all_done = true;
+    lock.unlock();
+    notify_new_tasks(sync);
+}
+
 void make_tasks_helper(TaskMap& tasks,
-                       std::vector<ContigName> contigs,
+                       const ContigBatches batches,
                        GenomeCallingComponents& components,
                        const unsigned num_threads,
                        ExecutionPolicy execution_policy,
+                       const CompletedContigMap& completed,
                        TaskMakerSyncPacket& sync)
 {
     const auto window_config = default_window_config;
     try {
         static auto debug_log = get_debug_log();
-        if (debug_log) stream(*debug_log) << "Making tasks for " << contigs.size() << " contigs";
+        const auto& contigs = batches.leads();
+        if (debug_log) stream(*debug_log) << "Making tasks for " << contigs.size() << " contig batches";
         for (std::size_t i {0}; i < contigs.size(); ++i) {
             const auto& contig = contigs[i];
+            const auto& batch = batches.batch(contig);
+            if (batch.size() > 1) {
+                if (debug_log) stream(*debug_log) << "Making task for batch of " << batch.size() << " contigs led by " << contig;
+                make_batch_task(batch, components, num_threads, execution_policy, completed, tasks, sync, i == contigs.size() - 1);
+                continue;
+            }
             if (debug_log) stream(*debug_log) << "Making tasks for contig " << contig;
             auto contig_components = make_contig_components(contig, components, num_threads);
-            make_contig_tasks(contig_components, execution_policy, tasks[contig], sync, i == contigs.size() - 1, window_config);
+            if (completed.count(contig) == 1) {
+                remove_completed(contig_components.regions, completed.at(contig));
+            }
+            if (contig_components.regions.empty()) {
+                mark_finished(contig, tasks, sync, i == contigs.size() - 1);
+            } else {
+                make_contig_tasks(contig_components, execution_policy, tasks[contig], sync, i == contigs.size() - 1, window_config);
+            }
             if (debug_log) stream(*debug_log) << "Finished making tasks for contig " << contig;
         }
         if (debug_log) *debug_log << "Finished making tasks";
@@ -780,10 +1323,12 @@ void make_tasks_helper(TaskMap& tasks,
 std::thread
 make_task_maker_thread(TaskMap& tasks,
                        GenomeCallingComponents& components,
+                       const ContigBatches& batches,
                        const unsigned num_threads,
+                       const CompletedContigMap& completed,
                        TaskMakerSyncPacket& sync)
 {
-    auto contigs = components.contigs();
+    const auto& contigs = components.contigs();
     if (contigs.empty()) {
         sync.all_done = true;
         return std::thread {};
@@ -792,8 +1337,9 @@ make_task_maker_thread(TaskMap& tasks,
     for (const auto& contig : contigs) {
         sync.finished.emplace(contig, false);
     }
-    return std::thread {make_tasks_helper, std::ref(tasks), std::move(contigs), std::ref(components),
-                        num_threads, make_execution_policy(components), std::ref(sync)};
+    // The batches are copied as the thread is detached
+    return std::thread {make_tasks_helper, std::ref(tasks), batches, std::ref(components),
+                        num_threads, make_execution_policy(components), std::cref(completed), std::ref(sync)};
 }
 
 unsigned calculate_num_task_threads(const GenomeCallingComponents& components)
@@ -808,22 +1354,23 @@ unsigned calculate_num_task_threads(const GenomeCallingComponents& components)
     return num_cores;
 }
 
-Task pop(TaskMap& tasks, TaskMakerSyncPacket& sync)
+// Takes all the tasks made so far, in contig then genomic order
+std::deque<Task> pop_all(TaskMap& tasks, TaskMakerSyncPacket& sync)
 {
-    assert(!tasks.empty());
+    std::deque<Task> result {};
     std::unique_lock<std::mutex> lock {sync.mutex};
     sync.ready = false;
-    assert(sync.num_tasks > 0);
-    const auto contig_task_itr = std::begin(tasks);
-    assert(!contig_task_itr->second.empty());
-    const auto result = std::move(contig_task_itr->second.front());
-    contig_task_itr->second.pop();
-    if (sync.finished.at(contig_task_itr->first) && contig_task_itr->second.empty()) {
-        static auto debug_log = get_debug_log();
-        if (debug_log) stream(*debug_log) << "Finished calling contig " << contig_task_itr->first;
-        tasks.erase(contig_task_itr);
+    for (auto contig_task_itr = std::begin(tasks); contig_task_itr != std::end(tasks);) {
+        utils::append(std::move(contig_task_itr->second), result);
+        if (sync.finished.at(contig_task_itr->first)) {
+            static auto debug_log = get_debug_log();
+            if (debug_log) stream(*debug_log) << "Finished making tasks for contig " << contig_task_itr->first;
+            contig_task_itr = tasks.erase(contig_task_itr);
+        } else {
+            ++contig_task_itr;
+        }
     }
-    --sync.num_tasks;
+    sync.num_tasks -= result.size();
     sync.ready = true;
     lock.unlock();
     sync.cv.notify_one();
@@ -832,9 +1379,12 @@ Task pop(TaskMap& tasks, TaskMakerSyncPacket& sync)
 
 struct CompletedTask : public Task
 {
-    CompletedTask(Task task) : Task {std::move(task)}, calls {}, runtime {} {}
+    CompletedTask(Task task) : Task {std::move(task)}, calls {}, secondary_calls {}, runtime {}, unfinished_region {}, telemetry {} {}
     std::deque<VcfRecord> calls;
+    std::deque<VcfRecord> secondary_calls; // empty unless there is a secondary caller
     utils::TimeInterval runtime;
+    boost::optional<GenomicRegion> unfinished_region; // if the task yielded before calling all of region
+    TaskTelemetry telemetry;
 };
 
 std::string duration(const CompletedTask& task)
@@ -850,49 +1400,170 @@ std::ostream& operator<<(std::ostream& os, const CompletedTask& task)
     return os;
 }
 
+using TaskSlot = std::size_t;
+
 struct CallerSyncPacket
 {
-    CallerSyncPacket() : num_finished {0} {}
+    CallerSyncPacket() : num_starving_slots {0} {}
     std::condition_variable cv;
     std::mutex mutex;
-    std::atomic_uint num_finished;
+    std::deque<TaskSlot> finished = {};
+    std::atomic_uint num_starving_slots; // idle slots with no pending tasks to run
 };
 
-template<typename R>
-bool is_ready(const std::future<R>& f)
+struct TaskSplitConfig
 {
-    return f.valid() && f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    std::chrono::seconds min_runtime;
+    GenomicRegion::Size min_unfinished_size;
+};
+
+static const TaskSplitConfig default_task_split_config {std::chrono::minutes {5}, 10'000};
+
+bool claim_starving_slot(CallerSyncPacket& sync) noexcept
+{
+    auto num_starving = sync.num_starving_slots.load();
+    while (num_starving > 0) {
+        if (sync.num_starving_slots.compare_exchange_weak(num_starving, num_starving - 1)) return true;
+    }
+    return false;
 }
 
-auto run(Task task, ContigCallingComponents components, CallerSyncPacket& sync, ThreadPool& workers)
+// A long running task should give up the rest of its region if there are slots with nothing to do
+auto make_yield_predicate(const Task& task, const std::chrono::system_clock::time_point start,
+                          const TaskSplitConfig& config, CallerSyncPacket& sync)
+{
+    return [&task, start, &config, &sync] (const GenomicRegion& completed_region) {
+        return std::chrono::system_clock::now() - start >= config.min_runtime
+               && region_size(right_overhang_region(task.region, completed_region)) >= config.min_unfinished_size
+               && claim_starving_slot(sync);
+    };
+}
+
+void notify_finished(const TaskSlot slot, CallerSyncPacket& sync)
+{
+    std::unique_lock<std::mutex> lock {sync.mutex};
+    sync.finished.push_back(slot);
+    lock.unlock();
+    sync.cv.notify_all();
+}
+
+// The regions of a contig batch are small, so are called in turn without yielding
+void call_batch(const Task& task, const ContigCallingComponents& components, ThreadPool& workers, CompletedTask& result)
+{
+    const Caller::YieldPredicate never_yield {[] (const GenomicRegion&) { return false; }};
+    boost::optional<GenomicRegion> unfinished_region {};
+    const auto call_region = [&] (const GenomicRegion& region) {
+        if (components.secondary_caller) {
+            std::deque<VcfRecord> secondary_calls {};
+            utils::append(components.caller->call(region, components.progress_meter, workers, never_yield,
+                                                  unfinished_region, result.telemetry,
+                                                  *components.secondary_caller, secondary_calls), result.calls);
+            utils::append(std::move(secondary_calls), result.secondary_calls);
+        } else {
+            utils::append(components.caller->call(region, components.progress_meter, workers, never_yield,
+                                                  unfinished_region, result.telemetry), result.calls);
+        }
+    };
+    call_region(task.region);
+    for (const auto& region : task.batch) call_region(region);
+}
+
+auto run(Task task, ContigCallingComponents components, const TaskSlot slot, CallerSyncPacket& sync, ThreadPool& workers,
+         const std::size_t node = 0)
 {
     static auto debug_log = get_debug_log();
     if (debug_log) stream(*debug_log) << "Spawning task " << task;
-    return workers.push([task = std::move(task), components = std::move(components), &sync, &workers] () {
+    return workers.push_to_node(node, [task = std::move(task), components = std::move(components), slot, &sync, &workers] () {
         try {
+            const logging::ScopedDebugMute debug_mute {should_mute_debug_logs(task.region, components)};
             CompletedTask result {task};
             result.runtime.start = std::chrono::system_clock::now();
-            result.calls = components.caller->call(task.region, components.progress_meter, workers);
+            const auto start_cpu_time = get_thread_cpu_time();
+            const auto start_peak_rss = get_peak_rss();
+            const auto start_allocations = allocation::thread_counts();
+            const auto should_yield = make_yield_predicate(task, result.runtime.start, default_task_split_config, sync);
+            if (!task.batch.empty()) {
+                call_batch(task, components, workers, result);
+            } else if (components.secondary_caller) {
+                result.calls = components.caller->call(task.region, components.progress_meter, workers,
+                                                       should_yield, result.unfinished_region, result.telemetry,
+                                                       *components.secondary_caller, result.secondary_calls);
+            } else {
+                result.calls = components.caller->call(task.region, components.progress_meter, workers,
+                                                       should_yield, result.unfinished_region, result.telemetry);
+            }
+            if (result.unfinished_region) {
+                result.region = left_overhang_region(task.region, *result.unfinished_region);
+            }
             result.runtime.end = std::chrono::system_clock::now();
-            std::unique_lock<std::mutex> lock {sync.mutex};
-            ++sync.num_finished;
-            lock.unlock();
-            sync.cv.notify_all();
+            result.telemetry.runtime = result.runtime;
+            result.telemetry.cpu_time = get_thread_cpu_time() - start_cpu_time;
+            result.telemetry.peak_rss_delta = get_peak_rss() - start_peak_rss;
+            result.telemetry.allocations = allocation::thread_counts() - start_allocations;
+            notify_finished(slot, sync);
             return result;
         } catch (const std::exception& e) {
             logging::ErrorLogger error_log {};
             stream(error_log) << "Encountered a problem whilst calling " << task << "(" << e.what() << ")";
             using namespace std::chrono_literals;
             std::this_thread::sleep_for(2s); // Try to make sure the error is logged before raising
-            std::unique_lock<std::mutex> lock {sync.mutex};
-            ++sync.num_finished;
-            lock.unlock();
-            sync.cv.notify_all();
+            notify_finished(slot, sync);
             throw;
         }
     });
 }
 
+// A task whose reads and candidates are being fetched ahead of it being run
+struct PrefetchedTask
+{
+    Task task;
+    std::future<ContigCallingComponents> components;
+};
+
+auto prefetch(Task task, ContigCallingComponents components, ThreadPool& prefetcher)
+{
+    static auto debug_log = get_debug_log();
+    if (debug_log) stream(*debug_log) << "Prefetching task " << task;
+    auto region = task.region;
+    return PrefetchedTask {std::move(task), prefetcher.push([components = std::move(components), region = std::move(region)] () mutable {
+        components.caller->prefetch(region);
+        return std::move(components);
+    })};
+}
+
+std::vector<GenomicRegion> split_evenly(const GenomicRegion& region, std::size_t n)
+{
+    n = std::max(std::min(n, static_cast<std::size_t>(size(region))), std::size_t {1});
+    std::vector<GenomicRegion> result {};
+    result.reserve(n);
+    const auto step = size(region) / n;
+    auto begin = region.begin();
+    for (std::size_t i {0}; i < n; ++i) {
+        const auto end = i + 1 < n ? begin + step : region.end();
+        result.emplace_back(region.contig_name(), begin, end);
+        begin = end;
+    }
+    return result;
+}
+
+// Shrinks the running task that yielded to the region it called, and inserts tasks for
+// the unfinished region directly after it so output order is maintained.
+std::vector<Task> split_running_task(const CompletedTask& task, TaskQueue& running_tasks, const std::size_t num_splits)
+{
+    assert(task.unfinished_region);
+    const auto original_region = encompassing_region(task.region, *task.unfinished_region);
+    const auto itr = std::find_if(std::begin(running_tasks), std::end(running_tasks),
+                                  [&] (const Task& running) { return is_same_region(running, original_region); });
+    assert(itr != std::end(running_tasks));
+    itr->region = task.region;
+    std::vector<Task> result {};
+    for (auto& region : split_evenly(*task.unfinished_region, num_splits)) {
+        result.emplace_back(std::move(region), task.policy);
+    }
+    running_tasks.insert(std::next(itr), std::cbegin(result), std::cend(result));
+    return result;
+}
+
 using CompletedTaskMap = std::map<ContigName, std::map<ContigRegion, CompletedTask>>;
 using HoldbackTask = boost::optional<std::reference_wrapper<const CompletedTask>>;
 
@@ -905,7 +1576,7 @@ auto get_writable_completed_tasks(CompletedTask&& task, CompletedTaskMap::mapped
         if (itr != std::end(buffered_tasks)) {
             result.push_back(std::move(itr->second));
             buffered_tasks.erase(itr);
-            running_tasks.pop();
+            running_tasks.pop_front();
         } else {
             break;
         }
@@ -928,7 +1599,7 @@ auto make_contig_calling_component_factory_map(GenomeCallingComponents& componen
     ContigCallingComponentFactoryMap result {};
     for (const auto& contig : components.contigs()) {
         result.emplace(contig, [&components, contig] () -> ContigCallingComponents
-                       { return ContigCallingComponents {contig, components}; });
+                       { return ContigCallingComponents {contig, components, ContigCallingComponents::TaskScope {}}; });
     }
     return result;
 }
@@ -1014,6 +1685,205 @@ void resolve_connecting_calls(std::deque<CompletedTask>& adjacent_tasks,
                   [&] (auto& rhs) { resolve_connecting_calls(*lhs++, rhs, calling_components); });
 }
 
+auto extract_writers(TempVcfWriterMap&& vcfs)
+{
+    std::vector<VcfWriter> result {};
+    result.reserve(vcfs.size());
+    for (auto&& p : vcfs) {
+        result.push_back(std::move(p.second));
+    }
+    vcfs.clear();
+    return result;
+}
+
+auto extract_as_readers(TempVcfWriterMap&& vcfs)
+{
+    return writers_to_readers(extract_writers(std::move(vcfs)), false);
+}
+
+void merge(TempVcfWriterMap&& temp_vcf_writers, const std::vector<boost::filesystem::path>& resumed_calls,
+           GenomeCallingComponents& components)
+{
+    static auto debug_log = get_debug_log();
+    if (debug_log) stream(*debug_log) << "Merging " << temp_vcf_writers.size() + resumed_calls.size() << " temporary VCF files";
+    auto temp_readers = extract_as_readers(std::move(temp_vcf_writers));
+    for (const auto& calls_file : resumed_calls) {
+        temp_readers.emplace_back(calls_file);
+    }
+    merge(temp_readers, components.output(), components.contigs());
+}
+
+void merge(TempVcfWriterMap&& temp_vcf_writers, GenomeCallingComponents& components)
+{
+    merge(std::move(temp_vcf_writers), {}, components);
+}
+
+void merge_secondary(TempVcfWriterMap&& temp_vcf_writers, GenomeCallingComponents& components)
+{
+    static auto debug_log = get_debug_log();
+    if (debug_log) stream(*debug_log) << "Merging " << temp_vcf_writers.size() << " temporary secondary VCF files";
+    auto temp_readers = extract_as_readers(std::move(temp_vcf_writers));
+    merge(temp_readers, *components.secondary_output(), components.contigs());
+}
+
+MemoryFootprint footprint(const VcfRecord& call) noexcept
+{
+    std::size_t result {sizeof(VcfRecord) + call.ref().size()};
+    for (const auto& allele : call.alt()) result += sizeof(allele) + allele.size();
+    // Info and sample values are mostly short strings so are counted at a fixed size
+    result += (call.info_keys().size() + call.num_samples() * call.format().size()) * 64;
+    return result;
+}
+
+MemoryFootprint footprint(const std::deque<VcfRecord>& calls) noexcept
+{
+    return std::accumulate(std::cbegin(calls), std::cend(calls), MemoryFootprint {0},
+                           [] (auto curr, const auto& call) noexcept { return curr + footprint(call); });
+}
+
+// The calls of written tasks are kept in memory, and written straight to the output in contig order once
+// calling has finished, until their footprint exceeds the in-memory limit. They are then spilled to
+// per-batch temporary files, which are merged into the output as usual. This avoids temporary files
+// entirely for small call sets (e.g. panels and exomes). Tasks are written under their batch lead.
+class CompletedTaskCalls
+{
+public:
+    CompletedTaskCalls() = delete;
+    
+    CompletedTaskCalls(GenomeCallingComponents& components, const ContigBatches& batches, std::string temp_file_tag,
+                       boost::optional<io::ProgressJournal&> journal = boost::none);
+    
+    CompletedTaskCalls(const CompletedTaskCalls&)            = delete;
+    CompletedTaskCalls& operator=(const CompletedTaskCalls&) = delete;
+    CompletedTaskCalls(CompletedTaskCalls&&)                 = delete;
+    CompletedTaskCalls& operator=(CompletedTaskCalls&&)      = delete;
+    
+    ~CompletedTaskCalls() = default;
+    
+    // Tasks of each batch must be written in order
+    void write(CompletedTask&& task);
+    // Records the regions written so far in the progress journal, once calls are in temporary files
+    void record_progress();
+    void write_to_output(const std::vector<boost::filesystem::path>& resumed_calls);
+    
+private:
+    using ContigCallMap = std::unordered_map<ContigName, std::deque<VcfRecord>>;
+    
+    GenomeCallingComponents& components_;
+    const ContigBatches& batches_;
+    std::string temp_file_tag_;
+    boost::optional<io::ProgressJournal&> journal_;
+    MemoryFootprint max_footprint_, footprint_;
+    ContigCallMap calls_, secondary_calls_;
+    boost::optional<TempVcfWriterMap> temp_writers_, secondary_temp_writers_;
+    std::map<ContigName, GenomicRegion::Position> unrecorded_ends_;
+    std::unordered_map<ContigName, std::size_t> num_records_;
+    std::map<ContigName, io::ProgressJournalEntry::TaskRecords> unrecorded_last_tasks_;
+    
+    void spill();
+};
+
+CompletedTaskCalls::CompletedTaskCalls(GenomeCallingComponents& components, const ContigBatches& batches,
+                                       std::string temp_file_tag, boost::optional<io::ProgressJournal&> journal)
+: components_ {components}
+, batches_ {batches}
+, temp_file_tag_ {std::move(temp_file_tag)}
+, journal_ {journal}
+, max_footprint_ {components.max_in_memory_calls_footprint()}
+, footprint_ {0}
+, calls_ {}
+, secondary_calls_ {}
+, temp_writers_ {}
+, secondary_temp_writers_ {}
+, unrecorded_ends_ {}
+, num_records_ {}
+, unrecorded_last_tasks_ {}
+{
+    if (max_footprint_.bytes() == 0) spill();
+}
+
+void CompletedTaskCalls::write(CompletedTask&& task)
+{
+    const auto& contig = contig_name(task);
+    const auto record_written = [this] (const GenomicRegion& region) {
+        auto& written_end = unrecorded_ends_[region.contig_name()];
+        written_end = std::max(written_end, region.end());
+    };
+    record_written(task.region);
+    for (const auto& region : task.batch) record_written(region);
+    // Records are counted as written even while in memory, as they are spilled in the same order
+    auto& num_records = num_records_[contig];
+    unrecorded_last_tasks_.erase(contig);
+    if (task.batch.empty()) {
+        unrecorded_last_tasks_.emplace(contig, io::ProgressJournalEntry::TaskRecords {task.region, num_records, task.calls.size()});
+    }
+    num_records += task.calls.size();
+    if (temp_writers_) {
+        write_calls(std::move(task.calls), temp_writers_->at(contig));
+        if (secondary_temp_writers_) write_calls(std::move(task.secondary_calls), secondary_temp_writers_->at(contig));
+    } else {
+        footprint_ += footprint(task.calls);
+        utils::append(std::move(task.calls), calls_[contig]);
+        if (components_.secondary_output()) {
+            footprint_ += footprint(task.secondary_calls);
+            utils::append(std::move(task.secondary_calls), secondary_calls_[contig]);
+        }
+        if (max_footprint_ < footprint_) spill();
+    }
+}
+
+void CompletedTaskCalls::record_progress()
+{
+    if (!journal_ || !temp_writers_) return;
+    for (const auto& p : unrecorded_ends_) {
+        boost::optional<io::ProgressJournalEntry::TaskRecords> last_task {};
+        const auto itr = unrecorded_last_tasks_.find(p.first);
+        if (itr != std::cend(unrecorded_last_tasks_)) last_task = itr->second;
+        journal_->record(*temp_writers_->at(batches_.lead(p.first)).path(), GenomicRegion {p.first, 0, p.second}, last_task);
+    }
+    unrecorded_ends_.clear();
+    unrecorded_last_tasks_.clear();
+}
+
+void CompletedTaskCalls::write_to_output(const std::vector<boost::filesystem::path>& resumed_calls)
+{
+    static auto debug_log = get_debug_log();
+    // Calls from earlier attempts are in temporary files so must be merged
+    if (!temp_writers_ && !resumed_calls.empty()) spill();
+    if (temp_writers_) {
+        merge(std::move(*temp_writers_), resumed_calls, components_);
+        if (secondary_temp_writers_) merge_secondary(std::move(*secondary_temp_writers_), components_);
+    } else {
+        if (debug_log) stream(*debug_log) << "Writing " << footprint_ << " of in-memory calls to output";
+        for (const auto& contig : components_.contigs()) {
+            auto itr = calls_.find(contig);
+            if (itr != std::end(calls_)) write_calls(std::move(itr->second), components_.output());
+            itr = secondary_calls_.find(contig);
+            if (itr != std::end(secondary_calls_)) write_calls(std::move(itr->second), *components_.secondary_output());
+        }
+        calls_.clear();
+        secondary_calls_.clear();
+        footprint_ = 0;
+    }
+}
+
+// private methods
+
+void CompletedTaskCalls::spill()
+{
+    static auto debug_log = get_debug_log();
+    if (debug_log && footprint_.bytes() > 0) {
+        stream(*debug_log) << "Writing " << footprint_ << " of in-memory calls to temporary files";
+    }
+    temp_writers_ = make_temp_vcf_writers(components_, batches_, temp_file_tag_);
+    if (components_.secondary_output()) secondary_temp_writers_ = make_secondary_temp_vcf_writers(components_, batches_);
+    for (auto& p : calls_) write_calls(std::move(p.second), temp_writers_->at(p.first));
+    for (auto& p : secondary_calls_) write_calls(std::move(p.second), secondary_temp_writers_->at(p.first));
+    calls_.clear();
+    secondary_calls_.clear();
+    footprint_ = 0;
+}
+
 struct TaskWriterSyncPacket
 {
     std::condition_variable cv;
@@ -1023,20 +1893,20 @@ struct TaskWriterSyncPacket
     bool completed = false;
 };
 
-void write(std::deque<CompletedTask>& tasks, TempVcfWriterMap& writers)
+void write(std::deque<CompletedTask>& tasks, CompletedTaskCalls& calls)
 {
     static auto debug_log = get_debug_log();
     for (auto&& task : tasks) {
         if (debug_log) {
             stream(*debug_log) << "Writing completed task " << task << " that finished in " << duration(task);
         }
-        auto& writer = writers.at(contig_name(task));
-        write_calls(std::move(task.calls), writer);
+        calls.write(std::move(task));
     }
     tasks.clear();
+    calls.record_progress();
 }
 
-void write_temp_vcf_helper(TempVcfWriterMap& writers, TaskWriterSyncPacket& sync)
+void write_task_calls_helper(CompletedTaskCalls& calls, TaskWriterSyncPacket& sync)
 {
     static auto debug_log = get_debug_log();
     try {
@@ -1049,7 +1919,7 @@ void write_temp_vcf_helper(TempVcfWriterMap& writers, TaskWriterSyncPacket& sync
             std::swap(sync.tasks, buffer);
             lock.unlock();
             sync.cv.notify_one();
-            write(buffer, writers);
+            write(buffer, calls);
         }
         if (debug_log) *debug_log << "Task writer finished";
         lock.lock();
@@ -1072,17 +1942,18 @@ void write_temp_vcf_helper(TempVcfWriterMap& writers, TaskWriterSyncPacket& sync
     }
 }
 
-std::thread make_task_writer_thread(TempVcfWriterMap& temp_writers, TaskWriterSyncPacket& writer_sync)
+std::thread make_task_writer_thread(CompletedTaskCalls& calls, TaskWriterSyncPacket& writer_sync)
 {
-    return std::thread {write_temp_vcf_helper, std::ref(temp_writers), std::ref(writer_sync)};
+    return std::thread {write_task_calls_helper, std::ref(calls), std::ref(writer_sync)};
 }
 
-void write(std::deque<CompletedTask>&& tasks, VcfWriter& temp_vcf)
+void write(std::deque<CompletedTask>&& tasks, VcfWriter& temp_vcf, boost::optional<VcfWriter&> secondary_temp_vcf)
 {
     static auto debug_log = get_debug_log();
     for (auto&& task : tasks) {
         if (debug_log) stream(*debug_log) << "Writing completed task " << task << " that finished in " << duration(task);
         write_calls(std::move(task.calls), temp_vcf);
+        if (secondary_temp_vcf) write_calls(std::move(task.secondary_calls), *secondary_temp_vcf);
     }
 }
 
@@ -1101,7 +1972,7 @@ void write_or_buffer(CompletedTask&& task, CompletedTaskMap::mapped_type& buffer
 {
     static auto debug_log = get_debug_log();
     if (is_same_region(task, running_tasks.front())) {
-        running_tasks.pop();
+        running_tasks.pop_front();
         auto writable_tasks = get_writable_completed_tasks(std::move(task), buffered_tasks, running_tasks, holdback);
         assert(holdback == boost::none);
         resolve_connecting_calls(writable_tasks, calling_components);
@@ -1182,60 +2053,99 @@ void resolve_connecting_calls(RemainingTaskMap& remaining_tasks,
     }
 }
 
-void write(RemainingTaskMap&& remaining_tasks, TempVcfWriterMap& temp_vcfs)
+void write(RemainingTaskMap&& remaining_tasks, TempVcfWriterMap& temp_vcfs, boost::optional<TempVcfWriterMap&> secondary_temp_vcfs)
 {
     for (auto& p : remaining_tasks) {
-        write(std::move(p.second), temp_vcfs.at(p.first));
+        boost::optional<VcfWriter&> secondary_temp_vcf {};
+        if (secondary_temp_vcfs) secondary_temp_vcf = secondary_temp_vcfs->at(p.first);
+        write(std::move(p.second), temp_vcfs.at(p.first), secondary_temp_vcf);
     }
 }
 
-void write_remaining_tasks(FutureCompletedTasks& futures, CompletedTaskMap& buffered_tasks, TempVcfWriterMap& temp_vcfs,
+void write_remaining_tasks(FutureCompletedTasks& futures, CompletedTaskMap& buffered_tasks, CompletedTaskCalls& calls,
                            const ContigCallingComponentFactoryMap& calling_components)
 {
     static auto debug_log = get_debug_log();
     if (debug_log) stream(*debug_log) << "Waiting for " << futures.size() << " running tasks to finish";
     auto remaining_tasks = extract_remaining_tasks(futures, buffered_tasks);
     resolve_connecting_calls(remaining_tasks, calling_components);
-    write(std::move(remaining_tasks), temp_vcfs);
+    for (auto& p : remaining_tasks) {
+        for (auto& task : p.second) calls.write(std::move(task));
+    }
+    calls.record_progress();
 }
 
-auto extract_writers(TempVcfWriterMap&& vcfs)
+using ContigNodeMap = std::unordered_map<ContigName, std::size_t>;
+
+// All tasks of a contig are sent to one NUMA node, so the reference sequence and reads cached for
+// the contig are allocated (on first touch) and then reused by workers on that node. Contigs are
+// assigned largest first to the node with the least work so far.
+ContigNodeMap assign_contigs_to_nodes(const GenomeCallingComponents& components, const std::size_t num_nodes)
 {
-    std::vector<VcfWriter> result {};
-    result.reserve(vcfs.size());
-    for (auto&& p : vcfs) {
-        result.push_back(std::move(p.second));
+    std::vector<std::pair<GenomicRegion::Size, ContigName>> contig_sizes {};
+    contig_sizes.reserve(components.contigs().size());
+    for (const auto& contig : components.contigs()) {
+        contig_sizes.emplace_back(sum_region_sizes(components.search_regions().at(contig)), contig);
+    }
+    std::sort(std::rbegin(contig_sizes), std::rend(contig_sizes));
+    std::vector<GenomicRegion::Size> node_sizes(num_nodes, 0);
+    ContigNodeMap result {};
+    result.reserve(contig_sizes.size());
+    for (const auto& contig_size : contig_sizes) {
+        const auto node = std::distance(std::cbegin(node_sizes), std::min_element(std::cbegin(node_sizes), std::cend(node_sizes)));
+        node_sizes[node] += contig_size.first;
+        result.emplace(contig_size.second, node);
     }
-    vcfs.clear();
     return result;
 }
 
-auto extract_as_readers(TempVcfWriterMap&& vcfs)
+NumaTopology get_worker_topology(const GenomeCallingComponents& components)
 {
-    return writers_to_readers(extract_writers(std::move(vcfs)), false);
+    if (!components.numa_aware()) return {};
+    auto result = get_numa_topology();
+    logging::InfoLogger info_log {};
+    if (result.size() > 1) {
+        stream(info_log) << "Binding threads to " << result.size() << " NUMA nodes";
+    } else {
+        info_log << "Only one NUMA node was found so threads will not be bound";
+        result.clear();
+    }
+    return result;
 }
 
-void merge(TempVcfWriterMap&& temp_vcf_writers, GenomeCallingComponents& components)
+boost::optional<TaskReport> make_task_report(const GenomeCallingComponents& components)
 {
-    static auto debug_log = get_debug_log();
-    if (debug_log) stream(*debug_log) << "Merging " << temp_vcf_writers.size() << " temporary VCF files";
-    auto temp_readers = extract_as_readers(std::move(temp_vcf_writers));
-    merge(temp_readers, components.output(), components.contigs());
+    if (components.task_report()) {
+        return TaskReport {*components.task_report()};
+    } else {
+        return boost::none;
+    }
 }
 
 void run_octopus_multi_threaded(GenomeCallingComponents& components)
 {
-    using namespace std::chrono_literals;
     static auto debug_log = get_debug_log();
     
     const auto num_task_threads = calculate_num_task_threads(components);
-    ThreadPool workers {num_task_threads};
+    ThreadPool workers {num_task_threads, get_worker_topology(components)};
+    const auto contig_nodes = assign_contigs_to_nodes(components, workers.num_nodes());
     
     TaskMap pending_tasks {components.contigs()};
     TaskMakerSyncPacket task_maker_sync {};
     task_maker_sync.batch_size_hint = 2 * num_task_threads;
+    CallerSyncPacket caller_sync {};
+    task_maker_sync.on_new_tasks = [&caller_sync] () {
+        { std::lock_guard<std::mutex> lock {caller_sync.mutex}; }
+        caller_sync.cv.notify_all();
+    };
     std::unique_lock<std::mutex> pending_task_lock {task_maker_sync.mutex, std::defer_lock};
-    auto task_maker_thread = make_task_maker_thread(pending_tasks, components, num_task_threads, task_maker_sync);
+    auto resumed_calls = load_resumed_calls(components);
+    const ContigBatches contig_batches {components};
+    if (debug_log && contig_batches.num_batched_contigs() > 0) {
+        stream(*debug_log) << "Batched " << contig_batches.num_batched_contigs() << " small contigs into shared tasks";
+    }
+    auto task_maker_thread = make_task_maker_thread(pending_tasks, components, contig_batches, num_task_threads,
+                                                    resumed_calls.completed, task_maker_sync);
     if (!task_maker_thread.joinable()) {
         logging::FatalLogger fatal_log {};
         fatal_log << "Unable to make task maker thread";
@@ -1244,6 +2154,8 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     task_maker_thread.detach();
     
     FutureCompletedTasks futures(num_task_threads);
+    // Tasks taken from the task maker that have not yet completed, in genomic order. Tasks may be
+    // run out of order but must be written in order.
     TaskMap running_tasks {ContigOrder {components.contigs()}};
     CompletedTaskMap buffered_tasks {};
     std::map<ContigName, HoldbackTask> holdbacks {};
@@ -1253,14 +2165,31 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
         buffered_tasks.emplace(contig, CompletedTaskMap::mapped_type {});
         holdbacks.emplace(contig, boost::none);
     }
+    // The last task written for each contig by earlier attempts is held back, so its calls are
+    // resolved against the calls of the next task as if the run had not been interrupted
+    for (auto& p : resumed_calls.last_tasks) {
+        CompletedTask resumed_task {Task {std::move(p.second.region)}};
+        resumed_task.calls = std::move(p.second.calls);
+        auto& contig_buffered_tasks = buffered_tasks.at(p.first);
+        const auto itr = contig_buffered_tasks.emplace(contig_region(resumed_task), std::move(resumed_task)).first;
+        holdbacks.at(p.first) = itr->second;
+    }
+    resumed_calls.last_tasks.clear();
     
-    CallerSyncPacket caller_sync {};
     const auto calling_components = make_contig_calling_component_factory_map(components);
-    unsigned num_idle_futures {0};
+    // While every slot is busy, the reads and candidates of the next tasks are fetched on a dedicated
+    // thread, so I/O and candidate generation overlap the inference of the running tasks
+    const auto max_prefetched_tasks = components.task_prefetch_depth();
+    std::unique_ptr<ThreadPool> prefetcher {max_prefetched_tasks > 0 ? std::make_unique<ThreadPool>(1) : nullptr};
+    std::deque<PrefetchedTask> prefetched_tasks {};
+    std::vector<TaskSlot> idle_slots(num_task_threads);
+    std::iota(std::rbegin(idle_slots), std::rend(idle_slots), TaskSlot {0});
     
-    auto temp_writers = make_temp_vcf_writers(components);
+    io::ProgressJournal progress_journal {get_progress_journal_path(components)};
+    CompletedTaskCalls completed_calls {components, contig_batches, make_temp_file_tag(components), progress_journal};
     TaskWriterSyncPacket task_writer_sync {};
-    auto task_writer_thread = make_task_writer_thread(temp_writers, task_writer_sync);
+    auto task_writer_thread = make_task_writer_thread(completed_calls, task_writer_sync);
+    auto task_report = make_task_report(components);
     if (!task_writer_thread.joinable()) {
         logging::FatalLogger fatal_log {};
         fatal_log << "Unable to make task writer thread";
@@ -1269,8 +2198,8 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     task_writer_thread.detach();
     
     // Wait for the first task to be made
-    const auto tasks_available = [&] () noexcept { return task_maker_sync.num_tasks > 0; };
-    while(task_maker_sync.num_tasks == 0) {
+    const auto tasks_available = [&] () noexcept { return task_maker_sync.num_tasks > 0 || task_maker_sync.all_done; };
+    while(!tasks_available()) {
         pending_task_lock.lock();
         task_maker_sync.cv.wait(pending_task_lock, tasks_available);
         pending_task_lock.unlock();
@@ -1278,57 +2207,98 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     task_maker_sync.batch_size_hint = num_task_threads / 2;
     
     components.progress_meter().start();
+    log_resumed_progress(resumed_calls, components);
     
-    while (!task_maker_sync.all_done || task_maker_sync.num_tasks > 0) {
-        pending_task_lock.lock();
-        assert(count_tasks(pending_tasks) == task_maker_sync.num_tasks);
-        if (!task_maker_sync.all_done && task_maker_sync.num_tasks == 0) {
-            task_maker_sync.batch_size_hint = std::max(num_idle_futures, num_task_threads / 2);
-            if (num_idle_futures < futures.size()) {
-                // If there are running futures then it's good periodically check to see if
-                // any have finished and process them while we wait for the task maker.
-                while (task_maker_sync.num_tasks == 0 && caller_sync.num_finished == 0) {
-                    auto now = std::chrono::system_clock::now();
-                    task_maker_sync.cv.wait_until(pending_task_lock, now + 5s, tasks_available);
-                }
-            } else {
-                task_maker_sync.cv.wait(pending_task_lock, tasks_available);
+    // Scheduling is driven by events rather than polling: the main thread sleeps until either a
+    // running task finishes, or the task maker produces new tasks while there are idle slots.
+    ReadyTaskQueue ready_tasks {};
+    const auto can_dispatch = [&] () noexcept {
+        return !idle_slots.empty() && task_maker_sync.num_tasks > 0;
+    };
+    // With --max-memory, a task is only started if an even share of the memory left after the fixed
+    // buffers is still available, so tasks that use more than their share hold back new ones. A task
+    // is always started if nothing else is running so the run can't stall.
+    const auto& memory_budget = process_memory_budget();
+    const MemoryFootprint task_memory_share {memory_budget.available().bytes() / num_task_threads};
+    const auto can_admit = [&] () noexcept {
+        return idle_slots.size() == futures.size() || memory_budget.fits(task_memory_share);
+    };
+    // Keep going until every task has finished, as running tasks may still yield unfinished regions
+    const auto all_finished = [&] () noexcept {
+        return task_maker_sync.all_done && task_maker_sync.num_tasks == 0 && ready_tasks.empty()
+               && prefetched_tasks.empty() && idle_slots.size() == futures.size();
+    };
+    std::deque<TaskSlot> finished_slots {};
+    while (!all_finished()) {
+        if (task_maker_sync.num_tasks > 0) {
+            for (auto& task : pop_all(pending_tasks, task_maker_sync)) {
+                running_tasks.at(contig_name(task)).push_back(task);
+                ready_tasks.push(std::move(task));
             }
         }
-        pending_task_lock.unlock();
-        num_idle_futures = 0;
-        for (auto& future : futures) {
-            if (is_ready(future)) {
-                auto completed_task = future.get();
-                const auto& contig = contig_name(completed_task.region);
-                write_or_buffer(std::move(completed_task), buffered_tasks.at(contig),
-                                running_tasks.at(contig), holdbacks.at(contig),
-                                task_writer_sync, calling_components.at(contig));
-                --caller_sync.num_finished;
-            }
-            if (!future.valid()) {
-                pending_task_lock.lock();
-                if (task_maker_sync.num_tasks > 0) {
-                    pending_task_lock.unlock(); // As pop will need to lock the mutex too == deadlock
-                    auto task = pop(pending_tasks, task_maker_sync);
-                    future = run(task, calling_components.at(contig_name(task))(), caller_sync, workers);
-                    running_tasks.at(contig_name(task)).push(std::move(task));
-                } else {
-                    pending_task_lock.unlock();
-                    ++num_idle_futures;
-                }
-            }
+        // Prefetched tasks were admitted when they were taken from the ready queue
+        while (!idle_slots.empty() && !prefetched_tasks.empty()) {
+            auto task = std::move(prefetched_tasks.front().task);
+            auto task_components = prefetched_tasks.front().components.get(); // usually ready as a task ran meanwhile
+            prefetched_tasks.pop_front();
+            const auto slot = idle_slots.back();
+            idle_slots.pop_back();
+            const auto contig = contig_name(task);
+            futures[slot] = run(std::move(task), std::move(task_components), slot, caller_sync, workers, contig_nodes.at(contig));
+        }
+        while (!idle_slots.empty() && !ready_tasks.empty() && can_admit()) {
+            auto task = ready_tasks.top();
+            ready_tasks.pop();
+            const auto slot = idle_slots.back();
+            idle_slots.pop_back();
+            const auto contig = contig_name(task);
+            futures[slot] = run(std::move(task), calling_components.at(contig)(), slot, caller_sync, workers, contig_nodes.at(contig));
+        }
+        while (idle_slots.empty() && prefetched_tasks.size() < max_prefetched_tasks && !ready_tasks.empty() && can_admit()) {
+            auto task = ready_tasks.top();
+            ready_tasks.pop();
+            const auto contig = contig_name(task);
+            prefetched_tasks.push_back(prefetch(std::move(task), calling_components.at(contig)(), *prefetcher));
         }
-        // If there are no idle futures then all threads are busy and we must wait for one to finish,
-        // otherwise we must have run out of tasks, so we should wait for new ones.
-        if (num_idle_futures == 0 && caller_sync.num_finished == 0) {
-            task_maker_sync.waiting = false;
+        if (debug_log && !idle_slots.empty()) stream(*debug_log) << "There are " << idle_slots.size() << " idle task slots";
+        if (debug_log && !idle_slots.empty() && !ready_tasks.empty()) {
+            stream(*debug_log) << "Holding back tasks as " << memory_budget.used() << " of the memory budget is in use";
+        }
+        components.progress_meter().set_task_counts(futures.size() - idle_slots.size(),
+                                                    ready_tasks.size() + prefetched_tasks.size() + task_maker_sync.num_tasks);
+        // A larger lookahead gives the cost-based ordering more tasks to choose between
+        task_maker_sync.batch_size_hint = std::max(static_cast<unsigned>(idle_slots.size()), num_task_threads);
+        // If all slots are busy the task maker should keep working ahead while we wait for a task to finish.
+        task_maker_sync.waiting = !idle_slots.empty();
+        {
             std::unique_lock<std::mutex> lock {caller_sync.mutex};
-            caller_sync.cv.wait(lock, [&] () { return caller_sync.num_finished > 0; });
-            task_maker_sync.waiting = true;
-        } else {
-            if (debug_log) stream(*debug_log) << "There are " << num_idle_futures << " idle futures";
+            caller_sync.num_starving_slots = task_maker_sync.num_tasks == 0 && ready_tasks.empty() && prefetched_tasks.empty()
+                                             && can_admit() ? idle_slots.size() : 0;
+            caller_sync.cv.wait(lock, [&] () { return !caller_sync.finished.empty() || can_dispatch() || all_finished(); });
+            caller_sync.num_starving_slots = 0;
+            std::swap(finished_slots, caller_sync.finished);
         }
+        task_maker_sync.waiting = true;
+        for (const auto slot : finished_slots) {
+            auto completed_task = futures[slot].get();
+            const auto& contig = contig_name(completed_task.region);
+            idle_slots.push_back(slot);
+            if (debug_log) stream(*debug_log) << "Task " << completed_task << " used " << completed_task.telemetry;
+            if (task_report) task_report->write(completed_task.region, completed_task.telemetry);
+            if (completed_task.unfinished_region) {
+                if (debug_log) stream(*debug_log) << "Task " << completed_task << " yielded unfinished region " << *completed_task.unfinished_region;
+                for (auto& split_task : split_running_task(completed_task, running_tasks.at(contig), idle_slots.size())) {
+                    const auto split_slot = idle_slots.back();
+                    idle_slots.pop_back();
+                    futures[split_slot] = run(std::move(split_task), calling_components.at(contig)(), split_slot, caller_sync, workers,
+                                                contig_nodes.at(contig));
+                }
+            }
+            write_or_buffer(std::move(completed_task), buffered_tasks.at(contig),
+                            running_tasks.at(contig), holdbacks.at(contig),
+                            task_writer_sync, calling_components.at(contig));
+        }
+        finished_slots.clear();
     }
     assert(task_maker_sync.num_tasks == 0);
     assert(pending_tasks.empty());
@@ -1336,11 +2306,127 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     holdbacks.clear(); // holdbacks are just references to buffered tasks
     if (debug_log) *debug_log << "Finished making new tasks. Waiting for task writer to complete existing jobs";
     wait_until_finished(task_writer_sync);
-    write_remaining_tasks(futures, buffered_tasks, temp_writers, calling_components);
+    write_remaining_tasks(futures, buffered_tasks, completed_calls, calling_components);
     components.progress_meter().stop();
+    completed_calls.write_to_output(resumed_calls.calls_files);
+    if (task_report) {
+        task_report->write_summary();
+        logging::InfoLogger info_log {};
+        stream(info_log) << "Task report written to " << task_report->path();
+    }
+}
+
+// Windows are proposed and costed exactly as calling tasks are so shards balance the same way tasks do
+std::vector<Task> make_costed_windows(GenomeCallingComponents& components)
+{
+    std::vector<Task> result {};
+    for (const auto& contig : components.contigs()) {
+        const ContigCallingComponents contig_components {contig, components};
+        for (const auto& region : contig_components.regions) {
+            auto window = propose_call_subregion(contig_components, region, default_window_config);
+            while (true) {
+                if (!is_empty(window)) {
+                    result.emplace_back(window, ExecutionPolicy::seq, estimate_cost(window, contig_components));
+                }
+                if (ends_equal(window, region)) break;
+                window = propose_call_subregion(contig_components, window, region, default_window_config);
+            }
+        }
+    }
+    return result;
+}
+
+// Greedily partitions the windows, in genome order, into contiguous shards of roughly equal total cost
+io::ShardManifest make_shard_manifest(const std::vector<Task>& windows, const unsigned num_shards,
+                                      const GenomicRegion::Size padding, const ReferenceGenome& reference)
+{
+    io::ShardManifest result {};
+    if (windows.empty() || num_shards == 0) return result;
+    const auto total_cost = std::accumulate(std::cbegin(windows), std::cend(windows), Task::Cost {0},
+                                            [] (auto curr, const Task& window) { return curr + window.cost; });
+    const auto target_shard_cost = total_cost / num_shards;
+    io::ShardRegion::ShardId shard {0};
+    Task::Cost cumulative_cost {0};
+    for (const auto& window : windows) {
+        if (shard + 1 < num_shards && cumulative_cost >= (shard + 1) * target_shard_cost
+            && !result.empty() && result.back().shard == shard) {
+            ++shard;
+        }
+        cumulative_cost += window.cost;
+        if (!result.empty() && result.back().shard == shard && are_adjacent(result.back().core, window.region)) {
+            result.back().core = encompassing_region(result.back().core, window.region);
+        } else {
+            result.push_back({shard, window.region, window.region});
+        }
+    }
+    for (auto& region : result) {
+        const auto contig_region = reference.contig_region(region.core.contig_name());
+        region.padded = *overlapped_region(expand(region.core, static_cast<GenomicRegion::Distance>(padding)), contig_region);
+    }
+    return result;
+}
+
+void write_shard_manifest(GenomeCallingComponents& components, const options::ShardManifestRequest& request)
+{
+    logging::InfoLogger info_log {};
+    info_log << "Estimating calling cost of search regions to make shards";
+    const auto manifest = make_shard_manifest(make_costed_windows(components), request.num_shards,
+                                              request.padding, components.reference());
+    io::write_shard_manifest(manifest, request.manifest);
+    const auto num_shards = io::count_shards(manifest);
+    if (num_shards < request.num_shards) {
+        logging::WarningLogger warn_log {};
+        stream(warn_log) << "Only " << num_shards << " shards could be made from the search regions";
+    }
+    stream(info_log) << "Wrote manifest of " << num_shards << " shards to " << request.manifest;
+}
+
+// Each shard is called over its padded regions, but only calls overlapping its core regions are
+// kept. Calls either side of shard boundaries are then resolved just like calls from adjacent tasks.
+std::deque<CompletedTask> read_shard_calls(const options::ShardMergeRequest& request)
+{
+    std::vector<VcfReader> shard_calls {};
+    shard_calls.reserve(request.shard_calls.size());
+    for (const auto& path : request.shard_calls) {
+        shard_calls.emplace_back(path);
+    }
+    std::deque<CompletedTask> result {};
+    for (const auto& region : request.manifest) {
+        CompletedTask task {Task {region.core}};
+        auto calls = shard_calls.at(region.shard).fetch_records(region.core);
+        // Calls spanning a core boundary are fetched for both neighbouring shards, but belong to the one they start in
+        const auto starts_outside_core = [&region] (const VcfRecord& call) {
+            return mapped_begin(call) < mapped_begin(region.core) || mapped_begin(call) >= mapped_end(region.core);
+        };
+        calls.erase(std::remove_if(std::begin(calls), std::end(calls), starts_outside_core), std::end(calls));
+        task.calls.assign(std::make_move_iterator(std::begin(calls)), std::make_move_iterator(std::end(calls)));
+        result.push_back(std::move(task));
+    }
+    return result;
+}
+
+void run_shard_merge(GenomeCallingComponents& components, const options::ShardMergeRequest& request)
+{
+    static auto debug_log = get_debug_log();
+    if (debug_log) stream(*debug_log) << "Merging calls from " << request.shard_calls.size() << " shards";
+    auto shard_tasks = read_shard_calls(request);
+    auto contig_shard_tasks = make_map(shard_tasks);
+    resolve_connecting_calls(contig_shard_tasks, make_contig_calling_component_factory_map(components));
+    auto temp_writers = make_temp_vcf_writers(components);
+    write(std::move(contig_shard_tasks), temp_writers, boost::none);
     merge(std::move(temp_writers), components);
 }
 
+auto make_progress_status_writer(GenomeCallingComponents& components)
+{
+    std::unique_ptr<ProgressStatusWriter> result {};
+    if (components.progress_report()) {
+        result = std::make_unique<ProgressStatusWriter>(*components.progress_report(), components.progress_meter(),
+                                                        components.progress_report_interval());
+    }
+    return result;
+}
+
 } // namespace
 
 bool is_multithreaded(const GenomeCallingComponents& components)
@@ -1350,7 +2436,10 @@ bool is_multithreaded(const GenomeCallingComponents& components)
 
 void run_calling(GenomeCallingComponents& components)
 {
-    if (is_multithreaded(components)) {
+    const auto progress_writer = make_progress_status_writer(components);
+    if (components.shard_merge_request()) {
+        run_shard_merge(components, *components.shard_merge_request());
+    } else if (is_multithreaded(components)) {
         if (DEBUG_MODE) {
             logging::WarningLogger warn_log {};
             warn_log << "Running in parallel mode can make debug log difficult to interpret";
@@ -1446,6 +2535,8 @@ void run_csr(GenomeCallingComponents& components)
         BufferedReadPipe::Config buffer_config {components.read_buffer_size()};
         buffer_config.fetch_expansion = 100;
         buffer_config.max_hint_gap = 5'000;
+        buffer_config.prefetch = is_multithreaded(components);
+        buffer_config.compress = components.compress_read_buffer();
         BufferedReadPipe buffered_rp {filter_read_pipe, buffer_config};
         if (use_unfiltered_call_region_hints_for_filtering(components)) {
             buffered_rp.hint(extract_call_regions(*input_path));
@@ -1717,9 +2808,12 @@ void run_data_profiler(GenomeCallingComponents& components)
         if (final_output_path) {
             info_log << "Starting indel profiler";
             final_output.close();
-            if (is_indexable(*final_output_path)) index_vcf(*final_output_path);
+            if (is_indexable(*final_output_path) && !final_output.is_indexed()) index_vcf(*final_output_path);
             auto config = components.profiler_config();
-            const auto profile = profile_indels(components.read_pipe(), *final_output_path, components.reference(), components.search_regions(), std::move(config));
+            IndelProfiler::PerformanceConfig performance_config {};
+            performance_config.max_threads = components.num_threads();
+            const auto profile = profile_indels(components.read_pipe(), *final_output_path, components.reference(), components.search_regions(),
+                                                std::move(config), std::move(performance_config));
             std::ofstream profile_file {data_profile_csv_path->string()};
             profile_file << profile;
             stream(info_log) << "Indel profile written to " << *data_profile_csv_path;
@@ -1729,16 +2823,136 @@ void run_data_profiler(GenomeCallingComponents& components)
     }
 }
 
+auto make_columnar_shard_path(boost::filesystem::path directory, const ContigName& contig)
+{
+    directory /= contig + ".calls";
+    return directory;
+}
+
+void write_columnar_samples(const boost::filesystem::path& directory, const std::vector<VcfRecord::SampleName>& samples)
+{
+    auto samples_path = directory;
+    samples_path /= "samples.txt";
+    std::ofstream samples_file {samples_path.string()};
+    for (const auto& sample : samples) samples_file << sample << '\n';
+}
+
+std::size_t write_columnar_shard(const boost::filesystem::path& calls_path, const ContigName& contig,
+                                 const boost::filesystem::path& directory, const std::vector<VcfRecord::SampleName>& samples)
+{
+    const VcfReader calls {calls_path};
+    auto p = calls.iterate(contig);
+    if (p.first == p.second) return 0;
+    ColumnarCallWriter shard {make_columnar_shard_path(directory, contig), samples};
+    std::for_each(std::move(p.first), std::move(p.second), [&] (const VcfRecord& call) { shard.write(call); });
+    shard.close();
+    return shard.num_records();
+}
+
+// Calls in an unindexable file can only be read in order, so the shards are written one after another
+std::size_t write_columnar_shards(const boost::filesystem::path& calls_path, const boost::filesystem::path& directory,
+                                  const std::vector<VcfRecord::SampleName>& samples)
+{
+    const VcfReader calls {calls_path};
+    auto p = calls.iterate();
+    boost::optional<ColumnarCallWriter> shard {};
+    ContigName shard_contig {};
+    std::size_t result {0};
+    std::for_each(std::move(p.first), std::move(p.second), [&] (const VcfRecord& call) {
+        if (!shard || call.chrom() != shard_contig) {
+            if (shard) {
+                shard->close();
+                result += shard->num_records();
+            }
+            shard_contig = call.chrom();
+            shard.emplace(make_columnar_shard_path(directory, shard_contig), samples);
+        }
+        shard->write(call);
+    });
+    if (shard) {
+        shard->close();
+        result += shard->num_records();
+    }
+    return result;
+}
+
+void run_columnar_export(GenomeCallingComponents& components)
+{
+    const auto columnar_directory = components.columnar_output();
+    if (!columnar_directory) return;
+    logging::InfoLogger info_log {};
+    VcfWriter& final_output {get_final_output(components)};
+    const auto final_output_path = final_output.path();
+    if (!final_output_path) {
+        info_log << "Did not write columnar calls as calls not written to file";
+        return;
+    }
+    namespace fs = boost::filesystem;
+    if (fs::exists(*columnar_directory)) {
+        if (!fs::is_directory(*columnar_directory)) {
+            logging::ErrorLogger error_log {};
+            stream(error_log) << "The given columnar output " << *columnar_directory << " is not a directory";
+            return;
+        }
+    } else if (!fs::create_directory(*columnar_directory)) {
+        logging::ErrorLogger error_log {};
+        stream(error_log) << "Failed to create columnar output directory " << *columnar_directory << " - check permissions";
+        return;
+    }
+    info_log << "Writing columnar calls";
+    final_output.close();
+    const auto samples = VcfReader {*final_output_path}.fetch_header().samples();
+    write_columnar_samples(*columnar_directory, samples);
+    std::size_t num_calls {0};
+    if (is_indexable(*final_output_path)) {
+        if (!final_output.is_indexed()) index_vcf(*final_output_path);
+        // Contigs are independent shards, so are written concurrently, each with its own reader
+        const auto num_threads = components.num_threads() ? *components.num_threads() : std::thread::hardware_concurrency();
+        ThreadPool workers {std::max(num_threads, 1u)};
+        std::vector<std::future<std::size_t>> shards {};
+        shards.reserve(components.contigs().size());
+        for (const auto& contig : components.contigs()) {
+            shards.push_back(workers.push(write_columnar_shard, std::cref(*final_output_path), std::cref(contig),
+                                          std::cref(*columnar_directory), std::cref(samples)));
+        }
+        for (auto& shard : shards) num_calls += shard.get();
+    } else {
+        num_calls = write_columnar_shards(*final_output_path, *columnar_directory, samples);
+    }
+    stream(info_log) << "Wrote " << utils::format_with_commas(num_calls) << " columnar calls to " << *columnar_directory;
+}
+
+void write_performance_report(const GenomeCallingComponents& components)
+{
+    const auto report_path = components.performance_report();
+    if (report_path) {
+        auto debug_log = logging::get_debug_log();
+        if (debug_log) stream(*debug_log) << "Performance counters:\n" << performance::collect();
+        performance::write_report(*report_path);
+        logging::InfoLogger info_log {};
+        stream(info_log) << "Performance report written to " << *report_path;
+    }
+}
+
 void run_post_calling_requests(GenomeCallingComponents& components)
 {
     run_data_profiler(components);
+    run_columnar_export(components);
     run_bam_realign(components);
 }
 
 void run_octopus(GenomeCallingComponents& components, UserCommandInfo info)
 {
+    if (components.shard_manifest_request()) {
+        write_shard_manifest(components, *components.shard_manifest_request());
+        cleanup(components);
+        return;
+    }
+    // The progress report uses the read counters for its throughput
+    if (components.performance_report() || components.progress_report()) performance::enable();
     run_variant_calling(components, std::move(info));
     run_post_calling_requests(components);
+    write_performance_report(components);
     cleanup(components);
 }
 
@@ -46,6 +46,55 @@ BadRegionDetector::detect(const ReadMap& reads, OptionalReadsReport reads_report
     return detect(InputData {reads, boost::none, reads_report}, reads_report);
 }
 
+std::vector<BadRegionDetector::BadRegion>
+BadRegionDetector::detect(const ReadManager& reads, const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    if (!reads_profile_ || is_empty(region)) return {};
+    std::unordered_map<SampleName, BinnedDepths> depths {};
+    depths.reserve(samples.size());
+    for (const auto& sample : samples) {
+        BinnedDepths sample_depths {};
+        const auto index_bin_size = reads.depth_index_bin_size(sample);
+        sample_depths.bin_size = index_bin_size ? *index_bin_size : ReadDepthIndex::defaultBinSize;
+        sample_depths.first_bin_begin = (region.begin() / sample_depths.bin_size) * sample_depths.bin_size;
+        const auto num_bins = (region.end() - sample_depths.first_bin_begin + sample_depths.bin_size - 1) / sample_depths.bin_size;
+        auto indexed_depths = index_bin_size ? reads.indexed_mean_depths(sample, region) : boost::none;
+        if (indexed_depths) {
+            sample_depths.mean_depths = std::move(*indexed_depths);
+            sample_depths.mean_depths.resize(num_bins, 0);
+        } else {
+            // Only the read positions are decoded
+            std::vector<GenomicRegion::Size> bin_bases(num_bins);
+            const auto bins_end = sample_depths.first_bin_begin + num_bins * sample_depths.bin_size;
+            reads.iterate(sample, region, [&] (const SampleName&, const ContigRegion& read_region) {
+                auto begin = std::max(read_region.begin(), sample_depths.first_bin_begin);
+                const auto end = std::min(read_region.end(), bins_end);
+                while (begin < end) {
+                    const auto bin_idx = (begin - sample_depths.first_bin_begin) / sample_depths.bin_size;
+                    const auto bin_end = std::min(sample_depths.first_bin_begin + (bin_idx + 1) * sample_depths.bin_size, end);
+                    bin_bases[bin_idx] += bin_end - begin;
+                    begin = bin_end;
+                }
+                return true;
+            });
+            sample_depths.mean_depths.resize(num_bins);
+            std::transform(std::cbegin(bin_bases), std::cend(bin_bases), std::begin(sample_depths.mean_depths),
+                           [&] (const auto bases) { return static_cast<float>(bases) / sample_depths.bin_size; });
+        }
+        depths.emplace(sample, std::move(sample_depths));
+    }
+    std::vector<BadRegion> result {};
+    for (auto& candidate : find_high_depth_regions(depths, region)) {
+        RegionState state {};
+        state.region = candidate;
+        fill(state.read_stats, depths, candidate);
+        if (is_bad(state, boost::none)) {
+            result.push_back({std::move(candidate), BadRegion::Severity::high});
+        }
+    }
+    return result;
+}
+
 // private methods
 
 std::vector<BadRegionDetector::BadRegion>
@@ -76,6 +125,23 @@ BadRegionDetector::detect(const InputData& data, OptionalReadsReport reads_repor
 
 namespace {
 
+auto get_high_depth_threshold(const GenomicRegion::ContigName& contig, const SampleName& sample, const ReadSetProfile& profile)
+{
+    auto depth_threshold = profile.depth_stats.combined.genome.positive.median;
+    if (profile.depth_stats.combined.contig.count(contig) == 1) {
+        depth_threshold = std::max(depth_threshold, profile.depth_stats.combined.contig.at(contig).positive.median);
+    }
+    if (profile.depth_stats.sample.count(sample) == 1) {
+        depth_threshold = std::max(depth_threshold, profile.depth_stats.sample.at(sample).genome.positive.median);
+        if (profile.depth_stats.sample.at(sample).contig.count(contig) == 1) {
+            depth_threshold = std::max(depth_threshold, profile.depth_stats.sample.at(sample).contig.at(contig).positive.median);
+        }
+    } else if (profile.depth_stats.combined.contig.count(contig) == 1) {
+        depth_threshold = std::max(depth_threshold, profile.depth_stats.combined.contig.at(contig).positive.median);
+    }
+    return 4 * depth_threshold;
+}
+
 auto find_high_depth_regions_helper(const GenomicRegion& target_region, const ReadPipe::Report::DepthMap& read_depths, const ReadSetProfile& profile)
 {
     std::vector<GenomicRegion> sample_high_depth_regions {};
@@ -83,19 +149,7 @@ auto find_high_depth_regions_helper(const GenomicRegion& target_region, const Re
     sample_high_depth_regions.reserve(num_samples);
     for (const auto& p : read_depths) {
         const auto sample_depths = p.second.get(target_region);
-        auto depth_threshold = profile.depth_stats.combined.genome.positive.median;
-        if (profile.depth_stats.combined.contig.count(target_region.contig_name()) == 1) {
-            depth_threshold = std::max(depth_threshold, profile.depth_stats.combined.contig.at(target_region.contig_name()).positive.median);
-        }
-        if (profile.depth_stats.sample.count(p.first) == 1) {
-            depth_threshold = std::max(depth_threshold, profile.depth_stats.sample.at(p.first).genome.positive.median);
-            if (profile.depth_stats.sample.at(p.first).contig.count(target_region.contig_name()) == 1) {
-                depth_threshold = std::max(depth_threshold, profile.depth_stats.sample.at(p.first).contig.at(target_region.contig_name()).positive.median);
-            }
-        } else if (profile.depth_stats.combined.contig.count(target_region.contig_name()) == 1) {
-            depth_threshold = std::max(depth_threshold, profile.depth_stats.combined.contig.at(target_region.contig_name()).positive.median);
-        }
-		depth_threshold *= 4;
+        const auto depth_threshold = get_high_depth_threshold(target_region.contig_name(), p.first, profile);
         utils::append(find_high_coverage_regions(sample_depths, target_region, static_cast<unsigned>(depth_threshold)), sample_high_depth_regions);
     }
     if (num_samples == 1) {
@@ -131,6 +185,26 @@ BadRegionDetector::find_high_depth_regions(const ReadMap& reads, OptionalReadsRe
     }
 }
 
+std::vector<GenomicRegion>
+BadRegionDetector::find_high_depth_regions(const std::unordered_map<SampleName, BinnedDepths>& depths, const GenomicRegion& region) const
+{
+    assert(reads_profile_);
+    std::vector<GenomicRegion> result {};
+    for (const auto& p : depths) {
+        const auto& sample_depths = p.second;
+        const auto depth_threshold = get_high_depth_threshold(region.contig_name(), p.first, *reads_profile_);
+        for (std::size_t bin_idx {0}; bin_idx < sample_depths.mean_depths.size(); ++bin_idx) {
+            if (sample_depths.mean_depths[bin_idx] > depth_threshold) {
+                const auto bin_begin = sample_depths.first_bin_begin + bin_idx * sample_depths.bin_size;
+                const GenomicRegion bin {region.contig_name(), bin_begin, bin_begin + sample_depths.bin_size};
+                result.push_back(*overlapped_region(region, bin));
+            }
+        }
+    }
+    std::sort(std::begin(result), std::end(result));
+    return extract_covered_regions(result);
+}
+
 namespace {
 
 void merge(std::vector<GenomicRegion> src, std::vector<GenomicRegion>& dst)
@@ -384,6 +458,26 @@ void BadRegionDetector::fill(RegionState::ReadSummaryStats& stats,
     }
 }
 
+void BadRegionDetector::fill(RegionState::ReadSummaryStats& stats,
+                             const std::unordered_map<SampleName, BinnedDepths>& depths,
+                             const GenomicRegion& region) const
+{
+    // Read lengths and local mapping qualities are not known without decoding reads
+    stats.max_length = 0;
+    stats.median_mapping_quality = reads_profile_ ? reads_profile_->mapping_quality_stats.median : 60;
+    stats.average_depths.reserve(depths.size());
+    for (const auto& p : depths) {
+        const auto& sample_depths = p.second;
+        double total_bases {0};
+        for (std::size_t bin_idx {0}; bin_idx < sample_depths.mean_depths.size(); ++bin_idx) {
+            const auto bin_begin = sample_depths.first_bin_begin + bin_idx * sample_depths.bin_size;
+            const ContigRegion bin {bin_begin, bin_begin + sample_depths.bin_size};
+            total_bases += std::max(overlap_size(region.contig_region(), bin), ContigRegion::Distance {0}) * sample_depths.mean_depths[bin_idx];
+        }
+        stats.average_depths.emplace(p.first, static_cast<unsigned>(total_bases / size(region)));
+    }
+}
+
 void BadRegionDetector::fill(RegionState::VariantSummaryStats& stats,
                              const MappableFlatSet<Variant>& variants,
                              const GenomicRegion& region) const
@@ -11,6 +11,7 @@
 #include "config/common.hpp"
 #include "basics/genomic_region.hpp"
 #include "core/types/variant.hpp"
+#include "io/read/read_manager.hpp"
 #include "readpipe/read_pipe.hpp"
 #include "utils/input_reads_profiler.hpp"
 
@@ -54,6 +55,13 @@ public:
     detect(const MappableFlatSet<Variant>& variants,
            const ReadMap& reads,
            OptionalReadsReport reads_report = boost::none) const;
+    
+    // Finds regions of unusually high depth without fetching reads, using the read depth indices
+    // where possible and otherwise just the read positions. Needs a reads profile.
+    std::vector<BadRegion>
+    detect(const ReadManager& reads,
+           const std::vector<SampleName>& samples,
+           const GenomicRegion& region) const;
 
 private:
     struct InputData
@@ -87,9 +95,18 @@ private:
     std::vector<BadRegion>
     detect(const InputData& data,
            OptionalReadsReport reads_report = boost::none) const;
+    struct BinnedDepths
+    {
+        GenomicRegion::Size bin_size;
+        GenomicRegion::Position first_bin_begin;
+        std::vector<float> mean_depths;
+    };
+    
     std::vector<GenomicRegion>
     find_high_depth_regions(const ReadMap& reads, OptionalReadsReport reads_reports) const;
     std::vector<GenomicRegion>
+    find_high_depth_regions(const std::unordered_map<SampleName, BinnedDepths>& depths, const GenomicRegion& region) const;
+    std::vector<GenomicRegion>
     get_candidate_bad_regions(const InputData& data) const;
     std::vector<GenomicRegion>
     get_candidate_dense_regions(const MappableFlatSet<Variant>& variants,
@@ -102,6 +119,10 @@ private:
          const GenomicRegion& region,
          OptionalReadsReport reads_report) const;
     void
+    fill(RegionState::ReadSummaryStats& stats,
+         const std::unordered_map<SampleName, BinnedDepths>& depths,
+         const GenomicRegion& region) const;
+    void
     fill(RegionState::VariantSummaryStats& stats,
          const MappableFlatSet<Variant>& variants,
          const GenomicRegion& region) const;
@@ -9,6 +9,8 @@
 #include <numeric>
 #include <utility>
 #include <thread>
+#include <future>
+#include <chrono>
 #include <cmath>
 #include <cassert>
 
@@ -354,6 +356,22 @@ auto move_merge(Container&& src, std::vector<T>& dst)
 
 } // namespace
 
+namespace {
+
+template <typename T>
+bool is_ready(const std::future<T>& f)
+{
+    return f.wait_for(std::chrono::seconds {0}) == std::future_status::ready;
+}
+
+void add(const BAMRealigner::Report& src, BAMRealigner::Report& dst) noexcept
+{
+    dst.n_reads_assigned += src.n_reads_assigned;
+    dst.n_reads_unassigned += src.n_reads_unassigned;
+}
+
+} // namespace
+
 BAMRealigner::Report
 BAMRealigner::realign(ReadReader& src, VcfReader& variants, ReadWriter& dst,
                       const ReferenceGenome& reference, SampleList samples) const
@@ -362,33 +380,67 @@ BAMRealigner::realign(ReadReader& src, VcfReader& variants, ReadWriter& dst,
     writer_config.max_buffer_footprint = config_.max_buffer;
     io::BufferedReadWriter<AlignedRead> writer {dst, writer_config};
     Report report {};
-    BatchList batch {};
-    boost::optional<GenomicRegion> batch_region {};
-    for (auto p = variants.iterate(); p.first != p.second;) {
-        std::tie(batch, batch_region) = read_next_batch(p.first, p.second, src, reference, samples, batch_region);
-        for (auto& sample : batch) {
-            std::vector<AlignedRead> genotype_reads {};
-            std::vector<AlignedRead> realigned_reads {};
-            auto sample_reads_itr = std::begin(sample.reads);
-            for (const auto& genotype : sample.genotypes) {
-                const auto padded_genotype_region = expand(mapped_region(genotype), 1);
-                const auto overlapped_reads = bases(overlap_range(sample_reads_itr, std::end(sample.reads), padded_genotype_region));
-                genotype_reads.assign(std::make_move_iterator(overlapped_reads.begin()),
-                                      std::make_move_iterator(overlapped_reads.end()));
-                sample_reads_itr = sample.reads.erase(overlapped_reads.begin(), overlapped_reads.end());
-                auto bad_reads = to_annotated(remove_unalignable_reads(genotype_reads));
-                auto realignments = assign_and_realign(genotype_reads, genotype, reference, config_.alignment_model, config_.read_linkage, report);
-                report.n_reads_unassigned += bad_reads.size();
-                move_merge(bad_reads, realignments);
-                move_merge(realignments, realigned_reads);
+    // Batches are read in order in this thread and realigned by the workers, so the next batches are
+    // read while earlier ones are realigned. Realigned batches wait in the reorder buffer until every
+    // batch before them has been written, and reading stops while the buffer is full.
+    const auto max_pending_batches = std::max(2 * workers_.size(), std::size_t {1});
+    std::deque<std::future<RealignedBatch>> pending_batches {};
+    const auto write_next_batch = [&] () {
+        workers_.wait(pending_batches.front());
+        auto realigned = pending_batches.front().get();
+        pending_batches.pop_front();
+        for (auto& sample_reads : realigned.reads) writer << sample_reads;
+        add(realigned.report, report);
+    };
+    try {
+        BatchList batch {};
+        boost::optional<GenomicRegion> batch_region {};
+        for (auto p = variants.iterate(); p.first != p.second;) {
+            std::tie(batch, batch_region) = read_next_batch(p.first, p.second, src, reference, samples, batch_region);
+            pending_batches.push_back(workers_.push([this, &reference, batch = std::move(batch)] () mutable {
+                return realign(std::move(batch), reference); }));
+            batch.clear();
+            while (pending_batches.size() >= max_pending_batches || (!pending_batches.empty() && is_ready(pending_batches.front()))) {
+                write_next_batch();
             }
-            move_merge(to_annotated(std::move(sample.reads)), realigned_reads);
-            writer << realigned_reads;
         }
+        while (!pending_batches.empty()) write_next_batch();
+    } catch (...) {
+        // The tasks reference this frame
+        for (const auto& batch : pending_batches) {
+            if (batch.valid()) workers_.wait(batch);
+        }
+        throw;
     }
     return report;
 }
 
+BAMRealigner::RealignedBatch BAMRealigner::realign(BatchList batch, const ReferenceGenome& reference) const
+{
+    RealignedBatch result {};
+    result.reads.reserve(batch.size());
+    for (auto& sample : batch) {
+        std::vector<AlignedRead> genotype_reads {};
+        std::vector<AlignedRead> realigned_reads {};
+        auto sample_reads_itr = std::begin(sample.reads);
+        for (const auto& genotype : sample.genotypes) {
+            const auto padded_genotype_region = expand(mapped_region(genotype), 1);
+            const auto overlapped_reads = bases(overlap_range(sample_reads_itr, std::end(sample.reads), padded_genotype_region));
+            genotype_reads.assign(std::make_move_iterator(overlapped_reads.begin()),
+                                  std::make_move_iterator(overlapped_reads.end()));
+            sample_reads_itr = sample.reads.erase(overlapped_reads.begin(), overlapped_reads.end());
+            auto bad_reads = to_annotated(remove_unalignable_reads(genotype_reads));
+            auto realignments = assign_and_realign(genotype_reads, genotype, reference, config_.alignment_model, config_.read_linkage, result.report);
+            result.report.n_reads_unassigned += bad_reads.size();
+            move_merge(bad_reads, realignments);
+            move_merge(realignments, realigned_reads);
+        }
+        move_merge(to_annotated(std::move(sample.reads)), realigned_reads);
+        result.reads.push_back(std::move(realigned_reads));
+    }
+    return result;
+}
+
 BAMRealigner::Report BAMRealigner::realign(ReadReader& src, VcfReader& variants, ReadWriter& dst,
                                            const ReferenceGenome& reference) const
 {
@@ -558,11 +610,19 @@ BAMRealigner::Report
 realign(io::ReadReader::Path src, VcfReader::Path variants, io::ReadWriter::Path dst,
         const ReferenceGenome& reference, BAMRealigner::Config config)
 {
-    io::ReadWriter dst_bam {std::move(dst), src};
+    io::ReadWriter::StreamConfig stream_config {};
+    if (get_pool_size(config) > 0) {
+        // Realignment of the next batch then overlaps with encoding and compressing the last
+        stream_config.max_queued_batches = 8;
+        stream_config.num_compression_threads = get_pool_size(config);
+    }
+    io::ReadWriter dst_bam {std::move(dst), src, stream_config};
     io::ReadReader src_bam {std::move(src)};
     VcfReader vcf {std::move(variants)};
     BAMRealigner realigner {std::move(config)};
-    return realigner.realign(src_bam, vcf, dst_bam, reference);
+    auto result = realigner.realign(src_bam, vcf, dst_bam, reference);
+    dst_bam.flush();
+    return result;
 }
 
 } // namespace octopus
@@ -73,6 +73,11 @@ private:
     };
     using BatchList = std::vector<Batch>;
     using BatchListRegionPair = std::pair<BatchList, boost::optional<GenomicRegion>>;
+    struct RealignedBatch
+    {
+        std::vector<std::vector<AlignedRead>> reads; // per sample, sorted
+        Report report;
+    };
     
     Config config_;
     mutable ThreadPool workers_;
@@ -82,6 +87,7 @@ private:
                                         const ReferenceGenome& reference, const SampleList& samples,
                                         const boost::optional<GenomicRegion>& prev_batch_region) const;
     void merge(BatchList& src, BatchList& dst) const;
+    RealignedBatch realign(BatchList batch, const ReferenceGenome& reference) const;
 };
 
 BAMRealigner::Report
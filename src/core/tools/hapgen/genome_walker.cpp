@@ -17,6 +17,111 @@
 
 namespace octopus { namespace coretools {
 
+// ReadSharingIndex
+
+ReadSharingIndex::ReadSharingIndex(const ReadMap& reads, boost::optional<const TemplateMap&> read_templates)
+: reads_ {reads}
+, read_templates_ {read_templates}
+, read_ids_ {}
+, template_ids_ {}
+{}
+
+const ReadMap& ReadSharingIndex::reads() const noexcept
+{
+    return reads_.get();
+}
+
+namespace {
+
+template <typename ReadIds>
+bool intersects(const ReadIds& lhs, const ReadIds& rhs) noexcept
+{
+    auto first1 = std::cbegin(lhs), first2 = std::cbegin(rhs);
+    const auto last1 = std::cend(lhs), last2 = std::cend(rhs);
+    while (first1 != last1 && first2 != last2) {
+        if (*first1 < *first2) {
+            ++first1;
+        } else if (*first2 < *first1) {
+            ++first2;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename SampleReadIds, typename Map>
+SampleReadIds get_overlapped_ids(const Map& reads, const Allele& allele)
+{
+    SampleReadIds result {};
+    result.reserve(reads.size());
+    for (const auto& p : reads) {
+        const auto overlapped = p.second.overlap_range(allele);
+        typename SampleReadIds::value_type ids {};
+        // Overlapped reads are visited in container order, so the ids are sorted
+        for (auto itr = std::cbegin(overlapped); itr != std::cend(overlapped); ++itr) {
+            ids.push_back(static_cast<typename SampleReadIds::value_type::value_type>(std::distance(std::cbegin(p.second), itr.base())));
+        }
+        result.push_back(std::move(ids));
+    }
+    return result;
+}
+
+} // namespace
+
+bool ReadSharingIndex::has_shared(const Allele& lhs, const Allele& rhs, const bool use_read_templates)
+{
+    const auto& lhs_ids = overlapped_ids(lhs, use_read_templates);
+    const auto& rhs_ids = overlapped_ids(rhs, use_read_templates);
+    for (std::size_t s {0}; s < lhs_ids.size(); ++s) {
+        if (intersects(lhs_ids[s], rhs_ids[s])) return true;
+    }
+    return false;
+}
+
+bool ReadSharingIndex::all_shared(const Allele& lhs, const Allele& rhs, const bool use_read_templates)
+{
+    const auto& lhs_ids = overlapped_ids(lhs, use_read_templates);
+    const auto& rhs_ids = overlapped_ids(rhs, use_read_templates);
+    for (std::size_t s {0}; s < lhs_ids.size(); ++s) {
+        if (!intersects(lhs_ids[s], rhs_ids[s])) return false;
+    }
+    return true;
+}
+
+void ReadSharingIndex::drop_before(const GenomicRegion& region)
+{
+    for (auto* cache : {&read_ids_, &template_ids_}) {
+        for (auto itr = std::begin(*cache); itr != std::end(*cache) && itr->first.begin() < region.begin();) {
+            if (itr->first.end() < region.begin()) {
+                itr = cache->erase(itr);
+            } else {
+                ++itr;
+            }
+        }
+    }
+}
+
+// private methods
+
+const ReadSharingIndex::SampleReadIds& ReadSharingIndex::overlapped_ids(const Allele& allele, const bool use_read_templates)
+{
+    const bool use_templates {use_read_templates && read_templates_};
+    auto& cache = use_templates ? template_ids_ : read_ids_;
+    const auto& key = contig_region(allele);
+    auto itr = cache.find(key);
+    if (itr == std::end(cache)) {
+        if (use_templates) {
+            itr = cache.emplace(key, get_overlapped_ids<SampleReadIds>(*read_templates_, allele)).first;
+        } else {
+            itr = cache.emplace(key, get_overlapped_ids<SampleReadIds>(reads_.get(), allele)).first;
+        }
+    }
+    return itr->second;
+}
+
+// GenomeWalker
+
 GenomeWalker::GenomeWalker(Config config)
 : config_ {config}
 {}
@@ -34,15 +139,11 @@ bool use_read_templates_for_extension(const GenomeWalker::ReadTemplatePolicy pol
 }
 
 template <typename BidirIt>
-BidirIt find_first_shared_helper(const ReadMap& reads, boost::optional<const TemplateMap&> read_templates,
+BidirIt find_first_shared_helper(ReadSharingIndex& reads, const bool use_read_templates,
                                  BidirIt first, BidirIt last, const Allele& allele)
 {
-    BidirIt result;
-    if (read_templates) {
-        result = find_first_shared(*read_templates, first, last, allele);
-    } else {
-        result = find_first_shared(reads, first, last, allele);
-    }
+    // The alleles are sorted, so the first sharing a read in any sample is the first found in any sample
+    auto result = std::find_if(first, last, [&] (const Allele& other) { return reads.has_shared(other, allele, use_read_templates); });
     if (result != last) {
         while (result != first && (are_adjacent(*std::prev(result), *result) || overlaps(*std::prev(result), *result))) --result;
     }
@@ -179,11 +280,22 @@ GenomeWalker::walk(const GenomicRegion& previous_region,
                    const ReadMap& reads,
                    const AlleleSet& alleles,
                    boost::optional<const TemplateMap&> read_templates) const
+{
+    ReadSharingIndex index {reads, read_templates};
+    return walk(previous_region, index, alleles);
+}
+
+GenomicRegion
+GenomeWalker::walk(const GenomicRegion& previous_region,
+                   ReadSharingIndex& reads,
+                   const AlleleSet& alleles,
+                   const bool use_read_templates) const
 {
     using std::cbegin; using std::cend; using std::next; using std::prev; using std::min;
     using std::distance; using std::advance;
     
     if (alleles.empty()) return previous_region;
+    reads.drop_before(previous_region);
     
     auto last_allele_itr  = cend(alleles);
     auto previous_alleles = bases(overlap_range(alleles, previous_region));
@@ -200,16 +312,13 @@ GenomeWalker::walk(const GenomicRegion& previous_region,
         }
     }
     unsigned num_indicators {0};
-    boost::optional<const TemplateMap&> indicator_read_templates {};
-    if (read_templates && use_read_templates_for_lagging(config_.read_template_policy)) {
-        indicator_read_templates = read_templates;
-    }
+    const bool use_indicator_read_templates {use_read_templates && use_read_templates_for_lagging(config_.read_template_policy)};
     switch (config_.indicator_policy) {
         case IndicatorPolicy::includeNone: break;
         case IndicatorPolicy::includeIfSharedWithNovelRegion:
         {
             if (distance(first_previous_itr, included_itr) > 0) {
-                auto it = find_first_shared_helper(reads, indicator_read_templates, first_previous_itr, included_itr, *included_itr);
+                auto it = find_first_shared_helper(reads, use_indicator_read_templates, first_previous_itr, included_itr, *included_itr);
                 if (it != included_itr) {
                     auto expanded_leftmost = mapped_region(*it);
                     std::for_each(it, included_itr, [&] (const auto& allele) {
@@ -233,7 +342,7 @@ GenomeWalker::walk(const GenomicRegion& previous_region,
             if (distance(first_previous_itr, included_itr) > 0) {
                 auto it = included_itr;
                 while (true) {
-                    const auto it2 = find_first_shared_helper(reads, indicator_read_templates, first_previous_itr, it, *it);
+                    const auto it2 = find_first_shared_helper(reads, use_indicator_read_templates, first_previous_itr, it, *it);
                     if (it2 == it) {
                         it = it2;
                         break;
@@ -254,21 +363,18 @@ GenomeWalker::walk(const GenomicRegion& previous_region,
     unsigned num_excluded_alleles {0};
     auto num_included = config_.max_alleles;
     if (config_.extension_policy == ExtensionPolicy::includeIfWithinReadLengthOfFirstIncluded) {
-        auto max_alleles_within_read_length = static_cast<unsigned>(max_count_if_shared_with_first(reads, first_included_itr, last_allele_itr));
+        auto max_alleles_within_read_length = static_cast<unsigned>(max_count_if_shared_with_first(reads.reads(), first_included_itr, last_allele_itr));
         num_included = min({num_included, num_remaining_alleles, max_alleles_within_read_length + 1});
         num_excluded_alleles = max_alleles_within_read_length - num_included;
     } else {
         num_included = min(num_included, num_remaining_alleles);
     }
-    boost::optional<const TemplateMap&> extension_read_templates {};
-    if (read_templates && use_read_templates_for_extension(config_.read_template_policy)) {
-        extension_read_templates = read_templates;
-    }
+    const bool use_extension_read_templates {use_read_templates && use_read_templates_for_extension(config_.read_template_policy)};
     assert(num_included > 0);
     auto first_excluded_itr = next(included_itr, num_included);
     while (--num_included > 0 && is_optimal_to_extend(first_included_itr, next(included_itr), first_excluded_itr,
-                                                      last_allele_itr, reads, num_included + num_excluded_alleles)) {
-        if (!can_extend(*included_itr, *next(included_itr), reads, extension_read_templates)) {
+                                                      last_allele_itr, reads.reads(), num_included + num_excluded_alleles)) {
+        if (!can_extend(*included_itr, *next(included_itr), reads, use_extension_read_templates)) {
             break;
         }
         ++included_itr;
@@ -280,23 +386,19 @@ GenomeWalker::walk(const GenomicRegion& previous_region,
 
 bool
 GenomeWalker::can_extend(const Allele& active, const Allele& novel,
-                         const ReadMap& reads, boost::optional<const TemplateMap&> read_templates) const
+                         ReadSharingIndex& reads, const bool use_read_templates) const
 {
     if (config_.max_extension && inner_distance(active, novel) > *config_.max_extension) {
         return false;
     }
     if (config_.extension_policy == ExtensionPolicy::includeIfAllSamplesSharedWithFrontier) {
-        if (read_templates) {
-            return all_shared(*read_templates, active, novel);
-        } else {
-            return all_shared(reads, active, novel);
-        }
+        return reads.all_shared(active, novel, use_read_templates);
     } else if (config_.extension_policy == ExtensionPolicy::includeIfAnySampleSharedWithFrontier) {
-        if (read_templates) {
-            return has_shared(*read_templates, active, novel);
-        } else {
-            return has_shared(reads, active, novel);
-        }
+        return reads.has_shared(active, novel, use_read_templates);
+    } else if (config_.extension_policy == ExtensionPolicy::noLimit && config_.require_shared_reads && !overlaps(active, novel)) {
+        // Alleles that no read links to the frontier are independent of the active alleles, so are better
+        // called in their own active region than multiplying the haplotypes of this one
+        return reads.has_shared(active, novel, use_read_templates);
     }
     return config_.extension_policy == ExtensionPolicy::noLimit;
 }
@@ -4,9 +4,15 @@
 #ifndef genome_walker_hpp
 #define genome_walker_hpp
 
+#include <vector>
+#include <map>
 #include <functional>
+#include <cstdint>
+
+#include <boost/optional.hpp>
 
 #include "config/common.hpp"
+#include "basics/contig_region.hpp"
 #include "concepts/mappable.hpp"
 #include "core/types/allele.hpp"
 #include "containers/mappable_flat_set.hpp"
@@ -18,6 +24,49 @@ class Variant;
 
 namespace coretools {
 
+/**
+    Answers whether two alleles share a read (or template) in any or all samples. The reads overlapping
+    each allele are found once, as sorted read ids for each sample, and kept for later queries, so
+    successive walks over the same reads don't search the reads again for every pair of alleles.
+    Alleles behind a walk are dropped as the walk moves forward. All alleles must be on the contig
+    of the reads.
+ */
+class ReadSharingIndex
+{
+public:
+    ReadSharingIndex() = delete;
+    
+    ReadSharingIndex(const ReadMap& reads, boost::optional<const TemplateMap&> read_templates = boost::none);
+    
+    ReadSharingIndex(const ReadSharingIndex&)            = default;
+    ReadSharingIndex& operator=(const ReadSharingIndex&) = default;
+    ReadSharingIndex(ReadSharingIndex&&)                 = default;
+    ReadSharingIndex& operator=(ReadSharingIndex&&)      = default;
+    
+    ~ReadSharingIndex() = default;
+    
+    const ReadMap& reads() const noexcept;
+    
+    // If use_read_templates is true and there are read templates then templates are used rather than reads
+    bool has_shared(const Allele& lhs, const Allele& rhs, bool use_read_templates = false);
+    bool all_shared(const Allele& lhs, const Allele& rhs, bool use_read_templates = false);
+    
+    // Drops the alleles ending before region
+    void drop_before(const GenomicRegion& region);
+    
+private:
+    using ReadId = std::uint32_t;
+    using ReadIds = std::vector<ReadId>;
+    using SampleReadIds = std::vector<ReadIds>; // in the iteration order of the read map
+    using ReadIdCache = std::map<ContigRegion, SampleReadIds>;
+    
+    std::reference_wrapper<const ReadMap> reads_;
+    boost::optional<const TemplateMap&> read_templates_;
+    ReadIdCache read_ids_, template_ids_;
+    
+    const SampleReadIds& overlapped_ids(const Allele& allele, bool use_read_templates);
+};
+
 class GenomeWalker
 {
 public:
@@ -53,6 +102,7 @@ public:
         ExtensionPolicy extension_policy = ExtensionPolicy::includeIfAnySampleSharedWithFrontier;
         ReadTemplatePolicy read_template_policy = ReadTemplatePolicy::indicators_and_extension;
         boost::optional<GenomicRegion::Distance> max_extension = boost::none;
+        bool require_shared_reads = false;
     };
     
     GenomeWalker() = delete;
@@ -72,11 +122,19 @@ public:
          const AlleleSet& alleles,
          boost::optional<const TemplateMap&> read_templates = boost::none) const;
     
+    // As above, but reuses the read sharing found by earlier walks over the same reads. The read
+    // templates of the index are only used if use_read_templates is true.
+    GenomicRegion
+    walk(const GenomicRegion& previous_region,
+         ReadSharingIndex& reads,
+         const AlleleSet& alleles,
+         bool use_read_templates = true) const;
+    
 private:
     Config config_;
     
     bool can_extend(const Allele& active, const Allele& novel,
-                    const ReadMap& reads, boost::optional<const TemplateMap&> read_templates) const;
+                    ReadSharingIndex& reads, bool use_read_templates) const;
 };
 
 } // namespace coretools
@@ -17,9 +17,10 @@
 #include "concepts/mappable.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/append.hpp"
+#include "utils/kmer_mapper.hpp"
+#include "io/reference/reference_genome.hpp"
 
 #include <iostream> // DEBUG
-#include "timers.hpp"
 
 #define _unused(x) ((void)(x))
 
@@ -173,6 +174,30 @@ auto decompose(const MappableFlatSet<Variant>& variants)
     };
 }
 
+auto make_default_walker(const HaplotypeGenerator::Policies& policies)
+{
+    return GenomeWalker {{
+        max_included(policies.haplotype_limits.target),
+        GenomeWalker::IndicatorPolicy::includeNone,
+        get_walker_policy(policies.extension),
+        get_walker_read_template_policy(policies),
+        policies.max_allele_distance,
+        policies.split_unlinked_blocks
+    }};
+}
+
+auto make_holdout_walker(const HaplotypeGenerator::Policies& policies)
+{
+    return GenomeWalker {{
+        max_included(policies.haplotype_limits.target),
+        GenomeWalker::IndicatorPolicy::includeAll,
+        get_walker_policy(policies.extension),
+        get_walker_read_template_policy(policies),
+        policies.max_allele_distance,
+        policies.split_unlinked_blocks
+    }};
+}
+
 auto make_lagged_walker(const HaplotypeGenerator::Policies& policies)
 {
     return GenomeWalker {{
@@ -180,7 +205,8 @@ auto make_lagged_walker(const HaplotypeGenerator::Policies& policies)
         get_walker_policy(policies.lagging),
         get_walker_policy(policies.extension),
         get_walker_read_template_policy(policies),
-        policies.max_allele_distance
+        policies.max_allele_distance,
+        policies.split_unlinked_blocks
     }};
 }
 
@@ -195,24 +221,14 @@ HaplotypeGenerator::HaplotypeGenerator(const ReferenceGenome& reference,
                                        Policies policies)
 : policies_ {std::move(policies)}
 , tree_ {get_contig_name(candidates, reads, reference), reference}
-, default_walker_ {{
-    max_included(policies_.haplotype_limits.target),
-    GenomeWalker::IndicatorPolicy::includeNone,
-    get_walker_policy(policies.extension),
-    get_walker_read_template_policy(policies),
-    policies.max_allele_distance
-}}
-, holdout_walker_{{
-	max_included(policies_.haplotype_limits.target),
-	GenomeWalker::IndicatorPolicy::includeAll,
-	get_walker_policy(policies.extension),
-    get_walker_read_template_policy(policies),
-    policies.max_allele_distance
-}}
+, default_walker_ {make_default_walker(policies_)}
+, holdout_walker_ {make_holdout_walker(policies_)}
 , lagged_walker_{}
 , alleles_{decompose(candidates)}
 , reads_{reads}
 , read_templates_ {read_templates}
+, read_sharing_ {reads, read_templates}
+, reference_ {reference}
 , next_active_region_{}
 , active_holdouts_{}
 , holdout_region_{}
@@ -222,8 +238,8 @@ HaplotypeGenerator::HaplotypeGenerator(const ReferenceGenome& reference,
 , debug_log_{logging::get_debug_log()}
 , trace_log_{logging::get_trace_log()}
 {
-    if (policies.lagging != Policies::Lagging::none) {
-        lagged_walker_ = make_lagged_walker(policies);
+    if (policies_.lagging != Policies::Lagging::none) {
+        lagged_walker_ = make_lagged_walker(policies_);
     }
     if (!alleles_.empty()) {
 		rightmost_allele_ = alleles_.rightmost();
@@ -289,6 +305,7 @@ HaplotypeGenerator::HaplotypePacket HaplotypeGenerator::generate()
     if (done()) return {{active_region_}, boost::none, boost::none};
     populate_tree();
     auto haplotypes = tree_.extract_haplotypes(calculate_haplotype_region());
+    if (policies_.prune_unsupported_haplotypes) remove_unsupported_haplotypes(haplotypes);
     cleanup_tree();
     return {std::move(haplotypes), active_region_, backtrack_region()};
 }
@@ -393,6 +410,21 @@ void HaplotypeGenerator::clear_lagging_exclusion_zones() noexcept
     lagging_exclusion_zones_.clear();
 }
 
+void HaplotypeGenerator::reduce_haplotype_limits(const unsigned factor)
+{
+    static constexpr unsigned min_target_limit {8};
+    if (factor < 2) return;
+    auto& limits = policies_.haplotype_limits;
+    if (limits.target <= min_target_limit) return;
+    limits.target   = std::max(limits.target / factor, min_target_limit);
+    limits.holdout  = std::max(limits.holdout / factor, limits.target + 1);
+    limits.overflow = std::max(limits.overflow / factor, limits.holdout);
+    if (debug_log_) stream(*debug_log_) << "Reduced the haplotype generator target limit to " << limits.target;
+    default_walker_ = make_default_walker(policies_);
+    holdout_walker_ = make_holdout_walker(policies_);
+    if (lagged_walker_) lagged_walker_ = make_lagged_walker(policies_);
+}
+
 // private methods
 
 bool HaplotypeGenerator::is_lagging_enabled() const noexcept
@@ -420,7 +452,7 @@ bool HaplotypeGenerator::is_active_region_lagged() const
     if (in_holdout_mode()) return true;
     if (!is_lagging_enabled(active_region_)) return false;
     if (alleles_.empty()) return false;
-    const auto next_lagged_region = lagged_walker_->walk(active_region_, reads_, alleles_);
+    const auto next_lagged_region = lagged_walker_->walk(active_region_, read_sharing_, alleles_, false);
     return overlaps(active_region_, next_lagged_region);
 }
 
@@ -477,7 +509,7 @@ void pop_front(std::vector<T>& v) {
 
 GenomicRegion HaplotypeGenerator::walk_from_active_region(const GenomeWalker& walker) const
 {
-    return walker.walk(active_region_, reads_, alleles_, read_templates_);
+    return walker.walk(active_region_, read_sharing_, alleles_);
 }
 
 GenomicRegion HaplotypeGenerator::find_max_lagged_region() const
@@ -1200,19 +1232,24 @@ std::size_t HaplotypeGenerator::max_cached_haplotypes() const
 bool can_add_block(const MappableBlock<Haplotype>& block,
                    const HaplotypeTree& tree,
                    const unsigned max_haplotypes,
-                   const HaplotypeGenerator::Policies::Backtrack backtrack_policy,
-                   const boost::optional<const TemplateMap&> reads)
+                   const HaplotypeGenerator::Policies& policies,
+                   const ReadMap& reads,
+                   const boost::optional<const TemplateMap&> read_templates)
 {
     if (tree.num_haplotypes() * block.size() > max_haplotypes) return false;
-    if (backtrack_policy == HaplotypeGenerator::Policies::Backtrack::aggressive) return true;
-    return !reads || tree.is_empty() || has_shared(*reads, tree.encompassing_region(), block);
+    if (policies.backtrack == HaplotypeGenerator::Policies::Backtrack::aggressive) return true;
+    if (tree.is_empty()) return true;
+    if (read_templates) return has_shared(*read_templates, tree.encompassing_region(), block);
+    // A block that no read links to the tree is an independent sub-problem, so can be left for its own
+    // active region rather than multiplying the haplotypes of the tree
+    return !policies.split_unlinked_blocks || has_shared(reads, tree.encompassing_region(), block);
 }
 
 unsigned HaplotypeGenerator::extend_tree_with_cached_haplotypes(const unsigned max_haplotypes)
 {
     if (!haplotype_blocks_.empty()) {
         const auto try_add_block = [this, max_haplotypes] (const auto& block) {
-            if (can_add_block(block, tree_, max_haplotypes, policies_.backtrack, read_templates_)) {
+            if (can_add_block(block, tree_, max_haplotypes, policies_, reads_, read_templates_)) {
                 extend_tree(block, tree_);
                 return false;
             } else {
@@ -1634,6 +1671,85 @@ boost::optional<GenomicRegion> HaplotypeGenerator::backtrack_region() const
     }
 }
 
+namespace {
+
+constexpr unsigned char supportKmerSize {15};
+
+using KmerSet = std::vector<KmerHashType>;
+
+void sort_unique(KmerSet& kmers)
+{
+    std::sort(std::begin(kmers), std::end(kmers));
+    kmers.erase(std::unique(std::begin(kmers), std::end(kmers)), std::end(kmers));
+}
+
+KmerSet get_kmers(const Haplotype::NucleotideSequence& sequence)
+{
+    auto result = compute_kmer_hashes<supportKmerSize>(sequence);
+    sort_unique(result);
+    return result;
+}
+
+KmerSet get_overlapped_read_kmers(const ReadMap& reads, const GenomicRegion& region)
+{
+    KmerSet result {};
+    for (const auto& p : reads) {
+        for (const auto& read : overlap_range(p.second, region)) {
+            const auto read_kmers = compute_kmer_hashes<supportKmerSize>(read.sequence());
+            utils::append(read_kmers, result);
+        }
+    }
+    sort_unique(result);
+    return result;
+}
+
+bool has_kmer(const KmerSet& kmers, const KmerHashType kmer)
+{
+    return std::binary_search(std::cbegin(kmers), std::cend(kmers), kmer);
+}
+
+// Each run of overlapping kmers that are not in the reference, usually those overlapping a variant
+// allele, must include at least one kmer found in the reads
+bool is_supported(const Haplotype& haplotype, const KmerSet& reference_kmers, const KmerSet& read_kmers)
+{
+    bool in_novel_run {false}, is_novel_run_supported {false};
+    for (const auto kmer : compute_kmer_hashes<supportKmerSize>(haplotype.sequence())) {
+        if (has_kmer(reference_kmers, kmer)) {
+            if (in_novel_run && !is_novel_run_supported) return false;
+            in_novel_run = false;
+        } else {
+            if (!in_novel_run) {
+                in_novel_run = true;
+                is_novel_run_supported = false;
+            }
+            is_novel_run_supported = is_novel_run_supported || has_kmer(read_kmers, kmer);
+        }
+    }
+    return !in_novel_run || is_novel_run_supported;
+}
+
+} // namespace
+
+void HaplotypeGenerator::remove_unsupported_haplotypes(HaplotypeBlock& haplotypes)
+{
+    if (haplotypes.size() < 2) return;
+    const auto reference_kmers = get_kmers(reference_.get().fetch_sequence(mapped_region(haplotypes)));
+    const auto read_kmers = get_overlapped_read_kmers(reads_, mapped_region(haplotypes));
+    const auto first_unsupported = std::stable_partition(std::begin(haplotypes), std::end(haplotypes),
+                                                         [&] (const Haplotype& haplotype) {
+                                                             return is_supported(haplotype, reference_kmers, read_kmers);
+                                                         });
+    // Keep everything if nothing is supported, as then the reads are not informative
+    if (first_unsupported == std::begin(haplotypes) || first_unsupported == std::end(haplotypes)) return;
+    const std::vector<Haplotype> unsupported {std::make_move_iterator(first_unsupported), std::make_move_iterator(std::end(haplotypes))};
+    haplotypes.erase(first_unsupported, std::end(haplotypes));
+    prune_all(unsupported, tree_);
+    if (debug_log_) {
+        stream(*debug_log_) << "Removed " << unsupported.size() << " haplotypes with alleles unsupported by read kmers, "
+                            << haplotypes.size() << " remain";
+    }
+}
+
 // Builder
 
 HaplotypeGenerator::Builder& HaplotypeGenerator::Builder::set_lagging_policy(const Policies::Lagging policy) noexcept
@@ -1700,6 +1816,18 @@ HaplotypeGenerator::Builder& HaplotypeGenerator::Builder::set_max_allele_distanc
     return *this;
 }
 
+HaplotypeGenerator::Builder& HaplotypeGenerator::Builder::set_prune_unsupported_haplotypes(const bool prune) noexcept
+{
+    policies_.prune_unsupported_haplotypes = prune;
+    return *this;
+}
+
+HaplotypeGenerator::Builder& HaplotypeGenerator::Builder::set_split_unlinked_blocks(const bool split) noexcept
+{
+    policies_.split_unlinked_blocks = split;
+    return *this;
+}
+
 HaplotypeGenerator
 HaplotypeGenerator::Builder::build(const ReferenceGenome& reference,
                                    const MappableFlatSet<Variant>& candidates,
@@ -49,6 +49,8 @@ public:
         Haplotype::MappingDomain::Size min_flank_pad = 30;
         boost::optional<Haplotype::NucleotideSequence::size_type> max_indicator_join_distance = boost::none;
         boost::optional<GenomicRegion::Distance> max_allele_distance = boost::none;
+        bool prune_unsupported_haplotypes = false;
+        bool split_unlinked_blocks = false;
     };
     
     enum class Mode { allele, haplotype, allele_and_haplotype };
@@ -121,6 +123,10 @@ public:
     void add_lagging_exclusion_zone(GenomicRegion region);
     void clear_lagging_exclusion_zones() noexcept;
     
+    // Divides the haplotype limits by the given factor for all active regions generated from now on.
+    // The target limit is never reduced below a small minimum.
+    void reduce_haplotype_limits(unsigned factor);
+    
 private:
     struct HoldoutSet
     {
@@ -143,6 +149,8 @@ private:
     MappableFlatSet<Allele> alleles_;
     std::reference_wrapper<const ReadMap> reads_;
     boost::optional<const TemplateMap&> read_templates_;
+    mutable ReadSharingIndex read_sharing_;
+    std::reference_wrapper<const ReferenceGenome> reference_;
     
     MappableFlatSet<GenomicRegion> lagging_exclusion_zones_;
     
@@ -199,6 +207,7 @@ private:
     void cache_active_haplotypes();
     boost::optional<GenomicRegion> haplotype_block_region() const;
     boost::optional<GenomicRegion> backtrack_region() const;
+    void remove_unsupported_haplotypes(HaplotypeBlock& haplotypes);
 };
 
 class HaplotypeGenerator::HaplotypeOverflow : public std::runtime_error
@@ -253,6 +262,8 @@ public:
     Builder& set_min_flank_pad(Haplotype::MappingDomain::Size n) noexcept;
     Builder& set_max_indicator_join_distance(Haplotype::NucleotideSequence::size_type n) noexcept;
     Builder& set_max_allele_distance(GenomicRegion::Distance gap) noexcept;
+    Builder& set_prune_unsupported_haplotypes(bool prune) noexcept;
+    Builder& set_split_unlinked_blocks(bool split) noexcept;
     
     HaplotypeGenerator
     build(const ReferenceGenome& reference,
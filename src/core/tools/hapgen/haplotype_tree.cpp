@@ -8,24 +8,26 @@
 #include <stdexcept>
 #include <cassert>
 #include <iostream>
-
-#include <boost/property_map/property_map.hpp>
-#include <boost/graph/breadth_first_search.hpp>
-#include <boost/graph/depth_first_search.hpp>
-#include <boost/graph/visitors.hpp>
-#include <boost/graph/copy.hpp>
-#include <boost/graph/graphviz.hpp>
+#include <fstream>
 
 #include "io/reference/reference_genome.hpp"
 #include "utils/mappable_algorithms.hpp"
 
 namespace octopus { namespace coretools {
 
+constexpr HaplotypeTree::Vertex HaplotypeTree::null_vertex;
+constexpr HaplotypeTree::AlleleId HaplotypeTree::null_allele;
+
 HaplotypeTree::HaplotypeTree(const GenomicRegion::ContigName& contig, const ReferenceGenome& reference)
 : reference_ {reference}
-, tree_ {}
-, root_ {boost::add_vertex(tree_)}
-, haplotype_leafs_ {root_}
+, nodes_ {}
+, free_nodes_ {}
+, alleles_ {}
+, allele_counts_ {}
+, free_alleles_ {}
+, allele_ids_ {}
+, root_ {}
+, haplotype_leafs_ {}
 , contig_ {contig}
 , haplotype_leaf_cache_ {}
 , tree_region_ {}
@@ -34,78 +36,7 @@ HaplotypeTree::HaplotypeTree(const GenomicRegion::ContigName& contig, const Refe
         throw std::invalid_argument {"HaplotypeTree: constructed with contig "
             + contig + " which is not in the reference " + reference.name()};
     }
-}
-
-namespace debug {
-
-template <typename G, typename V, typename Container>
-bool is_tree(const G& graph, const V& root, const Container& leafs);
-
-} // namespace debug
-
-namespace {
-
-template <typename Graph>
-bool is_empty(const Graph& g)
-{
-    return boost::num_vertices(g) == 0 && boost::num_edges(g) == 0;
-}
-
-template <typename Graph>
-auto copy_graph(const Graph& src, Graph& dst)
-{
-    assert(is_empty(dst));
-    using Vertex = typename boost::graph_traits<Graph>::vertex_descriptor;
-    std::unordered_map<Vertex, std::size_t> index_map {};
-    index_map.reserve(boost::num_vertices(src));
-    const auto p = boost::vertices(src);
-    std::size_t i {0};
-    std::for_each(p.first, p.second, [&i, &index_map] (const Vertex& v) { index_map.emplace(v, i++); });
-    std::unordered_map<Vertex, Vertex> vertex_copy_map {};
-    vertex_copy_map.reserve(boost::num_vertices(src));
-    boost::copy_graph(src, dst,
-                      boost::vertex_index_map(boost::make_assoc_property_map(index_map))
-                      .orig_to_copy(boost::make_assoc_property_map(vertex_copy_map)));
-    assert(vertex_copy_map.size() == boost::num_vertices(src));
-    return vertex_copy_map;
-}
-
-template <typename Container, typename Map>
-void copy_leafs(const Container& src, Container& dst, const Map& vertex_copy_map)
-{
-    assert(dst.empty());
-    std::transform(std::cbegin(src), std::cend(src), std::back_inserter(dst),
-                   [&vertex_copy_map] (const auto& v) { return vertex_copy_map.at(v); });
-}
-
-} // namespace
-
-HaplotypeTree::HaplotypeTree(const HaplotypeTree& other)
-: reference_ {other.reference_}
-, tree_ {}
-, root_ {}
-, haplotype_leafs_ {}
-, contig_ {other.contig_}
-, haplotype_leaf_cache_ {}
-{
-    const auto vertex_copy_map = copy_graph(other.tree_, tree_);
-    root_ = vertex_copy_map.at(other.root_);
-    copy_leafs(other.haplotype_leafs_, haplotype_leafs_, vertex_copy_map);
-}
-
-HaplotypeTree& HaplotypeTree::operator=(const HaplotypeTree& other)
-{
-    if (&other == this) return *this;
-    tree_.clear();
-    haplotype_leafs_.clear();
-    haplotype_leaf_cache_.clear();
-    reference_ = other.reference_;
-    contig_    = other.contig_;
-    const auto vertex_copy_map = copy_graph(other.tree_, tree_);
-    root_ = vertex_copy_map.at(other.root_);
-    copy_leafs(other.haplotype_leafs_, haplotype_leafs_, vertex_copy_map);
-    assert(debug::is_tree(tree_, root_, haplotype_leafs_));
-    return *this;
+    reset_tree();
 }
 
 bool HaplotypeTree::is_empty() const noexcept
@@ -158,9 +89,17 @@ bool HaplotypeTree::is_unique(const Haplotype& haplotype) const
 
 HaplotypeTree& HaplotypeTree::extend(const ContigAllele& allele)
 {
-    for (auto leaf_itr = std::begin(haplotype_leafs_); leaf_itr != std::end(haplotype_leafs_); ++leaf_itr) {
-        leaf_itr = extend_haplotype(leaf_itr, allele).first;
+    const auto allele_id = intern(allele);
+    std::vector<Vertex> new_leafs {};
+    new_leafs.reserve(2 * haplotype_leafs_.size());
+    for (const auto leaf : haplotype_leafs_) {
+        const auto p = extend_haplotype(leaf, allele_id);
+        // New branches go before the leaf they branch from
+        if (p.second != null_vertex) new_leafs.push_back(p.second);
+        new_leafs.push_back(p.first);
     }
+    haplotype_leafs_ = std::move(new_leafs);
+    release_if_unused(allele_id);
     haplotype_leaf_cache_.clear();
     tree_region_ = boost::none;
     return *this;
@@ -179,61 +118,30 @@ HaplotypeTree& HaplotypeTree::extend(const Haplotype& haplotype)
     if (contig_name(haplotype) != contig_) {
         throw std::domain_error {"HaplotypeTree: trying to extend with Haplotype on different contig"};
     }
-    for (auto leaf_itr = std::begin(haplotype_leafs_); leaf_itr != std::end(haplotype_leafs_); ++leaf_itr) {
-        leaf_itr = extend_haplotype(leaf_itr, haplotype);
+    std::vector<AlleleId> allele_ids {};
+    for (auto p = haplotype.alleles(); p.first != p.second; ++p.first) {
+        allele_ids.push_back(intern(*p.first));
+    }
+    std::vector<Vertex> new_leafs {};
+    new_leafs.reserve(haplotype_leafs_.size());
+    for (const auto leaf : haplotype_leafs_) {
+        extend_haplotype(leaf, allele_ids, new_leafs);
     }
+    haplotype_leafs_ = std::move(new_leafs);
+    for (const auto allele_id : allele_ids) release_if_unused(allele_id);
     haplotype_leaf_cache_.clear();
     tree_region_ = boost::none;
     return *this;
 }
 
-template <typename Container, typename V>
-struct Splicer : public boost::default_dfs_visitor
-{
-    Splicer(const ContigAllele& allele, std::stack<V>& candidate_splice_sites, Container& splice_sites,
-            V root)
-    : allele_ {allele}
-    , candidate_splice_sites_ {candidate_splice_sites}
-    , splice_sites_ {splice_sites}
-    , root_ {root}
-    {}
-    
-    template <typename G>
-    void finish_vertex(const V v, const G& tree)
-    {
-        if (!candidate_splice_sites_.empty() && v == candidate_splice_sites_.top()) {
-            candidate_splice_sites_.pop();
-            if (v == root_ || is_after(allele_.get(), tree[v])) {
-                splice_sites_.push_back(v);
-            } else {
-                const auto u = *boost::inv_adjacent_vertices(v, tree).first;
-                if (candidate_splice_sites_.empty() || candidate_splice_sites_.top() != u) {
-                    candidate_splice_sites_.push(u);
-                }
-            }
-        }
-    }
-private:
-    std::reference_wrapper<const ContigAllele> allele_;
-    std::stack<V>& candidate_splice_sites_;
-    Container& splice_sites_;
-    V root_;
-};
-
-template <typename Container, typename V>
-auto make_splicer(const ContigAllele& allele, std::stack<V>& candidate_splice_sites,
-                  Container& splice_sites, V root)
-{
-    return Splicer<Container, V> {allele, candidate_splice_sites, splice_sites, root};
-}
+namespace {
 
-template <typename V, typename G>
-bool is_possible_splice_site(const ContigAllele& allele, const V& v, const G& tree)
+bool is_possible_splice_site(const ContigAllele& allele, const ContigAllele& site, const bool is_leaf)
 {
-    // Can allele go before v in the tree?
-    return begins_before(allele, tree[v])
-           || (boost::out_degree(v, tree) == 0 && overlaps(allele, tree[v]))
-           || (begins_equal(allele, tree[v]) && (!is_empty_region(tree[v]) || (is_insertion(tree[v]) && is_deletion(allele))));
+    // Can allele go before site in the tree?
+    return begins_before(allele, site)
+           || (is_leaf && overlaps(allele, site))
+           || (begins_equal(allele, site) && (!is_empty_region(site) || (is_insertion(site) && is_deletion(allele))));
 }
 
 bool is_deletion_and_insertion(const ContigAllele& new_allele, const ContigAllele& leaf)
@@ -246,42 +154,68 @@ bool can_add_to_branch(const ContigAllele& new_allele, const ContigAllele& leaf)
     return !are_adjacent(leaf, new_allele) || !is_deletion_and_insertion(new_allele, leaf);
 }
 
+} // namespace
+
 void HaplotypeTree::splice(const ContigAllele& allele)
 {
     if (is_empty()) {
         extend(allele);
         return;
     }
-    std::unordered_map<Vertex, boost::default_color_type> colours {};
-    colours.reserve(boost::num_vertices(tree_));
     std::deque<Vertex> splice_sites {};
     std::stack<Vertex> candidate_splice_sites {};
-    boost::depth_first_visit(tree_, root_,
-                             make_splicer(allele, candidate_splice_sites, splice_sites, root_),
-                             boost::make_assoc_property_map(colours),
-                             [&] (const Vertex v, const Tree& tree) -> bool {
-                                 if (v != root_) {
-                                     if (is_possible_splice_site(allele, v, tree_)) {
-                                         const auto p = boost::inv_adjacent_vertices(v, tree);
-                                         if (p.first != p.second) {
-                                             const auto u = *p.first;
-                                             if (candidate_splice_sites.empty() || candidate_splice_sites.top() != u) {
-                                                 candidate_splice_sites.push(u);
-                                             }
-                                         }
-                                         return true;
-                                     }
-                                 }
-                                 return false;
-                             });
+    const auto push_candidate = [&] (const Vertex u) {
+        if (candidate_splice_sites.empty() || candidate_splice_sites.top() != u) {
+            candidate_splice_sites.push(u);
+        }
+    };
+    // The search does not go below a vertex that allele could be spliced before, but the splice
+    // site is then the nearest ancestor that allele can follow.
+    const auto stop_at = [&] (const Vertex v) {
+        if (v != root_ && is_possible_splice_site(allele, get_allele(v), is_leaf(v))) {
+            push_candidate(get_previous_allele(v));
+            return true;
+        }
+        return false;
+    };
+    const auto finish = [&] (const Vertex v) {
+        if (!candidate_splice_sites.empty() && v == candidate_splice_sites.top()) {
+            candidate_splice_sites.pop();
+            if (v == root_ || is_after(allele, get_allele(v))) {
+                splice_sites.push_back(v);
+            } else {
+                push_candidate(get_previous_allele(v));
+            }
+        }
+    };
+    Vertex v {root_};
+    bool descend {!stop_at(v)};
+    while (true) {
+        if (descend && nodes_[v].first_child != null_vertex) {
+            v = nodes_[v].first_child;
+            descend = !stop_at(v);
+            continue;
+        }
+        finish(v);
+        while (v != root_ && nodes_[v].next_sibling == null_vertex) {
+            v = get_previous_allele(v);
+            finish(v);
+        }
+        if (v == root_) break;
+        v = nodes_[v].next_sibling;
+        descend = !stop_at(v);
+    }
     assert(candidate_splice_sites.empty());
-    for (const auto v : splice_sites) {
-        if (can_add_to_branch(allele, tree_[v])) {
-            const auto spliced = boost::add_vertex(allele, tree_);
-            boost::add_edge(v, spliced, tree_);
+    if (splice_sites.empty()) return;
+    const auto allele_id = intern(allele);
+    for (const auto site : splice_sites) {
+        if (site == root_ || can_add_to_branch(allele, get_allele(site))) {
+            const auto spliced = add_vertex(allele_id);
+            add_edge(site, spliced);
             haplotype_leafs_.push_back(spliced);
         }
     }
+    release_if_unused(allele_id);
     tree_region_ = boost::none;
 }
 
@@ -293,48 +227,21 @@ void HaplotypeTree::splice(const Allele& allele)
     return splice(demote(allele));
 }
 
-namespace {
-
-template <typename InputIterator, typename Compare>
-decltype(auto) min_value(InputIterator first, InputIterator last, Compare comp)
-{
-    auto result = *first;
-    ++first;
-    for (; first != last; ++first) {
-        if (comp(*first, result)) {
-            result = *first;
-        }
-    }
-    return result;
-}
-
-template <typename InputIterator, typename Compare>
-decltype(auto) max_value(InputIterator first, InputIterator last, Compare comp)
-{
-    auto result = *first;
-    ++first;
-    for (; first != last; ++first) {
-        if (comp(result, *first)) {
-            result = *first;
-        }
-    }
-    return result;
-}
-
-} // namespace
-
 GenomicRegion HaplotypeTree::encompassing_region() const
 {
     if (tree_region_) return *tree_region_;
     if (is_empty()) {
         throw std::runtime_error {"HaplotypeTree::encompassing_region called on empty tree"};
     }
-    const auto p = boost::adjacent_vertices(root_, tree_);
-    const auto leftmost = min_value(p.first, p.second, [this] (const auto& lhs, const auto& rhs) {
-                                    return begins_before(tree_[lhs], tree_[rhs]); });
-    const auto rightmost = max_value(std::cbegin(haplotype_leafs_), std::cend(haplotype_leafs_),
-                                    [this] (const auto& lhs, const auto& rhs) { return ends_before(tree_[lhs], tree_[rhs]); });
-    tree_region_ = GenomicRegion {contig_, octopus::encompassing_region(tree_[leftmost], tree_[rightmost])};
+    auto leftmost = nodes_[root_].first_child;
+    for (auto v = nodes_[leftmost].next_sibling; v != null_vertex; v = nodes_[v].next_sibling) {
+        if (begins_before(get_allele(v), get_allele(leftmost))) leftmost = v;
+    }
+    auto rightmost = haplotype_leafs_.front();
+    for (const auto leaf : haplotype_leafs_) {
+        if (ends_before(get_allele(rightmost), get_allele(leaf))) rightmost = leaf;
+    }
+    tree_region_ = GenomicRegion {contig_, octopus::encompassing_region(get_allele(leftmost), get_allele(rightmost))};
     return *tree_region_;
 }
 
@@ -356,12 +263,103 @@ HaplotypeTree::extract_haplotypes(const GenomicRegion& region) const
     HaplotypeBlock result {region};
     if (is_empty() || !overlaps(region, encompassing_region())) return result;
     result.reserve(num_haplotypes());
-    for (const auto leaf : haplotype_leafs_) {
-        auto haplotype = extract_haplotype(leaf, region);
+    constexpr auto no_slot = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> leaf_slots(nodes_.size(), no_slot);
+    for (std::size_t slot {0}; slot < haplotype_leafs_.size(); ++slot) {
+        if (leaf_slots[haplotype_leafs_[slot]] == no_slot) leaf_slots[haplotype_leafs_[slot]] = slot;
+    }
+    // The haplotype of a leaf is made from the last run of alleles contained in the region on the
+    // path from the root to the leaf. A depth first search keeps the explicit alleles of the runs on
+    // the current path, with the reference between them, and their sequence, so leafs sharing a
+    // prefix share its sequence, which is only copied when a leaf is reached. Every reference gap is
+    // in the region, so the reference is only fetched once.
+    const auto& region_contig = region.contig_region();
+    const auto reference_sequence = reference_.get().fetch_sequence(region);
+    const auto reference_substr = [&] (const ContigRegion& gap) {
+        return reference_sequence.substr(gap.begin() - region.begin(), region_size(gap));
+    };
+    struct PathVertex
+    {
+        Vertex vertex;
+        std::size_t num_alleles, sequence_size, run_allele_begin, run_sequence_begin;
+        bool is_contained, has_run;
+    };
+    std::vector<PathVertex> path {};
+    std::vector<ContigAllele> run_alleles {};
+    Haplotype::NucleotideSequence run_sequence {};
+    std::vector<boost::optional<Haplotype>> haplotypes(haplotype_leafs_.size());
+    const auto visit = [&] (const Vertex v) {
+        PathVertex state {v, run_alleles.size(), run_sequence.size(), 0, 0, false, false};
+        if (!path.empty()) {
+            state.run_allele_begin = path.back().run_allele_begin;
+            state.run_sequence_begin = path.back().run_sequence_begin;
+            state.has_run = path.back().has_run;
+        }
+        if (v != root_ && octopus::contains(region_contig, get_allele(v))) {
+            const auto& allele = get_allele(v);
+            if (path.back().is_contained) {
+                assert(is_after(allele, run_alleles.back()));
+                if (!are_adjacent(run_alleles.back(), allele)) {
+                    const auto gap = *intervening_region(run_alleles.back(), allele);
+                    run_alleles.emplace_back(gap, reference_substr(gap));
+                    run_sequence += run_alleles.back().sequence();
+                }
+            } else {
+                state.run_allele_begin = run_alleles.size();
+                state.run_sequence_begin = run_sequence.size();
+            }
+            run_alleles.push_back(allele);
+            run_sequence += allele.sequence();
+            state.is_contained = state.has_run = true;
+        }
+        path.push_back(state);
+        if (leaf_slots[v] != no_slot) {
+            if (state.has_run) {
+                std::vector<ContigAllele> alleles {std::next(std::cbegin(run_alleles), state.run_allele_begin), std::cend(run_alleles)};
+                const auto allele_region = octopus::encompassing_region(alleles.front(), alleles.back());
+                const auto lhs_reference_region = left_overhang_region(region_contig, allele_region);
+                const auto rhs_reference_region = right_overhang_region(region_contig, allele_region);
+                Haplotype::NucleotideSequence sequence {};
+                sequence.reserve(region_size(lhs_reference_region) + (run_sequence.size() - state.run_sequence_begin)
+                                 + region_size(rhs_reference_region));
+                sequence += reference_substr(lhs_reference_region);
+                sequence.append(run_sequence, state.run_sequence_begin, std::string::npos);
+                sequence += reference_substr(rhs_reference_region);
+                haplotypes[leaf_slots[v]] = Haplotype {region, std::move(alleles), std::move(sequence), reference_};
+            } else {
+                haplotypes[leaf_slots[v]] = Haplotype {region, {}, reference_sequence, reference_};
+            }
+        }
+    };
+    const auto backtrack = [&] () {
+        run_alleles.erase(std::next(std::cbegin(run_alleles), path.back().num_alleles), std::cend(run_alleles));
+        run_sequence.resize(path.back().sequence_size);
+        path.pop_back();
+    };
+    Vertex v {root_};
+    visit(v);
+    while (true) {
+        if (nodes_[v].first_child != null_vertex) {
+            v = nodes_[v].first_child;
+            visit(v);
+            continue;
+        }
+        while (v != root_ && nodes_[v].next_sibling == null_vertex) {
+            backtrack();
+            v = path.back().vertex;
+        }
+        if (v == root_) break;
+        backtrack();
+        v = nodes_[v].next_sibling;
+        visit(v);
+    }
+    for (std::size_t slot {0}; slot < haplotype_leafs_.size(); ++slot) {
+        // A leaf listed more than once is only reached by the search once
+        if (!haplotypes[slot]) haplotypes[slot] = extract_haplotype(haplotype_leafs_[slot], region);
         // recently retreived haplotypes are added to the cache as it is likely these
         // are the haplotypes that will be pruned next
-        haplotype_leaf_cache_.emplace(haplotype, leaf);
-        result.push_back(std::move(haplotype));
+        haplotype_leaf_cache_.emplace(*haplotypes[slot], haplotype_leafs_[slot]);
+        result.push_back(std::move(*haplotypes[slot]));
     }
     return result;
 }
@@ -386,7 +384,6 @@ std::vector<HaplotypeTree::HaplotypeLength> HaplotypeTree::extract_haplotype_len
 
 void HaplotypeTree::prune_all(const Haplotype& haplotype)
 {
-    using std::cbegin; using std::cend; using std::for_each; using std::find;
     if (is_empty() || contig_name(haplotype) != contig_) return;
     // If any of the haplotypes in cache match the query haplotype then the cache must contain
     // all possible leaves corrosponding to that haplotype. So we don't need to look through
@@ -394,33 +391,34 @@ void HaplotypeTree::prune_all(const Haplotype& haplotype)
     tree_region_ = boost::none;
     if (haplotype_leaf_cache_.count(haplotype) > 0) {
         const auto possible_leafs = haplotype_leaf_cache_.equal_range(haplotype);
-        for_each(possible_leafs.first, possible_leafs.second,
-                 [this, &haplotype] (const HaplotypeVertexMultiMap::value_type& leaf_pair) {
-                     const auto p = clear(leaf_pair.second, contig_region(haplotype));
-                     auto leaf_itr = find(cbegin(haplotype_leafs_), cend(haplotype_leafs_), leaf_pair.second);
-                     leaf_itr = haplotype_leafs_.erase(leaf_itr);
-                     if (p.second) {
-                         haplotype_leafs_.insert(leaf_itr, p.first);
-                     }
-                 });
+        std::unordered_map<Vertex, std::pair<Vertex, bool>> replacements {};
+        std::for_each(possible_leafs.first, possible_leafs.second,
+                      [this, &haplotype, &replacements] (const HaplotypeVertexMultiMap::value_type& leaf_pair) {
+                          replacements.emplace(leaf_pair.second, clear(leaf_pair.second, contig_region(haplotype)));
+                      });
+        replace_leafs(replacements);
         haplotype_leaf_cache_.erase(haplotype);
     } else {
-        auto leaf_itr = cbegin(haplotype_leafs_);
-        while (true) {
-            leaf_itr = find_equal_haplotype_leaf(leaf_itr, cend(haplotype_leafs_), haplotype);
-            if (leaf_itr == cend(haplotype_leafs_)) return;
-            const auto p = clear(*leaf_itr, contig_region(haplotype));
-            leaf_itr = haplotype_leafs_.erase(leaf_itr);
-            if (p.second) {
-                leaf_itr = haplotype_leafs_.insert(leaf_itr, p.first);
+        std::size_t num_kept {0};
+        for (auto leaf : haplotype_leafs_) {
+            bool keep {true};
+            // A leaf exposed by clearing another may define the same haplotype
+            while (is_branch_equal_haplotype(leaf, haplotype)) {
+                const auto p = clear(leaf, contig_region(haplotype));
+                if (!p.second) {
+                    keep = false;
+                    break;
+                }
+                leaf = p.first;
             }
+            if (keep) haplotype_leafs_[num_kept++] = leaf;
         }
+        haplotype_leafs_.resize(num_kept);
     }
 }
 
 void HaplotypeTree::prune_unique(const Haplotype& haplotype)
 {
-    using std::cbegin; using std::cend; using std::for_each;
     if (is_empty()) return;
     tree_region_ = boost::none;
     if (haplotype_leaf_cache_.count(haplotype) > 0) {
@@ -432,34 +430,37 @@ void HaplotypeTree::prune_unique(const Haplotype& haplotype)
         if (match_itr == possible_leafs.second) {
             throw std::runtime_error {"HaplotypeTree::prune_unique called with matching Haplotype not in tree"};
         }
-        const auto leaf_to_keep_itr = match_itr->second;
+        const auto leaf_to_keep = match_itr->second;
+        std::unordered_map<Vertex, std::pair<Vertex, bool>> replacements {};
         std::for_each(possible_leafs.first, possible_leafs.second,
-                      [this, &haplotype, leaf_to_keep_itr] (HaplotypeVertexMultiMap::value_type& leaf_pair) {
-                          if (leaf_pair.second != leaf_to_keep_itr) {
-                              const auto p = clear(leaf_pair.second, contig_region(haplotype));
-                              auto leaf_itr = std::find(cbegin(haplotype_leafs_), cend(haplotype_leafs_), leaf_pair.second);
-                              leaf_itr = haplotype_leafs_.erase(leaf_itr);
-                              if (p.second) haplotype_leafs_.insert(leaf_itr, p.first);
+                      [this, &haplotype, &replacements, leaf_to_keep] (const HaplotypeVertexMultiMap::value_type& leaf_pair) {
+                          if (leaf_pair.second != leaf_to_keep) {
+                              replacements.emplace(leaf_pair.second, clear(leaf_pair.second, contig_region(haplotype)));
                           }
                       });
+        replace_leafs(replacements);
         haplotype_leaf_cache_.erase(haplotype);
-        haplotype_leaf_cache_.emplace(haplotype, leaf_to_keep_itr);
+        haplotype_leaf_cache_.emplace(haplotype, leaf_to_keep);
     } else {
-        auto leaf_itr = cbegin(haplotype_leafs_);
-        const auto leaf_to_keep_itr = find_exact_haplotype_leaf(leaf_itr, cend(haplotype_leafs_), haplotype);
-        while (true) {
-            leaf_itr = find_equal_haplotype_leaf(leaf_itr, cend(haplotype_leafs_), haplotype);
-            if (leaf_itr == cend(haplotype_leafs_)) {
-                return;
-            }
-            if (leaf_itr == leaf_to_keep_itr) {
-                std::advance(leaf_itr, 1);
-                continue;
+        const auto leaf_to_keep_itr = find_exact_haplotype_leaf(std::cbegin(haplotype_leafs_), std::cend(haplotype_leafs_), haplotype);
+        const auto leaf_to_keep_idx = static_cast<std::size_t>(std::distance(std::cbegin(haplotype_leafs_), leaf_to_keep_itr));
+        std::size_t num_kept {0};
+        for (std::size_t idx {0}; idx < haplotype_leafs_.size(); ++idx) {
+            auto leaf = haplotype_leafs_[idx];
+            bool keep {true};
+            if (idx != leaf_to_keep_idx) {
+                while (is_branch_equal_haplotype(leaf, haplotype)) {
+                    const auto p = clear(leaf, contig_region(haplotype));
+                    if (!p.second) {
+                        keep = false;
+                        break;
+                    }
+                    leaf = p.first;
+                }
             }
-            const auto p = clear(*leaf_itr, contig_region(haplotype));
-            leaf_itr = haplotype_leafs_.erase(leaf_itr);
-            if (p.second) leaf_itr = haplotype_leafs_.insert(leaf_itr, p.first);
+            if (keep) haplotype_leafs_[num_kept++] = leaf;
         }
+        haplotype_leafs_.resize(num_kept);
     }
 }
 
@@ -477,20 +478,21 @@ void HaplotypeTree::clear(const GenomicRegion& region)
 void HaplotypeTree::clear() noexcept
 {
     haplotype_leaf_cache_.clear();
-    haplotype_leafs_.clear();
-    tree_.clear();
-    root_ = boost::add_vertex(tree_);
-    haplotype_leafs_.push_back(root_);
+    reset_tree();
     tree_region_ = boost::none;
 }
 
 void HaplotypeTree::write_dot(std::ostream& out) const
 {
-    const auto vertex_writer = [this] (std::ostream& out, const Vertex v) {
-        const Allele allele {GenomicRegion {contig_, tree_[v].mapped_region()}, tree_[v].sequence()};
+    out << "digraph G {" << std::endl;
+    out << "rankdir=LR" << std::endl;
+    for (Vertex v {0}; v < nodes_.size(); ++v) {
+        if (v != root_ && nodes_[v].parent == null_vertex) continue; // free
+        out << v;
         if (v == root_) {
             out << " [shape=circle,color=black]" << std::endl;
         } else {
+            const Allele allele {GenomicRegion {contig_, get_allele(v).mapped_region()}, get_allele(v).sequence()};
             if (is_reference(allele, reference_.get())) {
                 out << " [shape=box,color=gray]" << std::endl;
             } else {
@@ -508,62 +510,164 @@ void HaplotypeTree::write_dot(std::ostream& out) const
             }
             out << " [label=\"" << allele << "\"]" << std::endl;
         }
-    };
-    const auto edge_writer = [] (std::ostream& out, const Edge e) {
-        out << "[color=black]" << std::endl;
-    };
-    const auto graph_writer = [] (std::ostream& out) {
-        out << "rankdir=LR" << std::endl;
-    };
-    std::unordered_map<Vertex, std::size_t> vertex_ids {};
-    vertex_ids.reserve(boost::num_vertices(tree_));
-    const auto p = boost::vertices(tree_); std::size_t idx {0};
-    std::for_each(p.first, p.second, [&] (Vertex v) { vertex_ids.emplace(v, idx++); });
-    boost::write_graphviz(out, tree_, vertex_writer, edge_writer, graph_writer, boost::make_assoc_property_map(vertex_ids));
+        out << ";" << std::endl;
+    }
+    for (Vertex v {0}; v < nodes_.size(); ++v) {
+        if (v != root_ && nodes_[v].parent != null_vertex) {
+            out << nodes_[v].parent << "->" << v << " [color=black]" << std::endl << ";" << std::endl;
+        }
+    }
+    out << "}" << std::endl;
 }
 
 // Private methods
 
+HaplotypeTree::AlleleId HaplotypeTree::intern(const ContigAllele& allele)
+{
+    const auto itr = allele_ids_.find(allele);
+    if (itr != std::cend(allele_ids_)) return itr->second;
+    AlleleId result;
+    if (free_alleles_.empty()) {
+        result = static_cast<AlleleId>(alleles_.size());
+        alleles_.push_back(allele);
+        allele_counts_.push_back(0);
+    } else {
+        result = free_alleles_.back();
+        free_alleles_.pop_back();
+        alleles_[result] = allele;
+        allele_counts_[result] = 0;
+    }
+    allele_ids_.emplace(allele, result);
+    return result;
+}
+
+void HaplotypeTree::release_if_unused(const AlleleId allele)
+{
+    if (allele_counts_[allele] == 0 && allele_ids_.erase(alleles_[allele]) > 0) {
+        free_alleles_.push_back(allele);
+    }
+}
+
+const ContigAllele& HaplotypeTree::get_allele(const Vertex v) const noexcept
+{
+    assert(nodes_[v].allele != null_allele);
+    return alleles_[nodes_[v].allele];
+}
+
+std::size_t HaplotypeTree::num_vertices() const noexcept
+{
+    return nodes_.size() - free_nodes_.size();
+}
+
+HaplotypeTree::Vertex HaplotypeTree::add_vertex(const AlleleId allele)
+{
+    const Node node {allele, null_vertex, null_vertex, null_vertex, null_vertex, null_vertex, 0};
+    if (allele != null_allele) ++allele_counts_[allele];
+    if (free_nodes_.empty()) {
+        nodes_.push_back(node);
+        return static_cast<Vertex>(nodes_.size() - 1);
+    } else {
+        const auto result = free_nodes_.back();
+        free_nodes_.pop_back();
+        nodes_[result] = node;
+        return result;
+    }
+}
+
+void HaplotypeTree::add_edge(const Vertex u, const Vertex v) noexcept
+{
+    assert(nodes_[v].parent == null_vertex);
+    auto& parent = nodes_[u];
+    auto& child = nodes_[v];
+    child.parent = u;
+    child.prev_sibling = parent.last_child;
+    child.next_sibling = null_vertex;
+    if (parent.last_child != null_vertex) {
+        nodes_[parent.last_child].next_sibling = v;
+    } else {
+        parent.first_child = v;
+    }
+    parent.last_child = v;
+    ++parent.num_children;
+}
+
+void HaplotypeTree::remove_edge(const Vertex u, const Vertex v) noexcept
+{
+    assert(nodes_[v].parent == u);
+    auto& parent = nodes_[u];
+    auto& child = nodes_[v];
+    if (child.prev_sibling != null_vertex) {
+        nodes_[child.prev_sibling].next_sibling = child.next_sibling;
+    } else {
+        parent.first_child = child.next_sibling;
+    }
+    if (child.next_sibling != null_vertex) {
+        nodes_[child.next_sibling].prev_sibling = child.prev_sibling;
+    } else {
+        parent.last_child = child.prev_sibling;
+    }
+    --parent.num_children;
+    child.parent = child.prev_sibling = child.next_sibling = null_vertex;
+}
+
+void HaplotypeTree::remove_vertex(const Vertex v)
+{
+    assert(v != root_ && nodes_[v].parent == null_vertex && nodes_[v].num_children == 0);
+    const auto allele = nodes_[v].allele;
+    if (--allele_counts_[allele] == 0) release_if_unused(allele);
+    free_nodes_.push_back(v);
+}
+
+void HaplotypeTree::reset_tree()
+{
+    nodes_.clear();
+    free_nodes_.clear();
+    alleles_.clear();
+    allele_counts_.clear();
+    free_alleles_.clear();
+    allele_ids_.clear();
+    root_ = add_vertex(null_allele);
+    haplotype_leafs_.assign({root_});
+}
+
 HaplotypeTree::Vertex HaplotypeTree::get_previous_allele(const Vertex allele) const
 {
     assert(allele != root_);
-    const auto p = boost::inv_adjacent_vertices(allele, tree_);
-    assert(std::distance(p.first, p.second) == 1);
-    return *p.first;
+    assert(nodes_[allele].parent != null_vertex);
+    return nodes_[allele].parent;
 }
 
 bool HaplotypeTree::is_leaf(const Vertex v) const
 {
-    return boost::out_degree(v, tree_) == 0;
+    return nodes_[v].num_children == 0;
 }
 
 bool HaplotypeTree::is_bifurcating(const Vertex v) const
 {
-    return boost::out_degree(v, tree_) > 1;
+    return nodes_[v].num_children > 1;
 }
 
 HaplotypeTree::Vertex HaplotypeTree::remove_forward(const Vertex u)
 {
-    const auto p = boost::adjacent_vertices(u, tree_);
-    assert(std::distance(p.first, p.second) == 1);
-    const auto v = *p.first;
-    boost::remove_edge(u, v, tree_);
-    boost::remove_vertex(u, tree_);
+    assert(nodes_[u].num_children == 1);
+    const auto v = nodes_[u].first_child;
+    remove_edge(u, v);
+    remove_vertex(u);
     return v;
 }
 
 HaplotypeTree::Vertex HaplotypeTree::remove_backward(const Vertex v)
 {
     const auto u = get_previous_allele(v);
-    boost::remove_edge(u, v, tree_);
-    boost::remove_vertex(v, tree_);
+    remove_edge(u, v);
+    remove_vertex(v);
     return u;
 }
 
 HaplotypeTree::Vertex HaplotypeTree::find_allele_before(Vertex v, const ContigAllele& allele) const
 {
-    while (v != root_ && !is_before(tree_[v], allele)) {
-        if (is_same_region(allele, tree_[v])) { // for insertions
+    while (v != root_ && !is_before(get_allele(v), allele)) {
+        if (is_same_region(allele, get_allele(v))) { // for insertions
             v = get_previous_allele(v);
             break;
         }
@@ -572,11 +676,11 @@ HaplotypeTree::Vertex HaplotypeTree::find_allele_before(Vertex v, const ContigAl
     return v;
 }
 
-HaplotypeTree::Vertex HaplotypeTree::find_allele_on_branch(const LeafIterator leaf, const ContigAllele& allele) const
+HaplotypeTree::Vertex HaplotypeTree::find_allele_on_branch(const Vertex leaf, const AlleleId allele) const
 {
-    Vertex v {*leaf};
-    while (v != root_ && !begins_before(tree_[v], allele)) {
-        if (allele == tree_[v]) {
+    Vertex v {leaf};
+    while (v != root_ && !begins_before(get_allele(v), alleles_[allele])) {
+        if (nodes_[v].allele == allele) {
             return v;
         }
         v = get_previous_allele(v);
@@ -584,80 +688,80 @@ HaplotypeTree::Vertex HaplotypeTree::find_allele_on_branch(const LeafIterator le
     return root_;
 }
 
-bool HaplotypeTree::allele_exists(const Vertex leaf, const ContigAllele& allele) const
+bool HaplotypeTree::allele_exists(const Vertex leaf, const AlleleId allele) const
 {
-    const auto p = boost::adjacent_vertices(leaf, tree_);
-    return std::any_of(p.first, p.second, [this, &allele] (const Vertex v) { return tree_[v] == allele; });
+    for (auto v = nodes_[leaf].first_child; v != null_vertex; v = nodes_[v].next_sibling) {
+        if (nodes_[v].allele == allele) return true;
+    }
+    return false;
 }
 
-std::pair<HaplotypeTree::LeafIterator, bool>
-HaplotypeTree::extend_haplotype(LeafIterator leaf_itr, const ContigAllele& new_allele)
+std::pair<HaplotypeTree::Vertex, HaplotypeTree::Vertex>
+HaplotypeTree::extend_haplotype(Vertex leaf, const AlleleId new_allele_id)
 {
-    bool added {false};
-    if (*leaf_itr == root_) {
-        const auto new_leaf = boost::add_vertex(new_allele, tree_);
-        boost::add_edge(*leaf_itr, new_leaf, tree_);
-        leaf_itr = haplotype_leafs_.erase(leaf_itr);
-        leaf_itr = haplotype_leafs_.insert(leaf_itr, new_leaf);
-        added = true;
+    const auto& new_allele = alleles_[new_allele_id];
+    Vertex branch {null_vertex};
+    if (leaf == root_) {
+        const auto new_leaf = add_vertex(new_allele_id);
+        add_edge(leaf, new_leaf);
+        leaf = new_leaf;
     } else {
-        const auto& leaf_allele = tree_[*leaf_itr];
+        const auto& leaf_allele = get_allele(leaf);
         if (can_add_to_branch(new_allele, leaf_allele)) {
             if (is_after(new_allele, leaf_allele)) {
-                const auto new_leaf = boost::add_vertex(new_allele, tree_);
-                boost::add_edge(*leaf_itr, new_leaf, tree_);
-                *leaf_itr = new_leaf;
-                added = true;
+                const auto new_leaf = add_vertex(new_allele_id);
+                add_edge(leaf, new_leaf);
+                leaf = new_leaf;
             } else if (overlaps(new_allele, leaf_allele)) {
-                const auto branch_point = find_allele_before(*leaf_itr, new_allele);
-                if ((branch_point == root_ || can_add_to_branch(new_allele, tree_[branch_point]))
-                    && !allele_exists(branch_point, new_allele)) {
-                    const auto new_leaf = boost::add_vertex(new_allele, tree_);
-                    boost::add_edge(branch_point, new_leaf, tree_);
-                    haplotype_leafs_.insert(leaf_itr, new_leaf);
-                    added = true;
+                const auto branch_point = find_allele_before(leaf, new_allele);
+                if ((branch_point == root_ || can_add_to_branch(new_allele, get_allele(branch_point)))
+                    && !allele_exists(branch_point, new_allele_id)) {
+                    branch = add_vertex(new_allele_id);
+                    add_edge(branch_point, branch);
                 }
             }
         }
     }
-    return std::make_pair(leaf_itr, added);
+    return std::make_pair(leaf, branch);
 }
 
-HaplotypeTree::LeafIterator
-HaplotypeTree::extend_haplotype(LeafIterator leaf_itr, const Haplotype& haplotype)
+void HaplotypeTree::extend_haplotype(const Vertex leaf, const std::vector<AlleleId>& alleles, std::vector<Vertex>& new_leafs)
 {
-    for (auto p = haplotype.alleles(); p.first != p.second; ++p.first) {
-        const auto& allele = *p.first;
-        if (*leaf_itr == root_ || is_after(allele, tree_[*leaf_itr])) {
-            const auto new_leaf = boost::add_vertex(allele, tree_);
-            boost::add_edge(*leaf_itr, new_leaf, tree_);
-            *leaf_itr = new_leaf;
+    new_leafs.push_back(leaf);
+    // Alleles that can't follow the current leaf start a new branch, which becomes the current leaf
+    auto current_leaf = new_leafs.size() - 1;
+    for (const auto allele_id : alleles) {
+        const auto& allele = alleles_[allele_id];
+        if (new_leafs[current_leaf] == root_ || is_after(allele, get_allele(new_leafs[current_leaf]))) {
+            const auto new_leaf = add_vertex(allele_id);
+            add_edge(new_leafs[current_leaf], new_leaf);
+            new_leafs[current_leaf] = new_leaf;
         } else {
-            const auto existing = find_allele_on_branch(leaf_itr, allele);
+            const auto existing = find_allele_on_branch(new_leafs[current_leaf], allele_id);
             if (existing == root_) {
-                const auto branch_point = find_allele_before(*leaf_itr, allele);
-                if (allele_exists(branch_point, allele)) return leaf_itr;
-                if ((branch_point == root_ || can_add_to_branch(allele, tree_[branch_point]))) {
-                    const auto new_leaf = boost::add_vertex(allele, tree_);
-                    boost::add_edge(branch_point, new_leaf, tree_);
-                    leaf_itr = haplotype_leafs_.insert(std::next(leaf_itr), new_leaf);
+                const auto branch_point = find_allele_before(new_leafs[current_leaf], allele);
+                if (allele_exists(branch_point, allele_id)) return;
+                if ((branch_point == root_ || can_add_to_branch(allele, get_allele(branch_point)))) {
+                    const auto new_leaf = add_vertex(allele_id);
+                    add_edge(branch_point, new_leaf);
+                    new_leafs.push_back(new_leaf);
+                    current_leaf = new_leafs.size() - 1;
                 }
             }
         }
-    };
-    return leaf_itr;
+    }
 }
 
 Haplotype HaplotypeTree::extract_haplotype(Vertex leaf, const GenomicRegion& region) const
 {
     const auto& contig_region = region.contig_region();
     using octopus::contains;
-    while (leaf != root_ && !contains(contig_region, tree_[leaf])) {
+    while (leaf != root_ && !contains(contig_region, get_allele(leaf))) {
         leaf = get_previous_allele(leaf);
     }
     Haplotype::Builder result {region, reference_};
-    while (leaf != root_ && contains(contig_region, tree_[leaf])) {
-        result.push_front(tree_[leaf]);
+    while (leaf != root_ && contains(contig_region, get_allele(leaf))) {
+        result.push_front(get_allele(leaf));
         leaf = get_previous_allele(leaf);
     }
     return result.build();
@@ -667,25 +771,25 @@ HaplotypeTree::HaplotypeLength HaplotypeTree::extract_haplotype_length(Vertex le
 {
     const auto& contig_region = region.contig_region();
     using octopus::contains;
-    while (leaf != root_ && !contains(contig_region, tree_[leaf])) {
+    while (leaf != root_ && !contains(contig_region, get_allele(leaf))) {
         leaf = get_previous_allele(leaf);
     }
     if (leaf == root_) {
         return size(contig_region);
     }
-    HaplotypeLength result {right_overhang_size(contig_region, tree_[leaf])};
+    HaplotypeLength result {right_overhang_size(contig_region, get_allele(leaf))};
     auto prev_node = leaf;
     while (true) {
-        result += sequence_size(tree_[leaf]);
+        result += sequence_size(get_allele(leaf));
         prev_node = leaf;
         leaf = get_previous_allele(leaf);
-        if (leaf != root_ && contains(contig_region, tree_[leaf])) {
-            result += inner_distance(tree_[leaf], tree_[prev_node]);
+        if (leaf != root_ && contains(contig_region, get_allele(leaf))) {
+            result += inner_distance(get_allele(leaf), get_allele(prev_node));
         } else {
             break;
         }
     }
-    result += left_overhang_size(contig_region, tree_[prev_node]);
+    result += left_overhang_size(contig_region, get_allele(prev_node));
     return result;
 }
 
@@ -695,7 +799,7 @@ bool HaplotypeTree::define_same_haplotype(Vertex leaf1, Vertex leaf2) const
         return true;
     }
     while (leaf1 != root_) {
-        if (leaf2 == root_ || tree_[leaf1] != tree_[leaf2]) return false;
+        if (leaf2 == root_ || nodes_[leaf1].allele != nodes_[leaf2].allele) return false;
         leaf1 = get_previous_allele(leaf1);
         leaf2 = get_previous_allele(leaf2);
     }
@@ -704,13 +808,13 @@ bool HaplotypeTree::define_same_haplotype(Vertex leaf1, Vertex leaf2) const
 
 bool HaplotypeTree::is_branch_exact_haplotype(Vertex leaf, const Haplotype& haplotype) const
 {
-    return leaf != root_ && overlaps(contig_region(haplotype), tree_[leaf])
+    return leaf != root_ && overlaps(contig_region(haplotype), get_allele(leaf))
             && have_same_alleles(extract_haplotype(leaf, haplotype.mapped_region()), haplotype);
 }
 
 bool HaplotypeTree::is_branch_equal_haplotype(const Vertex leaf, const Haplotype& haplotype) const
 {
-    return leaf != root_ && overlaps(contig_region(haplotype), tree_[leaf])
+    return leaf != root_ && overlaps(contig_region(haplotype), get_allele(leaf))
             && extract_haplotype(leaf, haplotype.mapped_region()) == haplotype;
 }
 
@@ -724,20 +828,26 @@ HaplotypeTree::find_exact_haplotype_leaf(const LeafConstIterator first, const Le
                         });
 }
 
-HaplotypeTree::LeafConstIterator
-HaplotypeTree::find_equal_haplotype_leaf(const LeafConstIterator first, const LeafConstIterator last,
-                                         const Haplotype& haplotype) const
+template <typename Map>
+void HaplotypeTree::replace_leafs(const Map& replacements)
 {
-    return std::find_if(first, last,
-                        [this, &haplotype] (Vertex leaf) {
-                            return is_branch_equal_haplotype(leaf, haplotype);
-                        });
+    std::size_t num_kept {0};
+    for (const auto leaf : haplotype_leafs_) {
+        const auto itr = replacements.find(leaf);
+        if (itr == std::cend(replacements)) {
+            haplotype_leafs_[num_kept++] = leaf;
+        } else if (itr->second.second) {
+            haplotype_leafs_[num_kept++] = itr->second.first;
+        }
+    }
+    haplotype_leafs_.resize(num_kept);
 }
 
 void HaplotypeTree::clear_overlapped(const ContigRegion& region)
 {
     haplotype_leaf_cache_.clear();
-    std::list<Vertex> new_leafs {};
+    std::vector<Vertex> new_leafs {};
+    new_leafs.reserve(haplotype_leafs_.size());
     for (const Vertex leaf : haplotype_leafs_) {
         const auto p = clear(leaf, region);
         if (p.second) new_leafs.push_back(p.first);
@@ -751,7 +861,7 @@ void HaplotypeTree::clear_overlapped(const ContigRegion& region)
 std::pair<HaplotypeTree::Vertex, bool>
 HaplotypeTree::clear(const Vertex leaf, const ContigRegion& region)
 {
-    if (overlaps(region, tree_[leaf])) {
+    if (overlaps(region, get_allele(leaf))) {
         return clear_external(leaf, region);
     } else {
         return clear_internal(leaf, region);
@@ -763,16 +873,16 @@ HaplotypeTree::clear_external(Vertex leaf, const ContigRegion& region)
 {
     assert(is_leaf(leaf));
     while (leaf != root_) {
-        if (boost::out_degree(leaf, tree_) > 0) {
+        if (!is_leaf(leaf)) {
             return std::make_pair(leaf, false);
-        } else if (begins_before(tree_[leaf], region)) {
+        } else if (begins_before(get_allele(leaf), region)) {
             return std::make_pair(leaf, true);
         } else {
             leaf = remove_backward(leaf);
         }
     }
     // the root should only be indicated as a leaf node if there are no other nodes in the tree
-    return std::make_pair(leaf, boost::num_vertices(tree_) == 1);
+    return std::make_pair(leaf, num_vertices() == 1);
 }
 
 std::pair<HaplotypeTree::Vertex, bool>
@@ -780,7 +890,7 @@ HaplotypeTree::clear_internal(const Vertex leaf, const ContigRegion& region)
 {
     assert(is_leaf(leaf));
     // TODO: we can optimise this for cases where region overlaps the leftmost alleles in the tree
-    if (leaf == root_ || is_after(region, tree_[leaf])) {
+    if (leaf == root_ || is_after(region, get_allele(leaf))) {
         return std::make_pair(leaf, true);
     }
     Vertex current_allele {leaf}, allele_to_move {leaf};
@@ -788,7 +898,7 @@ HaplotypeTree::clear_internal(const Vertex leaf, const ContigRegion& region)
     bool is_bifurcating_branch {false};
     while (true) {
         current_allele = get_previous_allele(current_allele);
-        if (current_allele == root_ || overlaps(tree_[current_allele], region)) {
+        if (current_allele == root_ || overlaps(get_allele(current_allele), region)) {
             break;
         }
         is_bifurcating_branch = is_bifurcating_branch || is_bifurcating(current_allele);
@@ -799,26 +909,26 @@ HaplotypeTree::clear_internal(const Vertex leaf, const ContigRegion& region)
         }
     }
     if (alleles_to_copy.empty()) {
-        boost::remove_edge(current_allele, allele_to_move, tree_);
+        remove_edge(current_allele, allele_to_move);
     } else {
         assert(alleles_to_copy.back() != allele_to_move);
-        boost::remove_edge(alleles_to_copy.back(), allele_to_move, tree_);
+        remove_edge(alleles_to_copy.back(), allele_to_move);
     }
-    while (current_allele != root_ && overlaps(region, tree_[current_allele])) {
+    while (current_allele != root_ && overlaps(region, get_allele(current_allele))) {
         const auto previous_allele = get_previous_allele(current_allele);
-        is_bifurcating_branch = is_bifurcating_branch || boost::out_degree(current_allele, tree_) > 0;
+        is_bifurcating_branch = is_bifurcating_branch || !is_leaf(current_allele);
         if (!is_bifurcating_branch) {
-            assert(boost::out_degree(current_allele, tree_) <= 1);
-            boost::remove_edge(previous_allele, current_allele, tree_);
-            boost::remove_vertex(current_allele, tree_);
+            assert(is_leaf(current_allele));
+            remove_edge(previous_allele, current_allele);
+            remove_vertex(current_allele);
         }
         current_allele = previous_allele;
     }
     // Simpler to prepend onto the movable branch and then call that moveable than treat each separately
     std::for_each(std::crbegin(alleles_to_copy), std::crend(alleles_to_copy),
                   [this, &allele_to_move] (const Vertex allele) {
-                      const auto v = boost::add_vertex(tree_[allele], tree_);
-                      boost::add_edge(v, allele_to_move, tree_);
+                      const auto v = add_vertex(nodes_[allele].allele);
+                      add_edge(v, allele_to_move);
                       allele_to_move = v;
                   });
     alleles_to_copy.clear();
@@ -826,26 +936,25 @@ HaplotypeTree::clear_internal(const Vertex leaf, const ContigRegion& region)
     auto allele_to_move_to = current_allele;
     // Now avoid duplicate branches
     while (true) {
-        const auto vertex_range = boost::adjacent_vertices(allele_to_move_to, tree_);
-        const auto it = std::find_if(vertex_range.first, vertex_range.second,
-                                     [this, allele_to_move] (const Vertex allele) {
-                                         return tree_[allele] == tree_[allele_to_move];
-                                     });
-        if (it == vertex_range.second) break;
-        allele_to_move_to = *it; // i.e. move forward
+        auto duplicate = nodes_[allele_to_move_to].first_child;
+        while (duplicate != null_vertex && nodes_[duplicate].allele != nodes_[allele_to_move].allele) {
+            duplicate = nodes_[duplicate].next_sibling;
+        }
+        if (duplicate == null_vertex) break;
+        allele_to_move_to = duplicate; // i.e. move forward
         if (is_leaf(allele_to_move)) break;
         // Safe to remove forward as we made this branch earlier via copies
         allele_to_move = remove_forward(allele_to_move);
     }
-    if (allele_to_move_to == root_ || tree_[allele_to_move_to] != tree_[allele_to_move]) {
-        boost::add_edge(allele_to_move_to, allele_to_move, tree_);
+    if (allele_to_move_to == root_ || nodes_[allele_to_move_to].allele != nodes_[allele_to_move].allele) {
+        add_edge(allele_to_move_to, allele_to_move);
         return std::make_pair(leaf, true);
     } else {
         // Ditch the entire copied branch as it's already in the tree
-        while (boost::out_degree(allele_to_move, tree_) > 0) {
+        while (!is_leaf(allele_to_move)) {
             allele_to_move = remove_forward(allele_to_move);
         }
-        boost::remove_vertex(allele_to_move, tree_);
+        remove_vertex(allele_to_move);
         return std::make_pair(allele_to_move_to, false);
     }
 }
@@ -924,41 +1033,6 @@ void write_dot(const HaplotypeTree& tree, const boost::filesystem::path& dest)
     tree.write_dot(file);
 }
 
-template <typename G, typename V, typename Container>
-bool is_tree(const G& graph, const V& root, const Container& leafs)
-{
-    if (boost::num_vertices(graph) == 1) {
-        return *boost::vertices(graph).first == root;
-    }
-    std::unordered_set<V> visited_vertices {};
-    visited_vertices.reserve(boost::num_vertices(graph));
-    auto vis = boost::make_bfs_visitor(boost::write_property(boost::typed_identity_property_map<V>(),
-                                                             std::inserter(visited_vertices,
-                                                                           std::begin(visited_vertices)),
-                                                             boost::on_discover_vertex()));
-    std::unordered_map<V, std::size_t> index_map {};
-    index_map.reserve(boost::num_vertices(graph));
-    const auto p = boost::vertices(graph);
-    std::size_t i {0};
-    std::for_each(p.first, p.second, [&i, &index_map] (const auto& v) { index_map.emplace(v, i++); });
-    boost::breadth_first_search(graph, root,
-                                boost::visitor(vis)
-                                .vertex_index_map(boost::make_assoc_property_map(index_map)));
-    if (visited_vertices.size() != boost::num_vertices(graph) || visited_vertices.count(root) == 0) {
-        return false;
-    }
-    return std::all_of(std::cbegin(leafs), std::cend(leafs),
-                       [&graph, &root] (auto v) {
-                           if (boost::out_degree(v, graph) != 0) return false;
-                           while (v != root) {
-                               const auto p = boost::inv_adjacent_vertices(v, graph);
-                               if (std::distance(p.first, p.second) != 1) return false;
-                               v = *p.first;
-                           }
-                           return true;
-                       });
-}
-
 } // namespace debug
 
 } // namespace coretools
@@ -5,9 +5,7 @@
 #define haplotype_tree_hpp
 
 #include <vector>
-#include <list>
 #include <unordered_map>
-#include <unordered_set>
 #include <utility>
 #include <functional>
 #include <iterator>
@@ -15,8 +13,9 @@
 #include <type_traits>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 
-#include <boost/graph/adjacency_list.hpp>
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
 
@@ -43,8 +42,8 @@ public:
     
     HaplotypeTree(const GenomicRegion::ContigName& contig, const ReferenceGenome& reference);
     
-    HaplotypeTree(const HaplotypeTree&);
-    HaplotypeTree& operator=(const HaplotypeTree&);
+    HaplotypeTree(const HaplotypeTree&)            = default;
+    HaplotypeTree& operator=(const HaplotypeTree&) = default;
     HaplotypeTree(HaplotypeTree&&)            = default;
     HaplotypeTree& operator=(HaplotypeTree&&) = default;
     
@@ -93,19 +92,33 @@ public:
     void write_dot(std::ostream& out) const;
     
 private:
-    using Tree = boost::adjacency_list<
-        boost::listS, boost::listS, boost::bidirectionalS, ContigAllele, boost::no_property
-    >;
+    // The tree is stored as an array of nodes linked by index, so it is cheap to copy, and removed
+    // nodes are recycled through a free list rather than returned to the allocator. Each distinct
+    // allele is stored once and referred to by id, so most allele comparisons are id comparisons.
+    using Vertex   = std::uint32_t;
+    using AlleleId = std::uint32_t;
     
-    using Vertex = boost::graph_traits<Tree>::vertex_descriptor;
-    using Edge   = boost::graph_traits<Tree>::edge_descriptor;
+    static constexpr Vertex null_vertex {std::numeric_limits<Vertex>::max()};
+    static constexpr AlleleId null_allele {std::numeric_limits<AlleleId>::max()};
+    
+    struct Node
+    {
+        AlleleId allele;
+        Vertex parent, first_child, last_child, next_sibling, prev_sibling;
+        unsigned num_children;
+    };
     
     using HaplotypeVertexMultiMap = std::unordered_multimap<Haplotype, Vertex>;
     
     std::reference_wrapper<const ReferenceGenome> reference_;
-    Tree tree_;
+    std::vector<Node> nodes_;
+    std::vector<Vertex> free_nodes_;
+    std::vector<ContigAllele> alleles_;
+    std::vector<unsigned> allele_counts_;
+    std::vector<AlleleId> free_alleles_;
+    std::unordered_map<ContigAllele, AlleleId> allele_ids_;
     Vertex root_;
-    std::list<Vertex> haplotype_leafs_;
+    std::vector<Vertex> haplotype_leafs_;
     GenomicRegion::ContigName contig_;
     
     mutable HaplotypeVertexMultiMap haplotype_leaf_cache_;
@@ -115,16 +128,25 @@ private:
     using LeafConstIterator = decltype(haplotype_leafs_)::const_iterator;
     using CacheIterator = decltype(haplotype_leaf_cache_)::iterator;
     
+    AlleleId intern(const ContigAllele& allele);
+    void release_if_unused(AlleleId allele);
+    const ContigAllele& get_allele(Vertex v) const noexcept;
+    std::size_t num_vertices() const noexcept;
+    Vertex add_vertex(AlleleId allele);
+    void add_edge(Vertex u, Vertex v) noexcept;
+    void remove_edge(Vertex u, Vertex v) noexcept;
+    void remove_vertex(Vertex v);
+    void reset_tree();
     bool is_leaf(Vertex v) const;
     bool is_bifurcating(Vertex v) const;
     Vertex remove_forward(Vertex u);
     Vertex remove_backward(Vertex v);
     Vertex get_previous_allele(Vertex allele) const;
     Vertex find_allele_before(Vertex v, const ContigAllele& allele) const;
-    Vertex find_allele_on_branch(LeafIterator leaf, const ContigAllele& allele) const;
-    bool allele_exists(Vertex leaf, const ContigAllele& allele) const;
-    std::pair<LeafIterator, bool> extend_haplotype(LeafIterator leaf, const ContigAllele& new_allele);
-    LeafIterator extend_haplotype(LeafIterator leaf, const Haplotype& other);
+    Vertex find_allele_on_branch(Vertex leaf, AlleleId allele) const;
+    bool allele_exists(Vertex leaf, AlleleId allele) const;
+    std::pair<Vertex, Vertex> extend_haplotype(Vertex leaf, AlleleId new_allele);
+    void extend_haplotype(Vertex leaf, const std::vector<AlleleId>& alleles, std::vector<Vertex>& new_leafs);
     Haplotype extract_haplotype(Vertex leaf, const GenomicRegion& region) const;
     HaplotypeLength extract_haplotype_length(Vertex leaf, const GenomicRegion& region) const;
     bool define_same_haplotype(Vertex leaf1, Vertex leaf2) const;
@@ -133,9 +155,7 @@ private:
     LeafConstIterator
      find_exact_haplotype_leaf(LeafConstIterator first, LeafConstIterator last,
                                const Haplotype& haplotype) const;
-    LeafConstIterator 
-    find_equal_haplotype_leaf(LeafConstIterator first, LeafConstIterator last,
-                              const Haplotype& haplotype) const;
+    template <typename Map> void replace_leafs(const Map& replacements);
     void clear_overlapped(const ContigRegion& region);
     std::pair<Vertex, bool> clear(Vertex leaf, const ContigRegion& region);
     std::pair<Vertex, bool> clear_external(Vertex leaf, const ContigRegion& region);
@@ -17,7 +17,7 @@
 #include "config/common.hpp"
 #include "core/models/haplotype_likelihood_array.hpp"
 #include "utils/maths.hpp"
-#include "utils/append.hpp"
+#include "utils/parallel_transform.hpp"
 #include "logging/logging.hpp"
 
 namespace octopus {
@@ -27,28 +27,6 @@ namespace {
 struct SampleIntersectTag {};
 struct SamplePoolTag {};
 
-template <typename T>
-struct FilterGreater
-{
-    FilterGreater(const std::unordered_map<Haplotype, T>& values) : values_ {values} {}
-    
-    bool operator()(const Haplotype& lhs, const T rhs) const
-    {
-        return values_.at(lhs) > rhs;
-    }
-    bool operator()(const T& lhs, const Haplotype& rhs) const
-    {
-        return lhs > values_.at(rhs);
-    }
-    bool operator()(const Haplotype& lhs, const Haplotype& rhs) const
-    {
-        return values_.at(lhs) > values_.at(rhs);
-    }
-    
-private:
-    const std::unordered_map<Haplotype, T>& values_;
-};
-
 template <typename T>
 bool are_equal(const T& lhs, const T& rhs, std::true_type) noexcept
 {
@@ -67,67 +45,73 @@ bool are_equal(const T& lhs, const T& rhs) noexcept
     return are_equal(lhs, rhs, std::is_floating_point<T> {});
 }
 
+template <typename F, typename Samples>
+auto compute_filter_scores(const std::vector<Haplotype>& haplotypes, const Samples& samples,
+                           const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                           const F& filter, OptionalThreadPool workers)
+{
+    using T = std::result_of_t<F(const Haplotype&, const Samples&, decltype(haplotype_likelihoods))>;
+    std::vector<T> result(haplotypes.size());
+    parallel_transform(std::cbegin(haplotypes), std::cend(haplotypes), std::begin(result),
+                       [&] (const Haplotype& haplotype) { return filter(haplotype, samples, haplotype_likelihoods); },
+                       workers);
+    return result;
+}
+
+// Marks the haplotypes that do not score in the top n. If the nth best score is tied with a score
+// in the top n then only haplotypes scoring strictly worse than the nth best score are marked.
+template <typename T>
+void mark_filtered(const std::vector<T>& scores, const std::size_t n, std::vector<char>& filtered)
+{
+    assert(n < scores.size());
+    std::vector<std::size_t> indices(scores.size());
+    std::iota(std::begin(indices), std::end(indices), 0);
+    const auto score_greater = [&scores] (const auto lhs, const auto rhs) { return scores[lhs] > scores[rhs]; };
+    const auto nth_itr = std::next(std::begin(indices), n);
+    std::nth_element(std::begin(indices), nth_itr, std::end(indices), score_greater);
+    const auto nth_best = scores[*nth_itr];
+    auto first_filtered_itr = nth_itr;
+    if (std::any_of(std::begin(indices), nth_itr, [&] (const auto idx) { return are_equal(scores[idx], nth_best); })) {
+        first_filtered_itr = std::partition(nth_itr, std::end(indices), [&] (const auto idx) { return !(nth_best > scores[idx]); });
+    }
+    std::for_each(first_filtered_itr, std::end(indices), [&] (const auto idx) { filtered[idx] = true; });
+}
+
+std::size_t move_filtered(std::vector<Haplotype>& haplotypes, const std::vector<char>& filtered,
+                          std::vector<Haplotype>& result)
+{
+    std::vector<Haplotype> kept {};
+    kept.reserve(haplotypes.size());
+    std::size_t num_filtered {0};
+    for (std::size_t i {0}; i < haplotypes.size(); ++i) {
+        if (filtered[i]) {
+            result.push_back(std::move(haplotypes[i]));
+            ++num_filtered;
+        } else {
+            kept.push_back(std::move(haplotypes[i]));
+        }
+    }
+    haplotypes = std::move(kept);
+    return num_filtered;
+}
+
 template <typename F>
 std::size_t try_filter(std::vector<Haplotype>& haplotypes,
                        const std::vector<SampleName>& samples,
                        const HaplotypeLikelihoodArray& haplotype_likelihoods,
                        const std::size_t n, std::vector<Haplotype>& result,
-                       F filter, SampleIntersectTag)
+                       F filter, SampleIntersectTag, OptionalThreadPool workers)
 {
-    std::sort(std::begin(haplotypes), std::end(haplotypes));
-    using T = std::result_of_t<F(const Haplotype&, decltype(samples), decltype(haplotype_likelihoods))>;
-    bool first_sample {true};
-    std::vector<Haplotype> new_filtered {};
+    // A haplotype is only filtered if it is filtered in every sample
+    std::vector<char> filtered(haplotypes.size(), true), sample_filtered(haplotypes.size());
     for (const auto& sample : samples) {
-        std::vector<std::pair<HaplotypeReference, T>> filter_scores {};
-        for (const auto& haplotype : haplotypes) {
-            filter_scores.emplace_back(haplotype, filter(haplotype, sample, haplotype_likelihoods));
-        }
-        const auto score_less = [] (const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; };
-        const auto first_score_itr = std::begin(filter_scores);
-        const auto last_score_itr  = std::end(filter_scores);
-        const auto nth_score_itr = std::next(first_score_itr, n);
-        std::nth_element(first_score_itr, nth_score_itr, last_score_itr, score_less);
-        const auto rlast = std::make_reverse_iterator(first_score_itr);
-        const auto itr = std::find_if(std::make_reverse_iterator(std::prev(nth_score_itr)), rlast,
-                                     [&] (const auto& p) { return are_equal(p.second, nth_score_itr->second); });
-        auto first_filtered_score_itr = nth_score_itr;
-        if (itr != rlast) {
-            std::sort(nth_score_itr, last_score_itr, score_less);
-            first_filtered_score_itr = std::upper_bound(first_score_itr, last_score_itr, nth_score_itr->second,
-                                                        [] (const auto& lhs, const auto& rhs) { return lhs > rhs.second; });
-        }
-        if (first_sample) {
-            new_filtered.reserve(std::distance(first_filtered_score_itr, last_score_itr));
-            std::transform(first_filtered_score_itr, last_score_itr, std::back_inserter(new_filtered),
-                           [] (const auto& p) { return p.first; });
-            std::sort(std::begin(new_filtered), std::end(new_filtered)); // was sorted by score
-            first_sample = false;
-        } else {
-            std::vector<Haplotype> filtered_haplotypes {};
-            filtered_haplotypes.reserve(std::distance(first_filtered_score_itr, last_score_itr));
-            std::transform(first_filtered_score_itr, last_score_itr, std::back_inserter(filtered_haplotypes),
-                           [] (const auto& p) { return p.first; });
-            std::sort(std::begin(filtered_haplotypes), std::end(filtered_haplotypes));
-            std::vector<Haplotype> tmp {};
-            tmp.reserve(std::min(filtered_haplotypes.size(), new_filtered.size()));
-            assert(std::is_sorted(std::cbegin(new_filtered), std::cend(new_filtered)));
-            std::set_intersection(std::cbegin(filtered_haplotypes), std::cend(filtered_haplotypes),
-                                  std::cbegin(new_filtered), std::cend(new_filtered),
-                                  std::back_inserter(tmp));
-            new_filtered = std::move(tmp);
-        }
+        const auto scores = compute_filter_scores(haplotypes, sample, haplotype_likelihoods, filter, workers);
+        std::fill(std::begin(sample_filtered), std::end(sample_filtered), false);
+        mark_filtered(scores, n, sample_filtered);
+        std::transform(std::cbegin(filtered), std::cend(filtered), std::cbegin(sample_filtered), std::begin(filtered),
+                       [] (const char lhs, const char rhs) -> char { return lhs && rhs; });
     }
-    std::vector<Haplotype> tmp {};
-    tmp.reserve(haplotypes.size() - new_filtered.size());
-    assert(std::is_sorted(std::cbegin(new_filtered), std::cend(new_filtered)));
-    std::set_difference(std::cbegin(haplotypes), std::cend(haplotypes),
-                        std::cbegin(new_filtered), std::cend(new_filtered),
-                        std::back_inserter(tmp));
-    haplotypes = std::move(tmp);
-    const auto num_new_filtered = new_filtered.size();
-    utils::append(std::move(new_filtered), result);
-    return num_new_filtered;
+    return move_filtered(haplotypes, filtered, result);
 }
 
 template <typename F>
@@ -135,37 +119,12 @@ std::size_t try_filter(std::vector<Haplotype>& haplotypes,
                        const std::vector<SampleName>& samples,
                        const HaplotypeLikelihoodArray& haplotype_likelihoods,
                        const std::size_t n, std::vector<Haplotype>& result,
-                       F filter, SamplePoolTag)
+                       F filter, SamplePoolTag, OptionalThreadPool workers)
 {
-    using T = std::result_of_t<F(const Haplotype&, decltype(samples), decltype(haplotype_likelihoods))>;
-    std::unordered_map<Haplotype, T> filter_score {haplotypes.size()};
-    for (const auto& haplotype : haplotypes) {
-        filter_score.emplace(haplotype, filter(haplotype, samples, haplotype_likelihoods));
-    }
-    const FilterGreater<T> cmp {filter_score};
-    const auto first = std::begin(haplotypes);
-    const auto last  = std::end(haplotypes);
-    const auto nth   = std::next(first, n);
-    std::nth_element(first, nth, last, cmp);
-    const auto nth_best = filter_score.at(*nth);
-    const auto rlast = std::make_reverse_iterator(first);
-    const auto it = std::find_if(std::make_reverse_iterator(std::prev(nth)), rlast,
-                                 [nth_best, &filter_score] (const Haplotype& haplotype) {
-                                     return are_equal(filter_score.at(haplotype), nth_best);
-                                 });
-    if (it != rlast) {
-        std::sort(first, nth, cmp);
-        std::sort(nth, last, cmp);
-        const auto er = std::equal_range(first, last, nth_best, cmp);
-        result.insert(std::end(result), std::make_move_iterator(er.second), std::make_move_iterator(last));
-        const auto num_removed = std::distance(er.second, last);
-        haplotypes.erase(er.second, last);
-        return num_removed;
-    }
-    result.insert(std::end(result), std::make_move_iterator(nth), std::make_move_iterator(last));
-    const auto num_removed = std::distance(nth, last);
-    haplotypes.erase(nth, last);
-    return num_removed;
+    const auto scores = compute_filter_scores(haplotypes, samples, haplotype_likelihoods, filter, workers);
+    std::vector<char> filtered(haplotypes.size(), false);
+    mark_filtered(scores, n, filtered);
+    return move_filtered(haplotypes, filtered, result);
 }
 
 template <typename F>
@@ -173,20 +132,17 @@ void force_filter(std::vector<Haplotype>& haplotypes,
                   const std::vector<SampleName>& samples,
                   const HaplotypeLikelihoodArray& haplotype_likelihoods,
                   const std::size_t n, std::vector<Haplotype>& result,
-                  F filter)
+                  F filter, OptionalThreadPool workers)
 {
-    using T = std::result_of_t<F(const Haplotype&, decltype(samples), decltype(haplotype_likelihoods))>;
-    std::unordered_map<Haplotype, T> filter_likelihoods {haplotypes.size()};
-    for (const auto& haplotype : haplotypes) {
-        filter_likelihoods.emplace(haplotype, filter(haplotype, samples, haplotype_likelihoods));
-    }
-    const auto first = std::begin(haplotypes);
-    const auto last  = std::end(haplotypes);
-    const auto nth = std::next(first, n);
-    const FilterGreater<T> cmp {filter_likelihoods};
-    std::nth_element(first, nth, last, cmp);
-    result.insert(std::end(result), std::make_move_iterator(nth), std::make_move_iterator(last));
-    haplotypes.erase(nth, last);
+    const auto scores = compute_filter_scores(haplotypes, samples, haplotype_likelihoods, filter, workers);
+    std::vector<std::size_t> indices(haplotypes.size());
+    std::iota(std::begin(indices), std::end(indices), 0);
+    const auto nth_itr = std::next(std::begin(indices), n);
+    std::nth_element(std::begin(indices), nth_itr, std::end(indices),
+                     [&scores] (const auto lhs, const auto rhs) { return scores[lhs] > scores[rhs]; });
+    std::vector<char> filtered(haplotypes.size(), false);
+    std::for_each(nth_itr, std::end(indices), [&] (const auto idx) { filtered[idx] = true; });
+    move_filtered(haplotypes, filtered, result);
 }
 
 // filters
@@ -322,7 +278,8 @@ struct LikelihoodSum
 
 std::vector<Haplotype>
 filter_to_n(std::vector<Haplotype>& haplotypes, const std::vector<SampleName>& samples,
-            const HaplotypeLikelihoodArray& haplotype_likelihoods, const std::size_t n)
+            const HaplotypeLikelihoodArray& haplotype_likelihoods, const std::size_t n,
+            OptionalThreadPool workers)
 {
     std::vector<Haplotype> result {};
     if (haplotypes.size() <= n) {
@@ -337,7 +294,7 @@ filter_to_n(std::vector<Haplotype>& haplotypes, const std::vector<SampleName>& s
                           << haplotypes.size() << " haplotypes";
     }
     num_to_filter -= try_filter(haplotypes, samples, haplotype_likelihoods, n, result,
-                                MaxLikelihood {}, SamplePoolTag {});
+                                MaxLikelihood {}, SamplePoolTag {}, workers);
     if (DEBUG_MODE) {
         stream(debug_log) << "There are " << haplotypes.size()
                           << " remaining haplotypes after maximum likelihood filtering";
@@ -347,7 +304,7 @@ filter_to_n(std::vector<Haplotype>& haplotypes, const std::vector<SampleName>& s
     }
     num_to_filter -= try_filter(haplotypes, samples, haplotype_likelihoods, n, result,
                                 AssignmentCount {haplotypes, samples, haplotype_likelihoods},
-                                SamplePoolTag {});
+                                SamplePoolTag {}, workers);
     if (DEBUG_MODE) {
         stream(debug_log) << "There are " << haplotypes.size()
                           << " remaining haplotypes after assignment count filtering";
@@ -356,7 +313,7 @@ filter_to_n(std::vector<Haplotype>& haplotypes, const std::vector<SampleName>& s
         return result;
     }
     num_to_filter -= try_filter(haplotypes, samples, haplotype_likelihoods, n, result,
-                                LikelihoodZeroCount {}, SampleIntersectTag {});
+                                LikelihoodZeroCount {}, SampleIntersectTag {}, workers);
     if (DEBUG_MODE) {
         stream(debug_log) << "There are " << haplotypes.size()
                           << " remaining haplotypes after likelihood zero count filtering";
@@ -369,7 +326,7 @@ filter_to_n(std::vector<Haplotype>& haplotypes, const std::vector<SampleName>& s
                           << haplotypes.size() << " haplotypes with assignment count filtering";
     }
     force_filter(haplotypes, samples, haplotype_likelihoods, n, result,
-                 AssignmentCount {haplotypes, samples, haplotype_likelihoods});
+                 AssignmentCount {haplotypes, samples, haplotype_likelihoods}, workers);
     return result;
 }
 
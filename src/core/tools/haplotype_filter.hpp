@@ -9,16 +9,23 @@
 #include <functional>
 #include <unordered_map>
 
+#include <boost/optional.hpp>
+
 #include "config/common.hpp"
 #include "core/types/haplotype.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace octopus {
 
 class HaplotypeLikelihoodArray;
 
+using OptionalThreadPool = boost::optional<ThreadPool&>;
+
+// Haplotype scores are computed in parallel if workers are given
 std::vector<Haplotype>
 filter_to_n(std::vector<Haplotype>& haplotypes, const std::vector<SampleName>& samples,
-            const HaplotypeLikelihoodArray& haplotype_likelihoods, const std::size_t n);
+            const HaplotypeLikelihoodArray& haplotype_likelihoods, const std::size_t n,
+            OptionalThreadPool workers = boost::none);
 
 using HaplotypeReference    = std::reference_wrapper<const Haplotype>;
 using HaplotypeReferenceProbabilityMap = std::unordered_map<HaplotypeReference, double>;
@@ -9,6 +9,8 @@
 #include <thread>
 #include <cassert>
 #include <iostream>
+#include <functional>
+#include <future>
 
 #include "basics/genomic_region.hpp"
 #include "basics/cigar_string.hpp"
@@ -21,8 +23,6 @@
 #include "utils/sequence_utils.hpp"
 #include "read_realigner.hpp"
 
-#include "logging/progress_meter.hpp"
-
 namespace octopus {
 
 namespace {
@@ -51,7 +51,7 @@ IndelProfiler::IndelProfiler(ProfileConfig config)
 
 IndelProfiler::IndelProfiler(ProfileConfig config, PerformanceConfig performance_config)
 : config_ {std::move(config)}
-, performance_config_ {}
+, performance_config_ {std::move(performance_config)}
 , workers_ {get_pool_size(performance_config_)}
 {}
 
@@ -61,15 +61,11 @@ IndelProfiler::profile(const ReadPipe& src, VcfReader& variants, const Reference
     const auto samples = src.samples();
     check_samples(samples, variants);
     IndelProfile result {};
-    boost::optional<GenomicRegion> batch_region {};
-    GenomicRegion analysis_region;
-    for (auto p = variants.iterate(); !batch_region || p.first != p.second; ) {
-        if (!batch_region || !is_same_contig(analysis_region, *p.first)) {
-            analysis_region = reference.contig_region(contig_name(*p.first));
+    for (const auto& contig : reference.contig_names()) {
+        const auto contig_records = variants.iterate(contig, VcfReader::UnpackPolicy::sites);
+        if (contig_records.first != contig_records.second) {
+            profile_region(src, variants, reference, samples, reference.contig_region(contig), result);
         }
-        const auto data = read_next_data_batch(p.first, p.second, src, reference, samples, analysis_region, batch_region);
-        evaluate_indel_profile(data, result);
-        batch_region = mapped_region(data.reference);
     }
     return result;
 }
@@ -85,13 +81,7 @@ IndelProfiler::profile(const ReadPipe& src, VcfReader& variants, const Reference
     IndelProfile result {};
     for (const auto& r : regions) {
         for (const auto& analysis_region : r.second) {
-            boost::optional<GenomicRegion> batch_region {};
-            for (auto p = variants.iterate(analysis_region); !batch_region || p.first != p.second; ) {
-                const auto data = read_next_data_batch(p.first, p.second, src, reference, samples, analysis_region, batch_region);
-                evaluate_indel_profile(data, result);
-                batch_region = mapped_region(data.reference);
-                progress.log_completed(*batch_region);
-            }
+            profile_region(src, variants, reference, samples, analysis_region, result, progress);
         }
     }
     progress.stop();
@@ -105,12 +95,7 @@ IndelProfiler::profile(const ReadPipe& src, VcfReader& variants, const Reference
     const auto samples = src.samples();
     check_samples(samples, variants);
     IndelProfile result {};
-    boost::optional<GenomicRegion> batch_region {};
-    for (auto p = variants.iterate(region); !batch_region || p.first != p.second; ) {
-        const auto data = read_next_data_batch(p.first, p.second, src, reference, samples, region, batch_region);
-        evaluate_indel_profile(data, result);
-        batch_region = mapped_region(data.reference);
-    }
+    profile_region(src, variants, reference, samples, region, result);
     return result;
 }
 
@@ -176,13 +161,13 @@ IndelProfiler::read_next_block(VcfIterator& first, const VcfIterator& last, cons
     return copy_each_first(block);
 }
 
-IndelProfiler::DataBatch
-IndelProfiler::read_next_data_batch(VcfIterator& first, const VcfIterator& last, const ReadPipe& src,
-                                    const ReferenceGenome& reference, const SampleList& samples,
+IndelProfiler::DataBlock
+IndelProfiler::read_next_data_block(VcfIterator& first, const VcfIterator& last, const SampleList& samples,
                                     const GenomicRegion& analysis_region,
                                     const boost::optional<GenomicRegion>& prev_batch_region) const
 {
-    const auto records = read_next_block(first, last, samples);
+    DataBlock result {read_next_block(first, last, samples), {}, prev_batch_region};
+    const auto& records = result.records;
     GenomicRegion batch_region;
     if (!records.empty()) {
         batch_region = encompassing_region(records);
@@ -201,8 +186,45 @@ IndelProfiler::read_next_data_batch(VcfIterator& first, const VcfIterator& last,
     } else {
         batch_region = analysis_region;
     }
-    DataBatch result {Haplotype {std::move(batch_region), reference}, {}, {}, {}};
+    result.region = std::move(batch_region);
+    return result;
+}
+
+namespace {
+
+void add_indels(const std::vector<VcfRecord>& records, const SampleName& sample, MappableFlatSet<Allele>& result)
+{
+    for (std::size_t record_idx {0}; record_idx < records.size(); ++record_idx) {
+        auto alleles = get_resolved_alleles(records, record_idx, sample);
+        std::vector<Allele> alt_indels {};
+        alt_indels.reserve(alleles.size() - 1);
+        std::for_each(std::next(std::begin(alleles)), std::end(alleles), [&] (auto& allele) {
+            if (allele && is_indel(*allele)) {
+                alt_indels.push_back(std::move(*allele));
+            }
+        });
+        result.insert(std::begin(alt_indels), std::end(alt_indels));
+    }
+}
+
+} // namespace
+
+IndelProfiler::DataBatch
+IndelProfiler::make_data_batch(const DataBlock& block, const ReadPipe& src, const ReferenceGenome& reference,
+                               const SampleList& samples, boost::optional<const IndelProfile&> sampled) const
+{
+    const auto& records = block.records;
+    DataBatch result {Haplotype {block.region, reference}, {}, {}, {}};
     if (is_empty_region(result.reference)) return result;
+    if (sampled) {
+        // Polymorphisms are cheap to count so are never sampled, only reads
+        auto reference_repeats = find_repeats(result.reference);
+        if (is_sampled(reference_repeats, *sampled)) {
+            for (const auto& sample : samples) add_indels(records, sample, result.indels);
+            result.repeats[result.reference] = std::move(reference_repeats);
+            return result;
+        }
+    }
     auto reads = src.fetch_reads(mapped_region(result.reference));
     auto repeat_search_region = mapped_region(result.reference);
     if (has_coverage(reads)) {
@@ -215,7 +237,7 @@ IndelProfiler::read_next_data_batch(VcfIterator& first, const VcfIterator& last,
         auto genotypes = extract_genotypes(records, samples, reference);
         result.support.reserve(2 * samples.size()); // guess
         for (const auto& sample : samples) {
-            if (prev_batch_region) reads[sample].erase_overlapped(*prev_batch_region);
+            if (block.prev_region) reads[sample].erase_overlapped(*block.prev_region);
             auto& sample_genotypes = genotypes.at(sample);
             for (auto& genotype : sample_genotypes) {
                 genotype = remap(genotype, expand(mapped_region(genotype), 2 * config_.max_length));
@@ -231,17 +253,7 @@ IndelProfiler::read_next_data_batch(VcfIterator& first, const VcfIterator& last,
             evaluate_support(sample_genotype, reads[sample], result.support);
             reads[sample].clear();
             reads[sample].shrink_to_fit();
-            for (std::size_t record_idx {0}; record_idx < records.size(); ++record_idx) {
-                auto alleles = get_resolved_alleles(records, record_idx, sample);
-                std::vector<Allele> alt_indels {};
-                alt_indels.reserve(alleles.size() - 1);
-                std::for_each(std::next(std::begin(alleles)), std::end(alleles), [&] (auto& allele) {
-                    if (allele && is_indel(*allele)) {
-                        alt_indels.push_back(std::move(*allele));
-                    }
-                });
-                result.indels.insert(std::begin(alt_indels), std::end(alt_indels));
-            }
+            add_indels(records, sample, result.indels);
         }
     } else {
         const Genotype<Haplotype> reference_genotype {result.reference};
@@ -399,6 +411,119 @@ void IndelProfiler::evaluate_indel_profile(const DataBatch& data, IndelProfile&
     }
 }
 
+IndelProfiler::IndelProfile
+IndelProfiler::evaluate_data_block(const DataBlock& block, const ReadPipe& src, const ReferenceGenome& reference,
+                                   const SampleList& samples, boost::optional<const IndelProfile&> sampled) const
+{
+    IndelProfile result {};
+    evaluate_indel_profile(make_data_batch(block, src, reference, samples, sampled), result);
+    return result;
+}
+
+namespace {
+
+void add(const std::vector<unsigned>& src, std::vector<unsigned>& dst)
+{
+    if (dst.size() < src.size()) dst.resize(src.size());
+    std::transform(std::cbegin(src), std::cend(src), std::cbegin(dst), std::begin(dst), std::plus<> {});
+}
+
+void add(const IndelProfiler::IndelProfile::RepeatState& src, IndelProfiler::IndelProfile::RepeatState& dst)
+{
+    dst.span += src.span;
+    dst.footprint += src.footprint;
+    dst.reference_count += src.reference_count;
+    dst.read_count += src.read_count;
+    add(src.polymorphism_counts, dst.polymorphism_counts);
+    add(src.error_counts, dst.error_counts);
+}
+
+void add(const IndelProfiler::IndelProfile& src, IndelProfiler::IndelProfile& dst)
+{
+    if (dst.states.size() < src.states.size()) dst.states.resize(src.states.size());
+    for (std::size_t period {0}; period < src.states.size(); ++period) {
+        auto& dst_period_states = dst.states[period];
+        if (dst_period_states.size() < src.states[period].size()) dst_period_states.resize(src.states[period].size());
+        for (std::size_t periods {0}; periods < src.states[period].size(); ++periods) {
+            for (const auto& state : src.states[period][periods]) {
+                auto& dst_state = find_or_insert_motif(state.motif, dst_period_states[periods]);
+                const auto reference_count = dst_state.reference_count;
+                add(state, dst_state);
+                if (period == 0) {
+                    // All non-repeat sequence is counted as one reference
+                    dst_state.reference_count = std::max(reference_count, state.reference_count);
+                }
+            }
+        }
+    }
+}
+
+const IndelProfiler::IndelProfile::RepeatState*
+find_state(const IndelProfiler::IndelProfile& profile, const std::size_t period, const std::size_t periods,
+           const Haplotype::NucleotideSequence& motif)
+{
+    if (period >= profile.states.size() || periods >= profile.states[period].size()) return nullptr;
+    const auto& states = profile.states[period][periods];
+    const auto motif_less = [] (const auto& lhs, const auto& rhs) { return lhs.motif < rhs; };
+    const auto motif_itr = std::lower_bound(std::cbegin(states), std::cend(states), motif, motif_less);
+    if (motif_itr != std::cend(states) && motif_itr->motif == motif) {
+        return &(*motif_itr);
+    } else {
+        return nullptr;
+    }
+}
+
+} // namespace
+
+void IndelProfiler::profile_region(const ReadPipe& src, VcfReader& variants, const ReferenceGenome& reference,
+                                   const SampleList& samples, const GenomicRegion& analysis_region, IndelProfile& result,
+                                   boost::optional<ProgressMeter&> progress) const
+{
+    // Blocks are read in rounds. Each round is evaluated in parallel and added to the result in order, and
+    // sampling decisions only depend on previous rounds, so the result is the same each run.
+    const auto max_round_blocks = std::max(2 * workers_.size(), std::size_t {1});
+    std::vector<DataBlock> blocks {};
+    blocks.reserve(max_round_blocks);
+    std::vector<std::future<IndelProfile>> pending_profiles {};
+    pending_profiles.reserve(max_round_blocks);
+    boost::optional<GenomicRegion> batch_region {};
+    for (auto p = variants.iterate(analysis_region); !batch_region || p.first != p.second; ) {
+        if (config_.target_reads_per_context && is_sampling_complete(result)) return;
+        boost::optional<const IndelProfile&> sampled {};
+        if (config_.target_reads_per_context) sampled = result;
+        blocks.clear();
+        while (blocks.size() < max_round_blocks && (!batch_region || p.first != p.second)) {
+            blocks.push_back(read_next_data_block(p.first, p.second, samples, analysis_region, batch_region));
+            batch_region = blocks.back().region;
+        }
+        if (workers_.empty() || blocks.size() == 1) {
+            for (const auto& block : blocks) {
+                add(evaluate_data_block(block, src, reference, samples, sampled), result);
+            }
+        } else {
+            pending_profiles.clear();
+            try {
+                for (const auto& block : blocks) {
+                    pending_profiles.push_back(workers_.push([&, this] () {
+                        return evaluate_data_block(block, src, reference, samples, sampled); }));
+                }
+                // The result is only written once all tasks reading it are done
+                for (const auto& block_profile : pending_profiles) workers_.wait(block_profile);
+            } catch (...) {
+                // The tasks reference this frame
+                for (const auto& block_profile : pending_profiles) {
+                    if (block_profile.valid()) workers_.wait(block_profile);
+                }
+                throw;
+            }
+            for (auto& block_profile : pending_profiles) add(block_profile.get(), result);
+        }
+        if (progress) {
+            for (const auto& block : blocks) progress->log_completed(block.region);
+        }
+    }
+}
+
 namespace {
 
 double error_expectation(const AlignedRead::BaseQualityVector& qualities)
@@ -531,6 +656,33 @@ bool IndelProfiler::is_good_repeat(const TandemRepeat& repeat) const
     return periods >= config_.min_periods && periods <= config_.max_periods && region_size(repeat) <= config_.max_length;
 }
 
+bool IndelProfiler::is_sampled(const MappableFlatSet<TandemRepeat>& repeats, const IndelProfile& profile) const
+{
+    assert(config_.target_reads_per_context);
+    const auto is_state_sampled = [&] (const std::size_t period, const std::size_t periods, const auto& motif) {
+        const auto state = find_state(profile, period, periods, motif);
+        return state && state->read_count >= *config_.target_reads_per_context;
+    };
+    return is_state_sampled(0, 0, config_.complex_motif)
+        && std::all_of(std::cbegin(repeats), std::cend(repeats), [&] (const auto& repeat) {
+            return is_state_sampled(repeat.period(), count_periods(repeat), repeat.motif()); });
+}
+
+bool IndelProfiler::is_sampling_complete(const IndelProfile& profile) const
+{
+    assert(config_.target_reads_per_context);
+    bool has_states {false};
+    for (const auto& period_states : profile.states) {
+        for (const auto& periods_states : period_states) {
+            for (const auto& state : periods_states) {
+                if (state.read_count < *config_.target_reads_per_context) return false;
+                has_states = true;
+            }
+        }
+    }
+    return has_states;
+}
+
 IndelProfiler::IndelProfile
 profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference)
 {
@@ -565,6 +717,15 @@ profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceG
     return profiler.profile(reads, vcf, reference, regions);
 }
 
+IndelProfiler::IndelProfile
+profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const InputRegionMap& regions,
+               IndelProfiler::ProfileConfig config, IndelProfiler::PerformanceConfig performance_config)
+{
+    VcfReader vcf {std::move(variants)};
+    IndelProfiler profiler {std::move(config), std::move(performance_config)};
+    return profiler.profile(reads, vcf, reference, regions);
+}
+
 IndelProfiler::IndelProfile
 profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const GenomicRegion& region)
 {
@@ -25,6 +25,7 @@
 #include "readpipe/read_pipe.hpp"
 #include "readpipe/buffered_read_pipe.hpp"
 #include "utils/thread_pool.hpp"
+#include "logging/progress_meter.hpp"
 #include "read_assigner.hpp"
 
 namespace octopus {
@@ -42,6 +43,8 @@ public:
         unsigned max_length = 200;
         bool ignore_likely_misaligned_reads = true;
         Haplotype::NucleotideSequence complex_motif = "N";
+        // If set, stop profiling reads once every repeat context seen has this many reads
+        boost::optional<unsigned> target_reads_per_context = boost::none;
     };
     
     struct PerformanceConfig
@@ -75,6 +78,13 @@ private:
     using HaplotypeReadSupportMap = std::unordered_map<Haplotype, MappableFlatMultiSet<AlignedRead>>;
     using HaplotypeRepeatMap = std::unordered_map<Haplotype, MappableFlatSet<TandemRepeat>>;
     
+    struct DataBlock
+    {
+        CallBlock records;
+        GenomicRegion region;
+        boost::optional<GenomicRegion> prev_region;
+    };
+    
     struct DataBatch
     {
         Haplotype reference;
@@ -89,14 +99,22 @@ private:
     
     void check_samples(const SampleList& samples, const VcfReader& variants) const;
     CallBlock read_next_block(VcfIterator& first, const VcfIterator& last, const SampleList& samples) const;
-    DataBatch read_next_data_batch(VcfIterator& first, const VcfIterator& last, const ReadPipe& src,
-                                   const ReferenceGenome& reference, const SampleList& samples,
+    void profile_region(const ReadPipe& src, VcfReader& variants, const ReferenceGenome& reference, const SampleList& samples,
+                        const GenomicRegion& analysis_region, IndelProfile& result,
+                        boost::optional<ProgressMeter&> progress = boost::none) const;
+    DataBlock read_next_data_block(VcfIterator& first, const VcfIterator& last, const SampleList& samples,
                                    const GenomicRegion& analysis_region,
                                    const boost::optional<GenomicRegion>& prev_batch_region) const;
+    DataBatch make_data_batch(const DataBlock& block, const ReadPipe& src, const ReferenceGenome& reference,
+                              const SampleList& samples, boost::optional<const IndelProfile&> sampled) const;
+    IndelProfile evaluate_data_block(const DataBlock& block, const ReadPipe& src, const ReferenceGenome& reference,
+                                     const SampleList& samples, boost::optional<const IndelProfile&> sampled) const;
     void evaluate_indel_profile(const DataBatch& data, IndelProfile& result) const;
     void evaluate_support(const Genotype<Haplotype>& genotype, ReadContainer& reads, HaplotypeReadSupportMap& result) const;
     MappableFlatSet<TandemRepeat> find_repeats(const Haplotype& haplotype) const;
     bool is_good_repeat(const TandemRepeat& repeat) const;
+    bool is_sampled(const MappableFlatSet<TandemRepeat>& repeats, const IndelProfile& profile) const;
+    bool is_sampling_complete(const IndelProfile& profile) const;
 };
 
 struct IndelProfiler::IndelProfile
@@ -123,6 +141,9 @@ IndelProfiler::IndelProfile
 profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const InputRegionMap& regions,
                IndelProfiler::ProfileConfig config);
 IndelProfiler::IndelProfile
+profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const InputRegionMap& regions,
+               IndelProfiler::ProfileConfig config, IndelProfiler::PerformanceConfig performance_config);
+IndelProfiler::IndelProfile
 profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const GenomicRegion& region);
 IndelProfiler::IndelProfile
 profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const GenomicRegion& region,
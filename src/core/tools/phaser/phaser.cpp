@@ -5,11 +5,14 @@
 
 #include <deque>
 #include <map>
+#include <array>
 #include <algorithm>
 #include <numeric>
 #include <cstddef>
 #include <cmath>
+#include <cstdint>
 #include <utility>
+#include <functional>
 #include <iostream>
 
 #include <boost/functional/hash.hpp>
@@ -353,18 +356,8 @@ compute_chunk_set_posteriors(const std::vector<CompressedGenotype>& genotypes,
     return result;
 }
 
-auto compute_phase_quality(const std::vector<CompressedGenotype>& genotypes,
-                           const std::vector<GenomicRegion>& sites,
-                           const std::size_t lhs, const std::size_t rhs,
-                           const Phaser::SampleGenotypePosteriorMap& genotype_posteriors,
-                           const GenotypeInfoMatrix& info)
+Phred<double> compute_phase_quality(std::vector<std::vector<double>> chunk_set_posteriors)
 {
-    if (overlaps(sites[lhs], sites[rhs])
-     || is_very_likely_homozygous(sites[lhs], genotype_posteriors, info[lhs])
-     || is_very_likely_homozygous(sites[rhs], genotype_posteriors, info[rhs])) {
-        return probability_false_to_phred(0.0); // maximum quality
-    }
-    auto chunk_set_posteriors = compute_chunk_set_posteriors(genotypes, sites, lhs, rhs, genotype_posteriors, info);
     std::vector<double> set_weights(chunk_set_posteriors.size());
     const static auto sum_probabilities = [] (const auto& probs) {
          return std::accumulate(std::cbegin(probs), std::cend(probs), 0.0); };
@@ -390,6 +383,147 @@ auto compute_phase_quality(const std::vector<CompressedGenotype>& genotypes,
     return probability_false_to_phred(total_not_map_posterior);
 }
 
+/*
+    SitePhaseLinker computes the phase quality of pairs of sites. In general the genotypes are copied
+    to chunks over both sites, and the chunks with the same alleles at each site are marginalised.
+    If every genotype is diploid, the haplotypes of a genotype that is heterozygous at both sites
+    share alleles in one of only two ways (cis or trans), so the chunk sets are found from the allele
+    index of each haplotype at each site, which are computed once for all pairs of sites.
+ */
+class SitePhaseLinker
+{
+public:
+    SitePhaseLinker(const std::vector<CompressedGenotype>& genotypes,
+                    const std::vector<GenomicRegion>& sites,
+                    const Phaser::SampleGenotypePosteriorMap& genotype_posteriors);
+    
+    Phred<double> operator()(std::size_t lhs, std::size_t rhs) const;
+    
+    bool is_very_likely_homozygous(std::size_t site) const noexcept { return is_very_likely_homozygous_[site]; }
+    
+private:
+    using AlleleIndex = std::uint16_t;
+    using AlleleIndexVector = std::vector<AlleleIndex>;
+    
+    std::reference_wrapper<const std::vector<CompressedGenotype>> genotypes_;
+    std::reference_wrapper<const std::vector<GenomicRegion>> sites_;
+    std::reference_wrapper<const Phaser::SampleGenotypePosteriorMap> genotype_posteriors_;
+    bool is_diploid_;
+    GenotypeInfoMatrix genotype_info_;
+    std::vector<AlleleIndexVector> haplotype_alleles_; // [site][haplotype index]
+    std::vector<double> posteriors_;
+    std::vector<bool> is_very_likely_homozygous_;
+    
+    Phred<double> compute_diploid_phase_quality(std::size_t lhs, std::size_t rhs) const;
+};
+
+bool is_diploid(const std::vector<CompressedGenotype>& genotypes) noexcept
+{
+    return std::all_of(std::cbegin(genotypes), std::cend(genotypes), [] (const auto& genotype) { return genotype.ploidy() == 2; });
+}
+
+SitePhaseLinker::SitePhaseLinker(const std::vector<CompressedGenotype>& genotypes,
+                                 const std::vector<GenomicRegion>& sites,
+                                 const Phaser::SampleGenotypePosteriorMap& genotype_posteriors)
+: genotypes_ {genotypes}
+, sites_ {sites}
+, genotype_posteriors_ {genotype_posteriors}
+, is_diploid_ {is_diploid(genotypes)}
+, genotype_info_ {}
+, haplotype_alleles_ {}
+, posteriors_ {}
+, is_very_likely_homozygous_(sites.size())
+{
+    assert(!genotypes.empty());
+    if (is_diploid_) {
+        posteriors_.reserve(genotypes.size());
+        for (const auto& p : genotype_posteriors) posteriors_.push_back(p.second);
+        assert(posteriors_.size() == genotypes.size());
+        std::vector<std::reference_wrapper<const Haplotype>> haplotypes {};
+        for (const auto& genotype : genotypes) {
+            for (const auto& haplotype : genotype) {
+                if (haplotype.index() >= haplotypes.size()) haplotypes.resize(haplotype.index() + 1, haplotype.haplotype());
+                haplotypes[haplotype.index()] = haplotype.haplotype();
+            }
+        }
+        const auto map_genotype_itr = std::max_element(std::cbegin(posteriors_), std::cend(posteriors_));
+        const auto& map_genotype = genotypes[std::distance(std::cbegin(posteriors_), map_genotype_itr)];
+        haplotype_alleles_.reserve(sites.size());
+        AlleleVector alleles {};
+        for (std::size_t site_idx {0}; site_idx < sites.size(); ++site_idx) {
+            alleles.clear();
+            AlleleIndexVector site_alleles(haplotypes.size());
+            std::transform(std::cbegin(haplotypes), std::cend(haplotypes), std::begin(site_alleles), [&] (const Haplotype& haplotype) {
+                auto allele = copy<Allele>(haplotype, sites[site_idx]);
+                const auto allele_itr = std::find(std::cbegin(alleles), std::cend(alleles), allele);
+                if (allele_itr != std::cend(alleles)) return static_cast<AlleleIndex>(std::distance(std::cbegin(alleles), allele_itr));
+                alleles.push_back(std::move(allele));
+                return static_cast<AlleleIndex>(alleles.size() - 1);
+            });
+            is_very_likely_homozygous_[site_idx] = *map_genotype_itr > 0.9999
+                                                   && site_alleles[map_genotype[0].index()] == site_alleles[map_genotype[1].index()];
+            haplotype_alleles_.push_back(std::move(site_alleles));
+        }
+    } else {
+        genotype_info_ = compute_genotype_info(genotypes, sites);
+        for (std::size_t site_idx {0}; site_idx < sites.size(); ++site_idx) {
+            is_very_likely_homozygous_[site_idx] = octopus::is_very_likely_homozygous(sites[site_idx], genotype_posteriors, genotype_info_[site_idx]);
+        }
+    }
+}
+
+Phred<double> SitePhaseLinker::operator()(const std::size_t lhs, const std::size_t rhs) const
+{
+    if (overlaps(sites_.get()[lhs], sites_.get()[rhs]) || is_very_likely_homozygous(lhs) || is_very_likely_homozygous(rhs)) {
+        return probability_false_to_phred(0.0); // maximum quality
+    }
+    if (is_diploid_) {
+        return compute_diploid_phase_quality(lhs, rhs);
+    } else {
+        return compute_phase_quality(compute_chunk_set_posteriors(genotypes_, sites_, lhs, rhs, genotype_posteriors_, genotype_info_));
+    }
+}
+
+Phred<double> SitePhaseLinker::compute_diploid_phase_quality(const std::size_t lhs, const std::size_t rhs) const
+{
+    struct ChunkSet
+    {
+        std::array<AlleleIndex, 4> alleles; // the heterozygous lhs then rhs alleles, each in increasing order
+        std::array<double, 2> posteriors; // cis then trans
+        std::array<bool, 2> is_present;
+    };
+    std::vector<ChunkSet> chunk_sets {};
+    const auto& lhs_alleles = haplotype_alleles_[lhs];
+    const auto& rhs_alleles = haplotype_alleles_[rhs];
+    const auto& genotypes = genotypes_.get();
+    for (std::size_t g {0}; g < genotypes.size(); ++g) {
+        const auto lhs_first = lhs_alleles[genotypes[g][0].index()], lhs_second = lhs_alleles[genotypes[g][1].index()];
+        const auto rhs_first = rhs_alleles[genotypes[g][0].index()], rhs_second = rhs_alleles[genotypes[g][1].index()];
+        if (lhs_first != lhs_second && rhs_first != rhs_second) {
+            const std::array<AlleleIndex, 4> alleles {std::min(lhs_first, lhs_second), std::max(lhs_first, lhs_second),
+                                                      std::min(rhs_first, rhs_second), std::max(rhs_first, rhs_second)};
+            const std::size_t phase {(lhs_first < lhs_second) == (rhs_first < rhs_second) ? 0u : 1u};
+            auto chunk_set_itr = std::find_if(std::begin(chunk_sets), std::end(chunk_sets),
+                                              [&] (const ChunkSet& chunk_set) { return chunk_set.alleles == alleles; });
+            if (chunk_set_itr == std::end(chunk_sets)) {
+                chunk_sets.push_back({alleles, {0.0, 0.0}, {false, false}});
+                chunk_set_itr = std::prev(std::end(chunk_sets));
+            }
+            chunk_set_itr->posteriors[phase] += posteriors_[g];
+            chunk_set_itr->is_present[phase] = true;
+        }
+    }
+    std::vector<std::vector<double>> chunk_set_posteriors {};
+    chunk_set_posteriors.reserve(chunk_sets.size());
+    for (const auto& chunk_set : chunk_sets) {
+        chunk_set_posteriors.emplace_back();
+        for (std::size_t phase {0}; phase < 2; ++phase) {
+            if (chunk_set.is_present[phase]) chunk_set_posteriors.back().push_back(chunk_set.posteriors[phase]);
+        }
+    }
+    return compute_phase_quality(std::move(chunk_set_posteriors));
+}
+
 } // namespace
 
 template <typename Graph>
@@ -438,6 +572,47 @@ calculate_phase_quality(const std::vector<std::size_t>& phase_set,
     return result;
 }
 
+namespace {
+
+/*
+    Sites are added to the current phase set from left to right. A heterozygous site joins the set if its best
+    phase quality with the last few heterozygous sites of the set is at least min_phase_quality, and otherwise
+    starts a new set. Very likely homozygous sites always join the current set. The quality of a phase set is the
+    minimum quality of the links that built it, so only a linear number of site pairs are evaluated.
+ */
+Phaser::PhaseSetVector
+phase_incrementally(const std::size_t num_sites, const SitePhaseLinker& phase_linker, const Phred<double> min_phase_quality)
+{
+    constexpr std::size_t maxLinkedSites {3};
+    static const auto max_possible_quality = probability_false_to_phred(0.0);
+    Phaser::PhaseSetVector result {};
+    std::deque<std::size_t> linked_sites {};
+    for (std::size_t site_idx {0}; site_idx < num_sites; ++site_idx) {
+        if (phase_linker.is_very_likely_homozygous(site_idx)) {
+            if (result.empty()) result.push_back({{}, max_possible_quality});
+            result.back().site_indices.push_back(site_idx);
+            continue;
+        }
+        boost::optional<Phred<double>> link_quality {};
+        for (const auto linked_site_idx : linked_sites) {
+            const auto quality = phase_linker(linked_site_idx, site_idx);
+            if (!link_quality || quality > *link_quality) link_quality = quality;
+        }
+        if (result.empty() || (link_quality && *link_quality < min_phase_quality)) {
+            result.push_back({{site_idx}, max_possible_quality});
+            linked_sites.clear();
+        } else {
+            result.back().site_indices.push_back(site_idx);
+            if (link_quality) result.back().quality = std::min(result.back().quality, *link_quality);
+        }
+        linked_sites.push_back(site_idx);
+        if (linked_sites.size() > maxLinkedSites) linked_sites.pop_front();
+    }
+    return result;
+}
+
+} // namespace
+
 namespace debug {
 
 void write_phase_graph(const std::vector<GenomicRegion>& sites,
@@ -476,7 +651,10 @@ Phaser::phase_sample(const std::vector<GenomicRegion>& sites,
     using std::cbegin; using std::cend;
     using CompletePhaseGraph = boost::adjacency_list<boost::listS, boost::listS, boost::undirectedS, std::size_t>;
     using CompletePhaseGraphVertex = boost::graph_traits<CompletePhaseGraph>::vertex_descriptor;
-    const auto genotype_info = compute_genotype_info(genotypes, sites);
+    const SitePhaseLinker phase_linker {genotypes, sites, genotype_posteriors};
+    if (config_.algorithm == Algorithm::incremental) {
+        return phase_incrementally(sites.size(), phase_linker, config_.min_phase_quality);
+    }
     CompletePhaseGraph phase_graph {};
     std::vector<CompletePhaseGraphVertex> vertices(sites.size());
     for (std::size_t idx {0}; idx < sites.size(); ++idx) {
@@ -485,8 +663,7 @@ Phaser::phase_sample(const std::vector<GenomicRegion>& sites,
     PhaseQualityTable pairwise_phase_qualities(sites.size(), PhaseQualityTable::value_type(sites.size()));
     for (std::size_t lhs_region_idx {0}; lhs_region_idx < sites.size() - 1; ++lhs_region_idx) {
         for (auto rhs_region_idx = lhs_region_idx + 1; rhs_region_idx < sites.size(); ++rhs_region_idx) {
-            const auto phase_quality = compute_phase_quality(genotypes, sites, lhs_region_idx, rhs_region_idx,
-                                                             genotype_posteriors, genotype_info);
+            const auto phase_quality = phase_linker(lhs_region_idx, rhs_region_idx);
             if (phase_quality >= config_.min_phase_quality) {
                 boost::add_edge(vertices[lhs_region_idx], vertices[rhs_region_idx], phase_graph);
             }
@@ -34,12 +34,17 @@ public:
     using GenotypeCallMap            = std::unordered_map<SampleName, Genotype<IndexedHaplotype<>>>;
     
     enum class GenotypeMatchType { exact, unique };
+    // clique finds the maximal sets of sites that are all pairwise phased, which is quadratic in the number of sites.
+    // incremental builds contiguous phase sets from left to right, linking each site to the last few heterozygous
+    // sites of the current phase set.
+    enum class Algorithm { clique, incremental };
     
     struct Config
     {
         GenotypeMatchType genotype_match = GenotypeMatchType::exact;
         Phred<double> min_phase_quality = Phred<double> {10};
         boost::optional<Phred<double>> max_phase_quality = Phred<double> {100};
+        Algorithm algorithm = Algorithm::clique;
     };
     
     struct PhaseSet
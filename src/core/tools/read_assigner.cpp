@@ -263,14 +263,17 @@ auto calculate_likelihoods(const Genotype<Haplotype>& genotype,
         transform(std::cbegin(genotype), std::cend(genotype), std::begin(result),
                   [&reads, &reads_region, &read_hashes, indel_factor, model] (const auto& haplotype) mutable {
                       const auto expanded_haplotype = expand_for_alignment(haplotype, reads_region, indel_factor, model);
-                      const auto haplotype_hashes = make_kmer_hash_table<mapperKmerSize>(expanded_haplotype.sequence());
+                      auto& haplotype_hashes = thread_local_kmer_hash_table<mapperKmerSize>();
+                      populate_kmer_hash_table<mapperKmerSize>(expanded_haplotype.sequence(), haplotype_hashes);
                       auto haplotype_mapping_counts = init_mapping_counts(haplotype_hashes);
                       model.reset(expanded_haplotype);
-                      return calculate_likelihoods(haplotype, reads, haplotype_hashes, read_hashes, haplotype_mapping_counts, model);
+                      auto likelihoods = calculate_likelihoods(haplotype, reads, haplotype_hashes, read_hashes, haplotype_mapping_counts, model);
+                      clear_kmer_hash_table(haplotype_hashes);
+                      return likelihoods;
                   }, workers);
     } else {
         result.reserve(genotype.ploidy());
-        auto haplotype_hashes = init_kmer_hash_table<mapperKmerSize>();
+        auto& haplotype_hashes = thread_local_kmer_hash_table<mapperKmerSize>();
         for (const auto& haplotype : genotype) {
             const auto expanded_haplotype = expand_for_alignment(haplotype, reads_region, indel_factor, model);
             populate_kmer_hash_table<mapperKmerSize>(expanded_haplotype.sequence(), haplotype_hashes);
@@ -437,6 +440,36 @@ compute_haplotype_support(const Genotype<Haplotype>& genotype,
     return compute_haplotype_support(genotype, reads, std::move(model), ambiguous, config, workers);
 }
 
+HaplotypeSupportMap
+compute_haplotype_support(const Genotype<Haplotype>& genotype,
+                          const std::vector<AlignedRead>& reads,
+                          const ReadLikelihoodMatrix& likelihoods,
+                          boost::optional<AmbiguousReadList&> ambiguous,
+                          AssignmentConfig config)
+{
+    assert(likelihoods.size() == genotype.ploidy());
+    if (!reads.empty()) {
+        if (is_heterozygous(genotype)) {
+            if (is_max_zygosity(genotype)) {
+                return calculate_support(genotype, reads, get_priors(genotype, {}), likelihoods, ambiguous, config);
+            }
+            // Genotypes are sorted, so the rows of duplicate haplotypes are adjacent
+            const auto unique_genotype = collapse(genotype);
+            ReadLikelihoodMatrix unique_likelihoods {};
+            unique_likelihoods.reserve(unique_genotype.ploidy());
+            for (unsigned k {0}; k < genotype.ploidy(); ++k) {
+                if (k == 0 || genotype[k] != genotype[k - 1]) unique_likelihoods.push_back(likelihoods[k]);
+            }
+            return calculate_support(unique_genotype, reads, get_priors(unique_genotype, {}), unique_likelihoods, ambiguous, config);
+        } else if (config.ambiguous_action != AssignmentConfig::AmbiguousAction::drop) {
+            HaplotypeSupportMap result {};
+            result.emplace(genotype[0], reads);
+            return result;
+        }
+    }
+    return {};
+}
+
 HaplotypeTemplateSupportMap
 compute_haplotype_support(const Genotype<Haplotype>& genotype,
                           const std::vector<AlignedTemplate>& reads,
@@ -122,6 +122,17 @@ compute_haplotype_support(const Genotype<Haplotype>& genotype,
                           AssignmentConfig config = AssignmentConfig {},
                           OptionalThreadPool workers = boost::none);
 
+// Likelihoods already computed for the reads, indexed [haplotype][read], with a row for each genotype haplotype
+using ReadLikelihoodMatrix = std::vector<std::vector<double>>;
+
+// Assigns reads with precomputed likelihoods (e.g. the caller's), rather than evaluating each read again
+HaplotypeSupportMap
+compute_haplotype_support(const Genotype<Haplotype>& genotype,
+                          const std::vector<AlignedRead>& reads,
+                          const ReadLikelihoodMatrix& likelihoods,
+                          boost::optional<AmbiguousReadList&> ambiguous = boost::none,
+                          AssignmentConfig config = AssignmentConfig {});
+
 // AlignedTemplate
 
 HaplotypeTemplateSupportMap
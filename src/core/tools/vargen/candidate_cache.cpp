@@ -0,0 +1,203 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "candidate_cache.hpp"
+
+#include <sstream>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "exceptions/unwritable_file_error.hpp"
+#include "exceptions/malformed_file_error.hpp"
+#include "logging/logging.hpp"
+
+namespace octopus { namespace coretools {
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Data layout: each cached region is a header line '>contig\tbegin\tend\tn' followed by n lines
+// 'begin\tref\talt', with empty alleles written as '-'.
+
+static const std::string dataFileName {"candidates"};
+static const std::string fingerprintFileName {"fingerprint"};
+static const char emptyAllele {'-'};
+
+class UnwritableCandidateCache : public UnwritableFileError
+{
+    std::string do_where() const override { return "CandidateCache"; }
+public:
+    UnwritableCandidateCache(fs::path file) : UnwritableFileError {std::move(file), "candidate cache"} {}
+};
+
+class MalformedCandidateCache : public MalformedFileError
+{
+    std::string do_where() const override { return "CandidateCache"; }
+public:
+    MalformedCandidateCache(fs::path file) : MalformedFileError {std::move(file), "candidate cache"} {}
+};
+
+std::string read_fingerprint(const fs::path& path)
+{
+    std::ifstream file {path.string()};
+    return {std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {}};
+}
+
+void write_fingerprint(const fs::path& path, const std::string& fingerprint)
+{
+    std::ofstream file {path.string(), std::ios::trunc};
+    file << fingerprint;
+}
+
+void write_allele(std::ostream& os, const Variant::NucleotideSequence& sequence)
+{
+    if (sequence.empty()) {
+        os << emptyAllele;
+    } else {
+        os << sequence;
+    }
+}
+
+Variant::NucleotideSequence read_allele(std::string&& field)
+{
+    if (field.size() == 1 && field.front() == emptyAllele) field.clear();
+    return std::move(field);
+}
+
+} // namespace
+
+CandidateCache::CandidateCache(Path directory, std::string fingerprint)
+: directory_ {std::move(directory)}
+{
+    boost::system::error_code ec {};
+    fs::create_directories(directory_, ec);
+    if (ec) throw UnwritableCandidateCache {directory_};
+    const auto data_path = directory_ / dataFileName;
+    const auto fingerprint_path = directory_ / fingerprintFileName;
+    auto mode = std::ios::in | std::ios::out | std::ios::app;
+    if (fs::exists(data_path) && read_fingerprint(fingerprint_path) != fingerprint) {
+        logging::WarningLogger warn_log {};
+        stream(warn_log) << "Clearing candidate cache " << directory_ << " as it was built with a different configuration";
+        mode |= std::ios::trunc;
+        mode ^= std::ios::app;
+    }
+    write_fingerprint(fingerprint_path, fingerprint);
+    if (!fs::exists(data_path)) std::ofstream {data_path.string()};
+    file_.open(data_path.string(), mode);
+    if (!file_) throw UnwritableCandidateCache {data_path};
+    build_index();
+}
+
+const CandidateCache::Path& CandidateCache::directory() const noexcept
+{
+    return directory_;
+}
+
+std::size_t CandidateCache::num_regions() const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    std::size_t result {0};
+    for (const auto& p : index_) result += p.second.size();
+    return result;
+}
+
+boost::optional<std::vector<Variant>> CandidateCache::fetch(const GenomicRegion& region) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    const auto contig_itr = index_.find(region.contig_name());
+    if (contig_itr == std::cend(index_)) return boost::none;
+    const auto& blocks = contig_itr->second;
+    const auto block_itr = std::find_if(std::cbegin(blocks), std::cend(blocks),
+                                        [&] (const Block& block) { return contains(block.region, region.contig_region()); });
+    if (block_itr == std::cend(blocks)) return boost::none;
+    auto result = read(region.contig_name(), *block_itr);
+    if (block_itr->region != region.contig_region()) {
+        result.erase(std::remove_if(std::begin(result), std::end(result),
+                                    [&] (const Variant& candidate) { return !overlaps(candidate, region); }),
+                     std::end(result));
+    }
+    return result;
+}
+
+void CandidateCache::write(const GenomicRegion& region, const std::vector<Variant>& candidates)
+{
+    std::ostringstream ss {};
+    ss << '>' << region.contig_name() << '\t' << region.begin() << '\t' << region.end() << '\t' << candidates.size() << '\n';
+    for (const auto& candidate : candidates) {
+        ss << mapped_begin(candidate) << '\t';
+        write_allele(ss, ref_sequence(candidate));
+        ss << '\t';
+        write_allele(ss, alt_sequence(candidate));
+        ss << '\n';
+    }
+    std::lock_guard<std::mutex> lock {mutex_};
+    file_.clear();
+    file_.seekp(0, std::ios::end);
+    const auto offset = static_cast<std::streamoff>(file_.tellp());
+    file_ << ss.str();
+    file_.flush();
+    if (!file_) throw UnwritableCandidateCache {directory_ / dataFileName};
+    index_[region.contig_name()].push_back({region.contig_region(), offset, candidates.size()});
+}
+
+// private methods
+
+void CandidateCache::build_index()
+{
+    file_.clear();
+    file_.seekg(0);
+    std::string line {};
+    std::streamoff offset {0};
+    while (std::getline(file_, line)) {
+        const auto line_offset = offset;
+        offset += line.size() + 1;
+        if (line.empty() || line.front() != '>') continue;
+        std::istringstream ss {line.substr(1)};
+        ContigName contig {};
+        ContigRegion::Position begin, end;
+        std::size_t n;
+        if (std::getline(ss, contig, '\t') && ss >> begin >> end >> n) {
+            // Blocks from an interrupted write are ignored
+            std::size_t num_read {0};
+            while (num_read < n && std::getline(file_, line)) {
+                offset += line.size() + 1;
+                ++num_read;
+            }
+            if (num_read == n) index_[contig].push_back({ContigRegion {begin, end}, line_offset, n});
+        }
+    }
+    file_.clear();
+}
+
+std::vector<Variant> CandidateCache::read(const ContigName& contig, const Block& block) const
+{
+    file_.clear();
+    file_.seekg(block.offset);
+    std::string line {};
+    std::getline(file_, line); // header
+    std::vector<Variant> result {};
+    result.reserve(block.num_candidates);
+    for (std::size_t i {0}; i < block.num_candidates && std::getline(file_, line); ++i) {
+        std::istringstream ss {line};
+        ContigRegion::Position begin;
+        std::string ref, alt;
+        ss >> begin;
+        ss.ignore();
+        std::getline(ss, ref, '\t');
+        std::getline(ss, alt);
+        result.emplace_back(contig, begin, read_allele(std::move(ref)), read_allele(std::move(alt)));
+    }
+    if (result.size() != block.num_candidates) {
+        MalformedCandidateCache error {directory_ / dataFileName};
+        error.set_reason("the candidate block for " + contig + " is truncated");
+        throw error;
+    }
+    return result;
+}
+
+} // namespace coretools
+} // namespace octopus
@@ -0,0 +1,76 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef candidate_cache_hpp
+#define candidate_cache_hpp
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <fstream>
+#include <mutex>
+#include <ios>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include "config/common.hpp"
+#include "basics/contig_region.hpp"
+#include "basics/genomic_region.hpp"
+#include "core/types/variant.hpp"
+
+namespace octopus { namespace coretools {
+
+/*
+    Stores the final candidates generated for each candidate region in a file in the cache directory,
+    so later runs on the same reads can skip candidate generation. The cache directory also records a
+    fingerprint of the configuration the candidates were generated with; opening the cache with a
+    different fingerprint clears it. Regions are indexed in memory when the cache is opened.
+
+    All methods are thread-safe.
+ */
+class CandidateCache
+{
+public:
+    using Path = boost::filesystem::path;
+
+    CandidateCache() = delete;
+
+    CandidateCache(Path directory, std::string fingerprint);
+
+    CandidateCache(const CandidateCache&)            = delete;
+    CandidateCache& operator=(const CandidateCache&) = delete;
+    CandidateCache(CandidateCache&&)                 = delete;
+    CandidateCache& operator=(CandidateCache&&)      = delete;
+
+    ~CandidateCache() = default;
+
+    const Path& directory() const noexcept;
+    std::size_t num_regions() const;
+
+    // The candidates overlapping region if a cached region contains it
+    boost::optional<std::vector<Variant>> fetch(const GenomicRegion& region) const;
+
+    void write(const GenomicRegion& region, const std::vector<Variant>& candidates);
+
+private:
+    struct Block
+    {
+        ContigRegion region;
+        std::streamoff offset;
+        std::size_t num_candidates;
+    };
+
+    Path directory_;
+    mutable std::fstream file_;
+    std::unordered_map<ContigName, std::vector<Block>> index_;
+    mutable std::mutex mutex_;
+
+    void build_index();
+    std::vector<Variant> read(const ContigName& contig, const Block& block) const;
+};
+
+} // namespace coretools
+} // namespace octopus
+
+#endif
@@ -6,9 +6,13 @@
 #include <iterator>
 #include <algorithm>
 #include <numeric>
+#include <cstdint>
+#include <unordered_map>
+#include <memory>
 
 #include <boost/iterator/zip_iterator.hpp>
 #include <boost/tuple/tuple.hpp>
+#include <boost/functional/hash.hpp>
 
 #include "config/common.hpp"
 #include "basics/aligned_read.hpp"
@@ -19,6 +23,7 @@
 #include "utils/append.hpp"
 #include "utils/sequence_utils.hpp"
 #include "utils/free_memory.hpp"
+#include "utils/simd_bytes.hpp"
 #include "logging/logging.hpp"
 
 #include "utils/maths.hpp"
@@ -37,11 +42,14 @@ CigarScanner::CigarScanner(const ReferenceGenome& reference, Options options)
 , candidates_ {}
 , likely_misaligned_candidates_ {}
 , max_seen_candidate_size_ {}
+, candidate_index_ {}
 , combined_read_coverage_tracker_ {}
 , misaligned_read_coverage_tracker_ {}
 , sample_read_coverage_tracker_ {}
 , sample_forward_strand_coverage_tracker_ {}
 , artificial_read_buffer_ {}
+, reference_block_region_ {}
+, reference_block_ {}
 {
     buffer_.reserve(100);
 }
@@ -86,9 +94,7 @@ void CigarScanner::do_add_template(const SampleName& sample, const AlignedTempla
     add_template(sample, reads, sample_read_coverage_tracker_[sample], sample_forward_strand_coverage_tracker_[sample]);
 }
 
-void CigarScanner::add_read(const SampleName& sample, const AlignedRead& read,
-                            CoverageTracker<GenomicRegion>& coverage_tracker,
-                            CoverageTracker<GenomicRegion>& forward_strand_coverage_tracker)
+double CigarScanner::scan_read(const SampleName& sample, const AlignedRead& read)
 {
     using std::cbegin; using std::next;
     using Flag = CigarOperation::Flag;
@@ -99,12 +105,12 @@ void CigarScanner::add_read(const SampleName& sample, const AlignedRead& read,
     GenomicRegion region;
     double misalignment_penalty {0};
     buffer_.clear();
+    match_snv_offsets_.clear();
     for (const auto& cigar_operation : read.cigar()) {
         const auto op_size = cigar_operation.size();
         switch (cigar_operation.flag()) {
             case Flag::alignmentMatch:
-                misalignment_penalty += add_snvs_in_match_range(GenomicRegion {read_contig, ref_index, ref_index + op_size},
-                                                                read, read_index, sample);
+                add_snvs_in_match_range(GenomicRegion {read_contig, ref_index, ref_index + op_size}, read, read_index, sample);
                 read_index += op_size;
                 ref_index  += op_size;
                 break;
@@ -115,7 +121,7 @@ void CigarScanner::add_read(const SampleName& sample, const AlignedRead& read,
             case Flag::substitution:
             {
                 region = GenomicRegion {read_contig, ref_index, ref_index + op_size};
-                auto ref_sequence = reference_.get().fetch_sequence(region);
+                auto ref_sequence = fetch_reference(region);
                 if (ref_sequence.size() > 1 && options_.split_mnvs) {
                     for (CigarOperation::Size snv_offset {0}; snv_offset < op_size; ++snv_offset) {
                         add_candidate(GenomicRegion {read_contig, ref_index + snv_offset, ref_index + snv_offset + 1},
@@ -147,8 +153,9 @@ void CigarScanner::add_read(const SampleName& sample, const AlignedRead& read,
             case Flag::deletion:
             {
                 region = GenomicRegion {read_contig, ref_index, ref_index + op_size};
+                auto ref_sequence = fetch_reference(region);
                 add_candidate(std::move(region),
-                              reference_.get().fetch_sequence(region),
+                              std::move(ref_sequence),
                               "",
                               read, read_index, sample);
                 ref_index += op_size;
@@ -179,16 +186,42 @@ void CigarScanner::add_read(const SampleName& sample, const AlignedRead& read,
                 break;
         }
     }
+    return misalignment_penalty;
+}
+
+double CigarScanner::calculate_snv_misalignment_penalty(const AlignedRead& read) const noexcept
+{
+    if (!options_.misalignment_parameters) return 0;
+    const auto& base_qualities = read.base_qualities();
+    const auto num_penalised_snvs = std::count_if(std::cbegin(match_snv_offsets_), std::cend(match_snv_offsets_),
+                                                  [&] (const auto offset) {
+                                                      return base_qualities[offset] >= options_.misalignment_parameters->snv_threshold;
+                                                  });
+    return num_penalised_snvs * options_.misalignment_parameters->snv_penalty;
+}
+
+void CigarScanner::add_coverage(const AlignedRead& read, const unsigned count,
+                                RangeCoverageTracker<GenomicRegion>& coverage_tracker,
+                                RangeCoverageTracker<GenomicRegion>& forward_strand_coverage_tracker)
+{
     if (options_.use_clipped_coverage_tracking) {
         const auto clipped_region = clipped_mapped_region(read);
-        combined_read_coverage_tracker_.add(clipped_region);
-        coverage_tracker.add(clipped_region);
-        if (is_forward_strand(read)) forward_strand_coverage_tracker.add(clipped_region);
+        combined_read_coverage_tracker_.add(clipped_region, count);
+        coverage_tracker.add(clipped_region, count);
+        if (is_forward_strand(read)) forward_strand_coverage_tracker.add(clipped_region, count);
     } else {
-        combined_read_coverage_tracker_.add(read);
-        coverage_tracker.add(read);
-        if (is_forward_strand(read)) forward_strand_coverage_tracker.add(read);
+        combined_read_coverage_tracker_.add(read, count);
+        coverage_tracker.add(read, count);
+        if (is_forward_strand(read)) forward_strand_coverage_tracker.add(read, count);
     }
+}
+
+void CigarScanner::add_read(const SampleName& sample, const AlignedRead& read,
+                            RangeCoverageTracker<GenomicRegion>& coverage_tracker,
+                            RangeCoverageTracker<GenomicRegion>& forward_strand_coverage_tracker)
+{
+    const auto misalignment_penalty = scan_read(sample, read) + calculate_snv_misalignment_penalty(read);
+    add_coverage(read, 1, coverage_tracker, forward_strand_coverage_tracker);
     if (!is_likely_misaligned(read, misalignment_penalty)) {
         utils::append(std::move(buffer_), candidates_);
     } else {
@@ -197,14 +230,95 @@ void CigarScanner::add_read(const SampleName& sample, const AlignedRead& read,
     }
 }
 
+void CigarScanner::add_identical_reads(const SampleName& sample, const ReadGroup& reads,
+                                       RangeCoverageTracker<GenomicRegion>& coverage_tracker,
+                                       RangeCoverageTracker<GenomicRegion>& forward_strand_coverage_tracker)
+{
+    assert(!reads.empty());
+    const AlignedRead& representative {reads.front()};
+    const auto misalignment_penalty = scan_read(sample, representative);
+    add_coverage(representative, reads.size(), coverage_tracker, forward_strand_coverage_tracker);
+    // The reads only differ in their qualities, so some may look misaligned when others do not
+    auto aligned_reads = std::make_shared<ReadGroup>(), misaligned_reads = std::make_shared<ReadGroup>();
+    for (const AlignedRead& read : reads) {
+        if (!is_likely_misaligned(read, misalignment_penalty + calculate_snv_misalignment_penalty(read))) {
+            aligned_reads->push_back(read);
+        } else {
+            misaligned_reads->push_back(read);
+        }
+    }
+    if (!misaligned_reads->empty()) {
+        misaligned_read_coverage_tracker_.add(clipped_mapped_region(representative), misaligned_reads->size());
+    }
+    const auto add_candidates = [this] (std::shared_ptr<const ReadGroup> sources, auto& result) {
+        for (const auto& candidate : buffer_) {
+            result.push_back(candidate);
+            result.back().source = sources->front();
+            result.back().sources = sources;
+        }
+    };
+    if (!aligned_reads->empty()) add_candidates(std::move(aligned_reads), candidates_);
+    if (!misaligned_reads->empty()) add_candidates(std::move(misaligned_reads), likely_misaligned_candidates_);
+}
+
+namespace {
+
+bool are_identical(const AlignedRead& lhs, const AlignedRead& rhs) noexcept
+{
+    return is_same_region(lhs, rhs) && lhs.direction() == rhs.direction()
+        && lhs.cigar() == rhs.cigar() && lhs.sequence() == rhs.sequence();
+}
+
+} // namespace
+
+template <typename ForwardIterator>
+void CigarScanner::add_reads(const SampleName& sample, ForwardIterator first, const ForwardIterator last)
+{
+    auto& coverage_tracker = sample_read_coverage_tracker_[sample];
+    auto& forward_strand_coverage_tracker = sample_forward_strand_coverage_tracker_[sample];
+    if (!options_.collapse_identical_reads) {
+        std::for_each(first, last, [&] (const auto& read) { add_read(sample, read, coverage_tracker, forward_strand_coverage_tracker); });
+        return;
+    }
+    // Identical reads have the same mapped region, so only reads sharing a region need be grouped
+    std::vector<ReadGroup> groups {};
+    std::unordered_multimap<std::size_t, std::size_t> group_indices {};
+    while (first != last) {
+        const auto region_last = std::find_if_not(std::next(first), last, [&] (const AlignedRead& read) { return is_same_region(read, *first); });
+        groups.clear();
+        group_indices.clear();
+        for (; first != region_last; ++first) {
+            const AlignedRead& read {*first};
+            auto hash = std::hash<NucleotideSequence> {}(read.sequence());
+            boost::hash_combine(hash, is_forward_strand(read));
+            const auto matches = group_indices.equal_range(hash);
+            const auto group_itr = std::find_if(matches.first, matches.second,
+                                                [&] (const auto& p) { return are_identical(groups[p.second].front(), read); });
+            if (group_itr != matches.second) {
+                groups[group_itr->second].push_back(read);
+            } else {
+                group_indices.emplace(hash, groups.size());
+                groups.push_back({read});
+            }
+        }
+        for (const auto& group : groups) {
+            if (group.size() == 1) {
+                add_read(sample, group.front(), coverage_tracker, forward_strand_coverage_tracker);
+            } else {
+                add_identical_reads(sample, group, coverage_tracker, forward_strand_coverage_tracker);
+            }
+        }
+    }
+}
+
 bool have_split_insertion(const AlignedRead& lhs, const AlignedRead& rhs)
 {
     return are_adjacent(lhs, rhs) && is_insertion(lhs.cigar().back()) && is_insertion(rhs.cigar().front()) && rhs.cigar().size() == 1;
 }
 
 void CigarScanner::add_template(const SampleName& sample, const AlignedTemplate& reads,
-                                CoverageTracker<GenomicRegion>& coverage_tracker,
-                                CoverageTracker<GenomicRegion>& forward_strand_coverage_tracker)
+                                RangeCoverageTracker<GenomicRegion>& coverage_tracker,
+                                RangeCoverageTracker<GenomicRegion>& forward_strand_coverage_tracker)
 {
     for (auto read_itr = std::cbegin(reads); read_itr != std::cend(reads);) {
         const static auto has_tail_insertion = [] (const AlignedRead& read) { return is_insertion(read.cigar().back()); };
@@ -250,15 +364,11 @@ void CigarScanner::add_template(const SampleName& sample, const AlignedTemplate&
 
 void CigarScanner::do_add_reads(const SampleName& sample, ReadVectorIterator first, ReadVectorIterator last)
 {
-    auto& coverage_tracker = sample_read_coverage_tracker_[sample];
-    auto& forward_strand_coverage_tracker = sample_forward_strand_coverage_tracker_[sample];
-    std::for_each(first, last, [&] (const auto& read) { add_read(sample, read, coverage_tracker, forward_strand_coverage_tracker); });
+    add_reads(sample, first, last);
 }
 void CigarScanner::do_add_reads(const SampleName& sample, ReadFlatSetIterator first, ReadFlatSetIterator last)
 {
-    auto& coverage_tracker = sample_read_coverage_tracker_[sample];
-    auto& forward_strand_coverage_tracker = sample_forward_strand_coverage_tracker_[sample];
-    std::for_each(first, last, [&] (const auto& read) { add_read(sample, read, coverage_tracker, forward_strand_coverage_tracker); });
+    add_reads(sample, first, last);
 }
 void CigarScanner::do_add_reads(const SampleName& sample, TemplateVectorIterator first, TemplateVectorIterator last)
 {
@@ -273,7 +383,7 @@ void CigarScanner::do_add_reads(const SampleName& sample, TemplateFlatSetIterato
     std::for_each(first, last, [&] (const auto& reads) { add_template(sample, reads, coverage_tracker, forward_strand_coverage_tracker); });
 }
 
-unsigned get_min_depth(const Variant& v, const CoverageTracker<GenomicRegion>& tracker)
+unsigned get_min_depth(const Variant& v, const RangeCoverageTracker<GenomicRegion>& tracker)
 {
     if (is_insertion(v)) {
         const auto& region = mapped_region(v);
@@ -328,10 +438,58 @@ void choose_push_back(Variant candidate, std::vector<Variant>& final_candidates,
     }
 }
 
+namespace {
+
+// Candidates are added read by read, so are mostly in order of position already. When the candidates
+// cover a short enough span, they are bucketed by begin position and only each bucket is sorted.
+template <typename Container>
+void sort_by_position(Container& candidates)
+{
+    if (candidates.size() < 2) return;
+    const auto& contig = contig_name(candidates.front());
+    if (std::any_of(std::cbegin(candidates), std::cend(candidates),
+                    [&] (const auto& candidate) { return contig_name(candidate) != contig; })) {
+        std::sort(std::begin(candidates), std::end(candidates));
+        return;
+    }
+    const auto minmax = std::minmax_element(std::cbegin(candidates), std::cend(candidates),
+                                            [] (const auto& lhs, const auto& rhs) { return mapped_begin(lhs) < mapped_begin(rhs); });
+    const auto min_begin = mapped_begin(*minmax.first);
+    const auto span = static_cast<std::size_t>(mapped_begin(*minmax.second) - min_begin) + 1;
+    if (span > 8 * candidates.size() + 1'000) {
+        std::sort(std::begin(candidates), std::end(candidates));
+        return;
+    }
+    std::vector<std::uint32_t> offsets(span + 1, 0);
+    for (const auto& candidate : candidates) ++offsets[mapped_begin(candidate) - min_begin + 1];
+    std::partial_sum(std::cbegin(offsets), std::cend(offsets), std::begin(offsets));
+    using Candidate = typename Container::value_type;
+    std::vector<boost::optional<Candidate>> bucketed(candidates.size());
+    {
+        auto cursors = offsets;
+        for (auto& candidate : candidates) bucketed[cursors[mapped_begin(candidate) - min_begin]++] = std::move(candidate);
+    }
+    auto candidate_itr = std::begin(candidates);
+    for (std::size_t bucket {0}; bucket < span; ++bucket) {
+        const auto bucket_begin = candidate_itr;
+        for (auto i = offsets[bucket]; i < offsets[bucket + 1]; ++i, ++candidate_itr) *candidate_itr = std::move(*bucketed[i]);
+        if (std::distance(bucket_begin, candidate_itr) > 1) std::stable_sort(bucket_begin, candidate_itr);
+    }
+}
+
+} // namespace
+
 std::vector<Variant> CigarScanner::do_generate(const RegionSet& regions, OptionalThreadPool workers) const
 {
-    std::sort(std::begin(candidates_), std::end(candidates_));
-    std::sort(std::begin(likely_misaligned_candidates_), std::end(likely_misaligned_candidates_));
+    sort_by_position(candidates_);
+    sort_by_position(likely_misaligned_candidates_);
+    // A few long deletions inflate max_seen_candidate_size_ for every region, so index the candidates
+    // when they are all on one contig
+    if (!candidates_.empty() && is_same_contig(candidates_.front(), candidates_.back())) {
+        candidate_index_.rebuild(std::cbegin(candidates_), std::cend(candidates_));
+    } else {
+        candidate_index_.clear();
+    }
     std::vector<Variant> result {};
     for (const auto& region : regions) {
         generate(region, result);
@@ -342,6 +500,7 @@ std::vector<Variant> CigarScanner::do_generate(const RegionSet& regions, Optiona
 void CigarScanner::do_clear() noexcept
 {
     free_memory(buffer_);
+    free_memory(match_snv_offsets_);
     free_memory(candidates_);
     free_memory(likely_misaligned_candidates_);
     free_memory(combined_read_coverage_tracker_);
@@ -349,7 +508,10 @@ void CigarScanner::do_clear() noexcept
     free_memory(sample_read_coverage_tracker_);
     free_memory(sample_forward_strand_coverage_tracker_);
     free_memory(artificial_read_buffer_);
+    reference_block_region_ = GenomicRegion {};
+    free_memory(reference_block_);
     max_seen_candidate_size_ = 0;
+    candidate_index_.clear();
 }
 
 std::string CigarScanner::name() const
@@ -359,30 +521,64 @@ std::string CigarScanner::name() const
 
 // private methods
 
-double CigarScanner::add_snvs_in_match_range(const GenomicRegion& region, const AlignedRead& read,
-                                             std::size_t read_index, const SampleName& origin)
+namespace {
+
+// Reads are mostly added in order, so the reference is fetched in blocks of at least this many bases
+constexpr GenomicRegion::Size min_reference_block_size {10'000};
+
+} // namespace
+
+const char* CigarScanner::fetch_reference(const GenomicRegion& region, std::size_t& num_bases)
 {
-    const NucleotideSequence ref_segment {reference_.get().fetch_sequence(region)};
-    double misalignment_penalty {0};
-    for (std::size_t ref_index {0}; ref_index < ref_segment.size(); ++ref_index, ++read_index) {
-        const char ref_base {ref_segment[ref_index]}, read_base {read.sequence()[read_index]};
-        if (ref_base != read_base && ref_base != 'N' && read_base != 'N') {
+    if (!contains(reference_block_region_, region)) {
+        const auto contig_size = reference_.get().contig_size(region.contig_name());
+        const auto block_end = std::min(std::max(region.end(), region.begin() + min_reference_block_size), contig_size);
+        if (block_end >= region.end()) {
+            reference_block_region_ = GenomicRegion {region.contig_name(), region.begin(), block_end};
+        } else {
+            reference_block_region_ = region; // runs off the end of the contig
+        }
+        reference_block_ = reference_.get().fetch_sequence(reference_block_region_);
+    }
+    const auto offset = std::min(static_cast<std::size_t>(region.begin() - reference_block_region_.begin()), reference_block_.size());
+    num_bases = std::min(static_cast<std::size_t>(size(region)), reference_block_.size() - offset);
+    return reference_block_.data() + offset;
+}
+
+CigarScanner::NucleotideSequence CigarScanner::fetch_reference(const GenomicRegion& region)
+{
+    std::size_t num_bases;
+    const auto first = fetch_reference(region, num_bases);
+    return NucleotideSequence {first, first + num_bases};
+}
+
+void CigarScanner::add_snvs_in_match_range(const GenomicRegion& region, const AlignedRead& read,
+                                           std::size_t read_index, const SampleName& origin)
+{
+    std::size_t num_bases;
+    const auto ref_first = fetch_reference(region, num_bases);
+    const auto read_first = read.sequence().data() + read_index;
+    const auto ref_last = ref_first + std::min(num_bases, read.sequence().size() - std::min(read_index, read.sequence().size()));
+    for (auto ref_itr = utils::simd::find_first_mismatch(ref_first, ref_last, read_first); ref_itr != ref_last;
+         ref_itr = utils::simd::find_first_mismatch(ref_itr + 1, ref_last, read_first + (ref_itr - ref_first) + 1)) {
+        const auto ref_index = static_cast<std::size_t>(ref_itr - ref_first);
+        const char ref_base {*ref_itr}, read_base {read_first[ref_index]};
+        if (ref_base != 'N' && read_base != 'N') {
             const auto begin_pos = region.begin() + static_cast<GenomicRegion::Position>(ref_index);
             add_candidate(GenomicRegion {region.contig_name(), begin_pos, begin_pos + 1},
-                          ref_base, read_base, read, read_index, origin);
-            if (options_.misalignment_parameters && read.base_qualities()[read_index] >= options_.misalignment_parameters->snv_threshold) {
-                misalignment_penalty += options_.misalignment_parameters->snv_penalty;
-            }
+                          ref_base, read_base, read, read_index + ref_index, origin);
+            match_snv_offsets_.push_back(read_index + ref_index);
         }
     }
-    return misalignment_penalty;
 }
 
 void CigarScanner::generate(const GenomicRegion& region, std::vector<Variant>& result) const
 {
     using std::begin; using std::end; using std::cbegin; using std::cend; using std::next;
     assert(std::is_sorted(std::cbegin(candidates_), std::cend(candidates_)));
-    auto viable_candidates = overlap_range(candidates_, region, max_seen_candidate_size_);
+    auto viable_candidates = candidate_index_.size() == candidates_.size()
+                             ? candidate_index_.overlap_range(cbegin(candidates_), cend(candidates_), region)
+                             : overlap_range(candidates_, region, max_seen_candidate_size_);
     if (empty(viable_candidates)) return;
     result.reserve(result.size() + size(viable_candidates, BidirectionallySortedTag {})); // maximum possible
     const auto last_viable_candidate_itr = cend(viable_candidates);
@@ -420,9 +616,9 @@ void CigarScanner::generate(const GenomicRegion& region, std::vector<Variant>& r
     }
 }
 
-unsigned CigarScanner::sum_base_qualities(const Candidate& candidate) const noexcept
+unsigned CigarScanner::sum_base_qualities(const Candidate& candidate, const AlignedRead& source) const noexcept
 {
-    const auto first_base_qual_itr = std::next(std::cbegin(candidate.source.get().base_qualities()), candidate.offset);
+    const auto first_base_qual_itr = std::next(std::cbegin(source.base_qualities()), candidate.offset);
     const auto last_base_qual_itr = std::next(first_base_qual_itr, alt_sequence_size(candidate.variant));
     return std::accumulate(first_base_qual_itr, last_base_qual_itr, 0u);
 }
@@ -438,6 +634,20 @@ bool CigarScanner::is_likely_misaligned(const AlignedRead& read, const double pe
     }
 }
 
+namespace {
+
+template <typename Candidate, typename UnaryFunction>
+void for_each_source(const Candidate& candidate, UnaryFunction&& f)
+{
+    if (candidate.sources) {
+        for (const AlignedRead& source : *candidate.sources) f(source);
+    } else {
+        f(candidate.source.get());
+    }
+}
+
+} // namespace
+
 CigarScanner::VariantObservation
 CigarScanner::make_observation(const CandidateIterator first_match, const CandidateIterator last_match) const
 {
@@ -453,27 +663,18 @@ CigarScanner::make_observation(const CandidateIterator first_match, const Candid
         const auto& origin = observation_itr->origin;
         auto next_itr = std::find_if_not(next(observation_itr), end(observations),
                                          [&] (const Candidate& c) { return c.origin.get() == origin.get(); });
-        const auto num_observations = static_cast<unsigned>(std::distance(observation_itr, next_itr));
-        std::vector<unsigned> observed_base_qualities(num_observations);
-        std::transform(observation_itr, next_itr, begin(observed_base_qualities),
-                       [this] (const Candidate& c) noexcept { return sum_base_qualities(c); });
-        std::vector<AlignedRead::MappingQuality> observed_mapping_qualities(num_observations);
-        std::transform(observation_itr, next_itr, begin(observed_mapping_qualities),
-                       [] (const Candidate& c) noexcept { return c.source.get().mapping_quality(); });
-        const auto forward_strand_support = std::accumulate(observation_itr, next_itr, 0u,
-                                                     [] (unsigned curr, const Candidate& c) noexcept {
-                                                         if (is_forward_strand(c.source.get())) {
-                                                             ++curr;
-                                                         }
-                                                         return curr;
-                                                     });
-        const auto edge_support = std::accumulate(observation_itr, next_itr, 0u,
-                                                      [] (unsigned curr, const Candidate& c) noexcept {
-                                                          if (begins_equal(c, c.source.get()) || ends_equal(c, c.source.get())) {
-                                                              ++curr;
-                                                          }
-                                                          return curr;
-                                                      });
+        std::vector<unsigned> observed_base_qualities {};
+        std::vector<AlignedRead::MappingQuality> observed_mapping_qualities {};
+        unsigned forward_strand_support {0}, edge_support {0};
+        std::for_each(observation_itr, next_itr, [&] (const Candidate& c) {
+            for_each_source(c, [&] (const AlignedRead& source) {
+                observed_base_qualities.push_back(sum_base_qualities(c, source));
+                observed_mapping_qualities.push_back(source.mapping_quality());
+                if (is_forward_strand(source)) ++forward_strand_support;
+                if (begins_equal(c, source) || ends_equal(c, source)) ++edge_support;
+            });
+        });
+        const auto num_observations = static_cast<unsigned>(observed_base_qualities.size());
         const auto depth = std::max(get_min_depth(candidate.variant, sample_read_coverage_tracker_.at(origin)), num_observations);
         const auto forward_depth = get_min_depth(candidate.variant, sample_forward_strand_coverage_tracker_.at(origin));
         result.sample_observations.push_back({origin, depth, forward_depth,
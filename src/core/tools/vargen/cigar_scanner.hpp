@@ -16,8 +16,9 @@
 #include "concepts/mappable.hpp"
 #include "concepts/comparable.hpp"
 #include "basics/aligned_read.hpp"
+#include "containers/mappable_interval_tree.hpp"
 #include "core/types/variant.hpp"
-#include "utils/coverage_tracker.hpp"
+#include "utils/range_coverage_tracker.hpp"
 #include "variant_generator.hpp"
 
 namespace octopus {
@@ -66,6 +67,9 @@ public:
         boost::optional<MisalignmentParameters> misalignment_parameters = MisalignmentParameters {};
         bool split_mnvs = true;
         bool ignore_strand_bias = false;
+        // Scan each distinct read (same region, strand, cigar and sequence) once, which makes
+        // scanning very deep amplicon data proportional to the number of distinct reads
+        bool collapse_identical_reads = false;
     };
     
     CigarScanner() = delete;
@@ -87,11 +91,13 @@ private:
     void do_add_read(const SampleName& sample, const AlignedRead& read) override;
     void do_add_template(const SampleName& sample, const AlignedTemplate& reads) override;
     void add_read(const SampleName& sample, const AlignedRead& read,
-                  CoverageTracker<GenomicRegion>& coverage_tracker,
-                  CoverageTracker<GenomicRegion>& forward_strand_coverage_tracker);
+                  RangeCoverageTracker<GenomicRegion>& coverage_tracker,
+                  RangeCoverageTracker<GenomicRegion>& forward_strand_coverage_tracker);
     void add_template(const SampleName& sample, const AlignedTemplate& reads,
-                      CoverageTracker<GenomicRegion>& coverage_tracker,
-                      CoverageTracker<GenomicRegion>& forward_strand_coverage_tracker);
+                      RangeCoverageTracker<GenomicRegion>& coverage_tracker,
+                      RangeCoverageTracker<GenomicRegion>& forward_strand_coverage_tracker);
+    template <typename ForwardIterator>
+    void add_reads(const SampleName& sample, ForwardIterator first, ForwardIterator last);
     void do_add_reads(const SampleName& sample, ReadVectorIterator first, ReadVectorIterator last) override;
     void do_add_reads(const SampleName& sample, ReadFlatSetIterator first, ReadFlatSetIterator last) override;
     void do_add_reads(const SampleName& sample, TemplateVectorIterator first, TemplateVectorIterator last) override;
@@ -100,12 +106,15 @@ private:
     void do_clear() noexcept override;
     std::string name() const override;
     
+    using ReadGroup = std::vector<std::reference_wrapper<const AlignedRead>>;
+    
     struct Candidate : public Comparable<Candidate>, public Mappable<Candidate>
     {
         Variant variant;
         std::reference_wrapper<const AlignedRead> source;
         std::reference_wrapper<const SampleName> origin;
         std::size_t offset;
+        std::shared_ptr<const ReadGroup> sources = nullptr; // if not null, source and the reads identical to it
         
         template <typename T1, typename T2, typename T3>
         Candidate(T1&& region, T2&& sequence_removed, T3&& sequence_added,
@@ -120,26 +129,40 @@ private:
     
     using NucleotideSequence = AlignedRead::NucleotideSequence;
     using SequenceIterator = NucleotideSequence::const_iterator;
-    using SampleCoverageTrackerMap = std::unordered_map<SampleName, CoverageTracker<GenomicRegion>>;
+    using SampleCoverageTrackerMap = std::unordered_map<SampleName, RangeCoverageTracker<GenomicRegion>>;
     
     std::reference_wrapper<const ReferenceGenome> reference_;
     Options options_;
     std::vector<Candidate> buffer_;
+    std::vector<std::size_t> match_snv_offsets_;
     mutable std::deque<Candidate> candidates_, likely_misaligned_candidates_;
     Variant::MappingDomain::Size max_seen_candidate_size_;
-    CoverageTracker<GenomicRegion> combined_read_coverage_tracker_, misaligned_read_coverage_tracker_;
+    mutable MappableIntervalIndex<Candidate> candidate_index_;
+    RangeCoverageTracker<GenomicRegion> combined_read_coverage_tracker_, misaligned_read_coverage_tracker_;
     SampleCoverageTrackerMap sample_read_coverage_tracker_, sample_forward_strand_coverage_tracker_;
     std::deque<AlignedRead> artificial_read_buffer_;
+    GenomicRegion reference_block_region_;
+    NucleotideSequence reference_block_;
     
     using CandidateIterator = OverlapIterator<decltype(candidates_)::const_iterator>;
     
     template <typename T1, typename T2, typename T3>
     void add_candidate(T1&& region, T2&& sequence_removed, T3&& sequence_added,
                        const AlignedRead& read, std::size_t offset, const SampleName& sample);
-    double add_snvs_in_match_range(const GenomicRegion& region, const AlignedRead& read,
-                                   std::size_t read_index, const SampleName& origin);
+    const char* fetch_reference(const GenomicRegion& region, std::size_t& num_bases);
+    NucleotideSequence fetch_reference(const GenomicRegion& region);
+    double scan_read(const SampleName& sample, const AlignedRead& read);
+    void add_snvs_in_match_range(const GenomicRegion& region, const AlignedRead& read,
+                                 std::size_t read_index, const SampleName& origin);
+    double calculate_snv_misalignment_penalty(const AlignedRead& read) const noexcept;
+    void add_coverage(const AlignedRead& read, unsigned count,
+                      RangeCoverageTracker<GenomicRegion>& coverage_tracker,
+                      RangeCoverageTracker<GenomicRegion>& forward_strand_coverage_tracker);
+    void add_identical_reads(const SampleName& sample, const ReadGroup& reads,
+                             RangeCoverageTracker<GenomicRegion>& coverage_tracker,
+                             RangeCoverageTracker<GenomicRegion>& forward_strand_coverage_tracker);
     void generate(const GenomicRegion& region, std::vector<Variant>& result) const;
-    unsigned sum_base_qualities(const Candidate& candidate) const noexcept;
+    unsigned sum_base_qualities(const Candidate& candidate, const AlignedRead& source) const noexcept;
     bool is_likely_misaligned(const AlignedRead& read, double penalty) const;
     VariantObservation make_observation(CandidateIterator first_match, CandidateIterator last_match) const;
     std::vector<Variant> get_novel_likely_misaligned_candidates(const std::vector<Variant>& current_candidates) const;
@@ -9,6 +9,8 @@
 #include <stdexcept>
 #include <thread>
 #include <future>
+#include <atomic>
+#include <array>
 #include <cassert>
 
 #include "tandem/tandem.hpp"
@@ -25,6 +27,7 @@
 #include "utils/free_memory.hpp"
 #include "io/reference/reference_genome.hpp"
 #include "logging/logging.hpp"
+#include "logging/profiler_zones.hpp"
 
 namespace octopus { namespace coretools {
 
@@ -185,9 +188,9 @@ bool requires_masking(const AlignedRead& read, const AlignedRead::BaseQuality go
     return has_low_quality_flank(read, good_quality) || has_low_quality_match(read, good_quality);
 }
 
-auto find_first_sequence_op(const std::vector<CigarOperation::Flag>& cigar) noexcept
+auto find_first_sequence_op(const CigarString& cigar) noexcept
 {
-    return std::find_if_not(std::cbegin(cigar), std::cend(cigar),
+    return std::find_if_not(flags_begin(cigar), flags_end(cigar),
                             [] (auto op) { return op == CigarOperation::Flag::hardClipped; });
 }
 
@@ -207,16 +210,16 @@ auto transform_low_quality_matches_to_reference(AlignedRead::NucleotideSequence
                                                 const CigarString& cigar,
                                                 const AlignedRead::BaseQuality min_quality)
 {
-    const auto expanded_cigar = decompose(cigar);
+    const auto cigar_end = flags_end(cigar);
     auto ref_itr   = std::cbegin(reference_sequence);
-    auto cigar_itr = find_first_sequence_op(expanded_cigar);
+    auto cigar_itr = find_first_sequence_op(cigar);
     bool has_masked {false};
     std::transform(std::cbegin(read_sequence), std::cend(read_sequence), std::cbegin(base_qualities),
                    std::begin(read_sequence), [&] (const auto read_base, const auto base_quality) {
         using Flag = CigarOperation::Flag;
         // Deletions are excess reference sequence so we need to move the
         // reference iterator to the next non-deleted read base
-        while (cigar_itr != std::cend(expanded_cigar) && *cigar_itr == Flag::deletion) {
+        while (cigar_itr != cigar_end && *cigar_itr == Flag::deletion) {
             ++cigar_itr;
             ++ref_itr;
         }
@@ -355,35 +358,24 @@ std::vector<Variant> LocalReassembler::do_generate(const RegionSet& regions, Opt
     finalise_bins(bins, regions);
     if (bins.empty()) return {};
     std::deque<Variant> candidates {};
-    if (workers && bins.size() > 1 && workers->size() > 1) {
+    if (workers && workers->size() > 1) {
+        // Each bin task fans its kmer sizes out onto the pool too, so bins x kmer sizes run concurrently
         std::vector<std::future<std::deque<Variant>>> bin_futures {};
         bin_futures.reserve(bins.size());
         for (auto& bin : bins) {
             bin_futures.push_back(workers->try_push([&] () {
-                if (debug_log_) {
-                    stream(*debug_log_) << "Assembling " << bin.size() << " reads in bin " << mapped_region(bin);
-                }
-                std::deque<Variant> result {};
-                    const auto num_default_failures = try_assemble_with_defaults(bin, result);
-                    if (num_default_failures == default_kmer_sizes_.size()) {
-                        try_assemble_with_fallbacks(bin, result);
-                    }
-                    bin.clear();
-                    return result;
+                auto result = assemble(bin, workers);
+                bin.clear();
+                return result;
             }));
         }
         for (auto&& f : bin_futures) {
+            workers->wait(f);
             utils::append(f.get(), candidates);
         }
     } else {
         for (auto& bin : bins) {
-            if (debug_log_) {
-                stream(*debug_log_) << "Assembling " << bin.size() << " reads in bin " << mapped_region(bin);
-            }
-            const auto num_default_failures = try_assemble_with_defaults(bin, candidates);
-            if (num_default_failures == default_kmer_sizes_.size()) {
-                try_assemble_with_fallbacks(bin, candidates);
-            }
+            utils::append(assemble(bin, boost::none), candidates);
             bin.clear();
         }
     }
@@ -492,12 +484,58 @@ void log_failure(L& log, const char* type, const unsigned k)
 
 } // namespace
 
-unsigned LocalReassembler::try_assemble_with_defaults(const Bin& bin, std::deque<Variant>& result) const
+std::deque<Variant> LocalReassembler::assemble(const Bin& bin, OptionalThreadPool workers) const
+{
+    OCTOPUS_ZONE("LocalReassembler::assemble");
+    if (debug_log_) {
+        stream(*debug_log_) << "Assembling " << bin.size() << " reads in bin " << mapped_region(bin);
+    }
+    std::deque<Variant> result {};
+    if (default_kmer_sizes_.empty()) return result;
+    const auto reference = fetch_reference(bin);
+    const auto num_default_failures = try_assemble_with_defaults(bin, reference, result, workers);
+    if (num_default_failures == default_kmer_sizes_.size()) {
+        try_assemble_with_fallbacks(bin, reference, result, workers);
+    }
+    return result;
+}
+
+namespace {
+
+template <typename F>
+void run_attempts(const std::size_t num_attempts, F attempt, boost::optional<ThreadPool&> workers)
 {
+    if (workers && workers->size() > 1 && num_attempts > 1) {
+        std::vector<std::future<void>> futures {};
+        futures.reserve(num_attempts);
+        for (std::size_t i {0}; i < num_attempts; ++i) {
+            futures.push_back(workers->try_push([&attempt, i] () { attempt(i); }));
+        }
+        for (auto& f : futures) {
+            workers->wait(f);
+            f.get();
+        }
+    } else {
+        for (std::size_t i {0}; i < num_attempts; ++i) attempt(i);
+    }
+}
+
+} // namespace
+
+unsigned LocalReassembler::try_assemble_with_defaults(const Bin& bin, const BinReference& reference,
+                                                      std::deque<Variant>& result, OptionalThreadPool workers) const
+{
+    const auto num_attempts = default_kmer_sizes_.size();
+    std::vector<AssemblerStatus> statuses(num_attempts);
+    std::vector<std::deque<Variant>> attempt_results(num_attempts);
+    run_attempts(num_attempts, [&] (const std::size_t i) {
+        statuses[i] = assemble_bin(default_kmer_sizes_[i], bin, reference, attempt_results[i]);
+    }, workers);
     unsigned num_failures {0};
-    for (const auto k : default_kmer_sizes_) {
-        const auto status = assemble_bin(k, bin, result);
-        switch (status) {
+    for (std::size_t i {0}; i < num_attempts; ++i) {
+        const auto k = default_kmer_sizes_[i];
+        utils::append(std::move(attempt_results[i]), result);
+        switch (statuses[i]) {
             case AssemblerStatus::success:
                 log_success(debug_log_, "Default", k);
                 break;
@@ -513,27 +551,51 @@ unsigned LocalReassembler::try_assemble_with_defaults(const Bin& bin, std::deque
     return num_failures;
 }
 
-void LocalReassembler::try_assemble_with_fallbacks(const Bin& bin, std::deque<Variant>& result) const
-{
-    auto prev_k = default_kmer_sizes_.back();
-    for (const auto k : fallback_kmer_sizes_) {
-        const auto status = assemble_bin(k, bin, result);
-        switch (status) {
+void LocalReassembler::try_assemble_with_fallbacks(const Bin& bin, const BinReference& reference,
+                                                   std::deque<Variant>& result, OptionalThreadPool workers) const
+{
+    // Fallbacks are tried together, but only the results up to the first success are used (as if they
+    // were tried in order), so attempts after the first success are abandoned
+    const auto num_attempts = fallback_kmer_sizes_.size();
+    std::vector<AssemblerStatus> statuses(num_attempts, AssemblerStatus::failed);
+    std::vector<std::deque<Variant>> attempt_results(num_attempts);
+    std::atomic<std::size_t> first_success {num_attempts};
+    run_attempts(num_attempts, [&] (const std::size_t i) {
+        const auto is_cancelled = [&first_success, i] () noexcept { return first_success.load(std::memory_order_relaxed) < i; };
+        if (is_cancelled()) return;
+        statuses[i] = assemble_bin(fallback_kmer_sizes_[i], bin, reference, attempt_results[i], is_cancelled);
+        if (statuses[i] == AssemblerStatus::success) {
+            auto curr = first_success.load();
+            while (i < curr && !first_success.compare_exchange_weak(curr, i));
+        }
+    }, workers);
+    const auto num_used_attempts = std::min(first_success.load() + 1, num_attempts);
+    for (std::size_t i {0}; i < num_used_attempts; ++i) {
+        const auto k = fallback_kmer_sizes_[i];
+        utils::append(std::move(attempt_results[i]), result);
+        switch (statuses[i]) {
             case AssemblerStatus::success:
                 log_success(debug_log_, "Fallback", k);
-                if (k - prev_k > 5) {
-                    const auto gap = k - prev_k;
-                    assemble_bin(k - gap / 2, bin, result);
-                    assemble_bin(k + gap / 2, bin, result);
-                }
-                return;
+                break;
             case AssemblerStatus::partial_success:
                 log_partial_success(debug_log_, "Fallback", k);
                 break;
             default:
                 log_failure(debug_log_, "Fallback", k);
         }
-        prev_k = k;
+    }
+    if (first_success < num_attempts) {
+        const auto k = fallback_kmer_sizes_[first_success];
+        const auto prev_k = first_success > 0 ? fallback_kmer_sizes_[first_success - 1] : default_kmer_sizes_.back();
+        if (k - prev_k > 5) {
+            const auto gap = k - prev_k;
+            const std::array<unsigned, 2> gap_kmer_sizes {k - gap / 2, k + gap / 2};
+            std::array<std::deque<Variant>, 2> gap_results {};
+            run_attempts(gap_kmer_sizes.size(), [&] (const std::size_t i) {
+                assemble_bin(gap_kmer_sizes[i], bin, reference, gap_results[i]);
+            }, workers);
+            for (auto& variants : gap_results) utils::append(std::move(variants), result);
+        }
     }
 }
 
@@ -558,6 +620,26 @@ GenomicRegion LocalReassembler::propose_assembler_region(const GenomicRegion& in
     }
 }
 
+LocalReassembler::BinReference LocalReassembler::fetch_reference(const Bin& bin) const
+{
+    auto max_kmer_size = default_kmer_sizes_.back();
+    if (!fallback_kmer_sizes_.empty()) max_kmer_size = std::max(max_kmer_size, fallback_kmer_sizes_.back());
+    auto region = propose_assembler_region(bin.region, max_kmer_size);
+    auto sequence = reference_.get().fetch_sequence(region);
+    return {std::move(region), std::move(sequence)};
+}
+
+LocalReassembler::NucleotideSequence
+LocalReassembler::fetch_reference(const GenomicRegion& region, const BinReference& bin_reference) const
+{
+    if (contains(bin_reference.region, region) && bin_reference.sequence.size() == size(bin_reference.region)) {
+        const auto offset = begin_distance(bin_reference.region, region);
+        return bin_reference.sequence.substr(offset, size(region));
+    } else {
+        return reference_.get().fetch_sequence(region);
+    }
+}
+
 void LocalReassembler::load(const Bin& bin, Assembler& assembler) const
 {
     for (const auto& read : bin.forward_read_sequences) {
@@ -583,21 +665,23 @@ void LocalReassembler::load(const Bin& bin, const std::size_t sample_idx, Assemb
 }
 
 LocalReassembler::AssemblerStatus
-LocalReassembler::assemble_bin(const unsigned kmer_size, const Bin& bin, std::deque<Variant>& result) const
+LocalReassembler::assemble_bin(const unsigned kmer_size, const Bin& bin, const BinReference& reference,
+                               std::deque<Variant>& result, const CancellationPredicate& is_cancelled) const
 {
     if (bin.empty()) return AssemblerStatus::success;
     const auto assemble_region = propose_assembler_region(bin.region, kmer_size);
     if (size(assemble_region) < kmer_size) return AssemblerStatus::failed;
-    const auto reference_sequence = reference_.get().fetch_sequence(assemble_region);
+    const auto reference_sequence = fetch_reference(assemble_region, reference);
     if (!utils::is_canonical_dna(reference_sequence)) return AssemblerStatus::failed;
     Assembler::Parameters assembler_params {kmer_size};
     assembler_params.use_strand_bias = !ignore_strand_bias_;
     Assembler assembler {assembler_params, reference_sequence};
     if (assembler.is_unique_reference()) {
         load(bin, assembler);
+        if (is_cancelled && is_cancelled()) return AssemblerStatus::failed;
         auto status = try_assemble_region(assembler, reference_sequence, assemble_region, result);
         const auto num_samples = read_buffer_.size();
-        if (num_samples > 1 && status != AssemblerStatus::success) {
+        if (num_samples > 1 && status != AssemblerStatus::success && !(is_cancelled && is_cancelled())) {
             for (std::size_t sample_idx {0}; sample_idx < num_samples; ++sample_idx) {
                 Assembler sample_assembler {assembler_params, reference_sequence};
                 load(bin, sample_idx, sample_assembler);
@@ -115,8 +115,17 @@ private:
     
     using BinList = std::deque<Bin>;
     
+    // The reference sequence around a bin, fetched once for all the kmer sizes tried on the bin
+    struct BinReference
+    {
+        GenomicRegion region;
+        NucleotideSequence sequence;
+    };
+    
     enum class AssemblerStatus { success, partial_success, failed };
     
+    using CancellationPredicate = std::function<bool()>;
+    
     ExecutionPolicy execution_policy_;
     std::reference_wrapper<const ReferenceGenome> reference_;
     std::vector<unsigned> default_kmer_sizes_, fallback_kmer_sizes_;
@@ -133,12 +142,18 @@ private:
     void prepare_bins(const GenomicRegion& active_region, BinList& bins) const;
     bool should_assemble_bin(const Bin& bin) const;
     void finalise_bins(BinList& bins, const RegionSet& active_regions) const;
-    unsigned try_assemble_with_defaults(const Bin& bin, std::deque<Variant>& result) const;
-    void try_assemble_with_fallbacks(const Bin& bin, std::deque<Variant>& result) const;
+    std::deque<Variant> assemble(const Bin& bin, OptionalThreadPool workers) const;
+    unsigned try_assemble_with_defaults(const Bin& bin, const BinReference& reference,
+                                        std::deque<Variant>& result, OptionalThreadPool workers) const;
+    void try_assemble_with_fallbacks(const Bin& bin, const BinReference& reference,
+                                     std::deque<Variant>& result, OptionalThreadPool workers) const;
     GenomicRegion propose_assembler_region(const GenomicRegion& input_region, unsigned kmer_size) const;
+    BinReference fetch_reference(const Bin& bin) const;
+    NucleotideSequence fetch_reference(const GenomicRegion& region, const BinReference& bin_reference) const;
     void load(const Bin& bin, Assembler& assembler) const;
     void load(const Bin& bin, std::size_t sample_idx, Assembler& assembler) const;
-    AssemblerStatus assemble_bin(unsigned kmer_size, const Bin& bin, std::deque<Variant>& result) const;
+    AssemblerStatus assemble_bin(unsigned kmer_size, const Bin& bin, const BinReference& reference,
+                                 std::deque<Variant>& result, const CancellationPredicate& is_cancelled = {}) const;
     AssemblerStatus try_assemble_region(Assembler& assembler, const NucleotideSequence& reference_sequence,
                                         const GenomicRegion& reference_region, std::deque<Variant>& result) const;
     double calculate_min_bubble_score(const GenomicRegion& bubble_region) const;
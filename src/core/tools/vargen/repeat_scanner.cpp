@@ -239,10 +239,7 @@ struct AdjacentRepeatPair : public Mappable<AdjacentRepeatPair>
 auto generate_tandem_repeats(const ReferenceGenome& reference, const GenomicRegion& region,
                              const unsigned max_period, const unsigned min_tract_length)
 {
-    auto result = find_exact_tandem_repeats(reference, region, max_period);
-    const auto is_too_short = [=] (const auto& repeat) { return region_size(repeat) < min_tract_length; };
-    result.erase(std::remove_if(std::begin(result), std::end(result), is_too_short), std::end(result));
-    return result;
+    return find_exact_tandem_repeats(reference, region, max_period, min_tract_length);
 }
 
 std::deque<AdjacentRepeatPair>
@@ -31,6 +31,7 @@
 #include "utils/sequence_utils.hpp"
 #include "utils/append.hpp"
 #include "utils/maths.hpp"
+#include "utils/kmer_encoding.hpp"
 
 #define _unused(x) ((void)(x))
 
@@ -68,6 +69,7 @@ Assembler::Assembler(const Parameters params)
 : params_ {params}
 , reference_kmers_ {}
 , reference_head_position_ {0}
+, vertex_cache_ {params.kmer_size}
 , reference_vertices_ {}
 {}
 
@@ -75,6 +77,7 @@ Assembler::Assembler(const Parameters params, const NucleotideSequence& referenc
 : params_ {params}
 , reference_kmers_ {}
 , reference_head_position_ {0}
+, vertex_cache_ {params.kmer_size}
 , reference_vertices_ {}
 {
     insert_reference_into_empty_graph(reference);
@@ -96,9 +99,7 @@ Assembler::Assembler(const Assembler& other)
                       boost::vertex_index_map(boost::make_assoc_property_map(index_map))
                       .orig_to_copy(boost::make_assoc_property_map(vertex_copy_map)));
     vertex_cache_ = other.vertex_cache_;
-    for (auto& p : vertex_cache_) {
-        p.second = vertex_copy_map.at(p.second);
-    }
+    vertex_cache_.transform_vertices([&] (const Vertex v) { return vertex_copy_map.at(v); });
     reference_vertices_ = other.reference_vertices_;
     for (auto& v : reference_vertices_) {
         v = vertex_copy_map.at(v);
@@ -150,12 +151,12 @@ void Assembler::insert_read(const NucleotideSequence& sequence,
         auto base_quality_itr = std::next(std::cbegin(base_qualities), kmer_size());
         Kmer prev_kmer {kmer_begin, kmer_end};
         bool prev_kmer_good {true};
-        auto vertex_itr = vertex_cache_.find(prev_kmer);
+        const auto prev_vertex = vertex_cache_.find(prev_kmer);
         auto ref_kmer_itr = std::cbegin(reference_kmers_);
-        if (vertex_itr == std::cend(vertex_cache_)) {
+        if (!prev_vertex) {
             const auto u = add_vertex(prev_kmer);
             if (!u) prev_kmer_good = false;
-        } else if (is_reference(vertex_itr->second)) {
+        } else if (is_reference(*prev_vertex)) {
             ref_kmer_itr = std::find(std::cbegin(reference_kmers_), std::cend(reference_kmers_), prev_kmer);
             assert(ref_kmer_itr != std::cend(reference_kmers_));
             auto next_kmer_begin = std::next(kmer_begin);
@@ -166,7 +167,7 @@ void Assembler::insert_read(const NucleotideSequence& sequence,
             ++ref_kmer_itr;
             for (; next_kmer_end <= std::cend(sequence) && ref_kmer_itr < std::cend(reference_kmers_);
                    ++next_kmer_begin, ++next_kmer_end, ++ref_kmer_itr, ++ref_vertex_itr, ++ref_edge_itr, ++base_quality_itr) {
-                if (std::equal(next_kmer_begin, next_kmer_end, std::cbegin(*ref_kmer_itr))) {
+                if (*std::prev(next_kmer_end) == ref_kmer_itr->back()) { // the previous kmers match
                     assert(ref_edge_itr != std::cend(reference_edges_));
                     increment_weight(*ref_edge_itr, is_forward_strand, *base_quality_itr, sample);
                 } else {
@@ -184,13 +185,14 @@ void Assembler::insert_read(const NucleotideSequence& sequence,
         ++kmer_begin;
         ++kmer_end;
         for (; kmer_end <= std::cend(sequence); ++kmer_begin, ++kmer_end, ++base_quality_itr) {
-            Kmer kmer {kmer_begin, kmer_end};
-            const auto kmer_itr = vertex_cache_.find(kmer);
-            if (kmer_itr == std::cend(vertex_cache_)) {
+            auto kmer = prev_kmer.next();
+            assert(kmer.begin() == kmer_begin);
+            const auto kmer_vertex = vertex_cache_.find(kmer);
+            if (!kmer_vertex) {
                 const auto v = add_vertex(kmer);
                 if (v) {
                     if (prev_kmer_good) {
-                        assert(vertex_cache_.count(prev_kmer) == 1);
+                        assert(vertex_cache_.contains(prev_kmer));
                         const auto u = vertex_cache_.at(prev_kmer);
                         add_edge(u, *v, 1, is_forward_strand, *base_quality_itr, false, sample);
                     }
@@ -201,7 +203,7 @@ void Assembler::insert_read(const NucleotideSequence& sequence,
             } else {
                 if (prev_kmer_good) {
                     const auto u = vertex_cache_.at(prev_kmer);
-                    const auto v = kmer_itr->second;
+                    const auto v = *kmer_vertex;
                     Edge e; bool e_in_graph;
                     std::tie(e, e_in_graph) = boost::edge(u, v, graph_);
                     if (e_in_graph) {
@@ -210,7 +212,7 @@ void Assembler::insert_read(const NucleotideSequence& sequence,
                         add_edge(u, v, 1, is_forward_strand, *base_quality_itr, false, sample);
                     }
                 }
-                if (is_reference(kmer_itr->second)) {
+                if (is_reference(*kmer_vertex)) {
                     ref_kmer_itr = std::find(ref_kmer_itr, std::cend(reference_kmers_), kmer);
                     if (ref_kmer_itr != std::cend(reference_kmers_)) {
                         auto next_kmer_begin = std::next(kmer_begin);
@@ -221,7 +223,7 @@ void Assembler::insert_read(const NucleotideSequence& sequence,
                         ++ref_kmer_itr;
                         for (; next_kmer_end <= std::cend(sequence) && ref_kmer_itr < std::cend(reference_kmers_);
                                ++next_kmer_begin, ++next_kmer_end, ++ref_kmer_itr, ++ref_vertex_itr, ++ref_edge_itr) {
-                            if (std::equal(next_kmer_begin, next_kmer_end, std::cbegin(*ref_kmer_itr))) {
+                            if (*std::prev(next_kmer_end) == ref_kmer_itr->back()) { // the previous kmers match
                                 assert(ref_edge_itr != std::cend(reference_edges_));
                                 increment_weight(*ref_edge_itr, is_forward_strand, *base_quality_itr, sample);
                             } else {
@@ -493,12 +495,55 @@ void Assembler::write_dot(std::ostream& out) const
 }
 
 // Kmer
-Assembler::Kmer::Kmer(SequenceIterator first, SequenceIterator last) noexcept
+
+static_assert(sizeof(std::size_t) == sizeof(std::uint64_t), "Kmer packing assumes 64-bit std::size_t");
+
+Assembler::Kmer::Kmer(SequenceIterator first, SequenceIterator last, std::size_t hash) noexcept
 : first_ {first}
 , last_ {last}
-, hash_ {boost::hash_range(first_, last_)}
+, hash_ {hash}
 {}
 
+Assembler::Kmer::Kmer(SequenceIterator first, SequenceIterator last) noexcept
+: first_ {first}
+, last_ {last}
+, hash_ {0}
+{
+    // Longer kmers are hashed one packed word of max_packed_kmer_size bases at a time
+    std::uint64_t word {0};
+    unsigned word_size {0};
+    for (; first != last; ++first) {
+        const auto code = encode_base(*first);
+        if (code == non_canonical_base_code) {
+            // Never equal to the code of a canonical kmer; non-canonical kmers are not added to the graph
+            hash_ = boost::hash_range(first_, last_) | (std::uint64_t {1} << 63);
+            return;
+        }
+        word = (word << 2) | code;
+        if (++word_size == max_packed_kmer_size) {
+            boost::hash_combine(hash_, word);
+            word = 0;
+            word_size = 0;
+        }
+    }
+    if (static_cast<std::size_t>(std::distance(first_, last_)) <= max_packed_kmer_size) {
+        hash_ = word;
+    } else if (word_size > 0) {
+        boost::hash_combine(hash_, word);
+    }
+}
+
+Assembler::Kmer Assembler::Kmer::next() const noexcept
+{
+    const auto kmer_size = static_cast<unsigned>(std::distance(first_, last_));
+    const auto code = encode_base(*last_);
+    if (kmer_size <= max_packed_kmer_size && code != non_canonical_base_code && !(hash_ >> 63)) {
+        const auto mask = RollingKmerEncoder::mask(kmer_size);
+        return Kmer {std::next(first_), std::next(last_), RollingKmerEncoder::roll(hash_, code, mask)};
+    }
+    return Kmer {std::next(first_), std::next(last_)};
+}
+
 char Assembler::Kmer::front() const noexcept
 {
     return *first_;
@@ -531,13 +576,107 @@ std::size_t Assembler::Kmer::hash() const noexcept
 
 bool operator==(const Assembler::Kmer& lhs, const Assembler::Kmer& rhs) noexcept
 {
-    return std::equal(lhs.first_, lhs.last_, rhs.first_);
+    return lhs.hash_ == rhs.hash_ && std::equal(lhs.first_, lhs.last_, rhs.first_);
 }
 
 bool operator<(const Assembler::Kmer& lhs, const Assembler::Kmer& rhs) noexcept
 {
     return std::lexicographical_compare(lhs.first_, lhs.last_, rhs.first_, rhs.last_);
 }
+// KmerTable
+Assembler::KmerTable::KmerTable(const unsigned kmer_size) noexcept
+: is_exact_hash_ {kmer_size <= Kmer::max_packed_kmer_size}
+{}
+
+void Assembler::KmerTable::reserve(const std::size_t n)
+{
+    std::size_t num_slots {16};
+    while (num_slots < 2 * n) num_slots *= 2;
+    if (num_slots > slots_.size()) rehash(num_slots);
+}
+
+void Assembler::KmerTable::clear() noexcept
+{
+    slots_.clear();
+    slots_.shrink_to_fit();
+    size_ = 0;
+    shift_ = 64;
+}
+
+const Assembler::Vertex* Assembler::KmerTable::find(const Kmer& kmer) const noexcept
+{
+    if (slots_.empty()) return nullptr;
+    const auto& slot = slots_[find_slot(kmer)];
+    return slot.empty() ? nullptr : &slot.vertex;
+}
+
+Assembler::Vertex Assembler::KmerTable::at(const Kmer& kmer) const
+{
+    const auto result = find(kmer);
+    if (!result) throw std::out_of_range {"Assembler::KmerTable::at"};
+    return *result;
+}
+
+void Assembler::KmerTable::emplace(const Kmer& kmer, const Vertex v)
+{
+    if (2 * (size_ + 1) > slots_.size()) {
+        rehash(std::max(2 * slots_.size(), std::size_t {16}));
+    }
+    auto& slot = slots_[find_slot(kmer)];
+    assert(slot.empty());
+    slot = {kmer, v};
+    ++size_;
+}
+
+bool Assembler::KmerTable::erase(const Kmer& kmer) noexcept
+{
+    if (slots_.empty()) return false;
+    auto hole = find_slot(kmer);
+    if (slots_[hole].empty()) return false;
+    // Backward shift deletion: pull later entries of the probe run into the hole, so no tombstones are needed
+    const auto mask = slots_.size() - 1;
+    for (auto i = (hole + 1) & mask; !slots_[i].empty(); i = (i + 1) & mask) {
+        const auto home = home_of(slots_[i].kmer.hash());
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            slots_[hole] = slots_[i];
+            hole = i;
+        }
+    }
+    slots_[hole] = Slot {};
+    --size_;
+    return true;
+}
+
+std::size_t Assembler::KmerTable::home_of(const std::size_t hash) const noexcept
+{
+    // Fibonacci hashing, as packed kmer codes are far from uniform in their low bits
+    return (hash * 11400714819323198485ull) >> shift_;
+}
+
+std::size_t Assembler::KmerTable::find_slot(const Kmer& kmer) const noexcept
+{
+    assert(!slots_.empty());
+    const auto mask = slots_.size() - 1;
+    for (auto i = home_of(kmer.hash());; i = (i + 1) & mask) {
+        const auto& slot = slots_[i];
+        if (slot.empty() || (is_exact_hash_ ? slot.kmer.hash() == kmer.hash() : slot.kmer == kmer)) {
+            return i;
+        }
+    }
+}
+
+void Assembler::KmerTable::rehash(const std::size_t num_slots)
+{
+    assert(num_slots > 0 && (num_slots & (num_slots - 1)) == 0);
+    std::vector<Slot> old_slots(num_slots);
+    std::swap(slots_, old_slots);
+    shift_ = 64;
+    for (auto n = num_slots; n > 1; n /= 2) --shift_;
+    for (const auto& slot : old_slots) {
+        if (!slot.empty()) slots_[find_slot(slot.kmer)] = slot;
+    }
+}
+
 //
 // Assembler private methods
 //
@@ -644,7 +783,6 @@ void Assembler::insert_reference_into_populated_graph(const NucleotideSequence&
             reference_edges_.push_back(e);
         }
     }
-    vertex_cache_.rehash(vertex_cache_.size());
     reference_kmers_.shrink_to_fit();
     reference_vertices_.shrink_to_fit();
     reference_edges_.shrink_to_fit();
@@ -654,12 +792,12 @@ void Assembler::insert_reference_into_populated_graph(const NucleotideSequence&
 
 bool Assembler::contains_kmer(const Kmer& kmer) const noexcept
 {
-    return vertex_cache_.count(kmer) == 1;
+    return vertex_cache_.contains(kmer);
 }
 
 std::size_t Assembler::count_kmer(const Kmer& kmer) const noexcept
 {
-    return vertex_cache_.count(kmer);
+    return vertex_cache_.contains(kmer) ? 1 : 0;
 }
 
 std::size_t Assembler::reference_size() const noexcept
@@ -712,7 +850,7 @@ boost::optional<Assembler::Vertex> Assembler::add_vertex(const Kmer& kmer, const
 void Assembler::remove_vertex(const Vertex v)
 {
     const auto c = vertex_cache_.erase(kmer_of(v));
-    assert(c == 1);
+    assert(c);
     _unused(c); // make production build happy
     boost::remove_vertex(v, graph_);
 }
@@ -720,7 +858,7 @@ void Assembler::remove_vertex(const Vertex v)
 void Assembler::clear_and_remove_vertex(const Vertex v)
 {
     const auto c = vertex_cache_.erase(kmer_of(v));
-    assert(c == 1);
+    assert(c);
     _unused(c); // make production build happy
     boost::clear_vertex(v, graph_);
     boost::remove_vertex(v, graph_);
@@ -895,9 +1033,9 @@ boost::optional<Assembler::Vertex> Assembler::find_joining_kmer(const Vertex v)
     for (const auto base : bases) {
         adjacent_kmer.back() = base;
         const Kmer k {std::cbegin(adjacent_kmer), std::cend(adjacent_kmer)};
-        const auto itr = vertex_cache_.find(k);
-        if (itr != std::cend(vertex_cache_)) {
-            return itr->second;
+        const auto joining_vertex = vertex_cache_.find(k);
+        if (joining_vertex) {
+            return *joining_vertex;
         }
     }
     return boost::none;
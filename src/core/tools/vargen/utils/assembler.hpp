@@ -11,12 +11,14 @@
 #include <unordered_set>
 #include <functional>
 #include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <tuple>
 #include <stdexcept>
 #include <iosfwd>
 
 #include <boost/graph/adjacency_list.hpp>
+#include <boost/container/flat_map.hpp>
 #include <boost/optional.hpp>
 
 #include "concepts/equitable.hpp"
@@ -107,6 +109,8 @@ public:
     void write_dot(std::ostream& out) const;
     
 private:
+    // A view of kmer_size bases of some sequence. Kmers of up to max_packed_kmer_size bases are
+    // hashed to their 2-bit packed code, so two such kmers are equal iff their hashes are equal.
     class Kmer : public Comparable<Kmer>
     {
     public:
@@ -123,6 +127,9 @@ private:
         
         ~Kmer() = default;
         
+        // The kmer starting one base on in the same sequence, which must extend past end()
+        Kmer next() const noexcept;
+        
         char front() const noexcept;
         char back() const noexcept;
         
@@ -133,21 +140,20 @@ private:
         
         std::size_t hash() const noexcept;
         
+        static constexpr unsigned max_packed_kmer_size = 31;
+        
         friend bool operator==(const Kmer& lhs, const Kmer& rhs) noexcept;
         friend bool operator<(const Kmer& lhs, const Kmer& rhs) noexcept;
     private:
         SequenceIterator first_, last_;
         std::size_t hash_;
+        
+        Kmer(SequenceIterator first, SequenceIterator last, std::size_t hash) noexcept;
     };
     
     friend bool operator==(const Kmer& lhs, const Kmer& rhs) noexcept;
     friend bool operator<(const Kmer& lhs, const Kmer& rhs) noexcept;
     
-    struct KmerHash
-    {
-        std::size_t operator()(const Kmer& k) const noexcept { return k.hash(); }
-    };
-    
     struct GraphEdge
     {
         using WeightType = unsigned;
@@ -157,7 +163,7 @@ private:
             WeightType weight, forward_strand_weight;
             int base_quality_sum = 0;
         };
-        std::map<SampleID, Data> samples;
+        boost::container::flat_map<SampleID, Data> samples;
         WeightType weight, forward_strand_weight;
         int base_quality_sum = 0;
         bool is_reference = false;
@@ -180,6 +186,57 @@ private:
     
     using DominatorMap = std::unordered_map<Vertex, Vertex>;
     
+    // An open-addressed (linear probing) map from kmers to vertices, so lookups while threading
+    // reads into the graph do not chase node pointers.
+    class KmerTable
+    {
+    public:
+        KmerTable() = default;
+        explicit KmerTable(unsigned kmer_size) noexcept;
+        
+        KmerTable(const KmerTable&)            = default;
+        KmerTable& operator=(const KmerTable&) = default;
+        KmerTable(KmerTable&&)                 = default;
+        KmerTable& operator=(KmerTable&&)      = default;
+        
+        ~KmerTable() = default;
+        
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+        
+        void reserve(std::size_t n);
+        void clear() noexcept;
+        
+        // nullptr if the kmer is not in the table; invalidated by emplace and erase
+        const Vertex* find(const Kmer& kmer) const noexcept;
+        bool contains(const Kmer& kmer) const noexcept { return find(kmer) != nullptr; }
+        Vertex at(const Kmer& kmer) const;
+        
+        // The kmer must not already be in the table
+        void emplace(const Kmer& kmer, Vertex v);
+        bool erase(const Kmer& kmer) noexcept;
+        
+        template <typename UnaryFunction>
+        void transform_vertices(UnaryFunction f);
+        
+    private:
+        struct Slot
+        {
+            Kmer kmer;
+            Vertex vertex = boost::graph_traits<KmerGraph>::null_vertex(); // marks an empty slot
+            bool empty() const noexcept { return vertex == boost::graph_traits<KmerGraph>::null_vertex(); }
+        };
+        
+        std::vector<Slot> slots_ = {};
+        std::size_t size_ = 0;
+        unsigned shift_ = 64;
+        bool is_exact_hash_ = false;
+        
+        std::size_t home_of(std::size_t hash) const noexcept;
+        std::size_t find_slot(const Kmer& kmer) const noexcept;
+        void rehash(std::size_t num_slots);
+    };
+    
     using Path = std::deque<Vertex>;
     using EdgePath = std::vector<Edge>;
     using PredecessorMap = std::unordered_map<Vertex, Vertex>;
@@ -215,7 +272,7 @@ private:
     
     KmerGraph graph_;
     
-    std::unordered_map<Kmer, Vertex, KmerHash> vertex_cache_;
+    KmerTable vertex_cache_;
     Path reference_vertices_;
     std::deque<Edge> reference_edges_;
     
@@ -383,6 +440,14 @@ Assembler::Variant::Variant(std::size_t pos, S1&& ref, S2&& alt)
 
 bool operator==(const Assembler::Variant& lhs, const Assembler::Variant& rhs) noexcept;
 
+template <typename UnaryFunction>
+void Assembler::KmerTable::transform_vertices(UnaryFunction f)
+{
+    for (auto& slot : slots_) {
+        if (!slot.empty()) slot.vertex = f(slot.vertex);
+    }
+}
+
 template <typename UnaryFunction>
 void Assembler::for_each_edge(const Path& path, UnaryFunction f) const
 {
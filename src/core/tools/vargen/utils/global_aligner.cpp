@@ -21,29 +21,75 @@ struct Cell
     ScoreType match = 0, insertion = 0, deletion = 0;
 };
 
-using DPMatrix = std::vector<std::vector<Cell>>;
+// Stores the cells on the diagonals between the two corner diagonals, widened by band_width on each
+// side. Cells outside the band are never computed and read as unreachable, so memory and time are
+// linear in the sequence lengths for a fixed band width. A band_width of at least the length of the
+// shorter sequence gives the full matrix.
+class DPMatrix
+{
+public:
+    DPMatrix(const std::size_t ncols, const std::size_t nrows, const std::size_t band_width, const Cell::ScoreType inf)
+    : nrows_ {nrows}
+    , first_row_(ncols), last_row_(ncols), offsets_(ncols + 1)
+    , outside_ {inf, inf, inf}
+    {
+        const auto below = band_width + (ncols > nrows ? ncols - nrows : 0);
+        const auto above = band_width + (nrows > ncols ? nrows - ncols : 0);
+        for (std::size_t i {0}; i < ncols; ++i) {
+            first_row_[i] = i > below ? i - below : 0;
+            last_row_[i] = std::min(i + above, nrows - 1);
+            offsets_[i + 1] = offsets_[i] + (last_row_[i] - first_row_[i] + 1);
+        }
+        cells_.resize(offsets_.back());
+    }
+    
+    std::size_t ncols() const noexcept { return first_row_.size(); }
+    std::size_t nrows() const noexcept { return nrows_; }
+    std::size_t first_row(const std::size_t i) const noexcept { return first_row_[i]; }
+    std::size_t last_row(const std::size_t i) const noexcept { return last_row_[i]; }
+    bool in_band(const std::size_t i, const std::size_t j) const noexcept
+    {
+        return i < ncols() && j >= first_row_[i] && j <= last_row_[i];
+    }
+    const Cell& operator()(const std::size_t i, const std::size_t j) const noexcept
+    {
+        return in_band(i, j) ? cells_[offsets_[i] + (j - first_row_[i])] : outside_;
+    }
+    Cell& operator()(const std::size_t i, const std::size_t j) noexcept
+    {
+        assert(in_band(i, j));
+        return cells_[offsets_[i] + (j - first_row_[i])];
+    }
+    const Cell& back() const noexcept { return cells_.back(); }
+    
+private:
+    std::size_t nrows_;
+    std::vector<std::size_t> first_row_, last_row_, offsets_;
+    std::vector<Cell> cells_;
+    Cell outside_;
+};
 
 auto ncols(const DPMatrix& matrix) noexcept
 {
-    return matrix.size();
+    return matrix.ncols();
 }
 
 auto nrows(const DPMatrix& matrix) noexcept
 {
-    return matrix.front().size();
+    return matrix.nrows();
 }
 
-auto init_dp_matrix(const std::string& target, const std::string& query, const Model& model)
+auto init_dp_matrix(const std::string& target, const std::string& query, const Model& model, const std::size_t band_width)
 {
     assert(!(target.empty() || query.empty()));
-    DPMatrix result(target.size() + 1, DPMatrix::value_type(query.size() + 1));
     using ScoreType = Cell::ScoreType;
-    const ScoreType inf {std::min(model.mismatch, model.gap_open) * static_cast<ScoreType>(std::max(ncols(result), nrows(result)))};
-    for (std::size_t i {1}; i < ncols(result); ++i) {
-        result[i][0] = {inf, inf, model.gap_open + static_cast<ScoreType>(i - 1) * model.gap_extend};
+    const ScoreType inf {std::min(model.mismatch, model.gap_open) * static_cast<ScoreType>(std::max(target.size(), query.size()) + 1)};
+    DPMatrix result {target.size() + 1, query.size() + 1, band_width, inf};
+    for (std::size_t i {1}; i < ncols(result) && result.in_band(i, 0); ++i) {
+        result(i, 0) = {inf, inf, model.gap_open + static_cast<ScoreType>(i - 1) * model.gap_extend};
     }
-    for (std::size_t j {1}; j < nrows(result); ++j) {
-        result[0][j] = {inf, model.gap_open + static_cast<ScoreType>(j - 1) * model.gap_extend, inf};
+    for (std::size_t j {1}; j < nrows(result) && result.in_band(0, j); ++j) {
+        result(0, j) = {inf, model.gap_open + static_cast<ScoreType>(j - 1) * model.gap_extend, inf};
     }
     return result;
 }
@@ -53,19 +99,19 @@ auto match(const std::string& target, const std::string& query,
            const Model& model) noexcept
 {
     const auto penalty = target[i - 1] == query[j - 1] ? model.match : model.mismatch;
-    const auto& prev = matrix[i - 1][j - 1];
+    const auto& prev = matrix(i - 1, j - 1);
     return std::max({prev.match, prev.insertion, prev.deletion}) + penalty;
 }
 
 auto insertion(const DPMatrix& matrix, const std::size_t i, const std::size_t j, const Model& model) noexcept
 {
-    const auto& prev = matrix[i][j - 1];
+    const auto& prev = matrix(i, j - 1);
     return std::max(prev.insertion + model.gap_extend, prev.match + model.gap_open);
 }
 
 auto deletion(const DPMatrix& matrix, const std::size_t i, const std::size_t j, const Model& model) noexcept
 {
-    const auto& prev = matrix[i - 1][j];
+    const auto& prev = matrix(i - 1, j);
     return std::max(prev.deletion + model.gap_extend, prev.match + model.gap_open);
 }
 
@@ -73,24 +119,25 @@ void fill(const std::string& target, const std::string& query,
           DPMatrix& matrix, const std::size_t i, const std::size_t j,
           const Model& model) noexcept
 {
-    auto& curr = matrix[i][j];
+    Cell curr {};
     curr.match     = match(target, query, matrix, i, j, model);
     curr.insertion = insertion(matrix, i, j, model);
     curr.deletion  = deletion(matrix, i, j, model);
+    matrix(i, j) = curr;
 }
 
 void fill(DPMatrix& matrix, const std::string& target, const std::string& query, const Model& model) noexcept
 {
     for (std::size_t i {1}; i < ncols(matrix); ++i) {
-        for (std::size_t j {1}; j < nrows(matrix); ++j) {
+        for (auto j = std::max(matrix.first_row(i), std::size_t {1}); j <= matrix.last_row(i); ++j) {
             fill(target, query, matrix, i, j, model);
         }
     }
 }
 
-auto build_dp_matrix(const std::string& target, const std::string& query, const Model& model)
+auto build_dp_matrix(const std::string& target, const std::string& query, const Model& model, const std::size_t band_width)
 {
-    auto result = init_dp_matrix(target, query, model);
+    auto result = init_dp_matrix(target, query, model, band_width);
     fill(result, target, query, model);
     return result;
 }
@@ -98,7 +145,7 @@ auto build_dp_matrix(const std::string& target, const std::string& query, const
 char traceback(const std::string& target, const std::string& query, const DPMatrix& matrix,
                const std::size_t i, const std::size_t j, const Model& model, const char prev_state) noexcept
 {
-    const auto& curr = matrix[i][j];
+    const auto& curr = matrix(i, j);
     if (prev_state == '$') {
         if (curr.match >= curr.deletion) {
             if (curr.match >= curr.insertion) {
@@ -121,7 +168,7 @@ char traceback(const std::string& target, const std::string& query, const DPMatr
                 return curr.deletion >= curr.insertion ? 'D' : 'I';
             }
         } else if (prev_state == 'D') {
-            const auto& prev = matrix[i + 1][j];
+            const auto& prev = matrix(i + 1, j);
             if (prev.deletion == curr.match + model.gap_open) {
                 return target[i - 1] == query[j - 1] ? '=' : 'X';
             } else {
@@ -129,7 +176,7 @@ char traceback(const std::string& target, const std::string& query, const DPMatr
             }
         } else {
             assert(prev_state == 'I');
-            const auto& prev = matrix[i][j + 1];
+            const auto& prev = matrix(i, j + 1);
             if (prev.insertion == curr.match + model.gap_open) {
                 return target[i - 1] == query[j - 1] ? '=' : 'X';
             } else {
@@ -205,7 +252,7 @@ auto extract_alignment(const std::string& target, const std::string& query, cons
 
 auto score(const DPMatrix& matrix) noexcept
 {
-    const auto& last = matrix.back().back();
+    const auto& last = matrix.back();
     return std::max({last.match, last.insertion, last.deletion});
 }
 
@@ -214,6 +261,27 @@ Cell::ScoreType calculate_unaligned_score(const std::size_t target_length, const
     return 2 * model.gap_open + (target_length + query_length - 2) * model.gap_extend; 
 }
 
+constexpr std::size_t initial_band_width {32};
+
+bool can_band(const Model& model) noexcept
+{
+    return std::max(model.match, model.mismatch) >= 0 && model.gap_open <= model.gap_extend && model.gap_extend <= 0;
+}
+
+// An upper bound on the score of any alignment that leaves the band. Such an alignment must contain
+// both insertions and deletions, at least |target - query| + 2 * (band_width + 1) gapped bases in
+// total, and so at most min(target, query) - (band_width + 1) aligned bases.
+Cell::ScoreType
+max_score_outside_band(const std::size_t target_length, const std::size_t query_length, const std::size_t band_width,
+                       const Model& model) noexcept
+{
+    using ScoreType = Cell::ScoreType;
+    const auto max_aligned = static_cast<ScoreType>(std::min(target_length, query_length)) - static_cast<ScoreType>(band_width + 1);
+    const auto length_difference = static_cast<ScoreType>(std::max(target_length, query_length) - std::min(target_length, query_length));
+    const auto min_gapped = length_difference + 2 * static_cast<ScoreType>(band_width + 1);
+    return std::max(max_aligned, 0) * std::max(model.match, model.mismatch) + 2 * model.gap_open + (min_gapped - 2) * model.gap_extend;
+}
+
 } // namespace
 
 Alignment align(const std::string& target, const std::string& query, Model model)
@@ -229,16 +297,24 @@ Alignment align(const std::string& target, const std::string& query, Model model
         return {CigarString {CigarOperation {static_cast<Size>(target.size()), Flag::deletion}},
                 model.gap_open + static_cast<int>(target.size() - 1) * model.gap_extend};
     }
-    const auto matrix = build_dp_matrix(target, query, model);
-    auto alignment_score = score(matrix);
     const auto unaligned_score = calculate_unaligned_score(target.size(), query.size(), model);
-    if (alignment_score > unaligned_score) {
-        return {extract_alignment(target, query, matrix, model), alignment_score};
-    } else {
-        return {CigarString {CigarOperation {static_cast<Size>(target.size()), Flag::deletion},
-                             CigarOperation {static_cast<Size>(query.size()), Flag::insertion}},
-                unaligned_score};
+    // Double the band until no alignment leaving it could score higher than the best one inside it, at
+    // which point the banded score is exact. The last band covers the full matrix.
+    const auto full_band_width = std::min(target.size(), query.size());
+    auto band_width = can_band(model) ? std::min(initial_band_width, full_band_width) : full_band_width;
+    for (;; band_width = std::min(2 * band_width, full_band_width)) {
+        const auto matrix = build_dp_matrix(target, query, model, band_width);
+        const auto alignment_score = score(matrix);
+        if (band_width == full_band_width || alignment_score > max_score_outside_band(target.size(), query.size(), band_width, model)) {
+            if (alignment_score > unaligned_score) {
+                return {extract_alignment(target, query, matrix, model), alignment_score};
+            }
+            break;
+        }
     }
+    return {CigarString {CigarOperation {static_cast<Size>(target.size()), Flag::deletion},
+                         CigarOperation {static_cast<Size>(query.size()), Flag::insertion}},
+            unaligned_score};
 }
 
 } // namespace coretools
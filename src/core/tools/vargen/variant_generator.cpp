@@ -4,10 +4,14 @@
 #include "variant_generator.hpp"
 
 #include <algorithm>
+#include <iterator>
+#include <utility>
+#include <future>
+#include <chrono>
 #include <cassert>
 
-#include "utils/append.hpp"
-#include "utils/parallel_transform.hpp"
+#include "utils/timing.hpp"
+
 namespace octopus { namespace coretools {
 
 VariantGenerator::VariantGenerator()
@@ -96,36 +100,84 @@ void log_candidates(const std::vector<Variant>& candidates, const std::string& g
 
 } // namespace debug
 
-std::vector<Variant> VariantGenerator::generate(const GenomicRegion& region, OptionalThreadPool workers) const
+namespace {
+
+// Merges the sorted, duplicate free, results of each generator. Two generators can still propose the
+// same variant independently, so only the first copy is kept.
+std::vector<Variant> merge_unique(std::vector<std::vector<Variant>>& generator_results)
 {
+    using VariantIterator = std::vector<Variant>::iterator;
+    using Range = std::pair<VariantIterator, VariantIterator>;
+    std::vector<Range> heads {};
+    heads.reserve(generator_results.size());
+    std::size_t num_candidates {0};
+    for (auto& candidates : generator_results) {
+        if (!candidates.empty()) heads.emplace_back(std::begin(candidates), std::end(candidates));
+        num_candidates += candidates.size();
+    }
+    if (heads.size() == 1) {
+        for (auto& candidates : generator_results) {
+            if (!candidates.empty()) return std::move(candidates);
+        }
+    }
     std::vector<Variant> result {};
+    result.reserve(num_candidates);
+    const auto greater = [] (const Range& lhs, const Range& rhs) { return *rhs.first < *lhs.first; };
+    std::make_heap(std::begin(heads), std::end(heads), greater);
+    while (!heads.empty()) {
+        std::pop_heap(std::begin(heads), std::end(heads), greater);
+        auto& head = heads.back();
+        if (result.empty() || !(result.back() == *head.first)) result.push_back(std::move(*head.first));
+        if (++head.first == head.second) {
+            heads.pop_back();
+        } else {
+            std::push_heap(std::begin(heads), std::end(heads), greater);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+std::vector<Variant> VariantGenerator::generate(const GenomicRegion& region, OptionalThreadPool workers) const
+{
     const auto generate_helper = [&] (const auto& generator) {
+        const auto start = std::chrono::system_clock::now();
         const auto active_regions = generate_active_regions(region, *generator);
         debug::log_active_regions(active_regions, generator->name(), debug_log_);
         auto result = generator->do_generate(active_regions, workers);
         debug::log_candidates(result, generator->name(), debug_log_);
         assert(std::is_sorted(std::cbegin(result), std::cend(result)));
+        if (trace_log_) {
+            stream(*trace_log_) << generator->name() << " generated " << result.size() << " candidates in "
+                                << utils::TimeInterval {start, std::chrono::system_clock::now()};
+        }
         return result;
     };
-    if (workers && variant_generators_.size() > 1 && workers->n_idle() > variant_generators_.size()) {
-        std::vector<std::vector<Variant>> generator_results(variant_generators_.size());
-        using octopus::transform;
-        transform(std::cbegin(variant_generators_), std::cend(variant_generators_), 
-                  std::begin(generator_results), generate_helper, *workers); 
-        for (auto& generator_result : generator_results) {
-            utils::append(std::move(generator_result), result);
+    std::vector<std::vector<Variant>> generator_results(variant_generators_.size());
+    if (workers && variant_generators_.size() > 1) {
+        // The generators are independent given the reads, but their costs are very uneven, so each gets its
+        // own task rather than a chunk of the generators. try_push runs a task in the calling thread if no
+        // worker is idle, and the generators wait on any nested jobs they push with ThreadPool::wait.
+        using GeneratorTask = std::future<std::vector<Variant>>;
+        std::vector<GeneratorTask> tasks {};
+        tasks.reserve(variant_generators_.size());
+        for (auto itr = std::next(std::cbegin(variant_generators_)); itr != std::cend(variant_generators_); ++itr) {
+            tasks.push_back(workers->try_push([&generate_helper, itr] () { return generate_helper(*itr); }));
         }
-        std::sort(std::begin(result), std::end(result));
-    } else {
-        for (const auto& generator : variant_generators_) {
-            auto itr = utils::append(generate_helper(generator), result);
-            std::inplace_merge(std::begin(result), itr, std::end(result));
+        std::packaged_task<std::vector<Variant>()> first_task {[&] () { return generate_helper(variant_generators_.front()); }};
+        tasks.insert(std::begin(tasks), first_task.get_future());
+        first_task();
+        // Wait for every generator before any result is retrieved so none outlives this frame if one throws
+        for (const auto& task : tasks) workers->wait(task);
+        for (std::size_t i {0}; i < tasks.size(); ++i) {
+            generator_results[i] = tasks[i].get();
         }
+    } else {
+        std::transform(std::cbegin(variant_generators_), std::cend(variant_generators_),
+                       std::begin(generator_results), generate_helper);
     }
-    // Each generator is guaranteed to return unique variants, but two generators can still
-    // propose the same variants independently.
-    remove_duplicates(result);
-    return result;
+    return merge_unique(generator_results);
 }
 
 bool VariantGenerator::requires_reads() const noexcept
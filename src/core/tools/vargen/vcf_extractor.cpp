@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <iterator>
 #include <utility>
+#include <limits>
+#include <cstdint>
 
 #include "io/variant/vcf_spec.hpp"
 #include "io/variant/vcf_record.hpp"
@@ -22,10 +24,30 @@ VcfExtractor::VcfExtractor(std::unique_ptr<VcfReader> reader)
 VcfExtractor::VcfExtractor(std::unique_ptr<VcfReader> reader, Options options)
 : reader_ {std::move(reader)}
 , options_ {options}
+, cursor_ {}
 {
     reader_->close();
 }
 
+VcfExtractor::VcfExtractor(const VcfExtractor& other)
+: reader_ {other.reader_}
+, options_ {other.options_}
+, cursor_ {}
+{}
+
+VcfExtractor& VcfExtractor::operator=(const VcfExtractor& other)
+{
+    reader_ = other.reader_;
+    options_ = other.options_;
+    cursor_.reset();
+    return *this;
+}
+
+VcfExtractor::VcfExtractor(VcfExtractor&&) = default;
+VcfExtractor& VcfExtractor::operator=(VcfExtractor&&) = default;
+
+VcfExtractor::~VcfExtractor() = default;
+
 std::unique_ptr<VariantGenerator> VcfExtractor::do_clone() const
 {
     return std::make_unique<VcfExtractor>(*this);
@@ -97,14 +119,85 @@ void extract_variants(const VcfRecord& record, Container& result, const bool spl
 
 } // namespace
 
+/*
+    Streams the candidate fields of one contig's records forward from the first region requested,
+    so successive regions of the contig requested in order are fetched without seeking. The
+    variants of good records are held until a region starts past their end, as records may
+    overlap more than one region. The cursor only seeks if the contig changes or a region
+    starts before the previous one.
+ */
+class VcfExtractor::RecordCursor
+{
+public:
+    RecordCursor() = delete;
+    
+    RecordCursor(const VcfReader::Path& file) : reader_ {file}, last_region_ {}, records_ {}, pending_ {} {}
+    
+    RecordCursor(const RecordCursor&)            = delete;
+    RecordCursor& operator=(const RecordCursor&) = delete;
+    RecordCursor(RecordCursor&&)                 = delete;
+    RecordCursor& operator=(RecordCursor&&)      = delete;
+    
+    ~RecordCursor() = default;
+    
+    // Appends the variants of records overlapping region that satisfy is_good to result
+    template <typename UnaryPredicate, typename Container>
+    void fetch(const GenomicRegion& region, UnaryPredicate is_good, bool split_complex, Container& result);
+    
+private:
+    using PendingVariants = std::pair<GenomicRegion, std::vector<Variant>>;
+    
+    VcfReader reader_;
+    boost::optional<GenomicRegion> last_region_;
+    boost::optional<VcfReader::RecordIteratorPair> records_;
+    std::deque<PendingVariants> pending_;
+    
+    void seek(const GenomicRegion& region);
+};
+
+template <typename UnaryPredicate, typename Container>
+void VcfExtractor::RecordCursor::fetch(const GenomicRegion& region, UnaryPredicate is_good,
+                                       const bool split_complex, Container& result)
+{
+    if (!last_region_ || !is_same_contig(*last_region_, region) || region.begin() < last_region_->begin()) {
+        seek(region);
+    }
+    last_region_ = region;
+    pending_.erase(std::remove_if(std::begin(pending_), std::end(pending_),
+                                  [&] (const PendingVariants& variants) { return variants.first.end() <= region.begin(); }),
+                   std::end(pending_));
+    for (auto& records = *records_; records.first != records.second; ++records.first) {
+        const VcfRecord& record {*records.first};
+        if (record.mapped_region().begin() >= region.end()) break;
+        if (record.mapped_region().end() > region.begin() && is_good(record)) {
+            std::vector<Variant> variants {};
+            extract_variants(record, variants, split_complex);
+            pending_.emplace_back(record.mapped_region(), std::move(variants));
+        }
+    }
+    for (const auto& variants : pending_) {
+        if (variants.first.begin() < region.end()) {
+            result.insert(std::cend(result), std::cbegin(variants.second), std::cend(variants.second));
+        }
+    }
+}
+
+void VcfExtractor::RecordCursor::seek(const GenomicRegion& region)
+{
+    // The index can only jump forward to region, so stream to the end of the contig from there
+    static constexpr GenomicRegion::Position max_contig_end {std::numeric_limits<std::int32_t>::max()};
+    const GenomicRegion contig_tail {region.contig_name(), region.begin(), std::max(region.end(), max_contig_end)};
+    records_ = boost::none;
+    pending_.clear();
+    records_ = reader_.iterate(contig_tail, VcfReader::UnpackPolicy::candidates);
+}
+
 std::vector<Variant> VcfExtractor::do_generate(const RegionSet& regions, OptionalThreadPool workers) const
 {
-    reader_->open();
     std::vector<Variant> result {};
     for (const auto& region : regions) {
         utils::append(fetch_variants(region), result);
     }
-    reader_->close();
     return result;
 }
 
@@ -115,14 +208,9 @@ std::string VcfExtractor::name() const
 
 std::vector<Variant> VcfExtractor::fetch_variants(const GenomicRegion& region) const
 {
-  std::deque<Variant> variants {};
-    for (auto p = reader_->iterate(region, VcfReader::UnpackPolicy::sites); p.first != p.second; ++p.first) {
-        if (is_good(*p.first)) {
-            extract_variants(*p.first, variants, options_.split_complex);
-        }
-    }
-    std::vector<Variant> result {std::make_move_iterator(std::begin(variants)),
-                                 std::make_move_iterator(std::end(variants))};
+    if (!cursor_) cursor_ = std::make_unique<RecordCursor>(reader_->path());
+    std::vector<Variant> result {};
+    cursor_->fetch(region, [this] (const VcfRecord& record) { return is_good(record); }, options_.split_complex, result);
     std::sort(std::begin(result), std::end(result));
     result.erase(std::unique(std::begin(result), std::end(result)), std::end(result));
     return result;
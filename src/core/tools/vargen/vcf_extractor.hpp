@@ -36,20 +36,23 @@ public:
     VcfExtractor(std::unique_ptr<VcfReader> reader);
     VcfExtractor(std::unique_ptr<VcfReader> reader, Options options);
     
-    VcfExtractor(const VcfExtractor&)            = default;
-    VcfExtractor& operator=(const VcfExtractor&) = default;
-    VcfExtractor(VcfExtractor&&)                 = default;
-    VcfExtractor& operator=(VcfExtractor&&)      = default;
+    VcfExtractor(const VcfExtractor&);
+    VcfExtractor& operator=(const VcfExtractor&);
+    VcfExtractor(VcfExtractor&&);
+    VcfExtractor& operator=(VcfExtractor&&);
     
-    ~VcfExtractor() override = default;
+    ~VcfExtractor() override;
     
 private:
+    class RecordCursor;
+    
     std::unique_ptr<VariantGenerator> do_clone() const override;
     std::vector<Variant> do_generate(const RegionSet& regions, OptionalThreadPool workers) const override;
     std::string name() const override;
     
     mutable std::shared_ptr<VcfReader> reader_;
     Options options_;
+    mutable std::unique_ptr<RecordCursor> cursor_;
     
     std::vector<Variant> fetch_variants(const GenomicRegion& region) const;
     bool is_good(const VcfRecord& record) const;
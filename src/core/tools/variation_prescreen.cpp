@@ -0,0 +1,137 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "variation_prescreen.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+#include "basics/genomic_region.hpp"
+#include "basics/cigar_string.hpp"
+#include "utils/mappable_algorithms.hpp"
+
+namespace octopus { namespace coretools {
+
+namespace {
+
+bool is_long_soft_clip(const AlignedRead& read, const VariationPrescreenOptions& options) noexcept
+{
+    if (!is_soft_clipped(read)) return false;
+    const auto soft_clips = get_soft_clipped_sizes(read);
+    return std::max(soft_clips.first, soft_clips.second) >= options.min_soft_clip_size;
+}
+
+bool is_informative_base(const char base) noexcept
+{
+    return base != 'N' && base != 'n';
+}
+
+class MismatchCounter
+{
+public:
+    MismatchCounter(const GenomicRegion& region, const ReferenceGenome::GeneticSequence& reference_sequence,
+                    const VariationPrescreenOptions& options)
+    : region_ {region}
+    , reference_sequence_ {reference_sequence}
+    , options_ {options}
+    , depths_(size(region))
+    , mismatches_(size(region))
+    {}
+    
+    void reset()
+    {
+        std::fill(std::begin(depths_), std::end(depths_), 0);
+        std::fill(std::begin(mismatches_), std::end(mismatches_), 0);
+    }
+    
+    // Returns true if the read itself is evidence of variation
+    bool add(const AlignedRead& read)
+    {
+        using Flag = CigarOperation::Flag;
+        if (is_long_soft_clip(read, options_)) return true;
+        const auto& read_sequence = read.sequence();
+        const auto& base_qualities = read.base_qualities();
+        auto ref_offset = static_cast<long>(mapped_begin(read)) - static_cast<long>(region_.begin());
+        std::size_t read_index {0};
+        for (const auto& op : read.cigar()) {
+            const auto op_size = op.size();
+            switch (op.flag()) {
+                case Flag::alignmentMatch:
+                case Flag::sequenceMatch:
+                case Flag::substitution:
+                    for (CigarOperation::Size i {0}; i < op_size; ++i) {
+                        const auto ref_index = ref_offset + static_cast<long>(i);
+                        if (ref_index < 0 || ref_index >= static_cast<long>(depths_.size())) continue;
+                        if (base_qualities[read_index + i] < options_.min_base_quality) continue;
+                        const auto ref_base = reference_sequence_[ref_index];
+                        const auto read_base = read_sequence[read_index + i];
+                        if (!is_informative_base(ref_base) || !is_informative_base(read_base)) continue;
+                        ++depths_[ref_index];
+                        if (read_base != ref_base) ++mismatches_[ref_index];
+                    }
+                    read_index += op_size;
+                    ref_offset += op_size;
+                    break;
+                case Flag::insertion:
+                case Flag::deletion:
+                    return true;
+                case Flag::softClipped:
+                    read_index += op_size;
+                    break;
+                case Flag::skipped:
+                    ref_offset += op_size;
+                    break;
+                case Flag::hardClipped:
+                case Flag::padding:
+                    break;
+            }
+        }
+        return false;
+    }
+    
+    bool has_supported_mismatch() const noexcept
+    {
+        for (std::size_t i {0}; i < depths_.size(); ++i) {
+            if (mismatches_[i] >= options_.min_mismatch_support
+                && mismatches_[i] >= options_.min_mismatch_fraction * depths_[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+private:
+    const GenomicRegion& region_;
+    const ReferenceGenome::GeneticSequence& reference_sequence_;
+    const VariationPrescreenOptions& options_;
+    std::vector<unsigned> depths_, mismatches_;
+};
+
+} // namespace
+
+bool has_variation_evidence(const ReadMap& reads, const ReferenceGenome& reference, const VariationPrescreenOptions options)
+{
+    if (std::all_of(std::cbegin(reads), std::cend(reads), [] (const auto& p) { return p.second.empty(); })) return false;
+    auto region = encompassing_region(reads);
+    const auto contig_region = reference.contig_region(region.contig_name());
+    const auto clipped_region = overlapped_region(region, contig_region);
+    if (!clipped_region) return true; // can't check, so don't skip
+    region = *clipped_region;
+    const auto reference_sequence = reference.fetch_sequence(region);
+    if (reference_sequence.size() != size(region)) return true;
+    MismatchCounter counter {region, reference_sequence, options};
+    for (const auto& p : reads) {
+        if (p.second.empty()) continue;
+        counter.reset();
+        for (const AlignedRead& read : p.second) {
+            if (counter.add(read)) return true;
+        }
+        if (counter.has_supported_mismatch()) return true;
+    }
+    return false;
+}
+
+} // namespace coretools
+} // namespace octopus
@@ -0,0 +1,35 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef variation_prescreen_hpp
+#define variation_prescreen_hpp
+
+#include "config/common.hpp"
+#include "basics/aligned_read.hpp"
+#include "io/reference/reference_genome.hpp"
+
+namespace octopus { namespace coretools {
+
+/*
+    A cheap screen for whether reads show any sign of non-reference variation, so regions where
+    every read agrees with the reference can skip candidate generation entirely. Any indel or long
+    soft clip counts as evidence, as does a position where enough good quality bases disagree with
+    the reference in any one sample. The screen only needs a single reference fetch and one pass
+    over each read's CIGAR, so it is much cheaper than running the candidate generators.
+ */
+
+struct VariationPrescreenOptions
+{
+    AlignedRead::BaseQuality min_base_quality = 20;
+    unsigned min_mismatch_support = 2;
+    double min_mismatch_fraction = 0.05;
+    AlignedRead::NucleotideSequence::size_type min_soft_clip_size = 10;
+};
+
+bool has_variation_evidence(const ReadMap& reads, const ReferenceGenome& reference,
+                            VariationPrescreenOptions options = {});
+
+} // namespace coretools
+} // namespace octopus
+
+#endif
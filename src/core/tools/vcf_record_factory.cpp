@@ -28,6 +28,7 @@
 #include "utils/string_utils.hpp"
 #include "utils/maths.hpp"
 #include "utils/append.hpp"
+#include "utils/parallel_transform.hpp"
 #include "exceptions/program_error.hpp"
 #include "io/variant/vcf_spec.hpp"
 #include "config/octopus_vcf.hpp"
@@ -270,7 +271,7 @@ private:
     }
 };
 
-std::vector<VcfRecord> VcfRecordFactory::make(std::vector<CallWrapper>&& calls) const
+std::vector<VcfRecord> VcfRecordFactory::make(std::vector<CallWrapper>&& calls, OptionalThreadPool workers) const
 {
     using std::begin; using std::end; using std::cbegin; using std::cend; using std::next;
     using std::prev; using std::for_each; using std::transform;
@@ -280,17 +281,21 @@ std::vector<VcfRecord> VcfRecordFactory::make(std::vector<CallWrapper>&& calls)
     resolve_indel_genotypes(calls, samples_, reference_);
     sort_genotype_alleles_by_phase_set(calls, samples_, reference_);
     pad_indels(calls, samples_);
-    std::vector<VcfRecord> result {};
-    result.reserve(calls.size());
+    // The calls of each record are resolved in order, as padding and phase depend on neighbouring calls,
+    // but then each record only depends on its own calls so records can be made in parallel
+    std::vector<RecordCalls> record_calls {};
+    record_calls.reserve(calls.size());
     for (auto call_itr = begin(calls); call_itr != end(calls);) {
         const auto block_begin_itr = adjacent_overlap_find(call_itr, end(calls));
-        transform(std::make_move_iterator(call_itr), std::make_move_iterator(block_begin_itr), std::back_inserter(result),
+        transform(std::make_move_iterator(call_itr), std::make_move_iterator(block_begin_itr), std::back_inserter(record_calls),
                   [this] (CallWrapper&& call) {
                       call->replace(dummy_base, reference_.fetch_sequence(head_position(call)).front());
                       // We may still have uncalled genotyped alleles here if the called genotype
                       // did not have a high posterior
                       call->replace_uncalled_genotype_alleles(Allele {call->mapped_region(), vcfspec::missingValue}, 'N');
-                      return this->make(std::move(call.call));
+                      RecordCalls result {{}, false};
+                      result.calls.push_back(std::move(call.call));
+                      return result;
                   });
         if (block_begin_itr == end(calls)) break;
         auto block_end_itr = find_next_mutually_exclusive(block_begin_itr, end(calls));
@@ -522,15 +527,28 @@ std::vector<VcfRecord> VcfRecordFactory::make(std::vector<CallWrapper>&& calls)
         }
         for (auto&& segment : segements) {
             for (auto&& new_segment : segment_by_end_move(segment)) {
-                std::vector<std::unique_ptr<Call>> final_segment {};
+                RecordCalls final_segment {{}, true};
                 transform(std::make_move_iterator(begin(new_segment)), std::make_move_iterator(end(new_segment)),
-                          std::back_inserter(final_segment),
+                          std::back_inserter(final_segment.calls),
                           [] (auto&& call) -> std::unique_ptr<Call>&& { return std::move(call.call); });
-                result.emplace_back(this->make_segment(std::move(final_segment)));
+                record_calls.push_back(std::move(final_segment));
             }
         }
         call_itr = block_end_itr;
     }
+    calls.clear();
+    calls.shrink_to_fit();
+    std::vector<VcfRecord> result {};
+    result.reserve(record_calls.size());
+    parallel_transform(std::make_move_iterator(begin(record_calls)), std::make_move_iterator(end(record_calls)),
+                       std::back_inserter(result),
+                       [this] (RecordCalls&& record) {
+                           if (record.is_segment) {
+                               return this->make_segment(std::move(record.calls));
+                           } else {
+                               return this->make(std::move(record.calls.front()));
+                           }
+                       }, workers);
     return result;
 }
 
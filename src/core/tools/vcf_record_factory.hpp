@@ -7,17 +7,22 @@
 #include <vector>
 #include <memory>
 
+#include <boost/optional.hpp>
+
 #include "config/common.hpp"
 #include "io/reference/reference_genome.hpp"
 #include "io/variant/vcf_record.hpp"
 #include "core/types/calls/call.hpp"
 #include "core/types/calls/call_wrapper.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace octopus {
 
 class VcfRecordFactory
 {
 public:
+    using OptionalThreadPool = boost::optional<ThreadPool&>;
+    
     VcfRecordFactory() = delete;
     
     VcfRecordFactory(const ReferenceGenome& reference, const ReadMap& reads,
@@ -30,7 +35,8 @@ public:
     
     ~VcfRecordFactory() = default;
     
-    std::vector<VcfRecord> make(std::vector<CallWrapper>&& calls) const;
+    // Records are made in parallel if workers are given
+    std::vector<VcfRecord> make(std::vector<CallWrapper>&& calls, OptionalThreadPool workers = boost::none) const;
     
 private:
     const ReferenceGenome& reference_;
@@ -40,6 +46,12 @@ private:
     double max_qual = 100'000;
     bool skip_inconsistent_ploidy = true;
     
+    struct RecordCalls
+    {
+        std::vector<std::unique_ptr<Call>> calls;
+        bool is_segment;
+    };
+    
     VcfRecord make(std::unique_ptr<Call> call) const;
     VcfRecord make_segment(std::vector<std::unique_ptr<Call>>&& calls) const;
 };
@@ -21,6 +21,7 @@
 
 #include <boost/functional/hash.hpp>
 #include <boost/iterator/transform_iterator.hpp>
+#include <boost/container/small_vector.hpp>
 
 #include "concepts/equitable.hpp"
 #include "concepts/mappable.hpp"
@@ -50,6 +51,15 @@ struct is_haplotype_like<MappaleType, std::enable_if_t<is_indexed_haplotype_v<Ma
 template <typename T>
 constexpr bool is_haplotype_like_v = is_haplotype_like<T>::value;
 
+// Genotypes of small elements (e.g. IndexedHaplotype) store haploid and diploid genotypes inline, so
+// the common genotypes need no heap allocation
+constexpr std::size_t genotypeInlineCapacity {2};
+
+template <typename T>
+using GenotypeElementContainer = std::conditional_t<(sizeof(T) <= 2 * sizeof(void*)),
+                                                    boost::container::small_vector<T, genotypeInlineCapacity>,
+                                                    std::vector<T>>;
+
 } // namespace detail
 
 template <typename T>
@@ -109,7 +119,7 @@ public:
     void shrink_to_fit() { elements_.shrink_to_fit(); }
     
 private:
-    std::vector<MappableType> elements_;
+    detail::GenotypeElementContainer<MappableType> elements_;
     
     void init() { init(ordered{}); }
     void init(std::true_type);
@@ -29,6 +29,26 @@ auto haplotype_contained_range(const T& alleles, const M& mappable)
     return bases(contained_range(alleles, mappable));
 }
 
+Haplotype::Data::Data(std::vector<ContigAllele> explicit_alleles, ContigRegion explicit_allele_region, NucleotideSequence sequence)
+: explicit_alleles {std::move(explicit_alleles)}
+, explicit_allele_region {std::move(explicit_allele_region)}
+, sequence {std::move(sequence)}
+, hash {std::hash<NucleotideSequence>()(this->sequence)}
+{}
+
+Haplotype::Haplotype(GenomicRegion region, std::vector<ContigAllele> explicit_alleles, NucleotideSequence sequence,
+                     const ReferenceGenome& reference)
+: region_ {std::move(region)}
+, data_ {}
+, reference_ {reference}
+{
+    ContigRegion explicit_allele_region {};
+    if (!explicit_alleles.empty()) {
+        explicit_allele_region = encompassing_region(explicit_alleles.front(), explicit_alleles.back());
+    }
+    data_ = std::make_shared<Data>(std::move(explicit_alleles), std::move(explicit_allele_region), std::move(sequence));
+}
+
 // public methods
 
 const GenomicRegion& Haplotype::mapped_region() const
@@ -51,38 +71,38 @@ bool Haplotype::contains(const ContigAllele& allele) const
 {
     using octopus::contains; using std::cbegin; using std::cend;
     if (contains(region_.contig_region(), allele)) {
-        if (begins_before(allele, explicit_allele_region_)) {
-            if (is_before(allele, explicit_allele_region_)) {
+        if (begins_before(allele, data_->explicit_allele_region)) {
+            if (is_before(allele, data_->explicit_allele_region)) {
                 return allele.sequence() == fetch_reference_sequence(contig_region(allele));
             }
-            const auto flank_region = left_overhang_region(explicit_allele_region_, contig_region(allele));
+            const auto flank_region = left_overhang_region(data_->explicit_allele_region, contig_region(allele));
             if (copy(allele, flank_region).sequence() != fetch_reference_sequence(flank_region)) {
                 return false;
             }
         }
-        if (ends_before(explicit_allele_region_, allele)) {
-            if (is_after(allele, explicit_allele_region_)) {
+        if (ends_before(data_->explicit_allele_region, allele)) {
+            if (is_after(allele, data_->explicit_allele_region)) {
                 return allele.sequence() == fetch_reference_sequence(contig_region(allele));
             }
-            const auto flank_region = right_overhang_region(contig_region(allele), explicit_allele_region_);
+            const auto flank_region = right_overhang_region(contig_region(allele), data_->explicit_allele_region);
             if (copy(allele, flank_region).sequence() != fetch_reference_sequence(flank_region)) {
                 return false;
             }
         }
-        const auto match_itr = binary_find(cbegin(explicit_alleles_), cend(explicit_alleles_), allele.mapped_region());
-        if (match_itr != cend(explicit_alleles_)) {
+        const auto match_itr = binary_find(cbegin(data_->explicit_alleles), cend(data_->explicit_alleles), allele.mapped_region());
+        if (match_itr != cend(data_->explicit_alleles)) {
             if (*match_itr == allele) return true;
             if (is_same_region(*match_itr, allele)) {
                 // If the allele is not explcitly contained but the region is then it must be a different
                 // allele, unless it is an insertion, in which case we must check the sequence
                 if (is_insertion(allele)) {
-                    return contains(*std::lower_bound(cbegin(explicit_alleles_), cend(explicit_alleles_),
+                    return contains(*std::lower_bound(cbegin(data_->explicit_alleles), cend(data_->explicit_alleles),
                                                       allele.mapped_region()), allele);
                 }
                 return false;
             }
         }
-        const auto overlapped = haplotype_overlap_range(explicit_alleles_, allele);
+        const auto overlapped = haplotype_overlap_range(data_->explicit_alleles, allele);
         if (overlapped.size() == 1 && contains(overlapped.front(), allele)) {
             return allele == copy(overlapped.front(), contig_region(allele));
         }
@@ -100,10 +120,10 @@ bool Haplotype::contains(const Allele& allele) const
 bool Haplotype::includes(const ContigAllele& allele) const
 {
     using octopus::contains;
-    if (explicit_alleles_.empty() || !contains(explicit_allele_region_, allele)) {
+    if (data_->explicit_alleles.empty() || !contains(data_->explicit_allele_region, allele)) {
         return false;
     } else {
-        return std::binary_search(std::cbegin(explicit_alleles_), std::cend(explicit_alleles_), allele);
+        return std::binary_search(std::cbegin(data_->explicit_alleles), std::cend(data_->explicit_alleles), allele);
     }
 }
 
@@ -134,18 +154,18 @@ Haplotype::NucleotideSequence Haplotype::sequence(const ContigRegion& region) co
     if (!contains(region_.contig_region(), region)) {
         throw std::out_of_range {"Haplotype: attempting to sequence from region not contained by Haplotype region"};
     }
-    if (explicit_alleles_.empty()) {
-        return sequence_.substr(begin_distance(region_.contig_region(), region), region_size(region));
+    if (data_->explicit_alleles.empty()) {
+        return data_->sequence.substr(begin_distance(region_.contig_region(), region), region_size(region));
     }
-    if (is_in_reference_flank(region, explicit_allele_region_, explicit_alleles_)) {
+    if (is_in_reference_flank(region, data_->explicit_allele_region, data_->explicit_alleles)) {
         return fetch_reference_sequence(region);
     }
     NucleotideSequence result {};
     result.reserve(region_size(region)); // may be more or less depending on indels
-    if (begins_before(region, explicit_allele_region_)) {
-        append_reference(result, left_overhang_region(region, explicit_allele_region_));
+    if (begins_before(region, data_->explicit_allele_region)) {
+        append_reference(result, left_overhang_region(region, data_->explicit_allele_region));
     }
-    auto overlapped_explicit_alleles = haplotype_overlap_range(explicit_alleles_, region);
+    auto overlapped_explicit_alleles = haplotype_overlap_range(data_->explicit_alleles, region);
     assert(!overlapped_explicit_alleles.empty());
     if (contains(overlapped_explicit_alleles.front(), region)) {
         append(result, copy(overlapped_explicit_alleles.front(), region));
@@ -159,7 +179,7 @@ Haplotype::NucleotideSequence Haplotype::sequence(const ContigRegion& region) co
                             *overlapped_region(overlapped_explicit_alleles.front(), region)));
         overlapped_explicit_alleles.advance_begin(1);
         if (overlapped_explicit_alleles.empty()) {
-            append_reference(result, right_overhang_region(region, explicit_allele_region_));
+            append_reference(result, right_overhang_region(region, data_->explicit_allele_region));
             return result;
         }
     }
@@ -173,8 +193,8 @@ Haplotype::NucleotideSequence Haplotype::sequence(const ContigRegion& region) co
         overlapped_explicit_alleles.advance_end(1); // as we previously removed this allele
         append(result, copy(overlapped_explicit_alleles.back(),
                             *overlapped_region(overlapped_explicit_alleles.back(), region)));
-    } else if (ends_before(explicit_allele_region_, region)) {
-        append_reference(result, right_overhang_region(region, explicit_allele_region_));
+    } else if (ends_before(data_->explicit_allele_region, region)) {
+        append_reference(result, right_overhang_region(region, data_->explicit_allele_region));
     }
     return result;
 }
@@ -189,7 +209,7 @@ Haplotype::NucleotideSequence Haplotype::sequence(const GenomicRegion& region) c
 
 const Haplotype::NucleotideSequence& Haplotype::sequence() const noexcept
 {
-    return sequence_;
+    return data_->sequence;
 }
 
 Haplotype::NucleotideSequence::size_type Haplotype::sequence_size(const ContigRegion& region) const
@@ -204,11 +224,27 @@ Haplotype::NucleotideSequence::size_type Haplotype::sequence_size(const GenomicR
 }
 
 std::vector<Variant> Haplotype::difference(const Haplotype& other) const
+{
+    if (other.data_->explicit_alleles.empty() && other.region_ == region_) {
+        // other is the reference haplotype of this haplotype's region
+        std::call_once(data_->reference_difference_flag, [&] () { data_->reference_difference = compute_difference(other); });
+        return data_->reference_difference;
+    }
+    return compute_difference(other);
+}
+
+CigarString Haplotype::cigar() const
+{
+    std::call_once(data_->cigar_flag, [this] () { data_->cigar = compute_cigar(); });
+    return data_->cigar;
+}
+
+std::vector<Variant> Haplotype::compute_difference(const Haplotype& other) const
 {
     std::vector<Variant> result {};
-    result.reserve(explicit_alleles_.size());
+    result.reserve(data_->explicit_alleles.size());
     const auto& contig = region_.contig_name();
-    for (const auto& allele : explicit_alleles_) {
+    for (const auto& allele : data_->explicit_alleles) {
         if (!other.contains(allele)) {
             result.emplace_back(GenomicRegion {contig, allele.mapped_region()},
                                 other.sequence(allele.mapped_region()),
@@ -218,19 +254,19 @@ std::vector<Variant> Haplotype::difference(const Haplotype& other) const
     return result;
 }
 
-CigarString Haplotype::cigar() const
+CigarString Haplotype::compute_cigar() const
 {
     using Flag = CigarOperation::Flag;
     CigarString result {};
-    if (!explicit_alleles_.empty()) {
-        const auto reference = reference_.get().fetch_sequence(GenomicRegion {region_.contig_name(), explicit_allele_region_});
-        result.reserve(2 * explicit_alleles_.size() + 2);
-        auto curr_op_size = begin_distance(region_.contig_region(), explicit_allele_region_);
+    if (!data_->explicit_alleles.empty()) {
+        const auto reference = reference_.get().fetch_sequence(GenomicRegion {region_.contig_name(), data_->explicit_allele_region});
+        result.reserve(2 * data_->explicit_alleles.size() + 2);
+        auto curr_op_size = begin_distance(region_.contig_region(), data_->explicit_allele_region);
         auto curr_op_flag = Flag::sequenceMatch;
-        for (std::size_t i {0}; i < explicit_alleles_.size(); ++i) {
-            const auto& allele = explicit_alleles_[i];
+        for (std::size_t i {0}; i < data_->explicit_alleles.size(); ++i) {
+            const auto& allele = data_->explicit_alleles[i];
             if (i > 0) {
-                const auto& prev_allele = explicit_alleles_[i - 1];
+                const auto& prev_allele = data_->explicit_alleles[i - 1];
                 if (!are_adjacent(prev_allele, allele)) {
                     result.emplace_back(curr_op_size, curr_op_flag);
                     curr_op_flag = Flag::sequenceMatch;
@@ -268,7 +304,7 @@ CigarString Haplotype::cigar() const
                     }
                 }
             } else if (!is_empty_region(allele)) {
-                const auto ref_idx = static_cast<std::size_t>(begin_distance(explicit_allele_region_, allele));
+                const auto ref_idx = static_cast<std::size_t>(begin_distance(data_->explicit_allele_region, allele));
                 assert(ref_idx < reference.size());
                 if (region_size(allele) == 1) {
                     if (allele.sequence()[0] == reference[ref_idx]) {
@@ -298,7 +334,7 @@ CigarString Haplotype::cigar() const
                 curr_op_size = allele_op_size;
             }
         }
-        const auto rhs_ref_flank_size = end_distance(explicit_allele_region_, region_.contig_region());
+        const auto rhs_ref_flank_size = end_distance(data_->explicit_allele_region, region_.contig_region());
         if (curr_op_flag == Flag::sequenceMatch) {
             curr_op_size += rhs_ref_flank_size;
         } else {
@@ -312,20 +348,20 @@ CigarString Haplotype::cigar() const
     } else {
         result.emplace_back(size(region_), Flag::sequenceMatch);
     }
-    assert(octopus::sequence_size(result) == sequence_.size());
+    assert(octopus::sequence_size(result) == data_->sequence.size());
     assert(reference_size(result) == size(region_));
     return result;
 }
 
 std::size_t Haplotype::get_hash() const noexcept
 {
-    return cached_hash_;
+    return data_->hash;
 }
 
 std::pair<Haplotype::AlleleIterator, Haplotype::AlleleIterator>
 Haplotype::alleles() const noexcept
 {
-    return std::make_pair(std::cbegin(explicit_alleles_), std::cend(explicit_alleles_));
+    return std::make_pair(std::cbegin(data_->explicit_alleles), std::cend(data_->explicit_alleles));
 }
 
 // private methods
@@ -342,13 +378,13 @@ void Haplotype::append(NucleotideSequence& result, AlleleIterator first, AlleleI
 
 void Haplotype::append_reference(NucleotideSequence& result, const ContigRegion& region) const
 {
-    if (is_before(region, explicit_allele_region_)) {
+    if (is_before(region, data_->explicit_allele_region)) {
         const auto offset = begin_distance(region_.contig_region(), region);
-        const auto it = std::next(std::cbegin(sequence_), offset);
+        const auto it = std::next(std::cbegin(data_->sequence), offset);
         result.append(it, std::next(it, region_size(region)));
     } else {
         const auto offset = end_distance(region, region_.contig_region());
-        const auto it = std::prev(std::cend(sequence_), offset);
+        const auto it = std::prev(std::cend(data_->sequence), offset);
         result.append(std::prev(it, region_size(region)), it);
     }
 }
@@ -544,14 +580,14 @@ Haplotype do_copy(const Haplotype& haplotype, const GenomicRegion& region, std::
     }
     if (is_same_region(haplotype, region)) return haplotype;
     Haplotype::Builder result {region, haplotype.reference_};
-    if (haplotype.explicit_alleles_.empty()) return result.build();
+    if (haplotype.data_->explicit_alleles.empty()) return result.build();
     const auto& contig_region = region.contig_region();
-    if (contains(contig_region, haplotype.explicit_allele_region_)) {
-        result.explicit_alleles_.assign(cbegin(haplotype.explicit_alleles_), cend(haplotype.explicit_alleles_));
+    if (contains(contig_region, haplotype.data_->explicit_allele_region)) {
+        result.explicit_alleles_.assign(cbegin(haplotype.data_->explicit_alleles), cend(haplotype.data_->explicit_alleles));
         return result.build();
     }
-    if (!overlaps(contig_region, haplotype.explicit_allele_region_)) return result.build();
-    auto overlapped = haplotype_overlap_range(haplotype.explicit_alleles_, region.contig_region());
+    if (!overlaps(contig_region, haplotype.data_->explicit_allele_region)) return result.build();
+    auto overlapped = haplotype_overlap_range(haplotype.data_->explicit_alleles, region.contig_region());
     assert(!overlapped.empty());
     if (is_empty(contig_region)) {
         if (!is_empty_region(overlapped.front()) && are_adjacent(contig_region, overlapped.front())) {
@@ -613,13 +649,13 @@ Haplotype copy(const Haplotype& haplotype, const std::vector<GenomicRegion>& reg
     using std::end; using std::cbegin; using std::cend; using std::prev;
     const auto copy_region = encompassing_region(regions);
     Haplotype::Builder result {copy_region, haplotype.reference_};
-    if (haplotype.explicit_alleles_.empty()) return result.build();
+    if (haplotype.data_->explicit_alleles.empty()) return result.build();
     auto copied_region = head_region(haplotype);
     for (const auto& region : regions) {
         if (!is_after(region, copied_region) && !begins_equal(region, head_region(haplotype))) {
             throw std::runtime_error {"Haplotype::copy unsorted or overlapping regions provided"};
         }
-        auto overlapped_alleles = haplotype_overlap_range(haplotype.explicit_alleles_, region.contig_region());
+        auto overlapped_alleles = haplotype_overlap_range(haplotype.data_->explicit_alleles, region.contig_region());
         if (!overlapped_alleles.empty()) {
             if (is_empty(region)) {
                 if (!is_empty_region(overlapped_alleles.front()) && are_adjacent(region.contig_region(), overlapped_alleles.front())) {
@@ -651,16 +687,21 @@ Haplotype copy(const Haplotype& haplotype, const std::vector<GenomicRegion>& reg
 
 bool is_reference(const Haplotype& haplotype)
 {
-    if (haplotype.explicit_alleles_.empty()) return true;
+    if (haplotype.data_->explicit_alleles.empty()) return true;
     return haplotype.sequence() == haplotype.reference_.get().fetch_sequence(haplotype.mapped_region());
 }
 
+Haplotype make_reference_haplotype(const Haplotype& haplotype)
+{
+    return Haplotype {haplotype.region_, haplotype.reference_};
+}
+
 Haplotype expand(const Haplotype& haplotype, Haplotype::MappingDomain::Size n)
 {
     if (n == 0) return haplotype;
     return Haplotype {
         expand(mapped_region(haplotype), n),
-        std::cbegin(haplotype.explicit_alleles_), std::cend(haplotype.explicit_alleles_),
+        std::cbegin(haplotype.data_->explicit_alleles), std::cend(haplotype.data_->explicit_alleles),
         haplotype.reference_
     };
 }
@@ -671,12 +712,12 @@ Haplotype remap(const Haplotype& haplotype, const GenomicRegion& region)
         return haplotype;
     } else if (contains(region, haplotype)) {
         return Haplotype {
-            region, std::cbegin(haplotype.explicit_alleles_), std::cend(haplotype.explicit_alleles_), haplotype.reference_
+            region, std::cbegin(haplotype.data_->explicit_alleles), std::cend(haplotype.data_->explicit_alleles), haplotype.reference_
         };
     } else if (contains(haplotype, region)) {
         return copy<Haplotype>(haplotype, region);
     } else if (is_same_contig(haplotype, region)) {
-        const auto remap_alleles = haplotype_contained_range(haplotype.explicit_alleles_, region.contig_region());
+        const auto remap_alleles = haplotype_contained_range(haplotype.data_->explicit_alleles, region.contig_region());
         return Haplotype {
             region, std::cbegin(remap_alleles), std::cend(remap_alleles), haplotype.reference_
         };
@@ -698,7 +739,8 @@ std::vector<Variant> difference(const Haplotype& lhs, const Haplotype& rhs)
 
 bool operator==(const Haplotype& lhs, const Haplotype& rhs) noexcept
 {
-    return lhs.mapped_region() == rhs.mapped_region() && lhs.sequence() == rhs.sequence();
+    if (lhs.get_hash() != rhs.get_hash() || lhs.mapped_region() != rhs.mapped_region()) return false;
+    return &lhs.sequence() == &rhs.sequence() || lhs.sequence() == rhs.sequence(); // copies share a sequence
 }
 
 bool operator<(const Haplotype& lhs, const Haplotype& rhs)
@@ -708,7 +750,7 @@ bool operator<(const Haplotype& lhs, const Haplotype& rhs)
 
 bool HaveSameAlleles::operator()(const Haplotype &lhs, const Haplotype &rhs) const
 {
-    return lhs.explicit_alleles_ == rhs.explicit_alleles_;
+    return lhs.data_->explicit_alleles == rhs.data_->explicit_alleles;
 }
 
 bool have_same_alleles(const Haplotype& lhs, const Haplotype& rhs)
@@ -720,15 +762,15 @@ IsLessComplex::IsLessComplex(boost::optional<Haplotype> reference) : reference_
 
 bool IsLessComplex::operator()(const Haplotype& lhs, const Haplotype& rhs) const
 {
-    if (lhs.explicit_alleles_.size() != rhs.explicit_alleles_.size()) {
-        return lhs.explicit_alleles_.size() < rhs.explicit_alleles_.size();
+    if (lhs.data_->explicit_alleles.size() != rhs.data_->explicit_alleles.size()) {
+        return lhs.data_->explicit_alleles.size() < rhs.data_->explicit_alleles.size();
     }
     if (reference_) {
         return lhs.difference(*reference_).size() < rhs.difference(*reference_).size();
     }
     // otherwise prefer the sequence with the least amount of indels
-    auto score = std::inner_product(std::cbegin(lhs.explicit_alleles_), std::cend(lhs.explicit_alleles_),
-                                    std::cbegin(rhs.explicit_alleles_), 0, std::plus<> {},
+    auto score = std::inner_product(std::cbegin(lhs.data_->explicit_alleles), std::cend(lhs.data_->explicit_alleles),
+                                    std::cbegin(rhs.data_->explicit_alleles), 0, std::plus<> {},
                                     [] (const auto& lhs, const auto& rhs) {
                                         if (lhs == rhs) {
                                             return 0;
@@ -753,7 +795,7 @@ bool StrictLess::operator()(const Haplotype& lhs, const Haplotype& rhs) const
         if (lhs.sequence() != rhs.sequence()) {
             return lhs.sequence() < rhs.sequence();
         } else {
-            return lhs.explicit_alleles_ < rhs.explicit_alleles_;
+            return lhs.data_->explicit_alleles < rhs.data_->explicit_alleles;
         }
     } else {
         return lhs.mapped_region() < rhs.mapped_region();
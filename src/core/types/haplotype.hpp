@@ -5,11 +5,15 @@
 #define haplotype_hpp
 
 #include <deque>
+#include <vector>
+#include <unordered_map>
+#include <memory>
 #include <cstddef>
 #include <functional>
 #include <type_traits>
 #include <utility>
 #include <numeric>
+#include <mutex>
 #include <iosfwd>
 
 #include <boost/functional/hash.hpp>
@@ -27,6 +31,12 @@ namespace octopus {
 class GenomicRegion;
 class ReferenceGenome;
 
+namespace coretools {
+
+class HaplotypeTree;
+
+} // namespace coretools
+
 /*
     A Haplotype is an ordered, non-overlapping, set of Alleles, and therefore implictly
     defines a sequence in a given GenomicRegion.
@@ -89,6 +99,7 @@ public:
     NucleotideSequence::size_type sequence_size(const ContigRegion& region) const;
     NucleotideSequence::size_type sequence_size(const GenomicRegion& region) const;
     
+    // The difference to, and cigar against, the reference are computed once for all copies of the haplotype
     std::vector<Variant> difference(const Haplotype& other) const; // w.r.t this
     CigarString cigar() const; // w.r.t reference
     
@@ -102,22 +113,41 @@ public:
     friend Haplotype detail::do_copy(const Haplotype& haplotype, const GenomicRegion& region, std::true_type);
     friend Haplotype copy(const Haplotype&, const std::vector<GenomicRegion>&);
     friend bool is_reference(const Haplotype& haplotype);
+    friend Haplotype make_reference_haplotype(const Haplotype& haplotype);
     friend Haplotype expand(const Haplotype& haplotype, MappingDomain::Position n);
     friend Haplotype remap(const Haplotype& haplotype, const GenomicRegion& region);
     
     template <typename S> friend void debug::print_alleles(S&&, const Haplotype&);
     template <typename S> friend void debug::print_variant_alleles(S&&, const Haplotype&);
     
+    friend class coretools::HaplotypeTree;
+    
 private:
+    // Immutable, so shared by copies of the haplotype
+    struct Data
+    {
+        Data(std::vector<ContigAllele> explicit_alleles, ContigRegion explicit_allele_region, NucleotideSequence sequence);
+        std::vector<ContigAllele> explicit_alleles;
+        ContigRegion explicit_allele_region;
+        NucleotideSequence sequence;
+        std::size_t hash;
+        // Lazily computed, as many haplotypes never need them
+        mutable std::once_flag cigar_flag, reference_difference_flag;
+        mutable CigarString cigar;
+        mutable std::vector<Variant> reference_difference;
+    };
+    
     GenomicRegion region_;
-    std::vector<ContigAllele> explicit_alleles_;
-    ContigRegion explicit_allele_region_;
-    NucleotideSequence sequence_;
-    std::size_t cached_hash_;
+    std::shared_ptr<const Data> data_;
     std::reference_wrapper<const ReferenceGenome> reference_;
+    
+    // For when the sequence is already known. explicit_alleles must be contained by region, and
+    // leave no gaps, and sequence must be the sequence of region.
+    Haplotype(GenomicRegion region, std::vector<ContigAllele> explicit_alleles, NucleotideSequence sequence,
+              const ReferenceGenome& reference);
 
 public:
-    using AlleleIterator = decltype(explicit_alleles_)::const_iterator;
+    using AlleleIterator = std::vector<ContigAllele>::const_iterator;
     
     std::pair<AlleleIterator, AlleleIterator> alleles() const noexcept;
 
@@ -127,29 +157,28 @@ private:
     void append(NucleotideSequence& result, AlleleIterator first, AlleleIterator last) const;
     void append_reference(NucleotideSequence& result, const ContigRegion& region) const;
     NucleotideSequence fetch_reference_sequence(const ContigRegion& region) const;
+    std::vector<Variant> compute_difference(const Haplotype& other) const;
+    CigarString compute_cigar() const;
 };
 
 template <typename R>
 Haplotype::Haplotype(R&& region, const ReferenceGenome& reference)
 : region_ {std::forward<R>(region)}
-, explicit_alleles_ {}
-, explicit_allele_region_ {}
-, sequence_ {reference.fetch_sequence(region_)}
-, cached_hash_ {std::hash<NucleotideSequence>()(sequence_)}
+, data_ {std::make_shared<Data>(std::vector<ContigAllele> {}, ContigRegion {}, reference.fetch_sequence(region_))}
 , reference_ {reference}
 {}
 
 template <typename R, typename S>
 Haplotype::Haplotype(R&& region, S&& sequence, const ReferenceGenome& reference)
 : region_ {std::forward<R>(region)}
-, explicit_alleles_ {}
-, explicit_allele_region_ {region_.contig_region()}
-, sequence_ {std::forward<S>(sequence)}
-, cached_hash_ {std::hash<NucleotideSequence>()(sequence_)}
+, data_ {}
 , reference_ {reference}
 {
-    explicit_alleles_.reserve(1);
-    explicit_alleles_.emplace_back(explicit_allele_region_, sequence_);
+    NucleotideSequence haplotype_sequence {std::forward<S>(sequence)};
+    std::vector<ContigAllele> explicit_alleles {};
+    explicit_alleles.reserve(1);
+    explicit_alleles.emplace_back(region_.contig_region(), haplotype_sequence);
+    data_ = std::make_shared<Data>(std::move(explicit_alleles), region_.contig_region(), std::move(haplotype_sequence));
 }
 
 namespace detail {
@@ -166,37 +195,37 @@ template <typename R, typename ForwardIt>
 Haplotype::Haplotype(R&& region, ForwardIt first_allele, ForwardIt last_allele,
                      const ReferenceGenome& reference)
 : region_ {std::forward<R>(region)}
-, explicit_alleles_ {first_allele, last_allele}
-, explicit_allele_region_ {}
-, sequence_ {}
-, cached_hash_ {0}
+, data_ {}
 , reference_ {reference}
 {
-    if (!explicit_alleles_.empty()) {
-        explicit_allele_region_ = encompassing_region(explicit_alleles_.front(), explicit_alleles_.back());
-        auto num_bases = std::accumulate(std::cbegin(explicit_alleles_), std::cend(explicit_alleles_),
+    std::vector<ContigAllele> explicit_alleles {first_allele, last_allele};
+    ContigRegion explicit_allele_region {};
+    NucleotideSequence sequence {};
+    if (!explicit_alleles.empty()) {
+        explicit_allele_region = encompassing_region(explicit_alleles.front(), explicit_alleles.back());
+        auto num_bases = std::accumulate(std::cbegin(explicit_alleles), std::cend(explicit_alleles),
                                          0, [] (const auto curr, const auto& allele) {
                                              return curr + ::octopus::sequence_size(allele);
                                          });
         const auto lhs_reference_region = left_overhang_region(region_.contig_region(),
-                                                               explicit_allele_region_);
+                                                               explicit_allele_region);
         const auto rhs_reference_region = right_overhang_region(region_.contig_region(),
-                                                                explicit_allele_region_);
+                                                                explicit_allele_region);
         num_bases += region_size(lhs_reference_region) + region_size(rhs_reference_region);
         
-        sequence_.reserve(num_bases);
+        sequence.reserve(num_bases);
         const auto& contig = region_.contig_name();
         if (!is_empty(lhs_reference_region)) {
-            detail::append(sequence_, reference, contig, lhs_reference_region);
+            detail::append(sequence, reference, contig, lhs_reference_region);
         }
-        append(sequence_, std::cbegin(explicit_alleles_), std::cend(explicit_alleles_));
+        append(sequence, std::cbegin(explicit_alleles), std::cend(explicit_alleles));
         if (!is_empty(rhs_reference_region)) {
-            detail::append(sequence_, reference, contig, rhs_reference_region);
+            detail::append(sequence, reference, contig, rhs_reference_region);
         }
     } else {
-        sequence_ = reference.fetch_sequence(region_);
+        sequence = reference.fetch_sequence(region_);
     }
-    cached_hash_ = std::hash<NucleotideSequence>()(sequence_);
+    data_ = std::make_shared<Data>(std::move(explicit_alleles), explicit_allele_region, std::move(sequence));
 }
 
 class Haplotype::Builder
@@ -291,6 +320,9 @@ std::vector<ContigAllele> copy_unique(const Container& haplotypes, const ContigR
 
 bool is_reference(const Haplotype& haplotype);
 
+// The reference haplotype with the same region as haplotype
+Haplotype make_reference_haplotype(const Haplotype& haplotype);
+
 Haplotype expand(const Haplotype& haplotype, Haplotype::MappingDomain::Size n);
 Haplotype remap(const Haplotype& haplotype, const GenomicRegion& region);
 
@@ -322,29 +354,51 @@ struct StrictLess
     bool operator()(const Haplotype& lhs, const Haplotype& rhs) const;
 };
 
+namespace detail {
+
+struct HaplotypeReferenceHash
+{
+    std::size_t operator()(const std::reference_wrapper<const Haplotype>& haplotype) const noexcept
+    {
+        return haplotype.get().get_hash();
+    }
+};
+
+struct HaplotypeReferenceEqual
+{
+    bool operator()(const std::reference_wrapper<const Haplotype>& lhs,
+                    const std::reference_wrapper<const Haplotype>& rhs) const noexcept
+    {
+        return lhs.get() == rhs.get();
+    }
+};
+
+} // namespace detail
+
 // Removes all duplicates haplotypes (w.r.t operator==) keeping the duplicate which is considered least complex w.r.t cmp.
+// Haplotypes are grouped by their precomputed sequence hash so sequences are only compared on hash collisions, and the
+// order of the first occurrence of each haplotype is preserved. Ties in cmp are broken with StrictLess.
 template <typename RandomIt, typename Compare>
 RandomIt remove_duplicates(RandomIt first_itr, RandomIt last_itr, const Compare& cmp)
 {
-    std::sort(first_itr, last_itr, StrictLess {});
-    auto first_dup_itr  = first_itr;
-    while (true) {
-        first_dup_itr = std::adjacent_find(first_dup_itr, last_itr);
-        if (first_dup_itr == last_itr) break;
-        auto dup_keep_itr = (cmp(*first_dup_itr, *std::next(first_dup_itr))) ? first_dup_itr : std::next(first_dup_itr);
-        auto last_dup_itr = std::next(first_dup_itr, 2);
-        for (; last_dup_itr != last_itr; ++last_dup_itr) {
-            if (*last_dup_itr != *first_dup_itr) {
-                break;
-            }
-            if (cmp(*last_dup_itr, *dup_keep_itr)) {
-                dup_keep_itr = last_dup_itr;
+    using HaplotypeReference = std::reference_wrapper<const Haplotype>;
+    std::unordered_map<HaplotypeReference, RandomIt, detail::HaplotypeReferenceHash, detail::HaplotypeReferenceEqual> kept {};
+    kept.reserve(std::distance(first_itr, last_itr));
+    auto keep_itr = first_itr;
+    for (auto itr = first_itr; itr != last_itr; ++itr) {
+        const auto match_itr = kept.find(std::cref(*itr));
+        if (match_itr == std::cend(kept)) {
+            if (itr != keep_itr) *keep_itr = std::move(*itr);
+            kept.emplace(std::cref(*keep_itr), keep_itr);
+            ++keep_itr;
+        } else {
+            auto& representative = *match_itr->second;
+            if (cmp(*itr, representative) || (!cmp(representative, *itr) && StrictLess {}(*itr, representative))) {
+                representative = std::move(*itr); // equal to the key so the map is still valid
             }
         }
-        std::iter_swap(first_dup_itr, dup_keep_itr);
-        first_dup_itr = last_dup_itr;
     }
-    return std::unique(first_itr, last_itr);
+    return keep_itr;
 }
 
 template <typename Container, typename Compare>
@@ -384,7 +438,7 @@ template <typename S>
 void print_alleles(S&& stream, const Haplotype& haplotype)
 {
     stream << "< ";
-    for (const auto& allele : haplotype.explicit_alleles_) {
+    for (const auto& allele : haplotype.data_->explicit_alleles) {
         stream << "{" << allele << "} ";
     }
     stream << ">";
@@ -398,7 +452,7 @@ void print_variant_alleles(S&& stream, const Haplotype& haplotype)
     } else {
         const auto& contig = contig_name(haplotype);
         stream << "< ";
-        for (const auto& contig_allele : haplotype.explicit_alleles_) {
+        for (const auto& contig_allele : haplotype.data_->explicit_alleles) {
             Allele allele {GenomicRegion {contig, contig_allele.mapped_region()}, contig_allele.sequence()};
             if (!is_reference(allele, haplotype.reference_)) stream << "{" << allele << "} ";
         }
@@ -0,0 +1,198 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "packed_genotype_block.hpp"
+
+#include <limits>
+#include <stdexcept>
+
+namespace octopus {
+
+bool is_homozygous(const PackedGenotype& genotype) noexcept
+{
+    return genotype.ploidy() < 2 || genotype[0] == genotype[genotype.ploidy() - 1];
+}
+
+unsigned zygosity(const PackedGenotype& genotype) noexcept
+{
+    if (genotype.ploidy() == 0) return 0;
+    unsigned result {1};
+    for (unsigned i {1}; i < genotype.ploidy(); ++i) {
+        if (genotype[i] != genotype[i - 1]) ++result;
+    }
+    return result;
+}
+
+PackedGenotypeBlock::PackedGenotypeBlock(const unsigned ploidy)
+: ploidy_ {ploidy}
+, indices_ {}
+{}
+
+void PackedGenotypeBlock::reserve(const std::size_t num_genotypes)
+{
+    indices_.reserve(num_genotypes * ploidy_);
+}
+
+void PackedGenotypeBlock::push_back(const Genotype<IndexedHaplotype<>>& genotype)
+{
+    assert(genotype.ploidy() == ploidy_);
+    for (const auto& haplotype : genotype) {
+        indices_.push_back(static_cast<HaplotypeIndex>(index_of(haplotype)));
+    }
+}
+
+namespace {
+
+void check_packable(const unsigned num_haplotypes)
+{
+    if (num_haplotypes > std::numeric_limits<PackedGenotype::HaplotypeIndex>::max() + 1u) {
+        throw std::overflow_error {"GenotypeIndexRange: too many haplotypes to pack"};
+    }
+}
+
+} // namespace
+
+GenotypeIndexRange::GenotypeIndexRange(const unsigned num_haplotypes, const unsigned ploidy, const bool max_zygosity_only)
+: num_haplotypes_ {num_haplotypes}
+, ploidy_ {ploidy}
+, max_zygosity_only_ {max_zygosity_only}
+, num_multiset_elements_ {}
+, multichoose_ {}
+, size_ {0}
+{
+    check_packable(num_haplotypes);
+    if (ploidy_ == 0 || num_haplotypes_ == 0 || (max_zygosity_only_ && ploidy_ > num_haplotypes_)) {
+        return;
+    }
+    // Strictly increasing indices a_i are ranked as the non-decreasing indices a_i - i,
+    // which preserves the order
+    num_multiset_elements_ = max_zygosity_only_ ? num_haplotypes_ - ploidy_ + 1 : num_haplotypes_;
+    const auto row_size = ploidy_ + 1;
+    multichoose_.assign((num_multiset_elements_ + 1) * row_size, 0);
+    for (unsigned m {0}; m <= num_multiset_elements_; ++m) {
+        multichoose_[m * row_size] = 1;
+        for (unsigned r {1}; m > 0 && r <= ploidy_; ++r) {
+            const auto a = multichoose_[(m - 1) * row_size + r], b = multichoose_[m * row_size + r - 1];
+            if (a > std::numeric_limits<Rank>::max() - b) {
+                throw std::overflow_error {"GenotypeIndexRange: too many genotypes"};
+            }
+            multichoose_[m * row_size + r] = a + b;
+        }
+    }
+    size_ = multichoose(num_multiset_elements_, ploidy_);
+}
+
+// The rank of sorted indices is the number of genotypes that are lexicographically smaller:
+// sum {i} multichoose(n - a_{i-1}, k - i + 1) - multichoose(n - a_i, k - i + 1), with a_0 = 0
+GenotypeIndexRange::Rank GenotypeIndexRange::rank(const PackedGenotype& genotype) const noexcept
+{
+    assert(genotype.ploidy() == ploidy_);
+    Rank result {0};
+    unsigned prev {0};
+    for (unsigned i {0}; i < ploidy_; ++i) {
+        const unsigned index {max_zygosity_only_ ? genotype[i] - i : genotype[i]};
+        result += multichoose(num_multiset_elements_ - prev, ploidy_ - i) - multichoose(num_multiset_elements_ - index, ploidy_ - i);
+        prev = index;
+    }
+    return result;
+}
+
+void GenotypeIndexRange::unrank(Rank rank, HaplotypeIndex* result) const noexcept
+{
+    assert(rank < size_);
+    unsigned prev {0};
+    for (unsigned i {0}; i < ploidy_; ++i) {
+        // The largest index whose preceding genotypes at this position number at most rank
+        const auto base = multichoose(num_multiset_elements_ - prev, ploidy_ - i);
+        unsigned lo {prev}, hi {num_multiset_elements_ - 1};
+        while (lo < hi) {
+            const auto mid = lo + (hi - lo + 1) / 2;
+            if (base - multichoose(num_multiset_elements_ - mid, ploidy_ - i) <= rank) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        rank -= base - multichoose(num_multiset_elements_ - lo, ploidy_ - i);
+        result[i] = static_cast<HaplotypeIndex>(max_zygosity_only_ ? lo + i : lo);
+        prev = lo;
+    }
+}
+
+bool GenotypeIndexRange::next(std::vector<HaplotypeIndex>& indices) const noexcept
+{
+    // Increment the rightmost index that can be, and reset the indices to its right to their minimum
+    for (auto i = static_cast<int>(ploidy_) - 1; i >= 0; --i) {
+        const auto max_index = max_zygosity_only_ ? num_haplotypes_ - ploidy_ + i : num_haplotypes_ - 1;
+        if (indices[i] < max_index) {
+            ++indices[i];
+            for (unsigned j = i + 1; j < ploidy_; ++j) {
+                indices[j] = max_zygosity_only_ ? indices[j - 1] + 1 : indices[j - 1];
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+PackedGenotypeBlock GenotypeIndexRange::materialise() const
+{
+    return materialise(0, size_);
+}
+
+PackedGenotypeBlock GenotypeIndexRange::materialise(const Rank first, Rank last) const
+{
+    last = std::min(last, size_);
+    PackedGenotypeBlock result {ploidy_};
+    if (first >= last) return result;
+    result.reserve(last - first);
+    for_each(first, last, [&] (Rank, const PackedGenotype& genotype) {
+        result.push_back(std::cbegin(genotype), std::cend(genotype));
+    });
+    return result;
+}
+
+PackedGenotypeBlock generate_all_packed_genotypes(const unsigned num_haplotypes, const unsigned ploidy)
+{
+    return GenotypeIndexRange {num_haplotypes, ploidy}.materialise();
+}
+
+namespace {
+
+template <typename Range>
+boost::optional<PackedGenotypeBlock> pack_range(const Range& genotypes)
+{
+    constexpr auto max_index = std::numeric_limits<PackedGenotype::HaplotypeIndex>::max();
+    if (genotypes.empty()) return PackedGenotypeBlock {};
+    PackedGenotypeBlock result {genotypes.front().ploidy()};
+    result.reserve(genotypes.size());
+    for (const auto& genotype : genotypes) {
+        if (genotype.ploidy() != result.ploidy()) return boost::none;
+        if (genotype.ploidy() > 0 && index_of(genotype[genotype.ploidy() - 1]) > max_index) return boost::none;
+        result.push_back(genotype);
+    }
+    return result;
+}
+
+} // namespace
+
+boost::optional<PackedGenotypeBlock> pack(const std::vector<Genotype<IndexedHaplotype<>>>& genotypes)
+{
+    return pack_range(genotypes);
+}
+
+boost::optional<PackedGenotypeBlock> pack(const MappableBlock<Genotype<IndexedHaplotype<>>>& genotypes)
+{
+    return pack_range(genotypes);
+}
+
+Genotype<IndexedHaplotype<>> unpack(const PackedGenotype& genotype, const MappableBlock<IndexedHaplotype<>>& haplotypes)
+{
+    Genotype<IndexedHaplotype<>> result {genotype.ploidy()};
+    for (const auto index : genotype) {
+        result.emplace(haplotypes[index]);
+    }
+    return result;
+}
+
+} // namespace octopus
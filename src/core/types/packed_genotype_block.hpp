@@ -0,0 +1,211 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef packed_genotype_block_hpp
+#define packed_genotype_block_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+
+#include <boost/optional.hpp>
+
+#include "containers/mappable_block.hpp"
+#include "indexed_haplotype.hpp"
+#include "genotype.hpp"
+
+namespace octopus {
+
+/*
+    A lightweight view of one genotype in a PackedGenotypeBlock: the sorted haplotype
+    indices of the genotype.
+ */
+class PackedGenotype
+{
+public:
+    using HaplotypeIndex = std::uint16_t;
+    using const_iterator = const HaplotypeIndex*;
+
+    PackedGenotype() = delete;
+
+    PackedGenotype(const HaplotypeIndex* indices, unsigned ploidy) noexcept
+    : indices_ {indices}
+    , ploidy_ {ploidy}
+    {}
+
+    unsigned ploidy() const noexcept { return ploidy_; }
+
+    HaplotypeIndex operator[](unsigned n) const noexcept { return indices_[n]; }
+
+    const_iterator begin() const noexcept { return indices_; }
+    const_iterator end() const noexcept { return indices_ + ploidy_; }
+
+private:
+    const HaplotypeIndex* indices_;
+    unsigned ploidy_;
+};
+
+bool is_homozygous(const PackedGenotype& genotype) noexcept;
+unsigned zygosity(const PackedGenotype& genotype) noexcept;
+
+/*
+    A block of genotypes of the same ploidy stored as one contiguous array of haplotype
+    indices, ploidy indices per genotype. Model hot loops can evaluate genotypes straight from
+    the index array, without touching Genotype or Haplotype objects.
+ */
+class PackedGenotypeBlock
+{
+public:
+    using HaplotypeIndex = PackedGenotype::HaplotypeIndex;
+
+    PackedGenotypeBlock() = default;
+
+    explicit PackedGenotypeBlock(unsigned ploidy);
+
+    PackedGenotypeBlock(const PackedGenotypeBlock&)            = default;
+    PackedGenotypeBlock& operator=(const PackedGenotypeBlock&) = default;
+    PackedGenotypeBlock(PackedGenotypeBlock&&)                 = default;
+    PackedGenotypeBlock& operator=(PackedGenotypeBlock&&)      = default;
+
+    ~PackedGenotypeBlock() = default;
+
+    unsigned ploidy() const noexcept { return ploidy_; }
+    std::size_t size() const noexcept { return ploidy_ > 0 ? indices_.size() / ploidy_ : 0; }
+    bool empty() const noexcept { return indices_.empty(); }
+
+    void reserve(std::size_t num_genotypes);
+
+    // The indices must be sorted
+    template <typename ForwardIterator>
+    void push_back(ForwardIterator first_index, ForwardIterator last_index);
+    void push_back(const Genotype<IndexedHaplotype<>>& genotype);
+
+    PackedGenotype operator[](std::size_t n) const noexcept { return {indices_.data() + n * ploidy_, ploidy_}; }
+
+    const HaplotypeIndex* data() const noexcept { return indices_.data(); }
+
+private:
+    unsigned ploidy_ = 0;
+    std::vector<HaplotypeIndex> indices_;
+};
+
+template <typename ForwardIterator>
+void PackedGenotypeBlock::push_back(ForwardIterator first_index, ForwardIterator last_index)
+{
+    assert(static_cast<unsigned>(std::distance(first_index, last_index)) == ploidy_);
+    assert(std::is_sorted(first_index, last_index));
+    std::transform(first_index, last_index, std::back_inserter(indices_),
+                   [] (const auto index) { return static_cast<HaplotypeIndex>(index); });
+}
+
+/*
+    The genotypes of a given ploidy over num_haplotypes haplotypes, in the same order as
+    generate_all_genotypes (or generate_all_max_zygosity_genotypes), without materialising them.
+    Genotypes are ranked and unranked with the combinatorial number system in O(ploidy) and
+    O(ploidy * log num_haplotypes) time, so the range can be streamed or split into chunks.
+ */
+class GenotypeIndexRange
+{
+public:
+    using HaplotypeIndex = PackedGenotype::HaplotypeIndex;
+    using Rank = std::size_t;
+    
+    GenotypeIndexRange() = delete;
+    
+    // Throws std::overflow_error if the number of genotypes does not fit in a Rank
+    GenotypeIndexRange(unsigned num_haplotypes, unsigned ploidy, bool max_zygosity_only = false);
+    
+    GenotypeIndexRange(const GenotypeIndexRange&)            = default;
+    GenotypeIndexRange& operator=(const GenotypeIndexRange&) = default;
+    GenotypeIndexRange(GenotypeIndexRange&&)                 = default;
+    GenotypeIndexRange& operator=(GenotypeIndexRange&&)      = default;
+    
+    ~GenotypeIndexRange() = default;
+    
+    unsigned num_haplotypes() const noexcept { return num_haplotypes_; }
+    unsigned ploidy() const noexcept { return ploidy_; }
+    bool is_max_zygosity_only() const noexcept { return max_zygosity_only_; }
+    Rank size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    
+    Rank rank(const PackedGenotype& genotype) const noexcept;
+    void unrank(Rank rank, HaplotypeIndex* result) const noexcept; // writes ploidy indices
+    
+    PackedGenotypeBlock materialise() const;
+    PackedGenotypeBlock materialise(Rank first, Rank last) const;
+    
+    // Calls f(rank, genotype) for each genotype in [first, last) in order
+    template <typename BinaryFunction>
+    void for_each(BinaryFunction&& f) const { for_each(0, size_, std::forward<BinaryFunction>(f)); }
+    template <typename BinaryFunction>
+    void for_each(Rank first, Rank last, BinaryFunction&& f) const;
+    
+private:
+    unsigned num_haplotypes_, ploidy_;
+    bool max_zygosity_only_;
+    unsigned num_multiset_elements_; // max zygosity genotypes are ranked as multisets of fewer elements
+    std::vector<Rank> multichoose_; // multichoose(m, r) at m * (ploidy + 1) + r
+    Rank size_;
+    
+    Rank multichoose(unsigned m, unsigned r) const noexcept { return multichoose_[m * (ploidy_ + 1) + r]; }
+    bool next(std::vector<HaplotypeIndex>& indices) const noexcept;
+};
+
+template <typename BinaryFunction>
+void GenotypeIndexRange::for_each(const Rank first, const Rank last, BinaryFunction&& f) const
+{
+    if (first >= last || first >= size_) return;
+    std::vector<HaplotypeIndex> indices(ploidy_);
+    unrank(first, indices.data());
+    for (Rank rank {first}; rank < last; ++rank) {
+        f(rank, PackedGenotype {indices.data(), ploidy_});
+        if (!next(indices)) break;
+    }
+}
+
+// All genotypes of num_haplotypes haplotypes, in the same order as generate_all_genotypes
+PackedGenotypeBlock generate_all_packed_genotypes(unsigned num_haplotypes, unsigned ploidy);
+
+/*
+    The ranks, in ascending order, of the k genotypes with the greatest score(genotype), streaming
+    the range so at most k genotypes are held at once.
+ */
+template <typename UnaryFunction>
+std::vector<GenotypeIndexRange::Rank>
+select_top_k_genotypes(const GenotypeIndexRange& genotypes, const std::size_t k, UnaryFunction&& score)
+{
+    using Rank = GenotypeIndexRange::Rank;
+    std::vector<std::pair<double, Rank>> top {};
+    if (k == 0) return {};
+    top.reserve(std::min(k, genotypes.size()));
+    const auto greater = [] (const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; };
+    genotypes.for_each([&] (const Rank rank, const PackedGenotype& genotype) {
+        const double genotype_score = score(genotype);
+        if (top.size() < k) {
+            top.emplace_back(genotype_score, rank);
+            std::push_heap(std::begin(top), std::end(top), greater);
+        } else if (genotype_score > top.front().first) {
+            std::pop_heap(std::begin(top), std::end(top), greater);
+            top.back() = {genotype_score, rank};
+            std::push_heap(std::begin(top), std::end(top), greater);
+        }
+    });
+    std::vector<Rank> result(top.size());
+    std::transform(std::cbegin(top), std::cend(top), std::begin(result), [] (const auto& p) { return p.second; });
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+// boost::none if the genotypes have different ploidies or a haplotype index is too large to pack
+boost::optional<PackedGenotypeBlock> pack(const std::vector<Genotype<IndexedHaplotype<>>>& genotypes);
+boost::optional<PackedGenotypeBlock> pack(const MappableBlock<Genotype<IndexedHaplotype<>>>& genotypes);
+
+Genotype<IndexedHaplotype<>> unpack(const PackedGenotype& genotype, const MappableBlock<IndexedHaplotype<>>& haplotypes);
+
+} // namespace octopus
+
+#endif
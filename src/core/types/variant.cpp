@@ -4,9 +4,12 @@
 #include "variant.hpp"
 
 #include <list>
+#include <algorithm>
+#include <functional>
 #include <ostream>
 #include <cassert>
 
+#include <boost/optional.hpp>
 #include <boost/range/algorithm.hpp>
 
 #include "io/reference/reference_genome.hpp"
@@ -237,8 +240,9 @@ void prepend(const ReferenceGenome::GeneticSequence& src, NucleotideList& dst)
     dst.insert(std::begin(dst), std::cbegin(src), std::cend(src));
 }
 
+template <typename R>
 GenomicRegion extend_alleles(NucleotideList& big_allele, NucleotideList& small_allele,
-                             const ReferenceGenome& reference, const GenomicRegion& current_region,
+                             const R& reference, const GenomicRegion& current_region,
                              const GenomicRegion::Distance extension_size)
 {
     const auto new_region = shift(current_region, -extension_size);
@@ -249,10 +253,9 @@ GenomicRegion extend_alleles(NucleotideList& big_allele, NucleotideList& small_a
     return new_region;
 }
 
-} // namespace
-
-Variant left_align(const Variant& variant, const ReferenceGenome& reference,
-                   const GenomicRegion::Size extension_size)
+// R is anything with a fetch_sequence(const GenomicRegion&) method, like ReferenceGenome
+template <typename R>
+Variant left_align_helper(const Variant& variant, const R& reference, const GenomicRegion::Size extension_size)
 {
     using std::cbegin; using std::cend; using std::crbegin; using std::crend;
     using std::tie; using std::next; using std::mismatch;
@@ -310,6 +313,54 @@ Variant left_align(const Variant& variant, const ReferenceGenome& reference,
     }
 }
 
+constexpr GenomicRegion::Size defaultLeftAlignExtensionSize {30}; // as left_align
+
+// The reference sequence around a batch of variants, fetched once so normalising each variant
+// doesn't make its own small reference requests. Requests outside the window (e.g. indels that
+// left align through a long repeat) still go to the reference.
+class ReferenceSequenceWindow
+{
+public:
+    static constexpr GenomicRegion::Size defaultPadding {500}, maxWindowSize {10'000'000};
+    
+    template <typename ForwardIterator>
+    ReferenceSequenceWindow(ForwardIterator first, ForwardIterator last, const ReferenceGenome& reference,
+                            const GenomicRegion::Size padding = defaultPadding)
+    : reference_ {reference}
+    , region_ {}
+    , sequence_ {}
+    {
+        if (first == last) return;
+        const auto& contig = contig_name(*first);
+        if (std::any_of(first, last, [&] (const Variant& variant) { return contig_name(variant) != contig; })) return;
+        const auto variants_region = encompassing_region(*leftmost_mappable(first, last), *rightmost_mappable(first, last));
+        if (size(variants_region) > maxWindowSize) return;
+        region_ = expand_lhs(variants_region, std::min(padding, variants_region.begin()));
+        sequence_ = reference.fetch_sequence(*region_);
+    }
+    
+    ReferenceGenome::GeneticSequence fetch_sequence(const GenomicRegion& region) const
+    {
+        if (region_ && contains(*region_, region)) {
+            return sequence_.substr(begin_distance(*region_, region), size(region));
+        }
+        return reference_.get().fetch_sequence(region);
+    }
+    
+private:
+    std::reference_wrapper<const ReferenceGenome> reference_;
+    boost::optional<GenomicRegion> region_;
+    ReferenceGenome::GeneticSequence sequence_;
+};
+
+} // namespace
+
+Variant left_align(const Variant& variant, const ReferenceGenome& reference,
+                   const GenomicRegion::Size extension_size)
+{
+    return left_align_helper(variant, reference, extension_size);
+}
+
 Variant normalise(const Variant& variant, const ReferenceGenome& reference,
                   const unsigned extension_size)
 {
@@ -361,8 +412,9 @@ std::vector<Variant> unique_left_align(const std::vector<Variant>& variants,
 {
     std::vector<Variant> result {};
     result.reserve(variants.size());
+    const ReferenceSequenceWindow window {std::cbegin(variants), std::cend(variants), reference};
     boost::transform(variants, std::back_inserter(result),
-                     [&reference] (const Variant& variant) { return left_align(variant, reference); });
+                     [&window] (const Variant& variant) { return left_align_helper(variant, window, defaultLeftAlignExtensionSize); });
     result.erase(boost::unique<boost::return_found>(boost::sort(result)), std::end(result));
     return result;
 }
@@ -376,9 +428,10 @@ std::vector<Variant> unique_left_align(std::vector<Variant>&& variants,
                                           [] (const Variant& variant) {
                                               return !is_left_alignable(variant);
                                           });
+    const ReferenceSequenceWindow window {it, std::end(variants), reference};
     std::transform(std::make_move_iterator(it), std::make_move_iterator(end(variants)), it,
-                   [&reference] (Variant&& variant) {
-                       return left_align(std::move(variant), reference);
+                   [&window] (Variant&& variant) {
+                       return left_align_helper(std::move(variant), window, defaultLeftAlignExtensionSize);
                    });
     std::sort(it, std::end(variants));
     variants.erase(std::unique(it, std::end(variants)), std::end(variants));
@@ -13,6 +13,7 @@
 #include <cassert>
 
 #include <boost/optional.hpp>
+#include <boost/range/iterator_range_core.hpp>
 
 #include "basics/aligned_read.hpp"
 #include "utils/memory_footprint.hpp"
@@ -246,7 +247,7 @@ void BufferedReadWriter<Read>::write(Range reads)
                 buffer_flush_end_itr = buffer_itr;
             }
         }
-        std::for_each(std::cbegin(buffer_), buffer_flush_end_itr, [this] (const auto& read) { writer_.get().write(read); });
+        writer_.get().write(boost::make_iterator_range(std::cbegin(buffer_), buffer_flush_end_itr));
         buffer_.erase(std::cbegin(buffer_), buffer_flush_end_itr);
         buffer_footprint_ = footprint(buffer_);
     }
@@ -12,12 +12,17 @@
 #include <limits>
 #include <cassert>
 #include <array>
+#include <map>
+#include <cstring>
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 #include <htslib/sam.h>
 #include <htslib/hts_endian.h>
+#include <htslib/thread_pool.h>
+#include <htslib/cram.h>
+#include <htslib/hfile.h>
 
 #include "basics/cigar_string.hpp"
 #include "basics/genomic_region.hpp"
@@ -27,6 +32,8 @@
 #include "exceptions/malformed_file_error.hpp"
 #include "exceptions/unwritable_file_error.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/mappable_algorithms.hpp"
+#include "logging/logging.hpp"
 
 #include <iostream>
 
@@ -163,12 +170,74 @@ private:
 
 namespace {
 
-auto open_hts_file(const boost::filesystem::path& file)
+htsFile* open_hts_file(const boost::filesystem::path& file, HtslibDecodingContext* decoding_context)
 {
     hts_verbose = 0; // disable hts error reporting
-    return sam_open(file.c_str(), "r");
+    auto result = sam_open(file.c_str(), "r");
+    if (result && decoding_context) decoding_context->attach(result, file);
+    return result;
+}
+
+} // namespace
+
+void HtslibDecodingContext::HtsThreadPoolDeleter::operator()(hts_tpool* pool) const
+{
+    hts_tpool_destroy(pool);
+}
+
+HtslibDecodingContext::HtslibDecodingContext(const unsigned num_threads, boost::optional<Path> reference, const bool read_ahead,
+                                             const std::size_t remote_block_size)
+: num_threads_ {num_threads}
+, read_ahead_ {read_ahead}
+, remote_block_size_ {remote_block_size}
+, pool_ {num_threads > 0 ? hts_tpool_init(static_cast<int>(num_threads)) : nullptr, HtsThreadPoolDeleter {}}
+, hts_pool_ {}
+, reference_ {std::move(reference)}
+, reference_owner_ {nullptr, HtsFileDeleter {}}
+, mutex_ {}
+{
+    if (!pool_) num_threads_ = 0;
+    hts_pool_.pool = pool_.get();
+    hts_pool_.qsize = 0; // let htslib choose the queue size
 }
 
+unsigned HtslibDecodingContext::num_threads() const noexcept
+{
+    return num_threads_;
+}
+
+bool HtslibDecodingContext::read_ahead() const noexcept
+{
+    return read_ahead_;
+}
+
+void HtslibDecodingContext::attach(htsFile* file, const Path& file_path)
+{
+    if (remote_block_size_ > 0 && hisremote(file_path.c_str())) {
+        if (hts_set_opt(file, HTS_OPT_BLOCK_SIZE, static_cast<int>(remote_block_size_)) != 0) {
+            logging::WarningLogger warn_log {};
+            stream(warn_log) << "Could not set the read block size of " << file_path << ", using the htslib default";
+        }
+    }
+    if (pool_) hts_set_thread_pool(file, &hts_pool_);
+    if (file->is_cram && reference_) {
+        std::lock_guard<std::mutex> lock {mutex_};
+        if (!reference_owner_) {
+            reference_owner_.reset(sam_open(file_path.c_str(), "r"));
+            if (reference_owner_ && hts_set_fai_filename(reference_owner_.get(), reference_->c_str()) != 0) {
+                reference_owner_.reset(nullptr);
+            }
+        }
+        if (reference_owner_) {
+            hts_set_opt(file, CRAM_OPT_SHARED_REF, cram_get_refs(reference_owner_.get()));
+        } else {
+            hts_set_fai_filename(file, reference_->c_str());
+        }
+    }
+}
+
+namespace {
+
 bool is_cram(const boost::filesystem::path& file)
 {
     return file.extension().string() == ".cram";
@@ -176,15 +245,18 @@ bool is_cram(const boost::filesystem::path& file)
 
 } // namespace
 
-HtslibSamFacade::HtslibSamFacade(Path file_path)
+HtslibSamFacade::HtslibSamFacade(Path file_path, std::shared_ptr<HtslibDecodingContext> decoding_context)
 : file_path_ {std::move(file_path)}
-, hts_file_ {open_hts_file(file_path_), HtsFileDeleter {}}
+, decoding_context_ {std::move(decoding_context)}
+, hts_file_ {open_hts_file(file_path_, decoding_context_.get()), HtsFileDeleter {}}
 , hts_header_ {(hts_file_) ? sam_hdr_read(hts_file_.get()) : nullptr, HtsHeaderDeleter {}}
 , hts_index_ {(hts_file_) ? sam_index_load(hts_file_.get(), file_path_.c_str()) : nullptr, HtsIndexDeleter {}}
+, read_ahead_ {false}
 , hts_targets_ {}
 , contig_names_ {}
 , sample_names_ {}
 , samples_ {}
+, indexed_read_densities_ {}
 {
     namespace fs = boost::filesystem;
     if (!hts_file_) {
@@ -215,6 +287,7 @@ HtslibSamFacade::HtslibSamFacade(Path file_path)
         close();
         throw;
     }
+    enable_read_ahead();
     for (const auto& pair : sample_names_) {
         if (std::find(std::cbegin(samples_), std::cend(samples_), pair.second) == std::cend(samples_)) {
             samples_.emplace_back(pair.second);
@@ -236,7 +309,7 @@ auto open_hts_writable_file(const boost::filesystem::path& path)
     return sam_open(path.c_str(), mode.c_str());
 }
 
-HtslibSamFacade::HtslibSamFacade(Path sam_out, Path sam_template)
+HtslibSamFacade::HtslibSamFacade(Path sam_out, Path sam_template, const unsigned num_compression_threads)
 : HtslibSamFacade {std::move(sam_template)}
 {
     file_path_ = std::move(sam_out);
@@ -244,6 +317,10 @@ HtslibSamFacade::HtslibSamFacade(Path sam_out, Path sam_template)
     if (!hts_file_) {
         throw UnwritableBAM {std::move(file_path_)};
     }
+    // BGZF blocks are then compressed by htslib's own pool
+    if (num_compression_threads > 0 && hts_set_threads(hts_file_.get(), static_cast<int>(num_compression_threads)) != 0) {
+        throw UnwritableBAM {std::move(file_path_)};
+    }
     hts_index_ = nullptr;
     if (sam_hdr_write(hts_file_.get(), hts_header_.get()) < 0) {
         throw UnwritableBAM {std::move(file_path_)};
@@ -268,10 +345,11 @@ bool HtslibSamFacade::is_open() const noexcept
 
 void HtslibSamFacade::open()
 {
-    hts_file_.reset(sam_open(file_path_.string().c_str(), "r"));
+    hts_file_.reset(open_hts_file(file_path_, decoding_context_.get()));
     if (hts_file_) {
         hts_header_.reset(sam_hdr_read(hts_file_.get()));
         hts_index_.reset(sam_index_load(hts_file_.get(), file_path_.c_str()));
+        enable_read_ahead();
     }
 }
 
@@ -280,6 +358,7 @@ void HtslibSamFacade::close()
     hts_file_.reset(nullptr);
     hts_header_.reset(nullptr);
     hts_index_.reset(nullptr);
+    read_ahead_ = false;
 }
 
 GenomicRegion::Size HtslibSamFacade::reference_size(const GenomicRegion::ContigName& contig) const
@@ -294,6 +373,76 @@ std::uint64_t HtslibSamFacade::get_num_mapped_reads(const GenomicRegion::ContigN
     return num_mapped;
 }
 
+namespace {
+
+// Typical ratio of uncompressed to compressed bytes in a BGZF block. Only used to add the in-block offsets
+// of a chunk to its whole blocks, so it needn't be accurate.
+constexpr double bgzfCompressionRatio {3.0};
+constexpr std::uintmax_t maxBgzfBlockSize {65536};
+
+double estimate_uncompressed_size(const hts_pair64_max_t& chunk) noexcept
+{
+    const auto compressed = static_cast<double>((chunk.v >> 16) - (chunk.u >> 16));
+    const auto uncompressed = static_cast<double>(chunk.v & 0xffff) - static_cast<double>(chunk.u & 0xffff);
+    return std::max(bgzfCompressionRatio * compressed + uncompressed, 0.0);
+}
+
+} // namespace
+
+boost::optional<double> HtslibSamFacade::get_indexed_size(const HtsTid target, const hts_pos_t begin, const hts_pos_t end) const
+{
+    // The chunks the index gives for a region are a (slight over) estimate of the bytes of record data in it
+    std::unique_ptr<hts_itr_t, void (*)(hts_itr_t*)> itr {sam_itr_queryi(hts_index_.get(), target, begin, end),
+                                                          hts_itr_destroy};
+    if (!itr) return boost::none;
+    double result {0};
+    for (int i {0}; i < itr->n_off; ++i) {
+        result += estimate_uncompressed_size(itr->off[i]);
+    }
+    return result;
+}
+
+void HtslibSamFacade::enable_read_ahead()
+{
+    read_ahead_ = decoding_context_ && decoding_context_->read_ahead() && hts_file_ && !hts_file_->is_cram;
+}
+
+void HtslibSamFacade::advise_access(const std::vector<GenomicRegion>& regions) const
+{
+    if (!read_ahead_ || !hts_index_ || regions.empty()) return;
+    // The advice outlives the handle, so the file is only open while advising. Holding a second descriptor
+    // per reader would go over the --max-open-read-files limit the read manager keeps to.
+    const ReadAheadAdvisor read_ahead {file_path_};
+    if (!read_ahead.is_open()) return;
+    for (const auto& region : regions) {
+        const auto target = hts_targets_.find(region.contig_name());
+        if (target == std::cend(hts_targets_)) continue;
+        std::unique_ptr<hts_itr_t, void (*)(hts_itr_t*)> itr {sam_itr_queryi(hts_index_.get(), target->second, region.begin(), region.end()),
+                                                              hts_itr_destroy};
+        if (!itr) continue;
+        for (int i {0}; i < itr->n_off; ++i) {
+            // The upper 48 bits of a virtual offset are the file offset of the BGZF block. The chunk end is
+            // the start of its last block, so add the largest possible block size.
+            const auto begin = itr->off[i].u >> 16, end = (itr->off[i].v >> 16) + maxBgzfBlockSize;
+            read_ahead.will_need(begin, end - begin);
+        }
+    }
+}
+
+boost::optional<double> HtslibSamFacade::get_indexed_read_density(const HtsTid target) const
+{
+    const auto itr = indexed_read_densities_.find(target);
+    if (itr != std::cend(indexed_read_densities_)) return itr->second;
+    boost::optional<double> result {};
+    const auto num_mapped_reads = get_num_mapped_reads(get_contig_name(target));
+    const auto contig_size = get_indexed_size(target, 0, hts_header_->target_len[target]);
+    if (contig_size && *contig_size > 0) {
+        result = static_cast<double>(num_mapped_reads) / *contig_size;
+    }
+    indexed_read_densities_.emplace(target, result);
+    return result;
+}
+
 std::vector<HtslibSamFacade::SampleName> HtslibSamFacade::extract_samples() const
 {
     return samples_;
@@ -369,7 +518,7 @@ HtslibSamFacade::iterate(const GenomicRegion& region,
         }
     } else {
         while (++itr) {
-            if (!visitor(sample_names_.at(itr.read_group()), *itr)) return false;
+            if (!visitor(itr.sample(), *itr)) return false;
         }
     }
     return true;
@@ -386,7 +535,7 @@ HtslibSamFacade::iterate(const SampleName& sample,
         } else {
             HtslibIterator itr {*this, region};
             while (++itr) {
-                const auto& read_sample = sample_names_.at(itr.read_group());
+                const auto& read_sample = itr.sample();
                 if (read_sample == sample) {
                     if (!visitor(sample, *itr)) return false;
                 }
@@ -410,7 +559,7 @@ HtslibSamFacade::iterate(const std::vector<SampleName>& samples,
         const auto readable_samples = get_readable_samples(samples, samples_);
         HtslibIterator itr {*this, region};
         while (++itr) {
-            const auto& sample = sample_names_.at(itr.read_group());
+            const auto& sample = itr.sample();
             if (std::binary_search(std::cbegin(readable_samples), std::cend(readable_samples), sample)) {
                 if (!visitor(sample, *itr)) return false;
             }
@@ -430,7 +579,7 @@ HtslibSamFacade::iterate(const GenomicRegion& region,
         }
     } else {
         while (++itr) {
-            if (!visitor(sample_names_.at(itr.read_group()), itr.region())) return false;
+            if (!visitor(itr.sample(), itr.region())) return false;
         }
     }
     return true;
@@ -447,7 +596,7 @@ HtslibSamFacade::iterate(const SampleName& sample,
         } else {
             HtslibIterator itr {*this, region};
             while (++itr) {
-                const auto& read_sample = sample_names_.at(itr.read_group());
+                const auto& read_sample = itr.sample();
                 if (read_sample == sample) {
                     if (!visitor(sample, itr.region())) return false;
                 }
@@ -471,7 +620,7 @@ HtslibSamFacade::iterate(const std::vector<SampleName>& samples,
         const auto readable_samples = get_readable_samples(samples, samples_);
         HtslibIterator itr {*this, region};
         while (++itr) {
-            const auto& sample = sample_names_.at(itr.read_group());
+            const auto& sample = itr.sample();
             if (std::binary_search(std::cbegin(readable_samples), std::cend(readable_samples), sample)) {
                 if (!visitor(sample, itr.region())) return false;
             }
@@ -492,7 +641,7 @@ bool HtslibSamFacade::has_reads(const SampleName& sample, const GenomicRegion& r
 {
     if (samples_.size() == 1 && samples_.front() == sample) return has_reads(region);
     HtslibIterator it {*this, region};
-    while (++it) if (sample_names_.at(it.read_group()) == sample) return true;
+    while (++it) if (it.sample() == sample) return true;
     return false;
 }
 
@@ -505,7 +654,7 @@ bool HtslibSamFacade::has_reads(const std::vector<SampleName>& samples, const Ge
     HtslibIterator it {*this, region};
     while (++it) {
         if (std::binary_search(std::cbegin(readable_samples), std::cend(readable_samples),
-                               sample_names_.at(it.read_group()))) {
+                               it.sample())) {
             return true;
         }
     }
@@ -522,12 +671,25 @@ std::size_t HtslibSamFacade::count_reads(const GenomicRegion& region) const
     return result;
 }
 
+boost::optional<std::size_t> HtslibSamFacade::estimate_read_count(const GenomicRegion& region) const
+{
+    // CRAM indices only record containers, not the BAM bins and chunks used here
+    if (!hts_index_ || hts_file_->is_cram) return boost::none;
+    const auto target = get_htslib_target(region.contig_name());
+    const auto region_size = get_indexed_size(target, region.begin(), region.end());
+    if (!region_size) return boost::none;
+    if (*region_size == 0) return std::size_t {0};
+    const auto density = get_indexed_read_density(target);
+    if (!density) return boost::none;
+    return std::max(static_cast<std::size_t>(std::round(*region_size * *density)), std::size_t {1});
+}
+
 std::size_t HtslibSamFacade::count_reads(const SampleName& sample, const GenomicRegion& region) const
 {
     if (samples_.size() == 1 && samples_.front() == sample) return count_reads(region);
     HtslibIterator it {*this, region};
     std::size_t result {0};
-    while (++it && sample_names_.at(it.read_group()) == sample) ++result;
+    while (++it && it.sample() == sample) ++result;
     return result;
 }
 
@@ -540,7 +702,7 @@ std::size_t HtslibSamFacade::count_reads(const std::vector<SampleName>& samples,
     HtslibIterator it {*this, region};
     std::size_t result {0};
     while (++it && std::binary_search(std::cbegin(readable_samples), std::cend(readable_samples),
-                                      sample_names_.at(it.read_group()))) {
+                                      it.sample())) {
         ++result;
     }
     return result;
@@ -571,7 +733,7 @@ HtslibSamFacade::extract_read_positions(const SampleName& sample, const GenomicR
     result.reserve(max_coverage);
     HtslibIterator it {*this, region};
     while (max_coverage > 0 && ++it) {
-        if (sample == sample_names_.at(it.read_group())) {
+        if (sample == it.sample()) {
             result.push_back(it.begin());
             --max_coverage;
         }
@@ -590,7 +752,7 @@ HtslibSamFacade::extract_read_positions(const std::vector<SampleName>& samples,
     result.reserve(max_coverage);
     HtslibIterator it {*this, region};
     while (max_coverage > 0 && ++it) {
-        if (contains(samples, sample_names_.at(it.read_group()))) {
+        if (contains(samples, it.sample())) {
             result.push_back(it.begin());
             --max_coverage;
         }
@@ -631,7 +793,7 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const GenomicRegion&
     }
     while (++it) {
         try {
-            result.at(sample_names_.at(it.read_group())).emplace_back(*it);
+            result.at(it.sample()).emplace_back(*it);
         } catch (InvalidBamRecord& e) {
             // TODO: Just ignore? Could log or something.
             //std::clog << "Warning: " << e.what() << std::endl;
@@ -650,7 +812,7 @@ HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_reads(const SampleName& sa
     ReadContainer result {};
     try_reserve(result, defaultReserve_, defaultReserve_ / 10);
     while (++it) {
-        if (sample_names_.at(it.read_group()) == sample) {
+        if (it.sample() == sample) {
             try {
                 result.emplace_back(*it);
             } catch (InvalidBamRecord& e) {
@@ -682,10 +844,10 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<Sa
     }
     if (result.empty()) return result; // no matching samples
     while (++it) {
-        const auto& sample = sample_names_.at(it.read_group());
+        const auto& sample = it.sample();
         if (result.count(sample) == 1) {
             try {
-                result.at(sample_names_.at(it.read_group())).emplace_back(*it);
+                result.at(it.sample()).emplace_back(*it);
             } catch (InvalidBamRecord& e) {
                 // TODO
             } catch (...) {
@@ -696,18 +858,9 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<Sa
     return result;
 }
 
-auto to_hts_regions(const std::vector<GenomicRegion>& regions)
-{
-    std::vector<hts_pair_pos_t> result(regions.size());
-    std::transform(std::cbegin(regions), std::cend(regions), std::begin(result),
-                   [] (const auto& region) -> hts_pair_pos_t { return {
-                           static_cast<hts_pos_t>(region.begin()), 
-                           static_cast<hts_pos_t>(region.end())}; });
-    return result;
-}
-
 HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<GenomicRegion>& regions) const
 {
+    if (regions.empty()) return {};
     if (regions.size() == 1) {
         return fetch_reads(regions.front());
     }
@@ -715,16 +868,15 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<Ge
     if (samples_.size() == 1) {
         return {{samples_.front(), fetch_reads(samples_.front(), regions)}};
     }
-    auto hts_regions = to_hts_regions(regions);
-    std::vector<hts_reglist_t> hts_region_list {make_hts_region_list(regions.front().contig_name(), hts_regions)};
-    HtslibIterator it {*this, hts_region_list};
+    auto hts_region_list = make_hts_region_list(regions);
+    HtslibIterator it {*this, hts_region_list.regions};
     for (const auto& sample : samples_) {
         auto p = result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
         try_reserve(p.first->second, defaultReserve_, defaultReserve_ / 10);
     }
     while (++it) {
         try {
-            result.at(sample_names_.at(it.read_group())).emplace_back(*it);
+            result.at(it.sample()).emplace_back(*it);
         } catch (InvalidBamRecord& e) {
             // TODO: Just ignore? Could log or something.
             //std::clog << "Warning: " << e.what() << std::endl;
@@ -737,18 +889,18 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<Ge
 
 HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_reads(const SampleName& sample, const std::vector<GenomicRegion>& regions) const
 {
+    if (regions.empty()) return {};
     if (regions.size() == 1) {
         return fetch_reads(sample, regions.front());
     }
     if (!contains(samples_, sample)) return {};
     if (samples_.size() == 1) return fetch_all_reads(regions);
-    auto hts_regions = to_hts_regions(regions);
-    std::vector<hts_reglist_t> hts_region_list {make_hts_region_list(regions.front().contig_name(), hts_regions)};
-    HtslibIterator it {*this, hts_region_list};
+    auto hts_region_list = make_hts_region_list(regions);
+    HtslibIterator it {*this, hts_region_list.regions};
     ReadContainer result {};
     try_reserve(result, defaultReserve_, defaultReserve_ / 10);
     while (++it) {
-        if (sample_names_.at(it.read_group()) == sample) {
+        if (it.sample() == sample) {
             try {
                 result.emplace_back(*it);
             } catch (InvalidBamRecord& e) {
@@ -764,6 +916,7 @@ HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_reads(const SampleName& sa
 HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<SampleName>& samples,
                                                             const std::vector<GenomicRegion>& regions) const
 {
+    if (regions.empty()) return {};
     if (regions.size() == 1) {
         return fetch_reads(samples, regions.front());
     }
@@ -771,9 +924,8 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<Sa
         return {{samples.front(), fetch_reads(samples.front(), regions)}};
     }
     if (set_equal(samples_, samples)) return fetch_reads(regions);
-    auto hts_regions = to_hts_regions(regions);
-    std::vector<hts_reglist_t> hts_region_list {make_hts_region_list(regions.front().contig_name(), hts_regions)};
-    HtslibIterator it {*this, hts_region_list};
+    auto hts_region_list = make_hts_region_list(regions);
+    HtslibIterator it {*this, hts_region_list.regions};
     SampleReadMap result {samples.size()};
     for (const auto& sample : samples) {
         if (contains(samples_, sample)) {
@@ -785,10 +937,10 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<Sa
     }
     if (result.empty()) return result; // no matching samples
     while (++it) {
-        const auto& sample = sample_names_.at(it.read_group());
+        const auto& sample = it.sample();
         if (result.count(sample) == 1) {
             try {
-                result.at(sample_names_.at(it.read_group())).emplace_back(*it);
+                result.at(it.sample()).emplace_back(*it);
             } catch (InvalidBamRecord& e) {
                 // TODO
             } catch (...) {
@@ -799,6 +951,27 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<Sa
     return result;
 }
 
+HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<SampleName>& samples,
+                                                            const GenomicRegion& region,
+                                                            const ReadRegionFilter& filter) const
+{
+    HtslibIterator it {*this, region};
+    return fetch_reads(it, samples, filter);
+}
+
+HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<SampleName>& samples,
+                                                            const std::vector<GenomicRegion>& regions,
+                                                            const ReadRegionFilter& filter) const
+{
+    if (regions.empty()) return {};
+    if (regions.size() == 1) {
+        return fetch_reads(samples, regions.front(), filter);
+    }
+    auto hts_region_list = make_hts_region_list(regions);
+    HtslibIterator it {*this, hts_region_list.regions};
+    return fetch_reads(it, samples, filter);
+}
+
 std::vector<GenomicRegion::ContigName> HtslibSamFacade::reference_contigs() const
 {
     std::vector<GenomicRegion::ContigName> result {};
@@ -824,17 +997,30 @@ boost::optional<std::vector<GenomicRegion::ContigName>> HtslibSamFacade::mapped_
     return result;
 }
 
-void HtslibSamFacade::write(const AlignedRead& read)
+HtslibSamFacade::EncodedRead HtslibSamFacade::encode(const AlignedRead& read) const
 {
-    if (!hts_file_ || !hts_header_) {
+    if (!hts_header_) {
         throw UnwritableBAM {file_path_};
     }
-    std::unique_ptr<bam1_t, HtsBam1Deleter> record {bam_init1(), HtsBam1Deleter {}};
-    if (!record) {
+    EncodedRead result {bam_init1(), HtsBam1Deleter {}};
+    if (!result) {
         throw UnwritableBAM {file_path_};
     }
-    write(read, record.get());
-    if (sam_write1(hts_file_.get(), hts_header_.get(), record.get()) < 0) {
+    write(read, result.get());
+    return result;
+}
+
+void HtslibSamFacade::write(const AlignedRead& read)
+{
+    write(encode(read));
+}
+
+void HtslibSamFacade::write(const EncodedRead& read)
+{
+    if (!hts_file_ || !hts_header_) {
+        throw UnwritableBAM {file_path_};
+    }
+    if (sam_write1(hts_file_.get(), hts_header_.get(), read.get()) < 0) {
         throw UnwritableBAM {file_path_};
     }
 }
@@ -860,9 +1046,8 @@ HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_all_reads(const GenomicReg
 
 HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_all_reads(const std::vector<GenomicRegion>& regions) const
 {
-    auto hts_regions = to_hts_regions(regions);
-    std::vector<hts_reglist_t> hts_region_list {make_hts_region_list(regions.front().contig_name(), hts_regions)};
-    HtslibIterator it {*this, hts_region_list};
+    auto hts_region_list = make_hts_region_list(regions);
+    HtslibIterator it {*this, hts_region_list.regions};
     ReadContainer result {};
     try_reserve(result, defaultReserve_, defaultReserve_ / 10);
     while (++it) {
@@ -877,15 +1062,73 @@ HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_all_reads(const std::vecto
     return result;
 }
 
-hts_reglist_t HtslibSamFacade::make_hts_region_list(const GenomicRegion::ContigName& contig, std::vector<hts_pair_pos_t>& regions) const
+HtslibSamFacade::SampleReadMap
+HtslibSamFacade::fetch_reads(HtslibIterator& it, const std::vector<SampleName>& samples, const ReadRegionFilter& filter) const
 {
-    hts_reglist_t result {};
-    result.reg = contig.c_str();
-    result.tid = hts_targets_.at(contig);
-    result.count = regions.size();
-    result.intervals = regions.data();
-    result.min_beg = regions.front().beg;
-    result.max_end = regions.back().end;
+    SampleReadMap result {samples.size()};
+    for (const auto& sample : samples) {
+        if (contains(samples_, sample)) {
+            auto p = result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
+            try_reserve(p.first->second, defaultReserve_, defaultReserve_ / 10);
+        }
+    }
+    if (result.empty()) return result; // no matching samples
+    while (++it) {
+        // The read region only needs the cigar, so rejected reads are never fully decoded
+        const auto& sample = samples_.size() == 1 ? samples_.front() : it.sample();
+        const auto sample_itr = result.find(sample);
+        if (sample_itr == std::end(result) || !filter(sample, it.contig_name(), it.region())) continue;
+        try {
+            sample_itr->second.emplace_back(*it);
+        } catch (InvalidBamRecord& e) {
+            // TODO
+        } catch (...) {
+            throw;
+        }
+    }
+    return result;
+}
+
+namespace {
+
+auto to_hts_regions(std::vector<ContigRegion> regions)
+{
+    std::sort(std::begin(regions), std::end(regions));
+    const auto covered_regions = extract_covered_regions(regions);
+    std::vector<hts_pair_pos_t> result(covered_regions.size());
+    std::transform(std::cbegin(covered_regions), std::cend(covered_regions), std::begin(result),
+                   [] (const auto& region) -> hts_pair_pos_t { return {
+                           static_cast<hts_pos_t>(region.begin()),
+                           static_cast<hts_pos_t>(region.end())}; });
+    return result;
+}
+
+} // namespace
+
+HtslibSamFacade::HtsRegionList HtslibSamFacade::make_hts_region_list(const std::vector<GenomicRegion>& regions) const
+{
+    // All contigs go in one iterator so the index is only queried once and neighbouring regions
+    // share decompressed blocks. The iterator needs sorted non-overlapping intervals for each contig,
+    // and returns reads overlapping several of them just once.
+    std::map<HtsTid, std::vector<ContigRegion>> contig_regions {};
+    for (const auto& region : regions) {
+        contig_regions[get_htslib_target(region.contig_name())].push_back(region.contig_region());
+    }
+    HtsRegionList result {};
+    result.intervals.reserve(contig_regions.size());
+    result.regions.reserve(contig_regions.size());
+    for (auto& p : contig_regions) {
+        result.intervals.push_back(to_hts_regions(std::move(p.second)));
+        auto& intervals = result.intervals.back();
+        hts_reglist_t region_list {};
+        region_list.reg = hts_header_->target_name[p.first];
+        region_list.tid = p.first;
+        region_list.count = intervals.size();
+        region_list.intervals = intervals.data();
+        region_list.min_beg = intervals.front().beg;
+        region_list.max_end = intervals.back().end;
+        result.regions.push_back(region_list);
+    }
     return result;
 }
 
@@ -937,8 +1180,9 @@ void HtslibSamFacade::init_maps()
                 e.set_reason("a sample tag (SM) in @RG lines is required but was not found");
                 throw e;
             }
-            sample_names_.emplace(extract_tag_value(line, readGroupIdTag),
-                                  extract_tag_value(line, sampleIdTag));
+            const auto p = sample_names_.emplace(extract_tag_value(line, readGroupIdTag),
+                                                 extract_tag_value(line, sampleIdTag));
+            if (p.second) read_groups_.push_back(*p.first);
             ++num_read_groups;
         }
     }
@@ -1031,20 +1275,39 @@ auto extract_sequence_length(const bam1_t* b) noexcept
     return b->core.l_qseq;
 }
 
+static constexpr const char* symbolTable {"=ACMGRSVTWYHKDBN"};
+
 char extract_base(const std::uint8_t* hts_sequence, const std::uint32_t index) noexcept
 {
-    static constexpr const char* symbolTable {"=ACMGRSVTWYHKDBN"};
     return symbolTable[bam_seqi(hts_sequence, index)];
 }
 
+// Each byte of a BAM sequence packs two bases, so decode a byte at a time
+auto make_base_pair_table() noexcept
+{
+    std::array<std::array<char, 2>, 256> result {};
+    for (unsigned code {0}; code < result.size(); ++code) {
+        result[code] = {symbolTable[code >> 4], symbolTable[code & 0xf]};
+    }
+    return result;
+}
+
 AlignedRead::NucleotideSequence extract_sequence(const bam1_t* b)
 {
     using NucleotideSequence = AlignedRead::NucleotideSequence;
+    static const auto basePairTable = make_base_pair_table();
     const auto sequence_length  = static_cast<NucleotideSequence::size_type>(extract_sequence_length(b));
     const auto hts_sequence     = bam_get_seq(b);
     NucleotideSequence result(sequence_length, 'N');
-    std::uint32_t i {0};
-    std::generate_n(std::begin(result), sequence_length, [&] () { return extract_base(hts_sequence, i++); });
+    auto result_itr = std::begin(result);
+    for (NucleotideSequence::size_type i {0}; i < sequence_length / 2; ++i) {
+        const auto& bases = basePairTable[hts_sequence[i]];
+        *result_itr++ = bases[0];
+        *result_itr++ = bases[1];
+    }
+    if (sequence_length % 2 == 1) {
+        *result_itr = extract_base(hts_sequence, static_cast<std::uint32_t>(sequence_length - 1));
+    }
     return result;
 }
 
@@ -1066,10 +1329,7 @@ CigarString extract_cigar_string(const bam1_t* b)
     const auto cigar_length     = get_cigar_length(b);
     CigarString result(cigar_length);
     std::transform(cigar_operations, cigar_operations + cigar_length, std::begin(result),
-                   [] (const auto op) noexcept {
-                       return CigarOperation {static_cast<CigarOperation::Size>(bam_cigar_oplen(op)),
-                                              static_cast<CigarOperation::Flag>(bam_cigar_opchr(op))};
-                   });
+                   [] (const auto op) noexcept { return CigarOperation::from_bam(op); });
     return result;
 }
 
@@ -1153,11 +1413,15 @@ auto get_annotations(const bam1_t* record)
     const auto end = record->data + record->l_data;
     std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>> result {};
     AlignedRead::Tag tag {};
-    AlignedRead::Annotation annotation {};
+    AlignedRead::Annotation read_group {};
     while (s != nullptr && end - s >= 3) {
         std::copy_n(s, tag.size(), std::begin(tag));
         s += tag.size();
         const auto tagtype = static_cast<char>(*s);
+        // The read group is given to AlignedRead separately, so don't copy it twice
+        const bool is_read_group {tag[0] == readGroupTag[0] && tag[1] == readGroupTag[1]};
+        if (!is_read_group) result.emplace_back(tag, AlignedRead::Annotation {});
+        auto& annotation = is_read_group ? read_group : result.back().second;
         switch (tagtype) {
             case 'c':
                 // fall through
@@ -1193,10 +1457,13 @@ auto get_annotations(const bam1_t* record)
                 break;
             case 'Z':
                 // fall through
-            case 'H':
-                annotation = std::string {bam_aux2Z(s)};
-                s += (annotation.length() + 1);
+            case 'H': {
+                const char* value {bam_aux2Z(s)};
+                const auto length = std::strlen(value);
+                if (!is_read_group) annotation.assign(value, length);
+                s += (length + 1);
                 break;
+            }
             case 'B': {
                 const auto size = aux_type2size(*s);
                 ++s;
@@ -1208,7 +1475,6 @@ auto get_annotations(const bam1_t* record)
             default:
                 throw std::runtime_error {"Unknown BAM tag type"};
         }
-        result.emplace_back(tag, annotation);
         s += 1;
     }
     return result;
@@ -1276,13 +1542,36 @@ AlignedRead HtslibSamFacade::HtslibIterator::operator*() const
     return result;
 }
 
-HtslibSamFacade::ReadGroupIdType HtslibSamFacade::HtslibIterator::read_group() const
+std::size_t HtslibSamFacade::HtslibIterator::find_read_group() const
 {
     const auto ptr = bam_aux_get(hts_bam1_.get(), readGroupTag.c_str());
     if (ptr == nullptr) {
         throw InvalidBamRecord {hts_facade_.file_path_, extract_read_name(hts_bam1_.get()), "no read group"};
     }
-    return HtslibSamFacade::ReadGroupIdType {bam_aux2Z(ptr)};
+    const char* id {bam_aux2Z(ptr)};
+    const auto& read_groups = hts_facade_.read_groups_;
+    if (read_group_hint_ < read_groups.size() && read_groups[read_group_hint_].first == id) {
+        return read_group_hint_;
+    }
+    const auto itr = std::find_if(std::cbegin(read_groups), std::cend(read_groups),
+                                  [id] (const auto& read_group) { return read_group.first == id; });
+    if (itr == std::cend(read_groups)) {
+        MalformedBAMHeader e {hts_facade_.file_path_};
+        e.set_reason("read " + extract_read_name(hts_bam1_.get()) + " has read group " + id + ", which is not in the header");
+        throw e;
+    }
+    read_group_hint_ = static_cast<std::size_t>(std::distance(std::cbegin(read_groups), itr));
+    return read_group_hint_;
+}
+
+const HtslibSamFacade::ReadGroupIdType& HtslibSamFacade::HtslibIterator::read_group() const
+{
+    return hts_facade_.read_groups_[find_read_group()].first;
+}
+
+const HtslibSamFacade::SampleName& HtslibSamFacade::HtslibIterator::sample() const
+{
+    return hts_facade_.read_groups_[find_read_group()].second;
 }
 
 bool HtslibSamFacade::HtslibIterator::is_good() const noexcept
@@ -1300,6 +1589,11 @@ bool HtslibSamFacade::HtslibIterator::is_good() const noexcept
                        [] (const auto op) { return bam_cigar_oplen(op) > 0; });
 }
 
+const GenomicRegion::ContigName& HtslibSamFacade::HtslibIterator::contig_name() const
+{
+    return hts_facade_.get_contig_name(hts_bam1_->core.tid);
+}
+
 ContigRegion HtslibSamFacade::HtslibIterator::region() const
 {
     const auto cigar = extract_cigar_string(hts_bam1_.get());
@@ -1438,25 +1732,7 @@ void set_cigar(const AlignedRead& read, bam1_t* result) noexcept
     const auto& cigar = read.cigar();
     result->core.n_cigar = cigar.size();
     std::transform(std::cbegin(cigar), std::cend(cigar), bam_get_cigar(result),
-                   [] (const CigarOperation& op) noexcept -> std::uint32_t {
-                       // Lower 4 bits for CIGAR operation and the higher 28 bits for size
-                       std::uint32_t result = op.size();
-                       result <<= BAM_CIGAR_SHIFT;
-                       using Flag = CigarOperation::Flag;
-                       switch (op.flag()) {
-                           case Flag::alignmentMatch: result |= BAM_CMATCH; break;
-                           case Flag::insertion:      result |= BAM_CINS; break;
-                           case Flag::deletion:       result |= BAM_CDEL; break;
-                           case Flag::skipped:        result |= BAM_CREF_SKIP; break;
-                           case Flag::softClipped:    result |= BAM_CSOFT_CLIP; break;
-                           case Flag::hardClipped:    result |= BAM_CHARD_CLIP; break;
-                           case Flag::padding:        result |= BAM_CPAD; break;
-                           case Flag::sequenceMatch:  result |= BAM_CEQUAL; break;
-                           case Flag::substitution:   result |= BAM_CDIFF; break;
-                       }
-                       return result;
-                   });
-    result->l_data += cigar_bytes(read);
+                   [] (const CigarOperation& op) noexcept { return op.bam_encoding(); });
 }
 
 static constexpr std::array<std::uint8_t, 128> sam_bases
@@ -11,6 +11,7 @@
 #include <cstdint>
 #include <memory>
 #include <utility>
+#include <mutex>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/optional.hpp>
@@ -19,6 +20,7 @@
 #include "htslib/sam.h"
 
 #include "basics/aligned_read.hpp"
+#include "utils/system_utils.hpp"
 #include "read_reader_impl.hpp"
 
 namespace octopus {
@@ -28,6 +30,60 @@ class ContigRegion;
 
 namespace io {
 
+/*
+ The decompression threads and CRAM reference sequences shared by every HtslibSamFacade given
+ the context. BGZF and CRAM blocks of all those files are decoded on one htslib thread pool, and
+ CRAM files are decoded against the run's reference, which is loaded once and shared between them
+ rather than found (and read) again from REF_PATH or the @SQ UR fields for every file.
+ */
+class HtslibDecodingContext
+{
+public:
+    using Path = boost::filesystem::path;
+    
+    HtslibDecodingContext() = delete;
+    
+    // If read_ahead is set, readers of local BAM files tell the OS which parts of the file they will read next.
+    // If remote_block_size > 0, remote files (e.g. s3:// or gs:// URLs) are read in blocks of this many bytes,
+    // so a fetch makes a few large range requests rather than one per BGZF block.
+    HtslibDecodingContext(unsigned num_threads, boost::optional<Path> reference = boost::none, bool read_ahead = false,
+                          std::size_t remote_block_size = 0);
+    
+    HtslibDecodingContext(const HtslibDecodingContext&)            = delete;
+    HtslibDecodingContext& operator=(const HtslibDecodingContext&) = delete;
+    HtslibDecodingContext(HtslibDecodingContext&&)                 = delete;
+    HtslibDecodingContext& operator=(HtslibDecodingContext&&)      = delete;
+    
+    ~HtslibDecodingContext() = default;
+    
+    unsigned num_threads() const noexcept;
+    bool read_ahead() const noexcept;
+    
+    // Must be called before the file's header is read
+    void attach(htsFile* file, const Path& file_path);
+    
+private:
+    struct HtsThreadPoolDeleter
+    {
+        void operator()(hts_tpool* pool) const;
+    };
+    struct HtsFileDeleter
+    {
+        void operator()(htsFile* file) const { hts_close(file); }
+    };
+    
+    unsigned num_threads_;
+    bool read_ahead_;
+    std::size_t remote_block_size_;
+    std::unique_ptr<hts_tpool, HtsThreadPoolDeleter> pool_;
+    htsThreadPool hts_pool_;
+    boost::optional<Path> reference_;
+    // The first CRAM file attached is kept open as it owns the shared reference sequences.
+    // Declared after pool_ so it is closed first.
+    std::unique_ptr<htsFile, HtsFileDeleter> reference_owner_;
+    std::mutex mutex_;
+};
+
 class HtslibSamFacade : public IReadReaderImpl
 {
 public:
@@ -39,6 +95,7 @@ public:
     using IReadReaderImpl::PositionList;
     using IReadReaderImpl::AlignedReadReadVisitor;
     using IReadReaderImpl::ContigRegionVisitor;
+    using IReadReaderImpl::ReadRegionFilter;
     
     using NucleotideSequence = AlignedRead::NucleotideSequence;
     
@@ -46,8 +103,8 @@ public:
     
     HtslibSamFacade() = delete;
     
-    HtslibSamFacade(Path file_path);
-    HtslibSamFacade(Path sam_out, Path sam_template);
+    HtslibSamFacade(Path file_path, std::shared_ptr<HtslibDecodingContext> decoding_context = nullptr);
+    HtslibSamFacade(Path sam_out, Path sam_template, unsigned num_compression_threads = 0);
     
     HtslibSamFacade(const HtslibSamFacade&)            = delete;
     HtslibSamFacade& operator=(const HtslibSamFacade&) = delete;
@@ -88,6 +145,8 @@ public:
                    const GenomicRegion& region) const override;
     
     std::size_t count_reads(const GenomicRegion& region) const override;
+    boost::optional<std::size_t> estimate_read_count(const GenomicRegion& region) const override;
+    void advise_access(const std::vector<GenomicRegion>& regions) const override;
     std::size_t count_reads(const SampleName& sample,
                             const GenomicRegion& region) const override;
     std::size_t count_reads(const std::vector<SampleName>& samples,
@@ -112,12 +171,27 @@ public:
                               const std::vector<GenomicRegion>& regions) const override;
     SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
                               const std::vector<GenomicRegion>& regions) const override;
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                              const GenomicRegion& region,
+                              const ReadRegionFilter& filter) const override;
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                              const std::vector<GenomicRegion>& regions,
+                              const ReadRegionFilter& filter) const override;
     
     GenomicRegion::Size reference_size(const GenomicRegion::ContigName& contig) const override;
     std::vector<GenomicRegion::ContigName> reference_contigs() const override;
     boost::optional<std::vector<GenomicRegion::ContigName>> mapped_contigs() const override;
     
+    struct HtsBam1Deleter
+    {
+        void operator()(bam1_t* b) const { bam_destroy1(b); }
+    };
+    using EncodedRead = std::unique_ptr<bam1_t, HtsBam1Deleter>;
+    
+    // Encoding only reads the header, so can be done concurrently with writing
+    EncodedRead encode(const AlignedRead& read) const;
     void write(const AlignedRead& read);
+    void write(const EncodedRead& read);
     
 private:
     using HtsTid = std::int32_t;
@@ -136,9 +210,12 @@ private:
     {
         void operator()(hts_idx_t* index) const { hts_idx_destroy(index); }
     };
-    struct HtsBam1Deleter
+    
+    // Regions for a single multi-region iterator, one list per contig. The intervals must outlive the iterator.
+    struct HtsRegionList
     {
-        void operator()(bam1_t* b) const { bam_destroy1(b); }
+        std::vector<std::vector<hts_pair_pos_t>> intervals;
+        std::vector<hts_reglist_t> regions;
     };
     
     class HtslibIterator
@@ -158,9 +235,11 @@ private:
         bool operator++();
         AlignedRead operator*() const;
         
-        HtslibSamFacade::ReadGroupIdType read_group() const;
+        const HtslibSamFacade::ReadGroupIdType& read_group() const;
+        const HtslibSamFacade::SampleName& sample() const;
         
         bool is_good() const noexcept;
+        const GenomicRegion::ContigName& contig_name() const;
         ContigRegion region() const;
         std::size_t begin() const noexcept;
     
@@ -184,27 +263,40 @@ private:
         
         std::unique_ptr<hts_itr_t, HtsIteratorDeleter> hts_iterator_;
         std::unique_ptr<bam1_t, HtsBam1Deleter> hts_bam1_;
+        mutable std::size_t read_group_hint_ = 0; // consecutive reads usually share a read group
+        
+        std::size_t find_read_group() const;
     };
     
     Path file_path_;
     
+    std::shared_ptr<HtslibDecodingContext> decoding_context_; // must outlive hts_file_
     std::unique_ptr<htsFile, HtsFileDeleter> hts_file_;
     std::unique_ptr<bam_hdr_t, HtsHeaderDeleter> hts_header_;
     std::unique_ptr<hts_idx_t, HtsIndexDeleter> hts_index_;
+    bool read_ahead_; // only for local BAMs when the decoding context asks for read ahead
     
     std::unordered_map<GenomicRegion::ContigName, HtsTid> hts_targets_;
     std::unordered_map<HtsTid, GenomicRegion::ContigName> contig_names_;
     std::unordered_map<ReadGroupIdType, SampleName> sample_names_;
+    // The same read groups interned, so decoded records can be matched without making strings
+    std::vector<std::pair<ReadGroupIdType, SampleName>> read_groups_;
     
     std::vector<SampleName> samples_;
     
+    mutable std::unordered_map<HtsTid, boost::optional<double>> indexed_read_densities_;
+    
     void init_maps();
+    void enable_read_ahead();
     HtsTid get_htslib_target(const GenomicRegion::ContigName& contig) const;
     const GenomicRegion::ContigName& get_contig_name(HtsTid target) const;
     std::uint64_t get_num_mapped_reads(const GenomicRegion::ContigName& contig) const;
+    boost::optional<double> get_indexed_size(HtsTid target, hts_pos_t begin, hts_pos_t end) const;
+    boost::optional<double> get_indexed_read_density(HtsTid target) const;
     ReadContainer fetch_all_reads(const GenomicRegion& region) const;
     ReadContainer fetch_all_reads(const std::vector<GenomicRegion>& regions) const;
-    hts_reglist_t make_hts_region_list(const GenomicRegion::ContigName& contig, std::vector<hts_pair_pos_t>& regions) const;
+    SampleReadMap fetch_reads(HtslibIterator& it, const std::vector<SampleName>& samples, const ReadRegionFilter& filter) const;
+    HtsRegionList make_hts_region_list(const std::vector<GenomicRegion>& regions) const;
     void set_fixed_length_data(const AlignedRead& read, bam1_t* result) const;
     void write(const AlignedRead& read, bam1_t* result) const;
 };
@@ -0,0 +1,270 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "read_depth_index.hpp"
+
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <exception>
+#include <cmath>
+#include <cassert>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "basics/aligned_read.hpp"
+#include "exceptions/unwritable_file_error.hpp"
+#include "read_reader.hpp"
+
+namespace octopus { namespace io {
+
+namespace fs = boost::filesystem;
+
+class UnwritableReadDepthIndex : public UnwritableFileError
+{
+    std::string do_where() const override { return "ReadDepthIndex::write"; }
+public:
+    UnwritableReadDepthIndex(fs::path file) : UnwritableFileError {std::move(file), "read depth index"} {}
+};
+
+namespace {
+
+constexpr char indexMagic[8] {'O', 'C', 'T', 'O', 'D', 'I', 'X', '\0'};
+constexpr std::uint32_t indexVersion {1};
+
+template <typename T>
+void write_value(std::ostream& os, const T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_value(std::istream& is, T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+void write_string(std::ostream& os, const std::string& str)
+{
+    write_value(os, static_cast<std::uint32_t>(str.size()));
+    os.write(str.data(), str.size());
+}
+
+bool read_string(std::istream& is, std::string& result)
+{
+    std::uint32_t size;
+    if (!read_value(is, size)) return false;
+    result.resize(size);
+    return size == 0 || static_cast<bool>(is.read(&result[0], size));
+}
+
+auto get_last_write_time(const fs::path& file)
+{
+    return static_cast<std::int64_t>(fs::last_write_time(file));
+}
+
+auto num_bins(const GenomicRegion::Size contig_size, const GenomicRegion::Size bin_size) noexcept
+{
+    return contig_size / bin_size + (contig_size % bin_size > 0 ? 1 : 0);
+}
+
+} // namespace
+
+ReadDepthIndex::ReadDepthIndex(const ReadReader& reads, const GenomicRegion::Size bin_size)
+: reads_file_size_ {fs::file_size(reads.path())}
+, reads_last_write_time_ {get_last_write_time(reads.path())}
+, bin_size_ {bin_size}
+, samples_ {}
+{
+    assert(bin_size_ > 0);
+    for (const auto& sample : reads.extract_samples()) {
+        samples_[sample].mapping_qualities.fill(0);
+    }
+    std::unordered_map<SampleName, std::vector<std::uint64_t>> aligned_bases {};
+    for (const auto& contig : reads.reference_contigs()) {
+        const auto contig_size = reads.reference_size(contig);
+        if (contig_size == 0) continue;
+        const auto contig_bins = num_bins(contig_size, bin_size_);
+        for (auto& p : samples_) {
+            p.second.contig_bins[contig].assign(contig_bins, Bin {0, 0});
+            aligned_bases[p.first].assign(contig_bins, 0);
+        }
+        const SampleName* prev_sample {nullptr};
+        SampleIndex* sample_index {nullptr};
+        std::vector<Bin>* bins {nullptr};
+        std::vector<std::uint64_t>* bases {nullptr};
+        reads.iterate(GenomicRegion {contig, 0, contig_size}, [&] (const SampleName& sample, AlignedRead read) {
+            if (read.is_marked_unmapped()) return true;
+            if (!prev_sample || sample != *prev_sample) {
+                const auto sample_itr = samples_.find(sample);
+                if (sample_itr == std::end(samples_)) return true;
+                sample_index = &sample_itr->second;
+                bins = &sample_index->contig_bins.at(contig);
+                bases = &aligned_bases.at(sample);
+                prev_sample = &sample_itr->first;
+            }
+            ++sample_index->mapping_qualities[read.mapping_quality()];
+            const auto read_begin = std::min(read.mapped_region().begin(), contig_size - 1);
+            const auto read_end = std::min(read.mapped_region().end(), contig_size);
+            ++(*bins)[read_begin / bin_size_].num_reads;
+            for (auto bin_idx = read_begin / bin_size_; bin_idx * bin_size_ < read_end; ++bin_idx) {
+                const auto bin_begin = bin_idx * bin_size_;
+                (*bases)[bin_idx] += std::min(read_end, bin_begin + bin_size_) - std::max(read_begin, bin_begin);
+            }
+            return true;
+        });
+        for (auto& p : samples_) {
+            auto& bins = p.second.contig_bins[contig];
+            const auto& bases = aligned_bases[p.first];
+            for (std::size_t bin_idx {0}; bin_idx < bins.size(); ++bin_idx) {
+                const auto bin_begin = bin_idx * bin_size_;
+                const auto bin_length = std::min(bin_begin + bin_size_, contig_size) - bin_begin;
+                bins[bin_idx].mean_depth = static_cast<float>(bases[bin_idx]) / bin_length;
+            }
+        }
+    }
+}
+
+ReadDepthIndex::Path ReadDepthIndex::default_path(const Path& reads)
+{
+    return reads.string() + ".odi";
+}
+
+boost::optional<ReadDepthIndex> ReadDepthIndex::load(const Path& reads)
+{
+    const auto index_path = default_path(reads);
+    boost::system::error_code ec {};
+    if (!fs::exists(index_path, ec) || !fs::exists(reads, ec)) return boost::none;
+    std::ifstream file {index_path.string(), std::ios::binary};
+    if (!file) return boost::none;
+    char magic[sizeof(indexMagic)];
+    std::uint32_t version;
+    if (!file.read(magic, sizeof(magic)) || !std::equal(std::cbegin(magic), std::cend(magic), std::cbegin(indexMagic))
+        || !read_value(file, version) || version != indexVersion) {
+        return boost::none;
+    }
+    ReadDepthIndex result {};
+    std::uint64_t reads_file_size, bin_size;
+    std::uint32_t num_samples;
+    if (!read_value(file, reads_file_size) || !read_value(file, result.reads_last_write_time_)
+        || !read_value(file, bin_size) || !read_value(file, num_samples) || bin_size == 0) {
+        return boost::none;
+    }
+    result.reads_file_size_ = reads_file_size;
+    if (result.reads_file_size_ != fs::file_size(reads) || result.reads_last_write_time_ != get_last_write_time(reads)) {
+        return boost::none; // stale
+    }
+    result.bin_size_ = static_cast<GenomicRegion::Size>(bin_size);
+    try {
+        for (std::uint32_t s {0}; s < num_samples; ++s) {
+            SampleName sample;
+            if (!read_string(file, sample)) return boost::none;
+            auto& sample_index = result.samples_[sample];
+            std::uint32_t num_contigs;
+            if (!read_value(file, sample_index.mapping_qualities) || !read_value(file, num_contigs)) return boost::none;
+            for (std::uint32_t c {0}; c < num_contigs; ++c) {
+                GenomicRegion::ContigName contig;
+                std::uint64_t contig_bins;
+                if (!read_string(file, contig) || !read_value(file, contig_bins)) return boost::none;
+                auto& bins = sample_index.contig_bins[contig];
+                bins.resize(contig_bins);
+                if (!file.read(reinterpret_cast<char*>(bins.data()), contig_bins * sizeof(Bin))) return boost::none;
+            }
+        }
+    } catch (const std::exception&) {
+        return boost::none; // corrupted sizes
+    }
+    return result;
+}
+
+void ReadDepthIndex::write(const Path& reads) const
+{
+    static_assert(std::is_trivially_copyable<Bin>::value, "");
+    const auto index_path = default_path(reads);
+    const auto tmp_path = Path {index_path.string() + ".tmp"};
+    {
+        std::ofstream file {tmp_path.string(), std::ios::binary | std::ios::trunc};
+        if (!file) throw UnwritableReadDepthIndex {index_path};
+        file.write(indexMagic, sizeof(indexMagic));
+        write_value(file, indexVersion);
+        write_value(file, static_cast<std::uint64_t>(reads_file_size_));
+        write_value(file, reads_last_write_time_);
+        write_value(file, static_cast<std::uint64_t>(bin_size_));
+        write_value(file, static_cast<std::uint32_t>(samples_.size()));
+        for (const auto& p : samples_) {
+            write_string(file, p.first);
+            write_value(file, p.second.mapping_qualities);
+            write_value(file, static_cast<std::uint32_t>(p.second.contig_bins.size()));
+            for (const auto& contig_bins : p.second.contig_bins) {
+                write_string(file, contig_bins.first);
+                write_value(file, static_cast<std::uint64_t>(contig_bins.second.size()));
+                file.write(reinterpret_cast<const char*>(contig_bins.second.data()), contig_bins.second.size() * sizeof(Bin));
+            }
+        }
+        if (!file.flush()) throw UnwritableReadDepthIndex {index_path};
+    }
+    // Renaming means a concurrent load never sees a partially written index
+    fs::rename(tmp_path, index_path);
+}
+
+GenomicRegion::Size ReadDepthIndex::bin_size() const noexcept
+{
+    return bin_size_;
+}
+
+bool ReadDepthIndex::contains(const SampleName& sample) const noexcept
+{
+    return samples_.count(sample) == 1;
+}
+
+std::size_t ReadDepthIndex::estimate_read_count(const SampleName& sample, const GenomicRegion& region) const
+{
+    const auto bins = find_bins(sample, region.contig_name());
+    if (!bins || is_empty(region)) return 0;
+    double result {0};
+    const auto last_bin_idx = std::min((region.end() - 1) / bin_size_ + 1, static_cast<GenomicRegion::Size>(bins->size()));
+    for (auto bin_idx = region.begin() / bin_size_; bin_idx < last_bin_idx; ++bin_idx) {
+        const auto bin_begin = bin_idx * bin_size_;
+        const auto overlap = std::min(region.end(), bin_begin + bin_size_) - std::max(region.begin(), bin_begin);
+        result += static_cast<double>((*bins)[bin_idx].num_reads) * overlap / bin_size_;
+    }
+    return static_cast<std::size_t>(std::round(result));
+}
+
+std::vector<float> ReadDepthIndex::mean_depths(const SampleName& sample, const GenomicRegion& region) const
+{
+    std::vector<float> result {};
+    const auto bins = find_bins(sample, region.contig_name());
+    if (!bins) return result;
+    const auto first_bin_idx = std::min(region.begin() / bin_size_, static_cast<GenomicRegion::Size>(bins->size()));
+    const auto last_bin_idx = std::min((std::max(region.end(), region.begin() + 1) - 1) / bin_size_ + 1,
+                                       static_cast<GenomicRegion::Size>(bins->size()));
+    result.reserve(last_bin_idx - first_bin_idx);
+    std::transform(std::next(std::cbegin(*bins), first_bin_idx), std::next(std::cbegin(*bins), last_bin_idx),
+                   std::back_inserter(result), [] (const Bin& bin) { return bin.mean_depth; });
+    return result;
+}
+
+const ReadDepthIndex::MappingQualityHistogram& ReadDepthIndex::mapping_quality_histogram(const SampleName& sample) const
+{
+    return samples_.at(sample).mapping_qualities;
+}
+
+// private methods
+
+const std::vector<ReadDepthIndex::Bin>*
+ReadDepthIndex::find_bins(const SampleName& sample, const GenomicRegion::ContigName& contig) const
+{
+    const auto sample_itr = samples_.find(sample);
+    if (sample_itr == std::cend(samples_)) return nullptr;
+    const auto contig_itr = sample_itr->second.contig_bins.find(contig);
+    if (contig_itr == std::cend(sample_itr->second.contig_bins)) return nullptr;
+    return &contig_itr->second;
+}
+
+} // namespace io
+} // namespace octopus
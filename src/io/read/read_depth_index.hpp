@@ -0,0 +1,97 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef read_depth_index_hpp
+#define read_depth_index_hpp
+
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include "basics/genomic_region.hpp"
+
+namespace octopus { namespace io {
+
+class ReadReader;
+
+// A ReadDepthIndex is a small sidecar of a read file that summarises each sample's reads in fixed
+// size bins along each reference contig (mean depth and the number of reads starting in the bin),
+// along with a histogram of mapping qualities. It lets read count estimates and depth profiles be
+// made without decoding reads. The summaries include all mapped reads, before any read filtering.
+//
+// The index records the size and modification time of the read file it was made from, and is
+// ignored if the read file has since changed. The index file is written in native byte order.
+class ReadDepthIndex
+{
+public:
+    using Path       = boost::filesystem::path;
+    using SampleName = std::string;
+
+    using MappingQualityHistogram = std::array<std::uint64_t, 256>;
+
+    struct Bin
+    {
+        float mean_depth;
+        std::uint32_t num_reads; // starting in the bin
+    };
+
+    static constexpr GenomicRegion::Size defaultBinSize {1000};
+
+    ReadDepthIndex() = default;
+
+    ReadDepthIndex(const ReadReader& reads, GenomicRegion::Size bin_size = defaultBinSize); // Scans all reads
+
+    ReadDepthIndex(const ReadDepthIndex&)            = default;
+    ReadDepthIndex& operator=(const ReadDepthIndex&) = default;
+    ReadDepthIndex(ReadDepthIndex&&)                 = default;
+    ReadDepthIndex& operator=(ReadDepthIndex&&)      = default;
+
+    ~ReadDepthIndex() = default;
+
+    static Path default_path(const Path& reads); // e.g. reads.bam -> reads.bam.odi
+
+    // Returns none if there is no index for the read file, or if the index is out of date or unreadable
+    static boost::optional<ReadDepthIndex> load(const Path& reads);
+
+    void write(const Path& reads) const; // Writes to default_path(reads)
+
+    GenomicRegion::Size bin_size() const noexcept;
+
+    bool contains(const SampleName& sample) const noexcept;
+
+    // Bins overlapping the region, with partial bins scaled by the fraction overlapped
+    std::size_t estimate_read_count(const SampleName& sample, const GenomicRegion& region) const;
+    // The mean depth of each bin overlapping the region
+    std::vector<float> mean_depths(const SampleName& sample, const GenomicRegion& region) const;
+    const MappingQualityHistogram& mapping_quality_histogram(const SampleName& sample) const;
+
+private:
+    using ContigBinMap = std::unordered_map<GenomicRegion::ContigName, std::vector<Bin>>;
+
+    struct SampleIndex
+    {
+        ContigBinMap contig_bins;
+        MappingQualityHistogram mapping_qualities;
+    };
+
+    std::uintmax_t reads_file_size_ = 0;
+    std::int64_t reads_last_write_time_ = 0;
+    GenomicRegion::Size bin_size_ = defaultBinSize;
+    std::unordered_map<SampleName, SampleIndex> samples_;
+
+    const std::vector<Bin>* find_bins(const SampleName& sample, const GenomicRegion::ContigName& contig) const;
+};
+
+} // namespace io
+
+using io::ReadDepthIndex;
+
+} // namespace octopus
+
+#endif
@@ -8,29 +8,39 @@
 #include <utility>
 #include <deque>
 #include <numeric>
+#include <functional>
+#include <future>
+#include <chrono>
 #include <cassert>
 
 #include <boost/filesystem/operations.hpp>
 
 #include "basics/aligned_read.hpp"
-#include "utils/append.hpp"
+#include "utils/free_memory.hpp"
 #include "utils/coverage_tracker.hpp"
 
 namespace octopus { namespace io {
 
-ReadManager::ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files)
+ReadManager::ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files,
+                         std::shared_ptr<HtslibDecodingContext> decoding_context,
+                         const unsigned num_fetch_threads, const unsigned num_setup_threads)
 : max_open_files_ {max_open_files}
+, decoding_context_ {std::move(decoding_context)}
 , num_files_ {static_cast<unsigned>(read_file_paths.size())}
 , all_readers_single_sample_ {true}
 , closed_readers_ {
     std::make_move_iterator(std::begin(read_file_paths)),
     std::make_move_iterator(std::end(read_file_paths))}
-, open_readers_ {FileSizeCompare {}}
+, open_readers_ {}
+, reader_recency_ {}
+, reader_slots_ {std::make_shared<ReaderSlots>()}
 , reader_paths_containing_sample_ {}
 , possible_regions_in_readers_ {}
+, depth_indices_ {}
 , samples_ {}
+, fetch_workers_ {num_fetch_threads > 0 ? std::make_unique<ThreadPool>(num_fetch_threads) : nullptr}
 {
-    setup_reader_samples_and_regions();
+    setup_reader_samples_and_regions(num_setup_threads);
     open_initial_files();
     samples_.reserve(reader_paths_containing_sample_.size());
     std::unordered_set<Path, PathHash> found {};
@@ -58,13 +68,18 @@ ReadManager::ReadManager(ReadManager&& other)
 {
     std::lock_guard<std::mutex> lock {other.mutex_};
     max_open_files_                 = std::move(other.max_open_files_);
+    decoding_context_               = std::move(other.decoding_context_);
     num_files_                      = std::move(other.num_files_);
     all_readers_single_sample_      = std::move(other.all_readers_single_sample_);
     closed_readers_                 = std::move(other.closed_readers_);
     open_readers_                   = std::move(other.open_readers_);
+    reader_recency_                 = std::move(other.reader_recency_);
+    reader_slots_                   = std::move(other.reader_slots_);
     reader_paths_containing_sample_ = std::move(other.reader_paths_containing_sample_);
     possible_regions_in_readers_    = std::move(other.possible_regions_in_readers_);
+    depth_indices_                  = std::move(other.depth_indices_);
     samples_                        = std::move(other.samples_);
+    fetch_workers_                  = std::move(other.fetch_workers_);
 }
 
 ReadManager& ReadManager::operator=(ReadManager&& other)
@@ -73,13 +88,18 @@ ReadManager& ReadManager::operator=(ReadManager&& other)
         std::unique_lock<std::mutex> lock_lhs {mutex_, std::defer_lock}, lock_rhs {other.mutex_, std::defer_lock};
         std::lock(lock_lhs, lock_rhs);
         max_open_files_                 = std::move(other.max_open_files_);
+        decoding_context_               = std::move(other.decoding_context_);
         num_files_                      = std::move(other.num_files_);
         all_readers_single_sample_      = std::move(other.all_readers_single_sample_);
         closed_readers_                 = std::move(other.closed_readers_);
         open_readers_                   = std::move(other.open_readers_);
+        reader_recency_                 = std::move(other.reader_recency_);
+        reader_slots_                   = std::move(other.reader_slots_);
         reader_paths_containing_sample_ = std::move(other.reader_paths_containing_sample_);
         possible_regions_in_readers_    = std::move(other.possible_regions_in_readers_);
+        depth_indices_                  = std::move(other.depth_indices_);
         samples_                        = std::move(other.samples_);
+        fetch_workers_                  = std::move(other.fetch_workers_);
     }
     return *this;
 }
@@ -91,30 +111,36 @@ void swap(ReadManager& lhs, ReadManager& rhs) noexcept
     std::lock_guard<std::mutex> lock_lhs {lhs.mutex_, std::adopt_lock}, lock_rhs {rhs.mutex_, std::adopt_lock};
     using std::swap;
     swap(lhs.max_open_files_,                 rhs.max_open_files_);
+    swap(lhs.decoding_context_,               rhs.decoding_context_);
     swap(lhs.num_files_,                      rhs.num_files_);
     swap(lhs.all_readers_single_sample_,             rhs.all_readers_single_sample_);
     swap(lhs.closed_readers_,                 rhs.closed_readers_);
     swap(lhs.open_readers_,                   rhs.open_readers_);
+    swap(lhs.reader_recency_,                 rhs.reader_recency_);
+    swap(lhs.reader_slots_,                   rhs.reader_slots_);
     swap(lhs.reader_paths_containing_sample_, rhs.reader_paths_containing_sample_);
     swap(lhs.possible_regions_in_readers_,    rhs.possible_regions_in_readers_);
+    swap(lhs.depth_indices_,                  rhs.depth_indices_);
     swap(lhs.samples_,                        rhs.samples_);
+    swap(lhs.fetch_workers_,                  rhs.fetch_workers_);
 }
 
 void ReadManager::close() const noexcept
 {
     std::lock_guard<std::mutex> lock {mutex_};
-    close_readers(num_files_);
+    close_readers();
 }
 
 bool ReadManager::good() const noexcept
 {
+    std::lock_guard<std::mutex> lock {mutex_};
     return std::all_of(std::cbegin(open_readers_), std::cend(open_readers_),
-                       [] (const auto& p) { return p.second.is_open(); });
+                       [] (const auto& p) { return p.second.reader->is_open(); });
 }
 
 unsigned ReadManager::num_files() const noexcept
 {
-    return static_cast<unsigned>(closed_readers_.size() + open_readers_.size());
+    return num_files_;
 }
 
 std::vector<ReadManager::Path> ReadManager::paths() const
@@ -170,6 +196,7 @@ unsigned ReadManager::drop_samples(std::vector<SampleName> samples)
     for (auto itr = std::cbegin(open_readers_); itr != std::cend(open_readers_); ) {
         if (remaining_reader_paths.count(itr->first) == 0) {
             dropped_reader_paths.insert(itr->first);
+            reader_recency_.erase(itr->second.recency);
             itr = open_readers_.erase(itr);
             ++num_new_spaces;
         } else {
@@ -186,6 +213,7 @@ unsigned ReadManager::drop_samples(std::vector<SampleName> samples)
     }
     for (const auto& path : dropped_reader_paths) {
         possible_regions_in_readers_.erase(path);
+        depth_indices_.erase(path);
     }
     possible_regions_in_readers_.rehash(possible_regions_in_readers_.size());
     if (num_new_spaces > 0 && !closed_readers_.empty()) {
@@ -244,22 +272,10 @@ bool ReadManager::has_reads(const std::vector<SampleName>& samples, const Genomi
 {
     if (all_readers_are_open()) {
         return std::any_of(std::cbegin(open_readers_), std::cend(open_readers_),
-                           [&] (const auto& p) { return p.second.has_reads(samples, region); });
+                           [&] (const auto& p) { return p.second.reader->has_reads(samples, region); });
     } else {
-        std::lock_guard<std::mutex> lock {mutex_};
-        auto reader_paths = get_reader_paths_containing_samples(samples);
-        auto reader_itr = partition_open(reader_paths);
-        while (!reader_paths.empty()) {
-            if (std::any_of(reader_itr, end(reader_paths),
-                            [this, &region, &samples] (const auto& reader_path) {
-                                return open_readers_.at(reader_path).has_reads(samples, region);
-                            })) {
-                return true;
-            }
-            reader_paths.erase(reader_itr, end(reader_paths));
-            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
-        }
-        return false;
+        return !for_each_reader(get_possible_reader_paths(samples, region),
+                                [&] (const ReadReader& reader) { return !reader.has_reads(samples, region); });
     }
 }
 
@@ -267,22 +283,10 @@ bool ReadManager::has_reads(const GenomicRegion& region) const
 {
     if (all_readers_are_open()) {
         return std::any_of(std::cbegin(open_readers_), std::cend(open_readers_),
-                           [&] (const auto& p) { return p.second.has_reads(region); });
+                           [&] (const auto& p) { return p.second.reader->has_reads(region); });
     } else {
-        std::lock_guard<std::mutex> lock {mutex_};
-        auto reader_paths = get_reader_paths_containing_samples(samples());
-        auto reader_itr = partition_open(reader_paths);
-        while (!reader_paths.empty()) {
-            if (std::any_of(reader_itr, end(reader_paths),
-                            [this, &region] (const auto& reader_path) {
-                                return open_readers_.at(reader_path).has_reads(region);
-                            })) {
-                return true;
-            }
-            reader_paths.erase(reader_itr, end(reader_paths));
-            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
-        }
-        return false;
+        return !for_each_reader(get_possible_reader_paths(samples(), region),
+                                [&] (const ReadReader& reader) { return !reader.has_reads(region); });
     }
 }
 
@@ -291,21 +295,14 @@ std::size_t ReadManager::count_reads(const SampleName& sample, const GenomicRegi
     if (all_readers_are_open()) {
         return std::accumulate(std::cbegin(open_readers_), std::cend(open_readers_), std::size_t {0},
                                [&] (std::size_t curr, const auto& p) {
-                                   return curr + p.second.count_reads(sample, region);
+                                   return curr + p.second.reader->count_reads(sample, region);
                                });
     } else {
-        std::lock_guard<std::mutex> lock {mutex_};
-        auto reader_paths = get_possible_reader_paths({sample}, region);
-        auto reader_itr = partition_open(reader_paths);
         std::size_t result {0};
-        while (!reader_paths.empty()) {
-            using std::begin; using std::end; using std::for_each;
-            for_each(reader_itr, end(reader_paths), [this, &sample, &region, &result] (const auto& reader_path) {
-                result += open_readers_.at(reader_path).count_reads(sample, region);
-            });
-            reader_paths.erase(reader_itr, end(reader_paths));
-            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
-        }
+        for_each_reader(get_possible_reader_paths({sample}, region), [&] (const ReadReader& reader) {
+            result += reader.count_reads(sample, region);
+            return true;
+        });
         return result;
     }
 }
@@ -315,21 +312,14 @@ std::size_t ReadManager::count_reads(const std::vector<SampleName>& samples, con
     if (all_readers_are_open()) {
         return std::accumulate(std::cbegin(open_readers_), std::cend(open_readers_), std::size_t {0},
                                [&] (std::size_t curr, const auto& p) {
-                                   return curr + p.second.count_reads(samples, region);
+                                   return curr + p.second.reader->count_reads(samples, region);
                                });
     } else {
-        std::lock_guard<std::mutex> lock {mutex_};
-        auto reader_paths = get_possible_reader_paths(samples, region);
-        auto reader_itr = partition_open(reader_paths);
         std::size_t result {0};
-        while (!reader_paths.empty()) {
-            using std::begin; using std::end; using std::for_each;
-            for_each(reader_itr, end(reader_paths), [this, &samples, &region, &result] (const auto& reader_path) {
-                result += open_readers_.at(reader_path).count_reads(samples, region);
-            });
-            reader_paths.erase(reader_itr, end(reader_paths));
-            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
-        }
+        for_each_reader(get_possible_reader_paths(samples, region), [&] (const ReadReader& reader) {
+            result += reader.count_reads(samples, region);
+            return true;
+        });
         return result;
     }
 }
@@ -339,6 +329,82 @@ std::size_t ReadManager::count_reads(const GenomicRegion& region) const
     return count_reads(samples(), region);
 }
 
+std::size_t ReadManager::estimate_read_count(const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    std::size_t result {0};
+    std::vector<Path> unindexed_reader_paths {};
+    for (const auto& reader_path : get_possible_reader_paths(samples, region)) {
+        const auto indexed_estimate = estimate_indexed_read_count(reader_path, samples, region);
+        if (indexed_estimate) {
+            result += *indexed_estimate;
+        } else {
+            unindexed_reader_paths.push_back(reader_path);
+        }
+    }
+    for_each_reader(std::move(unindexed_reader_paths), [&] (const ReadReader& reader) {
+        const auto reader_estimate = reader.estimate_read_count(region);
+        result += reader_estimate ? *reader_estimate : reader.count_reads(samples, region);
+        return true;
+    });
+    return result;
+}
+
+boost::optional<GenomicRegion::Size> ReadManager::depth_index_bin_size(const SampleName& sample) const
+{
+    const auto indices = get_depth_indices(sample);
+    if (indices.empty()) return boost::none;
+    const auto result = indices.front()->bin_size();
+    if (std::any_of(std::cbegin(indices), std::cend(indices),
+                    [=] (const ReadDepthIndex* index) { return index->bin_size() != result; })) {
+        return boost::none;
+    }
+    return result;
+}
+
+boost::optional<std::vector<float>>
+ReadManager::indexed_mean_depths(const SampleName& sample, const GenomicRegion& region) const
+{
+    if (!depth_index_bin_size(sample)) return boost::none;
+    const auto indices = get_depth_indices(sample);
+    auto result = indices.front()->mean_depths(sample, region);
+    std::for_each(std::next(std::cbegin(indices)), std::cend(indices), [&] (const ReadDepthIndex* index) {
+        const auto depths = index->mean_depths(sample, region);
+        if (depths.size() > result.size()) result.resize(depths.size(), 0);
+        std::transform(std::cbegin(depths), std::cend(depths), std::cbegin(result), std::begin(result), std::plus<> {});
+    });
+    return result;
+}
+
+boost::optional<ReadDepthIndex::MappingQualityHistogram>
+ReadManager::indexed_mapping_qualities(const SampleName& sample) const
+{
+    const auto indices = get_depth_indices(sample);
+    if (indices.empty()) return boost::none;
+    ReadDepthIndex::MappingQualityHistogram result {};
+    for (const auto index : indices) {
+        const auto& histogram = index->mapping_quality_histogram(sample);
+        std::transform(std::cbegin(histogram), std::cend(histogram), std::cbegin(result), std::begin(result), std::plus<> {});
+    }
+    return result;
+}
+
+void ReadManager::advise_access(const std::vector<SampleName>& samples, const std::vector<GenomicRegion>& regions) const
+{
+    if (regions.empty()) return;
+    // Closed readers aren't opened just to be advised, as that could evict readers in use
+    std::vector<ReaderHandle> readers {};
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        for (const auto& reader_path : get_possible_reader_paths(samples, regions)) {
+            const auto reader_itr = open_readers_.find(reader_path);
+            if (reader_itr != std::cend(open_readers_)) readers.push_back(reader_itr->second.reader);
+        }
+    }
+    for (const auto& reader : readers) {
+        reader->advise_access(regions);
+    }
+}
+
 GenomicRegion ReadManager::find_covered_subregion(const SampleName& sample, const GenomicRegion& region,
                                                   const std::size_t max_reads) const
 {
@@ -387,32 +453,29 @@ GenomicRegion ReadManager::find_covered_subregion(const std::vector<SampleName>&
                                                   const std::size_t max_reads) const
 {
     if (samples.empty() || is_empty(region)) return region;
+    // Index estimates are only trusted when they are well clear of the limit, as they are rough
+    const auto estimated_reads = try_estimate_read_count(samples, region);
+    if (estimated_reads && *estimated_reads <= max_reads / 2) return region;
     CoverageTracker<ContigRegion> position_tracker {};
     if (all_readers_are_open()) {
         for (const auto& p : open_readers_) {
             if (can_use_reader(p.first, samples, region)) {
                 // Request one more than the max so we can determine if the entire request region can be included
-                const auto positions = p.second.extract_read_positions(samples, region, max_reads + 1);
+                const auto positions = p.second.reader->extract_read_positions(samples, region, max_reads + 1);
                 for (auto position : positions) {
                     add(position, position_tracker);
                 }
             }
         }
     } else {
-        std::lock_guard<std::mutex> lock {mutex_};
-        auto reader_paths = get_possible_reader_paths(samples, region);
-        auto reader_itr = partition_open(reader_paths);
-        while (!reader_paths.empty()) {
-            std::for_each(reader_itr, end(reader_paths), [&] (const auto& reader_path) {
-                // Request one more than the max so we can determine if the entire request region can be included
-                const auto positions = open_readers_.at(reader_path).extract_read_positions(samples, region, max_reads + 1);
-                for (auto position : positions) {
-                    add(position, position_tracker);
-                }
-            });
-            reader_paths.erase(reader_itr, end(reader_paths));
-            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
-        }
+        for_each_reader(get_possible_reader_paths(samples, region), [&] (const ReadReader& reader) {
+            // Request one more than the max so we can determine if the entire request region can be included
+            const auto positions = reader.extract_read_positions(samples, region, max_reads + 1);
+            for (auto position : positions) {
+                add(position, position_tracker);
+            }
+            return true;
+        });
     }
     return max_head_region(position_tracker, region, max_reads);
 }
@@ -424,38 +487,89 @@ GenomicRegion ReadManager::find_covered_subregion(const GenomicRegion& region, c
 
 namespace {
 
+// Merges the sorted parts into one sorted container. Reads that compare equal are kept in part order.
 template <typename Container>
-void merge_insert(Container&& src, Container& dst)
+Container merge_sorted(std::vector<Container>& parts)
 {
-    auto itr = octopus::utils::append(std::move(src), dst);
-    std::inplace_merge(std::begin(dst), itr, std::end(dst));
+    parts.erase(std::remove_if(std::begin(parts), std::end(parts), [] (const auto& part) { return part.empty(); }), std::end(parts));
+    if (parts.empty()) return {};
+    if (parts.size() == 1) return std::move(parts.front());
+    Container result {};
+    result.reserve(std::accumulate(std::cbegin(parts), std::cend(parts), std::size_t {0},
+                                   [] (auto total, const auto& part) { return total + part.size(); }));
+    if (parts.size() == 2) {
+        std::merge(std::make_move_iterator(std::begin(parts[0])), std::make_move_iterator(std::end(parts[0])),
+                   std::make_move_iterator(std::begin(parts[1])), std::make_move_iterator(std::end(parts[1])),
+                   std::back_inserter(result));
+    } else {
+        using Iterator = typename Container::iterator;
+        struct Cursor { Iterator next, last; std::size_t part; };
+        std::vector<Cursor> heap {};
+        heap.reserve(parts.size());
+        for (std::size_t part {0}; part < parts.size(); ++part) {
+            heap.push_back({std::begin(parts[part]), std::end(parts[part]), part});
+        }
+        const auto after = [] (const Cursor& lhs, const Cursor& rhs) {
+            return *rhs.next < *lhs.next || (!(*lhs.next < *rhs.next) && rhs.part < lhs.part);
+        };
+        std::make_heap(std::begin(heap), std::end(heap), after);
+        while (!heap.empty()) {
+            std::pop_heap(std::begin(heap), std::end(heap), after);
+            auto& cursor = heap.back();
+            result.push_back(std::move(*cursor.next));
+            if (++cursor.next == cursor.last) {
+                heap.pop_back();
+            } else {
+                std::push_heap(std::begin(heap), std::end(heap), after);
+            }
+        }
+    }
+    for (auto& part : parts) free_memory(part);
+    return result;
+}
+
+template <typename SampleReadMap, typename SampleReadParts>
+void add_parts(SampleReadMap&& reads, SampleReadParts& parts)
+{
+    for (auto&& r : reads) {
+        if (!r.second.empty()) parts[r.first].push_back(std::move(r.second));
+    }
+}
+
+template <typename SampleReadParts, typename SampleReadMap>
+void merge_parts(SampleReadParts& parts, SampleReadMap& result)
+{
+    for (auto& p : parts) {
+        result.at(p.first) = merge_sorted(p.second);
+    }
 }
 
 } // namespace
 
 ReadManager::ReadContainer ReadManager::fetch_reads(const SampleName& sample, const GenomicRegion& region) const
 {
-    ReadContainer result {};
+    std::vector<ReadContainer> parts {};
     if (all_readers_are_open()) {
+        std::vector<Path> reader_paths {};
         for (const auto& p : open_readers_) {
-            if (can_use_reader(p.first, {sample}, region)) {
-                merge_insert(p.second.fetch_reads(sample, region), result);
-            }
+            if (can_use_reader(p.first, {sample}, region)) reader_paths.push_back(p.first);
         }
-    } else {
-        std::lock_guard<std::mutex> lock {mutex_};
-        auto reader_paths = get_possible_reader_paths({sample}, region);
-        auto reader_itr = partition_open(reader_paths);
-        while (!reader_paths.empty()) {
-            using std::begin; using std::end; using std::make_move_iterator; using std::for_each;
-            for_each(reader_itr, end(reader_paths), [&] (const auto& reader_path) {
-                merge_insert(open_readers_.at(reader_path).fetch_reads(sample, region), result);
-            });
-            reader_paths.erase(reader_itr, end(reader_paths));
-            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
+        if (can_fetch_in_parallel(reader_paths.size())) {
+            SampleReadParts sample_parts {};
+            fetch_in_parallel(reader_paths, [&] (const ReadReader& reader) {
+                return SampleReadMap {{sample, reader.fetch_reads(sample, region)}}; }, sample_parts);
+            return merge_sorted(sample_parts[sample]);
+        }
+        for (const auto& reader_path : reader_paths) {
+            parts.push_back(open_readers_.at(reader_path).reader->fetch_reads(sample, region));
         }
+    } else {
+        for_each_reader(get_possible_reader_paths({sample}, region), [&] (const ReadReader& reader) {
+            parts.push_back(reader.fetch_reads(sample, region));
+            return true;
+        });
     }
-    return result;
+    return merge_sorted(parts);
 }
 
 ReadManager::SampleReadMap ReadManager::fetch_reads(const std::vector<SampleName>& samples, const GenomicRegion& region) const
@@ -465,35 +579,28 @@ ReadManager::SampleReadMap ReadManager::fetch_reads(const std::vector<SampleName
     for (const auto& sample : samples) {
         result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
     }
+    SampleReadParts parts {};
+    if (all_readers_are_open() && fetch_workers_) {
+        const auto reader_paths = get_possible_reader_paths(samples, region);
+        if (can_fetch_in_parallel(reader_paths.size())) {
+            fetch_in_parallel(reader_paths, [&] (const ReadReader& reader) { return reader.fetch_reads(samples, region); }, parts);
+            merge_parts(parts, result);
+            return result;
+        }
+    }
     if (all_readers_are_open()) {
         for (const auto& p : open_readers_) {
             if (can_use_reader(p.first, samples, region)) {
-                auto reads = p.second.fetch_reads(samples, region);
-                for (auto&& r : reads) {
-                    merge_insert(std::move(r.second), result.at(r.first));
-                    r.second.clear();
-                    r.second.shrink_to_fit();
-            }
+                add_parts(p.second.reader->fetch_reads(samples, region), parts);
             }
         }
     } else {
-        std::lock_guard<std::mutex> lock {mutex_};
-        auto reader_paths = get_possible_reader_paths(samples, region);
-        auto reader_itr = partition_open(reader_paths);
-        while (!reader_paths.empty()) {
-            using std::begin; using std::end; using std::make_move_iterator; using std::for_each;
-            for_each(reader_itr, end(reader_paths), [&] (const auto& reader_path) {
-                auto reads = open_readers_.at(reader_path).fetch_reads(samples, region);
-                for (auto&& r : reads) {
-                    merge_insert(std::move(r.second), result.at(r.first));
-                    r.second.clear();
-                    r.second.shrink_to_fit();
-                }
-            });
-            reader_paths.erase(reader_itr, end(reader_paths));
-            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
-        }
+        for_each_reader(get_possible_reader_paths(samples, region), [&] (const ReadReader& reader) {
+            add_parts(reader.fetch_reads(samples, region), parts);
+            return true;
+        });
     }
+    merge_parts(parts, result);
     return result;
 }
 
@@ -504,25 +611,25 @@ ReadManager::SampleReadMap ReadManager::fetch_reads(const GenomicRegion& region)
 
 ReadManager::ReadContainer ReadManager::fetch_reads(const SampleName& sample, const std::vector<GenomicRegion>& regions) const
 {
-    ReadContainer result {};
+    std::vector<ReadContainer> parts {};
     if (all_readers_are_open()) {
+        const auto reader_paths = get_possible_reader_paths({sample}, regions);
+        if (can_fetch_in_parallel(reader_paths.size())) {
+            SampleReadParts sample_parts {};
+            fetch_in_parallel(reader_paths, [&] (const ReadReader& reader) {
+                return SampleReadMap {{sample, reader.fetch_reads(sample, regions)}}; }, sample_parts);
+            return merge_sorted(sample_parts[sample]);
+        }
         for (const auto& p : open_readers_) {
-            merge_insert(p.second.fetch_reads(sample, regions), result);
+            parts.push_back(p.second.reader->fetch_reads(sample, regions));
         }
     } else {
-        std::lock_guard<std::mutex> lock {mutex_};
-        auto reader_paths = get_possible_reader_paths({sample}, regions);
-        auto reader_itr = partition_open(reader_paths);
-        while (!reader_paths.empty()) {
-            using std::begin; using std::end; using std::make_move_iterator; using std::for_each;
-            for_each(reader_itr, end(reader_paths), [&] (const auto& reader_path) {
-                merge_insert(open_readers_.at(reader_path).fetch_reads(sample, regions), result);
-            });
-            reader_paths.erase(reader_itr, end(reader_paths));
-            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
-        }
+        for_each_reader(get_possible_reader_paths({sample}, regions), [&] (const ReadReader& reader) {
+            parts.push_back(reader.fetch_reads(sample, regions));
+            return true;
+        });
     }
-    return result;
+    return merge_sorted(parts);
 }
 
 ReadManager::SampleReadMap ReadManager::fetch_reads(const std::vector<SampleName>& samples, const std::vector<GenomicRegion>& regions) const
@@ -532,33 +639,26 @@ ReadManager::SampleReadMap ReadManager::fetch_reads(const std::vector<SampleName
     for (const auto& sample : samples) {
         result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
     }
+    SampleReadParts parts {};
+    if (all_readers_are_open() && fetch_workers_) {
+        const auto reader_paths = get_possible_reader_paths(samples, regions);
+        if (can_fetch_in_parallel(reader_paths.size())) {
+            fetch_in_parallel(reader_paths, [&] (const ReadReader& reader) { return reader.fetch_reads(samples, regions); }, parts);
+            merge_parts(parts, result);
+            return result;
+        }
+    }
     if (all_readers_are_open()) {
         for (const auto& p : open_readers_) {
-            auto reads = p.second.fetch_reads(samples, regions);
-            for (auto&& r : reads) {
-                merge_insert(std::move(r.second), result.at(r.first));
-                r.second.clear();
-                r.second.shrink_to_fit();
-            }
+            add_parts(p.second.reader->fetch_reads(samples, regions), parts);
         }
     } else {
-        std::lock_guard<std::mutex> lock {mutex_};
-        auto reader_paths = get_possible_reader_paths(samples, regions);
-        auto reader_itr = partition_open(reader_paths);
-        while (!reader_paths.empty()) {
-            using std::begin; using std::end; using std::make_move_iterator; using std::for_each;
-            for_each(reader_itr, end(reader_paths), [&] (const auto& reader_path) {
-                auto reads = open_readers_.at(reader_path).fetch_reads(samples, regions);
-                for (auto&& r : reads) {
-                    merge_insert(std::move(r.second), result.at(r.first));
-                    r.second.clear();
-                    r.second.shrink_to_fit();
-                }
-            });
-            reader_paths.erase(reader_itr, end(reader_paths));
-            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
-        }
+        for_each_reader(get_possible_reader_paths(samples, regions), [&] (const ReadReader& reader) {
+            add_parts(reader.fetch_reads(samples, regions), parts);
+            return true;
+        });
     }
+    merge_parts(parts, result);
     return result;
 }
 
@@ -567,6 +667,38 @@ ReadManager::SampleReadMap ReadManager::fetch_reads(const std::vector<GenomicReg
     return fetch_reads(samples(), regions);
 }
 
+ReadManager::SampleReadMap ReadManager::fetch_reads(const std::vector<SampleName>& samples, const GenomicRegion& region,
+                                                    const ReadRegionFilter& filter) const
+{
+    SampleReadMap result {samples.size()};
+    for (const auto& sample : samples) {
+        result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
+    }
+    SampleReadParts parts {};
+    for_each_reader(get_possible_reader_paths(samples, region), [&] (const ReadReader& reader) {
+        add_parts(reader.fetch_reads(samples, region, filter), parts);
+        return true;
+    });
+    merge_parts(parts, result);
+    return result;
+}
+
+ReadManager::SampleReadMap ReadManager::fetch_reads(const std::vector<SampleName>& samples, const std::vector<GenomicRegion>& regions,
+                                                    const ReadRegionFilter& filter) const
+{
+    SampleReadMap result {samples.size()};
+    for (const auto& sample : samples) {
+        result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
+    }
+    SampleReadParts parts {};
+    for_each_reader(get_possible_reader_paths(samples, regions), [&] (const ReadReader& reader) {
+        add_parts(reader.fetch_reads(samples, regions, filter), parts);
+        return true;
+    });
+    merge_parts(parts, result);
+    return result;
+}
+
 // Private methods
 
 bool ReadManager::FileSizeCompare::operator()(const Path& lhs, const Path& rhs) const
@@ -589,38 +721,93 @@ auto extract_spanning_regions(std::vector<GenomicRegion::ContigName> contigs,
 
 } // namespace
 
-void ReadManager::setup_reader_samples_and_regions()
+namespace {
+
+struct ReaderSummary
+{
+    std::vector<GenomicRegion> possible_regions;
+    std::vector<ReadManager::SampleName> samples;
+    boost::optional<ReadDepthIndex> depth_index;
+};
+
+auto summarise(const ReadReader& reader, const ReadManager::Path& reader_path)
 {
-    for (const auto& reader_path : closed_readers_) {
-        auto reader = make_reader(reader_path);
-        auto possible_reader_regions = reader.mapped_regions();
-        if (possible_reader_regions) {
-            add_possible_regions_to_reader_map(reader_path, *possible_reader_regions);
+    ReaderSummary result {};
+    auto possible_reader_regions = reader.mapped_regions();
+    if (possible_reader_regions) {
+        result.possible_regions = std::move(*possible_reader_regions);
+    } else {
+        auto possible_reader_contigs = reader.mapped_contigs();
+        if (possible_reader_contigs) {
+            result.possible_regions = extract_spanning_regions(std::move(*possible_reader_contigs), reader);
         } else {
-            auto possible_reader_contigs = reader.mapped_contigs();
-            if (possible_reader_contigs) {
-                add_possible_regions_to_reader_map(reader_path, extract_spanning_regions(*possible_reader_contigs, reader));
-            } else {
-                add_possible_regions_to_reader_map(reader_path, extract_spanning_regions(reader.reference_contigs(), reader));
+            result.possible_regions = extract_spanning_regions(reader.reference_contigs(), reader);
+        }
+    }
+    result.samples = reader.extract_samples();
+    result.depth_index = ReadDepthIndex::load(reader_path);
+    return result;
+}
+
+} // namespace
+
+void ReadManager::setup_reader_samples_and_regions(const unsigned num_threads)
+{
+    const std::vector<Path> reader_paths {std::cbegin(closed_readers_), std::cend(closed_readers_)};
+    std::vector<ReaderSummary> summaries(reader_paths.size());
+    if (num_threads > 1 && reader_paths.size() > 1) {
+        // Opening a file mostly waits on I/O (especially for remote files), so inspect files concurrently.
+        // The readers that open_initial_files would open anyway are kept rather than opened twice, leaving
+        // room under max_open_files for the readers the workers have open.
+        ThreadPool workers {std::min(static_cast<std::size_t>(num_threads), reader_paths.size())};
+        std::vector<Path> initial_reader_paths {reader_paths};
+        const auto num_initial = std::min(initial_reader_paths.size(),
+                                          static_cast<std::size_t>(max_open_files_ > workers.size() ? max_open_files_ - workers.size() : 0));
+        const auto nth = std::next(std::begin(initial_reader_paths), num_initial);
+        std::nth_element(std::begin(initial_reader_paths), nth, std::end(initial_reader_paths), FileSizeCompare {});
+        const std::unordered_set<Path, PathHash> initial_readers {std::begin(initial_reader_paths), nth};
+        std::vector<std::future<ReaderHandle>> inspections {};
+        inspections.reserve(reader_paths.size());
+        for (std::size_t i {0}; i < reader_paths.size(); ++i) {
+            inspections.push_back(workers.push([&, i] () -> ReaderHandle {
+                auto reader = make_reader(reader_paths[i]);
+                summaries[i] = summarise(reader, reader_paths[i]);
+                if (initial_readers.count(reader_paths[i]) == 1 && try_reserve_reader_slot()) {
+                    return make_reader_handle(std::move(reader));
+                }
+                return nullptr;
+            }));
+        }
+        try {
+            for (std::size_t i {0}; i < reader_paths.size(); ++i) {
+                auto reader = inspections[i].get();
+                if (reader) insert_reader(reader_paths[i], std::move(reader));
+            }
+        } catch (...) {
+            for (auto& inspection : inspections) {
+                if (inspection.valid()) inspection.wait(); // the workers reference local state
             }
+            throw;
         }
-        add_reader_to_sample_map(reader_path, reader.extract_samples());
+    } else {
+        std::transform(std::cbegin(reader_paths), std::cend(reader_paths), std::begin(summaries),
+                       [this] (const Path& reader_path) { return summarise(make_reader(reader_path), reader_path); });
+    }
+    for (std::size_t i {0}; i < reader_paths.size(); ++i) {
+        add_possible_regions_to_reader_map(reader_paths[i], summaries[i].possible_regions);
+        add_reader_to_sample_map(reader_paths[i], summaries[i].samples);
+        if (summaries[i].depth_index) depth_indices_.emplace(reader_paths[i], std::move(*summaries[i].depth_index));
     }
 }
 
 void ReadManager::open_initial_files()
 {
-    using std::begin; using std::end; using std::cbegin; using std::cend;
-    std::vector<Path> reader_paths {cbegin(closed_readers_), cend(closed_readers_)};
-    auto num_files_to_open = std::min(max_open_files_, static_cast<unsigned>(closed_readers_.size()));
-    std::nth_element(begin(reader_paths), begin(reader_paths) + num_files_to_open, end(reader_paths),
-                     FileSizeCompare {});
-    open_readers(begin(reader_paths), begin(reader_paths) + num_files_to_open);
+    open_readers(max_open_files_ - static_cast<unsigned>(open_readers_.size()));
 }
 
 ReadReader ReadManager::make_reader(const Path& reader_path) const
 {
-    return ReadReader {reader_path};
+    return ReadReader {reader_path, decoding_context_};
 }
 
 bool ReadManager::all_readers_are_open() const noexcept
@@ -634,48 +821,80 @@ bool ReadManager::is_open(const Path& reader_path) const noexcept
     return open_readers_.count(reader_path) == 1;
 }
 
-std::vector<ReadManager::Path>::iterator ReadManager::partition_open(std::vector<Path>& reader_paths) const
+boost::optional<std::size_t>
+ReadManager::try_estimate_read_count(const std::vector<SampleName>& samples, const GenomicRegion& region) const
 {
-    return std::partition(std::begin(reader_paths), std::end(reader_paths),
-                          [this] (const Path& path) { return !is_open(path); });
+    std::size_t result {0};
+    std::vector<Path> unindexed_reader_paths {};
+    for (const auto& reader_path : get_possible_reader_paths(samples, region)) {
+        const auto indexed_estimate = estimate_indexed_read_count(reader_path, samples, region);
+        if (indexed_estimate) {
+            result += *indexed_estimate;
+        } else {
+            unindexed_reader_paths.push_back(reader_path);
+        }
+    }
+    const auto estimate = [&] (const ReadReader& reader) {
+        const auto reader_estimate = reader.estimate_read_count(region);
+        if (reader_estimate) result += *reader_estimate;
+        return static_cast<bool>(reader_estimate);
+    };
+    if (!for_each_reader(std::move(unindexed_reader_paths), estimate)) return boost::none;
+    return result;
 }
 
-unsigned ReadManager::num_open_readers() const noexcept
+boost::optional<std::size_t>
+ReadManager::estimate_indexed_read_count(const Path& reader_path, const std::vector<SampleName>& samples,
+                                         const GenomicRegion& region) const
 {
-    return static_cast<unsigned>(open_readers_.size());
+    const auto index_itr = depth_indices_.find(reader_path);
+    if (index_itr == std::cend(depth_indices_)) return boost::none;
+    std::size_t result {0};
+    for (const auto& sample : samples) {
+        if (index_itr->second.contains(sample)) {
+            result += index_itr->second.estimate_read_count(sample, region);
+        }
+    }
+    return result;
 }
 
-unsigned ReadManager::num_reader_spaces() const noexcept
+std::vector<const ReadDepthIndex*> ReadManager::get_depth_indices(const SampleName& sample) const
 {
-    return max_open_files_ - num_open_readers();
+    std::vector<const ReadDepthIndex*> result {};
+    const auto sample_reader_paths = reader_paths_containing_sample_.find(sample);
+    if (sample_reader_paths == std::cend(reader_paths_containing_sample_)) return result;
+    result.reserve(sample_reader_paths->second.size());
+    for (const auto& reader_path : sample_reader_paths->second) {
+        const auto index_itr = depth_indices_.find(reader_path);
+        if (index_itr == std::cend(depth_indices_) || !index_itr->second.contains(sample)) return {};
+        result.push_back(&index_itr->second);
+    }
+    return result;
 }
 
-void ReadManager::open_reader(const Path& reader_path) const
+bool ReadManager::can_fetch_in_parallel(const std::size_t num_readers) const noexcept
 {
-    if (num_open_readers() == max_open_files_) { // do we need this?
-        close_reader(choose_reader_to_close());
-    }
-    open_readers_.emplace(reader_path, make_reader(reader_path));
-    closed_readers_.erase(reader_path);
+    // Only when every reader is open, otherwise the fetches could open more files than allowed at once
+    return fetch_workers_ && num_readers > 1 && all_readers_are_open();
 }
 
-std::vector<ReadManager::Path>::iterator
-ReadManager::open_readers(std::vector<Path>::iterator first, std::vector<Path>::iterator last) const
+void ReadManager::fetch_in_parallel(const std::vector<Path>& reader_paths, const SampleReadMapFetcher& fetcher,
+                                    SampleReadParts& result) const
 {
-    if (first == last) return first;
-    auto num_available_spaces = num_reader_spaces();
-    auto num_requested_spaces = static_cast<unsigned>(std::distance(first, last));
-    if (num_requested_spaces <= num_available_spaces) {
-        std::for_each(first, last, [this] (const Path& path) { open_reader(path); });
-        return first;
+    assert(fetch_workers_);
+    std::vector<std::future<SampleReadMap>> fetches {};
+    fetches.reserve(reader_paths.size());
+    for (const auto& reader_path : reader_paths) {
+        auto reader = open_readers_.at(reader_path).reader;
+        fetches.push_back(fetch_workers_->push([reader = std::move(reader), &fetcher] () { return fetcher(*reader); }));
+    }
+    try {
+        // Parts are added in reader order so the merged reads do not depend on which fetch finishes first
+        for (auto& fetch : fetches) add_parts(fetch.get(), result);
+    } catch (...) {
+        for (auto& fetch : fetches) if (fetch.valid()) fetch.wait(); // the fetcher must outlive the pending fetches
+        throw;
     }
-    auto num_readers_to_close = std::min(num_open_readers(), num_requested_spaces - num_available_spaces);
-    close_readers(num_readers_to_close);
-    num_available_spaces += num_readers_to_close;
-    // partition range so opened readers come last
-    auto first_open = std::next(first, num_requested_spaces - num_available_spaces);
-    std::for_each(first_open, last, [this] (const Path& path) { open_reader(path); });
-    return first_open;
 }
 
 void ReadManager::open_readers(unsigned n) const
@@ -684,26 +903,128 @@ void ReadManager::open_readers(unsigned n) const
     std::vector<Path> closed_reader_paths {std::cbegin(closed_readers_), std::cend(closed_readers_)};
     const auto nth = std::next(std::begin(closed_reader_paths), n);
     std::nth_element(std::begin(closed_reader_paths), nth, std::end(closed_reader_paths), FileSizeCompare {});
-    open_readers(std::begin(closed_reader_paths), nth);
+    std::for_each(std::begin(closed_reader_paths), nth, [this] (const Path& path) {
+        if (try_reserve_reader_slot()) insert_reader(path, make_reader_handle(make_reader(path)));
+    });
 }
 
-void ReadManager::close_reader(const Path& reader_path) const
+ReadManager::ReaderHandle ReadManager::acquire_reader(const Path& reader_path) const
 {
-    // TODO: we can make use of IReadReaderImpl::close to avoid calling deconstructor on the file.
-    open_readers_.erase(reader_path);
-    closed_readers_.insert(reader_path);
+    const auto find_cached = [&] () -> ReaderHandle {
+        const auto itr = open_readers_.find(reader_path);
+        if (itr == std::cend(open_readers_)) return nullptr;
+        reader_recency_.splice(std::begin(reader_recency_), reader_recency_, itr->second.recency);
+        return itr->second.reader;
+    };
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        auto result = find_cached();
+        if (result) return result;
+    }
+    // Opening a file loads its header and index, so don't make other tasks wait for it
+    reserve_reader_slot();
+    boost::optional<ReadReader> opened {};
+    try {
+        opened.emplace(make_reader(reader_path));
+    } catch (...) {
+        release_reader_slot();
+        throw;
+    }
+    const auto reader = make_reader_handle(std::move(*opened));
+    std::lock_guard<std::mutex> lock {mutex_};
+    auto result = find_cached(); // another task may have opened it meanwhile
+    if (result) return result;
+    insert_reader(reader_path, reader);
+    return reader;
+}
+
+void ReadManager::insert_reader(const Path& reader_path, ReaderHandle reader) const
+{
+    while (!open_readers_.empty() && open_readers_.size() >= max_open_files_) {
+        evict_least_recent_reader();
+    }
+    reader_recency_.push_front(reader_path);
+    open_readers_.emplace(reader_path, OpenReader {std::move(reader), std::begin(reader_recency_)});
+    closed_readers_.erase(reader_path);
 }
 
-ReadManager::Path ReadManager::choose_reader_to_close() const
+bool ReadManager::try_reserve_reader_slot() const
 {
-    return open_readers_.begin()->first; // i.e. smallest file size
+    std::lock_guard<std::mutex> lock {reader_slots_->mutex};
+    if (reader_slots_->num_open >= max_open_files_) return false;
+    ++reader_slots_->num_open;
+    return true;
 }
 
-void ReadManager::close_readers(unsigned n) const
+// Must not be called with mutex_ held. Evicted readers only free their slot once no task is using them.
+void ReadManager::reserve_reader_slot() const
 {
-    for (; n > 0; --n) {
-        close_reader(choose_reader_to_close());
+    const auto max_open = std::max(max_open_files_, 1u);
+    std::unique_lock<std::mutex> cache_lock {mutex_};
+    std::unique_lock<std::mutex> slots_lock {reader_slots_->mutex};
+    while (reader_slots_->num_open >= max_open) {
+        if (!open_readers_.empty()) {
+            slots_lock.unlock(); // destroying the evicted handle takes the slots lock
+            evict_least_recent_reader();
+            slots_lock.lock();
+        } else {
+            cache_lock.unlock();
+            reader_slots_->released.wait(slots_lock);
+            // mutex_ is always taken before the slots lock
+            slots_lock.unlock();
+            cache_lock.lock();
+            slots_lock.lock();
+        }
     }
+    ++reader_slots_->num_open;
+}
+
+void ReadManager::release_reader_slot() const noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock {reader_slots_->mutex};
+        --reader_slots_->num_open;
+    }
+    reader_slots_->released.notify_all();
+}
+
+ReadManager::ReaderHandle ReadManager::make_reader_handle(ReadReader reader) const
+{
+    std::unique_ptr<const ReadReader> owned {};
+    try {
+        owned = std::make_unique<ReadReader>(std::move(reader));
+    } catch (...) {
+        release_reader_slot();
+        throw;
+    }
+    // The handle may outlive this manager, so releases the slot through the shared counter.
+    // If the handle can't be made the deleter is still called, releasing the slot.
+    return ReaderHandle {owned.release(), [slots = reader_slots_] (const ReadReader* reader) {
+        delete reader;
+        {
+            std::lock_guard<std::mutex> lock {slots->mutex};
+            --slots->num_open;
+        }
+        slots->released.notify_all();
+    }};
+}
+
+void ReadManager::evict_least_recent_reader() const
+{
+    // Evicted readers close once the last task using them is finished
+    const auto least_recent = reader_recency_.back();
+    closed_readers_.insert(least_recent);
+    open_readers_.erase(least_recent);
+    reader_recency_.pop_back();
+}
+
+void ReadManager::close_readers() const noexcept
+{
+    for (const auto& p : open_readers_) {
+        closed_readers_.insert(p.first);
+    }
+    open_readers_.clear();
+    reader_recency_.clear();
 }
 
 void ReadManager::add_possible_regions_to_reader_map(const Path& reader_path, const std::vector<GenomicRegion>& regions)
@@ -735,16 +1056,12 @@ bool ReadManager::can_use_reader(const Path& reader_path,
 std::vector<ReadManager::Path>
 ReadManager::get_possible_reader_paths(const GenomicRegion& region) const
 {
+    // The region map is fixed, unlike the reader cache, so no lock is needed
     std::vector<Path> result {};
     result.reserve(num_files_);
-    for (const auto& reader_path : closed_readers_) {
-        if (could_reader_contain_region(reader_path, region)) {
-            result.emplace_back(reader_path);
-        }
-    }
-    for (const auto& reader : open_readers_) {
-        if (could_reader_contain_region(reader.first, region)) {
-            result.emplace_back(reader.first);
+    for (const auto& p : possible_regions_in_readers_) {
+        if (could_reader_contain_region(p.first, region)) {
+            result.emplace_back(p.first);
         }
     }
     return result;
@@ -787,16 +1104,10 @@ ReadManager::get_possible_reader_paths(const std::vector<GenomicRegion>& regions
 {
     std::vector<Path> result {};
     result.reserve(num_files_);
-    for (const auto& reader_path : closed_readers_) {
-        if (std::any_of(std::cbegin(regions), std::cend(regions), [&] (const auto& region) {
-            return could_reader_contain_region(reader_path, region); })) {
-            result.emplace_back(reader_path);
-        }
-    }
-    for (const auto& reader : open_readers_) {
+    for (const auto& p : possible_regions_in_readers_) {
         if (std::any_of(std::cbegin(regions), std::cend(regions), [&] (const auto& region) {
-            return could_reader_contain_region(reader.first, region); })) {
-            result.emplace_back(reader.first);
+            return could_reader_contain_region(p.first, region); })) {
+            result.emplace_back(p.first);
         }
     }
     return result;
@@ -808,8 +1119,8 @@ ReadManager::get_possible_reader_paths(const std::vector<SampleName>& samples, c
     auto result = get_reader_paths_containing_samples(samples);
     auto it = std::remove_if(std::begin(result), std::end(result),
                              [this, &regions] (const Path& path) {
-                                 return std::any_of(std::cbegin(regions), std::cend(regions), 
-                                    [&] (const auto& region) { return !could_reader_contain_region(path, region); });
+                                 return std::none_of(std::cbegin(regions), std::cend(regions),
+                                    [&] (const auto& region) { return could_reader_contain_region(path, region); });
                              });
     result.erase(it, std::end(result));
     return result;
@@ -5,21 +5,29 @@
 #define read_manager_hpp
 
 #include <vector>
+#include <list>
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <initializer_list>
 #include <cstddef>
+#include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <functional>
 
 #include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
 
 #include "basics/contig_region.hpp"
 #include "basics/genomic_region.hpp"
 #include "containers/mappable_map.hpp"
 #include "utils/hash_functions.hpp"
+#include "utils/thread_pool.hpp"
 #include "read_reader.hpp"
 #include "read_reader_impl.hpp"
+#include "read_depth_index.hpp"
 
 namespace octopus {
 
@@ -27,6 +35,8 @@ class AlignedRead;
 
 namespace io {
 
+class HtslibDecodingContext;
+
 class ReadManager
 {
 public:
@@ -37,10 +47,15 @@ public:
     using SampleReadMap = IReadReaderImpl::SampleReadMap;
     using AlignedReadReadVisitor = IReadReaderImpl::AlignedReadReadVisitor;
     using ContigRegionVisitor    = IReadReaderImpl::ContigRegionVisitor;
+    using ReadRegionFilter       = IReadReaderImpl::ReadRegionFilter;
     
     ReadManager() = default;
     
-    ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files);
+    // If num_fetch_threads > 0, multi-sample fetches read from different files concurrently on a dedicated pool.
+    // If num_setup_threads > 1, the files are opened and inspected concurrently during construction.
+    ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files,
+                std::shared_ptr<HtslibDecodingContext> decoding_context = nullptr,
+                unsigned num_fetch_threads = 0, unsigned num_setup_threads = 0);
     ReadManager(std::initializer_list<Path> read_file_paths);
     
     ReadManager(const ReadManager&)            = delete;
@@ -87,6 +102,19 @@ public:
     std::size_t count_reads(const std::vector<SampleName>& samples, const GenomicRegion& region) const;
     std::size_t count_reads(const GenomicRegion& region) const;
     
+    // Like count_reads, but uses read depth indices or the file indices where possible rather than decoding reads.
+    // File index estimates may include reads from other samples in the same files.
+    std::size_t estimate_read_count(const std::vector<SampleName>& samples, const GenomicRegion& region) const;
+    
+    // Summaries from the read depth indices of the files containing the sample, or none if any of those files
+    // does not have an up-to-date index (or the indices have different bin sizes).
+    boost::optional<GenomicRegion::Size> depth_index_bin_size(const SampleName& sample) const;
+    boost::optional<std::vector<float>> indexed_mean_depths(const SampleName& sample, const GenomicRegion& region) const;
+    boost::optional<ReadDepthIndex::MappingQualityHistogram> indexed_mapping_qualities(const SampleName& sample) const;
+    
+    // Tells open readers that might contain the regions that they will likely be fetched soon
+    void advise_access(const std::vector<SampleName>& samples, const std::vector<GenomicRegion>& regions) const;
+    
     GenomicRegion find_covered_subregion(const SampleName& sample, const GenomicRegion& region,
                                          std::size_t max_reads) const;
     GenomicRegion find_covered_subregion(const std::vector<SampleName>& samples, const GenomicRegion& region,
@@ -99,6 +127,11 @@ public:
     ReadContainer fetch_reads(const SampleName& sample,  const std::vector<GenomicRegion>& regions) const;
     SampleReadMap fetch_reads(const std::vector<SampleName>& samples, const std::vector<GenomicRegion>& regions) const;
     SampleReadMap fetch_reads(const std::vector<GenomicRegion>& regions) const;
+    // Files are read one at a time, so the filter sees the reads of one file at a time in file order
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples, const GenomicRegion& region,
+                              const ReadRegionFilter& filter) const;
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples, const std::vector<GenomicRegion>& regions,
+                              const ReadRegionFilter& filter) const;
     
 private:
     using PathHash = octopus::utils::FilepathHash;
@@ -108,41 +141,77 @@ private:
         bool operator()(const Path& lhs, const Path& rhs) const;
     };
     
-    using OpenReaderMap           = std::map<Path, ReadReader, FileSizeCompare>;
+    // Readers are shared so a reader evicted from the cache stays open until the tasks using it are done
+    using ReaderHandle            = std::shared_ptr<const ReadReader>;
+    // Counts every open reader, including evicted readers still in use and readers being opened, so
+    // no more than max_open_files_ files are ever open. Handles release their slot when destroyed.
+    struct ReaderSlots
+    {
+        std::mutex mutex;
+        std::condition_variable released;
+        unsigned num_open = 0;
+    };
+    using ReaderRecencyList       = std::list<Path>; // most recently used first
+    struct OpenReader
+    {
+        ReaderHandle reader;
+        ReaderRecencyList::iterator recency;
+    };
+    using OpenReaderMap           = std::unordered_map<Path, OpenReader, PathHash>;
     using ClosedReaderSet         = std::unordered_set<Path, PathHash>;
     using SampleIdToReaderPathMap = std::unordered_map<SampleName, std::vector<Path>>;
     using ContigMap               = MappableMap<GenomicRegion::ContigName, ContigRegion>;
     using ReaderRegionsMap        = std::unordered_map<Path, ContigMap, PathHash>;
+    using DepthIndexMap           = std::unordered_map<Path, ReadDepthIndex, PathHash>;
     
     unsigned max_open_files_ = 200;
+    std::shared_ptr<HtslibDecodingContext> decoding_context_; // shared by all readers
     unsigned num_files_;
     bool all_readers_single_sample_;
     
     mutable ClosedReaderSet closed_readers_;
     mutable OpenReaderMap open_readers_;
+    mutable ReaderRecencyList reader_recency_;
+    std::shared_ptr<ReaderSlots> reader_slots_; // shared with the reader handles
     
     SampleIdToReaderPathMap reader_paths_containing_sample_;
     ReaderRegionsMap possible_regions_in_readers_;
+    DepthIndexMap depth_indices_;
     std::vector<SampleName> samples_;
     
-    mutable std::mutex mutex_;
+    mutable std::mutex mutex_; // guards the reader cache, but is not held while readers are used
+    
+    std::unique_ptr<ThreadPool> fetch_workers_; // null unless fetching in parallel
     
-    void setup_reader_samples_and_regions();
+    void setup_reader_samples_and_regions(unsigned num_threads);
     void open_initial_files();
     
     ReadReader make_reader(const Path& reader_path) const;
+    bool try_reserve_reader_slot() const;
+    void reserve_reader_slot() const;
+    void release_reader_slot() const noexcept;
+    ReaderHandle make_reader_handle(ReadReader reader) const;
+    void evict_least_recent_reader() const;
     bool all_readers_are_open() const noexcept;
     bool is_open(const Path& reader_path) const noexcept;
-    std::vector<Path>::iterator partition_open(std::vector<Path>& reader_paths) const;
-    unsigned num_open_readers() const noexcept;
-    unsigned num_reader_spaces() const noexcept;
-    void open_reader(const Path& reader_path) const;
-    std::vector<Path>::iterator open_readers(std::vector<Path>::iterator first,
-                                             std::vector<Path>::iterator last) const;
+    boost::optional<std::size_t> try_estimate_read_count(const std::vector<SampleName>& samples,
+                                                         const GenomicRegion& region) const;
+    boost::optional<std::size_t> estimate_indexed_read_count(const Path& reader_path,
+                                                             const std::vector<SampleName>& samples,
+                                                             const GenomicRegion& region) const;
+    std::vector<const ReadDepthIndex*> get_depth_indices(const SampleName& sample) const;
     void open_readers(unsigned n) const;
-    void close_reader(const Path& reader_path) const;
-    Path choose_reader_to_close() const;
-    void close_readers(unsigned n) const;
+    ReaderHandle acquire_reader(const Path& reader_path) const;
+    void insert_reader(const Path& reader_path, ReaderHandle reader) const;
+    void close_readers() const noexcept;
+    
+    template <typename F>
+    bool for_each_reader(std::vector<Path> reader_paths, F f) const;
+    bool can_fetch_in_parallel(std::size_t num_readers) const noexcept;
+    using SampleReadMapFetcher = std::function<SampleReadMap(const ReadReader&)>;
+    using SampleReadParts = std::unordered_map<SampleName, std::vector<ReadContainer>>; // sorted reads from each reader
+    void fetch_in_parallel(const std::vector<Path>& reader_paths, const SampleReadMapFetcher& fetcher,
+                           SampleReadParts& result) const;
     
     template <typename Visitor>
     void iterate_helper(const std::vector<SampleName>& samples,
@@ -173,22 +242,29 @@ void ReadManager::iterate_helper(const std::vector<SampleName>& samples,
     if (all_readers_are_open()) {
         for (const auto& p : open_readers_) {
             if (can_use_reader(p.first, samples, region)) {
-                if (!p.second.iterate(samples, region, visitor)) return;
+                if (!p.second.reader->iterate(samples, region, visitor)) return;
             }
         }
     } else {
+        for_each_reader(get_possible_reader_paths(samples, region),
+                        [&] (const ReadReader& reader) { return reader.iterate(samples, region, visitor); });
+    }
+}
+
+template <typename F>
+bool ReadManager::for_each_reader(std::vector<Path> reader_paths, F f) const
+{
+    {
+        // Use cached readers first so they aren't evicted by the ones opened for this request
         std::lock_guard<std::mutex> lock {mutex_};
-        auto reader_paths = get_reader_paths_containing_samples(samples);
-        auto reader_itr = partition_open(reader_paths);
-        while (!reader_paths.empty()) {
-            auto itr = std::find_if(reader_itr, end(reader_paths), [&] (const auto& reader_path) {
-                return !open_readers_.at(reader_path).iterate(samples, region, visitor);
-            });
-            if (itr != end(reader_paths)) break;
-            reader_paths.erase(reader_itr, end(reader_paths));
-            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
-        }
+        std::stable_partition(std::begin(reader_paths), std::end(reader_paths),
+                              [this] (const Path& path) { return is_open(path); });
+    }
+    for (const auto& reader_path : reader_paths) {
+        const auto reader = acquire_reader(reader_path);
+        if (!f(*reader)) return false;
     }
+    return true;
 }
 
 } // namespace io
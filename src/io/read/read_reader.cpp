@@ -67,19 +67,19 @@ bool is_valid_read_file_type(const boost::filesystem::path& file_path)
     return includes(validReadFileExtensions, get_extension(file_path));
 }
 
-auto make_reader(const boost::filesystem::path& file_path)
+auto make_reader(const boost::filesystem::path& file_path, std::shared_ptr<HtslibDecodingContext> decoding_context)
 {
     if (!is_valid_read_file_type(file_path)) {
         throw UnknownReadFileFormat {file_path};
     }
-    return std::make_unique<HtslibSamFacade>(file_path);
+    return std::make_unique<HtslibSamFacade>(file_path, std::move(decoding_context));
 }
 
 } //namespace
 
-ReadReader::ReadReader(const boost::filesystem::path& file_path)
+ReadReader::ReadReader(const boost::filesystem::path& file_path, std::shared_ptr<HtslibDecodingContext> decoding_context)
 : file_path_ {file_path}
-, impl_ {make_reader(file_path_)}
+, impl_ {make_reader(file_path_, std::move(decoding_context))}
 {}
 
 ReadReader::ReadReader(ReadReader&& other)
@@ -158,6 +158,18 @@ boost::optional<std::vector<GenomicRegion>> ReadReader::mapped_regions() const
     return impl_->mapped_regions();
 }
 
+boost::optional<std::size_t> ReadReader::estimate_read_count(const GenomicRegion& region) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return impl_->estimate_read_count(region);
+}
+
+void ReadReader::advise_access(const std::vector<GenomicRegion>& regions) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    impl_->advise_access(regions);
+}
+
 bool ReadReader::iterate(const GenomicRegion& region,
                          AlignedReadReadVisitor visitor) const
 {
@@ -302,6 +314,22 @@ ReadReader::SampleReadMap ReadReader::fetch_reads(const std::vector<SampleName>&
     return impl_->fetch_reads(samples, regions);
 }
 
+ReadReader::SampleReadMap ReadReader::fetch_reads(const std::vector<SampleName>& samples,
+                                                  const GenomicRegion& region,
+                                                  const ReadRegionFilter& filter) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return impl_->fetch_reads(samples, region, filter);
+}
+
+ReadReader::SampleReadMap ReadReader::fetch_reads(const std::vector<SampleName>& samples,
+                                                  const std::vector<GenomicRegion>& regions,
+                                                  const ReadRegionFilter& filter) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return impl_->fetch_reads(samples, regions, filter);
+}
+
 bool operator==(const ReadReader& lhs, const ReadReader& rhs)
 {
     return lhs.path() == rhs.path();
@@ -24,6 +24,8 @@ class AlignedRead;
 
 namespace io {
 
+class HtslibDecodingContext;
+
 /*
  ReadReader is a simple RAII threadsafe wrapper around a IReadReaderImpl
  */
@@ -38,10 +40,11 @@ public:
     using PositionList  = IReadReaderImpl::PositionList;
     using AlignedReadReadVisitor = IReadReaderImpl::AlignedReadReadVisitor;
     using ContigRegionVisitor    = IReadReaderImpl::ContigRegionVisitor;
+    using ReadRegionFilter       = IReadReaderImpl::ReadRegionFilter;
     
     ReadReader() = default;
     
-    ReadReader(const Path& file_path);
+    ReadReader(const Path& file_path, std::shared_ptr<HtslibDecodingContext> decoding_context = nullptr);
     
     ReadReader(const ReadReader&)            = delete;
     ReadReader& operator=(const ReadReader&) = delete;
@@ -66,6 +69,8 @@ public:
     GenomicRegion::Size reference_size(const GenomicRegion::ContigName& contig) const;
     boost::optional<std::vector<GenomicRegion::ContigName>> mapped_contigs() const;
     boost::optional<std::vector<GenomicRegion>> mapped_regions() const;
+    boost::optional<std::size_t> estimate_read_count(const GenomicRegion& region) const;
+    void advise_access(const std::vector<GenomicRegion>& regions) const;
     
     bool iterate(const GenomicRegion& region,
                  AlignedReadReadVisitor visitor) const;
@@ -116,6 +121,12 @@ public:
                               const std::vector<GenomicRegion>& regions) const;
     SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
                               const std::vector<GenomicRegion>& regions) const;
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                              const GenomicRegion& region,
+                              const ReadRegionFilter& filter) const;
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                              const std::vector<GenomicRegion>& regions,
+                              const ReadRegionFilter& filter) const;
     
 private:
     Path file_path_;
@@ -27,6 +27,8 @@ public:
     using PositionList  = std::vector<GenomicRegion::Position>;
     using AlignedReadReadVisitor = std::function<bool(const SampleName&, AlignedRead)>;
     using ContigRegionVisitor = std::function<bool(const SampleName&, ContigRegion)>;
+    // Decides whether a read is kept from its mapped contig and region alone, before the read is decoded
+    using ReadRegionFilter = std::function<bool(const SampleName&, const GenomicRegion::ContigName&, const ContigRegion&)>;
     
     virtual ~IReadReaderImpl() noexcept = default;
     
@@ -86,12 +88,25 @@ public:
                                       const std::vector<GenomicRegion>& regions) const = 0;
     virtual SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
                                       const std::vector<GenomicRegion>& regions) const = 0;
+    // Only reads the filter keeps are decoded. The filter is called with each sample's reads in
+    // file order, which is sorted by mapped position within each contig.
+    virtual SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                                      const GenomicRegion& region,
+                                      const ReadRegionFilter& filter) const = 0;
+    virtual SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                                      const std::vector<GenomicRegion>& regions,
+                                      const ReadRegionFilter& filter) const = 0;
     
     virtual std::vector<GenomicRegion::ContigName> reference_contigs() const = 0;
     virtual GenomicRegion::Size reference_size(const GenomicRegion::ContigName& contig) const = 0;
     
     virtual boost::optional<std::vector<GenomicRegion::ContigName>> mapped_contigs() const { return boost::none; };
     virtual boost::optional<std::vector<GenomicRegion>> mapped_regions() const { return boost::none; };
+    // An approximate number of reads in the region over all samples, without decoding any records.
+    // Zero only if there are definitely no reads.
+    virtual boost::optional<std::size_t> estimate_read_count(const GenomicRegion& region) const { return boost::none; };
+    // A hint that the regions will be read soon, so the implementation may start reading them ahead. No effect by default.
+    virtual void advise_access(const std::vector<GenomicRegion>& regions) const {};
 };
 
 } // namespace io
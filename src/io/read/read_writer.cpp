@@ -10,15 +10,32 @@
 namespace octopus { namespace io {
 
 ReadWriter::ReadWriter(Path bam_out, Path bam_template)
-: path_ {std::move(bam_out)}
-, impl_ {std::make_unique<HtslibSamFacade>(path_, std::move(bam_template))}
+: ReadWriter {std::move(bam_out), std::move(bam_template), StreamConfig {}}
 {}
 
+ReadWriter::ReadWriter(Path bam_out, Path bam_template, StreamConfig config)
+: path_ {std::move(bam_out)}
+, impl_ {std::make_unique<HtslibSamFacade>(path_, std::move(bam_template), config.num_compression_threads)}
+, queue_ {}
+{
+    if (config.max_queued_batches > 0) {
+        queue_ = std::make_unique<WriteQueue>();
+        queue_->capacity = config.max_queued_batches;
+        queue_->writer = std::thread {run_writer, std::ref(*queue_), std::ref(*impl_)};
+    }
+}
+
 ReadWriter::ReadWriter(ReadWriter&& other)
 {
     std::lock_guard<std::mutex> lock {other.mutex_};
-    path_ = std::move(other.path_);
-    impl_ = std::move(other.impl_);
+    path_  = std::move(other.path_);
+    impl_  = std::move(other.impl_);
+    queue_ = std::move(other.queue_);
+}
+
+ReadWriter::~ReadWriter()
+{
+    close_queue();
 }
 
 void swap(ReadWriter& lhs, ReadWriter& rhs) noexcept
@@ -29,6 +46,7 @@ void swap(ReadWriter& lhs, ReadWriter& rhs) noexcept
     using std::swap;
     swap(lhs.path_, rhs.path_);
     swap(lhs.impl_, rhs.impl_);
+    swap(lhs.queue_, rhs.queue_);
 }
 
 const ReadWriter::Path& ReadWriter::path() const noexcept
@@ -38,8 +56,91 @@ const ReadWriter::Path& ReadWriter::path() const noexcept
 
 void ReadWriter::write(const AlignedRead& read)
 {
-    std::lock_guard<std::mutex> lock {mutex_};
-    impl_->write(read);
+    if (queue_) {
+        EncodedBatch batch {};
+        batch.push_back(impl_->encode(read));
+        write_batch(std::move(batch));
+    } else {
+        std::lock_guard<std::mutex> lock {mutex_};
+        impl_->write(read);
+    }
+}
+
+void ReadWriter::flush()
+{
+    if (!queue_) return;
+    std::unique_lock<std::mutex> lock {queue_->mutex};
+    queue_->popped.wait(lock, [this] () { return queue_->error || (queue_->batches.empty() && !queue_->writing); });
+    if (queue_->error) std::rethrow_exception(queue_->error);
+}
+
+// private methods
+
+void ReadWriter::write_batch(EncodedBatch batch)
+{
+    if (batch.empty()) return;
+    if (queue_) {
+        {
+            std::unique_lock<std::mutex> lock {queue_->mutex};
+            queue_->popped.wait(lock, [this] () { return queue_->error || queue_->batches.size() < queue_->capacity; });
+            if (queue_->error) std::rethrow_exception(queue_->error);
+            queue_->batches.push_back(std::move(batch));
+        }
+        queue_->pushed.notify_one();
+    } else {
+        std::lock_guard<std::mutex> lock {mutex_};
+        for (const auto& read : batch) {
+            impl_->write(read);
+        }
+    }
+}
+
+void ReadWriter::close_queue() noexcept
+{
+    if (!queue_) return;
+    {
+        std::lock_guard<std::mutex> lock {queue_->mutex};
+        queue_->done = true;
+    }
+    queue_->pushed.notify_one();
+    if (queue_->writer.joinable()) queue_->writer.join();
+}
+
+void ReadWriter::run_writer(WriteQueue& queue, HtslibSamFacade& impl)
+{
+    std::unique_lock<std::mutex> lock {queue.mutex};
+    while (true) {
+        queue.pushed.wait(lock, [&] () { return queue.done || !queue.batches.empty(); });
+        if (queue.batches.empty()) return; // done
+        auto batch = std::move(queue.batches.front());
+        queue.batches.pop_front();
+        queue.writing = true;
+        lock.unlock();
+        queue.popped.notify_all();
+        std::exception_ptr error {};
+        try {
+            for (const auto& read : batch) {
+                impl.write(read);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        batch.clear();
+        lock.lock();
+        queue.writing = false;
+        if (error) {
+            queue.error = error;
+            queue.batches.clear();
+            lock.unlock();
+            queue.popped.notify_all();
+            return;
+        }
+        if (queue.batches.empty()) {
+            lock.unlock();
+            queue.popped.notify_all();
+            lock.lock();
+        }
+    }
 }
 
 ReadWriter& operator<<(ReadWriter& dst, const AlignedRead& read)
@@ -6,6 +6,13 @@
 
 #include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <cstddef>
+#include <exception>
+#include <iterator>
 
 #include <boost/filesystem/path.hpp>
 
@@ -18,42 +25,88 @@ class AlignedRead;
 
 namespace io {
 
+/*
+ ReadWriter writes reads synchronously unless given a StreamConfig with queued batches, in which case
+ batches of reads are encoded on the calling thread and queued for a dedicated writer thread, and the
+ calling thread only blocks if the queue is full. BGZF compression can additionally be done on a pool
+ of htslib threads. Batches are written in the order they are queued.
+ */
 class ReadWriter
 {
 public:
     using Path = boost::filesystem::path;
     
+    struct StreamConfig
+    {
+        std::size_t max_queued_batches = 0; // if zero, reads are written by the calling thread
+        unsigned num_compression_threads = 0;
+    };
+    
     ReadWriter() = delete;
     
     ReadWriter(Path bam_out, Path bam_template);
+    ReadWriter(Path bam_out, Path bam_template, StreamConfig config);
     
     ReadWriter(const ReadWriter&)            = delete;
     ReadWriter& operator=(const ReadWriter&) = delete;
     ReadWriter(ReadWriter&&);
     ReadWriter& operator=(ReadWriter&&)      = delete;
     
-    ~ReadWriter() = default;
+    ~ReadWriter(); // Writes any queued reads
     
     friend void swap(ReadWriter& lhs, ReadWriter& rhs) noexcept;
     
     const Path& path() const noexcept;
     
     void write(const AlignedRead& read);
+    template <typename Range>
+    void write(const Range& reads);
+    
+    // Waits for all queued reads to be written, and throws if the writer thread failed
+    void flush();
     
 private:
+    using EncodedRead  = HtslibSamFacade::EncodedRead;
+    using EncodedBatch = std::vector<EncodedRead>;
+    
+    struct WriteQueue
+    {
+        std::size_t capacity;
+        std::deque<EncodedBatch> batches;
+        std::mutex mutex;
+        std::condition_variable pushed, popped;
+        bool writing = false, done = false;
+        std::exception_ptr error = nullptr;
+        std::thread writer;
+    };
+    
     Path path_;
     std::unique_ptr<HtslibSamFacade> impl_;
+    std::unique_ptr<WriteQueue> queue_; // null if writing synchronously
     mutable std::mutex mutex_;
+    
+    void write_batch(EncodedBatch batch);
+    void close_queue() noexcept;
+    static void run_writer(WriteQueue& queue, HtslibSamFacade& impl);
 };
 
+template <typename Range>
+void ReadWriter::write(const Range& reads)
+{
+    EncodedBatch batch {};
+    batch.reserve(std::distance(std::cbegin(reads), std::cend(reads)));
+    for (const auto& read : reads) {
+        batch.push_back(impl_->encode(read));
+    }
+    write_batch(std::move(batch));
+}
+
 ReadWriter& operator<<(ReadWriter& dst, const AlignedRead& read);
 
 template <typename Container>
 void write(const Container& reads, ReadWriter& dst)
 {
-    for (const auto& read : reads) {
-        dst << read;
-    }
+    dst.write(reads);
 }
 
 template <typename Container>
@@ -5,17 +5,19 @@
 #define caching_fasta_hpp
 
 #include <unordered_map>
-#include <map>
 #include <list>
+#include <array>
+#include <vector>
 #include <cstddef>
+#include <cstdint>
 #include <mutex>
+#include <atomic>
 #include <memory>
 
 #include <boost/filesystem/path.hpp>
-#include <boost/range/iterator_range_core.hpp>
-#include <boost/optional.hpp>
 
 #include "basics/contig_region.hpp"
+#include "utils/huge_page_allocator.hpp"
 #include "reference_reader.hpp"
 #include "fasta.hpp"
 
@@ -40,6 +42,11 @@ namespace io {
  
        - forward bias: the probability the next request region will be to the right hand side of
                        the current request region.
+ 
+ Sequence is cached in fixed size blocks aligned to contig positions, so requests on different contigs
+ (or different parts of one contig) never contend for the same cache entries. Blocks are spread over a
+ number of independently locked shards, each with its own LRU list. Copies of a CachingFasta share the
+ cache, so clones made for other threads don't duplicate cached sequence.
  */
 
 class CachingFasta : public ReferenceReader
@@ -51,6 +58,11 @@ public:
     using GenomicSize     = ReferenceReader::GenomicSize;
     using GeneticSequence = ReferenceReader::GeneticSequence;
     
+    struct CacheStats
+    {
+        std::uint64_t hits, misses; // in blocks
+    };
+    
     CachingFasta() = delete;
     
     CachingFasta(std::unique_ptr<ReferenceReader> fasta); // Use for unlimited caching
@@ -60,24 +72,54 @@ public:
     
     CachingFasta(const CachingFasta&);
     CachingFasta& operator=(CachingFasta);
-    CachingFasta(CachingFasta&&);
-    CachingFasta& operator=(CachingFasta&&);
+    CachingFasta(CachingFasta&&)            = default;
+    CachingFasta& operator=(CachingFasta&&) = default;
+    
+    CacheStats cache_stats() const noexcept;
     
 private:
-    using ContigSequenceCache = std::map<ContigRegion, GeneticSequence>;
-    using SequenceCache       = std::unordered_map<std::string, ContigSequenceCache>;
-    using CacheIterator       = ContigSequenceCache::const_iterator;
-    using OverlapRange        = boost::iterator_range<CacheIterator>;
+    using ContigId   = std::uint32_t;
+    using BlockIndex = std::uint64_t; // contig id in the high 32 bits, block number in the low
+    
+    struct Block
+    {
+        BlockIndex index;
+        std::size_t slot;
+        GenomicSize size;
+    };
+    
+    // Each shard keeps its blocks in one buffer of fixed size slots, so there is no allocation per block
+    // and the buffer can be backed by huge pages
+    struct CacheShard
+    {
+        using BlockList = std::list<Block>;
+        std::mutex mutex;
+        BlockList blocks; // most recently used first
+        std::unordered_map<BlockIndex, BlockList::iterator> index;
+        HugePageBuffer<char> storage; // made on first use
+        std::vector<std::size_t> free_slots;
+    };
+    
+    static constexpr std::size_t numShards {16};
+    
+    struct BlockCache
+    {
+        std::array<CacheShard, numShards> shards;
+        std::size_t max_shard_size, num_shard_slots;
+        std::atomic<std::uint64_t> hits, misses;
+        BlockCache(std::size_t max_shard_size, std::size_t num_shard_slots)
+        : shards {}, max_shard_size {max_shard_size}, num_shard_slots {num_shard_slots}, hits {0}, misses {0} {}
+        ~BlockCache(); // logs stats in debug mode
+    };
     
     std::unique_ptr<ReferenceReader> fasta_;
     std::unordered_map<ContigName, GenomicSize> contig_sizes_;
-    mutable SequenceCache sequence_cache_;
-    mutable std::list<GenomicRegion> recently_used_regions_; // TODO: also make into map of contigs?
+    std::unordered_map<ContigName, ContigId> contig_ids_;
     GenomicSize genome_size_;
     GenomicSize max_cache_size_;
-    mutable GenomicSize current_cache_size_;
+    GenomicSize block_size_;
     double locality_bias_, forward_bias_;
-    mutable std::mutex mutex_;
+    std::shared_ptr<BlockCache> cache_;
     
     std::unique_ptr<ReferenceReader> do_clone() const override;
     bool do_is_open() const noexcept override;
@@ -87,25 +129,11 @@ private:
     GeneticSequence do_fetch_sequence(const GenomicRegion& region) const override;
     
     void setup_cache();
-    GenomicSize get_remaining_cache_size() const;
-    GenomicSize get_lhs_extension_size(const GenomicRegion& requested_region) const;
-    GenomicSize get_rhs_extension_size(const GenomicRegion& requested_region) const;
-    GenomicRegion get_region_to_fetch(const GenomicRegion& requested_region) const;
-    GenomicRegion get_new_contig_chunk(const GenomicRegion& requested_region) const;
-    GenomicRegion get_partial_contig_chunk(const GenomicRegion& requested_region) const;
-    bool is_contig_cached(const GenomicRegion& region) const;
-    boost::optional<CacheIterator> find_cached(const GenomicRegion& request_region) const noexcept;
-    void add_sequence_to_cache(GeneticSequence&& sequence, GenomicRegion&& region) const;
-    void register_cache_hit(const GenomicRegion& region) const;
-    OverlapRange overlap_range(const GenomicRegion& region) const;
-    void remove_from_sequence_cache(const GenomicRegion& region) const;
-    void remove_from_usage_cache(const GenomicRegion& region) const;
-    void replace_in_usage_cache(const GenomicRegion& from, const GenomicRegion& to) const;
-    void recache_overlapped_regions(const GeneticSequence& sequence, const GenomicRegion& region) const;
-    void reduce_cache(std::size_t target_size) const;
-    GeneticSequence get_subsequence(const ContigRegion& requested_region,
-                                    const ContigRegion& sequence_region,
-                                    const GeneticSequence& sequence) const;
+    std::size_t num_readahead_blocks() const noexcept;
+    CacheShard& shard(BlockIndex index) const noexcept;
+    bool is_cached(BlockIndex index) const;
+    bool append_cached(BlockIndex index, ContigRegion::Position begin, ContigRegion::Position end, GeneticSequence& result) const;
+    void add_to_cache(BlockIndex index, const char* sequence, GenomicSize size) const;
 };
 
 } // namespace io
@@ -100,12 +100,19 @@ Fasta::Fasta(Path fasta_path, Path fasta_index_path, Options options)
     }
     fasta_       = std::ifstream(path_.string());
     fasta_index_ = bioio::read_fasta_index(index_path_.string());
+    if (options_.memory_map) {
+        auto mapped_fasta = std::make_shared<MappedFile>(path_);
+        if (mapped_fasta->is_open()) mapped_fasta_ = std::move(mapped_fasta);
+    }
 }
 
 Fasta::Fasta(const Fasta& other)
 : path_ {other.path_}
 , index_path_ {other.index_path_}
 , fasta_ {path_.string()}
+, fasta_index_ {other.fasta_index_}
+, mapped_fasta_ {other.mapped_fasta_}
+, options_ {other.options_}
 {}
 
 Fasta& Fasta::operator=(Fasta other)
@@ -114,9 +121,17 @@ Fasta& Fasta::operator=(Fasta other)
     swap(path_, other.path_);
     swap(index_path_, other.index_path_);
     swap(fasta_, other.fasta_);
+    swap(fasta_index_, other.fasta_index_);
+    swap(mapped_fasta_, other.mapped_fasta_);
+    swap(options_, other.options_);
     return *this;
 }
 
+bool Fasta::is_memory_mapped() const noexcept
+{
+    return static_cast<bool>(mapped_fasta_);
+}
+
 // virtual private methods
 
 std::unique_ptr<ReferenceReader> Fasta::do_clone() const
@@ -173,11 +188,37 @@ public:
     BadReferenceRequestRegion(GenomicRegion region) : region {std::move(region)} {}
 };
 
+namespace {
+
+// As bioio::read_fasta_contig, but only reads from the mapping so can be called from any thread
+std::string read_mapped_contig(const MappedFile& fasta, const bioio::FastaContigIndex& index,
+                               const std::size_t begin, std::size_t length)
+{
+    std::string result {};
+    if (length == 0 || begin >= index.length || index.line_length == 0) return result;
+    length = std::min(length, index.length - begin);
+    result.reserve(length);
+    const auto num_line_end_bytes = index.line_byte_length - index.line_length;
+    auto offset = index.offset + (begin / index.line_length) * index.line_byte_length + begin % index.line_length;
+    auto num_remaining_line_bases = index.line_length - begin % index.line_length;
+    while (result.size() < length) {
+        const auto num_bases = std::min(num_remaining_line_bases, length - result.size());
+        if (offset + num_bases > fasta.size()) break; // truncated file
+        result.append(fasta.data() + offset, num_bases);
+        offset += num_bases + num_line_end_bytes;
+        num_remaining_line_bases = index.line_length;
+    }
+    return result;
+}
+
+} // namespace
+
 Fasta::GeneticSequence Fasta::do_fetch_sequence(const GenomicRegion& region) const
 {
     try {
-        auto result = bioio::read_fasta_contig(fasta_, fasta_index_.at(contig_name(region)),
-                                               mapped_begin(region), size(region));
+        const auto& contig_index = fasta_index_.at(contig_name(region));
+        auto result = mapped_fasta_ ? read_mapped_contig(*mapped_fasta_, contig_index, mapped_begin(region), size(region))
+                                    : bioio::read_fasta_contig(fasta_, contig_index, mapped_begin(region), size(region));
         if (is_capitalisation_requested()) {
             utils::capitalise(result);
         }
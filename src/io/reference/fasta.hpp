@@ -14,6 +14,8 @@
 
 #include "bioio.hpp"
 
+#include "utils/system_utils.hpp"
+
 #include "reference_reader.hpp"
 
 namespace octopus {
@@ -39,6 +41,9 @@ public:
         CapitalisationPolicy base_transform_policy = CapitalisationPolicy::maintain;
         IUPACAmbiguitySymbolPolicy iupac_ambiguity_symbol_policy = IUPACAmbiguitySymbolPolicy::maintain;
         BaseFillPolicy base_fill_policy = BaseFillPolicy::ignore;
+        // Read sequence from a shared read-only mapping of the file rather than a stream, so
+        // fetches are safe from any thread. Streams are used if the file can't be mapped.
+        bool memory_map = false;
     };
     
     Fasta() = delete;
@@ -53,12 +58,16 @@ public:
     Fasta(Fasta&&)            = default;
     Fasta& operator=(Fasta&&) = default;
     
+    // If true, fetches may be made concurrently
+    bool is_memory_mapped() const noexcept;
+    
 private:
     Path path_;
     Path index_path_;
     
     mutable std::ifstream fasta_;
     bioio::FastaIndex fasta_index_;
+    std::shared_ptr<const MappedFile> mapped_fasta_;
     
     Options options_;
     
@@ -11,6 +11,8 @@
 #include "fasta.hpp"
 #include "threadsafe_fasta.hpp"
 #include "caching_fasta.hpp"
+#include "two_bit_reference.hpp"
+#include "tandem_repeat_index.hpp"
 
 namespace octopus {
 
@@ -25,6 +27,7 @@ ReferenceGenome::ReferenceGenome(std::unique_ptr<io::ReferenceReader> impl)
             ordered_contigs_ = impl_->fetch_contig_names();
             contig_sizes_.reserve(ordered_contigs_.size());
             for (const auto& contig_name : ordered_contigs_) {
+                ContigDictionary::instance().intern(contig_name); // so reference contigs have the smallest ids
                 contig_sizes_.emplace(contig_name, impl_->fetch_contig_size(contig_name));
             }
         } catch (...) {
@@ -40,6 +43,7 @@ ReferenceGenome::ReferenceGenome(const ReferenceGenome& other)
 , name_ {other.name_}
 , contig_sizes_ {other.contig_sizes_}
 , ordered_contigs_ {other.ordered_contigs_}
+, tandem_repeat_index_ {other.tandem_repeat_index_}
 {}
 
 ReferenceGenome& ReferenceGenome::operator=(ReferenceGenome other)
@@ -49,6 +53,7 @@ ReferenceGenome& ReferenceGenome::operator=(ReferenceGenome other)
     swap(name_,            other.name_);
     swap(contig_sizes_,    other.contig_sizes_);
     swap(ordered_contigs_, other.ordered_contigs_);
+    swap(tandem_repeat_index_, other.tandem_repeat_index_);
     return *this;
 }
 
@@ -92,15 +97,34 @@ ReferenceGenome::GeneticSequence ReferenceGenome::fetch_sequence(const GenomicRe
     return impl_->fetch_sequence(region);
 }
 
+void ReferenceGenome::set_tandem_repeat_index(std::shared_ptr<const io::TandemRepeatIndex> index) noexcept
+{
+    tandem_repeat_index_ = std::move(index);
+}
+
+const io::TandemRepeatIndex* ReferenceGenome::tandem_repeat_index() const noexcept
+{
+    return tandem_repeat_index_.get();
+}
+
 // non-member functions
 
-ReferenceGenome make_reference(boost::filesystem::path reference_path,
-                               const MemoryFootprint max_cache_size,
-                               const bool is_threaded,
-                               const bool capitalise_bases,
-                               const bool disambiguate_iupac_ambiguity_symbols)
+namespace {
+
+ReferenceGenome make_reference_helper(boost::filesystem::path reference_path,
+                                      const MemoryFootprint max_cache_size,
+                                      const bool is_threaded,
+                                      const bool capitalise_bases,
+                                      const bool disambiguate_iupac_ambiguity_symbols)
 {
     using namespace io;
+    if (capitalise_bases) {
+        // The 2-bit reference is shared between threads without locks, so needs no cache
+        auto two_bit_reference = TwoBitReference::load(reference_path, disambiguate_iupac_ambiguity_symbols);
+        if (two_bit_reference) {
+            return ReferenceGenome {std::make_unique<TwoBitReference>(std::move(*two_bit_reference))};
+        }
+    }
     std::unique_ptr<ReferenceReader> impl_ {};
     Fasta::Options options {};
     if (capitalise_bases) {
@@ -110,6 +134,7 @@ ReferenceGenome make_reference(boost::filesystem::path reference_path,
         options.iupac_ambiguity_symbol_policy = Fasta::Options::IUPACAmbiguitySymbolPolicy::disambiguate;
     }
     options.base_fill_policy = Fasta::Options::BaseFillPolicy::fill_with_ns;
+    options.memory_map = is_threaded; // so ThreadsafeFasta needn't lock
     if (is_threaded) {
         impl_ = std::make_unique<ThreadsafeFasta>(std::make_unique<Fasta>(reference_path, options));
     } else {
@@ -125,6 +150,26 @@ ReferenceGenome make_reference(boost::filesystem::path reference_path,
     }
 }
 
+} // namespace
+
+ReferenceGenome make_reference(boost::filesystem::path reference_path,
+                               const MemoryFootprint max_cache_size,
+                               const bool is_threaded,
+                               const bool capitalise_bases,
+                               const bool disambiguate_iupac_ambiguity_symbols)
+{
+    auto result = make_reference_helper(reference_path, max_cache_size, is_threaded, capitalise_bases,
+                                        disambiguate_iupac_ambiguity_symbols);
+    if (capitalise_bases) {
+        // The index is made from capitalised bases, so can't be used for other references
+        auto tandem_repeats = io::TandemRepeatIndex::load(reference_path);
+        if (tandem_repeats) {
+            result.set_tandem_repeat_index(std::make_shared<io::TandemRepeatIndex>(std::move(*tandem_repeats)));
+        }
+    }
+    return result;
+}
+
 std::vector<GenomicRegion> get_all_contig_regions(const ReferenceGenome& reference)
 {
     std::vector<GenomicRegion> result {};
@@ -18,6 +18,8 @@
 
 namespace octopus {
 
+namespace io { class TandemRepeatIndex; }
+
 class ReferenceGenome
 {
 public:
@@ -46,11 +48,16 @@ public:
     
     GeneticSequence fetch_sequence(const GenomicRegion& region) const;
     
+    // The precomputed tandem repeats of the reference, if any. Copies share the index.
+    void set_tandem_repeat_index(std::shared_ptr<const io::TandemRepeatIndex> index) noexcept;
+    const io::TandemRepeatIndex* tandem_repeat_index() const noexcept;
+    
 private:
     std::unique_ptr<io::ReferenceReader> impl_;
     std::string name_;
     std::unordered_map<ContigName, ContigRegion::Size> contig_sizes_;
     std::vector<ContigName> ordered_contigs_;
+    std::shared_ptr<const io::TandemRepeatIndex> tandem_repeat_index_;
 };
 
 // non-member functions
@@ -0,0 +1,297 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "tandem_repeat_index.hpp"
+
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "basics/tandem_repeat.hpp"
+#include "utils/repeat_finder.hpp"
+#include "exceptions/unwritable_file_error.hpp"
+#include "reference_genome.hpp"
+
+namespace octopus { namespace io {
+
+namespace fs = boost::filesystem;
+
+class UnwritableTandemRepeatIndex : public UnwritableFileError
+{
+    std::string do_where() const override { return "TandemRepeatIndex::write"; }
+public:
+    UnwritableTandemRepeatIndex(fs::path file) : UnwritableFileError {std::move(file), "tandem repeat index"} {}
+};
+
+namespace {
+
+// Layout (native byte order):
+//   header: magic, version, max period, min length, FASTA size, FASTA modification time
+//   for each contig (8 byte aligned): repeats sorted by begin
+//   contig table: number of contigs, then for each the name, repeats offset and count, and maximum repeat length
+//   footer: offset of the contig table
+constexpr char fileMagic[8] {'O', 'C', 'T', 'O', 'T', 'R', 'I', 'X'};
+constexpr std::uint32_t fileVersion {1};
+constexpr std::size_t headerSize {sizeof(fileMagic) + 3 * sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(std::int64_t)};
+constexpr GenomicRegion::Size findBlockSize {1'000'000};
+
+template <typename T>
+void write_value(std::ostream& os, const T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void write_array(std::ostream& os, const std::vector<T>& values)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    os.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+void write_string(std::ostream& os, const std::string& str)
+{
+    write_value(os, static_cast<std::uint32_t>(str.size()));
+    os.write(str.data(), str.size());
+}
+
+std::uint64_t align(std::ostream& os)
+{
+    static constexpr char padding[8] {};
+    const auto offset = static_cast<std::uint64_t>(os.tellp());
+    if (offset % 8 != 0) os.write(padding, 8 - offset % 8);
+    return static_cast<std::uint64_t>(os.tellp());
+}
+
+// Sequential reads from the mapped file that fail rather than read past the end
+class MappedCursor
+{
+public:
+    MappedCursor(const MappedFile& file, const std::size_t offset) : file_ {file}, offset_ {offset} {}
+
+    template <typename T>
+    bool read(T& value) noexcept
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "");
+        if (offset_ + sizeof(T) > file_.size()) return false;
+        std::memcpy(&value, file_.data() + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return true;
+    }
+    bool read(std::string& result)
+    {
+        std::uint32_t size;
+        if (!read(size) || offset_ + size > file_.size()) return false;
+        result.assign(file_.data() + offset_, size);
+        offset_ += size;
+        return true;
+    }
+
+private:
+    const MappedFile& file_;
+    std::size_t offset_;
+};
+
+auto get_last_write_time(const fs::path& file)
+{
+    return static_cast<std::int64_t>(fs::last_write_time(file));
+}
+
+template <typename T>
+const T* get_array(const MappedFile& file, const std::uint64_t offset, const std::uint64_t count) noexcept
+{
+    if (offset % alignof(T) != 0 || offset > file.size() || count > (file.size() - offset) / sizeof(T)) return nullptr;
+    return reinterpret_cast<const T*>(file.data() + offset);
+}
+
+using Repeat = TandemRepeatIndex::Repeat;
+
+/*
+    Finds the repeats of the contig in overlapping blocks. A repeat crossing a block boundary is found
+    truncated in both blocks, and as the blocks overlap by at least twice the maximum period, both
+    parts are long enough to be found and overlap each other by at least a period, so are joined.
+    Repeats that end inside the overlap are found whole in the earlier block, so are skipped in the later.
+ */
+std::vector<Repeat>
+find_contig_repeats(const ReferenceGenome& reference, const GenomicRegion::ContigName& contig,
+                    const unsigned max_period, const unsigned min_length)
+{
+    const auto contig_size = reference.contig_size(contig);
+    const GenomicRegion::Size block_overlap {2 * max_period};
+    std::vector<Repeat> result {};
+    GenomicRegion::Position block_begin {0}, prev_block_end {0};
+    while (block_begin < contig_size) {
+        const auto block_end = std::min(block_begin + findBlockSize, contig_size);
+        const GenomicRegion block {contig, block_begin, block_end};
+        auto sequence = reference.fetch_sequence(block);
+        // tandem::extract_exact_tandem_repeats misses some repeats with period equal to its max_period
+        for (const auto& repeat : find_exact_tandem_repeats(sequence, block, 1, max_period + 1)) {
+            if (repeat.period() > max_period || mapped_end(repeat) <= prev_block_end) continue;
+            result.push_back({static_cast<std::uint32_t>(mapped_begin(repeat)),
+                              static_cast<std::uint32_t>(mapped_end(repeat)),
+                              static_cast<std::uint32_t>(repeat.period())});
+        }
+        if (block_end == contig_size) break;
+        prev_block_end = block_end;
+        block_begin = block_end - block_overlap;
+    }
+    std::sort(std::begin(result), std::end(result), [] (const Repeat& lhs, const Repeat& rhs) {
+        return lhs.begin == rhs.begin ? (lhs.end == rhs.end ? lhs.period < rhs.period : lhs.end > rhs.end) : lhs.begin < rhs.begin;
+    });
+    // Repeats with the same period overlapping by at least a period are parts of the same repeat: either
+    // pieces of a repeat spanning a block boundary, or non-maximal repeats reported within a block
+    std::vector<std::size_t> last_repeat(max_period + 1, result.size());
+    std::size_t num_merged {0};
+    for (const auto& repeat : result) {
+        auto& last = last_repeat[repeat.period];
+        if (last < num_merged && repeat.begin + repeat.period <= result[last].end) {
+            result[last].end = std::max(result[last].end, repeat.end);
+        } else {
+            last = num_merged;
+            result[num_merged++] = repeat;
+        }
+    }
+    result.resize(num_merged);
+    result.erase(std::remove_if(std::begin(result), std::end(result),
+                                [=] (const Repeat& repeat) { return repeat.end - repeat.begin < min_length; }),
+                 std::end(result));
+    return result;
+}
+
+} // namespace
+
+TandemRepeatIndex::Path TandemRepeatIndex::default_path(const Path& fasta)
+{
+    return fasta.string() + ".otr";
+}
+
+boost::optional<TandemRepeatIndex> TandemRepeatIndex::load(const Path& fasta)
+{
+    const auto path = default_path(fasta);
+    boost::system::error_code ec {};
+    if (!fs::exists(path, ec) || !fs::exists(fasta, ec)) return boost::none;
+    auto index = std::make_shared<Index>();
+    index->file = MappedFile {path};
+    const auto& file = index->file;
+    if (!file.is_open() || file.size() < headerSize + sizeof(std::uint64_t)) return boost::none;
+    MappedCursor header {file, 0};
+    char magic[sizeof(fileMagic)];
+    std::uint32_t version, max_period, min_length;
+    std::uint64_t fasta_size;
+    std::int64_t fasta_last_write_time;
+    if (!header.read(magic) || !std::equal(std::cbegin(magic), std::cend(magic), std::cbegin(fileMagic))
+        || !header.read(version) || version != fileVersion || !header.read(max_period) || !header.read(min_length)
+        || !header.read(fasta_size) || !header.read(fasta_last_write_time)) {
+        return boost::none;
+    }
+    if (fasta_size != fs::file_size(fasta) || fasta_last_write_time != get_last_write_time(fasta)) {
+        return boost::none; // stale
+    }
+    index->max_period = max_period;
+    index->min_length = min_length;
+    std::uint64_t table_offset, num_contigs;
+    MappedCursor footer {file, file.size() - sizeof(std::uint64_t)};
+    if (!footer.read(table_offset) || table_offset < headerSize) return boost::none;
+    MappedCursor table {file, table_offset};
+    if (!table.read(num_contigs)) return boost::none;
+    for (std::uint64_t c {0}; c < num_contigs; ++c) {
+        GenomicRegion::ContigName name;
+        std::uint64_t repeats_offset, num_repeats;
+        std::uint32_t max_repeat_length;
+        if (!table.read(name) || !table.read(repeats_offset) || !table.read(num_repeats) || !table.read(max_repeat_length)) {
+            return boost::none;
+        }
+        Contig contig {get_array<Repeat>(file, repeats_offset, num_repeats), num_repeats, max_repeat_length};
+        if (!contig.repeats) return boost::none;
+        index->contigs.emplace(std::move(name), contig);
+    }
+    return TandemRepeatIndex {std::move(index)};
+}
+
+void TandemRepeatIndex::write(const ReferenceGenome& reference, const Path& fasta,
+                              const unsigned max_period, const unsigned min_length)
+{
+    const auto path = default_path(fasta);
+    const auto tmp_path = Path {path.string() + ".tmp"};
+    {
+        std::ofstream file {tmp_path.string(), std::ios::binary | std::ios::trunc};
+        if (!file) throw UnwritableTandemRepeatIndex {path};
+        file.write(fileMagic, sizeof(fileMagic));
+        write_value(file, fileVersion);
+        write_value(file, static_cast<std::uint32_t>(max_period));
+        write_value(file, static_cast<std::uint32_t>(min_length));
+        write_value(file, static_cast<std::uint64_t>(fs::file_size(fasta)));
+        write_value(file, get_last_write_time(fasta));
+        struct ContigEntry
+        {
+            GenomicRegion::ContigName name;
+            std::uint64_t repeats_offset, num_repeats;
+            std::uint32_t max_repeat_length;
+        };
+        std::vector<ContigEntry> entries {};
+        for (const auto& contig : reference.contig_names()) {
+            if (reference.contig_size(contig) > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::runtime_error {"contig \"" + contig + "\" is too long for a tandem repeat index"};
+            }
+            const auto repeats = find_contig_repeats(reference, contig, max_period, min_length);
+            std::uint32_t max_repeat_length {0};
+            for (const auto& repeat : repeats) max_repeat_length = std::max(max_repeat_length, repeat.end - repeat.begin);
+            ContigEntry entry {contig, align(file), repeats.size(), max_repeat_length};
+            write_array(file, repeats);
+            entries.push_back(std::move(entry));
+        }
+        const auto table_offset = align(file);
+        write_value(file, static_cast<std::uint64_t>(entries.size()));
+        for (const auto& entry : entries) {
+            write_string(file, entry.name);
+            write_value(file, entry.repeats_offset);
+            write_value(file, entry.num_repeats);
+            write_value(file, entry.max_repeat_length);
+        }
+        write_value(file, table_offset);
+        if (!file.flush()) throw UnwritableTandemRepeatIndex {path};
+    }
+    // Renaming means a concurrent load never sees a partially written file
+    fs::rename(tmp_path, path);
+}
+
+unsigned TandemRepeatIndex::max_period() const noexcept
+{
+    return index_->max_period;
+}
+
+unsigned TandemRepeatIndex::min_length() const noexcept
+{
+    return index_->min_length;
+}
+
+std::vector<TandemRepeatIndex::Repeat> TandemRepeatIndex::fetch(const GenomicRegion& region) const
+{
+    const auto contig_itr = index_->contigs.find(region.contig_name());
+    if (contig_itr == std::cend(index_->contigs)) return {};
+    const auto& contig = contig_itr->second;
+    const auto repeats_end = contig.repeats + contig.num_repeats;
+    // No repeat that begins before region.begin() - max_repeat_length can reach the region
+    const auto search_begin = region.begin() > contig.max_repeat_length ? region.begin() - contig.max_repeat_length : 0;
+    auto first = std::partition_point(contig.repeats, repeats_end, [=] (const Repeat& repeat) { return repeat.begin < search_begin; });
+    const auto last = std::partition_point(first, repeats_end, [&] (const Repeat& repeat) { return repeat.begin < region.end(); });
+    std::vector<Repeat> result {};
+    std::copy_if(first, last, std::back_inserter(result), [&] (const Repeat& repeat) { return repeat.end > region.begin(); });
+    return result;
+}
+
+// private methods
+
+TandemRepeatIndex::TandemRepeatIndex(std::shared_ptr<const Index> index)
+: index_ {std::move(index)}
+{}
+
+} // namespace io
+} // namespace octopus
@@ -0,0 +1,93 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef tandem_repeat_index_hpp
+#define tandem_repeat_index_hpp
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "utils/system_utils.hpp"
+
+namespace octopus {
+
+class ReferenceGenome;
+
+namespace io {
+
+// A TandemRepeatIndex is a precomputed list of the exact tandem repeats (maximal repetitions) of a
+// reference, written next to the FASTA by TandemRepeatIndex::write (i.e. 'octopus index-reference').
+// Only repeats with period at most max_period and length at least min_length are stored. The file
+// is memory mapped, so copies (e.g. one per thread) share it, and repeats overlapping a region are
+// found by binary search. As with TwoBitReference, the file records the size and modification time
+// of the FASTA it was made from, and is ignored if the FASTA has since changed.
+class TandemRepeatIndex
+{
+public:
+    using Path = boost::filesystem::path;
+
+    struct Repeat
+    {
+        std::uint32_t begin, end, period;
+    };
+
+    static constexpr unsigned default_max_period = 20;
+    static constexpr unsigned default_min_length = 3;
+
+    TandemRepeatIndex() = delete;
+
+    TandemRepeatIndex(const TandemRepeatIndex&)            = default;
+    TandemRepeatIndex& operator=(const TandemRepeatIndex&) = default;
+    TandemRepeatIndex(TandemRepeatIndex&&)                 = default;
+    TandemRepeatIndex& operator=(TandemRepeatIndex&&)      = default;
+
+    ~TandemRepeatIndex() = default;
+
+    static Path default_path(const Path& fasta); // e.g. reference.fa -> reference.fa.otr
+
+    // Returns none if there is no index for the FASTA, or if it is out of date or unreadable
+    static boost::optional<TandemRepeatIndex> load(const Path& fasta);
+
+    // Finds the repeats of reference, which must be the (capitalised) contents of fasta, and writes
+    // them to default_path(fasta)
+    static void write(const ReferenceGenome& reference, const Path& fasta,
+                      unsigned max_period = default_max_period, unsigned min_length = default_min_length);
+
+    unsigned max_period() const noexcept;
+    unsigned min_length() const noexcept;
+
+    // The repeats overlapping region, sorted by begin. Unindexed contigs have no repeats.
+    std::vector<Repeat> fetch(const GenomicRegion& region) const;
+
+private:
+    struct Contig
+    {
+        const Repeat* repeats;
+        std::size_t num_repeats;
+        std::uint32_t max_repeat_length;
+    };
+
+    struct Index
+    {
+        MappedFile file;
+        unsigned max_period, min_length;
+        std::unordered_map<GenomicRegion::ContigName, Contig> contigs;
+    };
+
+    std::shared_ptr<const Index> index_;
+
+    TandemRepeatIndex(std::shared_ptr<const Index> index);
+};
+
+} // namespace io
+} // namespace octopus
+
+#endif
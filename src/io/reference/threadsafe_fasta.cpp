@@ -62,12 +62,14 @@ std::vector<ThreadsafeFasta::ContigName> ThreadsafeFasta::do_fetch_contig_names(
 
 ThreadsafeFasta::GenomicSize ThreadsafeFasta::do_fetch_contig_size(const ContigName& contig) const
 {
-    std::lock_guard<std::mutex> lock {mutex_};
-    return fasta_->fetch_contig_size(contig);
+    return fasta_->fetch_contig_size(contig); // don't need mutex as only reads the index
 }
 
 ThreadsafeFasta::GeneticSequence ThreadsafeFasta::do_fetch_sequence(const GenomicRegion& region) const
 {
+    if (fasta_->is_memory_mapped()) {
+        return fasta_->fetch_sequence(region); // only reads from the shared mapping
+    }
     std::lock_guard<std::mutex> lock {mutex_};
     return fasta_->fetch_sequence(region);
 }
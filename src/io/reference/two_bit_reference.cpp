@@ -0,0 +1,346 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "two_bit_reference.hpp"
+
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "utils/sequence_utils.hpp"
+#include "exceptions/unwritable_file_error.hpp"
+#include "fasta.hpp"
+
+namespace octopus { namespace io {
+
+namespace fs = boost::filesystem;
+
+class UnwritableTwoBitReference : public UnwritableFileError
+{
+    std::string do_where() const override { return "TwoBitReference::write"; }
+public:
+    UnwritableTwoBitReference(fs::path file) : UnwritableFileError {std::move(file), "2-bit reference"} {}
+};
+
+namespace {
+
+// Layout (native byte order):
+//   header: magic, version, padding, FASTA size, FASTA modification time
+//   for each contig (8 byte aligned): packed bases, N runs, other symbols
+//   contig table: number of contigs, then for each the name, size and data offsets and counts
+//   footer: offset of the contig table
+constexpr char fileMagic[8] {'O', 'C', 'T', 'O', '2', 'B', 'I', 'T'};
+constexpr std::uint32_t fileVersion {1};
+constexpr std::size_t headerSize {sizeof(fileMagic) + 2 * sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(std::int64_t)};
+constexpr GenomicRegion::Size encodeChunkSize {1'000'000};
+
+template <typename T>
+void write_value(std::ostream& os, const T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void write_array(std::ostream& os, const std::vector<T>& values)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    os.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+void write_string(std::ostream& os, const std::string& str)
+{
+    write_value(os, static_cast<std::uint32_t>(str.size()));
+    os.write(str.data(), str.size());
+}
+
+std::uint64_t align(std::ostream& os)
+{
+    static constexpr char padding[8] {};
+    const auto offset = static_cast<std::uint64_t>(os.tellp());
+    if (offset % 8 != 0) os.write(padding, 8 - offset % 8);
+    return static_cast<std::uint64_t>(os.tellp());
+}
+
+// Sequential reads from the mapped file that fail rather than read past the end
+class MappedCursor
+{
+public:
+    MappedCursor(const MappedFile& file, const std::size_t offset) : file_ {file}, offset_ {offset} {}
+
+    template <typename T>
+    bool read(T& value) noexcept
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "");
+        if (offset_ + sizeof(T) > file_.size()) return false;
+        std::memcpy(&value, file_.data() + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return true;
+    }
+    bool read(std::string& result)
+    {
+        std::uint32_t size;
+        if (!read(size) || offset_ + size > file_.size()) return false;
+        result.assign(file_.data() + offset_, size);
+        offset_ += size;
+        return true;
+    }
+
+private:
+    const MappedFile& file_;
+    std::size_t offset_;
+};
+
+auto get_last_write_time(const fs::path& file)
+{
+    return static_cast<std::int64_t>(fs::last_write_time(file));
+}
+
+template <typename T>
+const T* get_array(const MappedFile& file, const std::uint64_t offset, const std::uint64_t count) noexcept
+{
+    if (offset % alignof(T) != 0 || offset > file.size() || count > (file.size() - offset) / sizeof(T)) return nullptr;
+    return reinterpret_cast<const T*>(file.data() + offset);
+}
+
+std::uint8_t encode(const char base) noexcept
+{
+    switch (base) {
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return 0;
+    }
+}
+
+// The four bases packed in each byte value
+auto make_decode_table() noexcept
+{
+    static constexpr char bases[4] {'A', 'C', 'G', 'T'};
+    std::array<std::array<char, 4>, 256> result {};
+    for (unsigned byte {0}; byte < 256; ++byte) {
+        for (unsigned i {0}; i < 4; ++i) result[byte][i] = bases[(byte >> (2 * i)) & 3u];
+    }
+    return result;
+}
+
+} // namespace
+
+TwoBitReference::Path TwoBitReference::default_path(const Path& fasta)
+{
+    return fasta.string() + ".o2b";
+}
+
+boost::optional<TwoBitReference> TwoBitReference::load(const Path& fasta, const bool disambiguate_iupac_ambiguity_symbols)
+{
+    const auto path = default_path(fasta);
+    boost::system::error_code ec {};
+    if (!fs::exists(path, ec) || !fs::exists(fasta, ec)) return boost::none;
+    auto index = std::make_shared<Index>();
+    index->file = MappedFile {path};
+    const auto& file = index->file;
+    if (!file.is_open() || file.size() < headerSize + sizeof(std::uint64_t)) return boost::none;
+    MappedCursor header {file, 0};
+    char magic[sizeof(fileMagic)];
+    std::uint32_t version, padding;
+    std::uint64_t fasta_size;
+    std::int64_t fasta_last_write_time;
+    if (!header.read(magic) || !std::equal(std::cbegin(magic), std::cend(magic), std::cbegin(fileMagic))
+        || !header.read(version) || version != fileVersion || !header.read(padding)
+        || !header.read(fasta_size) || !header.read(fasta_last_write_time)) {
+        return boost::none;
+    }
+    if (fasta_size != fs::file_size(fasta) || fasta_last_write_time != get_last_write_time(fasta)) {
+        return boost::none; // stale
+    }
+    std::uint64_t table_offset, num_contigs;
+    MappedCursor footer {file, file.size() - sizeof(std::uint64_t)};
+    if (!footer.read(table_offset) || table_offset < headerSize) return boost::none;
+    MappedCursor table {file, table_offset};
+    if (!table.read(num_contigs)) return boost::none;
+    index->contig_names.reserve(std::min<std::uint64_t>(num_contigs, file.size()));
+    for (std::uint64_t c {0}; c < num_contigs; ++c) {
+        ContigName name;
+        std::uint64_t size, bases_offset, n_runs_offset, num_n_runs, symbols_offset, num_symbols;
+        if (!table.read(name) || !table.read(size) || !table.read(bases_offset)
+            || !table.read(n_runs_offset) || !table.read(num_n_runs)
+            || !table.read(symbols_offset) || !table.read(num_symbols)) {
+            return boost::none;
+        }
+        Contig contig {static_cast<GenomicSize>(size),
+                       get_array<std::uint8_t>(file, bases_offset, (size + 3) / 4),
+                       get_array<NRun>(file, n_runs_offset, num_n_runs), num_n_runs,
+                       get_array<Symbol>(file, symbols_offset, num_symbols), num_symbols};
+        if (!contig.bases || !contig.n_runs || !contig.symbols) return boost::none;
+        index->contig_names.push_back(name);
+        index->contigs.emplace(std::move(name), contig);
+    }
+    index->reference_name = fasta.stem().string();
+    return TwoBitReference {std::move(index), disambiguate_iupac_ambiguity_symbols};
+}
+
+void TwoBitReference::write(const Path& fasta)
+{
+    Fasta::Options fasta_options {};
+    fasta_options.base_transform_policy = Fasta::Options::CapitalisationPolicy::capitalise;
+    const Fasta reference {fasta, fasta_options};
+    const auto path = default_path(fasta);
+    const auto tmp_path = Path {path.string() + ".tmp"};
+    {
+        std::ofstream file {tmp_path.string(), std::ios::binary | std::ios::trunc};
+        if (!file) throw UnwritableTwoBitReference {path};
+        file.write(fileMagic, sizeof(fileMagic));
+        write_value(file, fileVersion);
+        write_value(file, std::uint32_t {0});
+        write_value(file, static_cast<std::uint64_t>(fs::file_size(fasta)));
+        write_value(file, get_last_write_time(fasta));
+        struct ContigEntry
+        {
+            ContigName name;
+            std::uint64_t size, bases_offset, n_runs_offset, num_n_runs, symbols_offset, num_symbols;
+        };
+        std::vector<ContigEntry> entries {};
+        std::vector<std::uint8_t> bases {};
+        std::vector<NRun> n_runs {};
+        std::vector<Symbol> symbols {};
+        for (const auto& contig : reference.fetch_contig_names()) {
+            const auto contig_size = reference.fetch_contig_size(contig);
+            if (contig_size > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::runtime_error {"contig \"" + contig + "\" is too long for a 2-bit reference"};
+            }
+            bases.assign((contig_size + 3) / 4, 0);
+            n_runs.clear();
+            symbols.clear();
+            for (GenomicSize chunk_begin {0}; chunk_begin < contig_size; chunk_begin += encodeChunkSize) {
+                const auto chunk_end = std::min(chunk_begin + encodeChunkSize, contig_size);
+                const auto sequence = reference.fetch_sequence(GenomicRegion {contig, chunk_begin, chunk_end});
+                for (std::size_t i {0}; i < sequence.size(); ++i) {
+                    const auto position = static_cast<std::uint32_t>(chunk_begin + i);
+                    const auto base = sequence[i];
+                    if (base == 'N') {
+                        if (!n_runs.empty() && n_runs.back().end == position) {
+                            ++n_runs.back().end;
+                        } else {
+                            n_runs.push_back({position, position + 1});
+                        }
+                    } else if (base != 'A' && base != 'C' && base != 'G' && base != 'T') {
+                        symbols.push_back({position, static_cast<std::uint32_t>(static_cast<unsigned char>(base))});
+                    } else {
+                        bases[position / 4] |= encode(base) << (2 * (position % 4));
+                    }
+                }
+            }
+            ContigEntry entry {contig, contig_size, 0, 0, n_runs.size(), 0, symbols.size()};
+            entry.bases_offset = align(file);
+            write_array(file, bases);
+            entry.n_runs_offset = align(file);
+            write_array(file, n_runs);
+            entry.symbols_offset = align(file);
+            write_array(file, symbols);
+            entries.push_back(std::move(entry));
+        }
+        const auto table_offset = align(file);
+        write_value(file, static_cast<std::uint64_t>(entries.size()));
+        for (const auto& entry : entries) {
+            write_string(file, entry.name);
+            write_value(file, entry.size);
+            write_value(file, entry.bases_offset);
+            write_value(file, entry.n_runs_offset);
+            write_value(file, entry.num_n_runs);
+            write_value(file, entry.symbols_offset);
+            write_value(file, entry.num_symbols);
+        }
+        write_value(file, table_offset);
+        if (!file.flush()) throw UnwritableTwoBitReference {path};
+    }
+    // Renaming means a concurrent load never sees a partially written file
+    fs::rename(tmp_path, path);
+}
+
+// private methods
+
+TwoBitReference::TwoBitReference(std::shared_ptr<const Index> index, const bool disambiguate_iupac_ambiguity_symbols)
+: index_ {std::move(index)}
+, disambiguate_iupac_ambiguity_symbols_ {disambiguate_iupac_ambiguity_symbols}
+{}
+
+std::unique_ptr<ReferenceReader> TwoBitReference::do_clone() const
+{
+    return std::make_unique<TwoBitReference>(*this); // shares the mapping
+}
+
+bool TwoBitReference::do_is_open() const noexcept
+{
+    return index_->file.is_open();
+}
+
+std::string TwoBitReference::do_fetch_reference_name() const
+{
+    return index_->reference_name;
+}
+
+std::vector<TwoBitReference::ContigName> TwoBitReference::do_fetch_contig_names() const
+{
+    return index_->contig_names;
+}
+
+TwoBitReference::GenomicSize TwoBitReference::do_fetch_contig_size(const ContigName& contig) const
+{
+    return find_contig(contig).size;
+}
+
+TwoBitReference::GeneticSequence TwoBitReference::do_fetch_sequence(const GenomicRegion& region) const
+{
+    static const auto decode_table = make_decode_table();
+    const auto& contig = find_contig(region.contig_name());
+    GeneticSequence result(size(region), 'N');
+    const auto begin = std::min(region.begin(), contig.size), end = std::min(region.end(), contig.size);
+    auto position = begin;
+    auto out = std::begin(result);
+    for (; position < end && position % 4 != 0; ++position) {
+        *out++ = decode_table[contig.bases[position / 4]][position % 4];
+    }
+    for (; position + 4 <= end; position += 4) {
+        out = std::copy_n(std::cbegin(decode_table[contig.bases[position / 4]]), 4, out);
+    }
+    for (; position < end; ++position) {
+        *out++ = decode_table[contig.bases[position / 4]][position % 4];
+    }
+    const auto n_runs_end = contig.n_runs + contig.num_n_runs;
+    auto n_run = std::partition_point(contig.n_runs, n_runs_end, [=] (const NRun& run) { return run.end <= begin; });
+    for (; n_run != n_runs_end && n_run->begin < end; ++n_run) {
+        const auto run_begin = std::max<GenomicSize>(n_run->begin, begin), run_end = std::min<GenomicSize>(n_run->end, end);
+        std::fill(std::next(std::begin(result), run_begin - begin), std::next(std::begin(result), run_end - begin), 'N');
+    }
+    const auto symbols_end = contig.symbols + contig.num_symbols;
+    auto symbol = std::partition_point(contig.symbols, symbols_end, [=] (const Symbol& s) { return s.position < begin; });
+    for (; symbol != symbols_end && symbol->position < end; ++symbol) {
+        result[symbol->position - begin] = static_cast<char>(symbol->base);
+    }
+    if (disambiguate_iupac_ambiguity_symbols_ && contig.num_symbols > 0) {
+        utils::disambiguate_iupac_bases(result, true);
+    }
+    return result;
+}
+
+const TwoBitReference::Contig& TwoBitReference::find_contig(const ContigName& contig) const
+{
+    const auto itr = index_->contigs.find(contig);
+    if (itr == std::cend(index_->contigs)) {
+        throw std::runtime_error {"contig \"" + contig + "\" not found in 2-bit reference \""
+                                  + index_->reference_name + "\""};
+    }
+    return itr->second;
+}
+
+} // namespace io
+} // namespace octopus
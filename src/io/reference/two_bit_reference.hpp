@@ -0,0 +1,103 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef two_bit_reference_hpp
+#define two_bit_reference_hpp
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include "utils/system_utils.hpp"
+#include "reference_reader.hpp"
+
+namespace octopus { namespace io {
+
+// A TwoBitReference reads a pre-encoded copy of a FASTA reference, written next to the FASTA by
+// TwoBitReference::write (i.e. 'octopus index-reference'). Bases are packed four to a byte, with runs
+// of N and any other (e.g. IUPAC ambiguity) symbols stored separately, and the file is memory mapped.
+//
+// Fetching a sequence only decodes from the shared mapping, so no locking or caching is needed, and
+// clones (e.g. one per thread) share the same mapping. All bases are capitalised, and requests past the
+// end of a contig are filled with N. As with ReadDepthIndex, the file records the size and modification
+// time of the FASTA it was made from, and is ignored if the FASTA has since changed.
+class TwoBitReference : public ReferenceReader
+{
+public:
+    using Path = boost::filesystem::path;
+
+    using ContigName      = ReferenceReader::ContigName;
+    using GenomicSize     = ReferenceReader::GenomicSize;
+    using GeneticSequence = ReferenceReader::GeneticSequence;
+
+    TwoBitReference() = delete;
+
+    TwoBitReference(const TwoBitReference&)            = default;
+    TwoBitReference& operator=(const TwoBitReference&) = default;
+    TwoBitReference(TwoBitReference&&)                 = default;
+    TwoBitReference& operator=(TwoBitReference&&)      = default;
+
+    ~TwoBitReference() = default;
+
+    static Path default_path(const Path& fasta); // e.g. reference.fa -> reference.fa.o2b
+
+    // Returns none if there is no 2-bit file for the FASTA, or if it is out of date or unreadable
+    static boost::optional<TwoBitReference> load(const Path& fasta, bool disambiguate_iupac_ambiguity_symbols = false);
+
+    // Encodes the (indexed) FASTA and writes it to default_path(fasta)
+    static void write(const Path& fasta);
+
+private:
+    struct NRun
+    {
+        std::uint32_t begin, end;
+    };
+
+    struct Symbol
+    {
+        std::uint32_t position, base;
+    };
+
+    struct Contig
+    {
+        GenomicSize size;
+        const std::uint8_t* bases;
+        const NRun* n_runs;
+        std::size_t num_n_runs;
+        const Symbol* symbols;
+        std::size_t num_symbols;
+    };
+
+    struct Index
+    {
+        MappedFile file;
+        std::string reference_name;
+        std::vector<ContigName> contig_names;
+        std::unordered_map<ContigName, Contig> contigs;
+    };
+
+    std::shared_ptr<const Index> index_;
+    bool disambiguate_iupac_ambiguity_symbols_;
+
+    TwoBitReference(std::shared_ptr<const Index> index, bool disambiguate_iupac_ambiguity_symbols);
+
+    std::unique_ptr<ReferenceReader> do_clone() const override;
+    bool do_is_open() const noexcept override;
+    std::string do_fetch_reference_name() const override;
+    std::vector<ContigName> do_fetch_contig_names() const override;
+    GenomicSize do_fetch_contig_size(const ContigName& contig) const override;
+    GeneticSequence do_fetch_sequence(const GenomicRegion& region) const override;
+
+    const Contig& find_contig(const ContigName& contig) const;
+};
+
+} // namespace io
+} // namespace octopus
+
+#endif
@@ -0,0 +1,138 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "progress_journal.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <stdexcept>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include "exceptions/missing_file_error.hpp"
+#include "exceptions/malformed_file_error.hpp"
+#include "exceptions/unwritable_file_error.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/system_utils.hpp"
+#include "region_parser.hpp"
+
+namespace octopus { namespace io {
+
+class MissingProgressJournal : public MissingFileError
+{
+    std::string do_where() const override { return "read_progress_journal"; }
+public:
+    MissingProgressJournal(boost::filesystem::path p) : MissingFileError {std::move(p), "progress journal"} {};
+};
+
+class MalformedProgressJournal : public MalformedFileError
+{
+    std::string do_where() const override { return "read_progress_journal"; }
+    std::string do_help() const override { return "remove the temporary directory and restart the run without --resume"; }
+public:
+    MalformedProgressJournal(boost::filesystem::path file) : MalformedFileError {std::move(file), "progress journal"} {}
+};
+
+class UnwritableProgressJournal : public UnwritableFileError
+{
+    std::string do_where() const override { return "ProgressJournal"; }
+public:
+    UnwritableProgressJournal(boost::filesystem::path file) : UnwritableFileError {std::move(file), "progress journal"} {}
+};
+
+ProgressJournal::ProgressJournal(Path journal_file)
+: path_ {std::move(journal_file)}
+, file_ {path_.string(), std::ios::app}
+{
+    if (!file_) {
+        throw UnwritableProgressJournal {path_};
+    }
+}
+
+const ProgressJournal::Path& ProgressJournal::path() const noexcept
+{
+    return path_;
+}
+
+void ProgressJournal::record(const Path& calls_file, const GenomicRegion& completed,
+                             const boost::optional<ProgressJournalEntry::TaskRecords>& last_task)
+{
+    sync_file(calls_file);
+    const auto calls_file_size = boost::filesystem::file_size(calls_file);
+    file_ << calls_file.filename().string() << '\t' << calls_file_size << '\t' << to_string(completed);
+    if (last_task) {
+        file_ << '\t' << to_string(last_task->region) << '\t' << last_task->first_record << '\t' << last_task->num_records;
+    }
+    file_ << '\n';
+    file_.flush();
+    sync_file(path_);
+}
+
+namespace {
+
+ProgressJournalEntry parse_journal_line(std::string line, const boost::filesystem::path& directory,
+                                        const ReferenceGenome& reference)
+{
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    const auto fields = utils::split(line, '\t');
+    if ((fields.size() != 3 && fields.size() != 6) || fields[0].empty()) {
+        throw std::runtime_error {"Malformed progress journal line"};
+    }
+    auto calls_file_size = boost::lexical_cast<std::uintmax_t>(fields[1]);
+    auto completed = parse_region(fields[2], reference);
+    ProgressJournalEntry result {directory / fields[0], calls_file_size, std::move(completed)};
+    if (fields.size() == 6) {
+        auto last_task_region = parse_region(fields[3], reference);
+        if (last_task_region.contig_name() != result.completed.contig_name()) {
+            throw std::runtime_error {"Malformed progress journal line"};
+        }
+        result.last_task = ProgressJournalEntry::TaskRecords {std::move(last_task_region),
+                                                              boost::lexical_cast<std::size_t>(fields[4]),
+                                                              boost::lexical_cast<std::size_t>(fields[5])};
+    }
+    return result;
+}
+
+} // namespace
+
+std::vector<ProgressJournalEntry> read_progress_journal(const boost::filesystem::path& journal_file,
+                                                        const ReferenceGenome& reference)
+{
+    if (!boost::filesystem::exists(journal_file)) {
+        throw MissingProgressJournal {journal_file};
+    }
+    const auto directory = journal_file.parent_path();
+    std::ifstream file {journal_file.string()};
+    std::vector<boost::optional<ProgressJournalEntry>> entries {};
+    std::unordered_map<std::string, std::size_t> entry_indices {};
+    std::string line {};
+    try {
+        while (std::getline(file, line)) {
+            if (file.eof()) break; // the final line was not terminated so may be incomplete
+            if (line.empty()) continue;
+            auto entry = parse_journal_line(std::move(line), directory, reference);
+            auto key = entry.calls_file.string() + '\t' + entry.completed.contig_name();
+            const auto p = entry_indices.emplace(std::move(key), entries.size());
+            if (!p.second) {
+                entries[p.first->second] = boost::none;
+                p.first->second = entries.size();
+            }
+            entries.push_back(std::move(entry));
+        }
+    } catch (const std::runtime_error& e) {
+        throw MalformedProgressJournal {journal_file};
+    } catch (const boost::bad_lexical_cast& e) {
+        throw MalformedProgressJournal {journal_file};
+    }
+    std::vector<ProgressJournalEntry> result {};
+    result.reserve(entry_indices.size());
+    for (auto& entry : entries) {
+        if (entry) result.push_back(std::move(*entry));
+    }
+    return result;
+}
+
+} // namespace io
+} // namespace octopus
@@ -0,0 +1,77 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef progress_journal_hpp
+#define progress_journal_hpp
+
+#include <vector>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include "io/reference/reference_genome.hpp"
+#include "basics/genomic_region.hpp"
+
+namespace octopus { namespace io {
+
+// A progress journal records which calls files hold finished calling work. Each line gives a calls
+// file (relative to the journal's directory), the size of the file, and the region from the start
+// of a contig to the end of the last task of the contig written to the file. A calls file may hold
+// several contigs, so has a line for each. A line is only appended once the calls file has been
+// synced to disk, so the last line for each file and contig describes a complete prefix of the
+// file, even if the run was killed while writing more calls. A line may also give the region of
+// the last task of the contig written to the file and the range of records holding its calls, so a
+// resumed run can resolve these calls against the calls of the next task.
+struct ProgressJournalEntry
+{
+    struct TaskRecords
+    {
+        GenomicRegion region;
+        std::size_t first_record, num_records;
+    };
+    
+    boost::filesystem::path calls_file;
+    std::uintmax_t calls_file_size;
+    GenomicRegion completed;
+    boost::optional<TaskRecords> last_task = boost::none;
+};
+
+class ProgressJournal
+{
+public:
+    using Path = boost::filesystem::path;
+    
+    ProgressJournal() = delete;
+    
+    ProgressJournal(Path journal_file); // Appends to any existing journal
+    
+    ProgressJournal(const ProgressJournal&)            = delete;
+    ProgressJournal& operator=(const ProgressJournal&) = delete;
+    ProgressJournal(ProgressJournal&&)                 = default;
+    ProgressJournal& operator=(ProgressJournal&&)      = default;
+    
+    ~ProgressJournal() = default;
+    
+    const Path& path() const noexcept;
+    
+    // Syncs the calls file, which must be closed, and then records the completed region
+    void record(const Path& calls_file, const GenomicRegion& completed,
+                const boost::optional<ProgressJournalEntry::TaskRecords>& last_task = boost::none);
+    
+private:
+    Path path_;
+    std::ofstream file_;
+};
+
+// Returns the last entry of each calls file and contig, in the order they were recorded, with paths
+// resolved against the journal's directory. A torn final line (from a run killed while recording) is ignored.
+std::vector<ProgressJournalEntry> read_progress_journal(const boost::filesystem::path& journal_file,
+                                                        const ReferenceGenome& reference);
+
+} // namespace io
+} // namespace octopus
+
+#endif
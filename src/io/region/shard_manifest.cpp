@@ -0,0 +1,121 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "shard_manifest.hpp"
+
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include "exceptions/missing_file_error.hpp"
+#include "exceptions/malformed_file_error.hpp"
+#include "utils/string_utils.hpp"
+#include "region_parser.hpp"
+
+namespace octopus { namespace io {
+
+class MissingShardManifest : public MissingFileError
+{
+    std::string do_where() const override { return "read_shard_manifest"; }
+public:
+    MissingShardManifest(boost::filesystem::path p) : MissingFileError {std::move(p), "shard manifest"} {};
+};
+
+class MalformedShardManifest : public MalformedFileError
+{
+    std::string do_where() const override { return "read_shard_manifest"; }
+    std::string do_help() const override { return "regenerate the manifest with the --make-shards option"; }
+public:
+    MalformedShardManifest(boost::filesystem::path file) : MalformedFileError {std::move(file), "shard manifest"} {}
+};
+
+void write_shard_manifest(const ShardManifest& manifest, const boost::filesystem::path& manifest_file)
+{
+    std::ofstream file {manifest_file.string()};
+    for (const auto& region : manifest) {
+        file << region.shard << '\t' << to_string(region.core) << '\t' << to_string(region.padded) << '\n';
+    }
+}
+
+namespace {
+
+ShardRegion parse_manifest_line(std::string line, const ReferenceGenome& reference)
+{
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    const auto fields = utils::split(line, '\t');
+    if (fields.size() != 3) {
+        throw std::runtime_error {"Malformed shard manifest line"};
+    }
+    auto shard = boost::lexical_cast<ShardRegion::ShardId>(fields[0]);
+    auto core = parse_region(fields[1], reference);
+    auto padded = parse_region(fields[2], reference);
+    if (!contains(padded, core)) {
+        throw std::runtime_error {"Shard padded region does not contain core region"};
+    }
+    return {shard, std::move(core), std::move(padded)};
+}
+
+} // namespace
+
+ShardManifest read_shard_manifest(const boost::filesystem::path& manifest_file, const ReferenceGenome& reference)
+{
+    if (!boost::filesystem::exists(manifest_file)) {
+        throw MissingShardManifest {manifest_file};
+    }
+    std::ifstream file {manifest_file.string()};
+    ShardManifest result {};
+    std::string line {};
+    try {
+        while (std::getline(file, line)) {
+            if (!line.empty()) result.push_back(parse_manifest_line(std::move(line), reference));
+        }
+    } catch (const std::runtime_error& e) {
+        throw MalformedShardManifest {manifest_file};
+    } catch (const boost::bad_lexical_cast& e) {
+        throw MalformedShardManifest {manifest_file};
+    }
+    return result;
+}
+
+unsigned count_shards(const ShardManifest& manifest) noexcept
+{
+    if (manifest.empty()) return 0;
+    const auto max_shard = std::max_element(std::cbegin(manifest), std::cend(manifest),
+                                            [] (const auto& lhs, const auto& rhs) { return lhs.shard < rhs.shard; });
+    return max_shard->shard + 1;
+}
+
+std::vector<GenomicRegion> get_core_regions(const ShardManifest& manifest)
+{
+    std::vector<GenomicRegion> result {};
+    result.reserve(manifest.size());
+    for (const auto& region : manifest) {
+        result.push_back(region.core);
+    }
+    return result;
+}
+
+std::vector<GenomicRegion> get_core_regions(const ShardManifest& manifest, const ShardRegion::ShardId shard)
+{
+    std::vector<GenomicRegion> result {};
+    for (const auto& region : manifest) {
+        if (region.shard == shard) result.push_back(region.core);
+    }
+    return result;
+}
+
+std::vector<GenomicRegion> get_padded_regions(const ShardManifest& manifest, const ShardRegion::ShardId shard)
+{
+    std::vector<GenomicRegion> result {};
+    for (const auto& region : manifest) {
+        if (region.shard == shard) result.push_back(region.padded);
+    }
+    return result;
+}
+
+} // namespace io
+} // namespace octopus
@@ -0,0 +1,41 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef shard_manifest_hpp
+#define shard_manifest_hpp
+
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include "io/reference/reference_genome.hpp"
+#include "basics/genomic_region.hpp"
+
+namespace octopus { namespace io {
+
+// A shard is a set of contiguous core regions, each of which is called over a larger padded
+// region so calls near shard boundaries see the same flanking context as the neighbouring shard.
+struct ShardRegion
+{
+    using ShardId = unsigned;
+    ShardId shard;
+    GenomicRegion core, padded;
+};
+
+using ShardManifest = std::vector<ShardRegion>;
+
+// Manifest files are tab-separated with one line per core region: shard, core region, padded region
+void write_shard_manifest(const ShardManifest& manifest, const boost::filesystem::path& manifest_file);
+
+ShardManifest read_shard_manifest(const boost::filesystem::path& manifest_file, const ReferenceGenome& reference);
+
+unsigned count_shards(const ShardManifest& manifest) noexcept;
+
+std::vector<GenomicRegion> get_core_regions(const ShardManifest& manifest);
+std::vector<GenomicRegion> get_core_regions(const ShardManifest& manifest, ShardRegion::ShardId shard);
+std::vector<GenomicRegion> get_padded_regions(const ShardManifest& manifest, ShardRegion::ShardId shard);
+
+} // namespace io
+} // namespace octopus
+
+#endif
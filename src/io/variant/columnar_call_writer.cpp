@@ -0,0 +1,199 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "columnar_call_writer.hpp"
+
+#include <utility>
+#include <stdexcept>
+#include <cmath>
+
+#include "utils/compression.hpp"
+#include "vcf_record.hpp"
+#include "vcf_spec.hpp"
+
+namespace octopus {
+
+constexpr std::size_t ColumnarCallWriter::numColumns;
+constexpr std::int32_t ColumnarCallWriter::missingInteger;
+const std::array<char, 8> ColumnarCallWriter::magic {{'O', 'C', 'T', 'C', 'O', 'L', '1', '\0'}};
+
+namespace {
+
+template <typename T>
+void append(const T value, std::string& buffer)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void append(const std::string& str, std::string& buffer)
+{
+    append(static_cast<std::uint32_t>(str.size()), buffer);
+    buffer.append(str);
+}
+
+template <typename T>
+void write(const T value, std::ofstream& file)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+bool is_missing(const VcfRecord::ValueType& value) noexcept
+{
+    return value.empty() || value == vcfspec::missingValue;
+}
+
+std::int32_t get_integer(const VcfRecord& record, const VcfRecord::SampleName& sample, const VcfRecord::KeyType& key)
+{
+    if (!record.has_format(key)) return ColumnarCallWriter::missingInteger;
+    const auto& values = record.get_sample_value(sample, key);
+    if (values.empty() || is_missing(values.front())) return ColumnarCallWriter::missingInteger;
+    return static_cast<std::int32_t>(parse_integer_value(values.front()));
+}
+
+float parse_float(const VcfRecord::ValueType& value)
+{
+    return is_missing(value) ? std::nanf("") : static_cast<float>(parse_real_value(value));
+}
+
+} // namespace
+
+ColumnarCallWriter::ColumnarCallWriter(Path shard_path, std::vector<SampleName> samples)
+: ColumnarCallWriter {std::move(shard_path), std::move(samples), Config {}}
+{}
+
+ColumnarCallWriter::ColumnarCallWriter(Path shard_path, std::vector<SampleName> samples, Config config)
+: path_ {std::move(shard_path)}
+, samples_ {std::move(samples)}
+, config_ {config}
+, file_ {path_.string(), std::ios::binary | std::ios::trunc}
+, columns_ {}
+, num_buffered_ {0}
+, first_pos_ {0}, last_pos_ {0}
+, index_ {}
+, num_records_ {0}
+{
+    if (!file_) {
+        throw std::runtime_error {"ColumnarCallWriter: could not open " + path_.string()};
+    }
+    if (config_.chunk_size == 0) config_.chunk_size = 1;
+    file_.write(magic.data(), magic.size());
+}
+
+ColumnarCallWriter::~ColumnarCallWriter() noexcept
+{
+    try {
+        close();
+    } catch (...) {}
+}
+
+const ColumnarCallWriter::Path& ColumnarCallWriter::path() const noexcept
+{
+    return path_;
+}
+
+std::size_t ColumnarCallWriter::num_records() const noexcept
+{
+    return num_records_;
+}
+
+void ColumnarCallWriter::write(const VcfRecord& record)
+{
+    if (!file_.is_open()) {
+        throw std::runtime_error {"ColumnarCallWriter: cannot write to closed shard " + path_.string()};
+    }
+    const auto pos = static_cast<std::uint32_t>(record.pos());
+    if (num_buffered_ == 0) first_pos_ = pos;
+    append(num_buffered_ == 0 ? pos : pos - last_pos_, column(Column::pos));
+    last_pos_ = pos;
+    append(record.ref(), column(Column::ref));
+    auto& alt_column = column(Column::alt);
+    append(static_cast<std::uint8_t>(record.alt().size()), alt_column);
+    for (const auto& allele : record.alt()) append(allele, alt_column);
+    const auto qual = record.qual();
+    append(qual ? static_cast<float>(*qual) : std::nanf(""), column(Column::qual));
+    std::string filter {};
+    for (const auto& key : record.filter()) {
+        if (!filter.empty()) filter += ';';
+        filter += key;
+    }
+    append(filter, column(Column::filter));
+    const bool has_genotypes {record.has_genotypes()};
+    const bool has_likelihoods {record.has_format(vcfspec::format::likelihoods)};
+    for (const auto& sample : samples_) {
+        auto& gt_column = column(Column::gt);
+        if (has_genotypes) {
+            const auto& genotype = record.genotype(sample);
+            append(static_cast<std::uint8_t>(genotype.size()), gt_column);
+            append(static_cast<std::uint8_t>(record.is_sample_phased(sample)), gt_column);
+            for (const auto allele : genotype) append(static_cast<std::int8_t>(allele), gt_column);
+        } else {
+            append(std::uint8_t {0}, gt_column);
+            append(std::uint8_t {0}, gt_column);
+        }
+        append(get_integer(record, sample, vcfspec::format::conditionalQuality), column(Column::gq));
+        append(get_integer(record, sample, vcfspec::format::combinedReadDepth), column(Column::dp));
+        auto& gl_column = column(Column::gl);
+        if (has_likelihoods) {
+            const auto& likelihoods = record.get_sample_value(sample, vcfspec::format::likelihoods);
+            append(static_cast<std::uint16_t>(likelihoods.size()), gl_column);
+            for (const auto& value : likelihoods) append(parse_float(value), gl_column);
+        } else {
+            append(std::uint16_t {0}, gl_column);
+        }
+    }
+    ++num_buffered_;
+    ++num_records_;
+    if (num_buffered_ == config_.chunk_size) flush_chunk();
+}
+
+void ColumnarCallWriter::close()
+{
+    if (!file_.is_open()) return;
+    flush_chunk();
+    const auto index_offset = static_cast<std::uint64_t>(file_.tellp());
+    for (const auto& chunk : index_) {
+        octopus::write(chunk.first_pos, file_);
+        octopus::write(chunk.last_pos, file_);
+        octopus::write(chunk.num_records, file_);
+        for (std::size_t c {0}; c < numColumns; ++c) {
+            octopus::write(chunk.offsets[c], file_);
+            octopus::write(chunk.sizes[c], file_);
+        }
+    }
+    octopus::write(static_cast<std::uint64_t>(index_.size()), file_);
+    octopus::write(static_cast<std::uint32_t>(samples_.size()), file_);
+    octopus::write(static_cast<std::uint32_t>(numColumns), file_);
+    octopus::write(index_offset, file_);
+    file_.write(magic.data(), magic.size());
+    file_.close();
+    if (file_.fail()) {
+        throw std::runtime_error {"ColumnarCallWriter: failed writing " + path_.string()};
+    }
+}
+
+// private methods
+
+std::string& ColumnarCallWriter::column(const Column c) noexcept
+{
+    return columns_[static_cast<std::size_t>(c)];
+}
+
+void ColumnarCallWriter::flush_chunk()
+{
+    if (num_buffered_ == 0) return;
+    ChunkIndex chunk {};
+    chunk.first_pos = first_pos_;
+    chunk.last_pos = last_pos_;
+    chunk.num_records = static_cast<std::uint32_t>(num_buffered_);
+    for (std::size_t c {0}; c < numColumns; ++c) {
+        const auto compressed = utils::compress(columns_[c]);
+        chunk.offsets[c] = static_cast<std::uint64_t>(file_.tellp());
+        chunk.sizes[c] = compressed.size();
+        file_.write(compressed.data(), compressed.size());
+        columns_[c].clear();
+    }
+    index_.push_back(chunk);
+    num_buffered_ = 0;
+}
+
+} // namespace octopus
@@ -0,0 +1,107 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef columnar_call_writer_hpp
+#define columnar_call_writer_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <limits>
+
+#include <boost/filesystem/path.hpp>
+
+namespace octopus {
+
+class VcfRecord;
+
+/*
+    Writes the calls of one contig to a columnar binary shard, so tools that only need a few
+    fields of a large cohort call set don't have to parse every sample of every VCF record.
+
+    Records are buffered into chunks of Config::chunk_size records. Each column of a chunk is
+    zlib compressed and written separately, so readers can decompress just the columns they need.
+    The shard ends with an index of the chunks followed by a fixed size footer:
+
+        shard  := magic chunk* index footer
+        index  := (first_pos:u32 last_pos:u32 num_records:u32 (offset:u64 size:u64){numColumns})*
+        footer := num_chunks:u64 num_samples:u32 num_columns:u32 index_offset:u64 magic
+
+    Decompressed columns hold one entry per record, or per record and sample (sample-major within
+    each record) for the sample columns, in the order of Column:
+
+        pos    := u32 (one-based, delta from the previous record in the chunk)
+        ref    := len:u32 bytes
+        alt    := n:u8 (len:u32 bytes){n}
+        qual   := f32 (NaN if missing)
+        filter := len:u32 bytes (';' separated, empty if missing)
+        gt     := ploidy:u8 phased:u8 i8{ploidy} (allele indices, -1 if missing)
+        gq, dp := i32 (missingInteger if missing)
+        gl     := n:u16 f32{n}
+
+    Values are in host byte order. Sample order is given by the sample list passed to the constructor.
+ */
+class ColumnarCallWriter
+{
+public:
+    using Path = boost::filesystem::path;
+    using SampleName = std::string;
+
+    enum class Column : std::uint8_t { pos, ref, alt, qual, filter, gt, gq, dp, gl };
+
+    static constexpr std::size_t numColumns {static_cast<std::size_t>(Column::gl) + 1};
+    static constexpr std::int32_t missingInteger {std::numeric_limits<std::int32_t>::min()};
+    static const std::array<char, 8> magic;
+
+    struct Config
+    {
+        std::size_t chunk_size = 1024;
+    };
+
+    ColumnarCallWriter() = delete;
+
+    ColumnarCallWriter(Path shard_path, std::vector<SampleName> samples);
+    ColumnarCallWriter(Path shard_path, std::vector<SampleName> samples, Config config);
+
+    ColumnarCallWriter(const ColumnarCallWriter&)            = delete;
+    ColumnarCallWriter& operator=(const ColumnarCallWriter&) = delete;
+    ColumnarCallWriter(ColumnarCallWriter&&)                 = default;
+    ColumnarCallWriter& operator=(ColumnarCallWriter&&)      = default;
+
+    ~ColumnarCallWriter() noexcept;
+
+    const Path& path() const noexcept;
+    std::size_t num_records() const noexcept;
+
+    // Records must be on one contig and in position order
+    void write(const VcfRecord& record);
+    // Flushes the last chunk and writes the index. Nothing can be written after closing.
+    void close();
+
+private:
+    struct ChunkIndex
+    {
+        std::uint32_t first_pos, last_pos, num_records;
+        std::array<std::uint64_t, numColumns> offsets, sizes;
+    };
+
+    Path path_;
+    std::vector<SampleName> samples_;
+    Config config_;
+    std::ofstream file_;
+    std::array<std::string, numColumns> columns_;
+    std::size_t num_buffered_;
+    std::uint32_t first_pos_, last_pos_;
+    std::vector<ChunkIndex> index_;
+    std::size_t num_records_;
+
+    std::string& column(Column c) noexcept;
+    void flush_chunk();
+};
+
+} // namespace octopus
+
+#endif
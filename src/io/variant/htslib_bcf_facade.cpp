@@ -83,12 +83,39 @@ std::string get_hts_mode(const HtslibBcfFacade::Path& file_path, const HtslibBcf
     return result;
 }
 
+HtslibEncodingContext::HtslibEncodingContext(const unsigned num_threads)
+: num_threads_ {num_threads}
+, pool_ {num_threads > 0 ? hts_tpool_init(static_cast<int>(num_threads)) : nullptr, HtsThreadPoolDeleter {}}
+, hts_pool_ {}
+{
+    if (!pool_) num_threads_ = 0;
+    hts_pool_.pool = pool_.get();
+    hts_pool_.qsize = 0; // let htslib choose the queue size
+}
+
+unsigned HtslibEncodingContext::num_threads() const noexcept
+{
+    return num_threads_;
+}
+
+void HtslibEncodingContext::attach(htsFile* file)
+{
+    // Only BGZF compressed files use the pool; this is a no-op for uncompressed VCF
+    if (pool_ && file->format.compression == bgzf) hts_set_thread_pool(file, &hts_pool_);
+}
+
 HtslibBcfFacade::HtslibBcfFacade()
-: file_path_ {}
+: encoding_context_ {}
+, file_path_ {}
+, index_on_write_ {false}
+, index_path_ {}
 , file_ {bcf_open("-", "[w]"), HtsFileDeleter {}}
 , header_ {bcf_hdr_init("w"), HtsHeaderDeleter {}}
 , samples_ {}
 , reference_ {}
+, write_record_ {nullptr, HtsBcf1Deleter {}}
+, info_buffer_ {}
+, format_buffers_ {}
 {
     if (file_ == nullptr) {
         throw std::runtime_error {"HtslibBcfFacade: could not open stdout writer"};
@@ -109,11 +136,21 @@ std::error_code get_error_code()
 }
 
 HtslibBcfFacade::HtslibBcfFacade(Path file_path, Mode mode)
-: file_path_ {std::move(file_path)}
+: HtslibBcfFacade {std::move(file_path), mode, nullptr}
+{}
+
+HtslibBcfFacade::HtslibBcfFacade(Path file_path, Mode mode, std::shared_ptr<HtslibEncodingContext> encoding_context)
+: encoding_context_ {std::move(encoding_context)}
+, file_path_ {std::move(file_path)}
+, index_on_write_ {mode == Mode::write}
+, index_path_ {}
 , file_ {nullptr, HtsFileDeleter {}}
 , header_ {nullptr, HtsHeaderDeleter {}}
 , samples_ {}
 , reference_ {}
+, write_record_ {nullptr, HtsBcf1Deleter {}}
+, info_buffer_ {}
+, format_buffers_ {}
 {
     const auto hts_mode = get_hts_mode(file_path_, mode);
     if (mode == Mode::read) {
@@ -135,6 +172,7 @@ HtslibBcfFacade::HtslibBcfFacade(Path file_path, Mode mode)
         if (!file_) {
             throw FileOpenError {file_path_, get_error_code()};
         }
+        if (encoding_context_) encoding_context_->attach(file_.get());
         header_.reset(bcf_hdr_init(hts_mode.c_str()));
     } else {
         const auto hts_read_mode = get_hts_mode(file_path_, Mode::read);
@@ -148,6 +186,7 @@ HtslibBcfFacade::HtslibBcfFacade(Path file_path, Mode mode)
         if (!file_) {
             throw FileOpenError {file_path_, get_error_code()};
         }
+        if (encoding_context_) encoding_context_->attach(file_.get());
         if (header_) {
             samples_ = extract_samples(header_.get());
         } else {
@@ -407,18 +446,45 @@ void HtslibBcfFacade::write(const VcfHeader& header)
     }
     header_.reset(hdr);
     samples_ = extract_samples(header_.get());
+    if (index_on_write_) init_index();
+}
+
+void HtslibBcfFacade::init_index()
+{
+    index_on_write_ = false;
+    #if defined(HTS_VERSION) && HTS_VERSION >= 101000
+    if (file_->format.compression != bgzf) return;
+    // Same index types as index_vcf: CSI for BCF and tabix for VCF
+    const bool is_bcf_file {file_->format.format == bcf};
+    Path index_path {file_path_.string() + (is_bcf_file ? ".csi" : ".tbi")};
+    if (bcf_idx_init(file_.get(), header_.get(), is_bcf_file ? 14 : 0, index_path.c_str()) == 0) {
+        index_path_ = std::move(index_path);
+    }
+    #endif
+}
+
+bool HtslibBcfFacade::save_index() noexcept
+{
+    #if defined(HTS_VERSION) && HTS_VERSION >= 101000
+    if (index_path_ && file_ && bcf_idx_save(file_.get()) == 0) return true;
+    #endif
+    if (index_path_) {
+        boost::system::error_code ec {};
+        boost::filesystem::remove(*index_path_, ec); // a partial index is worse than none
+    }
+    return false;
 }
 
 void set_chrom(const bcf_hdr_t* header, bcf1_t* record, const std::string& chrom);
 void set_pos(bcf1_t* record, GenomicRegion::Position pos);
-void set_id(bcf1_t* record, const std::string& id);
+void set_id(const bcf_hdr_t* header, bcf1_t* record, const std::string& id);
 void set_alleles(const bcf_hdr_t* header, bcf1_t* record, const VcfRecord::NucleotideSequence& ref,
                  const std::vector<VcfRecord::NucleotideSequence>& alts);
 void set_qual(bcf1_t* record, VcfRecord::QualityType qual);
 void set_filter(const bcf_hdr_t* header, bcf1_t* record, const std::vector<std::string>& filters);
-void set_info(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source);
+void set_info(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source, std::string& str_buffer);
 void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
-                 const std::vector<std::string>& samples);
+                 const std::vector<std::string>& samples, std::vector<std::string>& str_buffer);
 
 void HtslibBcfFacade::write(const VcfRecord& record)
 {
@@ -435,23 +501,65 @@ void HtslibBcfFacade::write(const VcfRecord& record)
         throw std::runtime_error {"HtslibBcfFacade: required contig header line missing for contig \"" + contig + "\""};
     }
     
-    auto hts_record = bcf_init();
+    if (!write_record_) {
+        write_record_.reset(bcf_init());
+        if (!write_record_) {
+            throw std::runtime_error {"HtslibBcfFacade: could not allocate record"};
+        }
+    } else {
+        bcf_clear(write_record_.get());
+    }
+    const auto hts_record = write_record_.get();
     set_chrom(header_.get(), hts_record, contig);
     set_pos(hts_record, record.pos() - 1);
-    set_id(hts_record, record.id());
+    set_id(header_.get(), hts_record, record.id());
     set_alleles(header_.get(), hts_record, record.ref(), record.alt());
     if (record.qual()) {
         set_qual(hts_record, *record.qual());
     }
     set_filter(header_.get(), hts_record, record.filter());
-    set_info(header_.get(), hts_record, record);
+    set_info(header_.get(), hts_record, record, info_buffer_);
     if (record.num_samples() > 0) {
-        set_samples(header_.get(), hts_record, record, samples_);
+        set_samples(header_.get(), hts_record, record, samples_, format_buffers_);
     }
     if (bcf_write(file_.get(), header_.get(), hts_record) < 0) {
         throw std::runtime_error {"HtslibBcfFacade: record write failed"};
     }
-    bcf_destroy(hts_record);
+}
+
+void HtslibBcfFacade::write_records(const Path& source)
+{
+    if (file_ == nullptr) {
+        throw std::runtime_error {"HtslibBcfFacade: trying to write records to closed file"};
+    }
+    if (header_ == nullptr) {
+        throw std::runtime_error {"HtslibBcfFacade: trying to write records without a header"};
+    }
+    std::unique_ptr<htsFile, HtsFileDeleter> source_file {bcf_open(source.c_str(), "r"), HtsFileDeleter {}};
+    if (!source_file) {
+        throw FileOpenError {source, get_error_code()};
+    }
+    std::unique_ptr<bcf_hdr_t, HtsHeaderDeleter> source_header {bcf_hdr_read(source_file.get()), HtsHeaderDeleter {}};
+    if (!source_header) {
+        throw std::runtime_error {"HtslibBcfFacade: could not read header of " + source.string()};
+    }
+    HtsBcf1Ptr hts_record {bcf_init(), HtsBcf1Deleter {}};
+    if (!hts_record) {
+        throw std::runtime_error {"HtslibBcfFacade: could not allocate record"};
+    }
+    int status;
+    while ((status = bcf_read(source_file.get(), source_header.get(), hts_record.get())) == 0) {
+        // A no-op unless the source header assigns different dictionary ids to the destination header
+        if (bcf_translate(header_.get(), source_header.get(), hts_record.get()) < 0) {
+            throw std::runtime_error {"HtslibBcfFacade: could not translate record from " + source.string()};
+        }
+        if (bcf_write(file_.get(), header_.get(), hts_record.get()) < 0) {
+            throw std::runtime_error {"HtslibBcfFacade: record write failed"};
+        }
+    }
+    if (status < -1) {
+        throw std::runtime_error {"HtslibBcfFacade: failed reading records from " + source.string()};
+    }
 }
 
 // HtslibBcfFacade::RecordIterator
@@ -551,9 +659,10 @@ void extract_id(const bcf1_t* record, VcfRecord::Builder& builder)
     builder.set_id(record->d.id);
 }
 
-void set_id(bcf1_t* record, const std::string& id)
+void set_id(const bcf_hdr_t* header, bcf1_t* record, const std::string& id)
 {
-    record->d.id = malloc_copy(id);
+    // Copies into the record's own ID buffer, which bcf_clear keeps for the next record
+    bcf_update_id(header, record, id.c_str());
 }
 
 void extract_ref(const bcf1_t* record, VcfRecord::Builder& builder)
@@ -679,7 +788,26 @@ float get_bcf_float_missing() noexcept
     return result;
 }
 
-void set_info(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source)
+void join(const std::vector<std::string>& values, const char delim, std::string& result)
+{
+    result.clear();
+    for (const auto& value : values) {
+        if (&value != &values.front()) result += delim;
+        result += value;
+    }
+}
+
+int to_bcf_int(const std::string& value)
+{
+    return !is_missing(value) ? static_cast<int>(parse_integer_value(value)) : bcf_int32_missing;
+}
+
+float to_bcf_float(const std::string& value)
+{
+    return !is_missing(value) ? static_cast<float>(parse_real_value(value)) : get_bcf_float_missing();
+}
+
+void set_info(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source, std::string& str_buffer)
 {
     for (const auto& key : source.info_keys()) {
         const auto& values    = source.info_value(key);
@@ -689,24 +817,21 @@ void set_info(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source)
             case BCF_HT_INT:
             {
                 bc::small_vector<int, defaultBufferCapacity> vals(num_values);
-                std::transform(std::cbegin(values), std::cend(values), std::begin(vals),
-                               [] (const auto& v) { return !is_missing(v) ? std::stoi(v) : bcf_int32_missing; });
+                std::transform(std::cbegin(values), std::cend(values), std::begin(vals), to_bcf_int);
                 bcf_update_info_int32(header, dest, key.c_str(), vals.data(), num_values);
                 break;
             }
             case BCF_HT_REAL:
             {
                 bc::small_vector<float, defaultBufferCapacity> vals(num_values);
-                std::transform(std::cbegin(values), std::cend(values), std::begin(vals),
-                               [] (const auto& v) { return !is_missing(v) ? std::stof(v) : get_bcf_float_missing(); });
+                std::transform(std::cbegin(values), std::cend(values), std::begin(vals), to_bcf_float);
                 bcf_update_info_float(header, dest, key.c_str(), vals.data(), num_values);
                 break;
             }
             case BCF_HT_STR:
             {
-                // Can we also use small_vector here?
-                const auto vals = utils::join(values, vcfspec::info::valueSeperator);
-                bcf_update_info_string(header, dest, key.c_str(), vals.c_str());
+                join(values, vcfspec::info::valueSeperator, str_buffer);
+                bcf_update_info_string(header, dest, key.c_str(), str_buffer.c_str());
                 break;
             }
             case BCF_HT_FLAG:
@@ -876,7 +1001,7 @@ float get_bcf_float_pad() noexcept
 }
 
 void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
-                 const std::vector<std::string>& samples)
+                 const std::vector<std::string>& samples, std::vector<std::string>& str_buffer)
 {
     if (samples.empty()) return;
     const auto num_samples = static_cast<int>(source.num_samples());
@@ -905,7 +1030,6 @@ void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
         bcf_update_genotypes(header, dest, genotypes.data(), ngt);
         ++first_format;
     }
-    std::vector<std::string> str_buffer {};
     std::for_each(first_format, std::cend(format), [&] (const auto& key) {
         const auto key_cardinality = source.format_cardinality(key);
         int num_values {};
@@ -924,8 +1048,7 @@ void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
               auto value_itr = std::begin(typed_values);
               for (const auto& sample : samples) {
                   const auto& values = source.get_sample_value(sample, key);
-                  value_itr = std::transform(std::cbegin(values), std::cend(values), value_itr,
-                                             [] (const auto& v) { return !is_missing(v) ? std::stoi(v) : bcf_int32_missing; });
+                  value_itr = std::transform(std::cbegin(values), std::cend(values), value_itr, to_bcf_int);
                   assert(values.size() <= num_values_per_sample);
                   value_itr = std::fill_n(value_itr, num_values_per_sample - values.size(), pad);
               }
@@ -939,8 +1062,7 @@ void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
               auto value_itr = std::begin(typed_values);
               for (const auto& sample : samples) {
                   const auto& values = source.get_sample_value(sample, key);
-                  value_itr = std::transform(std::cbegin(values), std::cend(values), value_itr,
-                                             [] (const auto& v) { return !is_missing(v) ? std::stof(v) : get_bcf_float_missing(); });
+                  value_itr = std::transform(std::cbegin(values), std::cend(values), value_itr, to_bcf_float);
                   assert(values.size() <= num_values_per_sample);
                   value_itr = std::fill_n(value_itr, num_values_per_sample - values.size(), pad);
               }
@@ -959,14 +1081,15 @@ void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
                                                  [] (const auto& value) { return value.c_str(); });
                   }
               } else {
-                  str_buffer.clear();
-                  str_buffer.reserve(num_samples);
+                  // Keep the joined strings (and their capacity) around for the next key and record
+                  if (str_buffer.size() < samples.size()) str_buffer.resize(samples.size());
+                  auto buffer_itr = std::begin(str_buffer);
                   for (const auto& sample : samples) {
-                      str_buffer.push_back(utils::join(source.get_sample_value(sample, key), vcfspec::format::valueSeperator));
+                      join(source.get_sample_value(sample, key), vcfspec::format::valueSeperator, *buffer_itr++);
                   }
                   num_values = num_samples;
                   typed_values.resize(num_values);
-                  std::transform(std::cbegin(str_buffer), std::cend(str_buffer), std::begin(typed_values),
+                  std::transform(std::cbegin(str_buffer), buffer_itr, std::begin(typed_values),
                                  [] (const auto& value) { return value.c_str(); });
               }
               bcf_update_format_string(header, dest, key.c_str(), typed_values.data(), num_values);
@@ -992,16 +1115,21 @@ std::size_t HtslibBcfFacade::count_records(HtsBcfSrPtr& sr) const
 VcfRecord HtslibBcfFacade::fetch_record(const bcf_srs_t* sr, UnpackPolicy level) const
 {
     auto hts_record = bcf_sr_get_line(sr, 0);
-    bcf_unpack(hts_record, level == UnpackPolicy::all ? BCF_UN_ALL : BCF_UN_SHR);
+    switch (level) {
+        case UnpackPolicy::all: bcf_unpack(hts_record, BCF_UN_ALL); break;
+        case UnpackPolicy::sites: bcf_unpack(hts_record, BCF_UN_SHR); break;
+        case UnpackPolicy::candidates: bcf_unpack(hts_record, BCF_UN_STR | BCF_UN_FLT); break;
+    }
     VcfRecord::Builder record_builder {};
     if (reference_) record_builder = VcfRecord::Builder {*reference_};
     extract_chrom(header_.get(), hts_record, record_builder);
     extract_pos(hts_record, record_builder);
-    extract_id(hts_record, record_builder);
+    if (level != UnpackPolicy::candidates) extract_id(hts_record, record_builder);
     extract_ref(hts_record, record_builder);
     extract_alt(hts_record, record_builder);
     extract_qual(hts_record, record_builder);
     extract_filter(header_.get(), hts_record, record_builder);
+    if (level == UnpackPolicy::candidates) return record_builder.build_once();
     extract_info(header_.get(), hts_record, record_builder);
     if (level == UnpackPolicy::all && has_samples(header_.get())) {
         extract_samples(header_.get(), hts_record, record_builder);
@@ -11,10 +11,12 @@
 #include <iterator>
 
 #include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
 
 #include "htslib/hts.h"
 #include "htslib/vcf.h"
 #include "htslib/synced_bcf_reader.h"
+#include "htslib/thread_pool.h"
 
 #include "vcf_reader_impl.hpp"
 #include "vcf_record.hpp"
@@ -25,6 +27,37 @@ class GenomicRegion;
 class VcfHeader;
 class ReferenceGenome;
 
+// A thread pool shared by compressed (.vcf.gz & .bcf) writers for BGZF compression
+class HtslibEncodingContext
+{
+public:
+    HtslibEncodingContext() = delete;
+    
+    HtslibEncodingContext(unsigned num_threads);
+    
+    HtslibEncodingContext(const HtslibEncodingContext&)            = delete;
+    HtslibEncodingContext& operator=(const HtslibEncodingContext&) = delete;
+    HtslibEncodingContext(HtslibEncodingContext&&)                 = delete;
+    HtslibEncodingContext& operator=(HtslibEncodingContext&&)      = delete;
+    
+    ~HtslibEncodingContext() = default;
+    
+    unsigned num_threads() const noexcept;
+    
+    // Must be called before anything is written to the file
+    void attach(htsFile* file);
+    
+private:
+    struct HtsThreadPoolDeleter
+    {
+        void operator()(hts_tpool* pool) const { hts_tpool_destroy(pool); }
+    };
+    
+    unsigned num_threads_;
+    std::unique_ptr<hts_tpool, HtsThreadPoolDeleter> pool_;
+    htsThreadPool hts_pool_;
+};
+
 class HtslibBcfFacade : public IVcfReaderImpl
 {
 public:
@@ -38,6 +71,8 @@ public:
     
     HtslibBcfFacade(); // write only, goes to stdout
     HtslibBcfFacade(Path file_path, Mode mode = Mode::read);
+    // The encoding context is only used by compressed writers, and must outlive the facade
+    HtslibBcfFacade(Path file_path, Mode mode, std::shared_ptr<HtslibEncodingContext> encoding_context);
     
     HtslibBcfFacade(const HtslibBcfFacade&)            = delete;
     HtslibBcfFacade& operator=(const HtslibBcfFacade&) = delete;
@@ -66,6 +101,14 @@ public:
     
     void write(const VcfHeader& header);
     void write(const VcfRecord& record);
+    // Appends every record of the VCF/BCF file source without converting them to VcfRecord. All
+    // contigs and fields used by the records must be defined in the written header.
+    void write_records(const Path& source);
+    
+    // New compressed files are indexed as they are written, so no second pass over the file is
+    // needed. Writes the index and returns true if the file has one; the file must not be written
+    // to afterwards.
+    bool save_index() noexcept;
     
 private:
     struct HtsFileDeleter
@@ -88,13 +131,23 @@ private:
     using HtsBcfSrPtr = std::unique_ptr<bcf_srs_t, HtsSrsDeleter>;
     using HtsBcf1Ptr  = std::unique_ptr<bcf1_t, HtsBcf1Deleter>;
     
+    // Declared before file_ so that the file is closed (and all blocks flushed) before the pool is released
+    std::shared_ptr<HtslibEncodingContext> encoding_context_;
     Path file_path_;
+    bool index_on_write_;
+    boost::optional<Path> index_path_; // the index being built as records are written
     std::unique_ptr<htsFile, HtsFileDeleter> file_;
     std::unique_ptr<bcf_hdr_t, HtsHeaderDeleter> header_;
     std::vector<std::string> samples_;
     const ReferenceGenome* reference_;
+    // Reused by write(const VcfRecord&) so htslib's record storage and the string value
+    // buffers are only allocated once per file rather than once per record
+    HtsBcf1Ptr write_record_;
+    std::string info_buffer_;
+    std::vector<std::string> format_buffers_;
     
     bool is_bcf() const noexcept;
+    void init_index();
     std::size_t count_records(HtsBcfSrPtr& sr) const;
     VcfRecord fetch_record(const bcf_srs_t* sr, UnpackPolicy level) const;
     RecordContainer fetch_records(bcf_srs_t*, UnpackPolicy level, size_t num_records) const;
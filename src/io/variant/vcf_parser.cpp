@@ -3,20 +3,22 @@
 
 #include "vcf_parser.hpp"
 
+#include <fstream>
+#include <sstream>
 #include <algorithm>
+#include <numeric>
+#include <utility>
 #include <stdexcept>
+#include <cstring>
 
 #include <boost/optional.hpp>
-#include <boost/lexical_cast.hpp>
 
 #include "basics/genomic_region.hpp"
 #include "exceptions/file_open_error.hpp"
 
 namespace octopus {
 
-VcfHeader parse_header(std::ifstream& vcf_file);
-bool overlaps(const std::string& line, const GenomicRegion& region);
-VcfRecord parse_record(const std::string& line, const std::vector<VcfRecord::SampleName>& samples = {});
+namespace {
 
 template <char Delim>
 struct Token
@@ -32,131 +34,8 @@ std::istream& operator>>(std::istream& str, Token<Delim>& data)
     return str;
 }
 
-using Line   = Token<'\n'>;
 using Column = Token<'\t'>;
 
-// public methods
-
-VcfParser::VcfParser(const fs::path& file_path)
-: file_path_ {file_path}
-, file_ {file_path_.string()}
-, header_ {parse_header(file_)}
-, samples_ {header_.samples()}
-, first_record_pos_ {file_.tellg()}
-{
-    if (!file_.is_open()) {
-        throw FileOpenError {file_path_, "vcf"};
-    }
-}
-
-bool VcfParser::is_header_written() const noexcept
-{
-    return true; // always the case as can only read
-}
-
-VcfHeader VcfParser::fetch_header() const
-{
-    return header_;
-}
-
-std::size_t VcfParser::count_records() const
-{
-    const auto result = std::count_if(std::istreambuf_iterator<char>(file_), std::istreambuf_iterator<char>(),
-                                      [] (char c) { return c == '\n'; });
-    reset_vcf();
-    return result;
-}
-
-std::size_t VcfParser::count_records(const std::string& contig) const
-{
-    const auto result = std::count_if(std::istream_iterator<Line>(file_), std::istream_iterator<Line>(),
-                                      [&contig] (const auto& line) { return is_same_contig(line, contig); });
-    reset_vcf();
-    return result;
-}
-
-std::size_t VcfParser::count_records(const GenomicRegion& region) const
-{
-    const auto result = std::count_if(std::istream_iterator<Line>(file_), std::istream_iterator<Line>(),
-                                      [&region] (const auto& line) { return overlaps(line, region); });
-    reset_vcf();
-    return result;
-}
-
-VcfParser::RecordIteratorPtrPair VcfParser::iterate(UnpackPolicy level) const
-{
-    reset_vcf();
-    return std::make_pair(std::make_unique<RecordIterator>(*this, level),
-                          std::make_unique<RecordIterator>());
-}
-
-VcfParser::RecordIteratorPtrPair VcfParser::iterate(const std::string& contig, UnpackPolicy level) const
-{
-    reset_vcf();
-    return std::make_pair(std::make_unique<RecordIterator>(*this, level, contig),
-                          std::make_unique<RecordIterator>());
-}
-
-VcfParser::RecordIteratorPtrPair VcfParser::iterate(const GenomicRegion& region, const UnpackPolicy level) const
-{
-    reset_vcf();
-    return std::make_pair(std::make_unique<RecordIterator>(*this, level, region),
-                          std::make_unique<RecordIterator>());
-}
-
-VcfParser::RecordContainer VcfParser::fetch_records(const UnpackPolicy level) const
-{
-    RecordContainer result {};
-    result.reserve(count_records());
-    bool unpack_all {level == UnpackPolicy::all};
-    std::transform(std::istream_iterator<Line>(file_), std::istream_iterator<Line>(),
-                   std::back_inserter(result), [this, unpack_all] (const auto& line) {
-                       return (unpack_all) ? parse_record(line, samples_) : parse_record(line);
-                   });
-    reset_vcf();
-    return result;
-}
-
-VcfParser::RecordContainer VcfParser::fetch_records(const std::string& contig, const UnpackPolicy level) const
-{
-    RecordContainer result {};
-    result.reserve(count_records(contig));
-    bool unpack_all {level == UnpackPolicy::all};
-    std::for_each(std::istream_iterator<Line>(file_), std::istream_iterator<Line>(),
-                  [this, &result, &contig, unpack_all] (const auto& line) {
-                      if (is_same_contig(line, contig)) {
-                          result.push_back((unpack_all) ? parse_record(line, samples_) : parse_record(line));
-                      }
-                  });
-    reset_vcf();
-    return result;
-}
-
-VcfParser::RecordContainer VcfParser::fetch_records(const GenomicRegion& region, const UnpackPolicy level) const
-{
-    RecordContainer result {};
-    result.reserve(count_records(region));
-    bool unpack_all {level == UnpackPolicy::all};
-    std::for_each(std::istream_iterator<Line>(file_), std::istream_iterator<Line>(),
-                  [this, &result, &region, unpack_all] (const std::string& line) {
-                      if (overlaps(line, region)) {
-                          result.push_back((unpack_all) ? parse_record(line, samples_) : parse_record(line));
-                      }
-                  });
-    reset_vcf();
-    return result;
-}
-
-// private methods
-
-void VcfParser::reset_vcf() const
-{
-    file_.clear();
-    file_.seekg(first_record_pos_);
-}
-
-// non-member methods
-
 using Field = Token<','>;
 
 // A field looks like key=value, fields are delimited with ',' e.g. keyA=valueA,...,keyB=valueB.
@@ -269,220 +148,485 @@ VcfHeader parse_header(std::ifstream& vcf_file)
     return hb.build_once();
 }
 
-bool is_same_contig(const std::string& line, const std::string& contig)
+// Record lines are scanned with std::memchr, which the C library implements with vector instructions
+
+using CharIterator = const char*;
+
+struct Span
 {
-    std::istringstream ss {line};
-    std::istream_iterator<Column> it {ss};
-    return it->data == contig;
+    CharIterator first, last;
+};
+
+std::size_t size(const Span& span) noexcept
+{
+    return static_cast<std::size_t>(span.last - span.first);
 }
 
-bool overlaps(const std::string& line, const GenomicRegion& region)
+bool empty(const Span& span) noexcept
 {
-    std::istringstream ss {line};
-    std::istream_iterator<Column> it {ss};
-    if (it->data != region.contig_name()) return false; // CHROM
-    std::advance(it, 1); // POS
-    const auto begin = std::stol(it->data);
-    std::advance(it, 2); // REF
-    const auto end = begin + static_cast<long>(it->data.length());
-    return (std::min(static_cast<long>(region.end()), end) -
-                std::max(static_cast<long>(region.begin()), begin)) > 0;
+    return span.first == span.last;
 }
 
-std::vector<std::string> split(const std::string& str, char delim = ',')
+std::string to_string(const Span& span)
 {
-    std::stringstream ss {str};
-    std::string item;
-    std::vector<std::string> result {};
-    result.reserve(std::count(std::cbegin(str), std::cend(str), delim) + 1);
-    while (std::getline(ss, item, delim)) {
-        result.emplace_back(item);
-    }
-    return result;
+    return {span.first, span.last};
 }
 
-void parse_info_field(const std::string& field, VcfRecord::Builder& rb)
+bool operator==(const Span& lhs, const std::string& rhs) noexcept
 {
-    const auto pos = field.find_first_of('=');
-    if (pos == std::string::npos) {
-        rb.set_info_flag(field);
-    } else {
-        rb.set_info(field.substr(0, pos), split(field.substr(pos + 1), ','));
-    }
+    return size(lhs) == rhs.size() && std::equal(lhs.first, lhs.last, std::cbegin(rhs));
 }
 
-using InfoField = Token<';'>;
+bool is_missing(const Span& span) noexcept
+{
+    return size(span) == 1 && *span.first == '.';
+}
 
-void parse_info(const std::string& column, VcfRecord::Builder& rb)
+CharIterator find(CharIterator first, CharIterator last, const char delim) noexcept
 {
-    std::istringstream ss {column};
-    std::for_each(std::istream_iterator<InfoField>(ss), std::istream_iterator<InfoField>(),
-                  [&rb] (const auto& field) {
-                      parse_info_field(field, rb);
-                  });
+    if (first == last) return last;
+    const auto result = static_cast<CharIterator>(std::memchr(first, delim, static_cast<std::size_t>(last - first)));
+    return result != nullptr ? result : last;
 }
 
-bool is_phased(const std::string& genotype)
+CharIterator find_line_end(CharIterator first, CharIterator last) noexcept
 {
-    const auto pos = genotype.find_first_of("|/");
-    if (pos == std::string::npos) {
-        return true; // must be haploid
+    return find(first, last, '\n');
+}
+
+// Visits each delim separated token of span from left to right, stopping early if f returns false
+template <typename F>
+void for_each_token(const Span& span, const char delim, F f)
+{
+    auto first = span.first;
+    while (true) {
+        const auto token_end = find(first, span.last, delim);
+        if (!f(Span {first, token_end}) || token_end == span.last) break;
+        first = std::next(token_end);
     }
-    return genotype[pos] == '|';
 }
 
-void parse_genotype(const VcfRecord::SampleName& sample, const std::string& genotype,
-                    VcfRecord::Builder& rb)
+std::vector<std::string> split(const Span& span, const char delim)
 {
-    const bool phased {is_phased(genotype)};
-    auto allele_numbers = split(genotype, (phased) ? '|' : '/');
-    using Phasing = VcfRecord::Builder::Phasing;
-    std::vector<boost::optional<unsigned>> alleles {};
-    const auto ploidy = allele_numbers.size();
-    alleles.reserve(ploidy);
+    std::vector<std::string> result {};
+    result.reserve(std::count(span.first, span.last, delim) + 1);
+    for_each_token(span, delim, [&] (const Span& token) { result.push_back(to_string(token)); return true; });
+    return result;
+}
+
+// Splits a record line into its tab delimited columns
+class ColumnCursor
+{
+public:
+    ColumnCursor(CharIterator first, CharIterator last) noexcept : next_ {first}, last_ {last}, done_ {false} {}
     
-    std::transform(std::cbegin(allele_numbers), std::cend(allele_numbers), std::back_inserter(alleles),
-                   [] (const auto& a) -> boost::optional<unsigned> {
-                       try {
-                           return boost::lexical_cast<unsigned>(a);
-                       } catch (const boost::bad_lexical_cast&) {
-                           return boost::none;
-                       }
-                   });
+    bool done() const noexcept { return done_; }
     
-    rb.set_genotype(sample, std::move(alleles), (phased) ? Phasing::phased : Phasing::unphased);
-}
+    // Returns an empty span once all columns have been visited
+    Span next() noexcept
+    {
+        if (done_) return {last_, last_};
+        const auto first = next_;
+        const auto column_end = find(first, last_, '\t');
+        if (column_end == last_) {
+            done_ = true;
+        } else {
+            next_ = std::next(column_end);
+        }
+        return {first, column_end};
+    }
+    
+private:
+    CharIterator next_, last_;
+    bool done_;
+};
 
-using SampleField = Token<':'>;
+GenomicRegion::Position parse_position(const Span& column)
+{
+    if (empty(column)) throw std::runtime_error {"VcfParser: missing POS"};
+    GenomicRegion::Position result {0};
+    std::for_each(column.first, column.last, [&] (const char c) {
+        if (c < '0' || c > '9') throw std::runtime_error {"VcfParser: bad POS " + to_string(column)};
+        result = 10 * result + static_cast<GenomicRegion::Position>(c - '0');
+    });
+    return result;
+}
 
-void parse_sample(const std::string& column, const VcfRecord::SampleName& sample,
-                  const std::vector<std::string>& format, VcfRecord::Builder& rb)
+boost::optional<unsigned> parse_allele_number(const Span& token) noexcept
 {
-    auto first_key = std::cbegin(format);
-    std::istringstream ss {column};
-    std::istream_iterator<SampleField> first_value {ss};
-    if (format.front() == "GT") { // GT must always come first, if present
-        parse_genotype(sample, *first_value, rb);
-        ++first_key;
-        ++first_value;
+    if (empty(token)) return boost::none;
+    unsigned result {0};
+    for (auto itr = token.first; itr != token.last; ++itr) {
+        if (*itr < '0' || *itr > '9') return boost::none;
+        result = 10 * result + static_cast<unsigned>(*itr - '0');
     }
-    std::for_each(first_value, std::istream_iterator<SampleField> {},
-                  [&rb, &sample, &first_key] (const std::string& value) {
-                      rb.set_format(sample, *first_key, split(value, ','));
-                      ++first_key;
-                  });
+    return result;
 }
 
-VcfRecord parse_record(const std::string& line, const std::vector<VcfRecord::SampleName>& samples)
+// The mapped region of the record on the line, i.e. [POS - 1, POS - 1 + len(REF))
+struct Site
 {
-    std::istringstream ss {line};
-    std::istream_iterator<Column> it {ss}, eos {};
-    VcfRecord::Builder rb {};
-    
-    rb.set_chrom(it->data);
-    ++it;
-    rb.set_pos(static_cast<GenomicRegion::Position>(std::stol(it->data)));
-    ++it;
-    rb.set_id(it->data);
-    ++it;
-    rb.set_ref(it->data);
-    ++it;
-    rb.set_alt(split(it->data, ','));
-    ++it;
-    
-    if (it->data == ".") {
+    Span contig;
+    ContigRegion region;
+};
+
+Site parse_site(CharIterator line, CharIterator line_end)
+{
+    ColumnCursor columns {line, line_end};
+    const auto contig = columns.next();
+    const auto pos = parse_position(columns.next());
+    if (pos == 0) throw std::runtime_error {"VcfParser: bad POS 0"};
+    columns.next(); // ID
+    const auto ref_size = static_cast<ContigRegion::Position>(size(columns.next()));
+    return {contig, ContigRegion {pos - 1, pos - 1 + ref_size}};
+}
+
+bool overlaps(const Site& site, const GenomicRegion& region) noexcept
+{
+    return site.contig == region.contig_name() && overlaps(site.region, region.contig_region());
+}
+
+void parse_qual(const Span& column, VcfRecord::Builder& rb)
+{
+    if (is_missing(column)) {
         rb.set_qual(0);
     } else {
         try {
-            rb.set_qual(static_cast<VcfRecord::QualityType>(std::stod(it->data)));
+            rb.set_qual(static_cast<VcfRecord::QualityType>(std::stod(to_string(column))));
         } catch (const std::invalid_argument& e) {
             rb.set_qual(0); // or should throw?
         }
     }
-    
-    ++it;
-    if (it->data != ".") {
-        rb.set_filter(split(it->data, ';'));
+}
+
+void parse_info(const Span& column, VcfRecord::Builder& rb)
+{
+    if (empty(column) || is_missing(column)) return;
+    for_each_token(column, ';', [&rb] (const Span& field) {
+        const auto value_begin = find(field.first, field.last, '=');
+        if (value_begin == field.last) {
+            if (!empty(field)) rb.set_info_flag(to_string(field));
+        } else {
+            rb.set_info(std::string {field.first, value_begin}, split(Span {std::next(value_begin), field.last}, ','));
+        }
+        return true;
+    });
+}
+
+bool is_phased(const Span& genotype) noexcept
+{
+    const auto itr = std::find_if(genotype.first, genotype.last, [] (const char c) { return c == '|' || c == '/'; });
+    return itr == genotype.last || *itr == '|'; // must be haploid if no separator
+}
+
+void parse_genotype(const VcfRecord::SampleName& sample, const Span& genotype, VcfRecord::Builder& rb)
+{
+    using Phasing = VcfRecord::Builder::Phasing;
+    const bool phased {is_phased(genotype)};
+    std::vector<boost::optional<unsigned>> alleles {};
+    alleles.reserve(std::count(genotype.first, genotype.last, phased ? '|' : '/') + 1);
+    for_each_token(genotype, phased ? '|' : '/', [&alleles] (const Span& allele) {
+        alleles.push_back(parse_allele_number(allele));
+        return true;
+    });
+    rb.set_genotype(sample, std::move(alleles), (phased) ? Phasing::phased : Phasing::unphased);
+}
+
+void parse_sample(const Span& column, const VcfRecord::SampleName& sample,
+                  const std::vector<std::string>& format, VcfRecord::Builder& rb)
+{
+    if (format.empty()) return;
+    auto key_itr = std::cbegin(format);
+    const bool has_genotype {format.front() == "GT"}; // GT must always come first, if present
+    for_each_token(column, ':', [&] (const Span& value) {
+        if (has_genotype && key_itr == std::cbegin(format)) {
+            parse_genotype(sample, value, rb);
+        } else {
+            rb.set_format(sample, *key_itr, split(value, ','));
+        }
+        return ++key_itr != std::cend(format);
+    });
+}
+
+VcfRecord parse_record(CharIterator line, CharIterator line_end, const IVcfReaderImpl::UnpackPolicy unpack,
+                       const std::vector<VcfRecord::SampleName>& samples)
+{
+    using UnpackPolicy = IVcfReaderImpl::UnpackPolicy;
+    ColumnCursor columns {line, line_end};
+    VcfRecord::Builder rb {};
+    rb.set_chrom(to_string(columns.next()));
+    rb.set_pos(parse_position(columns.next()));
+    const auto id = columns.next();
+    if (unpack != UnpackPolicy::candidates) rb.set_id(to_string(id));
+    rb.set_ref(to_string(columns.next()));
+    rb.set_alt(split(columns.next(), ','));
+    parse_qual(columns.next(), rb);
+    const auto filter = columns.next();
+    if (!empty(filter) && !is_missing(filter)) {
+        rb.set_filter(split(filter, ';'));
     }
-    ++it;
-    parse_info(it->data, rb);
-    ++it;
-    
-    if (!samples.empty() && it != eos) {
-        auto format = split(it->data, ':');
-        ++it;
+    // The remaining columns are never scanned unless they are requested
+    if (unpack == UnpackPolicy::candidates) return rb.build_once();
+    parse_info(columns.next(), rb);
+    if (unpack == UnpackPolicy::all && !samples.empty() && !columns.done()) {
+        auto format = split(columns.next(), ':');
         for (const auto& sample : samples) {
-            parse_sample(it->data, sample, format, rb); // set after so can move
-            ++it;
+            if (columns.done()) break;
+            parse_sample(columns.next(), sample, format, rb); // set after so can move
         }
         rb.set_format(std::move(format));
     }
-    
     return rb.build_once();
 }
 
+// Small enough that a region query scans few records outside the region, but large enough that the
+// index is tiny compared with the file
+constexpr std::size_t maxRecordBlockSize {1024};
+
+} // namespace
+
+// public methods
+
+VcfParser::VcfParser(const fs::path& file_path)
+: file_path_ {file_path}
+, file_ {}
+, header_ {}
+, samples_ {}
+, first_record_offset_ {}
+, index_ {}
+, is_indexed_ {false}
+{
+    std::ifstream header_file {file_path_.string()};
+    if (!header_file.is_open()) {
+        throw FileOpenError {file_path_, "vcf"};
+    }
+    header_ = parse_header(header_file);
+    samples_ = header_.samples();
+    const auto header_end = header_file.tellg();
+    file_ = MappedFile {file_path_};
+    if (!file_.is_open()) {
+        throw FileOpenError {file_path_, "vcf"};
+    }
+    // tellg fails if the column names line is the last line and has no newline
+    first_record_offset_ = header_end != std::streampos {-1} ? static_cast<std::size_t>(header_end) : file_.size();
+    first_record_offset_ = std::min(first_record_offset_, file_.size());
+}
+
+bool VcfParser::is_header_written() const noexcept
+{
+    return true; // always the case as can only read
+}
+
+VcfHeader VcfParser::fetch_header() const
+{
+    return header_;
+}
+
+std::size_t VcfParser::count_records() const
+{
+    index_records();
+    return std::accumulate(std::cbegin(index_), std::cend(index_), std::size_t {0},
+                           [] (auto curr, const auto& block) { return curr + block.num_records; });
+}
+
+std::size_t VcfParser::count_records(const std::string& contig) const
+{
+    const auto blocks = find_blocks(contig);
+    return std::accumulate(std::cbegin(blocks), std::cend(blocks), std::size_t {0},
+                           [] (auto curr, const auto block) { return curr + block->num_records; });
+}
+
+std::size_t VcfParser::count_records(const GenomicRegion& region) const
+{
+    std::size_t result {0};
+    for (const auto block : find_blocks(region)) {
+        const auto last = record_data(block->end);
+        for (auto line = record_data(block->begin); line < last;) {
+            const auto line_end = find_line_end(line, last);
+            if (line != line_end && overlaps(parse_site(line, line_end), region)) ++result;
+            line = line_end == last ? last : std::next(line_end);
+        }
+    }
+    return result;
+}
+
+VcfParser::RecordIteratorPtrPair VcfParser::iterate(UnpackPolicy level) const
+{
+    return std::make_pair(std::make_unique<RecordIterator>(*this, level),
+                          std::make_unique<RecordIterator>());
+}
+
+VcfParser::RecordIteratorPtrPair VcfParser::iterate(const std::string& contig, UnpackPolicy level) const
+{
+    return std::make_pair(std::make_unique<RecordIterator>(*this, level, contig),
+                          std::make_unique<RecordIterator>());
+}
+
+VcfParser::RecordIteratorPtrPair VcfParser::iterate(const GenomicRegion& region, const UnpackPolicy level) const
+{
+    return std::make_pair(std::make_unique<RecordIterator>(*this, level, region),
+                          std::make_unique<RecordIterator>());
+}
+
+namespace {
+
+template <typename Iterator>
+VcfParser::RecordContainer collect_records(Iterator first, const std::size_t num_records)
+{
+    VcfParser::RecordContainer result {};
+    result.reserve(num_records);
+    for (const Iterator last {}; first != last; ++first) {
+        result.push_back(std::move(*first));
+    }
+    return result;
+}
+
+} // namespace
+
+VcfParser::RecordContainer VcfParser::fetch_records(const UnpackPolicy level) const
+{
+    return collect_records(RecordIterator {*this, level}, count_records());
+}
+
+VcfParser::RecordContainer VcfParser::fetch_records(const std::string& contig, const UnpackPolicy level) const
+{
+    return collect_records(RecordIterator {*this, level, contig}, count_records(contig));
+}
+
+VcfParser::RecordContainer VcfParser::fetch_records(const GenomicRegion& region, const UnpackPolicy level) const
+{
+    return collect_records(RecordIterator {*this, level, region}, count_records(region));
+}
+
+// private methods
+
+void VcfParser::index_records() const
+{
+    if (is_indexed_) return;
+    index_.clear();
+    const auto last = record_data(file_.size());
+    for (auto line = record_data(first_record_offset_); line < last;) {
+        const auto line_end = find_line_end(line, last);
+        const auto next_line = line_end == last ? last : std::next(line_end);
+        if (line != line_end) {
+            const auto site = parse_site(line, line_end);
+            if (index_.empty() || index_.back().num_records == maxRecordBlockSize || !(site.contig == index_.back().contig)) {
+                const auto offset = static_cast<std::size_t>(line - file_.data());
+                index_.push_back({to_string(site.contig), offset, offset, 0, site.region.begin(), site.region.end()});
+            }
+            auto& block = index_.back();
+            block.end = static_cast<std::size_t>(next_line - file_.data());
+            ++block.num_records;
+            block.min_begin = std::min(block.min_begin, site.region.begin());
+            block.max_end = std::max(block.max_end, site.region.end());
+        }
+        line = next_line;
+    }
+    index_.shrink_to_fit();
+    is_indexed_ = true;
+}
+
+std::vector<const VcfParser::RecordBlock*> VcfParser::find_blocks(const std::string& contig) const
+{
+    index_records();
+    std::vector<const RecordBlock*> result {};
+    for (const auto& block : index_) {
+        if (block.contig == contig) result.push_back(&block);
+    }
+    return result;
+}
+
+std::vector<const VcfParser::RecordBlock*> VcfParser::find_blocks(const GenomicRegion& region) const
+{
+    index_records();
+    std::vector<const RecordBlock*> result {};
+    for (const auto& block : index_) {
+        // Conservative so that records with empty regions are never missed
+        if (block.contig == region.contig_name() && block.min_begin <= region.end() && block.max_end >= region.begin()) {
+            result.push_back(&block);
+        }
+    }
+    return result;
+}
+
+const char* VcfParser::record_data(const std::size_t offset) const noexcept
+{
+    return file_.data() + offset;
+}
+
 // VcfParser::RecordIterator
 
-VcfParser::RecordIterator::RecordIterator(const VcfParser& vcf, UnpackPolicy unpack)
-: parent_vcf_ {&vcf}
+namespace {
+
+template <typename Blocks>
+std::pair<std::size_t, std::size_t> get_span(const Blocks& blocks) noexcept
+{
+    if (blocks.empty()) return {0, 0};
+    return {blocks.front()->begin, blocks.back()->end};
+}
+
+} // namespace
+
+VcfParser::RecordIterator::RecordIterator(const VcfParser& vcf, UnpackPolicy unpack,
+                                          const char* first, const char* last)
+: record_ {nullptr}
+, parent_vcf_ {&vcf}
 , unpack_ {unpack}
-, local_ {vcf.file_path_.string()}
+, line_ {nullptr}
+, next_line_ {first}
+, last_ {last}
 , contig_ {}
 , region_ {}
+{}
+
+VcfParser::RecordIterator::RecordIterator(const VcfParser& vcf, UnpackPolicy unpack)
+: RecordIterator {vcf, unpack, vcf.record_data(vcf.first_record_offset_), vcf.record_data(vcf.file_.size())}
 {
-    local_.seekg(parent_vcf_->file_.tellg());
-    if (std::getline(local_, line_)) {
-        if (unpack_ == UnpackPolicy::all) {
-            record_ = std::make_shared<VcfRecord>(parse_record(line_, vcf.samples_));
-        } else {
-            record_ = std::make_shared<VcfRecord>(parse_record(line_));
-        }
-    } else {
-        record_ = nullptr;
-    }
+    next();
 }
 
 VcfParser::RecordIterator::RecordIterator(const VcfParser& vcf, UnpackPolicy unpack, std::string contig)
-: RecordIterator {vcf, unpack}
+: RecordIterator {vcf, unpack, nullptr, nullptr}
 {
+    const auto span = get_span(vcf.find_blocks(contig));
+    next_line_ = vcf.record_data(span.first);
+    last_ = vcf.record_data(span.second);
     contig_ = std::move(contig);
-    if (record_ && record_->chrom() != *contig_) {
-        next();
-    }
+    next();
 }
 
 VcfParser::RecordIterator::RecordIterator(const VcfParser& vcf, UnpackPolicy unpack, GenomicRegion region)
-: RecordIterator {vcf, unpack}
+: RecordIterator {vcf, unpack, nullptr, nullptr}
 {
+    const auto span = get_span(vcf.find_blocks(region));
+    next_line_ = vcf.record_data(span.first);
+    last_ = vcf.record_data(span.second);
     region_ = std::move(region);
-    if (record_ && !overlaps(*record_, *region_)) {
-        next();
-    }
+    next();
 }
 
 VcfParser::RecordIterator::RecordIterator(const RecordIterator& other)
-: parent_vcf_ {other.parent_vcf_}
+: record_ {other.record_ ? std::make_shared<VcfRecord>(*other.record_) : nullptr}
+, parent_vcf_ {other.parent_vcf_}
 , unpack_ {other.unpack_}
-, local_ {parent_vcf_->file_path_.string()}
-{
-    local_.seekg(parent_vcf_->file_.tellg());
-    if (std::getline(local_, line_)) {
-        if (unpack_ == UnpackPolicy::all) {
-            record_ = std::make_shared<VcfRecord>(parse_record(line_, parent_vcf_->samples_));
-        } else {
-            record_ = std::make_shared<VcfRecord>(parse_record(line_));
-        }
-    } else {
-        record_ = nullptr;
-    }
-}
+, line_ {other.line_}
+, next_line_ {other.next_line_}
+, last_ {other.last_}
+, contig_ {other.contig_}
+, region_ {other.region_}
+{}
 
 VcfParser::RecordIterator& VcfParser::RecordIterator::operator=(RecordIterator other)
 {
     using std::swap;
+    swap(record_,     other.record_);
     swap(parent_vcf_, other.parent_vcf_);
     swap(unpack_,     other.unpack_);
-    swap(local_,      other.local_);
+    swap(line_,       other.line_);
+    swap(next_line_,  other.next_line_);
+    swap(last_,       other.last_);
+    swap(contig_,     other.contig_);
+    swap(region_,     other.region_);
     return *this;
 }
 
@@ -498,19 +642,23 @@ VcfParser::RecordIterator::pointer VcfParser::RecordIterator::operator->() const
 
 void VcfParser::RecordIterator::next()
 {
-    while (std::getline(local_, line_) && !line_.empty()) {
-        if (unpack_ == UnpackPolicy::all) {
-            *record_ = parse_record(line_, parent_vcf_->samples_);
-        } else {
-            *record_ = parse_record(line_);
+    line_ = nullptr;
+    while (next_line_ < last_) {
+        const auto line = next_line_;
+        const auto line_end = find_line_end(line, last_);
+        next_line_ = line_end == last_ ? last_ : std::next(line_end);
+        if (line != line_end && is_selected(line, line_end)) {
+            auto record = parse_record(line, line_end, unpack_, parent_vcf_->samples_);
+            if (record_) {
+                *record_ = std::move(record);
+            } else {
+                record_ = std::make_shared<VcfRecord>(std::move(record));
+            }
+            line_ = line;
+            return;
         }
-        if (region_) {
-            if (!overlaps(*record_, *region_)) continue;
-        } else if (contig_) {
-            if (record_->chrom() != *contig_) continue;
-        }
-        break;
     }
+    record_ = nullptr;
 }
 
 VcfParser::RecordIterator& VcfParser::RecordIterator::operator++()
@@ -519,9 +667,20 @@ VcfParser::RecordIterator& VcfParser::RecordIterator::operator++()
     return *this;
 }
 
+bool VcfParser::RecordIterator::is_selected(const char* line, const char* line_end) const
+{
+    if (region_) {
+        return overlaps(parse_site(line, line_end), *region_);
+    } else if (contig_) {
+        return Span {line, find(line, line_end, '\t')} == *contig_;
+    } else {
+        return true;
+    }
+}
+
 bool operator==(const VcfParser::RecordIterator& lhs, const VcfParser::RecordIterator& rhs)
 {
-    return (!lhs.local_.good() && !rhs.local_.good()) || lhs.local_.tellg() == rhs.local_.tellg();
+    return lhs.line_ == rhs.line_;
 }
 
 bool operator!=(const VcfParser::RecordIterator& lhs, const VcfParser::RecordIterator& rhs)
@@ -7,13 +7,14 @@
 #include <vector>
 #include <string>
 #include <cstddef>
-#include <fstream>
 #include <iterator>
 #include <memory>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/optional.hpp>
 
+#include "basics/contig_region.hpp"
+#include "utils/system_utils.hpp"
 #include "vcf_reader_impl.hpp"
 #include "vcf_header.hpp"
 #include "vcf_record.hpp"
@@ -24,6 +25,10 @@ namespace fs = boost::filesystem;
 
 class GenomicRegion;
 
+// Reads uncompressed VCF files. Records are parsed straight from a memory mapping of the file, and
+// the first query builds a small in-memory index of the records (blocks of consecutive records on
+// the same contig, with the span of positions each block covers), so contig and region queries
+// only scan the blocks that can contain matching records.
 class VcfParser : public IVcfReaderImpl
 {
 public:
@@ -64,16 +69,26 @@ public:
     friend bool operator==(const RecordIterator& lhs, const RecordIterator& rhs);
     
 private:
-    fs::path file_path_;
-    
-    mutable std::ifstream file_;
+    struct RecordBlock
+    {
+        std::string contig;
+        std::size_t begin, end; // file offsets of the first line and one past the last line
+        std::size_t num_records;
+        ContigRegion::Position min_begin, max_end;
+    };
     
+    fs::path file_path_;
+    MappedFile file_;
     VcfHeader header_;
-    
     std::vector<std::string> samples_;
-    std::streampos first_record_pos_; // must go after header_!
-    
-    void reset_vcf() const; // logically const
+    std::size_t first_record_offset_;
+    mutable std::vector<RecordBlock> index_;
+    mutable bool is_indexed_;
+    
+    void index_records() const; // logically const
+    std::vector<const RecordBlock*> find_blocks(const std::string& contig) const;
+    std::vector<const RecordBlock*> find_blocks(const GenomicRegion& region) const;
+    const char* record_data(std::size_t offset) const noexcept;
 };
 
 class VcfParser::RecordIterator : public IVcfReaderImpl::RecordIterator
@@ -112,12 +127,18 @@ public:
     
 private:
     std::shared_ptr<VcfRecord> record_;
-    const VcfParser* parent_vcf_;
+    const VcfParser* parent_vcf_ = nullptr;
     UnpackPolicy unpack_;
-    mutable std::ifstream local_;
-    mutable std::string line_;
+    // line_ is the start of the current record's line, or nullptr once the iterator is exhausted
+    const char* line_ = nullptr;
+    const char* next_line_ = nullptr;
+    const char* last_ = nullptr;
     boost::optional<std::string> contig_;
     boost::optional<GenomicRegion> region_;
+    
+    RecordIterator(const VcfParser& vcf, UnpackPolicy unpack, const char* first, const char* last);
+    
+    bool is_selected(const char* line, const char* line_end) const;
 };
 
 bool operator!=(const VcfParser::RecordIterator& lhs, const VcfParser::RecordIterator& rhs);
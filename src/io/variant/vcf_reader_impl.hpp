@@ -20,7 +20,8 @@ class ReferenceGenome;
 class IVcfReaderImpl
 {
 public:
-    enum class UnpackPolicy { all, sites };
+    // candidates only unpacks CHROM, POS, REF, ALT, QUAL and FILTER
+    enum class UnpackPolicy { all, sites, candidates };
     
     using RecordContainer = std::vector<VcfRecord>;
     
@@ -5,6 +5,9 @@
 
 #include <algorithm>
 #include <iterator>
+#include <cstdlib>
+#include <cerrno>
+#include <stdexcept>
 
 #include <boost/lexical_cast.hpp>
 
@@ -354,6 +357,26 @@ bool is_info_missing(const VcfRecord::KeyType& key, const VcfRecord& record)
     return !record.has_info(key) || is_missing(record.info_value(key));
 }
 
+std::int64_t parse_integer_value(const VcfRecord::ValueType& value)
+{
+    char* end;
+    errno = 0;
+    const auto result = std::strtoll(value.c_str(), &end, 10);
+    if (end == value.c_str()) throw std::invalid_argument {"parse_integer_value: no conversion for '" + value + "'"};
+    if (errno == ERANGE) throw std::out_of_range {"parse_integer_value: '" + value + "' is out of range"};
+    return result;
+}
+
+double parse_real_value(const VcfRecord::ValueType& value)
+{
+    char* end;
+    errno = 0;
+    const auto result = std::strtod(value.c_str(), &end);
+    if (end == value.c_str()) throw std::invalid_argument {"parse_real_value: no conversion for '" + value + "'"};
+    if (errno == ERANGE) throw std::out_of_range {"parse_real_value: '" + value + "' is out of range"};
+    return result;
+}
+
 bool is_refcall(const VcfRecord& record)
 {
     return record.is_refcall();
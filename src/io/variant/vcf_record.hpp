@@ -13,6 +13,7 @@
 #include <utility>
 #include <initializer_list>
 #include <functional>
+#include <type_traits>
 
 #include <boost/optional.hpp>
 #include <boost/container/flat_map.hpp>
@@ -93,6 +94,8 @@ public:
     bool has_info(const KeyType& key) const noexcept;
     std::vector<KeyType> info_keys() const;
     const std::vector<ValueType>& info_value(const KeyType& key) const;
+    // Parses a numeric value in place; throws std::invalid_argument if the value is not a number
+    template <typename T> T info_value_as(const KeyType& key, std::size_t index = 0) const;
     
     //
     // Sample related functions
@@ -113,6 +116,7 @@ public:
     bool has_alt_allele(const SampleName& sample) const;
     const std::vector<AlleleIndex>& genotype(const SampleName& sample) const;
     const std::vector<ValueType>& get_sample_value(const SampleName& sample, const KeyType& key) const;
+    template <typename T> T get_sample_value_as(const SampleName& sample, const KeyType& key, std::size_t index = 0) const;
     
     friend std::ostream& operator<<(std::ostream& os, const VcfRecord& record);
     friend Builder;
@@ -162,6 +166,10 @@ std::vector<double> get_allele_frequency(const VcfRecord& record);
 
 bool is_info_missing(const VcfRecord::KeyType& key, const VcfRecord& record);
 
+// Number parsing with the semantics of std::stoll and std::stod
+std::int64_t parse_integer_value(const VcfRecord::ValueType& value);
+double parse_real_value(const VcfRecord::ValueType& value);
+
 bool is_refcall(const VcfRecord& record);
 bool is_filtered(const VcfRecord& record) noexcept;
 bool is_dbsnp_member(const VcfRecord& record) noexcept;
@@ -342,6 +350,36 @@ VcfRecord::VcfRecord(GenomicRegion region, String&& id,
 , samples_ {std::forward<Samples>(samples)}
 {}
 
+namespace detail {
+
+template <typename T>
+T parse_value(const VcfRecord::ValueType& value, std::true_type)
+{
+    return static_cast<T>(parse_integer_value(value));
+}
+
+template <typename T>
+T parse_value(const VcfRecord::ValueType& value, std::false_type)
+{
+    return static_cast<T>(parse_real_value(value));
+}
+
+} // namespace detail
+
+template <typename T>
+T VcfRecord::info_value_as(const KeyType& key, const std::size_t index) const
+{
+    static_assert(std::is_arithmetic<T>::value, "VcfRecord::info_value_as requires a numeric type");
+    return detail::parse_value<T>(info_value(key).at(index), std::is_integral<T> {});
+}
+
+template <typename T>
+T VcfRecord::get_sample_value_as(const SampleName& sample, const KeyType& key, const std::size_t index) const
+{
+    static_assert(std::is_arithmetic<T>::value, "VcfRecord::get_sample_value_as requires a numeric type");
+    return detail::parse_value<T>(get_sample_value(sample, key).at(index), std::is_integral<T> {});
+}
+
 template <typename T>
 VcfRecord::Builder& VcfRecord::Builder::set_info(const KeyType& key, const T& value)
 {
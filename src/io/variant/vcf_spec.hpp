@@ -121,6 +121,7 @@ VCF_SPEC_CONSTANT alleleReadDepthForward {"ADF"};
 VCF_SPEC_CONSTANT alleleReadDepthReverse {"ADR"};
 VCF_SPEC_CONSTANT combinedReadDepth {"DP"};
 VCF_SPEC_CONSTANT alleleFrequency {"AF"};
+VCF_SPEC_CONSTANT alleleCount {"AC"};
 VCF_SPEC_CONSTANT totalAlleleCount {"AN"};
 VCF_SPEC_CONSTANT rmsBaseQuality {"BQ"};
 VCF_SPEC_CONSTANT dbSNPMember {"DB"};
@@ -13,6 +13,8 @@
 #include <stdexcept>
 #include <numeric>
 
+#include <boost/optional.hpp>
+
 #include "htslib/vcf.h"
 #include "htslib/tbx.h"
 
@@ -38,6 +40,25 @@ unsigned get_field_cardinality(const VcfHeader::StructuredKey& key, const VcfRec
     return 0;
 }
 
+std::vector<std::vector<unsigned>> get_genotype_allele_indices(const unsigned num_alleles, const unsigned ploidy)
+{
+    // The last allele index varies slowest, e.g. 0/0, 0/1, 1/1, 0/2, 1/2, 2/2 for three diploid alleles
+    std::vector<std::vector<unsigned>> result {{}};
+    for (unsigned i {0}; i < ploidy; ++i) {
+        std::vector<std::vector<unsigned>> extended {};
+        for (unsigned allele {0}; allele < num_alleles; ++allele) {
+            for (const auto& genotype : result) {
+                if (genotype.empty() || genotype.back() <= allele) {
+                    extended.push_back(genotype);
+                    extended.back().push_back(allele);
+                }
+            }
+        }
+        result = std::move(extended);
+    }
+    return result;
+}
+
 std::vector<VcfType> get_typed_info_values(const VcfHeader& header, const VcfRecord& record,
                                            const VcfHeader::StructuredKey& key)
 {
@@ -249,29 +270,29 @@ bool is_one_contig_per_reader(const ReaderContigRecordCountMap& counts)
                        [] (const auto& p) { return count_active_contigs(p.second) == 1; });
 }
 
-auto find_active_contig(ContigRecordCountMap::const_iterator first, ContigRecordCountMap::const_iterator last)
-{
-    return std::find_if(first, last, [] (const auto& p) { return p.second > 0; });
-}
-
-bool is_unique_contig_per_reader(const ReaderContigRecordCountMap& counts)
+// The readers in the order they should be appended to the output, if the records of each contig are
+// in at most one reader, and the contigs with records in each reader are consecutive in contigs (as
+// for temporary files holding a batch of small contigs). Otherwise none.
+boost::optional<std::vector<VcfReaderRef>>
+get_contig_disjoint_readers(const ReaderContigRecordCountMap& counts, const std::vector<std::string>& contigs)
 {
-    std::deque<std::reference_wrapper<const std::string>> contigs {};
-    for (const auto& p : counts) {
-        const auto it = find_active_contig(std::cbegin(p.second), std::cend(p.second));
-        if (it != std::cend(p.second)) {
-            if (find_active_contig(std::next(it), std::cend(p.second)) != std::cend(p.second)) {
-                return false;
+    std::vector<VcfReaderRef> result {};
+    for (const auto& contig : contigs) {
+        boost::optional<VcfReaderRef> contig_reader {};
+        for (const auto& p : counts) {
+            const auto itr = p.second.find(contig);
+            if (itr != std::cend(p.second) && itr->second > 0) {
+                if (contig_reader) return boost::none;
+                contig_reader = p.first;
             }
-            contigs.emplace_back(it->first);
         }
+        if (!contig_reader) continue;
+        const auto is_contig_reader = [&] (const VcfReaderRef& reader) { return &reader.get() == &contig_reader->get(); };
+        if (!result.empty() && is_contig_reader(result.back())) continue;
+        if (std::any_of(std::cbegin(result), std::cend(result), is_contig_reader)) return boost::none;
+        result.push_back(*contig_reader);
     }
-    std::sort(std::begin(contigs), std::end(contigs),
-              [] (const auto& lhs, const auto& rhs) { return lhs.get() < rhs.get(); });
-    return std::adjacent_find(std::cbegin(contigs), std::cend(contigs),
-                              [] (const auto& lhs, const auto& rhs) {
-                                  return lhs.get() == rhs.get();
-                              }) == std::cend(contigs);
+    return result;
 }
 
 std::size_t count_records(const ReaderContigRecordCountMap& counts)
@@ -286,29 +307,13 @@ std::size_t count_records(const ReaderContigRecordCountMap& counts)
                                                              }); });
 }
 
-auto extract_unique_readers(const ReaderContigRecordCountMap& reader_contig_counts)
-{
-    std::unordered_map<std::string, VcfReaderRef> result {};
-    result.reserve(reader_contig_counts.size());
-    for (const auto& p : reader_contig_counts) {
-        const auto itr = find_active_contig(std::cbegin(p.second), std::cend(p.second));
-        if (itr != std::cend(p.second)) {
-            result.emplace(itr->first, p.first);
-        }
-    }
-    return result;
-}
-
-void merge_contig_unique(const std::vector<VcfReader>& sources, VcfWriter& dst,
-                         const std::vector<std::string>& contigs,
-                         const ReaderContigRecordCountMap& reader_contig_counts)
+// Like copy, but the records are copied by htslib without converting them to VcfRecord
+void append(VcfReader& src, VcfWriter& dst)
 {
-    const auto contig_readers = extract_unique_readers(reader_contig_counts);
-    for (const auto& contig : contigs) {
-        if (contig_readers.count(contig) == 1) {
-            copy(contig_readers.at(contig), dst);
-        }
+    if (!dst.is_header_written()) {
+        dst << fetch_header(src);
     }
+    dst.append(src.path());
 }
 
 using VcfRecordQueue = std::priority_queue<VcfRecord, std::deque<VcfRecord>, std::greater<VcfRecord>>;
@@ -397,15 +402,15 @@ void merge(std::vector<VcfReader>& sources, VcfWriter& dst, const std::vector<st
 {
     if (sources.empty()) return;
     if (sources.size() == 1) {
-        copy(sources.front(), dst);
+        append(sources.front(), dst);
         return;
     }
     if (!dst.is_header_written()) {
         dst << merge(get_headers(sources));
     }
     auto reader_contig_counts = get_contig_count_map(sources, contigs);
-    if (is_unique_contig_per_reader(reader_contig_counts)) {
-        merge_contig_unique(sources, dst, contigs, reader_contig_counts);
+    if (const auto disjoint_readers = get_contig_disjoint_readers(reader_contig_counts, contigs)) {
+        for (const auto& reader : *disjoint_readers) append(reader, dst);
     } else {
         static constexpr std::size_t maxBufferSize {100000};
         if (count_records(reader_contig_counts) <= maxBufferSize) {
@@ -21,6 +21,9 @@ std::vector<std::string> get_contigs(const VcfHeader& header);
 
 unsigned get_field_cardinality(const VcfHeader::StructuredKey& key, const VcfRecord& record);
 
+// The sorted allele indices of each genotype, in the order of fields with 'G' cardinality (e.g. GL)
+std::vector<std::vector<unsigned>> get_genotype_allele_indices(unsigned num_alleles, unsigned ploidy);
+
 std::vector<VcfType>
 get_typed_info_values(const VcfHeader& header, const VcfRecord& record, const VcfHeader::StructuredKey& key);
 
@@ -17,10 +17,11 @@ namespace octopus {
 
 namespace {
 
-auto make_vcf_writer(boost::optional<VcfWriter::Path> path = boost::none)
+auto make_vcf_writer(boost::optional<VcfWriter::Path> path = boost::none,
+                     std::shared_ptr<HtslibEncodingContext> encoding_context = nullptr)
 {
     if (path) {
-        return std::make_unique<HtslibBcfFacade>(std::move(*path), HtslibBcfFacade::Mode::write);
+        return std::make_unique<HtslibBcfFacade>(std::move(*path), HtslibBcfFacade::Mode::write, std::move(encoding_context));
     } else {
         return std::make_unique<HtslibBcfFacade>();
     }
@@ -30,14 +31,22 @@ auto make_vcf_writer(boost::optional<VcfWriter::Path> path = boost::none)
 
 VcfWriter::VcfWriter()
 : file_path_ {}
+, encoding_context_ {}
 , writer_ {make_vcf_writer()}
 , is_header_written_ {false}
+, is_indexed_ {false}
 {}
 
 VcfWriter::VcfWriter(Path file_path)
+: VcfWriter {std::move(file_path), std::shared_ptr<HtslibEncodingContext> {}}
+{}
+
+VcfWriter::VcfWriter(Path file_path, std::shared_ptr<HtslibEncodingContext> encoding_context)
 : file_path_ {std::move(file_path)}
+, encoding_context_ {std::move(encoding_context)}
 , writer_ {nullptr}
 , is_header_written_ {false}
+, is_indexed_ {false}
 {
     using namespace boost::filesystem;
     
@@ -59,7 +68,7 @@ VcfWriter::VcfWriter(Path file_path)
     } else if (exists(index_path2)) {
         remove(index_path2);
     }
-    writer_ = make_vcf_writer(*file_path_);
+    writer_ = make_vcf_writer(*file_path_, encoding_context_);
 }
 
 VcfWriter::VcfWriter(const VcfHeader& header)
@@ -74,11 +83,19 @@ VcfWriter::VcfWriter(Path file_path, const VcfHeader& header)
     write(std::move(header));
 }
 
+VcfWriter::VcfWriter(Path file_path, const VcfHeader& header, std::shared_ptr<HtslibEncodingContext> encoding_context)
+: VcfWriter {std::move(file_path), std::move(encoding_context)}
+{
+    write(std::move(header));
+}
+
 VcfWriter::VcfWriter(VcfWriter&& other)
 {
     std::lock_guard<std::mutex> lock {other.mutex_};
     file_path_         = std::move(other.file_path_);
+    encoding_context_  = std::move(other.encoding_context_);
     is_header_written_ = other.is_header_written_;
+    is_indexed_        = other.is_indexed_;
     writer_            = std::move(other.writer_);
 }
 
@@ -88,7 +105,9 @@ VcfWriter& VcfWriter::operator=(VcfWriter&& other)
         std::unique_lock<std::mutex> lock_lhs {mutex_, std::defer_lock}, lock_rhs {other.mutex_, std::defer_lock};
         std::lock(lock_lhs, lock_rhs);
         file_path_         = std::move(other.file_path_);
+        encoding_context_  = std::move(other.encoding_context_);
         is_header_written_ = other.is_header_written_;
+        is_indexed_        = other.is_indexed_;
         writer_            = std::move(other.writer_);
     }
     return *this;
@@ -98,7 +117,7 @@ VcfWriter::~VcfWriter()
 {
     try {
         close();
-        if (can_write_index()) {
+        if (can_write_index() && !is_indexed_) {
             index_vcf(*file_path_);
         }
     } catch(...) {
@@ -113,7 +132,9 @@ void swap(VcfWriter& lhs, VcfWriter& rhs) noexcept
     std::lock_guard<std::mutex> lock_lhs {lhs.mutex_, std::adopt_lock}, lock_rhs {rhs.mutex_, std::adopt_lock};
     using std::swap;
     swap(lhs.file_path_, rhs.file_path_);
+    swap(lhs.encoding_context_, rhs.encoding_context_);
     swap(lhs.is_header_written_, rhs.is_header_written_);
+    swap(lhs.is_indexed_, rhs.is_indexed_);
     swap(lhs.writer_, rhs.writer_);
 }
 
@@ -129,21 +150,27 @@ void VcfWriter::open(const bool overwrite)
         throw std::runtime_error {"VcfWriter::open: invalid open request"};
     }
     std::lock_guard<std::mutex> lock {mutex_};
-    writer_ = std::make_unique<HtslibBcfFacade>(*file_path_, overwrite ? HtslibBcfFacade::Mode::write : HtslibBcfFacade::Mode::append);
+    writer_ = std::make_unique<HtslibBcfFacade>(*file_path_, overwrite ? HtslibBcfFacade::Mode::write : HtslibBcfFacade::Mode::append,
+                                                encoding_context_);
+    is_indexed_ = false;
 }
 
 void VcfWriter::open(Path file_path)
 {
     std::lock_guard<std::mutex> lock {mutex_};
     file_path_         = std::move(file_path);
-    writer_            = make_vcf_writer(*file_path_);
+    writer_            = make_vcf_writer(*file_path_, encoding_context_);
     is_header_written_ = false;
+    is_indexed_        = false;
 }
 
 void VcfWriter::close() noexcept
 {
     std::lock_guard<std::mutex> lock {mutex_};
-    writer_.reset();
+    if (writer_) {
+        is_indexed_ = writer_->save_index();
+        writer_.reset();
+    }
 }
 
 bool VcfWriter::is_header_written() const noexcept
@@ -152,12 +179,24 @@ bool VcfWriter::is_header_written() const noexcept
     return is_header_written_;
 }
 
+bool VcfWriter::is_indexed() const noexcept
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return is_indexed_;
+}
+
 boost::optional<VcfWriter::Path> VcfWriter::path() const
 {
     std::lock_guard<std::mutex> lock {mutex_};
     return file_path_;
 }
 
+std::shared_ptr<HtslibEncodingContext> VcfWriter::encoding_context() const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return encoding_context_;
+}
+
 void VcfWriter::write(const VcfHeader& header)
 {
     std::lock_guard<std::mutex> lock {mutex_};
@@ -175,6 +214,16 @@ void VcfWriter::write(const VcfRecord& record)
     }
 }
 
+void VcfWriter::append(const Path& vcf)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    if (is_header_written_) {
+        writer_->write_records(vcf);
+    } else {
+        throw std::runtime_error {"VcfWriter::append: cannot append records as header has not been written"};
+    }
+}
+
 bool VcfWriter::can_write_index() const noexcept
 {
     return file_path_ && is_header_written_
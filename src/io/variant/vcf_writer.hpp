@@ -30,6 +30,9 @@ public:
     VcfWriter(Path file_path);
     VcfWriter(const VcfHeader& header);
     VcfWriter(Path file_path, const VcfHeader& header);
+    // Compressed output is BGZF compressed with the context's thread pool, including after reopening
+    VcfWriter(Path file_path, std::shared_ptr<HtslibEncodingContext> encoding_context);
+    VcfWriter(Path file_path, const VcfHeader& header, std::shared_ptr<HtslibEncodingContext> encoding_context);
     
     VcfWriter(const VcfWriter&)            = delete;
     VcfWriter& operator=(const VcfWriter&) = delete;
@@ -46,16 +49,22 @@ public:
     void close() noexcept;
     
     bool is_header_written() const noexcept;
+    // True if the file was indexed as it was written, once closed. Otherwise the file is indexed on destruction.
+    bool is_indexed() const noexcept;
     
     boost::optional<Path> path() const;
+    std::shared_ptr<HtslibEncodingContext> encoding_context() const;
     
     void write(const VcfHeader& header);
     void write(const VcfRecord& record);
+    // Copies all records of another VCF/BCF file, which may only use contigs and fields in the written header
+    void append(const Path& vcf);
     
 private:
     boost::optional<Path> file_path_;
+    std::shared_ptr<HtslibEncodingContext> encoding_context_;
     std::unique_ptr<HtslibBcfFacade> writer_;
-    bool is_header_written_;
+    bool is_header_written_, is_indexed_;
     mutable std::mutex mutex_;
     
     bool can_write_index() const noexcept;
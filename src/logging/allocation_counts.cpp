@@ -0,0 +1,145 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "allocation_counts.hpp"
+
+#include <new>
+#include <cstdlib>
+
+namespace octopus { namespace allocation {
+
+const char* name(const Zone zone) noexcept
+{
+    switch (zone) {
+        case Zone::other: return "other";
+        case Zone::read_pipe: return "read_pipe";
+        case Zone::candidate_generation: return "candidate_generation";
+        case Zone::haplotype_generation: return "haplotype_generation";
+        case Zone::likelihoods: return "likelihoods";
+        case Zone::latents: return "latents";
+        case Zone::calling: return "calling";
+        case Zone::phasing: return "phasing";
+        case Zone::record_factory: return "record_factory";
+        default: return "unknown";
+    }
+}
+
+ZoneCounts operator-(const ZoneCounts& lhs, const ZoneCounts& rhs) noexcept
+{
+    ZoneCounts result {};
+    for (std::size_t i {0}; i < numZones; ++i) {
+        result[i] = {lhs[i].allocations - rhs[i].allocations, lhs[i].bytes - rhs[i].bytes};
+    }
+    return result;
+}
+
+ZoneCounts& operator+=(ZoneCounts& lhs, const ZoneCounts& rhs) noexcept
+{
+    for (std::size_t i {0}; i < numZones; ++i) {
+        lhs[i].allocations += rhs[i].allocations;
+        lhs[i].bytes += rhs[i].bytes;
+    }
+    return lhs;
+}
+
+#if defined(ALLOCATION_COUNTING)
+
+namespace {
+
+// Both are trivially constructed, so are usable from operator new at any point in a thread's life
+thread_local Zone current_zone {Zone::other};
+thread_local Counts current_counts[numZones] {};
+
+} // namespace
+
+namespace detail {
+
+Zone exchange_zone(const Zone zone) noexcept
+{
+    const auto result = current_zone;
+    current_zone = zone;
+    return result;
+}
+
+} // namespace detail
+
+ZoneCounts thread_counts() noexcept
+{
+    ZoneCounts result {};
+    for (std::size_t i {0}; i < numZones; ++i) result[i] = current_counts[i];
+    return result;
+}
+
+#else
+
+ZoneCounts thread_counts() noexcept
+{
+    return {};
+}
+
+#endif
+
+} // namespace allocation
+} // namespace octopus
+
+#if defined(ALLOCATION_COUNTING)
+
+void* operator new(const std::size_t size)
+{
+    auto& counts = octopus::allocation::current_counts[static_cast<std::size_t>(octopus::allocation::current_zone)];
+    ++counts.allocations;
+    counts.bytes += size;
+    if (auto result = std::malloc(size > 0 ? size : 1)) return result;
+    throw std::bad_alloc {};
+}
+
+void* operator new[](const std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
@@ -0,0 +1,105 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef allocation_counts_hpp
+#define allocation_counts_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+namespace octopus { namespace allocation {
+
+/*
+    With the ALLOCATION_COUNTING build option, global operator new is replaced with one that counts
+    the allocations and bytes requested by each thread, and attributes them to the zone the thread
+    is in. A ScopedZone puts the calling thread in a zone for its lifetime; the zone entered last
+    takes the allocations, so nested zones are not counted twice. Allocations made outside of any
+    zone are counted as 'other'. Memory allocated with malloc (e.g. by htslib) is not counted.
+
+    Without the option nothing is counted, ScopedZone does nothing, and all counts are zero.
+ */
+
+enum class Zone : std::size_t
+{
+    other,
+    read_pipe,
+    candidate_generation,
+    haplotype_generation,
+    likelihoods,
+    latents,
+    calling,
+    phasing,
+    record_factory,
+};
+
+constexpr std::size_t numZones {static_cast<std::size_t>(Zone::record_factory) + 1};
+
+const char* name(Zone zone) noexcept;
+
+struct Counts
+{
+    std::uint64_t allocations, bytes;
+};
+
+using ZoneCounts = std::array<Counts, numZones>;
+
+ZoneCounts operator-(const ZoneCounts& lhs, const ZoneCounts& rhs) noexcept;
+ZoneCounts& operator+=(ZoneCounts& lhs, const ZoneCounts& rhs) noexcept;
+
+#if defined(ALLOCATION_COUNTING)
+
+constexpr bool is_counting() noexcept { return true; }
+
+namespace detail {
+
+Zone exchange_zone(Zone zone) noexcept;
+
+} // namespace detail
+
+class ScopedZone
+{
+public:
+    ScopedZone() = delete;
+
+    explicit ScopedZone(Zone zone) noexcept : prev_zone_ {detail::exchange_zone(zone)} {}
+
+    ScopedZone(const ScopedZone&)            = delete;
+    ScopedZone& operator=(const ScopedZone&) = delete;
+    ScopedZone(ScopedZone&&)                 = delete;
+    ScopedZone& operator=(ScopedZone&&)      = delete;
+
+    ~ScopedZone() noexcept { detail::exchange_zone(prev_zone_); }
+
+private:
+    Zone prev_zone_;
+};
+
+#else
+
+constexpr bool is_counting() noexcept { return false; }
+
+class ScopedZone
+{
+public:
+    ScopedZone() = delete;
+
+    explicit ScopedZone(Zone) noexcept {}
+
+    ScopedZone(const ScopedZone&)            = delete;
+    ScopedZone& operator=(const ScopedZone&) = delete;
+    ScopedZone(ScopedZone&&)                 = delete;
+    ScopedZone& operator=(ScopedZone&&)      = delete;
+
+    ~ScopedZone() = default;
+};
+
+#endif
+
+// The allocations the calling thread has made so far, by zone
+ZoneCounts thread_counts() noexcept;
+
+} // namespace allocation
+} // namespace octopus
+
+#endif
@@ -4,6 +4,11 @@
 #include "logging.hpp"
 
 #include <iostream>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
 
 namespace octopus { namespace logging {
 
@@ -11,6 +16,34 @@ namespace sinks    = boost::log::sinks;
 namespace keywords = boost::log::keywords;
 namespace expr     = boost::log::expressions;
 
+namespace {
+
+using AsyncFileSink = sinks::asynchronous_sink<sinks::text_file_backend>;
+
+std::vector<boost::shared_ptr<AsyncFileSink>> async_sinks {};
+
+thread_local bool debug_muted {false};
+
+// Debug and trace logs can be very verbose, so messages are queued and written by the sink's own thread
+template <typename Filter>
+void add_async_file_log(const boost::filesystem::path& file_name, Filter filter)
+{
+    auto backend = boost::make_shared<sinks::text_file_backend>(keywords::file_name = file_name.c_str());
+    auto sink = boost::make_shared<AsyncFileSink>(std::move(backend));
+    sink->set_filter(filter);
+    sink->set_formatter
+    (
+     expr::stream
+        << expr::format_date_time< boost::posix_time::ptime >("TimeStamp", "[%Y-%m-%d %H:%M:%S]")
+        << " <" << severity
+        << "> " << expr::smessage
+    );
+    logging::core::get()->add_sink(sink);
+    async_sinks.push_back(std::move(sink));
+}
+
+} // namespace
+
 std::ostream& operator<<(std::ostream& os, severity_level level)
 {
     switch (level) {
@@ -44,43 +77,37 @@ void init(boost::optional<boost::filesystem::path> debug_log,
     );
     
     if (debug_log) {
-        logging::add_file_log
-        (
-         keywords::file_name = debug_log->c_str(),
-         keywords::filter =
-         (
-          severity != severity_level::trace
-          ),
-         keywords::format =
-         (
-            expr::stream
-                << expr::format_date_time< boost::posix_time::ptime >("TimeStamp", "[%Y-%m-%d %H:%M:%S]")
-                << " <" << severity
-                << "> " << expr::smessage
-          )
-         );
+        add_async_file_log(*debug_log, severity != severity_level::trace);
     }
     
     if (trace_log) {
-        logging::add_file_log
-        (
-         keywords::file_name = trace_log->c_str(),
-         keywords::filter =
-         (
-          severity != severity_level::debug
-          ),
-         keywords::format =
-         (
-          expr::stream
-                << expr::format_date_time< boost::posix_time::ptime >("TimeStamp", "[%Y-%m-%d %H:%M:%S]")
-                << " <" << severity
-                << "> " << expr::smessage
-          )
-         );
+        add_async_file_log(*trace_log, severity != severity_level::debug);
     }
     
     logging::add_common_attributes();
 }
 
+void flush()
+{
+    for (const auto& sink : async_sinks) {
+        sink->flush();
+    }
+}
+
+bool is_debug_muted() noexcept
+{
+    return debug_muted;
+}
+
+ScopedDebugMute::ScopedDebugMute(const bool mute) : prev_muted_ {debug_muted}
+{
+    debug_muted = mute;
+}
+
+ScopedDebugMute::~ScopedDebugMute()
+{
+    debug_muted = prev_muted_;
+}
+
 } // namespace logging
 } // namespace octopus
@@ -43,16 +43,41 @@ BOOST_LOG_INLINE_GLOBAL_LOGGER_DEFAULT(logger, src::severity_logger<severity_lev
 
 BOOST_LOG_ATTRIBUTE_KEYWORD(severity, "Severity", severity_level)
 
+// The debug and trace log files are written by a background thread, so logging threads only queue messages
 void init(boost::optional<boost::filesystem::path> debug_log = boost::none,
           boost::optional<boost::filesystem::path> trace_log = boost::none);
 
+// Writes any queued debug and trace messages
+void flush();
+
+// Debug and trace messages from the calling thread are dropped while it is muted, e.g. to only debug some tasks
+bool is_debug_muted() noexcept;
+
+class ScopedDebugMute
+{
+public:
+    explicit ScopedDebugMute(bool mute = true);
+    
+    ScopedDebugMute(const ScopedDebugMute&)            = delete;
+    ScopedDebugMute& operator=(const ScopedDebugMute&) = delete;
+    ScopedDebugMute(ScopedDebugMute&&)                 = delete;
+    ScopedDebugMute& operator=(ScopedDebugMute&&)      = delete;
+    
+    ~ScopedDebugMute();
+    
+private:
+    bool prev_muted_;
+};
+
 template <severity_level L>
 class Logger
 {
 public:
     Logger() : lg_ {logger::get()} {}
     
-    template <typename T> void write(const T& msg) { BOOST_LOG_SEV(lg_, L) << msg; }
+    bool enabled() const noexcept { return L > severity_level::debug || !is_debug_muted(); }
+    
+    template <typename T> void write(const T& msg) { if (enabled()) BOOST_LOG_SEV(lg_, L) << msg; }
     
 private:
     src::severity_logger<severity_level> lg_;
@@ -184,6 +209,7 @@ public:
     
     ~LogStream()
     {
+        if (!log_.get().enabled()) return;
         auto str = msg_.str();
         
         if (!str.empty() && str.back() == '\n') {
@@ -197,7 +223,7 @@ public:
         log_.get() << str;
     }
     
-    template <typename M> void write(const M& msg) { msg_<< msg; }
+    template <typename M> void write(const M& msg) { if (log_.get().enabled()) msg_<< msg; }
     
 private:
     std::reference_wrapper<Log> log_;
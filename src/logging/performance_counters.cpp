@@ -0,0 +1,251 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "performance_counters.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <ostream>
+#include <iomanip>
+
+#include "exceptions/unwritable_file_error.hpp"
+
+namespace octopus { namespace performance {
+
+namespace detail {
+
+std::atomic<bool> enabled {false};
+
+} // namespace detail
+
+namespace {
+
+constexpr std::array<const char*, numCounters> counterNames {{
+    "reads_read", "reads_returned", "read_cache_hits", "read_cache_misses", "candidates", "haplotypes", "genotypes"
+}};
+constexpr std::array<const char*, numPhases> phaseNames {{
+    "read_io", "read_pipe", "candidate_generation", "haplotype_generation", "likelihoods", "latents", "calling", "phasing"
+}};
+
+// Shards are only written by their own thread, but are read by collect, so the slots are atomic.
+// Value initialisation zeros them.
+struct HistogramShard
+{
+    std::atomic<std::uint64_t> count, total_ns;
+    std::array<std::atomic<std::uint64_t>, numBuckets> buckets;
+};
+
+struct Shard
+{
+    std::array<std::atomic<std::uint64_t>, numCounters> counters;
+    std::array<HistogramShard, numPhases> phases;
+};
+
+class ShardRegistry
+{
+public:
+    std::shared_ptr<Shard> make_shard()
+    {
+        auto result = std::make_shared<Shard>();
+        std::lock_guard<std::mutex> lock {mutex_};
+        shards_.push_back(result);
+        return result;
+    }
+
+    std::vector<std::shared_ptr<Shard>> shards() const
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        return shards_;
+    }
+
+private:
+    std::vector<std::shared_ptr<Shard>> shards_; // kept after their thread exits so nothing is lost
+    mutable std::mutex mutex_;
+};
+
+ShardRegistry& registry()
+{
+    static ShardRegistry result {};
+    return result;
+}
+
+Shard& local_shard()
+{
+    thread_local const std::shared_ptr<Shard> result {registry().make_shard()};
+    return *result;
+}
+
+void increment(std::atomic<std::uint64_t>& slot, const std::uint64_t n) noexcept
+{
+    // Only this thread writes the slot, so a load and store is enough
+    slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+std::size_t bucket_index(const Duration duration) noexcept
+{
+    auto micros = (static_cast<std::uint64_t>(duration.count()) + 999) / 1000;
+    std::size_t result {0};
+    while (micros > 1 && result + 1 < numBuckets) {
+        micros = (micros + 1) / 2;
+        ++result;
+    }
+    return result;
+}
+
+double bucket_bound_seconds(const std::size_t bucket) noexcept
+{
+    return static_cast<double>(std::uint64_t {1} << bucket) / 1e6;
+}
+
+double seconds(const std::uint64_t ns) noexcept
+{
+    return static_cast<double>(ns) / 1e9;
+}
+
+} // namespace
+
+const char* name(const Counter counter) noexcept
+{
+    return counterNames[static_cast<std::size_t>(counter)];
+}
+
+const char* name(const Phase phase) noexcept
+{
+    return phaseNames[static_cast<std::size_t>(phase)];
+}
+
+void enable(const bool enabled) noexcept
+{
+    detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void add(const Counter counter, const std::uint64_t n) noexcept
+{
+    if (!is_enabled()) return;
+    increment(local_shard().counters[static_cast<std::size_t>(counter)], n);
+}
+
+void record(const Phase phase, const Duration duration) noexcept
+{
+    if (!is_enabled()) return;
+    auto& histogram = local_shard().phases[static_cast<std::size_t>(phase)];
+    increment(histogram.count, 1);
+    increment(histogram.total_ns, static_cast<std::uint64_t>(duration.count()));
+    increment(histogram.buckets[bucket_index(duration)], 1);
+}
+
+Snapshot collect()
+{
+    Snapshot result {};
+    for (const auto& shard : registry().shards()) {
+        for (std::size_t i {0}; i < numCounters; ++i) {
+            result.counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+        }
+        for (std::size_t i {0}; i < numPhases; ++i) {
+            const auto& histogram = shard->phases[i];
+            auto& stats = result.phases[i];
+            stats.count += histogram.count.load(std::memory_order_relaxed);
+            stats.total_ns += histogram.total_ns.load(std::memory_order_relaxed);
+            for (std::size_t j {0}; j < numBuckets; ++j) {
+                stats.buckets[j] += histogram.buckets[j].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return result;
+}
+
+void write_json(const Snapshot& snapshot, std::ostream& os)
+{
+    os << "{\"counters\":{";
+    for (std::size_t i {0}; i < numCounters; ++i) {
+        if (i > 0) os << ',';
+        os << '"' << counterNames[i] << "\":" << snapshot.counters[i];
+    }
+    os << "},\"phases\":{";
+    for (std::size_t i {0}; i < numPhases; ++i) {
+        const auto& stats = snapshot.phases[i];
+        if (i > 0) os << ',';
+        os << '"' << phaseNames[i] << "\":{\"count\":" << stats.count
+           << ",\"total_seconds\":" << seconds(stats.total_ns) << ",\"buckets\":[";
+        for (std::size_t j {0}; j < numBuckets; ++j) {
+            if (j > 0) os << ',';
+            os << "{\"le\":";
+            if (j + 1 < numBuckets) {
+                os << bucket_bound_seconds(j);
+            } else {
+                os << "null";
+            }
+            os << ",\"count\":" << stats.buckets[j] << '}';
+        }
+        os << "]}";
+    }
+    os << "}}\n";
+}
+
+void write_prometheus(const Snapshot& snapshot, std::ostream& os)
+{
+    for (std::size_t i {0}; i < numCounters; ++i) {
+        os << "# TYPE octopus_" << counterNames[i] << "_total counter\n";
+        os << "octopus_" << counterNames[i] << "_total " << snapshot.counters[i] << '\n';
+    }
+    os << "# TYPE octopus_phase_seconds histogram\n";
+    for (std::size_t i {0}; i < numPhases; ++i) {
+        const auto& stats = snapshot.phases[i];
+        const std::string label {std::string {"phase=\""} + phaseNames[i] + '"'};
+        std::uint64_t cumulative_count {0};
+        for (std::size_t j {0}; j < numBuckets; ++j) {
+            cumulative_count += stats.buckets[j];
+            os << "octopus_phase_seconds_bucket{" << label << ",le=\"";
+            if (j + 1 < numBuckets) {
+                os << bucket_bound_seconds(j);
+            } else {
+                os << "+Inf";
+            }
+            os << "\"} " << cumulative_count << '\n';
+        }
+        os << "octopus_phase_seconds_sum{" << label << "} " << seconds(stats.total_ns) << '\n';
+        os << "octopus_phase_seconds_count{" << label << "} " << stats.count << '\n';
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const Snapshot& snapshot)
+{
+    for (std::size_t i {0}; i < numCounters; ++i) {
+        os << counterNames[i] << ": " << snapshot.counters[i] << '\n';
+    }
+    for (std::size_t i {0}; i < numPhases; ++i) {
+        const auto& stats = snapshot.phases[i];
+        os << phaseNames[i] << ": " << stats.count << " times, " << seconds(stats.total_ns) << "s";
+        if (stats.count > 0) os << " (mean " << seconds(stats.total_ns / stats.count) << "s)";
+        os << '\n';
+    }
+    return os;
+}
+
+class UnwritablePerformanceReport : public UnwritableFileError
+{
+    std::string do_where() const override { return "write_report"; }
+public:
+    UnwritablePerformanceReport(boost::filesystem::path file) : UnwritableFileError {std::move(file), "performance report"} {}
+};
+
+void write_report(const boost::filesystem::path& file)
+{
+    std::ofstream out {file.string()};
+    if (!out) {
+        throw UnwritablePerformanceReport {file};
+    }
+    out << std::setprecision(9);
+    const auto snapshot = collect();
+    if (file.extension() == ".prom") {
+        write_prometheus(snapshot, out);
+    } else {
+        write_json(snapshot, out);
+    }
+}
+
+} // namespace performance
+} // namespace octopus
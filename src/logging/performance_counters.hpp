@@ -0,0 +1,127 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef performance_counters_hpp
+#define performance_counters_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+
+#include <boost/filesystem/path.hpp>
+
+namespace octopus { namespace performance {
+
+// Process-wide counters and phase time histograms. Each thread records into its own shard, so
+// recording never contends; shards are summed when a snapshot is taken. Nothing is recorded
+// unless counters are enabled, and a disabled counter costs a single relaxed load.
+
+enum class Counter : std::size_t
+{
+    reads_read,
+    reads_returned,
+    read_cache_hits,
+    read_cache_misses,
+    candidates,
+    haplotypes,
+    genotypes,
+};
+
+enum class Phase : std::size_t
+{
+    read_io,
+    read_pipe,
+    candidate_generation,
+    haplotype_generation,
+    likelihoods,
+    latents,
+    calling,
+    phasing,
+};
+
+constexpr std::size_t numCounters {static_cast<std::size_t>(Counter::genotypes) + 1};
+constexpr std::size_t numPhases {static_cast<std::size_t>(Phase::phasing) + 1};
+constexpr std::size_t numBuckets {32}; // upper bounds are 1us, 2us, 4us, ..., 2^30us, then unbounded
+
+using Duration = std::chrono::nanoseconds;
+
+const char* name(Counter counter) noexcept;
+const char* name(Phase phase) noexcept;
+
+namespace detail {
+
+extern std::atomic<bool> enabled;
+
+} // namespace detail
+
+void enable(bool enabled = true) noexcept;
+
+inline bool is_enabled() noexcept
+{
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+void add(Counter counter, std::uint64_t n = 1) noexcept;
+void record(Phase phase, Duration duration) noexcept;
+
+// Records the time the timer is alive to a phase, if counters are enabled when it is created
+class PhaseTimer
+{
+public:
+    PhaseTimer() = delete;
+
+    explicit PhaseTimer(Phase phase) noexcept
+    : phase_ {phase}
+    , enabled_ {is_enabled()}
+    , start_ {enabled_ ? Clock::now() : Clock::time_point {}}
+    {}
+
+    PhaseTimer(const PhaseTimer&)            = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+    PhaseTimer(PhaseTimer&&)                 = delete;
+    PhaseTimer& operator=(PhaseTimer&&)      = delete;
+
+    ~PhaseTimer() noexcept
+    {
+        if (enabled_) record(phase_, std::chrono::duration_cast<Duration>(Clock::now() - start_));
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Phase phase_;
+    bool enabled_;
+    Clock::time_point start_;
+};
+
+struct PhaseStats
+{
+    std::uint64_t count, total_ns;
+    std::array<std::uint64_t, numBuckets> buckets; // not cumulative
+};
+
+struct Snapshot
+{
+    std::array<std::uint64_t, numCounters> counters;
+    std::array<PhaseStats, numPhases> phases;
+};
+
+// Sums the shards of every thread that has recorded anything, including threads that have exited
+Snapshot collect();
+
+void write_json(const Snapshot& snapshot, std::ostream& os);
+void write_prometheus(const Snapshot& snapshot, std::ostream& os);
+
+// A human readable summary
+std::ostream& operator<<(std::ostream& os, const Snapshot& snapshot);
+
+// Writes a snapshot to file in Prometheus text format if the file extension is '.prom', and as JSON otherwise
+void write_report(const boost::filesystem::path& file);
+
+} // namespace performance
+} // namespace octopus
+
+#endif
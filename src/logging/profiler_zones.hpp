@@ -0,0 +1,121 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef profiler_zones_hpp
+#define profiler_zones_hpp
+
+/*
+    Instrumentation for external profilers. OCTOPUS_ZONE("name") marks the rest of the enclosing
+    scope as a named zone, and OCTOPUS_ZONE_REGION(region) tags the zones the calling thread enters
+    for the rest of the enclosing scope with a genomic region, so traces can be filtered by region.
+
+    Both compile to nothing unless a backend is chosen at build time with OCTOPUS_PROFILER_TRACY
+    (Tracy) or OCTOPUS_PROFILER_ITT (Intel ITT, e.g. for VTune).
+ */
+
+#if defined(OCTOPUS_PROFILER_TRACY) || defined(OCTOPUS_PROFILER_ITT)
+
+#include <string>
+#include <sstream>
+#include <utility>
+
+#if defined(OCTOPUS_PROFILER_TRACY)
+#include <tracy/Tracy.hpp>
+#else
+#include <ittnotify.h>
+#endif
+
+namespace octopus { namespace profiling {
+
+inline std::string& current_region()
+{
+    static thread_local std::string result {};
+    return result;
+}
+
+class ScopedRegion
+{
+public:
+    template <typename Region>
+    explicit ScopedRegion(const Region& region) : prev_region_ {std::move(current_region())}
+    {
+        std::ostringstream ss {};
+        ss << region;
+        current_region() = ss.str();
+    }
+
+    ScopedRegion(const ScopedRegion&)            = delete;
+    ScopedRegion& operator=(const ScopedRegion&) = delete;
+    ScopedRegion(ScopedRegion&&)                 = delete;
+    ScopedRegion& operator=(ScopedRegion&&)      = delete;
+
+    ~ScopedRegion() { current_region() = std::move(prev_region_); }
+
+private:
+    std::string prev_region_;
+};
+
+#if defined(OCTOPUS_PROFILER_ITT)
+
+inline __itt_domain* domain()
+{
+    static __itt_domain* const result {__itt_domain_create("octopus")};
+    return result;
+}
+
+class ScopedIttTask
+{
+public:
+    explicit ScopedIttTask(__itt_string_handle* name)
+    {
+        __itt_task_begin(domain(), __itt_null, __itt_null, name);
+        const auto& region = current_region();
+        if (!region.empty()) {
+            static __itt_string_handle* const key {__itt_string_handle_create("region")};
+            __itt_metadata_str_add(domain(), __itt_null, key, region.c_str(), region.size());
+        }
+    }
+
+    ScopedIttTask(const ScopedIttTask&)            = delete;
+    ScopedIttTask& operator=(const ScopedIttTask&) = delete;
+    ScopedIttTask(ScopedIttTask&&)                 = delete;
+    ScopedIttTask& operator=(ScopedIttTask&&)      = delete;
+
+    ~ScopedIttTask() { __itt_task_end(domain()); }
+};
+
+#endif
+
+} // namespace profiling
+} // namespace octopus
+
+#define OCTOPUS_PROFILER_CONCAT_IMPL(a, b) a##b
+#define OCTOPUS_PROFILER_CONCAT(a, b) OCTOPUS_PROFILER_CONCAT_IMPL(a, b)
+
+#define OCTOPUS_ZONE_REGION(region) \
+    const ::octopus::profiling::ScopedRegion OCTOPUS_PROFILER_CONCAT(octopus_zone_region_, __LINE__) {region}
+
+#if defined(OCTOPUS_PROFILER_TRACY)
+
+#define OCTOPUS_ZONE(name) \
+    ZoneScopedN(name); \
+    if (!::octopus::profiling::current_region().empty()) { \
+        ZoneText(::octopus::profiling::current_region().data(), ::octopus::profiling::current_region().size()); \
+    }
+
+#else
+
+#define OCTOPUS_ZONE(name) \
+    static __itt_string_handle* const OCTOPUS_PROFILER_CONCAT(octopus_zone_name_, __LINE__) {__itt_string_handle_create(name)}; \
+    const ::octopus::profiling::ScopedIttTask OCTOPUS_PROFILER_CONCAT(octopus_zone_, __LINE__) {OCTOPUS_PROFILER_CONCAT(octopus_zone_name_, __LINE__)}
+
+#endif
+
+#else
+
+#define OCTOPUS_ZONE(name)
+#define OCTOPUS_ZONE_REGION(region)
+
+#endif
+
+#endif
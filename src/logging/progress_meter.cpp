@@ -115,6 +115,8 @@ ProgressMeter::ProgressMeter(ProgressMeter&& other)
     log_                  = std::move(other.log_);
     buffer_size_          = std::move(other.buffer_size_);
     buffer_               = std::move(other.buffer_);
+    num_tasks_running_    = other.num_tasks_running_;
+    num_tasks_queued_     = other.num_tasks_queued_;
 }
 
 ProgressMeter& ProgressMeter::operator=(ProgressMeter&& other)
@@ -139,6 +141,8 @@ ProgressMeter& ProgressMeter::operator=(ProgressMeter&& other)
         log_                  = std::move(other.log_);
         buffer_size_          = std::move(other.buffer_size_);
         buffer_               = std::move(other.buffer_);
+        num_tasks_running_    = other.num_tasks_running_;
+        num_tasks_queued_     = other.num_tasks_queued_;
     }
     return *this;
 }
@@ -253,6 +257,7 @@ void ProgressMeter::set_buffer_size(const std::size_t n)
 
 void ProgressMeter::start()
 {
+    std::lock_guard<std::mutex> lock {mutex_};
     if (!target_regions_.empty()) {
         completed_regions_.reserve(target_regions_.size());
         write_header();
@@ -273,6 +278,7 @@ void ProgressMeter::pause()
 
 void ProgressMeter::stop()
 {
+    std::lock_guard<std::mutex> lock {mutex_};
     spill_buffer();
     if (!done_ && !target_regions_.empty()) {
         const TimeInterval duration {start_, std::chrono::system_clock::now()};
@@ -282,6 +288,7 @@ void ProgressMeter::stop()
                      << time_taken_pad(time_taken) << time_taken
                      << ttc_pad("-") << "-";
     }
+    num_tasks_running_ = num_tasks_queued_ = 0;
     done_ = true;
 }
 
@@ -326,6 +333,36 @@ void ProgressMeter::log_completed(const GenomicRegion::ContigName& contig)
     }
 }
 
+void ProgressMeter::set_task_counts(const std::size_t running, const std::size_t queued)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    num_tasks_running_ = running;
+    num_tasks_queued_ = queued;
+}
+
+ProgressMeter::Status ProgressMeter::status() const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    Status result {};
+    result.time = std::chrono::system_clock::now();
+    result.elapsed = result.time - start_;
+    result.completed_bp = num_bp_completed_;
+    result.total_bp = num_bp_to_search_;
+    result.contigs.reserve(target_regions_.size());
+    for (const auto& p : target_regions_) {
+        Status::ContigStatus contig {0, sum_region_sizes(p.second)};
+        const auto completed_itr = completed_regions_.find(p.first);
+        if (completed_itr != std::cend(completed_regions_)) {
+            contig.completed_bp = sum_region_sizes(completed_itr->second);
+        }
+        result.contigs.emplace_back(p.first, contig);
+    }
+    result.tasks_running = num_tasks_running_;
+    result.tasks_queued = num_tasks_queued_;
+    result.done = done_;
+    return result;
+}
+
 // private methods
 
 void ProgressMeter::buffer(const GenomicRegion& region)
@@ -9,6 +9,8 @@
 #include <chrono>
 #include <deque>
 #include <mutex>
+#include <vector>
+#include <utility>
 
 #include "config/common.hpp"
 #include "basics/contig_region.hpp"
@@ -21,6 +23,24 @@ namespace octopus {
 class ProgressMeter
 {
 public:
+    using RegionSizeType = ContigRegion::Position;
+    
+    // A machine readable snapshot of progress
+    struct Status
+    {
+        struct ContigStatus
+        {
+            RegionSizeType completed_bp, total_bp;
+        };
+        
+        std::chrono::system_clock::time_point time;
+        std::chrono::duration<double> elapsed;
+        RegionSizeType completed_bp, total_bp;
+        std::vector<std::pair<ContigName, ContigStatus>> contigs;
+        std::size_t tasks_running, tasks_queued;
+        bool done;
+    };
+    
     ProgressMeter() = delete;
     
     ProgressMeter(InputRegionMap regions);
@@ -45,8 +65,12 @@ public:
     void log_completed(const GenomicRegion& region);
     void log_completed(const GenomicRegion::ContigName& contig);
     
+    // Whoever schedules the work reports how many tasks are running and waiting to run
+    void set_task_counts(std::size_t running, std::size_t queued);
+    
+    Status status() const;
+    
 private:
-    using RegionSizeType = ContigRegion::Position;
     using ContigRegionMap = MappableSetMap<ContigName, ContigRegion>;
     using DurationUnits = std::chrono::milliseconds;
     
@@ -65,6 +89,7 @@ private:
     logging::InfoLogger log_;
     std::size_t buffer_size_;
     std::vector<GenomicRegion> buffer_;
+    std::size_t num_tasks_running_ = 0, num_tasks_queued_ = 0;
     
     void buffer(const GenomicRegion& region);
     void spill_buffer();
@@ -0,0 +1,132 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "progress_status_writer.hpp"
+
+#include <string>
+#include <utility>
+#include <iomanip>
+#include <algorithm>
+
+#include "utils/string_utils.hpp"
+#include "utils/system_utils.hpp"
+#include "performance_counters.hpp"
+#include "exceptions/unwritable_file_error.hpp"
+
+namespace octopus {
+
+namespace {
+
+class UnwritableProgressStatus : public UnwritableFileError
+{
+    std::string do_where() const override { return "ProgressStatusWriter"; }
+public:
+    UnwritableProgressStatus(boost::filesystem::path file) : UnwritableFileError {std::move(file), "progress status"} {}
+};
+
+auto seconds_since_epoch(const std::chrono::system_clock::time_point time) noexcept
+{
+    return std::chrono::duration<double> {time.time_since_epoch()}.count();
+}
+
+std::uint64_t num_reads_returned()
+{
+    const auto snapshot = performance::collect();
+    return snapshot.counters[static_cast<std::size_t>(performance::Counter::reads_returned)];
+}
+
+} // namespace
+
+ProgressStatusWriter::ProgressStatusWriter(Path file, const ProgressMeter& meter, std::chrono::seconds interval)
+: path_ {std::move(file)}
+, file_ {path_.string()}
+, meter_ {meter}
+, interval_ {interval}
+, last_status_ {}
+, last_num_reads_ {0}
+, stop_ {false}
+, mutex_ {}
+, cv_ {}
+, thread_ {}
+{
+    if (!file_) {
+        throw UnwritableProgressStatus {path_};
+    }
+    file_ << std::setprecision(6) << std::fixed;
+    thread_ = std::thread {[this] () {
+        std::unique_lock<std::mutex> lock {mutex_};
+        while (!cv_.wait_for(lock, interval_, [this] () { return stop_; })) {
+            write();
+        }
+    }};
+}
+
+ProgressStatusWriter::~ProgressStatusWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+    write();
+}
+
+const ProgressStatusWriter::Path& ProgressStatusWriter::path() const noexcept
+{
+    return path_;
+}
+
+// private methods
+
+void ProgressStatusWriter::write()
+{
+    auto status = meter_.get().status();
+    file_ << "{\"time\":" << seconds_since_epoch(status.time)
+          << ",\"elapsed_seconds\":" << status.elapsed.count()
+          << ",\"completed_bp\":" << status.completed_bp
+          << ",\"total_bp\":" << status.total_bp
+          << ",\"done\":" << (status.done ? "true" : "false")
+          << ",\"tasks_running\":" << status.tasks_running
+          << ",\"tasks_queued\":" << status.tasks_queued;
+    // Throughput is measured since the last line so it follows changes in speed
+    const auto since_last = last_status_ ? status.elapsed - last_status_->elapsed : status.elapsed;
+    const auto last_completed_bp = last_status_ ? std::min(last_status_->completed_bp, status.completed_bp) : 0;
+    const auto completed_since_last = status.completed_bp - last_completed_bp;
+    file_ << ",\"bp_per_second\":";
+    if (since_last.count() > 0) {
+        file_ << completed_since_last / since_last.count();
+    } else {
+        file_ << "null";
+    }
+    file_ << ",\"reads_per_second\":";
+    if (performance::is_enabled() && since_last.count() > 0) {
+        const auto num_reads = num_reads_returned();
+        file_ << (num_reads - last_num_reads_) / since_last.count();
+        last_num_reads_ = num_reads;
+    } else {
+        file_ << "null";
+    }
+    // The estimated time to completion uses the mean speed over the run, which is more stable
+    file_ << ",\"eta_seconds\":";
+    if (status.done) {
+        file_ << 0;
+    } else if (status.completed_bp > 0 && status.completed_bp < status.total_bp) {
+        file_ << status.elapsed.count() * (status.total_bp - status.completed_bp) / status.completed_bp;
+    } else {
+        file_ << "null";
+    }
+    file_ << ",\"rss_bytes\":" << get_rss() << ",\"peak_rss_bytes\":" << get_peak_rss();
+    file_ << ",\"contigs\":{";
+    bool first {true};
+    for (const auto& p : status.contigs) {
+        if (!first) file_ << ',';
+        first = false;
+        file_ << '"' << utils::json_escape(p.first) << "\":{\"completed_bp\":" << p.second.completed_bp
+              << ",\"total_bp\":" << p.second.total_bp << '}';
+    }
+    file_ << "}}" << std::endl; // flushed so readers see whole lines as soon as they are written
+    last_status_ = std::move(status);
+}
+
+} // namespace octopus
@@ -0,0 +1,65 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef progress_status_writer_hpp
+#define progress_status_writer_hpp
+
+#include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include "progress_meter.hpp"
+
+namespace octopus {
+
+/*
+    ProgressStatusWriter appends a JSON line describing the progress of a run to a file at a fixed
+    interval, and once more when it is destroyed. Each line has the completed and total bases overall
+    and per contig, the number of tasks running and queued, the recent throughput in bases (and reads,
+    if performance counters are enabled) per second, the estimated seconds to completion, and the
+    current and peak memory use. Lines are written even if no progress is made, so a stalled run can be
+    told apart from a dead one.
+ */
+class ProgressStatusWriter
+{
+public:
+    using Path = boost::filesystem::path;
+
+    ProgressStatusWriter() = delete;
+
+    ProgressStatusWriter(Path file, const ProgressMeter& meter, std::chrono::seconds interval);
+
+    ProgressStatusWriter(const ProgressStatusWriter&)            = delete;
+    ProgressStatusWriter& operator=(const ProgressStatusWriter&) = delete;
+    ProgressStatusWriter(ProgressStatusWriter&&)                 = delete;
+    ProgressStatusWriter& operator=(ProgressStatusWriter&&)      = delete;
+
+    ~ProgressStatusWriter();
+
+    const Path& path() const noexcept;
+
+private:
+    Path path_;
+    std::ofstream file_;
+    std::reference_wrapper<const ProgressMeter> meter_;
+    std::chrono::seconds interval_;
+    boost::optional<ProgressMeter::Status> last_status_;
+    std::uint64_t last_num_reads_;
+    bool stop_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+
+    void write();
+};
+
+} // namespace octopus
+
+#endif
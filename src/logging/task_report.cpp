@@ -0,0 +1,241 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "task_report.hpp"
+
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <utility>
+
+#include "exceptions/unwritable_file_error.hpp"
+#include "utils/string_utils.hpp"
+
+namespace octopus {
+
+namespace {
+
+boost::optional<performance::Phase> to_performance_phase(TaskTelemetry::Duration TaskTelemetry::* phase) noexcept
+{
+    using performance::Phase;
+    if (phase == &TaskTelemetry::candidate_generation) return Phase::candidate_generation;
+    if (phase == &TaskTelemetry::haplotype_generation) return Phase::haplotype_generation;
+    if (phase == &TaskTelemetry::likelihoods) return Phase::likelihoods;
+    if (phase == &TaskTelemetry::latents) return Phase::latents;
+    if (phase == &TaskTelemetry::calling) return Phase::calling;
+    if (phase == &TaskTelemetry::phasing) return Phase::phasing;
+    return boost::none;
+}
+
+allocation::Zone to_allocation_zone(TaskTelemetry::Duration TaskTelemetry::* phase) noexcept
+{
+    using allocation::Zone;
+    if (phase == &TaskTelemetry::candidate_generation) return Zone::candidate_generation;
+    if (phase == &TaskTelemetry::haplotype_generation) return Zone::haplotype_generation;
+    if (phase == &TaskTelemetry::likelihoods) return Zone::likelihoods;
+    if (phase == &TaskTelemetry::latents) return Zone::latents;
+    if (phase == &TaskTelemetry::calling) return Zone::calling;
+    if (phase == &TaskTelemetry::phasing) return Zone::phasing;
+    return Zone::other;
+}
+
+} // namespace
+
+TaskPhaseTimer::TaskPhaseTimer(TaskTelemetry* telemetry, TaskTelemetry::Duration TaskTelemetry::* phase) noexcept
+: phase_ {telemetry ? &(telemetry->*phase) : nullptr}
+, performance_phase_ {performance::is_enabled() ? to_performance_phase(phase) : boost::none}
+, start_ {}
+, allocation_zone_ {to_allocation_zone(phase)}
+{
+    if (phase_ || performance_phase_) start_ = Clock::now();
+}
+
+TaskPhaseTimer::~TaskPhaseTimer() noexcept
+{
+    if (!phase_ && !performance_phase_) return;
+    const auto duration = std::chrono::duration_cast<TaskTelemetry::Duration>(Clock::now() - start_);
+    if (phase_) *phase_ += duration;
+    if (performance_phase_) performance::record(*performance_phase_, duration);
+}
+
+namespace {
+
+double seconds(const TaskTelemetry::Duration duration) noexcept
+{
+    return std::chrono::duration<double> {duration}.count();
+}
+
+auto wall_time(const TaskTelemetry& telemetry) noexcept
+{
+    return std::chrono::duration_cast<TaskTelemetry::Duration>(telemetry.runtime.end - telemetry.runtime.start);
+}
+
+std::string json_string(const GenomicRegion& region)
+{
+    std::ostringstream ss {};
+    ss << region;
+    return '"' + utils::json_escape(ss.str()) + '"';
+}
+
+void write_phases_json(std::ostream& os, const TaskTelemetry& telemetry)
+{
+    os << "{\"candidate_generation\":" << seconds(telemetry.candidate_generation)
+       << ",\"haplotype_generation\":" << seconds(telemetry.haplotype_generation)
+       << ",\"likelihoods\":" << seconds(telemetry.likelihoods)
+       << ",\"latents\":" << seconds(telemetry.latents)
+       << ",\"calling\":" << seconds(telemetry.calling)
+       << ",\"phasing\":" << seconds(telemetry.phasing) << '}';
+}
+
+void write_allocations_json(std::ostream& os, const TaskTelemetry& telemetry)
+{
+    os << '{';
+    for (std::size_t i {0}; i < allocation::numZones; ++i) {
+        if (i > 0) os << ',';
+        os << '"' << allocation::name(static_cast<allocation::Zone>(i)) << "\":{\"count\":" << telemetry.allocations[i].allocations
+           << ",\"bytes\":" << telemetry.allocations[i].bytes << '}';
+    }
+    os << '}';
+}
+
+void write_json(std::ostream& os, const GenomicRegion& region, const TaskTelemetry& telemetry)
+{
+    os << "{\"region\":" << json_string(region)
+       << ",\"wall_time\":" << seconds(wall_time(telemetry))
+       << ",\"cpu_time\":" << seconds(telemetry.cpu_time)
+       << ",\"peak_rss_delta\":" << telemetry.peak_rss_delta
+       << ",\"reads\":" << telemetry.num_reads
+       << ",\"candidates\":" << telemetry.num_candidates
+       << ",\"haplotypes\":" << telemetry.num_haplotypes
+       << ",\"max_haplotypes\":" << telemetry.max_haplotypes
+       << ",\"genotypes\":" << telemetry.num_genotypes
+       << ",\"max_genotypes\":" << telemetry.max_genotypes
+       << ",\"phase_times\":";
+    write_phases_json(os, telemetry);
+    if (allocation::is_counting()) {
+        os << ",\"allocations\":";
+        write_allocations_json(os, telemetry);
+    }
+    os << '}';
+}
+
+void accumulate(const TaskTelemetry& telemetry, TaskTelemetry& totals)
+{
+    totals.cpu_time += telemetry.cpu_time;
+    totals.peak_rss_delta += telemetry.peak_rss_delta;
+    totals.num_reads += telemetry.num_reads;
+    totals.num_candidates += telemetry.num_candidates;
+    totals.num_haplotypes += telemetry.num_haplotypes;
+    totals.max_haplotypes = std::max(totals.max_haplotypes, telemetry.max_haplotypes);
+    totals.num_genotypes += telemetry.num_genotypes;
+    totals.max_genotypes = std::max(totals.max_genotypes, telemetry.max_genotypes);
+    totals.candidate_generation += telemetry.candidate_generation;
+    totals.haplotype_generation += telemetry.haplotype_generation;
+    totals.likelihoods += telemetry.likelihoods;
+    totals.latents += telemetry.latents;
+    totals.calling += telemetry.calling;
+    totals.phasing += telemetry.phasing;
+    totals.allocations += telemetry.allocations;
+}
+
+} // namespace
+
+std::ostream& operator<<(std::ostream& os, const TaskTelemetry& telemetry)
+{
+    const auto old_precision = os.precision(3);
+    const auto old_flags = os.setf(std::ios::fixed, std::ios::floatfield);
+    os << "wall " << seconds(wall_time(telemetry)) << "s, cpu " << seconds(telemetry.cpu_time) << "s, "
+       << telemetry.num_reads << " reads, " << telemetry.num_candidates << " candidates, "
+       << telemetry.num_haplotypes << " haplotypes (max " << telemetry.max_haplotypes << "), "
+       << telemetry.num_genotypes << " genotypes (max " << telemetry.max_genotypes << "), "
+       << "peak RSS +" << telemetry.peak_rss_delta / 1024 << "KiB; phases: candidates "
+       << seconds(telemetry.candidate_generation) << "s, haplotypes " << seconds(telemetry.haplotype_generation)
+       << "s, likelihoods " << seconds(telemetry.likelihoods) << "s, latents " << seconds(telemetry.latents)
+       << "s, calling " << seconds(telemetry.calling) << "s, phasing " << seconds(telemetry.phasing) << 's';
+    os.precision(old_precision);
+    os.flags(old_flags);
+    return os;
+}
+
+class UnwritableTaskReport : public UnwritableFileError
+{
+    std::string do_where() const override { return "TaskReport"; }
+public:
+    UnwritableTaskReport(boost::filesystem::path file) : UnwritableFileError {std::move(file), "task report"} {}
+};
+
+TaskReport::TaskReport(Path file, const std::size_t max_ranked_tasks)
+: path_ {std::move(file)}
+, file_ {path_.string()}
+, max_ranked_tasks_ {max_ranked_tasks}
+, slowest_ {}
+, num_tasks_ {0}
+, wall_time_ {}
+, totals_ {}
+{
+    if (!file_) {
+        throw UnwritableTaskReport {path_};
+    }
+    file_ << std::setprecision(6);
+    slowest_.reserve(max_ranked_tasks_ + 1);
+}
+
+const TaskReport::Path& TaskReport::path() const noexcept
+{
+    return path_;
+}
+
+namespace {
+
+bool is_slower(const TaskTelemetry& lhs, const TaskTelemetry& rhs) noexcept
+{
+    return wall_time(lhs) > wall_time(rhs);
+}
+
+} // namespace
+
+void TaskReport::write(const GenomicRegion& region, const TaskTelemetry& telemetry)
+{
+    write_json(file_, region, telemetry);
+    file_ << '\n';
+    ++num_tasks_;
+    wall_time_ += wall_time(telemetry);
+    accumulate(telemetry, totals_);
+    if (max_ranked_tasks_ == 0) return;
+    const auto heap_order = [] (const RankedTask& lhs, const RankedTask& rhs) { return is_slower(lhs.telemetry, rhs.telemetry); };
+    if (slowest_.size() < max_ranked_tasks_) {
+        slowest_.push_back({region, telemetry});
+        std::push_heap(std::begin(slowest_), std::end(slowest_), heap_order);
+    } else if (is_slower(telemetry, slowest_.front().telemetry)) {
+        std::pop_heap(std::begin(slowest_), std::end(slowest_), heap_order);
+        slowest_.back() = {region, telemetry};
+        std::push_heap(std::begin(slowest_), std::end(slowest_), heap_order);
+    }
+}
+
+void TaskReport::write_summary()
+{
+    auto ranked = slowest_;
+    std::sort(std::begin(ranked), std::end(ranked), [] (const RankedTask& lhs, const RankedTask& rhs) {
+        return is_slower(lhs.telemetry, rhs.telemetry); });
+    file_ << "{\"summary\":{\"tasks\":" << num_tasks_
+          << ",\"wall_time\":" << seconds(wall_time_)
+          << ",\"cpu_time\":" << seconds(totals_.cpu_time)
+          << ",\"max_haplotypes\":" << totals_.max_haplotypes
+          << ",\"max_genotypes\":" << totals_.max_genotypes
+          << ",\"phase_times\":";
+    write_phases_json(file_, totals_);
+    if (allocation::is_counting()) {
+        file_ << ",\"allocations\":";
+        write_allocations_json(file_, totals_);
+    }
+    file_ << ",\"slowest\":[";
+    for (std::size_t i {0}; i < ranked.size(); ++i) {
+        if (i > 0) file_ << ',';
+        write_json(file_, ranked[i].region, ranked[i].telemetry);
+    }
+    file_ << "]}}" << std::endl;
+}
+
+} // namespace octopus
@@ -0,0 +1,108 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef task_report_hpp
+#define task_report_hpp
+
+#include <cstddef>
+#include <chrono>
+#include <fstream>
+#include <vector>
+#include <ostream>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "utils/timing.hpp"
+#include "performance_counters.hpp"
+#include "allocation_counts.hpp"
+
+namespace octopus {
+
+// The resources used by one calling task. The caller fills in the counts and phase times; whoever
+// runs the task fills in the runtime, CPU time and memory.
+struct TaskTelemetry
+{
+    using Duration = std::chrono::nanoseconds;
+
+    utils::TimeInterval runtime = {};
+    Duration cpu_time = {}; // of the thread running the task, excluding work it fanned out to other workers
+    std::size_t peak_rss_delta = 0; // growth of the process peak resident set size (bytes) while the task ran
+    std::size_t num_reads = 0, num_candidates = 0;
+    std::size_t num_haplotypes = 0, max_haplotypes = 0; // summed and largest over active regions
+    std::size_t num_genotypes = 0, max_genotypes = 0;
+    Duration candidate_generation = {}, haplotype_generation = {}, likelihoods = {}, latents = {}, calling = {}, phasing = {};
+    allocation::ZoneCounts allocations = {}; // of the thread running the task; only counted with ALLOCATION_COUNTING
+};
+
+// Adds the time the timer is alive to a phase of the telemetry, if there is any, and to the
+// matching performance counter phase, if counters are enabled. Allocations made meanwhile are
+// attributed to the matching allocation zone.
+class TaskPhaseTimer
+{
+public:
+    TaskPhaseTimer() = delete;
+
+    TaskPhaseTimer(TaskTelemetry* telemetry, TaskTelemetry::Duration TaskTelemetry::* phase) noexcept;
+
+    TaskPhaseTimer(const TaskPhaseTimer&)            = delete;
+    TaskPhaseTimer& operator=(const TaskPhaseTimer&) = delete;
+    TaskPhaseTimer(TaskPhaseTimer&&)                 = delete;
+    TaskPhaseTimer& operator=(TaskPhaseTimer&&)      = delete;
+
+    ~TaskPhaseTimer() noexcept;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    TaskTelemetry::Duration* phase_;
+    boost::optional<performance::Phase> performance_phase_;
+    Clock::time_point start_;
+    allocation::ScopedZone allocation_zone_;
+};
+
+std::ostream& operator<<(std::ostream& os, const TaskTelemetry& telemetry);
+
+// Writes a JSON object per task on its own line (JSONL), and a final line summarising the run
+// with the slowest tasks ranked by wall time. Not thread safe.
+class TaskReport
+{
+public:
+    using Path = boost::filesystem::path;
+
+    TaskReport() = delete;
+
+    TaskReport(Path file, std::size_t max_ranked_tasks = 50);
+
+    TaskReport(const TaskReport&)            = delete;
+    TaskReport& operator=(const TaskReport&) = delete;
+    TaskReport(TaskReport&&)                 = default;
+    TaskReport& operator=(TaskReport&&)      = default;
+
+    ~TaskReport() = default;
+
+    const Path& path() const noexcept;
+
+    void write(const GenomicRegion& region, const TaskTelemetry& telemetry);
+    void write_summary();
+
+private:
+    struct RankedTask
+    {
+        GenomicRegion region;
+        TaskTelemetry telemetry;
+    };
+
+    Path path_;
+    std::ofstream file_;
+    std::size_t max_ranked_tasks_;
+    std::vector<RankedTask> slowest_; // min-heap on wall time
+    std::size_t num_tasks_;
+    TaskTelemetry::Duration wall_time_;
+    TaskTelemetry totals_;
+};
+
+} // namespace octopus
+
+#endif
@@ -3,8 +3,15 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <cstddef>
 #include <chrono>
 #include <exception>
+#include <string>
+#include <vector>
+#include <future>
+#include <thread>
+#include <algorithm>
+#include <iterator>
 
 #include "config/config.hpp"
 #include "config/common.hpp"
@@ -13,9 +20,19 @@
 #include "config/option_parser.hpp"
 #include "config/option_collation.hpp"
 #include "core/octopus.hpp"
+#include "core/calling_service.hpp"
+#include "core/cohort_genotyping.hpp"
+#include "io/read/read_manager.hpp"
+#include "io/read/read_depth_index.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "io/reference/two_bit_reference.hpp"
+#include "io/reference/tandem_repeat_index.hpp"
+#include "core/models/pairhmm/simd_pair_hmm_kernels.hpp"
+#include "core/models/pairhmm/gpu_pair_hmm.hpp"
 #include "utils/timing.hpp"
 #include "utils/system_utils.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/thread_pool.hpp"
 #include "exceptions/error.hpp"
 #include "logging/error_handler.hpp"
 
@@ -58,6 +75,22 @@ bool could_exceed_open_file_limit(const OptionMap& options)
     return options::estimate_max_open_files(options) >= get_max_open_files();
 }
 
+// Must be done before any calling components are made, as each PairHMM takes the kernels when it is made
+void init_pair_hmm(const OptionMap& options)
+{
+    const auto instruction_set = get_pair_hmm_instruction_set(options);
+    if (instruction_set) hmm::simd::set_instruction_set(*instruction_set);
+    logging::InfoLogger info_log {};
+    stream(info_log) << "Using " << hmm::simd::to_string(hmm::simd::get_instruction_set()) << " pair HMM kernels"
+                     << (instruction_set ? "" : " (fastest supported by this CPU)");
+    const auto gpu_min_batch_size = get_pair_hmm_gpu_min_batch_size(options);
+    if (gpu_min_batch_size) {
+        hmm::gpu::enable(*gpu_min_batch_size);
+        stream(info_log) << "Using GPU " << hmm::gpu::device_name() << " for batches of at least "
+                         << *gpu_min_batch_size << " pair HMM alignments";
+    }
+}
+
 void sanity_check(const OptionMap& options)
 {
     logging::WarningLogger warn_log {};
@@ -66,13 +99,75 @@ void sanity_check(const OptionMap& options)
     }
 }
 
+bool is_index_reads_command(const int argc, const char** argv)
+{
+    return argc > 1 && std::string {argv[1]} == "index-reads";
+}
+
+// Writes a ReadDepthIndex next to each input read file, so later runs on the same files can skip profiling reads
+void index_reads(const OptionMap& options)
+{
+    logging::InfoLogger info_log {};
+    const auto read_paths = make_read_manager(options).paths();
+    const auto num_threads = get_num_threads(options);
+    ThreadPool workers {std::min<std::size_t>(num_threads ? *num_threads : std::thread::hardware_concurrency(), read_paths.size())};
+    std::vector<std::future<void>> indexed {};
+    indexed.reserve(read_paths.size());
+    for (const auto& read_path : read_paths) {
+        indexed.push_back(workers.push([&read_path] () {
+            const io::ReadReader reads {read_path};
+            ReadDepthIndex {reads}.write(read_path);
+        }));
+    }
+    for (std::size_t i {0}; i < read_paths.size(); ++i) {
+        indexed[i].get();
+        stream(info_log) << "Wrote read depth index " << ReadDepthIndex::default_path(read_paths[i]).string();
+    }
+}
+
+bool is_index_reference_command(const int argc, const char** argv)
+{
+    return argc > 1 && std::string {argv[1]} == "index-reference";
+}
+
+// Writes a TwoBitReference and TandemRepeatIndex next to the reference FASTA, which later runs then use in
+// place of the FASTA and repeat finding
+void index_reference(const OptionMap& options)
+{
+    logging::InfoLogger info_log {};
+    const auto reference_path = get_reference_path(options);
+    io::TwoBitReference::write(reference_path);
+    stream(info_log) << "Wrote 2-bit reference " << io::TwoBitReference::default_path(reference_path).string();
+    io::TandemRepeatIndex::write(octopus::make_reference(reference_path), reference_path);
+    stream(info_log) << "Wrote tandem repeat index " << io::TandemRepeatIndex::default_path(reference_path).string();
+}
+
+bool is_serve_command(const int argc, const char** argv)
+{
+    return argc > 1 && std::string {argv[1]} == "serve";
+}
+
+bool is_merge_cohort_command(const int argc, const char** argv)
+{
+    return argc > 1 && std::string {argv[1]} == "merge-cohort";
+}
+
 } // namespace
 
 int main(const int argc, const char** argv)
 {
     OptionMap options;
+    const auto index_reads_command = is_index_reads_command(argc, argv);
+    const auto index_reference_command = is_index_reference_command(argc, argv);
+    const auto serve_command = is_serve_command(argc, argv);
+    const auto merge_cohort_command = is_merge_cohort_command(argc, argv);
+    std::vector<const char*> args {argv, argv + argc};
     try {
-        options = parse_options(argc, argv);
+        if (index_reads_command || index_reference_command || serve_command || merge_cohort_command) {
+            args.erase(std::next(std::begin(args)));
+        }
+        options = parse_options(static_cast<int>(args.size()), args.data(),
+                                !(index_reference_command || serve_command || merge_cohort_command));
     } catch (const Error& e) {
         return log_startup_exception(e);
     } catch (const std::exception& e) {
@@ -90,12 +185,23 @@ int main(const int argc, const char** argv)
             const auto start = std::chrono::system_clock::now();
             sanity_check(options);
             log_command_line_options(options);
-            auto components = collate_genome_calling_components(options);
-            auto end = std::chrono::system_clock::now();
-            using utils::TimeInterval;
-            stream(info_log) << "Done initialising calling components in " << TimeInterval {start, end};
-            if (validate(components)) {
-                run_octopus(components, {to_string(argc, argv), to_string(options, true, false)});
+            init_pair_hmm(options);
+            if (index_reads_command) {
+                index_reads(options);
+            } else if (index_reference_command) {
+                index_reference(options);
+            } else if (serve_command) {
+                run_calling_service(options, {std::cbegin(args), std::cend(args)});
+            } else if (merge_cohort_command) {
+                run_cohort_genotyping(options);
+            } else {
+                auto components = collate_genome_calling_components(options);
+                auto end = std::chrono::system_clock::now();
+                using utils::TimeInterval;
+                stream(info_log) << "Done initialising calling components in " << TimeInterval {start, end};
+                if (validate(components)) {
+                    run_octopus(components, {to_string(argc, argv), to_string(options, true, false)});
+                }
             }
             log_program_end();
         } catch (const Error& e) {
@@ -7,6 +7,8 @@
 #include <limits>
 #include <algorithm>
 #include <iterator>
+#include <vector>
+#include <memory>
 
 #include "utils/mappable_algorithms.hpp"
 #include "utils/read_stats.hpp"
@@ -20,10 +22,13 @@ BufferedReadPipe::BufferedReadPipe(const ReadPipe& source, Config config)
 BufferedReadPipe::BufferedReadPipe(const ReadPipe& source, Config config, std::vector<GenomicRegion> hints)
 : source_ {source}
 , config_ {config}
-, buffer_ {}
+, buffer_ {std::make_shared<const ReadMap>()}
+, compressed_buffer_ {}
 , buffered_region_ {}
+, buffered_subregions_ {}
 , hints_ {}
 , debug_log_ {}
+, prefetch_ {}
 {
     hint(std::move(hints));
     if (DEBUG_MODE) debug_log_ = logging::DebugLogger {};
@@ -36,16 +41,75 @@ const ReadPipe& BufferedReadPipe::source() const noexcept
 
 void BufferedReadPipe::clear() noexcept
 {
-    buffer_.clear();
+    buffer_ = std::make_shared<const ReadMap>();
+    compressed_buffer_ = nullptr;
     buffered_region_ = boost::none;
+    buffered_subregions_.clear();
     hints_.clear();
+    prefetch_ = {}; // waits for any prefetch
 }
 
 ReadMap BufferedReadPipe::fetch_reads(const GenomicRegion& region) const
 {
     if (config_.max_buffer_size == 0) return source_.get().fetch_reads(region);
     setup_buffer(region);
-    return copy_overlapped(buffer_, region);
+    return copy_buffered(region);
+}
+
+namespace {
+
+auto sort_and_merge(std::vector<GenomicRegion> regions)
+{
+    std::sort(std::begin(regions), std::end(regions));
+    return extract_covered_regions(regions);
+}
+
+bool overlaps_any(const AlignedRead& read, const std::vector<GenomicRegion>& regions) noexcept
+{
+    return std::any_of(std::cbegin(regions), std::cend(regions), [&] (const auto& region) { return overlaps(read, region); });
+}
+
+} // namespace
+
+ReadMap BufferedReadPipe::fetch_reads(const std::vector<GenomicRegion>& regions) const
+{
+    if (regions.size() == 1) return fetch_reads(regions.front());
+    const auto covered_regions = sort_and_merge(regions);
+    if (config_.max_buffer_size == 0 || covered_regions.empty() || !setup_buffer(covered_regions)) {
+        return source_.get().fetch_reads(covered_regions);
+    }
+    return copy_buffered(covered_regions);
+}
+
+BufferedReadPipe::SharedReadMap BufferedReadPipe::fetch_shared_reads(const GenomicRegion& region) const
+{
+    if (config_.max_buffer_size == 0) return std::make_shared<const ReadMap>(source_.get().fetch_reads(region));
+    setup_buffer(region);
+    if (compressed_buffer_) {
+        return std::make_shared<const ReadMap>(compressed_buffer_->decompress(region));
+    } else if (count_overlapped(*buffer_, region) == count_reads(*buffer_)) {
+        return buffer_;
+    } else {
+        return std::make_shared<const ReadMap>(copy_overlapped(*buffer_, region));
+    }
+}
+
+BufferedReadPipe::SharedReadMap BufferedReadPipe::fetch_shared_reads(const std::vector<GenomicRegion>& regions) const
+{
+    if (regions.size() == 1) return fetch_shared_reads(regions.front());
+    const auto covered_regions = sort_and_merge(regions);
+    if (config_.max_buffer_size == 0 || covered_regions.empty() || !setup_buffer(covered_regions)) {
+        return std::make_shared<const ReadMap>(source_.get().fetch_reads(covered_regions));
+    }
+    if (compressed_buffer_) return std::make_shared<const ReadMap>(compressed_buffer_->decompress(covered_regions));
+    const auto all_requested = std::all_of(std::cbegin(*buffer_), std::cend(*buffer_), [&] (const auto& p) {
+        return std::all_of(std::cbegin(p.second), std::cend(p.second),
+                           [&] (const auto& read) { return overlaps_any(read, covered_regions); }); });
+    if (all_requested) {
+        return buffer_;
+    } else {
+        return std::make_shared<const ReadMap>(copy_buffered(covered_regions));
+    }
 }
 
 void BufferedReadPipe::hint(std::vector<GenomicRegion> hints) const
@@ -63,17 +127,94 @@ void BufferedReadPipe::hint(std::vector<GenomicRegion> hints) const
     }
 }
 
+namespace {
+
+bool is_buffered(const GenomicRegion& region, const GenomicRegion& buffered_region,
+                 const std::vector<GenomicRegion>& buffered_subregions) noexcept
+{
+    return contains(buffered_region, region)
+           && (buffered_subregions.empty()
+               || std::any_of(std::cbegin(buffered_subregions), std::cend(buffered_subregions),
+                              [&] (const auto& subregion) { return contains(subregion, region); }));
+}
+
+} // namespace
+
 bool BufferedReadPipe::is_cached(const GenomicRegion& region) const noexcept
 {
-    return buffered_region_ && contains(*buffered_region_, region);
+    return buffered_region_ && is_buffered(region, *buffered_region_, buffered_subregions_);
 }
 
 // private methods
 
+bool BufferedReadPipe::setup_buffer(const std::vector<GenomicRegion>& covered_regions) const
+{
+    if (std::all_of(std::cbegin(covered_regions), std::cend(covered_regions),
+                    [this] (const auto& region) { return is_cached(region); })) {
+        return true;
+    }
+    if (take_prefetch(covered_regions)) {
+        prefetch();
+        return true;
+    }
+    // A single multi-region fetch from the source beats refilling the buffer for each region
+    return false;
+}
+
+void BufferedReadPipe::set_buffer(ReadMap reads) const
+{
+    if (config_.compress) {
+        set_buffer(std::make_shared<const CompressedReadBuffer>(reads));
+    } else {
+        buffer_ = std::make_shared<const ReadMap>(std::move(reads));
+    }
+}
+
+void BufferedReadPipe::set_buffer(std::shared_ptr<const CompressedReadBuffer> reads) const
+{
+    static constexpr double maxCompressionRatio {8};
+    // Later buffers are sized assuming they compress as well as this one
+    if (!reads->empty() && reads->footprint().bytes() > 0) {
+        const auto ratio = static_cast<double>(reads->uncompressed_footprint().bytes()) / reads->footprint().bytes();
+        compression_ratio_ = std::max(std::min(ratio, maxCompressionRatio), 1.0);
+    }
+    compressed_buffer_ = std::move(reads);
+    buffer_ = std::make_shared<const ReadMap>();
+}
+
+ReadMap BufferedReadPipe::copy_buffered(const GenomicRegion& region) const
+{
+    if (compressed_buffer_) {
+        return compressed_buffer_->decompress(region);
+    } else {
+        return copy_overlapped(*buffer_, region);
+    }
+}
+
+ReadMap BufferedReadPipe::copy_buffered(const std::vector<GenomicRegion>& covered_regions) const
+{
+    if (compressed_buffer_) return compressed_buffer_->decompress(covered_regions);
+    // Reads spanning neighbouring regions must only be copied once
+    ReadMap result {buffer_->size()};
+    for (const auto& p : *buffer_) {
+        std::vector<AlignedRead> reads {};
+        std::copy_if(std::cbegin(p.second), std::cend(p.second), std::back_inserter(reads),
+                     [&] (const auto& read) { return overlaps_any(read, covered_regions); });
+        result.emplace(p.first, ReadMap::mapped_type {std::make_move_iterator(std::begin(reads)),
+                                                      std::make_move_iterator(std::end(reads))});
+    }
+    return result;
+}
+
 void BufferedReadPipe::setup_buffer(const GenomicRegion& request) const
 {
     if (!is_cached(request)) {
         if (debug_log_) stream(*debug_log_) << "Request " << request << " is not cached";
+        if (take_prefetch({request})) {
+            if (debug_log_) stream(*debug_log_) << "Request " << request << " was prefetched in " << *buffered_region_;
+            prefetch();
+            return;
+        }
         auto max_region = get_max_fetch_region(request);
         if (debug_log_) stream(*debug_log_) << "Max fetch region for request " << request << " is " << max_region;
         bool unchecked_fetch {false};
@@ -81,24 +222,33 @@ void BufferedReadPipe::setup_buffer(const GenomicRegion& request) const
             buffered_region_ = std::move(max_region);
             unchecked_fetch = true;
         } else {
-            buffered_region_ = source_.get().read_manager().find_covered_subregion(max_region, config_.max_buffer_size);
+            buffered_region_ = source_.get().read_manager().find_covered_subregion(max_region, max_buffer_size());
         }
         if (debug_log_) stream(*debug_log_) << "Buffer region for request " << request << " is " << *buffered_region_;
-        buffer_ = source_.get().fetch_reads(expand(*buffered_region_, config_.fetch_expansion));
+        const auto fetch_region = expand(*buffered_region_, config_.fetch_expansion);
+        buffered_subregions_ = get_hinted_fetch_regions(request, fetch_region);
+        ReadMap buffer {};
+        if (buffered_subregions_.empty()) {
+            buffer = source_.get().fetch_reads(fetch_region);
+        } else {
+            if (debug_log_) stream(*debug_log_) << "Buffering " << buffered_subregions_.size() << " hinted regions in " << fetch_region;
+            buffer = source_.get().fetch_reads(buffered_subregions_);
+        }
         if (unchecked_fetch) {
-            const auto fetch_size = count_reads(buffer_);
-            if (fetch_size > config_.max_buffer_size) {
+            const auto fetch_size = count_reads(buffer);
+            if (fetch_size > max_buffer_size()) {
                 if (default_unchecked_fetch_overflowed_) {
                     adjusted_unchecked_fetch_overflowed_ = true;
                 } else {
                     default_unchecked_fetch_overflowed_ = true;
                 }
                 // Clear buffer of reads to rhs of request
-                for (auto& p : buffer_) {
+                for (auto& p : buffer) {
                     const auto last_overlapped = find_first_after(p.second, request);
                     p.second.erase(last_overlapped, std::cend(p.second));
                 }
                 buffered_region_ = request;
+                buffered_subregions_.clear();
             }
         } else {
             if (min_checked_fetch_size_) {
@@ -107,6 +257,10 @@ void BufferedReadPipe::setup_buffer(const GenomicRegion& request) const
                 min_checked_fetch_size_ = size(*buffered_region_);
             }
         }
+        // Readers of the old buffer keep it alive, so it is replaced rather than modified
+        set_buffer(std::move(buffer));
+        prefetch();
+        advise_next_access();
     } else if (debug_log_) {
         stream(*debug_log_) << "Request " << request << " is already cached";
     }
@@ -139,6 +293,23 @@ GenomicRegion BufferedReadPipe::get_max_fetch_region(const GenomicRegion& reques
     }
 }
 
+std::vector<GenomicRegion>
+BufferedReadPipe::get_hinted_fetch_regions(const GenomicRegion& request, const GenomicRegion& fetch_region) const
+{
+    // Only fetch the hinted parts of the buffer region (e.g. the targets of a panel) rather than the gaps between them
+    if (hints_.count(request.contig_name()) == 0) return {};
+    const auto overlapped_hints = overlap_range(hints_.at(request.contig_name()), fetch_region);
+    if (empty(overlapped_hints)) return {};
+    std::vector<GenomicRegion> result {};
+    result.push_back(expand(request, config_.fetch_expansion));
+    for (const auto& hint : overlapped_hints) {
+        result.push_back(*overlapped_region(expand(hint, config_.fetch_expansion), fetch_region));
+    }
+    result = sort_and_merge(std::move(result));
+    if (result.size() == 1) result.clear(); // no gaps to skip
+    return result;
+}
+
 namespace {
 
 GenomicRegion fully_expand_rhs(const GenomicRegion& region)
@@ -172,4 +343,83 @@ bool BufferedReadPipe::can_make_unchecked_fetch() const noexcept
            && (config_.max_fetch_size || min_checked_fetch_size_);
 }
 
+std::size_t BufferedReadPipe::max_buffer_size() const noexcept
+{
+    auto result = config_.prefetch ? config_.max_buffer_size / 2 : config_.max_buffer_size;
+    if (config_.compress) result = static_cast<std::size_t>(result * compression_ratio_);
+    return result;
+}
+
+bool BufferedReadPipe::take_prefetch(const std::vector<GenomicRegion>& requests) const
+{
+    if (!prefetch_.valid()) return false;
+    // Always wait, even if the prefetch is no use, as the source can't be shared with the prefetch thread
+    auto prefetched = prefetch_.get();
+    if (!std::all_of(std::cbegin(requests), std::cend(requests), [&] (const auto& request) {
+        return is_buffered(request, prefetched.region, prefetched.subregions); })) {
+        if (debug_log_) stream(*debug_log_) << "Discarding prefetched buffer " << prefetched.region;
+        return false;
+    }
+    if (prefetched.compressed_reads) {
+        set_buffer(std::move(prefetched.compressed_reads));
+    } else {
+        set_buffer(std::move(prefetched.reads));
+    }
+    buffered_region_ = std::move(prefetched.region);
+    buffered_subregions_ = std::move(prefetched.subregions);
+    return true;
+}
+
+void BufferedReadPipe::prefetch() const
+{
+    if (!config_.prefetch) return;
+    const auto next_request = get_next_request();
+    if (!next_request) return;
+    Buffer next {{}, {}, source_.get().read_manager().find_covered_subregion(get_max_fetch_region(*next_request), max_buffer_size()), {}};
+    const auto fetch_region = expand(next.region, config_.fetch_expansion);
+    next.subregions = get_hinted_fetch_regions(*next_request, fetch_region);
+    if (debug_log_) stream(*debug_log_) << "Prefetching buffer " << next.region;
+    const ReadPipe& source {source_.get()};
+    const auto compress = config_.compress;
+    prefetch_ = std::async(std::launch::async, [&source, fetch_region, compress] (Buffer result) {
+        if (result.subregions.empty()) {
+            result.reads = source.fetch_reads(fetch_region);
+        } else {
+            result.reads = source.fetch_reads(result.subregions);
+        }
+        if (compress) {
+            result.compressed_reads = std::make_shared<const CompressedReadBuffer>(result.reads);
+            result.reads.clear();
+        }
+        return result;
+    }, std::move(next));
+}
+
+void BufferedReadPipe::advise_next_access() const
+{
+    // A prefetch is already reading the next buffer
+    if (config_.prefetch || !buffered_region_) return;
+    const auto next_request = get_next_request();
+    if (!next_request) return;
+    // Assume the next buffer will be about the size of this one
+    const auto next_region = expand(expand_rhs(head_region(*next_request), size(*buffered_region_)), config_.fetch_expansion);
+    auto next_regions = get_hinted_fetch_regions(*next_request, next_region);
+    if (next_regions.empty()) next_regions.push_back(next_region);
+    source_.get().read_manager().advise_access(source_.get().samples(), next_regions);
+}
+
+boost::optional<GenomicRegion> BufferedReadPipe::get_next_request() const
+{
+    // The hints are the only indication of where requests go next
+    const auto& contig = buffered_region_->contig_name();
+    if (hints_.count(contig) == 0) return boost::none;
+    const auto& hints = hints_.at(contig);
+    const auto buffered_end = buffered_region_->end();
+    // Hints are non-overlapping, so sorted by end too
+    const auto next_hint = std::partition_point(std::cbegin(hints), std::cend(hints),
+                                                [=] (const auto& hint) { return hint.end() <= buffered_end; });
+    if (next_hint == std::cend(hints)) return boost::none;
+    return GenomicRegion {contig, std::max(next_hint->begin(), buffered_end), next_hint->end()};
+}
+
 } // namespace octopus
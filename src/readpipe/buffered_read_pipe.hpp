@@ -6,10 +6,14 @@
 
 #include <functional>
 #include <cstddef>
+#include <vector>
+#include <future>
+#include <memory>
 
 #include <boost/optional.hpp>
 
 #include "read_pipe.hpp"
+#include "compressed_read_buffer.hpp"
 #include "basics/genomic_region.hpp"
 #include "containers/mappable_map.hpp"
 #include "logging/logging.hpp"
@@ -19,6 +23,8 @@ namespace octopus {
 class BufferedReadPipe
 {
 public:
+    using SharedReadMap = std::shared_ptr<const ReadMap>;
+    
     struct Config
     {
         std::size_t max_buffer_size;
@@ -26,6 +32,13 @@ public:
         boost::optional<GenomicRegion::Size> max_fetch_size = boost::none;
         boost::optional<GenomicRegion::Size> max_hint_gap = boost::none;
         bool allow_unchecked_fetches = true;
+        // Load the buffer for the next hinted region on a background thread while the current one is used.
+        // The current and prefetched buffers then get half of max_buffer_size each, and the source
+        // must not be used elsewhere while a prefetch is in flight.
+        bool prefetch = false;
+        // Keep the buffer in a compressed format and decompress the reads for each request. The buffer then
+        // holds as many more reads as compression saves memory, at the cost of decompressing every request.
+        bool compress = false;
     };
     
     BufferedReadPipe() = delete;
@@ -38,7 +51,7 @@ public:
     BufferedReadPipe(BufferedReadPipe&&)                 = default;
     BufferedReadPipe& operator=(BufferedReadPipe&&)      = default;
     
-    ~BufferedReadPipe() = default;
+    ~BufferedReadPipe() = default; // waits for any prefetch
     
     const ReadPipe& source() const noexcept;
     
@@ -47,6 +60,12 @@ public:
     ReadMap fetch_reads(const GenomicRegion& region) const;
     ReadMap fetch_reads(const std::vector<GenomicRegion>& regions) const;
     
+    // As fetch_reads, but if every buffered read is requested then the buffer itself is returned rather than
+    // a copy. The buffer is immutable and stays valid for as long as it is referenced, even after it is
+    // replaced, so callers that only read from the result avoid copying reads.
+    SharedReadMap fetch_shared_reads(const GenomicRegion& region) const;
+    SharedReadMap fetch_shared_reads(const std::vector<GenomicRegion>& regions) const;
+    
     // Hints are regions that will likely be requested in the future. This does not affect the observable behaviour of
     // the object, but may allow improved performance through optimised read buffering. If the hints given are
     // inaccurate it will likely result in worse performance.
@@ -57,20 +76,43 @@ public:
 private:
     using RegionMap = MappableSetMap<GenomicRegion::ContigName, GenomicRegion>;
     
+    struct Buffer
+    {
+        ReadMap reads;
+        std::shared_ptr<const CompressedReadBuffer> compressed_reads;
+        GenomicRegion region;
+        std::vector<GenomicRegion> subregions;
+    };
+    
     std::reference_wrapper<const ReadPipe> source_;
     Config config_;
-    mutable ReadMap buffer_;
+    mutable SharedReadMap buffer_;
+    mutable std::shared_ptr<const CompressedReadBuffer> compressed_buffer_; // used instead of buffer_ if config_.compress
+    mutable double compression_ratio_ = 1;
     mutable boost::optional<GenomicRegion> buffered_region_;
+    mutable std::vector<GenomicRegion> buffered_subregions_; // if not empty, only these parts of buffered_region_ are buffered
     mutable RegionMap hints_;
     mutable bool default_unchecked_fetch_overflowed_ = false;
     mutable bool adjusted_unchecked_fetch_overflowed_ = false;
     mutable boost::optional<GenomicRegion::Size> min_checked_fetch_size_ = boost::none;
     mutable boost::optional<logging::DebugLogger> debug_log_;
+    mutable std::future<Buffer> prefetch_;
     
     void setup_buffer(const GenomicRegion& request) const;
+    bool setup_buffer(const std::vector<GenomicRegion>& covered_regions) const;
+    void set_buffer(ReadMap reads) const;
+    void set_buffer(std::shared_ptr<const CompressedReadBuffer> reads) const;
+    ReadMap copy_buffered(const GenomicRegion& region) const;
+    ReadMap copy_buffered(const std::vector<GenomicRegion>& covered_regions) const;
     GenomicRegion get_max_fetch_region(const GenomicRegion& request) const;
     GenomicRegion get_default_max_fetch_region(const GenomicRegion& request) const;
+    std::vector<GenomicRegion> get_hinted_fetch_regions(const GenomicRegion& request, const GenomicRegion& fetch_region) const;
     bool can_make_unchecked_fetch() const noexcept;
+    std::size_t max_buffer_size() const noexcept;
+    bool take_prefetch(const std::vector<GenomicRegion>& requests) const;
+    void prefetch() const;
+    void advise_next_access() const;
+    boost::optional<GenomicRegion> get_next_request() const;
 };
 
 } // namespace octopus
@@ -0,0 +1,361 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "compressed_read_buffer.hpp"
+
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+#include "basics/cigar_string.hpp"
+#include "utils/read_stats.hpp"
+
+namespace octopus {
+
+namespace {
+
+using Annotations = std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>>;
+
+constexpr AlignedRead::Tag readGroupTag {'R','G'};
+constexpr char cigarFlags[] {'M', '=', 'X', 'I', 'D', 'S', 'H', 'P', 'N'};
+constexpr char bases[] {'A', 'C', 'G', 'T'};
+
+void write_varint(std::uint64_t value, std::string& out)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+std::uint64_t read_varint(const char*& in) noexcept
+{
+    std::uint64_t result {0};
+    for (unsigned shift {0};; shift += 7) {
+        const auto byte = static_cast<std::uint8_t>(*in++);
+        result |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) break;
+    }
+    return result;
+}
+
+void write_string(const std::string& str, std::string& out)
+{
+    write_varint(str.size(), out);
+    out.append(str);
+}
+
+std::string read_string(const char*& in)
+{
+    const auto length = read_varint(in);
+    std::string result {in, in + length};
+    in += length;
+    return result;
+}
+
+unsigned encode(const AlignedRead::Flags& flags) noexcept
+{
+    return flags.multiple_segment_template
+        | flags.all_segments_in_read_aligned << 1
+        | flags.unmapped << 2
+        | flags.reverse_mapped << 3
+        | flags.secondary_alignment << 4
+        | flags.qc_fail << 5
+        | flags.duplicate << 6
+        | flags.supplementary_alignment << 7
+        | flags.first_template_segment << 8
+        | flags.last_template_segment << 9;
+}
+
+AlignedRead::Flags decode_flags(const unsigned bits) noexcept
+{
+    AlignedRead::Flags result {};
+    result.multiple_segment_template    = bits & 1;
+    result.all_segments_in_read_aligned = bits >> 1 & 1;
+    result.unmapped                     = bits >> 2 & 1;
+    result.reverse_mapped               = bits >> 3 & 1;
+    result.secondary_alignment          = bits >> 4 & 1;
+    result.qc_fail                      = bits >> 5 & 1;
+    result.duplicate                    = bits >> 6 & 1;
+    result.supplementary_alignment      = bits >> 7 & 1;
+    result.first_template_segment       = bits >> 8 & 1;
+    result.last_template_segment        = bits >> 9 & 1;
+    return result;
+}
+
+void write_cigar(const CigarString& cigar, std::string& out)
+{
+    write_varint(cigar.size(), out);
+    for (const auto& op : cigar) {
+        const auto flag = std::find(std::cbegin(cigarFlags), std::cend(cigarFlags), static_cast<char>(op.flag()));
+        write_varint(static_cast<std::uint64_t>(op.size()) << 4 | std::distance(std::cbegin(cigarFlags), flag), out);
+    }
+}
+
+CigarString read_cigar(const char*& in)
+{
+    CigarString result(read_varint(in));
+    for (auto& op : result) {
+        const auto value = read_varint(in);
+        op = CigarOperation {static_cast<CigarOperation::Size>(value >> 4), static_cast<CigarOperation::Flag>(cigarFlags[value & 0xF])};
+    }
+    return result;
+}
+
+int base_code(const char base) noexcept
+{
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return -1;
+    }
+}
+
+// Bases are packed four to a byte; any other symbol is packed as 'A' and listed as an exception
+void write_sequence(const AlignedRead::NucleotideSequence& sequence, std::string& out)
+{
+    write_varint(sequence.size(), out);
+    std::vector<std::size_t> exceptions {};
+    for (std::size_t i {0}; i < sequence.size(); ++i) {
+        if (base_code(sequence[i]) < 0) exceptions.push_back(i);
+    }
+    write_varint(exceptions.size(), out);
+    std::size_t prev_exception {0};
+    for (const auto i : exceptions) {
+        write_varint(i - prev_exception, out);
+        out.push_back(sequence[i]);
+        prev_exception = i;
+    }
+    for (std::size_t i {0}; i < sequence.size(); i += 4) {
+        unsigned packed {0};
+        for (std::size_t j {0}; j < 4 && i + j < sequence.size(); ++j) {
+            packed |= static_cast<unsigned>(std::max(base_code(sequence[i + j]), 0)) << (2 * j);
+        }
+        out.push_back(static_cast<char>(packed));
+    }
+}
+
+AlignedRead::NucleotideSequence read_sequence(const char*& in)
+{
+    AlignedRead::NucleotideSequence result(read_varint(in), 'A');
+    const auto num_exceptions = read_varint(in);
+    std::vector<std::pair<std::size_t, char>> exceptions(num_exceptions);
+    std::size_t prev_exception {0};
+    for (auto& exception : exceptions) {
+        exception.first = prev_exception + read_varint(in);
+        exception.second = *in++;
+        prev_exception = exception.first;
+    }
+    for (std::size_t i {0}; i < result.size(); i += 4) {
+        const auto packed = static_cast<std::uint8_t>(*in++);
+        for (std::size_t j {0}; j < 4 && i + j < result.size(); ++j) {
+            result[i + j] = bases[(packed >> (2 * j)) & 3];
+        }
+    }
+    for (const auto& exception : exceptions) {
+        result[exception.first] = exception.second;
+    }
+    return result;
+}
+
+// Run-length coding suits both binned and unbinned quality schemes: binned qualities have long runs,
+// and a run of one costs two bytes, no worse than a typical uncoded quality plus a varint
+void write_qualities(const AlignedRead::BaseQualityVector& qualities, std::string& out)
+{
+    write_varint(qualities.size(), out);
+    for (auto itr = std::cbegin(qualities); itr != std::cend(qualities);) {
+        const auto run_end = std::find_if(std::next(itr), std::cend(qualities), [=] (auto q) { return q != *itr; });
+        out.push_back(static_cast<char>(*itr));
+        write_varint(std::distance(itr, run_end) - 1, out);
+        itr = run_end;
+    }
+}
+
+AlignedRead::BaseQualityVector read_qualities(const char*& in)
+{
+    AlignedRead::BaseQualityVector result(read_varint(in));
+    for (auto itr = std::begin(result); itr != std::end(result);) {
+        const auto quality = static_cast<AlignedRead::BaseQuality>(*in++);
+        const auto run_length = read_varint(in) + 1;
+        itr = std::fill_n(itr, run_length, quality);
+    }
+    return result;
+}
+
+void write_read(const AlignedRead& read, const GenomicRegion::Position prev_begin, std::string& out)
+{
+    write_varint(mapped_begin(read) - prev_begin, out);
+    write_varint(region_size(read), out);
+    out.push_back(static_cast<char>(read.mapping_quality()));
+    write_varint(encode(read.flags()), out);
+    write_string(read.name(), out);
+    write_cigar(read.cigar(), out);
+    write_sequence(read.sequence(), out);
+    write_qualities(read.base_qualities(), out);
+    if (read.has_other_segment()) {
+        const auto& segment = read.next_segment();
+        out.push_back(static_cast<char>(1 | segment.is_marked_unmapped() << 1 | segment.is_marked_reverse_mapped() << 2));
+        write_string(segment.contig_name() == contig_name(read) ? std::string {} : segment.contig_name(), out);
+        write_varint(segment.begin(), out);
+        write_varint(segment.inferred_template_length(), out);
+    } else {
+        out.push_back(0);
+    }
+    const auto tags = read.tags();
+    write_varint(tags.size(), out);
+    for (const auto& tag : tags) {
+        out.append(std::cbegin(tag), std::cend(tag));
+        write_string(*read.annotation(tag), out);
+    }
+}
+
+AlignedRead read_read(const GenomicRegion::ContigName& contig, GenomicRegion::Position& prev_begin, const char*& in)
+{
+    const auto begin = static_cast<GenomicRegion::Position>(prev_begin + read_varint(in));
+    const auto end = static_cast<GenomicRegion::Position>(begin + read_varint(in));
+    prev_begin = begin;
+    const auto mapping_quality = static_cast<AlignedRead::MappingQuality>(*in++);
+    const auto flags = decode_flags(static_cast<unsigned>(read_varint(in)));
+    auto name = read_string(in);
+    auto cigar = read_cigar(in);
+    auto sequence = read_sequence(in);
+    auto qualities = read_qualities(in);
+    const auto segment_bits = static_cast<std::uint8_t>(*in++);
+    std::string segment_contig {};
+    GenomicRegion::Position segment_begin {};
+    GenomicRegion::Size template_length {};
+    if (segment_bits) {
+        segment_contig = read_string(in);
+        if (segment_contig.empty()) segment_contig = contig;
+        segment_begin = static_cast<GenomicRegion::Position>(read_varint(in));
+        template_length = static_cast<GenomicRegion::Size>(read_varint(in));
+    }
+    Annotations annotations(read_varint(in));
+    std::string read_group {};
+    for (auto& annotation : annotations) {
+        annotation.first = {in[0], in[1]};
+        in += 2;
+        annotation.second = read_string(in);
+        if (annotation.first == readGroupTag) read_group = annotation.second;
+    }
+    GenomicRegion region {contig, begin, end};
+    if (segment_bits) {
+        const AlignedRead::Segment::Flags segment_flags {(segment_bits & 2) != 0, (segment_bits & 4) != 0};
+        return AlignedRead {std::move(name), std::move(region), std::move(sequence), std::move(qualities), std::move(cigar),
+                            mapping_quality, flags, std::move(read_group), std::move(segment_contig), segment_begin,
+                            template_length, segment_flags, std::move(annotations)};
+    } else {
+        return AlignedRead {std::move(name), std::move(region), std::move(sequence), std::move(qualities), std::move(cigar),
+                            mapping_quality, flags, std::move(read_group), std::move(annotations)};
+    }
+}
+
+bool overlaps_any(const AlignedRead& read, const std::vector<GenomicRegion>& regions) noexcept
+{
+    return std::any_of(std::cbegin(regions), std::cend(regions), [&] (const auto& region) { return overlaps(read, region); });
+}
+
+} // namespace
+
+CompressedReadBuffer::CompressedReadBuffer(const ReadMap& reads)
+{
+    samples_.reserve(reads.size());
+    for (const auto& p : reads) {
+        std::vector<Block> blocks {};
+        GenomicRegion::Position prev_begin {};
+        for (const auto& read : p.second) {
+            // Positions are delta coded, so a block can't go back along the contig
+            if (blocks.empty() || blocks.back().num_reads == maxBlockSize || blocks.back().contig != contig_name(read)
+                || mapped_begin(read) < prev_begin) {
+                if (!blocks.empty()) blocks.back().data.shrink_to_fit();
+                blocks.push_back({contig_name(read), mapped_begin(read), mapped_end(read), 0, {}});
+                prev_begin = mapped_begin(read);
+            }
+            auto& block = blocks.back();
+            write_read(read, prev_begin, block.data);
+            prev_begin = mapped_begin(read);
+            block.max_end = std::max(block.max_end, mapped_end(read));
+            ++block.num_reads;
+            uncompressed_footprint_ += octopus::footprint(read);
+        }
+        if (!blocks.empty()) blocks.back().data.shrink_to_fit();
+        blocks.shrink_to_fit();
+        num_reads_ += p.second.size();
+        footprint_ += sizeof(p) + blocks.size() * sizeof(Block);
+        for (const auto& block : blocks) {
+            footprint_ += block.data.capacity() + block.contig.capacity();
+        }
+        samples_.emplace_back(p.first, std::move(blocks));
+    }
+}
+
+std::size_t CompressedReadBuffer::size() const noexcept
+{
+    return num_reads_;
+}
+
+bool CompressedReadBuffer::empty() const noexcept
+{
+    return num_reads_ == 0;
+}
+
+ReadMap CompressedReadBuffer::decompress() const
+{
+    return decompress([] (const AlignedRead&) { return true; }, [] (const Block&) { return true; });
+}
+
+ReadMap CompressedReadBuffer::decompress(const GenomicRegion& region) const
+{
+    return decompress([&] (const AlignedRead& read) { return overlaps(read, region); },
+                      [&] (const Block& block) {
+                          return block.contig == region.contig_name()
+                              && block.begin <= region.end() && block.max_end >= region.begin(); });
+}
+
+ReadMap CompressedReadBuffer::decompress(const std::vector<GenomicRegion>& regions) const
+{
+    return decompress([&] (const AlignedRead& read) { return overlaps_any(read, regions); },
+                      [&] (const Block& block) {
+                          return std::any_of(std::cbegin(regions), std::cend(regions), [&] (const auto& region) {
+                              return block.contig == region.contig_name()
+                                  && block.begin <= region.end() && block.max_end >= region.begin(); }); });
+}
+
+MemoryFootprint CompressedReadBuffer::footprint() const noexcept
+{
+    return footprint_;
+}
+
+MemoryFootprint CompressedReadBuffer::uncompressed_footprint() const noexcept
+{
+    return uncompressed_footprint_;
+}
+
+// private methods
+
+template <typename Predicate, typename BlockPredicate>
+ReadMap CompressedReadBuffer::decompress(Predicate&& keep, BlockPredicate&& search) const
+{
+    ReadMap result {samples_.size()};
+    for (const auto& p : samples_) {
+        std::vector<AlignedRead> reads {};
+        for (const auto& block : p.second) {
+            if (!search(block)) continue;
+            const char* in {block.data.data()};
+            GenomicRegion::Position prev_begin {block.begin};
+            for (std::size_t i {0}; i < block.num_reads; ++i) {
+                auto read = read_read(block.contig, prev_begin, in);
+                if (keep(read)) reads.push_back(std::move(read));
+            }
+        }
+        result.emplace(p.first, ReadMap::mapped_type {std::make_move_iterator(std::begin(reads)),
+                                                      std::make_move_iterator(std::end(reads))});
+    }
+    return result;
+}
+
+} // namespace octopus
@@ -0,0 +1,77 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef compressed_read_buffer_hpp
+#define compressed_read_buffer_hpp
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "basics/aligned_read.hpp"
+#include "utils/memory_footprint.hpp"
+
+namespace octopus {
+
+/*
+    CompressedReadBuffer holds an immutable ReadMap in a compact block format, so a buffer of a given
+    memory size holds several times more reads than it would as AlignedRead objects.
+
+    The reads of each sample are split into blocks of consecutive reads. Within a block, mapping positions
+    are delta coded, bases are packed two bits each (other symbols are stored as exceptions), base
+    qualities are run-length coded, and the remaining fields are varint coded. The encoding is lossless.
+    Each block records the region its reads span, so only blocks overlapping a request are decompressed.
+ */
+class CompressedReadBuffer
+{
+public:
+    CompressedReadBuffer() = default;
+
+    CompressedReadBuffer(const ReadMap& reads);
+
+    CompressedReadBuffer(const CompressedReadBuffer&)            = default;
+    CompressedReadBuffer& operator=(const CompressedReadBuffer&) = default;
+    CompressedReadBuffer(CompressedReadBuffer&&)                 = default;
+    CompressedReadBuffer& operator=(CompressedReadBuffer&&)      = default;
+
+    ~CompressedReadBuffer() = default;
+
+    std::size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    ReadMap decompress() const;
+    // Reads overlapping region
+    ReadMap decompress(const GenomicRegion& region) const;
+    // Reads overlapping any of the sorted, non-overlapping regions
+    ReadMap decompress(const std::vector<GenomicRegion>& regions) const;
+
+    // The memory used by the compressed reads
+    MemoryFootprint footprint() const noexcept;
+    // The memory the reads would use uncompressed
+    MemoryFootprint uncompressed_footprint() const noexcept;
+
+private:
+    struct Block
+    {
+        GenomicRegion::ContigName contig;
+        GenomicRegion::Position begin, max_end;
+        std::size_t num_reads;
+        std::string data;
+    };
+
+    static constexpr std::size_t maxBlockSize {256}; // reads
+
+    std::vector<std::pair<SampleName, std::vector<Block>>> samples_;
+    std::size_t num_reads_ = 0;
+    MemoryFootprint footprint_ = 0, uncompressed_footprint_ = 0;
+
+    template <typename Predicate, typename BlockPredicate>
+    ReadMap decompress(Predicate&& keep, BlockPredicate&& search) const;
+};
+
+} // namespace octopus
+
+#endif
@@ -0,0 +1,51 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "streaming_downsampler.hpp"
+
+#include <iterator>
+
+namespace octopus { namespace readpipe {
+
+StreamingDownsampler::StreamingDownsampler(const std::vector<SampleName>& samples, const unsigned max_coverage)
+: max_coverage_ {max_coverage}
+, samples_ {}
+, num_dropped_ {0}
+{
+    samples_.reserve(samples.size());
+    for (const auto& sample : samples) {
+        samples_.emplace(sample, SampleState {});
+    }
+}
+
+bool StreamingDownsampler::keep(const SampleName& sample, const ContigName& contig, const ContigRegion& read_region)
+{
+    const auto sample_itr = samples_.find(sample);
+    if (sample_itr == std::end(samples_)) return true;
+    auto& state = sample_itr->second;
+    const auto begin = read_region.begin();
+    if (contig != state.contig || begin < state.last_begin) {
+        // a new ordered stream
+        state.kept_ends = {};
+        state.contig = contig;
+    }
+    state.last_begin = begin;
+    while (!state.kept_ends.empty() && state.kept_ends.top() <= begin) {
+        state.kept_ends.pop();
+    }
+    if (state.kept_ends.size() < max_coverage_) {
+        state.kept_ends.push(read_region.end() > begin ? read_region.end() : begin + 1);
+        return true;
+    } else {
+        ++num_dropped_;
+        return false;
+    }
+}
+
+std::size_t StreamingDownsampler::num_dropped() const noexcept
+{
+    return num_dropped_;
+}
+
+} // namespace readpipe
+} // namespace octopus
@@ -0,0 +1,64 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef streaming_downsampler_hpp
+#define streaming_downsampler_hpp
+
+#include <cstddef>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <unordered_map>
+
+#include "config/common.hpp"
+#include "basics/contig_region.hpp"
+
+namespace octopus { namespace readpipe {
+
+/**
+ StreamingDownsampler decides whether to keep each read as reads arrive in mapped order, using only
+ the read's mapped region, so it can be applied before reads are decoded. A read is dropped if
+ max_coverage kept reads already overlap its begin position. Reads are kept first come first
+ served, so this is a coarse cap for extreme depths, ahead of the Downsampler which samples evenly.
+ 
+ A read on a different contig to the previous read of the same sample, or that begins before it
+ (e.g. from another read file), starts a new ordered stream, and the coverage count starts again.
+ Not thread safe.
+ */
+class StreamingDownsampler
+{
+public:
+    StreamingDownsampler() = delete;
+    
+    StreamingDownsampler(const std::vector<SampleName>& samples, unsigned max_coverage);
+    
+    StreamingDownsampler(const StreamingDownsampler&)            = default;
+    StreamingDownsampler& operator=(const StreamingDownsampler&) = default;
+    StreamingDownsampler(StreamingDownsampler&&)                 = default;
+    StreamingDownsampler& operator=(StreamingDownsampler&&)      = default;
+    
+    ~StreamingDownsampler() = default;
+    
+    bool keep(const SampleName& sample, const ContigName& contig, const ContigRegion& read_region); // Reads of unknown samples are kept
+    
+    std::size_t num_dropped() const noexcept;
+    
+private:
+    using Position = ContigRegion::Position;
+    
+    struct SampleState
+    {
+        std::priority_queue<Position, std::vector<Position>, std::greater<>> kept_ends;
+        ContigName contig = {};
+        Position last_begin = 0;
+    };
+    
+    unsigned max_coverage_;
+    std::unordered_map<SampleName, SampleState> samples_;
+    std::size_t num_dropped_;
+};
+
+} // namespace readpipe
+} // namespace octopus
+
+#endif
@@ -354,6 +354,34 @@ private:
     DuplicateDefinition duplicate_definition_;
 };
 
+// Removes duplicates by merging each duplicate family into one consensus read, rather than keeping the
+// best duplicate, so the remaining read carries the evidence of the whole family.
+template <typename ForwardIt,
+          typename DuplicateDefinition>
+struct IsNotCollapsedDuplicate : ContextReadFilter<ForwardIt>
+{
+    IsNotCollapsedDuplicate() : IsNotCollapsedDuplicate<ForwardIt, DuplicateDefinition> {"IsNotCollapsedDuplicate", DuplicateDefinition {}} {}
+    IsNotCollapsedDuplicate(DuplicateDefinition duplicate_definition)
+    : IsNotCollapsedDuplicate<ForwardIt, DuplicateDefinition> {"IsNotCollapsedDuplicate", std::move(duplicate_definition)} {}
+    IsNotCollapsedDuplicate(std::string name, DuplicateDefinition duplicate_definition)
+    : ContextReadFilter<ForwardIt> {std::move(name)}
+    , duplicate_definition_ {std::move(duplicate_definition)}
+    {}
+    
+    ForwardIt do_remove(ForwardIt first, ForwardIt last) const override
+    {
+        return collapse_duplicate_reads(first, last, duplicate_definition_);
+    }
+    
+    ForwardIt do_partition(ForwardIt first, ForwardIt last) const override
+    {
+        return last; // merged reads are changed so cannot be partitioned
+    }
+
+private:
+    DuplicateDefinition duplicate_definition_;
+};
+
 } // namespace readpipe
 } // namespace octopus
 
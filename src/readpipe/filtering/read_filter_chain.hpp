@@ -0,0 +1,119 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef read_filter_chain_hpp
+#define read_filter_chain_hpp
+
+#include <string>
+#include <tuple>
+#include <limits>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "basics/aligned_read.hpp"
+#include "basics/cigar_string.hpp"
+#include "read_filter.hpp"
+
+namespace octopus { namespace readpipe
+{
+/*
+ BasicReadFilterChain is one BasicReadFilter made from a fixed sequence of simple predicates. The
+ chain type is composed at compile time, so the predicates are called directly (and can be inlined)
+ rather than through a virtual call each, and stop at the first that fails. Before any predicates
+ are tried, reads marked with any of the rejected SAM flags are removed with a single mask test.
+
+ The ReadFilterer only sees the chain, so any filter counts are for the whole chain.
+ */
+template <typename... Predicates>
+class BasicReadFilterChain : public BasicReadFilter
+{
+public:
+    BasicReadFilterChain() = delete;
+
+    BasicReadFilterChain(AlignedRead::Flags rejected_flags, Predicates... predicates)
+    : BasicReadFilterChain {"BasicReadFilterChain", rejected_flags, std::move(predicates)...} {}
+    BasicReadFilterChain(std::string name, AlignedRead::Flags rejected_flags, Predicates... predicates)
+    : BasicReadFilter {std::move(name)}
+    , rejected_flags_ {AlignedRead::make_flag_mask(rejected_flags)}
+    , predicates_ {std::move(predicates)...}
+    {}
+
+    bool passes(const AlignedRead& read) const noexcept override
+    {
+        return !read.is_marked_any(rejected_flags_) && passes_predicates(read, std::integral_constant<std::size_t, 0> {});
+    }
+
+private:
+    using EndIndex = std::integral_constant<std::size_t, sizeof...(Predicates)>;
+
+    AlignedRead::FlagMask rejected_flags_;
+    std::tuple<Predicates...> predicates_;
+
+    template <std::size_t I>
+    bool passes_predicates(const AlignedRead& read, std::integral_constant<std::size_t, I>) const noexcept
+    {
+        return std::get<I>(predicates_)(read) && passes_predicates(read, std::integral_constant<std::size_t, I + 1> {});
+    }
+    bool passes_predicates(const AlignedRead&, EndIndex) const noexcept
+    {
+        return true;
+    }
+};
+
+// Predicates for the chain, with the same meaning as the filters of similar name
+
+namespace predicates {
+
+struct HasValidBaseQualities
+{
+    bool operator()(const AlignedRead& read) const noexcept
+    {
+        return read.sequence().size() == read.base_qualities().size();
+    }
+};
+
+struct HasWellFormedCigar
+{
+    bool operator()(const AlignedRead& read) const noexcept
+    {
+        const auto& cigar = read.cigar();
+        return is_valid(cigar) && is_minimal(cigar) && !(cigar.size() == 1 && is_clipping(cigar.front()));
+    }
+};
+
+struct IsGoodMappingQuality
+{
+    AlignedRead::MappingQuality good_mapping_quality;
+
+    bool operator()(const AlignedRead& read) const noexcept
+    {
+        return read.mapping_quality() >= good_mapping_quality;
+    }
+};
+
+struct HasGoodLength
+{
+    using Length = AlignedRead::NucleotideSequence::size_type;
+
+    Length min_length = 0, max_length = std::numeric_limits<Length>::max();
+
+    bool operator()(const AlignedRead& read) const noexcept
+    {
+        const auto length = read.sequence().size();
+        return min_length <= length && length <= max_length;
+    }
+};
+
+} // namespace predicates
+
+// The non-flag checks nearly every configuration makes
+using CommonReadFilterChain = BasicReadFilterChain<predicates::HasValidBaseQualities,
+                                                   predicates::HasWellFormedCigar,
+                                                   predicates::IsGoodMappingQuality,
+                                                   predicates::HasGoodLength>;
+
+} // namespace readpipe
+} // namespace octopus
+
+#endif
@@ -11,6 +11,7 @@
 #include <iterator>
 #include <type_traits>
 #include <utility>
+#include <chrono>
 
 #include <boost/optional.hpp>
 
@@ -35,6 +36,7 @@ public:
     using ContextFilterPtr = std::unique_ptr<ContextReadFilter<ReadIterator>>;
     
     using FilterCountMap = std::unordered_map<std::string, std::size_t>;
+    using FilterTimeMap  = std::unordered_map<std::string, std::chrono::nanoseconds>;
     
     ReadFilterer() = default;
     
@@ -60,6 +62,14 @@ public:
     BidirIt partition(ReadIterator first, ReadIterator last) const;
     BidirIt partition(ReadIterator first, ReadIterator last, FilterCountMap& filter_counts) const;
     
+    // Like remove, but applies each filter in its own pass and adds the time it takes to filter_times.
+    // This is slower than remove, so is only for profiling.
+    BidirIt timed_remove(ReadIterator first, ReadIterator last, FilterTimeMap& filter_times) const;
+    
+    // Like remove, but first applies transform to each read in the same pass as the basic filters
+    template <typename UnaryFunction>
+    BidirIt transform_remove(ReadIterator first, ReadIterator last, UnaryFunction transform) const;
+    
 private:
     std::vector<BasicFilterPtr> basic_filters_;
     std::vector<ContextFilterPtr> context_filters_;
@@ -244,6 +254,44 @@ BidirIt ReadFilterer<BidirIt>::partition(BidirIt first, BidirIt last,
     return last;
 }
 
+template <typename BidirIt>
+BidirIt ReadFilterer<BidirIt>::timed_remove(BidirIt first, BidirIt last, FilterTimeMap& filter_times) const
+{
+    using Clock = std::chrono::steady_clock;
+    for (const auto& filter : basic_filters_) {
+        const auto start = Clock::now();
+        last = std::remove_if(first, last, [&filter] (const AlignedRead& read) { return !(*filter)(read); });
+        filter_times[filter->name()] += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    }
+    for (const auto& filter : context_filters_) {
+        const auto start = Clock::now();
+        last = filter->remove(first, last);
+        filter_times[filter->name()] += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    }
+    return last;
+}
+
+template <typename BidirIt>
+template <typename UnaryFunction>
+BidirIt ReadFilterer<BidirIt>::transform_remove(BidirIt first, BidirIt last, UnaryFunction transform) const
+{
+    auto result = first;
+    for (auto it = first; it != last; ++it) {
+        transform(*it);
+        if (passes_all_basic_filters(*it)) {
+            if (result != it) *result = std::move(*it);
+            ++result;
+        }
+    }
+    
+    std::for_each(cbegin(context_filters_), cend(context_filters_),
+                  [first, &result] (const auto& filter) {
+                      result = filter->remove(first, result);
+                  });
+    
+    return result;
+}
+
 // private member methods
 
 template <typename BidirIt>
@@ -6,11 +6,19 @@
 #include <utility>
 #include <iterator>
 #include <algorithm>
+#include <future>
+#include <exception>
 #include <cassert>
 
+#include "concepts/mappable_range.hpp"
+#include "downsampling/streaming_downsampler.hpp"
+#include "shared_read_cache.hpp"
 #include "utils/read_stats.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/append.hpp"
+#include "logging/performance_counters.hpp"
+#include "logging/profiler_zones.hpp"
+#include "logging/allocation_counts.hpp"
 
 namespace octopus {
 
@@ -29,6 +37,7 @@ ReadPipe::ReadPipe(const ReadManager& source, ReadTransformer transformer, ReadF
 , downsampler_ {std::move(downsampler)}
 , samples_ {std::move(samples)}
 , fragment_size_ {}
+, max_streamed_coverage_ {}
 , debug_log_ {}
 {
     if (DEBUG_MODE) debug_log_ = logging::DebugLogger {};
@@ -44,6 +53,7 @@ ReadPipe::ReadPipe(const ReadManager& source, ReadTransformer prefilter_transfor
 , downsampler_ {std::move(downsampler)}
 , samples_ {std::move(samples)}
 , fragment_size_ {}
+, max_streamed_coverage_ {}
 , debug_log_ {}
 {
     if (DEBUG_MODE) debug_log_ = logging::DebugLogger {};
@@ -59,6 +69,7 @@ ReadPipe::ReadPipe(const ReadManager& source, GenomicRegion::Size fragment_size,
 , downsampler_ {std::move(downsampler)}
 , samples_ {std::move(samples)}
 , fragment_size_ {fragment_size}
+, max_streamed_coverage_ {}
 , debug_log_ {}
 {
     if (DEBUG_MODE) debug_log_ = logging::DebugLogger {};
@@ -91,6 +102,11 @@ const std::vector<SampleName>& ReadPipe::samples() const noexcept
     return samples_;
 }
 
+void ReadPipe::set_max_streamed_coverage(const unsigned max_coverage) noexcept
+{
+    max_streamed_coverage_ = max_coverage;
+}
+
 namespace {
 
 template <typename Map>
@@ -102,10 +118,22 @@ void sort_each(Map& reads)
 }
 
 template <typename Regions>
-auto fetch_batch(const ReadManager& rm, const std::vector<SampleName>& samples, const Regions& region)
+auto fetch_batch(const ReadManager& rm, const std::vector<SampleName>& samples, const Regions& region,
+                 const boost::optional<unsigned> max_streamed_coverage)
 {
-    auto result = rm.fetch_reads(samples, region);
+    OCTOPUS_ZONE("ReadPipe::fetch_batch");
+    const performance::PhaseTimer timer {performance::Phase::read_io};
+    ReadManager::SampleReadMap result;
+    if (max_streamed_coverage) {
+        readpipe::StreamingDownsampler downsampler {samples, *max_streamed_coverage};
+        result = rm.fetch_reads(samples, region, [&] (const SampleName& sample, const ContigName& contig,
+                                                      const ContigRegion& read_region) {
+            return downsampler.keep(sample, contig, read_region); });
+    } else {
+        result = rm.fetch_reads(samples, region);
+    }
     sort_each(result);
+    performance::add(performance::Counter::reads_read, count_reads(result));
     return result;
 }
 
@@ -195,8 +223,11 @@ struct IsMappingQualityZero
 
 } // namespace
 
-ReadMap ReadPipe::fetch_reads(const GenomicRegion& region, boost::optional<Report&> report) const
+ReadMap ReadPipe::fetch_reads(const GenomicRegion& region, boost::optional<Report&> report, OptionalThreadPool workers) const
 {
+    OCTOPUS_ZONE("ReadPipe::fetch_reads");
+    const performance::PhaseTimer timer {performance::Phase::read_pipe};
+    const allocation::ScopedZone allocation_zone {allocation::Zone::read_pipe};
     using namespace readpipe;
     ReadMap result {samples_.size()};
     for (const auto& sample : samples_) {
@@ -204,7 +235,7 @@ ReadMap ReadPipe::fetch_reads(const GenomicRegion& region, boost::optional<Repor
     }
     if (report) report->raw_depths.reserve(samples_.size());
     for (const auto& batch : batch_samples(samples_)) {
-        auto batch_reads = fetch_batch(source_, batch, region);
+        auto batch_reads = fetch_batch(source_, batch, region, max_streamed_coverage_);
         if (debug_log_) {
             stream(*debug_log_) << "Fetched " << count_reads(batch_reads) << " unfiltered reads from " << region;
         }
@@ -214,6 +245,10 @@ ReadMap ReadPipe::fetch_reads(const GenomicRegion& region, boost::optional<Repor
                 report->mapping_quality_zero_depths.emplace(p.first, make_coverage_tracker(p.second, IsMappingQualityZero {}));
             }
         }
+        if (can_fuse_passes()) {
+            fused_transform_filter_downsample(batch_reads, result, report, workers);
+            continue;
+        }
         transform_reads(batch_reads, prefilter_transformer_);
         if (debug_log_) {
             SampleFilterCountMap<SampleName, decltype(filterer_)> filter_counts {};
@@ -283,6 +318,32 @@ ReadMap ReadPipe::fetch_reads(const GenomicRegion& region, boost::optional<Repor
         }
     }
     shrink_to_fit(result); // TODO: should we make this conditional on extra capacity?
+    performance::add(performance::Counter::reads_returned, count_reads(result));
+    return result;
+}
+
+void ReadPipe::set_shared_cache(const std::size_t max_reads)
+{
+    shared_cache_ = std::make_shared<SharedReadCache>(max_reads);
+}
+
+ReadPipe::SharedReadMap
+ReadPipe::fetch_shared_reads(const GenomicRegion& region, boost::optional<Report&> report, OptionalThreadPool workers) const
+{
+    if (!shared_cache_) return std::make_shared<const ReadMap>(fetch_reads(region, report, workers));
+    auto cached = shared_cache_->find(region);
+    if (cached) {
+        performance::add(performance::Counter::read_cache_hits);
+        if (debug_log_) stream(*debug_log_) << "Request " << region << " is cached in " << cached->region;
+        if (report) *report = *cached->report;
+        if (cached->region == region) return std::move(cached->reads);
+        return std::make_shared<const ReadMap>(copy_overlapped(*cached->reads, region));
+    }
+    performance::add(performance::Counter::read_cache_misses);
+    auto fetched_report = std::make_shared<Report>();
+    auto result = std::make_shared<const ReadMap>(fetch_reads(region, *fetched_report, workers));
+    if (report) *report = *fetched_report;
+    shared_cache_->insert(region, result, std::move(fetched_report));
     return result;
 }
 
@@ -292,11 +353,14 @@ auto sort_and_merge(std::vector<GenomicRegion> regions)
     return extract_covered_regions(regions);
 }
 
-ReadMap ReadPipe::fetch_reads(const std::vector<GenomicRegion>& regions, boost::optional<Report&> report) const
+ReadMap ReadPipe::fetch_reads(const std::vector<GenomicRegion>& regions, boost::optional<Report&> report, OptionalThreadPool workers) const
 {
-    if (regions.size() == 1) { return fetch_reads(regions.front(), report); }
+    if (regions.size() == 1) { return fetch_reads(regions.front(), report, workers); }
     const auto covered_regions = sort_and_merge(regions);
-    if (covered_regions.size() == 1) { return fetch_reads(covered_regions.front(), report); }
+    if (covered_regions.size() == 1) { return fetch_reads(covered_regions.front(), report, workers); }
+    OCTOPUS_ZONE("ReadPipe::fetch_reads");
+    const performance::PhaseTimer timer {performance::Phase::read_pipe};
+    const allocation::ScopedZone allocation_zone {allocation::Zone::read_pipe};
     using namespace readpipe;
     ReadMap result {samples_.size()};
     for (const auto& sample : samples_) {
@@ -305,7 +369,7 @@ ReadMap ReadPipe::fetch_reads(const std::vector<GenomicRegion>& regions, boost::
     if (regions.empty()) return result;
     if (report) report->raw_depths.reserve(samples_.size());
     for (const auto& batch : batch_samples(samples_)) {
-        auto batch_reads = fetch_batch(source_, batch, covered_regions);
+        auto batch_reads = fetch_batch(source_, batch, covered_regions, max_streamed_coverage_);
         // if (debug_log_) {
         //     stream(*debug_log_) << "Fetched " << count_reads(batch_reads) << " unfiltered reads from " << region;
         // }
@@ -315,6 +379,10 @@ ReadMap ReadPipe::fetch_reads(const std::vector<GenomicRegion>& regions, boost::
                 report->mapping_quality_zero_depths.emplace(p.first, make_coverage_tracker(p.second, IsMappingQualityZero {}));
             }
         }
+        if (can_fuse_passes()) {
+            fused_transform_filter_downsample(batch_reads, result, report, workers);
+            continue;
+        }
         transform_reads(batch_reads, prefilter_transformer_);
         if (debug_log_) {
             SampleFilterCountMap<SampleName, decltype(filterer_)> filter_counts {};
@@ -362,7 +430,93 @@ ReadMap ReadPipe::fetch_reads(const std::vector<GenomicRegion>& regions, boost::
         }
     }
     shrink_to_fit(result); // TODO: should we make this conditional on extra capacity?
+    performance::add(performance::Counter::reads_returned, count_reads(result));
     return result;
 }
 
+// private methods
+
+bool ReadPipe::can_fuse_passes() const noexcept
+{
+    // Template transforms need every read of a template, and fragments must be filtered again,
+    // so neither can be done one read at a time. Debug logging wants the per-filter counts.
+    return !debug_log_ && !fragment_size_ && !prefilter_transformer_.has_template_transforms();
+}
+
+// Does the prefilter transforms and basic filters in one pass over the reads, and moves the
+// survivors straight into the result, rather than partitioning, erasing, and copying them
+void ReadPipe::fused_transform_filter_downsample(ReadManager::SampleReadMap& reads, ReadMap& result,
+                                                 boost::optional<Report&> report, OptionalThreadPool workers) const
+{
+    std::vector<std::pair<ReadManager::SampleReadMap::value_type*, ReadMap::mapped_type*>> samples {};
+    samples.reserve(reads.size());
+    for (auto& p : reads) samples.emplace_back(&p, &result.at(p.first));
+    std::vector<boost::optional<Downsampler::Report>> downsample_reports(samples.size());
+    // Samples are independent, and the downsampler is seeded for each sample, so the result is
+    // the same however they are scheduled
+    if (samples.size() > 1 && workers && workers->size() > 1 && workers->n_idle() > 0) {
+        std::vector<std::future<void>> futures {};
+        futures.reserve(samples.size() - 1);
+        for (std::size_t sample_idx {1}; sample_idx < samples.size(); ++sample_idx) {
+            futures.push_back(workers->try_push([&, sample_idx] () {
+                downsample_reports[sample_idx] = fused_transform_filter_downsample(samples[sample_idx].first->second,
+                                                                                   *samples[sample_idx].second);
+            }));
+        }
+        // run the first sample in the current thread
+        std::exception_ptr error {};
+        try {
+            downsample_reports.front() = fused_transform_filter_downsample(samples.front().first->second, *samples.front().second);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        for (auto& f : futures) {
+            workers->wait(f);
+            try {
+                f.get();
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
+    } else {
+        for (std::size_t sample_idx {0}; sample_idx < samples.size(); ++sample_idx) {
+            downsample_reports[sample_idx] = fused_transform_filter_downsample(samples[sample_idx].first->second,
+                                                                               *samples[sample_idx].second);
+        }
+    }
+    if (report) {
+        for (std::size_t sample_idx {0}; sample_idx < samples.size(); ++sample_idx) {
+            if (downsample_reports[sample_idx]) {
+                report->downsample_report[samples[sample_idx].first->first] = std::move(*downsample_reports[sample_idx]);
+            }
+        }
+    }
+    reads.clear();
+}
+
+boost::optional<ReadPipe::Downsampler::Report>
+ReadPipe::fused_transform_filter_downsample(ReadManager::ReadContainer& reads, ReadMap::mapped_type& result) const
+{
+    const auto prefilter_transform = [this] (AlignedRead& read) { prefilter_transformer_.transform_read(read); };
+    const auto last_kept = filterer_.transform_remove(std::begin(reads), std::end(reads), prefilter_transform);
+    if (postfilter_transformer_) {
+        postfilter_transformer_->transform_reads(std::begin(reads), last_kept);
+    }
+    if (result.empty()) {
+        // Transforms do not move reads, so the reads are still sorted
+        result = ReadMap::mapped_type {ForwardSortedTag {}, std::make_move_iterator(std::begin(reads)),
+                                       std::make_move_iterator(last_kept)};
+    } else {
+        result.insert(std::make_move_iterator(std::begin(reads)), std::make_move_iterator(last_kept));
+    }
+    reads.clear();
+    reads.shrink_to_fit();
+    if (downsampler_) {
+        return downsampler_->downsample(result);
+    } else {
+        return boost::none;
+    }
+}
+
 } // namespace octopus
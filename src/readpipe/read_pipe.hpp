@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <cstddef>
 #include <functional>
+#include <memory>
 
 #include <boost/optional.hpp>
 
@@ -16,11 +17,15 @@
 #include "io/read/read_manager.hpp"
 #include "utils/coverage_tracker.hpp"
 #include "logging/logging.hpp"
+#include "utils/thread_pool.hpp"
 #include "filtering/read_filterer.hpp"
 #include "transformers/read_transformer.hpp"
 #include "downsampling/downsampler.hpp"
 
 namespace octopus {
+
+class SharedReadCache;
+
 /*
  ReadPipe provides a wrapper for the basic manipulation of AlignedRead's. It is responsable for
  actually fetching the reads from file, and applying any filters, transforms etc. The result is
@@ -39,6 +44,9 @@ public:
     using ReadFilterer    = readpipe::ReadFiltererTp<ReadManager::ReadContainer>;
     using Downsampler     = readpipe::Downsampler;
     
+    using OptionalThreadPool = boost::optional<ThreadPool&>;
+    using SharedReadMap      = std::shared_ptr<const ReadMap>;
+    
     struct Report
     {
         using DepthMap = std::unordered_map<SampleName, CoverageTracker<GenomicRegion>>;
@@ -85,8 +93,24 @@ public:
     unsigned num_samples() const noexcept;
     const std::vector<SampleName>& samples() const noexcept;
     
-    ReadMap fetch_reads(const GenomicRegion& region, boost::optional<Report&> report = boost::none) const;
-    ReadMap fetch_reads(const std::vector<GenomicRegion>& regions, boost::optional<Report&> report = boost::none) const;
+    // Reads are dropped before they are decoded if this many kept reads already overlap their begin
+    // position (see StreamingDownsampler). Reported raw depths then only count the kept reads.
+    void set_max_streamed_coverage(unsigned max_coverage) noexcept;
+    
+    // If workers are given, samples may be processed concurrently. The result does not depend on this.
+    ReadMap fetch_reads(const GenomicRegion& region, boost::optional<Report&> report = boost::none,
+                        OptionalThreadPool workers = boost::none) const;
+    ReadMap fetch_reads(const std::vector<GenomicRegion>& regions, boost::optional<Report&> report = boost::none,
+                        OptionalThreadPool workers = boost::none) const;
+    
+    // Keeps the results of recent fetch_shared_reads calls, up to max_reads reads, shared between all users
+    // of this pipe. A request contained in a cached fetch (e.g. the unfinished part of a task that gave up its
+    // region) is then served from the cache, with the reads and report of the containing fetch.
+    void set_shared_cache(std::size_t max_reads);
+    
+    // As fetch_reads, but the result may be shared with other callers
+    SharedReadMap fetch_shared_reads(const GenomicRegion& region, boost::optional<Report&> report = boost::none,
+                                     OptionalThreadPool workers = boost::none) const;
     
     //Report get_report() const;
     
@@ -98,7 +122,15 @@ private:
     boost::optional<Downsampler> downsampler_;
     std::vector<SampleName> samples_;
     boost::optional<GenomicRegion::Size> fragment_size_;
+    boost::optional<unsigned> max_streamed_coverage_;
     mutable boost::optional<logging::DebugLogger> debug_log_;
+    std::shared_ptr<SharedReadCache> shared_cache_;
+    
+    bool can_fuse_passes() const noexcept;
+    void fused_transform_filter_downsample(ReadManager::SampleReadMap& reads, ReadMap& result,
+                                           boost::optional<Report&> report, OptionalThreadPool workers) const;
+    boost::optional<Downsampler::Report>
+    fused_transform_filter_downsample(ReadManager::ReadContainer& reads, ReadMap::mapped_type& result) const;
 };
 
 } // namespace octopus
@@ -0,0 +1,52 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "shared_read_cache.hpp"
+
+#include <utility>
+#include <iterator>
+
+#include "utils/read_stats.hpp"
+
+namespace octopus {
+
+SharedReadCache::SharedReadCache(const std::size_t max_reads)
+: max_reads_ {max_reads}
+, num_reads_ {0}
+, blocks_ {}
+, mutex_ {}
+{}
+
+boost::optional<SharedReadCache::Block> SharedReadCache::find(const GenomicRegion& region) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    for (auto itr = std::begin(blocks_); itr != std::end(blocks_); ++itr) {
+        if (contains(itr->region, region)) {
+            blocks_.splice(std::begin(blocks_), blocks_, itr);
+            return blocks_.front();
+        }
+    }
+    return boost::none;
+}
+
+void SharedReadCache::insert(GenomicRegion region, SharedReadMap reads, SharedReport report)
+{
+    const auto num_reads = count_reads(*reads);
+    if (num_reads > max_reads_) return;
+    std::lock_guard<std::mutex> lock {mutex_};
+    blocks_.push_front({std::move(region), std::move(reads), std::move(report), num_reads});
+    num_reads_ += num_reads;
+    while (num_reads_ > max_reads_ || blocks_.size() > maxBlocks) {
+        num_reads_ -= blocks_.back().num_reads;
+        blocks_.pop_back();
+    }
+}
+
+void SharedReadCache::clear() noexcept
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    blocks_.clear();
+    num_reads_ = 0;
+}
+
+} // namespace octopus
@@ -0,0 +1,72 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef shared_read_cache_hpp
+#define shared_read_cache_hpp
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+
+#include <boost/optional.hpp>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "read_pipe.hpp"
+
+namespace octopus {
+
+/*
+    SharedReadCache keeps the results of recent ReadPipe fetches so that requests contained in
+    one of them are served without going back to the read files, and without filtering,
+    transforming, and downsampling the same reads again. The cached reads are immutable and are
+    shared between threads by reference count, so a block stays valid for as long as any task
+    uses it, even after it is evicted.
+
+    The cache is bounded by the total number of reads in the blocks it holds, and by the number
+    of blocks; the least recently used blocks are evicted first. All methods are thread-safe.
+ */
+class SharedReadCache
+{
+public:
+    using SharedReadMap = ReadPipe::SharedReadMap;
+    using SharedReport  = std::shared_ptr<const ReadPipe::Report>;
+
+    struct Block
+    {
+        GenomicRegion region;
+        SharedReadMap reads;
+        SharedReport report;
+        std::size_t num_reads;
+    };
+
+    SharedReadCache() = delete;
+
+    SharedReadCache(std::size_t max_reads);
+
+    SharedReadCache(const SharedReadCache&)            = delete;
+    SharedReadCache& operator=(const SharedReadCache&) = delete;
+    SharedReadCache(SharedReadCache&&)                 = delete;
+    SharedReadCache& operator=(SharedReadCache&&)      = delete;
+
+    ~SharedReadCache() = default;
+
+    // Returns the most recently used block that contains region, if any
+    boost::optional<Block> find(const GenomicRegion& region) const;
+
+    void insert(GenomicRegion region, SharedReadMap reads, SharedReport report);
+
+    void clear() noexcept;
+
+private:
+    static constexpr std::size_t maxBlocks {64}; // lookups are linear
+
+    std::size_t max_reads_, num_reads_;
+    mutable std::list<Block> blocks_; // most recently used first
+    mutable std::mutex mutex_;
+};
+
+} // namespace octopus
+
+#endif
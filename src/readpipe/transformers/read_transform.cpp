@@ -10,6 +10,7 @@
 
 #include "utils/maths.hpp"
 #include "utils/sequence_utils.hpp"
+#include "utils/simd_bytes.hpp"
 
 namespace octopus { namespace readpipe {
 
@@ -71,13 +72,13 @@ MaskLowQualityTails::MaskLowQualityTails(BaseQuality threshold) : threshold_ {th
 void MaskLowQualityTails::operator()(AlignedRead& read) const noexcept
 {
     auto& qualities = read.base_qualities();
-    const auto is_low_quality = [this] (BaseQuality q) noexcept { return q < threshold_; };
+    const auto first = qualities.data(), last = first + qualities.size();
     if (is_forward_strand(read)) {
-        const auto first_high_quality = std::find_if_not(std::rbegin(qualities), std::rend(qualities), is_low_quality);
-        std::fill(std::rbegin(qualities), first_high_quality, 0);
+        const auto num_low_quality = last - utils::simd::find_last_not_less(first, last, threshold_);
+        zero_back_qualities(read, num_low_quality);
     } else {
-        const auto first_high_quality = std::find_if_not(std::begin(qualities), std::end(qualities), is_low_quality);
-        std::fill(std::begin(qualities), first_high_quality, 0);
+        const auto num_low_quality = utils::simd::find_first_not_less(first, last, threshold_) - first;
+        zero_front_qualities(read, num_low_quality);
     }
 }
 
@@ -108,22 +109,18 @@ void MaskSoftClippedBoundraryBases::operator()(AlignedRead& read) const noexcept
 
 namespace {
 
-template<typename InputIterator>
-void zero_if_less_than(InputIterator first, InputIterator last,
-                       typename std::iterator_traits<InputIterator>::value_type value) noexcept {
-    std::transform(first, last, first, [value] (auto v) noexcept { return v < value ? 0 : v; });
-}
-
 void mask_low_quality_front_bases(AlignedRead& read, std::size_t num_bases, AlignedRead::BaseQuality min_quality) noexcept
 {
     auto& qualities = read.base_qualities();
-    zero_if_less_than(std::begin(qualities), std::next(std::begin(qualities), std::min(num_bases, sequence_size(read))), min_quality);
+    const auto first = qualities.data();
+    utils::simd::zero_if_less(first, first + std::min(num_bases, qualities.size()), min_quality);
 }
 
 void mask_low_quality_back_bases(AlignedRead& read, std::size_t num_bases, AlignedRead::BaseQuality min_quality) noexcept
 {
     auto& qualities = read.base_qualities();
-    zero_if_less_than(std::rbegin(qualities), std::next(std::rbegin(qualities), std::min(num_bases, sequence_size(read))), min_quality);
+    const auto last = qualities.data() + qualities.size();
+    utils::simd::zero_if_less(last - std::min(num_bases, qualities.size()), last, min_quality);
 }
 
 } // namespace
@@ -583,5 +580,90 @@ void MaskClippedDuplicatedBases::operator()(ReadReferenceVector& read_template)
     }
 }
 
+namespace {
+
+bool is_match_or_substitution_only(const CigarString& cigar) noexcept
+{
+    return std::all_of(std::cbegin(cigar), std::cend(cigar), [] (const auto& op) { return is_match_or_substitution(op); });
+}
+
+// The forward mate must begin at or before the reverse mate, and the reverse mate must end after the
+// forward mate, with identical gapless alignments over the overlap, so that the overlap is a suffix of
+// the forward mate and a prefix of the reverse mate of the same length.
+boost::optional<AlignedRead::NucleotideSequence::size_type>
+mergeable_overlap_size(const AlignedRead& forward, const AlignedRead& reverse, const GenomicRegion& overlap)
+{
+    if (begins_before(reverse, forward) || !ends_before(forward, reverse)) return boost::none;
+    if (is_soft_clipped(forward) || is_soft_clipped(reverse)) return boost::none;
+    const auto overlap_size = region_size(overlap);
+    const auto forward_overlap_cigar = copy_reference(forward.cigar(), begin_distance(forward, overlap), overlap_size);
+    const auto reverse_overlap_cigar = copy_reference(reverse.cigar(), 0, overlap_size);
+    if (forward_overlap_cigar != reverse_overlap_cigar || !is_match_or_substitution_only(forward_overlap_cigar)) {
+        return boost::none;
+    }
+    const auto result = sequence_size(forward_overlap_cigar);
+    if (result != overlap_size || result >= sequence_size(reverse)) return boost::none;
+    return result;
+}
+
+void merge_overlapped_segments(AlignedRead& forward, AlignedRead& reverse, const GenomicRegion& overlap,
+                               const AlignedRead::NucleotideSequence::size_type overlap_size)
+{
+    auto& forward_sequence = forward.sequence();
+    auto& forward_qualities = forward.base_qualities();
+    auto& reverse_sequence = reverse.sequence();
+    auto& reverse_qualities = reverse.base_qualities();
+    const auto forward_offset = forward_sequence.size() - overlap_size;
+    for (std::size_t i {0}; i < overlap_size; ++i) {
+        auto& forward_base = forward_sequence[forward_offset + i];
+        auto& forward_quality = forward_qualities[forward_offset + i];
+        const auto reverse_quality = reverse_qualities[i];
+        if (forward_base == reverse_sequence[i]) {
+            forward_quality = std::max(forward_quality, reverse_quality);
+        } else if (forward_quality < reverse_quality) {
+            forward_base = reverse_sequence[i];
+            forward_quality = reverse_quality - forward_quality;
+        } else {
+            forward_quality -= reverse_quality;
+        }
+    }
+    auto trimmed_region = right_overhang_region(reverse, forward);
+    auto trimmed_cigar = copy_reference(reverse.cigar(), region_size(overlap));
+    reverse_sequence.erase(std::cbegin(reverse_sequence), std::next(std::cbegin(reverse_sequence), overlap_size));
+    reverse_qualities.erase(std::cbegin(reverse_qualities), std::next(std::cbegin(reverse_qualities), overlap_size));
+    reverse.realign(std::move(trimmed_region), std::move(trimmed_cigar));
+}
+
+void merge_overlapped_segments(AlignedRead& forward, AlignedRead& reverse)
+{
+    const auto overlap = overlapped_region(forward, reverse);
+    if (overlap) {
+        const auto overlap_size = mergeable_overlap_size(forward, reverse, *overlap);
+        if (overlap_size) {
+            merge_overlapped_segments(forward, reverse, *overlap, *overlap_size);
+        } else {
+            mask_strand_of_duplicated_bases(forward, reverse, *overlap);
+        }
+    }
+}
+
+} // namespace
+
+void MergeOverlappedSegments::operator()(ReadReferenceVector& read_template) const
+{
+    const auto template_size = read_template.size();
+    if (template_size < 2) {
+        return;
+    } else if (template_size == 2) {
+        if (is_forward_strand(read_template.front())) {
+            merge_overlapped_segments(read_template.front(), read_template.back());
+        } else {
+            merge_overlapped_segments(read_template.back(), read_template.front());
+        }
+    } else {
+        // TODO
+    }
+}
+
 } // namespace readpipe
 } // namespace octopus
@@ -184,6 +184,14 @@ struct MaskClippedDuplicatedBases
     void operator()(ReadReferenceVector& read_template) const;
 };
 
+// Merges the bases duplicated by overlapping mates into the forward mate, and trims them from the
+// reverse mate, so the overlap is evaluated once. Mates that can't be merged are masked as with
+// MaskStrandOfDuplicatedBases.
+struct MergeOverlappedSegments
+{
+    void operator()(ReadReferenceVector& read_template) const;
+};
+
 } // namespace readpipe
 } // namespace octopus
 
@@ -24,6 +24,11 @@ unsigned ReadTransformer::num_transforms() const noexcept
     return static_cast<unsigned>(read_transforms_.size() + template_transforms_.size());
 }
 
+bool ReadTransformer::has_template_transforms() const noexcept
+{
+    return !template_transforms_.empty();
+}
+
 void ReadTransformer::shrink_to_fit() noexcept
 {
     read_transforms_.shrink_to_fit();
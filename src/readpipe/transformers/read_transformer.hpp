@@ -37,17 +37,19 @@ public:
     void add(TemplateTransform transform);
     
     unsigned num_transforms() const noexcept;
+    bool has_template_transforms() const noexcept;
     
     void shrink_to_fit() noexcept;
     
     template <typename ForwardIt>
     void transform_reads(ForwardIt first, ForwardIt last) const;
-        
+    
+    void transform_read(AlignedRead& read) const; // Only applies the read transforms
+    
 private:
     std::vector<ReadTransform> read_transforms_;
     std::vector<TemplateTransform> template_transforms_;
     
-    void transform_read(AlignedRead& read) const;
     template <typename ForwardIt>
     auto make_references(ForwardIt first, ForwardIt last) const;
     void transform(ReadReferenceVector& reads) const;
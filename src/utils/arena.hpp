@@ -0,0 +1,134 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef arena_hpp
+#define arena_hpp
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+#if defined(ARENA_ALLOCATION)
+#include <boost/container/pmr/memory_resource.hpp>
+#include <boost/container/pmr/monotonic_buffer_resource.hpp>
+#endif
+
+namespace octopus {
+
+/*
+    With the ARENA_ALLOCATION build option, scratch data made while calling an active region
+    can be allocated from a per-thread monotonic arena rather than the heap. A CallingWindowArena
+    opens the arena on the current thread for its lifetime, and releases everything allocated
+    from it, in one go, when destroyed. ArenaVectors made while a window is open allocate from
+    the arena; otherwise they fall back to the heap, so ArenaVectors made on worker threads, or
+    outside of a window, are always safe. An ArenaVector made inside a window must not outlive it.
+
+    Without the option ArenaVector is just std::vector and CallingWindowArena does nothing.
+ */
+
+#if defined(ARENA_ALLOCATION)
+
+namespace detail {
+
+inline boost::container::pmr::memory_resource*& active_arena() noexcept
+{
+    thread_local boost::container::pmr::memory_resource* result {nullptr};
+    return result;
+}
+
+} // namespace detail
+
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept : resource_ {detail::active_arena()} {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : resource_ {other.resource()} {}
+
+    T* allocate(std::size_t n)
+    {
+        if (resource_) {
+            return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+        } else {
+            return std::allocator<T> {}.allocate(n);
+        }
+    }
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        if (resource_) {
+            resource_->deallocate(p, n * sizeof(T), alignof(T));
+        } else {
+            std::allocator<T> {}.deallocate(p, n);
+        }
+    }
+
+    boost::container::pmr::memory_resource* resource() const noexcept { return resource_; }
+
+private:
+    boost::container::pmr::memory_resource* resource_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+{
+    return lhs.resource() == rhs.resource();
+}
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+class CallingWindowArena
+{
+public:
+    CallingWindowArena() : is_owner_ {detail::active_arena() == nullptr}
+    {
+        if (is_owner_) detail::active_arena() = &arena();
+    }
+
+    CallingWindowArena(const CallingWindowArena&)            = delete;
+    CallingWindowArena& operator=(const CallingWindowArena&) = delete;
+    CallingWindowArena(CallingWindowArena&&)                 = delete;
+    CallingWindowArena& operator=(CallingWindowArena&&)      = delete;
+
+    ~CallingWindowArena()
+    {
+        if (is_owner_) {
+            detail::active_arena() = nullptr;
+            arena().release();
+        }
+    }
+
+private:
+    bool is_owner_; // nested windows share the outermost arena
+
+    static boost::container::pmr::monotonic_buffer_resource& arena()
+    {
+        thread_local boost::container::pmr::monotonic_buffer_resource result {};
+        return result;
+    }
+};
+
+#else
+
+template <typename T>
+using ArenaVector = std::vector<T>;
+
+class CallingWindowArena
+{
+public:
+    CallingWindowArena() noexcept {}
+};
+
+#endif
+
+} // namespace octopus
+
+#endif
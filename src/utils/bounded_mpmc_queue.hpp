@@ -0,0 +1,131 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef bounded_mpmc_queue_hpp
+#define bounded_mpmc_queue_hpp
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <algorithm>
+
+namespace octopus {
+
+/*
+ A lock-free bounded multi-producer multi-consumer FIFO ring queue (Vyukov). Each cell carries
+ a sequence number that tells producers and consumers whether it is free for the current lap,
+ so the only contention is a CAS on the enqueue or dequeue position.
+ */
+template <typename T>
+class BoundedMPMCQueue
+{
+public:
+    BoundedMPMCQueue() = delete;
+    explicit BoundedMPMCQueue(std::size_t capacity); // rounded up to a power of two
+    
+    BoundedMPMCQueue(const BoundedMPMCQueue&)            = delete;
+    BoundedMPMCQueue& operator=(const BoundedMPMCQueue&) = delete;
+    BoundedMPMCQueue(BoundedMPMCQueue&&)                 = delete;
+    BoundedMPMCQueue& operator=(BoundedMPMCQueue&&)      = delete;
+    
+    ~BoundedMPMCQueue() = default;
+    
+    std::size_t capacity() const noexcept;
+    
+    // value is only moved from if the push succeeds
+    bool try_push(T& value);
+    bool try_pop(T& result);
+    
+private:
+    static constexpr std::size_t cacheLineSize {64};
+    
+    struct alignas(cacheLineSize) Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+    
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_;
+    alignas(cacheLineSize) std::atomic<std::size_t> enqueue_pos_;
+    alignas(cacheLineSize) std::atomic<std::size_t> dequeue_pos_;
+};
+
+namespace detail {
+
+inline std::size_t round_up_to_power_of_two(std::size_t n) noexcept
+{
+    std::size_t result {1};
+    while (result < n) result <<= 1;
+    return result;
+}
+
+} // namespace detail
+
+template <typename T>
+BoundedMPMCQueue<T>::BoundedMPMCQueue(const std::size_t capacity)
+: cells_ {}
+, mask_ {detail::round_up_to_power_of_two(std::max(capacity, std::size_t {2})) - 1}
+, enqueue_pos_ {0}
+, dequeue_pos_ {0}
+{
+    cells_ = std::make_unique<Cell[]>(mask_ + 1);
+    for (std::size_t i {0}; i <= mask_; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+std::size_t BoundedMPMCQueue<T>::capacity() const noexcept
+{
+    return mask_ + 1;
+}
+
+template <typename T>
+bool BoundedMPMCQueue<T>::try_push(T& value)
+{
+    auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+        auto& cell = cells_[pos & mask_];
+        const auto sequence = cell.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.value = std::move(value);
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false; // full
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+bool BoundedMPMCQueue<T>::try_pop(T& result)
+{
+    auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+        auto& cell = cells_[pos & mask_];
+        const auto sequence = cell.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+        if (diff == 0) {
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                result = std::move(cell.value);
+                cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false; // empty
+        } else {
+            pos = dequeue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace octopus
+
+#endif
@@ -45,6 +45,8 @@ public:
     
     template <typename MappableType>
     void add(const MappableType& mappable);
+    template <typename MappableType>
+    void add(const MappableType& mappable, DepthType count); // as if mappable were added count times
     
     bool any() const noexcept;
     bool any(const Region& region) const noexcept;
@@ -85,7 +87,7 @@ private:
     using Iterator     = typename decltype(coverage_)::const_iterator;
     using IteratorPair = std::pair<Iterator, Iterator>;
     
-    void do_add(const Region& region);
+    void do_add(const Region& region, DepthType count = 1);
     IteratorPair range(const Region& region) const;
 };
 
@@ -150,6 +152,14 @@ void CoverageTracker<Region, T>::add(const MappableType& mappable)
     do_add(mapped_region(mappable));
 }
 
+template <typename Region, typename T>
+template <typename MappableType>
+void CoverageTracker<Region, T>::add(const MappableType& mappable, const DepthType count)
+{
+    static_assert(is_region_or_mappable<MappableType>, "MappableType not Mappable");
+    if (count > 0) do_add(mapped_region(mappable), count);
+}
+
 template <typename Region, typename T>
 bool CoverageTracker<Region, T>::any() const noexcept
 {
@@ -331,11 +341,11 @@ inline bool is_same_contig_helper(const GenomicRegion& lhs, const GenomicRegion&
 } // namespace detail
 
 template <typename Region, typename T>
-void CoverageTracker<Region, T>::do_add(const Region& region)
+void CoverageTracker<Region, T>::do_add(const Region& region, const DepthType count)
 {
     if (octopus::is_empty(region)) return;
     if (num_tracked_ == 0) {
-        coverage_.assign(size(region), 1);
+        coverage_.assign(size(region), count);
         encompassing_region_ = region;
     } else {
         if (!detail::is_same_contig_helper(region, encompassing_region_)) {
@@ -358,13 +368,14 @@ void CoverageTracker<Region, T>::do_add(const Region& region)
         assert(std::next(first, size(region)) <= std::end(coverage_));
         const auto last = std::next(first, size(region));
         if (check_overflow_) {
-            if (std::find(first, last, std::numeric_limits<DepthType>::max()) != last) {
+            const auto max_depth = std::numeric_limits<DepthType>::max() - count;
+            if (std::any_of(first, last, [=] (auto depth) noexcept { return depth > max_depth; })) {
                 throw std::runtime_error {"CoverageTracker::add failed due to depth overflow"};
             }
         }
-        std::transform(first, last, first, [] (auto count) noexcept { return count + 1; });
+        std::transform(first, last, first, [=] (auto depth) noexcept { return depth + count; });
     }
-    ++num_tracked_;
+    num_tracked_ += count;
 }
 
 template <typename Region, typename T>
@@ -5,6 +5,12 @@
 #define hash_functions_hpp
 
 #include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <cassert>
 
 #include <boost/utility/string_ref.hpp>
 #include <boost/functional/hash.hpp>
@@ -27,6 +33,120 @@ namespace octopus { namespace utils
             return std::hash<std::string>()(path.string());
         }
     };
+    
+    // A fast non-cryptographic 128 bit hash, built with hash_combine and hash_bytes. The two halves
+    // are mixed independently, so collisions are unlikely enough to use the hash in place of the key.
+    struct Hash128
+    {
+        std::uint64_t lo = 0x9e3779b97f4a7c15, hi = 0xc2b2ae3d27d4eb4f;
+    };
+    
+    inline bool operator==(const Hash128& lhs, const Hash128& rhs) noexcept
+    {
+        return lhs.lo == rhs.lo && lhs.hi == rhs.hi;
+    }
+    
+    inline void hash_combine(Hash128& hash, const std::uint64_t value) noexcept
+    {
+        hash.lo = (hash.lo ^ value) * 0xff51afd7ed558ccd;
+        hash.lo ^= hash.lo >> 32;
+        hash.hi = (hash.hi ^ value) * 0xc4ceb9fe1a85ec53;
+        hash.hi ^= hash.hi >> 29;
+    }
+    
+    inline void hash_bytes(Hash128& hash, const void* bytes, const std::size_t num_bytes) noexcept
+    {
+        const auto data = static_cast<const unsigned char*>(bytes);
+        std::size_t i {0};
+        for (; i + sizeof(std::uint64_t) <= num_bytes; i += sizeof(std::uint64_t)) {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            hash_combine(hash, word);
+        }
+        if (i < num_bytes) {
+            std::uint64_t word {0};
+            std::memcpy(&word, data + i, num_bytes - i);
+            hash_combine(hash, word);
+        }
+        hash_combine(hash, num_bytes);
+    }
+    
+    struct Hash128Hash
+    {
+        std::size_t operator()(const Hash128& hash) const noexcept
+        {
+            return static_cast<std::size_t>(hash.lo);
+        }
+    };
+    
+    /*
+     PrefixHashes holds polynomial hashes of every prefix of a sequence of values, so the hash of any
+     subsequence can be combined into a Hash128 in constant time. The hashes are modulo the Mersenne prime
+     2^61 - 1, with two bases, which unlike hashes modulo 2^64 have no structured collisions.
+     */
+    class PrefixHashes
+    {
+    public:
+        using Value = std::uint64_t;
+        
+        static constexpr Value maxValue {(std::uint64_t {1} << 61) - 2};
+        
+        // value(i) is the i'th value of the sequence, and must be at most maxValue
+        template <typename F>
+        void assign(const std::size_t size, F value)
+        {
+            lo_.resize(size + 1);
+            hi_.resize(size + 1);
+            lo_[0] = hi_[0] = 0;
+            for (std::size_t i {0}; i < size; ++i) {
+                const auto v = static_cast<Value>(value(i)) + 1;
+                assert(v <= maxValue + 1);
+                lo_[i + 1] = add(multiply(lo_[i], loBase), v);
+                hi_[i + 1] = add(multiply(hi_[i], hiBase), v);
+            }
+            while (lo_powers_.size() <= size) {
+                if (lo_powers_.empty()) {
+                    lo_powers_.push_back(1);
+                    hi_powers_.push_back(1);
+                } else {
+                    lo_powers_.push_back(multiply(lo_powers_.back(), loBase));
+                    hi_powers_.push_back(multiply(hi_powers_.back(), hiBase));
+                }
+            }
+        }
+        
+        std::size_t size() const noexcept { return lo_.empty() ? 0 : lo_.size() - 1; }
+        
+        void hash_range(Hash128& hash, const std::size_t pos, const std::size_t len) const noexcept
+        {
+            assert(pos + len <= size());
+            hash_combine(hash, subtract(lo_[pos + len], multiply(lo_[pos], lo_powers_[len])));
+            hash_combine(hash, subtract(hi_[pos + len], multiply(hi_[pos], hi_powers_[len])));
+            hash_combine(hash, len);
+        }
+        
+    private:
+        static constexpr std::uint64_t modulus {(std::uint64_t {1} << 61) - 1};
+        static constexpr std::uint64_t loBase {0x1f3d5b79aa3c4e21 % modulus}, hiBase {0x2c1b3c6d5a7f9e03 % modulus};
+        
+        std::vector<std::uint64_t> lo_, hi_, lo_powers_, hi_powers_;
+        
+        static std::uint64_t add(const std::uint64_t a, const std::uint64_t b) noexcept
+        {
+            const auto result = a + b;
+            return result >= modulus ? result - modulus : result;
+        }
+        static std::uint64_t subtract(const std::uint64_t a, const std::uint64_t b) noexcept
+        {
+            return a >= b ? a - b : a + modulus - b;
+        }
+        static std::uint64_t multiply(const std::uint64_t a, const std::uint64_t b) noexcept
+        {
+            const auto product = static_cast<unsigned __int128>(a) * b;
+            const auto result = (static_cast<std::uint64_t>(product) & modulus) + static_cast<std::uint64_t>(product >> 61);
+            return result >= modulus ? result - modulus : result;
+        }
+    };
 } // namespace utils
 } // namespace octopus
 
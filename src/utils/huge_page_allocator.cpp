@@ -0,0 +1,36 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "huge_page_allocator.hpp"
+
+#include <algorithm>
+
+#include <boost/align/aligned_alloc.hpp>
+
+#include <sys/mman.h>
+
+namespace octopus { namespace detail {
+
+void* allocate_huge_page_aware(std::size_t bytes, std::size_t alignment)
+{
+    const bool use_huge_pages {bytes >= hugePageSize};
+    if (use_huge_pages) {
+        alignment = std::max(alignment, hugePageSize);
+        // Whole huge pages, so the tail of the buffer isn't left in small pages
+        bytes = ((bytes + hugePageSize - 1) / hugePageSize) * hugePageSize;
+    }
+    auto result = boost::alignment::aligned_alloc(alignment, std::max(bytes, std::size_t {1}));
+    if (!result) throw std::bad_alloc {};
+    #if defined(MADV_HUGEPAGE)
+    if (use_huge_pages) madvise(result, bytes, MADV_HUGEPAGE); // only advice, so failure is fine
+    #endif
+    return result;
+}
+
+void deallocate_huge_page_aware(void* p) noexcept
+{
+    boost::alignment::aligned_free(p);
+}
+
+} // namespace detail
+} // namespace octopus
@@ -0,0 +1,91 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef huge_page_allocator_hpp
+#define huge_page_allocator_hpp
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+namespace octopus {
+
+/*
+    Memory for large, long-lived numeric buffers. All allocations are aligned to at least Alignment
+    bytes, so SIMD loads from the start of a buffer are aligned. Allocations of at least one huge page
+    (2MB) are aligned to the huge page size and, where the OS supports it, advised to be backed by
+    transparent huge pages, which cuts the TLB misses of loops over the whole buffer. Smaller
+    allocations are only aligned, so the allocator is fine for buffers that are usually small too.
+ */
+
+namespace detail {
+
+constexpr std::size_t hugePageSize {2 * 1024 * 1024};
+
+void* allocate_huge_page_aware(std::size_t bytes, std::size_t alignment);
+void deallocate_huge_page_aware(void* p) noexcept;
+
+} // namespace detail
+
+template <typename T, std::size_t Alignment = 64>
+class HugePageAllocator
+{
+    static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0, "Alignment must be a power of 2");
+
+public:
+    using value_type = T;
+
+    template <typename U> struct rebind { using other = HugePageAllocator<U, Alignment>; };
+
+    HugePageAllocator() noexcept = default;
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(const std::size_t n)
+    {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) throw std::bad_alloc {};
+        return static_cast<T*>(detail::allocate_huge_page_aware(n * sizeof(T), Alignment));
+    }
+    void deallocate(T* p, std::size_t) noexcept
+    {
+        detail::deallocate_huge_page_aware(p);
+    }
+};
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator==(const HugePageAllocator<T, Alignment>&, const HugePageAllocator<U, Alignment>&) noexcept
+{
+    return true;
+}
+template <typename T, typename U, std::size_t Alignment>
+bool operator!=(const HugePageAllocator<T, Alignment>&, const HugePageAllocator<U, Alignment>&) noexcept
+{
+    return false;
+}
+
+template <typename T>
+using HugePageVector = std::vector<T, HugePageAllocator<T>>;
+
+// An uninitialised buffer, for storage that is filled as it is used so pages are only touched when needed
+template <typename T>
+struct HugePageDeleter
+{
+    void operator()(T* p) const noexcept { detail::deallocate_huge_page_aware(p); }
+};
+
+template <typename T>
+using HugePageBuffer = std::unique_ptr<T[], HugePageDeleter<T>>;
+
+template <typename T>
+HugePageBuffer<T> make_huge_page_buffer(const std::size_t n)
+{
+    static_assert(std::is_trivial<T>::value, "HugePageBuffer is uninitialised so only for trivial types");
+    return HugePageBuffer<T> {HugePageAllocator<T> {}.allocate(n)};
+}
+
+} // namespace octopus
+
+#endif
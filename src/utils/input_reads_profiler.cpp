@@ -12,6 +12,11 @@
 #include <iostream>
 #include <future>
 #include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <functional>
+#include <unordered_map>
 
 #include <boost/random/uniform_int_distribution.hpp>
 
@@ -79,6 +84,39 @@ choose_next_sample_region(const SampleName& sample,
     }
 }
 
+bool is_every_contig_minimally_sampled(const InputRegionMap& regions,
+                                       const ReadSetProfileConfig& config,
+                                       const SamplingSummary& sampling_summary)
+{
+    return std::all_of(std::cbegin(regions), std::cend(regions), [&] (const auto& p) {
+        if (p.second.empty()) return true;
+        const auto itr = sampling_summary.sampled_regions.find(p.first);
+        return itr != std::cend(sampling_summary.sampled_regions) && itr->second.size() >= config.min_draws_per_contig;
+    });
+}
+
+// Running mean and variance of per-draw means (Welford's method)
+class DrawMeanAccumulator
+{
+public:
+    void add(const double value) noexcept
+    {
+        ++n_;
+        const auto delta = value - mean_;
+        mean_ += delta / n_;
+        sum_squared_deviations_ += delta * (value - mean_);
+    }
+    bool is_precise(const double max_relative_standard_error) const noexcept
+    {
+        if (n_ < 2) return false;
+        const auto standard_error = std::sqrt(sum_squared_deviations_ / (n_ - 1) / n_);
+        return standard_error <= max_relative_standard_error * mean_;
+    }
+private:
+    std::size_t n_ = 0;
+    double mean_ = 0, sum_squared_deviations_ = 0;
+};
+
 auto make_contig_sampling_distribution(const InputRegionMap& regions)
 {
     std::vector<unsigned> contig_weights(regions.size());
@@ -206,11 +244,20 @@ profile_reads(const SampleName& sample,
     SampleReadSetProfileHelper<DepthType> result {};
     std::vector<DepthType> sample_depths {};
     SamplingSummary sampling_summary {};
+    DrawMeanAccumulator draw_depths {}, draw_read_lengths {};
+    const auto is_precise = [&] () {
+        return config.max_relative_standard_error && sampling_summary.num_samples >= config.min_draws_per_sample
+               && draw_depths.is_precise(*config.max_relative_standard_error)
+               && draw_read_lengths.is_precise(*config.max_relative_standard_error)
+               && is_every_contig_minimally_sampled(regions, config, sampling_summary);
+    };
     while (true) {
         if (kill && *kill) return result;
+        if (is_precise()) break;
         const auto target_sampling_region = choose_next_sample_region(sample, regions, config, contig_sampling_distribution, sampling_summary);
         if (!target_sampling_region) break;
         CoverageTracker<GenomicRegion, DepthType> depth_tracker {true};
+        const auto num_prior_reads = result.read_lengths.size();
         auto remaining_reads = static_cast<int>(config.target_reads_per_draw);
         boost::optional<GenomicRegion> critical_region {};
         const auto read_visitor = [&] (const SampleName& sample, AlignedRead read) {
@@ -252,6 +299,12 @@ profile_reads(const SampleName& sample,
         }
         auto read_depths = depth_tracker.get(sampled_region);
         erase_non_dna_or_rna_positions(read_depths, sampled_region, reference);
+        if (!read_depths.empty()) draw_depths.add(maths::mean(read_depths));
+        if (result.read_lengths.size() > num_prior_reads) {
+            const auto first_read_length = std::next(std::cbegin(result.read_lengths), num_prior_reads);
+            draw_read_lengths.add(static_cast<double>(std::accumulate(first_read_length, std::cend(result.read_lengths), std::size_t {0}))
+                                  / (result.read_lengths.size() - num_prior_reads));
+        }
         utils::append(read_depths, result.contig_depths[sampled_region.contig_name()]);
         utils::append(std::move(read_depths), sample_depths);
         ++sampling_summary.num_samples;
@@ -362,6 +415,82 @@ profile_reads_helper(const std::vector<SampleName>& samples,
     return result;
 }
 
+bool has_depth_indices(const std::vector<SampleName>& samples, const ReadManager& source)
+{
+    return !samples.empty() && std::all_of(std::cbegin(samples), std::cend(samples), [&] (const SampleName& sample) {
+        return static_cast<bool>(source.depth_index_bin_size(sample)); });
+}
+
+void fill_summary_stats(const ReadDepthIndex::MappingQualityHistogram& histogram, ReadSetProfile::MappingQualityStats& result)
+{
+    const auto total = std::accumulate(std::cbegin(histogram), std::cend(histogram), std::uint64_t {0});
+    if (total == 0) return;
+    double sum {0};
+    std::uint64_t cumulative {0};
+    bool found_median {false};
+    for (std::size_t quality {0}; quality < histogram.size(); ++quality) {
+        if (histogram[quality] == 0) continue;
+        if (cumulative == 0) result.min = quality;
+        result.max = quality;
+        sum += static_cast<double>(quality) * histogram[quality];
+        cumulative += histogram[quality];
+        if (!found_median && 2 * cumulative >= total) {
+            result.median = quality;
+            found_median = true;
+        }
+    }
+    const auto mean = sum / total;
+    double squared_deviations {0};
+    for (std::size_t quality {0}; quality < histogram.size(); ++quality) {
+        squared_deviations += histogram[quality] * std::pow(quality - mean, 2);
+    }
+    result.mean = static_cast<AlignedRead::MappingQuality>(mean);
+    result.stdev = static_cast<AlignedRead::MappingQuality>(std::sqrt(squared_deviations / total));
+}
+
+// The depths are bin means rather than per-base, so the distributions are somewhat narrower than if profiled by sampling
+void fill_indexed_depth_and_mapping_quality_stats(const std::vector<SampleName>& samples,
+                                                  const InputRegionMap& regions,
+                                                  const ReadManager& source,
+                                                  ReadSetProfile& result)
+{
+    using DepthVector = std::vector<std::size_t>;
+    result.depth_stats = {};
+    std::unordered_map<GenomicRegion::ContigName, DepthVector> contig_depths {};
+    ReadDepthIndex::MappingQualityHistogram mapping_qualities {};
+    for (const auto& sample : samples) {
+        DepthVector sample_depths {};
+        auto& sample_depth_stats = result.depth_stats.sample[sample];
+        for (const auto& p : regions) {
+            DepthVector sample_contig_depths {};
+            for (const auto& region : p.second) {
+                for (const auto depth : *source.indexed_mean_depths(sample, region)) {
+                    sample_contig_depths.push_back(static_cast<std::size_t>(std::round(depth)));
+                }
+            }
+            std::sort(std::begin(sample_contig_depths), std::end(sample_contig_depths));
+            sample_depth_stats.contig.emplace(p.first, make_depth_stats(sample_contig_depths));
+            utils::append(sample_contig_depths, sample_depths);
+            utils::append(std::move(sample_contig_depths), contig_depths[p.first]);
+        }
+        std::sort(std::begin(sample_depths), std::end(sample_depths));
+        fill_depth_stats(sample_depths, sample_depth_stats.genome);
+        const auto sample_mapping_qualities = *source.indexed_mapping_qualities(sample);
+        std::transform(std::cbegin(sample_mapping_qualities), std::cend(sample_mapping_qualities),
+                       std::cbegin(mapping_qualities), std::begin(mapping_qualities), std::plus<> {});
+    }
+    DepthVector depths {};
+    for (auto& p : contig_depths) {
+        std::sort(std::begin(p.second), std::end(p.second));
+        result.depth_stats.combined.contig.emplace(p.first, make_depth_stats(p.second));
+        utils::append(std::move(p.second), depths);
+    }
+    std::sort(std::begin(depths), std::end(depths));
+    fill_depth_stats(depths, result.depth_stats.combined.genome);
+    result.mapping_quality_stats = {};
+    fill_summary_stats(mapping_qualities, result.mapping_quality_stats);
+}
+
 } // namespace
 
 boost::optional<ReadSetProfile>
@@ -372,6 +501,12 @@ profile_reads(const std::vector<SampleName>& samples,
               ReadSetProfileConfig config,
               boost::optional<ThreadPool&> workers)
 {
+    const auto use_depth_indices = has_depth_indices(samples, source);
+    if (use_depth_indices) {
+        // Reads are still sampled for the memory and length stats, but these need far fewer draws than depths
+        config.max_draws_per_sample = std::min(config.max_draws_per_sample, std::size_t {20});
+        config.min_draws_per_contig = std::min(config.min_draws_per_contig, std::size_t {1});
+    }
     boost::optional<ReadSetProfile> result {};
     try {
         result = profile_reads_helper<unsigned short>(samples, reference, regions, source, config, workers);
@@ -382,6 +517,9 @@ profile_reads(const std::vector<SampleName>& samples,
             result = profile_reads_helper<unsigned long>(samples, reference, regions, source, config, workers);
         }
     }
+    if (result && use_depth_indices) {
+        fill_indexed_depth_and_mapping_quality_stats(samples, regions, source, *result);
+    }
     return result;
 }
 
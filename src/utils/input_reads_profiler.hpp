@@ -23,6 +23,10 @@ struct ReadSetProfileConfig
     std::size_t max_draws_per_sample = 500;
     std::size_t target_reads_per_draw = 10'000;
     std::size_t min_draws_per_contig = 10;
+    // Drawing stops early once the standard errors of the mean depth and read length of draws are
+    // within this fraction of the means, after min_draws_per_sample draws
+    boost::optional<double> max_relative_standard_error = 0.02;
+    std::size_t min_draws_per_sample = 50;
     boost::optional<AlignedRead::NucleotideSequence::size_type> fragment_size = boost::none;
     unsigned min_read_lengths = 20;
 };
@@ -15,12 +15,24 @@
 #include <cassert>
 #include <limits>
 
+#include <boost/optional.hpp>
+
+#include "thread_pool.hpp"
+#include "parallel_transform.hpp"
+
 namespace octopus {
 
 struct KMediodsParameters
 {
     enum class InitialisationMode { random, max_distance, total_distance } initialisation = InitialisationMode::max_distance;
     std::size_t max_iterations = 100;
+    // Inputs larger than this are clustered with CLARA: k-medoids is run on random samples of the input
+    // and every point is assigned to the nearest medoids of the best sample, so the full distance
+    // matrix is never built and memory use is linear in the input size.
+    std::size_t max_exact_size = 5'000;
+    std::size_t num_samples = 5;
+    std::size_t sample_size = 0; // 0 means 40 + 2k, the size suggested by Kaufman & Rousseeuw
+    boost::optional<ThreadPool&> workers = boost::none; // used for assigning points to medoids
 };
 
 using Cluster = std::vector<std::size_t>;
@@ -292,6 +304,136 @@ D total_distance(const MediodVector& medoids,
     return result;
 }
 
+template <typename ForwardIterator, typename BinaryFunction>
+auto
+exact_k_medoids(const ForwardIterator first_data_itr, const ForwardIterator last_data_itr,
+                const std::size_t k,
+                ClusterVector& clusters,
+                const BinaryFunction& distance,
+                const KMediodsParameters& params)
+{
+    const auto distances = make_distance_matrix(first_data_itr, last_data_itr, distance);
+    auto medoids = initialise_mediods(first_data_itr, last_data_itr, k, distances, params);
+    if (static_cast<std::size_t>(std::distance(first_data_itr, last_data_itr)) <= k) {
+        clusters.reserve(medoids.size());
+        for (auto medoid : medoids) clusters.push_back({medoid});
+    }
+    initialise_clusters(clusters, medoids, distances, params);
+    for (std::size_t n {0}; n < params.max_iterations; ++n) {
+        update_mediods(medoids, clusters, distances);
+        auto assignments_changed = update_clusters(clusters, medoids, distances, params);
+        if (!assignments_changed) break;
+    }
+    for (auto& cluster : clusters) cluster.shrink_to_fit();
+    return std::make_pair(std::move(medoids), total_distance(medoids, clusters, distances));
+}
+
+inline auto
+draw_clara_sample(const std::size_t N, const std::size_t sample_size, const MediodVector& best_medoids, std::mt19937& generator)
+{
+    // The best medoids found so far are always in the sample so the fit can only improve
+    std::vector<bool> in_sample(N, false);
+    std::vector<std::size_t> result {};
+    result.reserve(sample_size);
+    for (auto medoid : best_medoids) {
+        in_sample[medoid] = true;
+        result.push_back(medoid);
+    }
+    std::uniform_int_distribution<std::size_t> dist {0, N - 1};
+    while (result.size() < sample_size) {
+        const auto idx = dist(generator);
+        if (!in_sample[idx]) {
+            in_sample[idx] = true;
+            result.push_back(idx);
+        }
+    }
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+template <typename D>
+struct Assignment
+{
+    std::size_t cluster;
+    D distance;
+};
+
+template <typename ForwardIterator, typename BinaryFunction>
+auto
+assign_to_medoids(const std::vector<ForwardIterator>& points, const MediodVector& medoids,
+                  const BinaryFunction& distance, const KMediodsParameters& params)
+{
+    using D = decltype(distance(*points.front(), *points.front()));
+    std::vector<std::size_t> medoid_clusters(points.size(), medoids.size());
+    for (std::size_t cluster_idx {0}; cluster_idx < medoids.size(); ++cluster_idx) {
+        medoid_clusters[medoids[cluster_idx]] = cluster_idx;
+    }
+    std::vector<std::size_t> point_indices(points.size());
+    std::iota(std::begin(point_indices), std::end(point_indices), 0);
+    std::vector<Assignment<D>> result {};
+    result.reserve(points.size());
+    parallel_transform(std::cbegin(point_indices), std::cend(point_indices), std::back_inserter(result), [&] (const std::size_t point_idx) {
+        // A medoid is always in its own cluster, so no cluster is empty
+        if (medoid_clusters[point_idx] < medoids.size()) return Assignment<D> {medoid_clusters[point_idx], D {}};
+        Assignment<D> best {0, distance(*points[point_idx], *points[medoids.front()])};
+        for (std::size_t cluster_idx {1}; cluster_idx < medoids.size(); ++cluster_idx) {
+            const auto d = distance(*points[point_idx], *points[medoids[cluster_idx]]);
+            if (d < best.distance) best = {cluster_idx, d};
+        }
+        return best;
+    }, params.workers);
+    return result;
+}
+
+template <typename D>
+D total_distance(const std::vector<Assignment<D>>& assignments)
+{
+    return std::accumulate(std::cbegin(assignments), std::cend(assignments), D {},
+                           [] (D total, const Assignment<D>& assignment) { return total + assignment.distance; });
+}
+
+template <typename ForwardIterator, typename BinaryFunction>
+auto
+clara_k_medoids(const ForwardIterator first_data_itr, const ForwardIterator last_data_itr,
+                const std::size_t k,
+                ClusterVector& clusters,
+                const BinaryFunction& distance,
+                const KMediodsParameters& params)
+{
+    std::vector<ForwardIterator> points {};
+    for (auto itr = first_data_itr; itr != last_data_itr; ++itr) points.push_back(itr);
+    const auto N = points.size();
+    const auto sample_size = std::min(params.sample_size > 0 ? params.sample_size : 40 + 2 * k, N);
+    const auto point_distance = [&] (const ForwardIterator& lhs, const ForwardIterator& rhs) { return distance(*lhs, *rhs); };
+    using D = decltype(distance(*first_data_itr, *first_data_itr));
+    std::mt19937 generator {42};
+    MediodVector best_medoids {};
+    std::vector<Assignment<D>> best_assignments {};
+    D best_distance {};
+    for (std::size_t s {0}; s < std::max(params.num_samples, std::size_t {1}); ++s) {
+        const auto sample = draw_clara_sample(N, sample_size, best_medoids, generator);
+        std::vector<ForwardIterator> sample_points(sample.size());
+        std::transform(std::cbegin(sample), std::cend(sample), std::begin(sample_points), [&] (auto idx) { return points[idx]; });
+        ClusterVector sample_clusters {};
+        auto medoids = exact_k_medoids(std::cbegin(sample_points), std::cend(sample_points), k,
+                                       sample_clusters, point_distance, params).first;
+        for (auto& medoid : medoids) medoid = sample[medoid];
+        auto assignments = assign_to_medoids(points, medoids, distance, params);
+        const auto sample_distance = total_distance(assignments);
+        if (best_medoids.empty() || sample_distance < best_distance) {
+            best_medoids = std::move(medoids);
+            best_assignments = std::move(assignments);
+            best_distance = sample_distance;
+        }
+    }
+    clusters.assign(best_medoids.size(), Cluster {});
+    for (std::size_t point_idx {0}; point_idx < N; ++point_idx) {
+        clusters[best_assignments[point_idx].cluster].push_back(point_idx);
+    }
+    for (auto& cluster : clusters) cluster.shrink_to_fit();
+    return std::make_pair(std::move(best_medoids), best_distance);
+}
+
 template <typename D>
 void print(const DistanceMatrix<D>& distances)
 {
@@ -313,20 +455,12 @@ k_medoids(const ForwardIterator first_data_itr, const ForwardIterator last_data_
           BinaryFunction distance,
           const KMediodsParameters params = KMediodsParameters {})
 {
-    const auto distances = detail::make_distance_matrix(first_data_itr, last_data_itr, distance);
-    auto medoids = detail::initialise_mediods(first_data_itr, last_data_itr, k, distances, params);
-    if (static_cast<std::size_t>(std::distance(first_data_itr, last_data_itr)) <= k) {
-        clusters.reserve(medoids.size());
-        for (auto medoid : medoids) clusters.push_back({medoid});
-    }
-    detail::initialise_clusters(clusters, medoids, distances, params);
-    for (std::size_t n {0}; n < params.max_iterations; ++n) {
-        detail::update_mediods(medoids, clusters, distances);
-        auto assignments_changed = detail::update_clusters(clusters, medoids, distances, params);
-        if (!assignments_changed) break;
+    const auto N = static_cast<std::size_t>(std::distance(first_data_itr, last_data_itr));
+    if (N > params.max_exact_size && N > k) {
+        return detail::clara_k_medoids(first_data_itr, last_data_itr, k, clusters, distance, params);
+    } else {
+        return detail::exact_k_medoids(first_data_itr, last_data_itr, k, clusters, distance, params);
     }
-    for (auto& cluster : clusters) cluster.shrink_to_fit();
-    return std::make_pair(std::move(medoids), detail::total_distance(medoids, clusters, distances));
 }
 
 template <typename ForwardIterator>
@@ -0,0 +1,125 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef kmer_encoding_hpp
+#define kmer_encoding_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <algorithm>
+#include <cassert>
+
+#include "simd_bytes.hpp"
+
+namespace octopus {
+
+// The 2-bit codes of the canonical bases are A = 0, C = 1, G = 2, T = 3
+constexpr std::uint8_t non_canonical_base_code {4};
+
+inline std::uint8_t encode_base(const char base) noexcept
+{
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return non_canonical_base_code;
+    }
+}
+
+/*
+    The last kmer_size (at most 32) bases pushed into the encoder, packed two bits per base with the
+    first base most significant, so codes order kmers lexicographically. The code and its reverse
+    complement are updated in O(1) per base. Non-canonical bases are packed as A, and the window is
+    valid once it holds kmer_size consecutive canonical bases.
+ */
+class RollingKmerEncoder
+{
+public:
+    using Code = std::uint64_t;
+
+    static constexpr unsigned max_kmer_size = 32;
+
+    RollingKmerEncoder() = delete;
+
+    explicit RollingKmerEncoder(unsigned kmer_size) noexcept
+    : kmer_size_ {kmer_size}
+    , mask_ {mask(kmer_size)}
+    {
+        assert(kmer_size > 0 && kmer_size <= max_kmer_size);
+    }
+
+    RollingKmerEncoder(const RollingKmerEncoder&)            = default;
+    RollingKmerEncoder& operator=(const RollingKmerEncoder&) = default;
+    RollingKmerEncoder(RollingKmerEncoder&&)                 = default;
+    RollingKmerEncoder& operator=(RollingKmerEncoder&&)      = default;
+
+    ~RollingKmerEncoder() = default;
+
+    unsigned kmer_size() const noexcept { return kmer_size_; }
+
+    void push(const char base) noexcept { push_code(encode_base(base)); }
+    void push_code(std::uint8_t base_code) noexcept
+    {
+        if (base_code == non_canonical_base_code) {
+            base_code = 0;
+            num_canonical_ = 0;
+        } else if (num_canonical_ < kmer_size_) {
+            ++num_canonical_;
+        }
+        if (size_ < kmer_size_) ++size_;
+        code_ = roll(code_, base_code, mask_);
+        reverse_complement_code_ = (reverse_complement_code_ >> 2) | (Code {3u - base_code} << (2 * (kmer_size_ - 1)));
+    }
+    void clear() noexcept { code_ = reverse_complement_code_ = 0; size_ = num_canonical_ = 0; }
+
+    bool is_full() const noexcept { return size_ == kmer_size_; }
+    bool is_valid() const noexcept { return num_canonical_ == kmer_size_; }
+
+    Code code() const noexcept { return code_; }
+    Code reverse_complement_code() const noexcept { return reverse_complement_code_; }
+    Code canonical_code() const noexcept { return std::min(code_, reverse_complement_code_); }
+
+    static Code mask(const unsigned kmer_size) noexcept
+    {
+        return kmer_size < max_kmer_size ? (Code {1} << (2 * kmer_size)) - 1 : ~Code {0};
+    }
+    // The code of a kmer with the given mask (see mask) after dropping its first base and appending base_code
+    static Code roll(const Code code, const std::uint8_t base_code, const Code mask) noexcept
+    {
+        return ((code << 2) | base_code) & mask;
+    }
+
+private:
+    unsigned kmer_size_;
+    Code mask_;
+    Code code_ = 0, reverse_complement_code_ = 0;
+    unsigned size_ = 0, num_canonical_ = 0;
+};
+
+/*
+    Calls f(position, encoder) for each of the kmers of [first, last), in order, where position is the
+    offset of the kmer from first. Bases are encoded in batches with utils::simd::encode_bases.
+ */
+template <typename BinaryFunction>
+void for_each_kmer(const char* first, const char* const last, RollingKmerEncoder& encoder, BinaryFunction&& f)
+{
+    constexpr std::size_t batch_size {256};
+    std::array<std::uint8_t, batch_size> codes;
+    std::size_t position {0};
+    encoder.clear();
+    while (first != last) {
+        const auto n = std::min(static_cast<std::size_t>(last - first), batch_size);
+        utils::simd::encode_bases(first, first + n, codes.data());
+        for (std::size_t i {0}; i < n; ++i, ++position) {
+            encoder.push_code(codes[i]);
+            if (encoder.is_full()) f(position + 1 - encoder.kmer_size(), encoder);
+        }
+        first += n;
+    }
+}
+
+} // namespace octopus
+
+#endif
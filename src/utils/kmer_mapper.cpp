@@ -24,7 +24,7 @@ map_query_to_target(const KmerPerfectHashes& query, const KmerHashTable& target,
 std::vector<std::size_t>
 map_query_to_target(const KmerPerfectHashes& query, const KmerHashTable& target)
 {
-    MappedIndexCounts mapping_counts(target.second, 0);
+    MappedIndexCounts mapping_counts(target.size(), 0);
     return  map_query_to_target(query, target, mapping_counts);
 }
 
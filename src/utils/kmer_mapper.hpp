@@ -13,6 +13,9 @@
 #include <algorithm>
 #include <numeric>
 #include <limits>
+#include <cassert>
+
+#include "kmer_encoding.hpp"
 
 namespace octopus {
 
@@ -40,15 +43,13 @@ constexpr auto perfect_hash(const char base) noexcept
 
 using KmerHashType = std::uint_fast32_t;
 
+// The 2-bit packed code of the K bases from first (see RollingKmerEncoder), non-canonical bases packed as A
 template <unsigned char K, typename InputIt>
 constexpr auto perfect_kmer_hash(InputIt first)
 {
-    unsigned k {1};
     return std::accumulate(first, std::next(first, K), KmerHashType {0},
-                           [&k] (const unsigned curr, const char base) {
-                               const auto result = curr + k * perfect_hash(base);
-                               k *= 4;
-                               return result;
+                           [] (const KmerHashType curr, const char base) {
+                               return 4 * curr + perfect_hash<KmerHashType>(base);
                            });
 }
 
@@ -61,40 +62,104 @@ auto compute_kmer_hashes(const std::string& sequence)
         return KmerPerfectHashes {};
     }
     KmerPerfectHashes result(sequence.size() - K + 1);
-    auto result_it = std::begin(result);
-    for (auto it = std::cbegin(sequence); it != std::prev(std::cend(sequence), K - 1); ++it, ++result_it) {
-        *result_it = perfect_kmer_hash<K>(it);
-    }
+    RollingKmerEncoder encoder {K};
+    for_each_kmer(sequence.data(), sequence.data() + sequence.size(), encoder,
+                  [&result] (const std::size_t position, const RollingKmerEncoder& kmer) {
+                      result[position] = static_cast<KmerHashType>(kmer.code());
+                  });
     return result;
 }
 
-using KmerHashTable = std::pair<std::vector<std::vector<std::size_t>>, std::size_t>;
+/*
+    The positions of each kmer of a sequence, stored CSR-style: the positions of all kmers are held in
+    one buffer ordered by kmer hash, with an offset into it for each of the num_kmers(K) hashes. A
+    table can be cleared and repopulated without reallocating.
+ */
+class KmerHashTable
+{
+public:
+    class Positions
+    {
+    public:
+        Positions(const std::size_t* first, const std::size_t* last) noexcept : first_ {first}, last_ {last} {}
+        const std::size_t* begin() const noexcept { return first_; }
+        const std::size_t* end() const noexcept { return last_; }
+        bool empty() const noexcept { return first_ == last_; }
+        std::size_t size() const noexcept { return last_ - first_; }
+    private:
+        const std::size_t* first_, *last_;
+    };
+    
+    KmerHashTable() = default;
+    
+    explicit KmerHashTable(unsigned char kmer_size) : offsets_(num_kmers(kmer_size) + 1, 0) {}
+    
+    KmerHashTable(const KmerHashTable&)            = default;
+    KmerHashTable& operator=(const KmerHashTable&) = default;
+    KmerHashTable(KmerHashTable&&)                 = default;
+    KmerHashTable& operator=(KmerHashTable&&)      = default;
+    
+    ~KmerHashTable() = default;
+    
+    // The number of kmer positions in the table
+    std::size_t size() const noexcept { return positions_.size(); }
+    
+    Positions operator[](KmerHashType hash) const noexcept
+    {
+        return {positions_.data() + offsets_[hash], positions_.data() + offsets_[hash + 1]};
+    }
+    
+    void clear() noexcept
+    {
+        std::fill(std::begin(offsets_), std::end(offsets_), 0);
+        positions_.clear();
+    }
+    
+    // Replaces the contents of the table with the kmers of sequence
+    template <unsigned char K>
+    void populate(const std::string& sequence)
+    {
+        assert(offsets_.size() == num_kmers(K) + 1);
+        if (!positions_.empty()) clear();
+        if (sequence.size() < K) return;
+        codes_.resize(sequence.size() - K + 1);
+        RollingKmerEncoder encoder {K};
+        for_each_kmer(sequence.data(), sequence.data() + sequence.size(), encoder,
+                      [this] (const std::size_t position, const RollingKmerEncoder& kmer) {
+                          const auto code = static_cast<KmerHashType>(kmer.code());
+                          codes_[position] = code;
+                          ++offsets_[code];
+                      });
+        // Turn the counts into bin end offsets, then fill the bins back to front so the positions
+        // in each bin are ascending and each offset ends at the start of its bin
+        std::partial_sum(std::cbegin(offsets_), std::cend(offsets_), std::begin(offsets_));
+        positions_.resize(codes_.size());
+        for (auto position = codes_.size(); position > 0; --position) {
+            positions_[--offsets_[codes_[position - 1]]] = position - 1;
+        }
+    }
+    
+private:
+    std::vector<std::uint32_t> offsets_;
+    std::vector<std::size_t> positions_;
+    std::vector<KmerHashType> codes_;
+};
 
 template <unsigned char K>
 KmerHashTable init_kmer_hash_table()
 {
-    return std::make_pair(std::vector<std::vector<std::size_t>> {num_kmers(K), std::vector<std::size_t> {}}, 0);
+    return KmerHashTable {K};
 }
 
 inline void clear_kmer_hash_table(KmerHashTable& table)
 {
-    for (auto& bin : table.first) bin.clear();
-    table.second = 0;
+    table.clear();
 }
 
 template <unsigned char K>
 void populate_kmer_hash_table(const std::string& sequence, KmerHashTable& result)
 {
-    if (sequence.size() < K) {
-        return;
-    }
-    const auto last_index = sequence.size() - K;
-    auto it = std::cbegin(sequence);
-    for (std::size_t index {0}; index <= last_index; ++index, ++it) {
-        result.first[perfect_kmer_hash<K>(it)].push_back(index);
-    }
-    for (auto& bin : result.first) bin.shrink_to_fit();
-    result.second = sequence.size() - K + 1;
+    result.template populate<K>(sequence);
 }
 
 template <unsigned char K>
@@ -105,11 +170,22 @@ KmerHashTable make_kmer_hash_table(const std::string& sequence)
     return result;
 }
 
+/*
+    A table owned by the calling thread, so repeated populations on a thread reuse one set of buffers.
+    The table must not be held while running other tasks that may use it.
+ */
+template <unsigned char K>
+KmerHashTable& thread_local_kmer_hash_table()
+{
+    thread_local auto result = init_kmer_hash_table<K>();
+    return result;
+}
+
 using MappedIndexCounts = std::vector<unsigned>;
 
 inline MappedIndexCounts init_mapping_counts(const KmerHashTable& target)
 {
-    return MappedIndexCounts(target.second, 0);
+    return MappedIndexCounts(target.size(), 0);
 }
 
 inline void reset_mapping_counts(MappedIndexCounts& mapping_counts)
@@ -126,7 +202,7 @@ OutputIt map_query_to_target(const KmerPerfectHashes& query, const KmerHashTable
     std::size_t first_max_hit_index {0};
     unsigned num_max_hits {0};
     for (std::size_t query_index {0}; query_index < query.size(); ++query_index) {
-        for (const auto target_index : target.first[query[query_index]]) {
+        for (const auto target_index : target[query[query_index]]) {
             if (target_index >= query_index) {
                 const auto mapping_begin = target_index - query_index;
                 if (++mapping_counts[mapping_begin] > max_hit_count) {
@@ -6,7 +6,9 @@
 
 #include <vector>
 #include <cstddef>
+#include <cstdint>
 #include <cmath>
+#include <memory>
 #include <numeric>
 #include <algorithm>
 #include <type_traits>
@@ -383,11 +385,54 @@ inline RealType fast_log_sum_exp(std::initializer_list<RealType> il) noexcept
                                           }));
 }
 
-template <typename ForwardIt,
-          typename = std::enable_if_t<!std::is_floating_point<ForwardIt>::value>>
-inline auto fast_log_sum_exp(ForwardIt first, ForwardIt last) noexcept
+namespace detail {
+
+template <typename Iterator>
+struct is_contiguous_double_iterator : std::integral_constant<bool,
+    std::is_same<Iterator, double*>::value || std::is_same<Iterator, const double*>::value
+    || std::is_same<Iterator, std::vector<double>::iterator>::value
+    || std::is_same<Iterator, std::vector<double>::const_iterator>::value> {};
+
+// Exponentiates n contiguous doubles in place. fmath::expd_v needs 32 byte aligned
+// input, so any unaligned head is done one at a time.
+inline void exp_contiguous(double* values, std::size_t n) noexcept
+{
+    #if defined(__SSE2__)
+    for (; n > 0 && reinterpret_cast<std::uintptr_t>(values) % 32 != 0; ++values, --n) {
+        *values = fmath::expd(*values);
+    }
+    fmath::expd_v(values, n);
+    #else
+    std::transform(values, values + n, values, [] (const double x) noexcept { return std::exp(x); });
+    #endif // defined(__SSE2__)
+}
+
+inline double sum_exp_contiguous(const double* values, const std::size_t n, const double shift) noexcept
+{
+    constexpr std::size_t block_size {64};
+    alignas(32) double block[block_size];
+    double result {0};
+    for (std::size_t i {0}; i < n; i += block_size) {
+        const auto m = std::min(n - i, block_size);
+        std::transform(values + i, values + i + m, block, [shift] (const double x) noexcept { return x - shift; });
+        exp_contiguous(block, m);
+        result = std::accumulate(block, block + m, result);
+    }
+    return result;
+}
+
+template <typename ForwardIt>
+auto fast_log_sum_exp(ForwardIt first, ForwardIt last, std::true_type) noexcept
+{
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    const double* values {std::addressof(*first)};
+    const auto max = *std::max_element(values, values + n);
+    return max + std::log(sum_exp_contiguous(values, n, max));
+}
+
+template <typename ForwardIt>
+auto fast_log_sum_exp(ForwardIt first, ForwardIt last, std::false_type) noexcept
 {
-    assert(first != last);
     using RealType = typename std::iterator_traits<ForwardIt>::value_type;
     const auto max = *std::max_element(first, last);
     return max + fast_log(std::accumulate(first, last, RealType {0},
@@ -396,6 +441,17 @@ inline auto fast_log_sum_exp(ForwardIt first, ForwardIt last) noexcept
                                           }));
 }
 
+} // namespace detail
+
+// Contiguous double ranges are vectorised, with relative error below 1e-13
+template <typename ForwardIt,
+          typename = std::enable_if_t<!std::is_floating_point<ForwardIt>::value>>
+inline auto fast_log_sum_exp(ForwardIt first, ForwardIt last) noexcept
+{
+    assert(first != last);
+    return detail::fast_log_sum_exp(first, last, detail::is_contiguous_double_iterator<ForwardIt> {});
+}
+
 template <typename RealType,
           typename = std::enable_if_t<std::is_floating_point<RealType>::value>>
 inline RealType fast_log_sum_exp(const std::array<RealType, 1>& logs) noexcept
@@ -423,6 +479,45 @@ inline auto fast_log_sum_exp(const Container& values) noexcept
     return fast_log_sum_exp(std::cbegin(values), std::cend(values));
 }
 
+namespace detail {
+
+template <typename ForwardIt>
+void fast_exp_each(ForwardIt first, ForwardIt last, std::true_type) noexcept
+{
+    exp_contiguous(std::addressof(*first), static_cast<std::size_t>(std::distance(first, last)));
+}
+
+template <typename ForwardIt>
+void fast_exp_each(ForwardIt first, ForwardIt last, std::false_type) noexcept
+{
+    std::for_each(first, last, [] (auto& value) noexcept { value = fast_exp(value); });
+}
+
+} // namespace detail
+
+// Vectorised for contiguous double ranges, with relative error below 1e-13
+template <typename Range>
+void fast_exp_each(Range& values) noexcept
+{
+    using std::begin; using std::end;
+    if (begin(values) == end(values)) return;
+    detail::fast_exp_each(begin(values), end(values), detail::is_contiguous_double_iterator<decltype(begin(values))> {});
+}
+
+// Uses the recurrence digamma(x) = digamma(x + 1) - 1/x to shift x above 10, then the
+// asymptotic expansion, which has absolute error below 1e-13 for x > 0
+template <typename RealType,
+          typename = std::enable_if_t<std::is_floating_point<RealType>::value>>
+inline RealType fast_digamma(RealType x) noexcept
+{
+    assert(x > 0);
+    RealType result {0};
+    for (; x < 10; x += 1) result -= 1 / x;
+    const auto f = 1 / (x * x);
+    const auto series = f * (RealType {1} / 12 - f * (RealType {1} / 120 - f * (RealType {1} / 252 - f * (RealType {1} / 240 - f * (RealType {1} / 132)))));
+    return result + std::log(x) - RealType {0.5} / x - series;
+}
+
 template <typename T, typename IntegerType,
           typename = std::enable_if_t<std::is_integral<IntegerType>::value>>
 T factorial(const IntegerType x)
@@ -1150,6 +1245,24 @@ auto normalise_exp(Range& logs)
     return normalise_exp(std::begin(logs), std::end(logs));
 }
 
+// As normalise_logs, but vectorised for contiguous double ranges
+template <typename Range>
+auto fast_normalise_logs(Range& logs) noexcept
+{
+    const auto norm = fast_log_sum_exp(std::cbegin(logs), std::cend(logs));
+    for (auto& value : logs) value -= norm;
+    return norm;
+}
+
+// As normalise_exp, but vectorised for contiguous double ranges
+template <typename Range>
+auto fast_normalise_exp(Range& logs) noexcept
+{
+    const auto norm = fast_normalise_logs(logs);
+    fast_exp_each(logs);
+    return norm;
+}
+
 } // namespace maths
 } // namespace octopus
 
@@ -0,0 +1,105 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "memory_budget.hpp"
+
+#include <utility>
+
+namespace octopus {
+
+MemoryBudget::Reservation::Reservation(MemoryBudget& budget, MemoryFootprint footprint) noexcept
+: budget_ {&budget}
+, bytes_ {0}
+{
+    resize(footprint);
+}
+
+MemoryBudget::Reservation::Reservation(Reservation&& other) noexcept
+: budget_ {other.budget_}
+, bytes_ {other.bytes_}
+{
+    other.bytes_ = 0;
+}
+
+MemoryBudget::Reservation& MemoryBudget::Reservation::operator=(Reservation&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        budget_ = other.budget_;
+        bytes_ = other.bytes_;
+        other.bytes_ = 0;
+    }
+    return *this;
+}
+
+MemoryBudget::Reservation::~Reservation() noexcept
+{
+    release();
+}
+
+MemoryFootprint MemoryBudget::Reservation::footprint() const noexcept
+{
+    return bytes_;
+}
+
+void MemoryBudget::Reservation::resize(const MemoryFootprint footprint) noexcept
+{
+    if (!budget_) return;
+    if (footprint.bytes() > bytes_) {
+        budget_->used_ += footprint.bytes() - bytes_;
+    } else {
+        budget_->used_ -= bytes_ - footprint.bytes();
+    }
+    bytes_ = footprint.bytes();
+}
+
+void MemoryBudget::Reservation::release() noexcept
+{
+    resize(0);
+}
+
+MemoryBudget::MemoryBudget(const MemoryFootprint limit) noexcept
+: limit_ {limit.bytes()}
+, used_ {0}
+{}
+
+boost::optional<MemoryFootprint> MemoryBudget::limit() const noexcept
+{
+    const auto result = limit_.load();
+    if (result == unlimited_) return boost::none;
+    return MemoryFootprint {result};
+}
+
+void MemoryBudget::set_limit(boost::optional<MemoryFootprint> limit) noexcept
+{
+    limit_ = limit ? limit->bytes() : unlimited_;
+}
+
+MemoryFootprint MemoryBudget::used() const noexcept
+{
+    return used_.load();
+}
+
+MemoryFootprint MemoryBudget::available() const noexcept
+{
+    const auto limit = limit_.load(), used = used_.load();
+    return used < limit ? limit - used : 0;
+}
+
+bool MemoryBudget::is_exceeded() const noexcept
+{
+    return used_.load() > limit_.load();
+}
+
+bool MemoryBudget::fits(const MemoryFootprint footprint) const noexcept
+{
+    return footprint <= available();
+}
+
+MemoryBudget& process_memory_budget() noexcept
+{
+    static MemoryBudget result {};
+    return result;
+}
+
+} // namespace octopus
@@ -0,0 +1,78 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef memory_budget_hpp
+#define memory_budget_hpp
+
+#include <cstddef>
+#include <atomic>
+
+#include <boost/optional.hpp>
+
+#include "memory_footprint.hpp"
+
+namespace octopus {
+
+/*
+    MemoryBudget accounts for the estimated memory of the large, long lived, or fast growing
+    parts of a run (read buffers, the reference cache, haplotype likelihoods, genotype
+    posteriors) against an optional limit. Components register their footprint with a
+    Reservation, which they resize as they grow or shrink, and which is given back on
+    destruction. Registering never fails: it is up to the scheduler to hold back new work
+    while the budget is exceeded or nearly so.
+ */
+class MemoryBudget
+{
+public:
+    class Reservation
+    {
+    public:
+        Reservation() = default;
+        Reservation(MemoryBudget& budget, MemoryFootprint footprint = 0) noexcept;
+
+        Reservation(const Reservation&)            = delete;
+        Reservation& operator=(const Reservation&) = delete;
+        Reservation(Reservation&& other) noexcept;
+        Reservation& operator=(Reservation&& other) noexcept;
+
+        ~Reservation() noexcept;
+
+        MemoryFootprint footprint() const noexcept;
+        void resize(MemoryFootprint footprint) noexcept;
+        void release() noexcept;
+
+    private:
+        MemoryBudget* budget_ = nullptr;
+        std::size_t bytes_ = 0;
+    };
+
+    MemoryBudget() = default; // unlimited
+    MemoryBudget(MemoryFootprint limit) noexcept;
+
+    MemoryBudget(const MemoryBudget&)            = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+    MemoryBudget(MemoryBudget&&)                 = delete;
+    MemoryBudget& operator=(MemoryBudget&&)      = delete;
+
+    ~MemoryBudget() = default;
+
+    boost::optional<MemoryFootprint> limit() const noexcept;
+    void set_limit(boost::optional<MemoryFootprint> limit) noexcept;
+
+    MemoryFootprint used() const noexcept;
+    MemoryFootprint available() const noexcept; // zero if the budget is exceeded
+    bool is_exceeded() const noexcept;
+    bool fits(MemoryFootprint footprint) const noexcept;
+
+private:
+    static constexpr std::size_t unlimited_ {static_cast<std::size_t>(-1)};
+
+    std::atomic<std::size_t> limit_ {unlimited_}, used_ {0};
+};
+
+// The budget that components of this process register with. Unlimited unless set with --max-memory.
+MemoryBudget& process_memory_budget() noexcept;
+
+} // namespace octopus
+
+#endif
@@ -18,175 +18,240 @@
 
 namespace octopus {
 
+/*
+ These algorithms split the input range into contiguous chunks, one for each idle worker of the
+ given pool plus one that is run in the calling thread, so the cost of scheduling is paid per
+ chunk rather than per element and the pool is never oversubscribed. Chunks that cannot be
+ given to an idle worker are run in the calling thread. Ranges that cannot be traversed more
+ than once (i.e. input iterators) are processed sequentially.
+ */
+
 namespace detail {
 
-template <typename InputIt,
+template <typename ForwardIt>
+std::size_t num_chunks(ForwardIt first, ForwardIt last, const ThreadPool& pool)
+{
+    if (pool.size() < 2) return 1;
+    return std::min(static_cast<std::size_t>(std::distance(first, last)), pool.n_idle() + 1);
+}
+
+// Returns the futures of each (non-empty) chunk result in input order once all chunks are complete.
+template <typename ForwardIt, typename ChunkOp>
+auto run_chunks(ForwardIt first, ForwardIt last, std::size_t num_chunks, ChunkOp& chunk_op, ThreadPool& pool)
+{
+    using chunk_result_type = std::result_of_t<ChunkOp&(ForwardIt, ForwardIt)>;
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    std::vector<std::future<chunk_result_type>> result {};
+    result.reserve(num_chunks);
+    for (std::size_t chunk {0}; chunk < num_chunks; ++chunk) {
+        const auto chunk_last = std::next(first, n / num_chunks + (chunk < n % num_chunks ? 1 : 0));
+        if (chunk + 1 < num_chunks) {
+            result.push_back(pool.try_push([&chunk_op, first, chunk_last] () { return chunk_op(first, chunk_last); }));
+        } else {
+            // run last chunk in calling thread
+            std::packaged_task<chunk_result_type()> task {[&chunk_op, first, chunk_last] () { return chunk_op(first, chunk_last); }};
+            result.push_back(task.get_future());
+            task();
+        }
+        first = chunk_last;
+    }
+    // Wait for every chunk before any result is retrieved so no chunk outlives the caller's state if one throws
+    for (const auto& f : result) pool.wait(f);
+    return result;
+}
+
+template <typename ForwardIt,
           typename OutputIt,
           typename UnaryOp>
-OutputIt parallel_transform(InputIt first, InputIt last, OutputIt result, UnaryOp op,
-                            std::random_access_iterator_tag)
+OutputIt parallel_transform(ForwardIt first, ForwardIt last, OutputIt result, UnaryOp op, ThreadPool& pool,
+                            std::forward_iterator_tag)
 {
-    using value_type  = typename std::iterator_traits<InputIt>::value_type;
-    using result_type = std::result_of_t<UnaryOp(value_type)>;
-    std::vector<std::future<result_type>> results(std::distance(first, last));
-    std::transform(first, last, std::begin(results),
-                   [&op](const auto& value) {
-                       return std::async(std::launch::async, op, std::cref(value));
-                   });
-    return std::transform(std::begin(results), std::end(results), result,
-                          [](auto& f) { return f.get(); });
+    const auto n_chunks = num_chunks(first, last, pool);
+    if (n_chunks < 2) {
+        return std::transform(first, last, result, std::move(op));
+    }
+    using result_type = std::decay_t<std::result_of_t<UnaryOp&(typename std::iterator_traits<ForwardIt>::reference)>>;
+    auto transform_chunk = [&op] (ForwardIt chunk_first, ForwardIt chunk_last) {
+        std::vector<result_type> chunk_result {};
+        chunk_result.reserve(std::distance(chunk_first, chunk_last));
+        std::transform(chunk_first, chunk_last, std::back_inserter(chunk_result), op);
+        return chunk_result;
+    };
+    for (auto& chunk_result : run_chunks(first, last, n_chunks, transform_chunk, pool)) {
+        auto values = chunk_result.get();
+        result = std::move(std::begin(values), std::end(values), result);
+    }
+    return result;
 }
 
 template <typename InputIt,
           typename OutputIt,
           typename UnaryOp>
-OutputIt parallel_transform(InputIt first, InputIt last, OutputIt result, UnaryOp op,
+OutputIt parallel_transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, ThreadPool& pool,
                             std::input_iterator_tag)
 {
     return std::transform(first, last, result, std::move(op));
 }
 
-template <typename InputIt1,
-          typename InputIt2,
+template <typename ForwardIt1,
+          typename ForwardIt2,
           typename OutputIt,
           typename BinaryOp>
-OutputIt parallel_transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op,
-                            std::random_access_iterator_tag, std::random_access_iterator_tag)
+OutputIt parallel_transform(ForwardIt1 first1, ForwardIt1 last1, ForwardIt2 first2, OutputIt result, BinaryOp op, ThreadPool& pool,
+                            std::forward_iterator_tag, std::forward_iterator_tag)
 {
-    using value_type1  = typename std::iterator_traits<InputIt1>::value_type;
-    using value_type2  = typename std::iterator_traits<InputIt2>::value_type;
-    using result_type = std::result_of_t<BinaryOp(value_type1, value_type2)>;
-    std::vector<std::future<result_type>> results(std::distance(first1, last1));
-    std::transform(first1, last1, first2, std::begin(results),
-                   [&op](const auto& a, const auto& b) {
-                       return std::async(std::launch::async, op, std::cref(a), std::cref(b));
-                   });
-    return std::transform(std::begin(results), std::end(results), result,
-                          [](auto& f) { return f.get(); });
+    const auto n_chunks = num_chunks(first1, last1, pool);
+    if (n_chunks < 2) {
+        return std::transform(first1, last1, first2, result, std::move(op));
+    }
+    using result_type = std::decay_t<std::result_of_t<BinaryOp&(typename std::iterator_traits<ForwardIt1>::reference,
+                                                                typename std::iterator_traits<ForwardIt2>::reference)>>;
+    auto transform_chunk = [&op, first1, first2] (ForwardIt1 chunk_first, ForwardIt1 chunk_last) {
+        std::vector<result_type> chunk_result {};
+        chunk_result.reserve(std::distance(chunk_first, chunk_last));
+        std::transform(chunk_first, chunk_last, std::next(first2, std::distance(first1, chunk_first)),
+                       std::back_inserter(chunk_result), op);
+        return chunk_result;
+    };
+    for (auto& chunk_result : run_chunks(first1, last1, n_chunks, transform_chunk, pool)) {
+        auto values = chunk_result.get();
+        result = std::move(std::begin(values), std::end(values), result);
+    }
+    return result;
 }
 
 template <typename InputIt1,
           typename InputIt2,
           typename OutputIt,
           typename BinaryOp>
-OutputIt parallel_transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op,
+OutputIt parallel_transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, ThreadPool& pool,
                             std::input_iterator_tag, std::input_iterator_tag)
 {
     return std::transform(first1, last1, first2, result, std::move(op));
 }
 
-} // namespace detail
+template <typename ForwardIt,
+          typename UnaryOp>
+void parallel_for_each(ForwardIt first, ForwardIt last, UnaryOp op, ThreadPool& pool,
+                       std::forward_iterator_tag)
+{
+    const auto n_chunks = num_chunks(first, last, pool);
+    if (n_chunks < 2) {
+        std::for_each(first, last, std::move(op));
+        return;
+    }
+    auto apply_chunk = [&op] (ForwardIt chunk_first, ForwardIt chunk_last) { std::for_each(chunk_first, chunk_last, op); };
+    for (auto& f : run_chunks(first, last, n_chunks, apply_chunk, pool)) {
+        f.get();
+    }
+}
 
 template <typename InputIt,
-          typename OutputIt,
           typename UnaryOp>
-OutputIt parallel_transform(InputIt first, InputIt last, OutputIt result, UnaryOp op)
+void parallel_for_each(InputIt first, InputIt last, UnaryOp op, ThreadPool& pool,
+                       std::input_iterator_tag)
 {
-    return detail::parallel_transform(first, last, result, std::move(op),
-                                      typename std::iterator_traits<InputIt>::iterator_category {});
+    std::for_each(first, last, std::move(op));
 }
 
-template <typename InputIt1,
-          typename InputIt2,
-          typename OutputIt,
-          typename BinaryOp>
-OutputIt parallel_transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op)
+template <typename ForwardIt,
+          typename T,
+          typename BinaryOp,
+          typename UnaryOp>
+T parallel_transform_reduce(ForwardIt first, ForwardIt last, T init, BinaryOp reduce_op, UnaryOp transform_op, ThreadPool& pool,
+                            std::forward_iterator_tag)
 {
-    return detail::parallel_transform(first1, last1, first2, result, std::move(op),
-                                      typename std::iterator_traits<InputIt1>::iterator_category {},
-                                      typename std::iterator_traits<InputIt2>::iterator_category {});
+    const auto n_chunks = num_chunks(first, last, pool);
+    if (n_chunks < 2) {
+        for (; first != last; ++first) init = reduce_op(std::move(init), transform_op(*first));
+        return init;
+    }
+    // Each chunk is non-empty, so its first element seeds the chunk's partial result
+    auto reduce_chunk = [&reduce_op, &transform_op] (ForwardIt chunk_first, ForwardIt chunk_last) {
+        T chunk_result = transform_op(*chunk_first);
+        for (++chunk_first; chunk_first != chunk_last; ++chunk_first) {
+            chunk_result = reduce_op(std::move(chunk_result), transform_op(*chunk_first));
+        }
+        return chunk_result;
+    };
+    for (auto& chunk_result : run_chunks(first, last, n_chunks, reduce_chunk, pool)) {
+        init = reduce_op(std::move(init), chunk_result.get());
+    }
+    return init;
 }
 
-namespace detail {
+template <typename InputIt,
+          typename T,
+          typename BinaryOp,
+          typename UnaryOp>
+T parallel_transform_reduce(InputIt first, InputIt last, T init, BinaryOp reduce_op, UnaryOp transform_op, ThreadPool& pool,
+                            std::input_iterator_tag)
+{
+    for (; first != last; ++first) init = reduce_op(std::move(init), transform_op(*first));
+    return init;
+}
+
+struct Identity
+{
+    template <typename T>
+    decltype(auto) operator()(T&& value) const noexcept { return std::forward<T>(value); }
+};
+
+} // namespace detail
+
+// parallel_transform
 
 template <typename InputIt,
           typename OutputIt,
           typename UnaryOp>
-OutputIt 
-transform(InputIt first, InputIt last, OutputIt result, 
-          UnaryOp op, ThreadPool& pool,
-          std::random_access_iterator_tag)
+OutputIt parallel_transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, ThreadPool& pool)
 {
-    using value_type  = typename std::iterator_traits<InputIt>::value_type;
-    using result_type = std::result_of_t<UnaryOp(value_type)>;
-    const auto n = std::distance(first, last);
-    if (n < 2) {
-        return std::transform(first, last, result, std::move(op));
-    }
-    std::vector<std::future<result_type>> results(n);
-    std::transform(first, std::prev(last), std::begin(results),
-                   [&op, &pool] (auto&& value) {
-                       return pool.try_push([&] () { return op(value); });
-                   });
-    // run last input in calling thread
-    std::promise<result_type> last_result {};
-    results.back() = last_result.get_future();
-    last_result.set_value(op(*std::prev(last)));
-    return std::transform(std::begin(results), std::end(results), result,
-                          [](auto& f) { return f.get(); });
+    return detail::parallel_transform(first, last, result, std::move(op), pool,
+                                      typename std::iterator_traits<InputIt>::iterator_category {});
 }
 
 template <typename InputIt,
           typename OutputIt,
           typename UnaryOp>
-OutputIt transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, ThreadPool& pool,
-                   std::input_iterator_tag)
+OutputIt parallel_transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, boost::optional<ThreadPool&> pool)
 {
-    return std::transform(first, last, result, std::move(op));
+    if (pool) {
+        return parallel_transform(first, last, result, std::move(op), *pool);
+    } else {
+        return std::transform(first, last, result, std::move(op));
+    }
 }
 
 template <typename InputIt1,
           typename InputIt2,
           typename OutputIt,
           typename BinaryOp>
-OutputIt 
-transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, 
-          BinaryOp op, ThreadPool& pool,
-          std::random_access_iterator_tag, std::random_access_iterator_tag)
+OutputIt parallel_transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, ThreadPool& pool)
 {
-    using value_type1 = typename std::iterator_traits<InputIt1>::value_type;
-    using value_type2 = typename std::iterator_traits<InputIt2>::value_type;
-    using result_type = std::result_of_t<BinaryOp(value_type1, value_type2)>;
-    const auto n = std::distance(first1, last1);
-    if (n < 2) {
-        return std::transform(first1, last1, first2, result, std::move(op));
-    }
-    std::vector<std::future<result_type>> results(n);
-    std::transform(first1, std::prev(last1), first2, std::begin(results),
-                   [&op, &pool] (auto&& a, auto&& b) {
-                       return pool.try_push([&] () { return op(a, b); });
-                   });
-    // run last input in calling thread
-    std::promise<result_type> last_result {};
-    results.back() = last_result.get_future();
-    last_result.set_value(op(*std::prev(last1), *std::next(first2, n - 1)));
-    return std::transform(std::begin(results), std::end(results), result,
-                          [](auto& f) { return f.get(); });
+    return detail::parallel_transform(first1, last1, first2, result, std::move(op), pool,
+                                      typename std::iterator_traits<InputIt1>::iterator_category {},
+                                      typename std::iterator_traits<InputIt2>::iterator_category {});
 }
 
 template <typename InputIt1,
           typename InputIt2,
           typename OutputIt,
           typename BinaryOp>
-OutputIt transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, ThreadPool& pool,
-                   std::input_iterator_tag, std::input_iterator_tag)
+OutputIt parallel_transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, boost::optional<ThreadPool&> pool)
 {
-    return std::transform(first1, last1, first2, result, std::move(op));
+    if (pool) {
+        return parallel_transform(first1, last1, first2, result, std::move(op), *pool);
+    } else {
+        return std::transform(first1, last1, first2, result, std::move(op));
+    }
 }
 
-} // namespace detail
-
 template <typename InputIt,
           typename OutputIt,
           typename UnaryOp>
 OutputIt transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, ThreadPool& pool)
 {
-    if (pool.size() > 1) {
-        return detail::transform(first, last, result, std::move(op), pool,
-                                 typename std::iterator_traits<InputIt>::iterator_category {});
-    } else {
-        return std::transform(first, last, result, std::move(op));
-    }
+    return parallel_transform(first, last, result, std::move(op), pool);
 }
 
 template <typename InputIt,
@@ -194,11 +259,7 @@ template <typename InputIt,
           typename UnaryOp>
 OutputIt transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, boost::optional<ThreadPool&> pool)
 {
-    if (pool) {
-        return transform(first, last, result, std::move(op), *pool);
-    } else {
-        return std::transform(first, last, result, std::move(op));
-    }
+    return parallel_transform(first, last, result, std::move(op), pool);
 }
 
 template <typename InputIt1,
@@ -207,14 +268,7 @@ template <typename InputIt1,
           typename BinaryOp>
 OutputIt transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, ThreadPool& pool)
 {
-    if (pool.size() > 1) {
-        return detail::transform(first1, last1, first2, result, std::move(op), pool,
-                             typename std::iterator_traits<InputIt1>::iterator_category {},
-                             typename std::iterator_traits<InputIt2>::iterator_category {});
-    } else {
-        return std::transform(first1, last1, first2, result, std::move(op));
-    }
-    
+    return parallel_transform(first1, last1, first2, result, std::move(op), pool);
 }
 
 template <typename InputIt1,
@@ -223,74 +277,91 @@ template <typename InputIt1,
           typename BinaryOp>
 OutputIt transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, boost::optional<ThreadPool&> pool)
 {
-    if (pool) {
-        return transform(first1, last1, first2, result, std::move(op), *pool);
-    } else {
-        return std::transform(first1, last1, first2, result, std::move(op));
-    }
+    return parallel_transform(first1, last1, first2, result, std::move(op), pool);
 }
 
-// for_each
-
-namespace detail {
+// parallel_for_each
 
 template <typename InputIt,
           typename UnaryOp>
-void for_each(InputIt first, InputIt last, UnaryOp op, ThreadPool& pool, 
-              std::input_iterator_tag)
+void parallel_for_each(InputIt first, InputIt last, UnaryOp op, ThreadPool& pool)
 {
-    if (first == last) return;
-    std::vector<std::future<void>> futures {};
-    std::transform(first, last, std::back_inserter(futures),
-                   [&op, &pool] (auto& value) {
-                       return pool.try_push([&] () { return op(value); });
-                   });
-    for (auto& f : futures) f.get();
+    detail::parallel_for_each(first, last, std::move(op), pool,
+                              typename std::iterator_traits<InputIt>::iterator_category {});
 }
 
 template <typename InputIt,
           typename UnaryOp>
-void for_each(InputIt first, InputIt last, UnaryOp op, ThreadPool& pool, 
-              std::bidirectional_iterator_tag)
+void parallel_for_each(InputIt first, InputIt last, UnaryOp op, boost::optional<ThreadPool&> pool)
 {
-    const auto n = std::distance(first, last);
-    if (n < 2) {
+    if (pool) {
+        parallel_for_each(first, last, std::move(op), *pool);
+    } else {
         std::for_each(first, last, std::move(op));
     }
-    std::vector<std::future<void>> futures(n - 1);
-    std::transform(first, std::prev(last), std::begin(futures),
-                   [&op, &pool] (auto& value) {
-                       return pool.try_push([&] () { return op(value); });
-                   });
-    // run last input in calling thread
-    op(*std::prev(last));
-    for (auto& f : futures) f.get();
 }
 
-} // namespace detail
-
 template <typename InputIt,
           typename UnaryOp>
 void for_each(InputIt first, InputIt last, UnaryOp op, ThreadPool& pool)
 {
-    if (pool.size() > 1) {
-        detail::for_each(first, last, std::move(op), pool);
-    } else {
-        std::for_each(first, last, std::move(op));
-    }
+    parallel_for_each(first, last, std::move(op), pool);
 }
 
 template <typename InputIt,
           typename UnaryOp>
 void for_each(InputIt first, InputIt last, UnaryOp op, boost::optional<ThreadPool&> pool)
+{
+    parallel_for_each(first, last, std::move(op), pool);
+}
+
+// parallel_reduce
+//
+// reduce_op must be associative, as partial results are computed per chunk and then combined in
+// input order. The result is therefore not generally bitwise identical to a sequential reduction
+// for floating point types.
+
+template <typename InputIt,
+          typename T,
+          typename BinaryOp,
+          typename UnaryOp>
+T parallel_transform_reduce(InputIt first, InputIt last, T init, BinaryOp reduce_op, UnaryOp transform_op, ThreadPool& pool)
+{
+    return detail::parallel_transform_reduce(first, last, std::move(init), std::move(reduce_op), std::move(transform_op), pool,
+                                             typename std::iterator_traits<InputIt>::iterator_category {});
+}
+
+template <typename InputIt,
+          typename T,
+          typename BinaryOp,
+          typename UnaryOp>
+T parallel_transform_reduce(InputIt first, InputIt last, T init, BinaryOp reduce_op, UnaryOp transform_op,
+                            boost::optional<ThreadPool&> pool)
 {
     if (pool) {
-        for_each(first, last, std::move(op), *pool);
+        return parallel_transform_reduce(first, last, std::move(init), std::move(reduce_op), std::move(transform_op), *pool);
     } else {
-        std::for_each(first, last, std::move(op));
+        for (; first != last; ++first) init = reduce_op(std::move(init), transform_op(*first));
+        return init;
     }
 }
 
+template <typename InputIt,
+          typename T,
+          typename BinaryOp>
+T parallel_reduce(InputIt first, InputIt last, T init, BinaryOp reduce_op, ThreadPool& pool)
+{
+    return parallel_transform_reduce(first, last, std::move(init), std::move(reduce_op), detail::Identity {}, pool);
+}
+
+template <typename InputIt,
+          typename T,
+          typename BinaryOp>
+T parallel_reduce(InputIt first, InputIt last, T init, BinaryOp reduce_op, boost::optional<ThreadPool&> pool)
+{
+    return parallel_transform_reduce(first, last, std::move(init), std::move(reduce_op), detail::Identity {}, pool);
+}
+
 } // namespace octopus
 
 #endif
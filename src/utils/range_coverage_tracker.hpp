@@ -0,0 +1,410 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef range_coverage_tracker_hpp
+#define range_coverage_tracker_hpp
+
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <type_traits>
+#include <stdexcept>
+#include <cassert>
+
+#include <boost/optional.hpp>
+
+#include "concepts/mappable.hpp"
+#include "coverage_tracker.hpp"
+#include "maths.hpp"
+
+namespace octopus {
+
+/**
+ RangeCoverageTracker has the same interface as CoverageTracker but is optimised for adding many
+ long mappables (e.g. reads at high depth) and then querying many regions.
+
+ Adding a mappable is O(1): only the coverage changes at its ends are recorded. The depths, their
+ prefix sums, and block sparse tables of depth minima and maxima are built on the first query
+ after an add, so sum, mean, min, and max are then answered in (near) constant time per region.
+ As queries may build this index, const methods must not be called concurrently until the index
+ is built; calling index() does this explicitly.
+ */
+template <typename Region, typename T = unsigned>
+class RangeCoverageTracker
+{
+public:
+    using RegionType = Region;
+    using DepthType  = T;
+
+    static_assert(std::is_unsigned<T>::value, "RangeCoverageTracker requires an unsigned depth type");
+
+    RangeCoverageTracker() = default;
+
+    RangeCoverageTracker(const RangeCoverageTracker&)            = default;
+    RangeCoverageTracker& operator=(const RangeCoverageTracker&) = default;
+    RangeCoverageTracker(RangeCoverageTracker&&)                 = default;
+    RangeCoverageTracker& operator=(RangeCoverageTracker&&)      = default;
+
+    ~RangeCoverageTracker() = default;
+
+    template <typename MappableType>
+    void add(const MappableType& mappable);
+    template <typename MappableType>
+    void add(const MappableType& mappable, DepthType count); // as if mappable were added count times
+
+    bool any() const noexcept;
+    bool any(const Region& region) const noexcept;
+
+    std::size_t sum() const noexcept;
+    std::size_t sum(const Region& region) const noexcept;
+
+    DepthType max() const noexcept;
+    DepthType max(const Region& region) const noexcept;
+
+    DepthType min() const noexcept;
+    DepthType min(const Region& region) const noexcept;
+
+    double mean() const noexcept;
+    double mean(const Region& region) const noexcept;
+
+    double stdev() const noexcept;
+    double stdev(const Region& region) const noexcept;
+
+    double median() const;
+    double median(const Region& region) const;
+
+    template <typename OutputIt>
+    OutputIt get(const Region& region, OutputIt result) const;
+    std::vector<DepthType> get(const Region& region) const;
+
+    boost::optional<Region> encompassing_region() const;
+    bool is_empty() const noexcept;
+    std::size_t num_tracked() const noexcept;
+    void clear() noexcept;
+
+    void index() const;
+
+private:
+    static constexpr std::size_t block_size_ = 64;
+
+    using SparseTable = std::vector<std::vector<DepthType>>;
+
+    // Coverage changes, with depth[i] = deltas_[0] + ... + deltas_[i] in modular arithmetic
+    std::deque<DepthType> deltas_ = {};
+    Region encompassing_region_;
+    std::size_t num_tracked_ = 0;
+
+    mutable bool is_indexed_ = true;
+    mutable std::vector<DepthType> coverage_ = {};
+    mutable std::vector<std::size_t> prefix_sums_ = {};
+    mutable SparseTable block_mins_ = {}, block_maxs_ = {};
+
+    using Iterator     = typename std::vector<DepthType>::const_iterator;
+    using IteratorPair = std::pair<Iterator, Iterator>;
+
+    void do_add(const Region& region, DepthType count);
+    std::pair<std::size_t, std::size_t> index_range(const Region& region) const;
+    IteratorPair range(const Region& region) const;
+    template <typename Compare>
+    DepthType select(std::size_t first, std::size_t last, const SparseTable& table, Compare cmp) const noexcept;
+};
+
+// public methods
+
+template <typename Region, typename T>
+template <typename MappableType>
+void RangeCoverageTracker<Region, T>::add(const MappableType& mappable)
+{
+    static_assert(is_region_or_mappable<MappableType>, "MappableType not Mappable");
+    do_add(mapped_region(mappable), 1);
+}
+
+template <typename Region, typename T>
+template <typename MappableType>
+void RangeCoverageTracker<Region, T>::add(const MappableType& mappable, const DepthType count)
+{
+    static_assert(is_region_or_mappable<MappableType>, "MappableType not Mappable");
+    if (count > 0) do_add(mapped_region(mappable), count);
+}
+
+template <typename Region, typename T>
+bool RangeCoverageTracker<Region, T>::any() const noexcept
+{
+    return max() > 0;
+}
+
+template <typename Region, typename T>
+bool RangeCoverageTracker<Region, T>::any(const Region& region) const noexcept
+{
+    return max(region) > 0;
+}
+
+template <typename Region, typename T>
+std::size_t RangeCoverageTracker<Region, T>::sum() const noexcept
+{
+    index();
+    return prefix_sums_.empty() ? 0 : prefix_sums_.back();
+}
+
+template <typename Region, typename T>
+std::size_t RangeCoverageTracker<Region, T>::sum(const Region& region) const noexcept
+{
+    if (octopus::is_empty(region)) return 0;
+    const auto p = index_range(region);
+    return prefix_sums_[p.second] - prefix_sums_[p.first];
+}
+
+template <typename Region, typename T>
+T RangeCoverageTracker<Region, T>::max() const noexcept
+{
+    index();
+    return select(0, coverage_.size(), block_maxs_, std::greater<> {});
+}
+
+template <typename Region, typename T>
+T RangeCoverageTracker<Region, T>::max(const Region& region) const noexcept
+{
+    if (octopus::is_empty(region)) return 0;
+    const auto p = index_range(region);
+    return select(p.first, p.second, block_maxs_, std::greater<> {});
+}
+
+template <typename Region, typename T>
+T RangeCoverageTracker<Region, T>::min() const noexcept
+{
+    index();
+    return select(0, coverage_.size(), block_mins_, std::less<> {});
+}
+
+template <typename Region, typename T>
+T RangeCoverageTracker<Region, T>::min(const Region& region) const noexcept
+{
+    if (octopus::is_empty(region)) return 0;
+    const auto p = index_range(region);
+    return select(p.first, p.second, block_mins_, std::less<> {});
+}
+
+template <typename Region, typename T>
+double RangeCoverageTracker<Region, T>::mean() const noexcept
+{
+    index();
+    if (coverage_.empty()) return 0;
+    return static_cast<double>(sum()) / coverage_.size();
+}
+
+template <typename Region, typename T>
+double RangeCoverageTracker<Region, T>::mean(const Region& region) const noexcept
+{
+    if (octopus::is_empty(region)) return 0;
+    const auto p = index_range(region);
+    if (p.first == p.second) return 0;
+    return static_cast<double>(prefix_sums_[p.second] - prefix_sums_[p.first]) / (p.second - p.first);
+}
+
+template <typename Region, typename T>
+double RangeCoverageTracker<Region, T>::stdev() const noexcept
+{
+    index();
+    if (coverage_.empty()) return 0;
+    return maths::stdev(coverage_);
+}
+
+template <typename Region, typename T>
+double RangeCoverageTracker<Region, T>::stdev(const Region& region) const noexcept
+{
+    if (octopus::is_empty(region)) return 0;
+    const auto p = range(region);
+    if (p.first == p.second) return 0;
+    return maths::stdev(p.first, p.second);
+}
+
+template <typename Region, typename T>
+double RangeCoverageTracker<Region, T>::median() const
+{
+    index();
+    if (coverage_.empty()) return 0;
+    return maths::median(coverage_);
+}
+
+template <typename Region, typename T>
+double RangeCoverageTracker<Region, T>::median(const Region& region) const
+{
+    auto range_coverage = this->get(region);
+    if (range_coverage.empty()) return 0;
+    return maths::median(range_coverage);
+}
+
+template <typename Region, typename T>
+template <typename OutputIt>
+OutputIt RangeCoverageTracker<Region, T>::get(const Region& region, OutputIt result) const
+{
+    index();
+    if (coverage_.empty() || !overlaps(region, encompassing_region_)) {
+        return std::fill_n(result, size(region), 0);
+    }
+    const auto p = range(region);
+    if (contains(encompassing_region_, region)) {
+        return std::copy(p.first, p.second, result);
+    } else {
+        using D = typename Region::Distance;
+        const auto lhs_pad = std::max(begin_distance(region, encompassing_region_), D {0});
+        result = std::fill_n(result, lhs_pad, 0);
+        result = std::copy(p.first, p.second, result);
+        const auto rhs_pad = std::max(end_distance(encompassing_region_, region), D {0});
+        return std::fill_n(result, rhs_pad, 0);
+    }
+}
+
+template <typename Region, typename T>
+std::vector<T> RangeCoverageTracker<Region, T>::get(const Region& region) const
+{
+    std::vector<T> result(size(region));
+    this->get(region, std::begin(result));
+    return result;
+}
+
+template <typename Region, typename T>
+boost::optional<Region> RangeCoverageTracker<Region, T>::encompassing_region() const
+{
+    if (!is_empty()) {
+        return encompassing_region_;
+    } else {
+        return boost::none;
+    }
+}
+
+template <typename Region, typename T>
+bool RangeCoverageTracker<Region, T>::is_empty() const noexcept
+{
+    return num_tracked_ == 0;
+}
+
+template <typename Region, typename T>
+std::size_t RangeCoverageTracker<Region, T>::num_tracked() const noexcept
+{
+    return num_tracked_;
+}
+
+template <typename Region, typename T>
+void RangeCoverageTracker<Region, T>::clear() noexcept
+{
+    deltas_.clear();
+    deltas_.shrink_to_fit();
+    num_tracked_ = 0;
+    coverage_.clear();
+    coverage_.shrink_to_fit();
+    prefix_sums_.clear();
+    prefix_sums_.shrink_to_fit();
+    block_mins_.clear();
+    block_maxs_.clear();
+    is_indexed_ = true;
+}
+
+template <typename Region, typename T>
+void RangeCoverageTracker<Region, T>::index() const
+{
+    if (is_indexed_) return;
+    const auto n = deltas_.size() - 1; // the last delta is past the encompassing region
+    coverage_.resize(n);
+    std::partial_sum(std::cbegin(deltas_), std::prev(std::cend(deltas_)), std::begin(coverage_));
+    prefix_sums_.resize(n + 1);
+    prefix_sums_[0] = 0;
+    std::partial_sum(std::cbegin(coverage_), std::cend(coverage_), std::next(std::begin(prefix_sums_)),
+                     [] (std::size_t total, DepthType depth) { return total + depth; });
+    const auto num_blocks = (n + block_size_ - 1) / block_size_;
+    const auto build = [&] (SparseTable& table, auto cmp) {
+        table.assign(1, std::vector<DepthType>(num_blocks));
+        for (std::size_t block {0}; block < num_blocks; ++block) {
+            const auto first = std::next(std::cbegin(coverage_), block * block_size_);
+            const auto last = std::next(std::cbegin(coverage_), std::min((block + 1) * block_size_, n));
+            table[0][block] = *std::min_element(first, last, cmp);
+        }
+        for (std::size_t width {2}; width <= num_blocks; width *= 2) {
+            const auto& prev = table.back();
+            std::vector<DepthType> level(num_blocks - width + 1);
+            for (std::size_t block {0}; block < level.size(); ++block) {
+                level[block] = std::min(prev[block], prev[block + width / 2], cmp);
+            }
+            table.push_back(std::move(level));
+        }
+    };
+    build(block_mins_, std::less<> {});
+    build(block_maxs_, std::greater<> {});
+    is_indexed_ = true;
+}
+
+// private methods
+
+template <typename Region, typename T>
+void RangeCoverageTracker<Region, T>::do_add(const Region& region, const DepthType count)
+{
+    if (octopus::is_empty(region)) return;
+    if (num_tracked_ == 0) {
+        deltas_.assign(size(region) + 1, 0);
+        encompassing_region_ = region;
+    } else {
+        if (!detail::is_same_contig_helper(region, encompassing_region_)) {
+            throw std::runtime_error {"RangeCoverageTracker: contig mismatch"};
+        }
+        if (begins_before(region, encompassing_region_)) {
+            deltas_.insert(std::cbegin(deltas_), left_overhang_size(region, encompassing_region_), 0);
+        }
+        if (ends_before(encompassing_region_, region)) {
+            deltas_.insert(std::cend(deltas_), right_overhang_size(region, encompassing_region_), 0);
+        }
+        encompassing_region_ = octopus::encompassing_region(encompassing_region_, region);
+    }
+    const auto first = static_cast<std::size_t>(begin_distance(encompassing_region_, region));
+    assert(first + size(region) < deltas_.size());
+    deltas_[first] += count;
+    deltas_[first + size(region)] -= count;
+    num_tracked_ += count;
+    is_indexed_ = false;
+}
+
+template <typename Region, typename T>
+std::pair<std::size_t, std::size_t> RangeCoverageTracker<Region, T>::index_range(const Region& region) const
+{
+    index();
+    if (coverage_.empty() || !overlaps(region, encompassing_region_)) return {0, 0};
+    std::size_t first {0};
+    if (begins_before(encompassing_region_, region)) {
+        first = begin_distance(encompassing_region_, region);
+    }
+    return {first, first + overlap_size(region, encompassing_region_)};
+}
+
+template <typename Region, typename T>
+typename RangeCoverageTracker<Region, T>::IteratorPair RangeCoverageTracker<Region, T>::range(const Region& region) const
+{
+    const auto p = index_range(region);
+    return {std::next(std::cbegin(coverage_), p.first), std::next(std::cbegin(coverage_), p.second)};
+}
+
+template <typename Region, typename T>
+template <typename Compare>
+T RangeCoverageTracker<Region, T>::select(const std::size_t first, const std::size_t last, const SparseTable& table,
+                                          Compare cmp) const noexcept
+{
+    if (first == last) return 0;
+    const auto first_full_block = (first + block_size_ - 1) / block_size_, last_full_block = last / block_size_;
+    const auto scan = [&] (std::size_t lhs, std::size_t rhs) {
+        return *std::min_element(std::next(std::cbegin(coverage_), lhs), std::next(std::cbegin(coverage_), rhs), cmp);
+    };
+    if (first_full_block >= last_full_block) return scan(first, last);
+    std::size_t level {0};
+    while ((std::size_t {2} << level) <= last_full_block - first_full_block) ++level;
+    auto result = std::min(table[level][first_full_block], table[level][last_full_block - (std::size_t {1} << level)], cmp);
+    if (first < first_full_block * block_size_) result = std::min(result, scan(first, first_full_block * block_size_), cmp);
+    if (last_full_block * block_size_ < last) result = std::min(result, scan(last_full_block * block_size_, last), cmp);
+    return result;
+}
+
+} // namespace octopus
+
+#endif
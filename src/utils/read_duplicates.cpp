@@ -3,6 +3,10 @@
 
 #include "read_duplicates.hpp"
 
+#include <algorithm>
+#include <numeric>
+#include <array>
+#include <iterator>
 #include <cassert>
 
 namespace octopus {
@@ -35,6 +39,17 @@ bool next_segments_are_duplicates(const AlignedRead& lhs, const AlignedRead& rhs
 
 } // namespace
 
+bool have_same_molecular_identifier(const AlignedRead& lhs, const AlignedRead& rhs) noexcept
+{
+    static constexpr AlignedRead::Tag miTag {'M','I'}, rxTag {'R','X'};
+    for (const auto& tag : {miTag, rxTag}) {
+        const auto lhs_id = lhs.annotation(tag);
+        const auto rhs_id = rhs.annotation(tag);
+        if (lhs_id && rhs_id) return *lhs_id == *rhs_id;
+    }
+    return true;
+}
+
 bool FivePrimeDuplicateDefinition::unpaired_equal(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept
 {
     return are_same_strand(lhs, rhs)
@@ -63,12 +78,112 @@ bool FivePrimeAndCigarDuplicateDefinition::paired_equal(const AlignedRead& lhs,
 
 namespace detail {
 
-bool NextSegmentLess::operator()(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept
+namespace {
+
+std::uint64_t mix(std::uint64_t x) noexcept
 {
-    assert(lhs.has_other_segment() && rhs.has_other_segment());
-    return lhs.next_segment().inferred_template_length() < rhs.next_segment().inferred_template_length();
+    // splitmix64 finaliser
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27; x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
 }
 
 } // namespace
 
+std::uint64_t duplicate_key(const AlignedRead& read) noexcept
+{
+    // bits 0-31: 5' position, 32: strand, 33: has next segment, 34: next unmapped, 35: next reverse,
+    // 36-63: a hash of the inferred template length
+    std::uint64_t result {static_cast<std::uint32_t>(five_prime_mapping_position(read))};
+    if (is_reverse_strand(read)) result |= 1ull << 32;
+    if (read.has_other_segment()) {
+        const auto& next = read.next_segment();
+        result |= 1ull << 33;
+        if (next.is_marked_unmapped()) result |= 1ull << 34;
+        if (next.is_marked_reverse_mapped()) result |= 1ull << 35;
+        result |= mix(next.inferred_template_length()) << 36;
+    }
+    return result;
+}
+
+ReadKeyTable::ReadKeyTable(const std::size_t expected_size)
+{
+    std::size_t capacity {16};
+    while (capacity < 2 * expected_size) capacity *= 2;
+    slots_.assign(capacity, Slot {0, 0, false});
+    occupied_.reserve(expected_size);
+}
+
+void ReadKeyTable::clear() noexcept
+{
+    for (const auto idx : occupied_) slots_[idx].occupied = false;
+    occupied_.clear();
+}
+
+std::size_t ReadKeyTable::index(const std::uint64_t key) const noexcept
+{
+    return static_cast<std::size_t>(mix(key)) & (slots_.size() - 1);
+}
+
+void ReadKeyTable::grow()
+{
+    std::vector<Slot> old_slots(std::max(std::size_t {16}, 2 * slots_.size()), Slot {0, 0, false});
+    std::swap(slots_, old_slots);
+    occupied_.clear();
+    const auto mask = slots_.size() - 1;
+    for (const auto& slot : old_slots) {
+        if (!slot.occupied) continue;
+        auto idx = index(slot.key);
+        while (slots_[idx].occupied) idx = (idx + 1) & mask;
+        slots_[idx] = slot;
+        occupied_.push_back(idx);
+    }
+}
+
+bool can_merge_duplicates(const AlignedRead& lhs, const AlignedRead& rhs) noexcept
+{
+    return lhs.mapped_region() == rhs.mapped_region() && lhs.cigar() == rhs.cigar()
+        && lhs.sequence().size() == rhs.sequence().size()
+        && lhs.base_qualities().size() == rhs.base_qualities().size();
+}
+
+namespace {
+
+std::size_t base_index(const char base) noexcept
+{
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return 4;
+    }
+}
+
+} // namespace
+
+void merge_duplicates(AlignedRead& read, const std::vector<std::reference_wrapper<const AlignedRead>>& duplicates,
+                      const AlignedRead::BaseQuality max_quality)
+{
+    static constexpr std::array<char, 5> bases {'A', 'C', 'G', 'T', 'N'};
+    auto& sequence = read.sequence();
+    auto& qualities = read.base_qualities();
+    for (std::size_t i {0}; i < sequence.size(); ++i) {
+        std::array<unsigned, 5> totals {};
+        totals[base_index(sequence[i])] += qualities[i];
+        for (const AlignedRead& duplicate : duplicates) {
+            totals[base_index(duplicate.sequence()[i])] += duplicate.base_qualities()[i];
+        }
+        totals[4] = 0; // unknown bases never win and are no evidence against the consensus
+        const auto best = std::distance(std::cbegin(totals), std::max_element(std::cbegin(totals), std::cend(totals)));
+        if (totals[best] == 0) continue;
+        const auto total = std::accumulate(std::cbegin(totals), std::cend(totals), 0u);
+        const auto disagreement = total - totals[best];
+        sequence[i] = bases[best];
+        qualities[i] = totals[best] > disagreement ? std::min<unsigned>(totals[best] - disagreement, max_quality) : 0;
+    }
+}
+
+} // namespace detail
+
 } // namespace octopus
@@ -8,6 +8,10 @@
 #include <algorithm>
 #include <vector>
 #include <map>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
 
 #include "basics/aligned_read.hpp"
 #include "basics/aligned_template.hpp"
@@ -27,55 +31,122 @@ struct FivePrimeAndCigarDuplicateDefinition
     bool paired_equal(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept;
 };
 
-namespace detail {
-	
-template <typename Range, typename DuplicateDefinition>
-auto find_duplicate(const AlignedRead& read, const Range& reads, const DuplicateDefinition& dup_def) noexcept
+// Reads that both have a molecular identifier (the MI tag, or the RX UMI tag if either read has no
+// MI tag) must have the same identifier to be duplicates. Reads lacking identifiers are compared with
+// the wrapped definition alone.
+template <typename DuplicateDefinition>
+struct MolecularIdentifierDuplicateDefinition
+{
+    DuplicateDefinition definition;
+    bool unpaired_equal(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept;
+    bool paired_equal(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept;
+};
+
+bool have_same_molecular_identifier(const AlignedRead& lhs, const AlignedRead& rhs) noexcept;
+
+template <typename DuplicateDefinition>
+bool MolecularIdentifierDuplicateDefinition<DuplicateDefinition>::unpaired_equal(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept
+{
+    return definition.unpaired_equal(lhs, rhs) && have_same_molecular_identifier(lhs, rhs);
+}
+
+template <typename DuplicateDefinition>
+bool MolecularIdentifierDuplicateDefinition<DuplicateDefinition>::paired_equal(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept
 {
-	return std::find_if(std::begin(reads), std::end(reads), [&] (auto other_itr) { return dup_def.paired_equal(read, *other_itr); });
+    return definition.paired_equal(lhs, rhs) && have_same_molecular_identifier(lhs, rhs);
 }
 
-struct NextSegmentLess
+namespace detail {
+
+// Packs the 5' mapping position, strand and next segment summary of a read into a key. Reads that
+// are duplicates under any of the duplicate definitions above have equal keys, but equal keys do
+// not imply duplicates, so candidates must still be compared with the definition.
+std::uint64_t duplicate_key(const AlignedRead& read) noexcept;
+
+// A linear probing hash table from read keys to small integer values (e.g. group indices). Because
+// keys may collide, lookups take a predicate to decide whether a stored value really matches.
+class ReadKeyTable
 {
-    bool operator()(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept;
+public:
+    using Value = std::size_t;
+
+    ReadKeyTable() = default;
+    ReadKeyTable(std::size_t expected_size);
+
+    ReadKeyTable(const ReadKeyTable&)            = default;
+    ReadKeyTable& operator=(const ReadKeyTable&) = default;
+    ReadKeyTable(ReadKeyTable&&)                 = default;
+    ReadKeyTable& operator=(ReadKeyTable&&)      = default;
+
+    ~ReadKeyTable() = default;
+
+    // Returns the stored value with an equal key for which is_match(value) is true, or
+    // inserts and returns value if there is none. The bool is true if value was inserted.
+    template <typename UnaryPredicate>
+    std::pair<Value, bool> find_or_insert(std::uint64_t key, Value value, UnaryPredicate is_match);
+
+    void clear() noexcept; // in the number of stored values
+
+private:
+    struct Slot
+    {
+        std::uint64_t key;
+        Value value;
+        bool occupied;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<std::size_t> occupied_;
+
+    std::size_t index(std::uint64_t key) const noexcept;
+    void grow();
 };
 
+template <typename UnaryPredicate>
+std::pair<ReadKeyTable::Value, bool>
+ReadKeyTable::find_or_insert(const std::uint64_t key, const Value value, UnaryPredicate is_match)
+{
+    if (2 * (occupied_.size() + 1) > slots_.size()) grow();
+    const auto mask = slots_.size() - 1;
+    for (auto idx = index(key);; idx = (idx + 1) & mask) {
+        auto& slot = slots_[idx];
+        if (!slot.occupied) {
+            slot = Slot {key, value, true};
+            occupied_.push_back(idx);
+            return {value, true};
+        }
+        if (slot.key == key && is_match(slot.value)) {
+            return {slot.value, false};
+        }
+    }
+}
+
 } // namespace detail
 
+// Groups reads with other segments that are duplicates under the given definition. Each group is
+// in input order, and the groups are ordered by their first read. Reads are hashed by their
+// duplicate_key, so a single pass finds duplicates that are not adjacent in the input.
 template <typename ForwardIt,
           typename DuplicateDefinition>
 std::vector<std::vector<ForwardIt>>
 find_duplicate_reads(ForwardIt first, const ForwardIt last,
                      const DuplicateDefinition& duplicate_definition)
 {
-    std::vector<std::vector<ForwardIt>> result {};
-    std::vector<ForwardIt> buffer {};
-    // Recall that reads come sorted w.r.t operator< and it is therefore not guaranteed that 'duplicate'
-    // reads (according to IsDuplicate) will be adjacent to one another. In particular, operator< only
-    // guarantees that duplicate read segment described in the AlignedRead object will be adjacent.
-    const auto are_primary_dups = [&] (const auto& lhs, const auto& rhs) { return duplicate_definition.unpaired_equal(lhs, rhs); };
-    for (first = std::adjacent_find(first, last, are_primary_dups); first != last; first = std::adjacent_find(first, last, are_primary_dups)) {
-        buffer.reserve(8);
-        if (first->has_other_segment()) buffer.push_back(first);
-        if (std::next(first)->has_other_segment()) buffer.push_back(std::next(first));
-        const AlignedRead& primary_dup_read {*first};
-        std::advance(first, 2);
-        for (; first != last && are_primary_dups(*first, primary_dup_read); ++first) {
-            if (first->has_other_segment()) buffer.push_back(first);
-        }
-        std::sort(buffer.begin(), buffer.end(), [] (ForwardIt lhs, ForwardIt rhs) { return detail::NextSegmentLess{}(*lhs, *rhs); });
-        const auto are_duplicates = [&] (ForwardIt lhs, ForwardIt rhs) { return duplicate_definition.paired_equal(*lhs, *rhs); };
-        for (auto dup_itr = std::adjacent_find(buffer.cbegin(), buffer.cend(), are_duplicates); dup_itr != buffer.cend();
-                 dup_itr = std::adjacent_find(dup_itr, buffer.cend(), are_duplicates)) {
-            std::vector<ForwardIt> duplicates {dup_itr, std::next(dup_itr, 2)};
-            const AlignedRead& duplicate_read {**dup_itr};
-            std::advance(dup_itr, 2);
-            for (; dup_itr != buffer.cend() && duplicate_definition.paired_equal(**dup_itr, duplicate_read); ++dup_itr) {
-                duplicates.push_back(*dup_itr);
-            }
-            result.push_back(std::move(duplicates));
+    std::vector<std::vector<ForwardIt>> groups {};
+    detail::ReadKeyTable groups_table {static_cast<std::size_t>(std::distance(first, last))};
+    for (; first != last; ++first) {
+        if (!first->has_other_segment()) continue;
+        const auto is_duplicate = [&] (const std::size_t group_idx) { return duplicate_definition.paired_equal(*groups[group_idx].front(), *first); };
+        const auto p = groups_table.find_or_insert(detail::duplicate_key(*first), groups.size(), is_duplicate);
+        if (p.second) {
+            groups.push_back({first});
+        } else {
+            groups[p.first].push_back(first);
         }
-        buffer.clear();
+    }
+    std::vector<std::vector<ForwardIt>> result {};
+    for (auto& group : groups) {
+        if (group.size() > 1) result.push_back(std::move(group));
     }
     return result;
 }
@@ -89,6 +160,64 @@ find_duplicate_reads(ForwardIt first, const ForwardIt last)
 
 namespace detail {
 
+bool can_merge_duplicates(const AlignedRead& lhs, const AlignedRead& rhs) noexcept;
+
+// Replaces the bases and qualities of read with the consensus of read and duplicates. Each consensus
+// base is the base with the greatest total quality, and its quality is that total less the total
+// quality of the disagreeing bases, capped at max_quality.
+void merge_duplicates(AlignedRead& read, const std::vector<std::reference_wrapper<const AlignedRead>>& duplicates,
+                      AlignedRead::BaseQuality max_quality);
+
+} // namespace detail
+
+// Merges each family of duplicate reads (see find_duplicate_reads) into a single consensus read and
+// removes the merged reads, keeping the input order of the remaining reads. Each family is split by
+// molecular identifier where reads have one. The read with the smallest name in each family is kept
+// so that the families of both template segments keep the same template. Only duplicates with the
+// same alignment as the kept read are merged; any others are left in place.
+template <typename ForwardIt,
+          typename DuplicateDefinition>
+ForwardIt
+collapse_duplicate_reads(ForwardIt first, const ForwardIt last,
+                         const DuplicateDefinition& duplicate_definition,
+                         const AlignedRead::BaseQuality max_quality = 60)
+{
+    const MolecularIdentifierDuplicateDefinition<DuplicateDefinition> family_definition {duplicate_definition};
+    const auto families = find_duplicate_reads(first, last, family_definition);
+    if (families.empty()) return last;
+    std::vector<bool> merged(std::distance(first, last), false);
+    std::vector<std::reference_wrapper<const AlignedRead>> duplicates {};
+    for (const auto& family : families) {
+        const auto kept = *std::min_element(std::cbegin(family), std::cend(family),
+                                            [] (const auto& lhs, const auto& rhs) { return lhs->name() < rhs->name(); });
+        duplicates.clear();
+        for (const auto& read_itr : family) {
+            if (read_itr != kept && detail::can_merge_duplicates(*kept, *read_itr)) {
+                duplicates.emplace_back(*read_itr);
+                merged[std::distance(first, read_itr)] = true;
+            }
+        }
+        if (!duplicates.empty()) detail::merge_duplicates(*kept, duplicates, max_quality);
+    }
+    auto result = first;
+    for (std::size_t idx {0}; first != last; ++first, ++idx) {
+        if (!merged[idx]) {
+            if (result != first) *result = std::move(*first);
+            ++result;
+        }
+    }
+    return result;
+}
+
+template <typename ForwardIt>
+ForwardIt
+collapse_duplicate_reads(ForwardIt first, const ForwardIt last)
+{
+    return collapse_duplicate_reads(first, last, FivePrimeAndCigarDuplicateDefinition {});
+}
+
+namespace detail {
+
 template <typename AlignedReadIterator>
 struct AlignedReadIteratorNameLess
 {
@@ -109,22 +238,31 @@ remove_duplicate_reads(ForwardIt first, ForwardIt last,
                        const BinaryPredicate duplicate_compare,
                        const DuplicateDefinition& duplicate_definition)
 {
-    // See comment in 'find_duplicates'
+    // Recall that reads come sorted w.r.t operator< and it is therefore not guaranteed that 'duplicate'
+    // reads (according to IsDuplicate) will be adjacent to one another. In particular, operator< only
+    // guarantees that duplicate read segment described in the AlignedRead object will be adjacent.
     const auto are_primary_dups = [&] (const auto& lhs, const auto& rhs) { return duplicate_definition.unpaired_equal(lhs, rhs); };
     first = std::adjacent_find(first, last, are_primary_dups);
     if (first != last) {
-        std::vector<ForwardIt> candidate_duplicates {first++};
+        std::vector<ForwardIt> candidate_duplicates {first};
+        detail::ReadKeyTable candidates_table {};
+        const auto find_or_insert_candidate = [&] (const AlignedRead& read, const std::size_t candidate_idx) {
+            const auto is_duplicate = [&] (const std::size_t idx) { return duplicate_definition.paired_equal(read, *candidate_duplicates[idx]); };
+            return candidates_table.find_or_insert(detail::duplicate_key(read), candidate_idx, is_duplicate);
+        };
+        find_or_insert_candidate(*first++, 0);
 		using DuplicatePairedReadMap = std::map<ForwardIt, std::vector<AlignedRead>, detail::AlignedReadIteratorNameLess<ForwardIt>>;
 		DuplicatePairedReadMap paired_duplicates {}, working_paired_duplicates {};
         candidate_duplicates.reserve(100);
         for (auto read_itr = first; read_itr != last; ++read_itr) {
 			AlignedRead& read {*read_itr};
             if (are_primary_dups(read, *candidate_duplicates.front())) { // can check any candidate
-				const auto duplicate_itr = detail::find_duplicate(read, candidate_duplicates, duplicate_definition);
-                if (duplicate_itr == std::end(candidate_duplicates)) { // read may not be a duplicate
+				const auto candidate = find_or_insert_candidate(read, candidate_duplicates.size());
+                if (candidate.second) { // read may not be a duplicate
                     if (read_itr != first) *first = std::move(read);
                     candidate_duplicates.emplace_back(first++);
                 } else { // read is a duplicate
+                    const auto duplicate_itr = std::next(std::cbegin(candidate_duplicates), candidate.first);
 					const ForwardIt curr_best_duplicate_itr {*duplicate_itr};
 					if (duplicate_compare(*curr_best_duplicate_itr, read)) {
 						// swap duplicates
@@ -151,7 +289,9 @@ remove_duplicate_reads(ForwardIt first, ForwardIt last,
                 }
             } else {
                 if (read_itr != first) *first = std::move(read);
-                candidate_duplicates.assign({first++});
+                candidate_duplicates.assign({first});
+                candidates_table.clear();
+                find_or_insert_candidate(*first++, 0);
 				for (auto& p : working_paired_duplicates) {
 					auto mate_itr = paired_duplicates.find(*p.first);
 					if (mate_itr != std::cend(paired_duplicates)) {
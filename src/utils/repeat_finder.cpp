@@ -3,13 +3,91 @@
 
 #include "repeat_finder.hpp"
 
+#include "io/reference/tandem_repeat_index.hpp"
+
 namespace octopus {
 
+namespace {
+
+bool is_complete(const io::TandemRepeatIndex& index, const unsigned max_period, const unsigned min_length) noexcept
+{
+    // Every repeat is at least two periods long
+    return index.max_period() >= max_period && index.min_length() <= std::max(min_length, 2u);
+}
+
+// tandem::extract_exact_tandem_repeats can report parts of a repeat as well as the whole repeat, so
+// repeats with the same period overlapping by at least a period are merged, as in the index
+void merge_overlapping_repeats(std::vector<TandemRepeat>& repeats, const unsigned max_period)
+{
+    std::sort(std::begin(repeats), std::end(repeats), [] (const TandemRepeat& lhs, const TandemRepeat& rhs) {
+        return mapped_begin(lhs) == mapped_begin(rhs) ? mapped_end(lhs) > mapped_end(rhs) : mapped_begin(lhs) < mapped_begin(rhs);
+    });
+    std::vector<std::size_t> last_repeat(max_period + 1, repeats.size());
+    std::size_t num_merged {0};
+    for (std::size_t i {0}; i < repeats.size(); ++i) {
+        const auto& repeat = repeats[i];
+        auto& last = last_repeat[repeat.period()];
+        if (last < num_merged && mapped_begin(repeat) + repeat.period() <= mapped_end(repeats[last])) {
+            if (mapped_end(repeat) > mapped_end(repeats[last])) {
+                repeats[last] = TandemRepeat {encompassing_region(repeats[last], repeat), repeats[last].motif()};
+            }
+        } else {
+            last = num_merged;
+            if (i != num_merged) repeats[num_merged] = std::move(repeats[i]);
+            ++num_merged;
+        }
+    }
+    repeats.erase(std::next(std::begin(repeats), num_merged), std::end(repeats));
+    std::sort(std::begin(repeats), std::end(repeats));
+}
+
+/*
+    A maximal repetition of a region's sequence is the part of a maximal repetition of the whole
+    contig, with the same period, that lies in the region, if that part is at least two periods long.
+    So indexed repeats are clipped to the region, and their motifs taken from the clipped start.
+ */
 std::vector<TandemRepeat>
-find_exact_tandem_repeats(const ReferenceGenome& reference, const GenomicRegion& region, unsigned max_period)
+find_indexed_tandem_repeats(const io::TandemRepeatIndex& index, const ReferenceGenome& reference,
+                            const GenomicRegion& region, const unsigned max_period, const unsigned min_length)
 {
+    const auto repeats = index.fetch(region);
+    std::vector<TandemRepeat> result {};
+    if (repeats.empty()) return result;
+    result.reserve(repeats.size());
+    const auto sequence = reference.fetch_sequence(region);
+    for (const auto& repeat : repeats) {
+        if (repeat.period > max_period) continue;
+        const auto begin = std::max<GenomicRegion::Position>(repeat.begin, region.begin());
+        const auto end = std::min<GenomicRegion::Position>(repeat.end, region.end());
+        if (end - begin < std::max(2 * repeat.period, min_length)) continue;
+        const auto motif_begin = std::next(std::cbegin(sequence), begin - region.begin());
+        result.emplace_back(GenomicRegion {region.contig_name(), begin, end},
+                            TandemRepeat::NucleotideSequence {motif_begin, std::next(motif_begin, repeat.period)});
+    }
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+} // namespace
+
+std::vector<TandemRepeat>
+find_exact_tandem_repeats(const ReferenceGenome& reference, const GenomicRegion& region, const unsigned max_period,
+                          const unsigned min_length)
+{
+    const auto index = reference.tandem_repeat_index();
+    if (index && is_complete(*index, max_period, min_length)) {
+        return find_indexed_tandem_repeats(*index, reference, region, max_period, min_length);
+    }
     auto sequence = reference.fetch_sequence(region);
-    return find_exact_tandem_repeats(sequence, region, 1, max_period);
+    // As for the index, search one period further as some repeats with the maximum period are otherwise missed
+    auto result = find_exact_tandem_repeats(sequence, region, 1, max_period + 1);
+    result.erase(std::remove_if(std::begin(result), std::end(result),
+                                [=] (const auto& repeat) {
+                                    return repeat.period() > max_period || region_size(repeat) < min_length;
+                                }),
+                 std::end(result));
+    merge_overlapping_repeats(result, max_period);
+    return result;
 }
 
 bool is_good_seed(const TandemRepeat& repeat, const InexactRepeatDefinition& repeat_def) noexcept
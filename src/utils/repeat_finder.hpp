@@ -40,16 +40,23 @@ find_exact_tandem_repeats(SequenceType& sequence, const GenomicRegion& region,
     }
     auto n_shift_map = tandem::collapse(sequence, 'N');
     auto maximal_repetitions = tandem::extract_exact_tandem_repeats(sequence , min_period, max_period);
+    // Motifs must be taken from the collapsed sequence before the runs are rebased
+    std::vector<SequenceType> motifs {};
+    motifs.reserve(maximal_repetitions.size());
+    for (const auto& run : maximal_repetitions) {
+        motifs.emplace_back(std::next(std::cbegin(sequence), run.pos), std::next(std::cbegin(sequence), run.pos + run.period));
+    }
     tandem::rebase(maximal_repetitions, n_shift_map);
     n_shift_map.clear();
     std::vector<TandemRepeat> result {};
     result.reserve(maximal_repetitions.size());
     auto offset = region.begin();
-    for (const auto& run : maximal_repetitions) {
+    for (std::size_t i {0}; i < maximal_repetitions.size(); ++i) {
+        const auto& run = maximal_repetitions[i];
         result.emplace_back(GenomicRegion {region.contig_name(),
                                            static_cast<GenomicRegion::Size>(run.pos + offset),
                                            static_cast<GenomicRegion::Size>(run.pos + run.length + offset)
-        }, SequenceType {std::next(std::cbegin(sequence), run.pos), std::next(std::cbegin(sequence), run.pos + run.period)});
+        }, std::move(motifs[i]));
     }
     return result;
 }
@@ -63,8 +70,11 @@ find_exact_tandem_repeats(const SequenceType& sequence, const GenomicRegion& reg
     return find_exact_tandem_repeats(tmp, region, min_period, max_period);
 }
 
+// As above, but only repeats at least min_length long are returned. The reference's tandem repeat index is
+// used if it has all the repeats requested.
 std::vector<TandemRepeat>
-find_exact_tandem_repeats(const ReferenceGenome& reference, const GenomicRegion& region, unsigned max_period);
+find_exact_tandem_repeats(const ReferenceGenome& reference, const GenomicRegion& region, unsigned max_period,
+                          unsigned min_length = 0);
 
 std::vector<GenomicRegion>
 find_repeat_regions(const std::vector<TandemRepeat>& repeats, const GenomicRegion& region,
@@ -0,0 +1,298 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef simd_bytes_hpp
+#define simd_bytes_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SIMD_BYTES_AVX2
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+    #define SIMD_BYTES_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define SIMD_BYTES_NEON
+#endif
+
+namespace octopus { namespace utils { namespace simd {
+
+/*
+ Vectorised in-place operations on contiguous bytes (sequences and base qualities). The instruction
+ set is selected at compile time in the same way as the pair-HMM, and each function falls back to
+ a scalar loop for the remainder of the range (or all of it when no SIMD extension is available).
+ */
+
+namespace detail {
+
+inline void capitalise_scalar(char* first, const char* last) noexcept
+{
+    for (; first != last; ++first) {
+        if ('a' <= *first && *first <= 'z') *first -= 'a' - 'A';
+    }
+}
+
+inline void cap_scalar(std::uint8_t* first, const std::uint8_t* last, const std::uint8_t max) noexcept
+{
+    for (; first != last; ++first) {
+        if (*first > max) *first = max;
+    }
+}
+
+inline void zero_if_less_scalar(std::uint8_t* first, const std::uint8_t* last, const std::uint8_t value) noexcept
+{
+    for (; first != last; ++first) {
+        if (*first < value) *first = 0;
+    }
+}
+
+inline void encode_bases_scalar(const char* first, const char* last, std::uint8_t* result) noexcept
+{
+    for (; first != last; ++first, ++result) {
+        switch (*first) {
+            case 'A': *result = 0; break;
+            case 'C': *result = 1; break;
+            case 'G': *result = 2; break;
+            case 'T': *result = 3; break;
+            default: *result = 4;
+        }
+    }
+}
+
+inline unsigned count_trailing_zeros(const unsigned mask) noexcept
+{
+    return __builtin_ctz(mask);
+}
+
+inline unsigned count_leading_zeros(const unsigned mask) noexcept
+{
+    return __builtin_clz(mask);
+}
+
+} // namespace detail
+
+// Upper cases ASCII letters in [first, last), as std::toupper in the "C" locale
+inline void capitalise(char* first, char* last) noexcept
+{
+#if defined(SIMD_BYTES_AVX2)
+    const auto lower_begin = _mm256_set1_epi8('a' - 1), lower_end = _mm256_set1_epi8('z' + 1);
+    const auto case_bit = _mm256_set1_epi8('a' - 'A');
+    for (; last - first >= 32; first += 32) {
+        const auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        const auto is_lower = _mm256_and_si256(_mm256_cmpgt_epi8(chars, lower_begin), _mm256_cmpgt_epi8(lower_end, chars));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(first), _mm256_sub_epi8(chars, _mm256_and_si256(is_lower, case_bit)));
+    }
+#elif defined(SIMD_BYTES_SSE2)
+    const auto lower_begin = _mm_set1_epi8('a' - 1), lower_end = _mm_set1_epi8('z' + 1);
+    const auto case_bit = _mm_set1_epi8('a' - 'A');
+    for (; last - first >= 16; first += 16) {
+        const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const auto is_lower = _mm_and_si128(_mm_cmpgt_epi8(chars, lower_begin), _mm_cmplt_epi8(chars, lower_end));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(first), _mm_sub_epi8(chars, _mm_and_si128(is_lower, case_bit)));
+    }
+#elif defined(SIMD_BYTES_NEON)
+    const auto lower_begin = vdupq_n_u8('a'), lower_end = vdupq_n_u8('z');
+    const auto case_bit = vdupq_n_u8('a' - 'A');
+    for (; last - first >= 16; first += 16) {
+        const auto chars = vld1q_u8(reinterpret_cast<const std::uint8_t*>(first));
+        const auto is_lower = vandq_u8(vcgeq_u8(chars, lower_begin), vcleq_u8(chars, lower_end));
+        vst1q_u8(reinterpret_cast<std::uint8_t*>(first), vsubq_u8(chars, vandq_u8(is_lower, case_bit)));
+    }
+#endif
+    detail::capitalise_scalar(first, last);
+}
+
+// Replaces each byte in [first, last) greater than max with max
+inline void cap(std::uint8_t* first, std::uint8_t* last, const std::uint8_t max) noexcept
+{
+#if defined(SIMD_BYTES_AVX2)
+    const auto maxs = _mm256_set1_epi8(static_cast<char>(max));
+    for (; last - first >= 32; first += 32) {
+        const auto values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(first), _mm256_min_epu8(values, maxs));
+    }
+#elif defined(SIMD_BYTES_SSE2)
+    const auto maxs = _mm_set1_epi8(static_cast<char>(max));
+    for (; last - first >= 16; first += 16) {
+        const auto values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(first), _mm_min_epu8(values, maxs));
+    }
+#elif defined(SIMD_BYTES_NEON)
+    const auto maxs = vdupq_n_u8(max);
+    for (; last - first >= 16; first += 16) {
+        vst1q_u8(first, vminq_u8(vld1q_u8(first), maxs));
+    }
+#endif
+    detail::cap_scalar(first, last, max);
+}
+
+// Replaces each byte in [first, last) less than value with zero
+inline void zero_if_less(std::uint8_t* first, std::uint8_t* last, const std::uint8_t value) noexcept
+{
+#if defined(SIMD_BYTES_AVX2)
+    const auto values = _mm256_set1_epi8(static_cast<char>(value));
+    for (; last - first >= 32; first += 32) {
+        const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        const auto is_high = _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, values), bytes);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(first), _mm256_and_si256(bytes, is_high));
+    }
+#elif defined(SIMD_BYTES_SSE2)
+    const auto values = _mm_set1_epi8(static_cast<char>(value));
+    for (; last - first >= 16; first += 16) {
+        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const auto is_high = _mm_cmpeq_epi8(_mm_max_epu8(bytes, values), bytes);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(first), _mm_and_si128(bytes, is_high));
+    }
+#elif defined(SIMD_BYTES_NEON)
+    const auto values = vdupq_n_u8(value);
+    for (; last - first >= 16; first += 16) {
+        const auto bytes = vld1q_u8(first);
+        vst1q_u8(first, vandq_u8(bytes, vcgeq_u8(bytes, values)));
+    }
+#endif
+    detail::zero_if_less_scalar(first, last, value);
+}
+
+// Returns a pointer to the first byte in [first1, last1) that differs from the corresponding byte from first2, or last1
+inline const char* find_first_mismatch(const char* first1, const char* last1, const char* first2) noexcept
+{
+#if defined(SIMD_BYTES_AVX2)
+    for (; last1 - first1 >= 32; first1 += 32, first2 += 32) {
+        const auto lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first1));
+        const auto rhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first2));
+        const auto mask = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs)));
+        if (mask != 0) return first1 + detail::count_trailing_zeros(mask);
+    }
+#elif defined(SIMD_BYTES_SSE2)
+    for (; last1 - first1 >= 16; first1 += 16, first2 += 16) {
+        const auto lhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first1));
+        const auto rhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first2));
+        const auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs))) & 0xFFFFu;
+        if (mask != 0) return first1 + detail::count_trailing_zeros(mask);
+    }
+#elif defined(SIMD_BYTES_NEON)
+    for (; last1 - first1 >= 16; first1 += 16, first2 += 16) {
+        const auto lhs = vld1q_u8(reinterpret_cast<const std::uint8_t*>(first1));
+        const auto rhs = vld1q_u8(reinterpret_cast<const std::uint8_t*>(first2));
+        if (vminvq_u8(vceqq_u8(lhs, rhs)) == 0) break; // finish the block below
+    }
+#endif
+    for (; first1 != last1; ++first1, ++first2) {
+        if (*first1 != *first2) return first1;
+    }
+    return last1;
+}
+
+// Writes the 2-bit code of each base in [first, last) to result (A = 0, C = 1, G = 2, T = 3), or 4 for any other character
+inline void encode_bases(const char* first, const char* last, std::uint8_t* result) noexcept
+{
+#if defined(SIMD_BYTES_AVX2)
+    const auto as = _mm256_set1_epi8('A'), cs = _mm256_set1_epi8('C'), gs = _mm256_set1_epi8('G'), ts = _mm256_set1_epi8('T');
+    const auto ones = _mm256_set1_epi8(1), twos = _mm256_set1_epi8(2), threes = _mm256_set1_epi8(3), fours = _mm256_set1_epi8(4);
+    for (; last - first >= 32; first += 32, result += 32) {
+        const auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        const auto is_a = _mm256_cmpeq_epi8(chars, as), is_c = _mm256_cmpeq_epi8(chars, cs);
+        const auto is_g = _mm256_cmpeq_epi8(chars, gs), is_t = _mm256_cmpeq_epi8(chars, ts);
+        const auto is_base = _mm256_or_si256(_mm256_or_si256(is_a, is_c), _mm256_or_si256(is_g, is_t));
+        auto codes = _mm256_or_si256(_mm256_and_si256(is_c, ones), _mm256_and_si256(is_g, twos));
+        codes = _mm256_or_si256(codes, _mm256_or_si256(_mm256_and_si256(is_t, threes), _mm256_andnot_si256(is_base, fours)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(result), codes);
+    }
+#elif defined(SIMD_BYTES_SSE2)
+    const auto as = _mm_set1_epi8('A'), cs = _mm_set1_epi8('C'), gs = _mm_set1_epi8('G'), ts = _mm_set1_epi8('T');
+    const auto ones = _mm_set1_epi8(1), twos = _mm_set1_epi8(2), threes = _mm_set1_epi8(3), fours = _mm_set1_epi8(4);
+    for (; last - first >= 16; first += 16, result += 16) {
+        const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const auto is_a = _mm_cmpeq_epi8(chars, as), is_c = _mm_cmpeq_epi8(chars, cs);
+        const auto is_g = _mm_cmpeq_epi8(chars, gs), is_t = _mm_cmpeq_epi8(chars, ts);
+        const auto is_base = _mm_or_si128(_mm_or_si128(is_a, is_c), _mm_or_si128(is_g, is_t));
+        auto codes = _mm_or_si128(_mm_and_si128(is_c, ones), _mm_and_si128(is_g, twos));
+        codes = _mm_or_si128(codes, _mm_or_si128(_mm_and_si128(is_t, threes), _mm_andnot_si128(is_base, fours)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result), codes);
+    }
+#elif defined(SIMD_BYTES_NEON)
+    const auto as = vdupq_n_u8('A'), cs = vdupq_n_u8('C'), gs = vdupq_n_u8('G'), ts = vdupq_n_u8('T');
+    const auto ones = vdupq_n_u8(1), twos = vdupq_n_u8(2), threes = vdupq_n_u8(3), fours = vdupq_n_u8(4);
+    for (; last - first >= 16; first += 16, result += 16) {
+        const auto chars = vld1q_u8(reinterpret_cast<const std::uint8_t*>(first));
+        const auto is_a = vceqq_u8(chars, as), is_c = vceqq_u8(chars, cs);
+        const auto is_g = vceqq_u8(chars, gs), is_t = vceqq_u8(chars, ts);
+        const auto is_base = vorrq_u8(vorrq_u8(is_a, is_c), vorrq_u8(is_g, is_t));
+        auto codes = vorrq_u8(vandq_u8(is_c, ones), vandq_u8(is_g, twos));
+        codes = vorrq_u8(codes, vorrq_u8(vandq_u8(is_t, threes), vbicq_u8(fours, is_base)));
+        vst1q_u8(result, codes);
+    }
+#endif
+    detail::encode_bases_scalar(first, last, result);
+}
+
+// Returns a pointer to the first byte in [first, last) not less than value, or last if there is none
+inline const std::uint8_t* find_first_not_less(const std::uint8_t* first, const std::uint8_t* last, const std::uint8_t value) noexcept
+{
+#if defined(SIMD_BYTES_AVX2)
+    const auto values = _mm256_set1_epi8(static_cast<char>(value));
+    for (; last - first >= 32; first += 32) {
+        const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(bytes, values), bytes)));
+        if (mask != 0) return first + detail::count_trailing_zeros(mask);
+    }
+#elif defined(SIMD_BYTES_SSE2)
+    const auto values = _mm_set1_epi8(static_cast<char>(value));
+    for (; last - first >= 16; first += 16) {
+        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(bytes, values), bytes)));
+        if (mask != 0) return first + detail::count_trailing_zeros(mask);
+    }
+#elif defined(SIMD_BYTES_NEON)
+    const auto values = vdupq_n_u8(value);
+    for (; last - first >= 16; first += 16) {
+        if (vmaxvq_u8(vcgeq_u8(vld1q_u8(first), values)) != 0) break; // finish the block below
+    }
+#endif
+    for (; first != last; ++first) {
+        if (*first >= value) return first;
+    }
+    return last;
+}
+
+// Returns a pointer one past the last byte in [first, last) not less than value, or first if there is none
+inline const std::uint8_t* find_last_not_less(const std::uint8_t* first, const std::uint8_t* last, const std::uint8_t value) noexcept
+{
+#if defined(SIMD_BYTES_AVX2)
+    const auto values = _mm256_set1_epi8(static_cast<char>(value));
+    for (; last - first >= 32; last -= 32) {
+        const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last - 32));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(bytes, values), bytes)));
+        if (mask != 0) return last - detail::count_leading_zeros(mask);
+    }
+#elif defined(SIMD_BYTES_SSE2)
+    const auto values = _mm_set1_epi8(static_cast<char>(value));
+    for (; last - first >= 16; last -= 16) {
+        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last - 16));
+        const auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(bytes, values), bytes)));
+        if (mask != 0) return last - (detail::count_leading_zeros(mask) - 16);
+    }
+#elif defined(SIMD_BYTES_NEON)
+    const auto values = vdupq_n_u8(value);
+    for (; last - first >= 16; last -= 16) {
+        if (vmaxvq_u8(vcgeq_u8(vld1q_u8(last - 16), values)) != 0) break; // finish the block below
+    }
+#endif
+    for (; last != first; --last) {
+        if (*(last - 1) >= value) return last;
+    }
+    return first;
+}
+
+} // namespace simd
+} // namespace utils
+} // namespace octopus
+
+#undef SIMD_BYTES_AVX2
+#undef SIMD_BYTES_SSE2
+#undef SIMD_BYTES_NEON
+
+#endif
@@ -125,5 +125,28 @@ bool begins_with_vowel(const std::string& str)
     return !str.empty() && is_vowel(str.front());
 }
 
+std::string json_escape(const std::string& str)
+{
+    std::string result {};
+    result.reserve(str.size());
+    for (const char c : str) {
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    std::ostringstream ss {};
+                    ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c);
+                    result += ss.str();
+                } else {
+                    result += c;
+                }
+        }
+    }
+    return result;
+}
+
 } // namespace utils
 } // namespace octopus
@@ -47,6 +47,9 @@ std::string strip_leading_zeroes(const std::string& str);
 bool is_vowel(const char c);
 bool begins_with_vowel(const std::string& str);
 
+// Escapes str for use inside a JSON string literal
+std::string json_escape(const std::string& str);
+
 enum class PrecisionRule { dp, sf };
 
 template <typename T, typename = typename std::enable_if_t<std::is_floating_point<T>::value>>
@@ -3,7 +3,29 @@
 
 #include "system_utils.hpp"
 
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <iterator>
+#include <cctype>
+#include <stdexcept>
+#include <limits>
+#include <utility>
+
 #include <sys/resource.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
 
 namespace octopus {
 
@@ -14,4 +36,217 @@ std::size_t get_max_open_files()
     return lim.rlim_cur;
 }
 
+std::size_t get_peak_rss()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    #ifdef __APPLE__
+    return usage.ru_maxrss; // bytes
+    #else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024; // kilobytes
+    #endif
+}
+
+std::size_t get_rss()
+{
+    #ifdef __linux__
+    std::ifstream statm {"/proc/self/statm"};
+    std::size_t size_pages {}, resident_pages {};
+    if (statm >> size_pages >> resident_pages) {
+        return resident_pages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    }
+    #endif
+    return get_peak_rss();
+}
+
+std::chrono::nanoseconds get_thread_cpu_time()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return std::chrono::nanoseconds {0};
+    return std::chrono::seconds {ts.tv_sec} + std::chrono::nanoseconds {ts.tv_nsec};
+}
+
+bool sync_file(const boost::filesystem::path& file)
+{
+    const auto fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    const bool synced {::fsync(fd) == 0};
+    ::close(fd);
+    return synced;
+}
+
+ReadAheadAdvisor::ReadAheadAdvisor(const boost::filesystem::path& file)
+: fd_ {::open(file.c_str(), O_RDONLY)}
+{}
+
+ReadAheadAdvisor::ReadAheadAdvisor(ReadAheadAdvisor&& other) noexcept
+: fd_ {other.fd_}
+{
+    other.fd_ = -1;
+}
+
+ReadAheadAdvisor& ReadAheadAdvisor::operator=(ReadAheadAdvisor&& other) noexcept
+{
+    std::swap(fd_, other.fd_);
+    return *this;
+}
+
+ReadAheadAdvisor::~ReadAheadAdvisor() noexcept
+{
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool ReadAheadAdvisor::is_open() const noexcept
+{
+    return fd_ >= 0;
+}
+
+void ReadAheadAdvisor::will_need(const std::uintmax_t offset, const std::uintmax_t length) const noexcept
+{
+    if (fd_ < 0) return;
+    #if defined(POSIX_FADV_WILLNEED)
+    ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+    #elif defined(F_RDADVISE)
+    struct radvisory advice;
+    advice.ra_offset = static_cast<off_t>(offset);
+    advice.ra_count = static_cast<int>(std::min<std::uintmax_t>(length, std::numeric_limits<int>::max()));
+    ::fcntl(fd_, F_RDADVISE, &advice);
+    #endif
+}
+
+MappedFile::MappedFile(const boost::filesystem::path& file)
+{
+    const auto fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        const auto size = static_cast<std::size_t>(file_stat.st_size);
+        auto data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            data_ = static_cast<const char*>(data);
+            size_ = size;
+        }
+    }
+    ::close(fd); // the mapping keeps the file open
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+: data_ {other.data_}
+, size_ {other.size_}
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+}
+
+MappedFile::~MappedFile() noexcept
+{
+    if (data_) ::munmap(const_cast<char*>(data_), size_);
+}
+
+bool MappedFile::is_open() const noexcept
+{
+    return data_ != nullptr;
+}
+
+const char* MappedFile::data() const noexcept
+{
+    return data_;
+}
+
+std::size_t MappedFile::size() const noexcept
+{
+    return size_;
+}
+
+namespace {
+
+// Parses a kernel CPU list, e.g. "0-3,8,10-11"
+std::vector<unsigned> parse_cpu_list(const std::string& list)
+{
+    std::vector<unsigned> result {};
+    std::istringstream ss {list};
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        try {
+            const auto dash_pos = range.find('-');
+            const unsigned first = std::stoul(range.substr(0, dash_pos));
+            const unsigned last = dash_pos == std::string::npos ? first : std::stoul(range.substr(dash_pos + 1));
+            for (auto cpu = first; cpu <= last; ++cpu) result.push_back(cpu);
+        } catch (const std::logic_error&) {
+            return {};
+        }
+    }
+    return result;
+}
+
+#ifdef __linux__
+
+NumaTopology read_numa_topology()
+{
+    namespace fs = boost::filesystem;
+    const fs::path node_dir {"/sys/devices/system/node"};
+    boost::system::error_code ec {};
+    if (!fs::is_directory(node_dir, ec)) return {};
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return {};
+    std::vector<std::pair<unsigned, std::vector<unsigned>>> nodes {};
+    for (fs::directory_iterator itr {node_dir, ec}, end {}; !ec && itr != end; itr.increment(ec)) {
+        const auto name = itr->path().filename().string();
+        if (name.size() < 5 || name.compare(0, 4, "node") != 0
+            || !std::all_of(std::next(std::cbegin(name), 4), std::cend(name), [] (char c) { return std::isdigit(c); })) {
+            continue;
+        }
+        std::ifstream cpulist {(itr->path() / "cpulist").string()};
+        std::string list;
+        if (!std::getline(cpulist, list)) continue;
+        auto cpus = parse_cpu_list(list);
+        cpus.erase(std::remove_if(std::begin(cpus), std::end(cpus),
+                                  [&] (unsigned cpu) { return cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed); }),
+                   std::end(cpus));
+        if (!cpus.empty()) nodes.emplace_back(std::stoul(name.substr(4)), std::move(cpus));
+    }
+    std::sort(std::begin(nodes), std::end(nodes));
+    NumaTopology result {};
+    result.reserve(nodes.size());
+    for (auto& node : nodes) result.push_back(std::move(node.second));
+    return result;
+}
+
+#endif
+
+} // namespace
+
+NumaTopology get_numa_topology()
+{
+    #ifdef __linux__
+    auto result = read_numa_topology();
+    if (!result.empty()) return result;
+    #endif
+    return NumaTopology(1);
+}
+
+bool bind_to_cpus(std::thread& thread, const std::vector<unsigned>& cpus)
+{
+    if (cpus.empty()) return false;
+    #ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (const auto cpu : cpus) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpu_set);
+    }
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set) == 0;
+    #else
+    return false;
+    #endif
+}
+
 } // namespace octopus
@@ -5,11 +5,89 @@
 #define system_utils_hpp
 
 #include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include <boost/filesystem/path.hpp>
 
 namespace octopus {
 
 std::size_t get_max_open_files();
 
+// The largest resident set size (in bytes) this process has had so far
+std::size_t get_peak_rss();
+
+// The current resident set size (in bytes) of this process, or the peak if the current size is unavailable
+std::size_t get_rss();
+
+// The CPU time used by the calling thread so far
+std::chrono::nanoseconds get_thread_cpu_time();
+
+// Flushes the file's data to storage. Returns false if the file could not be synced.
+bool sync_file(const boost::filesystem::path& file);
+
+// A read-only file handle used to tell the OS which parts of the file will be read soon, so it can read
+// them into the page cache ahead of time. The page cache is shared, so this benefits all readers of the file,
+// and the advice stands after the handle is closed.
+class ReadAheadAdvisor
+{
+public:
+    ReadAheadAdvisor() = default;
+    explicit ReadAheadAdvisor(const boost::filesystem::path& file);
+    
+    ReadAheadAdvisor(const ReadAheadAdvisor&)            = delete;
+    ReadAheadAdvisor& operator=(const ReadAheadAdvisor&) = delete;
+    ReadAheadAdvisor(ReadAheadAdvisor&& other) noexcept;
+    ReadAheadAdvisor& operator=(ReadAheadAdvisor&& other) noexcept;
+    
+    ~ReadAheadAdvisor() noexcept;
+    
+    bool is_open() const noexcept;
+    
+    // Does nothing if the file isn't open, or read ahead advice is not supported
+    void will_need(std::uintmax_t offset, std::uintmax_t length) const noexcept;
+    
+private:
+    int fd_ = -1;
+};
+
+// A read-only memory mapping of a whole file. The mapped pages are shared with the page cache, so
+// any number of mappings of the same file (or threads reading one mapping) use the same memory.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const boost::filesystem::path& file);
+    
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    
+    ~MappedFile() noexcept;
+    
+    bool is_open() const noexcept;
+    
+    const char* data() const noexcept; // nullptr if not open
+    std::size_t size() const noexcept;
+    
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// The CPUs of each NUMA node that this process is allowed to run on. Nodes without available CPUs
+// are omitted. If the topology cannot be determined (e.g. not Linux) a single node with no listed
+// CPUs is returned.
+using NumaTopology = std::vector<std::vector<unsigned>>;
+
+NumaTopology get_numa_topology();
+
+// Returns false if the thread could not be restricted to the CPUs (or binding is not supported)
+bool bind_to_cpus(std::thread& thread, const std::vector<unsigned>& cpus);
+
 } // namespace octopus
 
 #endif
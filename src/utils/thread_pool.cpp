@@ -3,31 +3,48 @@
 
 #include "thread_pool.hpp"
 
+#include <iterator>
+#include <algorithm>
+
 namespace octopus {
 
+thread_local const ThreadPool* ThreadPool::current_pool_ {nullptr};
+thread_local std::size_t ThreadPool::current_worker_ {0};
+
 ThreadPool::ThreadPool() : ThreadPool {0} {}
 
-ThreadPool::ThreadPool(const std::size_t n_threads)
-: stop_ {false}
+ThreadPool::ThreadPool(const std::size_t n_threads) : ThreadPool {n_threads, NumaTopology {}} {}
+
+ThreadPool::ThreadPool(const std::size_t n_threads, const NumaTopology& topology)
+: queues_ {}
+, node_queues_ {}
+, worker_nodes_ {}
+, injected_ {injectionQueueCapacity}
+, overflow_ {}
+, stop_ {false}
 , n_idle_ {n_threads}
+, n_queued_ {0}
 {
+    queues_.reserve(n_threads);
+    for (std::size_t i {0}; i < n_threads; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    const auto n_nodes = std::max(topology.size(), std::size_t {1});
+    if (n_nodes > 1) {
+        node_queues_.reserve(n_nodes);
+        for (std::size_t node {0}; node < n_nodes; ++node) {
+            node_queues_.push_back(std::make_unique<WorkQueue>());
+        }
+    }
+    // Consecutive workers share a node so the workers of each node are balanced
+    worker_nodes_.reserve(n_threads);
+    for (std::size_t i {0}; i < n_threads; ++i) {
+        worker_nodes_.push_back(i * n_nodes / n_threads);
+    }
     workers_.reserve(n_threads);
     for (std::size_t i {0}; i < n_threads; ++i) {
-        workers_.emplace_back([this] {
-            std::function<void()> task;
-            while (true) {
-                std::unique_lock<std::mutex> lk {mutex_};
-                cv_.wait(lk, [this] () { return stop_ || !tasks_.empty(); });
-                if (stop_ && tasks_.empty()) return;
-                task = std::move(tasks_.front());
-                tasks_.pop();
-                --n_idle_;
-                lk.unlock();
-                task();
-                lk.lock();
-                ++n_idle_;
-            }
-        });
+        workers_.emplace_back([this, i] { run(i); });
+        if (!topology.empty()) bind_to_cpus(workers_.back(), topology[worker_nodes_[i]]);
     }
 }
 
@@ -53,15 +70,198 @@ bool ThreadPool::empty() const noexcept
     return workers_.empty();
 }
 
+std::size_t ThreadPool::num_nodes() const noexcept
+{
+    return std::max(node_queues_.size(), std::size_t {1});
+}
+
 std::size_t ThreadPool::n_idle() const noexcept
 {
-    return n_idle_;
+    const std::size_t idle {n_idle_}, queued {n_queued_};
+    return idle > queued ? idle - queued : 0;
 }
 
 void ThreadPool::clear() noexcept
 {
-    std::lock_guard<std::mutex> lk {mutex_};
-    while (!tasks_.empty()) tasks_.pop();
+    for (auto& queue : queues_) {
+        std::lock_guard<std::mutex> lk {queue->mutex};
+        n_queued_ -= queue->tasks.size();
+        queue->tasks.clear();
+    }
+    for (auto& queue : node_queues_) {
+        std::lock_guard<std::mutex> lk {queue->mutex};
+        n_queued_ -= queue->tasks.size();
+        queue->tasks.clear();
+    }
+    Task task;
+    while (injected_.try_pop(task)) {
+        --n_queued_;
+        task = nullptr;
+    }
+    std::lock_guard<std::mutex> lk {overflow_.mutex};
+    n_queued_ -= overflow_.tasks.size();
+    overflow_.tasks.clear();
+}
+
+// private methods
+
+void ThreadPool::enqueue(Task task)
+{
+    // Count the task before it is visible so a consumer never decrements past zero
+    ++n_queued_;
+    if (current_pool_ == this) {
+        auto& queue = *queues_[current_worker_];
+        std::lock_guard<std::mutex> queue_lk {queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    } else {
+        inject(task);
+    }
+    notify(1);
+}
+
+void ThreadPool::enqueue(std::vector<Task> tasks)
+{
+    n_queued_ += tasks.size();
+    if (current_pool_ == this) {
+        auto& queue = *queues_[current_worker_];
+        std::lock_guard<std::mutex> queue_lk {queue.mutex};
+        queue.tasks.insert(std::end(queue.tasks), std::make_move_iterator(std::begin(tasks)),
+                           std::make_move_iterator(std::end(tasks)));
+    } else {
+        for (auto& task : tasks) inject(task);
+    }
+    notify(tasks.size());
+}
+
+void ThreadPool::enqueue(const std::size_t node, Task task)
+{
+    if (node_queues_.empty()) {
+        enqueue(std::move(task));
+        return;
+    }
+    ++n_queued_;
+    {
+        auto& queue = *node_queues_[node % node_queues_.size()];
+        std::lock_guard<std::mutex> queue_lk {queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    }
+    notify(1);
+}
+
+void ThreadPool::inject(Task& task)
+{
+    if (!injected_.try_push(task)) {
+        std::lock_guard<std::mutex> lk {overflow_.mutex};
+        overflow_.tasks.push_back(std::move(task));
+    }
+}
+
+void ThreadPool::notify(const std::size_t n_tasks)
+{
+    {
+        // Synchronise with the sleep check in run to avoid lost wakeups
+        std::lock_guard<std::mutex> lk {mutex_};
+    }
+    if (n_tasks == 1) {
+        cv_.notify_one();
+    } else {
+        cv_.notify_all();
+    }
+}
+
+bool ThreadPool::try_pop(const std::size_t worker, Task& result)
+{
+    auto& queue = *queues_[worker];
+    std::lock_guard<std::mutex> lk {queue.mutex};
+    if (queue.tasks.empty()) return false;
+    result = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    --n_queued_;
+    return true;
+}
+
+bool ThreadPool::try_pop_injected(Task& result)
+{
+    if (injected_.try_pop(result)) {
+        --n_queued_;
+        return true;
+    }
+    std::lock_guard<std::mutex> lk {overflow_.mutex};
+    if (overflow_.tasks.empty()) return false;
+    result = std::move(overflow_.tasks.front());
+    overflow_.tasks.pop_front();
+    --n_queued_;
+    return true;
+}
+
+bool ThreadPool::try_pop_node(const std::size_t node, Task& result)
+{
+    if (node_queues_.empty()) return false;
+    auto& queue = *node_queues_[node];
+    std::lock_guard<std::mutex> lk {queue.mutex};
+    if (queue.tasks.empty()) return false;
+    result = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    --n_queued_;
+    return true;
+}
+
+bool ThreadPool::try_steal(const std::size_t thief, const bool same_node, Task& result)
+{
+    const auto n_queues = queues_.size();
+    for (std::size_t offset {1}; offset < n_queues; ++offset) {
+        const auto victim_idx = (thief + offset) % n_queues;
+        if ((worker_nodes_[victim_idx] == worker_nodes_[thief]) != same_node) continue;
+        auto& victim = *queues_[victim_idx];
+        std::unique_lock<std::mutex> victim_lk {victim.mutex};
+        if (victim.tasks.empty()) continue;
+        // Take the older half of the victim's tasks; run the oldest and keep the rest.
+        const auto n_steal = (victim.tasks.size() + 1) / 2;
+        const auto stolen_end = std::next(std::begin(victim.tasks), n_steal);
+        result = std::move(victim.tasks.front());
+        std::deque<Task> stolen {std::make_move_iterator(std::next(std::begin(victim.tasks))),
+                                 std::make_move_iterator(stolen_end)};
+        victim.tasks.erase(std::begin(victim.tasks), stolen_end);
+        --n_queued_;
+        victim_lk.unlock();
+        if (!stolen.empty()) {
+            auto& own = *queues_[thief];
+            std::lock_guard<std::mutex> own_lk {own.mutex};
+            own.tasks.insert(std::begin(own.tasks),
+                             std::make_move_iterator(std::begin(stolen)),
+                             std::make_move_iterator(std::end(stolen)));
+        }
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(const std::size_t worker)
+{
+    current_pool_ = this;
+    current_worker_ = worker;
+    const auto node = worker_nodes_[worker];
+    const auto n_nodes = node_queues_.size();
+    const auto try_pop_remote = [&] (Task& result) {
+        for (std::size_t offset {1}; offset < n_nodes; ++offset) {
+            if (try_pop_node((node + offset) % n_nodes, result)) return true;
+        }
+        return false;
+    };
+    Task task;
+    while (true) {
+        if (try_pop(worker, task) || try_pop_node(node, task) || try_pop_injected(task)
+            || try_steal(worker, true, task) || try_pop_remote(task) || try_steal(worker, false, task)) {
+            --n_idle_;
+            task();
+            task = nullptr;
+            ++n_idle_;
+            continue;
+        }
+        std::unique_lock<std::mutex> lk {mutex_};
+        cv_.wait(lk, [this] () { return stop_ || n_queued_ > 0; });
+        if (stop_ && n_queued_ == 0) return;
+    }
 }
 
 } // namespace octopus
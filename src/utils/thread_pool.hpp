@@ -1,73 +1,264 @@
 // Copyright (c) 2015-2021 Daniel Cooke
 // Use of this source code is governed by the MIT license that can be found in the LICENSE file.
 
-// This thread pool implementation is mostly derived from https://github.com/progschj/ThreadPool
+// The public interface of this thread pool is derived from https://github.com/progschj/ThreadPool,
+// but tasks are scheduled with per-worker work-stealing deques rather than a single shared queue.
 
 #ifndef thread_pool_hpp
 #define thread_pool_hpp
 
 #include <cstddef>
 #include <vector>
-#include <queue>
-#include <functional>
+#include <deque>
 #include <memory>
+#include <functional>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <future>
 #include <atomic>
+#include <chrono>
 #include <type_traits>
+#include <iterator>
 #include <utility>
+#include <new>
 #include <exception>
+#include <stdexcept>
+
+#include "bounded_mpmc_queue.hpp"
+#include "system_utils.hpp"
 
 namespace octopus {
 
+/*
+ Each worker owns a double-ended task queue. Tasks pushed from inside a worker go onto
+ the back of that worker's own queue (so nested jobs stay local and cache warm), while
+ tasks pushed from outside the pool go onto a shared lock-free injection queue (spilling into
+ a locked overflow queue if it is full). Workers pop their own queue from the back (LIFO), then
+ take the oldest injected task, and when both are empty steal half of another worker's queue
+ from the front.
+ 
+ A worker that fans out nested jobs should wait for them with wait, which runs the worker's
+ own pending jobs rather than blocking, so a task can use idle workers without losing its own.
+ 
+ If the pool is given a NUMA topology, workers are spread evenly over the nodes and bound to the
+ CPUs of their node. Tasks pushed to a node with push_to_node go onto that node's queue, which
+ the node's workers check before the shared injection queue. Workers prefer to steal from workers
+ on the same node, and will only take another node's tasks once there is nothing to do locally.
+ */
 class ThreadPool
 {
 public:
     ThreadPool();
     explicit ThreadPool(std::size_t n_threads);
-    
+    ThreadPool(std::size_t n_threads, const NumaTopology& topology);
+
     ThreadPool(const ThreadPool&)             = delete;
     ThreadPool& operator=(const ThreadPool&)  = delete;
     ThreadPool(ThreadPool&& other) noexcept   = delete;
     ThreadPool& operator=(ThreadPool&& other) = delete;
-    
+
     ~ThreadPool() noexcept;
-    
+
     std::size_t size() const noexcept;
     bool empty() const noexcept;
     std::size_t n_idle() const noexcept;
-    
+    std::size_t num_nodes() const noexcept;
+
     void clear() noexcept;
-    
+
     template <typename F, typename... Args>
     auto push(F&& f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>>;
     template <typename F, typename... Args>
     auto try_push(F&& f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>>;
+    template <typename F, typename... Args>
+    auto push_to_node(std::size_t node, F&& f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>>;
     
+    // Pushes a range of nullary callables with a single wakeup. The callables are copied, so the range
+    // can be reused; use std::make_move_iterator to move them instead.
+    template <typename InputIt>
+    auto push_bulk(InputIt first, InputIt last)
+    -> std::vector<std::future<std::result_of_t<typename std::iterator_traits<InputIt>::value_type()>>>;
+    
+    template <typename T>
+    void wait(const std::future<T>& future);
+
 private:
+    // A move-only type-erased nullary callable. Callables that fit in the buffer (which includes
+    // packaged_task) are stored inline so pushing a task does not allocate beyond the future state.
+    class Task
+    {
+    public:
+        Task() noexcept = default;
+        template <typename F,
+                  typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>,
+                  typename = decltype(std::declval<std::decay_t<F>&>()())>
+        Task(F&& f);
+        
+        Task(const Task&)            = delete;
+        Task& operator=(const Task&) = delete;
+        Task(Task&& other) noexcept;
+        Task& operator=(Task&& other) noexcept;
+        Task& operator=(std::nullptr_t) noexcept;
+        
+        ~Task() noexcept;
+        
+        void operator()();
+        explicit operator bool() const noexcept;
+        
+    private:
+        static constexpr std::size_t bufferSize {48};
+        
+        using Storage = std::aligned_storage_t<bufferSize, alignof(std::max_align_t)>;
+        
+        template <typename F, bool Inline = (sizeof(F) <= bufferSize && alignof(F) <= alignof(Storage)
+                                             && std::is_nothrow_move_constructible<F>::value)>
+        struct Handler;
+        
+        Storage storage_;
+        void (*invoke_)(void*) = nullptr;
+        void (*relocate_)(void* dst, void* src) = nullptr; // destroys src, moving into dst if not null
+        
+        void reset() noexcept;
+    };
+    
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    
+    static constexpr std::size_t injectionQueueCapacity {1024};
+    
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::unique_ptr<WorkQueue>> node_queues_; // empty unless a topology is given
+    std::vector<std::size_t> worker_nodes_;
+    BoundedMPMCQueue<Task> injected_;
+    WorkQueue overflow_;
     std::mutex mutex_;
     std::condition_variable cv_;
     std::atomic<bool> stop_;
-    std::atomic<std::size_t> n_idle_;
-    
+    std::atomic<std::size_t> n_idle_, n_queued_;
+
     std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
+
+    static thread_local const ThreadPool* current_pool_;
+    static thread_local std::size_t current_worker_;
+
+    void enqueue(Task task);
+    void enqueue(std::vector<Task> tasks);
+    void enqueue(std::size_t node, Task task);
+    void inject(Task& task);
+    void notify(std::size_t n_tasks);
+    bool try_pop(std::size_t worker, Task& result);
+    bool try_pop_injected(Task& result);
+    bool try_pop_node(std::size_t node, Task& result);
+    bool try_steal(std::size_t thief, bool same_node, Task& result);
+    void run(std::size_t worker);
 };
 
+template <typename F>
+struct ThreadPool::Task::Handler<F, true>
+{
+    template <typename G>
+    static void create(void* storage, G&& f) { ::new (storage) F {std::forward<G>(f)}; }
+    static void invoke(void* storage) { (*static_cast<F*>(storage))(); }
+    static void relocate(void* dst, void* src) noexcept
+    {
+        auto& f = *static_cast<F*>(src);
+        if (dst) ::new (dst) F {std::move(f)};
+        f.~F();
+    }
+};
+
+template <typename F>
+struct ThreadPool::Task::Handler<F, false>
+{
+    static F*& get(void* storage) noexcept { return *static_cast<F**>(storage); }
+    template <typename G>
+    static void create(void* storage, G&& f) { ::new (storage) F* {new F {std::forward<G>(f)}}; }
+    static void invoke(void* storage) { (*get(storage))(); }
+    static void relocate(void* dst, void* src) noexcept
+    {
+        if (dst) {
+            ::new (dst) F* {get(src)};
+        } else {
+            delete get(src);
+        }
+    }
+};
+
+template <typename F, typename, typename>
+ThreadPool::Task::Task(F&& f)
+{
+    using Callable = std::decay_t<F>;
+    Handler<Callable>::create(&storage_, std::forward<F>(f));
+    invoke_ = Handler<Callable>::invoke;
+    relocate_ = Handler<Callable>::relocate;
+}
+
+inline ThreadPool::Task::Task(Task&& other) noexcept
+: invoke_ {other.invoke_}
+, relocate_ {other.relocate_}
+{
+    if (relocate_) relocate_(&storage_, &other.storage_);
+    other.invoke_ = nullptr;
+    other.relocate_ = nullptr;
+}
+
+inline ThreadPool::Task& ThreadPool::Task::operator=(Task&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        invoke_ = other.invoke_;
+        relocate_ = other.relocate_;
+        if (relocate_) relocate_(&storage_, &other.storage_);
+        other.invoke_ = nullptr;
+        other.relocate_ = nullptr;
+    }
+    return *this;
+}
+
+inline ThreadPool::Task& ThreadPool::Task::operator=(std::nullptr_t) noexcept
+{
+    reset();
+    return *this;
+}
+
+inline ThreadPool::Task::~Task() noexcept
+{
+    reset();
+}
+
+inline void ThreadPool::Task::operator()()
+{
+    invoke_(&storage_);
+}
+
+inline ThreadPool::Task::operator bool() const noexcept
+{
+    return invoke_ != nullptr;
+}
+
+inline void ThreadPool::Task::reset() noexcept
+{
+    if (relocate_) relocate_(nullptr, &storage_);
+    invoke_ = nullptr;
+    relocate_ = nullptr;
+}
+
 template <typename F, typename... Args>
 auto ThreadPool::push(F&& f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>>
 {
     using f_result_type = std::result_of_t<F(Args...)>;
-    auto task = std::make_shared<std::packaged_task<f_result_type()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-    auto result = task->get_future();
-    {
-        std::lock_guard<std::mutex> lk {mutex_};
-        if (stop_) throw std::runtime_error {"ThreadPool: calling push on stopped pool"};
-        tasks_.emplace([task] () { (*task)(); });
+    std::packaged_task<f_result_type()> task {std::bind(std::forward<F>(f), std::forward<Args>(args)...)};
+    auto result = task.get_future();
+    if (stop_) throw std::runtime_error {"ThreadPool: calling push on stopped pool"};
+    if (workers_.empty()) {
+        task(); // no workers so run task in calling thread
+    } else {
+        enqueue(Task {std::move(task)});
     }
-    cv_.notify_one();
     return result;
 }
 
@@ -75,25 +266,69 @@ template <typename F, typename... Args>
 auto ThreadPool::try_push(F&& f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>>
 {
     using f_result_type = std::result_of_t<F(Args...)>;
-    auto task = std::make_shared<std::packaged_task<f_result_type()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-    auto result = task->get_future();
-    bool pushed {false};
-    {
-        std::lock_guard<std::mutex> lk {mutex_};
-        if (stop_) throw std::runtime_error {"ThreadPool: calling push on stopped pool"};
-        if (n_idle_ > 0) {
-            tasks_.emplace([task] () { (*task)(); });
-            pushed = true;
-        }
+    std::packaged_task<f_result_type()> task {std::bind(std::forward<F>(f), std::forward<Args>(args)...)};
+    auto result = task.get_future();
+    if (stop_) throw std::runtime_error {"ThreadPool: calling push on stopped pool"};
+    if (n_idle_ > n_queued_) {
+        enqueue(Task {std::move(task)});
+    } else {
+        task(); // run task in calling thread
     }
-    if (pushed) {
-        cv_.notify_one();
+    return result;
+}
+
+template <typename F, typename... Args>
+auto ThreadPool::push_to_node(const std::size_t node, F&& f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>>
+{
+    using f_result_type = std::result_of_t<F(Args...)>;
+    std::packaged_task<f_result_type()> task {std::bind(std::forward<F>(f), std::forward<Args>(args)...)};
+    auto result = task.get_future();
+    if (stop_) throw std::runtime_error {"ThreadPool: calling push on stopped pool"};
+    if (workers_.empty()) {
+        task(); // no workers so run task in calling thread
     } else {
-        (*task)(); // run task in calling thread
+        enqueue(node, Task {std::move(task)});
+    }
+    return result;
+}
+
+template <typename InputIt>
+auto ThreadPool::push_bulk(InputIt first, InputIt last)
+-> std::vector<std::future<std::result_of_t<typename std::iterator_traits<InputIt>::value_type()>>>
+{
+    using f_result_type = std::result_of_t<typename std::iterator_traits<InputIt>::value_type()>;
+    std::vector<std::future<f_result_type>> result {};
+    std::vector<Task> tasks {};
+    for (; first != last; ++first) {
+        std::packaged_task<f_result_type()> task {*first};
+        result.push_back(task.get_future());
+        tasks.emplace_back(std::move(task));
+    }
+    if (stop_) throw std::runtime_error {"ThreadPool: calling push on stopped pool"};
+    if (workers_.empty()) {
+        for (auto& task : tasks) task(); // no workers so run tasks in calling thread
+    } else if (!tasks.empty()) {
+        enqueue(std::move(tasks));
     }
     return result;
 }
 
+template <typename T>
+void ThreadPool::wait(const std::future<T>& future)
+{
+    if (current_pool_ == this) {
+        // Only this worker's own queue is drained; it holds the nested jobs this worker pushed
+        // (or stole), but never injected tasks, which may be much longer than the one waiting.
+        Task task;
+        while (future.wait_for(std::chrono::seconds {0}) != std::future_status::ready
+               && try_pop(current_worker_, task)) {
+            task();
+            task = nullptr;
+        }
+    }
+    future.wait();
+}
+
 } // namespace octopus
 
 #endif
@@ -5,20 +5,76 @@
 #define Octopus_benchmark_utils_hpp
 
 #include <chrono>
+#include <cstddef>
+#include <string>
+#include <ostream>
+#include <iomanip>
 
 template <typename D = std::chrono::nanoseconds, typename F>
 D benchmark(F f, unsigned num_tests)
 {
     D total {0};
-    
-    for (; num_tests > 0; --num_tests) {
+
+    for (unsigned i {0}; i < num_tests; ++i) {
         const auto start = std::chrono::system_clock::now();
         f();
         const auto end = std::chrono::system_clock::now();
         total += std::chrono::duration_cast<D>(end - start);
     }
-    
+
     return D {total / num_tests};
 }
 
+// The work done by one iteration of a benchmark, reported as throughputs
+struct WorkCounts
+{
+    std::size_t reads = 0, cells = 0;
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    unsigned iterations;
+    std::chrono::nanoseconds time_per_iteration;
+    WorkCounts counts; // per iteration
+};
+
+// Runs f, which returns the WorkCounts of one iteration, once untimed and then until min_time has passed
+template <typename F>
+BenchmarkResult run_timed(std::string name, F f, const std::chrono::nanoseconds min_time)
+{
+    using Clock = std::chrono::steady_clock;
+    const WorkCounts counts {f()};
+    unsigned iterations {0};
+    const auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    do {
+        f();
+        ++iterations;
+        elapsed = Clock::now() - start;
+    } while (elapsed < min_time);
+    return {std::move(name), iterations, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed) / iterations, counts};
+}
+
+inline void write_header(std::ostream& os)
+{
+    os << std::left << std::setw(40) << "benchmark" << std::right << std::setw(12) << "iterations"
+       << std::setw(14) << "ms/iteration" << std::setw(14) << "reads/s" << std::setw(14) << "Mcells/s" << '\n';
+}
+
+inline std::ostream& operator<<(std::ostream& os, const BenchmarkResult& result)
+{
+    const auto seconds = std::chrono::duration<double> {result.time_per_iteration}.count();
+    const auto per_second = [=] (const std::size_t count) { return seconds > 0 ? count / seconds : 0.0; };
+    os << std::left << std::setw(40) << result.name << std::right << std::setw(12) << result.iterations
+       << std::setw(14) << std::fixed << std::setprecision(3) << (1e3 * seconds)
+       << std::setw(14) << std::setprecision(0) << per_second(result.counts.reads);
+    if (result.counts.cells > 0) {
+        os << std::setw(14) << std::setprecision(1) << (per_second(result.counts.cells) / 1e6);
+    } else {
+        os << std::setw(14) << '-';
+    }
+    return os;
+}
+
 #endif
@@ -0,0 +1,202 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "benchmark_window.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "io/reference/reference_reader.hpp"
+#include "basics/cigar_string.hpp"
+#include "core/types/allele.hpp"
+
+namespace octopus { namespace benchmark {
+
+MalformedWindowFile::MalformedWindowFile(const boost::filesystem::path& file, const std::size_t line_number,
+                                         const std::string& why)
+: std::runtime_error {file.string() + ":" + std::to_string(line_number) + ": " + why}
+{}
+
+namespace {
+
+// Reads closer than this to the window edges are skipped, as the haplotypes must cover the alignment band
+constexpr GenomicRegion::Size minReadFlank {50};
+
+const std::string defaultModel {"PCR-free.HiSeq-2500"};
+
+// The reference sequence of one region
+class WindowReference : public io::ReferenceReader
+{
+public:
+    WindowReference(GenomicRegion region, GeneticSequence sequence)
+    : region_ {std::move(region)}
+    , sequence_ {std::move(sequence)}
+    {}
+
+private:
+    GenomicRegion region_;
+    GeneticSequence sequence_;
+
+    std::unique_ptr<ReferenceReader> do_clone() const override { return std::make_unique<WindowReference>(*this); }
+    bool do_is_open() const noexcept override { return true; }
+    std::string do_fetch_reference_name() const override { return "window"; }
+    std::vector<ContigName> do_fetch_contig_names() const override { return {region_.contig_name()}; }
+    GenomicSize do_fetch_contig_size(const ContigName&) const override { return region_.end(); }
+    GeneticSequence do_fetch_sequence(const GenomicRegion& region) const override
+    {
+        if (!contains(region_, region)) {
+            throw std::runtime_error {"WindowReference: requested region is outside the window"};
+        }
+        return sequence_.substr(region.begin() - region_.begin(), region_size(region));
+    }
+};
+
+auto make_read(std::string name, const GenomicRegion::ContigName& contig, const GenomicRegion::Position begin,
+               CigarString cigar, const AlignedRead::MappingQuality mapping_quality, const bool is_reverse,
+               std::string sequence, AlignedRead::BaseQualityVector base_qualities)
+{
+    AlignedRead::Flags flags {};
+    flags.reverse_mapped = is_reverse;
+    const GenomicRegion region {contig, begin, begin + reference_size<GenomicRegion::Position>(cigar)};
+    return AlignedRead {std::move(name), region, std::move(sequence), std::move(base_qualities), std::move(cigar),
+                        mapping_quality, flags, "", std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>> {}};
+}
+
+bool has_flanks(const AlignedRead& read, const GenomicRegion& window) noexcept
+{
+    return read.mapped_region().begin() >= window.begin() + minReadFlank
+           && read.mapped_region().end() + minReadFlank <= window.end();
+}
+
+struct WindowBuilder
+{
+    boost::optional<GenomicRegion> region = boost::none;
+    std::string reference_sequence = "", model = defaultModel;
+    std::vector<std::vector<Allele>> haplotype_alleles = {};
+    std::vector<AlignedRead> reads = {};
+
+    Window build()
+    {
+        Window result {*region, model, nullptr, {}, {}};
+        result.reference = std::make_shared<ReferenceGenome>(std::make_unique<WindowReference>(*region, reference_sequence));
+        for (const auto& alleles : haplotype_alleles) {
+            Haplotype::Builder builder {*region, *result.reference};
+            for (const auto& allele : alleles) builder.push_back(allele);
+            result.haplotypes.push_back(builder.build());
+        }
+        result.reads = std::move(reads);
+        return result;
+    }
+};
+
+} // namespace
+
+std::vector<Window> read_windows(const boost::filesystem::path& file)
+{
+    std::ifstream in {file.string()};
+    if (!in) throw std::runtime_error {"Could not open " + file.string()};
+    std::vector<Window> result {};
+    boost::optional<WindowBuilder> window {};
+    std::string line;
+    std::size_t line_number {0};
+    const auto make_error = [&] (const std::string& why) { return MalformedWindowFile {file, line_number, why}; };
+    while (std::getline(in, line)) {
+        ++line_number;
+        if (line.empty() || line.front() == '#') continue;
+        std::istringstream record {line};
+        std::string type;
+        record >> type;
+        if (type == "window") {
+            if (window) result.push_back(window->build());
+            std::string contig;
+            GenomicRegion::Position begin, end;
+            if (!(record >> contig >> begin >> end) || end < begin) throw make_error("bad window record");
+            window = WindowBuilder {};
+            window->region = GenomicRegion {contig, begin, end};
+            continue;
+        }
+        if (!window) throw make_error("record before the first window record");
+        const auto& region = *window->region;
+        if (type == "reference") {
+            record >> window->reference_sequence;
+            if (window->reference_sequence.size() != region_size(region)) throw make_error("reference sequence is not the window size");
+        } else if (type == "model") {
+            record >> window->model;
+        } else if (type == "haplotype") {
+            std::vector<Allele> alleles {};
+            GenomicRegion::Position begin, end;
+            std::string sequence;
+            while (record >> begin >> end >> sequence) {
+                if (sequence == ".") sequence.clear();
+                alleles.emplace_back(GenomicRegion {region.contig_name(), begin, end}, std::move(sequence));
+            }
+            window->haplotype_alleles.push_back(std::move(alleles));
+        } else if (type == "read") {
+            std::string name, cigar, strand, sequence, qualities;
+            GenomicRegion::Position begin;
+            unsigned mapping_quality;
+            if (!(record >> name >> begin >> cigar >> mapping_quality >> strand >> sequence >> qualities)
+                || sequence.size() != qualities.size()) {
+                throw make_error("bad read record");
+            }
+            AlignedRead::BaseQualityVector base_qualities(qualities.size());
+            std::transform(std::cbegin(qualities), std::cend(qualities), std::begin(base_qualities),
+                           [] (const char q) { return static_cast<AlignedRead::BaseQuality>(q - 33); });
+            auto read = make_read(std::move(name), region.contig_name(), begin, parse_cigar(cigar),
+                                  static_cast<AlignedRead::MappingQuality>(mapping_quality), strand == "-",
+                                  std::move(sequence), std::move(base_qualities));
+            if (has_flanks(read, region)) window->reads.push_back(std::move(read));
+        } else {
+            throw make_error("unknown record type " + type);
+        }
+    }
+    if (window) result.push_back(window->build());
+    return result;
+}
+
+std::vector<Window> make_random_windows(const std::size_t num_windows, const std::size_t num_reads, const std::size_t read_length)
+{
+    std::mt19937 generator {42};
+    const auto random_base = [&] () { return "ACGT"[generator() % 4]; };
+    const auto random_index = [&] (const std::size_t n) { return static_cast<std::size_t>(generator() % n); };
+    const std::size_t window_size {4 * read_length}, num_haplotypes {5};
+    std::vector<Window> result {};
+    result.reserve(num_windows);
+    for (std::size_t w {0}; w < num_windows; ++w) {
+        WindowBuilder window {};
+        const GenomicRegion::Position window_begin {static_cast<GenomicRegion::Position>(w * window_size)};
+        window.region = GenomicRegion {"random", window_begin, window_begin + static_cast<GenomicRegion::Position>(window_size)};
+        std::generate_n(std::back_inserter(window.reference_sequence), window_size, random_base);
+        // A reference haplotype and haplotypes with an SNV, insertion or deletion in the middle of the window
+        window.haplotype_alleles.emplace_back();
+        for (std::size_t h {1}; h < num_haplotypes; ++h) {
+            const auto pos = window_begin + static_cast<GenomicRegion::Position>(read_length + random_index(2 * read_length));
+            const auto ref_base = window.reference_sequence[pos - window_begin];
+            switch (h % 3) {
+                case 0: window.haplotype_alleles.push_back({Allele {GenomicRegion {"random", pos, pos + 1}, std::string(1, ref_base == 'A' ? 'C' : 'A')}}); break;
+                case 1: window.haplotype_alleles.push_back({Allele {GenomicRegion {"random", pos, pos}, std::string(1 + random_index(5), 'T')}}); break;
+                default: window.haplotype_alleles.push_back({Allele {GenomicRegion {"random", pos, pos + 1 + static_cast<GenomicRegion::Position>(random_index(5))}, ""}});
+            }
+        }
+        for (std::size_t r {0}; r < num_reads; ++r) {
+            const auto offset = minReadFlank + random_index(window_size - read_length - 2 * minReadFlank);
+            auto sequence = window.reference_sequence.substr(offset, read_length);
+            for (auto& base : sequence) if (random_index(100) == 0) base = random_base();
+            AlignedRead::BaseQualityVector base_qualities(read_length);
+            std::generate(std::begin(base_qualities), std::end(base_qualities),
+                          [&] () { return static_cast<AlignedRead::BaseQuality>(20 + random_index(21)); });
+            window.reads.push_back(make_read("read" + std::to_string(r), "random", window_begin + static_cast<GenomicRegion::Position>(offset),
+                                             parse_cigar(std::to_string(read_length) + "M"), 60, random_index(2) == 0,
+                                             std::move(sequence), std::move(base_qualities)));
+        }
+        result.push_back(window.build());
+    }
+    return result;
+}
+
+} // namespace benchmark
+} // namespace octopus
@@ -0,0 +1,59 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef benchmark_window_hpp
+#define benchmark_window_hpp
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include <boost/filesystem/path.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "basics/aligned_read.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "core/types/haplotype.hpp"
+
+namespace octopus { namespace benchmark {
+
+/*
+ A Window is the input to the likelihood calculation of one active region: the reads, the candidate
+ haplotypes, and the name of the sequence error model. Windows are replayed from files captured from
+ real data with capture_windows.py, which have one record per line:
+
+    window <contig> <begin> <end>
+    reference <sequence of the window region>
+    model <sequence error model label>
+    haplotype [<begin> <end> <allele sequence or .>]...
+    read <name> <begin> <cigar> <mapping quality> <+ or -> <sequence> <phred+33 base qualities>
+
+ where positions are 0-based and haplotype alleles are the variant alleles of the haplotype (none for
+ the reference haplotype). A file may hold any number of windows. Lines starting with # are ignored.
+ */
+struct Window
+{
+    GenomicRegion region;
+    std::string model;
+    std::shared_ptr<ReferenceGenome> reference; // of the window region only
+    std::vector<Haplotype> haplotypes;
+    std::vector<AlignedRead> reads;
+};
+
+class MalformedWindowFile : public std::runtime_error
+{
+public:
+    MalformedWindowFile(const boost::filesystem::path& file, std::size_t line_number, const std::string& why);
+};
+
+std::vector<Window> read_windows(const boost::filesystem::path& file);
+
+// Random windows, for when no captured windows are given
+std::vector<Window> make_random_windows(std::size_t num_windows = 10, std::size_t num_reads = 200,
+                                        std::size_t read_length = 150);
+
+} // namespace benchmark
+} // namespace octopus
+
+#endif
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+
+# Captures windows of real data for octopus_bench (see benchmark_window.hpp for the format).
+
+import argparse
+import pysam as ps
+
+def parse_region(region):
+    contig, rest = region.split(':')
+    start, end = rest.replace(',', '').split('-')
+    return contig, int(start) - 1, int(end)
+
+def trim_allele(pos, ref, alt):
+    while ref and alt and ref[0] == alt[0]:
+        ref, alt, pos = ref[1:], alt[1:], pos + 1
+    while ref and alt and ref[-1] == alt[-1]:
+        ref, alt = ref[:-1], alt[:-1]
+    return pos, pos + len(ref), alt if alt else '.'
+
+def variant_haplotypes(vcf, contig, begin, end):
+    result = []
+    for record in vcf.fetch(contig, begin, end):
+        if record.start < begin or record.stop > end or record.alts is None:
+            continue
+        for alt in record.alts:
+            if alt.startswith('<') or alt == '*':
+                continue
+            result.append(trim_allele(record.start, record.ref, alt))
+    return result
+
+def is_usable_read(read):
+    return not (read.is_unmapped or read.is_secondary or read.is_supplementary or read.is_duplicate) \
+        and read.query_sequence is not None and read.query_qualities is not None
+
+def write_window(out, bam, fasta, vcf, region, pad, model, max_reads):
+    contig, begin, end = parse_region(region)
+    begin, end = max(begin - pad, 0), min(end + pad, fasta.get_reference_length(contig))
+    out.write('window {} {} {}\n'.format(contig, begin, end))
+    out.write('reference {}\n'.format(fasta.fetch(contig, begin, end).upper()))
+    out.write('model {}\n'.format(model))
+    out.write('haplotype\n')
+    if vcf is not None:
+        for allele_begin, allele_end, sequence in variant_haplotypes(vcf, contig, begin, end):
+            out.write('haplotype {} {} {}\n'.format(allele_begin, allele_end, sequence))
+    num_reads = 0
+    for read in bam.fetch(contig, begin, end):
+        if not is_usable_read(read) or read.reference_start < begin or read.reference_end > end:
+            continue
+        qualities = ''.join(chr(q + 33) for q in read.query_qualities)
+        out.write('read {} {} {} {} {} {} {}\n'.format(read.query_name, read.reference_start, read.cigarstring,
+                                                      read.mapping_quality, '-' if read.is_reverse else '+',
+                                                      read.query_sequence.upper(), qualities))
+        num_reads += 1
+        if max_reads is not None and num_reads == max_reads:
+            break
+
+def main(args):
+    bam = ps.AlignmentFile(args.bam)
+    fasta = ps.FastaFile(args.reference)
+    vcf = ps.VariantFile(args.vcf) if args.vcf is not None else None
+    regions = list(args.regions)
+    if args.regions_file is not None:
+        with open(args.regions_file) as regions_file:
+            regions += [line.strip() for line in regions_file if line.strip()]
+    with open(args.output, 'w') as out:
+        for region in regions:
+            write_window(out, bam, fasta, vcf, region, args.pad, args.model, args.max_reads)
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--bam', type=str, required=True, help='Indexed BAM or CRAM file')
+    parser.add_argument('--reference', type=str, required=True, help='Indexed FASTA reference')
+    parser.add_argument('--vcf', type=str, help='Indexed VCF of candidate variants; each ALT allele in a window becomes a haplotype')
+    parser.add_argument('--regions', type=str, nargs='*', default=[], help='Regions to capture (chr:start-end, 1-based)')
+    parser.add_argument('--regions-file', type=str, help='File with one region per line')
+    parser.add_argument('--pad', type=int, default=200, help='Padding added to each region so reads fit inside the window')
+    parser.add_argument('--model', type=str, default='PCR-free.HiSeq-2500', help='Sequence error model label')
+    parser.add_argument('--max-reads', type=int, help='Maximum reads captured per window')
+    parser.add_argument('--output', type=str, required=True, help='Output window file')
+    parsed, unparsed = parser.parse_known_args()
+    main(parsed)
@@ -0,0 +1,403 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+// Replays windows of reads and haplotypes (see benchmark_window.hpp) through the haplotype likelihood
+// model, the pair HMM kernels of each supported instruction set, the variational Bayes mixture model
+// and the assembler, and reports the throughput of each.
+//
+// usage: octopus_bench [--windows FILE...] [--filter REGEX] [--min-time SECONDS] [--list]
+//
+// Random windows are used if no window files are given. Benchmarks run over every window in each iteration.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <regex>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#include "basics/aligned_read.hpp"
+#include "core/types/haplotype.hpp"
+#include "core/models/haplotype_likelihood_model.hpp"
+#include "core/models/haplotype_likelihood_array.hpp"
+#include "core/models/error/error_model_factory.hpp"
+#include "core/models/genotype/variational_bayes_mixture_model.hpp"
+#include "core/models/pairhmm/simd_pair_hmm_kernels.hpp"
+#include "core/tools/vargen/utils/assembler.hpp"
+#include "benchmark/benchmark_utils.hpp"
+#include "benchmark/benchmark_window.hpp"
+
+using namespace octopus;
+using octopus::benchmark::Window;
+
+namespace {
+
+struct Benchmark
+{
+    std::string name;
+    std::function<WorkCounts()> run;
+};
+
+// Cells in the band of a banded pair HMM alignment
+std::size_t count_cells(const std::size_t target_length, const int band_size) noexcept
+{
+    return 2 * static_cast<std::size_t>(band_size) * target_length;
+}
+
+std::size_t count_reads(const std::vector<Window>& windows) noexcept
+{
+    return std::accumulate(std::cbegin(windows), std::cend(windows), std::size_t {0},
+                           [] (auto curr, const Window& window) { return curr + window.reads.size(); });
+}
+
+// HaplotypeLikelihoodModel
+
+std::vector<HaplotypeLikelihoodModel> make_likelihood_models(const std::vector<Window>& windows)
+{
+    std::vector<HaplotypeLikelihoodModel> result {};
+    result.reserve(windows.size());
+    for (const auto& window : windows) {
+        result.push_back(make_haplotype_likelihood_model(window.model));
+    }
+    return result;
+}
+
+Benchmark make_likelihood_model_benchmark(const std::vector<Window>& windows)
+{
+    auto models = std::make_shared<std::vector<HaplotypeLikelihoodModel>>(make_likelihood_models(windows));
+    return {"likelihood_model/evaluate", [&windows, models] () {
+        WorkCounts result {};
+        for (std::size_t w {0}; w < windows.size(); ++w) {
+            auto& model = (*models)[w];
+            for (const auto& haplotype : windows[w].haplotypes) {
+                model.reset(haplotype);
+                for (const auto& read : windows[w].reads) {
+                    model.evaluate(read);
+                    ++result.reads;
+                    result.cells += count_cells(sequence_size(read), model.pad_requirement());
+                }
+            }
+        }
+        return result;
+    }};
+}
+
+Benchmark make_batched_likelihood_model_benchmark(const std::vector<Window>& windows)
+{
+    auto models = std::make_shared<std::vector<HaplotypeLikelihoodModel>>(make_likelihood_models(windows));
+    return {"likelihood_model/evaluate_batched", [&windows, models] () {
+        static const HaplotypeLikelihoodModel::MappingPositionVector no_mapping_positions {};
+        std::vector<const AlignedRead*> reads {};
+        std::vector<HaplotypeLikelihoodModel::MappingPositionRange> mapping_positions {};
+        std::vector<HaplotypeLikelihoodModel::LogProbability> likelihoods {};
+        WorkCounts result {};
+        for (std::size_t w {0}; w < windows.size(); ++w) {
+            auto& model = (*models)[w];
+            reads.clear();
+            for (const auto& read : windows[w].reads) reads.push_back(&read);
+            mapping_positions.assign(reads.size(), {std::cbegin(no_mapping_positions), std::cend(no_mapping_positions)});
+            for (const auto& haplotype : windows[w].haplotypes) {
+                model.reset(haplotype);
+                model.evaluate(reads, mapping_positions, likelihoods);
+                for (const auto& read : windows[w].reads) {
+                    ++result.reads;
+                    result.cells += count_cells(sequence_size(read), model.pad_requirement());
+                }
+            }
+        }
+        return result;
+    }};
+}
+
+// Pair HMM kernels
+
+struct HaplotypeModel
+{
+    const std::string* sequence;
+    std::vector<char> forward_snv_mask, reverse_snv_mask;
+    hmm::PenaltyVector forward_snv_priors, reverse_snv_priors, gap_open, gap_extend;
+};
+
+// The alignments of every read against every haplotype that covers the read's band
+struct AlignmentSet
+{
+    std::vector<HaplotypeModel> haplotypes;
+    std::vector<hmm::simd::BatchLane> lanes; // sorted by target length
+    std::vector<int> target_lengths;
+};
+
+std::shared_ptr<const AlignmentSet> make_alignments(const std::vector<Window>& windows, const int band_size)
+{
+    auto result = std::make_shared<AlignmentSet>();
+    std::size_t num_haplotypes {0};
+    for (const auto& window : windows) num_haplotypes += window.haplotypes.size();
+    result->haplotypes.reserve(num_haplotypes);
+    std::vector<std::pair<int, hmm::simd::BatchLane>> alignments {};
+    for (const auto& window : windows) {
+        const auto error_model = make_error_model(window.model);
+        for (const auto& haplotype : window.haplotypes) {
+            HaplotypeModel model {std::addressof(haplotype.sequence()), {}, {}, {}, {}, {}, {}};
+            error_model.snv->evaluate(haplotype, model.forward_snv_mask, model.forward_snv_priors,
+                                      model.reverse_snv_mask, model.reverse_snv_priors);
+            error_model.indel->set_penalties(haplotype, model.gap_open, model.gap_extend);
+            result->haplotypes.push_back(std::move(model));
+            const auto& haplotype_model = result->haplotypes.back();
+            const auto haplotype_length = static_cast<int>(haplotype.sequence().size());
+            for (const auto& read : window.reads) {
+                const auto target_length = static_cast<int>(sequence_size(read));
+                const auto offset = static_cast<int>(read.mapped_region().begin() - haplotype.mapped_region().begin()) - band_size;
+                if (offset < 0 || offset + target_length + 2 * band_size - 1 > haplotype_length) continue;
+                const auto is_forward = !read.is_marked_reverse_mapped();
+                const auto& snv_mask = is_forward ? haplotype_model.forward_snv_mask : haplotype_model.reverse_snv_mask;
+                const auto& snv_priors = is_forward ? haplotype_model.forward_snv_priors : haplotype_model.reverse_snv_priors;
+                alignments.push_back({target_length, {haplotype_model.sequence->data() + offset, read.sequence().data(),
+                                                      reinterpret_cast<const std::int8_t*>(read.base_qualities().data()),
+                                                      snv_mask.data() + offset, snv_priors.data() + offset,
+                                                      haplotype_model.gap_open.data() + offset,
+                                                      haplotype_model.gap_extend.data() + offset}});
+            }
+        }
+    }
+    std::stable_sort(std::begin(alignments), std::end(alignments),
+                     [] (const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    for (const auto& alignment : alignments) {
+        result->target_lengths.push_back(alignment.first);
+        result->lanes.push_back(alignment.second);
+    }
+    return result;
+}
+
+const short nucPrior {2};
+
+Benchmark make_pair_hmm_benchmark(const std::vector<Window>& windows, const hmm::simd::PairHMMKernelSet& kernels,
+                                  const bool use_int32, const std::size_t band_idx)
+{
+    const auto& kernel = (use_int32 ? kernels.int32 : kernels.int16)[band_idx];
+    const auto alignments = make_alignments(windows, kernel.band_size);
+    return {std::string {"pair_hmm/"} + to_string(kernels.instruction_set) + (use_int32 ? "/int32" : "/int16")
+            + "/band" + std::to_string(kernel.band_size), [&kernel, alignments] () {
+        const auto align = std::get<0>(kernel.alignment).align_with_snv_mask;
+        WorkCounts result {};
+        for (std::size_t i {0}; i < alignments->lanes.size(); ++i) {
+            const auto& lane = alignments->lanes[i];
+            const auto target_length = alignments->target_lengths[i];
+            align(lane.truth, lane.target, lane.qualities, target_length + 2 * kernel.band_size - 1, target_length,
+                  lane.snv_mask, lane.snv_prior, lane.gap_open, lane.gap_extend, nucPrior);
+            ++result.reads;
+            result.cells += count_cells(target_length, kernel.band_size);
+        }
+        return result;
+    }};
+}
+
+Benchmark make_batched_pair_hmm_benchmark(const std::vector<Window>& windows, const hmm::simd::PairHMMKernelSet& kernels,
+                                          const bool use_int32)
+{
+    const auto& kernel = use_int32 ? kernels.batched_int32 : kernels.batched_int16;
+    const int band_size {8};
+    const auto alignments = make_alignments(windows, band_size);
+    return {std::string {"batched_pair_hmm/"} + to_string(kernels.instruction_set) + (use_int32 ? "/int32" : "/int16")
+            + "/band" + std::to_string(band_size), [&kernel, alignments] () {
+        std::vector<int> scores(kernel.batch_size);
+        WorkCounts result {};
+        const auto num_alignments = alignments->lanes.size();
+        for (std::size_t first {0}; first < num_alignments;) {
+            // Batches can only contain alignments with the same target length
+            const auto target_length = alignments->target_lengths[first];
+            auto last = first;
+            while (last < num_alignments && last - first < static_cast<std::size_t>(kernel.batch_size)
+                   && alignments->target_lengths[last] == target_length) ++last;
+            kernel.align(alignments->lanes.data() + first, static_cast<int>(last - first),
+                         target_length + 2 * band_size - 1, target_length, band_size, nucPrior, scores.data());
+            result.reads += last - first;
+            result.cells += (last - first) * count_cells(target_length, band_size);
+            first = last;
+        }
+        return result;
+    }};
+}
+
+std::vector<const hmm::simd::PairHMMKernelSet*> get_supported_kernels()
+{
+    using namespace hmm::simd;
+    std::vector<const PairHMMKernelSet*> result {};
+    for (const auto kernels : {sse2_kernels(), avx2_kernels(), avx512_kernels(), neon_kernels(), sve_kernels()}) {
+        if (kernels && is_supported(kernels->instruction_set)) result.push_back(kernels);
+    }
+    return result;
+}
+
+// Variational Bayes mixture model
+
+// The likelihoods of the reads in one window, and the genotypes of two haplotypes for the model
+struct VBInputs
+{
+    std::vector<std::vector<HaplotypeLikelihoodArray::LogProbability>> likelihoods; // per haplotype
+    std::vector<HaplotypeLikelihoodArray::LikelihoodVector> likelihood_views;
+    model::VBReadLikelihoodMatrix<2> genotype_likelihoods;
+    model::LogProbabilityVector genotype_log_priors;
+};
+
+std::shared_ptr<std::vector<VBInputs>> make_vb_inputs(const std::vector<Window>& windows)
+{
+    auto result = std::make_shared<std::vector<VBInputs>>(windows.size());
+    auto models = make_likelihood_models(windows);
+    for (std::size_t w {0}; w < windows.size(); ++w) {
+        auto& inputs = (*result)[w];
+        const auto& window = windows[w];
+        for (const auto& haplotype : window.haplotypes) {
+            models[w].reset(haplotype);
+            std::vector<HaplotypeLikelihoodArray::LogProbability> likelihoods {};
+            likelihoods.reserve(window.reads.size());
+            for (const auto& read : window.reads) likelihoods.push_back(models[w].evaluate(read));
+            inputs.likelihoods.push_back(std::move(likelihoods));
+        }
+        for (const auto& likelihoods : inputs.likelihoods) inputs.likelihood_views.emplace_back(likelihoods.data(), likelihoods.size());
+        model::VBGenotypeVector<2> genotypes {};
+        for (std::size_t i {0}; i < inputs.likelihood_views.size(); ++i) {
+            for (std::size_t j {i}; j < inputs.likelihood_views.size(); ++j) {
+                genotypes.push_back({model::VBReadLikelihoodArray {inputs.likelihood_views[i]},
+                                     model::VBReadLikelihoodArray {inputs.likelihood_views[j]}});
+            }
+        }
+        inputs.genotype_log_priors.assign(genotypes.size(), -std::log(static_cast<double>(genotypes.size())));
+        inputs.genotype_likelihoods.push_back(std::move(genotypes));
+    }
+    return result;
+}
+
+Benchmark make_vb_benchmark(const std::vector<Window>& windows)
+{
+    auto inputs = make_vb_inputs(windows);
+    return {"variational_bayes/k2", [&windows, inputs] () {
+        const model::VBAlphaVector<2> prior_alphas {{1.0f, 1.0f}};
+        const model::VariationalBayesParameters params {};
+        WorkCounts result {};
+        for (std::size_t w {0}; w < windows.size(); ++w) {
+            const auto& window_inputs = (*inputs)[w];
+            if (window_inputs.genotype_log_priors.empty() || windows[w].reads.empty()) continue;
+            std::vector<model::LogProbabilityVector> seeds {window_inputs.genotype_log_priors};
+            model::run_variational_bayes(prior_alphas, window_inputs.genotype_log_priors, window_inputs.genotype_likelihoods,
+                                         params, std::move(seeds));
+            result.reads += windows[w].reads.size();
+        }
+        return result;
+    }};
+}
+
+// Assembler
+
+Benchmark make_assembler_benchmark(const std::vector<Window>& windows, const unsigned kmer_size)
+{
+    return {"assembler/k" + std::to_string(kmer_size), [&windows, kmer_size] () {
+        using coretools::Assembler;
+        WorkCounts result {};
+        for (const auto& window : windows) {
+            try {
+                Assembler assembler {{kmer_size}, window.reference->fetch_sequence(window.region)};
+                for (const auto& read : window.reads) {
+                    assembler.insert_read(read.sequence(), read.base_qualities(),
+                                          read.is_marked_reverse_mapped() ? Assembler::Direction::reverse : Assembler::Direction::forward, 0);
+                }
+                assembler.try_recover_dangling_branches();
+                assembler.prune(2);
+                if (!assembler.is_acyclic()) assembler.remove_nonreference_cycles();
+                assembler.cleanup();
+                if (!assembler.is_empty() && !assembler.is_all_reference()) {
+                    assembler.extract_variants(20, [] (std::size_t, std::size_t) { return 2.0; });
+                }
+            } catch (const Assembler::NonCanonicalReferenceSequence&) {
+                continue;
+            } catch (const Assembler::NonUniqueReferenceSequence&) {
+                continue;
+            }
+            result.reads += window.reads.size();
+        }
+        return result;
+    }};
+}
+
+std::vector<Benchmark> make_benchmarks(const std::vector<Window>& windows)
+{
+    std::vector<Benchmark> result {};
+    result.push_back(make_likelihood_model_benchmark(windows));
+    result.push_back(make_batched_likelihood_model_benchmark(windows));
+    for (const auto kernels : get_supported_kernels()) {
+        for (const std::size_t band_idx : {0, 1, 2}) {
+            result.push_back(make_pair_hmm_benchmark(windows, *kernels, false, band_idx));
+        }
+        result.push_back(make_pair_hmm_benchmark(windows, *kernels, true, 0));
+        result.push_back(make_batched_pair_hmm_benchmark(windows, *kernels, false));
+        result.push_back(make_batched_pair_hmm_benchmark(windows, *kernels, true));
+    }
+    result.push_back(make_vb_benchmark(windows));
+    for (const unsigned kmer_size : {10u, 25u}) {
+        result.push_back(make_assembler_benchmark(windows, kmer_size));
+    }
+    return result;
+}
+
+struct Options
+{
+    std::vector<std::string> window_files = {};
+    std::regex filter {".*"};
+    std::chrono::nanoseconds min_time = std::chrono::seconds {1};
+    bool list = false;
+};
+
+Options parse_options(const int argc, char** argv)
+{
+    Options result {};
+    for (int i {1}; i < argc; ++i) {
+        const std::string arg {argv[i]};
+        if (arg == "--windows") {
+            while (i + 1 < argc && argv[i + 1][0] != '-') result.window_files.emplace_back(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            result.filter = std::regex {argv[++i]};
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            result.min_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double> {std::atof(argv[++i])});
+        } else if (arg == "--list") {
+            result.list = true;
+        } else {
+            throw std::invalid_argument {"unknown option " + arg};
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    try {
+        const auto options = parse_options(argc, argv);
+        std::vector<Window> windows {};
+        for (const auto& file : options.window_files) {
+            auto file_windows = benchmark::read_windows(file);
+            std::move(std::begin(file_windows), std::end(file_windows), std::back_inserter(windows));
+        }
+        if (options.window_files.empty()) windows = benchmark::make_random_windows();
+        std::cout << "Windows: " << windows.size() << ", reads: " << count_reads(windows)
+                  << ", pair HMM instruction set: " << to_string(hmm::simd::get_instruction_set()) << '\n';
+        const auto benchmarks = make_benchmarks(windows);
+        if (!options.list) write_header(std::cout);
+        for (const auto& benchmark : benchmarks) {
+            if (!std::regex_search(benchmark.name, options.filter)) continue;
+            if (options.list) {
+                std::cout << benchmark.name << '\n';
+            } else {
+                std::cout << run_timed(benchmark.name, benchmark.run, options.min_time) << std::endl;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "octopus_bench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+// Compares the throughput of the single alignment (intra-alignment) pair HMM with the
+// batched (inter-alignment) pair HMM, for reads of the same length against random haplotypes.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+#include <cstdint>
+
+#include "core/models/pairhmm/simd_pair_hmm_factory.hpp"
+#include "core/models/pairhmm/batched_pair_hmm.hpp"
+#include "benchmark/benchmark_utils.hpp"
+
+using namespace octopus::hmm::simd;
+
+namespace {
+
+struct AlignmentSet
+{
+    std::vector<std::string> truths, targets, snv_masks;
+    std::vector<std::vector<std::int8_t>> qualities, snv_priors, gap_opens, gap_extends;
+};
+
+AlignmentSet make_alignments(const int num_alignments, const int truth_len, const int target_len, const int band_size)
+{
+    std::mt19937 generator {42};
+    const auto random_base = [&] () { return "ACGT"[generator() % 4]; };
+    AlignmentSet result {};
+    for (int i {0}; i < num_alignments; ++i) {
+        std::string truth {};
+        std::generate_n(std::back_inserter(truth), truth_len, random_base);
+        auto target = truth.substr(generator() % band_size, target_len);
+        for (auto& base : target) if (generator() % 50 == 0) base = random_base();
+        std::string snv_mask {};
+        std::generate_n(std::back_inserter(snv_mask), truth_len, random_base);
+        std::vector<std::int8_t> qualities(target_len), snv_priors(truth_len), gap_opens(truth_len), gap_extends(truth_len, 3);
+        std::generate(std::begin(qualities), std::end(qualities), [&] () { return 20 + generator() % 21; });
+        std::generate(std::begin(snv_priors), std::end(snv_priors), [&] () { return 30 + generator() % 20; });
+        std::generate(std::begin(gap_opens), std::end(gap_opens), [&] () { return 20 + generator() % 40; });
+        result.truths.push_back(std::move(truth));
+        result.targets.push_back(std::move(target));
+        result.snv_masks.push_back(std::move(snv_mask));
+        result.qualities.push_back(std::move(qualities));
+        result.snv_priors.push_back(std::move(snv_priors));
+        result.gap_opens.push_back(std::move(gap_opens));
+        result.gap_extends.push_back(std::move(gap_extends));
+    }
+    return result;
+}
+
+template <int BandSize, typename ScoreType>
+void run_benchmark(const int target_len, const int num_alignments, const unsigned num_tests)
+{
+    const SimdPairHMM<BandSize, ScoreType> hmm {};
+    const BatchedSimdPairHMM<ScoreType> batched_hmm {};
+    const int truth_len {target_len + 2 * BandSize - 1};
+    const auto alignments = make_alignments(num_alignments, truth_len, target_len, BandSize);
+    const short nuc_prior {4};
+    std::vector<int> single_scores(num_alignments), batched_scores(num_alignments);
+    const auto single_time = benchmark<std::chrono::microseconds>([&] () {
+        for (int i {0}; i < num_alignments; ++i) {
+            single_scores[i] = hmm.align(alignments.truths[i].data(), alignments.targets[i].data(), alignments.qualities[i].data(),
+                                         truth_len, target_len, alignments.snv_masks[i].data(), alignments.snv_priors[i].data(),
+                                         alignments.gap_opens[i].data(), alignments.gap_extends[i].data(), nuc_prior);
+        }
+    }, num_tests);
+    const int batch_size {batched_hmm.batch_size()};
+    std::vector<typename BatchedSimdPairHMM<ScoreType>::Lane> lanes(num_alignments);
+    for (int i {0}; i < num_alignments; ++i) {
+        lanes[i] = {alignments.truths[i].data(), alignments.targets[i].data(), alignments.qualities[i].data(),
+                    alignments.snv_masks[i].data(), alignments.snv_priors[i].data(),
+                    alignments.gap_opens[i].data(), alignments.gap_extends[i].data()};
+    }
+    const auto batched_time = benchmark<std::chrono::microseconds>([&] () {
+        for (int i {0}; i < num_alignments; i += batch_size) {
+            const auto num_lanes = std::min(batch_size, num_alignments - i);
+            batched_hmm.align(lanes.data() + i, num_lanes, truth_len, target_len, BandSize, nuc_prior, batched_scores.data() + i);
+        }
+    }, num_tests);
+    const auto throughput = [=] (const std::chrono::microseconds time) {
+        return time.count() > 0 ? 1e6 * num_alignments / time.count() : 0.0;
+    };
+    std::cout << std::setw(8) << hmm.name() << std::setw(6) << BandSize << std::setw(8) << (sizeof(ScoreType) * 8)
+              << std::setw(8) << target_len << std::setw(8) << batched_hmm.name() << std::setw(6) << batch_size
+              << std::setw(14) << std::fixed << std::setprecision(0) << throughput(single_time)
+              << std::setw(14) << throughput(batched_time)
+              << std::setw(10) << std::setprecision(2) << (throughput(single_time) > 0 ? throughput(batched_time) / throughput(single_time) : 0.0)
+              << (single_scores == batched_scores ? "" : "  (scores differ!)") << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+    const int num_alignments {10000};
+    const unsigned num_tests {5};
+    std::cout << std::setw(8) << "single" << std::setw(6) << "band" << std::setw(8) << "bits"
+              << std::setw(8) << "length" << std::setw(8) << "batched" << std::setw(6) << "lanes"
+              << std::setw(14) << "single aln/s" << std::setw(14) << "batched aln/s" << std::setw(10) << "speedup" << std::endl;
+    for (const int target_len : {100, 150, 250}) {
+        run_benchmark<8, short>(target_len, num_alignments, num_tests);
+        run_benchmark<16, short>(target_len, num_alignments, num_tests);
+        run_benchmark<32, short>(target_len, num_alignments, num_tests);
+        run_benchmark<8, int>(target_len, num_alignments, num_tests);
+        run_benchmark<16, int>(target_len, num_alignments, num_tests);
+    }
+    return 0;
+}
@@ -0,0 +1,356 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+// Runs only the read input stages of a calling run - ReadManager, ReadPipe (transforms, filters and
+// downsampling) and BufferedReadPipe - over the search regions of an octopus command line, so changes
+// to read decoding, htslib threading, read packing and prefetching can be measured without calling.
+// Each stage is run with each thread count and reports records/s, decoded read bytes/s (the footprint
+// of the fetched reads) and the number of C++ heap allocations. The time taken by each read filter
+// is reported separately.
+//
+// usage: octopus_bench_io [--threads N...] [--window-size BP] [--min-time SECONDS] [--filter REGEX] -- OCTOPUS_OPTIONS
+//
+// OCTOPUS_OPTIONS are the usual octopus options (e.g. -R ref.fa -I reads.bam -T chr20:1,000,000-2,000,000)
+// and must not include --threads. Search regions are fetched in windows of --window-size (default 10,000),
+// like calling tasks.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <regex>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#include "config/common.hpp"
+#include "config/option_parser.hpp"
+#include "config/option_collation.hpp"
+#include "basics/genomic_region.hpp"
+#include "basics/aligned_read.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "io/read/read_manager.hpp"
+#include "readpipe/read_pipe.hpp"
+#include "readpipe/buffered_read_pipe.hpp"
+#include "utils/thread_pool.hpp"
+
+namespace {
+
+// Counts every C++ heap allocation in the process. htslib allocates with malloc so is not counted.
+struct AllocationCounts
+{
+    std::size_t allocations = 0, bytes = 0;
+};
+
+std::atomic<std::size_t> num_allocations {0}, num_allocated_bytes {0};
+
+AllocationCounts get_allocation_counts() noexcept
+{
+    return {num_allocations.load(std::memory_order_relaxed), num_allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+} // namespace
+
+void* operator new(const std::size_t size)
+{
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    num_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (auto result = std::malloc(size > 0 ? size : 1)) return result;
+    throw std::bad_alloc {};
+}
+
+void* operator new[](const std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+using namespace octopus;
+
+namespace {
+
+// The work done by one iteration of a benchmark
+struct IOCounts
+{
+    std::size_t records = 0, bytes = 0;
+    AllocationCounts allocations = {};
+};
+
+struct IOBenchmark
+{
+    std::string name;
+    std::function<IOCounts()> run;
+};
+
+struct IOBenchmarkResult
+{
+    std::string name;
+    unsigned iterations;
+    std::chrono::nanoseconds time_per_iteration;
+    IOCounts counts; // per iteration
+};
+
+template <typename Map>
+void add_reads(const Map& reads, IOCounts& counts) noexcept
+{
+    for (const auto& p : reads) {
+        counts.records += p.second.size();
+        counts.bytes += footprint(p.second).bytes();
+    }
+}
+
+// Runs the benchmark once untimed, to warm the file system cache, and then until min_time has passed
+IOBenchmarkResult run_timed(const IOBenchmark& benchmark, const std::chrono::nanoseconds min_time)
+{
+    using Clock = std::chrono::steady_clock;
+    benchmark.run();
+    const auto allocations_before = get_allocation_counts();
+    IOCounts counts {benchmark.run()};
+    const auto allocations_after = get_allocation_counts();
+    counts.allocations = {allocations_after.allocations - allocations_before.allocations,
+                          allocations_after.bytes - allocations_before.bytes};
+    unsigned iterations {0};
+    const auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    do {
+        benchmark.run();
+        ++iterations;
+        elapsed = Clock::now() - start;
+    } while (elapsed < min_time);
+    return {benchmark.name, iterations, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed) / iterations, counts};
+}
+
+void write_header(std::ostream& os)
+{
+    os << std::left << std::setw(32) << "benchmark" << std::right << std::setw(12) << "iterations"
+       << std::setw(14) << "ms/iteration" << std::setw(14) << "records/s" << std::setw(12) << "MB/s"
+       << std::setw(14) << "allocations" << std::setw(14) << "alloc MB" << '\n';
+}
+
+std::ostream& operator<<(std::ostream& os, const IOBenchmarkResult& result)
+{
+    const auto seconds = std::chrono::duration<double> {result.time_per_iteration}.count();
+    const auto per_second = [=] (const std::size_t count) { return seconds > 0 ? count / seconds : 0.0; };
+    os << std::left << std::setw(32) << result.name << std::right << std::setw(12) << result.iterations
+       << std::setw(14) << std::fixed << std::setprecision(3) << (1e3 * seconds)
+       << std::setw(14) << std::setprecision(0) << per_second(result.counts.records)
+       << std::setw(12) << std::setprecision(1) << (per_second(result.counts.bytes) / 1e6)
+       << std::setw(14) << result.counts.allocations.allocations
+       << std::setw(14) << std::setprecision(1) << (result.counts.allocations.bytes / 1e6);
+    return os;
+}
+
+struct Options
+{
+    std::vector<unsigned> thread_counts = {1};
+    GenomicRegion::Size window_size = 10'000;
+    std::chrono::nanoseconds min_time = std::chrono::seconds {1};
+    std::regex filter {".*"};
+    std::vector<std::string> octopus_options = {};
+};
+
+Options parse_options(const int argc, char** argv)
+{
+    Options result {};
+    int i {1};
+    for (; i < argc; ++i) {
+        const std::string arg {argv[i]};
+        if (arg == "--") {
+            ++i;
+            break;
+        } else if (arg == "--threads") {
+            result.thread_counts.clear();
+            while (i + 1 < argc && argv[i + 1][0] != '-') result.thread_counts.push_back(std::stoul(argv[++i]));
+            if (result.thread_counts.empty() || std::count(std::cbegin(result.thread_counts), std::cend(result.thread_counts), 0u) > 0) {
+                throw std::invalid_argument {"--threads requires positive counts"};
+            }
+        } else if (arg == "--window-size" && i + 1 < argc) {
+            result.window_size = std::stoul(argv[++i]);
+            if (result.window_size == 0) throw std::invalid_argument {"--window-size must be positive"};
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            result.min_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double> {std::atof(argv[++i])});
+        } else if (arg == "--filter" && i + 1 < argc) {
+            result.filter = std::regex {argv[++i]};
+        } else {
+            throw std::invalid_argument {"unknown option " + arg};
+        }
+    }
+    for (; i < argc; ++i) result.octopus_options.emplace_back(argv[i]);
+    if (result.octopus_options.empty()) throw std::invalid_argument {"no octopus options given after --"};
+    return result;
+}
+
+options::OptionMap parse_octopus_options(const Options& options, const unsigned num_threads)
+{
+    std::vector<std::string> args {"octopus"};
+    args.insert(std::cend(args), std::cbegin(options.octopus_options), std::cend(options.octopus_options));
+    args.push_back("--threads=" + std::to_string(num_threads));
+    std::vector<const char*> argv {};
+    argv.reserve(args.size());
+    for (const auto& arg : args) argv.push_back(arg.c_str());
+    return options::parse_options(static_cast<int>(argv.size()), argv.data());
+}
+
+std::vector<GenomicRegion> make_windows(const InputRegionMap& search_regions, const GenomicRegion::Size window_size)
+{
+    std::vector<GenomicRegion> result {};
+    for (const auto& p : search_regions) {
+        for (const auto& region : p.second) {
+            for (auto begin = region.begin(); begin < region.end(); begin += window_size) {
+                result.emplace_back(region.contig_name(), begin, std::min(begin + window_size, region.end()));
+            }
+        }
+    }
+    return result;
+}
+
+// The read input stages of a calling run with one thread count
+struct ReadInput
+{
+    ReadInput(const options::OptionMap& options, const GenomicRegion::Size window_size)
+    : reference {options::make_reference(options)}
+    , read_manager {options::make_read_manager(options)}
+    , samples {options::get_user_samples(options).value_or(read_manager.samples())}
+    , read_pipe {options::make_read_pipe(read_manager, reference, samples, options)}
+    , filterer {options::make_read_filterer(options)}
+    , windows {make_windows(options::get_search_regions(options, reference), window_size)}
+    , read_buffer_size {options::get_target_read_buffer_size(options).bytes()}
+    , compress_read_buffer {options::compress_read_buffer(options)}
+    {}
+
+    ReferenceGenome reference;
+    ReadManager read_manager;
+    std::vector<SampleName> samples;
+    ReadPipe read_pipe;
+    ReadPipe::ReadFilterer filterer;
+    std::vector<GenomicRegion> windows;
+    std::size_t read_buffer_size;
+    bool compress_read_buffer;
+};
+
+IOBenchmark make_read_manager_benchmark(const ReadInput& input, const std::string& suffix)
+{
+    return {"read_manager/fetch" + suffix, [&input] () {
+        IOCounts result {};
+        for (const auto& window : input.windows) {
+            add_reads(input.read_manager.fetch_reads(input.samples, window), result);
+        }
+        return result;
+    }};
+}
+
+IOBenchmark make_read_pipe_benchmark(const ReadInput& input, const std::string& suffix, ThreadPool& workers)
+{
+    return {"read_pipe/fetch" + suffix, [&input, &workers] () {
+        IOCounts result {};
+        for (const auto& window : input.windows) {
+            add_reads(input.read_pipe.fetch_reads(window, boost::none, workers), result);
+        }
+        return result;
+    }};
+}
+
+IOBenchmark make_buffered_read_pipe_benchmark(const ReadInput& input, const std::string& suffix, const bool prefetch)
+{
+    return {"buffered_read_pipe/fetch" + suffix + (prefetch ? "/prefetch" : ""), [&input, prefetch] () {
+        BufferedReadPipe::Config config {input.read_buffer_size};
+        config.prefetch = prefetch;
+        config.compress = input.compress_read_buffer;
+        const BufferedReadPipe buffered_read_pipe {input.read_pipe, config, input.windows};
+        IOCounts result {};
+        for (const auto& window : input.windows) {
+            add_reads(buffered_read_pipe.fetch_reads(window), result);
+        }
+        return result;
+    }};
+}
+
+// The time each filter takes over the unfiltered reads of every window
+void write_filter_times(const ReadInput& input, std::ostream& os)
+{
+    ReadPipe::ReadFilterer::FilterTimeMap filter_times {};
+    std::size_t num_reads {0};
+    for (const auto& window : input.windows) {
+        auto reads = input.read_manager.fetch_reads(input.samples, window);
+        for (auto& p : reads) {
+            num_reads += p.second.size();
+            input.filterer.timed_remove(std::begin(p.second), std::end(p.second), filter_times);
+        }
+    }
+    std::vector<std::pair<std::string, std::chrono::nanoseconds>> sorted_times {std::cbegin(filter_times), std::cend(filter_times)};
+    std::sort(std::begin(sorted_times), std::end(sorted_times), [] (const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+    const auto total_time = std::accumulate(std::cbegin(sorted_times), std::cend(sorted_times), std::chrono::nanoseconds {0},
+                                            [] (auto curr, const auto& p) { return curr + p.second; });
+    os << '\n' << std::left << std::setw(48) << "filter" << std::right << std::setw(14) << "ms" << std::setw(10) << "%" << '\n';
+    for (const auto& p : sorted_times) {
+        const auto ms = std::chrono::duration<double, std::milli> {p.second}.count();
+        os << std::left << std::setw(48) << p.first << std::right << std::setw(14) << std::fixed << std::setprecision(3) << ms
+           << std::setw(10) << std::setprecision(1) << (total_time.count() > 0 ? 100.0 * p.second.count() / total_time.count() : 0.0) << '\n';
+    }
+    os << "Filtered " << num_reads << " reads" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    try {
+        const auto options = parse_options(argc, argv);
+        bool wrote_header {false};
+        std::ostringstream filter_times {};
+        for (const auto num_threads : options.thread_counts) {
+            const ReadInput input {parse_octopus_options(options, num_threads), options.window_size};
+            if (!wrote_header) {
+                std::cout << "Samples: " << input.samples.size() << ", windows: " << input.windows.size() << '\n';
+                write_header(std::cout);
+                wrote_header = true;
+            }
+            ThreadPool workers {num_threads};
+            const auto suffix = "/t" + std::to_string(num_threads);
+            std::vector<IOBenchmark> benchmarks {};
+            benchmarks.push_back(make_read_manager_benchmark(input, suffix));
+            benchmarks.push_back(make_read_pipe_benchmark(input, suffix, workers));
+            benchmarks.push_back(make_buffered_read_pipe_benchmark(input, suffix, false));
+            if (num_threads != 1) benchmarks.push_back(make_buffered_read_pipe_benchmark(input, suffix, true));
+            for (const auto& benchmark : benchmarks) {
+                if (std::regex_search(benchmark.name, options.filter)) {
+                    std::cout << run_timed(benchmark, options.min_time) << std::endl;
+                }
+            }
+            if (filter_times.tellp() == 0 && std::regex_search("read_filters", options.filter)) {
+                write_filter_times(input, filter_times);
+            }
+        }
+        std::cout << filter_times.str();
+    } catch (const std::exception& e) {
+        std::cerr << "octopus_bench_io: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
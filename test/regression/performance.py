@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+
+# Measures the run time and memory use of an octopus build against a baseline build on a pinned set of
+# datasets, records the measurements in an SQLite database, and fails if the test build is slower or uses
+# more memory than the baseline by more than --tolerance on any dataset.
+#
+# Datasets are given in a JSON file of the form
+#
+#   {
+#     "germline": {"reference": "ref.fa", "reads": ["NA12878.chr20.bam"], "regions": ["chr20:10M-20M"], "options": ""},
+#     "trio": {"reference": "ref.fa", "reads": ["mother.bam", "father.bam", "child.bam"],
+#              "options": "--maternal-sample NA12892 --paternal-sample NA12891"},
+#     ...
+#   }
+#
+# where relative paths are relative to the JSON file. Each dataset is run --repeats times with each build and
+# the median of each measurement is compared. Phase times are read from each run's --performance-report.
+
+import argparse
+import datetime
+import json
+import os
+import sqlite3
+import statistics
+import subprocess as sp
+import sys
+import time
+from pathlib import Path
+
+MEASURES = ['wall_seconds', 'cpu_seconds', 'peak_rss_mb']
+
+def read_datasets(datasets_path, names):
+    with datasets_path.open() as datasets_file:
+        datasets = json.load(datasets_file)
+    if names:
+        datasets = {name: datasets[name] for name in names}
+    def resolve(path):
+        path = Path(path)
+        return path if path.is_absolute() else datasets_path.parent / path
+    for dataset in datasets.values():
+        dataset['reference'] = resolve(dataset['reference'])
+        dataset['reads'] = [resolve(reads) for reads in dataset['reads']]
+    return datasets
+
+def run_octopus(octopus, dataset, out_dir, threads):
+    out_dir.mkdir(parents=True, exist_ok=True)
+    report = out_dir / 'performance.json'
+    command = [str(octopus), '-R', str(dataset['reference']), '-I'] + [str(r) for r in dataset['reads']]
+    command += ['-o', str(out_dir / 'calls.vcf.gz'), '--performance-report', str(report), '--threads', str(threads)]
+    if 'regions' in dataset:
+        command += ['-T'] + dataset['regions']
+    if dataset.get('options'):
+        command += dataset['options'].split()
+    start = time.monotonic()
+    with (out_dir / 'octopus.log').open('w') as log:
+        process = sp.Popen(command, stdout=log, stderr=sp.STDOUT)
+        # wait4 gives the resource use of just this run
+        _, status, usage = os.wait4(process.pid, 0)
+    wall_seconds = time.monotonic() - start
+    if status != 0:
+        raise RuntimeError('octopus failed on {} (see {})'.format(out_dir, out_dir / 'octopus.log'))
+    result = {'wall_seconds': wall_seconds,
+              'cpu_seconds': usage.ru_utime + usage.ru_stime,
+              'peak_rss_mb': usage.ru_maxrss / (1024 ** 2 if sys.platform == 'darwin' else 1024)}
+    if report.exists():
+        with report.open() as report_file:
+            phases = json.load(report_file)['phases']
+        result['phases'] = {phase: stats['total_seconds'] for phase, stats in phases.items()}
+    return result
+
+def median_measures(runs):
+    result = {measure: statistics.median(run[measure] for run in runs) for measure in MEASURES}
+    phases = set().union(*(run.get('phases', {}).keys() for run in runs))
+    result['phases'] = {phase: statistics.median(run.get('phases', {}).get(phase, 0) for run in runs) for phase in phases}
+    return result
+
+def open_database(path):
+    result = sqlite3.connect(str(path))
+    result.execute('''CREATE TABLE IF NOT EXISTS runs
+                      (time TEXT, label TEXT, build TEXT, dataset TEXT, repeat INTEGER,
+                       wall_seconds REAL, cpu_seconds REAL, peak_rss_mb REAL)''')
+    result.execute('''CREATE TABLE IF NOT EXISTS phases
+                      (time TEXT, label TEXT, build TEXT, dataset TEXT, repeat INTEGER, phase TEXT, seconds REAL)''')
+    return result
+
+def record(database, run_time, label, build, dataset, repeat, run):
+    database.execute('INSERT INTO runs VALUES (?, ?, ?, ?, ?, ?, ?, ?)',
+                     (run_time, label, build, dataset, repeat, run['wall_seconds'], run['cpu_seconds'], run['peak_rss_mb']))
+    for phase, seconds in run.get('phases', {}).items():
+        database.execute('INSERT INTO phases VALUES (?, ?, ?, ?, ?, ?, ?)',
+                         (run_time, label, build, dataset, repeat, phase, seconds))
+    database.commit()
+
+def main(options):
+    datasets = read_datasets(options.datasets, options.dataset)
+    database = open_database(options.database)
+    run_time = datetime.datetime.now().isoformat(timespec='seconds')
+    regressions = []
+    for name, dataset in datasets.items():
+        medians = {}
+        for build, octopus in [('baseline', options.baseline), ('test', options.test)]:
+            runs = []
+            for repeat in range(options.repeats):
+                run = run_octopus(octopus, dataset, options.out / name / build / str(repeat), options.threads)
+                record(database, run_time, options.label, build, name, repeat, run)
+                runs.append(run)
+            medians[build] = median_measures(runs)
+        print('{}:'.format(name))
+        for measure in MEASURES:
+            baseline, test = medians['baseline'][measure], medians['test'][measure]
+            change = (test - baseline) / baseline if baseline > 0 else 0
+            print('  {}: baseline {:.2f} test {:.2f} ({:+.1%})'.format(measure, baseline, test, change))
+            if change > options.tolerance:
+                regressions.append((name, measure, change))
+        for phase in sorted(medians['test']['phases']):
+            baseline = medians['baseline']['phases'].get(phase, 0)
+            test = medians['test']['phases'][phase]
+            if baseline > 0 or test > 0:
+                print('  phase {}: baseline {:.2f}s test {:.2f}s'.format(phase, baseline, test))
+    for name, measure, change in regressions:
+        print('Regression: {} {} is {:+.1%} on the baseline'.format(name, measure, change))
+    if regressions:
+        sys.exit(1)
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--baseline', type=Path, required=True, help='The octopus binary to compare against')
+    parser.add_argument('--test', type=Path, required=True, help='The octopus binary to test')
+    parser.add_argument('--datasets', type=Path, required=True, help='JSON file describing the pinned datasets')
+    parser.add_argument('--dataset', type=str, nargs='+', help='Only run these datasets')
+    parser.add_argument('--database', type=Path, default=Path('performance.db'), help='SQLite database to record runs in')
+    parser.add_argument('--label', type=str, default='', help='Label recorded with the runs, e.g. a commit')
+    parser.add_argument('--out', type=Path, default=Path('performance'), help='Output directory for the runs')
+    parser.add_argument('--threads', type=int, default=4, help='Threads used by each run')
+    parser.add_argument('--repeats', type=int, default=3, help='Runs of each build on each dataset')
+    parser.add_argument('--tolerance', type=float, default=0.1, help='Maximum fractional increase over the baseline')
+    main(parser.parse_args())
@@ -1,3 +1,72 @@
 #!/usr/bin/env python3
 
+# Measures the call concordance of an octopus build against a baseline build on the same data, e.g. a
+# build with the SINGLE_PRECISION_LIKELIHOODS option against a default build. Fails if the concordance
+# is below --min-concordance.
 
+import argparse
+import subprocess as sp
+import sys
+from pathlib import Path
+
+import pysam as ps
+
+def call_variants(octopus, reference, reads, regions, out_vcf, options):
+    command = [str(octopus), '-R', str(reference), '-I'] + [str(r) for r in reads] + ['-o', str(out_vcf)]
+    if regions is not None:
+        command += ['-T'] + regions
+    command += options
+    sp.run(command, check=True)
+
+def read_calls(vcf_filename, min_quality):
+    result = {}
+    with ps.VariantFile(str(vcf_filename)) as vcf:
+        for rec in vcf:
+            if rec.qual is not None and rec.qual < min_quality:
+                continue
+            if 'PASS' not in rec.filter.keys() and len(rec.filter.keys()) > 0:
+                continue
+            genotypes = tuple(tuple(sorted(a for a in rec.samples[sample]['GT'] if a is not None)) for sample in rec.samples)
+            result[(rec.contig, rec.pos, rec.ref, tuple(rec.alts or ()))] = genotypes
+    return result
+
+def concordance(baseline_calls, test_calls):
+    sites = set(baseline_calls) | set(test_calls)
+    if len(sites) == 0:
+        return 1.0, 1.0, []
+    shared_sites = set(baseline_calls) & set(test_calls)
+    matching_genotypes = [site for site in shared_sites if baseline_calls[site] == test_calls[site]]
+    discordant = sorted(sites - set(matching_genotypes))
+    return len(shared_sites) / len(sites), len(matching_genotypes) / len(sites), discordant
+
+def main(options):
+    options.out.mkdir(parents=True, exist_ok=True)
+    baseline_vcf, test_vcf = options.out / 'baseline.vcf.gz', options.out / 'test.vcf.gz'
+    octopus_options = options.options.split() if options.options else []
+    call_variants(options.baseline, options.reference, options.reads, options.regions, baseline_vcf, octopus_options)
+    call_variants(options.test, options.reference, options.reads, options.regions, test_vcf, octopus_options)
+    baseline_calls = read_calls(baseline_vcf, options.min_quality)
+    test_calls = read_calls(test_vcf, options.min_quality)
+    site_concordance, genotype_concordance, discordant = concordance(baseline_calls, test_calls)
+    print('Baseline calls: {}, test calls: {}'.format(len(baseline_calls), len(test_calls)))
+    print('Site concordance: {:.6f}'.format(site_concordance))
+    print('Genotype concordance: {:.6f}'.format(genotype_concordance))
+    for contig, pos, ref, alts in discordant[:options.max_report]:
+        print('Discordant: {}:{} {}>{}'.format(contig, pos, ref, ','.join(alts)))
+    if genotype_concordance < options.min_concordance:
+        print('Genotype concordance is below {}'.format(options.min_concordance))
+        sys.exit(1)
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--baseline', type=Path, required=True, help='The octopus binary to compare against, e.g. a default build')
+    parser.add_argument('--test', type=Path, required=True, help='The octopus binary to test, e.g. a SINGLE_PRECISION_LIKELIHOODS build')
+    parser.add_argument('-R', '--reference', type=Path, required=True, help='Reference FASTA')
+    parser.add_argument('-I', '--reads', type=Path, nargs='+', required=True, help='Read files to call')
+    parser.add_argument('-T', '--regions', type=str, nargs='+', help='Regions to call')
+    parser.add_argument('--options', type=str, help='Extra options given to both octopus runs')
+    parser.add_argument('--out', type=Path, default=Path('regression'), help='Output directory for the calls')
+    parser.add_argument('--min-quality', type=float, default=0, help='Ignore calls with lower QUAL')
+    parser.add_argument('--min-concordance', type=float, default=0.999, help='Minimum genotype concordance to pass')
+    parser.add_argument('--max-report', type=int, default=20, help='Maximum number of discordant sites to print')
+    main(parser.parse_args())
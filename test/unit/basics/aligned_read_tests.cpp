@@ -4,6 +4,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <utility>
+#include <vector>
 
 #include "basics/genomic_region.hpp"
 #include "basics/cigar_string.hpp"
@@ -53,6 +54,38 @@ BOOST_AUTO_TEST_CASE(can_be_moved)
     BOOST_REQUIRE_NO_THROW(read2 = std::move(read1));
 }
 
+BOOST_AUTO_TEST_CASE(flag_masks_test_for_any_of_the_flags)
+{
+    const auto make_read = [] (AlignedRead::Flags flags) {
+        return AlignedRead {"test", GenomicRegion {"1", 0, 4}, "ACGT", AlignedRead::BaseQualityVector {1, 2, 3, 4},
+                            parse_cigar("4M"), 10, flags, "",
+                            std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>> {}};
+    };
+    AlignedRead::Flags flags {};
+    flags.duplicate = true;
+    const auto read = make_read(flags);
+    AlignedRead::Flags rejected {};
+    BOOST_CHECK(!read.is_marked_any(AlignedRead::make_flag_mask(rejected)));
+    rejected.qc_fail = true;
+    rejected.secondary_alignment = true;
+    BOOST_CHECK(!read.is_marked_any(AlignedRead::make_flag_mask(rejected)));
+    rejected.duplicate = true;
+    BOOST_CHECK(read.is_marked_any(AlignedRead::make_flag_mask(rejected)));
+    BOOST_CHECK(!make_read(AlignedRead::Flags {}).is_marked_any(AlignedRead::make_flag_mask(rejected)));
+}
+
+BOOST_AUTO_TEST_CASE(flags_are_returned_as_given)
+{
+    AlignedRead::Flags flags {};
+    flags.multiple_segment_template = true;
+    const AlignedRead read {"test", GenomicRegion {"1", 0, 4}, "ACGT", AlignedRead::BaseQualityVector {1, 2, 3, 4},
+                            parse_cigar("4M"), 10, flags, "",
+                            std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>> {}};
+    BOOST_CHECK(read.flags() == flags);
+    BOOST_CHECK(read.is_marked_multiple_segment_template());
+    BOOST_CHECK(!read.is_marked_all_segments_in_read_aligned());
+}
+
 BOOST_AUTO_TEST_CASE(can_copy_read_subregions)
 {
     const AlignedRead read {
@@ -4,6 +4,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <string>
+#include <vector>
 
 #include "basics/cigar_string.hpp"
 
@@ -79,6 +80,29 @@ BOOST_AUTO_TEST_CASE(can_copy_parts_of_cigar)
     BOOST_CHECK_EQUAL(copy(cigar, 16, 7), parse_cigar("3I4M"));
 }
 
+BOOST_AUTO_TEST_CASE(operations_use_the_bam_encoding)
+{
+    const CigarOperation op {10, CigarOperation::Flag::deletion};
+    BOOST_CHECK_EQUAL(op.bam_encoding(), (10u << 4) | 2u);
+    BOOST_CHECK_EQUAL(CigarOperation::from_bam(op.bam_encoding()), op);
+    for (const auto& other : parse_cigar("1M2I3D4N5S6H7P8=9X")) {
+        BOOST_CHECK_EQUAL(CigarOperation::from_bam(other.bam_encoding()), other);
+    }
+    auto changed = op;
+    changed.set_size(3);
+    changed.set_flag(CigarOperation::Flag::insertion);
+    BOOST_CHECK_EQUAL(changed, CigarOperation(3, CigarOperation::Flag::insertion));
+}
+
+BOOST_AUTO_TEST_CASE(flag_iterators_visit_each_position)
+{
+    const auto cigar = parse_cigar("2S3M1D2I");
+    const std::vector<CigarOperation::Flag> flags(flags_begin(cigar), flags_end(cigar));
+    BOOST_CHECK(flags == decompose(cigar));
+    const CigarString empty {};
+    BOOST_CHECK(flags_begin(empty) == flags_end(empty));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
     
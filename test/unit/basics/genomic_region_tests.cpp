@@ -3,6 +3,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <string>
+
 #include "basics/genomic_region.hpp"
 
 namespace octopus { namespace test {
@@ -32,6 +34,22 @@ BOOST_AUTO_TEST_CASE(some_operations_are_well_defined_on_different_contigs)
     BOOST_CHECK_NO_THROW(contains(r1, r2));
 }
 
+BOOST_AUTO_TEST_CASE(contig_names_are_shared_between_regions)
+{
+    const std::string contig {"chr_interned"};
+    const GenomicRegion r1 {contig, 0, 10}, r2 {std::string {"chr_interned"}, 5, 20}, r3 {"chr_other", 0, 10};
+    BOOST_CHECK_EQUAL(r1.contig_id(), r2.contig_id());
+    BOOST_CHECK_NE(r1.contig_id(), r3.contig_id());
+    BOOST_CHECK_EQUAL(&r1.contig_name(), &r2.contig_name());
+    BOOST_CHECK_EQUAL(r1.contig_name(), contig);
+    BOOST_CHECK_EQUAL(expand(r1, 5).contig_name(), contig);
+    BOOST_CHECK(overlaps(r1, r2));
+    BOOST_CHECK(!overlaps(r1, r3));
+    BOOST_CHECK_EQUAL(GenomicRegion {}.contig_name(), "");
+    BOOST_CHECK(ContigDictionary::instance().find(contig));
+    BOOST_CHECK(!ContigDictionary::instance().find("chr_never_used"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
     
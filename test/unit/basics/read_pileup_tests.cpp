@@ -0,0 +1,96 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "basics/genomic_region.hpp"
+#include "basics/cigar_string.hpp"
+#include "basics/aligned_read.hpp"
+#include "basics/read_pileup.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(basics)
+BOOST_AUTO_TEST_SUITE(read_pileup)
+
+namespace {
+
+AlignedRead make_read(const GenomicRegion::Position begin, const std::string& sequence, const std::string& cigar)
+{
+    const auto parsed_cigar = parse_cigar(cigar);
+    AlignedRead::BaseQualityVector qualities(sequence.size());
+    for (std::size_t i {0}; i < qualities.size(); ++i) qualities[i] = static_cast<AlignedRead::BaseQuality>(i + 1);
+    return AlignedRead {"test", GenomicRegion {"1", begin, begin + reference_size(parsed_cigar)}, sequence, std::move(qualities),
+                        parsed_cigar, 60, AlignedRead::Flags {}, "",
+                        std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>> {}};
+}
+
+auto get_observations(const ReadPileup& pileup)
+{
+    std::vector<std::pair<std::string, ReadPileup::ReadSummary>> result {};
+    pileup.summaries([&] (const auto& sequence, const auto& summaries) {
+        for (const auto& summary : summaries) result.emplace_back(sequence, summary);
+    });
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(pileups_have_the_same_bases_as_copy_sequence)
+{
+    const GenomicRegion region {"1", 95, 125};
+    const std::vector<AlignedRead> reads {
+        make_read(100, "ACGTACGTAC", "10M"),
+        make_read(100, "ACGTACGTAC", "2S6M2S"),
+        make_read(98, "ACGTACGTACGT", "3M2I2M3D5M"),
+        make_read(103, "ACGTACGTACG", "2I4M1D3X2I"),
+        make_read(110, "ACGTACGT", "3M1I4M")
+    };
+    auto pileups = make_pileups(region);
+    for (const auto& read : reads) add_to_pileups(read, pileups);
+    for (const auto& pileup : pileups) {
+        std::vector<std::pair<std::string, AlignedRead::BaseQualityVector>> expected {};
+        const GenomicRegion position {"1", pileup.mapped_region()};
+        for (const auto& read : reads) {
+            if (overlaps(read, position)) {
+                expected.emplace_back(copy_sequence(read, position), copy_base_qualities(read, position));
+            }
+        }
+        const auto observations = get_observations(pileup);
+        BOOST_REQUIRE_EQUAL(observations.size(), expected.size());
+        for (const auto& observation : observations) {
+            const auto& qualities = observation.second.base_qualities;
+            BOOST_CHECK_EQUAL(observation.second.mapping_quality, 60);
+            BOOST_CHECK(std::find_if(std::cbegin(expected), std::cend(expected), [&] (const auto& p) {
+                return p.first == observation.first && std::equal(std::cbegin(qualities), std::cend(qualities), std::cbegin(p.second), std::cend(p.second));
+            }) != std::cend(expected));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(insertions_are_added_to_the_next_position)
+{
+    auto pileups = make_pileups(GenomicRegion {"1", 100, 104});
+    add_to_pileups(make_read(100, "ACGGTT", "2M2I2M"), pileups);
+    const std::vector<std::string> expected {"A", "C", "GGT", "T"};
+    for (std::size_t i {0}; i < pileups.size(); ++i) {
+        const auto observations = get_observations(pileups[i]);
+        BOOST_REQUIRE_EQUAL(observations.size(), 1);
+        BOOST_CHECK_EQUAL(observations.front().first, expected[i]);
+    }
+    ReadPileup pileup {102};
+    pileup.add(make_read(100, "ACGGTT", "2M2I2M"));
+    BOOST_REQUIRE_EQUAL(get_observations(pileup).size(), 1);
+    BOOST_CHECK_EQUAL(get_observations(pileup).front().first, "GGT");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -68,6 +68,25 @@ BOOST_AUTO_TEST_CASE(range_insert_accepts_unsorted_ranges)
     BOOST_CHECK(std::is_sorted(std::cbegin(set), std::cend(set)));
 }
 
+BOOST_AUTO_TEST_CASE(range_insert_merges_with_existing_elements)
+{
+    const std::vector<ContigRegion> regions1 {ContigRegion {0, 5}, ContigRegion {2, 3}, ContigRegion {8, 9}};
+    const std::vector<ContigRegion> regions2 {ContigRegion {9, 10}, ContigRegion {0, 1}, ContigRegion {2, 3}, ContigRegion {0, 100}};
+    
+    MappableFlatSet<ContigRegion> set {std::cbegin(regions1), std::cend(regions1)};
+    MappableFlatVectorSet<ContigRegion> vector_set {std::cbegin(regions1), std::cend(regions1)};
+    
+    set.insert(std::cbegin(regions2), std::cend(regions2));
+    vector_set.insert(std::cbegin(regions2), std::cend(regions2));
+    
+    BOOST_CHECK_EQUAL(set.size(), 6);
+    BOOST_CHECK(std::is_sorted(std::cbegin(set), std::cend(set)));
+    BOOST_REQUIRE_EQUAL(vector_set.size(), set.size());
+    BOOST_CHECK(std::equal(std::cbegin(set), std::cend(set), std::cbegin(vector_set)));
+    BOOST_CHECK_EQUAL(vector_set.count_overlapped(ContigRegion {50, 51}), 1);
+    BOOST_CHECK_EQUAL(vector_set.count_overlapped(ContigRegion {8, 10}), 3);
+}
+
 BOOST_AUTO_TEST_CASE(insert_hint_works)
 {
     const ContigRegion r1 {0, 1}, r2 {0, 2}, r3 {1, 1}, r4 {0, 0}, r5 {0, 4},
@@ -0,0 +1,113 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <random>
+
+#include "basics/contig_region.hpp"
+#include "containers/mappable_interval_tree.hpp"
+
+namespace octopus { namespace test {
+
+using octopus::MappableIntervalTree;
+
+BOOST_AUTO_TEST_SUITE(containers)
+BOOST_AUTO_TEST_SUITE(mappable_interval_tree)
+
+namespace {
+
+auto brute_force_overlapped(const std::vector<ContigRegion>& regions, const ContigRegion& region)
+{
+    std::vector<ContigRegion> result {};
+    std::copy_if(std::cbegin(regions), std::cend(regions), std::back_inserter(result),
+                 [&] (const auto& r) { return overlaps(r, region); });
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(empty_tree_has_no_overlaps)
+{
+    const MappableIntervalTree<ContigRegion> tree {};
+    const ContigRegion region {0, 10};
+
+    BOOST_CHECK(!tree.has_overlapped(region));
+    BOOST_CHECK_EQUAL(tree.count_overlapped(region), 0);
+    BOOST_CHECK(tree.overlap_range(region).empty());
+}
+
+BOOST_AUTO_TEST_CASE(overlap_queries_handle_long_and_empty_elements)
+{
+    const std::vector<ContigRegion> regions {ContigRegion {0, 1000}, ContigRegion {5, 5}, ContigRegion {10, 12},
+                                             ContigRegion {20, 20}, ContigRegion {20, 25}, ContigRegion {30, 31},
+                                             ContigRegion {500, 501}};
+    const MappableIntervalTree<ContigRegion> tree {std::cbegin(regions), std::cend(regions)};
+
+    BOOST_REQUIRE_EQUAL(tree.size(), regions.size());
+    BOOST_CHECK(std::is_sorted(std::cbegin(tree), std::cend(tree)));
+
+    for (const ContigRegion& region : {ContigRegion {5, 5}, ContigRegion {20, 20}, ContigRegion {12, 20},
+                                       ContigRegion {999, 1000}, ContigRegion {1000, 1000}, ContigRegion {1000, 1001}}) {
+        const auto expected = brute_force_overlapped(regions, region);
+        const auto overlapped = tree.overlap_range(region);
+        BOOST_CHECK_EQUAL(tree.count_overlapped(region), expected.size());
+        BOOST_CHECK_EQUAL(tree.has_overlapped(region), !expected.empty());
+        BOOST_CHECK(std::equal(std::cbegin(overlapped), std::cend(overlapped), std::cbegin(expected), std::cend(expected)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(overlap_queries_agree_with_linear_search)
+{
+    std::mt19937 generator {42};
+    std::uniform_int_distribution<ContigRegion::Position> begin_dist {0, 10'000};
+    std::geometric_distribution<ContigRegion::Size> short_size_dist {0.05};
+    std::uniform_int_distribution<ContigRegion::Size> long_size_dist {1'000, 5'000};
+    std::bernoulli_distribution is_long_dist {0.01};
+    for (std::size_t n : {1, 2, 3, 7, 16, 17, 100, 1'000}) {
+        std::vector<ContigRegion> regions {};
+        regions.reserve(n);
+        for (std::size_t i {0}; i < n; ++i) {
+            const auto begin = begin_dist(generator);
+            const auto size = is_long_dist(generator) ? long_size_dist(generator) : short_size_dist(generator);
+            regions.emplace_back(begin, begin + size);
+        }
+        MappableIntervalTree<ContigRegion> tree {std::cbegin(regions), std::cend(regions)};
+        std::sort(std::begin(regions), std::end(regions));
+        for (int q {0}; q < 200; ++q) {
+            const auto begin = begin_dist(generator);
+            const ContigRegion region {begin, begin + short_size_dist(generator)};
+            const auto expected = brute_force_overlapped(regions, region);
+            const auto overlapped = tree.overlap_range(region);
+            BOOST_REQUIRE_EQUAL(tree.count_overlapped(region), expected.size());
+            BOOST_REQUIRE_EQUAL(tree.has_overlapped(region), !expected.empty());
+            BOOST_REQUIRE(std::equal(std::cbegin(overlapped), std::cend(overlapped), std::cbegin(expected), std::cend(expected)));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(insert_rebuilds_index)
+{
+    MappableIntervalTree<ContigRegion> tree {};
+    const std::vector<ContigRegion> regions1 {ContigRegion {10, 20}, ContigRegion {30, 40}};
+    const std::vector<ContigRegion> regions2 {ContigRegion {0, 100}, ContigRegion {35, 36}};
+
+    tree.insert(std::cbegin(regions1), std::cend(regions1));
+    BOOST_CHECK_EQUAL(tree.count_overlapped(ContigRegion {50, 60}), 0);
+    tree.insert(std::cbegin(regions2), std::cend(regions2));
+    BOOST_CHECK_EQUAL(tree.size(), 4);
+    BOOST_CHECK(std::is_sorted(std::cbegin(tree), std::cend(tree)));
+    BOOST_CHECK_EQUAL(tree.count_overlapped(ContigRegion {50, 60}), 1);
+    BOOST_CHECK_EQUAL(tree.count_overlapped(ContigRegion {35, 36}), 3);
+    tree.clear();
+    BOOST_CHECK(!tree.has_overlapped(ContigRegion {35, 36}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,110 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <iterator>
+
+#include "containers/matrix_map.hpp"
+#include "containers/probability_matrix.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(containers)
+BOOST_AUTO_TEST_SUITE(matrix_map)
+
+namespace {
+
+auto make_test_matrix()
+{
+    MatrixMap<std::string, int, double> result {};
+    const std::vector<int> keys {1, 2, 3};
+    result.assign_keys(std::cbegin(keys), std::cend(keys));
+    const std::vector<double> a {0.1, 0.2, 0.7}, b {0.5, 0.25, 0.25};
+    result.insert_at(std::string {"a"}, std::cbegin(a), std::cend(a));
+    result.insert_at(std::string {"b"}, std::cbegin(b), std::cend(b));
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(key_and_index_access_agree)
+{
+    const auto matrix = make_test_matrix();
+
+    BOOST_REQUIRE_EQUAL(matrix.size1(), 2);
+    BOOST_REQUIRE_EQUAL(matrix.size2(), 3);
+    BOOST_CHECK_EQUAL(matrix("a", 3), 0.7);
+    BOOST_CHECK_EQUAL(matrix["b"][2], 0.25);
+    for (const auto& p : matrix) {
+        const auto i = matrix.index1(p.first);
+        BOOST_CHECK_EQUAL(matrix.key1(i), p.first);
+        const auto row = matrix.row(i);
+        BOOST_REQUIRE_EQUAL(std::distance(std::cbegin(row), std::cend(row)), 3);
+        for (const auto& q : p.second) {
+            const auto j = matrix.index2(q.first);
+            BOOST_CHECK_EQUAL(matrix.key2(j), q.first);
+            BOOST_CHECK_EQUAL(matrix.at_index(i, j), q.second);
+            BOOST_CHECK_EQUAL(*std::next(std::cbegin(row), j), q.second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(column_and_row_updates_keep_values_aligned)
+{
+    auto matrix = make_test_matrix();
+    const std::vector<double> c {9, 8};
+
+    matrix.insert_each(4, std::cbegin(c), std::cend(c));
+    BOOST_CHECK_EQUAL(matrix("a", 4), 9);
+    BOOST_CHECK_EQUAL(matrix("b", 4), 8);
+    BOOST_CHECK_EQUAL(matrix("b", 3), 0.25);
+
+    BOOST_CHECK(matrix.erase2(2));
+    BOOST_REQUIRE_EQUAL(matrix.size2(), 3);
+    BOOST_CHECK_EQUAL(matrix("a", 1), 0.1);
+    BOOST_CHECK_EQUAL(matrix("a", 3), 0.7);
+    BOOST_CHECK_EQUAL(matrix("b", 4), 8);
+
+    BOOST_CHECK(matrix.erase1("a"));
+    BOOST_REQUIRE_EQUAL(matrix.size1(), 1);
+    BOOST_CHECK_EQUAL(matrix.index1("b"), 0);
+    BOOST_CHECK_EQUAL(matrix("b", 4), 8);
+
+    matrix.pop_back();
+    BOOST_REQUIRE_EQUAL(matrix.size2(), 2);
+    BOOST_CHECK_EQUAL(matrix("b", 3), 0.25);
+
+    const auto copy = matrix;
+    BOOST_CHECK_EQUAL(copy("b", 1), 0.5);
+}
+
+BOOST_AUTO_TEST_CASE(remove_improbable_keys_keeps_keys_probable_in_any_sample)
+{
+    ProbabilityMatrix<int> matrix {};
+    const std::vector<int> keys {1, 2, 3, 4};
+    assign_keys(keys, matrix);
+    const std::vector<double> a {0.6, 0.39, 0.005, 0.005}, b {0.3, 0.69, 0.009, 0.001};
+    insert_sample(std::string {"a"}, a, matrix);
+    insert_sample(std::string {"b"}, b, matrix);
+
+    const auto removed = remove_improbable_keys(matrix, 0.01);
+    BOOST_REQUIRE_EQUAL(matrix.size1(), 2);
+    BOOST_REQUIRE_EQUAL(matrix.size2(), 2);
+    BOOST_CHECK_EQUAL(matrix("a", 1), 0.6);
+    BOOST_CHECK_EQUAL(matrix("b", 2), 0.69);
+    BOOST_REQUIRE_EQUAL(removed.size(), 2);
+    BOOST_CHECK_CLOSE(removed[matrix.index1("a")], 0.01, 1e-6);
+    BOOST_CHECK_CLOSE(removed[matrix.index1("b")], 0.01, 1e-6);
+
+    BOOST_CHECK(remove_improbable_keys(matrix, 0.9) == std::vector<double>(2, 0.0));
+    BOOST_CHECK_EQUAL(matrix.size2(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
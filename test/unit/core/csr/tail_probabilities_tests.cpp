@@ -0,0 +1,50 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include "core/csr/measures/tail_probabilities.hpp"
+#include "utils/maths.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(tail_probabilities)
+
+BOOST_AUTO_TEST_CASE(memoised_beta_tails_match_direct_evaluation)
+{
+    for (int repeat {0}; repeat < 2; ++repeat) {
+        BOOST_CHECK_CLOSE(csr::beta_cdf(3.0, 4.0, 0.3), maths::beta_cdf(3.0, 4.0, 0.3), 1e-10);
+        BOOST_CHECK_CLOSE(csr::beta_sf(3.0, 4.0, 0.3), maths::beta_sf(3.0, 4.0, 0.3), 1e-10);
+        BOOST_CHECK_CLOSE(csr::beta_tail_probability(10.5, 2.5, 0.1), maths::beta_tail_probability(10.5, 2.5, 0.1), 1e-10);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(beta_difference_probability_is_exact_for_small_counts)
+{
+    // Two uniforms differ by more than d with probability (1 - d)^2
+    const auto uniform_prob = csr::beta_difference_probability(1, 1, 1, 1, 0.25);
+    BOOST_REQUIRE(uniform_prob);
+    BOOST_CHECK_CLOSE(*uniform_prob, 0.5625, 1e-8);
+    const auto no_difference_prob = csr::beta_difference_probability(5, 3, 2, 9, 0.0);
+    BOOST_REQUIRE(no_difference_prob);
+    BOOST_CHECK_CLOSE(*no_difference_prob, 1.0, 1e-8);
+    // Symmetric in the two distributions
+    const auto lhs = csr::beta_difference_probability(5, 3, 2, 9, 0.25);
+    const auto rhs = csr::beta_difference_probability(2, 9, 5, 3, 0.25);
+    BOOST_REQUIRE(lhs && rhs);
+    BOOST_CHECK_CLOSE(*lhs, *rhs, 1e-8);
+    BOOST_CHECK_GT(*lhs, 0.8);
+    BOOST_CHECK_LT(*lhs, 0.85);
+}
+
+BOOST_AUTO_TEST_CASE(beta_difference_probability_is_not_given_for_large_counts)
+{
+    BOOST_CHECK(!csr::beta_difference_probability(100, 100, 100, 100, 0.25));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
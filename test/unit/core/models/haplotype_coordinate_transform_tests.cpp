@@ -0,0 +1,92 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "basics/genomic_region.hpp"
+#include "basics/cigar_string.hpp"
+#include "basics/aligned_read.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "core/types/allele.hpp"
+#include "core/types/haplotype.hpp"
+#include "core/models/haplotype_coordinate_transform.hpp"
+#include "utils/kmer_mapper.hpp"
+
+#include "mock/mock_reference.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(haplotype_coordinate_transform)
+
+namespace {
+
+AlignedRead make_read(const GenomicRegion::Position begin, std::string sequence, const std::string& cigar)
+{
+    const auto parsed_cigar = parse_cigar(cigar);
+    AlignedRead::BaseQualityVector qualities(sequence.size(), 30);
+    return AlignedRead {"test", GenomicRegion {"3", begin, begin + reference_size(parsed_cigar)}, std::move(sequence),
+                        std::move(qualities), parsed_cigar, 60, AlignedRead::Flags {}, "",
+                        std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>> {}};
+}
+
+// A haplotype of 3:1000-1400 with a 3bp insertion at 1100
+Haplotype make_haplotype(const ReferenceGenome& reference)
+{
+    Haplotype::Builder builder {GenomicRegion {"3", 1000, 1400}, reference};
+    builder.push_back(Allele {GenomicRegion {"3", 1100, 1100}, "TTG"});
+    return builder.build();
+}
+
+bool is_kmer_mapping(const AlignedRead& read, const Haplotype& haplotype, const std::size_t position)
+{
+    const auto positions = map_query_to_target<6>(read.sequence(), haplotype.sequence());
+    return std::find(std::cbegin(positions), std::cend(positions), position) != std::cend(positions);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(reads_are_mapped_past_haplotype_indels)
+{
+    const auto reference = mock::make_reference();
+    const auto haplotype = make_haplotype(reference);
+    const HaplotypeCoordinateTransform transform {haplotype, 8};
+    const auto read = make_read(1200, haplotype.sequence().substr(203, 40), "40M");
+    const auto position = transform.map(read);
+    BOOST_REQUIRE(position);
+    BOOST_CHECK_EQUAL(*position, 203);
+    BOOST_CHECK(is_kmer_mapping(read, haplotype, *position));
+}
+
+BOOST_AUTO_TEST_CASE(front_soft_clipped_reads_are_mapped_from_the_start_of_their_sequence)
+{
+    const auto reference = mock::make_reference();
+    const auto haplotype = make_haplotype(reference);
+    const HaplotypeCoordinateTransform transform {haplotype, 8};
+    // The soft clipped bases match the haplotype, as an aligner would clip them at a nearby mismatch
+    const auto read = make_read(1205, haplotype.sequence().substr(203, 45), "5S40M");
+    const auto position = transform.map(read);
+    BOOST_REQUIRE(position);
+    BOOST_CHECK_EQUAL(*position, 203);
+    BOOST_CHECK(is_kmer_mapping(read, haplotype, *position));
+}
+
+BOOST_AUTO_TEST_CASE(reads_with_haplotype_indels_under_soft_clips_are_not_mapped)
+{
+    const auto reference = mock::make_reference();
+    const auto haplotype = make_haplotype(reference);
+    const HaplotypeCoordinateTransform transform {haplotype, 8};
+    const auto read = make_read(1120, haplotype.sequence().substr(83, 60), "30S30M");
+    BOOST_CHECK(!transform.map(read));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,67 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "basics/cigar_string.hpp"
+#include "basics/aligned_read.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "containers/mappable_block.hpp"
+#include "core/types/haplotype.hpp"
+#include "core/models/haplotype_likelihood_model.hpp"
+#include "core/models/haplotype_likelihood_array.hpp"
+
+#include "mock/mock_reference.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(haplotype_likelihood_array)
+
+namespace {
+
+AlignedRead make_read(const GenomicRegion::Position begin, std::string sequence, const std::string& cigar)
+{
+    const auto parsed_cigar = parse_cigar(cigar);
+    AlignedRead::BaseQualityVector qualities(sequence.size(), 30);
+    return AlignedRead {"test", GenomicRegion {"3", begin, begin + reference_size(parsed_cigar)}, std::move(sequence),
+                        std::move(qualities), parsed_cigar, 60, AlignedRead::Flags {}, "",
+                        std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>> {}};
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(reads_that_only_differ_in_their_cigar_have_their_own_likelihoods)
+{
+    const auto reference = mock::make_reference();
+    const std::vector<Haplotype> haplotypes {Haplotype {GenomicRegion {"3", 1000, 1400}, reference}};
+    const auto& haplotype = haplotypes.front();
+    // Both reads cover 3:1100-1198, but only the front soft clipped read's sequence starts at 3:1098
+    const auto sequence = haplotype.sequence().substr(98, 100);
+    const auto front_clipped_read = make_read(1100, sequence, "2S98M");
+    const auto back_clipped_read = make_read(1100, sequence, "98M2S");
+    BOOST_REQUIRE(is_same_region(front_clipped_read, back_clipped_read));
+    const SampleName sample {"test"};
+    ReadMap reads {};
+    reads[sample].insert(front_clipped_read);
+    reads[sample].insert(back_clipped_read);
+    HaplotypeLikelihoodArray likelihoods {HaplotypeLikelihoodModel {}, 1, {sample}};
+    likelihoods.populate(reads, MappableBlock<Haplotype> {std::cbegin(haplotypes), std::cend(haplotypes)});
+    const auto& haplotype_likelihoods = likelihoods(sample, haplotype);
+    BOOST_REQUIRE_EQUAL(haplotype_likelihoods.size(), 2);
+    const auto front_clipped_idx = reads[sample].front().cigar() == front_clipped_read.cigar() ? 0 : 1;
+    // Only the front soft clipped read matches the haplotype where its sequence starts
+    BOOST_CHECK_GT(haplotype_likelihoods[front_clipped_idx], haplotype_likelihoods[1 - front_clipped_idx]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
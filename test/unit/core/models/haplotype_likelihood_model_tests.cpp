@@ -1,4 +1,61 @@
 // Copyright (c) 2017 Daniel Cooke
 // Use of this source code is governed by the MIT license that can be found in the LICENSE file.
 
-#include <stdio.h>
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+
+#include "core/models/haplotype_likelihood_model.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(haplotype_likelihood_model)
+
+namespace {
+
+using AlignmentScoreCache = HaplotypeLikelihoodModel::AlignmentScoreCache;
+
+AlignmentScoreCache::Key make_key(const std::uint64_t value) noexcept
+{
+    AlignmentScoreCache::Key result {};
+    utils::hash_combine(result, value);
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(alignment_score_cache_evicts_least_recently_used_scores)
+{
+    AlignmentScoreCache cache {4096};
+    const auto capacity = cache.capacity();
+    BOOST_REQUIRE_GT(capacity, 2);
+    for (std::uint64_t i {0}; i < capacity; ++i) {
+        cache.insert(make_key(i), -static_cast<double>(i));
+    }
+    BOOST_CHECK_EQUAL(cache.size(), capacity);
+    // Using the oldest score makes the second oldest the least recently used
+    BOOST_REQUIRE(cache.find(make_key(0)));
+    cache.insert(make_key(capacity), -1.0);
+    BOOST_CHECK_EQUAL(cache.size(), capacity);
+    BOOST_CHECK(!cache.find(make_key(1)));
+    BOOST_REQUIRE(cache.find(make_key(0)));
+    BOOST_CHECK_EQUAL(*cache.find(make_key(0)), 0.0);
+    BOOST_REQUIRE(cache.find(make_key(capacity)));
+    BOOST_CHECK_EQUAL(*cache.find(make_key(capacity)), -1.0);
+    for (std::uint64_t i {2}; i < capacity; ++i) {
+        BOOST_CHECK(cache.find(make_key(i)));
+    }
+    cache.insert(make_key(2), -0.5);
+    BOOST_CHECK_EQUAL(cache.size(), capacity);
+    BOOST_CHECK_EQUAL(*cache.find(make_key(2)), -0.5);
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0);
+    BOOST_CHECK(!cache.find(make_key(0)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
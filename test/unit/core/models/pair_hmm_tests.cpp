@@ -9,8 +9,11 @@
 #include <algorithm>
 #include <utility>
 #include <iostream>
+#include <random>
 
 #include "core/models/pairhmm/simd_pair_hmm_factory.hpp"
+#include "core/models/pairhmm/batched_pair_hmm.hpp"
+#include "core/models/pairhmm/pair_hmm.hpp"
 
 namespace octopus { namespace test {
 
@@ -713,6 +716,127 @@ BOOST_AUTO_TEST_CASE(avx2_check_alignments)
 #endif /* __AVX2__ */
 
 
+template <int BandSize, typename ScoreType>
+void check_batched_alignments(const int target_len, const int num_alignments)
+{
+    SimdPairHMM<BandSize, ScoreType> hmm {};
+    BatchedSimdPairHMM<ScoreType> batched_hmm {};
+    const int truth_len {target_len + 2 * BandSize - 1};
+    std::mt19937 generator {42};
+    const auto random_base = [&] () { return "ACGT"[generator() % 4]; };
+    std::vector<std::string> truths(num_alignments), targets(num_alignments), snv_masks(num_alignments);
+    std::vector<std::vector<std::int8_t>> qualities(num_alignments), snv_priors(num_alignments), gap_opens(num_alignments), gap_extends(num_alignments);
+    std::vector<typename BatchedSimdPairHMM<ScoreType>::Lane> lanes(num_alignments);
+    for (int i {0}; i < num_alignments; ++i) {
+        std::generate_n(std::back_inserter(truths[i]), truth_len, random_base);
+        targets[i] = truths[i].substr(generator() % BandSize, target_len);
+        targets[i].resize(target_len, 'A');
+        for (auto& base : targets[i]) if (generator() % 10 == 0) base = random_base();
+        std::generate_n(std::back_inserter(qualities[i]), target_len, [&] () { return generator() % 41; });
+        std::generate_n(std::back_inserter(snv_masks[i]), truth_len, random_base);
+        std::generate_n(std::back_inserter(snv_priors[i]), truth_len, [&] () { return 10 + generator() % 40; });
+        std::generate_n(std::back_inserter(gap_opens[i]), truth_len, [&] () { return 10 + generator() % 80; });
+        std::generate_n(std::back_inserter(gap_extends[i]), truth_len, [&] () { return 1 + generator() % 10; });
+        lanes[i] = {truths[i].data(), targets[i].data(), qualities[i].data(), snv_masks[i].data(),
+                    snv_priors[i].data(), gap_opens[i].data(), gap_extends[i].data()};
+    }
+    const short nuc_prior {4};
+    std::vector<int> scores(num_alignments);
+    batched_hmm.align(lanes.data(), num_alignments, truth_len, target_len, BandSize, nuc_prior, scores.data());
+    for (int i {0}; i < num_alignments; ++i) {
+        BOOST_CHECK_EQUAL(scores[i], hmm.align(truths[i].data(), targets[i].data(), qualities[i].data(), truth_len, target_len,
+                                               snv_masks[i].data(), snv_priors[i].data(), gap_opens[i].data(), gap_extends[i].data(),
+                                               nuc_prior));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batched_alignments_match_single_alignments)
+{
+    const auto num_lanes_short = BatchedSimdPairHMM<short>::batch_size();
+    const auto num_lanes_int = BatchedSimdPairHMM<int>::batch_size();
+    check_batched_alignments<8, short>(150, num_lanes_short);
+    check_batched_alignments<8, short>(1, num_lanes_short);
+    check_batched_alignments<8, short>(100, num_lanes_short / 2 + 1);
+    check_batched_alignments<16, short>(150, num_lanes_short);
+    check_batched_alignments<32, short>(250, num_lanes_short - 1);
+    check_batched_alignments<8, int>(150, num_lanes_int);
+    check_batched_alignments<16, int>(77, num_lanes_int / 2);
+}
+
+BOOST_AUTO_TEST_CASE(truth_hashes_are_equal_only_if_evaluations_are_equal)
+{
+    using namespace octopus::hmm;
+    std::mt19937 generator {13};
+    const auto random_base = [&] () { return "ACGT"[generator() % 4]; };
+    for (int trial {0}; trial < 500; ++trial) {
+        const std::size_t haplotype_size {300}, read_size {100}, read_offset {100};
+        std::string haplotype(haplotype_size, 'A');
+        std::generate(std::begin(haplotype), std::end(haplotype), random_base);
+        PenaltyVector gap_open(haplotype_size), gap_extend(haplotype_size), snv_priors(haplotype_size);
+        NucleotideVector snv_mask(haplotype_size);
+        for (std::size_t i {0}; i < haplotype_size; ++i) {
+            gap_open[i] = 10 + generator() % 40;
+            gap_extend[i] = 1 + generator() % 5;
+            snv_priors[i] = generator() % 50;
+            snv_mask[i] = random_base();
+        }
+        auto read = haplotype.substr(read_offset, read_size);
+        for (auto& base : read) if (generator() % 10 == 0) base = random_base();
+        std::vector<std::uint8_t> qualities(read_size);
+        for (auto& quality : qualities) quality = generator() % 41;
+        // The same haplotype shifted right, with a different flank, and maybe a change near the read
+        const std::size_t shift {1 + generator() % 50};
+        auto shifted_haplotype = std::string(shift, 'N') + haplotype;
+        const auto shift_penalties = [shift] (PenaltyVector penalties) {
+            penalties.insert(std::begin(penalties), shift, 20);
+            return penalties;
+        };
+        const auto shifted_gap_open = shift_penalties(gap_open), shifted_gap_extend = shift_penalties(gap_extend);
+        const auto shifted_snv_priors = shift_penalties(snv_priors);
+        auto shifted_snv_mask = snv_mask;
+        shifted_snv_mask.insert(std::begin(shifted_snv_mask), shift, 'N');
+        const bool is_changed {generator() % 2 == 0};
+        if (is_changed) {
+            auto& base = shifted_haplotype[shift + read_offset + generator() % read_size];
+            base = base == 'A' ? 'C' : 'A';
+        }
+        MutationModel model {gap_open, gap_extend, snv_mask, snv_priors};
+        model.lhs_flank_size = generator() % 2 == 0 ? 0 : generator() % 150;
+        model.rhs_flank_size = 0;
+        MutationModel shifted_model {shifted_gap_open, shifted_gap_extend, shifted_snv_mask, shifted_snv_priors};
+        shifted_model.lhs_flank_size = model.lhs_flank_size + shift;
+        shifted_model.rhs_flank_size = 0;
+        octopus::hmm::PairHMM<MutationModel> hmm {model, 8u}, shifted_hmm {shifted_model, 8u};
+        octopus::utils::Hash128 hash {}, shifted_hash {};
+        BOOST_REQUIRE(hmm.hash_truth(haplotype, read_size, read_offset, hash));
+        BOOST_REQUIRE(shifted_hmm.hash_truth(shifted_haplotype, read_size, read_offset + shift, shifted_hash));
+        BOOST_CHECK_EQUAL(hash == shifted_hash, !is_changed);
+        if (hash == shifted_hash) {
+            BOOST_CHECK_EQUAL(hmm.evaluate(read, haplotype, qualities, read_offset),
+                              shifted_hmm.evaluate(read, shifted_haplotype, qualities, read_offset + shift));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(alignments_do_not_depend_on_previous_alignments)
+{
+    // Traceback storage is reused between alignments on the same thread
+    SSE2PairHMM<8, short> hmm;
+    const TestCase short_test {
+        "ACGTACGTACGTACGAAAA",
+        "AAAA",
+        {40,40,40,40},
+        {10,10,10,10, 10,10,10,10, 10,10,10,10, 10,10,10,10, 10,10,10},
+        1,
+        4
+    };
+    const Alignment short_expected_alignment {0, 15, "AAAA", "AAAA"};
+    CHECK_ALIGNER(short_test, hmm, short_expected_alignment)
+    CHECK_ALIGNER(band8_speed_test, hmm, band8_speed_expected_alignment)
+    CHECK_ALIGNER(short_test, hmm, short_expected_alignment)
+    CHECK_ALIGNER(band8_speed_test, hmm, band8_speed_expected_alignment)
+}
+
 // Speed tests
 
 
@@ -0,0 +1,122 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "basics/genomic_region.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "core/types/allele.hpp"
+#include "core/types/haplotype.hpp"
+#include "core/models/error/reference_window.hpp"
+#include "core/models/error/error_model_factory.hpp"
+
+#include "mock/mock_reference.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(reference_window)
+
+namespace {
+
+// SNVs, insertions and deletions, with insertions copying nearby reference so repeats are extended
+Haplotype make_random_haplotype(const GenomicRegion& region, const ReferenceGenome& reference, std::mt19937& generator)
+{
+    const auto& contig = region.contig_name();
+    std::uniform_int_distribution<GenomicRegion::Position> position_dist {region.begin() + 1, region.end() - 10};
+    std::uniform_int_distribution<int> num_alleles_dist {1, 5}, type_dist {0, 2}, length_dist {1, 8};
+    std::vector<GenomicRegion::Position> positions(num_alleles_dist(generator));
+    std::generate(std::begin(positions), std::end(positions), [&] () { return position_dist(generator); });
+    std::sort(std::begin(positions), std::end(positions));
+    Haplotype::Builder builder {region, reference};
+    GenomicRegion::Position min_position {region.begin()};
+    for (const auto position : positions) {
+        if (position < min_position) continue;
+        const auto length = static_cast<GenomicRegion::Position>(length_dist(generator));
+        switch (type_dist(generator)) {
+            case 0: {
+                const auto base = reference.fetch_sequence(GenomicRegion {contig, position, position + 1});
+                builder.push_back(Allele {GenomicRegion {contig, position, position + 1}, base == "A" ? "C" : "A"});
+                min_position = position + 2;
+                break;
+            }
+            case 1: {
+                auto sequence = reference.fetch_sequence(GenomicRegion {contig, position - 1, position - 1 + length});
+                builder.push_back(Allele {GenomicRegion {contig, position, position}, std::move(sequence)});
+                min_position = position + 1;
+                break;
+            }
+            default: {
+                builder.push_back(Allele {GenomicRegion {contig, position, position + length}, ""});
+                min_position = position + length + 1;
+            }
+        }
+    }
+    return builder.build();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(reference_haplotypes_are_a_single_reference_segment)
+{
+    const auto reference = mock::make_reference();
+    const GenomicRegion region {"3", 100, 1900};
+    const Haplotype haplotype {region, reference};
+    const ReferenceWindow window {haplotype};
+    const auto segments = window.split(haplotype);
+    BOOST_REQUIRE(segments);
+    BOOST_REQUIRE_EQUAL(segments->size(), 1);
+    BOOST_CHECK(segments->front().is_reference);
+    BOOST_CHECK_EQUAL(segments->front().begin, 0);
+    BOOST_CHECK_EQUAL(segments->front().end, sequence_size(haplotype));
+    BOOST_CHECK(!window.split(Haplotype {GenomicRegion {"3", 100, 1800}, reference}));
+}
+
+BOOST_AUTO_TEST_CASE(patched_penalties_are_the_same_as_penalties_computed_from_scratch)
+{
+    const auto reference = mock::make_reference();
+    const auto indel_model = make_indel_error_model();
+    const auto snv_model = make_snv_error_model();
+    std::mt19937 generator {42};
+    for (const std::string contig : {"1", "2", "3", "4", "5", "6"}) {
+        const GenomicRegion region {contig, 20, reference.contig_size(contig) - 20};
+        const Haplotype reference_haplotype {region, reference};
+        const ReferenceWindow window {reference_haplotype};
+        IndelErrorModel::PenaltyVector reference_open, reference_extend;
+        indel_model->set_penalties(reference_haplotype, reference_open, reference_extend);
+        SnvErrorModel::MutationVector reference_forward_mask, reference_reverse_mask;
+        SnvErrorModel::PenaltyVector reference_forward_priors, reference_reverse_priors;
+        snv_model->evaluate(reference_haplotype, reference_forward_mask, reference_forward_priors, reference_reverse_mask, reference_reverse_priors);
+        for (int i {0}; i < 100; ++i) {
+            const auto haplotype = make_random_haplotype(region, reference, generator);
+            const auto segments = window.split(haplotype);
+            BOOST_REQUIRE(segments);
+            BOOST_CHECK(std::any_of(std::cbegin(*segments), std::cend(*segments), [] (const auto& segment) { return segment.is_reference; }));
+            IndelErrorModel::PenaltyVector expected_open, expected_extend, patched_open, patched_extend;
+            indel_model->set_penalties(haplotype, expected_open, expected_extend);
+            indel_model->set_penalties(haplotype, window, reference_open, reference_extend, patched_open, patched_extend);
+            BOOST_CHECK(patched_open == expected_open);
+            BOOST_CHECK(patched_extend == expected_extend);
+            SnvErrorModel::MutationVector expected_forward_mask, expected_reverse_mask, patched_forward_mask, patched_reverse_mask;
+            SnvErrorModel::PenaltyVector expected_forward_priors, expected_reverse_priors, patched_forward_priors, patched_reverse_priors;
+            snv_model->evaluate(haplotype, expected_forward_mask, expected_forward_priors, expected_reverse_mask, expected_reverse_priors);
+            snv_model->evaluate(haplotype, window, reference_forward_priors, reference_reverse_priors,
+                                patched_forward_mask, patched_forward_priors, patched_reverse_mask, patched_reverse_priors);
+            BOOST_CHECK(patched_forward_priors == expected_forward_priors);
+            BOOST_CHECK(patched_reverse_priors == expected_reverse_priors);
+            BOOST_CHECK(patched_forward_mask == expected_forward_mask);
+            BOOST_CHECK(patched_reverse_mask == expected_reverse_mask);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -4,6 +4,10 @@
 #include <boost/test/unit_test.hpp>
 
 #include <exception>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
 
 #include "core/tools/vargen/utils/assembler.hpp"
 
@@ -72,7 +76,37 @@ BOOST_AUTO_TEST_CASE(assembler_throws_if_reference_sequence_is_inserted_twice)
     BOOST_CHECK_THROW(assembler.insert_reference(reference), std::exception);
 }
 
-
+BOOST_AUTO_TEST_CASE(assembler_finds_snv_in_reads_for_short_and_long_kmers)
+{
+    const Assembler::NucleotideSequence reference {"GATTACAGCTTGCAATCGGATCCTAGGCATCGATTCAGCGTACCGTAGGCTAACGTTCGAAGCTGCATGCCTAGAGTCGACCTTAAGGTACCTGCAGTTAGC"};
+    auto alt = reference;
+    alt[50] = alt[50] == 'A' ? 'C' : 'A';
+    std::vector<Assembler::NucleotideSequence> reads {}; // kmers are views, so reads must outlive the assembler
+    for (unsigned offset {0}; offset + 60 <= reference.size(); offset += 4) {
+        reads.push_back(reference.substr(offset, 60));
+        reads.push_back(alt.substr(offset, 60));
+    }
+    const std::vector<std::uint8_t> base_qualities(60, 30);
+    
+    for (const unsigned kmer_size : {10, 35}) {
+        Assembler assembler {{kmer_size}, reference};
+        for (const auto& read : reads) {
+            assembler.insert_read(read, base_qualities, Assembler::Direction::forward, 0);
+            assembler.insert_read(read, base_qualities, Assembler::Direction::reverse, 0);
+        }
+        BOOST_REQUIRE(assembler.is_unique_reference());
+        assembler.prune(2);
+        assembler.cleanup();
+        BOOST_REQUIRE(!assembler.is_all_reference());
+        const auto variants = assembler.extract_variants(10, [] (auto, auto) { return 0.0; });
+        const auto is_snv = [&] (const Assembler::Variant& variant) {
+            const auto offset = 50 - variant.begin_pos;
+            return variant.ref.size() == variant.alt.size() && offset < variant.ref.size()
+                && variant.ref[offset] == reference[50] && variant.alt[offset] == alt[50];
+        };
+        BOOST_CHECK(std::any_of(std::cbegin(variants), std::cend(variants), is_snv));
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
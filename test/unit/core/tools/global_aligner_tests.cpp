@@ -56,6 +56,22 @@ BOOST_AUTO_TEST_CASE(align_returns_the_optimal_global_alignmenet)
     BOOST_CHECK_EQUAL(alignment.score, 2 * defaultModel.match + defaultModel.gap_open);
 }
 
+BOOST_AUTO_TEST_CASE(align_finds_gaps_longer_than_the_initial_band)
+{
+    using coretools::align;
+    
+    constexpr coretools::Model defaultModel {};
+    std::string target {};
+    for (unsigned i {0}; i < 400; ++i) target += "ACGT"[(i * 7 + i / 5) % 4];
+    auto query = target;
+    query.erase(200, 100);
+    
+    const auto alignment = align(target, query);
+    BOOST_CHECK_EQUAL(alignment.score, 300 * defaultModel.match + defaultModel.gap_open + 99 * defaultModel.gap_extend);
+    BOOST_CHECK_EQUAL(sum_operation_sizes(alignment.cigar), 400);
+    BOOST_CHECK_EQUAL(reference_size(alignment.cigar), 400);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
     
@@ -3,17 +3,69 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+
+#include "basics/genomic_region.hpp"
+#include "core/types/variant.hpp"
+#include "utils/thread_pool.hpp"
 #include "core/tools/vargen/variant_generator.hpp"
 
 namespace octopus { namespace test {
-    
+
 BOOST_AUTO_TEST_SUITE(core)
 BOOST_AUTO_TEST_SUITE(variant_generator)
 
+namespace {
+
+class FixedVariantGenerator : public VariantGenerator
+{
+public:
+    FixedVariantGenerator(std::vector<Variant> variants) : variants_ {std::move(variants)} {}
+private:
+    std::vector<Variant> variants_;
+
+    std::unique_ptr<VariantGenerator> do_clone() const override { return std::make_unique<FixedVariantGenerator>(*this); }
+    std::vector<Variant> do_generate(const RegionSet&, OptionalThreadPool) const override { return variants_; }
+    std::string name() const override { return "Fixed"; }
+};
 
+Variant make_snv(const GenomicRegion::Position position, const char alt)
+{
+    return {"1", position, std::string {"A"}, std::string {alt}};
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(generate_merges_generator_candidates_without_duplicates)
+{
+    const std::vector<std::vector<Variant>> candidates {
+        {make_snv(1, 'C'), make_snv(5, 'G'), make_snv(9, 'T')},
+        {},
+        {make_snv(0, 'T'), make_snv(5, 'C'), make_snv(5, 'G'), make_snv(12, 'C')},
+        {make_snv(1, 'C'), make_snv(9, 'T'), make_snv(20, 'G')}
+    };
+    VariantGenerator generator {};
+    std::vector<Variant> expected {};
+    for (const auto& variants : candidates) {
+        generator.add(std::make_unique<FixedVariantGenerator>(variants));
+        expected.insert(std::cend(expected), std::cbegin(variants), std::cend(variants));
+    }
+    std::sort(std::begin(expected), std::end(expected));
+    expected.erase(std::unique(std::begin(expected), std::end(expected)), std::end(expected));
+    const GenomicRegion region {"1", 0, 100};
+    BOOST_CHECK(generator.generate(region) == expected);
+    ThreadPool workers {3};
+    for (int i {0}; i < 10; ++i) {
+        BOOST_CHECK(generator.generate(region, workers) == expected);
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
-    
+
 } // namespace test
 } // namespace octopus
@@ -0,0 +1,63 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "basics/aligned_read.hpp"
+#include "basics/cigar_string.hpp"
+#include "core/tools/variation_prescreen.hpp"
+#include "mock/mock_reference.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(variation_prescreen)
+
+namespace {
+
+AlignedRead make_read(const GenomicRegion::Position begin, std::string sequence, const std::string& cigar)
+{
+    const auto cigar_string = parse_cigar(cigar);
+    const GenomicRegion region {"1", begin, begin + reference_size(cigar_string)};
+    AlignedRead::BaseQualityVector qualities(sequence.size(), 30);
+    return AlignedRead {"read", region, std::move(sequence), std::move(qualities), cigar_string, 60,
+                        AlignedRead::Flags {}, "", std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>> {}};
+}
+
+ReadMap make_read_map(const std::vector<AlignedRead>& reads)
+{
+    ReadMap result {};
+    result["sample"].insert(std::cbegin(reads), std::cend(reads));
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(has_variation_evidence_only_reports_supported_variation)
+{
+    using coretools::has_variation_evidence;
+    const auto reference = mock::make_reference();
+    // Reference is TAAGATGAAATCTACAAAATTTAACACAAATCCATTATCT
+    const AlignedRead ref_read {make_read(0, "TAAGATGAAATCTACAAAAT", "20M")};
+    const AlignedRead snv_read {make_read(2, "AGATGAAATCGACAAAATTT", "20M")};
+    const AlignedRead deletion_read {make_read(4, "ATGAAATCTAAAAATTTAAC", "10M1D10M")};
+    const AlignedRead clipped_read {make_read(0, "GGGGGGGGGGGTAAGATGAAATCTA", "11S14M")};
+    BOOST_CHECK(!has_variation_evidence(ReadMap {}, reference));
+    BOOST_CHECK(!has_variation_evidence(make_read_map({ref_read, ref_read}), reference));
+    BOOST_CHECK(!has_variation_evidence(make_read_map({ref_read, snv_read}), reference));
+    BOOST_CHECK(has_variation_evidence(make_read_map({ref_read, snv_read, snv_read}), reference));
+    BOOST_CHECK(has_variation_evidence(make_read_map({ref_read, deletion_read}), reference));
+    BOOST_CHECK(has_variation_evidence(make_read_map({ref_read, clipped_read}), reference));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
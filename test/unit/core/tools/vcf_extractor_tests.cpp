@@ -3,15 +3,78 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "core/types/variant.hpp"
+#include "io/variant/vcf_reader.hpp"
+#include "core/tools/vargen/variant_generator.hpp"
+#include "core/tools/vargen/vcf_extractor.hpp"
+
 namespace octopus { namespace test {
-    
+
 BOOST_AUTO_TEST_SUITE(core)
 BOOST_AUTO_TEST_SUITE(vcf_extractor)
 
+namespace {
+
+struct TemporaryVcf
+{
+    boost::filesystem::path path;
 
+    explicit TemporaryVcf(const std::vector<std::string>& records)
+    : path {boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-%%%%.vcf")}
+    {
+        std::ofstream file {path.string()};
+        file << "##fileformat=VCFv4.2\n##contig=<ID=1,length=1000>\n##contig=<ID=2,length=1000>\n"
+             << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n";
+        for (const auto& record : records) file << record << '\n';
+    }
+    ~TemporaryVcf() { boost::filesystem::remove(path); }
+};
+
+auto make_generator(const TemporaryVcf& vcf)
+{
+    coretools::VariantGenerator result {};
+    result.add(std::make_unique<coretools::VcfExtractor>(std::make_unique<VcfReader>(vcf.path)));
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(streamed_regions_match_independently_fetched_regions)
+{
+    const TemporaryVcf vcf {{
+        "1\t10\t.\tA\tC\t30\tPASS\tDP=5",
+        "1\t20\t.\tACGTACGTACGTACGTACGTA\tA\t30\tPASS\tDP=5",
+        "1\t25\t.\tC\tG,T\t30\tPASS\tDP=5",
+        "1\t35\t.\tG\tGTT\t30\tq10\tDP=5",
+        "1\t50\t.\tT\tA\t30\tPASS\tDP=5",
+        "1\t90\t.\tA\tG\t30\tPASS\tDP=5",
+        "2\t5\t.\tC\tA\t30\tPASS\tDP=5",
+        "2\t60\t.\tG\tC\t30\tPASS\tDP=5"
+    }};
+    const std::vector<GenomicRegion> regions {
+        GenomicRegion {"1", 0, 22}, GenomicRegion {"1", 22, 30}, GenomicRegion {"1", 30, 40}, GenomicRegion {"1", 40, 100},
+        GenomicRegion {"1", 5, 30}, GenomicRegion {"2", 0, 100}, GenomicRegion {"1", 80, 100}
+    };
+    auto streamed = make_generator(vcf);
+    for (const auto& region : regions) {
+        const auto expected = make_generator(vcf).generate(region);
+        BOOST_CHECK(streamed.generate(region) == expected);
+    }
+    // The deletion at 20 overlaps the first three regions, and the filtered insertion is excluded
+    BOOST_CHECK_EQUAL(make_generator(vcf).generate(regions[1]).size(), 3);
+    BOOST_CHECK_EQUAL(make_generator(vcf).generate(regions[2]).size(), 1);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
-    
+
 } // namespace test
 } // namespace octopus
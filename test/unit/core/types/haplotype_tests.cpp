@@ -255,6 +255,27 @@ BOOST_AUTO_TEST_CASE(haplotype_equate_when_alleles_infer_same_sequence)
     BOOST_CHECK(hap3 == hap4);
 }
 
+BOOST_AUTO_TEST_CASE(remove_duplicates_keeps_least_complex_haplotype)
+{
+    BOOST_REQUIRE(test_file_exists(human_reference_fasta));
+    const auto human = make_reference(human_reference_fasta);
+    const auto region = parse_region("16:9300000-9300100", human);
+    const Allele allele1 {parse_region("16:9300037-9300037", human), "TG"};
+    const Allele allele2 {parse_region("16:9300039-9300051", human), ""};
+    const Allele allele3 {parse_region("16:9300041-9300051", human), ""};
+    const Allele allele4 {parse_region("16:9300037-9300038", human), "A"};
+    const auto complex_hap = make_haplotype(human, region, {allele1, allele2});
+    const auto simple_hap = make_haplotype(human, region, {allele3});
+    const auto other_hap = make_haplotype(human, region, {allele4});
+    const Haplotype reference {region, human};
+    std::vector<Haplotype> haplotypes {complex_hap, other_hap, reference, simple_hap, other_hap, complex_hap};
+    BOOST_CHECK_EQUAL(remove_duplicates(haplotypes, reference), 3);
+    BOOST_REQUIRE_EQUAL(haplotypes.size(), 3);
+    BOOST_CHECK(have_same_alleles(haplotypes[0], simple_hap));
+    BOOST_CHECK(haplotypes[1] == other_hap);
+    BOOST_CHECK(haplotypes[2] == reference);
+}
+
 BOOST_AUTO_TEST_CASE(haplotypes_behave_at_boundries)
 {
     BOOST_REQUIRE(test_file_exists(human_reference_fasta));
@@ -0,0 +1,163 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iterator>
+
+#include "basics/genomic_region.hpp"
+#include "containers/mappable_block.hpp"
+#include "core/types/haplotype.hpp"
+#include "core/types/indexed_haplotype.hpp"
+#include "core/types/genotype.hpp"
+#include "core/types/packed_genotype_block.hpp"
+#include "mock/mock_reference.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(packed_genotype_block)
+
+namespace {
+
+MappableBlock<Haplotype> make_haplotypes(const ReferenceGenome& reference, const unsigned num_haplotypes)
+{
+    const GenomicRegion region {"1", 0, 4};
+    MappableBlock<Haplotype> result {region};
+    for (unsigned i {0}; i < num_haplotypes; ++i) {
+        std::string sequence(4, 'A');
+        for (unsigned j {0}, k {i}; j < 4; ++j, k /= 4) sequence[j] = "ACGT"[k % 4];
+        result.emplace_back(region, std::move(sequence), reference);
+    }
+    return result;
+}
+
+bool is_same_genotype(const PackedGenotype& packed, const Genotype<IndexedHaplotype<>>& genotype)
+{
+    return packed.ploidy() == genotype.ploidy()
+        && std::equal(std::cbegin(packed), std::cend(packed), std::cbegin(genotype),
+                      [] (const auto index, const auto& haplotype) { return index == index_of(haplotype); });
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(generate_all_packed_genotypes_matches_generate_all_genotypes)
+{
+    const auto reference = mock::make_reference();
+    for (unsigned num_haplotypes {1}; num_haplotypes <= 6; ++num_haplotypes) {
+        const auto block = make_haplotypes(reference, num_haplotypes);
+        const auto haplotypes = index(block);
+        for (unsigned ploidy {1}; ploidy <= 4; ++ploidy) {
+            const auto genotypes = generate_all_genotypes(haplotypes, ploidy);
+            const auto packed = generate_all_packed_genotypes(num_haplotypes, ploidy);
+            BOOST_REQUIRE_EQUAL(packed.ploidy(), ploidy);
+            BOOST_REQUIRE_EQUAL(packed.size(), genotypes.size());
+            for (std::size_t g {0}; g < genotypes.size(); ++g) {
+                BOOST_CHECK(is_same_genotype(packed[g], genotypes[g]));
+                BOOST_CHECK_EQUAL(is_homozygous(packed[g]), is_homozygous(genotypes[g]));
+                BOOST_CHECK_EQUAL(zygosity(packed[g]), zygosity(genotypes[g]));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(packed_genotypes_can_be_unpacked)
+{
+    const auto reference = mock::make_reference();
+    const auto block = make_haplotypes(reference, 4);
+    const auto haplotypes = index(block);
+    const auto genotypes = generate_all_genotypes(haplotypes, 3);
+    const auto packed = pack(genotypes);
+    BOOST_REQUIRE(packed);
+    BOOST_REQUIRE_EQUAL(packed->size(), genotypes.size());
+    for (std::size_t g {0}; g < genotypes.size(); ++g) {
+        BOOST_CHECK(is_same_genotype((*packed)[g], genotypes[g]));
+        BOOST_CHECK(unpack((*packed)[g], haplotypes) == genotypes[g]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(genotypes_with_different_ploidies_are_not_packed)
+{
+    const auto reference = mock::make_reference();
+    const auto block = make_haplotypes(reference, 2);
+    const auto haplotypes = index(block);
+    const std::vector<Genotype<IndexedHaplotype<>>> genotypes {
+        Genotype<IndexedHaplotype<>> {haplotypes[0], haplotypes[1]},
+        Genotype<IndexedHaplotype<>> {haplotypes[0], haplotypes[0], haplotypes[1]}
+    };
+    BOOST_CHECK(!pack(genotypes));
+    BOOST_CHECK(pack(std::vector<Genotype<IndexedHaplotype<>>> {}));
+}
+
+BOOST_AUTO_TEST_CASE(genotype_index_range_ranks_genotypes_in_generation_order)
+{
+    const auto reference = mock::make_reference();
+    for (unsigned num_haplotypes {1}; num_haplotypes <= 6; ++num_haplotypes) {
+        const auto block = make_haplotypes(reference, num_haplotypes);
+        const auto haplotypes = index(block);
+        for (unsigned ploidy {1}; ploidy <= 4; ++ploidy) {
+            for (const bool max_zygosity_only : {false, true}) {
+                const auto genotypes = max_zygosity_only ? generate_all_max_zygosity_genotypes(haplotypes, ploidy)
+                                                         : generate_all_genotypes(haplotypes, ploidy);
+                const GenotypeIndexRange range {num_haplotypes, ploidy, max_zygosity_only};
+                BOOST_REQUIRE_EQUAL(range.size(), genotypes.size());
+                std::vector<PackedGenotype::HaplotypeIndex> indices(ploidy);
+                std::size_t num_visited {0};
+                range.for_each([&] (const auto rank, const PackedGenotype& genotype) {
+                    BOOST_REQUIRE_EQUAL(rank, num_visited);
+                    BOOST_CHECK(is_same_genotype(genotype, genotypes[rank]));
+                    BOOST_CHECK_EQUAL(range.rank(genotype), rank);
+                    range.unrank(rank, indices.data());
+                    BOOST_CHECK(std::equal(std::cbegin(indices), std::cend(indices), std::cbegin(genotype)));
+                    ++num_visited;
+                });
+                BOOST_CHECK_EQUAL(num_visited, genotypes.size());
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(genotype_index_range_can_be_materialised_in_chunks)
+{
+    const GenotypeIndexRange range {5, 3};
+    const auto all = range.materialise();
+    BOOST_REQUIRE_EQUAL(all.size(), range.size());
+    const auto chunk = range.materialise(7, 20);
+    BOOST_REQUIRE_EQUAL(chunk.size(), 13);
+    for (std::size_t g {0}; g < chunk.size(); ++g) {
+        BOOST_CHECK(std::equal(std::cbegin(chunk[g]), std::cend(chunk[g]), std::cbegin(all[g + 7])));
+    }
+    BOOST_CHECK(range.materialise(range.size(), range.size() + 1).empty());
+    BOOST_CHECK(GenotypeIndexRange(2, 3, true).empty());
+}
+
+BOOST_AUTO_TEST_CASE(select_top_k_genotypes_returns_best_scoring_ranks_in_order)
+{
+    const GenotypeIndexRange range {6, 2};
+    // A shuffled but distinct score for each genotype
+    const auto score = [] (const PackedGenotype& genotype) {
+        return static_cast<double>((6 * genotype[0] + genotype[1]) * 37 % 41);
+    };
+    std::vector<std::pair<double, std::size_t>> expected {};
+    range.for_each([&] (const auto rank, const PackedGenotype& genotype) { expected.emplace_back(score(genotype), rank); });
+    std::sort(std::begin(expected), std::end(expected), [] (const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+    for (const std::size_t k : {0, 1, 4, 21, 100}) {
+        const auto top = select_top_k_genotypes(range, k, score);
+        BOOST_REQUIRE_EQUAL(top.size(), std::min(k, range.size()));
+        BOOST_CHECK(std::is_sorted(std::cbegin(top), std::cend(top)));
+        std::vector<std::size_t> expected_ranks {};
+        std::transform(std::cbegin(expected), std::next(std::cbegin(expected), top.size()), std::back_inserter(expected_ranks),
+                       [] (const auto& p) { return p.second; });
+        std::sort(std::begin(expected_ranks), std::end(expected_ranks));
+        BOOST_CHECK(top == expected_ranks);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
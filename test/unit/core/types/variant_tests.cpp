@@ -340,6 +340,29 @@ BOOST_AUTO_TEST_CASE(indels_can_be_left_aligned)
     BOOST_CHECK_EQUAL(alt_sequence(left_aligned_insertion), "ACA");
 }
 
+BOOST_AUTO_TEST_CASE(unique_left_align_matches_left_aligning_each_variant)
+{
+    const auto reference = mock::make_reference();
+    
+    // The CAG repeat of contig 4 starts at 603, so the indels in it shift to the same deletion or insertion
+    std::vector<Variant> variants {
+        Variant {GenomicRegion {"4", 10, 11}, reference.fetch_sequence(GenomicRegion {"4", 10, 11}), "A"},
+        Variant {GenomicRegion {"4", 603, 606}, "CAG", ""},
+        Variant {GenomicRegion {"4", 657, 660}, "CAG", ""},
+        Variant {GenomicRegion {"4", 660, 660}, "", "CAG"},
+        Variant {GenomicRegion {"4", 690, 690}, "", "CAG"},
+    };
+    std::sort(std::begin(variants), std::end(variants));
+    std::vector<Variant> expected {};
+    for (const auto& variant : variants) expected.push_back(left_align(variant, reference));
+    std::sort(std::begin(expected), std::end(expected));
+    expected.erase(std::unique(std::begin(expected), std::end(expected)), std::end(expected));
+    
+    BOOST_CHECK_EQUAL(expected.size(), 4);
+    BOOST_CHECK(unique_left_align(variants, reference) == expected);
+    BOOST_CHECK(unique_left_align(std::move(variants), reference) == expected);
+}
+
 BOOST_AUTO_TEST_CASE(can_make_variants_parsimonious)
 {
     const auto reference = mock::make_reference();
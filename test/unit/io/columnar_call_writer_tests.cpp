@@ -0,0 +1,106 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "io/variant/vcf_record.hpp"
+#include "io/variant/vcf_spec.hpp"
+#include "io/variant/columnar_call_writer.hpp"
+#include "utils/compression.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(io)
+BOOST_AUTO_TEST_SUITE(columnar_call_writer)
+
+namespace {
+
+VcfRecord make_call(const GenomicRegion::Position pos, const std::string& gq)
+{
+    VcfRecord::Builder builder {};
+    builder.set_chrom("1").set_pos(pos).set_ref("A").set_alt("C").set_qual(50).set_passed();
+    builder.set_format({vcfspec::format::genotype, vcfspec::format::conditionalQuality});
+    for (const std::string sample : {"A", "B"}) {
+        builder.set_genotype(sample, std::vector<boost::optional<unsigned>> {0u, 1u}, VcfRecord::Builder::Phasing::unphased);
+        builder.set_format(sample, vcfspec::format::conditionalQuality, gq);
+    }
+    return builder.build_once();
+}
+
+std::string read_file(const boost::filesystem::path& file)
+{
+    std::ifstream is {file.string(), std::ios::binary};
+    return {std::istreambuf_iterator<char> {is}, std::istreambuf_iterator<char> {}};
+}
+
+template <typename T>
+T read_value(const std::string& data, const std::size_t offset)
+{
+    T result;
+    std::memcpy(&result, data.data() + offset, sizeof(T));
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(shards_are_chunked_and_indexed)
+{
+    const auto file = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    {
+        ColumnarCallWriter::Config config {};
+        config.chunk_size = 2;
+        ColumnarCallWriter writer {file, {"A", "B"}, config};
+        writer.write(make_call(100, "20"));
+        writer.write(make_call(150, "."));
+        writer.write(make_call(400, "30"));
+        BOOST_CHECK_EQUAL(writer.num_records(), 3);
+    }
+    const auto shard = read_file(file);
+    boost::filesystem::remove(file);
+    const auto& magic = ColumnarCallWriter::magic;
+    constexpr std::size_t footerSize {8 + 4 + 4 + 8 + 8};
+    BOOST_REQUIRE(shard.size() > 2 * magic.size() + footerSize);
+    BOOST_CHECK(shard.compare(0, magic.size(), magic.data(), magic.size()) == 0);
+    BOOST_CHECK(shard.compare(shard.size() - magic.size(), magic.size(), magic.data(), magic.size()) == 0);
+    const auto footer = shard.size() - footerSize;
+    BOOST_REQUIRE_EQUAL(read_value<std::uint64_t>(shard, footer), 2);
+    BOOST_CHECK_EQUAL(read_value<std::uint32_t>(shard, footer + 8), 2);
+    BOOST_REQUIRE_EQUAL(read_value<std::uint32_t>(shard, footer + 12), ColumnarCallWriter::numColumns);
+    const auto index = read_value<std::uint64_t>(shard, footer + 16);
+    BOOST_CHECK_EQUAL(read_value<std::uint32_t>(shard, index), 100);
+    BOOST_CHECK_EQUAL(read_value<std::uint32_t>(shard, index + 4), 150);
+    BOOST_CHECK_EQUAL(read_value<std::uint32_t>(shard, index + 8), 2);
+    const auto column_entry = [&] (const ColumnarCallWriter::Column column) {
+        const auto entry = index + 12 + 16 * static_cast<std::size_t>(column);
+        const auto offset = read_value<std::uint64_t>(shard, entry);
+        const auto size = read_value<std::uint64_t>(shard, entry + 8);
+        return utils::decompress(shard.substr(offset, size));
+    };
+    const auto positions = column_entry(ColumnarCallWriter::Column::pos);
+    BOOST_REQUIRE_EQUAL(positions.size(), 2 * sizeof(std::uint32_t));
+    BOOST_CHECK_EQUAL(read_value<std::uint32_t>(positions, 0), 100);
+    BOOST_CHECK_EQUAL(read_value<std::uint32_t>(positions, 4), 50);
+    const auto gqs = column_entry(ColumnarCallWriter::Column::gq);
+    BOOST_REQUIRE_EQUAL(gqs.size(), 4 * sizeof(std::int32_t));
+    BOOST_CHECK_EQUAL(read_value<std::int32_t>(gqs, 0), 20);
+    BOOST_CHECK_EQUAL(read_value<std::int32_t>(gqs, 12), ColumnarCallWriter::missingInteger);
+    const auto genotypes = column_entry(ColumnarCallWriter::Column::gt);
+    BOOST_REQUIRE_EQUAL(genotypes.size(), 4 * 4);
+    BOOST_CHECK_EQUAL(static_cast<int>(genotypes[0]), 2);
+    BOOST_CHECK_EQUAL(static_cast<int>(genotypes[3]), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
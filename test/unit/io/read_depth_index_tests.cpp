@@ -0,0 +1,147 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <cstdint>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "io/read/read_depth_index.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(io)
+BOOST_AUTO_TEST_SUITE(read_depth_index)
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+using Bin = ReadDepthIndex::Bin;
+
+template <typename T>
+void write_value(std::ostream& os, const T& value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void write_string(std::ostream& os, const std::string& str)
+{
+    write_value(os, static_cast<std::uint32_t>(str.size()));
+    os.write(str.data(), str.size());
+}
+
+std::string read_file(const fs::path& file)
+{
+    std::ifstream is {file.string(), std::ios::binary};
+    return {std::istreambuf_iterator<char> {is}, std::istreambuf_iterator<char> {}};
+}
+
+// A stand-in read file with a hand written index of one sample and contig
+struct IndexedReads
+{
+    fs::path reads;
+
+    IndexedReads(const GenomicRegion::Size bin_size, const std::vector<Bin>& bins)
+    : reads {fs::temp_directory_path() / fs::unique_path()}
+    {
+        std::ofstream {reads.string()} << "reads";
+        std::ofstream index {ReadDepthIndex::default_path(reads).string(), std::ios::binary};
+        const char magic[8] {'O', 'C', 'T', 'O', 'D', 'I', 'X', '\0'};
+        index.write(magic, sizeof(magic));
+        write_value(index, std::uint32_t {1});
+        write_value(index, static_cast<std::uint64_t>(fs::file_size(reads)));
+        write_value(index, static_cast<std::int64_t>(fs::last_write_time(reads)));
+        write_value(index, static_cast<std::uint64_t>(bin_size));
+        write_value(index, std::uint32_t {1});
+        write_string(index, "sample");
+        ReadDepthIndex::MappingQualityHistogram mapping_qualities {};
+        mapping_qualities[60] = 5;
+        write_value(index, mapping_qualities);
+        write_value(index, std::uint32_t {1});
+        write_string(index, "1");
+        write_value(index, static_cast<std::uint64_t>(bins.size()));
+        for (const auto& bin : bins) write_value(index, bin);
+    }
+
+    ~IndexedReads()
+    {
+        fs::remove(ReadDepthIndex::default_path(reads));
+        fs::remove(reads);
+    }
+};
+
+const std::vector<Bin> test_bins {{10, 10}, {20, 40}, {0, 0}, {30, 4}};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(depth_queries_scale_bins_partially_overlapping_the_region)
+{
+    const IndexedReads test {100, test_bins};
+    const auto index = ReadDepthIndex::load(test.reads);
+    BOOST_REQUIRE(index);
+    BOOST_CHECK_EQUAL(index->bin_size(), 100);
+    BOOST_REQUIRE(index->contains("sample"));
+    BOOST_CHECK_EQUAL(index->estimate_read_count("sample", GenomicRegion {"1", 100, 200}), 40);
+    BOOST_CHECK_EQUAL(index->estimate_read_count("sample", GenomicRegion {"1", 50, 150}), 25);
+    BOOST_CHECK_EQUAL(index->estimate_read_count("sample", GenomicRegion {"1", 90, 110}), 5);
+    BOOST_CHECK_EQUAL(index->estimate_read_count("sample", GenomicRegion {"1", 0, 400}), 54);
+    BOOST_CHECK(index->mean_depths("sample", GenomicRegion {"1", 100, 200}) == std::vector<float>({20}));
+    BOOST_CHECK(index->mean_depths("sample", GenomicRegion {"1", 99, 101}) == std::vector<float>({10, 20}));
+    BOOST_CHECK(index->mean_depths("sample", GenomicRegion {"1", 100, 201}) == std::vector<float>({20, 0}));
+    BOOST_CHECK(index->mean_depths("sample", GenomicRegion {"1", 350, 1000}) == std::vector<float>({30}));
+}
+
+BOOST_AUTO_TEST_CASE(depth_queries_of_empty_regions_find_nothing)
+{
+    const IndexedReads test {100, test_bins};
+    const auto index = ReadDepthIndex::load(test.reads);
+    BOOST_REQUIRE(index);
+    BOOST_CHECK_EQUAL(index->estimate_read_count("sample", GenomicRegion {"1", 150, 150}), 0);
+    BOOST_CHECK_EQUAL(index->estimate_read_count("sample", GenomicRegion {"1", 200, 300}), 0);
+    BOOST_CHECK_EQUAL(index->estimate_read_count("sample", GenomicRegion {"1", 400, 500}), 0);
+    BOOST_CHECK(index->mean_depths("sample", GenomicRegion {"1", 400, 500}).empty());
+    BOOST_CHECK_EQUAL(index->estimate_read_count("sample", GenomicRegion {"2", 0, 100}), 0);
+    BOOST_CHECK(index->mean_depths("sample", GenomicRegion {"2", 0, 100}).empty());
+    BOOST_CHECK(!index->contains("other"));
+    BOOST_CHECK_EQUAL(index->estimate_read_count("other", GenomicRegion {"1", 0, 100}), 0);
+    BOOST_CHECK(index->mean_depths("other", GenomicRegion {"1", 0, 100}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(written_indices_load_to_the_same_index)
+{
+    const IndexedReads test {100, test_bins};
+    const auto index_path = ReadDepthIndex::default_path(test.reads);
+    const auto original = read_file(index_path);
+    const auto index = ReadDepthIndex::load(test.reads);
+    BOOST_REQUIRE(index);
+    fs::remove(index_path);
+    index->write(test.reads);
+    BOOST_CHECK(read_file(index_path) == original);
+    const auto reloaded = ReadDepthIndex::load(test.reads);
+    BOOST_REQUIRE(reloaded);
+    BOOST_CHECK_EQUAL(reloaded->bin_size(), 100);
+    BOOST_CHECK_EQUAL(reloaded->mapping_quality_histogram("sample")[60], 5);
+    const GenomicRegion contig {"1", 0, 400};
+    BOOST_CHECK_EQUAL(reloaded->estimate_read_count("sample", contig), index->estimate_read_count("sample", contig));
+    BOOST_CHECK(reloaded->mean_depths("sample", contig) == index->mean_depths("sample", contig));
+}
+
+BOOST_AUTO_TEST_CASE(indices_of_changed_read_files_are_not_loaded)
+{
+    const IndexedReads test {100, test_bins};
+    std::ofstream {test.reads.string(), std::ios::app} << "more reads";
+    BOOST_CHECK(!ReadDepthIndex::load(test.reads));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
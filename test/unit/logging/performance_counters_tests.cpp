@@ -0,0 +1,86 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <sstream>
+#include <thread>
+#include <chrono>
+
+#include "logging/performance_counters.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(logging)
+BOOST_AUTO_TEST_SUITE(performance_counters)
+
+namespace {
+
+auto counter(const performance::Snapshot& snapshot, performance::Counter counter)
+{
+    return snapshot.counters[static_cast<std::size_t>(counter)];
+}
+
+const auto& phase(const performance::Snapshot& snapshot, performance::Phase phase)
+{
+    return snapshot.phases[static_cast<std::size_t>(phase)];
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(nothing_is_recorded_when_disabled)
+{
+    performance::enable(false);
+    const auto before = performance::collect();
+    performance::add(performance::Counter::candidates, 10);
+    { const performance::PhaseTimer timer {performance::Phase::calling}; }
+    const auto after = performance::collect();
+    BOOST_CHECK_EQUAL(counter(after, performance::Counter::candidates), counter(before, performance::Counter::candidates));
+    BOOST_CHECK_EQUAL(phase(after, performance::Phase::calling).count, phase(before, performance::Phase::calling).count);
+}
+
+BOOST_AUTO_TEST_CASE(counts_from_all_threads_are_summed)
+{
+    performance::enable();
+    const auto before = performance::collect();
+    std::thread worker {[] () {
+        performance::add(performance::Counter::haplotypes, 5);
+        performance::record(performance::Phase::latents, std::chrono::microseconds {3});
+    }};
+    worker.join();
+    performance::add(performance::Counter::haplotypes, 2);
+    performance::record(performance::Phase::latents, std::chrono::milliseconds {1});
+    const auto after = performance::collect();
+    performance::enable(false);
+    BOOST_CHECK_EQUAL(counter(after, performance::Counter::haplotypes) - counter(before, performance::Counter::haplotypes), 7);
+    const auto& latents_before = phase(before, performance::Phase::latents);
+    const auto& latents_after = phase(after, performance::Phase::latents);
+    BOOST_CHECK_EQUAL(latents_after.count - latents_before.count, 2);
+    BOOST_CHECK_EQUAL(latents_after.total_ns - latents_before.total_ns, 1'003'000);
+    BOOST_CHECK_EQUAL(latents_after.buckets[2] - latents_before.buckets[2], 1);  // <= 4us
+    BOOST_CHECK_EQUAL(latents_after.buckets[10] - latents_before.buckets[10], 1); // <= 1024us
+}
+
+BOOST_AUTO_TEST_CASE(prometheus_histograms_are_cumulative)
+{
+    performance::Snapshot snapshot {};
+    auto& stats = snapshot.phases[static_cast<std::size_t>(performance::Phase::likelihoods)];
+    stats.count = 3;
+    stats.total_ns = 3'000'000;
+    stats.buckets[0] = 1;
+    stats.buckets[5] = 2;
+    std::ostringstream ss {};
+    performance::write_prometheus(snapshot, ss);
+    const auto text = ss.str();
+    BOOST_CHECK(text.find("octopus_phase_seconds_bucket{phase=\"likelihoods\",le=\"1e-06\"} 1\n") != std::string::npos);
+    BOOST_CHECK(text.find("octopus_phase_seconds_bucket{phase=\"likelihoods\",le=\"+Inf\"} 3\n") != std::string::npos);
+    BOOST_CHECK(text.find("octopus_phase_seconds_count{phase=\"likelihoods\"} 3\n") != std::string::npos);
+    BOOST_CHECK(text.find("octopus_candidates_total 0\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
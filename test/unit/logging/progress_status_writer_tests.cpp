@@ -0,0 +1,78 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "logging/progress_meter.hpp"
+#include "logging/progress_status_writer.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(logging)
+BOOST_AUTO_TEST_SUITE(progress_status_writer)
+
+namespace {
+
+std::vector<std::string> read_lines(const boost::filesystem::path& file)
+{
+    std::ifstream is {file.string()};
+    std::vector<std::string> result {};
+    for (std::string line; std::getline(is, line);) result.push_back(line);
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(a_final_line_is_written_on_destruction)
+{
+    const auto file = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    ProgressMeter meter {GenomicRegion {"1", 0, 1000}};
+    meter.start();
+    meter.set_task_counts(3, 5);
+    meter.log_completed(GenomicRegion {"1", 0, 250});
+    {
+        const ProgressStatusWriter writer {file, meter, std::chrono::hours {1}};
+    }
+    const auto lines = read_lines(file);
+    boost::filesystem::remove(file);
+    BOOST_REQUIRE_EQUAL(lines.size(), 1);
+    const auto& line = lines.front();
+    BOOST_CHECK_EQUAL(line.front(), '{');
+    BOOST_CHECK_EQUAL(line.back(), '}');
+    BOOST_CHECK(line.find("\"completed_bp\":250,\"total_bp\":1000,\"done\":false") != std::string::npos);
+    BOOST_CHECK(line.find("\"tasks_running\":3,\"tasks_queued\":5") != std::string::npos);
+    BOOST_CHECK(line.find("\"contigs\":{\"1\":{\"completed_bp\":250,\"total_bp\":1000}}") != std::string::npos);
+    BOOST_CHECK(line.find("\"eta_seconds\":null") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(a_stopped_meter_is_reported_as_done)
+{
+    const auto file = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    ProgressMeter meter {GenomicRegion {"1", 0, 1000}};
+    meter.start();
+    meter.set_task_counts(1, 0);
+    meter.log_completed(GenomicRegion {"1", 0, 1000});
+    meter.stop();
+    {
+        const ProgressStatusWriter writer {file, meter, std::chrono::hours {1}};
+    }
+    const auto lines = read_lines(file);
+    boost::filesystem::remove(file);
+    BOOST_REQUIRE_EQUAL(lines.size(), 1);
+    BOOST_CHECK(lines.front().find("\"done\":true,\"tasks_running\":0,\"tasks_queued\":0") != std::string::npos);
+    BOOST_CHECK(lines.front().find("\"eta_seconds\":0,") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,85 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <thread>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "logging/task_report.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(logging)
+BOOST_AUTO_TEST_SUITE(task_report)
+
+namespace {
+
+TaskTelemetry make_telemetry(const int wall_time_ms)
+{
+    TaskTelemetry result {};
+    result.runtime.start = std::chrono::system_clock::now();
+    result.runtime.end = result.runtime.start + std::chrono::milliseconds {wall_time_ms};
+    return result;
+}
+
+std::vector<std::string> read_lines(const boost::filesystem::path& file)
+{
+    std::ifstream is {file.string()};
+    std::vector<std::string> result {};
+    for (std::string line; std::getline(is, line);) result.push_back(line);
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(phase_timer_adds_to_its_phase)
+{
+    TaskTelemetry telemetry {};
+    telemetry.likelihoods = std::chrono::seconds {1};
+    const auto before = telemetry.likelihoods;
+    const std::chrono::milliseconds timed {2};
+    {
+        const TaskPhaseTimer timer {&telemetry, &TaskTelemetry::likelihoods};
+        std::this_thread::sleep_for(timed);
+    }
+    BOOST_CHECK(telemetry.likelihoods >= before + timed);
+    BOOST_CHECK_EQUAL(telemetry.latents.count(), 0);
+    const TaskPhaseTimer null_timer {nullptr, &TaskTelemetry::latents};
+}
+
+BOOST_AUTO_TEST_CASE(summary_ranks_the_slowest_tasks)
+{
+    const auto file = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    {
+        TaskReport report {file, 2};
+        report.write(GenomicRegion {"1", 0, 100}, make_telemetry(10));
+        report.write(GenomicRegion {"1", 100, 200}, make_telemetry(30));
+        report.write(GenomicRegion {"1", 200, 300}, make_telemetry(20));
+        report.write_summary();
+    }
+    const auto lines = read_lines(file);
+    boost::filesystem::remove(file);
+    BOOST_REQUIRE_EQUAL(lines.size(), 4);
+    BOOST_CHECK_EQUAL(lines[0].find("{\"region\":\"1:0-100\""), 0);
+    const auto& summary = lines.back();
+    BOOST_CHECK_EQUAL(summary.find("{\"summary\":{\"tasks\":3"), 0);
+    const auto slowest = summary.find("\"1:100-200\"");
+    const auto second_slowest = summary.find("\"1:200-300\"");
+    BOOST_REQUIRE(slowest != std::string::npos);
+    BOOST_REQUIRE(second_slowest != std::string::npos);
+    BOOST_CHECK(slowest < second_slowest);
+    BOOST_CHECK_EQUAL(summary.find("\"1:0-100\""), std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
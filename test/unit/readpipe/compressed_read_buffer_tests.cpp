@@ -0,0 +1,87 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <utility>
+#include <iterator>
+
+#include "basics/aligned_read.hpp"
+#include "readpipe/compressed_read_buffer.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(readpipe)
+BOOST_AUTO_TEST_SUITE(compressed_read_buffer)
+
+namespace {
+
+using Annotations = std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>>;
+
+AlignedRead make_read(GenomicRegion::Position begin, AlignedRead::NucleotideSequence sequence,
+                      AlignedRead::BaseQualityVector qualities)
+{
+    const auto size = static_cast<GenomicRegion::Position>(sequence.size());
+    return AlignedRead {"read" + std::to_string(begin), GenomicRegion {"1", begin, begin + size}, std::move(sequence),
+                        std::move(qualities), CigarString {CigarOperation {size, CigarOperation::Flag::alignmentMatch}},
+                        60, AlignedRead::Flags {}, "RG1", Annotations {}};
+}
+
+ReadMap make_reads()
+{
+    std::vector<AlignedRead> reads {};
+    AlignedRead::Flags flags {};
+    flags.multiple_segment_template = true;
+    flags.reverse_mapped = true;
+    reads.emplace_back("paired", GenomicRegion {"1", 0, 6}, "ACgNTA", AlignedRead::BaseQualityVector {30, 30, 30, 12, 40, 40},
+                       CigarString {CigarOperation {2, CigarOperation::Flag::softClipped}, CigarOperation {4, CigarOperation::Flag::alignmentMatch}},
+                       20, flags, "RG2", "2", 500, 300, AlignedRead::Segment::Flags {false, true},
+                       Annotations {{AlignedRead::Tag {'B','X'}, "ACGT-1"}});
+    for (GenomicRegion::Position begin {1}; begin < 1000; begin += 3) {
+        reads.push_back(make_read(begin, "ACGTTGCA", {30, 30, 30, 30, 30, 30, 20, 10}));
+    }
+    ReadMap result {};
+    result.emplace("A", ReadMap::mapped_type {std::cbegin(reads), std::cend(reads)});
+    result.emplace("B", ReadMap::mapped_type {});
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(compression_is_lossless)
+{
+    const auto reads = make_reads();
+    const CompressedReadBuffer buffer {reads};
+    BOOST_CHECK_EQUAL(buffer.size(), reads.at("A").size());
+    const auto decompressed = buffer.decompress();
+    BOOST_REQUIRE_EQUAL(decompressed.size(), 2);
+    BOOST_CHECK(decompressed.at("B").empty());
+    BOOST_REQUIRE_EQUAL(decompressed.at("A").size(), reads.at("A").size());
+    BOOST_CHECK(std::equal(std::cbegin(reads.at("A")), std::cend(reads.at("A")), std::cbegin(decompressed.at("A"))));
+    const auto& paired = decompressed.at("A").front();
+    BOOST_CHECK_EQUAL(paired.barcode(), "ACGT-1");
+    BOOST_CHECK_EQUAL(paired.read_group(), "RG2");
+    BOOST_CHECK(paired.next_segment().is_marked_reverse_mapped());
+    BOOST_CHECK(buffer.footprint() < buffer.uncompressed_footprint());
+}
+
+BOOST_AUTO_TEST_CASE(only_reads_overlapping_requests_are_decompressed)
+{
+    const auto reads = make_reads();
+    const CompressedReadBuffer buffer {reads};
+    const GenomicRegion region {"1", 500, 520};
+    const auto decompressed = buffer.decompress(region);
+    BOOST_CHECK_EQUAL(decompressed.at("A").size(), count_overlapped(reads.at("A"), region));
+    BOOST_CHECK(decompressed.at("B").empty());
+    const std::vector<GenomicRegion> regions {GenomicRegion {"1", 0, 2}, GenomicRegion {"1", 900, 910}};
+    BOOST_CHECK_EQUAL(buffer.decompress(regions).at("A").size(),
+                      count_overlapped(reads.at("A"), regions.front()) + count_overlapped(reads.at("A"), regions.back()));
+    BOOST_CHECK(buffer.decompress(GenomicRegion {"2", 0, 1000}).at("A").empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,56 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include "basics/contig_region.hpp"
+#include "readpipe/downsampling/streaming_downsampler.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(readpipe)
+BOOST_AUTO_TEST_SUITE(streaming_downsampler)
+
+BOOST_AUTO_TEST_CASE(keeps_reads_until_coverage_reaches_the_maximum)
+{
+    octopus::readpipe::StreamingDownsampler downsampler {{"A"}, 2};
+    BOOST_CHECK(downsampler.keep("A", "1", ContigRegion {0, 10}));
+    BOOST_CHECK(downsampler.keep("A", "1", ContigRegion {2, 10}));
+    BOOST_CHECK(!downsampler.keep("A", "1", ContigRegion {5, 15}));
+    BOOST_CHECK(downsampler.keep("A", "1", ContigRegion {10, 20}));
+    BOOST_CHECK(downsampler.keep("A", "1", ContigRegion {10, 20}));
+    BOOST_CHECK(!downsampler.keep("A", "1", ContigRegion {12, 20}));
+    BOOST_CHECK_EQUAL(downsampler.num_dropped(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(samples_are_downsampled_independently)
+{
+    octopus::readpipe::StreamingDownsampler downsampler {{"A", "B"}, 1};
+    BOOST_CHECK(downsampler.keep("A", "1", ContigRegion {0, 10}));
+    BOOST_CHECK(downsampler.keep("B", "1", ContigRegion {0, 10}));
+    BOOST_CHECK(!downsampler.keep("A", "1", ContigRegion {1, 10}));
+    BOOST_CHECK(downsampler.keep("C", "1", ContigRegion {1, 10}));
+}
+
+BOOST_AUTO_TEST_CASE(reads_out_of_order_start_a_new_stream)
+{
+    octopus::readpipe::StreamingDownsampler downsampler {{"A"}, 1};
+    BOOST_CHECK(downsampler.keep("A", "1", ContigRegion {100, 200}));
+    BOOST_CHECK(downsampler.keep("A", "1", ContigRegion {0, 150}));
+    BOOST_CHECK(!downsampler.keep("A", "1", ContigRegion {100, 200}));
+}
+
+BOOST_AUTO_TEST_CASE(reads_on_a_new_contig_start_a_new_stream)
+{
+    octopus::readpipe::StreamingDownsampler downsampler {{"A"}, 1};
+    BOOST_CHECK(downsampler.keep("A", "1", ContigRegion {100, 300}));
+    BOOST_CHECK(downsampler.keep("A", "2", ContigRegion {200, 300}));
+    BOOST_CHECK(!downsampler.keep("A", "2", ContigRegion {250, 300}));
+    BOOST_CHECK_EQUAL(downsampler.num_dropped(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
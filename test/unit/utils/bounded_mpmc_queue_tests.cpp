@@ -0,0 +1,76 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "utils/bounded_mpmc_queue.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(bounded_mpmc_queue)
+
+BOOST_AUTO_TEST_CASE(capacity_is_rounded_up_to_a_power_of_two)
+{
+    BoundedMPMCQueue<int> queue {100};
+    BOOST_CHECK_EQUAL(queue.capacity(), 128);
+}
+
+BOOST_AUTO_TEST_CASE(values_are_popped_in_fifo_order_until_empty)
+{
+    BoundedMPMCQueue<int> queue {4};
+    for (int i {0}; i < 4; ++i) {
+        BOOST_REQUIRE(queue.try_push(i));
+    }
+    int value {-1};
+    BOOST_CHECK(!queue.try_push(value));
+    BOOST_CHECK_EQUAL(value, -1);
+    for (int i {0}; i < 4; ++i) {
+        BOOST_REQUIRE(queue.try_pop(value));
+        BOOST_CHECK_EQUAL(value, i);
+    }
+    BOOST_CHECK(!queue.try_pop(value));
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_producers_and_consumers_see_every_value_once)
+{
+    BoundedMPMCQueue<int> queue {64};
+    const int num_values {10000};
+    std::atomic<long> sum {0};
+    std::atomic<int> num_popped {0};
+    std::vector<std::thread> threads {};
+    for (int p {0}; p < 2; ++p) {
+        threads.emplace_back([&, p] () {
+            for (int i {p}; i < num_values; i += 2) {
+                auto value = i;
+                while (!queue.try_push(value)) std::this_thread::yield();
+            }
+        });
+    }
+    for (int c {0}; c < 2; ++c) {
+        threads.emplace_back([&] () {
+            int value;
+            while (num_popped < num_values) {
+                if (queue.try_pop(value)) {
+                    sum += value;
+                    ++num_popped;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    BOOST_CHECK_EQUAL(num_popped, num_values);
+    BOOST_CHECK_EQUAL(sum, static_cast<long>(num_values - 1) * num_values / 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,48 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <numeric>
+
+#include "utils/huge_page_allocator.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(huge_page_allocator)
+
+namespace {
+
+template <typename T>
+auto address(const T* p) noexcept
+{
+    return reinterpret_cast<std::uintptr_t>(p);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(small_allocations_are_simd_aligned)
+{
+    for (std::size_t n {1}; n < 100; n += 7) {
+        HugePageVector<float> values(n);
+        BOOST_CHECK_EQUAL(address(values.data()) % 64, 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(large_allocations_are_huge_page_aligned)
+{
+    HugePageVector<double> values(detail::hugePageSize / sizeof(double) + 1);
+    BOOST_CHECK_EQUAL(address(values.data()) % detail::hugePageSize, 0);
+    std::iota(std::begin(values), std::end(values), 0.0);
+    BOOST_CHECK_EQUAL(values.back(), static_cast<double>(values.size() - 1));
+    auto buffer = make_huge_page_buffer<char>(3 * detail::hugePageSize);
+    BOOST_CHECK_EQUAL(address(buffer.get()) % detail::hugePageSize, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
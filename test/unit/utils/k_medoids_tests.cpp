@@ -0,0 +1,74 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include "utils/thread_pool.hpp"
+#include "utils/k_medoids.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(k_medoids)
+
+namespace {
+
+std::vector<double> make_two_groups(const std::size_t n)
+{
+    std::vector<double> result(2 * n);
+    for (std::size_t i {0}; i < n; ++i) {
+        result[2 * i] = static_cast<double>(i % 10);
+        result[2 * i + 1] = 1000.0 + static_cast<double>(i % 10);
+    }
+    return result;
+}
+
+void check_two_groups(const std::vector<double>& values, const ClusterVector& clusters)
+{
+    BOOST_REQUIRE_EQUAL(clusters.size(), 2);
+    std::size_t num_points {0};
+    for (const auto& cluster : clusters) {
+        BOOST_REQUIRE(!cluster.empty());
+        const bool low = values[cluster.front()] < 500;
+        BOOST_CHECK(std::all_of(std::cbegin(cluster), std::cend(cluster), [&] (auto idx) { return (values[idx] < 500) == low; }));
+        num_points += cluster.size();
+    }
+    BOOST_CHECK_EQUAL(num_points, values.size());
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(k_medoids_finds_separated_clusters)
+{
+    const auto values = make_two_groups(100);
+    ClusterVector clusters {};
+    const auto fit = octopus::k_medoids(values, 2, clusters);
+    BOOST_CHECK_EQUAL(fit.first.size(), 2);
+    check_two_groups(values, clusters);
+}
+
+BOOST_AUTO_TEST_CASE(sampled_k_medoids_finds_separated_clusters_without_full_distance_matrix)
+{
+    const auto values = make_two_groups(20'000);
+    ThreadPool pool {4};
+    KMediodsParameters params {};
+    params.max_exact_size = 1'000;
+    params.workers = pool;
+    ClusterVector clusters {};
+    const auto fit = octopus::k_medoids(values, 2, clusters, params);
+    BOOST_CHECK_EQUAL(fit.first.size(), 2);
+    check_two_groups(values, clusters);
+    for (std::size_t i {0}; i < clusters.size(); ++i) {
+        BOOST_CHECK(std::find(std::cbegin(clusters[i]), std::cend(clusters[i]), fit.first[i]) != std::cend(clusters[i]));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
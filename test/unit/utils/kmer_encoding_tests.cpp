@@ -0,0 +1,118 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+
+#include "utils/kmer_encoding.hpp"
+#include "utils/kmer_mapper.hpp"
+#include "utils/sequence_utils.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(kmer_encoding)
+
+namespace {
+
+std::string make_sequence(const std::size_t n)
+{
+    std::string result(n, 'A');
+    std::uint32_t state {42};
+    for (auto& base : result) {
+        state = 1664525 * state + 1013904223;
+        base = "ACGTACGTACGTACGN"[state >> 28];
+    }
+    return result;
+}
+
+RollingKmerEncoder::Code pack(const std::string& kmer)
+{
+    RollingKmerEncoder::Code result {0};
+    for (const char base : kmer) result = 4 * result + (encode_base(base) % 4);
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(encode_bases_matches_encode_base)
+{
+    for (const std::size_t n : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+        auto sequence = make_sequence(n);
+        if (n > 3) sequence[3] = 'a';
+        std::vector<std::uint8_t> codes(n);
+        octopus::utils::simd::encode_bases(sequence.data(), sequence.data() + n, codes.data());
+        for (std::size_t i {0}; i < n; ++i) {
+            BOOST_CHECK_EQUAL(codes[i], encode_base(sequence[i]));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rolling_kmer_encoder_packs_each_window)
+{
+    const auto sequence = make_sequence(300);
+    for (const unsigned k : {1u, 5u, 16u, 31u, 32u}) {
+        RollingKmerEncoder encoder {k};
+        std::size_t num_kmers {0};
+        for_each_kmer(sequence.data(), sequence.data() + sequence.size(), encoder,
+                      [&] (const std::size_t position, const RollingKmerEncoder& kmer) {
+                          BOOST_REQUIRE_EQUAL(position, num_kmers);
+                          const auto window = sequence.substr(position, k);
+                          BOOST_CHECK_EQUAL(kmer.code(), pack(window));
+                          BOOST_CHECK_EQUAL(kmer.is_valid(), window.find('N') == std::string::npos);
+                          if (kmer.is_valid()) {
+                              BOOST_CHECK_EQUAL(kmer.reverse_complement_code(), pack(octopus::utils::reverse_complement_copy(window)));
+                              BOOST_CHECK_EQUAL(kmer.canonical_code(), std::min(kmer.code(), kmer.reverse_complement_code()));
+                          }
+                          ++num_kmers;
+                      });
+        BOOST_CHECK_EQUAL(num_kmers, sequence.size() - k + 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(compute_kmer_hashes_matches_perfect_kmer_hash)
+{
+    const auto sequence = make_sequence(100);
+    const auto hashes = compute_kmer_hashes<6>(sequence);
+    BOOST_REQUIRE_EQUAL(hashes.size(), sequence.size() - 5);
+    for (std::size_t i {0}; i < hashes.size(); ++i) {
+        BOOST_CHECK_EQUAL(hashes[i], perfect_kmer_hash<6>(std::next(std::cbegin(sequence), i)));
+    }
+    BOOST_CHECK(compute_kmer_hashes<6>("ACGT").empty());
+    const auto target = make_sequence(200);
+    const auto mapping = map_query_to_target<6>(target.substr(40, 50), target);
+    BOOST_REQUIRE(!mapping.empty());
+    BOOST_CHECK_EQUAL(mapping.front(), 40);
+}
+
+BOOST_AUTO_TEST_CASE(kmer_hash_table_can_be_repopulated)
+{
+    auto table = init_kmer_hash_table<6>();
+    for (const std::size_t n : {200, 3, 50}) {
+        const auto sequence = make_sequence(n);
+        populate_kmer_hash_table<6>(sequence, table);
+        BOOST_CHECK_EQUAL(table.size(), n < 6 ? 0 : n - 5);
+        std::size_t num_positions {0};
+        for (KmerHashType hash {0}; hash < num_kmers(6); ++hash) {
+            const auto positions = table[hash];
+            BOOST_CHECK(std::is_sorted(std::cbegin(positions), std::cend(positions)));
+            for (const auto position : positions) {
+                BOOST_CHECK_EQUAL(perfect_kmer_hash<6>(std::next(std::cbegin(sequence), position)), hash);
+            }
+            num_positions += positions.size();
+        }
+        BOOST_CHECK_EQUAL(num_positions, table.size());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -5,6 +5,12 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
  
+#include <vector>
+#include <cmath>
+#include <random>
+
+#include <boost/math/special_functions/digamma.hpp>
+
 #include "utils/maths.hpp"
  
 namespace octopus { namespace test {
@@ -22,6 +28,59 @@ BOOST_AUTO_TEST_CASE(log_sum_exp_handles_edge_cases)
     BOOST_CHECK_CLOSE(log_sum_exp(lnHalf, lnHalf), zero, tolerance);
     BOOST_CHECK_CLOSE(log_sum_exp(zero, zero), -lnHalf, tolerance);
 }
+
+namespace {
+
+auto make_random_logs(const std::size_t n)
+{
+    std::mt19937 generator {42};
+    std::uniform_real_distribution<double> distribution {-50.0, 0.0};
+    std::vector<double> result(n);
+    for (auto& value : result) value = distribution(generator);
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(fast_log_sum_exp_matches_log_sum_exp)
+{
+    for (std::size_t n : {1, 3, 4, 7, 64, 65, 1000}) {
+        const auto logs = make_random_logs(n);
+        BOOST_CHECK_CLOSE(octopus::maths::fast_log_sum_exp(logs), octopus::maths::log_sum_exp(logs), tolerance);
+        if (n > 1) {
+            // unaligned start
+            BOOST_CHECK_CLOSE(octopus::maths::fast_log_sum_exp(logs.data() + 1, logs.data() + n),
+                              octopus::maths::log_sum_exp(std::next(std::cbegin(logs)), std::cend(logs)), tolerance);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fast_exp_each_matches_exp)
+{
+    auto values = make_random_logs(1001);
+    const auto logs = values;
+    octopus::maths::fast_exp_each(values);
+    for (std::size_t i {0}; i < values.size(); ++i) {
+        BOOST_CHECK_CLOSE(values[i], std::exp(logs[i]), tolerance);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fast_normalise_exp_matches_normalise_exp)
+{
+    auto fast_values = make_random_logs(100);
+    auto values = fast_values;
+    BOOST_CHECK_CLOSE(octopus::maths::fast_normalise_exp(fast_values), octopus::maths::normalise_exp(values), tolerance);
+    for (std::size_t i {0}; i < values.size(); ++i) {
+        BOOST_CHECK_CLOSE(fast_values[i], values[i], tolerance);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fast_digamma_matches_digamma)
+{
+    for (double x : {1e-3, 0.1, 0.5, 1.0, 2.5, 9.99, 10.0, 42.0, 1e4}) {
+        BOOST_CHECK_SMALL(octopus::maths::fast_digamma(x) - boost::math::digamma(x), 1e-12);
+    }
+}
  
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
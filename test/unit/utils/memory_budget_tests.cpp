@@ -0,0 +1,54 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <utility>
+
+#include "utils/memory_budget.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(memory_budget)
+
+BOOST_AUTO_TEST_CASE(unlimited_budget_always_fits)
+{
+    MemoryBudget budget {};
+    const MemoryBudget::Reservation reservation {budget, 1'000'000};
+
+    BOOST_CHECK(!budget.limit());
+    BOOST_CHECK_EQUAL(budget.used().bytes(), 1'000'000);
+    BOOST_CHECK(!budget.is_exceeded());
+    BOOST_CHECK(budget.fits(1'000'000'000));
+}
+
+BOOST_AUTO_TEST_CASE(reservations_are_returned_when_released)
+{
+    MemoryBudget budget {1'000};
+    {
+        MemoryBudget::Reservation reservation {budget, 400};
+        BOOST_CHECK_EQUAL(budget.available().bytes(), 600);
+        BOOST_CHECK(budget.fits(600));
+        BOOST_CHECK(!budget.fits(601));
+        reservation.resize(1'200);
+        BOOST_CHECK(budget.is_exceeded());
+        BOOST_CHECK_EQUAL(budget.available().bytes(), 0);
+        reservation.resize(100);
+        BOOST_CHECK_EQUAL(budget.used().bytes(), 100);
+        auto moved = std::move(reservation);
+        BOOST_CHECK_EQUAL(budget.used().bytes(), 100);
+        BOOST_CHECK_EQUAL(moved.footprint().bytes(), 100);
+        moved = MemoryBudget::Reservation {budget, 300};
+        BOOST_CHECK_EQUAL(budget.used().bytes(), 300);
+    }
+    BOOST_CHECK_EQUAL(budget.used().bytes(), 0);
+    budget.set_limit(boost::none);
+    BOOST_CHECK(!budget.limit());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,92 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <numeric>
+#include <iterator>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+
+#include "utils/thread_pool.hpp"
+#include "utils/parallel_transform.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(parallel_transform)
+
+BOOST_AUTO_TEST_CASE(parallel_transform_preserves_input_order)
+{
+    ThreadPool pool {4};
+    std::vector<int> values(1000);
+    std::iota(std::begin(values), std::end(values), 0);
+    std::vector<int> result {};
+    octopus::parallel_transform(std::cbegin(values), std::cend(values), std::back_inserter(result),
+                                [] (int value) { return 2 * value; }, pool);
+    BOOST_REQUIRE_EQUAL(result.size(), values.size());
+    for (std::size_t i {0}; i < values.size(); ++i) {
+        BOOST_CHECK_EQUAL(result[i], 2 * values[i]);
+    }
+    std::vector<int> sums(values.size());
+    octopus::parallel_transform(std::cbegin(values), std::cend(values), std::cbegin(values), std::begin(sums),
+                                [] (int lhs, int rhs) { return lhs + rhs; }, pool);
+    BOOST_CHECK(sums == result);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_transform_can_move_from_input)
+{
+    ThreadPool pool {4};
+    std::vector<std::unique_ptr<int>> values {};
+    for (int i {0}; i < 100; ++i) values.push_back(std::make_unique<int>(i));
+    std::vector<int> result {};
+    octopus::parallel_transform(std::make_move_iterator(std::begin(values)), std::make_move_iterator(std::end(values)),
+                                std::back_inserter(result), [] (std::unique_ptr<int> value) { return *value; }, pool);
+    BOOST_REQUIRE_EQUAL(result.size(), values.size());
+    for (int i {0}; i < 100; ++i) BOOST_CHECK_EQUAL(result[i], i);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_each_visits_every_element_once)
+{
+    ThreadPool pool {4};
+    std::list<int> values(1000, 0);
+    parallel_for_each(std::begin(values), std::end(values), [] (int& value) { ++value; }, pool);
+    BOOST_CHECK(std::all_of(std::cbegin(values), std::cend(values), [] (int value) { return value == 1; }));
+    std::atomic<int> count {0};
+    parallel_for_each(std::cbegin(values), std::cend(values), [&] (int) { ++count; }, boost::none);
+    BOOST_CHECK_EQUAL(count, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_reduce_matches_sequential_reduction)
+{
+    ThreadPool pool {4};
+    std::vector<long> values(10'000);
+    std::iota(std::begin(values), std::end(values), 1);
+    const auto plus = [] (long lhs, long rhs) { return lhs + rhs; };
+    BOOST_CHECK_EQUAL(parallel_reduce(std::cbegin(values), std::cend(values), 10l, plus, pool), 10 + 10'000l * 10'001 / 2);
+    BOOST_CHECK_EQUAL(parallel_reduce(std::cend(values), std::cend(values), 10l, plus, pool), 10);
+    const auto square = [] (long value) { return value * value; };
+    const auto expected = std::accumulate(std::cbegin(values), std::cend(values), 0l,
+                                          [&] (long sum, long value) { return sum + square(value); });
+    BOOST_CHECK_EQUAL(parallel_transform_reduce(std::cbegin(values), std::cend(values), 0l, plus, square, pool), expected);
+}
+
+BOOST_AUTO_TEST_CASE(exceptions_are_propagated_to_the_caller)
+{
+    ThreadPool pool {4};
+    std::vector<int> values(100);
+    std::iota(std::begin(values), std::end(values), 0);
+    BOOST_CHECK_THROW(parallel_for_each(std::cbegin(values), std::cend(values),
+                                        [] (int value) { if (value == 50) throw std::runtime_error {"test"}; }, pool),
+                      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,57 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <random>
+
+#include "basics/contig_region.hpp"
+#include "utils/coverage_tracker.hpp"
+#include "utils/range_coverage_tracker.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(range_coverage_tracker)
+
+BOOST_AUTO_TEST_CASE(range_coverage_tracker_agrees_with_coverage_tracker)
+{
+    std::mt19937 generator {42};
+    std::uniform_int_distribution<ContigRegion::Position> begin_dist {1'000, 3'000}, size_dist {1, 300};
+    std::uniform_int_distribution<unsigned> count_dist {1, 3};
+    CoverageTracker<ContigRegion> expected {};
+    RangeCoverageTracker<ContigRegion> tracker {};
+    for (int i {0}; i < 500; ++i) {
+        const auto begin = begin_dist(generator);
+        const ContigRegion region {begin, begin + size_dist(generator)};
+        const auto count = count_dist(generator);
+        expected.add(region, count);
+        tracker.add(region, count);
+        if (i % 100 == 0) BOOST_CHECK_EQUAL(tracker.max(), expected.max()); // queries between adds
+    }
+    BOOST_REQUIRE_EQUAL(tracker.num_tracked(), expected.num_tracked());
+    BOOST_CHECK(*tracker.encompassing_region() == *expected.encompassing_region());
+    BOOST_CHECK_EQUAL(tracker.sum(), expected.sum());
+    BOOST_CHECK_EQUAL(tracker.min(), expected.min());
+    BOOST_CHECK_EQUAL(tracker.max(), expected.max());
+    std::uniform_int_distribution<ContigRegion::Position> query_begin_dist {900, 3'400}, query_size_dist {0, 1'000};
+    for (int i {0}; i < 1'000; ++i) {
+        const auto begin = query_begin_dist(generator);
+        const ContigRegion region {begin, begin + query_size_dist(generator)};
+        BOOST_CHECK_EQUAL(tracker.sum(region), expected.sum(region));
+        BOOST_CHECK_EQUAL(tracker.min(region), expected.min(region));
+        BOOST_CHECK_EQUAL(tracker.max(region), expected.max(region));
+        BOOST_CHECK_EQUAL(tracker.any(region), expected.any(region));
+        if (overlaps(region, *expected.encompassing_region())) {
+            BOOST_CHECK_CLOSE(tracker.mean(region), expected.mean(region), 1e-6);
+        }
+        BOOST_CHECK(tracker.get(region) == expected.get(region));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,156 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <iterator>
+
+#include "basics/genomic_region.hpp"
+#include "basics/cigar_string.hpp"
+#include "basics/aligned_read.hpp"
+#include "utils/read_duplicates.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(read_duplicates)
+
+namespace {
+
+using Annotations = std::vector<std::pair<AlignedRead::Tag, AlignedRead::Annotation>>;
+
+AlignedRead make_read(std::string name, std::string sequence, AlignedRead::BaseQualityVector qualities,
+                      Annotations annotations = {})
+{
+    const auto size = static_cast<GenomicRegion::Size>(sequence.size());
+    AlignedRead::Flags flags {};
+    flags.multiple_segment_template = true;
+    flags.all_segments_in_read_aligned = true;
+    return AlignedRead {std::move(name), GenomicRegion {"1", 100, 100 + size}, std::move(sequence), std::move(qualities),
+                        parse_cigar(std::to_string(size) + "M"), 60, flags, "RG", "1", 300, 250,
+                        AlignedRead::Segment::Flags {}, std::move(annotations)};
+}
+
+AlignedRead make_segment(std::string name, const GenomicRegion::Position begin, const std::string& cigar,
+                         const bool reverse, const GenomicRegion::Size template_length = 300,
+                         const bool next_reverse = true)
+{
+    auto parsed_cigar = parse_cigar(cigar);
+    const auto size = sequence_size(parsed_cigar);
+    AlignedRead::Flags flags {};
+    flags.multiple_segment_template = true;
+    flags.all_segments_in_read_aligned = true;
+    flags.reverse_mapped = reverse;
+    AlignedRead::Segment::Flags next_flags {};
+    next_flags.reverse_mapped = next_reverse;
+    return AlignedRead {std::move(name), GenomicRegion {"1", begin, begin + reference_size(parsed_cigar)},
+                        std::string(size, 'A'), AlignedRead::BaseQualityVector(size, 30), std::move(parsed_cigar),
+                        60, flags, "RG", "1", 400, template_length, next_flags, Annotations {}};
+}
+
+template <typename Container>
+auto get_names(const std::vector<typename Container::const_iterator>& group)
+{
+    std::vector<std::string> result {};
+    for (const auto& read : group) result.push_back(read->name());
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(find_duplicate_reads_finds_duplicates_that_are_not_adjacent)
+{
+    const std::vector<AlignedRead> reads {
+        make_segment("a", 100, "50M", false),
+        make_segment("b", 200, "50M", false),
+        make_segment("c", 100, "50M", false),
+        make_segment("d", 300, "50M", true),
+        make_segment("e", 100, "50M", false)
+    };
+    const auto duplicates = find_duplicate_reads(std::cbegin(reads), std::cend(reads));
+    BOOST_REQUIRE_EQUAL(duplicates.size(), 1);
+    const std::vector<std::string> expected_names {"a", "c", "e"};
+    BOOST_CHECK(get_names<decltype(reads)>(duplicates.front()) == expected_names);
+}
+
+BOOST_AUTO_TEST_CASE(find_duplicate_reads_compares_reverse_reads_by_their_five_prime_end)
+{
+    const std::vector<AlignedRead> reads {
+        make_segment("a", 100, "50M", true),
+        make_segment("b", 120, "30M", false),
+        make_segment("c", 100, "40M", true),
+        make_segment("d", 110, "40M", true),
+        make_segment("e", 105, "45M", true)
+    };
+    const auto duplicates = find_duplicate_reads(std::cbegin(reads), std::cend(reads));
+    BOOST_REQUIRE_EQUAL(duplicates.size(), 1);
+    const std::vector<std::string> expected_names {"a", "d", "e"};
+    BOOST_CHECK(get_names<decltype(reads)>(duplicates.front()) == expected_names);
+}
+
+BOOST_AUTO_TEST_CASE(find_duplicate_reads_does_not_match_near_duplicates)
+{
+    const std::vector<AlignedRead> reads {
+        make_segment("a", 100, "50M", false),
+        make_segment("b", 50, "50M", true), // same 5' position on the other strand
+        make_segment("c", 101, "50M", false),
+        make_segment("d", 100, "50M", false, 301),
+        make_segment("e", 100, "50M", false, 300, false)
+    };
+    BOOST_CHECK(find_duplicate_reads(std::cbegin(reads), std::cend(reads)).empty());
+}
+
+BOOST_AUTO_TEST_CASE(find_duplicate_reads_checks_candidates_with_equal_keys_against_the_definition)
+{
+    const std::vector<AlignedRead> reads {
+        make_segment("a", 100, "50M", false),
+        make_segment("b", 100, "20M1D29M", false),
+        make_segment("c", 100, "10S40M", false),
+        make_segment("d", 100, "50M", false)
+    };
+    const auto duplicates = find_duplicate_reads(std::cbegin(reads), std::cend(reads), FivePrimeAndCigarDuplicateDefinition {});
+    BOOST_REQUIRE_EQUAL(duplicates.size(), 1);
+    const std::vector<std::string> expected_names {"a", "d"};
+    BOOST_CHECK(get_names<decltype(reads)>(duplicates.front()) == expected_names);
+}
+
+BOOST_AUTO_TEST_CASE(collapse_duplicate_reads_merges_families_into_consensus_reads)
+{
+    std::vector<AlignedRead> reads {
+        make_read("c", "ACGT", {30, 30, 30, 30}),
+        make_read("a", "ACGA", {30, 30, 30, 10}),
+        make_read("b", "ACTT", {30, 30, 20, 30})
+    };
+    const auto last = collapse_duplicate_reads(std::begin(reads), std::end(reads));
+    BOOST_REQUIRE_EQUAL(std::distance(std::begin(reads), last), 1);
+    const auto& consensus = reads.front();
+    BOOST_CHECK_EQUAL(consensus.name(), "a");
+    BOOST_CHECK_EQUAL(consensus.sequence(), "ACGT");
+    const AlignedRead::BaseQualityVector expected_qualities {60, 60, 40, 50};
+    BOOST_CHECK(consensus.base_qualities() == expected_qualities);
+}
+
+BOOST_AUTO_TEST_CASE(collapse_duplicate_reads_keeps_reads_with_different_molecular_identifiers)
+{
+    const AlignedRead::Tag rx {'R', 'X'};
+    std::vector<AlignedRead> reads {
+        make_read("a", "ACGT", {30, 30, 30, 30}, {{rx, "AAAA"}}),
+        make_read("b", "ACGT", {30, 30, 30, 30}, {{rx, "CCCC"}}),
+        make_read("c", "ACGT", {30, 30, 30, 30}, {{rx, "AAAA"}})
+    };
+    const auto last = collapse_duplicate_reads(std::begin(reads), std::end(reads));
+    BOOST_REQUIRE_EQUAL(std::distance(std::begin(reads), last), 2);
+    BOOST_CHECK_EQUAL(reads[0].name(), "a");
+    BOOST_CHECK_EQUAL(reads[1].name(), "b");
+    BOOST_CHECK_EQUAL(reads[0].base_qualities().front(), 60);
+    BOOST_CHECK_EQUAL(reads[1].base_qualities().front(), 30);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,116 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/filesystem.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "basics/tandem_repeat.hpp"
+#include "io/reference/reference_reader.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "io/reference/tandem_repeat_index.hpp"
+#include "utils/repeat_finder.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(repeat_finder)
+
+namespace {
+
+std::string make_repetitive_sequence(const std::size_t n)
+{
+    std::string result {};
+    result.reserve(n + 100);
+    std::uint32_t state {42};
+    const auto next = [&] () { state = 1664525 * state + 1013904223; return state >> 8; };
+    while (result.size() < n) {
+        if (next() % 4 != 0) {
+            result += "ACGT"[next() % 4];
+        } else {
+            std::string motif {};
+            for (auto period = 1 + next() % 8; period > 0; --period) motif += "ACGT"[next() % 4];
+            for (auto periods = 2 + next() % 6; periods > 0; --periods) result += motif;
+        }
+    }
+    result.resize(n);
+    // A satellite spanning the first block boundary of the index
+    for (std::size_t i {999'000}; i < 1'001'000 && i + 1 < n; i += 2) result.replace(i, 2, "CA");
+    return result;
+}
+
+class SequenceReader : public io::ReferenceReader
+{
+public:
+    SequenceReader(std::string sequence) : sequence_ {std::move(sequence)} {}
+private:
+    std::string sequence_;
+
+    std::unique_ptr<ReferenceReader> do_clone() const override { return std::make_unique<SequenceReader>(*this); }
+    bool do_is_open() const noexcept override { return true; }
+    std::string do_fetch_reference_name() const override { return "test"; }
+    std::vector<ContigName> do_fetch_contig_names() const override { return {"1"}; }
+    GenomicSize do_fetch_contig_size(const ContigName&) const override { return sequence_.size(); }
+    GeneticSequence do_fetch_sequence(const GenomicRegion& region) const override
+    {
+        return sequence_.substr(region.begin(), size(region));
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(find_exact_tandem_repeats_reports_positions_and_motifs_around_unknown_bases)
+{
+    const std::string sequence {"ACACACGTNNNNNTTTTAGNNGAGAGA"};
+    const GenomicRegion region {"1", 100, 100 + static_cast<GenomicRegion::Position>(sequence.size())};
+    auto repeats = find_exact_tandem_repeats(sequence, region, 1, 2);
+    std::sort(std::begin(repeats), std::end(repeats));
+    const std::vector<TandemRepeat> expected {
+        {GenomicRegion {"1", 100, 106}, "AC"},
+        {GenomicRegion {"1", 113, 117}, "T"},
+        {GenomicRegion {"1", 121, 127}, "GA"}
+    };
+    BOOST_CHECK(repeats == expected);
+}
+
+BOOST_AUTO_TEST_CASE(indexed_tandem_repeats_match_unindexed_tandem_repeats)
+{
+    const auto fasta = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-%%%%.fa");
+    { std::ofstream file {fasta.string()}; file << ">1\n"; }
+    const ReferenceGenome unindexed {std::make_unique<SequenceReader>(make_repetitive_sequence(1'200'000))};
+    io::TandemRepeatIndex::write(unindexed, fasta);
+    auto index = io::TandemRepeatIndex::load(fasta);
+    boost::filesystem::remove(fasta);
+    boost::filesystem::remove(io::TandemRepeatIndex::default_path(fasta));
+    BOOST_REQUIRE(index);
+    auto indexed = unindexed;
+    indexed.set_tandem_repeat_index(std::make_shared<io::TandemRepeatIndex>(std::move(*index)));
+    for (GenomicRegion::Position begin {0}; begin < 1'150'000; begin += 9'973) {
+        const GenomicRegion region {"1", begin, begin + 1 + begin % 5'000};
+        for (const unsigned max_period : {6u, 20u}) {
+            for (const unsigned min_length : {3u, 10u}) {
+                BOOST_CHECK(find_exact_tandem_repeats(indexed, region, max_period, min_length)
+                            == find_exact_tandem_repeats(unindexed, region, max_period, min_length));
+            }
+        }
+    }
+    const GenomicRegion boundary {"1", 999'500, 1'000'500};
+    const auto repeats = find_exact_tandem_repeats(indexed, boundary, 6u, 3u);
+    BOOST_REQUIRE_EQUAL(repeats.size(), 1);
+    BOOST_CHECK_EQUAL(repeats.front().motif(), "CA");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,86 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include "utils/simd_bytes.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(simd_bytes)
+
+namespace {
+
+std::vector<std::uint8_t> make_bytes(const std::size_t n)
+{
+    std::vector<std::uint8_t> result(n);
+    for (std::size_t i {0}; i < n; ++i) result[i] = static_cast<std::uint8_t>((i * 37 + 11) % 256);
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(capitalise_only_changes_lower_case_letters)
+{
+    std::string sequence {};
+    for (int c {0}; c < 256; ++c) sequence.push_back(static_cast<char>(c));
+    sequence += "acgtnACGTN";
+    auto expected = sequence;
+    std::transform(std::cbegin(expected), std::cend(expected), std::begin(expected),
+                   [] (char c) { return 'a' <= c && c <= 'z' ? c - ('a' - 'A') : c; });
+    octopus::utils::simd::capitalise(&sequence.front(), &sequence.front() + sequence.size());
+    BOOST_CHECK_EQUAL(sequence, expected);
+}
+
+BOOST_AUTO_TEST_CASE(cap_and_zero_if_less_match_scalar_results)
+{
+    for (const std::size_t n : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+        auto capped = make_bytes(n), zeroed = capped;
+        octopus::utils::simd::cap(capped.data(), capped.data() + n, 40);
+        octopus::utils::simd::zero_if_less(zeroed.data(), zeroed.data() + n, 40);
+        const auto bytes = make_bytes(n);
+        for (std::size_t i {0}; i < n; ++i) {
+            BOOST_CHECK_EQUAL(capped[i], std::min<std::uint8_t>(bytes[i], 40));
+            BOOST_CHECK_EQUAL(zeroed[i], bytes[i] < 40 ? 0 : bytes[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(find_not_less_finds_the_first_and_last_high_bytes)
+{
+    for (const std::size_t n : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+        for (std::size_t high {0}; high <= n; ++high) {
+            std::vector<std::uint8_t> bytes(n, 5);
+            if (high < n) bytes[high] = 20;
+            const auto first = bytes.data(), last = first + n;
+            BOOST_CHECK_EQUAL(octopus::utils::simd::find_first_not_less(first, last, 20) - first, high);
+            BOOST_CHECK_EQUAL(octopus::utils::simd::find_last_not_less(first, last, 20) - first, high < n ? high + 1 : 0);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(find_first_mismatch_finds_the_first_differing_byte)
+{
+    for (const std::size_t n : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+        for (std::size_t mismatch {0}; mismatch <= n; ++mismatch) {
+            const std::string lhs(n, 'A');
+            auto rhs = lhs;
+            if (mismatch < n) rhs[mismatch] = 'C';
+            const auto first = lhs.data(), last = first + n;
+            BOOST_CHECK_EQUAL(octopus::utils::simd::find_first_mismatch(first, last, rhs.data()) - first, mismatch);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,155 @@
+// Copyright (c) 2015-2021 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <future>
+#include <numeric>
+#include <atomic>
+#include <array>
+#include <memory>
+#include <functional>
+#include <iterator>
+
+#include "utils/thread_pool.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(thread_pool)
+
+BOOST_AUTO_TEST_CASE(all_pushed_tasks_are_run)
+{
+    ThreadPool pool {4};
+    std::vector<std::future<int>> results {};
+    for (int i {0}; i < 1000; ++i) {
+        results.push_back(pool.push([i] () { return i; }));
+    }
+    int sum {0};
+    for (auto& result : results) sum += result.get();
+    BOOST_CHECK_EQUAL(sum, 999 * 1000 / 2);
+}
+
+BOOST_AUTO_TEST_CASE(tasks_can_push_nested_tasks)
+{
+    ThreadPool pool {4};
+    std::vector<std::future<int>> results {};
+    for (int i {0}; i < 100; ++i) {
+        results.push_back(pool.push([&pool, i] () {
+            std::vector<std::future<int>> nested {};
+            for (int j {0}; j < 4; ++j) {
+                nested.push_back(pool.try_push([i] () { return i; }));
+            }
+            int sum {0};
+            for (auto& result : nested) sum += result.get();
+            return sum;
+        }));
+    }
+    int sum {0};
+    for (auto& result : results) sum += result.get();
+    BOOST_CHECK_EQUAL(sum, 4 * 99 * 100 / 2);
+}
+
+BOOST_AUTO_TEST_CASE(waiting_worker_runs_its_own_nested_tasks)
+{
+    ThreadPool pool {1};
+    auto result = pool.push([&pool] () {
+        // With one worker the nested tasks can only run if the waiting worker runs them
+        std::vector<std::future<int>> nested {};
+        for (int j {0}; j < 10; ++j) {
+            nested.push_back(pool.push([j] () { return j; }));
+        }
+        int sum {0};
+        for (auto& f : nested) {
+            pool.wait(f);
+            sum += f.get();
+        }
+        return sum;
+    });
+    BOOST_CHECK_EQUAL(result.get(), 9 * 10 / 2);
+}
+
+BOOST_AUTO_TEST_CASE(push_bulk_runs_all_tasks)
+{
+    ThreadPool pool {4};
+    std::vector<std::function<int()>> tasks {};
+    for (int i {0}; i < 5000; ++i) {
+        tasks.emplace_back([i] () { return i; });
+    }
+    auto results = pool.push_bulk(std::begin(tasks), std::end(tasks));
+    BOOST_REQUIRE_EQUAL(results.size(), tasks.size());
+    int sum {0};
+    for (auto& result : results) sum += result.get();
+    BOOST_CHECK_EQUAL(sum, 4999 * 5000 / 2);
+    BOOST_CHECK_EQUAL(tasks.back()(), 4999);
+}
+
+BOOST_AUTO_TEST_CASE(push_bulk_can_move_tasks)
+{
+    ThreadPool pool {2};
+    std::vector<std::function<int()>> tasks {};
+    for (int i {0}; i < 100; ++i) {
+        tasks.emplace_back([i] () { return i; });
+    }
+    auto results = pool.push_bulk(std::make_move_iterator(std::begin(tasks)), std::make_move_iterator(std::end(tasks)));
+    int sum {0};
+    for (auto& result : results) sum += result.get();
+    BOOST_CHECK_EQUAL(sum, 99 * 100 / 2);
+}
+
+BOOST_AUTO_TEST_CASE(tasks_can_capture_large_and_move_only_state)
+{
+    ThreadPool pool {2};
+    std::array<int, 64> big {};
+    big.fill(1);
+    auto owned = std::make_unique<int>(3);
+    auto large = pool.push([big] () { return std::accumulate(std::cbegin(big), std::cend(big), 0); });
+    auto move_only = pool.push([owned = std::move(owned)] () { return *owned; });
+    BOOST_CHECK_EQUAL(large.get(), 64);
+    BOOST_CHECK_EQUAL(move_only.get(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(pool_without_workers_runs_tasks_in_calling_thread)
+{
+    ThreadPool pool {};
+    BOOST_CHECK(pool.empty());
+    BOOST_CHECK_EQUAL(pool.push([] () { return 1; }).get(), 1);
+    BOOST_CHECK_EQUAL(pool.try_push([] () { return 2; }).get(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(destructor_runs_queued_tasks)
+{
+    std::atomic<int> count {0};
+    {
+        ThreadPool pool {2};
+        for (int i {0}; i < 100; ++i) {
+            pool.push([&count] () { ++count; });
+        }
+    }
+    BOOST_CHECK_EQUAL(count, 100);
+}
+
+BOOST_AUTO_TEST_CASE(node_pushed_tasks_are_run)
+{
+    // Nodes with no listed CPUs are not bound, so this runs on any machine
+    const NumaTopology topology(2);
+    ThreadPool pool {4, topology};
+    BOOST_CHECK_EQUAL(pool.num_nodes(), 2);
+    std::vector<std::future<int>> results {};
+    for (int i {0}; i < 1000; ++i) {
+        results.push_back(pool.push_to_node(i % 3, [i] () { return i; }));
+    }
+    int sum {0};
+    for (auto& result : results) sum += result.get();
+    BOOST_CHECK_EQUAL(sum, 999 * 1000 / 2);
+    ThreadPool flat_pool {2};
+    BOOST_CHECK_EQUAL(flat_pool.num_nodes(), 1);
+    BOOST_CHECK_EQUAL(flat_pool.push_to_node(1, [] () { return 1; }).get(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus